@@ -7,6 +7,8 @@
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
@@ -23,6 +25,13 @@
 
 namespace base {
 
+namespace {
+
+// In microseconds, read by every pump when idle.
+std::atomic<int64_t> g_spin_us{0};
+
+}  // namespace
+
 MessagePumpEpoll::MessagePumpEpoll() {
   epoll_.reset(epoll_create1(/*flags=*/0));
   PCHECK(epoll_.is_valid());
@@ -37,6 +46,12 @@ MessagePumpEpoll::MessagePumpEpoll() {
 
 MessagePumpEpoll::~MessagePumpEpoll() = default;
 
+// static
+void MessagePumpEpoll::SetSpinDuration(TimeDelta spin) {
+  g_spin_us.store(std::max<int64_t>(spin.InMicroseconds(), 0),
+                  std::memory_order_relaxed);
+}
+
 bool MessagePumpEpoll::WatchFileDescriptor(int fd,
                                            bool persistent,
                                            int mode,
@@ -120,6 +135,14 @@ void MessagePumpEpoll::Run(Delegate* delegate) {
       continue;
     }
 
+    if (SpinForEpollEvents(next_work_info)) {
+      processed_io_events_ = false;
+      if (run_state.should_quit) {
+        break;
+      }
+      continue;
+    }
+
     TimeDelta timeout = TimeDelta::Max();
     DCHECK(!next_work_info.delayed_run_time.is_null());
     if (!next_work_info.delayed_run_time.is_max()) {
@@ -267,6 +290,24 @@ bool MessagePumpEpoll::WaitForEpollEvents(TimeDelta timeout) {
   return true;
 }
 
+bool MessagePumpEpoll::SpinForEpollEvents(
+    const Delegate::NextWorkInfo& next_work_info) {
+  const int64_t spin_us = g_spin_us.load(std::memory_order_relaxed);
+  if (spin_us == 0) {
+    return false;
+  }
+  TimeTicks end = TimeTicks::Now() + Microseconds(spin_us);
+  if (!next_work_info.delayed_run_time.is_max()) {
+    end = std::min(end, next_work_info.delayed_run_time);
+  }
+  do {
+    if (WaitForEpollEvents(TimeDelta())) {
+      return true;
+    }
+  } while (TimeTicks::Now() < end);
+  return false;
+}
+
 void MessagePumpEpoll::OnEpollEvent(EpollEventEntry& entry, uint32_t events) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
   DCHECK(!entry.stopped);
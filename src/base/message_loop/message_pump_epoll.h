@@ -46,6 +46,11 @@ class BASE_EXPORT MessagePumpEpoll : public MessagePump,
                            FdWatchController* controller,
                            FdWatcher* watcher);
 
+  // Makes every pump poll for IO for up to `spin` when idle before blocking
+  // in epoll_wait(), trading CPU for wakeup latency. Zero, the default,
+  // blocks right away. May be called while pumps are running.
+  static void SetSpinDuration(TimeDelta spin);
+
   // MessagePump methods:
   void Run(Delegate* delegate) override;
   void Quit() override;
@@ -126,6 +131,9 @@ class BASE_EXPORT MessagePumpEpoll : public MessagePump,
   void StopEpollEvent(EpollEventEntry& entry);
   void UnregisterInterest(const scoped_refptr<Interest>& interest);
   bool WaitForEpollEvents(TimeDelta timeout);
+  // Polls without blocking until an event comes, the spin duration passes or
+  // delayed work is due. Returns whether events were processed.
+  bool SpinForEpollEvents(const Delegate::NextWorkInfo& next_work_info);
   void OnEpollEvent(EpollEventEntry& entry, uint32_t events);
   void HandleEvent(int fd,
                    bool can_read,
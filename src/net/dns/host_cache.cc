@@ -822,6 +822,8 @@ void HostCache::Set(const Key& key,
     }
   }
 
+  if (entry.error() == OK)
+    ttl = std::max(ttl, min_ttl_);
   Entry entry_for_cache(entry, now, ttl, network_changes_);
   entry_for_cache.set_pinning(entry.pinning().value_or(has_active_pin));
   entry_for_cache.PrepareForCacheInsertion();
@@ -867,6 +869,12 @@ void HostCache::set_persistence_delegate(PersistenceDelegate* delegate) {
   delegate_ = delegate;
 }
 
+void HostCache::set_max_entries(size_t max_entries) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  DCHECK_GE(max_entries, size());
+  max_entries_ = max_entries;
+}
+
 void HostCache::clear() {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
@@ -879,6 +887,19 @@ void HostCache::clear() {
     delegate_->ScheduleWrite();
 }
 
+void HostCache::Shrink(size_t max_entries) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  if (size() <= max_entries)
+    return;
+
+  base::TimeTicks now = tick_clock_->NowTicks();
+  while (size() > max_entries && EvictOneEntry(now)) {
+  }
+  if (delegate_)
+    delegate_->ScheduleWrite();
+}
+
 void HostCache::ClearForHosts(
     const base::RepeatingCallback<bool(const std::string&)>& host_filter) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
@@ -444,6 +444,14 @@ class NET_EXPORT HostCache {
 
   void set_persistence_delegate(PersistenceDelegate* delegate);
 
+  // Changes the capacity. Must not shrink it below size(). A capacity of 0
+  // disables the cache.
+  void set_max_entries(size_t max_entries);
+
+  // Keeps successful results for at least |min_ttl|, even if their records
+  // expire sooner.
+  void set_min_ttl(base::TimeDelta min_ttl) { min_ttl_ = min_ttl; }
+
   void set_tick_clock_for_testing(const base::TickClock* tick_clock) {
     tick_clock_ = tick_clock;
   }
@@ -451,6 +459,10 @@ class NET_EXPORT HostCache {
   // Empties the cache.
   void clear();
 
+  // Evicts entries, expired and oldest first, until at most |max_entries|
+  // are left. Pinned entries are kept anyway.
+  void Shrink(size_t max_entries);
+
   // Clears hosts matching |host_filter| from the cache.
   void ClearForHosts(
       const base::RepeatingCallback<bool(const std::string&)>& host_filter);
@@ -519,6 +531,7 @@ class NET_EXPORT HostCache {
   // a resolved result entry.
   EntryMap entries_;
   size_t max_entries_;
+  base::TimeDelta min_ttl_;
   int network_changes_ = 0;
   // Number of cache entries that were restored in the last call to
   // RestoreFromListValue(). Used in histograms.
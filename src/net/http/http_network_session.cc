@@ -20,6 +20,7 @@
 #include "net/base/features.h"
 #include "net/dns/host_resolver.h"
 #include "net/http/http_auth_handler_factory.h"
+#include "net/http/http_proxy_warm_pool.h"
 #include "net/http/http_response_body_drainer.h"
 #include "net/http/http_stream_factory.h"
 #include "net/http/url_security_manager.h"
@@ -30,6 +31,7 @@
 #include "net/socket/client_socket_factory.h"
 #include "net/socket/client_socket_pool_manager_impl.h"
 #include "net/socket/next_proto.h"
+#include "net/socket/socks5_warm_pool.h"
 #include "net/socket/ssl_client_socket.h"
 #include "net/spdy/spdy_session.h"
 #include "net/spdy/spdy_session_pool.h"
@@ -185,6 +187,14 @@ HttpNetworkSession::HttpNetworkSession(const HttpNetworkSessionParams& params,
   CHECK(http_server_properties_);
   DCHECK(context_.client_socket_factory);
 
+  if (params_.http_proxy_warm_sockets > 0) {
+    http_proxy_warm_pool_ =
+        std::make_unique<HttpProxyWarmPool>(params_.http_proxy_warm_sockets);
+  }
+  if (params_.socks5_warm_sockets > 0) {
+    socks5_warm_pool_ =
+        std::make_unique<SOCKS5WarmPool>(params_.socks5_warm_sockets);
+  }
   normal_socket_pool_manager_ = std::make_unique<ClientSocketPoolManagerImpl>(
       CreateCommonConnectJobParams(false /* for_websockets */),
       CreateCommonConnectJobParams(true /* for_websockets */),
@@ -367,7 +377,7 @@ CommonConnectJobParams HttpNetworkSession::CreateCommonConnectJobParams(
     bool for_websockets) {
   // Use null websocket_endpoint_lock_manager, which is only set for WebSockets,
   // and only when not using a proxy.
-  return CommonConnectJobParams(
+  CommonConnectJobParams common_connect_job_params(
       context_.client_socket_factory, context_.host_resolver, &http_auth_cache_,
       context_.http_auth_handler_factory, &spdy_session_pool_,
       &context_.quic_context->params()->supported_versions, &quic_session_pool_,
@@ -377,6 +387,9 @@ CommonConnectJobParams HttpNetworkSession::CreateCommonConnectJobParams(
       for_websockets ? &websocket_endpoint_lock_manager_ : nullptr,
       context_.http_server_properties, &next_protos_, &application_settings_,
       &params_.ignore_certificate_errors, &params_.enable_early_data);
+  common_connect_job_params.http_proxy_warm_pool = http_proxy_warm_pool_.get();
+  common_connect_job_params.socks5_warm_pool = socks5_warm_pool_.get();
+  return common_connect_job_params;
 }
 
 ClientSocketPoolManager* HttpNetworkSession::GetSocketPoolManager(
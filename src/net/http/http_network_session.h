@@ -51,6 +51,7 @@ class ClientSocketPool;
 class ClientSocketPoolManager;
 class HostResolver;
 class HttpAuthHandlerFactory;
+class HttpProxyWarmPool;
 class HttpNetworkSessionPeer;
 class HttpResponseBodyDrainer;
 class HttpServerProperties;
@@ -69,6 +70,7 @@ class ReportingService;
 #endif
 class SCTAuditingDelegate;
 class SocketPerformanceWatcherFactory;
+class SOCKS5WarmPool;
 class SSLConfigService;
 class TransportSecurityState;
 
@@ -95,6 +97,12 @@ struct NET_EXPORT HttpNetworkSessionParams {
   bool enable_spdy_ping_based_connection_checking = true;
   bool enable_http2 = true;
   size_t spdy_session_max_recv_window_size;
+  // Idle connections kept per HTTP/1.1 proxy, see HttpProxyWarmPool. 0
+  // disables it.
+  size_t http_proxy_warm_sockets = 0;
+  // Greeted connections kept per SOCKS5 proxy, see SOCKS5WarmPool. 0 disables
+  // it.
+  size_t socks5_warm_sockets = 0;
   // Maximum number of capped frames that can be queued at any time.
   int spdy_session_max_queued_capped_frames;
   // Whether SPDY pools should mark sessions as going away upon relevant network
@@ -346,6 +354,10 @@ class NET_EXPORT HttpNetworkSession {
   HttpNetworkSessionParams params_;
   HttpNetworkSessionContext context_;
 
+  // Destroyed first, its connect jobs use all of the above.
+  std::unique_ptr<HttpProxyWarmPool> http_proxy_warm_pool_;
+  std::unique_ptr<SOCKS5WarmPool> socks5_warm_pool_;
+
   std::unique_ptr<base::MemoryPressureListener> memory_pressure_listener_;
 
   THREAD_CHECKER(thread_checker_);
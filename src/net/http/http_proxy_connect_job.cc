@@ -27,6 +27,7 @@
 #include "net/base/proxy_chain.h"
 #include "net/base/session_usage.h"
 #include "net/dns/public/secure_dns_policy.h"
+#include "net/http/http_proxy_warm_pool.h"
 #include "net/log/net_log_source_type.h"
 #include "net/log/net_log_with_source.h"
 #include "net/nqe/network_quality_estimator.h"
@@ -262,7 +263,8 @@ const RequestPriority HttpProxyConnectJob::kH2QuicTunnelPriority =
 LoadState HttpProxyConnectJob::GetLoadState() const {
   switch (next_state_) {
     case STATE_TRANSPORT_CONNECT_COMPLETE:
-      return nested_connect_job_->GetLoadState();
+      return nested_connect_job_ ? nested_connect_job_->GetLoadState()
+                                 : LOAD_STATE_CONNECTING;
     case STATE_HTTP_PROXY_CONNECT:
     case STATE_HTTP_PROXY_CONNECT_COMPLETE:
     case STATE_SPDY_PROXY_CREATE_STREAM:
@@ -486,6 +488,23 @@ int HttpProxyConnectJob::DoBeginConnect() {
 
 int HttpProxyConnectJob::DoTransportConnect() {
   ProxyServer::Scheme scheme = GetProxyServerScheme();
+  if (scheme == ProxyServer::SCHEME_HTTPS && params_->tunnel() &&
+      common_connect_job_params()->spdy_session_pool->FindAvailableSession(
+          CreateSpdySessionKey(), /*enable_ip_based_pooling=*/false,
+          /*is_websocket=*/false, net_log())) {
+    // Skip making a new connection if we have an existing HTTP/2 session.
+    next_state_ = STATE_SPDY_PROXY_CREATE_STREAM;
+    return OK;
+  }
+  if (HttpProxyWarmPool* warm_pool =
+          common_connect_job_params()->http_proxy_warm_pool) {
+    warm_socket_ = warm_pool->Take(params_, common_connect_job_params());
+    if (warm_socket_) {
+      next_state_ = STATE_TRANSPORT_CONNECT_COMPLETE;
+      return OK;
+    }
+  }
+
   if (scheme == ProxyServer::SCHEME_HTTP) {
     nested_connect_job_ = std::make_unique<TransportConnectJob>(
         priority(), socket_tag(), common_connect_job_params(),
@@ -493,15 +512,6 @@ int HttpProxyConnectJob::DoTransportConnect() {
   } else {
     DCHECK_EQ(scheme, ProxyServer::SCHEME_HTTPS);
     DCHECK(params_->is_over_ssl());
-    // Skip making a new connection if we have an existing HTTP/2 session.
-    if (params_->tunnel() &&
-        common_connect_job_params()->spdy_session_pool->FindAvailableSession(
-            CreateSpdySessionKey(), /*enable_ip_based_pooling=*/false,
-            /*is_websocket=*/false, net_log())) {
-      next_state_ = STATE_SPDY_PROXY_CREATE_STREAM;
-      return OK;
-    }
-
     nested_connect_job_ = std::make_unique<SSLConnectJob>(
         priority(), socket_tag(), common_connect_job_params(),
         params_->ssl_params(), this, &net_log());
@@ -512,6 +522,13 @@ int HttpProxyConnectJob::DoTransportConnect() {
 }
 
 int HttpProxyConnectJob::DoTransportConnectComplete(int result) {
+  if (warm_socket_) {
+    // Connected to the proxy over HTTP/1.1 ahead of time.
+    DCHECK_EQ(result, OK);
+    has_established_connection_ = true;
+    next_state_ = STATE_HTTP_PROXY_CONNECT;
+    return OK;
+  }
   resolve_error_info_ = nested_connect_job_->GetResolveErrorInfo();
   ProxyServer::Scheme scheme = GetProxyServerScheme();
   if (result != OK) {
@@ -608,9 +625,11 @@ int HttpProxyConnectJob::DoHttpProxyConnect() {
 
   // Add a HttpProxy connection on top of the tcp socket.
   transport_socket_ = std::make_unique<HttpProxyClientSocket>(
-      nested_connect_job_->PassSocket(), GetUserAgent(), params_->endpoint(),
-      params_->proxy_chain(), params_->proxy_chain_index(),
-      http_auth_controller_, common_connect_job_params()->proxy_delegate,
+      warm_socket_ ? std::move(warm_socket_)
+                   : nested_connect_job_->PassSocket(),
+      GetUserAgent(), params_->endpoint(), params_->proxy_chain(),
+      params_->proxy_chain_index(), http_auth_controller_,
+      common_connect_job_params()->proxy_delegate,
       params_->traffic_annotation());
   nested_connect_job_.reset();
   return transport_socket_->Connect(base::BindOnce(
@@ -289,6 +289,8 @@ class NET_EXPORT_PRIVATE HttpProxyConnectJob : public ConnectJob,
   ResolveErrorInfo resolve_error_info_;
 
   std::unique_ptr<ConnectJob> nested_connect_job_;
+  // Taken from the HttpProxyWarmPool instead of `nested_connect_job_`.
+  std::unique_ptr<StreamSocket> warm_socket_;
   std::unique_ptr<ProxyClientSocket> transport_socket_;
 
   std::unique_ptr<SpdyStreamRequest> spdy_stream_request_;
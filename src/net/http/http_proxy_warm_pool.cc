@@ -0,0 +1,137 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/http/http_proxy_warm_pool.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/containers/contains.h"
+#include "base/notreached.h"
+#include "base/ranges/algorithm.h"
+#include "net/base/net_errors.h"
+#include "net/base/request_priority.h"
+#include "net/http/http_proxy_connect_job.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/socket_tag.h"
+#include "net/socket/ssl_connect_job.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/transport_connect_job.h"
+
+namespace net {
+
+namespace {
+// Below the 60 seconds nginx and others give a connection to send its
+// first request.
+constexpr base::TimeDelta kIdleTimeout = base::Seconds(30);
+}  // namespace
+
+HttpProxyWarmPool::IdleSocket::IdleSocket(std::unique_ptr<StreamSocket> socket,
+                                          base::TimeTicks since)
+    : socket(std::move(socket)), since(since) {}
+HttpProxyWarmPool::IdleSocket::IdleSocket(IdleSocket&&) = default;
+HttpProxyWarmPool::IdleSocket& HttpProxyWarmPool::IdleSocket::operator=(
+    IdleSocket&&) = default;
+HttpProxyWarmPool::IdleSocket::~IdleSocket() = default;
+
+HttpProxyWarmPool::Proxy::Proxy() = default;
+HttpProxyWarmPool::Proxy::~Proxy() = default;
+
+HttpProxyWarmPool::HttpProxyWarmPool(size_t size) : size_(size) {
+  DCHECK_GT(size_, 0u);
+}
+
+HttpProxyWarmPool::~HttpProxyWarmPool() = default;
+
+std::unique_ptr<StreamSocket> HttpProxyWarmPool::Take(
+    const scoped_refptr<HttpProxySocketParams>& params,
+    const CommonConnectJobParams* common_connect_job_params) {
+  // Only the first hop of a tunnel is a plain connection to the proxy.
+  if (!params->tunnel() || params->is_over_quic() ||
+      params->proxy_chain().is_multi_proxy()) {
+    return nullptr;
+  }
+  Proxy& proxy = proxies_[params->proxy_server()];
+  if (proxy.multiplexed)
+    return nullptr;
+  proxy.params = params;
+  proxy.common_connect_job_params = common_connect_job_params;
+
+  // Oldest first, before the proxy closes them.
+  std::unique_ptr<StreamSocket> socket;
+  base::TimeTicks now = base::TimeTicks::Now();
+  while (!socket && !proxy.idle.empty()) {
+    IdleSocket idle = std::move(proxy.idle.front());
+    proxy.idle.pop_front();
+    if (now - idle.since < kIdleTimeout && idle.socket->IsConnectedAndIdle())
+      socket = std::move(idle.socket);
+  }
+  TopUp(proxy);
+  return socket;
+}
+
+void HttpProxyWarmPool::OnConnectJobComplete(int result, ConnectJob* job) {
+  for (auto& [server, proxy] : proxies_) {
+    if (base::Contains(proxy.jobs, job, &std::unique_ptr<ConnectJob>::get)) {
+      OnJobComplete(proxy, job, result);
+      return;
+    }
+  }
+  NOTREACHED();
+}
+
+void HttpProxyWarmPool::OnNeedsProxyAuth(
+    const HttpResponseInfo& response,
+    HttpAuthController* auth_controller,
+    base::OnceClosure restart_with_auth_callback,
+    ConnectJob* job) {
+  // Connections to the proxy send no requests.
+  NOTREACHED();
+}
+
+void HttpProxyWarmPool::TopUp(Proxy& proxy) {
+  while (!proxy.multiplexed && proxy.jobs.size() + proxy.idle.size() < size_) {
+    std::unique_ptr<ConnectJob> job;
+    if (proxy.params->is_over_ssl()) {
+      job = std::make_unique<SSLConnectJob>(
+          IDLE, SocketTag(), proxy.common_connect_job_params,
+          proxy.params->ssl_params(), this, /*net_log=*/nullptr);
+    } else {
+      job = std::make_unique<TransportConnectJob>(
+          IDLE, SocketTag(), proxy.common_connect_job_params,
+          proxy.params->transport_params(), this, /*net_log=*/nullptr);
+    }
+    ConnectJob* raw_job = job.get();
+    proxy.jobs.push_back(std::move(job));
+    int rv = raw_job->Connect();
+    if (rv == ERR_IO_PENDING)
+      continue;
+    OnJobComplete(proxy, raw_job, rv);
+    // Failures are retried on the next Take().
+    if (rv != OK)
+      break;
+  }
+}
+
+void HttpProxyWarmPool::OnJobComplete(Proxy& proxy,
+                                      ConnectJob* job,
+                                      int result) {
+  auto it =
+      base::ranges::find(proxy.jobs, job, &std::unique_ptr<ConnectJob>::get);
+  CHECK(it != proxy.jobs.end());
+  std::unique_ptr<ConnectJob> owned_job = std::move(*it);
+  proxy.jobs.erase(it);
+  if (result != OK)
+    return;
+  std::unique_ptr<StreamSocket> socket = owned_job->PassSocket();
+  if (socket->GetNegotiatedProtocol() == kProtoHTTP2) {
+    proxy.multiplexed = true;
+    proxy.jobs.clear();
+    proxy.idle.clear();
+    return;
+  }
+  proxy.idle.emplace_back(std::move(socket), base::TimeTicks::Now());
+}
+
+}  // namespace net
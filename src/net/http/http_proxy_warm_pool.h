@@ -0,0 +1,86 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_HTTP_HTTP_PROXY_WARM_POOL_H_
+#define NET_HTTP_HTTP_PROXY_WARM_POOL_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/containers/circular_deque.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/time/time.h"
+#include "net/base/net_export.h"
+#include "net/base/proxy_server.h"
+#include "net/socket/connect_job.h"
+
+namespace net {
+
+class HttpProxySocketParams;
+class StreamSocket;
+
+// Idle connections to HTTP/1.1 proxies, over TCP or TLS, which
+// HttpProxyConnectJob sends its CONNECT over instead of connecting anew, so a
+// tunnel costs only the CONNECT round trip. Whenever one is taken, the
+// connections to its proxy are topped up to `size` in the background.
+// Proxies negotiating HTTP/2 are not warmed, their sessions are shared
+// anyway. Connections are shared by all network anonymization keys. Owned by
+// the HttpNetworkSession.
+class NET_EXPORT_PRIVATE HttpProxyWarmPool : public ConnectJob::Delegate {
+ public:
+  explicit HttpProxyWarmPool(size_t size);
+  ~HttpProxyWarmPool() override;
+  HttpProxyWarmPool(const HttpProxyWarmPool&) = delete;
+  HttpProxyWarmPool& operator=(const HttpProxyWarmPool&) = delete;
+
+  // Returns an idle connection to the proxy of `params`, or null, e.g. for
+  // the first tunnel through it. `common_connect_job_params` must outlive
+  // the pool.
+  std::unique_ptr<StreamSocket> Take(
+      const scoped_refptr<HttpProxySocketParams>& params,
+      const CommonConnectJobParams* common_connect_job_params);
+
+  // ConnectJob::Delegate:
+  void OnConnectJobComplete(int result, ConnectJob* job) override;
+  void OnNeedsProxyAuth(const HttpResponseInfo& response,
+                        HttpAuthController* auth_controller,
+                        base::OnceClosure restart_with_auth_callback,
+                        ConnectJob* job) override;
+
+ private:
+  struct IdleSocket {
+    IdleSocket(std::unique_ptr<StreamSocket> socket, base::TimeTicks since);
+    IdleSocket(IdleSocket&&);
+    IdleSocket& operator=(IdleSocket&&);
+    ~IdleSocket();
+
+    std::unique_ptr<StreamSocket> socket;
+    base::TimeTicks since;
+  };
+
+  struct Proxy {
+    Proxy();
+    ~Proxy();
+
+    // Of the last tunnel taking a connection, to connect more like it.
+    scoped_refptr<HttpProxySocketParams> params;
+    raw_ptr<const CommonConnectJobParams> common_connect_job_params = nullptr;
+    std::vector<std::unique_ptr<ConnectJob>> jobs;
+    base::circular_deque<IdleSocket> idle;
+    // Negotiated HTTP/2, so it is no longer warmed.
+    bool multiplexed = false;
+  };
+
+  void TopUp(Proxy& proxy);
+  void OnJobComplete(Proxy& proxy, ConnectJob* job, int result);
+
+  const size_t size_;
+  std::map<ProxyServer, Proxy> proxies_;
+};
+
+}  // namespace net
+#endif  // NET_HTTP_HTTP_PROXY_WARM_POOL_H_
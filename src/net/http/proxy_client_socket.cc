@@ -5,8 +5,10 @@
 #include "net/http/proxy_client_socket.h"
 
 #include <unordered_set>
+#include <utility>
 
 #include "base/metrics/histogram_macros.h"
+#include "base/notreached.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "net/base/host_port_pair.h"
@@ -21,6 +23,38 @@ namespace net {
 
 void ProxyClientSocket::SetStreamPriority(RequestPriority priority) {}
 
+int ProxyClientSocket::ReadSpdyBuffer(std::unique_ptr<SpdyBuffer>* buffer,
+                                      CompletionOnceCallback callback) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+size_t ProxyClientSocket::GetReadBacklogSize() const {
+  return 0;
+}
+
+void ProxyClientSocket::SetReadAheadLimit(int32_t limit) {}
+
+int ProxyClientSocket::PeekReadData(base::span<base::span<const char>> regions,
+                                    CompletionOnceCallback callback) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+void ProxyClientSocket::ConsumeReadData(size_t bytes) {
+  NOTREACHED();
+}
+
+int ProxyClientSocket::GetWriteHeadroom() const {
+  return 0;
+}
+
+int ProxyClientSocket::WriteInPlace(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return Write(buf, buf_len, std::move(callback), traffic_annotation);
+}
+
 // static
 void ProxyClientSocket::BuildTunnelRequest(
     const HostPortPair& endpoint,
@@ -5,9 +5,11 @@
 #ifndef NET_HTTP_PROXY_CLIENT_SOCKET_H_
 #define NET_HTTP_PROXY_CLIENT_SOCKET_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
+#include "base/containers/span.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 #include "net/base/request_priority.h"
@@ -22,6 +24,7 @@ class HttpResponseInfo;
 class HttpRequestHeaders;
 class HttpAuthController;
 class NetLogWithSource;
+class SpdyBuffer;
 
 // A common base class for a stream socket tunneled through a proxy.
 class NET_EXPORT_PRIVATE ProxyClientSocket : public StreamSocket {
@@ -55,6 +58,49 @@ class NET_EXPORT_PRIVATE ProxyClientSocket : public StreamSocket {
   // Set the priority of the underlying stream (for SPDY and QUIC)
   virtual void SetStreamPriority(RequestPriority priority);
 
+  // Like ReadIfReady(), but hands over the next received chunk of tunnel
+  // data in |*buffer| instead of copying it into a caller's buffer. Its
+  // flow control window is returned once |*buffer| is consumed or
+  // destroyed. Returns ERR_NOT_IMPLEMENTED if the tunnel does not receive
+  // data in SpdyBuffers.
+  virtual int ReadSpdyBuffer(std::unique_ptr<SpdyBuffer>* buffer,
+                             CompletionOnceCallback callback);
+
+  // Returns the bytes of tunnel data received and held until read, for
+  // memory accounting. 0 if the tunnel does not hold any itself.
+  virtual size_t GetReadBacklogSize() const;
+
+  // Until the received tunnel data next runs out, keeps at most |limit|
+  // bytes of it buffered or in flight from the peer, e.g. while the reader
+  // cannot pass it on. Does nothing if the tunnel has no flow control of its
+  // own.
+  virtual void SetReadAheadLimit(int32_t limit);
+
+  // Like ReadIfReady(), but fills |regions| with the received tunnel data
+  // in place instead of copying it, and returns the number filled, or 0 at
+  // EOF. The data stays valid until the socket is used otherwise, so it is
+  // to be passed on at once. It is read again until ConsumeReadData().
+  // Returns ERR_NOT_IMPLEMENTED if the tunnel cannot hand out its data.
+  virtual int PeekReadData(base::span<base::span<const char>> regions,
+                           CompletionOnceCallback callback);
+
+  // Consumes the first |bytes| of the data of PeekReadData().
+  virtual void ConsumeReadData(size_t bytes);
+
+  // The bytes WriteInPlace() needs free before the data of its buffer. 0 if
+  // the tunnel frames writes by copying them.
+  virtual int GetWriteHeadroom() const;
+
+  // Like Write(), but frames the data of |buf| where it is instead of
+  // copying it, writing over the GetWriteHeadroom() bytes before it and over
+  // the bytes of |buf| already sent. |buf| must not change until the write
+  // completes. Same as Write() by default.
+  virtual int WriteInPlace(
+      IOBuffer* buf,
+      int buf_len,
+      CompletionOnceCallback callback,
+      const NetworkTrafficAnnotationTag& traffic_annotation);
+
  protected:
   // The HTTP CONNECT method for establishing a tunnel connection is documented
   // in Section 9.3.6 of RFC 9110.
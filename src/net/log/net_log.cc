@@ -100,6 +100,17 @@ void NetLog::AddObserver(NetLog::ThreadSafeObserver* observer,
   UpdateObserverCaptureModes();
 }
 
+void NetLog::AddObserver(NetLog::ThreadSafeObserver* observer,
+                         NetLogCaptureMode capture_mode,
+                         const std::vector<NetLogEventType>& event_types) {
+  observer->filters_event_types_ = true;
+  observer->event_types_.reset();
+  for (NetLogEventType type : event_types) {
+    observer->event_types_.set(static_cast<size_t>(type));
+  }
+  AddObserver(observer, capture_mode);
+}
+
 void NetLog::RemoveObserver(NetLog::ThreadSafeObserver* observer) {
   base::AutoLock lock(lock_);
 
@@ -111,6 +122,8 @@ void NetLog::RemoveObserver(NetLog::ThreadSafeObserver* observer) {
 
   observer->net_log_ = nullptr;
   observer->capture_mode_ = NetLogCaptureMode::kDefault;
+  observer->filters_event_types_ = false;
+  observer->event_types_.reset();
   UpdateObserverCaptureModes();
 }
 
@@ -148,6 +161,26 @@ void NetLog::UpdateObserverCaptureModes() {
     NetLogCaptureModeSetAdd(observer->capture_mode_, &capture_mode_set);
   }
 
+  std::bitset<static_cast<size_t>(NetLogEventType::COUNT)> event_types;
+  bool filters_event_types = !observers_.empty();
+  for (const net::NetLog::ThreadSafeObserver* observer : observers_) {
+    if (!observer->filters_event_types_) {
+      filters_event_types = false;
+      break;
+    }
+    event_types |= observer->event_types_;
+  }
+  for (size_t i = 0; i < observed_event_types_.size(); ++i) {
+    uint32_t word = 0;
+    for (size_t bit = 0; bit < 32 && i * 32 + bit < event_types.size();
+         ++bit) {
+      if (event_types.test(i * 32 + bit))
+        word |= 1u << bit;
+    }
+    base::subtle::NoBarrier_Store(&observed_event_types_[i], word);
+  }
+  base::subtle::NoBarrier_Store(&filters_event_types_, filters_event_types);
+
   base::subtle::NoBarrier_Store(&observer_capture_modes_, capture_mode_set);
 
   // Notify any capture mode observers with the new |capture_mode_set|.
@@ -252,8 +285,10 @@ void NetLog::AddEntryInternal(NetLogEventType type,
     // Notify all of the log observers with |capture_mode|.
     base::AutoLock lock(lock_);
     for (net::NetLog::ThreadSafeObserver* observer : observers_) {
-      if (observer->capture_mode() == capture_mode)
+      if (observer->capture_mode() == capture_mode &&
+          observer->WantsEventType(type)) {
         observer->OnAddEntry(entry);
+      }
     }
   }
 }
@@ -276,7 +311,8 @@ void NetLog::AddEntryAtTimeWithMaterializedParams(NetLogEventType type,
   // Notify all of the log observers, regardless of capture mode.
   base::AutoLock lock(lock_);
   for (net::NetLog::ThreadSafeObserver* observer : observers_) {
-    observer->OnAddEntry(entry);
+    if (observer->WantsEventType(type))
+      observer->OnAddEntry(entry);
   }
 }
 
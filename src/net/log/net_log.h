@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <bitset>
 #include <string>
 #include <vector>
 
@@ -110,6 +112,13 @@ class NET_EXPORT NetLog {
     // Returns the NetLog being watched, or nullptr if there is none.
     NetLog* net_log() const;
 
+    // Returns whether entries of |type| are passed to OnAddEntry(). All are
+    // unless the observer was added for specific event types.
+    bool WantsEventType(NetLogEventType type) const {
+      return !filters_event_types_ ||
+             event_types_.test(static_cast<size_t>(type));
+    }
+
     // This method is called whenever an entry (event) was added to the NetLog
     // being watched.
     //
@@ -133,9 +142,11 @@ class NET_EXPORT NetLog {
    private:
     friend class NetLog;
 
-    // Both of these values are only modified by the NetLog.
+    // These values are only modified by the NetLog.
     NetLogCaptureMode capture_mode_ = NetLogCaptureMode::kDefault;
     raw_ptr<NetLog> net_log_ = nullptr;
+    bool filters_event_types_ = false;
+    std::bitset<static_cast<size_t>(NetLogEventType::COUNT)> event_types_;
   };
 
   // An observer that is notified of changes in the capture mode set, and has
@@ -228,6 +239,8 @@ class NET_EXPORT NetLog {
            const ParametersCallback& get_params) {
     if (LIKELY(!IsCapturing()))
       return;
+    if (!IsObservingEventType(type))
+      return;
 
     AddEntryWithMaterializedParams(type, source, phase, get_params());
   }
@@ -245,6 +258,8 @@ class NET_EXPORT NetLog {
            const ParametersCallback& get_params) {
     if (LIKELY(!IsCapturing()))
       return;
+    if (!IsObservingEventType(type))
+      return;
 
     // Indirect through virtual dispatch to reduce code bloat, as this is
     // inlined in a number of places.
@@ -308,6 +323,13 @@ class NET_EXPORT NetLog {
   void AddObserver(ThreadSafeObserver* observer,
                    NetLogCaptureMode capture_mode);
 
+  // Same as above, but the observer only receives entries of |event_types|.
+  // While all observers are added this way, entries of other types are
+  // dropped before their parameters are materialized.
+  void AddObserver(ThreadSafeObserver* observer,
+                   NetLogCaptureMode capture_mode,
+                   const std::vector<NetLogEventType>& event_types);
+
   // Removes an observer.
   //
   // For thread safety reasons, it is recommended that this not be called in
@@ -365,6 +387,15 @@ class NET_EXPORT NetLog {
     return base::subtle::NoBarrier_Load(&observer_capture_modes_);
   }
 
+  // Returns whether any observer wants entries of |type|.
+  bool IsObservingEventType(NetLogEventType type) const {
+    if (LIKELY(!base::subtle::NoBarrier_Load(&filters_event_types_)))
+      return true;
+    size_t index = static_cast<size_t>(type);
+    return base::subtle::NoBarrier_Load(&observed_event_types_[index / 32]) &
+           (1u << (index % 32));
+  }
+
   // Adds an entry using already materialized parameters, when it is already
   // known that the log is capturing (goes straight to acquiring observer lock).
   //
@@ -406,6 +437,14 @@ class NET_EXPORT NetLog {
   // accessed and updated more efficiently.
   base::subtle::Atomic32 observer_capture_modes_ = 0;
 
+  // Nonzero if every observer was added for specific event types, whose
+  // union is then in |observed_event_types_| as a bitmap. Updated with
+  // |observer_capture_modes_|.
+  base::subtle::Atomic32 filters_event_types_ = 0;
+  std::array<base::subtle::Atomic32,
+             (static_cast<size_t>(NetLogEventType::COUNT) + 31) / 32>
+      observed_event_types_ = {};
+
   // |observers_| is a list of observers, ordered by when they were added.
   // Pointers contained in |observers_| are non-owned, and must
   // remain valid.
@@ -1119,6 +1119,8 @@ QuicChromiumClientSession::~QuicChromiumClientSession() {
 void QuicChromiumClientSession::Initialize() {
   set_max_inbound_header_list_size(kQuicMaxHeaderListSize);
   quic::QuicSpdyClientSessionBase::Initialize();
+  qpack_encoder()->SetIndexingPolicy(&ShouldIndexHeader);
+  path_start_time_ = tick_clock_->NowTicks();
 }
 
 size_t QuicChromiumClientSession::WriteHeadersOnHeadersStream(
@@ -1138,7 +1140,7 @@ size_t QuicChromiumClientSession::WriteHeadersOnHeadersStream(
 
 void QuicChromiumClientSession::OnHttp3GoAway(uint64_t id) {
   quic::QuicSpdySession::OnHttp3GoAway(id);
-  NotifyFactoryOfSessionGoingAway();
+  NotifyFactoryOfGoAway();
 
   PerformActionOnActiveStreams([id](quic::QuicStream* stream) {
     if (stream->id() >= id) {
@@ -1610,6 +1612,12 @@ quic::QuicSSLConfig QuicChromiumClientSession::GetSSLConfig() const {
 
 void QuicChromiumClientSession::OnConfigNegotiated() {
   quic::QuicSpdyClientSessionBase::OnConfigNegotiated();
+  // After the congestion controller of the config was set, which decides
+  // whether marking is enabled.
+  if (session_pool_ && session_pool_->send_ecn() &&
+      !connection()->set_ecn_codepoint(quic::ECN_ECT1)) {
+    connection()->set_ecn_codepoint(quic::ECN_ECT0);
+  }
   if (!session_pool_ || !session_pool_->allow_server_migration()) {
     return;
   }
@@ -1754,7 +1762,7 @@ void QuicChromiumClientSession::OnCryptoHandshakeMessageReceived(
 
 void QuicChromiumClientSession::OnGoAway(const quic::QuicGoAwayFrame& frame) {
   quic::QuicSession::OnGoAway(frame);
-  NotifyFactoryOfSessionGoingAway();
+  NotifyFactoryOfGoAway();
   port_migration_detected_ =
       frame.error_code == quic::QUIC_ERROR_MIGRATING_PORT;
 }
@@ -2319,6 +2327,7 @@ void QuicChromiumClientSession::OnPortMigrationProbeSucceeded(
   writer->set_delegate(this);
 
   if (!migrate_idle_session_ && !HasActiveRequestStreams()) {
+    FinishPortHop(false);
     // If idle sessions won't be migrated, close the connection.
     CloseSessionOnErrorLater(
         ERR_NETWORK_CHANGED,
@@ -2328,6 +2337,7 @@ void QuicChromiumClientSession::OnPortMigrationProbeSucceeded(
   }
 
   if (migrate_idle_session_ && CheckIdleTimeExceedsIdleMigrationPeriod()) {
+    FinishPortHop(false);
     return;
   }
 
@@ -2335,6 +2345,7 @@ void QuicChromiumClientSession::OnPortMigrationProbeSucceeded(
   // be acquired by connection and used as default on success.
   if (!MigrateToSocket(self_address, peer_address, std::move(reader),
                        std::move(writer))) {
+    FinishPortHop(false);
     LogMigrateToSocketStatus(false);
     net_log_.AddEvent(
         NetLogEventType::QUIC_CONNECTION_MIGRATION_FAILURE_AFTER_PROBING);
@@ -2344,6 +2355,7 @@ void QuicChromiumClientSession::OnPortMigrationProbeSucceeded(
   LogMigrateToSocketStatus(true);
 
   num_migrations_++;
+  FinishPortHop(true);
   HistogramAndLogMigrationSuccess(connection_id());
 }
 
@@ -2476,6 +2488,7 @@ void QuicChromiumClientSession::OnProbeFailed(
                     });
 
   LogProbeResultToHistogram(current_migration_cause_, false);
+  FinishPortHop(false);
 
   auto* context = static_cast<QuicChromiumPathValidationContext*>(
       connection()->GetPathValidationContext());
@@ -2963,6 +2976,49 @@ void QuicChromiumClientSession::MaybeMigrateToDifferentPortOnPathDegrading() {
   net_log_.EndEvent(NetLogEventType::QUIC_PORT_MIGRATION_TRIGGERED);
 }
 
+bool QuicChromiumClientSession::HopPort(uint16_t peer_port) {
+  if (!session_pool_ || port_hop_pending_ ||
+      !connection()->IsHandshakeConfirmed() ||
+      config()->DisableConnectionMigration() ||
+      connection()->HasPendingPathValidation()) {
+    return false;
+  }
+  // Probed and moved to like a port migration on path degrading.
+  current_migration_cause_ = CHANGE_PORT_ON_PATH_DEGRADING;
+  port_hop_pending_ = true;
+  quic::QuicSocketAddress peer(peer_address().host(),
+                               peer_port ? peer_port : peer_address().port());
+  StartProbing(base::BindOnce(&QuicChromiumClientSession::OnPortHopProbing,
+                              weak_factory_.GetWeakPtr()),
+               default_network_, peer);
+  return true;
+}
+
+void QuicChromiumClientSession::OnPortHopProbing(ProbingResult result) {
+  // Otherwise the path validation completes it.
+  if (result != ProbingResult::PENDING) {
+    FinishPortHop(false);
+  }
+}
+
+void QuicChromiumClientSession::FinishPortHop(bool success) {
+  if (!std::exchange(port_hop_pending_, false) || !session_pool_) {
+    return;
+  }
+  uint64_t path_bytes = 0;
+  base::TimeDelta path_time;
+  if (success) {
+    const quic::QuicConnectionStats& stats = connection()->GetStats();
+    uint64_t bytes = stats.bytes_sent + stats.bytes_received;
+    base::TimeTicks now = tick_clock_->NowTicks();
+    path_bytes = bytes - path_start_bytes_;
+    path_time = now - path_start_time_;
+    path_start_bytes_ = bytes;
+    path_start_time_ = now;
+  }
+  session_pool_->OnPortHop(success, path_bytes, path_time);
+}
+
 void QuicChromiumClientSession::
     MaybeMigrateToAlternateNetworkOnPathDegrading() {
   net_log_.AddEvent(
@@ -3618,6 +3674,15 @@ bool QuicChromiumClientSession::OnPacket(
   return true;
 }
 
+void QuicChromiumClientSession::NotifyFactoryOfGoAway() {
+  // Servers may send several, each lowering the last stream accepted.
+  const bool was_going_away = going_away_;
+  NotifyFactoryOfSessionGoingAway();
+  if (!was_going_away && session_pool_) {
+    session_pool_->OnSessionGoAway(session_key_.network_anonymization_key());
+  }
+}
+
 void QuicChromiumClientSession::NotifyFactoryOfSessionGoingAway() {
   going_away_ = true;
   if (session_pool_) {
@@ -698,6 +698,13 @@ class NET_EXPORT_PRIVATE QuicChromiumClientSession
   void OnProbeFailed(handles::NetworkHandle network,
                      const quic::QuicSocketAddress& peer_address);
 
+  // Probes a path from a new local port to `peer_port` of the server, or to
+  // its current port if 0, and moves the session to it on success, to spread
+  // a long session over several UDP flows. Returns false without probing if
+  // the handshake is not confirmed, migration is disabled by the server, or
+  // a path is still being probed. The outcome is reported to the pool.
+  bool HopPort(uint16_t peer_port);
+
   // quic::QuicSpdySession methods:
   size_t WriteHeadersOnHeadersStream(
       quic::QuicStreamId id,
@@ -984,6 +991,10 @@ class NET_EXPORT_PRIVATE QuicChromiumClientSession
 
   // Helper method to initiate a port migration on path degrading is detected.
   void MaybeMigrateToDifferentPortOnPathDegrading();
+  void OnPortHopProbing(ProbingResult result);
+  // Reports the hop pending, if any, to the pool, and starts the next path
+  // on success.
+  void FinishPortHop(bool success);
 
   // Called when there is only one possible working network: |network|, If any
   // error encountered, this session will be closed.
@@ -1029,6 +1040,8 @@ class NET_EXPORT_PRIVATE QuicChromiumClientSession
   // should be created from it.  This needs to be called before closing any
   // streams, because closing a stream may cause a new stream to be created.
   void NotifyFactoryOfSessionGoingAway();
+  // Likewise on a GOAWAY of the server, telling the factory of the first.
+  void NotifyFactoryOfGoAway();
 
   // Posts a task to notify the factory that this session has been closed.
   void NotifyFactoryOfSessionClosedLater();
@@ -1142,6 +1155,13 @@ class NET_EXPORT_PRIVATE QuicChromiumClientSession
 
   size_t num_migrations_ = 0;
 
+  // Set while the probe of HopPort() is pending.
+  bool port_hop_pending_ = false;
+  // Of the current path, with the connection's bytes sent and received when
+  // it was taken.
+  base::TimeTicks path_start_time_;
+  uint64_t path_start_bytes_ = 0;
+
   // The reason for the last 1-RTT key update on the connection. Will be
   // kInvalid if no key updates have occurred.
   quic::KeyUpdateReason last_key_update_reason_ =
@@ -103,6 +103,12 @@ void QuicChromiumClientStream::Handle::OnDataAvailable() {
   if (!read_body_callback_)
     return;  // Wait for ReadBody to be called.
 
+  // PeekBody() callers peek again.
+  if (!read_body_buffer_) {
+    ResetAndRun(std::move(read_body_callback_), OK);
+    return;
+  }
+
   DCHECK(read_body_buffer_);
   DCHECK_GT(read_body_buffer_len_, 0);
 
@@ -335,6 +341,34 @@ int QuicChromiumClientStream::Handle::WriteConnectUdpPayload(
   }
 }
 
+int QuicChromiumClientStream::Handle::PeekBody(
+    iovec* iov,
+    size_t iov_len,
+    CompletionOnceCallback callback) {
+  ScopedBoolSaver saver(&may_invoke_callbacks_, false);
+  if (IsDoneReading())
+    return OK;
+
+  if (!stream_)
+    return net_error_;
+
+  if (stream_->read_side_closed()) {
+    return OK;
+  }
+
+  int rv = stream_->PeekBody(iov, iov_len);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+
+  SetCallback(std::move(callback), &read_body_callback_);
+  return ERR_IO_PENDING;
+}
+
+void QuicChromiumClientStream::Handle::ConsumeBody(size_t num_bytes) {
+  if (stream_)
+    stream_->MarkConsumed(num_bytes);
+}
+
 int QuicChromiumClientStream::Handle::Read(IOBuffer* buf, int buf_len) {
   if (!stream_)
     return net_error_;
@@ -379,6 +413,19 @@ void QuicChromiumClientStream::Handle::UnregisterHttp3DatagramVisitor() {
   }
 }
 
+void QuicChromiumClientStream::Handle::RegisterConnectIpVisitor(
+    ConnectIpVisitor* visitor) {
+  if (stream_) {
+    stream_->RegisterConnectIpVisitor(visitor);
+  }
+}
+
+void QuicChromiumClientStream::Handle::UnregisterConnectIpVisitor() {
+  if (stream_) {
+    stream_->UnregisterConnectIpVisitor();
+  }
+}
+
 quic::QuicStreamId QuicChromiumClientStream::Handle::id() const {
   if (!stream_)
     return id_;
@@ -767,6 +814,20 @@ int QuicChromiumClientStream::Read(IOBuffer* buf, int buf_len) {
   return bytes_read;
 }
 
+int QuicChromiumClientStream::PeekBody(iovec* iov, size_t iov_len) {
+  DCHECK_GT(iov_len, 0u);
+
+  if (IsDoneReading())
+    return 0;  // EOF
+
+  if (!HasBytesToRead())
+    return ERR_IO_PENDING;
+
+  int count = GetReadableRegions(iov, iov_len);
+  DCHECK_GT(count, 0);
+  return count;
+}
+
 void QuicChromiumClientStream::NotifyHandleOfInitialHeadersAvailableLater() {
   DCHECK(handle_);
   base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
@@ -70,6 +70,16 @@ class NET_EXPORT_PRIVATE QuicChromiumClientStream
                  int buffer_len,
                  CompletionOnceCallback callback);
 
+    // Like ReadBody(), but fills |iov| with up to |iov_len| regions of the
+    // body received so far instead of copying them out, and returns their
+    // number. They are valid until the stream is used otherwise, and are
+    // read again until ConsumeBody(). If none are available, returns
+    // ERR_IO_PENDING and invokes |callback| with OK once they are.
+    int PeekBody(iovec* iov, size_t iov_len, CompletionOnceCallback callback);
+
+    // Consumes the first |num_bytes| of the regions of PeekBody().
+    void ConsumeBody(size_t num_bytes);
+
     // Reads trailing headers into |header_block| and returns the length of
     // the HEADERS frame which contained them. If headers are not available,
     // returns ERR_IO_PENDING and will invoke |callback| asynchronously when
@@ -131,6 +141,12 @@ class NET_EXPORT_PRIVATE QuicChromiumClientStream
     // Unregisters an HTTP/3 datagram visitor.
     void UnregisterHttp3DatagramVisitor();
 
+    // Registers |visitor| to receive the CONNECT-IP capsules of the stream.
+    void RegisterConnectIpVisitor(ConnectIpVisitor* visitor);
+
+    // Unregisters a CONNECT-IP visitor.
+    void UnregisterConnectIpVisitor();
+
     quic::QuicStreamId id() const;
     quic::QuicErrorCode connection_error() const;
     quic::QuicRstStreamErrorCode stream_error() const;
@@ -302,6 +318,10 @@ class NET_EXPORT_PRIVATE QuicChromiumClientStream
   // Reads at most |buf_len| bytes into |buf|. Returns the number of bytes read.
   int Read(IOBuffer* buf, int buf_len);
 
+  // Fills |iov| with up to |iov_len| regions of the body received, without
+  // consuming them. Returns their number, or 0 at EOF.
+  int PeekBody(iovec* iov, size_t iov_len);
+
   const NetLogWithSource& net_log() const { return net_log_; }
 
   // Prevents this stream from migrating to a cellular network. May be reset
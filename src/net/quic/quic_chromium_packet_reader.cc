@@ -17,10 +17,10 @@
 namespace net {
 
 namespace {
-// Add 1 because some of our UDP socket implementations do not read successfully
-// when the packet length is equal to the read buffer size.
-const size_t kReadBufferSize =
-    static_cast<size_t>(quic::kMaxIncomingPacketSize + 1);
+// Fits the largest UDP_GRO read, or a few dozen packets from recvmmsg(2).
+// Larger than any packet, as some of our UDP socket implementations do not
+// read successfully when the packet length is equal to the read buffer size.
+const size_t kReadBufferSize = 64 * 1024;
 }  // namespace
 
 QuicChromiumPacketReader::QuicChromiumPacketReader(
@@ -53,17 +53,31 @@ void QuicChromiumPacketReader::StartReading() {
 
     CHECK(socket_);
     read_pending_ = true;
-    int rv =
-        socket_->Read(read_buffer_.get(), read_buffer_->size(),
-                      base::BindOnce(&QuicChromiumPacketReader::OnReadComplete,
-                                     weak_factory_.GetWeakPtr()));
+    int rv = ERR_NOT_IMPLEMENTED;
+    if (read_multiple_) {
+      rv = socket_->ReadMultiple(
+          read_buffer_.get(), read_buffer_->size(),
+          quic::kMaxIncomingPacketSize, &datagrams_,
+          base::BindOnce(&QuicChromiumPacketReader::OnReadComplete,
+                         weak_factory_.GetWeakPtr()));
+      if (rv == ERR_NOT_IMPLEMENTED)
+        read_multiple_ = false;
+    }
+    if (!read_multiple_) {
+      rv = socket_->Read(
+          read_buffer_.get(), read_buffer_->size(),
+          base::BindOnce(&QuicChromiumPacketReader::OnReadComplete,
+                         weak_factory_.GetWeakPtr()));
+    }
     UMA_HISTOGRAM_BOOLEAN("Net.QuicSession.AsyncRead", rv == ERR_IO_PENDING);
     if (rv == ERR_IO_PENDING) {
       num_packets_read_ = 0;
       return;
     }
 
-    if (++num_packets_read_ > yield_after_packets_ ||
+    num_packets_read_ +=
+        read_multiple_ && rv > 0 ? static_cast<int>(datagrams_.size()) : 1;
+    if (num_packets_read_ > yield_after_packets_ ||
         clock_->Now() > yield_after_) {
       num_packets_read_ = 0;
       // Data was read, process it.
@@ -109,12 +123,31 @@ bool QuicChromiumPacketReader::ProcessReadResult(int result) {
     return visitor_->OnReadError(result, socket_.get());
   }
 
-  quic::QuicEcnCodepoint ecn = quic::ECN_NOT_ECT;
-  if (report_ecn_) {
-    DscpAndEcn tos = socket_->GetLastTos();
-    ecn = static_cast<quic::QuicEcnCodepoint>(tos.ecn);
+  if (!read_multiple_) {
+    quic::QuicEcnCodepoint ecn = quic::ECN_NOT_ECT;
+    if (report_ecn_) {
+      ecn = static_cast<quic::QuicEcnCodepoint>(socket_->GetLastTos().ecn);
+    }
+    return ProcessPacket(read_buffer_->data(), result, ecn);
   }
-  quic::QuicReceivedPacket packet(read_buffer_->data(), result, clock_->Now(),
+  // Stops at the first packet after which reading should not continue, which
+  // includes |this| being deleted.
+  for (size_t i = 0; i < datagrams_.size(); ++i) {
+    quic::QuicEcnCodepoint ecn = quic::ECN_NOT_ECT;
+    if (report_ecn_) {
+      ecn = static_cast<quic::QuicEcnCodepoint>(
+          socket_->GetDatagramTos(i).ecn);
+    }
+    if (!ProcessPacket(datagrams_[i].data(), datagrams_[i].size(), ecn))
+      return false;
+  }
+  return true;
+}
+
+bool QuicChromiumPacketReader::ProcessPacket(const char* data,
+                                             size_t length,
+                                             quic::QuicEcnCodepoint ecn) {
+  quic::QuicReceivedPacket packet(data, length, clock_->Now(),
                                   /*owns_buffer=*/false, /*ttl=*/0,
                                   /*ttl_valid=*/true,
                                   /*packet_headers=*/nullptr,
@@ -6,6 +6,9 @@
 #ifndef NET_QUIC_QUIC_CHROMIUM_PACKET_READER_H_
 #define NET_QUIC_QUIC_CHROMIUM_PACKET_READER_H_
 
+#include <string_view>
+#include <vector>
+
 #include "base/memory/raw_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "net/base/io_buffer.h"
@@ -71,6 +74,9 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketReader {
   void OnReadComplete(int result);
   // Return true if reading should continue.
   bool ProcessReadResult(int result);
+  bool ProcessPacket(const char* data,
+                     size_t length,
+                     quic::QuicEcnCodepoint ecn);
 
   std::unique_ptr<DatagramClientSocket> socket_;
 
@@ -86,6 +92,11 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketReader {
   // Stores whether receiving ECN is in the feature list to avoid accessing
   // the feature list for every packet.
   bool report_ecn_;
+  // Whether the socket is read with DatagramClientSocket::ReadMultiple(),
+  // which reports the ECN codepoint of each datagram with
+  // GetDatagramTos(). Cleared if the socket does not implement it.
+  bool read_multiple_ = true;
+  std::vector<std::string_view> datagrams_;
 
   base::WeakPtrFactory<QuicChromiumPacketReader> weak_factory_{this};
 };
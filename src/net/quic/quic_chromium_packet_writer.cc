@@ -16,6 +16,7 @@
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/quic/quic_chromium_client_session.h"
+#include "net/socket/diff_serv_code_point.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
 
 namespace net {
@@ -31,6 +32,14 @@ enum NotReusableReason {
 
 const int kMaxRetries = 12;  // 2^12 = 4 seconds, which should be a LOT.
 
+// Bounds a batch of packets by the largest UDP payload over IPv6 and by the
+// most segments Linux takes in one UDP_SEGMENT write.
+const size_t kMaxBatchSize = 65535 - 40 - 8;
+const size_t kMaxBatchPackets = 64;
+// How much later than the first packet of a batch a packet may be due to
+// join it, as QuicConnection already sends up to a millisecond early.
+constexpr base::TimeDelta kMaxBatchReleaseSpread = base::Milliseconds(1);
+
 void RecordNotReusableReason(NotReusableReason reason) {
   UMA_HISTOGRAM_ENUMERATION("Net.QuicSession.WritePacketNotReusable", reason,
                             NUM_NOT_REUSABLE_REASONS);
@@ -79,15 +88,27 @@ void QuicChromiumPacketWriter::ReusableIOBuffer::Set(const char* buffer,
   CHECK_LE(buf_len, capacity_);
   CHECK(HasOneRef());
   size_ = buf_len;
+  segment_size_ = buf_len;
   std::memcpy(data(), buffer, buf_len);
 }
 
+void QuicChromiumPacketWriter::ReusableIOBuffer::Append(const char* buffer,
+                                                        size_t buf_len) {
+  CHECK_LE(buf_len, segment_size_);
+  CHECK_LE(size_ + buf_len, capacity_);
+  CHECK(HasOneRef());
+  std::memcpy(data() + size_, buffer, buf_len);
+  size_ += buf_len;
+}
+
 QuicChromiumPacketWriter::QuicChromiumPacketWriter(
     DatagramClientSocket* socket,
     base::SequencedTaskRunner* task_runner)
     : socket_(socket),
-      packet_(base::MakeRefCounted<ReusableIOBuffer>(
-          quic::kMaxOutgoingPacketSize)) {
+      batch_writes_(socket->SupportsSegmentedWrites()),
+      supports_release_time_(socket->IsTxTimeEnabled()) {
+  packet_ = base::MakeRefCounted<ReusableIOBuffer>(
+      batch_writes_ ? kMaxBatchSize : quic::kMaxOutgoingPacketSize);
   retry_timer_.SetTaskRunner(task_runner);
   write_callback_ = base::BindRepeating(
       &QuicChromiumPacketWriter::OnWriteComplete, weak_factory_.GetWeakPtr());
@@ -103,9 +124,11 @@ void QuicChromiumPacketWriter::set_force_write_blocked(
 }
 
 void QuicChromiumPacketWriter::SetPacket(const char* buffer, size_t buf_len) {
+  size_t capacity =
+      batch_writes_ ? kMaxBatchSize : quic::kMaxOutgoingPacketSize;
   if (UNLIKELY(!packet_)) {
-    packet_ = base::MakeRefCounted<ReusableIOBuffer>(
-        std::max(buf_len, static_cast<size_t>(quic::kMaxOutgoingPacketSize)));
+    packet_ =
+        base::MakeRefCounted<ReusableIOBuffer>(std::max(buf_len, capacity));
     RecordNotReusableReason(NOT_REUSABLE_NULLPTR);
   }
   if (UNLIKELY(packet_->capacity() < buf_len)) {
@@ -113,23 +136,85 @@ void QuicChromiumPacketWriter::SetPacket(const char* buffer, size_t buf_len) {
     RecordNotReusableReason(NOT_REUSABLE_TOO_SMALL);
   }
   if (UNLIKELY(!packet_->HasOneRef())) {
-    packet_ = base::MakeRefCounted<ReusableIOBuffer>(
-        std::max(buf_len, static_cast<size_t>(quic::kMaxOutgoingPacketSize)));
+    packet_ =
+        base::MakeRefCounted<ReusableIOBuffer>(std::max(buf_len, capacity));
     RecordNotReusableReason(NOT_REUSABLE_REF_COUNT);
   }
   packet_->Set(buffer, buf_len);
 }
 
+void QuicChromiumPacketWriter::SetEcn(quic::QuicEcnCodepoint ecn) {
+  if (ecn == ecn_)
+    return;
+  // On failure the packets go out unmarked, which the connection's ECN
+  // validation notices.
+  socket_->SetTos(DSCP_NO_CHANGE, static_cast<EcnCodePoint>(ecn));
+  ecn_ = ecn;
+}
+
+bool QuicChromiumPacketWriter::CanBatch(size_t buf_len) const {
+  // Only the last packet of a segmented write may be shorter.
+  return batched_packets_ < kMaxBatchPackets &&
+         buf_len <= packet_->segment_size() &&
+         packet_->size() % packet_->segment_size() == 0 &&
+         packet_->size() + buf_len <= packet_->capacity();
+}
+
+quic::WriteResult QuicChromiumPacketWriter::FlushBatch() {
+  DCHECK_GT(batched_packets_, 0u);
+  batched_packets_ = 0;
+  return WritePacketToSocketImpl();
+}
+
 quic::WriteResult QuicChromiumPacketWriter::WritePacket(
     const char* buffer,
     size_t buf_len,
     const quic::QuicIpAddress& self_address,
     const quic::QuicSocketAddress& peer_address,
     quic::PerPacketOptions* /*options*/,
-    const quic::QuicPacketWriterParams& /*params*/) {
+    const quic::QuicPacketWriterParams& params) {
   CHECK(!IsWriteBlocked());
-  SetPacket(buffer, buf_len);
-  return WritePacketToSocketImpl();
+  // Null releases the packet now.
+  base::TimeTicks release_time;
+  if (supports_release_time_ && !params.allow_burst &&
+      params.release_time_delay > quic::QuicTime::Delta::Zero()) {
+    release_time = base::TimeTicks::Now() +
+                   base::Microseconds(
+                       params.release_time_delay.ToMicroseconds());
+  }
+  if (!batch_writes_) {
+    SetEcn(params.ecn_codepoint);
+    release_time_ = release_time;
+    SetPacket(buffer, buf_len);
+    return WritePacketToSocketImpl();
+  }
+
+  // The packets of a batch share the ECN codepoint of the socket and leave
+  // together at the release time of the first.
+  if (batched_packets_ > 0 &&
+      (params.ecn_codepoint != ecn_ || !CanBatch(buf_len) ||
+       release_time.is_null() != release_time_.is_null() ||
+       release_time - release_time_ > kMaxBatchReleaseSpread)) {
+    quic::WriteResult result = FlushBatch();
+    if (result.status != quic::WRITE_STATUS_OK) {
+      // |buffer| was not part of the batch, so it is not buffered either.
+      if (quic::IsWriteBlockedStatus(result.status))
+        result.status = quic::WRITE_STATUS_BLOCKED;
+      return result;
+    }
+  }
+  SetEcn(params.ecn_codepoint);
+  if (batched_packets_ == 0) {
+    release_time_ = release_time;
+    SetPacket(buffer, buf_len);
+  } else {
+    packet_->Append(buffer, buf_len);
+  }
+  ++batched_packets_;
+  // Sends the batch once it cannot take another full packet.
+  if (CanBatch(packet_->segment_size()))
+    return quic::WriteResult(quic::WRITE_STATUS_OK, 0);
+  return FlushBatch();
 }
 
 void QuicChromiumPacketWriter::WritePacketToSocket(
@@ -148,8 +233,17 @@ quic::WriteResult QuicChromiumPacketWriter::WritePacketToSocketImpl() {
   // When the connection is closed, the socket is cleaned up. If socket is
   // invalidated, packets should not be written to the socket.
   CHECK(socket_);
-  int rv = socket_->Write(packet_.get(), packet_->size(), write_callback_,
-                          kTrafficAnnotation);
+  if (supports_release_time_) {
+    socket_->SetNextTxTime(release_time_);
+  }
+  int rv;
+  if (packet_->size() > packet_->segment_size()) {
+    rv = socket_->WriteSegmented(packet_.get(), packet_->size(),
+                                 packet_->segment_size(), write_callback_);
+  } else {
+    rv = socket_->Write(packet_.get(), packet_->size(), write_callback_,
+                        kTrafficAnnotation);
+  }
 
   if (MaybeRetryAfterWriteError(rv))
     return quic::WriteResult(quic::WRITE_STATUS_BLOCKED_DATA_BUFFERED,
@@ -263,15 +357,15 @@ quic::QuicByteCount QuicChromiumPacketWriter::GetMaxPacketSize(
 }
 
 bool QuicChromiumPacketWriter::SupportsReleaseTime() const {
-  return false;
+  return supports_release_time_;
 }
 
 bool QuicChromiumPacketWriter::IsBatchMode() const {
-  return false;
+  return batch_writes_;
 }
 
 bool QuicChromiumPacketWriter::SupportsEcn() const {
-  return false;
+  return true;
 }
 
 quic::QuicPacketBuffer QuicChromiumPacketWriter::GetNextWriteLocation(
@@ -281,7 +375,13 @@ quic::QuicPacketBuffer QuicChromiumPacketWriter::GetNextWriteLocation(
 }
 
 quic::WriteResult QuicChromiumPacketWriter::Flush() {
-  return quic::WriteResult(quic::WRITE_STATUS_OK, 0);
+  if (batched_packets_ == 0)
+    return quic::WriteResult(quic::WRITE_STATUS_OK, 0);
+  quic::WriteResult result = FlushBatch();
+  // The socket holds on to the batch, but Flush() reports it as blocked.
+  if (result.status == quic::WRITE_STATUS_BLOCKED_DATA_BUFFERED)
+    result.status = quic::WRITE_STATUS_BLOCKED;
+  return result;
 }
 
 bool QuicChromiumPacketWriter::OnSocketClosed(DatagramClientSocket* socket) {
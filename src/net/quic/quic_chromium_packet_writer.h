@@ -10,6 +10,7 @@
 #include "base/memory/raw_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/task/sequenced_task_runner.h"
+#include "base/time/time.h"
 #include "base/timer/timer.h"
 #include "net/base/completion_repeating_callback.h"
 #include "net/base/io_buffer.h"
@@ -37,15 +38,24 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketWriter
 
     size_t capacity() const { return capacity_; }
     size_t size() const { return size_; }
+    // The size of each packet in the buffer but the last, which may be
+    // shorter.
+    size_t segment_size() const { return segment_size_; }
 
     // Does memcpy from |buffer| into this->data(). |buf_len <=
     // capacity()| must be true, |HasOneRef()| must be true.
     void Set(const char* buffer, size_t buf_len);
 
+    // Does memcpy from |buffer| after the packets already in the buffer.
+    // |buf_len <= segment_size()| and |size() + buf_len <= capacity()| must
+    // be true, |HasOneRef()| must be true.
+    void Append(const char* buffer, size_t buf_len);
+
    private:
     ~ReusableIOBuffer() override;
     size_t capacity_;
     size_t size_ = 0;
+    size_t segment_size_ = 0;
   };
   // Delegate interface which receives notifications on socket write events.
   class NET_EXPORT_PRIVATE Delegate {
@@ -115,6 +125,13 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketWriter
 
  private:
   void SetPacket(const char* buffer, size_t buf_len);
+  // Marks the packets written from now on with |ecn|.
+  void SetEcn(quic::QuicEcnCodepoint ecn);
+  // Returns whether a packet of |buf_len| bytes can join the packets
+  // batched in |packet_|.
+  bool CanBatch(size_t buf_len) const;
+  // Writes the packets batched in |packet_| with one segmented write.
+  quic::WriteResult FlushBatch();
   bool MaybeRetryAfterWriteError(int rv);
   void RetryPacketAfterNoBuffers();
   quic::WriteResult WritePacketToSocketImpl();
@@ -124,6 +141,19 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketWriter
   // moved to the delegate in the case of a write error.
   scoped_refptr<ReusableIOBuffer> packet_;
 
+  // Whether packets are batched in |packet_| until Flush() and sent with
+  // DatagramClientSocket::WriteSegmented(), and how many are batched.
+  const bool batch_writes_;
+  size_t batched_packets_ = 0;
+
+  // The ECN codepoint the socket marks packets with.
+  quic::QuicEcnCodepoint ecn_ = quic::ECN_NOT_ECT;
+
+  // Whether the socket paces writes, see DatagramClientSocket::SetTxTime(),
+  // and the release time of the packets in |packet_|, null for now.
+  const bool supports_release_time_;
+  base::TimeTicks release_time_;
+
   // Whether a write is currently in progress: true if an asynchronous write is
   // in flight, or a retry of a previous write is in progress, or session is
   // handling write error of a previous write.
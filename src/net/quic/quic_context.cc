@@ -60,8 +60,12 @@ quic::QuicConfig InitializeQuicConfig(const QuicParams& params) {
   config.SetClientConnectionOptions(params.client_connection_options);
   config.set_max_undecryptable_packets(kMaxUndecryptablePackets);
   config.SetInitialSessionFlowControlWindowToSend(
-      kQuicSessionMaxRecvWindowSize);
-  config.SetInitialStreamFlowControlWindowToSend(kQuicStreamMaxRecvWindowSize);
+      params.session_flow_control_window > 0
+          ? params.session_flow_control_window
+          : kQuicSessionMaxRecvWindowSize);
+  config.SetInitialStreamFlowControlWindowToSend(
+      params.stream_flow_control_window > 0 ? params.stream_flow_control_window
+                                            : kQuicStreamMaxRecvWindowSize);
   config.SetBytesForConnectionIdToSend(0);
   return config;
 }
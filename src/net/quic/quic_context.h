@@ -109,6 +109,13 @@ struct NET_EXPORT QuicParams {
       DefaultSupportedQuicVersions();
   // Limit on the size of QUIC packets.
   size_t max_packet_length = quic::kDefaultMaxPacketSize;
+  // Target of path MTU discovery, probed for from `max_packet_length` after
+  // the handshake. 0 disables probing beyond the options of
+  // `connection_options`.
+  size_t mtu_discovery_target = 0;
+  // Bytes a stream writes before the other streams of its priority get
+  // their turn. 0 keeps QUICHE's default.
+  size_t stream_write_quantum = 0;
   // Additional packet size to use for QUIC connections used to carry
   // proxy traffic.  This is required for QUIC connections tunneled via
   // CONNECT-UDP, as the tunneled connection's packets must fit within the
@@ -129,6 +136,14 @@ struct NET_EXPORT QuicParams {
   // Set of QUIC tags to send in the handshake's connection options that only
   // affect the client.
   quic::QuicTagVector client_connection_options;
+  // Initial receive windows offered to the server, 0 for the defaults of
+  // 15 MB per session and 6 MB per stream. At most the QUIC limits of 24 MB
+  // and 16 MB.
+  uint32_t session_flow_control_window = 0;
+  uint32_t stream_flow_control_window = 0;
+  // Auto-tunes the receive windows up to the QUIC limits, as servers do,
+  // see quic::QuicFlowController::EnableReceiveWindowAutoTune().
+  bool auto_tune_flow_control_windows = false;
   // Enables experimental optimization for receiving data in UDPSocket.
   bool enable_socket_recv_optimization = false;
 
@@ -231,6 +246,20 @@ struct NET_EXPORT QuicParams {
   // If true, read Explicit Congestion Notification (ECN) marks from QUIC
   // sockets and report them to the peer.
   bool report_ecn = false;
+
+  // If true, mark sent packets ECN-capable, ECT(1) or else ECT(0), where
+  // the congestion controller responds to the marks of the peer's reports.
+  bool send_ecn = false;
+
+  // If true, pace sent packets with release times the kernel holds them
+  // until, see DatagramClientSocket::SetTxTime(), rather than with alarms
+  // alone. The packets then leave in time only through a qdisc honoring
+  // them, such as fq.
+  bool use_tx_time = false;
+
+  // If true, sessions to the same peer address share one UDP socket, see
+  // QuicSharedSocket, where their version supports client connection IDs.
+  bool share_sockets = false;
 };
 
 // QuicContext contains QUIC-related variables that are shared across all of the
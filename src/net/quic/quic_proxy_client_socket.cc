@@ -4,7 +4,9 @@
 
 #include "net/quic/quic_proxy_client_socket.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 #include <string_view>
 #include <utility>
 
@@ -24,6 +26,11 @@
 
 namespace net {
 
+namespace {
+// Of the body handed out by one PeekReadData().
+constexpr size_t kMaxPeekRegions = 16;
+}  // namespace
+
 QuicProxyClientSocket::QuicProxyClientSocket(
     std::unique_ptr<QuicChromiumClientStream::Handle> stream,
     std::unique_ptr<QuicChromiumClientSession::Handle> session,
@@ -84,7 +91,13 @@ int QuicProxyClientSocket::RestartWithAuth(CompletionOnceCallback callback) {
 //
 // TODO(mmenke):  Use a single priority value for all QuicProxyClientSockets,
 // regardless of what priority they're created with.
-void QuicProxyClientSocket::SetStreamPriority(RequestPriority priority) {}
+void QuicProxyClientSocket::SetStreamPriority(RequestPriority priority) {
+  if (!stream_ || !stream_->IsOpen())
+    return;
+  stream_->SetPriority(quic::QuicStreamPriority(quic::HttpStreamPriority{
+      ConvertRequestPriorityToQuicPriority(priority),
+      kDefaultPriorityIncremental}));
+}
 
 // Sends a HEADERS frame to the proxy with a CONNECT request
 // for the specified endpoint.  Waits for the server to send back
@@ -161,6 +174,20 @@ void QuicProxyClientSocket::ApplySocketTag(const SocketTag& tag) {
   CHECK(tag == SocketTag());
 }
 
+int QuicProxyClientSocket::ShutdownWrite() {
+  DCHECK(write_callback_.is_null());
+  if (next_state_ != STATE_CONNECT_COMPLETE)
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  // The FIN is buffered by the stream if it is blocked, and sent after the
+  // data written before.
+  int rv = stream_->WriteStreamData(
+      std::string_view(), /*fin=*/true,
+      base::BindOnce(&QuicProxyClientSocket::OnWriteComplete,
+                     weak_factory_.GetWeakPtr()));
+  return rv == ERR_IO_PENDING ? OK : rv;
+}
+
 int QuicProxyClientSocket::Read(IOBuffer* buf,
                                 int buf_len,
                                 CompletionOnceCallback callback) {
@@ -208,6 +235,44 @@ void QuicProxyClientSocket::OnReadComplete(int rv) {
   }
 }
 
+int QuicProxyClientSocket::PeekReadData(
+    base::span<base::span<const char>> regions,
+    CompletionOnceCallback callback) {
+  DCHECK(connect_callback_.is_null());
+  DCHECK(read_callback_.is_null());
+  DCHECK(!regions.empty());
+
+  if (next_state_ == STATE_DISCONNECTED)
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  if (!stream_->IsOpen()) {
+    return 0;
+  }
+
+  iovec iov[kMaxPeekRegions];
+  int rv = stream_->PeekBody(
+      iov, std::min(regions.size(), std::size(iov)),
+      base::BindOnce(&QuicProxyClientSocket::OnPeekReady,
+                     weak_factory_.GetWeakPtr(), std::move(callback)));
+  for (int i = 0; i < rv; ++i) {
+    regions[i] = base::span(static_cast<const char*>(iov[i].iov_base),
+                            iov[i].iov_len);
+  }
+  return rv;
+}
+
+void QuicProxyClientSocket::ConsumeReadData(size_t bytes) {
+  stream_->ConsumeBody(bytes);
+  // The bytes were passed on in place, so they are not logged.
+  net_log_.AddEventWithIntParams(NetLogEventType::SOCKET_BYTES_RECEIVED,
+                                 "byte_count", static_cast<int>(bytes));
+}
+
+void QuicProxyClientSocket::OnPeekReady(CompletionOnceCallback callback,
+                                        int rv) {
+  std::move(callback).Run(rv);
+}
+
 int QuicProxyClientSocket::Write(
     IOBuffer* buf,
     int buf_len,
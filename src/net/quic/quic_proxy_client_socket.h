@@ -53,6 +53,9 @@ class NET_EXPORT_PRIVATE QuicProxyClientSocket : public ProxyClientSocket {
   const scoped_refptr<HttpAuthController>& GetAuthController() const override;
   int RestartWithAuth(CompletionOnceCallback callback) override;
   void SetStreamPriority(RequestPriority priority) override;
+  int PeekReadData(base::span<base::span<const char>> regions,
+                   CompletionOnceCallback callback) override;
+  void ConsumeReadData(size_t bytes) override;
 
   // StreamSocket implementation.
   int Connect(CompletionOnceCallback callback) override;
@@ -65,6 +68,7 @@ class NET_EXPORT_PRIVATE QuicProxyClientSocket : public ProxyClientSocket {
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
   void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
 
   // Socket implementation.
   int Read(IOBuffer* buf,
@@ -93,6 +97,7 @@ class NET_EXPORT_PRIVATE QuicProxyClientSocket : public ProxyClientSocket {
 
   void OnIOComplete(int result);  // Callback used during connecting
   void OnReadComplete(int rv);
+  void OnPeekReady(CompletionOnceCallback callback, int rv);
   void OnWriteComplete(int rv);
 
   // Callback for stream_->ReadInitialHeaders()
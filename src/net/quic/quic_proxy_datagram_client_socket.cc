@@ -15,6 +15,7 @@
 #include "net/http/http_response_headers.h"
 #include "net/log/net_log_source.h"
 #include "net/log/net_log_source_type.h"
+#include "net/quic/address_utils.h"
 #include "net/spdy/spdy_http_utils.h"
 
 namespace net {
@@ -72,6 +73,10 @@ int QuicProxyDatagramClientSocket::ConnectViaStream(
   // Register stream to receive HTTP/3 datagrams.
   stream_handle_->RegisterHttp3DatagramVisitor(this);
   datagram_visitor_registered_ = true;
+  if (connect_ip_) {
+    stream_handle_->RegisterConnectIpVisitor(this);
+    connect_ip_visitor_registered_ = true;
+  }
 
   DCHECK_EQ(STATE_DISCONNECTED, next_state_);
   next_state_ = STATE_SEND_REQUEST;
@@ -83,6 +88,11 @@ int QuicProxyDatagramClientSocket::ConnectViaStream(
   return rv;
 }
 
+void QuicProxyDatagramClientSocket::UseConnectIp() {
+  DCHECK_EQ(STATE_DISCONNECTED, next_state_);
+  connect_ip_ = true;
+}
+
 int QuicProxyDatagramClientSocket::Connect(const IPEndPoint& address) {
   NOTREACHED();
   return ERR_NOT_IMPLEMENTED;
@@ -135,6 +145,10 @@ void QuicProxyDatagramClientSocket::Close() {
     stream_handle_->UnregisterHttp3DatagramVisitor();
     datagram_visitor_registered_ = false;
   }
+  if (connect_ip_visitor_registered_) {
+    stream_handle_->UnregisterConnectIpVisitor();
+    connect_ip_visitor_registered_ = false;
+  }
   stream_handle_->Reset(quic::QUIC_STREAM_CANCELLED);
 }
 
@@ -202,6 +216,33 @@ void QuicProxyDatagramClientSocket::OnUnknownCapsule(
     quic::QuicStreamId stream_id,
     const quiche::UnknownCapsule& capsule) {}
 
+bool QuicProxyDatagramClientSocket::OnAddressAssignCapsule(
+    const quiche::AddressAssignCapsule& capsule) {
+  // Each capsule replaces the addresses assigned before.
+  assigned_addresses_.clear();
+  for (const quiche::PrefixWithId& prefix : capsule.assigned_addresses) {
+    IPAddress address = ToIPAddress(prefix.ip_prefix.address());
+    if (address.IsValid()) {
+      assigned_addresses_.push_back(std::move(address));
+    }
+  }
+  return true;
+}
+
+// Requests and routes from the proxy are ignored, packets to destinations
+// it does not route are dropped by it.
+bool QuicProxyDatagramClientSocket::OnAddressRequestCapsule(
+    const quiche::AddressRequestCapsule& capsule) {
+  return true;
+}
+
+bool QuicProxyDatagramClientSocket::OnRouteAdvertisementCapsule(
+    const quiche::RouteAdvertisementCapsule& capsule) {
+  return true;
+}
+
+void QuicProxyDatagramClientSocket::OnHeadersWritten() {}
+
 // TODO(crbug.com/41497362) Implement method.
 handles::NetworkHandle QuicProxyDatagramClientSocket::GetBoundNetwork() const {
   return handles::kInvalidNetworkHandle;
@@ -407,14 +448,17 @@ int QuicProxyDatagramClientSocket::DoSendRequest() {
 
   // Generate a fake request line for logging purposes.
   std::string request_line =
-      base::StringPrintf("CONNECT-UDP %s HTTP/3\r\n", url_.path().c_str());
+      base::StringPrintf("%s %s HTTP/3\r\n",
+                         connect_ip_ ? "CONNECT-IP" : "CONNECT-UDP",
+                         url_.path().c_str());
   NetLogRequestHeaders(net_log_,
                        NetLogEventType::HTTP_TRANSACTION_SEND_TUNNEL_HEADERS,
                        request_line, &request_.extra_headers);
 
   spdy::Http2HeaderBlock headers;
   CreateSpdyHeadersFromHttpRequestForExtendedConnect(
-      request_, /*priority=*/std::nullopt, "connect-udp",
+      request_, /*priority=*/std::nullopt,
+      connect_ip_ ? "connect-ip" : "connect-udp",
       request_.extra_headers, &headers);
 
   return stream_handle_->WriteHeaders(std::move(headers), false, nullptr);
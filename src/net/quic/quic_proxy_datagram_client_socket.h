@@ -9,7 +9,9 @@
 
 #include <queue>
 #include <string_view>
+#include <vector>
 
+#include "net/base/ip_address.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_export.h"
 #include "net/log/net_log.h"
@@ -34,7 +36,8 @@ class ProxyDelegate;
 // to send and receive datagrams.
 class NET_EXPORT_PRIVATE QuicProxyDatagramClientSocket
     : public DatagramClientSocket,
-      public quic::QuicSpdyStream::Http3DatagramVisitor {
+      public quic::QuicSpdyStream::Http3DatagramVisitor,
+      public quic::QuicSpdyStream::ConnectIpVisitor {
  public:
   // Initializes a QuicProxyDatagramClientSocket with the provided network
   // log (source_net_log) and destination URL. The destination URL is
@@ -69,6 +72,16 @@ class NET_EXPORT_PRIVATE QuicProxyDatagramClientSocket
                        std::unique_ptr<QuicChromiumClientStream::Handle> stream,
                        CompletionOnceCallback callback);
 
+  // Requests a CONNECT-IP (RFC 9484) tunnel instead of CONNECT-UDP, whose
+  // datagrams are IP packets, with `url` expanded from an IP URI template.
+  // Must be called before ConnectViaStream().
+  void UseConnectIp();
+  // The addresses the proxy assigned to this end of a CONNECT-IP tunnel in
+  // its last ADDRESS_ASSIGN capsule, empty until then.
+  const std::vector<IPAddress>& assigned_addresses() const {
+    return assigned_addresses_;
+  }
+
   // DatagramClientSocket implementation.
   int Connect(const IPEndPoint& address) override;
   int ConnectUsingNetwork(handles::NetworkHandle network,
@@ -115,6 +128,15 @@ class NET_EXPORT_PRIVATE QuicProxyDatagramClientSocket
   void OnUnknownCapsule(quic::QuicStreamId stream_id,
                         const quiche::UnknownCapsule& capsule) override;
 
+  // ConnectIpVisitor implementation.
+  bool OnAddressAssignCapsule(
+      const quiche::AddressAssignCapsule& capsule) override;
+  bool OnAddressRequestCapsule(
+      const quiche::AddressRequestCapsule& capsule) override;
+  bool OnRouteAdvertisementCapsule(
+      const quiche::RouteAdvertisementCapsule& capsule) override;
+  void OnHeadersWritten() override;
+
   const HttpResponseInfo* GetConnectResponseInfo() const;
   bool IsConnected() const;
 
@@ -177,6 +199,12 @@ class NET_EXPORT_PRIVATE QuicProxyDatagramClientSocket
   // Visitor on stream is registered to receive HTTP/3 datagrams.
   bool datagram_visitor_registered_ = false;
 
+  // Whether this is a CONNECT-IP tunnel, and the visitor of its capsules
+  // registered.
+  bool connect_ip_ = false;
+  bool connect_ip_visitor_registered_ = false;
+  std::vector<IPAddress> assigned_addresses_;
+
   // CONNECT request and response.
   HttpRequestInfo request_;
   HttpResponseInfo response_;
@@ -20,6 +20,7 @@
 #include "base/metrics/histogram_macros.h"
 #include "base/no_destructor.h"
 #include "base/numerics/safe_conversions.h"
+#include "base/rand_util.h"
 #include "base/ranges/algorithm.h"
 #include "base/strings/escape.h"
 #include "base/strings/string_number_conversions.h"
@@ -356,7 +357,7 @@ bool QuicSessionPool::QuicSessionAliasKey::operator==(
 
 QuicSessionPool::QuicCryptoClientConfigOwner::QuicCryptoClientConfigOwner(
     std::unique_ptr<quic::ProofVerifier> proof_verifier,
-    std::unique_ptr<quic::QuicClientSessionCache> session_cache,
+    std::unique_ptr<quic::SessionCache> session_cache,
     QuicSessionPool* quic_session_pool)
     : config_(std::move(proof_verifier), std::move(session_cache)),
       clock_(base::DefaultClock::GetInstance()),
@@ -474,6 +475,9 @@ QuicSessionPool::QuicSessionPool(
   if (params_.disable_tls_zero_rtt) {
     SetQuicFlag(quic_disable_client_tls_zero_rtt, true);
   }
+  if (params_.send_ecn) {
+    SetQuicRestartFlag(quic_support_ect1, true);
+  }
   InitializeMigrationOptions();
   cert_verifier_->AddObserver(this);
   CertDatabase::GetInstance()->AddObserver(this);
@@ -680,6 +684,37 @@ void QuicSessionPool::CloseAllSessions(int error,
   DCHECK(all_sessions_.empty());
 }
 
+void QuicSessionPool::CloseSessionsForNetworkAnonymizationKey(
+    const NetworkAnonymizationKey& network_anonymization_key,
+    int error,
+    quic::QuicErrorCode quic_error) {
+  // Closing a session removes it from `all_sessions_`.
+  std::vector<QuicChromiumClientSession*> sessions;
+  for (const auto& [session, alias_key] : all_sessions_) {
+    if (session->quic_session_key().network_anonymization_key() ==
+        network_anonymization_key) {
+      sessions.push_back(session);
+    }
+  }
+  for (QuicChromiumClientSession* session : sessions) {
+    if (!all_sessions_.contains(session))
+      continue;
+    session->CloseSessionOnError(
+        error, quic_error,
+        quic::ConnectionCloseBehavior::SEND_CONNECTION_CLOSE_PACKET);
+  }
+}
+
+base::CallbackListSubscription QuicSessionPool::AddGoAwayCallback(
+    GoAwayCallback callback) {
+  return go_away_callbacks_.Add(std::move(callback));
+}
+
+void QuicSessionPool::OnSessionGoAway(
+    const NetworkAnonymizationKey& network_anonymization_key) {
+  go_away_callbacks_.Notify(network_anonymization_key);
+}
+
 base::Value QuicSessionPool::QuicSessionPoolInfoToValue() const {
   base::Value::List list;
 
@@ -700,6 +735,41 @@ base::Value QuicSessionPool::QuicSessionPoolInfoToValue() const {
   return base::Value(std::move(list));
 }
 
+std::vector<std::pair<HostPortPair, quic::QuicByteCount>>
+QuicSessionPool::GetMaxPacketLengths() const {
+  std::vector<std::pair<HostPortPair, quic::QuicByteCount>> lengths;
+  for (const auto& [session, key] : all_sessions_) {
+    lengths.emplace_back(
+        HostPortPair(key.server_id().host(), key.server_id().port()),
+        session->connection()->max_packet_length());
+  }
+  return lengths;
+}
+
+size_t QuicSessionPool::HopPorts(uint16_t first_port, uint16_t last_port) {
+  DCHECK_LE(first_port, last_port);
+  size_t probing = 0;
+  for (const auto& [session, key] : all_sessions_) {
+    uint16_t port = first_port ? base::RandInt(first_port, last_port) : 0;
+    if (session->HopPort(port)) {
+      ++probing;
+    }
+  }
+  return probing;
+}
+
+void QuicSessionPool::OnPortHop(bool success,
+                                uint64_t path_bytes,
+                                base::TimeDelta path_time) {
+  if (!success) {
+    ++port_hop_stats_.failures;
+    return;
+  }
+  ++port_hop_stats_.hops;
+  port_hop_stats_.path_bytes += path_bytes;
+  port_hop_stats_.path_time += path_time;
+}
+
 void QuicSessionPool::ClearCachedStatesInCryptoConfig(
     const base::RepeatingCallback<bool(const GURL&)>& origin_filter) {
   ServerIdOriginFilter filter(origin_filter);
@@ -782,6 +852,11 @@ void QuicSessionPool::FinishConnectAndConfigureSocket(
     }
   }
 
+  // Where it fails, the connection paces with alarms.
+  if (params_.use_tx_time) {
+    socket->SetTxTime();
+  }
+
   // Set a buffer large enough to contain the initial CWND's worth of packet
   // to work around the problem with CHLO packets being sent out with the
   // wrong encryption level, when the send buffer is full.
@@ -874,6 +949,11 @@ int QuicSessionPool::ConfigureSocket(DatagramClientSocket* socket,
     }
   }
 
+  // Where it fails, the connection paces with alarms.
+  if (params_.use_tx_time) {
+    socket->SetTxTime();
+  }
+
   // Set a buffer large enough to contain the initial CWND's worth of packet
   // to work around the problem with CHLO packets being sent out with the
   // wrong encryption level, when the send buffer is full.
@@ -903,6 +983,38 @@ int QuicSessionPool::ConfigureSocket(DatagramClientSocket* socket,
   return OK;
 }
 
+std::unique_ptr<DatagramClientSocket> QuicSessionPool::JoinSharedSocket(
+    const IPEndPoint& peer_address,
+    handles::NetworkHandle network,
+    quic::QuicConnectionId* client_connection_id) {
+  auto it = shared_sockets_.find({peer_address, network});
+  if (it == shared_sockets_.end()) {
+    return nullptr;
+  }
+  if (!it->second) {
+    shared_sockets_.erase(it);
+    return nullptr;
+  }
+  return it->second->CreateMember(client_connection_id);
+}
+
+std::unique_ptr<DatagramClientSocket> QuicSessionPool::ShareSocket(
+    std::unique_ptr<DatagramClientSocket> socket,
+    const IPEndPoint& peer_address,
+    handles::NetworkHandle network,
+    quic::QuicConnectionId* client_connection_id) {
+  // Drops the entries of sockets whose sessions are all gone.
+  std::erase_if(shared_sockets_,
+                [](const auto& entry) { return !entry.second; });
+  auto shared_socket = base::MakeRefCounted<QuicSharedSocket>(
+      std::move(socket));
+  std::unique_ptr<DatagramClientSocket> member =
+      shared_socket->CreateMember(client_connection_id);
+  DCHECK(member);
+  shared_sockets_[{peer_address, network}] = shared_socket->GetWeakPtr();
+  return member;
+}
+
 handles::NetworkHandle QuicSessionPool::FindAlternateNetwork(
     handles::NetworkHandle old_network) {
   // Find a new network that sessions bound to |old_network| can be migrated to.
@@ -1261,23 +1373,39 @@ int QuicSessionPool::CreateSessionSync(
     const NetLogWithSource& net_log,
     raw_ptr<QuicChromiumClientSession>* session,
     handles::NetworkHandle* network) {
-  // TODO(crbug.com/40256842): This logic only knows how to try one IP
-  // endpoint.
-  std::unique_ptr<DatagramClientSocket> socket(
-      CreateSocket(net_log.net_log(), net_log.source()));
-
-  // If migrate_sessions_on_network_change_v2 is on, passing in
-  // handles::kInvalidNetworkHandle will bind the socket to the default network.
-  int rv = ConfigureSocket(socket.get(), peer_address, *network,
-                           key.session_key().socket_tag());
-  if (rv != OK) {
-    return rv;
+  // Sockets are shared by peer address and network alone, so sessions with a
+  // tag of their own get their own sockets.
+  bool share_socket = params_.share_sockets &&
+                      quic_version.SupportsClientConnectionIds() &&
+                      key.session_key().socket_tag() == SocketTag();
+  quic::QuicConnectionId client_connection_id;
+  std::unique_ptr<DatagramClientSocket> socket;
+  if (share_socket) {
+    socket = JoinSharedSocket(peer_address, *network, &client_connection_id);
+  }
+  if (!socket) {
+    // TODO(crbug.com/40256842): This logic only knows how to try one IP
+    // endpoint.
+    socket = CreateSocket(net_log.net_log(), net_log.source());
+
+    // If migrate_sessions_on_network_change_v2 is on, passing in
+    // handles::kInvalidNetworkHandle will bind the socket to the default
+    // network.
+    int rv = ConfigureSocket(socket.get(), peer_address, *network,
+                             key.session_key().socket_tag());
+    if (rv != OK) {
+      return rv;
+    }
+    if (share_socket) {
+      socket = ShareSocket(std::move(socket), peer_address, *network,
+                           &client_connection_id);
+    }
   }
   bool closed_during_initialize = CreateSessionHelper(
       key, quic_version, cert_verify_flags, require_confirmation,
       std::move(peer_address), std::move(metadata), dns_resolution_start_time,
       dns_resolution_end_time, /*session_max_packet_length=*/0, net_log,
-      session, network, std::move(socket));
+      session, network, std::move(socket), client_connection_id);
   if (closed_during_initialize) {
     DLOG(DFATAL) << "Session closed during initialize";
     *session = nullptr;
@@ -1412,7 +1540,7 @@ void QuicSessionPool::FinishCreateSession(
       key, quic_version, cert_verify_flags, require_confirmation,
       std::move(peer_address), std::move(metadata), dns_resolution_start_time,
       dns_resolution_end_time, session_max_packet_length, net_log, session,
-      network, std::move(socket));
+      network, std::move(socket), quic::EmptyQuicConnectionId());
   if (closed_during_initialize) {
     DLOG(DFATAL) << "Session closed during initialize";
     *session = nullptr;
@@ -1437,7 +1565,8 @@ bool QuicSessionPool::CreateSessionHelper(
     const NetLogWithSource& net_log,
     raw_ptr<QuicChromiumClientSession>* session,
     handles::NetworkHandle* network,
-    std::unique_ptr<DatagramClientSocket> socket) {
+    std::unique_ptr<DatagramClientSocket> socket,
+    const quic::QuicConnectionId& client_connection_id) {
   const quic::QuicServerId& server_id = key.server_id();
 
   if (params_.migrate_sessions_on_network_change_v2 &&
@@ -1478,13 +1607,23 @@ bool QuicSessionPool::CreateSessionHelper(
   InitializeCachedStateInCryptoConfig(*crypto_config_handle, server_id,
                                       server_info);
 
+  // Sessions on shared sockets keep the tag of their socket in the client
+  // connection IDs they issue.
+  quic::ConnectionIdGeneratorInterface* connection_id_generator =
+      &connection_id_generator_;
+  if (!client_connection_id.IsEmpty()) {
+    connection_id_generator = &QuicSharedSocket::connection_id_generator();
+  }
   QuicChromiumPacketWriter* writer =
       new QuicChromiumPacketWriter(socket.get(), task_runner_.get());
   quic::QuicConnection* connection = new quic::QuicConnection(
       connection_id, quic::QuicSocketAddress(),
       ToQuicSocketAddress(peer_address), helper_.get(), alarm_factory_.get(),
       writer, true /* owns_writer */, quic::Perspective::IS_CLIENT,
-      {quic_version}, connection_id_generator_);
+      {quic_version}, *connection_id_generator);
+  if (!client_connection_id.IsEmpty()) {
+    connection->set_client_connection_id(client_connection_id);
+  }
   connection->set_keep_alive_ping_timeout(ping_timeout_);
 
   // Calculate the max packet length for this connection. If the session is
@@ -1501,6 +1640,9 @@ bool QuicSessionPool::CreateSessionHelper(
   DVLOG(1) << "Session to " << key.destination().Serialize()
            << " has max packet length " << max_packet_length;
   connection->SetMaxPacketLength(max_packet_length);
+  if (params_.mtu_discovery_target > max_packet_length) {
+    connection->EnableMtuDiscovery(params_.mtu_discovery_target);
+  }
 
   quic::QuicConfig config = config_;
   ConfigureInitialRttEstimate(
@@ -1549,6 +1691,13 @@ bool QuicSessionPool::CreateSessionHelper(
       NetLogEventType::QUIC_SESSION_POOL_JOB_RESULT,
       (*session)->net_log().source());
 
+  if (params_.auto_tune_flow_control_windows) {
+    // Before any stream takes the setting.
+    (*session)->flow_controller()->EnableReceiveWindowAutoTune();
+  }
+  if (params_.stream_write_quantum > 0) {
+    (*session)->SetStreamWriteQuantum(params_.stream_write_quantum);
+  }
   (*session)->Initialize();
   bool closed_during_initialize = !base::Contains(all_sessions_, *session) ||
                                   !(*session)->connection()->connected();
@@ -1874,13 +2023,19 @@ QuicSessionPool::CreateCryptoConfigHandle(
 
   // Otherwise, create a new QuicCryptoClientConfigOwner and add it to
   // |active_crypto_config_map_|.
+  std::unique_ptr<quic::SessionCache> session_cache;
+  if (session_cache_factory_) {
+    session_cache = session_cache_factory_.Run();
+  } else {
+    session_cache = std::make_unique<quic::QuicClientSessionCache>();
+  }
   std::unique_ptr<QuicCryptoClientConfigOwner> crypto_config_owner =
       std::make_unique<QuicCryptoClientConfigOwner>(
           std::make_unique<ProofVerifierChromium>(
               cert_verifier_, transport_security_state_, sct_auditing_delegate_,
               HostsFromOrigins(params_.origins_to_force_quic_on),
               actual_network_anonymization_key),
-          std::make_unique<quic::QuicClientSessionCache>(), this);
+          std::move(session_cache), this);
 
   quic::QuicCryptoClientConfig* crypto_config = crypto_config_owner->config();
   crypto_config->AddCanonicalSuffix(".c.youtube.com");
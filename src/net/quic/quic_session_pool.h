@@ -12,9 +12,12 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/callback_list.h"
 #include "base/containers/lru_cache.h"
+#include "base/functional/callback.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/memory_pressure_monitor.h"
 #include "base/memory/raw_ptr.h"
@@ -49,6 +52,7 @@
 #include "net/quic/quic_crypto_client_config_handle.h"
 #include "net/quic/quic_proxy_datagram_client_socket.h"
 #include "net/quic/quic_session_key.h"
+#include "net/quic/quic_shared_socket.h"
 #include "net/socket/client_socket_pool.h"
 #include "net/ssl/ssl_config_service.h"
 #include "net/third_party/quiche/src/quiche/quic/core/crypto/quic_client_session_cache.h"
@@ -368,8 +372,52 @@ class NET_EXPORT_PRIVATE QuicSessionPool
   // It sends connection close packet when closing connections.
   void CloseAllSessions(int error, quic::QuicErrorCode quic_error);
 
+  // Closes the current sessions of |network_anonymization_key| likewise.
+  void CloseSessionsForNetworkAnonymizationKey(
+      const NetworkAnonymizationKey& network_anonymization_key,
+      int error,
+      quic::QuicErrorCode quic_error);
+
+  // Runs `callback` with the NetworkAnonymizationKey of each session going
+  // away on a GOAWAY of the server, like
+  // SpdySessionPool::AddGoAwayCallback().
+  using GoAwayCallback =
+      base::RepeatingCallback<void(const NetworkAnonymizationKey&)>;
+  base::CallbackListSubscription AddGoAwayCallback(GoAwayCallback callback);
+
+  // Called by sessions receiving their first GOAWAY.
+  void OnSessionGoAway(
+      const NetworkAnonymizationKey& network_anonymization_key);
+
   base::Value QuicSessionPoolInfoToValue() const;
 
+  // The max packet length of each session, as raised by path MTU discovery,
+  // with the server the session was created for.
+  std::vector<std::pair<HostPortPair, quic::QuicByteCount>>
+  GetMaxPacketLengths() const;
+
+  struct PortHopStats {
+    // Probes of a new path that the session moved to, and that failed.
+    uint64_t hops = 0;
+    uint64_t failures = 0;
+    // Bytes sent and received on, and time spent on, the paths sessions
+    // moved off of.
+    uint64_t path_bytes = 0;
+    base::TimeDelta path_time;
+  };
+
+  // Moves each session to a new local port, and to a random server port
+  // from `first_port` to `last_port` unless they are 0, through a path
+  // probe. A session still probing, not yet confirmed, or whose server
+  // disabled migration keeps its path. Returns the sessions probing.
+  size_t HopPorts(uint16_t first_port, uint16_t last_port);
+
+  // Called by sessions when the probe of a hop completes, with the bytes
+  // and time of the path left on success.
+  void OnPortHop(bool success, uint64_t path_bytes, base::TimeDelta path_time);
+
+  const PortHopStats& port_hop_stats() const { return port_hop_stats_; }
+
   // Delete cached state objects in |crypto_config_|. If |origin_filter| is not
   // null, only objects on matching origins will be deleted.
   void ClearCachedStatesInCryptoConfig(
@@ -457,6 +505,8 @@ class NET_EXPORT_PRIVATE QuicSessionPool
     return params_.disable_gquic_zero_rtt;
   }
 
+  bool send_ecn() const { return params_.send_ecn; }
+
   // Returns true if QuicSessionPool is configured to report incoming ECN marks.
   bool report_ecn() const {
     return report_ecn_;
@@ -465,6 +515,14 @@ class NET_EXPORT_PRIVATE QuicSessionPool
   void set_is_quic_known_to_work_on_current_network(
       bool is_quic_known_to_work_on_current_network);
 
+  // Creates the TLS session cache of each crypto config instead of a
+  // quic::QuicClientSessionCache. Must be set before any session is created.
+  using SessionCacheFactory =
+      base::RepeatingCallback<std::unique_ptr<quic::SessionCache>()>;
+  void set_session_cache_factory(SessionCacheFactory session_cache_factory) {
+    session_cache_factory_ = std::move(session_cache_factory);
+  }
+
   // It returns the amount of time waiting job should be delayed.
   base::TimeDelta GetTimeDelayForWaitingJob(const QuicSessionKey& session_key);
 
@@ -589,7 +647,23 @@ class NET_EXPORT_PRIVATE QuicSessionPool
                            const NetLogWithSource& net_log,
                            raw_ptr<QuicChromiumClientSession>* session,
                            handles::NetworkHandle* network,
-                           std::unique_ptr<DatagramClientSocket> socket);
+                           std::unique_ptr<DatagramClientSocket> socket,
+                           const quic::QuicConnectionId& client_connection_id);
+
+  // Returns a member socket of the shared socket to `peer_address` on
+  // `network` and sets `client_connection_id` for it, or returns null if
+  // there is no such socket.
+  std::unique_ptr<DatagramClientSocket> JoinSharedSocket(
+      const IPEndPoint& peer_address,
+      handles::NetworkHandle network,
+      quic::QuicConnectionId* client_connection_id);
+  // Makes the connected `socket` the shared socket to `peer_address` on
+  // `network` and returns its first member, like JoinSharedSocket().
+  std::unique_ptr<DatagramClientSocket> ShareSocket(
+      std::unique_ptr<DatagramClientSocket> socket,
+      const IPEndPoint& peer_address,
+      handles::NetworkHandle network,
+      quic::QuicConnectionId* client_connection_id);
 
   // Called when the Job for the given key has created and confirmed a session.
   void ActivateSession(const QuicSessionAliasKey& key,
@@ -694,6 +768,8 @@ class NET_EXPORT_PRIVATE QuicSessionPool
   // the broken alternative service map in HttpServerProperties.
   bool is_quic_known_to_work_on_current_network_ = false;
 
+  SessionCacheFactory session_cache_factory_;
+
   NetLogWithSource net_log_;
   const raw_ptr<HostResolver> host_resolver_;
   const raw_ptr<ClientSocketFactory> client_socket_factory_;
@@ -807,6 +883,17 @@ class NET_EXPORT_PRIVATE QuicSessionPool
   quic::DeterministicConnectionIdGenerator connection_id_generator_{
       quic::kQuicDefaultConnectionIdLength};
 
+  // The sockets shared by sessions if `params_.share_sockets`, by peer
+  // address and network. Each lives as long as its sessions do.
+  std::map<std::pair<IPEndPoint, handles::NetworkHandle>,
+           base::WeakPtr<QuicSharedSocket>>
+      shared_sockets_;
+
+  base::RepeatingCallbackList<void(const NetworkAnonymizationKey&)>
+      go_away_callbacks_;
+
+  PortHopStats port_hop_stats_;
+
   base::WeakPtrFactory<QuicSessionPool> weak_factory_{this};
 };
 
@@ -818,7 +905,7 @@ class QuicSessionPool::QuicCryptoClientConfigOwner {
  public:
   QuicCryptoClientConfigOwner(
       std::unique_ptr<quic::ProofVerifier> proof_verifier,
-      std::unique_ptr<quic::QuicClientSessionCache> session_cache,
+      std::unique_ptr<quic::SessionCache> session_cache,
       QuicSessionPool* quic_session_pool);
 
   QuicCryptoClientConfigOwner(const QuicCryptoClientConfigOwner&) = delete;
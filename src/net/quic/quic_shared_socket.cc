@@ -0,0 +1,550 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/quic/quic_shared_socket.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+#include "base/check.h"
+#include "base/containers/contains.h"
+#include "base/containers/span.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/no_destructor.h"
+#include "base/rand_util.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_constants.h"
+
+namespace net {
+namespace {
+
+// Matches QuicChromiumPacketReader's.
+constexpr int kReadBufferSize = 64 * 1024;
+
+// Reads done in a row before yielding to other tasks.
+constexpr int kYieldAfterReads = 32;
+
+// Packets kept for a member that is not reading, beyond which they are
+// dropped like the kernel would drop them from a full receive buffer.
+constexpr size_t kMaxQueuedPackets = 256;
+
+// The client connection IDs of shared sockets. Bytes 0 and 1 hold the tag.
+constexpr uint8_t kConnectionIdLength = 8;
+constexpr size_t kTagLength = 2;
+
+constexpr uint8_t kLongHeaderBit = 0x80;
+// The form byte and the version.
+constexpr size_t kLongHeaderPrefixLength = 5;
+
+uint16_t ReadTag(const char* data) {
+  return static_cast<uint16_t>(static_cast<uint8_t>(data[0]) << 8 |
+                               static_cast<uint8_t>(data[1]));
+}
+
+quic::QuicConnectionId CreateTaggedConnectionId(const char* tag) {
+  char data[kConnectionIdLength];
+  base::RandBytes(base::as_writable_byte_span(data));
+  std::copy_n(tag, kTagLength, data);
+  return quic::QuicConnectionId(data, kConnectionIdLength);
+}
+
+// Finds the tag in the destination connection ID of `datagram`, which is at
+// byte 1 of short header packets, and follows the version and its length
+// byte in long header ones, including version negotiation.
+std::optional<uint16_t> ParseTag(std::string_view datagram) {
+  if (datagram.empty()) {
+    return std::nullopt;
+  }
+  size_t offset = 1;
+  if (static_cast<uint8_t>(datagram[0]) & kLongHeaderBit) {
+    if (datagram.size() <= kLongHeaderPrefixLength ||
+        static_cast<uint8_t>(datagram[kLongHeaderPrefixLength]) <
+            kTagLength) {
+      return std::nullopt;
+    }
+    offset = kLongHeaderPrefixLength + 1;
+  }
+  if (datagram.size() < offset + kTagLength) {
+    return std::nullopt;
+  }
+  return ReadTag(datagram.data() + offset);
+}
+
+class TaggedConnectionIdGenerator
+    : public quic::ConnectionIdGeneratorInterface {
+ public:
+  std::optional<quic::QuicConnectionId> GenerateNextConnectionId(
+      const quic::QuicConnectionId& original) override {
+    if (original.length() < kTagLength) {
+      return std::nullopt;
+    }
+    return CreateTaggedConnectionId(original.data());
+  }
+
+  std::optional<quic::QuicConnectionId> MaybeReplaceConnectionId(
+      const quic::QuicConnectionId& original,
+      const quic::ParsedQuicVersion& version) override {
+    return std::nullopt;
+  }
+
+  uint8_t ConnectionIdLength(uint8_t first_byte) const override {
+    return kConnectionIdLength;
+  }
+};
+
+}  // namespace
+
+// The socket of one connection. Its reads are served from the packets the
+// shared socket dispatched to it, and its writes go through the shared
+// socket. Setting up the socket is left to the shared socket's owner, so
+// those calls are no-ops.
+class QuicSharedSocket::Member : public DatagramClientSocket {
+ public:
+  Member(scoped_refptr<QuicSharedSocket> shared, uint16_t tag)
+      : shared_(std::move(shared)), tag_(tag) {}
+  Member(const Member&) = delete;
+  Member& operator=(const Member&) = delete;
+  ~Member() override { Close(); }
+
+  // Keeps `datagram` for the next read.
+  void AddPacket(std::string_view datagram, DscpAndEcn tos) {
+    if (packets_.size() >= kMaxQueuedPackets) {
+      return;
+    }
+    packets_.push_back({std::string(datagram), tos});
+  }
+
+  bool CanCompleteRead() const {
+    return !read_callback_.is_null() &&
+           (!packets_.empty() || shared_->read_error_ != 0);
+  }
+
+  // Completes the pending read. May delete `this`.
+  void CompleteRead() {
+    DCHECK(CanCompleteRead());
+    int rv = DoRead(read_buf_.get(), read_buf_len_, read_datagrams_);
+    read_buf_ = nullptr;
+    read_datagrams_ = nullptr;
+    std::move(read_callback_).Run(rv);
+  }
+
+  // DatagramClientSocket implementation.
+  int Connect(const IPEndPoint& address) override { return OK; }
+  int ConnectUsingNetwork(handles::NetworkHandle network,
+                          const IPEndPoint& address) override {
+    return OK;
+  }
+  int ConnectUsingDefaultNetwork(const IPEndPoint& address) override {
+    return OK;
+  }
+  int ConnectAsync(const IPEndPoint& address,
+                   CompletionOnceCallback callback) override {
+    return OK;
+  }
+  int ConnectUsingNetworkAsync(handles::NetworkHandle network,
+                               const IPEndPoint& address,
+                               CompletionOnceCallback callback) override {
+    return OK;
+  }
+  int ConnectUsingDefaultNetworkAsync(
+      const IPEndPoint& address,
+      CompletionOnceCallback callback) override {
+    return OK;
+  }
+  handles::NetworkHandle GetBoundNetwork() const override {
+    return shared_ ? shared_->socket_->GetBoundNetwork()
+                   : handles::kInvalidNetworkHandle;
+  }
+  void ApplySocketTag(const SocketTag& tag) override {}
+  bool SupportsSegmentedWrites() const override {
+    return shared_ && shared_->socket_->SupportsSegmentedWrites();
+  }
+  int WriteSegmented(IOBuffer* buf,
+                     int buf_len,
+                     int segment_size,
+                     CompletionOnceCallback callback) override {
+    if (!shared_) {
+      return ERR_SOCKET_NOT_CONNECTED;
+    }
+    return shared_->Write(tag_, buf, buf_len, segment_size,
+                          std::move(callback),
+                          MutableNetworkTrafficAnnotationTag());
+  }
+  int ReadMultiple(IOBuffer* buf,
+                   int buf_len,
+                   int max_datagram_size,
+                   std::vector<std::string_view>* datagrams,
+                   CompletionOnceCallback callback) override {
+    return StartRead(buf, buf_len, datagrams, std::move(callback));
+  }
+  DscpAndEcn GetDatagramTos(size_t index) const override {
+    return index < datagram_tos_.size() ? datagram_tos_[index] : DscpAndEcn();
+  }
+  int SetMulticastInterface(uint32_t interface_index) override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  // DatagramSocket implementation.
+  void Close() override {
+    if (!shared_) {
+      return;
+    }
+    packets_.clear();
+    read_callback_.Reset();
+    read_buf_ = nullptr;
+    read_datagrams_ = nullptr;
+    shared_->RemoveMember(tag_);
+    shared_ = nullptr;
+  }
+  int GetPeerAddress(IPEndPoint* address) const override {
+    return shared_ ? shared_->socket_->GetPeerAddress(address)
+                   : ERR_SOCKET_NOT_CONNECTED;
+  }
+  int GetLocalAddress(IPEndPoint* address) const override {
+    return shared_ ? shared_->socket_->GetLocalAddress(address)
+                   : ERR_SOCKET_NOT_CONNECTED;
+  }
+  void UseNonBlockingIO() override {}
+  int SetDoNotFragment() override { return OK; }
+  int SetRecvTos() override { return OK; }
+  int SetTos(DiffServCodePoint dscp, EcnCodePoint ecn) override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  void SetMsgConfirm(bool confirm) override {}
+  const NetLogWithSource& NetLog() const override { return net_log_; }
+  DscpAndEcn GetLastTos() const override { return last_tos_; }
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override {
+    return StartRead(buf, buf_len, /*datagrams=*/nullptr, std::move(callback));
+  }
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override {
+    if (!shared_) {
+      return ERR_SOCKET_NOT_CONNECTED;
+    }
+    return shared_->Write(
+        tag_, buf, buf_len, /*segment_size=*/0, std::move(callback),
+        MutableNetworkTrafficAnnotationTag(traffic_annotation));
+  }
+  int SetReceiveBufferSize(int32_t size) override { return OK; }
+  int SetSendBufferSize(int32_t size) override { return OK; }
+
+ private:
+  struct Packet {
+    std::string data;
+    DscpAndEcn tos;
+  };
+
+  int StartRead(IOBuffer* buf,
+                int buf_len,
+                std::vector<std::string_view>* datagrams,
+                CompletionOnceCallback callback) {
+    DCHECK(read_callback_.is_null());
+    if (!shared_) {
+      return ERR_SOCKET_NOT_CONNECTED;
+    }
+    if (packets_.empty() && shared_->read_error_ == 0) {
+      read_buf_ = buf;
+      read_buf_len_ = buf_len;
+      read_datagrams_ = datagrams;
+      read_callback_ = std::move(callback);
+      return ERR_IO_PENDING;
+    }
+    return DoRead(buf, buf_len, datagrams);
+  }
+
+  // Copies the queued packets into `buf`, all that fit if `datagrams` is
+  // given, else the first.
+  int DoRead(IOBuffer* buf,
+             int buf_len,
+             std::vector<std::string_view>* datagrams) {
+    if (packets_.empty()) {
+      return shared_->read_error_;
+    }
+    if (!datagrams) {
+      Packet packet = std::move(packets_.front());
+      packets_.pop_front();
+      if (packet.data.size() > static_cast<size_t>(buf_len)) {
+        return ERR_MSG_TOO_BIG;
+      }
+      std::copy(packet.data.begin(), packet.data.end(), buf->data());
+      last_tos_ = packet.tos;
+      return static_cast<int>(packet.data.size());
+    }
+    datagrams->clear();
+    datagram_tos_.clear();
+    size_t total = 0;
+    while (!packets_.empty() &&
+           total + packets_.front().data.size() <=
+               static_cast<size_t>(buf_len)) {
+      const Packet& packet = packets_.front();
+      char* data = buf->data() + total;
+      std::copy(packet.data.begin(), packet.data.end(), data);
+      datagrams->emplace_back(data, packet.data.size());
+      datagram_tos_.push_back(packet.tos);
+      total += packet.data.size();
+      packets_.pop_front();
+    }
+    return static_cast<int>(total);
+  }
+
+  // Null once closed.
+  scoped_refptr<QuicSharedSocket> shared_;
+  const uint16_t tag_;
+  base::circular_deque<Packet> packets_;
+  DscpAndEcn last_tos_;
+  std::vector<DscpAndEcn> datagram_tos_;
+
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_ = 0;
+  raw_ptr<std::vector<std::string_view>> read_datagrams_ = nullptr;
+  CompletionOnceCallback read_callback_;
+
+  NetLogWithSource net_log_;
+};
+
+QuicSharedSocket::PendingWrite::PendingWrite(
+    uint16_t tag,
+    scoped_refptr<IOBuffer> buf,
+    int buf_len,
+    int segment_size,
+    CompletionOnceCallback callback,
+    MutableNetworkTrafficAnnotationTag traffic_annotation)
+    : tag(tag),
+      buf(std::move(buf)),
+      buf_len(buf_len),
+      segment_size(segment_size),
+      callback(std::move(callback)),
+      traffic_annotation(traffic_annotation) {}
+
+QuicSharedSocket::PendingWrite::PendingWrite(PendingWrite&&) = default;
+
+QuicSharedSocket::PendingWrite& QuicSharedSocket::PendingWrite::operator=(
+    PendingWrite&&) = default;
+
+QuicSharedSocket::PendingWrite::~PendingWrite() = default;
+
+QuicSharedSocket::QuicSharedSocket(
+    std::unique_ptr<DatagramClientSocket> socket)
+    : socket_(std::move(socket)),
+      read_buffer_(base::MakeRefCounted<IOBufferWithSize>(kReadBufferSize)) {}
+
+QuicSharedSocket::~QuicSharedSocket() {
+  DCHECK(members_.empty());
+  socket_->Close();
+}
+
+std::unique_ptr<DatagramClientSocket> QuicSharedSocket::CreateMember(
+    quic::QuicConnectionId* client_connection_id) {
+  if (read_error_ != 0) {
+    return nullptr;
+  }
+  // Tags are drawn at random so they are not handed out again right after
+  // their member left, when packets for it may still arrive.
+  constexpr int kMaxTries = 16;
+  for (int i = 0; i < kMaxTries; ++i) {
+    auto tag = static_cast<uint16_t>(base::RandUint64());
+    if (base::Contains(members_, tag)) {
+      continue;
+    }
+    const char tag_bytes[kTagLength] = {static_cast<char>(tag >> 8),
+                                        static_cast<char>(tag)};
+    *client_connection_id = CreateTaggedConnectionId(tag_bytes);
+    auto member = std::make_unique<Member>(this, tag);
+    members_[tag] = member.get();
+    if (!read_pending_) {
+      DoRead();
+    }
+    return member;
+  }
+  return nullptr;
+}
+
+// static
+quic::ConnectionIdGeneratorInterface&
+QuicSharedSocket::connection_id_generator() {
+  static base::NoDestructor<TaggedConnectionIdGenerator> generator;
+  return *generator;
+}
+
+void QuicSharedSocket::RemoveMember(uint16_t tag) {
+  members_.erase(tag);
+  base::EraseIf(pending_writes_, [tag](const PendingWrite& write) {
+    return write.tag == tag;
+  });
+}
+
+int QuicSharedSocket::Write(
+    uint16_t tag,
+    IOBuffer* buf,
+    int buf_len,
+    int segment_size,
+    CompletionOnceCallback callback,
+    MutableNetworkTrafficAnnotationTag traffic_annotation) {
+  if (write_pending_) {
+    pending_writes_.emplace_back(tag, buf, buf_len, segment_size,
+                                 std::move(callback), traffic_annotation);
+    return ERR_IO_PENDING;
+  }
+  int rv = WriteToSocket(buf, buf_len, segment_size, traffic_annotation);
+  if (rv == ERR_IO_PENDING) {
+    write_tag_ = tag;
+    write_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int QuicSharedSocket::WriteToSocket(
+    IOBuffer* buf,
+    int buf_len,
+    int segment_size,
+    MutableNetworkTrafficAnnotationTag traffic_annotation) {
+  DCHECK(!write_pending_);
+  int rv;
+  if (segment_size > 0) {
+    rv = socket_->WriteSegmented(
+        buf, buf_len, segment_size,
+        base::BindOnce(&QuicSharedSocket::OnWriteComplete,
+                       weak_factory_.GetWeakPtr()));
+  } else {
+    rv = socket_->Write(buf, buf_len,
+                        base::BindOnce(&QuicSharedSocket::OnWriteComplete,
+                                       weak_factory_.GetWeakPtr()),
+                        NetworkTrafficAnnotationTag(traffic_annotation));
+  }
+  write_pending_ = rv == ERR_IO_PENDING;
+  return rv;
+}
+
+void QuicSharedSocket::OnWriteComplete(int rv) {
+  write_pending_ = false;
+  scoped_refptr<QuicSharedSocket> self(this);
+  if (base::Contains(members_, write_tag_)) {
+    std::move(write_callback_).Run(rv);
+  } else {
+    write_callback_.Reset();
+  }
+  DoPendingWrites();
+}
+
+void QuicSharedSocket::DoPendingWrites() {
+  while (!write_pending_ && !pending_writes_.empty()) {
+    PendingWrite write = std::move(pending_writes_.front());
+    pending_writes_.pop_front();
+    int rv = WriteToSocket(write.buf.get(), write.buf_len, write.segment_size,
+                           write.traffic_annotation);
+    if (rv == ERR_IO_PENDING) {
+      write_tag_ = write.tag;
+      write_callback_ = std::move(write.callback);
+      return;
+    }
+    // The member asked for an asynchronous completion, which this is.
+    std::move(write.callback).Run(rv);
+  }
+}
+
+void QuicSharedSocket::DoRead() {
+  DCHECK(!read_pending_);
+  scoped_refptr<QuicSharedSocket> self(this);
+  for (int reads = 0; !members_.empty(); ++reads) {
+    if (reads == kYieldAfterReads) {
+      read_pending_ = true;
+      base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+          FROM_HERE, base::BindOnce(&QuicSharedSocket::OnReadComplete,
+                                    weak_factory_.GetWeakPtr(), OK));
+      return;
+    }
+    int rv = ERR_NOT_IMPLEMENTED;
+    if (read_multiple_) {
+      rv = socket_->ReadMultiple(
+          read_buffer_.get(), read_buffer_->size(),
+          quic::kMaxIncomingPacketSize, &datagrams_,
+          base::BindOnce(&QuicSharedSocket::OnReadComplete,
+                         weak_factory_.GetWeakPtr()));
+      if (rv == ERR_NOT_IMPLEMENTED) {
+        read_multiple_ = false;
+      }
+    }
+    if (!read_multiple_) {
+      rv = socket_->Read(read_buffer_.get(), read_buffer_->size(),
+                         base::BindOnce(&QuicSharedSocket::OnReadComplete,
+                                        weak_factory_.GetWeakPtr()));
+    }
+    if (rv == ERR_IO_PENDING) {
+      read_pending_ = true;
+      return;
+    }
+    HandleReadResult(rv);
+    if (read_error_ != 0) {
+      return;
+    }
+  }
+}
+
+void QuicSharedSocket::OnReadComplete(int rv) {
+  read_pending_ = false;
+  scoped_refptr<QuicSharedSocket> self(this);
+  // A yield posts OK, for which there is nothing to hand out.
+  if (rv != OK) {
+    HandleReadResult(rv);
+  }
+  if (read_error_ == 0) {
+    DoRead();
+  }
+}
+
+void QuicSharedSocket::HandleReadResult(int rv) {
+  // Like QuicChromiumPacketReader, ignores empty and oversized datagrams.
+  if (rv == 0 || rv == ERR_MSG_TOO_BIG) {
+    return;
+  }
+  if (rv < 0) {
+    read_error_ = rv;
+  } else if (!read_multiple_) {
+    Dispatch(std::string_view(read_buffer_->data(), rv),
+             socket_->GetLastTos());
+  } else {
+    for (size_t i = 0; i < datagrams_.size(); ++i) {
+      Dispatch(datagrams_[i], socket_->GetDatagramTos(i));
+    }
+  }
+  DeliverPackets();
+}
+
+void QuicSharedSocket::Dispatch(std::string_view datagram, DscpAndEcn tos) {
+  std::optional<uint16_t> tag = ParseTag(datagram);
+  if (!tag) {
+    return;
+  }
+  auto it = members_.find(*tag);
+  if (it != members_.end()) {
+    it->second->AddPacket(datagram, tos);
+  }
+}
+
+void QuicSharedSocket::DeliverPackets() {
+  // Completing a read may remove any member.
+  std::vector<uint16_t> tags;
+  for (const auto& [tag, member] : members_) {
+    if (member->CanCompleteRead()) {
+      tags.push_back(tag);
+    }
+  }
+  for (uint16_t tag : tags) {
+    auto it = members_.find(tag);
+    if (it != members_.end() && it->second->CanCompleteRead()) {
+      it->second->CompleteRead();
+    }
+  }
+}
+
+}  // namespace net
@@ -0,0 +1,135 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_QUIC_QUIC_SHARED_SOCKET_H_
+#define NET_QUIC_QUIC_SHARED_SOCKET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/containers/circular_deque.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/net_export.h"
+#include "net/socket/datagram_client_socket.h"
+#include "net/third_party/quiche/src/quiche/quic/core/connection_id_generator.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_connection_id.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+
+class IOBuffer;
+class IOBufferWithSize;
+
+// A connected UDP socket that several QUIC connections to the same peer
+// share, so one fd and one batched receive serve all of them. Each
+// connection gets a member socket, and a client connection ID whose first
+// two bytes tag that member: packets from the peer are handed to the member
+// the tag of their destination connection ID names, and packets for no
+// member, e.g. stateless resets, are dropped. Only one write to the socket is
+// pending at a time, and those of the other members wait their turn.
+//
+// The connections must use connection_id_generator(), which keeps the tag
+// in the connection IDs they issue later. Members do not mark their packets
+// with ECN or pace them through the kernel, as the socket settings for those
+// are not theirs alone. The socket is closed with its last member.
+class NET_EXPORT_PRIVATE QuicSharedSocket
+    : public base::RefCounted<QuicSharedSocket> {
+ public:
+  // Takes a connected `socket`.
+  explicit QuicSharedSocket(std::unique_ptr<DatagramClientSocket> socket);
+  QuicSharedSocket(const QuicSharedSocket&) = delete;
+  QuicSharedSocket& operator=(const QuicSharedSocket&) = delete;
+
+  // Returns a new member socket and sets `client_connection_id` to the
+  // connection ID its connection is to use, or returns null if the socket
+  // has failed or has no tag left.
+  std::unique_ptr<DatagramClientSocket> CreateMember(
+      quic::QuicConnectionId* client_connection_id);
+
+  // The connection ID generator of connections on shared sockets, which
+  // issues IDs with the tag of the ID they replace.
+  static quic::ConnectionIdGeneratorInterface& connection_id_generator();
+
+  base::WeakPtr<QuicSharedSocket> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+ private:
+  friend class base::RefCounted<QuicSharedSocket>;
+  class Member;
+
+  struct PendingWrite {
+    PendingWrite(uint16_t tag,
+                 scoped_refptr<IOBuffer> buf,
+                 int buf_len,
+                 int segment_size,
+                 CompletionOnceCallback callback,
+                 MutableNetworkTrafficAnnotationTag traffic_annotation);
+    PendingWrite(PendingWrite&&);
+    PendingWrite& operator=(PendingWrite&&);
+    ~PendingWrite();
+
+    uint16_t tag;
+    scoped_refptr<IOBuffer> buf;
+    int buf_len;
+    int segment_size;
+    CompletionOnceCallback callback;
+    MutableNetworkTrafficAnnotationTag traffic_annotation;
+  };
+
+  ~QuicSharedSocket();
+
+  void RemoveMember(uint16_t tag);
+
+  // Writes for the member of `tag`, or queues the write behind the pending
+  // one. A `segment_size` of 0 writes a single datagram, the only kind
+  // `traffic_annotation` is needed for.
+  int Write(uint16_t tag,
+            IOBuffer* buf,
+            int buf_len,
+            int segment_size,
+            CompletionOnceCallback callback,
+            MutableNetworkTrafficAnnotationTag traffic_annotation);
+  int WriteToSocket(IOBuffer* buf,
+                    int buf_len,
+                    int segment_size,
+                    MutableNetworkTrafficAnnotationTag traffic_annotation);
+  void OnWriteComplete(int rv);
+  void DoPendingWrites();
+
+  void DoRead();
+  void OnReadComplete(int rv);
+  void HandleReadResult(int rv);
+  void Dispatch(std::string_view datagram, DscpAndEcn tos);
+  void DeliverPackets();
+
+  std::unique_ptr<DatagramClientSocket> socket_;
+  std::map<uint16_t, raw_ptr<Member>> members_;
+
+  scoped_refptr<IOBufferWithSize> read_buffer_;
+  std::vector<std::string_view> datagrams_;
+  bool read_multiple_ = true;
+  bool read_pending_ = false;
+  // The error that failed reads, after which members fail theirs with it.
+  int read_error_ = 0;
+
+  base::circular_deque<PendingWrite> pending_writes_;
+  bool write_pending_ = false;
+  uint16_t write_tag_ = 0;
+  CompletionOnceCallback write_callback_;
+
+  base::WeakPtrFactory<QuicSharedSocket> weak_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_QUIC_QUIC_SHARED_SOCKET_H_
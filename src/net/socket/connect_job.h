@@ -40,6 +40,7 @@ struct HostResolverEndpointResult;
 class HttpAuthCache;
 class HttpAuthController;
 class HttpAuthHandlerFactory;
+class HttpProxyWarmPool;
 class HttpResponseInfo;
 class HttpUserAgentSettings;
 class NetLog;
@@ -47,6 +48,7 @@ class NetLogWithSource;
 class NetworkQualityEstimator;
 class ProxyDelegate;
 class QuicSessionPool;
+class SOCKS5WarmPool;
 class SocketPerformanceWatcherFactory;
 class SocketTag;
 class SpdySessionPool;
@@ -110,6 +112,11 @@ struct NET_EXPORT_PRIVATE CommonConnectJobParams {
   raw_ptr<const SSLConfig::ApplicationSettings> application_settings;
   raw_ptr<const bool> ignore_certificate_errors;
   raw_ptr<const bool> enable_early_data;
+
+  // Null unless HttpNetworkSessionParams::http_proxy_warm_sockets is set.
+  raw_ptr<HttpProxyWarmPool> http_proxy_warm_pool = nullptr;
+  // Null unless HttpNetworkSessionParams::socks5_warm_sockets is set.
+  raw_ptr<SOCKS5WarmPool> socks5_warm_pool = nullptr;
 };
 
 // When a host resolution completes, OnHostResolutionCallback() is invoked. If
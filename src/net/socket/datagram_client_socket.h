@@ -5,7 +5,12 @@
 #ifndef NET_SOCKET_DATAGRAM_CLIENT_SOCKET_H_
 #define NET_SOCKET_DATAGRAM_CLIENT_SOCKET_H_
 
+#include <string_view>
+#include <vector>
+
+#include "base/time/time.h"
 #include "net/base/datagram_buffer.h"
+#include "net/base/net_errors.h"
 #include "net/base/net_export.h"
 #include "net/base/network_handle.h"
 #include "net/socket/datagram_socket.h"
@@ -77,6 +82,46 @@ class NET_EXPORT_PRIVATE DatagramClientSocket : public DatagramSocket,
   // By default, this method is no-op.
   virtual void EnableRecvOptimization() {}
 
+  // Returns whether WriteSegmented() is supported. By default, it is not.
+  virtual bool SupportsSegmentedWrites() const { return false; }
+
+  // Writes |buf| as datagrams of |segment_size| bytes each, the last one
+  // possibly shorter, in as few system calls as the platform allows.
+  // Returns |buf_len| once all of them are written, or a net error code.
+  // Returns ERR_NOT_IMPLEMENTED if SupportsSegmentedWrites() is false.
+  virtual int WriteSegmented(IOBuffer* buf,
+                             int buf_len,
+                             int segment_size,
+                             CompletionOnceCallback callback) {
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  // Lets the caller pace writes through the kernel: once enabled, the
+  // datagrams of each write are held by the qdisc, fq on Linux, until the
+  // time last given to SetNextTxTime(). Returns a net error code. By
+  // default, this method is not implemented.
+  virtual int SetTxTime() { return ERR_NOT_IMPLEMENTED; }
+  virtual bool IsTxTimeEnabled() const { return false; }
+  virtual void SetNextTxTime(base::TimeTicks time) {}
+
+  // Reads as many datagrams as are ready, up to the platform's batch size,
+  // into |buf| in one system call where possible, and fills in |datagrams|
+  // with views into |buf| of each, none longer than |max_datagram_size|.
+  // Longer datagrams are dropped. Returns the total size of the datagrams,
+  // or a net error code. By default, this method is not implemented.
+  virtual int ReadMultiple(IOBuffer* buf,
+                           int buf_len,
+                           int max_datagram_size,
+                           std::vector<std::string_view>* datagrams,
+                           CompletionOnceCallback callback) {
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  // Returns the DSCP and ECN codepoint of datagram |index| of the last
+  // ReadMultiple(), which GetLastTos() does not report, once SetRecvTos()
+  // enabled receiving them. By default, returns zeros.
+  virtual DscpAndEcn GetDatagramTos(size_t index) const { return {}; }
+
   // Set interface to use for data sent to multicast groups. If
   // |interface_index| set to 0, default interface is used.
   // Must be called before Connect(), ConnectUsingNetwork() or
@@ -88,6 +88,18 @@ bool SocketBIOAdapter::HasPendingReadData() {
   return read_result_ > 0;
 }
 
+bool SocketBIOAdapter::HasPendingWriteData() const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  return write_buffer_used_ > 0 || write_error_ == ERR_IO_PENDING;
+}
+
+void SocketBIOAdapter::FailWrites(int error) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(!HasPendingWriteData());
+  DCHECK_LT(error, 0);
+  write_error_ = error;
+}
+
 size_t SocketBIOAdapter::GetAllocationSize() const {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   size_t buffer_size = 0;
@@ -85,6 +85,14 @@ class NET_EXPORT_PRIVATE SocketBIOAdapter {
   // but not yet consumed by the BIO.
   bool HasPendingReadData();
 
+  // Returns true if data written to the BIO has not been written to the
+  // underlying StreamSocket yet.
+  bool HasPendingWriteData() const;
+
+  // Fails later writes to the BIO with |error|, once something else writes
+  // to the underlying StreamSocket.
+  void FailWrites(int error);
+
   // Returns the allocation size estimate in bytes.
   size_t GetAllocationSize() const;
 
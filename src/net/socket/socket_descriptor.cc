@@ -9,6 +9,8 @@
 #if BUILDFLAG(IS_WIN)
 #include <ws2tcpip.h>
 
+#include <atomic>
+
 #include "net/base/winsock_init.h"
 #elif BUILDFLAG(IS_POSIX) || BUILDFLAG(IS_FUCHSIA)
 #include <sys/socket.h>
@@ -21,11 +23,26 @@
 
 namespace net {
 
+#if BUILDFLAG(IS_WIN)
+namespace {
+std::atomic<bool> g_registered_io_sockets{false};
+}  // namespace
+
+void SetRegisteredIoSockets(bool enabled) {
+  g_registered_io_sockets.store(enabled, std::memory_order_relaxed);
+}
+#endif
+
 SocketDescriptor CreatePlatformSocket(int family, int type, int protocol) {
 #if BUILDFLAG(IS_WIN)
   EnsureWinsockInit();
-  SocketDescriptor result = ::WSASocket(family, type, protocol, nullptr, 0,
-                                        WSA_FLAG_OVERLAPPED);
+  DWORD flags = WSA_FLAG_OVERLAPPED;
+  if (type == SOCK_STREAM &&
+      g_registered_io_sockets.load(std::memory_order_relaxed)) {
+    flags |= WSA_FLAG_REGISTERED_IO;
+  }
+  SocketDescriptor result =
+      ::WSASocket(family, type, protocol, nullptr, 0, flags);
   if (result != kInvalidSocket && family == AF_INET6) {
     DWORD value = 0;
     if (setsockopt(result, IPPROTO_IPV6, IPV6_V6ONLY,
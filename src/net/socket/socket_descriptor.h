@@ -27,6 +27,13 @@ SocketDescriptor NET_EXPORT CreatePlatformSocket(int family,
                                                  int type,
                                                  int protocol);
 
+#if BUILDFLAG(IS_WIN)
+// Makes CreatePlatformSocket() create TCP sockets for Registered I/O as well
+// as overlapped I/O, which sockets accepted on them inherit. Set before any
+// socket is created.
+NET_EXPORT void SetRegisteredIoSockets(bool enabled);
+#endif
+
 }  // namespace net
 
 #endif  // NET_SOCKET_SOCKET_DESCRIPTOR_H_
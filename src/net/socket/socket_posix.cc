@@ -8,6 +8,7 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <cstring>
 #include <memory>
 #include <utility>
 
@@ -31,6 +32,29 @@
 #include <sys/ioctl.h>
 #endif  // BUILDFLAG(IS_FUCHSIA)
 
+#if BUILDFLAG(IS_LINUX)
+#include <linux/errqueue.h>
+#include <sys/ioctl.h>
+
+#include "base/location.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+// Older headers lack the Linux 4.14 API.
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#endif  // BUILDFLAG(IS_LINUX)
+
 namespace net {
 
 namespace {
@@ -66,6 +90,98 @@ int MapConnectError(int os_error) {
   }
 }
 
+#if BUILDFLAG(IS_LINUX)
+using ZeroCopyQueue = std::deque<std::pair<uint32_t, scoped_refptr<IOBuffer>>>;
+
+// How long a closed socket is kept open for its zero-copy sends.
+constexpr base::TimeDelta kZeroCopyCloseTimeout = base::Minutes(1);
+constexpr base::TimeDelta kZeroCopyClosePollInterval = base::Milliseconds(100);
+
+// Drops the buffers of `pending` whose sends the error queue of `fd`
+// reports done. Returns true if the kernel copied any of them instead.
+bool ReapZeroCopyCompletions(int fd, ZeroCopyQueue& pending) {
+  bool copied = false;
+  while (!pending.empty()) {
+    alignas(cmsghdr) char control[128];
+    msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (HANDLE_EINTR(recvmsg(fd, &msg, MSG_ERRQUEUE)) < 0)
+      break;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      sock_extended_err err;
+      memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+      if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        copied = true;
+      // Reports the sends numbered ee_info to ee_data, usually in the order
+      // sent. The numbers wrap around.
+      uint32_t first = err.ee_info;
+      uint32_t count = err.ee_data - first;
+      std::erase_if(pending, [first, count](const auto& send) {
+        return send.first - first <= count;
+      });
+    }
+  }
+  return copied;
+}
+
+// Whether close() resets the connection, discarding what is unsent.
+bool ResetsOnClose(int fd) {
+  linger linger = {};
+  socklen_t len = sizeof(linger);
+  if (getsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, &len) == 0 &&
+      linger.l_onoff && linger.l_linger == 0) {
+    return true;
+  }
+  int unread = 0;
+  return ioctl(fd, FIONREAD, &unread) == 0 && unread > 0;
+}
+
+// Holds the buffers of the zero-copy sends of a closed socket until the
+// kernel is done with them, after which their pages could go out with the
+// data of whatever reuses the buffers. Closes `fd` then if valid, which was
+// shut down for writing in place of the close. Deletes itself.
+class ZeroCopyCloser {
+ public:
+  ZeroCopyCloser(int fd, ZeroCopyQueue pending)
+      : fd_(fd),
+        pending_(std::move(pending)),
+        deadline_(base::TimeTicks::Now() + kZeroCopyCloseTimeout) {
+    timer_.Start(FROM_HERE, kZeroCopyClosePollInterval, this,
+                 &ZeroCopyCloser::Poll);
+  }
+  ZeroCopyCloser(const ZeroCopyCloser&) = delete;
+  ZeroCopyCloser& operator=(const ZeroCopyCloser&) = delete;
+
+ private:
+  ~ZeroCopyCloser() {
+    if (fd_ != kInvalidSocket && IGNORE_EINTR(close(fd_)) < 0)
+      DPLOG(ERROR) << "close() failed";
+  }
+
+  void Poll() {
+    // Without the socket nothing is reported, so the buffers are held for
+    // the whole timeout.
+    if (fd_ != kInvalidSocket)
+      ReapZeroCopyCompletions(fd_, pending_);
+    if (pending_.empty() || base::TimeTicks::Now() >= deadline_)
+      delete this;
+  }
+
+  int fd_;
+  ZeroCopyQueue pending_;
+  base::TimeTicks deadline_;
+  base::RepeatingTimer timer_;
+};
+#endif  // BUILDFLAG(IS_LINUX)
+
 }  // namespace
 
 SocketPosix::SocketPosix()
@@ -412,6 +528,11 @@ void SocketPosix::DetachFromThread() {
 void SocketPosix::OnFileCanReadWithoutBlocking(int fd) {
   TRACE_EVENT0(NetTracingCategory(),
                "SocketPosix::OnFileCanReadWithoutBlocking");
+#if BUILDFLAG(IS_LINUX)
+  // Completions on the error queue wake up both watchers until reaped.
+  if (!zerocopy_pending_.empty())
+    ReapZeroCopy();
+#endif
   if (!accept_callback_.is_null()) {
     AcceptCompleted();
   } else {
@@ -422,6 +543,10 @@ void SocketPosix::OnFileCanReadWithoutBlocking(int fd) {
 
 void SocketPosix::OnFileCanWriteWithoutBlocking(int fd) {
   DCHECK(!write_callback_.is_null());
+#if BUILDFLAG(IS_LINUX)
+  if (!zerocopy_pending_.empty())
+    ReapZeroCopy();
+#endif
   if (waiting_connect_) {
     ConnectCompleted();
   } else {
@@ -431,9 +556,17 @@ void SocketPosix::OnFileCanWriteWithoutBlocking(int fd) {
 
 int SocketPosix::DoAccept(std::unique_ptr<SocketPosix>* socket) {
   SockaddrStorage new_peer_address;
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_ANDROID)
+  // Saves a fcntl() per accepted socket making it non-blocking, and keeps
+  // it from leaking into child processes.
+  int new_socket = HANDLE_EINTR(accept4(socket_fd_, new_peer_address.addr,
+                                        &new_peer_address.addr_len,
+                                        SOCK_NONBLOCK | SOCK_CLOEXEC));
+#else
   int new_socket = HANDLE_EINTR(accept(socket_fd_,
                                        new_peer_address.addr,
                                        &new_peer_address.addr_len));
+#endif
   if (new_socket < 0)
     return MapAcceptError(errno);
 
@@ -516,6 +649,22 @@ void SocketPosix::ReadCompleted() {
 }
 
 int SocketPosix::DoWrite(IOBuffer* buf, int buf_len) {
+#if BUILDFLAG(IS_LINUX)
+  if (zerocopy_threshold_ > 0 && buf_len >= zerocopy_threshold_) {
+    if (!zerocopy_pending_.empty())
+      ReapZeroCopy();
+    int rv = HANDLE_EINTR(
+        send(socket_fd_, buf->data(), buf_len, MSG_NOSIGNAL | MSG_ZEROCOPY));
+    if (rv >= 0) {
+      CHECK_LE(rv, buf_len);
+      zerocopy_pending_.emplace_back(zerocopy_next_id_++, buf);
+      return rv;
+    }
+    // Past the locked memory limit sends are copied until some complete.
+    if (errno != ENOBUFS)
+      return MapSystemError(errno);
+  }
+#endif
 #if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_ANDROID)
   // Disable SIGPIPE for this write. Although Chromium globally disables
   // SIGPIPE, the net stack may be used in other consumers which do not do
@@ -543,6 +692,26 @@ void SocketPosix::WriteCompleted() {
   std::move(write_callback_).Run(rv);
 }
 
+#if BUILDFLAG(IS_LINUX)
+int SocketPosix::EnableZeroCopy(int threshold) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  DCHECK_GT(threshold, 0);
+
+  int on = 1;
+  if (setsockopt(socket_fd_, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+    return MapSystemError(errno);
+  zerocopy_threshold_ = threshold;
+  return OK;
+}
+
+void SocketPosix::ReapZeroCopy() {
+  // Copying is slower than a plain send, so it stops trying, e.g. on
+  // loopback or devices without scatter-gather.
+  if (ReapZeroCopyCompletions(socket_fd_, zerocopy_pending_))
+    zerocopy_threshold_ = 0;
+}
+#endif
+
 void SocketPosix::StopWatchingAndCleanUp(bool close_socket) {
   bool ok = accept_socket_watcher_.StopWatchingFileDescriptor();
   DCHECK(ok);
@@ -554,12 +723,32 @@ void SocketPosix::StopWatchingAndCleanUp(bool close_socket) {
   // These needs to be done after the StopWatchingFileDescriptor() calls, but
   // before deleting the write buffer.
   if (close_socket) {
+#if BUILDFLAG(IS_LINUX)
+    if (socket_fd_ != kInvalidSocket && !zerocopy_pending_.empty()) {
+      ReapZeroCopy();
+      // A reset discards the unsent data at once.
+      if (!zerocopy_pending_.empty() && !ResetsOnClose(socket_fd_)) {
+        shutdown(socket_fd_, SHUT_WR);
+        new ZeroCopyCloser(socket_fd_, std::move(zerocopy_pending_));
+        socket_fd_ = kInvalidSocket;
+      }
+    }
+#endif
     if (socket_fd_ != kInvalidSocket) {
       if (IGNORE_EINTR(close(socket_fd_)) < 0)
         DPLOG(ERROR) << "close() failed";
       socket_fd_ = kInvalidSocket;
     }
   }
+#if BUILDFLAG(IS_LINUX)
+  if (!zerocopy_pending_.empty()) {
+    // The new owner of a released socket does not know of the sends.
+    if (!close_socket)
+      new ZeroCopyCloser(kInvalidSocket, std::move(zerocopy_pending_));
+    zerocopy_pending_.clear();
+  }
+  zerocopy_threshold_ = 0;
+#endif
 
   if (!accept_callback_.is_null()) {
     accept_socket_ = nullptr;
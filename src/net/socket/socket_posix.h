@@ -5,13 +5,17 @@
 #ifndef NET_SOCKET_SOCKET_POSIX_H_
 #define NET_SOCKET_SOCKET_POSIX_H_
 
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <utility>
 
 #include "base/compiler_specific.h"
 #include "base/memory/raw_ptr.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/message_loop/message_pump_for_io.h"
 #include "base/threading/thread_checker.h"
+#include "build/build_config.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 #include "net/socket/socket_descriptor.h"
@@ -106,6 +110,16 @@ class NET_EXPORT_PRIVATE SocketPosix
 
   SocketDescriptor socket_fd() const { return socket_fd_; }
 
+#if BUILDFLAG(IS_LINUX)
+  // Sends writes of at least `threshold` bytes with MSG_ZEROCOPY. The pages
+  // of such a write stay in use by the kernel after it completes, so the
+  // socket keeps a reference to its buffer until the kernel reports it
+  // sent, and its data must not change until that reference is gone. They
+  // are held past Close() too, until sent or for a minute at most. Returns
+  // a net error if the kernel lacks SO_ZEROCOPY.
+  int EnableZeroCopy(int threshold);
+#endif
+
  private:
   // base::MessagePumpForIO::FdWatcher methods.
   void OnFileCanReadWithoutBlocking(int fd) override;
@@ -127,6 +141,16 @@ class NET_EXPORT_PRIVATE SocketPosix
   // |close_socket| indicates whether the socket should also be closed.
   void StopWatchingAndCleanUp(bool close_socket);
 
+#if BUILDFLAG(IS_LINUX)
+  // Zero-copy sends not reported done yet, by their number in the kernel's
+  // count of them.
+  using ZeroCopyQueue =
+      std::deque<std::pair<uint32_t, scoped_refptr<IOBuffer>>>;
+
+  // Releases the buffers of the zero-copy sends the kernel is done with.
+  void ReapZeroCopy();
+#endif
+
   SocketDescriptor socket_fd_;
 
   base::MessagePumpForIO::FdWatchController accept_socket_watcher_;
@@ -155,6 +179,12 @@ class NET_EXPORT_PRIVATE SocketPosix
 
   std::unique_ptr<SockaddrStorage> peer_address_;
 
+#if BUILDFLAG(IS_LINUX)
+  int zerocopy_threshold_ = 0;
+  uint32_t zerocopy_next_id_ = 0;
+  ZeroCopyQueue zerocopy_pending_;
+#endif
+
   base::ThreadChecker thread_checker_;
 };
 
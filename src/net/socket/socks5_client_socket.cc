@@ -58,7 +58,16 @@ int SOCKS5ClientSocket::Connect(CompletionOnceCallback callback) {
 
   net_log_.BeginEvent(NetLogEventType::SOCKS5_CONNECT);
 
-  next_state_ = STATE_GREET_WRITE;
+  // Since we only have 1 byte to send the hostname length in, if the
+  // URL has a hostname longer than 255 characters we can't send it.
+  if (0xFF < destination_.host().size()) {
+    net_log_.AddEvent(NetLogEventType::SOCKS_HOSTNAME_TOO_BIG);
+    net_log_.EndEventWithNetErrorCode(NetLogEventType::SOCKS5_CONNECT,
+                                      ERR_SOCKS_CONNECTION_FAILED);
+    return ERR_SOCKS_CONNECTION_FAILED;
+  }
+
+  next_state_ = greeted_ ? STATE_HANDSHAKE_WRITE : STATE_GREET_WRITE;
   buffer_.clear();
 
   int rv = DoLoop(OK);
@@ -70,9 +79,27 @@ int SOCKS5ClientSocket::Connect(CompletionOnceCallback callback) {
   return rv;
 }
 
+int SOCKS5ClientSocket::Greet(CompletionOnceCallback callback) {
+  DCHECK(transport_socket_);
+  DCHECK_EQ(STATE_NONE, next_state_);
+  DCHECK(user_callback_.is_null());
+  DCHECK(!pipelined_);
+
+  greet_only_ = true;
+  next_state_ = STATE_GREET_WRITE;
+  buffer_.clear();
+
+  int rv = DoLoop(OK);
+  if (rv == ERR_IO_PENDING)
+    user_callback_ = std::move(callback);
+  return rv;
+}
+
 void SOCKS5ClientSocket::Disconnect() {
   completed_handshake_ = false;
-  transport_socket_->Disconnect();
+  // Gone after PassTransportSocket().
+  if (transport_socket_)
+    transport_socket_->Disconnect();
 
   // Reset other states to make sure they aren't mistakenly used later.
   // These are the states initialized by Connect().
@@ -180,7 +207,8 @@ void SOCKS5ClientSocket::OnIOComplete(int result) {
   DCHECK_NE(STATE_NONE, next_state_);
   int rv = DoLoop(result);
   if (rv != ERR_IO_PENDING) {
-    net_log_.EndEvent(NetLogEventType::SOCKS5_CONNECT);
+    if (!greet_only_)
+      net_log_.EndEvent(NetLogEventType::SOCKS5_CONNECT);
     DoCallback(rv);
   }
 }
@@ -254,16 +282,16 @@ int SOCKS5ClientSocket::DoLoop(int last_io_result) {
 const char kSOCKS5GreetWriteData[] = { 0x05, 0x01, 0x00 };  // no authentication
 
 int SOCKS5ClientSocket::DoGreetWrite() {
-  // Since we only have 1 byte to send the hostname length in, if the
-  // URL has a hostname longer than 255 characters we can't send it.
-  if (0xFF < destination_.host().size()) {
-    net_log_.AddEvent(NetLogEventType::SOCKS_HOSTNAME_TOO_BIG);
-    return ERR_SOCKS_CONNECTION_FAILED;
-  }
-
   if (buffer_.empty()) {
     buffer_ =
         std::string(kSOCKS5GreetWriteData, std::size(kSOCKS5GreetWriteData));
+    if (pipelined_) {
+      std::string handshake;
+      int rv = BuildHandshakeWriteBuffer(&handshake);
+      if (rv != OK)
+        return rv;
+      buffer_ += handshake;
+    }
     bytes_sent_ = 0;
   }
 
@@ -329,7 +357,12 @@ int SOCKS5ClientSocket::DoGreetReadComplete(int result) {
   }
 
   buffer_.clear();
-  next_state_ = STATE_HANDSHAKE_WRITE;
+  if (greet_only_) {
+    next_state_ = STATE_NONE;
+    return OK;
+  }
+  // The CONNECT request of a pipelined greeting was sent along with it.
+  next_state_ = pipelined_ ? STATE_HANDSHAKE_READ : STATE_HANDSHAKE_WRITE;
   return OK;
 }
 
@@ -45,6 +45,23 @@ class NET_EXPORT_PRIVATE SOCKS5ClientSocket : public StreamSocket {
   // On destruction Disconnect() is called.
   ~SOCKS5ClientSocket() override;
 
+  // Sends the CONNECT request along with the greeting instead of after its
+  // reply, saving a round trip. Only no authentication is offered anyway, so
+  // a proxy refusing it fails the same either way.
+  void set_pipelined(bool pipelined) { pipelined_ = pipelined; }
+
+  // The transport socket was greeted by another SOCKS5ClientSocket, see
+  // Greet(), so Connect() only sends the CONNECT request.
+  void set_greeted() { greeted_ = true; }
+
+  // Only greets the proxy, ahead of knowing the destination. The greeted
+  // transport socket is then taken with PassTransportSocket(), leaving this
+  // socket unusable. See SOCKS5WarmPool.
+  int Greet(CompletionOnceCallback callback);
+  std::unique_ptr<StreamSocket> PassTransportSocket() {
+    return std::move(transport_socket_);
+  }
+
   // StreamSocket implementation.
 
   // Does the SOCKS handshake and completes the protocol.
@@ -150,6 +167,11 @@ class NET_EXPORT_PRIVATE SOCKS5ClientSocket : public StreamSocket {
 
   bool was_ever_used_ = false;
 
+  bool pipelined_ = false;
+  bool greeted_ = false;
+  // Stops after the greeting, see Greet().
+  bool greet_only_ = false;
+
   const HostPortPair destination_;
 
   NetLogWithSource net_log_;
@@ -0,0 +1,160 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/socket/socks5_warm_pool.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/containers/contains.h"
+#include "base/functional/bind.h"
+#include "base/notreached.h"
+#include "base/ranges/algorithm.h"
+#include "net/base/net_errors.h"
+#include "net/base/request_priority.h"
+#include "net/socket/socket_tag.h"
+#include "net/socket/socks5_client_socket.h"
+#include "net/socket/socks_connect_job.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/transport_connect_job.h"
+#include "third_party/abseil-cpp/absl/types/variant.h"
+#include "url/scheme_host_port.h"
+
+namespace net {
+
+namespace {
+// Proxies commonly give a connection no longer than a minute to send its
+// request.
+constexpr base::TimeDelta kIdleTimeout = base::Seconds(30);
+
+HostPortPair ToHostPortPair(const TransportSocketParams::Endpoint& endpoint) {
+  if (absl::holds_alternative<url::SchemeHostPort>(endpoint)) {
+    return HostPortPair::FromSchemeHostPort(
+        absl::get<url::SchemeHostPort>(endpoint));
+  }
+  return absl::get<HostPortPair>(endpoint);
+}
+}  // namespace
+
+SOCKS5WarmPool::IdleSocket::IdleSocket(std::unique_ptr<StreamSocket> socket,
+                                       base::TimeTicks since)
+    : socket(std::move(socket)), since(since) {}
+SOCKS5WarmPool::IdleSocket::IdleSocket(IdleSocket&&) = default;
+SOCKS5WarmPool::IdleSocket& SOCKS5WarmPool::IdleSocket::operator=(
+    IdleSocket&&) = default;
+SOCKS5WarmPool::IdleSocket::~IdleSocket() = default;
+
+SOCKS5WarmPool::Proxy::Proxy() = default;
+SOCKS5WarmPool::Proxy::~Proxy() = default;
+
+SOCKS5WarmPool::SOCKS5WarmPool(size_t size) : size_(size) {
+  DCHECK_GT(size_, 0u);
+}
+
+SOCKS5WarmPool::~SOCKS5WarmPool() = default;
+
+std::unique_ptr<StreamSocket> SOCKS5WarmPool::Take(
+    const scoped_refptr<SOCKSSocketParams>& params,
+    const CommonConnectJobParams* common_connect_job_params) {
+  DCHECK(params->is_socks_v5());
+  Proxy& proxy =
+      proxies_[ToHostPortPair(params->transport_params()->destination())];
+  proxy.params = params;
+  proxy.common_connect_job_params = common_connect_job_params;
+
+  // Oldest first, before the proxy closes them.
+  std::unique_ptr<StreamSocket> socket;
+  base::TimeTicks now = base::TimeTicks::Now();
+  while (!socket && !proxy.idle.empty()) {
+    IdleSocket idle = std::move(proxy.idle.front());
+    proxy.idle.pop_front();
+    if (now - idle.since < kIdleTimeout && idle.socket->IsConnectedAndIdle())
+      socket = std::move(idle.socket);
+  }
+  TopUp(proxy);
+  return socket;
+}
+
+void SOCKS5WarmPool::OnConnectJobComplete(int result, ConnectJob* job) {
+  for (auto& [server, proxy] : proxies_) {
+    if (base::Contains(proxy.jobs, job, &std::unique_ptr<ConnectJob>::get)) {
+      OnJobComplete(proxy, job, result);
+      return;
+    }
+  }
+  NOTREACHED();
+}
+
+void SOCKS5WarmPool::OnNeedsProxyAuth(
+    const HttpResponseInfo& response,
+    HttpAuthController* auth_controller,
+    base::OnceClosure restart_with_auth_callback,
+    ConnectJob* job) {
+  // Only transport connections are made.
+  NOTREACHED();
+}
+
+void SOCKS5WarmPool::TopUp(Proxy& proxy) {
+  while (proxy.jobs.size() + proxy.greetings.size() + proxy.idle.size() <
+         size_) {
+    auto job = std::make_unique<TransportConnectJob>(
+        IDLE, SocketTag(), proxy.common_connect_job_params,
+        proxy.params->transport_params(), this, /*net_log=*/nullptr);
+    ConnectJob* raw_job = job.get();
+    proxy.jobs.push_back(std::move(job));
+    int rv = raw_job->Connect();
+    if (rv == ERR_IO_PENDING)
+      continue;
+    OnJobComplete(proxy, raw_job, rv);
+    // Failures are retried on the next Take().
+    if (rv != OK)
+      break;
+  }
+}
+
+void SOCKS5WarmPool::OnJobComplete(Proxy& proxy, ConnectJob* job, int result) {
+  auto it =
+      base::ranges::find(proxy.jobs, job, &std::unique_ptr<ConnectJob>::get);
+  CHECK(it != proxy.jobs.end());
+  std::unique_ptr<ConnectJob> owned_job = std::move(*it);
+  proxy.jobs.erase(it);
+  if (result != OK)
+    return;
+  Greet(proxy, owned_job->PassSocket());
+}
+
+void SOCKS5WarmPool::Greet(Proxy& proxy, std::unique_ptr<StreamSocket> socket) {
+  // The destination is only known once the connection is taken.
+  auto greeting = std::make_unique<SOCKS5ClientSocket>(
+      std::move(socket), HostPortPair(), proxy.params->traffic_annotation());
+  SOCKS5ClientSocket* raw_greeting = greeting.get();
+  proxy.greetings.push_back(std::move(greeting));
+  // Deleting the greeting cancels the callback.
+  int rv = raw_greeting->Greet(base::BindOnce(
+      &SOCKS5WarmPool::OnGreetComplete, base::Unretained(this),
+      ToHostPortPair(proxy.params->transport_params()->destination()),
+      raw_greeting));
+  if (rv != ERR_IO_PENDING) {
+    OnGreetComplete(
+        ToHostPortPair(proxy.params->transport_params()->destination()),
+        raw_greeting, rv);
+  }
+}
+
+void SOCKS5WarmPool::OnGreetComplete(const HostPortPair& server,
+                                     SOCKS5ClientSocket* greeting,
+                                     int result) {
+  Proxy& proxy = proxies_[server];
+  auto it = base::ranges::find(proxy.greetings, greeting,
+                               &std::unique_ptr<SOCKS5ClientSocket>::get);
+  CHECK(it != proxy.greetings.end());
+  std::unique_ptr<SOCKS5ClientSocket> owned_greeting = std::move(*it);
+  proxy.greetings.erase(it);
+  if (result != OK)
+    return;
+  proxy.idle.emplace_back(owned_greeting->PassTransportSocket(),
+                          base::TimeTicks::Now());
+}
+
+}  // namespace net
@@ -0,0 +1,90 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_SOCKET_SOCKS5_WARM_POOL_H_
+#define NET_SOCKET_SOCKS5_WARM_POOL_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/containers/circular_deque.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/net_export.h"
+#include "net/socket/connect_job.h"
+
+namespace net {
+
+class SOCKS5ClientSocket;
+class SOCKSSocketParams;
+class StreamSocket;
+
+// Connections to SOCKS5 proxies that have already been greeted, which
+// SOCKSConnectJob sends its CONNECT request over instead of connecting anew,
+// so a tunnel costs only the CONNECT round trip. Whenever one is taken, the
+// connections to its proxy are topped up to `size` in the background.
+// Connections are shared by all network anonymization keys. Owned by the
+// HttpNetworkSession.
+class NET_EXPORT_PRIVATE SOCKS5WarmPool : public ConnectJob::Delegate {
+ public:
+  explicit SOCKS5WarmPool(size_t size);
+  ~SOCKS5WarmPool() override;
+  SOCKS5WarmPool(const SOCKS5WarmPool&) = delete;
+  SOCKS5WarmPool& operator=(const SOCKS5WarmPool&) = delete;
+
+  // Returns a greeted connection to the proxy of `params`, or null, e.g. for
+  // the first tunnel through it. `common_connect_job_params` must outlive
+  // the pool.
+  std::unique_ptr<StreamSocket> Take(
+      const scoped_refptr<SOCKSSocketParams>& params,
+      const CommonConnectJobParams* common_connect_job_params);
+
+  // ConnectJob::Delegate:
+  void OnConnectJobComplete(int result, ConnectJob* job) override;
+  void OnNeedsProxyAuth(const HttpResponseInfo& response,
+                        HttpAuthController* auth_controller,
+                        base::OnceClosure restart_with_auth_callback,
+                        ConnectJob* job) override;
+
+ private:
+  struct IdleSocket {
+    IdleSocket(std::unique_ptr<StreamSocket> socket, base::TimeTicks since);
+    IdleSocket(IdleSocket&&);
+    IdleSocket& operator=(IdleSocket&&);
+    ~IdleSocket();
+
+    std::unique_ptr<StreamSocket> socket;
+    base::TimeTicks since;
+  };
+
+  struct Proxy {
+    Proxy();
+    ~Proxy();
+
+    // Of the last tunnel taking a connection, to connect more like it.
+    scoped_refptr<SOCKSSocketParams> params;
+    raw_ptr<const CommonConnectJobParams> common_connect_job_params = nullptr;
+    std::vector<std::unique_ptr<ConnectJob>> jobs;
+    // Connected, waiting for the reply to their greeting.
+    std::vector<std::unique_ptr<SOCKS5ClientSocket>> greetings;
+    base::circular_deque<IdleSocket> idle;
+  };
+
+  void TopUp(Proxy& proxy);
+  void OnJobComplete(Proxy& proxy, ConnectJob* job, int result);
+  void Greet(Proxy& proxy, std::unique_ptr<StreamSocket> socket);
+  void OnGreetComplete(const HostPortPair& server,
+                       SOCKS5ClientSocket* greeting,
+                       int result);
+
+  const size_t size_;
+  std::map<HostPortPair, Proxy> proxies_;
+};
+
+}  // namespace net
+#endif  // NET_SOCKET_SOCKS5_WARM_POOL_H_
@@ -15,6 +15,7 @@
 #include "net/socket/client_socket_handle.h"
 #include "net/socket/connect_job_params.h"
 #include "net/socket/socks5_client_socket.h"
+#include "net/socket/socks5_warm_pool.h"
 #include "net/socket/socks_client_socket.h"
 #include "net/socket/transport_connect_job.h"
 
@@ -23,6 +24,10 @@ namespace net {
 // SOCKSConnectJobs will time out if the SOCKS handshake takes longer than this.
 static constexpr base::TimeDelta kSOCKSConnectJobTimeout = base::Seconds(30);
 
+namespace {
+bool g_pipelined = false;
+}  // namespace
+
 SOCKSSocketParams::SOCKSSocketParams(
     ConnectJobParams nested_params,
     bool socks_v5,
@@ -77,7 +82,8 @@ LoadState SOCKSConnectJob::GetLoadState() const {
     case STATE_TRANSPORT_CONNECT:
       return LOAD_STATE_IDLE;
     case STATE_TRANSPORT_CONNECT_COMPLETE:
-      return transport_connect_job_->GetLoadState();
+      return transport_connect_job_ ? transport_connect_job_->GetLoadState()
+                                    : LOAD_STATE_CONNECTING;
     case STATE_SOCKS_CONNECT:
     case STATE_SOCKS_CONNECT_COMPLETE:
       return LOAD_STATE_CONNECTING;
@@ -100,6 +106,10 @@ base::TimeDelta SOCKSConnectJob::HandshakeTimeoutForTesting() {
   return kSOCKSConnectJobTimeout;
 }
 
+void SOCKSConnectJob::SetPipelined(bool pipelined) {
+  g_pipelined = pipelined;
+}
+
 void SOCKSConnectJob::OnIOComplete(int result) {
   int rv = DoLoop(result);
   if (rv != ERR_IO_PENDING)
@@ -156,6 +166,17 @@ int SOCKSConnectJob::DoLoop(int result) {
 int SOCKSConnectJob::DoTransportConnect() {
   DCHECK(!transport_connect_job_);
 
+  if (socks_params_->is_socks_v5() &&
+      common_connect_job_params()->socks5_warm_pool) {
+    greeted_socket_ = common_connect_job_params()->socks5_warm_pool->Take(
+        socks_params_, common_connect_job_params());
+    if (greeted_socket_) {
+      ResetTimer(kSOCKSConnectJobTimeout);
+      next_state_ = STATE_SOCKS_CONNECT;
+      return OK;
+    }
+  }
+
   next_state_ = STATE_TRANSPORT_CONNECT_COMPLETE;
   transport_connect_job_ = std::make_unique<TransportConnectJob>(
       priority(), socket_tag(), common_connect_job_params(),
@@ -179,9 +200,16 @@ int SOCKSConnectJob::DoSOCKSConnect() {
 
   // Add a SOCKS connection on top of the tcp socket.
   if (socks_params_->is_socks_v5()) {
-    socket_ = std::make_unique<SOCKS5ClientSocket>(
-        transport_connect_job_->PassSocket(), socks_params_->destination(),
-        socks_params_->traffic_annotation());
+    bool greeted = !!greeted_socket_;
+    auto socks5_socket = std::make_unique<SOCKS5ClientSocket>(
+        greeted ? std::move(greeted_socket_)
+                : transport_connect_job_->PassSocket(),
+        socks_params_->destination(), socks_params_->traffic_annotation());
+    if (greeted)
+      socks5_socket->set_greeted();
+    else
+      socks5_socket->set_pipelined(g_pipelined);
+    socket_ = std::move(socks5_socket);
   } else {
     auto socks_socket = std::make_unique<SOCKSClientSocket>(
         transport_connect_job_->PassSocket(), socks_params_->destination(),
@@ -105,6 +105,10 @@ class NET_EXPORT_PRIVATE SOCKSConnectJob : public ConnectJob,
   // Returns the handshake timeout used by SOCKSConnectJobs.
   static base::TimeDelta HandshakeTimeoutForTesting();
 
+  // Sends SOCKS5 CONNECT requests along with the greeting, see
+  // SOCKS5ClientSocket::set_pipelined(). Must be called before any job starts.
+  static void SetPipelined(bool pipelined);
+
  private:
   enum State {
     STATE_TRANSPORT_CONNECT,
@@ -142,6 +146,8 @@ class NET_EXPORT_PRIVATE SOCKSConnectJob : public ConnectJob,
 
   State next_state_;
   std::unique_ptr<ConnectJob> transport_connect_job_;
+  // Already greeted by the SOCKS5WarmPool, instead of a transport connection.
+  std::unique_ptr<StreamSocket> greeted_socket_;
   std::unique_ptr<StreamSocket> socket_;
   raw_ptr<SOCKSClientSocket> socks_socket_ptr_;
 
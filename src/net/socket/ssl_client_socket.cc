@@ -72,6 +72,21 @@ void SSLClientSocket::SetSSLKeyLogger(std::unique_ptr<SSLKeyLogger> logger) {
   SSLClientSocketImpl::SetSSLKeyLogger(std::move(logger));
 }
 
+// static
+void SSLClientSocket::SetKernelTlsEnabled(bool enabled) {
+  SSLClientSocketImpl::SetKernelTlsEnabled(enabled);
+}
+
+// static
+void SSLClientSocket::SetParallelSealingEnabled(bool enabled) {
+  SSLClientSocketImpl::SetParallelSealingEnabled(enabled);
+}
+
+// static
+void SSLClientSocket::SetDynamicRecordSizing(bool enabled) {
+  SSLClientSocketImpl::SetDynamicRecordSizing(enabled);
+}
+
 // static
 std::vector<uint8_t> SSLClientSocket::SerializeNextProtos(
     const NextProtoVector& next_protos) {
@@ -56,6 +56,27 @@ class NET_EXPORT SSLClientSocket : public SSLSocket {
   // once https://crbug.com/458365 is resolved.
   static void SetSSLKeyLogger(std::unique_ptr<SSLKeyLogger> logger);
 
+  // On Linux, hands the encryption of the records sent on TLS 1.3
+  // connections over TCP to the kernel (kTLS) after the handshake, which
+  // BoringSSL still performs. Received records are still decrypted by
+  // BoringSSL. Connections the kernel cannot take are not affected.
+  static void SetKernelTlsEnabled(bool enabled);
+
+  // Encrypts the records sent on TLS 1.3 connections after the handshake
+  // with a SSLRecordSealer, which seals the records of consecutive writes on
+  // the thread pool in parallel and writes them in order, instead of in
+  // BoringSSL on the socket's thread. Where the kernel encrypts them with
+  // SetKernelTlsEnabled(), it is preferred. Received records are still
+  // decrypted by BoringSSL.
+  static void SetParallelSealingEnabled(bool enabled);
+
+  // Sends the data written after the handshake in records of about a TCP
+  // segment after a second without writes, so the first bytes can be
+  // decrypted as their segment arrives, doubling the size every 16 records
+  // up to the full 16 KB for bulk transfer. Handshake records are unchanged.
+  // Not applied to writes encrypted by the kernel.
+  static void SetDynamicRecordSizing(bool enabled);
+
  protected:
   void set_signed_cert_timestamps_received(
       bool signed_cert_timestamps_received) {
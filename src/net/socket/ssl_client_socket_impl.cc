@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <map>
 #include <memory>
@@ -59,13 +60,29 @@
 #include "net/ssl/ssl_key_logger.h"
 #include "net/ssl/ssl_private_key.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
+#include "third_party/boringssl/src/include/openssl/aead.h"
 #include "third_party/boringssl/src/include/openssl/bio.h"
 #include "third_party/boringssl/src/include/openssl/bytestring.h"
 #include "third_party/boringssl/src/include/openssl/err.h"
 #include "third_party/boringssl/src/include/openssl/evp.h"
+#include "third_party/boringssl/src/include/openssl/hkdf.h"
 #include "third_party/boringssl/src/include/openssl/mem.h"
 #include "third_party/boringssl/src/include/openssl/ssl.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif  // BUILDFLAG(IS_LINUX)
+
 namespace net {
 
 namespace {
@@ -154,6 +171,168 @@ bool HostIsIPAddressNoBrackets(std::string_view host) {
   return unused.AssignFromIPLiteral(host);
 }
 
+// HKDF-Expand-Label of RFC 8446, section 7.1, with an empty context.
+bool ExpandTrafficKey(const EVP_MD* digest,
+                      bssl::Span<const uint8_t> secret,
+                      std::string_view label,
+                      uint8_t* out,
+                      size_t out_len) {
+  static constexpr std::string_view kLabelPrefix = "tls13 ";
+  bssl::ScopedCBB cbb;
+  CBB child;
+  uint8_t* info;
+  size_t info_len;
+  if (!CBB_init(cbb.get(), 2 + 1 + kLabelPrefix.size() + label.size() + 1) ||
+      !CBB_add_u16(cbb.get(), out_len) ||
+      !CBB_add_u8_length_prefixed(cbb.get(), &child) ||
+      !CBB_add_bytes(&child,
+                     reinterpret_cast<const uint8_t*>(kLabelPrefix.data()),
+                     kLabelPrefix.size()) ||
+      !CBB_add_bytes(&child, reinterpret_cast<const uint8_t*>(label.data()),
+                     label.size()) ||
+      !CBB_add_u8(cbb.get(), 0) ||
+      !CBB_finish(cbb.get(), &info, &info_len)) {
+    return false;
+  }
+  bssl::UniquePtr<uint8_t> free_info(info);
+  return HKDF_expand(out, out_len, digest, secret.data(), secret.size(), info,
+                     info_len);
+}
+
+std::atomic<bool> g_parallel_sealing_enabled{false};
+
+// Returns nullptr if the write keys of the TLS 1.3 `cipher` cannot be used.
+std::unique_ptr<SSLRecordSealer> CreateRecordSealer(
+    const SSL_CIPHER* cipher,
+    bssl::Span<const uint8_t> secret,
+    uint64_t sequence,
+    StreamSocket* transport) {
+  const EVP_AEAD* aead;
+  switch (SSL_CIPHER_get_id(cipher)) {
+    case TLS1_3_CK_AES_128_GCM_SHA256:
+      aead = EVP_aead_aes_128_gcm();
+      break;
+    case TLS1_3_CK_AES_256_GCM_SHA384:
+      aead = EVP_aead_aes_256_gcm();
+      break;
+    case TLS1_3_CK_CHACHA20_POLY1305_SHA256:
+      aead = EVP_aead_chacha20_poly1305();
+      break;
+    default:
+      return nullptr;
+  }
+  const EVP_MD* digest = SSL_CIPHER_get_handshake_digest(cipher);
+  uint8_t key[EVP_AEAD_MAX_KEY_LENGTH];
+  uint8_t iv[SSLRecordSealer::kIvSize];
+  size_t key_len = EVP_AEAD_key_length(aead);
+  std::unique_ptr<SSLRecordSealer> sealer;
+  if (ExpandTrafficKey(digest, secret, "key", key, key_len) &&
+      ExpandTrafficKey(digest, secret, "iv", iv, sizeof(iv))) {
+    sealer = SSLRecordSealer::Create(
+        aead, bssl::Span<const uint8_t>(key, key_len), iv, sequence, transport);
+  }
+  OPENSSL_cleanse(key, sizeof(key));
+  OPENSSL_cleanse(iv, sizeof(iv));
+  return sealer;
+}
+
+#if BUILDFLAG(IS_LINUX)
+std::atomic<bool> g_kernel_tls_enabled{false};
+std::atomic<bool> g_kernel_tls_warned{false};
+
+// Fills |info|, one of the tls12_crypto_info_* structs, with the keys of the
+// write side of a TLS 1.3 connection, whose next record is |sequence|.
+template <typename CryptoInfo>
+bool FillCryptoInfo(CryptoInfo* info,
+                    uint16_t cipher_type,
+                    const EVP_MD* digest,
+                    bssl::Span<const uint8_t> secret,
+                    uint64_t sequence) {
+  // The kernel splits the nonce of RFC 8446 into a fixed salt and the IV.
+  uint8_t iv[sizeof(info->salt) + sizeof(info->iv)];
+  static_assert(sizeof(iv) == 12);
+  info->info.version = TLS_1_3_VERSION;
+  info->info.cipher_type = cipher_type;
+  if (!ExpandTrafficKey(digest, secret, "key", info->key, sizeof(info->key)) ||
+      !ExpandTrafficKey(digest, secret, "iv", iv, sizeof(iv))) {
+    return false;
+  }
+  memcpy(info->salt, iv, sizeof(info->salt));
+  memcpy(info->iv, iv + sizeof(info->salt), sizeof(info->iv));
+  OPENSSL_cleanse(iv, sizeof(iv));
+  for (size_t i = 0; i < sizeof(info->rec_seq); ++i) {
+    info->rec_seq[i] = sequence >> (8 * (sizeof(info->rec_seq) - 1 - i));
+  }
+  return true;
+}
+
+// Installs the write keys of the TLS 1.3 `cipher` on `fd`, returning whether
+// the kernel encrypts the records written from then on.
+bool EnableKernelTls(SocketDescriptor fd,
+                     const SSL_CIPHER* cipher,
+                     bssl::Span<const uint8_t> secret,
+                     uint64_t sequence) {
+  if (fd == kInvalidSocket)
+    return false;
+  const EVP_MD* digest = SSL_CIPHER_get_handshake_digest(cipher);
+  union {
+    tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+    tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+#if defined(TLS_CIPHER_CHACHA20_POLY1305)
+    tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+#endif
+  } info = {};
+  size_t info_size = 0;
+  bool filled = false;
+  switch (SSL_CIPHER_get_id(cipher)) {
+    case TLS1_3_CK_AES_128_GCM_SHA256:
+      filled = FillCryptoInfo(&info.aes_gcm_128, TLS_CIPHER_AES_GCM_128,
+                              digest, secret, sequence);
+      info_size = sizeof(info.aes_gcm_128);
+      break;
+    case TLS1_3_CK_AES_256_GCM_SHA384:
+      filled = FillCryptoInfo(&info.aes_gcm_256, TLS_CIPHER_AES_GCM_256,
+                              digest, secret, sequence);
+      info_size = sizeof(info.aes_gcm_256);
+      break;
+#if defined(TLS_CIPHER_CHACHA20_POLY1305)
+    case TLS1_3_CK_CHACHA20_POLY1305_SHA256:
+      filled = FillCryptoInfo(&info.chacha20_poly1305,
+                              TLS_CIPHER_CHACHA20_POLY1305, digest, secret,
+                              sequence);
+      info_size = sizeof(info.chacha20_poly1305);
+      break;
+#endif
+    default:
+      return false;
+  }
+
+  // Without the keys, the "tls" upper layer passes data through as before.
+  bool installed =
+      filled &&
+      setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+      setsockopt(fd, SOL_TLS, TLS_TX, &info, info_size) == 0;
+  int os_error = errno;
+  OPENSSL_cleanse(&info, sizeof(info));
+  if (!installed &&
+      !g_kernel_tls_warned.exchange(true, std::memory_order_relaxed)) {
+    LOG(WARNING) << "Cannot enable kTLS: "
+                 << (filled ? strerror(os_error) : "key derivation failed");
+  }
+  return installed;
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
+std::atomic<bool> g_dynamic_record_sizing{false};
+
+// Of the records sent after idle, so each fits a segment: an MSS of 1440
+// bytes over IPv6 less TCP timestamps and the TLS 1.3 record overhead.
+constexpr size_t kSmallRecordSize = 1400;
+// Records sent at a size until the next write doubles it.
+constexpr size_t kRecordsPerRecordSize = 16;
+// A window this idle may have collapsed, so records start small again.
+constexpr base::TimeDelta kRecordSizeIdleTimeout = base::Seconds(1);
+
 }  // namespace
 
 class SSLClientSocketImpl::SSLContext {
@@ -297,6 +476,23 @@ void SSLClientSocketImpl::SetSSLKeyLogger(
   SSLContext::GetInstance()->SetSSLKeyLogger(std::move(logger));
 }
 
+// static
+void SSLClientSocketImpl::SetKernelTlsEnabled(bool enabled) {
+#if BUILDFLAG(IS_LINUX)
+  g_kernel_tls_enabled.store(enabled, std::memory_order_relaxed);
+#endif
+}
+
+// static
+void SSLClientSocketImpl::SetParallelSealingEnabled(bool enabled) {
+  g_parallel_sealing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+// static
+void SSLClientSocketImpl::SetDynamicRecordSizing(bool enabled) {
+  g_dynamic_record_sizing.store(enabled, std::memory_order_relaxed);
+}
+
 std::vector<uint8_t> SSLClientSocketImpl::GetECHRetryConfigs() {
   const uint8_t* retry_configs;
   size_t retry_configs_len;
@@ -364,6 +560,7 @@ void SSLClientSocketImpl::Disconnect() {
   cert_verifier_request_.reset();
   weak_factory_.InvalidateWeakPtrs();
   transport_adapter_.reset();
+  record_sealer_.reset();
 
   // Release user callbacks.
   user_connect_callback_.Reset();
@@ -509,6 +706,10 @@ int64_t SSLClientSocketImpl::GetTotalReceivedBytes() const {
   return stream_socket_->GetTotalReceivedBytes();
 }
 
+SocketDescriptor SSLClientSocketImpl::GetTransportSocketDescriptor() const {
+  return stream_socket_->GetTransportSocketDescriptor();
+}
+
 void SSLClientSocketImpl::GetSSLCertRequestInfo(
     SSLCertRequestInfo* cert_request_info) const {
   if (!ssl_) {
@@ -586,9 +787,43 @@ int SSLClientSocketImpl::Write(
     int buf_len,
     CompletionOnceCallback callback,
     const NetworkTrafficAnnotationTag& traffic_annotation) {
+  if (!write_offload_decided_)
+    MaybeOffloadWrites();
+  if (kernel_tls_tx_) {
+    // The kernel frames and encrypts the plaintext.
+    was_ever_used_ = true;
+    return stream_socket_->Write(buf, buf_len, std::move(callback),
+                                 traffic_annotation);
+  }
+  if (record_sealer_) {
+    size_t record_size = SSL3_RT_MAX_PLAIN_LENGTH;
+    if (g_dynamic_record_sizing.load(std::memory_order_relaxed)) {
+      UpdateRecordSize();
+      record_size = record_size_;
+    }
+    int rv = record_sealer_->Write(
+        buf, buf_len, record_size,
+        base::BindOnce(&SSLClientSocketImpl::OnSealerWriteComplete,
+                       weak_factory_.GetWeakPtr()),
+        traffic_annotation);
+    if (rv == ERR_IO_PENDING) {
+      user_write_callback_ = std::move(callback);
+    } else if (rv > 0) {
+      record_size_bytes_ += rv;
+      was_ever_used_ = true;
+    }
+    return rv;
+  }
+
   user_write_buf_ = buf;
   user_write_buf_len_ = buf_len;
 
+  // Records of the handshake and of early data keep BoringSSL's sizes.
+  if (g_dynamic_record_sizing.load(std::memory_order_relaxed) &&
+      SSL_is_init_finished(ssl_.get())) {
+    UpdateRecordSize();
+  }
+
   int rv = DoPayloadWrite();
 
   if (rv == ERR_IO_PENDING) {
@@ -605,6 +840,75 @@ int SSLClientSocketImpl::Write(
   return rv;
 }
 
+void SSLClientSocketImpl::UpdateRecordSize() {
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (record_size_ == 0 || now - last_write_time_ > kRecordSizeIdleTimeout) {
+    record_size_ = kSmallRecordSize;
+    record_size_bytes_ = 0;
+  } else if (record_size_ < SSL3_RT_MAX_PLAIN_LENGTH &&
+             record_size_bytes_ >= kRecordsPerRecordSize * record_size_) {
+    record_size_ = std::min(record_size_ * 2, size_t{SSL3_RT_MAX_PLAIN_LENGTH});
+    record_size_bytes_ = 0;
+  }
+  last_write_time_ = now;
+  SSL_set_max_send_fragment(ssl_.get(), record_size_);
+}
+
+void SSLClientSocketImpl::MaybeOffloadWrites() {
+  bool kernel_tls = false;
+#if BUILDFLAG(IS_LINUX)
+  kernel_tls = g_kernel_tls_enabled.load(std::memory_order_relaxed);
+#endif
+  bool parallel_sealing =
+      g_parallel_sealing_enabled.load(std::memory_order_relaxed);
+  if (!kernel_tls && !parallel_sealing) {
+    write_offload_decided_ = true;
+    return;
+  }
+  // Decides once the handshake is confirmed and its last flight sent, as the
+  // records written from then on continue right after those BoringSSL wrote.
+  if (!completed_connect_ || SSL_in_init(ssl_.get()) ||
+      SSL_in_early_data(ssl_.get()) ||
+      transport_adapter_->HasPendingWriteData()) {
+    return;
+  }
+  write_offload_decided_ = true;
+
+  if (SSL_version(ssl_.get()) != TLS1_3_VERSION)
+    return;
+  bssl::Span<const uint8_t> read_secret;
+  bssl::Span<const uint8_t> write_secret;
+  if (!SSL_get_traffic_secrets(ssl_.get(), &read_secret, &write_secret))
+    return;
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl_.get());
+  uint64_t sequence = SSL_get_write_sequence(ssl_.get());
+
+#if BUILDFLAG(IS_LINUX)
+  if (kernel_tls) {
+    kernel_tls_tx_ =
+        EnableKernelTls(stream_socket_->GetKernelSocketDescriptor(), cipher,
+                        write_secret, sequence);
+  }
+#endif
+  if (!kernel_tls_tx_ && parallel_sealing) {
+    record_sealer_ = CreateRecordSealer(cipher, write_secret, sequence,
+                                        stream_socket_.get());
+  }
+  if (kernel_tls_tx_ || record_sealer_) {
+    // Records BoringSSL would write itself from now on, like a KeyUpdate
+    // requested by the server, would be out of sequence.
+    transport_adapter_->FailWrites(ERR_SSL_PROTOCOL_ERROR);
+  }
+}
+
+void SSLClientSocketImpl::OnSealerWriteComplete(int result) {
+  if (result > 0) {
+    record_size_bytes_ += result;
+    was_ever_used_ = true;
+  }
+  std::move(user_write_callback_).Run(result);
+}
+
 int SSLClientSocketImpl::SetReceiveBufferSize(int32_t size) {
   return stream_socket_->SetReceiveBufferSize(size);
 }
@@ -1351,6 +1655,7 @@ int SSLClientSocketImpl::DoPayloadWrite() {
 
   if (rv >= 0) {
     CHECK_LE(rv, user_write_buf_len_);
+    record_size_bytes_ += rv;
     net_log_.AddByteTransferEvent(NetLogEventType::SSL_SOCKET_BYTES_SENT, rv,
                                   user_write_buf_->data());
     if (first_post_handshake_write_ && SSL_is_init_finished(ssl_.get())) {
@@ -19,6 +19,7 @@
 #include "base/memory/raw_ptr.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/host_port_pair.h"
 #include "net/base/io_buffer.h"
@@ -28,6 +29,7 @@
 #include "net/socket/next_proto.h"
 #include "net/socket/socket_bio_adapter.h"
 #include "net/socket/ssl_client_socket.h"
+#include "net/socket/ssl_record_sealer.h"
 #include "net/socket/stream_socket.h"
 #include "net/ssl/openssl_ssl_util.h"
 #include "net/ssl/ssl_client_session_cache.h"
@@ -71,6 +73,15 @@ class SSLClientSocketImpl : public SSLClientSocket,
   // SSLClientSockets are created.
   static void SetSSLKeyLogger(std::unique_ptr<SSLKeyLogger> logger);
 
+  // See SSLClientSocket::SetKernelTlsEnabled().
+  static void SetKernelTlsEnabled(bool enabled);
+
+  // See SSLClientSocket::SetParallelSealingEnabled().
+  static void SetParallelSealingEnabled(bool enabled);
+
+  // See SSLClientSocket::SetDynamicRecordSizing().
+  static void SetDynamicRecordSizing(bool enabled);
+
   // SSLClientSocket implementation.
   std::vector<uint8_t> GetECHRetryConfigs() override;
 
@@ -95,6 +106,7 @@ class SSLClientSocketImpl : public SSLClientSocket,
   std::optional<std::string_view> GetPeerApplicationSettings() const override;
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
+  SocketDescriptor GetTransportSocketDescriptor() const override;
   void GetSSLCertRequestInfo(
       SSLCertRequestInfo* cert_request_info) const override;
 
@@ -139,6 +151,13 @@ class SSLClientSocketImpl : public SSLClientSocket,
   int DoHandshakeLoop(int last_io_result);
   int DoPayloadRead(IOBuffer* buf, int buf_len);
   int DoPayloadWrite();
+  // Hands the write keys to the kernel or to a SSLRecordSealer once the
+  // handshake is confirmed and its records were written.
+  void MaybeOffloadWrites();
+  void OnSealerWriteComplete(int result);
+  // Picks the size of the records of the next write, see
+  // SSLClientSocket::SetDynamicRecordSizing().
+  void UpdateRecordSize();
   void DoPeek();
 
   // Called when an asynchronous event completes which may have blocked the
@@ -224,6 +243,12 @@ class SSLClientSocketImpl : public SSLClientSocket,
   int user_write_buf_len_;
   bool first_post_handshake_write_ = true;
 
+  // Of UpdateRecordSize(): the record size, 0 until the first write after
+  // the handshake, the bytes written at it, and when the last write began.
+  size_t record_size_ = 0;
+  size_t record_size_bytes_ = 0;
+  base::TimeTicks last_write_time_;
+
   // True if we've already handled the result of our attempt to use early data.
   bool handled_early_data_result_ = false;
 
@@ -251,6 +276,12 @@ class SSLClientSocketImpl : public SSLClientSocket,
   // network.
   bool was_ever_used_ = false;
 
+  // Whether MaybeOffloadWrites() decided, and if the kernel or
+  // `record_sealer_` encrypts the records written, so Write() bypasses
+  // BoringSSL.
+  bool write_offload_decided_ = false;
+  bool kernel_tls_tx_ = false;
+
   const raw_ptr<SSLClientContext> context_;
 
   std::unique_ptr<CertVerifier::Request> cert_verifier_request_;
@@ -263,6 +294,8 @@ class SSLClientSocketImpl : public SSLClientSocket,
 
   std::unique_ptr<StreamSocket> stream_socket_;
   std::unique_ptr<SocketBIOAdapter> transport_adapter_;
+  // Writes to `stream_socket_`, so it is destroyed first.
+  std::unique_ptr<SSLRecordSealer> record_sealer_;
   const HostPortPair host_and_port_;
   SSLConfig ssl_config_;
 
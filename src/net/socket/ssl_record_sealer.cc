@@ -0,0 +1,256 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/socket/ssl_record_sealer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/memory/ptr_util.h"
+#include "base/memory/ref_counted.h"
+#include "base/task/thread_pool.h"
+#include "net/socket/stream_socket.h"
+#include "third_party/boringssl/src/include/openssl/aead.h"
+#include "third_party/boringssl/src/include/openssl/mem.h"
+
+namespace net {
+
+namespace {
+// Of RFC 8446, section 5.2: a TLSCiphertext header, and the content type
+// ending the TLSInnerPlaintext.
+constexpr size_t kHeaderSize = 5;
+constexpr uint8_t kApplicationData = 23;
+constexpr size_t kTagSize = 16;
+constexpr size_t kRecordOverhead = kHeaderSize + 1 + kTagSize;
+}  // namespace
+
+// Seals on any thread, as EVP_AEAD_CTX_seal() does not change the context.
+class SSLRecordSealer::Key : public base::RefCountedThreadSafe<Key> {
+ public:
+  Key() = default;
+  Key(const Key&) = delete;
+  Key& operator=(const Key&) = delete;
+
+  bool Init(const EVP_AEAD* aead,
+            bssl::Span<const uint8_t> key,
+            bssl::Span<const uint8_t> iv) {
+    if (iv.size() != kIvSize || EVP_AEAD_nonce_length(aead) != kIvSize ||
+        EVP_AEAD_max_overhead(aead) != kTagSize) {
+      return false;
+    }
+    memcpy(iv_, iv.data(), kIvSize);
+    return EVP_AEAD_CTX_init(ctx_.get(), aead, key.data(), key.size(),
+                             kTagSize, nullptr);
+  }
+
+  // Seals the TLSInnerPlaintext at `record` + kHeaderSize in place, and
+  // writes the header before it.
+  bool Seal(uint8_t* record, size_t plaintext_size, uint64_t sequence) const {
+    size_t inner_size = plaintext_size + 1;
+    size_t ciphertext_size = inner_size + kTagSize;
+    record[0] = kApplicationData;
+    record[1] = 0x03;
+    record[2] = 0x03;
+    record[3] = ciphertext_size >> 8;
+    record[4] = ciphertext_size & 0xff;
+    record[kHeaderSize + plaintext_size] = kApplicationData;
+
+    uint8_t nonce[kIvSize];
+    memcpy(nonce, iv_, kIvSize);
+    for (size_t i = 0; i < 8; ++i) {
+      nonce[kIvSize - 1 - i] ^= static_cast<uint8_t>(sequence >> (8 * i));
+    }
+    uint8_t* inner = record + kHeaderSize;
+    size_t out_size;
+    return EVP_AEAD_CTX_seal(ctx_.get(), inner, &out_size, ciphertext_size,
+                             nonce, kIvSize, inner, inner_size, record,
+                             kHeaderSize) &&
+           out_size == ciphertext_size;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<Key>;
+  ~Key() { OPENSSL_cleanse(iv_, sizeof(iv_)); }
+
+  bssl::ScopedEVP_AEAD_CTX ctx_;
+  uint8_t iv_[kIvSize];
+};
+
+struct SSLRecordSealer::Batch : public base::RefCountedThreadSafe<Batch> {
+  // The records, each laid out with its plaintext where its ciphertext goes.
+  scoped_refptr<IOBufferWithSize> data;
+  size_t plaintext_size = 0;
+  size_t record_size = 0;
+  // Of the first record.
+  uint64_t sequence = 0;
+  bool sealed = false;
+
+ private:
+  friend class base::RefCountedThreadSafe<Batch>;
+  ~Batch() = default;
+};
+
+// static
+bool SSLRecordSealer::SealBatch(scoped_refptr<const Key> key,
+                                scoped_refptr<Batch> batch) {
+  uint8_t* record = batch->data->bytes();
+  uint64_t sequence = batch->sequence;
+  for (size_t offset = 0; offset < batch->plaintext_size;
+       offset += batch->record_size) {
+    size_t size = std::min(batch->record_size, batch->plaintext_size - offset);
+    if (!key->Seal(record, size, sequence++))
+      return false;
+    record += size + kRecordOverhead;
+  }
+  return true;
+}
+
+// static
+std::unique_ptr<SSLRecordSealer> SSLRecordSealer::Create(
+    const EVP_AEAD* aead,
+    bssl::Span<const uint8_t> key,
+    bssl::Span<const uint8_t> iv,
+    uint64_t sequence,
+    StreamSocket* transport) {
+  auto sealer_key = base::MakeRefCounted<Key>();
+  if (!sealer_key->Init(aead, key, iv))
+    return nullptr;
+  return base::WrapUnique(
+      new SSLRecordSealer(std::move(sealer_key), sequence, transport));
+}
+
+SSLRecordSealer::SSLRecordSealer(scoped_refptr<const Key> key,
+                                 uint64_t sequence,
+                                 StreamSocket* transport)
+    : key_(std::move(key)), sequence_(sequence), transport_(transport) {}
+
+SSLRecordSealer::~SSLRecordSealer() = default;
+
+int SSLRecordSealer::Write(
+    IOBuffer* buf,
+    int buf_len,
+    size_t record_size,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  DCHECK(!user_write_callback_);
+  DCHECK_GT(buf_len, 0);
+  DCHECK_GT(record_size, 0u);
+  if (error_ != OK)
+    return error_;
+  traffic_annotation_ = MutableNetworkTrafficAnnotationTag(traffic_annotation);
+  if (pending_bytes_ >= kMaxPendingBytes) {
+    user_write_buf_ = buf;
+    user_write_buf_len_ = buf_len;
+    user_record_size_ = record_size;
+    user_write_callback_ = std::move(callback);
+    return ERR_IO_PENDING;
+  }
+  return StartSealing(buf, buf_len, record_size);
+}
+
+int SSLRecordSealer::StartSealing(IOBuffer* buf,
+                                  int buf_len,
+                                  size_t record_size) {
+  size_t size = std::min(static_cast<size_t>(buf_len), kMaxBatchSize);
+  size_t records = (size + record_size - 1) / record_size;
+  auto batch = base::MakeRefCounted<Batch>();
+  batch->data =
+      base::MakeRefCounted<IOBufferWithSize>(size + records * kRecordOverhead);
+  batch->plaintext_size = size;
+  batch->record_size = record_size;
+  batch->sequence = sequence_;
+  uint8_t* record = batch->data->bytes();
+  for (size_t offset = 0; offset < size; offset += record_size) {
+    size_t record_plaintext = std::min(record_size, size - offset);
+    memcpy(record + kHeaderSize, buf->bytes() + offset, record_plaintext);
+    record += record_plaintext + kRecordOverhead;
+  }
+  sequence_ += records;
+  pending_bytes_ += size;
+  batches_.push_back(batch);
+
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE,
+      {base::TaskPriority::USER_BLOCKING,
+       base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+      base::BindOnce(&SealBatch, key_, batch),
+      base::BindOnce(&SSLRecordSealer::OnSealed, weak_factory_.GetWeakPtr(),
+                     batch));
+  return static_cast<int>(size);
+}
+
+void SSLRecordSealer::OnSealed(scoped_refptr<Batch> batch, bool ok) {
+  if (!ok) {
+    // Records after it would be out of sequence.
+    error_ = ERR_SSL_PROTOCOL_ERROR;
+  } else {
+    batch->sealed = true;
+    WriteSealed();
+  }
+  MaybeRunUserWriteCallback();
+}
+
+void SSLRecordSealer::WriteSealed() {
+  while (error_ == OK && !transport_write_pending_ && !batches_.empty() &&
+         batches_.front()->sealed) {
+    if (!transport_buf_) {
+      const Batch& batch = *batches_.front();
+      transport_buf_ = base::MakeRefCounted<DrainableIOBuffer>(
+          batch.data, batch.data->size());
+    }
+    int rv = transport_->Write(
+        transport_buf_.get(), transport_buf_->BytesRemaining(),
+        base::BindOnce(&SSLRecordSealer::OnTransportWriteComplete,
+                       weak_factory_.GetWeakPtr()),
+        NetworkTrafficAnnotationTag(traffic_annotation_));
+    if (rv == ERR_IO_PENDING) {
+      transport_write_pending_ = true;
+      return;
+    }
+    DidTransportWrite(rv);
+  }
+}
+
+void SSLRecordSealer::OnTransportWriteComplete(int rv) {
+  transport_write_pending_ = false;
+  DidTransportWrite(rv);
+  WriteSealed();
+  MaybeRunUserWriteCallback();
+}
+
+void SSLRecordSealer::DidTransportWrite(int rv) {
+  DCHECK_NE(rv, ERR_IO_PENDING);
+  if (rv < 0) {
+    error_ = rv;
+    return;
+  }
+  transport_buf_->DidConsume(rv);
+  if (transport_buf_->BytesRemaining() > 0)
+    return;
+  transport_buf_ = nullptr;
+  pending_bytes_ -= batches_.front()->plaintext_size;
+  batches_.pop_front();
+}
+
+void SSLRecordSealer::MaybeRunUserWriteCallback() {
+  if (!user_write_callback_)
+    return;
+  int rv;
+  if (error_ != OK) {
+    rv = error_;
+  } else if (pending_bytes_ < kMaxPendingBytes) {
+    rv = StartSealing(user_write_buf_.get(), user_write_buf_len_,
+                      user_record_size_);
+  } else {
+    return;
+  }
+  user_write_buf_ = nullptr;
+  user_write_buf_len_ = 0;
+  std::move(user_write_callback_).Run(rv);
+}
+
+}  // namespace net
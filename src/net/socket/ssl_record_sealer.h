@@ -0,0 +1,116 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_SOCKET_SSL_RECORD_SEALER_H_
+#define NET_SOCKET_SSL_RECORD_SEALER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "base/containers/circular_deque.h"
+#include "base/containers/span.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_export.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "third_party/boringssl/src/include/openssl/base.h"
+
+namespace net {
+
+class StreamSocket;
+
+// Frames and encrypts the application data sent on a TLS 1.3 connection
+// after its handshake, in place of BoringSSL, like the kernel does with
+// kTLS. The records of each write are sealed as a batch on the thread pool,
+// so the batches of consecutive writes are sealed on several cores at once,
+// and written to the transport in order as they are done. Records are
+// numbered when their write is accepted, so ordering does not depend on
+// which batch is sealed first.
+//
+// A write is accepted as soon as its plaintext is copied, until
+// kMaxPendingBytes are being sealed or were sealed and not yet written,
+// after which it waits for the transport like a full socket buffer.
+class NET_EXPORT_PRIVATE SSLRecordSealer {
+ public:
+  // Plaintext of a write taken at once, the rest is left to the next write.
+  static constexpr size_t kMaxBatchSize = 64 * 1024;
+  static constexpr size_t kMaxPendingBytes = 256 * 1024;
+
+  // Of the per-record nonce of RFC 8446, section 5.3.
+  static constexpr size_t kIvSize = 12;
+
+  // Returns nullptr if `key` does not fit `aead`. `key` and `iv` are the
+  // traffic keys of the write side, and `sequence` the number of the next
+  // record. `transport` must outlive the sealer.
+  static std::unique_ptr<SSLRecordSealer> Create(
+      const EVP_AEAD* aead,
+      bssl::Span<const uint8_t> key,
+      bssl::Span<const uint8_t> iv,
+      uint64_t sequence,
+      StreamSocket* transport);
+
+  SSLRecordSealer(const SSLRecordSealer&) = delete;
+  SSLRecordSealer& operator=(const SSLRecordSealer&) = delete;
+  ~SSLRecordSealer();
+
+  // Like StreamSocket::Write(), in records of up to `record_size` bytes.
+  // Returns the bytes accepted, or the error that failed a previous write.
+  int Write(IOBuffer* buf,
+            int buf_len,
+            size_t record_size,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation);
+
+ private:
+  class Key;
+  struct Batch;
+
+  SSLRecordSealer(scoped_refptr<const Key> key,
+                  uint64_t sequence,
+                  StreamSocket* transport);
+
+  // Runs on the thread pool.
+  static bool SealBatch(scoped_refptr<const Key> key,
+                        scoped_refptr<Batch> batch);
+
+  // Copies a batch of the plaintext of `buf` and posts its sealing. Returns
+  // the bytes copied.
+  int StartSealing(IOBuffer* buf, int buf_len, size_t record_size);
+  void OnSealed(scoped_refptr<Batch> batch, bool ok);
+  // Writes the sealed batches at the front to the transport, in order.
+  void WriteSealed();
+  void OnTransportWriteComplete(int rv);
+  void DidTransportWrite(int rv);
+  // Completes a write that waited for room, or for an error.
+  void MaybeRunUserWriteCallback();
+
+  const scoped_refptr<const Key> key_;
+  // Of the first record of the next batch.
+  uint64_t sequence_;
+  const raw_ptr<StreamSocket> transport_;
+
+  // In the order of their records, the front one being written once sealed.
+  base::circular_deque<scoped_refptr<Batch>> batches_;
+  // Plaintext of `batches_`.
+  size_t pending_bytes_ = 0;
+  scoped_refptr<DrainableIOBuffer> transport_buf_;
+  bool transport_write_pending_ = false;
+  MutableNetworkTrafficAnnotationTag traffic_annotation_;
+  // Fails the writes from then on.
+  int error_ = OK;
+
+  scoped_refptr<IOBuffer> user_write_buf_;
+  int user_write_buf_len_ = 0;
+  size_t user_record_size_ = 0;
+  CompletionOnceCallback user_write_callback_;
+
+  base::WeakPtrFactory<SSLRecordSealer> weak_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_SOCKET_SSL_RECORD_SEALER_H_
@@ -140,6 +140,13 @@ class SSLServerContextImpl::SocketImpl : public SSLServerSocket,
                                 unsigned in_len,
                                 void* arg);
 
+  static int TicketKeyCallback(SSL* ssl,
+                               uint8_t* key_name,
+                               uint8_t* iv,
+                               EVP_CIPHER_CTX* cipher_ctx,
+                               HMAC_CTX* hmac_ctx,
+                               int encrypt);
+
   static ssl_select_cert_result_t SelectCertificateCallback(
       const SSL_CLIENT_HELLO* client_hello);
 
@@ -359,6 +366,19 @@ int SSLServerContextImpl::SocketImpl::ALPNSelectCallback(SSL* ssl,
   return SSL_TLSEXT_ERR_NOACK;
 }
 
+// static
+int SSLServerContextImpl::SocketImpl::TicketKeyCallback(
+    SSL* ssl,
+    uint8_t* key_name,
+    uint8_t* iv,
+    EVP_CIPHER_CTX* cipher_ctx,
+    HMAC_CTX* hmac_ctx,
+    int encrypt) {
+  SSLServerContextImpl::SocketImpl* socket = FromSSL(ssl);
+  return socket->context_->ssl_server_config_.ticket_key_source
+      ->HandleTicketKey(key_name, iv, cipher_ctx, hmac_ctx, encrypt != 0);
+}
+
 ssl_select_cert_result_t
 SSLServerContextImpl::SocketImpl::SelectCertificateCallback(
     const SSL_CLIENT_HELLO* client_hello) {
@@ -1045,6 +1065,11 @@ void SSLServerContextImpl::Init() {
                                 ssl_server_config_.ech_keys.get()));
   }
 
+  if (ssl_server_config_.ticket_key_source) {
+    SSL_CTX_set_tlsext_ticket_key_cb(ssl_ctx_.get(),
+                                     &SocketImpl::TicketKeyCallback);
+  }
+
   SSL_CTX_set_select_certificate_cb(ssl_ctx_.get(),
                                     &SocketImpl::SelectCertificateCallback);
 }
@@ -20,6 +20,18 @@ std::optional<std::string_view> StreamSocket::GetPeerApplicationSettings()
   return std::nullopt;
 }
 
+SocketDescriptor StreamSocket::GetKernelSocketDescriptor() const {
+  return kInvalidSocket;
+}
+
+SocketDescriptor StreamSocket::GetTransportSocketDescriptor() const {
+  return GetKernelSocketDescriptor();
+}
+
+int StreamSocket::ShutdownWrite() {
+  return ERR_NOT_IMPLEMENTED;
+}
+
 void StreamSocket::GetSSLCertRequestInfo(
     SSLCertRequestInfo* cert_request_info) const {
   NOTREACHED();
@@ -16,6 +16,7 @@
 #include "net/dns/public/resolve_error_info.h"
 #include "net/socket/next_proto.h"
 #include "net/socket/socket.h"
+#include "net/socket/socket_descriptor.h"
 
 namespace net {
 
@@ -136,6 +137,24 @@ class NET_EXPORT StreamSocket : public Socket {
   // Disconnect() is called.
   virtual int64_t GetTotalReceivedBytes() const = 0;
 
+  // Returns the descriptor of the kernel socket that carries the bytes of
+  // this socket unchanged, for moving work like TLS record encryption into
+  // the kernel, or kInvalidSocket if there is none, e.g. for sockets over
+  // tunnels. Does not release ownership of the descriptor.
+  virtual SocketDescriptor GetKernelSocketDescriptor() const;
+
+  // Returns the descriptor of the kernel socket carrying this socket,
+  // possibly under TLS, for reading transport state like TCP_INFO, or
+  // kInvalidSocket if there is none. Does not release ownership of the
+  // descriptor. Defaults to GetKernelSocketDescriptor().
+  virtual SocketDescriptor GetTransportSocketDescriptor() const;
+
+  // Half-closes the socket: the peer reads EOF once the data written so far
+  // has arrived, while reading from it goes on. Must not be called with a
+  // write pending, and Write() must not be called afterwards. Returns OK, or
+  // ERR_NOT_IMPLEMENTED if the socket can only be closed as a whole.
+  virtual int ShutdownWrite();
+
   // Apply |tag| to this socket. If socket isn't yet connected, tag will be
   // applied when socket is later connected. If Connect() fails or socket
   // is closed, tag is cleared. If this socket is layered upon or wraps an
@@ -118,6 +118,17 @@ bool TCPClientSocket::SetNoDelay(bool no_delay) {
   return socket_->SetNoDelay(no_delay);
 }
 
+bool TCPClientSocket::SetMultipath(bool multipath) {
+#if BUILDFLAG(IS_LINUX)
+  if (socket_->IsValid())
+    return false;
+  socket_->SetMultipath(multipath);
+  return true;
+#else
+  return false;
+#endif
+}
+
 void TCPClientSocket::SetBeforeConnectCallback(
     const BeforeConnectCallback& before_connect_callback) {
   DCHECK_EQ(CONNECT_STATE_NONE, next_connect_state_);
@@ -456,10 +467,26 @@ SocketDescriptor TCPClientSocket::SocketDescriptorForTesting() const {
   return socket_->SocketDescriptorForTesting();
 }
 
+#if BUILDFLAG(IS_LINUX)
+int TCPClientSocket::EnableZeroCopy(int threshold) {
+  return socket_->EnableZeroCopy(threshold);
+}
+#endif
+
 int64_t TCPClientSocket::GetTotalReceivedBytes() const {
   return total_received_bytes_;
 }
 
+SocketDescriptor TCPClientSocket::GetKernelSocketDescriptor() const {
+  return socket_->SocketDescriptorForTesting();
+}
+
+int TCPClientSocket::ShutdownWrite() {
+  if (!IsConnected())
+    return ERR_SOCKET_NOT_CONNECTED;
+  return socket_->ShutdownWrite();
+}
+
 void TCPClientSocket::ApplySocketTag(const SocketTag& tag) {
   socket_->ApplySocketTag(tag);
 }
@@ -92,6 +92,7 @@ class NET_EXPORT TCPClientSocket : public TransportClientSocket,
   int Bind(const IPEndPoint& address) override;
   bool SetKeepAlive(bool enable, int delay) override;
   bool SetNoDelay(bool no_delay) override;
+  bool SetMultipath(bool multipath) override;
 
   // StreamSocket implementation.
   void SetBeforeConnectCallback(
@@ -107,6 +108,8 @@ class NET_EXPORT TCPClientSocket : public TransportClientSocket,
   NextProto GetNegotiatedProtocol() const override;
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
+  SocketDescriptor GetKernelSocketDescriptor() const override;
+  int ShutdownWrite() override;
   void ApplySocketTag(const SocketTag& tag) override;
 
   // Socket implementation.
@@ -130,6 +133,12 @@ class NET_EXPORT TCPClientSocket : public TransportClientSocket,
   // release ownership of the descriptor.
   SocketDescriptor SocketDescriptorForTesting() const;
 
+#if BUILDFLAG(IS_LINUX)
+  // Sends the writes of at least `threshold` bytes without copying, see
+  // SocketPosix::EnableZeroCopy().
+  int EnableZeroCopy(int threshold);
+#endif
+
   // base::PowerSuspendObserver methods:
   void OnSuspend() override;
 
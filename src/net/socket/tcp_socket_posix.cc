@@ -9,7 +9,10 @@
 #include <sys/socket.h>
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "base/atomicops.h"
 #include "base/files/file_path.h"
@@ -18,6 +21,7 @@
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/no_destructor.h"
 #include "base/posix/eintr_wrapper.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_piece.h"
@@ -43,6 +47,7 @@
 #include "net/socket/socket_posix.h"
 #include "net/socket/socket_tag.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
+#include "third_party/abseil-cpp/absl/base/attributes.h"
 
 #if BUILDFLAG(IS_ANDROID)
 #include "net/android/network_library.h"
@@ -53,6 +58,11 @@
 #define TCPI_OPT_SYN_DATA 32
 #endif
 
+// Older glibc headers lack IP_BIND_ADDRESS_NO_PORT, added in Linux 4.2.
+#if BUILDFLAG(IS_LINUX) && !defined(IP_BIND_ADDRESS_NO_PORT)
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
 // Fuchsia defines TCP_INFO, but it's not implemented.
 // TODO(crbug.com/42050612): Enable TCP_INFO on Fuchsia once it's implemented
 // there (see NET-160).
@@ -60,8 +70,36 @@
 #define HAVE_TCP_INFO
 #endif
 
+// Older headers lack the Linux 4.11 option.
+#if BUILDFLAG(IS_LINUX) && !defined(TCP_FASTOPEN_CONNECT)
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+
+// And the Linux 3.11 and 5.11 options.
+#if BUILDFLAG(IS_LINUX) && !defined(SO_BUSY_POLL)
+#define SO_BUSY_POLL 46
+#endif
+#if BUILDFLAG(IS_LINUX) && !defined(SO_PREFER_BUSY_POLL)
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+// And those of MPTCP, added in Linux 5.6 and 5.16.
+#if BUILDFLAG(IS_LINUX) && !defined(IPPROTO_MPTCP)
+#define IPPROTO_MPTCP 262
+#endif
+#if BUILDFLAG(IS_LINUX) && !defined(SOL_MPTCP)
+#define SOL_MPTCP 284
+#endif
+#if BUILDFLAG(IS_LINUX) && !defined(MPTCP_INFO)
+#define MPTCP_INFO 1
+#endif
+
 namespace net {
 
+TCPSocketPosix::TuningOptions::TuningOptions() = default;
+TCPSocketPosix::TuningOptions::TuningOptions(const TuningOptions&) = default;
+TCPSocketPosix::TuningOptions::~TuningOptions() = default;
+
 namespace {
 
 // SetTCPKeepAlive sets SO_KEEPALIVE.
@@ -104,6 +142,94 @@ bool SetTCPKeepAlive(int fd, bool enable, int delay) {
   return true;
 }
 
+// Pending TFO requests a listening socket holds, as recommended by RFC 7413.
+constexpr int kTCPFastOpenQueueLength = 256;
+
+TCPSocketPosix::TuningOptions& GetTuningOptions() {
+  static base::NoDestructor<TCPSocketPosix::TuningOptions> options;
+  return *options;
+}
+
+// Counters of a TuningOptions::source_addresses entry, updated by the
+// sockets of all threads.
+struct SourceAddressState {
+  std::atomic<int> open_sockets{0};
+  std::atomic<uint64_t> exhausted{0};
+};
+
+// Indexed like TuningOptions::source_addresses, and sized along with it.
+std::vector<SourceAddressState>& GetSourceAddressStates() {
+  static base::NoDestructor<std::vector<SourceAddressState>> states;
+  return *states;
+}
+
+#if BUILDFLAG(IS_LINUX)
+// The head of struct mptcp_info of <linux/mptcp.h>, of which the kernel
+// copies as much as asked for.
+struct MptcpInfoHead {
+  // Besides the initial one.
+  uint8_t subflows;
+  uint8_t add_addr_signal;
+  uint8_t add_addr_accepted;
+  uint8_t subflows_max;
+};
+
+// Whether the kernel refused an IPPROTO_MPTCP socket, so later sockets go
+// straight to TCP.
+std::atomic<bool> g_multipath_unavailable{false};
+
+// Of the sockets of the current thread, see TCPSocketPosix::multipath_fd_.
+ABSL_CONST_INIT thread_local std::set<SocketDescriptor>* multipath_fds =
+    nullptr;
+
+std::set<SocketDescriptor>& GetMultipathFds() {
+  if (!multipath_fds) {
+    // Leaked like the other per-thread state of the IO threads.
+    multipath_fds = new std::set<SocketDescriptor>();
+  }
+  return *multipath_fds;
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
+// Sets the TuningOptions listening sockets pass on to accepted sockets, and
+// which must be set on client sockets before connecting. Failures are logged
+// and otherwise ignored.
+void SetInheritedTuningOptions(int fd) {
+  const TCPSocketPosix::TuningOptions& options = GetTuningOptions();
+  if (options.receive_buffer_size > 0 &&
+      SetSocketReceiveBufferSize(fd, options.receive_buffer_size) != OK) {
+    PLOG(ERROR) << "Failed to set SO_RCVBUF on fd: " << fd;
+  }
+  if (options.send_buffer_size > 0 &&
+      SetSocketSendBufferSize(fd, options.send_buffer_size) != OK) {
+    PLOG(ERROR) << "Failed to set SO_SNDBUF on fd: " << fd;
+  }
+#if BUILDFLAG(IS_LINUX)
+  if (options.notsent_lowat > 0 &&
+      setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &options.notsent_lowat,
+                 sizeof(options.notsent_lowat))) {
+    PLOG(ERROR) << "Failed to set TCP_NOTSENT_LOWAT on fd: " << fd;
+  }
+  if (!options.congestion_control.empty() &&
+      setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION,
+                 options.congestion_control.data(),
+                 options.congestion_control.size())) {
+    PLOG(ERROR) << "Failed to set TCP_CONGESTION on fd: " << fd;
+  }
+  if (options.busy_poll_us > 0) {
+    // Raising SO_BUSY_POLL above net.core.busy_read needs CAP_NET_ADMIN.
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &options.busy_poll_us,
+                   sizeof(options.busy_poll_us))) {
+      PLOG(ERROR) << "Failed to set SO_BUSY_POLL on fd: " << fd;
+    }
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on))) {
+      PLOG(ERROR) << "Failed to set SO_PREFER_BUSY_POLL on fd: " << fd;
+    }
+  }
+#endif  // BUILDFLAG(IS_LINUX)
+}
+
 #if defined(HAVE_TCP_INFO)
 // Returns a zero value if the transport RTT is unavailable.
 base::TimeDelta GetTransportRtt(SocketDescriptor fd) {
@@ -168,7 +294,13 @@ TCPSocketPosix::~TCPSocketPosix() {
 int TCPSocketPosix::Open(AddressFamily family) {
   DCHECK(!socket_);
   socket_ = std::make_unique<SocketPosix>();
-  int rv = socket_->Open(ConvertAddressFamily(family));
+  int rv = ERR_NOT_IMPLEMENTED;
+#if BUILDFLAG(IS_LINUX)
+  if (multipath_)
+    rv = OpenMultipath(family);
+#endif
+  if (rv == ERR_NOT_IMPLEMENTED)
+    rv = socket_->Open(ConvertAddressFamily(family));
   if (rv != OK)
     socket_.reset();
   if (rv == OK && tag_ != SocketTag())
@@ -226,6 +358,7 @@ int TCPSocketPosix::Bind(const IPEndPoint& address) {
   if (!address.ToSockAddr(storage.addr, &storage.addr_len))
     return ERR_ADDRESS_INVALID;
 
+  bound_ = true;
   return socket_->Bind(storage);
 }
 
@@ -267,6 +400,14 @@ int TCPSocketPosix::Connect(const IPEndPoint& address,
   if (!address.ToSockAddr(storage.addr, &storage.addr_len))
     return ERR_ADDRESS_INVALID;
 
+#if BUILDFLAG(IS_LINUX)
+  if (!bound_ && source_address_index_ < 0) {
+    int rv = BindToSourceAddress(address.address());
+    if (rv != OK)
+      return HandleConnectCompleted(rv);
+  }
+#endif  // BUILDFLAG(IS_LINUX)
+
   int rv = socket_->Connect(
       storage, base::BindOnce(&TCPSocketPosix::ConnectCompleted,
                               base::Unretained(this), std::move(callback)));
@@ -396,18 +537,52 @@ int TCPSocketPosix::SetDefaultOptionsForServer() {
   if (rv < 0) {
     return MapSystemError(errno);
   }
+
+  if (GetTuningOptions().fastopen) {
+    int qlen = kTCPFastOpenQueueLength;
+    if (setsockopt(socket_->socket_fd(), IPPROTO_TCP, TCP_FASTOPEN, &qlen,
+                   sizeof(qlen))) {
+      PLOG(ERROR) << "Failed to set TCP_FASTOPEN on fd: "
+                  << socket_->socket_fd();
+    }
+  }
 #endif
 
+  SetInheritedTuningOptions(socket_->socket_fd());
+
   return AllowAddressReuse();
 }
 
+// static
+void TCPSocketPosix::SetTuningOptions(const TuningOptions& options) {
+  GetTuningOptions() = options;
+  GetSourceAddressStates() =
+      std::vector<SourceAddressState>(options.source_addresses.size());
+}
+
+// static
+std::vector<TCPSocketPosix::SourceAddressStats>
+TCPSocketPosix::GetSourceAddressStats() {
+  const TuningOptions& options = GetTuningOptions();
+  const std::vector<SourceAddressState>& states = GetSourceAddressStates();
+  std::vector<SourceAddressStats> stats(options.source_addresses.size());
+  for (size_t i = 0; i < stats.size(); ++i) {
+    stats[i].address = options.source_addresses[i];
+    stats[i].open_sockets =
+        states[i].open_sockets.load(std::memory_order_relaxed);
+    stats[i].exhausted = states[i].exhausted.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
 void TCPSocketPosix::SetDefaultOptionsForClient() {
   DCHECK(socket_);
 
   // This mirrors the behaviour on Windows. See the comment in
   // tcp_socket_win.cc after searching for "NODELAY".
   // If SetTCPNoDelay fails, we don't care.
-  SetTCPNoDelay(socket_->socket_fd(), true);
+  const TuningOptions& options = GetTuningOptions();
+  SetTCPNoDelay(socket_->socket_fd(), options.no_delay);
 
   // TCP keep alive wakes up the radio, which is expensive on mobile. Do not
   // enable it there. It's useful to prevent TCP middleboxes from timing out
@@ -421,10 +596,41 @@ void TCPSocketPosix::SetDefaultOptionsForClient() {
   // retransmissions required before killing the connection, this can lead to
   // tens of seconds or even minutes of delay, depending on OS.
 #if !BUILDFLAG(IS_ANDROID) && !BUILDFLAG(IS_IOS)
-  const int kTCPKeepAliveSeconds = 45;
-
-  SetTCPKeepAlive(socket_->socket_fd(), true, kTCPKeepAliveSeconds);
+  if (options.keepalive_idle > 0 &&
+      SetTCPKeepAlive(socket_->socket_fd(), true, options.keepalive_idle)) {
+#if BUILDFLAG(IS_LINUX)
+    // SetTCPKeepAlive() uses the idle time as the interval.
+    if (options.keepalive_interval > 0 &&
+        setsockopt(socket_->socket_fd(), SOL_TCP, TCP_KEEPINTVL,
+                   &options.keepalive_interval,
+                   sizeof(options.keepalive_interval))) {
+      PLOG(ERROR) << "Failed to set TCP_KEEPINTVL on fd: "
+                  << socket_->socket_fd();
+    }
+    if (options.keepalive_count > 0 &&
+        setsockopt(socket_->socket_fd(), SOL_TCP, TCP_KEEPCNT,
+                   &options.keepalive_count,
+                   sizeof(options.keepalive_count))) {
+      PLOG(ERROR) << "Failed to set TCP_KEEPCNT on fd: "
+                  << socket_->socket_fd();
+    }
+#endif  // BUILDFLAG(IS_LINUX)
+  }
 #endif
+
+  SetInheritedTuningOptions(socket_->socket_fd());
+
+#if BUILDFLAG(IS_LINUX)
+  // Accepted sockets are already connected and refuse the option.
+  if (options.fastopen && !socket_->HasPeerAddress()) {
+    int on = 1;
+    if (setsockopt(socket_->socket_fd(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                   &on, sizeof(on))) {
+      PLOG(ERROR) << "Failed to set TCP_FASTOPEN_CONNECT on fd: "
+                  << socket_->socket_fd();
+    }
+  }
+#endif  // BUILDFLAG(IS_LINUX)
 }
 
 int TCPSocketPosix::AllowAddressReuse() {
@@ -459,6 +665,22 @@ bool TCPSocketPosix::SetNoDelay(bool no_delay) {
   return SetTCPNoDelay(socket_->socket_fd(), no_delay) == OK;
 }
 
+int TCPSocketPosix::ShutdownWrite() {
+  if (!socket_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  if (shutdown(socket_->socket_fd(), SHUT_WR))
+    return MapSystemError(errno);
+  return OK;
+}
+
+#if BUILDFLAG(IS_LINUX)
+int TCPSocketPosix::EnableZeroCopy(int threshold) {
+  if (!socket_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  return socket_->EnableZeroCopy(threshold);
+}
+#endif
+
 int TCPSocketPosix::SetIPv6Only(bool ipv6_only) {
   CHECK(socket_);
   return ::net::SetIPv6Only(socket_->socket_fd(), ipv6_only);
@@ -466,8 +688,20 @@ int TCPSocketPosix::SetIPv6Only(bool ipv6_only) {
 
 void TCPSocketPosix::Close() {
   TRACE_EVENT("base", perfetto::StaticString{"CloseSocketTCP"});
+#if BUILDFLAG(IS_LINUX)
+  if (multipath_fd_ != kInvalidSocket) {
+    GetMultipathFds().erase(multipath_fd_);
+    multipath_fd_ = kInvalidSocket;
+  }
+#endif
   socket_.reset();
   tag_ = SocketTag();
+  if (source_address_index_ >= 0) {
+    GetSourceAddressStates()[source_address_index_].open_sockets.fetch_sub(
+        1, std::memory_order_relaxed);
+    source_address_index_ = -1;
+  }
+  bound_ = false;
 }
 
 bool TCPSocketPosix::IsValid() const {
@@ -498,6 +732,12 @@ void TCPSocketPosix::EndLoggingMultipleConnectAttempts(int net_error) {
 }
 
 SocketDescriptor TCPSocketPosix::ReleaseSocketDescriptorForTesting() {
+#if BUILDFLAG(IS_LINUX)
+  if (multipath_fd_ != kInvalidSocket) {
+    GetMultipathFds().erase(multipath_fd_);
+    multipath_fd_ = kInvalidSocket;
+  }
+#endif
   SocketDescriptor socket_descriptor = socket_->ReleaseConnectedSocket();
   socket_.reset();
   return socket_descriptor;
@@ -558,6 +798,95 @@ int TCPSocketPosix::BuildTcpSocketPosix(
   return OK;
 }
 
+#if BUILDFLAG(IS_LINUX)
+int TCPSocketPosix::BindToSourceAddress(const IPAddress& peer) {
+  const std::vector<IPAddress>& addresses =
+      GetTuningOptions().source_addresses;
+  std::vector<SourceAddressState>& states = GetSourceAddressStates();
+
+  // The least used rather than one hashed from the peer, so a busy peer
+  // spreads over all addresses instead of exhausting the ports of one.
+  int index = -1;
+  int least_open = 0;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    if (addresses[i].IsIPv4() != peer.IsIPv4())
+      continue;
+    int open = states[i].open_sockets.load(std::memory_order_relaxed);
+    if (index < 0 || open < least_open) {
+      index = static_cast<int>(i);
+      least_open = open;
+    }
+  }
+  if (index < 0)
+    return OK;
+
+  // Without it, bind() reserves a port for the address alone, so the ports
+  // of an address run out at the size of the ephemeral range however many
+  // peers they connect to.
+  int fd = socket_->socket_fd();
+  int on = 1;
+  if (setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof(on))) {
+    PLOG(ERROR) << "Failed to set IP_BIND_ADDRESS_NO_PORT on fd: " << fd;
+  }
+
+  SockaddrStorage storage;
+  if (!IPEndPoint(addresses[index], 0)
+           .ToSockAddr(storage.addr, &storage.addr_len)) {
+    return ERR_ADDRESS_INVALID;
+  }
+  int rv = socket_->Bind(storage);
+  if (rv != OK)
+    return rv;
+
+  states[index].open_sockets.fetch_add(1, std::memory_order_relaxed);
+  source_address_index_ = index;
+  return OK;
+}
+
+int TCPSocketPosix::OpenMultipath(AddressFamily family) {
+  if (g_multipath_unavailable.load(std::memory_order_relaxed))
+    return ERR_NOT_IMPLEMENTED;
+  SocketDescriptor fd = CreatePlatformSocket(ConvertAddressFamily(family),
+                                             SOCK_STREAM, IPPROTO_MPTCP);
+  if (fd < 0) {
+    // Without CONFIG_MPTCP, or with net.mptcp.enabled=0.
+    if (errno == EPROTONOSUPPORT || errno == EINVAL || errno == ENOPROTOOPT) {
+      if (!g_multipath_unavailable.exchange(true)) {
+        PLOG(WARNING) << "MPTCP is unavailable, connecting with TCP";
+      }
+      return ERR_NOT_IMPLEMENTED;
+    }
+    PLOG(ERROR) << "CreatePlatformSocket() failed";
+    return MapSystemError(errno);
+  }
+  int rv = socket_->AdoptUnconnectedSocket(fd);
+  if (rv != OK)
+    return rv;
+  GetMultipathFds().insert(fd);
+  multipath_fd_ = fd;
+  return OK;
+}
+
+// static
+TCPSocketPosix::MultipathStats TCPSocketPosix::GetMultipathStats() {
+  MultipathStats stats;
+  for (SocketDescriptor fd : GetMultipathFds()) {
+    MptcpInfoHead info = {};
+    socklen_t info_len = sizeof(info);
+    // Sockets fallen back to TCP answer SOL_MPTCP options with an error, or
+    // with nothing on some kernels.
+    if (getsockopt(fd, SOL_MPTCP, MPTCP_INFO, &info, &info_len) != 0 ||
+        info_len == 0) {
+      ++stats.fallbacks;
+      continue;
+    }
+    ++stats.connections;
+    stats.subflows += 1 + info.subflows;
+  }
+  return stats;
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
 void TCPSocketPosix::ConnectCompleted(CompletionOnceCallback callback, int rv) {
   DCHECK_NE(ERR_IO_PENDING, rv);
   std::move(callback).Run(HandleConnectCompleted(rv));
@@ -569,6 +898,12 @@ int TCPSocketPosix::HandleConnectCompleted(int rv) {
     net_log_.EndEventWithIntParams(NetLogEventType::TCP_CONNECT_ATTEMPT,
                                    "os_error", errno);
     tag_ = SocketTag();
+    // With IP_BIND_ADDRESS_NO_PORT, connect() fails with EADDRNOTAVAIL when
+    // no local port of the source address is free for the peer.
+    if (rv == ERR_ADDRESS_INVALID && source_address_index_ >= 0) {
+      GetSourceAddressStates()[source_address_index_].exhausted.fetch_add(
+          1, std::memory_order_relaxed);
+    }
   } else {
     net_log_.EndEvent(NetLogEventType::TCP_CONNECT_ATTEMPT);
     NotifySocketPerformanceWatcher();
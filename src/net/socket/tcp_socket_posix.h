@@ -8,10 +8,14 @@
 #include <stdint.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "base/functional/callback.h"
+#include "build/build_config.h"
 #include "net/base/address_family.h"
 #include "net/base/completion_once_callback.h"
+#include "net/base/ip_address.h"
 #include "net/base/net_export.h"
 #include "net/base/network_handle.h"
 #include "net/log/net_log_with_source.h"
@@ -36,6 +40,69 @@ class SocketTag;
 
 class NET_EXPORT TCPSocketPosix {
  public:
+  // Process-wide options added to SetDefaultOptionsForServer() and
+  // SetDefaultOptionsForClient(). 0 or empty keeps the system default.
+  struct NET_EXPORT TuningOptions {
+    TuningOptions();
+    TuningOptions(const TuningOptions&);
+    ~TuningOptions();
+
+    // Accepts data in the SYN on listening sockets, and sends the first write
+    // in the SYN of client sockets (TCP_FASTOPEN_CONNECT). Linux only.
+    bool fastopen = false;
+    bool no_delay = true;
+    int receive_buffer_size = 0;
+    int send_buffer_size = 0;
+    // TCP_NOTSENT_LOWAT, limiting unsent data queued in the kernel. Linux only.
+    int notsent_lowat = 0;
+    // Seconds until the first keepalive probe, 0 disables keepalives.
+    int keepalive_idle = 45;
+    // Seconds between probes, 0 means |keepalive_idle|.
+    int keepalive_interval = 0;
+    // Probes before the connection is dropped. Linux only.
+    int keepalive_count = 0;
+    // TCP_CONGESTION, e.g. "bbr". Linux only.
+    std::string congestion_control;
+    // SO_BUSY_POLL in microseconds, with SO_PREFER_BUSY_POLL, polling the
+    // device queue on reads instead of waiting for its interrupt. Linux only.
+    int busy_poll_us = 0;
+    // Local addresses client sockets not bound otherwise are bound to, the
+    // one with the fewest open sockets of the family of the peer, with
+    // IP_BIND_ADDRESS_NO_PORT so the port is picked at connect time per
+    // 4-tuple. Linux only.
+    std::vector<IPAddress> source_addresses;
+  };
+
+  // Of one of TuningOptions::source_addresses.
+  struct SourceAddressStats {
+    IPAddress address;
+    // Connecting or connected sockets bound to it.
+    int open_sockets = 0;
+    // Connects failing as it had no local port left for the peer.
+    uint64_t exhausted = 0;
+  };
+
+  // Must be called before any socket is opened, as the options are read
+  // without synchronization by all threads.
+  static void SetTuningOptions(const TuningOptions& options);
+
+  // Indexed like TuningOptions::source_addresses. Safe to call on any
+  // thread.
+  static std::vector<SourceAddressStats> GetSourceAddressStats();
+
+#if BUILDFLAG(IS_LINUX)
+  // Of the sockets opened with SetMultipath() on the current thread.
+  struct MultipathStats {
+    // Connected with MPTCP, or not connected yet.
+    int connections = 0;
+    // Connected with plain TCP, the peer or a middlebox not taking MPTCP.
+    int fallbacks = 0;
+    // Of `connections`, the initial ones included.
+    int subflows = 0;
+  };
+  static MultipathStats GetMultipathStats();
+#endif  // BUILDFLAG(IS_LINUX)
+
   // |socket_performance_watcher| is notified of the performance metrics related
   // to this socket. |socket_performance_watcher| may be null.
   TCPSocketPosix(
@@ -114,10 +181,12 @@ class NET_EXPORT TCPSocketPosix {
   // Sets various socket options.
   // The commonly used options for server listening sockets:
   // - AllowAddressReuse().
+  // - The TuningOptions inherited by accepted sockets.
   int SetDefaultOptionsForServer();
   // The commonly used options for client sockets and accepted sockets:
   // - SetNoDelay(true);
   // - SetKeepAlive(true, 45).
+  // Both as changed by the TuningOptions.
   void SetDefaultOptionsForClient();
   int AllowAddressReuse();
   int SetReceiveBufferSize(int32_t size);
@@ -125,6 +194,15 @@ class NET_EXPORT TCPSocketPosix {
   bool SetKeepAlive(bool enable, int delay);
   bool SetNoDelay(bool no_delay);
   int SetIPv6Only(bool ipv6_only);
+  // Sends a FIN once the data written so far is sent.
+  int ShutdownWrite();
+#if BUILDFLAG(IS_LINUX)
+  // See SocketPosix::EnableZeroCopy().
+  int EnableZeroCopy(int threshold);
+  // Makes Open() create an IPPROTO_MPTCP socket, or a TCP one if the kernel
+  // has MPTCP disabled or lacks it. Must be called before Open().
+  void SetMultipath(bool multipath) { multipath_ = multipath; }
+#endif
 
   // Gets the estimated RTT. Returns false if the RTT is
   // unavailable. May also return false when estimated RTT is 0.
@@ -190,6 +268,15 @@ class NET_EXPORT TCPSocketPosix {
   int BuildTcpSocketPosix(std::unique_ptr<TCPSocketPosix>* tcp_socket,
                           IPEndPoint* address);
 
+#if BUILDFLAG(IS_LINUX)
+  // Binds the socket to the TuningOptions::source_addresses entry for
+  // connecting to `peer`, if any. Returns a net error code.
+  int BindToSourceAddress(const IPAddress& peer);
+  // Opens an IPPROTO_MPTCP socket. Returns ERR_NOT_IMPLEMENTED if the kernel
+  // cannot, otherwise a net error code.
+  int OpenMultipath(AddressFamily family);
+#endif  // BUILDFLAG(IS_LINUX)
+
   void ConnectCompleted(CompletionOnceCallback callback, int rv);
   int HandleConnectCompleted(int rv);
   void LogConnectBegin(const AddressList& addresses) const;
@@ -220,6 +307,18 @@ class NET_EXPORT TCPSocketPosix {
 
   bool logging_multiple_connect_attempts_ = false;
 
+  // Whether Bind() was called, so Connect() leaves the local address alone.
+  bool bound_ = false;
+  // Of the source address Connect() bound the socket to, or -1.
+  int source_address_index_ = -1;
+
+#if BUILDFLAG(IS_LINUX)
+  bool multipath_ = false;
+  // The descriptor OpenMultipath() counted in GetMultipathStats(), until
+  // Close().
+  SocketDescriptor multipath_fd_ = kInvalidSocket;
+#endif
+
   NetLogWithSource net_log_;
 
   // Current socket tag if |socket_| is valid, otherwise the tag to apply when
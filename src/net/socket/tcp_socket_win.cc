@@ -686,6 +686,14 @@ bool TCPSocketWin::SetNoDelay(bool no_delay) {
   return SetTCPNoDelay(socket_, no_delay) == OK;
 }
 
+int TCPSocketWin::ShutdownWrite() {
+  if (socket_ == INVALID_SOCKET)
+    return ERR_SOCKET_NOT_CONNECTED;
+  if (shutdown(socket_, SD_SEND))
+    return MapSystemError(WSAGetLastError());
+  return OK;
+}
+
 int TCPSocketWin::SetIPv6Only(bool ipv6_only) {
   return ::net::SetIPv6Only(socket_, ipv6_only);
 }
@@ -100,6 +100,8 @@ class NET_EXPORT TCPSocketWin : public base::win::ObjectWatcher::Delegate {
   bool SetKeepAlive(bool enable, int delay);
   bool SetNoDelay(bool no_delay);
   int SetIPv6Only(bool ipv6_only);
+  // Sends a FIN once the data written so far is sent.
+  int ShutdownWrite();
 
   // Gets the estimated RTT. Returns false if the RTT is
   // unavailable. May also return false when estimated RTT is 0.
@@ -19,4 +19,8 @@ bool TransportClientSocket::SetKeepAlive(bool enable, int delay_secs) {
   return false;
 }
 
+bool TransportClientSocket::SetMultipath(bool multipath) {
+  return false;
+}
+
 }  // namespace net
@@ -50,6 +50,11 @@ class NET_EXPORT TransportClientSocket : public StreamSocket {
   // should always be ready after successful connection or slightly earlier
   // during BeforeConnect handlers.
   virtual bool SetKeepAlive(bool enable, int delay_secs);
+
+  // Requests Multipath TCP for the connection, which falls back to TCP where
+  // the peer does not take it. Must be called before Connect(). Returns
+  // false if the socket cannot, as by default. Linux only.
+  virtual bool SetMultipath(bool multipath);
 };
 
 }  // namespace net
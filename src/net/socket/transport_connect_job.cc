@@ -5,16 +5,24 @@
 #include "net/socket/transport_connect_job.h"
 
 #include <memory>
+#include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "base/check_op.h"
+#include "base/containers/contains.h"
+#include "base/containers/lru_cache.h"
 #include "base/feature_list.h"
 #include "base/functional/bind.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/no_destructor.h"
 #include "base/notreached.h"
+#include "base/synchronization/lock.h"
 #include "base/task/single_thread_task_runner.h"
+#include "base/thread_annotations.h"
 #include "base/time/time.h"
 #include "net/base/features.h"
 #include "net/base/host_port_pair.h"
@@ -48,8 +56,108 @@ HostPortPair ToLegacyDestinationEndpoint(
   return absl::get<HostPortPair>(endpoint);
 }
 
+constexpr size_t kMaxFamilyMemoryEntries = 1024;
+
+TransportConnectJob::ConnectPolicy& GetConnectPolicy() {
+  static TransportConnectJob::ConnectPolicy policy;
+  return policy;
+}
+
+// Hosts that connected over IPv4 while IPv6 was tried, until when they are
+// connected IPv4 first. Shared by the jobs of all threads.
+class FamilyMemory {
+ public:
+  static FamilyMemory& GetInstance() {
+    static base::NoDestructor<FamilyMemory> instance;
+    return *instance;
+  }
+
+  FamilyMemory() : hosts_(kMaxFamilyMemoryEntries) {}
+
+  bool PrefersIPv4(const std::string& host) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    base::AutoLock lock(lock_);
+    auto it = hosts_.Get(host);
+    if (it == hosts_.end())
+      return false;
+    if (now >= it->second) {
+      hosts_.Erase(it);
+      return false;
+    }
+    return true;
+  }
+
+  void Remember(const std::string& host, bool ipv4, base::TimeDelta duration) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    base::AutoLock lock(lock_);
+    if (ipv4) {
+      hosts_.Put(host, now + duration);
+      return;
+    }
+    auto it = hosts_.Peek(host);
+    if (it != hosts_.end())
+      hosts_.Erase(it);
+  }
+
+ private:
+  base::Lock lock_;
+  base::LRUCache<std::string, base::TimeTicks> hosts_ GUARDED_BY(lock_);
+};
+
+// The address of each of the ConnectPolicy::race_hosts that won its last
+// race, until when it is connected first. Shared by the jobs of all threads.
+class AddressMemory {
+ public:
+  static AddressMemory& GetInstance() {
+    static base::NoDestructor<AddressMemory> instance;
+    return *instance;
+  }
+
+  AddressMemory() : hosts_(kMaxFamilyMemoryEntries) {}
+
+  std::optional<IPEndPoint> Get(const std::string& host) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    base::AutoLock lock(lock_);
+    auto it = hosts_.Get(host);
+    if (it == hosts_.end())
+      return std::nullopt;
+    if (now >= it->second.second) {
+      hosts_.Erase(it);
+      return std::nullopt;
+    }
+    return it->second.first;
+  }
+
+  void Remember(const std::string& host,
+                const IPEndPoint& address,
+                base::TimeDelta duration) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    base::AutoLock lock(lock_);
+    hosts_.Put(host, {address, now + duration});
+  }
+
+  void Forget(const std::string& host) {
+    base::AutoLock lock(lock_);
+    auto it = hosts_.Peek(host);
+    if (it != hosts_.end())
+      hosts_.Erase(it);
+  }
+
+ private:
+  base::Lock lock_;
+  base::LRUCache<std::string, std::pair<IPEndPoint, base::TimeTicks>> hosts_
+      GUARDED_BY(lock_);
+};
+
 }  // namespace
 
+TransportConnectJob::ConnectPolicy::ConnectPolicy() = default;
+TransportConnectJob::ConnectPolicy::ConnectPolicy(const ConnectPolicy&) =
+    default;
+TransportConnectJob::ConnectPolicy&
+TransportConnectJob::ConnectPolicy::operator=(const ConnectPolicy&) = default;
+TransportConnectJob::ConnectPolicy::~ConnectPolicy() = default;
+
 TransportSocketParams::TransportSocketParams(
     Endpoint destination,
     NetworkAnonymizationKey network_anonymization_key,
@@ -162,6 +270,10 @@ LoadState TransportConnectJob::GetLoadState() const {
           load_state != LOAD_STATE_CONNECTING) {
         load_state = ipv4_job_->GetLoadState();
       }
+      for (const auto& job : race_jobs_) {
+        if (job && job->started() && load_state != LOAD_STATE_CONNECTING)
+          load_state = job->GetLoadState();
+      }
       return load_state;
     }
     case STATE_NONE:
@@ -199,6 +311,10 @@ base::TimeDelta TransportConnectJob::ConnectionTimeout() {
   return base::Minutes(4);
 }
 
+void TransportConnectJob::SetConnectPolicy(const ConnectPolicy& policy) {
+  GetConnectPolicy() = policy;
+}
+
 void TransportConnectJob::OnIOComplete(int result) {
   result = DoLoop(result);
   if (result != ERR_IO_PENDING)
@@ -311,6 +427,7 @@ int TransportConnectJob::DoResolveHostComplete(int result) {
 int TransportConnectJob::DoResolveHostCallbackComplete() {
   const auto& unfiltered_results = *request_->GetEndpointResults();
   bool svcb_optional = IsSvcbOptional(unfiltered_results);
+  ConnectPolicy::Family family = GetConnectPolicy().family;
   std::set<IPEndPoint> ip_endpoints_seen;
   for (const auto& result : unfiltered_results) {
     if (!IsEndpointResultUsable(result, svcb_optional)) {
@@ -322,6 +439,12 @@ int TransportConnectJob::DoResolveHostCallbackComplete() {
     // route, there is no use in trying a second time.
     std::vector<IPEndPoint> ip_endpoints;
     for (const auto& ip_endpoint : result.ip_endpoints) {
+      if ((family == ConnectPolicy::Family::kIPv4Only &&
+           ip_endpoint.GetFamily() != ADDRESS_FAMILY_IPV4) ||
+          (family == ConnectPolicy::Family::kIPv6Only &&
+           ip_endpoint.GetFamily() != ADDRESS_FAMILY_IPV6)) {
+        continue;
+      }
       auto [iter, inserted] = ip_endpoints_seen.insert(ip_endpoint);
       if (inserted) {
         ip_endpoints.push_back(ip_endpoint);
@@ -356,8 +479,30 @@ int TransportConnectJob::DoTransportConnect() {
 
   const HostResolverEndpointResult& endpoint =
       GetEndpointResultForCurrentSubJobs();
+  const ConnectPolicy& policy = GetConnectPolicy();
+  const std::string host =
+      ToLegacyDestinationEndpoint(params_->destination()).host();
+  remembered_address_.reset();
+  multipath_ = policy.multipath_hosts.contains(host);
+  if (endpoint.ip_endpoints.size() > 1 && policy.race_hosts.contains(host)) {
+    remembered_address_ = AddressMemory::GetInstance().Get(host);
+    if (!remembered_address_ ||
+        !base::Contains(endpoint.ip_endpoints, *remembered_address_)) {
+      remembered_address_.reset();
+      return StartRace(endpoint.ip_endpoints);
+    }
+  }
+
   std::vector<IPEndPoint> ipv4_addresses, ipv6_addresses;
   for (const auto& ip_endpoint : endpoint.ip_endpoints) {
+    // The winner of the last race goes first.
+    if (remembered_address_ && ip_endpoint == *remembered_address_) {
+      std::vector<IPEndPoint>& addresses =
+          ip_endpoint.GetFamily() == ADDRESS_FAMILY_IPV4 ? ipv4_addresses
+                                                         : ipv6_addresses;
+      addresses.insert(addresses.begin(), ip_endpoint);
+      continue;
+    }
     switch (ip_endpoint.GetFamily()) {
       case ADDRESS_FAMILY_IPV4:
         ipv4_addresses.push_back(ip_endpoint);
@@ -373,6 +518,7 @@ int TransportConnectJob::DoTransportConnect() {
     }
   }
 
+  has_both_families_ = !ipv4_addresses.empty() && !ipv6_addresses.empty();
   if (!ipv4_addresses.empty()) {
     ipv4_job_ = std::make_unique<TransportConnectSubJob>(
         std::move(ipv4_addresses), this, SUB_JOB_IPV4);
@@ -381,25 +527,33 @@ int TransportConnectJob::DoTransportConnect() {
   if (!ipv6_addresses.empty()) {
     ipv6_job_ = std::make_unique<TransportConnectSubJob>(
         std::move(ipv6_addresses), this, SUB_JOB_IPV6);
-    int result = ipv6_job_->Start();
-    if (result != ERR_IO_PENDING)
-      return HandleSubJobComplete(result, ipv6_job_.get());
-    if (ipv4_job_) {
-      // This use of base::Unretained is safe because |fallback_timer_| is
-      // owned by this object.
-      fallback_timer_.Start(
-          FROM_HERE, kIPv6FallbackTime,
-          base::BindOnce(&TransportConnectJob::StartIPv4JobAsync,
-                         base::Unretained(this)));
-    }
-    return ERR_IO_PENDING;
   }
 
-  DCHECK(!ipv6_job_);
-  DCHECK(ipv4_job_);
-  int result = ipv4_job_->Start();
+  bool ipv4_first =
+      policy.family == ConnectPolicy::Family::kPreferIPv4 ||
+      (policy.family == ConnectPolicy::Family::kDefault &&
+       has_both_families_ && policy.family_memory.is_positive() &&
+       FamilyMemory::GetInstance().PrefersIPv4(host));
+  if (remembered_address_) {
+    ipv4_first = remembered_address_->GetFamily() == ADDRESS_FAMILY_IPV4;
+  }
+  TransportConnectSubJob* first_job = ipv6_job_.get();
+  TransportConnectSubJob* second_job = ipv4_job_.get();
+  if (!first_job || (second_job && ipv4_first))
+    std::swap(first_job, second_job);
+  DCHECK(first_job);
+
+  int result = first_job->Start();
   if (result != ERR_IO_PENDING)
-    return HandleSubJobComplete(result, ipv4_job_.get());
+    return HandleSubJobComplete(result, first_job);
+  if (second_job) {
+    // This use of base::Unretained is safe because |fallback_timer_| is
+    // owned by this object.
+    fallback_timer_.Start(
+        FROM_HERE, policy.fallback_delay,
+        base::BindOnce(&TransportConnectJob::StartFallbackJobAsync,
+                       base::Unretained(this)));
+  }
   return ERR_IO_PENDING;
 }
 
@@ -407,6 +561,7 @@ int TransportConnectJob::DoTransportConnectComplete(int result) {
   // Make sure nothing else calls back into this object.
   ipv4_job_.reset();
   ipv6_job_.reset();
+  race_jobs_.clear();
   fallback_timer_.Stop();
 
   if (result == OK) {
@@ -441,7 +596,29 @@ int TransportConnectJob::DoTransportConnectComplete(int result) {
 int TransportConnectJob::HandleSubJobComplete(int result,
                                               TransportConnectSubJob* job) {
   DCHECK_NE(result, ERR_IO_PENDING);
+  if (!race_jobs_.empty())
+    return HandleRaceJobComplete(result, job);
   if (result == OK) {
+    const ConnectPolicy& policy = GetConnectPolicy();
+    // IPv4 is remembered only if it won against IPv6, and IPv6 winning
+    // forgets it, so IPv6 is tried again once the memory expires.
+    bool ipv6_tried = !ipv6_job_ || ipv6_job_->started();
+    if (has_both_families_ &&
+        policy.family == ConnectPolicy::Family::kDefault &&
+        policy.family_memory.is_positive() &&
+        (job->type() == SUB_JOB_IPV6 || ipv6_tried)) {
+      FamilyMemory::GetInstance().Remember(
+          ToLegacyDestinationEndpoint(params_->destination()).host(),
+          job->type() == SUB_JOB_IPV4, policy.family_memory);
+    }
+    // A remembered address that did not connect first is raced again.
+    IPEndPoint address;
+    if (remembered_address_ &&
+        (job->socket()->GetPeerAddress(&address) != OK ||
+         address != *remembered_address_)) {
+      AddressMemory::GetInstance().Forget(
+          ToLegacyDestinationEndpoint(params_->destination()).host());
+    }
     SetSocket(job->PassSocket(), dns_aliases_);
     return result;
   }
@@ -451,6 +628,8 @@ int TransportConnectJob::HandleSubJobComplete(int result,
     return result;
   }
 
+  std::unique_ptr<TransportConnectSubJob>& other_job =
+      job->type() == SUB_JOB_IPV4 ? ipv6_job_ : ipv4_job_;
   switch (job->type()) {
     case SUB_JOB_IPV4:
       ipv4_job_.reset();
@@ -458,16 +637,16 @@ int TransportConnectJob::HandleSubJobComplete(int result,
 
     case SUB_JOB_IPV6:
       ipv6_job_.reset();
-      // Start the other job, rather than wait for the fallback timer.
-      if (ipv4_job_ && !ipv4_job_->started()) {
-        fallback_timer_.Stop();
-        result = ipv4_job_->Start();
-        if (result != ERR_IO_PENDING) {
-          return HandleSubJobComplete(result, ipv4_job_.get());
-        }
-      }
       break;
   }
+  // Start the other job, rather than wait for the fallback timer.
+  if (other_job && !other_job->started()) {
+    fallback_timer_.Stop();
+    result = other_job->Start();
+    if (result != ERR_IO_PENDING) {
+      return HandleSubJobComplete(result, other_job.get());
+    }
+  }
 
   if (ipv4_job_ || ipv6_job_) {
     // Wait for the other job to complete, rather than reporting |result|.
@@ -485,12 +664,70 @@ void TransportConnectJob::OnSubJobComplete(int result,
   }
 }
 
-void TransportConnectJob::StartIPv4JobAsync() {
-  DCHECK(ipv4_job_);
+void TransportConnectJob::StartFallbackJobAsync() {
+  TransportConnectSubJob* job =
+      ipv4_job_ && !ipv4_job_->started() ? ipv4_job_.get() : ipv6_job_.get();
+  DCHECK(job);
+  DCHECK(!job->started());
   net_log().AddEvent(NetLogEventType::TRANSPORT_CONNECT_JOB_IPV6_FALLBACK);
-  int result = ipv4_job_->Start();
+  int result = job->Start();
   if (result != ERR_IO_PENDING)
-    OnSubJobComplete(result, ipv4_job_.get());
+    OnSubJobComplete(result, job);
+}
+
+int TransportConnectJob::StartRace(const std::vector<IPEndPoint>& addresses) {
+  DCHECK(race_jobs_.empty());
+  for (const IPEndPoint& address : addresses) {
+    race_jobs_.push_back(std::make_unique<TransportConnectSubJob>(
+        std::vector<IPEndPoint>{address}, this,
+        address.GetFamily() == ADDRESS_FAMILY_IPV4 ? SUB_JOB_IPV4
+                                                   : SUB_JOB_IPV6));
+  }
+  // Jobs failing at once are reset, the others are left running.
+  for (size_t i = 0; i < race_jobs_.size(); ++i) {
+    TransportConnectSubJob* job = race_jobs_[i].get();
+    int result = job->Start();
+    if (result == ERR_IO_PENDING)
+      continue;
+    result = HandleRaceJobComplete(result, job);
+    if (result != ERR_IO_PENDING)
+      return result;
+  }
+  return ERR_IO_PENDING;
+}
+
+int TransportConnectJob::HandleRaceJobComplete(int result,
+                                               TransportConnectSubJob* job) {
+  DCHECK_NE(result, ERR_IO_PENDING);
+  if (result == OK) {
+    IPEndPoint address;
+    if (job->socket()->GetPeerAddress(&address) == OK) {
+      AddressMemory::GetInstance().Remember(
+          ToLegacyDestinationEndpoint(params_->destination()).host(), address,
+          GetConnectPolicy().race_memory);
+    }
+    SetSocket(job->PassSocket(), dns_aliases_);
+    race_jobs_.clear();
+    return result;
+  }
+
+  if (result == ERR_NETWORK_IO_SUSPENDED) {
+    race_jobs_.clear();
+    return result;
+  }
+
+  bool running = false;
+  for (auto& race_job : race_jobs_) {
+    if (race_job.get() == job) {
+      race_job.reset();
+    } else if (race_job) {
+      running = true;
+    }
+  }
+  if (running)
+    return ERR_IO_PENDING;
+  race_jobs_.clear();
+  return result;
 }
 
 int TransportConnectJob::ConnectInternal() {
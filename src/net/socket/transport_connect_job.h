@@ -18,6 +18,7 @@
 #include "base/time/time.h"
 #include "base/timer/timer.h"
 #include "net/base/host_port_pair.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/net_export.h"
 #include "net/base/network_anonymization_key.h"
 #include "net/dns/host_resolver.h"
@@ -116,6 +117,43 @@ class NET_EXPORT_PRIVATE TransportConnectJob : public ConnectJob {
   // they don't synchronize.
   static constexpr base::TimeDelta kIPv6FallbackTime = base::Milliseconds(300);
 
+  // How the connects of all TransportConnectJobs in the process race the
+  // address families.
+  struct NET_EXPORT_PRIVATE ConnectPolicy {
+    enum class Family {
+      // IPv6 first, unless the host is remembered to need IPv4.
+      kDefault,
+      kPreferIPv6,
+      kPreferIPv4,
+      kIPv4Only,
+      kIPv6Only,
+    };
+
+    Family family = Family::kDefault;
+    // Delay before the second family is tried while the first is still
+    // connecting.
+    base::TimeDelta fallback_delay = kIPv6FallbackTime;
+    // With kDefault, a host that connected over IPv4 while IPv6 was tried
+    // is connected IPv4 first for this long. Zero disables it.
+    base::TimeDelta family_memory;
+    // Hosts whose addresses are all connected at once, e.g. those of the
+    // proxies. The first to connect, the one of the lowest RTT, is connected
+    // first for `race_memory` before they are raced again.
+    std::set<std::string> race_hosts;
+    base::TimeDelta race_memory;
+    // Hosts connected with Multipath TCP, e.g. those of the proxies, see
+    // TransportClientSocket::SetMultipath(). Linux only.
+    std::set<std::string> multipath_hosts;
+
+    ConnectPolicy();
+    ConnectPolicy(const ConnectPolicy&);
+    ConnectPolicy& operator=(const ConnectPolicy&);
+    ~ConnectPolicy();
+  };
+
+  // Must be called before any job starts.
+  static void SetConnectPolicy(const ConnectPolicy& policy);
+
   struct NET_EXPORT_PRIVATE EndpointResultOverride {
     EndpointResultOverride(HostResolverEndpointResult result,
                            std::set<std::string> dns_aliases);
@@ -188,8 +226,12 @@ class NET_EXPORT_PRIVATE TransportConnectJob : public ConnectJob {
   // be called from within `DoLoop`.
   void OnSubJobComplete(int result, TransportConnectSubJob* job);
 
-  // Called from |fallback_timer_|.
-  void StartIPv4JobAsync();
+  // Called from |fallback_timer_|. Starts the job of the second family.
+  void StartFallbackJobAsync();
+
+  // Connects to all of `addresses` at once, see ConnectPolicy::race_hosts.
+  int StartRace(const std::vector<IPEndPoint>& addresses);
+  int HandleRaceJobComplete(int result, TransportConnectSubJob* job);
 
   // Begins the host resolution and the TCP connect.  Returns OK on success
   // and ERR_IO_PENDING if it cannot immediately service the request.
@@ -221,12 +263,23 @@ class NET_EXPORT_PRIVATE TransportConnectJob : public ConnectJob {
   State next_state_ = STATE_NONE;
 
   // The addresses are divided into IPv4 and IPv6, which are performed partially
-  // in parallel. If the list of IPv6 addresses is non-empty, then the IPv6 jobs
-  // go first, followed after `kIPv6FallbackTime` by the IPv4 addresses. The
-  // first sub-job to establish a connection wins. If one sub-job fails, the
-  // other one is launched if needed, and we wait for it to complete.
+  // in parallel. If the list of IPv6 addresses is non-empty, then by default
+  // the IPv6 jobs go first, followed after the fallback delay of the
+  // `ConnectPolicy` by the IPv4 addresses. The first sub-job to establish a
+  // connection wins. If one sub-job fails, the other one is launched if
+  // needed, and we wait for it to complete.
   std::unique_ptr<TransportConnectSubJob> ipv4_job_;
   std::unique_ptr<TransportConnectSubJob> ipv6_job_;
+  // Whether the current endpoint has addresses of both families, so the
+  // family of the connection is worth remembering.
+  bool has_both_families_ = false;
+  // Instead of the above, one per address while they are raced. Jobs done
+  // are reset.
+  std::vector<std::unique_ptr<TransportConnectSubJob>> race_jobs_;
+  // The address connected first as remembered when the connect started.
+  std::optional<IPEndPoint> remembered_address_;
+  // Whether the host is one of the ConnectPolicy::multipath_hosts.
+  bool multipath_ = false;
 
   base::OneShotTimer fallback_timer_;
 
@@ -18,6 +18,7 @@
 #include "net/socket/connection_attempts.h"
 #include "net/socket/socket_performance_watcher.h"
 #include "net/socket/socket_performance_watcher_factory.h"
+#include "net/socket/transport_client_socket.h"
 #include "net/socket/websocket_endpoint_lock_manager.h"
 
 namespace net {
@@ -214,11 +215,15 @@ int TransportConnectSubJob::DoEndpointLockComplete() {
   }
 
   const NetLogWithSource& net_log = parent_job_->net_log();
-  transport_socket_ =
+  std::unique_ptr<TransportClientSocket> transport_socket =
       parent_job_->client_socket_factory()->CreateTransportClientSocket(
           one_address, std::move(socket_performance_watcher),
           parent_job_->network_quality_estimator(), net_log.net_log(),
           net_log.source());
+  if (parent_job_->multipath_) {
+    transport_socket->SetMultipath(true);
+  }
+  transport_socket_ = std::move(transport_socket);
 
   net_log.AddEvent(NetLogEventType::TRANSPORT_CONNECT_JOB_CONNECT_ATTEMPT, [&] {
     auto dict = base::Value::Dict().Set("address", CurrentAddress().ToString());
@@ -48,6 +48,9 @@ class TransportConnectSubJob : public WebSocketEndpointLockManager::Waiter {
 
   SubJobType type() const { return type_; }
 
+  // The connected socket until passed.
+  StreamSocket* socket() const { return transport_socket_.get(); }
+
   std::unique_ptr<StreamSocket> PassSocket() {
     return std::move(transport_socket_);
   }
@@ -251,6 +251,61 @@ void UDPClientSocket::EnableRecvOptimization() {
 #endif
 }
 
+bool UDPClientSocket::SupportsSegmentedWrites() const {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.SupportsSegmentedWrites();
+#else
+  return false;
+#endif
+}
+
+int UDPClientSocket::WriteSegmented(IOBuffer* buf,
+                                    int buf_len,
+                                    int segment_size,
+                                    CompletionOnceCallback callback) {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.WriteSegmented(buf, buf_len, segment_size,
+                                std::move(callback));
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+int UDPClientSocket::SetTxTime() {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.SetTxTime();
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+bool UDPClientSocket::IsTxTimeEnabled() const {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.tx_time_enabled();
+#else
+  return false;
+#endif
+}
+
+void UDPClientSocket::SetNextTxTime(base::TimeTicks time) {
+#if BUILDFLAG(IS_POSIX)
+  socket_.set_next_tx_time(time);
+#endif
+}
+
+int UDPClientSocket::ReadMultiple(IOBuffer* buf,
+                                  int buf_len,
+                                  int max_datagram_size,
+                                  std::vector<std::string_view>* datagrams,
+                                  CompletionOnceCallback callback) {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.ReadMultiple(buf, buf_len, max_datagram_size, datagrams,
+                              std::move(callback));
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
 void UDPClientSocket::SetIOSNetworkServiceType(int ios_network_service_type) {
 #if BUILDFLAG(IS_POSIX)
   socket_.SetIOSNetworkServiceType(ios_network_service_type);
@@ -270,4 +325,12 @@ DscpAndEcn UDPClientSocket::GetLastTos() const {
   return socket_.GetLastTos();
 }
 
+DscpAndEcn UDPClientSocket::GetDatagramTos(size_t index) const {
+#if BUILDFLAG(IS_POSIX)
+  return socket_.GetDatagramTos(index);
+#else
+  return {};
+#endif
+}
+
 }  // namespace net
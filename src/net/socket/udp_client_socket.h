@@ -78,6 +78,20 @@ class NET_EXPORT_PRIVATE UDPClientSocket : public DatagramClientSocket {
   void SetMsgConfirm(bool confirm) override;
   const NetLogWithSource& NetLog() const override;
   void EnableRecvOptimization() override;
+  bool SupportsSegmentedWrites() const override;
+  int WriteSegmented(IOBuffer* buf,
+                     int buf_len,
+                     int segment_size,
+                     CompletionOnceCallback callback) override;
+  int SetTxTime() override;
+  bool IsTxTimeEnabled() const override;
+  void SetNextTxTime(base::TimeTicks time) override;
+  int ReadMultiple(IOBuffer* buf,
+                   int buf_len,
+                   int max_datagram_size,
+                   std::vector<std::string_view>* datagrams,
+                   CompletionOnceCallback callback) override;
+  DscpAndEcn GetDatagramTos(size_t index) const override;
 
   int SetMulticastInterface(uint32_t interface_index) override;
   void SetIOSNetworkServiceType(int ios_network_service_type) override;
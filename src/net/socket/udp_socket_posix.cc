@@ -19,7 +19,10 @@
 #include <netinet/in.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <time.h>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 #include "base/debug/alias.h"
@@ -73,10 +76,66 @@ constexpr int kBindRetries = 10;
 constexpr int kPortStart = 1024;
 constexpr int kPortEnd = 65535;
 
+#if BUILDFLAG(IS_LINUX)
+// UDP_SEGMENT and UDP_GRO from <linux/udp.h>, which older C libraries do
+// not define.
+constexpr int kUdpSegment = 103;
+constexpr int kUdpGro = 104;
+
+// SO_TXTIME and struct sock_txtime from <linux/net_tstamp.h>. The control
+// message of the release time is of the same type.
+constexpr int kSoTxTime = 61;
+struct SockTxTime {
+  int32_t clockid;
+  uint32_t flags;
+};
+#endif
+
 int GetSocketFDHash(int fd) {
   return fd ^ 1595649551;
 }
 
+#if BUILDFLAG(IS_LINUX)
+// Adds the release time |tx_time| to |msg|, whose |control| buffer of
+// |control_size| bytes must have CMSG_SPACE(sizeof(uint64_t)) bytes free
+// after the control messages already in it.
+void AddTxTime(struct msghdr* msg,
+               char* control,
+               size_t control_size,
+               base::TimeTicks tx_time) {
+  size_t used = msg->msg_control ? msg->msg_controllen : 0;
+  DCHECK_LE(used + CMSG_SPACE(sizeof(uint64_t)), control_size);
+  msg->msg_control = control;
+  msg->msg_controllen = used + CMSG_SPACE(sizeof(uint64_t));
+  struct cmsghdr* cmsg = reinterpret_cast<struct cmsghdr*>(control + used);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = kSoTxTime;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+  // TimeTicks are CLOCK_MONOTONIC on Linux, the clock SetTxTime() asks for.
+  uint64_t ns = static_cast<uint64_t>(
+      (tx_time - base::TimeTicks()).InNanoseconds());
+  memcpy(CMSG_DATA(cmsg), &ns, sizeof(ns));
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
+// Returns the TOS byte in the control messages of |msg|, 0 if there is
+// none.
+uint8_t GetReceivedTos(struct msghdr* msg) {
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(msg, cmsg)) {
+#if BUILDFLAG(IS_APPLE)
+    if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVTOS) ||
+        (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS)) {
+#else
+    if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) ||
+        (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS)) {
+#endif  // BUILDFLAG(IS_APPLE)
+      return *(reinterpret_cast<uint8_t*>(CMSG_DATA(cmsg)));
+    }
+  }
+  return 0;
+}
+
 }  // namespace
 
 UDPSocketPosix::UDPSocketPosix(DatagramSocket::BindType bind_type,
@@ -180,6 +239,7 @@ void UDPSocketPosix::Close() {
   read_buf_len_ = 0;
   read_callback_.Reset();
   recv_from_address_ = nullptr;
+  read_datagrams_ = nullptr;
   write_buf_.reset();
   write_buf_len_ = 0;
   write_callback_.Reset();
@@ -274,6 +334,31 @@ int UDPSocketPosix::Read(IOBuffer* buf,
   return RecvFrom(buf, buf_len, nullptr, std::move(callback));
 }
 
+int UDPSocketPosix::ReadMultiple(IOBuffer* buf,
+                                 int buf_len,
+                                 int max_datagram_size,
+                                 std::vector<std::string_view>* datagrams,
+                                 CompletionOnceCallback callback) {
+#if BUILDFLAG(IS_LINUX)
+  DCHECK(is_connected_);
+  DCHECK_GT(max_datagram_size, 0);
+  if (!udp_gro_tried_) {
+    udp_gro_tried_ = true;
+    int on = 1;
+    udp_gro_enabled_ =
+        setsockopt(socket_, IPPROTO_UDP, kUdpGro, &on, sizeof(on)) == 0;
+  }
+  read_datagrams_ = datagrams;
+  read_max_datagram_size_ = max_datagram_size;
+  int result = RecvFrom(buf, buf_len, nullptr, std::move(callback));
+  if (result != ERR_IO_PENDING)
+    read_datagrams_ = nullptr;
+  return result;
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
 int UDPSocketPosix::RecvFrom(IOBuffer* buf,
                              int buf_len,
                              IPEndPoint* address,
@@ -313,6 +398,44 @@ int UDPSocketPosix::Write(
   return SendToOrWrite(buf, buf_len, nullptr, std::move(callback));
 }
 
+bool UDPSocketPosix::SupportsSegmentedWrites() const {
+#if BUILDFLAG(IS_LINUX)
+  return true;
+#else
+  return false;
+#endif
+}
+
+int UDPSocketPosix::WriteSegmented(IOBuffer* buf,
+                                   int buf_len,
+                                   int segment_size,
+                                   CompletionOnceCallback callback) {
+  DCHECK(SupportsSegmentedWrites());
+  DCHECK_GT(segment_size, 0);
+  write_segment_size_ = segment_size;
+  write_segment_offset_ = 0;
+  int result = SendToOrWrite(buf, buf_len, nullptr, std::move(callback));
+  if (result != ERR_IO_PENDING)
+    write_segment_size_ = 0;
+  return result;
+}
+
+int UDPSocketPosix::SetTxTime() {
+  DCHECK_NE(socket_, kInvalidSocket);
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+#if BUILDFLAG(IS_LINUX)
+  SockTxTime config = {CLOCK_MONOTONIC, 0};
+  if (setsockopt(socket_, SOL_SOCKET, kSoTxTime, &config, sizeof(config)) !=
+      0) {
+    return MapSystemError(errno);
+  }
+  tx_time_enabled_ = true;
+  return OK;
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
 int UDPSocketPosix::SendTo(IOBuffer* buf,
                            int buf_len,
                            const IPEndPoint& address,
@@ -512,12 +635,17 @@ int UDPSocketPosix::SetRecvTos() {
       return MapSystemError(errno);
     }
     if (v6_only) {
+      recv_tos_ = true;
       return OK;
     }
   }
 
   int rv = setsockopt(socket_, IPPROTO_IP, IP_RECVTOS, &ecn, sizeof(ecn));
-  return rv == 0 ? OK : MapSystemError(errno);
+  if (rv != 0) {
+    return MapSystemError(errno);
+  }
+  recv_tos_ = true;
+  return OK;
 }
 
 void UDPSocketPosix::SetMsgConfirm(bool confirm) {
@@ -619,6 +747,7 @@ void UDPSocketPosix::DidCompleteRead() {
     read_buf_.reset();
     read_buf_len_ = 0;
     recv_from_address_ = nullptr;
+    read_datagrams_ = nullptr;
     bool ok = read_socket_watcher_.StopWatchingFileDescriptor();
     DCHECK(ok);
     DoReadCallback(result);
@@ -656,6 +785,7 @@ void UDPSocketPosix::DidCompleteWrite() {
     write_buf_.reset();
     write_buf_len_ = 0;
     send_to_address_.reset();
+    write_segment_size_ = 0;
     write_socket_watcher_.StopWatchingFileDescriptor();
     DoWriteCallback(result);
   }
@@ -683,6 +813,13 @@ void UDPSocketPosix::LogWrite(int result,
 int UDPSocketPosix::InternalRecvFrom(IOBuffer* buf,
                                      int buf_len,
                                      IPEndPoint* address) {
+#if BUILDFLAG(IS_LINUX)
+  if (read_datagrams_) {
+    DCHECK(!address);
+    return InternalReadMultiple(buf, buf_len);
+  }
+#endif
+
   // If the socket is connected and the remote address is known
   // use the more efficient method that uses read() instead of recvmsg().
   if (experimental_recv_optimization_enabled_ && is_connected_ &&
@@ -764,20 +901,7 @@ int UDPSocketPosix::InternalRecvFromNonConnectedSocket(IOBuffer* buf,
     }
     last_tos_ = 0;
     if (bytes_transferred > 0 && msg.msg_controllen > 0) {
-      for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
-           cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-#if BUILDFLAG(IS_APPLE)
-        if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVTOS) ||
-            (cmsg->cmsg_level == IPPROTO_IPV6 &&
-             cmsg->cmsg_type == IPV6_TCLASS)) {
-#else
-        if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) ||
-            (cmsg->cmsg_level == IPPROTO_IPV6 &&
-             cmsg->cmsg_type == IPV6_TCLASS)) {
-#endif  // BUILDFLAG(IS_APPLE)
-          last_tos_ = *(reinterpret_cast<uint8_t*>(CMSG_DATA(cmsg)));
-        }
-      }
+      last_tos_ = GetReceivedTos(&msg);
     }
   }
 
@@ -788,6 +912,13 @@ int UDPSocketPosix::InternalRecvFromNonConnectedSocket(IOBuffer* buf,
 int UDPSocketPosix::InternalSendTo(IOBuffer* buf,
                                    int buf_len,
                                    const IPEndPoint* address) {
+#if BUILDFLAG(IS_LINUX)
+  if (write_segment_size_ > 0) {
+    DCHECK(!address);
+    return InternalWriteSegments(buf, buf_len);
+  }
+#endif
+
   SockaddrStorage storage;
   struct sockaddr* addr = storage.addr;
   if (!address) {
@@ -801,8 +932,26 @@ int UDPSocketPosix::InternalSendTo(IOBuffer* buf,
     }
   }
 
-  int result = HANDLE_EINTR(sendto(socket_, buf->data(), buf_len, sendto_flags_,
-                                   addr, storage.addr_len));
+  int result;
+#if BUILDFLAG(IS_LINUX)
+  if (tx_time_enabled_ && !next_tx_time_.is_null()) {
+    struct iovec iov = {buf->data(), static_cast<size_t>(buf_len)};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint64_t))] = {};
+    struct msghdr msg = {};
+    msg.msg_name = addr;
+    msg.msg_namelen = storage.addr_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    AddTxTime(&msg, control, sizeof(control), next_tx_time_);
+    result = HANDLE_EINTR(sendmsg(socket_, &msg, sendto_flags_));
+  } else {
+    result = HANDLE_EINTR(sendto(socket_, buf->data(), buf_len,
+                                 sendto_flags_, addr, storage.addr_len));
+  }
+#else
+  result = HANDLE_EINTR(sendto(socket_, buf->data(), buf_len, sendto_flags_,
+                               addr, storage.addr_len));
+#endif
   if (result < 0)
     result = MapSystemError(errno);
   if (result != ERR_IO_PENDING)
@@ -810,6 +959,180 @@ int UDPSocketPosix::InternalSendTo(IOBuffer* buf,
   return result;
 }
 
+#if BUILDFLAG(IS_LINUX)
+int UDPSocketPosix::InternalWriteSegments(IOBuffer* buf, int buf_len) {
+  const bool tx_time = tx_time_enabled_ && !next_tx_time_.is_null();
+  // The kernel sends all segments of a UDP_SEGMENT write or none of them,
+  // at the release time if given.
+  if (!udp_segment_disabled_ && write_segment_offset_ == 0 &&
+      buf_len > write_segment_size_) {
+    struct iovec iov = {buf->data(), static_cast<size_t>(buf_len)};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t)) +
+                                         CMSG_SPACE(sizeof(uint64_t))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = kUdpSegment;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segment_size = static_cast<uint16_t>(write_segment_size_);
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    if (tx_time) {
+      AddTxTime(&msg, control, sizeof(control), next_tx_time_);
+    }
+    int result = HANDLE_EINTR(sendmsg(socket_, &msg, sendto_flags_));
+    if (result >= 0) {
+      LogWrite(result, buf->data(), nullptr);
+      return result;
+    }
+    // EIO comes from routes without checksum offload, and ENOPROTOOPT from
+    // kernels before 4.18. EINVAL may only concern this write, e.g. a first
+    // segment over the path MTU, so sendmmsg(2) reports it properly.
+    if (errno == EIO || errno == ENOPROTOOPT) {
+      udp_segment_disabled_ = true;
+    } else if (errno != EINVAL) {
+      result = MapSystemError(errno);
+      if (result != ERR_IO_PENDING)
+        LogWrite(result, nullptr, nullptr);
+      return result;
+    }
+  }
+
+  constexpr int kMaxMessages = 64;
+  struct iovec iovs[kMaxMessages];
+  struct mmsghdr msgs[kMaxMessages];
+  // Shared by the messages, which all leave at the release time.
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint64_t))] = {};
+  while (write_segment_offset_ < buf_len) {
+    int count = 0;
+    for (int offset = write_segment_offset_;
+         offset < buf_len && count < kMaxMessages;
+         offset += write_segment_size_, ++count) {
+      iovs[count] = {buf->data() + offset,
+                     static_cast<size_t>(
+                         std::min(write_segment_size_, buf_len - offset))};
+      msgs[count] = {};
+      msgs[count].msg_hdr.msg_iov = &iovs[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      if (tx_time) {
+        AddTxTime(&msgs[count].msg_hdr, control, sizeof(control),
+                  next_tx_time_);
+      }
+    }
+    int sent = HANDLE_EINTR(sendmmsg(socket_, msgs, count, sendto_flags_));
+    if (sent < 0) {
+      int result = MapSystemError(errno);
+      if (result != ERR_IO_PENDING)
+        LogWrite(result, nullptr, nullptr);
+      return result;
+    }
+    for (int i = 0; i < sent; ++i) {
+      int len = static_cast<int>(msgs[i].msg_len);
+      LogWrite(len, buf->data() + write_segment_offset_, nullptr);
+      write_segment_offset_ += len;
+    }
+  }
+  return buf_len;
+}
+
+int UDPSocketPosix::InternalReadMultiple(IOBuffer* buf, int buf_len) {
+  DCHECK(remote_address_);
+  SockaddrStorage peer;
+  bool success = remote_address_->ToSockAddr(peer.addr, &peer.addr_len);
+  DCHECK(success);
+  std::vector<std::string_view>& datagrams = *read_datagrams_;
+  datagrams.clear();
+  read_tos_.clear();
+
+  if (udp_gro_enabled_) {
+    struct iovec iov = {buf->data(), static_cast<size_t>(buf_len)};
+    // Room for the segment size and the TOS byte.
+    alignas(struct cmsghdr) char control[2 * CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int result = HANDLE_EINTR(recvmsg(socket_, &msg, 0));
+    if (result < 0) {
+      result = MapSystemError(errno);
+      if (result != ERR_IO_PENDING)
+        LogRead(result, nullptr, 0, nullptr);
+      return result;
+    }
+    // Without the control message, a single datagram was read.
+    int segment_size = result;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == kUdpGro)
+        memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+    }
+    if ((msg.msg_flags & MSG_TRUNC) || segment_size <= 0 ||
+        segment_size > read_max_datagram_size_) {
+      LogRead(ERR_MSG_TOO_BIG, nullptr, 0, nullptr);
+      return ERR_MSG_TOO_BIG;
+    }
+    for (int offset = 0; offset < result; offset += segment_size) {
+      int len = std::min(segment_size, result - offset);
+      datagrams.emplace_back(buf->data() + offset, len);
+      LogRead(len, buf->data() + offset, peer.addr_len, peer.addr);
+    }
+    // GRO only coalesces datagrams with the same TOS byte.
+    if (recv_tos_) {
+      read_tos_.assign(datagrams.size(), GetReceivedTos(&msg));
+    }
+    return result;
+  }
+
+  constexpr int kMaxMessages = 64;
+  // Each slot has a spare byte to tell datagrams that are too long.
+  int slot_size = read_max_datagram_size_ + 1;
+  int count = std::min(kMaxMessages, buf_len / slot_size);
+  DCHECK_GT(count, 0);
+  struct iovec iovs[kMaxMessages];
+  struct mmsghdr msgs[kMaxMessages];
+  alignas(struct cmsghdr) char controls[kMaxMessages][CMSG_SPACE(sizeof(int))];
+  for (int i = 0; i < count; ++i) {
+    iovs[i] = {buf->data() + i * slot_size, static_cast<size_t>(slot_size)};
+    msgs[i] = {};
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (recv_tos_) {
+      msgs[i].msg_hdr.msg_control = controls[i];
+      msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+    }
+  }
+  int received = HANDLE_EINTR(recvmmsg(socket_, msgs, count, 0, nullptr));
+  if (received < 0) {
+    int result = MapSystemError(errno);
+    if (result != ERR_IO_PENDING)
+      LogRead(result, nullptr, 0, nullptr);
+    return result;
+  }
+  int total = 0;
+  for (int i = 0; i < received; ++i) {
+    int len = static_cast<int>(msgs[i].msg_len);
+    if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+        len > read_max_datagram_size_) {
+      continue;
+    }
+    datagrams.emplace_back(buf->data() + i * slot_size, len);
+    if (recv_tos_) {
+      read_tos_.push_back(GetReceivedTos(&msgs[i].msg_hdr));
+    }
+    LogRead(len, buf->data() + i * slot_size, peer.addr_len, peer.addr);
+    total += len;
+  }
+  // Read again rather than report an empty batch as EOF.
+  if (datagrams.empty())
+    return InternalReadMultiple(buf, buf_len);
+  return total;
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
 int UDPSocketPosix::SetMulticastOptions() {
   if (!(socket_options_ & SOCKET_OPTION_MULTICAST_LOOP)) {
     int rv;
@@ -10,12 +10,15 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <string_view>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/memory/raw_ptr.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/message_loop/message_pump_for_io.h"
 #include "base/threading/thread_checker.h"
+#include "base/time/time.h"
 #include "net/base/address_family.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/io_buffer.h"
@@ -99,6 +102,38 @@ class NET_EXPORT UDPSocketPosix {
             CompletionOnceCallback callback,
             const NetworkTrafficAnnotationTag& traffic_annotation);
 
+  // Returns whether WriteSegmented() is supported, which is on Linux.
+  bool SupportsSegmentedWrites() const;
+
+  // Writes |buf| as datagrams of |segment_size| bytes each, the last one
+  // possibly shorter, with UDP generic segmentation offload (UDP_SEGMENT),
+  // or with sendmmsg(2) where the kernel or the route does not support it.
+  // Returns |buf_len| once all of them are written. Only usable from the
+  // client-side of a UDP socket, after the socket has been connected.
+  int WriteSegmented(IOBuffer* buf,
+                     int buf_len,
+                     int segment_size,
+                     CompletionOnceCallback callback);
+
+  // Enables SO_TXTIME on Linux, see DatagramClientSocket::SetTxTime().
+  // Returns ERR_NOT_IMPLEMENTED elsewhere.
+  int SetTxTime();
+  bool tx_time_enabled() const { return tx_time_enabled_; }
+  // The time the datagrams of the next write leave the qdisc, now if null.
+  void set_next_tx_time(base::TimeTicks time) { next_tx_time_ = time; }
+
+  // Reads the datagrams ready on the socket into |buf|, see
+  // DatagramClientSocket::ReadMultiple(). On Linux they come coalesced by
+  // UDP generic receive offload (UDP_GRO), or with recvmmsg(2) into slots of
+  // |max_datagram_size| + 1 bytes where the kernel does not support it.
+  // Returns ERR_NOT_IMPLEMENTED elsewhere. Only usable from the client-side
+  // of a UDP socket, after the socket has been connected.
+  int ReadMultiple(IOBuffer* buf,
+                   int buf_len,
+                   int max_datagram_size,
+                   std::vector<std::string_view>* datagrams,
+                   CompletionOnceCallback callback);
+
   // Reads from a socket and receive sender address information.
   // |buf| is the buffer to read data into.
   // |buf_len| is the maximum amount of data to read.
@@ -276,6 +311,12 @@ class NET_EXPORT UDPSocketPosix {
 
   DscpAndEcn GetLastTos() const { return TosToDscpAndEcn(last_tos_); }
 
+  // See DatagramClientSocket::GetDatagramTos().
+  DscpAndEcn GetDatagramTos(size_t index) const {
+    return index < read_tos_.size() ? TosToDscpAndEcn(read_tos_[index])
+                                    : DscpAndEcn();
+  }
+
  private:
   enum SocketOptions {
     SOCKET_OPTION_MULTICAST_LOOP = 1 << 0
@@ -361,6 +402,13 @@ class NET_EXPORT UDPSocketPosix {
                                          int buf_len,
                                          IPEndPoint* address);
   int InternalSendTo(IOBuffer* buf, int buf_len, const IPEndPoint* address);
+#if BUILDFLAG(IS_LINUX)
+  // Sends the rest of a WriteSegmented() buffer after
+  // |write_segment_offset_|.
+  int InternalWriteSegments(IOBuffer* buf, int buf_len);
+  // Reads for a pending ReadMultiple().
+  int InternalReadMultiple(IOBuffer* buf, int buf_len);
+#endif
 
   // Applies |socket_options_| to |socket_|. Should be called before
   // Bind().
@@ -417,12 +465,30 @@ class NET_EXPORT UDPSocketPosix {
   scoped_refptr<IOBuffer> read_buf_;
   int read_buf_len_ = 0;
   raw_ptr<IPEndPoint> recv_from_address_ = nullptr;
+  // Output and datagram size limit of the pending ReadMultiple(), null for
+  // other reads.
+  raw_ptr<std::vector<std::string_view>> read_datagrams_ = nullptr;
+  int read_max_datagram_size_ = 0;
+  // Whether enabling UDP_GRO was tried, and whether it succeeded.
+  bool udp_gro_tried_ = false;
+  bool udp_gro_enabled_ = false;
 
   // The buffer used by InternalWrite() to retry Write requests
   scoped_refptr<IOBuffer> write_buf_;
   int write_buf_len_ = 0;
   std::unique_ptr<IPEndPoint> send_to_address_;
 
+  // Segment size of the pending WriteSegmented(), 0 for other writes, and
+  // the bytes of it already sent.
+  int write_segment_size_ = 0;
+  int write_segment_offset_ = 0;
+
+  // Whether SetTxTime() succeeded, and the release time of the next write.
+  bool tx_time_enabled_ = false;
+  base::TimeTicks next_tx_time_;
+  // Set once UDP_SEGMENT fails for lack of checksum offload on the route.
+  bool udp_segment_disabled_ = false;
+
   // External callback; called when read is complete.
   CompletionOnceCallback read_callback_;
 
@@ -450,6 +516,10 @@ class NET_EXPORT UDPSocketPosix {
 
   // The last TOS byte received on the socket.
   uint8_t last_tos_ = 0;
+  // Whether SetRecvTos() succeeded, and the TOS bytes of the datagrams of
+  // the last ReadMultiple() if so.
+  bool recv_tos_ = false;
+  std::vector<uint8_t> read_tos_;
 
   THREAD_CHECKER(thread_checker_);
 };
@@ -10,6 +10,7 @@
 #include "base/check.h"
 #include "base/strings/string_util.h"
 #include "base/trace_event/memory_usage_estimator.h"
+#include "net/spdy/spdy_http_utils.h"
 
 namespace net {
 
@@ -30,6 +31,8 @@ BufferedSpdyFramer::BufferedSpdyFramer(uint32_t max_header_list_size,
   // Do not bother decoding response header payload above the limit.
   deframer_.GetHpackDecoder().set_max_decode_buffer_size_bytes(
       max_header_list_size_);
+  // Keeps headers of SetUnindexedHeaderNames() out of the dynamic table.
+  spdy_framer_.SetHpackIndexingPolicy(&ShouldIndexHeader);
 }
 
 BufferedSpdyFramer::~BufferedSpdyFramer() = default;
@@ -301,6 +304,18 @@ std::unique_ptr<spdy::SpdySerializedFrame> BufferedSpdyFramer::CreateDataFrame(
       spdy_framer_.SerializeData(data_ir));
 }
 
+std::unique_ptr<spdy::SpdySerializedFrame>
+BufferedSpdyFramer::CreateDataFrameHeader(spdy::SpdyStreamId stream_id,
+                                          uint32_t len,
+                                          spdy::SpdyDataFlags flags) {
+  spdy::SpdyDataIR data_ir(stream_id);
+  data_ir.SetDataShallow(len);
+  data_ir.set_fin((flags & spdy::DATA_FLAG_FIN) != 0);
+  return std::make_unique<spdy::SpdySerializedFrame>(
+      spdy::SpdyFramer::SerializeDataFrameHeaderWithPaddingLengthField(
+          data_ir));
+}
+
 // TODO(jgraettinger): Eliminate uses of this method (prefer
 // spdy::SpdyPriorityIR).
 std::unique_ptr<spdy::SpdySerializedFrame> BufferedSpdyFramer::CreatePriority(
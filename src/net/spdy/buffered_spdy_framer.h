@@ -235,6 +235,11 @@ class NET_EXPORT_PRIVATE BufferedSpdyFramer
       const char* data,
       uint32_t len,
       spdy::SpdyDataFlags flags);
+  // The header alone of a DATA frame with a payload of `len` bytes.
+  std::unique_ptr<spdy::SpdySerializedFrame> CreateDataFrameHeader(
+      spdy::SpdyStreamId stream_id,
+      uint32_t len,
+      spdy::SpdyDataFlags flags);
   std::unique_ptr<spdy::SpdySerializedFrame> CreatePriority(
       spdy::SpdyStreamId stream_id,
       spdy::SpdyStreamId dependency_id,
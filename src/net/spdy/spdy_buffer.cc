@@ -60,6 +60,21 @@ class SpdyBuffer::SharedFrameIOBuffer : public IOBuffer {
   const scoped_refptr<SharedFrame> shared_frame_;
 };
 
+// Refers to data held by another IOBuffer, keeping it alive.
+class SpdyBuffer::BorrowedIOBuffer : public IOBuffer {
+ public:
+  BorrowedIOBuffer(scoped_refptr<IOBuffer> owner, base::span<char> data)
+      : IOBuffer(data), owner_(std::move(owner)) {}
+
+  BorrowedIOBuffer(const BorrowedIOBuffer&) = delete;
+  BorrowedIOBuffer& operator=(const BorrowedIOBuffer&) = delete;
+
+ private:
+  ~BorrowedIOBuffer() override { data_ = nullptr; }
+
+  const scoped_refptr<IOBuffer> owner_;
+};
+
 SpdyBuffer::SpdyBuffer(std::unique_ptr<spdy::SpdySerializedFrame> frame)
     : shared_frame_(base::MakeRefCounted<SharedFrame>(std::move(frame))) {}
 
@@ -72,16 +87,28 @@ SpdyBuffer::SpdyBuffer(const char* data, size_t size)
   shared_frame_->data = MakeSpdySerializedFrame(data, size);
 }
 
+SpdyBuffer::SpdyBuffer(scoped_refptr<IOBuffer> owner, char* data, size_t size)
+    : borrowed_(base::MakeRefCounted<BorrowedIOBuffer>(
+          std::move(owner),
+          base::span(data, size))) {
+  CHECK_GT(size, 0u);
+  CHECK_LE(size, kMaxSpdyFrameSize);
+}
+
 SpdyBuffer::~SpdyBuffer() {
   if (GetRemainingSize() > 0)
     ConsumeHelper(GetRemainingSize(), DISCARD);
 }
 
 const char* SpdyBuffer::GetRemainingData() const {
+  if (borrowed_)
+    return borrowed_->data() + offset_;
   return shared_frame_->data->data() + offset_;
 }
 
 size_t SpdyBuffer::GetRemainingSize() const {
+  if (borrowed_)
+    return borrowed_->size() - offset_;
   return shared_frame_->data->size() - offset_;
 }
 
@@ -94,6 +121,10 @@ void SpdyBuffer::Consume(size_t consume_size) {
 }
 
 scoped_refptr<IOBuffer> SpdyBuffer::GetIOBufferForRemainingData() {
+  if (borrowed_) {
+    return base::MakeRefCounted<BorrowedIOBuffer>(
+        borrowed_, borrowed_->span().subspan(offset_));
+  }
   return base::MakeRefCounted<SharedFrameIOBuffer>(shared_frame_, offset_);
 }
 
@@ -55,6 +55,11 @@ class NET_EXPORT_PRIVATE SpdyBuffer {
   // non-NULL and |size| must be non-zero.
   SpdyBuffer(const char* data, size_t size);
 
+  // Construct with the |size| bytes at |data| without copying them. |owner|
+  // holds them and is referenced until they are no longer used, also by the
+  // IOBuffers of GetIOBufferForRemainingData().
+  SpdyBuffer(scoped_refptr<IOBuffer> owner, char* data, size_t size);
+
   SpdyBuffer(const SpdyBuffer&) = delete;
   SpdyBuffer& operator=(const SpdyBuffer&) = delete;
 
@@ -97,8 +102,11 @@ class NET_EXPORT_PRIVATE SpdyBuffer {
       SharedFrame;
 
   class SharedFrameIOBuffer;
+  class BorrowedIOBuffer;
 
+  // One of them holds the data.
   const scoped_refptr<SharedFrame> shared_frame_;
+  const scoped_refptr<IOBuffer> borrowed_;
   std::vector<ConsumeCallback> consume_callbacks_;
   size_t offset_ = 0;
 };
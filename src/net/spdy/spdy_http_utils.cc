@@ -6,10 +6,13 @@
 
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "base/check_op.h"
+#include "base/containers/contains.h"
 #include "base/feature_list.h"
+#include "base/no_destructor.h"
 #include "base/strings/strcat.h"
 #include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
@@ -37,6 +40,12 @@ namespace {
 // sizes in ricea@'s cache on 3 Aug 2023.
 constexpr size_t kExpectedRawHeaderSize = 4035;
 
+// Of SetUnindexedHeaderNames().
+std::vector<std::string>& UnindexedHeaderNames() {
+  static base::NoDestructor<std::vector<std::string>> names;
+  return *names;
+}
+
 // Add header `name` with `value` to `headers`. `name` must not already exist in
 // `headers`.
 void AddUniqueSpdyHeader(std::string_view name,
@@ -317,4 +326,18 @@ NET_EXPORT_PRIVATE void ConvertHeaderBlockToHttpRequestHeaders(
   }
 }
 
+void SetUnindexedHeaderNames(std::vector<std::string> names) {
+  UnindexedHeaderNames() = std::move(names);
+}
+
+bool ShouldIndexHeader(std::string_view name, std::string_view value) {
+  if (name.empty()) {
+    return false;
+  }
+  if (name[0] == ':') {
+    return name == ":authority";
+  }
+  return !base::Contains(UnindexedHeaderNames(), name);
+}
+
 }  // namespace net
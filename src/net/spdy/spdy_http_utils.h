@@ -6,6 +6,9 @@
 #define NET_SPDY_SPDY_HTTP_UTILS_H_
 
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "base/memory/ref_counted.h"
 #include "base/types/expected.h"
@@ -90,6 +93,18 @@ NET_EXPORT spdy::SpdyPriority ConvertRequestPriorityToSpdyPriority(
 NET_EXPORT RequestPriority
 ConvertSpdyPriorityToRequestPriority(spdy::SpdyPriority priority);
 
+// Makes HPACK and QPACK encoders send the headers named `names` as literals
+// without indexing. For headers whose values change with every request, like
+// random padding, which would otherwise be inserted into the dynamic table
+// and evict the headers repeated on every request. Names are lowercase. Set
+// before any session is created.
+NET_EXPORT void SetUnindexedHeaderNames(std::vector<std::string> names);
+
+// The indexing policy of the HPACK and QPACK encoders: the default HPACK one,
+// which indexes :authority of the pseudo-headers, without the names above.
+NET_EXPORT bool ShouldIndexHeader(std::string_view name,
+                                  std::string_view value);
+
 }  // namespace net
 
 #endif  // NET_SPDY_SPDY_HTTP_UTILS_H_
@@ -5,6 +5,7 @@
 #include "net/spdy/spdy_proxy_client_socket.h"
 
 #include <algorithm>  // min
+#include <atomic>
 #include <utility>
 
 #include "base/check_op.h"
@@ -26,12 +27,17 @@
 #include "net/http/http_response_headers.h"
 #include "net/log/net_log_event_type.h"
 #include "net/log/net_log_source_type.h"
+#include "net/spdy/spdy_buffer.h"
 #include "net/spdy/spdy_http_utils.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
 #include "url/gurl.h"
 
 namespace net {
 
+namespace {
+std::atomic<bool> g_half_close_enabled{false};
+}  // namespace
+
 SpdyProxyClientSocket::SpdyProxyClientSocket(
     const base::WeakPtr<SpdyStream>& spdy_stream,
     const ProxyChain& proxy_chain,
@@ -68,6 +74,11 @@ SpdyProxyClientSocket::~SpdyProxyClientSocket() {
   net_log_.EndEvent(NetLogEventType::SOCKET_ALIVE);
 }
 
+// static
+void SpdyProxyClientSocket::SetHalfCloseEnabled(bool enabled) {
+  g_half_close_enabled.store(enabled, std::memory_order_relaxed);
+}
+
 const HttpResponseInfo* SpdyProxyClientSocket::GetConnectResponseInfo() const {
   return response_.headers.get() ? &response_ : nullptr;
 }
@@ -91,7 +102,10 @@ int SpdyProxyClientSocket::RestartWithAuth(CompletionOnceCallback callback) {
 //
 // TODO(mmenke):  Use a single priority value for all SpdyProxyClientSockets,
 // regardless of what priority they're created with.
-void SpdyProxyClientSocket::SetStreamPriority(RequestPriority priority) {}
+void SpdyProxyClientSocket::SetStreamPriority(RequestPriority priority) {
+  if (spdy_stream_)
+    spdy_stream_->SetPriority(priority);
+}
 
 // Sends a HEADERS frame to the proxy with a CONNECT request
 // for the specified endpoint.  Waits for the server to send back
@@ -183,6 +197,20 @@ void SpdyProxyClientSocket::ApplySocketTag(const SocketTag& tag) {
   CHECK(tag == SocketTag());
 }
 
+int SpdyProxyClientSocket::ShutdownWrite() {
+  DCHECK(write_callback_.is_null());
+  if (next_state_ != STATE_OPEN)
+    return ERR_SOCKET_NOT_CONNECTED;
+  if (end_stream_state_ == EndStreamState::kEndStreamSent)
+    return OK;
+
+  DCHECK(spdy_stream_.get());
+  auto buffer = base::MakeRefCounted<IOBufferWithSize>(/*buffer_size=*/0);
+  spdy_stream_->SendData(buffer.get(), /*length=*/0, NO_MORE_DATA_TO_SEND);
+  end_stream_state_ = EndStreamState::kEndStreamSent;
+  return OK;
+}
+
 int SpdyProxyClientSocket::Read(IOBuffer* buf,
                                 int buf_len,
                                 CompletionOnceCallback callback) {
@@ -211,6 +239,7 @@ int SpdyProxyClientSocket::ReadIfReady(IOBuffer* buf,
   DCHECK(buf);
   size_t result = PopulateUserReadBuffer(buf->data(), buf_len);
   if (result == 0) {
+    LiftReadAheadLimit();
     read_callback_ = std::move(callback);
     return ERR_IO_PENDING;
   }
@@ -224,6 +253,48 @@ int SpdyProxyClientSocket::CancelReadIfReady() {
   return OK;
 }
 
+int SpdyProxyClientSocket::ReadSpdyBuffer(std::unique_ptr<SpdyBuffer>* buffer,
+                                          CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  DCHECK(!user_buffer_);
+
+  if (next_state_ == STATE_DISCONNECTED)
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  if (next_state_ == STATE_CLOSED && read_buffer_queue_.IsEmpty()) {
+    return 0;
+  }
+
+  DCHECK(next_state_ == STATE_OPEN || next_state_ == STATE_CLOSED);
+  if (read_buffer_queue_.IsEmpty()) {
+    LiftReadAheadLimit();
+    // Signaled like a pending ReadIfReady() by OnDataReceived().
+    read_callback_ = std::move(callback);
+    return ERR_IO_PENDING;
+  }
+  *buffer = read_buffer_queue_.DequeueBuffer();
+  return static_cast<int>((*buffer)->GetRemainingSize());
+}
+
+size_t SpdyProxyClientSocket::GetReadBacklogSize() const {
+  return read_buffer_queue_.GetTotalSize();
+}
+
+void SpdyProxyClientSocket::SetReadAheadLimit(int32_t limit) {
+  if (!spdy_stream_)
+    return;
+  read_ahead_limited_ = limit > 0;
+  spdy_stream_->SetRecvWindowLimit(limit);
+}
+
+void SpdyProxyClientSocket::LiftReadAheadLimit() {
+  if (!read_ahead_limited_)
+    return;
+  read_ahead_limited_ = false;
+  if (spdy_stream_)
+    spdy_stream_->SetRecvWindowLimit(0);
+}
+
 size_t SpdyProxyClientSocket::PopulateUserReadBuffer(char* data, size_t len) {
   return read_buffer_queue_.Dequeue(data, len);
 }
@@ -233,6 +304,25 @@ int SpdyProxyClientSocket::Write(
     int buf_len,
     CompletionOnceCallback callback,
     const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return WriteData(buf, buf_len, /*in_place=*/false, std::move(callback));
+}
+
+int SpdyProxyClientSocket::GetWriteHeadroom() const {
+  return spdy::kDataFrameMinimumSize;
+}
+
+int SpdyProxyClientSocket::WriteInPlace(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return WriteData(buf, buf_len, /*in_place=*/true, std::move(callback));
+}
+
+int SpdyProxyClientSocket::WriteData(IOBuffer* buf,
+                                     int buf_len,
+                                     bool in_place,
+                                     CompletionOnceCallback callback) {
   DCHECK(write_callback_.is_null());
   if (next_state_ != STATE_OPEN)
     return ERR_SOCKET_NOT_CONNECTED;
@@ -240,9 +330,14 @@ int SpdyProxyClientSocket::Write(
     return ERR_CONNECTION_CLOSED;
 
   DCHECK(spdy_stream_.get());
-  spdy_stream_->SendData(buf, buf_len, MORE_DATA_TO_SEND);
+  // Logged before framing in place can overwrite the data.
   net_log_.AddByteTransferEvent(NetLogEventType::SOCKET_BYTES_SENT, buf_len,
                                 buf->data());
+  if (in_place) {
+    spdy_stream_->SendDataInPlace(buf, buf_len, MORE_DATA_TO_SEND);
+  } else {
+    spdy_stream_->SendData(buf, buf_len, MORE_DATA_TO_SEND);
+  }
   write_callback_ = std::move(callback);
   write_buffer_len_ = buf_len;
   return ERR_IO_PENDING;
@@ -512,7 +607,8 @@ void SpdyProxyClientSocket::OnDataReceived(std::unique_ptr<SpdyBuffer> buffer) {
     net_log_.AddByteTransferEvent(NetLogEventType::SOCKET_BYTES_RECEIVED, 0,
                                   nullptr);
 
-    if (end_stream_state_ == EndStreamState::kNone) {
+    if (end_stream_state_ == EndStreamState::kNone &&
+        !g_half_close_enabled.load(std::memory_order_relaxed)) {
       // The peer sent END_STREAM. Schedule a DATA frame with END_STREAM.
       end_stream_state_ = EndStreamState::kEndStreamReceived;
       base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
@@ -547,10 +643,11 @@ void SpdyProxyClientSocket::OnDataSent() {
   write_buffer_len_ = 0;
 
   // Proxy write callbacks result in deep callback chains. Post to allow the
-  // stream's write callback chain to unwind (see crbug.com/355511).
-  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
-      FROM_HERE, base::BindOnce(&SpdyProxyClientSocket::RunWriteCallback,
-                                weak_factory_.GetWeakPtr(), rv));
+  // stream's write callback chain to unwind (see crbug.com/355511). The
+  // session may hold the completion back until the data has left its socket.
+  spdy_stream_->PostWhenUploadDrained(
+      base::BindOnce(&SpdyProxyClientSocket::RunWriteCallback,
+                     weak_factory_.GetWeakPtr(), rv));
 }
 
 void SpdyProxyClientSocket::OnTrailers(const spdy::Http2HeaderBlock& trailers) {
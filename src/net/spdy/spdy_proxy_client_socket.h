@@ -61,11 +61,26 @@ class NET_EXPORT_PRIVATE SpdyProxyClientSocket : public ProxyClientSocket,
   // On destruction Disconnect() is called.
   ~SpdyProxyClientSocket() override;
 
+  // With `enabled`, the END_STREAM of the peer is no longer answered with one
+  // of this socket once pending writes are done, so reads end while writes
+  // go on until ShutdownWrite(). Process-wide, set before any tunnel starts.
+  static void SetHalfCloseEnabled(bool enabled);
+
   // ProxyClientSocket methods:
   const HttpResponseInfo* GetConnectResponseInfo() const override;
   const scoped_refptr<HttpAuthController>& GetAuthController() const override;
   int RestartWithAuth(CompletionOnceCallback callback) override;
   void SetStreamPriority(RequestPriority priority) override;
+  int ReadSpdyBuffer(std::unique_ptr<SpdyBuffer>* buffer,
+                     CompletionOnceCallback callback) override;
+  size_t GetReadBacklogSize() const override;
+  void SetReadAheadLimit(int32_t limit) override;
+  int GetWriteHeadroom() const override;
+  int WriteInPlace(
+      IOBuffer* buf,
+      int buf_len,
+      CompletionOnceCallback callback,
+      const NetworkTrafficAnnotationTag& traffic_annotation) override;
 
   // StreamSocket implementation.
   int Connect(CompletionOnceCallback callback) override;
@@ -78,6 +93,7 @@ class NET_EXPORT_PRIVATE SpdyProxyClientSocket : public ProxyClientSocket,
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
   void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
 
   // Socket implementation.
   int Read(IOBuffer* buf,
@@ -137,6 +153,15 @@ class NET_EXPORT_PRIVATE SpdyProxyClientSocket : public ProxyClientSocket,
   // and returns the number of bytes read.
   size_t PopulateUserReadBuffer(char* out, size_t len);
 
+  // Write() or WriteInPlace().
+  int WriteData(IOBuffer* buf,
+                int buf_len,
+                bool in_place,
+                CompletionOnceCallback callback);
+
+  // Lifts SetReadAheadLimit() once the buffered data has been read.
+  void LiftReadAheadLimit();
+
   // Called when the peer sent END_STREAM.
   void MaybeSendEndStream();
 
@@ -170,6 +195,8 @@ class NET_EXPORT_PRIVATE SpdyProxyClientSocket : public ProxyClientSocket,
 
   // We buffer the response body as it arrives asynchronously from the stream.
   SpdyReadQueue read_buffer_queue_;
+  // Whether SetReadAheadLimit() holds back the stream's window updates.
+  bool read_ahead_limited_ = false;
 
   // User provided buffer for the Read() response.
   scoped_refptr<IOBuffer> user_buffer_;
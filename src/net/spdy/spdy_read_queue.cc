@@ -51,6 +51,14 @@ size_t SpdyReadQueue::Dequeue(char* out, size_t len) {
   return bytes_copied;
 }
 
+std::unique_ptr<SpdyBuffer> SpdyReadQueue::DequeueBuffer() {
+  DCHECK(!queue_.empty());
+  std::unique_ptr<SpdyBuffer> buffer = std::move(queue_.front());
+  queue_.pop_front();
+  total_size_ -= buffer->GetRemainingSize();
+  return buffer;
+}
+
 void SpdyReadQueue::Clear() {
   queue_.clear();
   total_size_ = 0;
@@ -39,6 +39,9 @@ class NET_EXPORT_PRIVATE SpdyReadQueue {
   // |out|. Returns the number of bytes dequeued.
   size_t Dequeue(char* out, size_t len);
 
+  // Dequeues the first buffer as a whole. The queue must not be empty.
+  std::unique_ptr<SpdyBuffer> DequeueBuffer();
+
   // Removes all bytes from the queue.
   void Clear();
 
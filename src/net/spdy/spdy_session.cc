@@ -4,6 +4,8 @@
 
 #include "net/spdy/spdy_session.h"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <string>
@@ -30,6 +32,7 @@
 #include "base/time/time.h"
 #include "base/trace_event/memory_usage_estimator.h"
 #include "base/values.h"
+#include "build/build_config.h"
 #include "net/base/features.h"
 #include "net/base/proxy_chain.h"
 #include "net/base/proxy_string_util.h"
@@ -67,6 +70,11 @@
 #include "url/scheme_host_port.h"
 #include "url/url_constants.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#endif
+
 namespace net {
 
 namespace {
@@ -97,6 +105,10 @@ const int kReadBufferSize = 8 * 1024;
 const int kDefaultConnectionAtRiskOfLossSeconds = 10;
 const int kHungIntervalSeconds = 10;
 
+// How often the socket is checked for writes held back by
+// SpdySession::EnableUploadLowat() while nothing else is written.
+constexpr base::TimeDelta kUploadDrainCheckInterval = base::Milliseconds(2);
+
 // Default initial value for HTTP/2 SETTINGS.
 const uint32_t kDefaultInitialHeaderTableSize = 4096;
 const uint32_t kDefaultInitialEnablePush = 1;
@@ -798,6 +810,8 @@ SpdySession::SpdySession(
       http_server_properties_(http_server_properties),
       transport_security_state_(transport_security_state),
       ssl_config_service_(ssl_config_service),
+      read_buffer_size_(kReadBufferSize),
+      max_read_buffer_size_(kReadBufferSize),
       stream_hi_water_mark_(kFirstStreamId),
       initial_settings_(initial_settings),
       enable_http2_settings_grease_(enable_http2_settings_grease),
@@ -1091,6 +1105,7 @@ std::unique_ptr<SpdyBuffer> SpdySession::CreateDataBuffer(
     IOBuffer* data,
     int len,
     spdy::SpdyDataFlags flags,
+    bool in_place,
     int* effective_len,
     bool* end_stream) {
   if (availability_state_ == STATE_DRAINING) {
@@ -1173,14 +1188,24 @@ std::unique_ptr<SpdyBuffer> SpdySession::CreateDataBuffer(
   if (*effective_len > 0)
     MaybeSendPrefacePing();
 
-  // TODO(mbelshe): reduce memory copies here.
   DCHECK(buffered_spdy_framer_.get());
-  std::unique_ptr<spdy::SpdySerializedFrame> frame(
-      buffered_spdy_framer_->CreateDataFrame(
-          stream_id, data->data(), static_cast<uint32_t>(*effective_len),
-          flags));
-
-  auto data_buffer = std::make_unique<SpdyBuffer>(std::move(frame));
+  std::unique_ptr<SpdyBuffer> data_buffer;
+  if (in_place) {
+    std::unique_ptr<spdy::SpdySerializedFrame> header(
+        buffered_spdy_framer_->CreateDataFrameHeader(
+            stream_id, static_cast<uint32_t>(*effective_len), flags));
+    DCHECK_EQ(header->size(), spdy::kDataFrameMinimumSize);
+    char* frame = data->data() - header->size();
+    std::memcpy(frame, header->data(), header->size());
+    data_buffer = std::make_unique<SpdyBuffer>(
+        data, frame, header->size() + *effective_len);
+  } else {
+    std::unique_ptr<spdy::SpdySerializedFrame> frame(
+        buffered_spdy_framer_->CreateDataFrame(
+            stream_id, data->data(), static_cast<uint32_t>(*effective_len),
+            flags));
+    data_buffer = std::make_unique<SpdyBuffer>(std::move(frame));
+  }
 
   // Send window size is based on payload size, so nothing to do if this is
   // just a FIN with no payload.
@@ -1279,6 +1304,10 @@ bool SpdySession::GetSSLInfo(SSLInfo* ssl_info) const {
   return socket_->GetSSLInfo(ssl_info);
 }
 
+SocketDescriptor SpdySession::GetTransportSocketDescriptor() const {
+  return socket_ ? socket_->GetTransportSocketDescriptor() : kInvalidSocket;
+}
+
 std::string_view SpdySession::GetAcceptChViaAlps(
     const url::SchemeHostPort& scheme_host_port) const {
   auto it = accept_ch_entries_received_via_alps_.find(scheme_host_port);
@@ -1879,8 +1908,10 @@ int SpdySession::DoReadLoop(ReadState expected_read_state, int result) {
     if (result == ERR_IO_PENDING)
       break;
 
+    // Larger reads take as many of them per pass.
     if (read_state_ == READ_STATE_DO_READ &&
-        (bytes_read_without_yielding > kYieldAfterBytesRead ||
+        (bytes_read_without_yielding >
+             std::max(kYieldAfterBytesRead, 4 * max_read_buffer_size_) ||
          time_func_() > yield_after_time)) {
       base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
           FROM_HERE,
@@ -1903,9 +1934,9 @@ int SpdySession::DoRead() {
 
   CHECK(socket_);
   read_state_ = READ_STATE_DO_READ_COMPLETE;
-  read_buffer_ = base::MakeRefCounted<IOBufferWithSize>(kReadBufferSize);
+  read_buffer_ = base::MakeRefCounted<IOBufferWithSize>(read_buffer_size_);
   int rv = socket_->ReadIfReady(
-      read_buffer_.get(), kReadBufferSize,
+      read_buffer_.get(), read_buffer_size_,
       base::BindOnce(&SpdySession::PumpReadLoop, weak_factory_.GetWeakPtr(),
                      READ_STATE_DO_READ));
   if (rv == ERR_IO_PENDING) {
@@ -1916,7 +1947,7 @@ int SpdySession::DoRead() {
   if (rv == ERR_READ_IF_READY_NOT_IMPLEMENTED) {
     // Fallback to regular Read().
     return socket_->Read(
-        read_buffer_.get(), kReadBufferSize,
+        read_buffer_.get(), read_buffer_size_,
         base::BindOnce(&SpdySession::PumpReadLoop, weak_factory_.GetWeakPtr(),
                        READ_STATE_DO_READ_COMPLETE));
   }
@@ -1928,7 +1959,7 @@ int SpdySession::DoReadComplete(int result) {
   CHECK(in_io_loop_);
 
   // Parse a frame.  For now this code requires that the frame fit into our
-  // buffer (kReadBufferSize).
+  // buffer (read_buffer_size_).
   // TODO(mbelshe): support arbitrarily large frames!
 
   if (result == 0) {
@@ -1942,9 +1973,14 @@ int SpdySession::DoReadComplete(int result) {
         base::StringPrintf("Error %d reading from socket.", -result));
     return result;
   }
-  CHECK_LE(result, kReadBufferSize);
+  CHECK_LE(result, read_buffer_size_);
 
   last_read_time_ = time_func_();
+  if (result == read_buffer_size_) {
+    read_buffer_size_ = std::min(read_buffer_size_ * 2, max_read_buffer_size_);
+  } else if (result < read_buffer_size_ / 4) {
+    read_buffer_size_ = std::max(read_buffer_size_ / 2, kReadBufferSize);
+  }
 
   DCHECK(buffered_spdy_framer_.get());
   char* data = read_buffer_->data();
@@ -1981,13 +2017,18 @@ void SpdySession::PumpWriteLoop(WriteState expected_write_state, int result) {
 }
 
 void SpdySession::MaybePostWriteLoop() {
+  MaybePostDelayedWriteLoop(base::TimeDelta());
+}
+
+void SpdySession::MaybePostDelayedWriteLoop(base::TimeDelta delay) {
   if (write_state_ == WRITE_STATE_IDLE) {
     CHECK(!in_flight_write_);
     write_state_ = WRITE_STATE_DO_WRITE;
-    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
         FROM_HERE,
         base::BindOnce(&SpdySession::PumpWriteLoop, weak_factory_.GetWeakPtr(),
-                       WRITE_STATE_DO_WRITE, OK));
+                       WRITE_STATE_DO_WRITE, OK),
+        delay);
   }
 }
 
@@ -2074,8 +2115,15 @@ int SpdySession::DoWrite() {
     }
     in_flight_write_frame_type_ = frame_type;
     in_flight_write_frame_size_ = in_flight_write_->GetRemainingSize();
+    if (stream.get()) {
+      write_queue_.ChargeStream(stream->stream_id(),
+                                in_flight_write_frame_size_);
+    }
     DCHECK_GE(in_flight_write_frame_size_, spdy::kFrameMinimumSize);
     in_flight_write_stream_ = stream;
+
+    if (write_coalescing_size_ > 0)
+      CoalesceWrites();
   }
 
   write_state_ = WRITE_STATE_DO_WRITE_COMPLETE;
@@ -2101,6 +2149,8 @@ int SpdySession::DoWriteComplete(int result) {
     in_flight_write_frame_size_ = 0;
     in_flight_write_stream_.reset();
     in_flight_write_traffic_annotation_.reset();
+    in_flight_coalesced_frames_.clear();
+    in_flight_coalesced_size_ = 0;
     write_state_ = WRITE_STATE_DO_WRITE;
     DoDrainSession(static_cast<Error>(result), "Write error");
     return OK;
@@ -2110,33 +2160,110 @@ int SpdySession::DoWriteComplete(int result) {
   // in_flight_write_.
   DCHECK_LE(static_cast<size_t>(result), in_flight_write_->GetRemainingSize());
 
-  if (result > 0) {
-    in_flight_write_->Consume(static_cast<size_t>(result));
+  // Written bytes are accounted to each frame of a coalesced write in turn.
+  size_t bytes_left = static_cast<size_t>(result);
+  while (bytes_left > 0) {
+    size_t frame_remaining =
+        in_flight_write_->GetRemainingSize() - in_flight_coalesced_size_;
+    size_t bytes = std::min(bytes_left, frame_remaining);
+    bytes_left -= bytes;
+    in_flight_write_->Consume(bytes);
+    bytes_written_ += bytes;
     if (in_flight_write_stream_.get())
-      in_flight_write_stream_->AddRawSentBytes(static_cast<size_t>(result));
+      in_flight_write_stream_->AddRawSentBytes(bytes);
 
     // We only notify the stream when we've fully written the pending frame.
-    if (in_flight_write_->GetRemainingSize() == 0) {
-      // It is possible that the stream was cancelled while we were
-      // writing to the socket.
-      if (in_flight_write_stream_.get()) {
-        DCHECK_GT(in_flight_write_frame_size_, 0u);
-        in_flight_write_stream_->OnFrameWriteComplete(
-            in_flight_write_frame_type_, in_flight_write_frame_size_);
-      }
+    if (bytes < frame_remaining)
+      break;
 
-      // Cleanup the write which just completed.
-      in_flight_write_.reset();
-      in_flight_write_frame_type_ = spdy::SpdyFrameType::DATA;
-      in_flight_write_frame_size_ = 0;
-      in_flight_write_stream_.reset();
+    // It is possible that the stream was cancelled while we were
+    // writing to the socket.
+    if (in_flight_write_stream_.get()) {
+      DCHECK_GT(in_flight_write_frame_size_, 0u);
+      in_flight_write_stream_->OnFrameWriteComplete(
+          in_flight_write_frame_type_, in_flight_write_frame_size_);
+    }
+
+    if (!in_flight_coalesced_frames_.empty()) {
+      CoalescedFrame& next_frame = in_flight_coalesced_frames_.front();
+      in_flight_write_frame_type_ = next_frame.frame_type;
+      in_flight_write_frame_size_ = next_frame.frame_size;
+      in_flight_write_stream_ = next_frame.stream;
+      in_flight_coalesced_size_ -= next_frame.frame_size;
+      in_flight_coalesced_frames_.pop_front();
+      continue;
     }
+
+    // Cleanup the write which just completed.
+    DCHECK_EQ(bytes_left, 0u);
+    in_flight_write_.reset();
+    in_flight_write_frame_type_ = spdy::SpdyFrameType::DATA;
+    in_flight_write_frame_size_ = 0;
+    in_flight_write_stream_.reset();
   }
 
+  // The socket is likely to have sent more by the time it takes another
+  // write.
+  if (!upload_drain_waiters_.empty())
+    CheckUploadDrains();
+
   write_state_ = WRITE_STATE_DO_WRITE;
   return OK;
 }
 
+void SpdySession::CoalesceWrites() {
+  DCHECK(in_flight_coalesced_frames_.empty());
+  std::vector<std::unique_ptr<SpdyBuffer>> buffers;
+  size_t total_size = in_flight_write_->GetRemainingSize();
+  spdy::SpdyFrameType frame_type;
+  // Only frames already queued are taken, so coalescing never delays a
+  // write. The HEADERS frame taking the last stream ID is left to DoWrite(),
+  // which makes the session unavailable then.
+  while (total_size < write_coalescing_size_ &&
+         write_queue_.PeekFrameType(&frame_type) &&
+         (frame_type != spdy::SpdyFrameType::HEADERS ||
+          stream_hi_water_mark_ < kLastStreamId)) {
+    std::unique_ptr<SpdyBufferProducer> producer;
+    base::WeakPtr<SpdyStream> stream;
+    MutableNetworkTrafficAnnotationTag traffic_annotation;
+    write_queue_.Dequeue(&frame_type, &producer, &stream, &traffic_annotation);
+    if (stream.get())
+      CHECK(!stream->IsClosed());
+    // Activated in write order, as in DoWrite(), before the frame carrying
+    // the stream ID is produced.
+    if (frame_type == spdy::SpdyFrameType::HEADERS) {
+      CHECK(stream.get());
+      InsertActivatedStream(ActivateCreatedStream(stream.get()));
+    }
+    std::unique_ptr<SpdyBuffer> buffer = producer->ProduceBuffer();
+    CHECK(buffer);
+    size_t frame_size = buffer->GetRemainingSize();
+    if (stream.get())
+      write_queue_.ChargeStream(stream->stream_id(), frame_size);
+    total_size += frame_size;
+    in_flight_coalesced_frames_.push_back({frame_type, frame_size, stream});
+    buffers.push_back(std::move(buffer));
+  }
+  if (buffers.empty())
+    return;
+
+  // Consuming the frames copied returns their flow control accounting as
+  // if they were written.
+  auto data = std::make_unique<char[]>(total_size);
+  size_t offset = in_flight_write_->GetRemainingSize();
+  memcpy(data.get(), in_flight_write_->GetRemainingData(), offset);
+  for (const std::unique_ptr<SpdyBuffer>& buffer : buffers) {
+    size_t size = buffer->GetRemainingSize();
+    memcpy(data.get() + offset, buffer->GetRemainingData(), size);
+    offset += size;
+    buffer->Consume(size);
+  }
+  in_flight_write_->Consume(in_flight_write_->GetRemainingSize());
+  in_flight_coalesced_size_ = total_size - in_flight_write_frame_size_;
+  in_flight_write_ = std::make_unique<SpdyBuffer>(
+      std::make_unique<spdy::SpdySerializedFrame>(std::move(data), total_size));
+}
+
 void SpdySession::NotifyRequestsOfConfirmation(int rv) {
   for (auto& callback : waiting_for_confirmation_callbacks_) {
     base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
@@ -2341,6 +2468,49 @@ void SpdySession::MaybeSendPrefacePing() {
     WritePingFrame(next_ping_id_, false);
 }
 
+void SpdySession::EnablePingProbe(base::TimeDelta interval,
+                                  base::TimeDelta min_timeout,
+                                  bool aligned) {
+  ping_probe_interval_ = interval;
+  ping_probe_min_timeout_ = min_timeout;
+  ping_probe_aligned_ = aligned;
+  if (!ping_probe_interval_.is_positive())
+    return;
+  ScheduleProbe();
+}
+
+void SpdySession::ProbeConnection() {
+  if (availability_state_ == STATE_DRAINING)
+    return;
+
+  // Anything read since the last probe shows the connection alive.
+  if (buffered_spdy_framer_ && enable_ping_based_connection_checking_ &&
+      !ping_in_flight_ && !check_ping_status_pending_ &&
+      time_func_() >= last_read_time_ + ping_probe_interval_) {
+    hung_interval_ = std::max(ping_probe_min_timeout_, 4 * smoothed_ping_rtt_);
+    WritePingFrame(next_ping_id_, false);
+  }
+
+  ScheduleProbe();
+}
+
+void SpdySession::ScheduleProbe() {
+  base::TimeDelta delay = ping_probe_interval_;
+  if (ping_probe_aligned_) {
+    // Like base::MetronomeTimer, at least half an interval out so a late
+    // probe does not run again right away.
+    base::TimeTicks now = base::TimeTicks::Now();
+    delay = (now + ping_probe_interval_ / 2)
+                .SnappedToNextTick(base::TimeTicks(), ping_probe_interval_) -
+            now;
+  }
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&SpdySession::ProbeConnection,
+                     weak_factory_.GetWeakPtr()),
+      delay);
+}
+
 void SpdySession::SendWindowUpdateFrame(spdy::SpdyStreamId stream_id,
                                         uint32_t delta_window_size,
                                         RequestPriority priority) {
@@ -2482,6 +2652,16 @@ void SpdySession::EnqueueWrite(
 
   write_queue_.Enqueue(priority, frame_type, std::move(producer), stream,
                        traffic_annotation);
+  if (frame_type == spdy::SpdyFrameType::HEADERS &&
+      headers_batching_window_.is_positive()) {
+    base::TimeTicks now = time_func_();
+    bool in_burst = now - last_headers_queued_time_ < headers_batching_window_;
+    last_headers_queued_time_ = now;
+    if (in_burst) {
+      MaybePostDelayedWriteLoop(headers_batching_window_);
+      return;
+    }
+  }
   MaybePostWriteLoop();
 }
 
@@ -2520,6 +2700,10 @@ void SpdySession::DeleteStream(std::unique_ptr<SpdyStream> stream, int status) {
     // without notifying |in_flight_write_stream_|.
     in_flight_write_stream_.reset();
   }
+  for (CoalescedFrame& frame : in_flight_coalesced_frames_) {
+    if (frame.stream.get() == stream.get())
+      frame.stream.reset();
+  }
 
   write_queue_.RemovePendingWritesForStream(stream.get());
   if (stream->detect_broken_connection())
@@ -2706,6 +2890,11 @@ void SpdySession::OnPing(spdy::SpdyPingId unique_id, bool is_ack) {
 
   // Record RTT in histogram when there are no more pings in flight.
   base::TimeDelta ping_duration = time_func_() - last_ping_sent_time_;
+  if (min_ping_rtt_.is_zero() || ping_duration < min_ping_rtt_)
+    min_ping_rtt_ = ping_duration;
+  smoothed_ping_rtt_ = smoothed_ping_rtt_.is_zero()
+                           ? ping_duration
+                           : (7 * smoothed_ping_rtt_ + ping_duration) / 8;
   if (network_quality_estimator_) {
     network_quality_estimator_->RecordSpdyPingLatency(host_port_pair(),
                                                       ping_duration);
@@ -2770,7 +2959,11 @@ void SpdySession::OnGoAway(spdy::SpdyStreamId last_accepted_stream_id,
                           last_accepted_stream_id, active_streams_.size(),
                           error_code, debug_data, capture_mode);
                     });
+  const bool was_available = availability_state_ == STATE_AVAILABLE;
   MakeUnavailable();
+  if (was_available) {
+    pool_->OnSessionGoAway(spdy_session_key_.network_anonymization_key());
+  }
   if (error_code == spdy::ERROR_CODE_HTTP_1_1_REQUIRED) {
     // TODO(bnc): Record histogram with number of open streams capped at 50.
     DoDrainSession(ERR_HTTP_1_1_REQUIRED, "HTTP_1_1_REQUIRED for stream.");
@@ -2822,7 +3015,7 @@ void SpdySession::OnStreamFrameData(spdy::SpdyStreamId stream_id,
   std::unique_ptr<SpdyBuffer> buffer;
   if (data) {
     DCHECK_GT(len, 0u);
-    CHECK_LE(len, static_cast<size_t>(kReadBufferSize));
+    CHECK_LE(len, static_cast<size_t>(max_read_buffer_size_));
     buffer = std::make_unique<SpdyBuffer>(data, len);
 
     DecreaseRecvWindowSize(static_cast<int32_t>(len));
@@ -3070,6 +3263,11 @@ void SpdySession::OnSendCompressedFrame(spdy::SpdyStreamId stream_id,
 
   DCHECK(buffered_spdy_framer_.get());
   size_t compressed_len = frame_len - spdy::kFrameMinimumSize;
+  if (header_encoder_stats_) {
+    ++header_encoder_stats_->frames;
+    header_encoder_stats_->uncompressed_bytes += payload_len;
+    header_encoder_stats_->compressed_bytes += compressed_len;
+  }
 
   if (payload_len) {
     // Make sure we avoid early decimal truncation.
@@ -3187,6 +3385,15 @@ void SpdySession::IncreaseRecvWindowSize(int32_t delta_window_size) {
       base::TimeTicks::Now() - last_recv_window_update_;
   if (session_unacked_recv_window_bytes_ > session_max_recv_window_size_ / 2 ||
       elapsed >= time_to_buffer_small_window_updates_) {
+    int32_t max_window_size =
+        AutotuneRecvWindowSize(session_max_recv_window_size_, elapsed);
+    if (max_window_size > session_max_recv_window_size_) {
+      // Advertised with this update.
+      int32_t delta = max_window_size - session_max_recv_window_size_;
+      session_max_recv_window_size_ = max_window_size;
+      session_recv_window_size_ += delta;
+      session_unacked_recv_window_bytes_ += delta;
+    }
     last_recv_window_update_ = base::TimeTicks::Now();
     SendWindowUpdateFrame(spdy::kSessionFlowControlStreamId,
                           session_unacked_recv_window_bytes_, HIGHEST);
@@ -3194,6 +3401,73 @@ void SpdySession::IncreaseRecvWindowSize(int32_t delta_window_size) {
   }
 }
 
+void SpdySession::EnableAdaptiveReadSize(int max_read_size) {
+  max_read_buffer_size_ = std::max(max_read_size, kReadBufferSize);
+  read_buffer_size_ = std::min(read_buffer_size_, max_read_buffer_size_);
+}
+
+void SpdySession::PostWhenUploadDrained(base::OnceClosure callback) {
+  // The socket sends in order, so all it has not sent yet was written before
+  // |callback|'s bytes.
+  if (upload_notsent_lowat_ <= 0 || GetUnsentBytes() < upload_notsent_lowat_) {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, std::move(callback));
+    return;
+  }
+  upload_drain_waiters_.emplace_back(bytes_written_, std::move(callback));
+  if (!upload_drain_timer_.IsRunning()) {
+    upload_drain_timer_.Start(FROM_HERE, kUploadDrainCheckInterval,
+                              base::BindOnce(&SpdySession::CheckUploadDrains,
+                                             weak_factory_.GetWeakPtr()));
+  }
+}
+
+int SpdySession::GetUnsentBytes() const {
+#if BUILDFLAG(IS_LINUX)
+  // Counts the TLS record overhead of the bytes, which is small enough.
+  int unsent = 0;
+  SocketDescriptor fd = GetTransportSocketDescriptor();
+  if (fd != kInvalidSocket && ioctl(fd, SIOCOUTQNSD, &unsent) == 0)
+    return unsent;
+#endif
+  return 0;
+}
+
+void SpdySession::CheckUploadDrains() {
+  int64_t bytes_sent = bytes_written_ - GetUnsentBytes();
+  while (!upload_drain_waiters_.empty() &&
+         upload_drain_waiters_.front().first - bytes_sent <
+             upload_notsent_lowat_) {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, std::move(upload_drain_waiters_.front().second));
+    upload_drain_waiters_.pop_front();
+  }
+  if (upload_drain_waiters_.empty()) {
+    upload_drain_timer_.Stop();
+  } else if (!upload_drain_timer_.IsRunning()) {
+    upload_drain_timer_.Start(FROM_HERE, kUploadDrainCheckInterval,
+                              base::BindOnce(&SpdySession::CheckUploadDrains,
+                                             weak_factory_.GetWeakPtr()));
+  }
+}
+
+int32_t SpdySession::AutotuneRecvWindowSize(int32_t max_window_size,
+                                            base::TimeDelta update_interval) {
+  if (max_window_size >= recv_window_autotune_max_)
+    return max_window_size;
+  if (min_ping_rtt_.is_zero()) {
+    // Measures the round trip for the next update.
+    if (!ping_in_flight_ && !check_ping_status_pending_)
+      WritePingFrame(next_ping_id_, false);
+    return max_window_size;
+  }
+  if (update_interval >= 2 * min_ping_rtt_)
+    return max_window_size;
+  return static_cast<int32_t>(
+      std::min(static_cast<int64_t>(max_window_size) * 2,
+               static_cast<int64_t>(recv_window_autotune_max_)));
+}
+
 void SpdySession::DecreaseRecvWindowSize(int32_t delta_window_size) {
   CHECK(in_io_loop_);
   DCHECK_GE(delta_window_size, 1);
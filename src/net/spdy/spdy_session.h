@@ -14,6 +14,7 @@
 #include <set>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "base/containers/circular_deque.h"
@@ -448,10 +449,14 @@ class NET_EXPORT SpdySession
   // Sets |*effective_len| to number of bytes sent, and |*end_stream| to the
   // value of the END_STREAM (also known as fin) flag.  Returns nullptr if
   // session is draining or if session or stream is stalled by flow control.
+  // If |in_place|, the frame header is written over the
+  // spdy::kDataFrameMinimumSize bytes before |data| and the frame refers to
+  // |data| instead of copying it, see SpdyStream::SendDataInPlace().
   std::unique_ptr<SpdyBuffer> CreateDataBuffer(spdy::SpdyStreamId stream_id,
                                                IOBuffer* data,
                                                int len,
                                                spdy::SpdyDataFlags flags,
+                                               bool in_place,
                                                int* effective_len,
                                                bool* end_stream);
 
@@ -510,6 +515,85 @@ class NET_EXPORT SpdySession
     return time_to_buffer_small_window_updates_;
   }
 
+  // Lets the session and stream receive windows grow up to
+  // |max_window_size| when the peer is limited by them. 0 disables it.
+  void EnableRecvWindowAutotune(int32_t max_window_size) {
+    recv_window_autotune_max_ = max_window_size;
+  }
+
+  // Returns the receive window that should follow |max_window_size|, given
+  // that half of it was consumed in |update_interval|. The window doubles if
+  // that took less than two round trips, as the bandwidth-delay product
+  // estimated from the delivery rate and the minimum PING round trip then
+  // exceeds what the window allows.
+  int32_t AutotuneRecvWindowSize(int32_t max_window_size,
+                                 base::TimeDelta update_interval);
+
+  // Lets socket reads grow from 8 KiB up to |max_read_size| while each
+  // fills its buffer, doubling at a time, and shrink back by half after one
+  // that took less than a quarter, so a session receiving at a high rate
+  // drains it in fewer, larger reads per pass of the read loop. Sizes up to
+  // 8 KiB keep the fixed size.
+  void EnableAdaptiveReadSize(int max_read_size);
+
+  // Holds back PostWhenUploadDrained() while |notsent_lowat| or more bytes
+  // of the writes it waits for are still unsent in the kernel. Linux only.
+  // Zero disables it.
+  void EnableUploadLowat(int notsent_lowat) {
+    upload_notsent_lowat_ = notsent_lowat;
+  }
+
+  // Posts |callback| once fewer than the EnableUploadLowat() mark of the
+  // bytes written to the socket so far are unsent, or right away without
+  // one. The bytes of other streams written before count, and those written
+  // after do not, so a stream completes its DATA writes with it to keep a
+  // bulk upload from queueing megabytes in the socket ahead of other
+  // streams, without waiting for what they write meanwhile.
+  void PostWhenUploadDrained(base::OnceClosure callback);
+
+  // Lets frames queued behind the one being written go out in the same
+  // socket write while it is smaller than |max_write_size|, instead of one
+  // write each. 0 disables it.
+  void EnableWriteCoalescing(size_t max_write_size) {
+    write_coalescing_size_ = max_write_size;
+  }
+
+  // Holds the write loop for up to |window| when a HEADERS frame is queued
+  // within |window| of the previous one, so the streams opened in a burst
+  // share a coalesced write instead of a TLS record and a syscall each. The
+  // first stream of a burst is not held. Needs write coalescing. Zero
+  // disables it.
+  void EnableHeadersBatching(base::TimeDelta window) {
+    headers_batching_window_ = window;
+  }
+
+  // Sends a PING every |interval| in which nothing was read, and drains the
+  // session with ERR_HTTP2_PING_FAILED if then nothing is read for the
+  // larger of |min_timeout| and four smoothed PING round trips, so a peer
+  // gone silently is noticed before its streams hang. With |aligned| the
+  // probes run on multiples of |interval| since the TimeTicks origin, so
+  // those of all sessions share one wakeup. Zero |interval| disables it.
+  void EnablePingProbe(base::TimeDelta interval,
+                       base::TimeDelta min_timeout,
+                       bool aligned = false);
+
+  // Adds the sizes of sent HEADERS frames to |stats|, which must outlive the
+  // session.
+  void set_header_encoder_stats(SpdyHeaderEncoderStats* stats) {
+    header_encoder_stats_ = stats;
+  }
+
+  // The descriptor of the TCP socket carrying the session, or
+  // kInvalidSocket, see StreamSocket::GetTransportSocketDescriptor().
+  SocketDescriptor GetTransportSocketDescriptor() const;
+
+  // Shares the send path among the streams of a priority by the bytes they
+  // write, |quantum| bytes each a round, see
+  // SpdyWriteQueue::EnableFairScheduling(). 0 disables it.
+  void EnableFairWriteScheduling(size_t quantum) {
+    write_queue_.EnableFairScheduling(quantum);
+  }
+
   // Accessors for the session's availability state.
   bool IsAvailable() const { return availability_state_ == STATE_AVAILABLE; }
   bool IsGoingAway() const { return availability_state_ == STATE_GOING_AWAY; }
@@ -742,6 +826,8 @@ class NET_EXPORT SpdySession
   // Iff the write loop is not currently active, posts a callback into
   // PumpWriteLoop().
   void MaybePostWriteLoop();
+  // Likewise, running the callback after |delay|.
+  void MaybePostDelayedWriteLoop(base::TimeDelta delay);
 
   // Advance the WriteState state machine. |expected_write_state| is
   // the expected starting write state.
@@ -752,6 +838,18 @@ class NET_EXPORT SpdySession
   int DoWrite();
   int DoWriteComplete(int result);
 
+  // Appends frames ready in the write queue to |in_flight_write_|, up to
+  // |write_coalescing_size_|, activating the streams of HEADERS frames.
+  void CoalesceWrites();
+
+  // Returns the bytes written to the socket that the kernel has not sent
+  // yet, or 0 where that is not known.
+  int GetUnsentBytes() const;
+
+  // Posts the callbacks of PostWhenUploadDrained() whose bytes drained, and
+  // checks again later while some have not.
+  void CheckUploadDrains();
+
   void NotifyRequestsOfConfirmation(int rv);
 
   // TODO(akalin): Rename the Send* and Write* functions below to
@@ -784,6 +882,10 @@ class NET_EXPORT SpdySession
   // and too long time has passed since last read from server.
   void MaybeSendPrefacePing();
 
+  // Sends the PING of EnablePingProbe() if due and schedules the next.
+  void ProbeConnection();
+  void ScheduleProbe();
+
   // Send a single WINDOW_UPDATE frame.
   void SendWindowUpdateFrame(spdy::SpdyStreamId stream_id,
                              uint32_t delta_window_size,
@@ -1036,6 +1138,20 @@ class NET_EXPORT SpdySession
   // The read buffer used to read data from the socket.
   // Non-null if there is a Read() pending.
   scoped_refptr<IOBuffer> read_buffer_;
+  // Of the next read, and its upper bound, see EnableAdaptiveReadSize().
+  int read_buffer_size_;
+  int max_read_buffer_size_;
+
+  // Bytes written to the socket so far.
+  int64_t bytes_written_ = 0;
+  // See EnableUploadLowat().
+  int upload_notsent_lowat_ = 0;
+  // Callbacks of PostWhenUploadDrained() with |bytes_written_| as of the
+  // call, oldest first.
+  base::circular_deque<std::pair<int64_t, base::OnceClosure>>
+      upload_drain_waiters_;
+  // Checks the waiters while the session writes nothing else.
+  base::OneShotTimer upload_drain_timer_;
 
   spdy::SpdyStreamId stream_hi_water_mark_;  // The next stream id to use.
 
@@ -1079,6 +1195,25 @@ class NET_EXPORT SpdySession
   // Traffic annotation for the write in progress.
   MutableNetworkTrafficAnnotationTag in_flight_write_traffic_annotation_;
 
+  // A frame coalesced into |in_flight_write_|.
+  struct CoalescedFrame {
+    spdy::SpdyFrameType frame_type;
+    size_t frame_size;
+    base::WeakPtr<SpdyStream> stream;
+  };
+  // The frames in |in_flight_write_| after the one described above, in
+  // order, and their total size.
+  base::circular_deque<CoalescedFrame> in_flight_coalesced_frames_;
+  size_t in_flight_coalesced_size_ = 0;
+
+  // Upper bound of coalesced writes, 0 if disabled.
+  size_t write_coalescing_size_ = 0;
+
+  // See EnableHeadersBatching(), zero if disabled.
+  base::TimeDelta headers_batching_window_;
+  // When the last HEADERS frame was queued.
+  base::TimeTicks last_headers_queued_time_;
+
   // Spdy Frame state.
   std::unique_ptr<BufferedSpdyFramer> buffered_spdy_framer_;
 
@@ -1209,6 +1344,22 @@ class NET_EXPORT SpdySession
   // Time to accumilate small receive window updates for.
   base::TimeDelta time_to_buffer_small_window_updates_;
 
+  // Upper bound of receive window autotuning, 0 if disabled.
+  int32_t recv_window_autotune_max_ = 0;
+
+  // The smallest PING round trip seen, zero until the first PING ACK.
+  base::TimeDelta min_ping_rtt_;
+  // Its weighted average, for the deadline of the probe PINGs.
+  base::TimeDelta smoothed_ping_rtt_;
+
+  // Of EnablePingProbe(), zero if disabled.
+  base::TimeDelta ping_probe_interval_;
+  base::TimeDelta ping_probe_min_timeout_;
+  bool ping_probe_aligned_ = false;
+
+  // Of set_header_encoder_stats(), may be null.
+  raw_ptr<SpdyHeaderEncoderStats> header_encoder_stats_ = nullptr;
+
   // Initial send window size for this session's streams. Can be
   // changed by an arriving SETTINGS frame. Newly created streams use
   // this value for the initial send window size.
@@ -484,6 +484,31 @@ void SpdySessionPool::CloseAllSessions() {
   }
 }
 
+void SpdySessionPool::CloseSessionsForNetworkAnonymizationKey(
+    const NetworkAnonymizationKey& network_anonymization_key,
+    const std::string& description) {
+  WeakSessionList current_sessions = GetCurrentSessions();
+  for (base::WeakPtr<SpdySession>& session : current_sessions) {
+    if (!session || session->IsDraining())
+      continue;
+    if (session->spdy_session_key().network_anonymization_key() !=
+        network_anonymization_key) {
+      continue;
+    }
+    session->CloseSessionOnError(ERR_ABORTED, description);
+  }
+}
+
+base::CallbackListSubscription SpdySessionPool::AddGoAwayCallback(
+    GoAwayCallback callback) {
+  return go_away_callbacks_.Add(std::move(callback));
+}
+
+void SpdySessionPool::OnSessionGoAway(
+    const NetworkAnonymizationKey& network_anonymization_key) {
+  go_away_callbacks_.Notify(network_anonymization_key);
+}
+
 void SpdySessionPool::MakeCurrentSessionsGoingAway(Error error) {
   WeakSessionList current_sessions = GetCurrentSessions();
   for (base::WeakPtr<SpdySession>& session : current_sessions) {
@@ -514,6 +539,17 @@ std::unique_ptr<base::Value> SpdySessionPool::SpdySessionPoolInfoToValue()
   return std::make_unique<base::Value>(std::move(list));
 }
 
+std::vector<SocketDescriptor> SpdySessionPool::GetTransportSocketDescriptors()
+    const {
+  std::vector<SocketDescriptor> descriptors;
+  for (SpdySession* session : sessions_) {
+    SocketDescriptor descriptor = session->GetTransportSocketDescriptor();
+    if (descriptor != kInvalidSocket)
+      descriptors.push_back(descriptor);
+  }
+  return descriptors;
+}
+
 void SpdySessionPool::OnIPAddressChanged() {
   DCHECK(cleanup_sessions_on_ip_address_changed_);
   if (go_away_on_ip_change_) {
@@ -704,7 +740,7 @@ std::unique_ptr<SpdySession> SpdySessionPool::CreateSession(
     RemoveAliases(key);
   }
 
-  return std::make_unique<SpdySession>(
+  auto session = std::make_unique<SpdySession>(
       key, http_server_properties_, transport_security_state_,
       ssl_client_context_ ? ssl_client_context_->ssl_config_service() : nullptr,
       quic_supported_versions_, enable_sending_initial_data_,
@@ -714,6 +750,16 @@ std::unique_ptr<SpdySession> SpdySessionPool::CreateSession(
       enable_http2_settings_grease_, greased_http2_frame_,
       http2_end_stream_with_data_frame_, enable_priority_update_, time_func_,
       network_quality_estimator_, net_log);
+  session->EnableRecvWindowAutotune(recv_window_autotune_max_);
+  session->EnableAdaptiveReadSize(max_read_size_);
+  session->EnableUploadLowat(upload_notsent_lowat_);
+  session->EnableWriteCoalescing(write_coalescing_size_);
+  session->EnableFairWriteScheduling(write_quantum_);
+  session->EnableHeadersBatching(headers_batching_window_);
+  session->EnablePingProbe(ping_probe_interval_, ping_probe_min_timeout_,
+                           ping_probe_aligned_);
+  session->set_header_encoder_stats(&header_encoder_stats_);
+  return session;
 }
 
 base::WeakPtr<SpdySession> SpdySessionPool::InsertSession(
@@ -6,6 +6,7 @@
 #define NET_SPDY_SPDY_SESSION_POOL_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <list>
 #include <map>
@@ -15,8 +16,10 @@
 #include <string>
 #include <vector>
 
+#include "base/callback_list.h"
 #include "base/memory/raw_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
 #include "net/base/host_port_pair.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/load_timing_info.h"
@@ -28,6 +31,7 @@
 #include "net/log/net_log_source.h"
 #include "net/proxy_resolution/proxy_config.h"
 #include "net/socket/connect_job.h"
+#include "net/socket/socket_descriptor.h"
 #include "net/socket/ssl_client_socket.h"
 #include "net/spdy/spdy_session_key.h"
 #include "net/ssl/ssl_config_service.h"
@@ -45,6 +49,15 @@ class SpdySession;
 class StreamSocket;
 class TransportSecurityState;
 
+// Totals of the HEADERS frames sent by the sessions of a pool.
+struct SpdyHeaderEncoderStats {
+  uint64_t frames = 0;
+  // Of the header blocks before HPACK.
+  uint64_t uncompressed_bytes = 0;
+  // Of the frame payloads.
+  uint64_t compressed_bytes = 0;
+};
+
 // This is a very simple pool for open SpdySessions.
 class NET_EXPORT SpdySessionPool
     : public NetworkChangeNotifier::IPAddressObserver,
@@ -279,6 +292,23 @@ class NET_EXPORT SpdySessionPool
   // the process of closing those new ones, etc.) are unavailable.
   void CloseAllSessions();
 
+  // Closes the current sessions of |network_anonymization_key| along with
+  // their streams, such as idle tunnels left in the socket pools.
+  void CloseSessionsForNetworkAnonymizationKey(
+      const NetworkAnonymizationKey& network_anonymization_key,
+      const std::string& description);
+
+  // Runs `callback` with the NetworkAnonymizationKey of each session that
+  // receives a GOAWAY, for a replacement to be opened while its streams
+  // finish, until the subscription is destroyed.
+  using GoAwayCallback =
+      base::RepeatingCallback<void(const NetworkAnonymizationKey&)>;
+  base::CallbackListSubscription AddGoAwayCallback(GoAwayCallback callback);
+
+  // Called by sessions receiving their first GOAWAY.
+  void OnSessionGoAway(
+      const NetworkAnonymizationKey& network_anonymization_key);
+
   // Mark all current sessions as going away.
   void MakeCurrentSessionsGoingAway(Error error);
 
@@ -313,6 +343,65 @@ class NET_EXPORT SpdySessionPool
     network_quality_estimator_ = network_quality_estimator;
   }
 
+  // Lets receive windows of new sessions grow up to |max_window_size|, see
+  // SpdySession::EnableRecvWindowAutotune(). 0 disables it.
+  void set_recv_window_autotune_max(int32_t max_window_size) {
+    recv_window_autotune_max_ = max_window_size;
+  }
+
+  // Lets socket reads of new sessions grow up to |max_read_size|, see
+  // SpdySession::EnableAdaptiveReadSize(). 0 keeps them fixed.
+  void set_max_read_size(int max_read_size) { max_read_size_ = max_read_size; }
+
+  // Holds back the tunnel writes of new sessions while |notsent_lowat| or
+  // more of their bytes are unsent, see SpdySession::EnableUploadLowat().
+  // 0 disables it.
+  void set_upload_notsent_lowat(int notsent_lowat) {
+    upload_notsent_lowat_ = notsent_lowat;
+  }
+
+  // Lets new sessions coalesce writes up to |max_write_size|, see
+  // SpdySession::EnableWriteCoalescing(). 0 disables it.
+  void set_write_coalescing_size(size_t max_write_size) {
+    write_coalescing_size_ = max_write_size;
+  }
+
+  // Lets new sessions batch the HEADERS frames of streams opened in a burst,
+  // see SpdySession::EnableHeadersBatching(). Zero disables it.
+  void set_headers_batching_window(base::TimeDelta window) {
+    headers_batching_window_ = window;
+  }
+
+  // The descriptors of the TCP sockets carrying the sessions of the pool,
+  // e.g. for sampling their TCP_INFO.
+  std::vector<SocketDescriptor> GetTransportSocketDescriptors() const;
+
+  // Of the HEADERS frames sent by all sessions of the pool.
+  const SpdyHeaderEncoderStats& header_encoder_stats() const {
+    return header_encoder_stats_;
+  }
+
+  // Lets new sessions probe their connection with PINGs, see
+  // SpdySession::EnablePingProbe(). Zero |interval| disables it.
+  void set_ping_probe(base::TimeDelta interval,
+                      base::TimeDelta min_timeout,
+                      bool aligned = false) {
+    ping_probe_interval_ = interval;
+    ping_probe_min_timeout_ = min_timeout;
+    ping_probe_aligned_ = aligned;
+  }
+
+  // Sets the receive window of new sessions, in place of the one of
+  // HttpNetworkSessionParams.
+  void set_session_max_recv_window_size(size_t window_size) {
+    session_max_recv_window_size_ = window_size;
+  }
+
+  // Lets new sessions share their send path among streams, |quantum| bytes
+  // each a round, see SpdySession::EnableFairWriteScheduling(). 0 disables
+  // it.
+  void set_write_quantum(size_t quantum) { write_quantum_ = quantum; }
+
   // Returns the stored DNS aliases for the session key.
   std::set<std::string> GetDnsAliasesForSessionKey(
       const SpdySessionKey& key) const;
@@ -481,6 +570,35 @@ class NET_EXPORT SpdySessionPool
   // HEADERS frames and PRIORITY frames if it has value 1.
   const bool enable_priority_update_;
 
+  // Upper bound of receive window autotuning for new sessions.
+  int32_t recv_window_autotune_max_ = 0;
+
+  // Upper bound of the socket reads of new sessions.
+  int max_read_size_ = 0;
+
+  // Low-water mark of the unsent tunnel writes of new sessions.
+  int upload_notsent_lowat_ = 0;
+
+  // Upper bound of coalesced writes for new sessions.
+  size_t write_coalescing_size_ = 0;
+
+  // Bytes each stream of new sessions writes a round, 0 for FIFO.
+  size_t write_quantum_ = 0;
+
+  // Of the HEADERS batching of new sessions.
+  base::TimeDelta headers_batching_window_;
+
+  // Of the PING probes of new sessions.
+  base::TimeDelta ping_probe_interval_;
+  base::TimeDelta ping_probe_min_timeout_;
+  bool ping_probe_aligned_ = false;
+
+  // Of the sessions, which do not outlive the pool.
+  SpdyHeaderEncoderStats header_encoder_stats_;
+
+  base::RepeatingCallbackList<void(const NetworkAnonymizationKey&)>
+      go_away_callbacks_;
+
   // If set, sessions will be marked as going away upon relevant network changes
   // (instead of being closed).
   const bool go_away_on_ip_change_;
@@ -275,8 +275,32 @@ void SpdyStream::IncreaseRecvWindowSize(int32_t delta_window_size) {
   unacked_recv_window_bytes_ += delta_window_size;
   const base::TimeDelta elapsed =
       base::TimeTicks::Now() - last_recv_window_update_;
+  if (recv_window_limit_ > 0 && recv_window_limit_ < max_recv_window_size_) {
+    // What the peer may send and what is not yet consumed add up to
+    // |max_recv_window_size_ - unacked_recv_window_bytes_|.
+    int32_t releasable = unacked_recv_window_bytes_ -
+                         (max_recv_window_size_ - recv_window_limit_);
+    if (releasable > recv_window_limit_ / 2 ||
+        (releasable > 0 &&
+         elapsed >= session_->TimeToBufferSmallWindowUpdates())) {
+      last_recv_window_update_ = base::TimeTicks::Now();
+      session_->SendStreamWindowUpdate(stream_id_,
+                                       static_cast<uint32_t>(releasable));
+      unacked_recv_window_bytes_ -= releasable;
+    }
+    return;
+  }
   if (unacked_recv_window_bytes_ > max_recv_window_size_ / 2 ||
       elapsed >= session_->TimeToBufferSmallWindowUpdates()) {
+    int32_t max_window_size =
+        session_->AutotuneRecvWindowSize(max_recv_window_size_, elapsed);
+    if (max_window_size > max_recv_window_size_) {
+      // Advertised with this update.
+      int32_t delta = max_window_size - max_recv_window_size_;
+      max_recv_window_size_ = max_window_size;
+      recv_window_size_ += delta;
+      unacked_recv_window_bytes_ += delta;
+    }
     last_recv_window_update_ = base::TimeTicks::Now();
     session_->SendStreamWindowUpdate(
         stream_id_, static_cast<uint32_t>(unacked_recv_window_bytes_));
@@ -307,6 +331,20 @@ void SpdyStream::DecreaseRecvWindowSize(int32_t delta_window_size) {
   });
 }
 
+void SpdyStream::SetRecvWindowLimit(int32_t limit) {
+  DCHECK_GE(limit, 0);
+  bool lifted = recv_window_limit_ > 0 && limit == 0;
+  recv_window_limit_ = limit;
+  if (!lifted || unacked_recv_window_bytes_ == 0 ||
+      !session_->IsStreamActive(stream_id_)) {
+    return;
+  }
+  last_recv_window_update_ = base::TimeTicks::Now();
+  session_->SendStreamWindowUpdate(
+      stream_id_, static_cast<uint32_t>(unacked_recv_window_bytes_));
+  unacked_recv_window_bytes_ = 0;
+}
+
 int SpdyStream::GetPeerAddress(IPEndPoint* address) const {
   return session_->GetPeerAddress(address);
 }
@@ -640,15 +678,33 @@ int SpdyStream::SendRequestHeaders(spdy::Http2HeaderBlock request_headers,
 void SpdyStream::SendData(IOBuffer* data,
                           int length,
                           SpdySendStatus send_status) {
+  StartSendData(data, length, send_status, /*in_place=*/false);
+}
+
+void SpdyStream::SendDataInPlace(IOBuffer* data,
+                                 int length,
+                                 SpdySendStatus send_status) {
+  StartSendData(data, length, send_status, /*in_place=*/true);
+}
+
+void SpdyStream::StartSendData(IOBuffer* data,
+                               int length,
+                               SpdySendStatus send_status,
+                               bool in_place) {
   CHECK_EQ(pending_send_status_, MORE_DATA_TO_SEND);
   CHECK(io_state_ == STATE_OPEN ||
         io_state_ == STATE_HALF_CLOSED_REMOTE) << io_state_;
   CHECK(!pending_send_data_.get());
   pending_send_data_ = base::MakeRefCounted<DrainableIOBuffer>(data, length);
   pending_send_status_ = send_status;
+  pending_send_in_place_ = in_place;
   QueueNextDataFrame();
 }
 
+void SpdyStream::PostWhenUploadDrained(base::OnceClosure callback) {
+  session_->PostWhenUploadDrained(std::move(callback));
+}
+
 bool SpdyStream::GetSSLInfo(SSLInfo* ssl_info) const {
   return session_->GetSSLInfo(ssl_info);
 }
@@ -736,7 +792,8 @@ void SpdyStream::QueueNextDataFrame() {
   std::unique_ptr<SpdyBuffer> data_buffer(
       session_->CreateDataBuffer(stream_id_, pending_send_data_.get(),
                                  pending_send_data_->BytesRemaining(), flags,
-                                 &effective_len, &end_stream));
+                                 pending_send_in_place_, &effective_len,
+                                 &end_stream));
   // We'll get called again by PossiblyResumeIfSendStalled().
   if (!data_buffer)
     return;
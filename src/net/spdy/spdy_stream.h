@@ -248,6 +248,12 @@ class NET_EXPORT_PRIVATE SpdyStream {
   // this must not be called.
   void DecreaseRecvWindowSize(int32_t delta_window_size);
 
+  // While |limit| is positive and below the maximum receive window size,
+  // holds back WINDOW_UPDATE frames so that the data received but not yet
+  // consumed plus what the peer may still send stay within |limit|. 0 lifts
+  // the limit, sending the updates held back.
+  void SetRecvWindowLimit(int32_t limit);
+
   int GetPeerAddress(IPEndPoint* address) const;
   int GetLocalAddress(IPEndPoint* address) const;
 
@@ -340,6 +346,19 @@ class NET_EXPORT_PRIVATE SpdyStream {
   // Must not be called until Delegate::OnHeadersSent() is called.
   void SendData(IOBuffer* data, int length, SpdySendStatus send_status);
 
+  // Like SendData(), but frames |data| where it is instead of copying it.
+  // The header of each DATA frame is written over the
+  // spdy::kDataFrameMinimumSize bytes before its payload, so |data| must
+  // have that many bytes free before data(), and its bytes already sent are
+  // overwritten. |data| must not change until the send is complete.
+  void SendDataInPlace(IOBuffer* data,
+                       int length,
+                       SpdySendStatus send_status);
+
+  // Posts |callback| once the data sent so far has left the session's
+  // socket, see SpdySession::PostWhenUploadDrained().
+  void PostWhenUploadDrained(base::OnceClosure callback);
+
   // Fills SSL info in |ssl_info| and returns true when SSL is in use.
   bool GetSSLInfo(SSLInfo* ssl_info) const;
 
@@ -434,6 +453,11 @@ class NET_EXPORT_PRIVATE SpdyStream {
   // already be activated.
   std::unique_ptr<spdy::SpdySerializedFrame> ProduceHeadersFrame();
 
+  void StartSendData(IOBuffer* data,
+                     int length,
+                     SpdySendStatus send_status,
+                     bool in_place);
+
   // Queues the send for next frame of the remaining data in
   // |pending_send_data_|. Must be called only when
   // |pending_send_data_| is set.
@@ -478,6 +502,9 @@ class NET_EXPORT_PRIVATE SpdyStream {
   // Time of the last WINDOW_UPDATE for the receive window
   base::TimeTicks last_recv_window_update_;
 
+  // See SetRecvWindowLimit(), 0 for none.
+  int32_t recv_window_limit_ = 0;
+
   const base::WeakPtr<SpdySession> session_;
 
   // The transaction should own the delegate.
@@ -491,6 +518,8 @@ class NET_EXPORT_PRIVATE SpdyStream {
   // after the data is fully written.
   scoped_refptr<DrainableIOBuffer> pending_send_data_;
   SpdySendStatus pending_send_status_ = MORE_DATA_TO_SEND;
+  // Whether |pending_send_data_| is framed in place, see SendDataInPlace().
+  bool pending_send_in_place_ = false;
 
   // Data waiting to be received, and the close state of the remote endpoint
   // after the data is fully read. Specifically, data received before the
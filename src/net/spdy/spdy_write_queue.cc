@@ -5,6 +5,8 @@
 #include "net/spdy/spdy_write_queue.h"
 
 #include <cstddef>
+#include <limits>
+#include <set>
 #include <utility>
 #include <vector>
 
@@ -51,6 +53,19 @@ SpdyWriteQueue::~SpdyWriteQueue() {
   Clear();
 }
 
+void SpdyWriteQueue::EnableFairScheduling(size_t quantum) {
+  quantum_ = quantum;
+  credits_.clear();
+}
+
+void SpdyWriteQueue::ChargeStream(spdy::SpdyStreamId stream_id, size_t size) {
+  if (quantum_ == 0 || stream_id == 0)
+    return;
+  auto [it, inserted] =
+      credits_.try_emplace(stream_id, static_cast<int64_t>(quantum_));
+  it->second -= static_cast<int64_t>(size);
+}
+
 bool SpdyWriteQueue::IsEmpty() const {
   for (int i = MINIMUM_PRIORITY; i <= MAXIMUM_PRIORITY; i++) {
     if (!queue_[i].empty())
@@ -59,6 +74,17 @@ bool SpdyWriteQueue::IsEmpty() const {
   return true;
 }
 
+bool SpdyWriteQueue::PeekFrameType(spdy::SpdyFrameType* frame_type) const {
+  for (int i = MAXIMUM_PRIORITY; i >= MINIMUM_PRIORITY; --i) {
+    if (!queue_[i].empty()) {
+      int64_t rounds;
+      *frame_type = queue_[i][FindNextWrite(i, &rounds)].frame_type;
+      return true;
+    }
+  }
+  return false;
+}
+
 void SpdyWriteQueue::Enqueue(
     RequestPriority priority,
     spdy::SpdyFrameType frame_type,
@@ -87,8 +113,25 @@ bool SpdyWriteQueue::Dequeue(
   CHECK(!removing_writes_);
   for (int i = MAXIMUM_PRIORITY; i >= MINIMUM_PRIORITY; --i) {
     if (!queue_[i].empty()) {
-      PendingWrite pending_write = std::move(queue_[i].front());
-      queue_[i].pop_front();
+      int64_t rounds;
+      size_t index = FindNextWrite(i, &rounds);
+      // Every stream waiting at this priority gets the rounds it took for
+      // the next one to have credit.
+      if (rounds > 0) {
+        std::set<spdy::SpdyStreamId> credited;
+        for (const PendingWrite& write : queue_[i]) {
+          int64_t credit;
+          if (!GetCredit(write, &credit))
+            continue;
+          spdy::SpdyStreamId stream_id = write.stream->stream_id();
+          if (credited.insert(stream_id).second) {
+            credits_[stream_id] =
+                credit + rounds * static_cast<int64_t>(quantum_);
+          }
+        }
+      }
+      PendingWrite pending_write = std::move(queue_[i][index]);
+      queue_[i].erase(queue_[i].begin() + index);
       *frame_type = pending_write.frame_type;
       *frame_producer = std::move(pending_write.frame_producer);
       *stream = pending_write.stream;
@@ -105,9 +148,44 @@ bool SpdyWriteQueue::Dequeue(
   return false;
 }
 
+size_t SpdyWriteQueue::FindNextWrite(int priority, int64_t* rounds) const {
+  const base::circular_deque<PendingWrite>& queue = queue_[priority];
+  DCHECK(!queue.empty());
+  *rounds = 0;
+  if (quantum_ == 0)
+    return 0;
+  // The first write whose stream has credit left, or else the one whose
+  // stream needs the fewest rounds to get some.
+  size_t next = 0;
+  int64_t min_rounds = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0; i < queue.size(); ++i) {
+    int64_t credit;
+    if (!GetCredit(queue[i], &credit) || credit > 0)
+      return i;
+    int64_t needed = -credit / static_cast<int64_t>(quantum_) + 1;
+    if (needed < min_rounds) {
+      min_rounds = needed;
+      next = i;
+    }
+  }
+  *rounds = min_rounds;
+  return next;
+}
+
+bool SpdyWriteQueue::GetCredit(const PendingWrite& pending_write,
+                               int64_t* credit) const {
+  // A stream is activated when its HEADERS frame is dequeued.
+  if (!pending_write.stream.get() || pending_write.stream->stream_id() == 0)
+    return false;
+  auto it = credits_.find(pending_write.stream->stream_id());
+  *credit = it != credits_.end() ? it->second : static_cast<int64_t>(quantum_);
+  return true;
+}
+
 void SpdyWriteQueue::RemovePendingWritesForStream(SpdyStream* stream) {
   CHECK(!removing_writes_);
   removing_writes_ = true;
+  credits_.erase(stream->stream_id());
   RequestPriority priority = stream->priority();
   CHECK_GE(priority, MINIMUM_PRIORITY);
   CHECK_LE(priority, MAXIMUM_PRIORITY);
@@ -149,6 +227,7 @@ void SpdyWriteQueue::RemovePendingWritesForStreamsAfter(
     spdy::SpdyStreamId last_good_stream_id) {
   CHECK(!removing_writes_);
   removing_writes_ = true;
+  credits_.erase(credits_.upper_bound(last_good_stream_id), credits_.end());
 
   // Defer deletion until queue iteration is complete, as
   // SpdyBuffer::~SpdyBuffer() can result in callbacks into SpdyWriteQueue.
@@ -217,6 +296,7 @@ void SpdyWriteQueue::Clear() {
     }
     queue_[i].clear();
   }
+  credits_.clear();
   removing_writes_ = false;
   num_queued_capped_frames_ = 0;
 }
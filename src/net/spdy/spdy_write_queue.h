@@ -5,6 +5,9 @@
 #ifndef NET_SPDY_SPDY_WRITE_QUEUE_H_
 #define NET_SPDY_SPDY_WRITE_QUEUE_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
 
 #include "base/containers/circular_deque.h"
@@ -25,7 +28,8 @@ class SpdyBufferProducer;
 class SpdyStream;
 
 // A queue of SpdyBufferProducers to produce frames to write. Ordered
-// by priority, and then FIFO.
+// by priority, and then FIFO, or by deficit round robin among the streams
+// of a priority if enabled.
 class NET_EXPORT_PRIVATE SpdyWriteQueue {
  public:
   SpdyWriteQueue();
@@ -35,10 +39,25 @@ class NET_EXPORT_PRIVATE SpdyWriteQueue {
 
   ~SpdyWriteQueue();
 
+  // Shares each priority among its streams by the bytes they write instead
+  // of FIFO: a stream gets |quantum| bytes a round, and a stream that wrote
+  // more than its share waits for the others to catch up. Frames of no
+  // stream and HEADERS opening a stream are never held back, and the frames
+  // of each stream stay in order. 0 disables it.
+  void EnableFairScheduling(size_t quantum);
+
+  // Charges |size| bytes written by the stream |stream_id| to its share,
+  // with fair scheduling enabled.
+  void ChargeStream(spdy::SpdyStreamId stream_id, size_t size);
+
   // Returns whether there is anything in the write queue,
   // i.e. whether the next call to Dequeue will return true.
   bool IsEmpty() const;
 
+  // Fills in |frame_type| with the type of the frame the next call to
+  // Dequeue would return. Returns false if the queue is empty.
+  bool PeekFrameType(spdy::SpdyFrameType* frame_type) const;
+
   // Enqueues the given frame producer of the given type at the given
   // priority associated with the given stream, which may be NULL if
   // the frame producer is not associated with a stream. If |stream|
@@ -51,7 +70,8 @@ class NET_EXPORT_PRIVATE SpdyWriteQueue {
                const NetworkTrafficAnnotationTag& traffic_annotation);
 
   // Dequeues the frame producer with the highest priority that was
-  // enqueued the earliest and its associated stream. Returns true and
+  // enqueued the earliest, or whose stream's turn it is with fair
+  // scheduling, and its associated stream. Returns true and
   // fills in |frame_type|, |frame_producer|, and |stream| if
   // successful -- otherwise, just returns false.
   bool Dequeue(spdy::SpdyFrameType* frame_type,
@@ -106,6 +126,15 @@ class NET_EXPORT_PRIVATE SpdyWriteQueue {
     ~PendingWrite();
   };
 
+  // Returns the position in |queue_[priority]| of the write Dequeue() takes
+  // next, which must not be empty. Sets |rounds| to the rounds of quantum
+  // the streams get before it may be taken.
+  size_t FindNextWrite(int priority, int64_t* rounds) const;
+
+  // Sets |credit| to the bytes the stream of |pending_write| may still write
+  // this round. Returns false if the write is not held back for its stream.
+  bool GetCredit(const PendingWrite& pending_write, int64_t* credit) const;
+
   bool removing_writes_ = false;
 
   // Number of currently queued capped frames including all priorities.
@@ -113,6 +142,14 @@ class NET_EXPORT_PRIVATE SpdyWriteQueue {
 
   // The actual write queue, binned by priority.
   base::circular_deque<PendingWrite> queue_[NUM_PRIORITIES];
+
+  // Bytes a stream gets each round, 0 without fair scheduling.
+  size_t quantum_ = 0;
+  // Bytes each stream that wrote may still write this round, negative if it
+  // wrote ahead. Streams without an entry have a full quantum. Kept while
+  // the stream is open, as a stream mostly has one DATA frame queued at a
+  // time and would otherwise start each round afresh.
+  std::map<spdy::SpdyStreamId, int64_t> credits_;
 };
 
 }  // namespace net
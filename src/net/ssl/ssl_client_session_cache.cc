@@ -51,6 +51,8 @@ SSLClientSessionCache::SSLClientSessionCache(const Config& config)
 }
 
 SSLClientSessionCache::~SSLClientSessionCache() {
+  // Saved sessions are for the next cache.
+  persister_ = nullptr;
   Flush();
 }
 
@@ -68,8 +70,14 @@ bssl::UniquePtr<SSL_SESSION> SSLClientSessionCache::Lookup(
   }
 
   auto iter = cache_.Get(cache_key);
-  if (iter == cache_.end())
-    return nullptr;
+  if (iter == cache_.end()) {
+    if (!persister_)
+      return nullptr;
+    bssl::UniquePtr<SSL_SESSION> session = persister_->LoadSession(cache_key);
+    if (session && IsExpired(session.get(), clock_->Now().ToTimeT()))
+      session = nullptr;
+    return session;
+  }
 
   time_t now = clock_->Now().ToTimeT();
   bssl::UniquePtr<SSL_SESSION> session = iter->second.Pop();
@@ -84,6 +92,8 @@ bssl::UniquePtr<SSL_SESSION> SSLClientSessionCache::Lookup(
 
 void SSLClientSessionCache::Insert(const Key& cache_key,
                                    bssl::UniquePtr<SSL_SESSION> session) {
+  if (persister_)
+    persister_->SaveSession(cache_key, session.get());
   auto iter = cache_.Get(cache_key);
   if (iter == cache_.end())
     iter = cache_.Put(cache_key, Entry());
@@ -103,6 +113,8 @@ void SSLClientSessionCache::ClearEarlyData(const Key& cache_key) {
 
 void SSLClientSessionCache::FlushForServers(
     const base::flat_set<HostPortPair>& servers) {
+  if (persister_)
+    persister_->ForgetSessions(&servers);
   auto iter = cache_.begin();
   while (iter != cache_.end()) {
     if (servers.contains(iter->first.server)) {
@@ -114,6 +126,8 @@ void SSLClientSessionCache::FlushForServers(
 }
 
 void SSLClientSessionCache::Flush() {
+  if (persister_)
+    persister_->ForgetSessions(nullptr);
   cache_.Clear();
 }
 
@@ -173,6 +187,11 @@ bool SSLClientSessionCache::Entry::ExpireSessions(time_t now) {
   return false;
 }
 
+void SSLClientSessionCache::Shrink(size_t max_entries) {
+  FlushExpiredSessions();
+  cache_.ShrinkToSize(max_entries);
+}
+
 void SSLClientSessionCache::FlushExpiredSessions() {
   time_t now = clock_->Now().ToTimeT();
   auto iter = cache_.begin();
@@ -194,7 +213,8 @@ void SSLClientSessionCache::OnMemoryPressure(
       FlushExpiredSessions();
       break;
     case base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL:
-      Flush();
+      // Saved sessions do not take this memory.
+      cache_.Clear();
       break;
   }
 }
@@ -56,6 +56,24 @@ class NET_EXPORT SSLClientSessionCache {
     PrivacyMode privacy_mode = PRIVACY_MODE_DISABLED;
   };
 
+  // Keeps sessions outside of the cache, e.g. on disk across restarts.
+  class NET_EXPORT Persister {
+   public:
+    virtual ~Persister() = default;
+
+    // Called with each session inserted at |cache_key|.
+    virtual void SaveSession(const Key& cache_key, SSL_SESSION* session) = 0;
+
+    // Returns the session saved at |cache_key| and forgets it, or nullptr.
+    // Called by Lookup() when the cache has no session at |cache_key|.
+    virtual bssl::UniquePtr<SSL_SESSION> LoadSession(const Key& cache_key) = 0;
+
+    // Forgets the saved sessions of |servers|, or all of them if |servers|
+    // is null.
+    virtual void ForgetSessions(
+        const base::flat_set<HostPortPair>* servers) = 0;
+  };
+
   explicit SSLClientSessionCache(const Config& config);
 
   SSLClientSessionCache(const SSLClientSessionCache&) = delete;
@@ -88,8 +106,16 @@ class NET_EXPORT SSLClientSessionCache {
   // Removes all entries from the cache.
   void Flush();
 
+  // Removes the expired entries, then the least recently used ones until at
+  // most |max_entries| are left.
+  void Shrink(size_t max_entries);
+
   void SetClockForTesting(base::Clock* clock);
 
+  // Sets the Persister of the cache, which must outlive it unless reset to
+  // nullptr.
+  void set_persister(Persister* persister) { persister_ = persister; }
+
  private:
   struct Entry {
     Entry();
@@ -122,6 +148,7 @@ class NET_EXPORT SSLClientSessionCache {
   Config config_;
   base::LRUCache<Key, Entry> cache_;
   size_t lookups_since_flush_ = 0;
+  raw_ptr<Persister> persister_ = nullptr;
   std::unique_ptr<base::MemoryPressureListener> memory_pressure_listener_;
 };
 
@@ -14,6 +14,8 @@
 #include "base/containers/flat_map.h"
 #include "base/functional/callback.h"
 #include "base/memory/raw_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
 #include "net/base/net_export.h"
 #include "net/socket/next_proto.h"
 #include "net/ssl/ssl_config.h"
@@ -141,6 +143,27 @@ struct NET_EXPORT SSLServerConfig {
 
   // If not nullptr, an ECH configuration to use on the server.
   ECHKeysContainer ech_keys;
+
+  // Session ticket keys in place of the rotating key BoringSSL generates,
+  // so that servers sharing them resume each other's sessions.
+  class NET_EXPORT TicketKeySource
+      : public base::RefCountedThreadSafe<TicketKeySource> {
+   public:
+    // As the callback of SSL_CTX_set_tlsext_ticket_key_cb(), on the thread
+    // of the handshake.
+    virtual int HandleTicketKey(uint8_t* key_name,
+                                uint8_t* iv,
+                                EVP_CIPHER_CTX* cipher_ctx,
+                                HMAC_CTX* hmac_ctx,
+                                bool encrypt) = 0;
+
+   protected:
+    friend class base::RefCountedThreadSafe<TicketKeySource>;
+    virtual ~TicketKeySource() = default;
+  };
+
+  // If not nullptr, encrypts and decrypts the session tickets.
+  scoped_refptr<TicketKeySource> ticket_key_source;
 };
 
 }  // namespace net
@@ -381,6 +381,9 @@ OgHttp2Session::OgHttp2Session(Http2VisitorInterface& visitor, Options options)
     // endpoints don't properly handle multiple `Cookie` header fields.
     framer_.GetHpackEncoder()->DisableCookieCrumbling();
   }
+  if (options_.should_index_header) {
+    framer_.SetHpackIndexingPolicy(options_.should_index_header);
+  }
 }
 
 OgHttp2Session::~OgHttp2Session() {}
@@ -50,6 +50,10 @@ class QUICHE_EXPORT OgHttp2Session : public Http2Session,
     Perspective perspective = Perspective::kClient;
     // The maximum HPACK table size to use.
     std::optional<size_t> max_hpack_encoding_table_capacity;
+    // If set, the HPACK indexing policy, see
+    // spdy::HpackEncoder::SetIndexingPolicy().
+    bool (*should_index_header)(absl::string_view name,
+                                absl::string_view value) = nullptr;
     // The maximum number of decoded header bytes that a stream can receive.
     std::optional<uint32_t> max_header_list_bytes = std::nullopt;
     // The maximum size of an individual header field, including name and value.
@@ -125,6 +125,8 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
 
     auto match_type =
         header_table_.FindHeaderField(name, value, &is_static, &index);
+    const bool can_insert = can_write_to_encoder_stream &&
+                            (!should_index_ || should_index_(name, value));
 
     switch (match_type) {
       case QpackEncoderHeaderTable::MatchType::kNameAndValue:
@@ -158,7 +160,7 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
                          std::min(smallest_non_evictable_index, index))) {
             dynamic_table_insertion_blocked = true;
           } else {
-            if (can_write_to_encoder_stream) {
+            if (can_insert) {
               // If allowed, duplicate entry and refer to it.
               encoder_stream_sender_.SendDuplicate(
                   QpackAbsoluteIndexToEncoderStreamRelativeIndex(
@@ -191,7 +193,7 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
                   header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
                       smallest_non_evictable_index)) {
             // If allowed, insert entry into dynamic table and refer to it.
-            if (can_write_to_encoder_stream) {
+            if (can_insert) {
               encoder_stream_sender_.SendInsertWithNameReference(is_static,
                                                                  index, value);
               uint64_t new_index = header_table_.InsertEntry(name, value);
@@ -219,7 +221,7 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
           dynamic_table_insertion_blocked = true;
         } else {
           // If allowed, insert entry with name reference and refer to it.
-          if (can_write_to_encoder_stream) {
+          if (can_insert) {
             encoder_stream_sender_.SendInsertWithNameReference(
                 is_static,
                 QpackAbsoluteIndexToEncoderStreamRelativeIndex(
@@ -266,7 +268,7 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
                        smallest_non_evictable_index)) {
           dynamic_table_insertion_blocked = true;
         } else {
-          if (can_write_to_encoder_stream) {
+          if (can_insert) {
             encoder_stream_sender_.SendInsertWithoutNameReference(name, value);
             uint64_t new_index = header_table_.InsertEntry(name, value);
             representations.push_back(EncodeIndexedHeaderField(
@@ -8,9 +8,11 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "quiche/common/quiche_callbacks.h"
 #include "quiche/quic/core/qpack/qpack_blocking_manager.h"
 #include "quiche/quic/core/qpack/qpack_decoder_stream_receiver.h"
 #include "quiche/quic/core/qpack/qpack_encoder_stream_sender.h"
@@ -44,10 +46,21 @@ class QUICHE_EXPORT QpackEncoder : public QpackDecoderStreamReceiver::Delegate {
                                       absl::string_view error_message) = 0;
   };
 
+  // An indexing policy returns false for header name-value pairs that must
+  // not be inserted into the dynamic table, which are then encoded as
+  // literals or with a reference to a static name.
+  using IndexingPolicy =
+      quiche::MultiUseCallback<bool(absl::string_view, absl::string_view)>;
+
   QpackEncoder(DecoderStreamErrorDelegate* decoder_stream_error_delegate,
                HuffmanEncoding huffman_encoding);
   ~QpackEncoder() override;
 
+  // Without a policy, any header may be inserted.
+  void SetIndexingPolicy(IndexingPolicy policy) {
+    should_index_ = std::move(policy);
+  }
+
   // Encode a header list.  If |encoder_stream_sent_byte_count| is not null,
   // |*encoder_stream_sent_byte_count| will be set to the number of bytes sent
   // on the encoder stream to insert dynamic table entries.
@@ -154,6 +167,7 @@ class QUICHE_EXPORT QpackEncoder : public QpackDecoderStreamReceiver::Delegate {
   uint64_t maximum_blocked_streams_;
   QpackBlockingManager blocking_manager_;
   int header_list_count_;
+  IndexingPolicy should_index_;
 };
 
 // QpackEncoder::DecoderStreamErrorDelegate implementation that does nothing.
@@ -844,6 +844,12 @@ class QUICHE_EXPORT QuicConnection
   QuicRandom* random_generator() const { return random_generator_; }
   QuicByteCount max_packet_length() const;
   void SetMaxPacketLength(QuicByteCount length);
+  // Probes for packets of up to |target| bytes from the current max packet
+  // length, falling back to the last validated length on black holes and
+  // write errors.
+  void EnableMtuDiscovery(QuicByteCount target) {
+    SetMtuDiscoveryTarget(target);
+  }
 
   size_t mtu_probe_count() const { return mtu_probe_count_; }
 
@@ -4,6 +4,7 @@
 
 #include "quiche/quic/core/quic_flow_controller.h"
 
+#include <algorithm>
 #include <cstdint>
 
 #include "absl/strings/str_cat.h"
@@ -132,6 +133,9 @@ void QuicFlowController::MaybeIncreaseMaxWindowSize() {
   QuicTime now = connection_->clock()->ApproximateNow();
   QuicTime prev = prev_window_update_time_;
   prev_window_update_time_ = now;
+  const QuicByteCount consumed_since_last =
+      bytes_consumed_ - prev_window_update_bytes_consumed_;
+  prev_window_update_bytes_consumed_ = bytes_consumed_;
   if (!prev.IsInitialized()) {
     QUIC_DVLOG(1) << ENDPOINT << "first window update for " << LogLabel();
     return;
@@ -160,6 +164,15 @@ void QuicFlowController::MaybeIncreaseMaxWindowSize() {
   }
   QuicByteCount old_window = receive_window_size_;
   IncreaseWindowSize();
+  // Doubling takes a window update per step, so where the bandwidth-delay
+  // product is far above the window, grow to twice that of the delivery rate
+  // since the last update and the RTT at once.
+  if (!since_last.IsZero()) {
+    const QuicByteCount bdp = consumed_since_last * rtt.ToMicroseconds() /
+                              since_last.ToMicroseconds();
+    receive_window_size_ = std::max(
+        receive_window_size_, std::min(2 * bdp, receive_window_size_limit_));
+  }
 
   if (receive_window_size_ > old_window) {
     QUIC_DVLOG(1) << ENDPOINT << "New max window increase for " << LogLabel()
@@ -109,6 +109,10 @@ class QUICHE_EXPORT QuicFlowController : public QuicFlowControllerInterface {
 
   bool auto_tune_receive_window() { return auto_tune_receive_window_; }
 
+  // Auto-tunes the receive window, which only servers do by default. Streams
+  // take the setting of their session's flow controller when created.
+  void EnableReceiveWindowAutoTune() { auto_tune_receive_window_ = true; }
+
  private:
   friend class test::QuicFlowControllerPeer;
 
@@ -208,6 +212,9 @@ class QUICHE_EXPORT QuicFlowController : public QuicFlowControllerInterface {
   // Keep time of the last time a window update was sent.  We use this
   // as part of the receive window auto tuning.
   QuicTime prev_window_update_time_;
+
+  // Bytes consumed at the previous window update, for the delivery rate.
+  QuicByteCount prev_window_update_bytes_consumed_ = 0;
 };
 
 }  // namespace quic
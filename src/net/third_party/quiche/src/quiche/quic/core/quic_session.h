@@ -770,6 +770,12 @@ class QUICHE_EXPORT QuicSession
     return write_blocked_streams_.get();
   }
 
+  // Lets a data stream write |quantum| bytes before the other streams of its
+  // priority take their turn, instead of 16000.
+  void SetStreamWriteQuantum(QuicByteCount quantum) {
+    write_blocked_streams_->set_batch_write_size(quantum);
+  }
+
   // Returns true if the stream is still active.
   bool IsOpenStream(QuicStreamId id);
 
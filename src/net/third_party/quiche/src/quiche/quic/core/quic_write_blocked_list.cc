@@ -66,9 +66,10 @@ QuicStreamId QuicWriteBlockedList::PopFront() {
     // the first popped for its urgency anyway.
     batch_write_stream_id_[urgency] = 0;
   } else if (batch_write_stream_id_[urgency] != id) {
-    // If newly latching this batch write stream, let it write 16k.
+    // If newly latching this batch write stream, let it write
+    // batch_write_size_, 16k by default.
     batch_write_stream_id_[urgency] = id;
-    bytes_left_for_batch_write_[urgency] = 16000;
+    bytes_left_for_batch_write_[urgency] = batch_write_size_;
   }
 
   return id;
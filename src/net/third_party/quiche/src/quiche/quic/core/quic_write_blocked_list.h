@@ -133,6 +133,12 @@ class QUICHE_EXPORT QuicWriteBlockedList
   // Returns true if stream with |stream_id| is write blocked.
   bool IsStreamBlocked(QuicStreamId stream_id) const override;
 
+  // Sets the bytes a stream latched for batch writing may write before the
+  // other streams of its priority get their turn, 16000 by default.
+  void set_batch_write_size(size_t batch_write_size) {
+    batch_write_size_ = batch_write_size;
+  }
+
  private:
   struct QUICHE_EXPORT HttpStreamPriorityToInt {
     int operator()(const HttpStreamPriority& priority) {
@@ -161,6 +167,8 @@ class QUICHE_EXPORT QuicWriteBlockedList
   // TODO(b/147306124): Remove when deprecating
   // reloadable_flag_quic_disable_batch_write.
   size_t bytes_left_for_batch_write_[spdy::kV3LowestPriority + 1];
+  // What bytes_left_for_batch_write_ starts at.
+  size_t batch_write_size_ = 16000;
   // Tracks the last priority popped for UpdateBytesForStream() and AddStream().
   spdy::SpdyPriority last_priority_popped_;
 
@@ -14,28 +14,66 @@
 #include "base/functional/callback_helpers.h"
 #include "base/logging.h"
 #include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
 #include "base/sys_byteorder.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/base_tracing.h"
 #include "net/base/ip_address.h"
 #include "net/base/net_errors.h"
 #include "net/base/url_util.h"
 #include "net/http/http_request_headers.h"
+#include "net/http/http_response_headers.h"
 #include "net/log/net_log.h"
 #include "net/third_party/quiche/src/quiche/spdy/core/hpack/hpack_constants.h"
 #include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_proxy_protocol.h"
 #include "net/tools/naive/naive_proxy_delegate.h"
 #include "url/gurl.h"
 
 namespace net {
 
 namespace {
-constexpr int kBufferSize = 64 * 1024;
-constexpr size_t kMaxHeaderSize = 64 * 1024;
+// Most tunnel requests fit in the first size. Grows by doubling.
+constexpr int kInitialHeaderBufferSize = 4 * 1024;
+constexpr int kMaxHeaderSize = 64 * 1024;
 constexpr char kResponseHeader[] = "HTTP/1.1 200 OK\r\nPadding: ";
 constexpr int kResponseHeaderSize = sizeof(kResponseHeader) - 1;
 // A plain 200 is 10 bytes. Expected 48 bytes. "Padding" uses up 7 bytes.
 constexpr int kMinPaddingSize = 30;
 constexpr int kMaxPaddingSize = kMinPaddingSize + 32;
+
+// Returns the value of header `name` in the "\r\n" separated `headers`,
+// like HttpRequestHeaders::GetHeader() but without copying any of them.
+std::optional<std::string_view> FindHeader(std::string_view headers,
+                                           std::string_view name) {
+  while (!headers.empty()) {
+    size_t line_end = headers.find("\r\n");
+    std::string_view line = headers.substr(0, line_end);
+    headers = line_end == std::string_view::npos ? std::string_view()
+                                                 : headers.substr(line_end + 2);
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos)
+      continue;
+    if (base::EqualsCaseInsensitiveASCII(
+            base::TrimWhitespaceASCII(line.substr(0, colon), base::TRIM_ALL),
+            name)) {
+      return base::TrimWhitespaceASCII(line.substr(colon + 1), base::TRIM_ALL);
+    }
+  }
+  return std::nullopt;
+}
+
+// Whether the comma-separated header `value` lists `token`.
+bool HasToken(std::string_view value, std::string_view token) {
+  for (std::string_view item : base::SplitStringPiece(
+           value, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (base::EqualsCaseInsensitiveASCII(item, token))
+      return true;
+  }
+  return false;
+}
 }  // namespace
 
 HttpProxyServerSocket::HttpProxyServerSocket(
@@ -63,6 +101,18 @@ const HostPortPair& HttpProxyServerSocket::request_endpoint() const {
   return request_endpoint_;
 }
 
+size_t HttpProxyServerSocket::GetHandshakeMemoryUsage() const {
+  return (handshake_buf_ ? handshake_buf_->size() : 0) +
+         (header_buf_ ? header_buf_->capacity() : 0) + buffer_.capacity();
+}
+
+std::unique_ptr<StreamSocket>
+HttpProxyServerSocket::ReleaseKeptAliveTransport() {
+  if (!exchange_finished_ || !keep_alive_)
+    return nullptr;
+  return std::move(transport_);
+}
+
 int HttpProxyServerSocket::Connect(CompletionOnceCallback callback) {
   DCHECK(transport_);
   DCHECK_EQ(STATE_NONE, next_state_);
@@ -73,7 +123,10 @@ int HttpProxyServerSocket::Connect(CompletionOnceCallback callback) {
     return OK;
 
   next_state_ = STATE_HEADER_READ;
+  header_buf_ = nullptr;
+  header_scan_offset_ = 0;
   buffer_.clear();
+  buffer_offset_ = 0;
 
   int rv = DoLoop(OK);
   if (rv == ERR_IO_PENDING) {
@@ -84,12 +137,15 @@ int HttpProxyServerSocket::Connect(CompletionOnceCallback callback) {
 
 void HttpProxyServerSocket::Disconnect() {
   completed_handshake_ = false;
-  transport_->Disconnect();
+  // A transport kept alive is left open for the next request.
+  if (transport_ && !(exchange_finished_ && keep_alive_))
+    transport_->Disconnect();
 
   // Reset other states to make sure they aren't mistakenly used later.
   // These are the states initialized by Connect().
   next_state_ = STATE_NONE;
   user_callback_.Reset();
+  pending_read_callback_.Reset();
 }
 
 bool HttpProxyServerSocket::IsConnected() const {
@@ -132,6 +188,15 @@ void HttpProxyServerSocket::ApplySocketTag(const SocketTag& tag) {
   return transport_->ApplySocketTag(tag);
 }
 
+int HttpProxyServerSocket::ShutdownWrite() {
+  if (!completed_handshake_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  // Plain HTTP requests have their responses framed by this socket.
+  if (request_state_ != MESSAGE_RAW || response_state_ != MESSAGE_RAW)
+    return ERR_NOT_IMPLEMENTED;
+  return transport_->ShutdownWrite();
+}
+
 // Read is called by the transport layer above to read. This can only be done
 // if the HTTP header is complete.
 int HttpProxyServerSocket::Read(IOBuffer* buf,
@@ -142,18 +207,32 @@ int HttpProxyServerSocket::Read(IOBuffer* buf,
   DCHECK(!user_callback_);
   DCHECK(callback);
 
-  if (!buffer_.empty()) {
-    was_ever_used_ = true;
-    int data_len = buffer_.size();
-    if (data_len <= buf_len) {
-      std::memcpy(buf->data(), buffer_.data(), data_len);
-      buffer_.clear();
-      return data_len;
-    } else {
-      std::memcpy(buf->data(), buffer_.data(), buf_len);
-      buffer_ = buffer_.substr(buf_len);
-      return buf_len;
+  if (exchange_finished_)
+    return 0;
+
+  if (!buffer_.empty())
+    return ReadBufferedData(buf, buf_len);
+
+  if (request_state_ != MESSAGE_RAW) {
+    if (request_state_ == MESSAGE_DONE) {
+      pending_read_callback_ = std::move(callback);
+      return ERR_IO_PENDING;
+    }
+    // Stops at the end of the body, the rest being the next request.
+    if (request_state_ == MESSAGE_LENGTH) {
+      buf_len =
+          static_cast<int>(std::min<int64_t>(buf_len, request_remaining_));
     }
+    int rv = transport_->Read(
+        buf, buf_len,
+        base::BindOnce(&HttpProxyServerSocket::OnRequestReadComplete,
+                       base::Unretained(this), base::WrapRefCounted(buf),
+                       std::move(callback)));
+    if (rv > 0) {
+      was_ever_used_ = true;
+      ConsumeRequest(buf->data(), rv);
+    }
+    return rv;
   }
 
   int rv = transport_->Read(
@@ -165,6 +244,58 @@ int HttpProxyServerSocket::Read(IOBuffer* buf,
   return rv;
 }
 
+int HttpProxyServerSocket::ReadIfReady(IOBuffer* buf,
+                                       int buf_len,
+                                       CompletionOnceCallback callback) {
+  DCHECK(completed_handshake_);
+  DCHECK_EQ(STATE_NONE, next_state_);
+  DCHECK(!user_callback_);
+  DCHECK(callback);
+
+  if (exchange_finished_)
+    return 0;
+
+  if (!buffer_.empty())
+    return ReadBufferedData(buf, buf_len);
+
+  if (request_state_ == MESSAGE_DONE) {
+    pending_read_callback_ = std::move(callback);
+    return ERR_IO_PENDING;
+  }
+  if (request_state_ == MESSAGE_LENGTH) {
+    buf_len = static_cast<int>(std::min<int64_t>(buf_len, request_remaining_));
+  }
+  int rv = transport_->ReadIfReady(
+      buf, buf_len,
+      base::BindOnce(&HttpProxyServerSocket::OnReadWriteComplete,
+                     base::Unretained(this), std::move(callback)));
+  if (rv > 0) {
+    was_ever_used_ = true;
+    ConsumeRequest(buf->data(), rv);
+  }
+  return rv;
+}
+
+int HttpProxyServerSocket::CancelReadIfReady() {
+  if (pending_read_callback_) {
+    pending_read_callback_.Reset();
+    return OK;
+  }
+  return transport_->CancelReadIfReady();
+}
+
+int HttpProxyServerSocket::ReadBufferedData(IOBuffer* buf, int buf_len) {
+  was_ever_used_ = true;
+  int size = std::min<int>(buf_len, buffer_.size() - buffer_offset_);
+  std::memcpy(buf->data(), buffer_.data() + buffer_offset_, size);
+  buffer_offset_ += size;
+  if (buffer_offset_ == buffer_.size()) {
+    buffer_.clear();
+    buffer_offset_ = 0;
+  }
+  return size;
+}
+
 // Write is called by the transport layer. This can only be done if the
 // HTTP CONNECT request is complete.
 int HttpProxyServerSocket::Write(
@@ -177,6 +308,20 @@ int HttpProxyServerSocket::Write(
   DCHECK(!user_callback_);
   DCHECK(callback);
 
+  if (response_state_ != MESSAGE_RAW) {
+    int rv = transport_->Write(
+        buf, buf_len,
+        base::BindOnce(&HttpProxyServerSocket::OnResponseWriteComplete,
+                       base::Unretained(this), base::WrapRefCounted(buf),
+                       std::move(callback)),
+        traffic_annotation);
+    if (rv > 0) {
+      was_ever_used_ = true;
+      ConsumeResponse(buf->data(), rv);
+    }
+    return rv;
+  }
+
   int rv = transport_->Write(
       buf, buf_len,
       base::BindOnce(&HttpProxyServerSocket::OnReadWriteComplete,
@@ -222,12 +367,32 @@ void HttpProxyServerSocket::OnReadWriteComplete(CompletionOnceCallback callback,
   std::move(callback).Run(result);
 }
 
+void HttpProxyServerSocket::OnRequestReadComplete(
+    scoped_refptr<IOBuffer> buf,
+    CompletionOnceCallback callback,
+    int result) {
+  if (result > 0)
+    ConsumeRequest(buf->data(), result);
+  OnReadWriteComplete(std::move(callback), result);
+}
+
+void HttpProxyServerSocket::OnResponseWriteComplete(
+    scoped_refptr<IOBuffer> buf,
+    CompletionOnceCallback callback,
+    int result) {
+  if (result > 0)
+    ConsumeResponse(buf->data(), result);
+  OnReadWriteComplete(std::move(callback), result);
+}
+
 int HttpProxyServerSocket::DoLoop(int last_io_result) {
   DCHECK_NE(next_state_, STATE_NONE);
   int rv = last_io_result;
   do {
     State state = next_state_;
     next_state_ = STATE_NONE;
+    TRACE_EVENT("net", "HttpProxyServerSocket::DoLoop", "state",
+                static_cast<int>(state), "rv", rv);
     switch (state) {
       case STATE_HEADER_READ:
         DCHECK_EQ(OK, rv);
@@ -255,44 +420,26 @@ int HttpProxyServerSocket::DoLoop(int last_io_result) {
 int HttpProxyServerSocket::DoHeaderRead() {
   next_state_ = STATE_HEADER_READ_COMPLETE;
 
-  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(kBufferSize);
-  return transport_->Read(handshake_buf_.get(), kBufferSize, io_callback_);
+  // Reads into the same buffer until the header is complete, so it can be
+  // parsed in place.
+  if (!header_buf_) {
+    header_buf_ = base::MakeRefCounted<GrowableIOBuffer>();
+    header_buf_->SetCapacity(kInitialHeaderBufferSize);
+  } else if (header_buf_->RemainingCapacity() == 0) {
+    if (header_buf_->capacity() >= kMaxHeaderSize)
+      return ERR_MSG_TOO_BIG;
+    header_buf_->SetCapacity(
+        std::min(header_buf_->capacity() * 2, kMaxHeaderSize));
+  }
+  return transport_->Read(header_buf_.get(), header_buf_->RemainingCapacity(),
+                          io_callback_);
 }
 
 std::optional<PaddingType> HttpProxyServerSocket::ParsePaddingHeaders(
-    const HttpRequestHeaders& headers) {
-  bool has_padding = headers.HasHeader(kPaddingHeader);
-  std::string padding_type_request;
-  bool has_padding_type_request =
-      headers.GetHeader(kPaddingTypeRequestHeader, &padding_type_request);
-
-  if (!has_padding_type_request) {
-    // Backward compatibility with before kVariant1 when the padding-version
-    // header does not exist.
-    if (has_padding) {
-      return PaddingType::kVariant1;
-    } else {
-      return PaddingType::kNone;
-    }
-  }
-
-  std::vector<std::string_view> padding_type_strs = base::SplitStringPiece(
-      padding_type_request, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
-  for (std::string_view padding_type_str : padding_type_strs) {
-    std::optional<PaddingType> padding_type =
-        ParsePaddingType(padding_type_str);
-    if (!padding_type.has_value()) {
-      LOG(ERROR) << "Invalid padding type: " << padding_type_str;
-      return std::nullopt;
-    }
-    if (std::find(supported_padding_types_.begin(),
-                  supported_padding_types_.end(),
-                  *padding_type) != supported_padding_types_.end()) {
-      return padding_type;
-    }
-  }
-  LOG(ERROR) << "No padding type is supported: " << padding_type_request;
-  return std::nullopt;
+    std::string_view headers) {
+  return NegotiatePaddingType(FindHeader(headers, kPaddingHeader).has_value(),
+                              FindHeader(headers, kPaddingTypeRequestHeader),
+                              supported_padding_types_);
 }
 
 int HttpProxyServerSocket::DoHeaderReadComplete(int result) {
@@ -303,35 +450,53 @@ int HttpProxyServerSocket::DoHeaderReadComplete(int result) {
     return ERR_CONNECTION_CLOSED;
   }
 
-  buffer_.append(handshake_buf_->data(), result);
-  if (buffer_.size() > kMaxHeaderSize) {
-    return ERR_MSG_TOO_BIG;
+  header_buf_->set_offset(header_buf_->offset() + result);
+  if (proxy_protocol_) {
+    std::string_view data(header_buf_->StartOfBuffer(), header_buf_->offset());
+    int header_size = ParseProxyProtocolHeader(data, &proxied_source_);
+    if (header_size < 0) {
+      LOG(WARNING) << "Invalid PROXY protocol header";
+      return ERR_INVALID_ARGUMENT;
+    }
+    if (header_size == 0) {
+      next_state_ = STATE_HEADER_READ;
+      return OK;
+    }
+    // Drops the header, so the request read with it is parsed in place.
+    std::memmove(header_buf_->StartOfBuffer(),
+                 header_buf_->StartOfBuffer() + header_size,
+                 data.size() - header_size);
+    header_buf_->set_offset(data.size() - header_size);
+    proxy_protocol_ = false;
   }
-
-  size_t header_end = buffer_.find("\r\n\r\n");
-  if (header_end == std::string::npos) {
+  std::string_view buffer(header_buf_->StartOfBuffer(), header_buf_->offset());
+  // Resumes after what earlier reads scanned, but the terminator may start
+  // in their last three bytes.
+  size_t header_end = buffer.find("\r\n\r\n", header_scan_offset_);
+  if (header_end == std::string_view::npos) {
+    header_scan_offset_ = std::max<size_t>(buffer.size(), 3) - 3;
     next_state_ = STATE_HEADER_READ;
     return OK;
   }
 
-  size_t first_line_end = buffer_.find("\r\n");
-  size_t first_space = buffer_.find(' ');
+  std::string_view request_line = buffer.substr(0, buffer.find("\r\n"));
+  size_t first_space = request_line.find(' ');
   bool is_http_1_0 = false;
-  if (first_space == std::string::npos || first_space + 1 >= first_line_end) {
-    LOG(WARNING) << "Invalid request: " << buffer_.substr(0, first_line_end);
+  if (first_space == std::string_view::npos ||
+      first_space + 1 >= request_line.size()) {
+    LOG(WARNING) << "Invalid request: " << request_line;
     return ERR_INVALID_ARGUMENT;
   }
-  size_t second_space = buffer_.find(' ', first_space + 1);
-  if (second_space == std::string::npos || second_space >= first_line_end) {
-    LOG(WARNING) << "Invalid request: " << buffer_.substr(0, first_line_end);
+  size_t second_space = request_line.find(' ', first_space + 1);
+  if (second_space == std::string_view::npos) {
+    LOG(WARNING) << "Invalid request: " << request_line;
     return ERR_INVALID_ARGUMENT;
   }
 
-  std::string method = buffer_.substr(0, first_space);
-  std::string uri =
-      buffer_.substr(first_space + 1, second_space - (first_space + 1));
-  std::string version =
-      buffer_.substr(second_space + 1, first_line_end - (second_space + 1));
+  std::string_view method = request_line.substr(0, first_space);
+  std::string_view uri =
+      request_line.substr(first_space + 1, second_space - (first_space + 1));
+  std::string_view version = request_line.substr(second_space + 1);
   if (method == HttpRequestHeaders::kConnectMethod) {
     request_endpoint_ = HostPortPair::FromString(uri);
   } else {
@@ -339,15 +504,25 @@ int HttpProxyServerSocket::DoHeaderReadComplete(int result) {
     is_http_1_0 = true;
   }
 
-  size_t second_line = first_line_end + 2;
-  HttpRequestHeaders headers;
-  std::string headers_str;
+  size_t second_line = request_line.size() + 2;
+  std::string_view headers_str;
   if (second_line < header_end) {
-    headers_str = buffer_.substr(second_line, header_end - second_line);
-    headers.AddHeadersFromString(headers_str);
+    headers_str = buffer.substr(second_line, header_end - second_line);
   }
+  std::string_view payload = buffer.substr(header_end + 4);
+
+  // CONNECT requests only need the padding headers, which are looked up in
+  // place. Plain HTTP requests are forwarded and need all headers parsed.
+  std::optional<PaddingType> padding_type = ParsePaddingHeaders(headers_str);
+  if (!padding_type.has_value()) {
+    return ERR_INVALID_ARGUMENT;
+  }
+  padding_detector_delegate_->SetClientPaddingType(*padding_type);
 
   if (is_http_1_0) {
+    HttpRequestHeaders headers;
+    headers.AddHeadersFromString(headers_str);
+
     GURL url(uri);
     if (!url.is_valid()) {
       LOG(WARNING) << "Invalid URI: " << uri;
@@ -381,45 +556,209 @@ int HttpProxyServerSocket::DoHeaderReadComplete(int result) {
       headers.SetHeader(HttpRequestHeaders::kHost, host_str);
     }
     // Host is already known. Converts any absolute URI to relative.
-    uri = url.path();
+    std::string path = url.path();
     if (url.has_query()) {
-      uri.append("?").append(url.query());
+      path.append("?").append(url.query());
     }
 
     request_endpoint_.set_host(host);
     request_endpoint_.set_port(port);
-  }
-
-  std::optional<PaddingType> padding_type = ParsePaddingHeaders(headers);
-  if (!padding_type.has_value()) {
-    return ERR_INVALID_ARGUMENT;
-  }
-  padding_detector_delegate_->SetClientPaddingType(*padding_type);
 
-  if (is_http_1_0) {
     // Regenerates http header to make sure don't leak them to end servers
     HttpRequestHeaders sanitized_headers = headers;
     sanitized_headers.RemoveHeader(HttpRequestHeaders::kProxyConnection);
     sanitized_headers.RemoveHeader(HttpRequestHeaders::kProxyAuthorization);
     std::ostringstream ss;
-    ss << method << " " << uri << " " << version << "\r\n"
-       << sanitized_headers.ToString();
-    if (buffer_.size() > header_end + 4) {
-      ss << buffer_.substr(header_end + 4);
-    }
+    ss << method << " " << path << " " << version << "\r\n"
+       << sanitized_headers.ToString() << payload;
     buffer_ = ss.str();
+    header_buf_ = nullptr;
+    // Padded requests are framed by NaivePaddingSocket above this.
+    if (*padding_type == PaddingType::kNone)
+      DelimitRequest(method, version, headers, payload);
     // Skips padding write for raw http proxy
     completed_handshake_ = true;
     next_state_ = STATE_NONE;
     return OK;
   }
 
-  buffer_ = buffer_.substr(header_end + 4);
+  buffer_.assign(payload);
+  header_buf_ = nullptr;
 
   next_state_ = STATE_HEADER_WRITE;
   return OK;
 }
 
+void HttpProxyServerSocket::DelimitRequest(std::string_view method,
+                                           std::string_view version,
+                                           const HttpRequestHeaders& headers,
+                                           std::string_view payload) {
+  // Upgraded connections pass through as they are.
+  if (version != "HTTP/1.1" || headers.HasHeader("Upgrade"))
+    return;
+  std::string value;
+  for (const char* name : {HttpRequestHeaders::kConnection,
+                           HttpRequestHeaders::kProxyConnection}) {
+    if (headers.GetHeader(name, &value) && HasToken(value, "close"))
+      return;
+  }
+
+  if (headers.GetHeader(HttpRequestHeaders::kTransferEncoding, &value)) {
+    // With other codings last, the body ends by closing.
+    std::vector<std::string_view> codings = base::SplitStringPiece(
+        value, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (codings.empty() ||
+        !base::EqualsCaseInsensitiveASCII(codings.back(), "chunked")) {
+      return;
+    }
+    request_state_ = MESSAGE_CHUNKED;
+  } else if (headers.GetHeader(HttpRequestHeaders::kContentLength, &value)) {
+    if (!base::StringToInt64(value, &request_remaining_) ||
+        request_remaining_ < 0) {
+      return;
+    }
+    request_state_ = request_remaining_ > 0 ? MESSAGE_LENGTH : MESSAGE_DONE;
+  } else {
+    request_state_ = MESSAGE_DONE;
+  }
+
+  is_head_request_ = method == HttpRequestHeaders::kHeadMethod;
+  response_state_ = MESSAGE_HEADER;
+  keep_alive_ = true;
+  if (!payload.empty())
+    ConsumeRequest(payload.data(), static_cast<int>(payload.size()));
+}
+
+HttpProxyServerSocket::MessageState HttpProxyServerSocket::ConsumeChunked(
+    HttpChunkedDecoder* decoder,
+    const char* data,
+    int size) {
+  chunked_scratch_.assign(data, size);
+  if (decoder->FilterBuf(chunked_scratch_.data(), size) < 0) {
+    keep_alive_ = false;
+    return MESSAGE_RAW;
+  }
+  if (!decoder->reached_eof())
+    return MESSAGE_CHUNKED;
+  if (decoder->bytes_after_eof() > 0)
+    keep_alive_ = false;
+  return MESSAGE_DONE;
+}
+
+void HttpProxyServerSocket::ConsumeRequest(const char* data, int size) {
+  switch (request_state_) {
+    case MESSAGE_LENGTH:
+      if (size < request_remaining_) {
+        request_remaining_ -= size;
+        break;
+      }
+      // Anything past the body is a pipelined request, which is not kept.
+      if (size > request_remaining_)
+        keep_alive_ = false;
+      request_remaining_ = 0;
+      request_state_ = MESSAGE_DONE;
+      break;
+    case MESSAGE_CHUNKED:
+      request_state_ = ConsumeChunked(&request_decoder_, data, size);
+      break;
+    case MESSAGE_DONE:
+      keep_alive_ = false;
+      break;
+    default:
+      break;
+  }
+}
+
+void HttpProxyServerSocket::ConsumeResponse(const char* data, int size) {
+  bool was_done = response_state_ == MESSAGE_DONE;
+  while (size > 0 && response_state_ != MESSAGE_RAW) {
+    if (response_state_ == MESSAGE_HEADER) {
+      size_t scanned = response_header_.size();
+      response_header_.append(data, size);
+      size_t header_end = response_header_.find(
+          "\r\n\r\n", std::max<size_t>(scanned, 3) - 3);
+      if (header_end == std::string::npos) {
+        if (response_header_.size() > static_cast<size_t>(kMaxHeaderSize)) {
+          keep_alive_ = false;
+          response_state_ = MESSAGE_RAW;
+          response_header_.clear();
+        }
+        return;
+      }
+      int used = static_cast<int>(header_end + 4 - scanned);
+      data += used;
+      size -= used;
+      response_header_.resize(header_end + 4);
+      ParseResponseHeader(response_header_);
+      response_header_.clear();
+    } else if (response_state_ == MESSAGE_LENGTH) {
+      int used = static_cast<int>(std::min<int64_t>(size, response_remaining_));
+      data += used;
+      size -= used;
+      response_remaining_ -= used;
+      if (response_remaining_ == 0)
+        response_state_ = MESSAGE_DONE;
+    } else if (response_state_ == MESSAGE_CHUNKED) {
+      response_state_ = ConsumeChunked(&response_decoder_, data, size);
+      size = 0;
+    } else {
+      // Past the end of the response.
+      keep_alive_ = false;
+      size = 0;
+    }
+  }
+
+  // Posted, as the write completing the response is yet to return to the
+  // caller.
+  if (!was_done && response_state_ == MESSAGE_DONE) {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&HttpProxyServerSocket::FinishExchange,
+                                  weak_ptr_factory_.GetWeakPtr()));
+  }
+}
+
+void HttpProxyServerSocket::ParseResponseHeader(std::string_view header) {
+  scoped_refptr<HttpResponseHeaders> headers =
+      HttpResponseHeaders::TryToCreate(header);
+  int status = headers ? headers->response_code() : 0;
+  // Interim responses are followed by the final one.
+  if (status >= 100 && status < 200 && status != 101) {
+    response_state_ = MESSAGE_HEADER;
+    return;
+  }
+  // Upgrades and responses ending by closing pass through as they are.
+  if (!headers || status == 101 || !headers->IsKeepAlive()) {
+    keep_alive_ = false;
+    response_state_ = MESSAGE_RAW;
+    return;
+  }
+  if (is_head_request_ || status == 204 || status == 304) {
+    response_state_ = MESSAGE_DONE;
+    return;
+  }
+  if (headers->IsChunkEncoded()) {
+    response_state_ = MESSAGE_CHUNKED;
+    return;
+  }
+  response_remaining_ = headers->GetContentLength();
+  if (response_remaining_ < 0) {
+    keep_alive_ = false;
+    response_state_ = MESSAGE_RAW;
+    return;
+  }
+  response_state_ = response_remaining_ > 0 ? MESSAGE_LENGTH : MESSAGE_DONE;
+}
+
+void HttpProxyServerSocket::FinishExchange() {
+  // The request body still coming after an early response has nowhere to
+  // go.
+  if (request_state_ != MESSAGE_DONE)
+    keep_alive_ = false;
+  exchange_finished_ = true;
+  if (pending_read_callback_)
+    std::move(pending_read_callback_).Run(0);
+}
+
 int HttpProxyServerSocket::DoHeaderWrite() {
   next_state_ = STATE_HEADER_WRITE_COMPLETE;
 
@@ -451,6 +790,10 @@ int HttpProxyServerSocket::DoHeaderWriteComplete(int result) {
 }
 
 int HttpProxyServerSocket::GetPeerAddress(IPEndPoint* address) const {
+  if (proxied_source_) {
+    *address = *proxied_source_;
+    return OK;
+  }
   return transport_->GetPeerAddress(address);
 }
 
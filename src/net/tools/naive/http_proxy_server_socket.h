@@ -9,15 +9,19 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/completion_repeating_callback.h"
 #include "net/base/host_port_pair.h"
 #include "net/base/io_buffer.h"
 #include "net/base/ip_endpoint.h"
+#include "net/http/http_chunked_decoder.h"
 #include "net/http/http_request_headers.h"
 #include "net/log/net_log_with_source.h"
 #include "net/socket/connection_attempts.h"
@@ -46,6 +50,38 @@ class HttpProxyServerSocket : public StreamSocket {
 
   const HostPortPair& request_endpoint() const;
 
+  // Expects a PROXY protocol header ahead of the request, from a load
+  // balancer. The client address in it is then the peer address.
+  void set_proxy_protocol(bool proxy_protocol) {
+    proxy_protocol_ = proxy_protocol;
+  }
+  // The client address of the PROXY protocol header, passed on to the
+  // socket of the next request kept alive.
+  const std::optional<IPEndPoint>& proxied_source() const {
+    return proxied_source_;
+  }
+  void set_proxied_source(const std::optional<IPEndPoint>& source) {
+    proxied_source_ = source;
+  }
+
+  StreamSocket* transport_socket() const { return transport_.get(); }
+
+  // Whether payload received along with the request header is yet unread.
+  bool has_buffered_data() const { return !buffer_.empty(); }
+
+  // Bytes held by the handshake buffers, for memory accounting.
+  size_t GetHandshakeMemoryUsage() const;
+
+  // Whether this is a plain HTTP request kept alive. Read() then ends with
+  // the request and Write() with its response, after which the transport is
+  // left for the next request.
+  bool is_keep_alive_request() const {
+    return request_state_ != MESSAGE_RAW;
+  }
+  // Returns the transport once the response of a request kept alive is
+  // complete, or nullptr if it is to be closed.
+  std::unique_ptr<StreamSocket> ReleaseKeptAliveTransport();
+
   // StreamSocket implementation.
 
   int Connect(CompletionOnceCallback callback) override;
@@ -58,11 +94,16 @@ class HttpProxyServerSocket : public StreamSocket {
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
   void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
 
   // Socket implementation.
   int Read(IOBuffer* buf,
            int buf_len,
            CompletionOnceCallback callback) override;
+  int ReadIfReady(IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) override;
+  int CancelReadIfReady() override;
   int Write(IOBuffer* buf,
             int buf_len,
             CompletionOnceCallback callback,
@@ -83,9 +124,28 @@ class HttpProxyServerSocket : public StreamSocket {
     STATE_NONE,
   };
 
+  // Where a kept-alive request or response is. Either passes through as is
+  // once it cannot be delimited.
+  enum MessageState {
+    MESSAGE_RAW,
+    MESSAGE_HEADER,
+    MESSAGE_LENGTH,
+    MESSAGE_CHUNKED,
+    MESSAGE_DONE,
+  };
+
   void DoCallback(int result);
   void OnIOComplete(int result);
   void OnReadWriteComplete(CompletionOnceCallback callback, int result);
+  void OnRequestReadComplete(scoped_refptr<IOBuffer> buf,
+                             CompletionOnceCallback callback,
+                             int result);
+  void OnResponseWriteComplete(scoped_refptr<IOBuffer> buf,
+                               CompletionOnceCallback callback,
+                               int result);
+
+  // Returns payload read past the request header along with it.
+  int ReadBufferedData(IOBuffer* buf, int buf_len);
 
   int DoLoop(int last_io_result);
   int DoHeaderWrite();
@@ -93,8 +153,25 @@ class HttpProxyServerSocket : public StreamSocket {
   int DoHeaderRead();
   int DoHeaderReadComplete(int result);
 
-  std::optional<PaddingType> ParsePaddingHeaders(
-      const HttpRequestHeaders& headers);
+  std::optional<PaddingType> ParsePaddingHeaders(std::string_view headers);
+
+  // Sets up delimiting a plain HTTP request to keep the connection alive,
+  // unless it is not HTTP/1.1 or its body cannot be delimited. `payload` is
+  // what was read past its header.
+  void DelimitRequest(std::string_view method,
+                      std::string_view version,
+                      const HttpRequestHeaders& headers,
+                      std::string_view payload);
+  // Accounts for request payload read and response payload written.
+  void ConsumeRequest(const char* data, int size);
+  void ConsumeResponse(const char* data, int size);
+  // Returns the state of a chunked body after `size` more bytes of it.
+  MessageState ConsumeChunked(HttpChunkedDecoder* decoder,
+                              const char* data,
+                              int size);
+  void ParseResponseHeader(std::string_view header);
+  // Ends Read() once the response is written.
+  void FinishExchange();
 
   CompletionRepeatingCallback io_callback_;
 
@@ -107,12 +184,22 @@ class HttpProxyServerSocket : public StreamSocket {
   // Stores the callback to the layer above, called on completing Connect().
   CompletionOnceCallback user_callback_;
 
-  // This IOBuffer is used by the class to read and write
-  // SOCKS handshake data. The length contains the expected size to
-  // read or write.
+  // This IOBuffer is used by the class to write the response header.
   scoped_refptr<IOBuffer> handshake_buf_;
 
+  // Accumulates the request header until it is complete. Its offset is the
+  // end of the data read so far.
+  scoped_refptr<GrowableIOBuffer> header_buf_;
+  // Where the search for the end of the header resumes.
+  size_t header_scan_offset_ = 0;
+
+  // Until the PROXY protocol header is read.
+  bool proxy_protocol_ = false;
+  std::optional<IPEndPoint> proxied_source_;
+
+  // Payload read along with the request header, returned by the first reads.
   std::string buffer_;
+  size_t buffer_offset_ = 0;
   bool completed_handshake_;
   bool was_ever_used_;
   int header_write_size_;
@@ -125,6 +212,26 @@ class HttpProxyServerSocket : public StreamSocket {
   const NetworkTrafficAnnotationTag& traffic_annotation_;
 
   std::vector<PaddingType> supported_padding_types_;
+
+  MessageState request_state_ = MESSAGE_RAW;
+  MessageState response_state_ = MESSAGE_RAW;
+  int64_t request_remaining_ = 0;
+  int64_t response_remaining_ = 0;
+  HttpChunkedDecoder request_decoder_;
+  HttpChunkedDecoder response_decoder_;
+  // Copy of chunked payload for the decoders, which decode in place.
+  std::string chunked_scratch_;
+  bool is_head_request_ = false;
+  // Response header written so far.
+  std::string response_header_;
+  // Cleared by anything past the request or the response, or by either
+  // asking to close.
+  bool keep_alive_ = false;
+  bool exchange_finished_ = false;
+  // Read() waiting for the response once the request is complete.
+  CompletionOnceCallback pending_read_callback_;
+
+  base::WeakPtrFactory<HttpProxyServerSocket> weak_ptr_factory_{this};
 };
 
 }  // namespace net
@@ -0,0 +1,99 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_accept_forwarder.h"
+
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/socket/server_socket.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/tools/naive/naive_proxy.h"
+
+namespace net {
+
+NaiveAcceptForwarder::Target::Target() = default;
+
+NaiveAcceptForwarder::Target::Target(
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    base::WeakPtr<NaiveProxy> proxy)
+    : task_runner(std::move(task_runner)), proxy(std::move(proxy)) {}
+
+NaiveAcceptForwarder::Target::Target(const Target&) = default;
+
+NaiveAcceptForwarder::Target& NaiveAcceptForwarder::Target::operator=(
+    const Target&) = default;
+
+NaiveAcceptForwarder::Target::~Target() = default;
+
+NaiveAcceptForwarder::NaiveAcceptForwarder(
+    std::unique_ptr<ServerSocket> listen_socket,
+    std::vector<Target> targets)
+    : listen_socket_(std::move(listen_socket)), targets_(std::move(targets)) {
+  DCHECK(listen_socket_);
+  DCHECK(!targets_.empty());
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveAcceptForwarder::DoAcceptLoop,
+                                weak_ptr_factory_.GetWeakPtr()));
+}
+
+NaiveAcceptForwarder::~NaiveAcceptForwarder() = default;
+
+void NaiveAcceptForwarder::DoAcceptLoop() {
+  int result;
+  do {
+    result = listen_socket_->Accept(
+        &accepted_socket_,
+        base::BindRepeating(&NaiveAcceptForwarder::OnAcceptComplete,
+                            weak_ptr_factory_.GetWeakPtr()));
+    if (result == ERR_IO_PENDING)
+      return;
+    HandleAcceptResult(result);
+  } while (result == OK);
+}
+
+void NaiveAcceptForwarder::OnAcceptComplete(int result) {
+  HandleAcceptResult(result);
+  if (result == OK)
+    DoAcceptLoop();
+}
+
+void NaiveAcceptForwarder::HandleAcceptResult(int result) {
+  if (result != OK) {
+    LOG(ERROR) << "Accept error: " << ErrorToShortString(result);
+    return;
+  }
+  std::unique_ptr<StreamSocket> socket = std::move(accepted_socket_);
+
+  IPEndPoint peer_address;
+  socket->GetPeerAddress(&peer_address);
+  // TCPServerSocket only produces TCPClientSocket. The descriptor is
+  // duplicated because TCPClientSocket cannot release its own.
+  int fd = static_cast<TCPClientSocket*>(socket.get())
+               ->SocketDescriptorForTesting();
+  base::ScopedFD dup_fd(HANDLE_EINTR(dup(fd)));
+  socket.reset();
+  if (!dup_fd.is_valid()) {
+    PLOG(ERROR) << "dup failed";
+    return;
+  }
+
+  const Target& target = targets_[next_target_];
+  next_target_ = (next_target_ + 1) % targets_.size();
+  // If the proxy is gone the bound descriptor is closed with the task.
+  target.task_runner->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveProxy::AdoptSocket, target.proxy,
+                                std::move(dup_fd), peer_address));
+}
+
+}  // namespace net
@@ -0,0 +1,60 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_ACCEPT_FORWARDER_H_
+#define NET_TOOLS_NAIVE_NAIVE_ACCEPT_FORWARDER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/task/single_thread_task_runner.h"
+
+namespace net {
+
+class NaiveProxy;
+class ServerSocket;
+class StreamSocket;
+
+// Accepts connections on a listener of a thread without a network session and
+// hands the connected sockets round-robin to NaiveProxy instances on the
+// threads owning the upstream sessions. Linux only.
+class NaiveAcceptForwarder {
+ public:
+  struct Target {
+    Target();
+    Target(scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+           base::WeakPtr<NaiveProxy> proxy);
+    Target(const Target&);
+    Target& operator=(const Target&);
+    ~Target();
+
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+    // Only dereferenced on `task_runner`.
+    base::WeakPtr<NaiveProxy> proxy;
+  };
+
+  NaiveAcceptForwarder(std::unique_ptr<ServerSocket> listen_socket,
+                       std::vector<Target> targets);
+  ~NaiveAcceptForwarder();
+  NaiveAcceptForwarder(const NaiveAcceptForwarder&) = delete;
+  NaiveAcceptForwarder& operator=(const NaiveAcceptForwarder&) = delete;
+
+ private:
+  void DoAcceptLoop();
+  void OnAcceptComplete(int result);
+  void HandleAcceptResult(int result);
+
+  std::unique_ptr<ServerSocket> listen_socket_;
+  std::vector<Target> targets_;
+  size_t next_target_ = 0;
+
+  std::unique_ptr<StreamSocket> accepted_socket_;
+
+  base::WeakPtrFactory<NaiveAcceptForwarder> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_ACCEPT_FORWARDER_H_
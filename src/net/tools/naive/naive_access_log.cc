@@ -0,0 +1,106 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_access_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "base/files/file.h"
+#include "base/logging.h"
+#include "net/base/ip_address.h"
+
+namespace net {
+
+NaiveAccessLog::NaiveAccessLog() = default;
+
+NaiveAccessLog::~NaiveAccessLog() = default;
+
+// static
+scoped_refptr<NaiveAccessLog> NaiveAccessLog::Open(const base::FilePath& path,
+                                                   uint64_t capacity) {
+  auto access_log = base::WrapRefCounted(new NaiveAccessLog());
+  if (!access_log->Init(path, capacity))
+    return nullptr;
+  LOG(INFO) << "Mapped access log " << path << " with " << capacity
+            << " records, "
+            << access_log->header_->last_sequence.load(
+                   std::memory_order_relaxed)
+            << " appended before";
+  return access_log;
+}
+
+bool NaiveAccessLog::Init(const base::FilePath& path, uint64_t capacity) {
+  base::File file(path, base::File::FLAG_OPEN_ALWAYS | base::File::FLAG_READ |
+                            base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    LOG(ERROR) << "Failed to open access log " << path << ": "
+               << base::File::ErrorToString(file.error_details());
+    return false;
+  }
+
+  Layout expected = {};
+  std::memcpy(expected.magic, kMagic, sizeof(kMagic));
+  expected.version = kVersion;
+  expected.record_size = sizeof(Record);
+  expected.capacity = capacity;
+  Layout layout;
+  bool keep = file.Read(0, reinterpret_cast<char*>(&layout), sizeof(layout)) ==
+                  static_cast<int>(sizeof(layout)) &&
+              std::memcmp(&layout, &expected, sizeof(layout)) == 0;
+  // Emptied rather than cleared in the mapping, so the records start out as
+  // zero pages that are not read in.
+  if (!keep && !file.SetLength(0)) {
+    LOG(ERROR) << "Failed to truncate access log " << path;
+    return false;
+  }
+
+  size_t size = sizeof(Header) + capacity * sizeof(Record);
+  if (!file_.Initialize(std::move(file), {0, size},
+                        base::MemoryMappedFile::READ_WRITE_EXTEND)) {
+    LOG(ERROR) << "Failed to map access log " << path;
+    return false;
+  }
+  capacity_ = capacity;
+  header_ = reinterpret_cast<Header*>(file_.data());
+  records_ = reinterpret_cast<Record*>(file_.data() + sizeof(Header));
+  if (!keep) {
+    std::memcpy(&header_->layout, &expected, sizeof(expected));
+  }
+  return true;
+}
+
+// static
+void NaiveAccessLog::SetClient(const IPEndPoint& client, Entry* entry) {
+  const IPAddress& address = client.address();
+  IPAddress ipv6 = address.IsIPv4() ? ConvertIPv4ToIPv4MappedIPv6(address)
+                                    : address;
+  if (ipv6.IsIPv6()) {
+    std::copy(ipv6.bytes().begin(), ipv6.bytes().end(),
+              entry->client_address);
+  }
+  entry->client_port = client.port();
+}
+
+// static
+void NaiveAccessLog::SetDestination(const HostPortPair& destination,
+                                    Entry* entry) {
+  const std::string& host = destination.host();
+  entry->host_size = std::min(host.size(), kMaxHostSize);
+  std::memcpy(entry->host, host.data(), entry->host_size);
+  entry->destination_port = destination.port();
+}
+
+void NaiveAccessLog::Append(const Entry& entry) {
+  uint64_t sequence =
+      header_->last_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+  Record& record = records_[(sequence - 1) % capacity_];
+  // A record being written when the file is read shows as empty.
+  record.sequence.store(0, std::memory_order_relaxed);
+  std::memcpy(&record.entry, &entry, sizeof(entry));
+  record.sequence.store(sequence, std::memory_order_release);
+}
+
+}  // namespace net
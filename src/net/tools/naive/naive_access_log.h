@@ -0,0 +1,112 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_ACCESS_LOG_H_
+#define NET_TOOLS_NAIVE_NAIVE_ACCESS_LOG_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_endpoint.h"
+
+namespace net {
+
+// A record of each closed connection in a fixed size ring of fixed width
+// records, mapped from a file, for capacity planning without producing or
+// parsing log lines. Appending is a memcpy into the mapping, and the kernel
+// writes the pages out. The file survives restarts and is read offline by
+// naive_access_log_decode. Shared by the listeners of all threads.
+//
+// Layout, little-endian:
+//   Header
+//   Record[capacity], the record of sequence number N at (N - 1) % capacity
+class NaiveAccessLog : public base::RefCountedThreadSafe<NaiveAccessLog> {
+ public:
+  static constexpr char kMagic[8] = {'N', 'A', 'I', 'V', 'E', 'A', 'L', '\0'};
+  // Bumped on any change of the layout.
+  static constexpr uint32_t kVersion = 1;
+  // Bytes of the destination host kept, longer ones are cut at the end.
+  static constexpr size_t kMaxHostSize = 64;
+
+  // Whether the records of a file can be kept.
+  struct Layout {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+  };
+  struct Header {
+    Layout layout;
+    // Of the last record appended, 0 if none.
+    std::atomic<uint64_t> last_sequence;
+    uint8_t reserved[32];
+  };
+  // What is copied in at once.
+  struct Entry {
+    // Microseconds since the Unix epoch of when the connection closed.
+    int64_t close_time;
+    // Payload from the client and to it.
+    uint64_t upload_bytes;
+    uint64_t download_bytes;
+    uint32_t duration_ms;
+    // The net error that closed the connection, 0 for a clean close.
+    int32_t result;
+    // IPv4 addresses mapped into IPv6, all zero if unknown.
+    uint8_t client_address[16];
+    uint16_t client_port;
+    uint16_t destination_port;
+    // ClientProtocol.
+    uint8_t protocol;
+    uint8_t host_size;
+    uint8_t reserved[2];
+    // Not NUL-terminated.
+    char host[kMaxHostSize];
+  };
+  struct Record {
+    // Set last, after the entry, and 0 while it is being written.
+    std::atomic<uint64_t> sequence;
+    Entry entry;
+  };
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(Entry) == 120);
+  static_assert(sizeof(Record) == 128);
+
+  // Maps `path` with room for `capacity` records, going on after the
+  // records there if it has the same layout and capacity, and starting over
+  // otherwise. Returns nullptr after logging the error if it fails.
+  static scoped_refptr<NaiveAccessLog> Open(const base::FilePath& path,
+                                            uint64_t capacity);
+
+  NaiveAccessLog(const NaiveAccessLog&) = delete;
+  NaiveAccessLog& operator=(const NaiveAccessLog&) = delete;
+
+  static void SetClient(const IPEndPoint& client, Entry* entry);
+  static void SetDestination(const HostPortPair& destination, Entry* entry);
+
+  // Overwrites the oldest record once the ring is full. Can be called on
+  // any thread.
+  void Append(const Entry& entry);
+
+ private:
+  friend class base::RefCountedThreadSafe<NaiveAccessLog>;
+
+  NaiveAccessLog();
+  ~NaiveAccessLog();
+
+  bool Init(const base::FilePath& path, uint64_t capacity);
+
+  base::MemoryMappedFile file_;
+  uint64_t capacity_ = 0;
+  Header* header_ = nullptr;
+  Record* records_ = nullptr;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_ACCESS_LOG_H_
@@ -0,0 +1,148 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Prints the records of a --access-log file, oldest first, a line each of
+// tab-separated fields:
+//
+//   close time, client, destination, protocol, upload bytes,
+//   download bytes, duration in milliseconds, result
+//
+//   naive_access_log_decode access.bin
+//
+// The file can be read while naive writes it, or copied elsewhere first.
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/tools/naive/naive_access_log.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+namespace {
+
+std::string FormatTime(int64_t unix_micros) {
+  base::Time time = base::Time::UnixEpoch() + base::Microseconds(unix_micros);
+  base::Time::Exploded exploded;
+  time.UTCExplode(&exploded);
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                exploded.year, exploded.month, exploded.day_of_month,
+                exploded.hour, exploded.minute, exploded.second,
+                exploded.millisecond);
+  return buffer;
+}
+
+std::string FormatClient(const NaiveAccessLog::Entry& entry) {
+  IPAddress address(entry.client_address);
+  if (address.IsZero())
+    return "-";
+  if (address.IsIPv4MappedIPv6()) {
+    address = ConvertIPv4MappedIPv6ToIPv4(address);
+  }
+  return IPEndPoint(address, entry.client_port).ToString();
+}
+
+const char* FormatProtocol(uint8_t protocol) {
+  if (protocol > static_cast<uint8_t>(ClientProtocol::kTun))
+    return "-";
+  return ToString(static_cast<ClientProtocol>(protocol));
+}
+
+void PrintEntry(const NaiveAccessLog::Entry& entry) {
+  size_t host_size =
+      std::min<size_t>(entry.host_size, NaiveAccessLog::kMaxHostSize);
+  HostPortPair destination(std::string(entry.host, host_size),
+                           entry.destination_port);
+  std::printf("%s\t%s\t%s\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu32 "\t%s\n",
+              FormatTime(entry.close_time).c_str(),
+              FormatClient(entry).c_str(), destination.ToString().c_str(),
+              FormatProtocol(entry.protocol), entry.upload_bytes,
+              entry.download_bytes, entry.duration_ms,
+              ErrorToShortString(entry.result).c_str());
+}
+
+bool Decode(const base::FilePath& path) {
+  base::MemoryMappedFile file;
+  if (!file.Initialize(path)) {
+    std::fprintf(stderr, "Failed to map %s\n", path.AsUTF8Unsafe().c_str());
+    return false;
+  }
+  if (file.length() < sizeof(NaiveAccessLog::Header)) {
+    std::fprintf(stderr, "Invalid access log\n");
+    return false;
+  }
+  NaiveAccessLog::Layout layout;
+  std::memcpy(&layout, file.data(), sizeof(layout));
+  if (std::memcmp(layout.magic, NaiveAccessLog::kMagic,
+                  sizeof(NaiveAccessLog::kMagic)) != 0 ||
+      layout.record_size != sizeof(NaiveAccessLog::Record)) {
+    std::fprintf(stderr, "Invalid access log\n");
+    return false;
+  }
+  if (layout.version != NaiveAccessLog::kVersion) {
+    std::fprintf(stderr,
+                 "Access log has version %" PRIu32 ", expected %" PRIu32 "\n",
+                 layout.version, NaiveAccessLog::kVersion);
+    return false;
+  }
+  // Naive extends the file as it maps it, a copy may be cut short.
+  uint64_t stored = (file.length() - sizeof(NaiveAccessLog::Header)) /
+                    sizeof(NaiveAccessLog::Record);
+  uint64_t count = std::min<uint64_t>(layout.capacity, stored);
+  const auto* records = reinterpret_cast<const NaiveAccessLog::Record*>(
+      file.data() + sizeof(NaiveAccessLog::Header));
+
+  // The ring starts at the oldest record, after the newest one.
+  std::vector<std::pair<uint64_t, const NaiveAccessLog::Record*>> order;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t sequence = records[i].sequence.load(std::memory_order_acquire);
+    if (sequence != 0) {
+      order.emplace_back(sequence, &records[i]);
+    }
+  }
+  std::sort(order.begin(), order.end());
+  for (const auto& [sequence, record] : order) {
+    NaiveAccessLog::Entry entry;
+    std::memcpy(&entry, &record->entry, sizeof(entry));
+    // Overwritten while it was copied.
+    if (record->sequence.load(std::memory_order_acquire) != sequence)
+      continue;
+    PrintEntry(entry);
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+
+  if (command_line.GetArgs().size() != 1) {
+    std::fprintf(stderr, "Usage: naive_access_log_decode <path>\n");
+    return EXIT_FAILURE;
+  }
+  if (!net::Decode(base::FilePath(command_line.GetArgs()[0])))
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
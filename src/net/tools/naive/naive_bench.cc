@@ -0,0 +1,472 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_bench.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/barrier_closure.h"
+#include "base/logging.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/run_loop.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/timer/timer.h"
+#include "net/base/elements_upload_data_stream.h"
+#include "net/base/io_buffer.h"
+#include "net/base/load_flags.h"
+#include "net/base/load_timing_info.h"
+#include "net/base/net_errors.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/base/upload_element_reader.h"
+#include "net/base/upload_progress.h"
+#include "net/http/http_network_session.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_transaction_factory.h"
+#include "net/quic/quic_context.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_constants.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "net/url_request/url_request.h"
+#include "net/url_request/url_request_context.h"
+
+namespace net {
+
+namespace {
+constexpr NetworkTrafficAnnotationTag kTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_bench", "");
+// Of each download and upload test, long enough to get past slow start on
+// most paths.
+constexpr base::TimeDelta kTestDuration = base::Seconds(5);
+// For the requests timing the handshake and the round trip.
+constexpr base::TimeDelta kProbeTimeout = base::Seconds(10);
+constexpr int kReadBufferSize = 64 * 1024;
+// More than an upload sends in kTestDuration on most links.
+constexpr uint64_t kUploadBytes = 1024 * 1024 * 1024;
+// Settings within this share of the best throughput count as good as the
+// best, so fewer sessions or the faster handshake win.
+constexpr double kGoodEnough = 0.9;
+// Receive windows of HTTP/2 and QUIC sessions unless configured.
+constexpr int64_t kDefaultSessionWindow = 15 * 1024 * 1024;
+constexpr int64_t kWindowGranularity = 1024 * 1024;
+
+enum class Test {
+  // Ends once the response starts.
+  kProbe,
+  kDownload,
+  kUpload,
+};
+
+// The body of an upload, sent without holding it in memory.
+class ZeroUploadReader : public UploadElementReader {
+ public:
+  explicit ZeroUploadReader(uint64_t size) : size_(size) {}
+
+  // UploadElementReader implementation.
+  int Init(CompletionOnceCallback callback) override {
+    offset_ = 0;
+    return OK;
+  }
+  uint64_t GetContentLength() const override { return size_; }
+  uint64_t BytesRemaining() const override { return size_ - offset_; }
+  int Read(IOBuffer* buf,
+           int buf_length,
+           CompletionOnceCallback callback) override {
+    int size = static_cast<int>(
+        std::min(static_cast<uint64_t>(buf_length), BytesRemaining()));
+    memset(buf->data(), 0, size);
+    offset_ += size;
+    return size;
+  }
+
+ private:
+  const uint64_t size_;
+  uint64_t offset_ = 0;
+};
+
+// One request of a test, in a session of its own unless it shares the
+// anonymization key of another.
+class BenchRequest : public URLRequest::Delegate {
+ public:
+  BenchRequest(URLRequestContext* context,
+               const GURL& url,
+               Test test,
+               const NetworkAnonymizationKey& network_anonymization_key)
+      : test_(test) {
+    request_ = context->CreateRequest(url, MAXIMUM_PRIORITY, this,
+                                      kTrafficAnnotation);
+    request_->SetLoadFlags(LOAD_DISABLE_CACHE);
+    request_->set_allow_credentials(false);
+    request_->set_isolation_info_from_network_anonymization_key(
+        network_anonymization_key);
+    if (test == Test::kUpload) {
+      std::vector<std::unique_ptr<UploadElementReader>> readers;
+      readers.push_back(std::make_unique<ZeroUploadReader>(kUploadBytes));
+      request_->set_method("POST");
+      request_->SetExtraRequestHeaderByName(HttpRequestHeaders::kContentType,
+                                            "application/octet-stream",
+                                            /*overwrite=*/true);
+      request_->set_upload(std::make_unique<ElementsUploadDataStream>(
+          std::move(readers), /*identifier=*/0));
+    }
+  }
+  BenchRequest(const BenchRequest&) = delete;
+  BenchRequest& operator=(const BenchRequest&) = delete;
+  ~BenchRequest() override = default;
+
+  void Start(base::OnceClosure callback) {
+    callback_ = std::move(callback);
+    request_->Start();
+  }
+  // Ends the request with `result` unless it is done.
+  void Stop(int result) {
+    callback_.Reset();
+    Finish(result);
+  }
+
+  int result() const { return result_; }
+  // Of the body downloaded or uploaded.
+  int64_t bytes() const { return bytes_; }
+  const LoadTimingInfo& load_timing() const { return load_timing_; }
+
+  // URLRequest::Delegate implementation.
+  void OnResponseStarted(URLRequest* request, int net_error) override {
+    if (net_error != OK) {
+      Finish(net_error);
+      return;
+    }
+    int response_code = request->GetResponseCode();
+    if (response_code < 200 || response_code >= 300) {
+      LOG(WARNING) << "Bench request got HTTP " << response_code;
+      Finish(ERR_HTTP_RESPONSE_CODE_FAILURE);
+      return;
+    }
+    if (test_ != Test::kDownload) {
+      Finish(OK);
+      return;
+    }
+    buffer_ = base::MakeRefCounted<IOBufferWithSize>(kReadBufferSize);
+    ReadBody();
+  }
+  void OnReadCompleted(URLRequest* request, int bytes_read) override {
+    if (done_)
+      return;
+    if (bytes_read <= 0) {
+      Finish(bytes_read);
+      return;
+    }
+    bytes_ += bytes_read;
+    ReadBody();
+  }
+
+ private:
+  void ReadBody() {
+    for (;;) {
+      int rv = request_->Read(buffer_.get(), buffer_->size());
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv <= 0) {
+        Finish(rv);
+        return;
+      }
+      bytes_ += rv;
+    }
+  }
+
+  void Finish(int result) {
+    if (done_)
+      return;
+    done_ = true;
+    result_ = result;
+    request_->GetLoadTimingInfo(&load_timing_);
+    if (test_ == Test::kUpload)
+      bytes_ = request_->GetUploadProgress().position();
+    request_->Cancel();
+    if (callback_)
+      std::move(callback_).Run();
+  }
+
+  const Test test_;
+  std::unique_ptr<URLRequest> request_;
+  scoped_refptr<IOBufferWithSize> buffer_;
+  base::OnceClosure callback_;
+  bool done_ = false;
+  int result_ = ERR_IO_PENDING;
+  int64_t bytes_ = 0;
+  LoadTimingInfo load_timing_;
+};
+
+using BenchRequests = std::vector<std::unique_ptr<BenchRequest>>;
+
+// Runs `requests` at once until they are done, or until `timeout`, which
+// stops the others with `timeout_result`. Returns the time taken.
+base::TimeDelta RunRequests(const BenchRequests& requests,
+                            base::TimeDelta timeout,
+                            int timeout_result) {
+  base::RunLoop run_loop;
+  base::RepeatingClosure done =
+      base::BarrierClosure(requests.size(), run_loop.QuitClosure());
+  base::OneShotTimer timer;
+  timer.Start(FROM_HERE, timeout, run_loop.QuitClosure());
+  base::ElapsedTimer elapsed;
+  for (const auto& request : requests) {
+    request->Start(done);
+  }
+  run_loop.Run();
+  base::TimeDelta time = elapsed.Elapsed();
+  for (const auto& request : requests) {
+    request->Stop(timeout_result);
+  }
+  return time;
+}
+
+// One way of reaching a proxy of the config.
+struct Upstream {
+  NaiveProxyServerConfig proxy;
+  std::string protocol;
+  bool is_quic = false;
+};
+
+struct UpstreamResult {
+  Upstream upstream;
+  bool ok = false;
+  base::TimeDelta handshake;
+  base::TimeDelta rtt;
+  // In bits per second by the number of sessions less one, negative where
+  // the test failed.
+  std::vector<double> download;
+  std::vector<double> upload;
+  // The receive window of each session.
+  int64_t session_window = 0;
+};
+
+// HTTP/2 and QUIC for the proxies that may speak both.
+std::vector<Upstream> GetUpstreams(const NaiveConfig& config) {
+  std::vector<Upstream> upstreams;
+  for (const NaiveProxyServerConfig& proxy : config.proxies) {
+    std::string_view url = proxy.url;
+    if (url.compare(0, 9, "direct://") == 0)
+      continue;
+    size_t colon = url.find("://");
+    std::string_view scheme = url.substr(0, colon);
+    if (scheme != "https" && scheme != "quic" && scheme != "auto") {
+      upstreams.push_back({proxy, std::string(scheme), false});
+      continue;
+    }
+    std::string_view rest = url.substr(colon);
+    Upstream h2{proxy, "HTTP/2", false};
+    h2.proxy.url = base::StrCat({"https", rest});
+    upstreams.push_back(std::move(h2));
+    Upstream quic{proxy, "QUIC", true};
+    quic.proxy.url = base::StrCat({"quic", rest});
+    upstreams.push_back(std::move(quic));
+  }
+  return upstreams;
+}
+
+// Bits per second of all `requests` of a test that succeeded at least in
+// part, or -1.
+double GetThroughput(const BenchRequests& requests, base::TimeDelta time) {
+  int64_t bytes = 0;
+  for (const auto& request : requests) {
+    if (request->result() != OK)
+      return -1;
+    bytes += request->bytes();
+  }
+  if (bytes == 0 || !time.is_positive())
+    return -1;
+  return bytes * 8 / time.InSecondsF();
+}
+
+UpstreamResult MeasureUpstream(const NaiveConfig& config,
+                               const Upstream& upstream,
+                               const NaiveBenchContextFactory& factory) {
+  UpstreamResult result;
+  result.upstream = upstream;
+  std::cout << "Measuring " << upstream.proxy.url << " (" << upstream.protocol
+            << ")" << std::endl;
+
+  NaiveConfig upstream_config = config;
+  upstream_config.proxies = {upstream.proxy};
+  std::unique_ptr<URLRequestContext> context = factory.Run(upstream_config);
+  if (!context)
+    return result;
+  auto* session = context->http_transaction_factory()->GetSession();
+  if (upstream.is_quic) {
+    uint32_t window = context->quic_context()->params()
+                          ->session_flow_control_window;
+    result.session_window = window > 0 ? window : kDefaultSessionWindow;
+  } else {
+    result.session_window = session->params().spdy_session_max_recv_window_size;
+  }
+
+  // The first request pays for the handshake of its session, the second
+  // one only for its round trip.
+  NetworkAnonymizationKey probe_key =
+      NetworkAnonymizationKey::CreateTransient();
+  for (int i = 0; i < 2; ++i) {
+    BenchRequests probe;
+    probe.push_back(std::make_unique<BenchRequest>(
+        context.get(), config.bench_url, Test::kProbe, probe_key));
+    RunRequests(probe, kProbeTimeout, ERR_TIMED_OUT);
+    if (probe[0]->result() != OK) {
+      std::cout << "  failed: " << ErrorToShortString(probe[0]->result())
+                << std::endl;
+      return result;
+    }
+    const LoadTimingInfo& timing = probe[0]->load_timing();
+    if (i == 0) {
+      // Null if a session was already there.
+      if (!timing.connect_timing.connect_start.is_null()) {
+        result.handshake = timing.connect_timing.connect_end -
+                           timing.connect_timing.connect_start;
+      }
+    } else {
+      result.rtt = timing.receive_headers_end - timing.send_start;
+    }
+  }
+  result.ok = true;
+  std::cout << base::StringPrintf(
+                   "  handshake %lld ms, request round trip %lld ms",
+                   static_cast<long long>(result.handshake.InMilliseconds()),
+                   static_cast<long long>(result.rtt.InMilliseconds()))
+            << std::endl;
+
+  for (int sessions = 1; sessions <= config.bench_sessions; ++sessions) {
+    std::vector<NetworkAnonymizationKey> keys;
+    BenchRequests warmups;
+    for (int i = 0; i < sessions; ++i) {
+      keys.push_back(NetworkAnonymizationKey::CreateTransient());
+      warmups.push_back(std::make_unique<BenchRequest>(
+          context.get(), config.bench_url, Test::kProbe, keys.back()));
+    }
+    // The sessions are set up before the tests, which do not time their
+    // handshakes.
+    RunRequests(warmups, kProbeTimeout, ERR_TIMED_OUT);
+    for (Test test : {Test::kDownload, Test::kUpload}) {
+      BenchRequests requests;
+      for (const NetworkAnonymizationKey& key : keys) {
+        requests.push_back(std::make_unique<BenchRequest>(
+            context.get(), config.bench_url, test, key));
+      }
+      base::TimeDelta time = RunRequests(requests, kTestDuration, OK);
+      double throughput = GetThroughput(requests, time);
+      (test == Test::kDownload ? result.download : result.upload)
+          .push_back(throughput);
+    }
+  }
+  return result;
+}
+
+std::string FormatThroughput(double bits_per_second) {
+  if (bits_per_second < 0)
+    return "-";
+  return base::StringPrintf("%.1f Mbps", bits_per_second / 1e6);
+}
+
+double GetBest(const std::vector<double>& throughputs) {
+  double best = -1;
+  for (double throughput : throughputs) {
+    best = std::max(best, throughput);
+  }
+  return best;
+}
+
+void PrintResults(const std::vector<UpstreamResult>& results) {
+  std::cout << std::endl;
+  for (const UpstreamResult& result : results) {
+    std::cout << result.upstream.proxy.url << " (" << result.upstream.protocol
+              << ")" << std::endl;
+    if (!result.ok) {
+      std::cout << "  failed" << std::endl;
+      continue;
+    }
+    std::cout << base::StringPrintf("  %-10s%-16s%s", "sessions", "download",
+                                    "upload")
+              << std::endl;
+    for (size_t i = 0; i < result.download.size(); ++i) {
+      std::cout << base::StringPrintf(
+                       "  %-10zu%-16s%s", i + 1,
+                       FormatThroughput(result.download[i]).c_str(),
+                       FormatThroughput(result.upload[i]).c_str())
+                << std::endl;
+    }
+  }
+}
+
+void PrintRecommendation(const NaiveConfig& config,
+                         const std::vector<UpstreamResult>& results) {
+  double best_overall = -1;
+  for (const UpstreamResult& result : results) {
+    if (result.ok)
+      best_overall = std::max(best_overall, GetBest(result.download));
+  }
+  if (best_overall < 0) {
+    std::cout << "No upstream could be measured." << std::endl;
+    return;
+  }
+  // The fastest handshake among those about as fast as the fastest one.
+  const UpstreamResult* pick = nullptr;
+  for (const UpstreamResult& result : results) {
+    if (!result.ok || GetBest(result.download) < best_overall * kGoodEnough)
+      continue;
+    if (!pick || result.handshake < pick->handshake)
+      pick = &result;
+  }
+  double best = GetBest(pick->download);
+  int sessions = 1;
+  while (pick->download[sessions - 1] < best * kGoodEnough)
+    ++sessions;
+
+  std::cout << std::endl << "Recommended:" << std::endl;
+  std::cout << "  --proxy=" << pick->upstream.proxy.url << std::endl;
+  if (sessions != config.insecure_concurrency) {
+    std::cout << "  --insecure-concurrency=" << sessions << std::endl;
+  }
+  // Twice the bandwidth-delay product of a session keeps the proxy from
+  // waiting on window updates.
+  double session_rate = pick->download[sessions - 1] / 8 / sessions;
+  int64_t window =
+      static_cast<int64_t>(2 * session_rate * pick->rtt.InSecondsF());
+  window = (window + kWindowGranularity - 1) / kWindowGranularity *
+           kWindowGranularity;
+  if (window > pick->session_window) {
+    if (pick->upstream.is_quic) {
+      window = std::min<int64_t>(window, quic::kSessionReceiveWindowLimit);
+      std::cout << "  --quic-session-window=" << window << std::endl;
+    } else {
+      std::cout << "  --h2-session-window=" << window << std::endl;
+    }
+  }
+}
+}  // namespace
+
+bool RunBench(const NaiveConfig& config,
+              const NaiveBenchContextFactory& context_factory) {
+  std::vector<Upstream> upstreams = GetUpstreams(config);
+  if (upstreams.empty()) {
+    std::cerr << "bench needs a proxy" << std::endl;
+    return false;
+  }
+  std::vector<UpstreamResult> results;
+  for (const Upstream& upstream : upstreams) {
+    results.push_back(MeasureUpstream(config, upstream, context_factory));
+  }
+  PrintResults(results);
+  PrintRecommendation(config, results);
+  return std::any_of(
+      results.begin(), results.end(),
+      [](const UpstreamResult& result) { return result.ok; });
+}
+
+}  // namespace net
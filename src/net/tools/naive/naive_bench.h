@@ -0,0 +1,32 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_BENCH_H_
+#define NET_TOOLS_NAIVE_NAIVE_BENCH_H_
+
+#include <memory>
+
+#include "base/functional/callback.h"
+
+namespace net {
+
+struct NaiveConfig;
+class URLRequestContext;
+
+// Builds a context proxying through the upstreams of `config`.
+using NaiveBenchContextFactory =
+    base::RepeatingCallback<std::unique_ptr<URLRequestContext>(
+        const NaiveConfig& config)>;
+
+// Runs --bench on the calling IO thread. Each proxy of `config` is measured
+// over HTTP/2 and over QUIC, or as is if it is neither: the handshake of a
+// new session, the round trip of a request to NaiveConfig::bench_url
+// through it, and the throughput of downloads from and uploads to that URL
+// through 1 to NaiveConfig::bench_sessions sessions at once. Prints the
+// results and the settings they suggest, and returns false if no upstream
+// could be measured.
+bool RunBench(const NaiveConfig& config,
+              const NaiveBenchContextFactory& context_factory);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_BENCH_H_
@@ -0,0 +1,190 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_bond_joiner.h"
+
+#include <string_view>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/functional/callback_helpers.h"
+#include "base/logging.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/socket/stream_socket.h"
+
+namespace net {
+
+namespace {
+// Members of a bond are opened together, so the last arrives within a few
+// round trips of the first.
+constexpr base::TimeDelta kJoinTimeout = base::Seconds(10);
+constexpr base::TimeDelta kExpireInterval = base::Seconds(1);
+// Bounds what clients can leave waiting.
+constexpr size_t kMaxPendingMembers = 256;
+constexpr size_t kMaxPendingBonds = 64;
+constexpr int kMaxHelloSize = NaiveBondSocket::kHelloSize + 255;
+}  // namespace
+
+NaiveBondJoiner::PendingMember::PendingMember() = default;
+
+NaiveBondJoiner::PendingMember::~PendingMember() = default;
+
+NaiveBondJoiner::Bond::Bond() = default;
+
+NaiveBondJoiner::Bond::Bond(Bond&&) = default;
+
+NaiveBondJoiner::Bond& NaiveBondJoiner::Bond::operator=(Bond&&) = default;
+
+NaiveBondJoiner::Bond::~Bond() = default;
+
+NaiveBondJoiner::NaiveBondJoiner(
+    const NetworkTrafficAnnotationTag& traffic_annotation,
+    BondCallback bond_callback)
+    : traffic_annotation_(traffic_annotation),
+      bond_callback_(std::move(bond_callback)) {}
+
+NaiveBondJoiner::~NaiveBondJoiner() = default;
+
+void NaiveBondJoiner::AddMember(std::unique_ptr<StreamSocket> socket,
+                                PaddingType padding_type) {
+  if (pending_members_.size() >= kMaxPendingMembers) {
+    LOG(WARNING) << "Too many bond members pending";
+    return;
+  }
+  // Sends the tunnel response, synchronously for the streams of both
+  // listeners.
+  int rv = socket->Connect(base::DoNothing());
+  if (rv != OK)
+    return;
+
+  auto member = std::make_unique<PendingMember>();
+  member->socket = std::move(socket);
+  member->padding_type = padding_type;
+  member->buffer = base::MakeRefCounted<IOBufferWithSize>(kMaxHelloSize);
+  member->deadline = base::TimeTicks::Now() + kJoinTimeout;
+  unsigned int member_id = ++last_member_id_;
+  pending_members_.emplace(member_id, std::move(member));
+  MaybeStartExpireTimer();
+  ReadHello(member_id);
+}
+
+void NaiveBondJoiner::ReadHello(unsigned int member_id) {
+  for (;;) {
+    PendingMember* member = pending_members_[member_id].get();
+    // Reads no further than the hello, leaving the chunks after it to the
+    // bond.
+    int rv = member->socket->Read(
+        member->buffer.get(),
+        member->hello_size - static_cast<int>(member->data.size()),
+        base::BindOnce(&NaiveBondJoiner::OnHelloRead,
+                       weak_ptr_factory_.GetWeakPtr(), member_id));
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (!HandleHelloRead(member_id, rv))
+      return;
+  }
+}
+
+void NaiveBondJoiner::OnHelloRead(unsigned int member_id, int result) {
+  if (!pending_members_.count(member_id))
+    return;
+  if (HandleHelloRead(member_id, result))
+    ReadHello(member_id);
+}
+
+bool NaiveBondJoiner::HandleHelloRead(unsigned int member_id, int result) {
+  auto it = pending_members_.find(member_id);
+  if (result <= 0) {
+    pending_members_.erase(it);
+    return false;
+  }
+  PendingMember* member = it->second.get();
+  member->data.append(member->buffer->data(), result);
+  if (static_cast<int>(member->data.size()) < member->hello_size)
+    return true;
+
+  std::string_view data(member->data);
+  if (member->hello_size == NaiveBondSocket::kHelloSize) {
+    int host_length = NaiveBondSocket::ParseHelloHeader(data, &member->hello);
+    if (host_length < 0) {
+      LOG(WARNING) << "Invalid bond hello";
+      pending_members_.erase(it);
+      return false;
+    }
+    member->hello_size += host_length;
+    return true;
+  }
+  member->hello.request_endpoint.set_host(
+      std::string(data.substr(NaiveBondSocket::kHelloSize)));
+  std::unique_ptr<PendingMember> joined = std::move(it->second);
+  pending_members_.erase(it);
+  Join(std::move(joined));
+  return false;
+}
+
+void NaiveBondJoiner::Join(std::unique_ptr<PendingMember> member) {
+  const NaiveBondSocket::Hello& hello = member->hello;
+  auto it = bonds_.find(hello.bond_id);
+  if (it == bonds_.end()) {
+    if (bonds_.size() >= kMaxPendingBonds) {
+      LOG(WARNING) << "Too many bonds pending";
+      return;
+    }
+    Bond bond;
+    bond.request_endpoint = hello.request_endpoint;
+    bond.members.resize(hello.count);
+    bond.deadline = member->deadline;
+    it = bonds_.emplace(hello.bond_id, std::move(bond)).first;
+  }
+  Bond& bond = it->second;
+  // Members disagreeing on the bond close it, as it cannot complete.
+  if (bond.members.size() != static_cast<size_t>(hello.count) ||
+      !bond.request_endpoint.Equals(hello.request_endpoint) ||
+      bond.members[hello.index]) {
+    LOG(WARNING) << "Invalid bond member " << hello.index;
+    bonds_.erase(it);
+    return;
+  }
+  if (hello.index == 0) {
+    bond.padding_type = member->padding_type;
+  }
+  bond.members[hello.index] = std::move(member->socket);
+  if (++bond.joined < bond.members.size())
+    return;
+
+  auto socket = std::make_unique<NaiveBondSocket>(
+      std::move(bond.members), bond.request_endpoint, traffic_annotation_);
+  PaddingType padding_type = bond.padding_type;
+  bonds_.erase(it);
+  bond_callback_.Run(std::move(socket), padding_type);
+}
+
+void NaiveBondJoiner::ExpireStale() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  std::erase_if(pending_members_, [now](const auto& entry) {
+    return entry.second->deadline < now;
+  });
+  std::erase_if(bonds_, [now](const auto& entry) {
+    if (entry.second.deadline >= now)
+      return false;
+    LOG(INFO) << "Bond to " << entry.second.request_endpoint.ToString()
+              << " timed out with " << entry.second.joined << " of "
+              << entry.second.members.size() << " members";
+    return true;
+  });
+  if (pending_members_.empty() && bonds_.empty()) {
+    expire_timer_.Stop();
+  }
+}
+
+void NaiveBondJoiner::MaybeStartExpireTimer() {
+  if (expire_timer_.IsRunning())
+    return;
+  // Unretained is safe because the timer is owned by this.
+  expire_timer_.Start(FROM_HERE, kExpireInterval,
+                      base::BindRepeating(&NaiveBondJoiner::ExpireStale,
+                                          base::Unretained(this)));
+}
+
+}  // namespace net
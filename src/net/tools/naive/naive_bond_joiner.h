@@ -0,0 +1,102 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_BOND_JOINER_H_
+#define NET_TOOLS_NAIVE_NAIVE_BOND_JOINER_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/host_port_pair.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+class IOBufferWithSize;
+class StreamSocket;
+struct NetworkTrafficAnnotationTag;
+
+// Joins the tunnels to kBondHost of a server into NaiveBondSocket streams.
+// Each tunnel is answered, then its hello read, and once all the members
+// named by the hellos of a bond arrived the bond is handed over. Tunnels of
+// bonds not complete within a timeout are closed.
+class NaiveBondJoiner {
+ public:
+  // With the padding type of the first member, by which the client pads the
+  // bond.
+  using BondCallback =
+      base::RepeatingCallback<void(std::unique_ptr<NaiveBondSocket> socket,
+                                   PaddingType padding_type)>;
+
+  NaiveBondJoiner(const NetworkTrafficAnnotationTag& traffic_annotation,
+                  BondCallback bond_callback);
+  ~NaiveBondJoiner();
+  NaiveBondJoiner(const NaiveBondJoiner&) = delete;
+  NaiveBondJoiner& operator=(const NaiveBondJoiner&) = delete;
+
+  // Takes a tunnel of an https:// or quic:// listener to kBondHost, whose
+  // padding was negotiated with `padding_type`.
+  void AddMember(std::unique_ptr<StreamSocket> socket,
+                 PaddingType padding_type);
+
+ private:
+  struct PendingMember {
+    PendingMember();
+    ~PendingMember();
+
+    std::unique_ptr<StreamSocket> socket;
+    PaddingType padding_type;
+    scoped_refptr<IOBufferWithSize> buffer;
+    // Of the hello read so far.
+    std::string data;
+    // kHelloSize until the host length is known.
+    int hello_size = NaiveBondSocket::kHelloSize;
+    NaiveBondSocket::Hello hello;
+    base::TimeTicks deadline;
+  };
+
+  struct Bond {
+    Bond();
+    Bond(Bond&&);
+    Bond& operator=(Bond&&);
+    ~Bond();
+
+    HostPortPair request_endpoint;
+    // Indexed by the member index, null until it arrived.
+    std::vector<std::unique_ptr<StreamSocket>> members;
+    size_t joined = 0;
+    PaddingType padding_type = PaddingType::kNone;
+    base::TimeTicks deadline;
+  };
+
+  void ReadHello(unsigned int member_id);
+  void OnHelloRead(unsigned int member_id, int result);
+  // Returns false once the member is removed.
+  bool HandleHelloRead(unsigned int member_id, int result);
+  void Join(std::unique_ptr<PendingMember> member);
+  // Closes the members and bonds past their deadline.
+  void ExpireStale();
+  void MaybeStartExpireTimer();
+
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+  const BondCallback bond_callback_;
+
+  unsigned int last_member_id_ = 0;
+  std::map<unsigned int, std::unique_ptr<PendingMember>> pending_members_;
+  std::map<std::string, Bond> bonds_;
+  base::RepeatingTimer expire_timer_;
+
+  base::WeakPtrFactory<NaiveBondJoiner> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_BOND_JOINER_H_
@@ -0,0 +1,524 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_bond_socket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "net/base/ip_endpoint.h"
+
+namespace net {
+
+namespace {
+constexpr char kHelloMagic[4] = {'N', 'B', 'N', 'D'};
+constexpr uint8_t kHelloVersion = 1;
+constexpr int kMemberReadBufferSize =
+    NaiveBondSocket::kMaxChunkSize + NaiveBondSocket::kChunkHeaderSize;
+// Member reads stop past this while the next chunk is buffered. They go on
+// while it is missing, as it may be behind a chunk of the same member.
+constexpr size_t kMaxBufferedBytes = 1024 * 1024;
+}  // namespace
+
+NaiveBondSocket::Member::Member() = default;
+
+NaiveBondSocket::Member::Member(Member&&) = default;
+
+NaiveBondSocket::Member& NaiveBondSocket::Member::operator=(Member&&) =
+    default;
+
+NaiveBondSocket::Member::~Member() = default;
+
+// static
+std::string NaiveBondSocket::SerializeHello(const Hello& hello) {
+  DCHECK_EQ(hello.bond_id.size(), kBondIdSize);
+  const std::string& host = hello.request_endpoint.host();
+  DCHECK(!host.empty() && host.size() <= 255);
+  std::string out(kHelloMagic, sizeof(kHelloMagic));
+  out.push_back(kHelloVersion);
+  out.push_back(static_cast<char>(hello.index));
+  out.push_back(static_cast<char>(hello.count));
+  out.push_back(static_cast<char>(host.size()));
+  out.append(hello.bond_id);
+  uint16_t port = hello.request_endpoint.port();
+  out.push_back(static_cast<char>(port / 256));
+  out.push_back(static_cast<char>(port % 256));
+  out.append(host);
+  return out;
+}
+
+// static
+int NaiveBondSocket::ParseHelloHeader(std::string_view data, Hello* hello) {
+  if (data.size() < kHelloSize ||
+      std::memcmp(data.data(), kHelloMagic, sizeof(kHelloMagic)) != 0 ||
+      static_cast<uint8_t>(data[4]) != kHelloVersion)
+    return -1;
+  int index = static_cast<uint8_t>(data[5]);
+  int count = static_cast<uint8_t>(data[6]);
+  int host_length = static_cast<uint8_t>(data[7]);
+  if (count < 2 || count > kMaxMembers || index >= count || host_length == 0)
+    return -1;
+  hello->index = index;
+  hello->count = count;
+  hello->bond_id = std::string(data.substr(8, kBondIdSize));
+  hello->request_endpoint.set_port(static_cast<uint8_t>(data[24]) * 256 +
+                                   static_cast<uint8_t>(data[25]));
+  return host_length;
+}
+
+NaiveBondSocket::NaiveBondSocket(
+    std::vector<std::unique_ptr<StreamSocket>> members,
+    const HostPortPair& request_endpoint,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : NaiveBondSocket(members.size(),
+                      request_endpoint,
+                      std::string(),
+                      traffic_annotation) {
+  for (size_t i = 0; i < members.size(); ++i) {
+    members_[i].owned_socket = std::move(members[i]);
+    members_[i].socket = members_[i].owned_socket.get();
+  }
+}
+
+NaiveBondSocket::NaiveBondSocket(
+    std::vector<std::unique_ptr<ClientSocketHandle>> members,
+    const HostPortPair& request_endpoint,
+    const std::string& bond_id,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : NaiveBondSocket(members.size(),
+                      request_endpoint,
+                      bond_id,
+                      traffic_annotation) {
+  DCHECK_EQ(bond_id_.size(), kBondIdSize);
+  for (size_t i = 0; i < members.size(); ++i) {
+    members_[i].handle = std::move(members[i]);
+    members_[i].socket = members_[i].handle->socket();
+  }
+}
+
+NaiveBondSocket::NaiveBondSocket(
+    size_t member_count,
+    const HostPortPair& request_endpoint,
+    const std::string& bond_id,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : request_endpoint_(request_endpoint),
+      bond_id_(bond_id),
+      traffic_annotation_(traffic_annotation) {
+  DCHECK_GE(member_count, 2u);
+  DCHECK_LE(member_count, static_cast<size_t>(kMaxMembers));
+  members_.resize(member_count);
+  for (size_t i = 0; i < member_count; ++i) {
+    members_[i].read_callback = base::BindRepeating(
+        &NaiveBondSocket::OnMemberReadComplete,
+        weak_ptr_factory_.GetWeakPtr(), i);
+    members_[i].write_callback = base::BindRepeating(
+        &NaiveBondSocket::OnMemberWriteComplete,
+        weak_ptr_factory_.GetWeakPtr(), i);
+  }
+}
+
+NaiveBondSocket::~NaiveBondSocket() {
+  Disconnect();
+}
+
+int NaiveBondSocket::Flush(CompletionOnceCallback callback) {
+  DCHECK(!flush_callback_);
+  if (error_ != OK)
+    return error_;
+  if (!HasPendingWrites())
+    return OK;
+  flush_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int NaiveBondSocket::Connect(CompletionOnceCallback callback) {
+  if (connected_)
+    return OK;
+  connected_ = true;
+  // The hellos go first on the members, which take no chunk until theirs is
+  // written.
+  if (!bond_id_.empty()) {
+    int count = static_cast<int>(members_.size());
+    for (int i = 0; i < count && error_ == OK; ++i) {
+      Hello hello = {i, count, bond_id_, request_endpoint_};
+      StartMemberWrite(i, SerializeHello(hello));
+    }
+  }
+  if (error_ == OK) {
+    ReadMembers();
+  }
+  return error_;
+}
+
+void NaiveBondSocket::Disconnect() {
+  connected_ = false;
+  if (error_ == OK) {
+    error_ = ERR_CONNECTION_CLOSED;
+  }
+  for (Member& member : members_) {
+    member.socket->Disconnect();
+    member.write_buf = nullptr;
+    member.read_buf = nullptr;
+    member.read_pending = false;
+  }
+  read_buf_ = nullptr;
+  read_callback_.Reset();
+  write_buf_ = nullptr;
+  write_callback_.Reset();
+  flush_callback_.Reset();
+}
+
+bool NaiveBondSocket::IsConnected() const {
+  if (!connected_ || error_ != OK)
+    return false;
+  return std::all_of(members_.begin(), members_.end(),
+                     [](const Member& member) {
+                       return member.eof || member.socket->IsConnected();
+                     });
+}
+
+bool NaiveBondSocket::IsConnectedAndIdle() const {
+  return IsConnected() && chunks_.empty();
+}
+
+const NetLogWithSource& NaiveBondSocket::NetLog() const {
+  return members_[0].socket->NetLog();
+}
+
+bool NaiveBondSocket::WasEverUsed() const {
+  return was_ever_used_;
+}
+
+NextProto NaiveBondSocket::GetNegotiatedProtocol() const {
+  return kProtoUnknown;
+}
+
+bool NaiveBondSocket::GetSSLInfo(SSLInfo* ssl_info) {
+  return false;
+}
+
+int64_t NaiveBondSocket::GetTotalReceivedBytes() const {
+  return total_received_bytes_;
+}
+
+void NaiveBondSocket::ApplySocketTag(const SocketTag& tag) {
+  for (Member& member : members_) {
+    member.socket->ApplySocketTag(tag);
+  }
+}
+
+int NaiveBondSocket::Read(IOBuffer* buf,
+                          int buf_len,
+                          CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  DCHECK(callback);
+  int rv = DoRead(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    read_buf_ = buf;
+    read_buf_len_ = buf_len;
+    read_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveBondSocket::Write(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  DCHECK(!write_callback_);
+  DCHECK(callback);
+  int rv = WriteChunk(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    write_buf_ = buf;
+    write_buf_len_ = buf_len;
+    write_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveBondSocket::SetReceiveBufferSize(int32_t size) {
+  // Like SpdyProxyClientSocket, as the members share their connections.
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveBondSocket::SetSendBufferSize(int32_t size) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveBondSocket::GetPeerAddress(IPEndPoint* address) const {
+  return members_[0].socket->GetPeerAddress(address);
+}
+
+int NaiveBondSocket::GetLocalAddress(IPEndPoint* address) const {
+  return members_[0].socket->GetLocalAddress(address);
+}
+
+bool NaiveBondSocket::HasPendingWrites() const {
+  return std::any_of(
+      members_.begin(), members_.end(),
+      [](const Member& member) { return member.write_buf != nullptr; });
+}
+
+int NaiveBondSocket::WriteChunk(IOBuffer* buf, int buf_len) {
+  if (error_ != OK)
+    return error_;
+  // Round robin over the idle members, so a slow member takes fewer chunks.
+  size_t count = members_.size();
+  size_t index = count;
+  for (size_t i = 0; i < count; ++i) {
+    size_t candidate = (next_write_member_ + i) % count;
+    if (!members_[candidate].write_buf) {
+      index = candidate;
+      break;
+    }
+  }
+  if (index == count)
+    return ERR_IO_PENDING;
+  next_write_member_ = (index + 1) % count;
+
+  int length = std::min(buf_len, kMaxChunkSize);
+  uint32_t sequence = next_write_sequence_++;
+  std::string chunk;
+  chunk.reserve(kChunkHeaderSize + length);
+  chunk.push_back(static_cast<char>(sequence >> 24));
+  chunk.push_back(static_cast<char>(sequence >> 16));
+  chunk.push_back(static_cast<char>(sequence >> 8));
+  chunk.push_back(static_cast<char>(sequence));
+  chunk.push_back(static_cast<char>(length / 256));
+  chunk.push_back(static_cast<char>(length % 256));
+  chunk.append(buf->data(), length);
+  StartMemberWrite(index, std::move(chunk));
+  if (error_ != OK)
+    return error_;
+  was_ever_used_ = true;
+  return length;
+}
+
+void NaiveBondSocket::StartMemberWrite(size_t index, std::string data) {
+  Member& member = members_[index];
+  DCHECK(!member.write_buf);
+  int size = static_cast<int>(data.size());
+  member.write_buf = base::MakeRefCounted<DrainableIOBuffer>(
+      base::MakeRefCounted<StringIOBuffer>(std::move(data)), size);
+  DoMemberWrite(index);
+}
+
+void NaiveBondSocket::DoMemberWrite(size_t index) {
+  Member& member = members_[index];
+  while (member.write_buf) {
+    int rv = member.socket->Write(
+        member.write_buf.get(), member.write_buf->BytesRemaining(),
+        base::BindOnce(member.write_callback), traffic_annotation_);
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (!HandleMemberWrite(index, rv))
+      return;
+  }
+}
+
+bool NaiveBondSocket::HandleMemberWrite(size_t index, int result) {
+  Member& member = members_[index];
+  if (result < 0) {
+    member.write_buf = nullptr;
+    error_ = result;
+    return false;
+  }
+  member.write_buf->DidConsume(result);
+  if (member.write_buf->BytesRemaining() == 0) {
+    member.write_buf = nullptr;
+  }
+  return true;
+}
+
+void NaiveBondSocket::OnMemberWriteComplete(size_t index, int result) {
+  if (HandleMemberWrite(index, result)) {
+    DoMemberWrite(index);
+  }
+  if (error_ != OK) {
+    OnError();
+    return;
+  }
+  if (members_[index].write_buf)
+    return;
+
+  // The callbacks may disconnect this.
+  base::WeakPtr<NaiveBondSocket> self = weak_ptr_factory_.GetWeakPtr();
+  if (write_callback_) {
+    int rv = WriteChunk(write_buf_.get(), write_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      write_buf_ = nullptr;
+      std::move(write_callback_).Run(rv);
+      if (!self)
+        return;
+    }
+  }
+  if (flush_callback_ && !HasPendingWrites()) {
+    std::move(flush_callback_).Run(error_);
+  }
+}
+
+bool NaiveBondSocket::IsReadPaused() const {
+  return buffered_bytes_ >= kMaxBufferedBytes &&
+         chunks_.count(next_read_sequence_) != 0;
+}
+
+void NaiveBondSocket::ReadMembers() {
+  for (size_t i = 0; i < members_.size() && error_ == OK; ++i) {
+    ReadMember(i);
+  }
+}
+
+void NaiveBondSocket::ReadMember(size_t index) {
+  Member& member = members_[index];
+  while (connected_ && !member.eof && !member.read_pending &&
+         error_ == OK && !IsReadPaused()) {
+    if (!member.read_buf) {
+      member.read_buf =
+          base::MakeRefCounted<IOBufferWithSize>(kMemberReadBufferSize);
+    }
+    int rv = member.socket->Read(member.read_buf.get(),
+                                 kMemberReadBufferSize,
+                                 base::BindOnce(member.read_callback));
+    if (rv == ERR_IO_PENDING) {
+      member.read_pending = true;
+      return;
+    }
+    if (!HandleMemberRead(index, rv))
+      return;
+  }
+}
+
+bool NaiveBondSocket::HandleMemberRead(size_t index, int result) {
+  Member& member = members_[index];
+  if (result == 0) {
+    member.eof = true;
+    member.read_buf = nullptr;
+    ++eof_count_;
+    if (member.header_bytes != 0 || member.payload_remaining != 0) {
+      error_ = ERR_CONNECTION_CLOSED;
+    }
+    return false;
+  }
+  if (result < 0) {
+    error_ = result;
+    return false;
+  }
+  total_received_bytes_ += result;
+
+  const char* data = member.read_buf->data();
+  int remaining = result;
+  while (remaining > 0) {
+    if (member.payload_remaining == 0) {
+      int n = std::min(remaining, kChunkHeaderSize - member.header_bytes);
+      std::memcpy(member.header + member.header_bytes, data, n);
+      member.header_bytes += n;
+      data += n;
+      remaining -= n;
+      if (member.header_bytes < kChunkHeaderSize)
+        break;
+      member.header_bytes = 0;
+      const uint8_t* header = member.header;
+      uint32_t sequence = (uint32_t{header[0]} << 24) |
+                          (uint32_t{header[1]} << 16) |
+                          (uint32_t{header[2]} << 8) | uint32_t{header[3]};
+      int length = header[4] * 256 + header[5];
+      if (length == 0 || length > kMaxChunkSize ||
+          sequence < next_read_sequence_ || chunks_.count(sequence) != 0) {
+        error_ = ERR_INVALID_RESPONSE;
+        return false;
+      }
+      member.sequence = sequence;
+      member.payload_remaining = length;
+      member.payload.reserve(length);
+      continue;
+    }
+    int n = std::min(remaining, member.payload_remaining);
+    member.payload.append(data, n);
+    member.payload_remaining -= n;
+    data += n;
+    remaining -= n;
+    if (member.payload_remaining == 0) {
+      buffered_bytes_ += member.payload.size();
+      chunks_.emplace(member.sequence, std::move(member.payload));
+      member.payload.clear();
+    }
+  }
+  return true;
+}
+
+void NaiveBondSocket::OnMemberReadComplete(size_t index, int result) {
+  members_[index].read_pending = false;
+  if (HandleMemberRead(index, result)) {
+    ReadMember(index);
+  }
+  if (error_ != OK) {
+    OnError();
+    return;
+  }
+  if (read_callback_) {
+    int rv = DoRead(read_buf_.get(), read_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      read_buf_ = nullptr;
+      std::move(read_callback_).Run(rv);
+    }
+  }
+}
+
+int NaiveBondSocket::DoRead(IOBuffer* buf, int buf_len) {
+  int copied = 0;
+  while (copied < buf_len) {
+    auto it = chunks_.find(next_read_sequence_);
+    if (it == chunks_.end())
+      break;
+    const std::string& chunk = it->second;
+    size_t n = std::min(chunk.size() - read_offset_,
+                        static_cast<size_t>(buf_len - copied));
+    std::memcpy(buf->data() + copied, chunk.data() + read_offset_, n);
+    copied += static_cast<int>(n);
+    read_offset_ += n;
+    if (read_offset_ == chunk.size()) {
+      buffered_bytes_ -= chunk.size();
+      chunks_.erase(it);
+      ++next_read_sequence_;
+      read_offset_ = 0;
+    }
+  }
+  if (copied > 0) {
+    was_ever_used_ = true;
+    // Resumes the members paused on the buffer limit.
+    ReadMembers();
+    return copied;
+  }
+  if (error_ != OK)
+    return error_;
+  if (eof_count_ == members_.size())
+    return chunks_.empty() ? 0 : ERR_CONNECTION_CLOSED;
+  return ERR_IO_PENDING;
+}
+
+void NaiveBondSocket::OnError() {
+  DCHECK_NE(error_, OK);
+  // The callbacks may disconnect this.
+  base::WeakPtr<NaiveBondSocket> self = weak_ptr_factory_.GetWeakPtr();
+  if (read_callback_) {
+    read_buf_ = nullptr;
+    std::move(read_callback_).Run(error_);
+    if (!self)
+      return;
+  }
+  if (write_callback_) {
+    write_buf_ = nullptr;
+    std::move(write_callback_).Run(error_);
+    if (!self)
+      return;
+  }
+  if (flush_callback_) {
+    std::move(flush_callback_).Run(error_);
+  }
+}
+
+}  // namespace net
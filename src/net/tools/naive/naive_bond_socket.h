@@ -0,0 +1,213 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_BOND_SOCKET_H_
+#define NET_TOOLS_NAIVE_NAIVE_BOND_SOCKET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/completion_repeating_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/client_socket_handle.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/stream_socket.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+
+// One byte stream striped over several tunnels, its members, each on its own
+// tunnel session, so that a large transfer is not capped by the congestion
+// window of one upstream connection. Writes are cut into chunks sent on
+// whichever member is idle, and reads put the chunks of all members back in
+// order. The client opens the members to kBondHost, see NaiveConnection, and
+// the server joins them with NaiveBondJoiner.
+//
+// Each member starts with a hello from the client, then carries chunks both
+// ways, in network byte order:
+//   struct Hello {
+//     uint8_t magic[4];  // "NBND"
+//     uint8_t version;  // 1
+//     uint8_t index;
+//     uint8_t count;
+//     uint8_t host_length;
+//     uint8_t bond_id[16];
+//     uint16_t port;
+//     uint8_t host[host_length];
+//   };
+//   struct Chunk {
+//     uint32_t sequence;  // From 0, over the chunks of all members.
+//     uint16_t length;  // 1 to kMaxChunkSize.
+//     uint8_t payload[length];
+//   };
+// The stream ends once every member has ended.
+class NaiveBondSocket : public StreamSocket {
+ public:
+  static constexpr int kMaxMembers = 8;
+  static constexpr int kMaxChunkSize = 16 * 1024;
+  static constexpr size_t kBondIdSize = 16;
+  // Of the hello before the host.
+  static constexpr int kHelloSize = 26;
+  static constexpr int kChunkHeaderSize = 6;
+
+  struct Hello {
+    int index = 0;
+    int count = 0;
+    std::string bond_id;
+    HostPortPair request_endpoint;
+  };
+
+  static std::string SerializeHello(const Hello& hello);
+  // Parses the first kHelloSize bytes of a hello into `hello`, except the
+  // host. Returns the length of the host that follows, or -1 if invalid.
+  static int ParseHelloHeader(std::string_view data, Hello* hello);
+
+  // On the server side, over the tunnels whose hellos to `request_endpoint`
+  // have been read, member i carrying the hello of index i.
+  NaiveBondSocket(std::vector<std::unique_ptr<StreamSocket>> members,
+                  const HostPortPair& request_endpoint,
+                  const NetworkTrafficAnnotationTag& traffic_annotation);
+  // On the client side, over the connected tunnels of `members`. Connect()
+  // sends their hellos with `bond_id`.
+  NaiveBondSocket(std::vector<std::unique_ptr<ClientSocketHandle>> members,
+                  const HostPortPair& request_endpoint,
+                  const std::string& bond_id,
+                  const NetworkTrafficAnnotationTag& traffic_annotation);
+  NaiveBondSocket(const NaiveBondSocket&) = delete;
+  NaiveBondSocket& operator=(const NaiveBondSocket&) = delete;
+
+  // On destruction Disconnect() is called.
+  ~NaiveBondSocket() override;
+
+  const HostPortPair& request_endpoint() const { return request_endpoint_; }
+  size_t member_count() const { return members_.size(); }
+
+  // Completes once the chunks of completed writes are written to their
+  // members. Writes complete as soon as a member takes the chunk, so a
+  // graceful close waits for this first.
+  int Flush(CompletionOnceCallback callback);
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override;
+  void Disconnect() override;
+  bool IsConnected() const override;
+  bool IsConnectedAndIdle() const override;
+  const NetLogWithSource& NetLog() const override;
+  bool WasEverUsed() const override;
+  NextProto GetNegotiatedProtocol() const override;
+  bool GetSSLInfo(SSLInfo* ssl_info) override;
+  int64_t GetTotalReceivedBytes() const override;
+  void ApplySocketTag(const SocketTag& tag) override;
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override;
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override;
+  int SetReceiveBufferSize(int32_t size) override;
+  int SetSendBufferSize(int32_t size) override;
+  int GetPeerAddress(IPEndPoint* address) const override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+
+ private:
+  struct Member {
+    Member();
+    Member(Member&&);
+    Member& operator=(Member&&);
+    ~Member();
+
+    // Of `handle` on the client side, `owned_socket` on the server side.
+    StreamSocket* socket = nullptr;
+    std::unique_ptr<ClientSocketHandle> handle;
+    std::unique_ptr<StreamSocket> owned_socket;
+    CompletionRepeatingCallback read_callback;
+    CompletionRepeatingCallback write_callback;
+
+    // Null while idle.
+    scoped_refptr<DrainableIOBuffer> write_buf;
+
+    scoped_refptr<IOBufferWithSize> read_buf;
+    bool read_pending = false;
+    bool eof = false;
+    // Of the chunk being read.
+    uint8_t header[kChunkHeaderSize] = {};
+    int header_bytes = 0;
+    uint32_t sequence = 0;
+    int payload_remaining = 0;
+    std::string payload;
+  };
+
+  NaiveBondSocket(size_t member_count,
+                  const HostPortPair& request_endpoint,
+                  const std::string& bond_id,
+                  const NetworkTrafficAnnotationTag& traffic_annotation);
+
+  bool HasPendingWrites() const;
+  // Returns the size taken or ERR_IO_PENDING if no member is idle.
+  int WriteChunk(IOBuffer* buf, int buf_len);
+  void StartMemberWrite(size_t index, std::string data);
+  void DoMemberWrite(size_t index);
+  // Returns false on error.
+  bool HandleMemberWrite(size_t index, int result);
+  void OnMemberWriteComplete(size_t index, int result);
+
+  // Whether chunks are buffered for the next read, past the limit.
+  bool IsReadPaused() const;
+  void ReadMembers();
+  void ReadMember(size_t index);
+  // Returns false on error or end of the member.
+  bool HandleMemberRead(size_t index, int result);
+  void OnMemberReadComplete(size_t index, int result);
+  int DoRead(IOBuffer* buf, int buf_len);
+
+  // Fails the pending calls with `error_`.
+  void OnError();
+
+  std::vector<Member> members_;
+  const HostPortPair request_endpoint_;
+  // Empty on the server side.
+  const std::string bond_id_;
+  const NetworkTrafficAnnotationTag traffic_annotation_;
+  bool connected_ = false;
+  bool was_ever_used_ = false;
+  int error_ = OK;
+
+  uint32_t next_write_sequence_ = 0;
+  size_t next_write_member_ = 0;
+
+  // Chunks read ahead of `next_read_sequence_` or not yet fully read.
+  std::map<uint32_t, std::string> chunks_;
+  uint32_t next_read_sequence_ = 0;
+  // Into the chunk of `next_read_sequence_`.
+  size_t read_offset_ = 0;
+  size_t buffered_bytes_ = 0;
+  size_t eof_count_ = 0;
+  int64_t total_received_bytes_ = 0;
+
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_ = 0;
+  CompletionOnceCallback read_callback_;
+  scoped_refptr<IOBuffer> write_buf_;
+  int write_buf_len_ = 0;
+  CompletionOnceCallback write_callback_;
+  CompletionOnceCallback flush_callback_;
+
+  base::WeakPtrFactory<NaiveBondSocket> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_BOND_SOCKET_H_
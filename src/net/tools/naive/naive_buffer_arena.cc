@@ -0,0 +1,92 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_buffer_arena.h"
+
+#include <sys/mman.h>
+
+#include <bit>
+#include <cstdint>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+
+namespace net {
+
+NaiveBufferArena::NaiveBufferArena(char* base, size_t size, bool hugetlb)
+    : base_(base), size_(size), hugetlb_(hugetlb) {}
+
+NaiveBufferArena::~NaiveBufferArena() {
+  munmap(base_, size_);
+}
+
+// static
+std::unique_ptr<NaiveBufferArena> NaiveBufferArena::Create(size_t bytes) {
+  const size_t size = base::bits::AlignUp(bytes, kHugePageSize);
+  CHECK_GT(size, 0u);
+
+  // Private hugetlb mappings reserve their pages up front, so this fails
+  // cleanly instead of faulting later when the pool runs out.
+  void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mapped != MAP_FAILED) {
+    return base::WrapUnique(
+        new NaiveBufferArena(static_cast<char*>(mapped), size, true));
+  }
+  PLOG(INFO) << "No hugetlb pages for relay buffers, using THP";
+
+  // Over-maps by a huge page to align the reservation to one.
+  const size_t mapped_size = size + kHugePageSize;
+  mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to reserve relay buffers";
+    return nullptr;
+  }
+  char* const start = base::bits::AlignUp(static_cast<char*>(mapped),
+                                          kHugePageSize);
+  const size_t head = static_cast<size_t>(start - static_cast<char*>(mapped));
+  if (head > 0) {
+    munmap(mapped, head);
+  }
+  if (mapped_size - head > size) {
+    munmap(start + size, mapped_size - head - size);
+  }
+  if (madvise(start, size, MADV_HUGEPAGE)) {
+    PLOG(WARNING) << "Relay buffers stay on small pages: madvise failed";
+  }
+  return base::WrapUnique(new NaiveBufferArena(start, size, false));
+}
+
+// static
+size_t NaiveBufferArena::GetSizeClass(size_t capacity) {
+  DCHECK(std::has_single_bit(capacity));
+  return std::countr_zero(capacity);
+}
+
+base::span<char> NaiveBufferArena::Allocate(size_t capacity) {
+  base::AutoLock lock(lock_);
+  std::vector<char*>& free = free_[GetSizeClass(capacity)];
+  if (!free.empty()) {
+    char* storage = free.back();
+    free.pop_back();
+    return base::span(storage, capacity);
+  }
+  if (size_ - used_ < capacity) {
+    return {};
+  }
+  char* storage = base_ + used_;
+  used_ += capacity;
+  return base::span(storage, capacity);
+}
+
+void NaiveBufferArena::Free(base::span<char> storage) {
+  DCHECK_GE(storage.data(), base_);
+  DCHECK_LE(storage.data() + storage.size(), base_ + size_);
+  base::AutoLock lock(lock_);
+  free_[GetSizeClass(storage.size())].push_back(storage.data());
+}
+
+}  // namespace net
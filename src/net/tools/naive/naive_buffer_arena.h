@@ -0,0 +1,61 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_BUFFER_ARENA_H_
+#define NET_TOOLS_NAIVE_NAIVE_BUFFER_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace net {
+
+// Memory reserved on 2 MB pages for the relay buffers of a NaiveBufferPool,
+// so the buffers of thousands of connections take a few TLB entries instead
+// of one per 4 KB page. Storage is carved in power-of-two sizes and reused
+// by size once freed; the reservation is never returned. Linux only.
+class NaiveBufferArena {
+ public:
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  ~NaiveBufferArena();
+  NaiveBufferArena(const NaiveBufferArena&) = delete;
+  NaiveBufferArena& operator=(const NaiveBufferArena&) = delete;
+
+  // Reserves `bytes` rounded up to huge pages, from the hugetlb pool of
+  // vm.nr_hugepages if it has enough, else as memory advised for
+  // transparent huge pages. Returns null if nothing can be mapped.
+  static std::unique_ptr<NaiveBufferArena> Create(size_t bytes);
+
+  // Returns `capacity` bytes, a power of two of at least 4 KB, or an empty
+  // span if the reservation is used up. Thread-safe, like Free(), as a
+  // buffer may be released on another thread than its pool.
+  base::span<char> Allocate(size_t capacity);
+  void Free(base::span<char> storage);
+
+  size_t size() const { return size_; }
+  // Whether the pages come from the hugetlb pool rather than THP.
+  bool hugetlb() const { return hugetlb_; }
+
+ private:
+  NaiveBufferArena(char* base, size_t size, bool hugetlb);
+
+  // Of a power of two capacity.
+  static size_t GetSizeClass(size_t capacity);
+
+  char* const base_;
+  const size_t size_;
+  const bool hugetlb_;
+
+  base::Lock lock_;
+  // Bytes of the reservation handed out at least once.
+  size_t used_ GUARDED_BY(lock_) = 0;
+  std::vector<char*> free_[sizeof(size_t) * 8] GUARDED_BY(lock_);
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_BUFFER_ARENA_H_
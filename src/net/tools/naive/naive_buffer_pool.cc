@@ -0,0 +1,234 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_buffer_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/logging.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+#if BUILDFLAG(IS_LINUX)
+#include "net/tools/naive/naive_buffer_arena.h"
+#endif
+
+namespace net {
+
+namespace {
+// Caps the memory kept idle in one pool. Set before the IO threads start.
+size_t g_max_free_bytes = 16 * 1024 * 1024;
+// Reserved by each pool on huge pages, 0 for none.
+size_t g_arena_bytes = 0;
+
+// Of all relay buffers, for memory accounting. Only updated on pool misses
+// and when buffers are destroyed, never on the relay path.
+std::atomic<size_t> g_allocated_bytes{0};
+std::atomic<size_t> g_peak_allocated_bytes{0};
+
+void AddAllocatedBytes(size_t bytes) {
+  size_t allocated =
+      g_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = g_peak_allocated_bytes.load(std::memory_order_relaxed);
+  while (allocated > peak &&
+         !g_peak_allocated_bytes.compare_exchange_weak(
+             peak, allocated, std::memory_order_relaxed)) {
+  }
+}
+}  // namespace
+
+NaiveRelayBuffer::NaiveRelayBuffer(int capacity) {
+  AssertValidBufferSize(capacity);
+  heap_storage_ = base::HeapArray<char>::Uninit(capacity);
+  storage_ = heap_storage_.as_span();
+  Reset(capacity);
+  AddAllocatedBytes(storage_.size());
+}
+
+NaiveRelayBuffer::NaiveRelayBuffer(base::span<char> storage,
+                                   NaiveBufferArena* arena)
+    : storage_(storage), arena_(arena) {
+  AssertValidBufferSize(storage.size());
+  Reset(capacity());
+  AddAllocatedBytes(storage_.size());
+}
+
+NaiveRelayBuffer::~NaiveRelayBuffer() {
+  // Clears ptrs before the storage is destroyed, making them dangle.
+  data_ = nullptr;
+  base::span<char> storage = storage_;
+  storage_ = {};
+  g_allocated_bytes.fetch_sub(storage.size(), std::memory_order_relaxed);
+#if BUILDFLAG(IS_LINUX)
+  if (arena_) {
+    arena_->Free(storage);
+  }
+#endif
+}
+
+void NaiveRelayBuffer::Reset(int offset, int size) {
+  CHECK_GE(offset, 0);
+  CHECK_GE(size, 0);
+  CHECK_LE(size, capacity() - offset);
+  data_ = storage_.data() + offset;
+  size_ = size;
+}
+
+int NaiveRelayBuffer::headroom() const {
+  return static_cast<int>(data_.get() - storage_.data());
+}
+
+void NaiveRelayBuffer::DidConsume(int bytes) {
+  CHECK_GE(bytes, 0);
+  CHECK_LE(bytes, size_);
+  data_ += bytes;
+  size_ -= bytes;
+}
+
+NaiveBufferPool::NaiveBufferPool() = default;
+
+NaiveBufferPool::~NaiveBufferPool() = default;
+
+// static
+NaiveBufferPool* NaiveBufferPool::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveBufferPool>([] {
+    auto pool = std::make_unique<NaiveBufferPool>();
+#if BUILDFLAG(IS_LINUX)
+    if (g_arena_bytes > 0) {
+      pool->arena_ = NaiveBufferArena::Create(g_arena_bytes);
+      if (pool->arena_) {
+        VLOG(1) << "Reserved " << pool->arena_->size()
+                << " bytes for relay buffers on "
+                << (pool->arena_->hugetlb() ? "hugetlb" : "THP") << " pages";
+      }
+    }
+#endif
+    return pool;
+  });
+}
+
+// static
+void NaiveBufferPool::SetMaxFreeBytes(size_t bytes) {
+  g_max_free_bytes = bytes;
+}
+
+// static
+void NaiveBufferPool::SetArenaBytes(size_t bytes) {
+  g_arena_bytes = bytes;
+}
+
+// static
+size_t NaiveBufferPool::allocated_bytes() {
+  return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+// static
+size_t NaiveBufferPool::peak_allocated_bytes() {
+  return g_peak_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+// static
+int NaiveBufferPool::RoundUpSize(int size) {
+  size = std::clamp(size, kMinBufferSize, kMaxBufferSize);
+  return 1 << base::bits::Log2Ceiling(static_cast<uint32_t>(size));
+}
+
+// static
+int NaiveBufferPool::GetSizeClass(int capacity) {
+  return base::bits::Log2Ceiling(static_cast<uint32_t>(capacity)) -
+         base::bits::Log2Ceiling(static_cast<uint32_t>(kMinBufferSize));
+}
+
+scoped_refptr<NaiveRelayBuffer> NaiveBufferPool::Get(int size) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  size = std::clamp(size, kMinBufferSize, kMaxBufferSize);
+  int capacity = RoundUpSize(size);
+  auto& free_buffers = free_buffers_[GetSizeClass(capacity)];
+  if (free_buffers.empty() && !busy_buffers_.empty())
+    ReclaimBusyBuffers();
+  if (free_buffers.empty()) {
+    ++misses_;
+#if BUILDFLAG(IS_LINUX)
+    if (arena_) {
+      base::span<char> storage = arena_->Allocate(capacity);
+      if (!storage.empty()) {
+        auto buffer =
+            base::MakeRefCounted<NaiveRelayBuffer>(storage, arena_.get());
+        buffer->Reset(size);
+        return buffer;
+      }
+    }
+#endif
+    auto buffer = base::MakeRefCounted<NaiveRelayBuffer>(capacity);
+    buffer->Reset(size);
+    return buffer;
+  }
+  ++hits_;
+  scoped_refptr<NaiveRelayBuffer> buffer = std::move(free_buffers.back());
+  free_buffers.pop_back();
+  free_bytes_ -= capacity;
+  buffer->Reset(size);
+  return buffer;
+}
+
+void NaiveBufferPool::Release(scoped_refptr<NaiveRelayBuffer> buffer) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  if (!buffer)
+    return;
+  if (!buffer->HasOneRef()) {
+    if (busy_buffers_.size() < kMaxBusyBuffers)
+      busy_buffers_.push_back(std::move(buffer));
+    return;
+  }
+  AddFree(std::move(buffer));
+}
+
+void NaiveBufferPool::Trim(size_t max_free_bytes) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  ReclaimBusyBuffers();
+  for (int i = kNumSizeClasses - 1; i >= 0 && free_bytes_ > max_free_bytes;
+       --i) {
+    auto& free_buffers = free_buffers_[i];
+    while (!free_buffers.empty() && free_bytes_ > max_free_bytes) {
+      free_bytes_ -= free_buffers.back()->capacity();
+      free_buffers.pop_back();
+    }
+    free_buffers.shrink_to_fit();
+  }
+}
+
+void NaiveBufferPool::AddFree(scoped_refptr<NaiveRelayBuffer> buffer) {
+  size_t capacity = buffer->capacity();
+  if (free_bytes_ + capacity > g_max_free_bytes)
+    return;
+  free_bytes_ += capacity;
+  free_buffers_[GetSizeClass(capacity)].push_back(std::move(buffer));
+}
+
+void NaiveBufferPool::ReclaimBusyBuffers() {
+  auto busy_end = std::partition(
+      busy_buffers_.begin(), busy_buffers_.end(),
+      [](const scoped_refptr<NaiveRelayBuffer>& buffer) {
+        return !buffer->HasOneRef();
+      });
+  for (auto it = busy_end; it != busy_buffers_.end(); ++it) {
+    AddFree(std::move(*it));
+  }
+  busy_buffers_.erase(busy_end, busy_buffers_.end());
+}
+
+size_t NaiveBufferPool::free_count() const {
+  size_t count = 0;
+  for (const auto& free_buffers : free_buffers_) {
+    count += free_buffers.size();
+  }
+  return count;
+}
+
+}  // namespace net
@@ -0,0 +1,146 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_BUFFER_POOL_H_
+#define NET_TOOLS_NAIVE_NAIVE_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/containers/heap_array.h"
+#include "base/containers/span.h"
+#include "base/memory/raw_span.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/threading/thread_checker.h"
+#include "build/build_config.h"
+#include "net/base/io_buffer.h"
+
+namespace net {
+
+class NaiveBufferArena;
+
+// A fixed-capacity relay buffer that can be drained in place, so the relay
+// loop does not need a DrainableIOBuffer wrapper for short writes.
+class NaiveRelayBuffer : public IOBuffer {
+ public:
+  explicit NaiveRelayBuffer(int capacity);
+  // Borrows `storage` from `arena` until destroyed.
+  NaiveRelayBuffer(base::span<char> storage, NaiveBufferArena* arena);
+
+  int capacity() const { return static_cast<int>(storage_.size()); }
+
+  // Makes `size` bytes of the storage starting at `offset` the readable
+  // region.
+  void Reset(int offset, int size);
+  // Makes the first `size` bytes of the storage the readable region.
+  void Reset(int size) { Reset(0, size); }
+
+  // Number of storage bytes before and after the readable region.
+  int headroom() const;
+  int tailroom() const { return capacity() - headroom() - size_; }
+
+  // Advances data() past `bytes` consumed bytes.
+  void DidConsume(int bytes);
+
+  // Returns the number of unconsumed bytes.
+  int BytesRemaining() const { return size_; }
+
+ private:
+  ~NaiveRelayBuffer() override;
+
+  // Empty if `storage_` is from `arena_`.
+  base::HeapArray<char> heap_storage_;
+  base::raw_span<char> storage_;
+  NaiveBufferArena* arena_ = nullptr;
+};
+
+// Per-thread free lists of relay buffers in power-of-two size classes.
+// Buffers are borrowed with Get() and handed back with Release() once no I/O
+// references them anymore, so the steady-state relay loop does not allocate.
+class NaiveBufferPool {
+ public:
+  static constexpr int kDefaultBufferSize = 64 * 1024;
+  static constexpr int kMinBufferSize = 4 * 1024;
+  static constexpr int kMaxBufferSize = 1024 * 1024;
+
+  NaiveBufferPool();
+  NaiveBufferPool(const NaiveBufferPool&) = delete;
+  NaiveBufferPool& operator=(const NaiveBufferPool&) = delete;
+  ~NaiveBufferPool();
+
+  // Returns the pool of the calling thread, creating it on first use.
+  // The pool lives as long as the thread.
+  static NaiveBufferPool* GetForCurrentThread();
+
+  // Caps the memory each pool keeps idle, 16 MB by default. Must be called
+  // before any thread uses its pool.
+  static void SetMaxFreeBytes(size_t bytes);
+
+  // Makes each pool allocate its buffers from a NaiveBufferArena of `bytes`
+  // on huge pages, and from the heap once it is used up. Must be called
+  // before any thread uses its pool. Linux only.
+  static void SetArenaBytes(size_t bytes);
+
+  // Of the relay buffers of all threads, those in free lists included.
+  static size_t allocated_bytes();
+  // The most allocated at once since startup.
+  static size_t peak_allocated_bytes();
+
+  // Rounds `size` up to the capacity of its size class.
+  static int RoundUpSize(int size);
+
+  // Returns a buffer from the size class of `size` with its first `size`
+  // bytes readable. `size` is clamped to [kMinBufferSize, kMaxBufferSize].
+  scoped_refptr<NaiveRelayBuffer> Get(int size = kDefaultBufferSize);
+
+  // Returns `buffer` to the free list. Buffers still referenced elsewhere,
+  // e.g. by a transport socket with a pending or zero-copy write, return to
+  // it once the other references are gone, found by a later Get() missing
+  // the free list.
+  void Release(scoped_refptr<NaiveRelayBuffer> buffer);
+
+  // Frees idle buffers, the largest first, until at most `max_free_bytes`
+  // are left. Those from the arena go back to it, which keeps them reserved.
+  void Trim(size_t max_free_bytes);
+
+  // Number of Get() calls served from the free list.
+  uint64_t hits() const { return hits_; }
+  // Number of Get() calls that had to allocate.
+  uint64_t misses() const { return misses_; }
+  size_t free_count() const;
+  size_t free_bytes() const { return free_bytes_; }
+#if BUILDFLAG(IS_LINUX)
+  // Null without SetArenaBytes() or if the reservation failed.
+  const NaiveBufferArena* arena() const { return arena_.get(); }
+#endif
+
+ private:
+  static constexpr int kNumSizeClasses = 9;
+
+  // Released buffers waiting for their other references at most.
+  static constexpr size_t kMaxBusyBuffers = 256;
+
+  static int GetSizeClass(int capacity);
+
+  // Adds `buffer` to its free list unless over the idle memory cap.
+  void AddFree(scoped_refptr<NaiveRelayBuffer> buffer);
+  // Moves the busy buffers no longer referenced elsewhere to the free lists.
+  void ReclaimBusyBuffers();
+
+  std::vector<scoped_refptr<NaiveRelayBuffer>> free_buffers_[kNumSizeClasses];
+  std::vector<scoped_refptr<NaiveRelayBuffer>> busy_buffers_;
+#if BUILDFLAG(IS_LINUX)
+  // Leaked with the pool, outliving every buffer borrowing its storage.
+  std::unique_ptr<NaiveBufferArena> arena_;
+#endif
+  size_t free_bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+
+  THREAD_CHECKER(thread_checker_);
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_BUFFER_POOL_H_
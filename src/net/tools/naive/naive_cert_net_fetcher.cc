@@ -0,0 +1,83 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_cert_net_fetcher.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/cert_net/cert_net_fetcher_url_request.h"
+#include "net/url_request/url_request_context.h"
+#include "url/gurl.h"
+
+namespace net {
+
+NaiveCertNetFetcher::NaiveCertNetFetcher(ContextFactory context_factory)
+    : task_runner_(base::SingleThreadTaskRunner::GetCurrentDefault()),
+      fetcher_(base::MakeRefCounted<CertNetFetcherURLRequest>()),
+      context_factory_(std::move(context_factory)) {}
+
+NaiveCertNetFetcher::~NaiveCertNetFetcher() = default;
+
+void NaiveCertNetFetcher::Shutdown() {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  shut_down_ = true;
+  // Before the context its requests use.
+  fetcher_->Shutdown();
+  context_.reset();
+}
+
+std::unique_ptr<CertNetFetcher::Request> NaiveCertNetFetcher::FetchCaIssuers(
+    const GURL& url,
+    int timeout_milliseconds,
+    int max_response_bytes) {
+  MaybeCreateContext();
+  return fetcher_->FetchCaIssuers(url, timeout_milliseconds,
+                                  max_response_bytes);
+}
+
+std::unique_ptr<CertNetFetcher::Request> NaiveCertNetFetcher::FetchCrl(
+    const GURL& url,
+    int timeout_milliseconds,
+    int max_response_bytes) {
+  MaybeCreateContext();
+  return fetcher_->FetchCrl(url, timeout_milliseconds, max_response_bytes);
+}
+
+std::unique_ptr<CertNetFetcher::Request> NaiveCertNetFetcher::FetchOcsp(
+    const GURL& url,
+    int timeout_milliseconds,
+    int max_response_bytes) {
+  MaybeCreateContext();
+  return fetcher_->FetchOcsp(url, timeout_milliseconds, max_response_bytes);
+}
+
+void NaiveCertNetFetcher::MaybeCreateContext() {
+  // Posting under the lock orders the task before the fetches of other
+  // threads seeing the factory taken.
+  base::AutoLock lock(lock_);
+  if (!context_factory_)
+    return;
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&NaiveCertNetFetcher::CreateContext,
+                     base::WrapRefCounted(this), std::move(context_factory_)));
+}
+
+void NaiveCertNetFetcher::CreateContext(ContextFactory context_factory) {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  if (shut_down_)
+    return;
+  base::ElapsedTimer timer;
+  context_ = std::move(context_factory).Run();
+  fetcher_->SetURLRequestContext(context_.get());
+  LOG(INFO) << "Certificate fetcher ready in "
+            << timer.Elapsed().InMilliseconds() << " ms";
+}
+
+}  // namespace net
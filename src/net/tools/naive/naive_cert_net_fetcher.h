@@ -0,0 +1,72 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_CERT_NET_FETCHER_H_
+#define NET_TOOLS_NAIVE_NAIVE_CERT_NET_FETCHER_H_
+
+#include <memory>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "net/cert/cert_net_fetcher.h"
+
+class GURL;
+
+namespace base {
+class SingleThreadTaskRunner;
+}
+
+namespace net {
+
+class CertNetFetcherURLRequest;
+class URLRequestContext;
+
+// CertNetFetcherURLRequest with its URLRequestContext built on the first
+// fetch, as most verifications need no AIA fetches and the context costs
+// startup time and memory. Created on the network thread, where the
+// context is built and Shutdown() must be called.
+class NaiveCertNetFetcher : public CertNetFetcher {
+ public:
+  using ContextFactory =
+      base::OnceCallback<std::unique_ptr<URLRequestContext>()>;
+
+  explicit NaiveCertNetFetcher(ContextFactory context_factory);
+  NaiveCertNetFetcher(const NaiveCertNetFetcher&) = delete;
+  NaiveCertNetFetcher& operator=(const NaiveCertNetFetcher&) = delete;
+
+  // CertNetFetcher implementation.
+  void Shutdown() override;
+  std::unique_ptr<Request> FetchCaIssuers(const GURL& url,
+                                          int timeout_milliseconds,
+                                          int max_response_bytes) override;
+  std::unique_ptr<Request> FetchCrl(const GURL& url,
+                                    int timeout_milliseconds,
+                                    int max_response_bytes) override;
+  std::unique_ptr<Request> FetchOcsp(const GURL& url,
+                                     int timeout_milliseconds,
+                                     int max_response_bytes) override;
+
+ private:
+  ~NaiveCertNetFetcher() override;
+
+  // Called on any thread before a fetch is posted to the network thread,
+  // so the context is set by the time the fetch runs.
+  void MaybeCreateContext();
+  void CreateContext(ContextFactory context_factory);
+
+  const scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+  const scoped_refptr<CertNetFetcherURLRequest> fetcher_;
+
+  base::Lock lock_;
+  // Moved into the task building the context.
+  ContextFactory context_factory_ GUARDED_BY(lock_);
+
+  // On the network thread.
+  bool shut_down_ = false;
+  std::unique_ptr<URLRequestContext> context_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_CERT_NET_FETCHER_H_
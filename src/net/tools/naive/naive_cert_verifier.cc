@@ -0,0 +1,212 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_cert_verifier.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/containers/contains.h"
+#include "base/containers/lru_cache.h"
+#include "base/functional/bind.h"
+#include "base/no_destructor.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "net/base/net_errors.h"
+#include "net/cert/cert_status_flags.h"
+#include "net/cert/cert_verify_result.h"
+#include "net/cert/x509_certificate.h"
+#include "net/cert/x509_util.h"
+
+namespace net {
+
+namespace {
+constexpr size_t kMaxCacheEntries = 256;
+// As CachingCertVerifier.
+constexpr base::TimeDelta kCacheTTL = base::Minutes(30);
+
+// Accessed by every IO thread.
+class SharedCache {
+ public:
+  static SharedCache& GetInstance() {
+    static base::NoDestructor<SharedCache> instance;
+    return *instance;
+  }
+
+  SharedCache() : cache_(kMaxCacheEntries) {}
+
+  // Changes whenever the cache is cleared, so verifications started before
+  // are not added.
+  uint64_t generation() {
+    base::AutoLock lock(lock_);
+    return generation_;
+  }
+
+  bool Lookup(const CertVerifier::RequestParams& params,
+              CertVerifyResult* verify_result) {
+    base::Time now = base::Time::Now();
+    base::AutoLock lock(lock_);
+    auto it = cache_.Get(params);
+    if (it == cache_.end())
+      return false;
+    // Also expires the entry if the clock went back.
+    if (now < it->second.verification_time ||
+        now >= it->second.expiration_time) {
+      cache_.Erase(it);
+      return false;
+    }
+    *verify_result = it->second.result;
+    return true;
+  }
+
+  void Add(uint64_t generation,
+           const CertVerifier::RequestParams& params,
+           base::Time start_time,
+           const CertVerifyResult& verify_result) {
+    base::Time expiration_time = start_time + kCacheTTL;
+    if (verify_result.verified_cert) {
+      expiration_time = std::min(expiration_time,
+                                 verify_result.verified_cert->valid_expiry());
+    }
+    base::AutoLock lock(lock_);
+    if (generation != generation_)
+      return;
+    cache_.Put(params, Entry{verify_result, start_time, expiration_time});
+  }
+
+  void Clear() {
+    base::AutoLock lock(lock_);
+    ++generation_;
+    cache_.Clear();
+  }
+
+ private:
+  struct Entry {
+    CertVerifyResult result;
+    base::Time verification_time;
+    base::Time expiration_time;
+  };
+
+  base::Lock lock_;
+  uint64_t generation_ GUARDED_BY(lock_) = 0;
+  base::LRUCache<CertVerifier::RequestParams, Entry> cache_ GUARDED_BY(lock_);
+};
+}  // namespace
+
+NaiveCertVerifier::NaiveCertVerifier(VerifierFactory verifier_factory,
+                                     SpkiPins spki_pins)
+    : verifier_factory_(std::move(verifier_factory)),
+      spki_pins_(std::move(spki_pins)) {
+  CertDatabase::GetInstance()->AddObserver(this);
+}
+
+NaiveCertVerifier::~NaiveCertVerifier() {
+  CertDatabase::GetInstance()->RemoveObserver(this);
+  if (verifier_)
+    verifier_->RemoveObserver(this);
+}
+
+void NaiveCertVerifier::Warm() {
+  GetVerifier();
+}
+
+CertVerifier* NaiveCertVerifier::GetVerifier() {
+  if (!verifier_) {
+    verifier_ = std::move(verifier_factory_).Run();
+    if (config_)
+      verifier_->SetConfig(*config_);
+    verifier_->AddObserver(this);
+  }
+  return verifier_.get();
+}
+
+// static
+int NaiveCertVerifier::VerifyPinned(const RequestParams& params,
+                                    const HashValueVector& pins,
+                                    CertVerifyResult* verify_result) {
+  verify_result->Reset();
+  verify_result->verified_cert = params.certificate();
+  HashValue hash;
+  if (!x509_util::CalculateSha256SpkiHash(
+          params.certificate()->cert_buffer(), &hash) ||
+      !base::Contains(pins, hash)) {
+    verify_result->cert_status = CERT_STATUS_AUTHORITY_INVALID;
+    return ERR_CERT_AUTHORITY_INVALID;
+  }
+  // Not issued by a known root, so no Certificate Transparency is required.
+  verify_result->public_key_hashes.push_back(hash);
+  return OK;
+}
+
+int NaiveCertVerifier::Verify(const RequestParams& params,
+                              CertVerifyResult* verify_result,
+                              CompletionOnceCallback callback,
+                              std::unique_ptr<Request>* out_req,
+                              const NetLogWithSource& net_log) {
+  out_req->reset();
+  if (auto it = spki_pins_.find(params.hostname()); it != spki_pins_.end()) {
+    return VerifyPinned(params, it->second, verify_result);
+  }
+  SharedCache& cache = SharedCache::GetInstance();
+  if (cache.Lookup(params, verify_result))
+    return OK;
+
+  uint64_t generation = cache.generation();
+  base::Time start_time = base::Time::Now();
+  // Unretained is safe as `verifier_` is owned by `this` and does not run
+  // callbacks after its destruction.
+  CompletionOnceCallback caching_callback = base::BindOnce(
+      &NaiveCertVerifier::OnRequestFinished, base::Unretained(this),
+      generation, params, start_time, std::move(callback), verify_result);
+  int result = GetVerifier()->Verify(
+      params, verify_result, std::move(caching_callback), out_req, net_log);
+  if (result == OK)
+    cache.Add(generation, params, start_time, *verify_result);
+  return result;
+}
+
+void NaiveCertVerifier::SetConfig(const Config& config) {
+  config_ = config;
+  if (verifier_) {
+    // Which notifies the observers through OnCertVerifierChanged().
+    verifier_->SetConfig(config);
+  } else {
+    OnCertVerifierChanged();
+  }
+  SharedCache::GetInstance().Clear();
+}
+
+void NaiveCertVerifier::AddObserver(CertVerifier::Observer* observer) {
+  observers_.AddObserver(observer);
+}
+
+void NaiveCertVerifier::RemoveObserver(CertVerifier::Observer* observer) {
+  observers_.RemoveObserver(observer);
+}
+
+void NaiveCertVerifier::OnRequestFinished(uint64_t generation,
+                                          const RequestParams& params,
+                                          base::Time start_time,
+                                          CompletionOnceCallback callback,
+                                          CertVerifyResult* verify_result,
+                                          int error) {
+  if (error == OK) {
+    SharedCache::GetInstance().Add(generation, params, start_time,
+                                   *verify_result);
+  }
+  // May delete |this|.
+  std::move(callback).Run(error);
+}
+
+void NaiveCertVerifier::OnCertVerifierChanged() {
+  SharedCache::GetInstance().Clear();
+  for (CertVerifier::Observer& observer : observers_) {
+    observer.OnCertVerifierChanged();
+  }
+}
+
+void NaiveCertVerifier::OnTrustStoreChanged() {
+  SharedCache::GetInstance().Clear();
+}
+
+}  // namespace net
@@ -0,0 +1,94 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_CERT_VERIFIER_H_
+#define NET_TOOLS_NAIVE_NAIVE_CERT_VERIFIER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "base/functional/callback.h"
+#include "base/observer_list.h"
+#include "base/time/time.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/hash_value.h"
+#include "net/cert/cert_database.h"
+#include "net/cert/cert_verifier.h"
+
+namespace net {
+
+class CertVerifyResult;
+
+// Caches successful verifications like CachingCertVerifier, but in a cache
+// shared by the NaiveCertVerifiers of all IO threads, so the certificate of
+// a proxy is verified once per process rather than once per thread. Results
+// are kept for 30 minutes at most, and until the configuration or the trust
+// store changes. The underlying verifier, which loads the trust store, is
+// created on the first verification missing the cache, so a thread served
+// from the cache never creates one.
+//
+// The certificates of hosts given SPKI pins are instead accepted if the
+// SHA-256 hash of the leaf's public key is one of their pins, without
+// building a path or loading the trust store. The handshake proves that the
+// server holds the key, so neither the chain nor the name is looked at.
+class NaiveCertVerifier : public CertVerifier,
+                          public CertVerifier::Observer,
+                          public CertDatabase::Observer {
+ public:
+  using VerifierFactory =
+      base::OnceCallback<std::unique_ptr<CertVerifier>()>;
+  // Keyed by lowercase host.
+  using SpkiPins = std::map<std::string, HashValueVector>;
+
+  explicit NaiveCertVerifier(VerifierFactory verifier_factory,
+                             SpkiPins spki_pins = {});
+  ~NaiveCertVerifier() override;
+  NaiveCertVerifier(const NaiveCertVerifier&) = delete;
+  NaiveCertVerifier& operator=(const NaiveCertVerifier&) = delete;
+
+  // CertVerifier:
+  int Verify(const RequestParams& params,
+             CertVerifyResult* verify_result,
+             CompletionOnceCallback callback,
+             std::unique_ptr<Request>* out_req,
+             const NetLogWithSource& net_log) override;
+  void SetConfig(const Config& config) override;
+  void AddObserver(CertVerifier::Observer* observer) override;
+  void RemoveObserver(CertVerifier::Observer* observer) override;
+
+  // Creates the underlying verifier ahead of the first verification.
+  void Warm();
+
+ private:
+  CertVerifier* GetVerifier();
+
+  static int VerifyPinned(const RequestParams& params,
+                          const HashValueVector& pins,
+                          CertVerifyResult* verify_result);
+
+  void OnRequestFinished(uint64_t generation,
+                         const RequestParams& params,
+                         base::Time start_time,
+                         CompletionOnceCallback callback,
+                         CertVerifyResult* verify_result,
+                         int error);
+
+  // CertVerifier::Observer:
+  void OnCertVerifierChanged() override;
+
+  // CertDatabase::Observer:
+  void OnTrustStoreChanged() override;
+
+  VerifierFactory verifier_factory_;
+  const SpkiPins spki_pins_;
+  std::unique_ptr<CertVerifier> verifier_;
+  // Applied to `verifier_` once created.
+  std::optional<Config> config_;
+  base::ObserverList<CertVerifier::Observer> observers_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_CERT_VERIFIER_H_
@@ -0,0 +1,1264 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Opens and closes SOCKS5 and HTTP CONNECT tunnels through a running naive
+// at a target rate, like a connection storm, and prints a JSON line per
+// proxy of the accept rate, the handshake latency distribution, the failure
+// rate by stage and, with --pid, the memory per idle connection measured
+// from its RSS. The tunnels go to a sink on loopback by default, so naive
+// needs a direct proxy or one that can reach the loopback of this host.
+//
+//   naive_churn --proxy=socks://127.0.0.1:1080,http://127.0.0.1:8080
+//       --rate=2000 --duration=10 --pid=$(pidof naive)
+//
+// With --soak, instead runs a mixed workload for that many minutes, of
+// tunnels closed after their handshake and tunnels sending some data and
+// held open for a while, to catch memory naive only loses over hours. It
+// samples the RSS of --pid and, from the --metrics listener of naive, the
+// allocator and relay buffer bytes and the counts of connections, sessions
+// and resolver entries, printing a JSON line per sample. The samples
+// compared are taken with no load, after a warm-up and after the soak, and
+// the run fails if any grew more than --max-growth percent.
+//
+//   naive_churn --proxy=socks://127.0.0.1:1080 --rate=200 --soak=480
+//       --pid=$(pidof naive) --metrics=127.0.0.1:9090
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/containers/unique_ptr_adapters.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/functional/bind.h"
+#include "base/json/json_writer.h"
+#include "base/location.h"
+#include "base/message_loop/message_pump_type.h"
+#include "base/rand_util.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/task/single_thread_task_executor.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "base/values.h"
+#include "build/build_config.h"
+#include "net/base/address_list.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_source.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_server_socket.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+namespace {
+
+constexpr NetworkTrafficAnnotationTag kTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_churn", "");
+// How often connections are started to keep up with the rate.
+constexpr base::TimeDelta kTickInterval = base::Milliseconds(5);
+// Enough for a SOCKS5 reply with the longest bound name, and for the
+// headers of an HTTP CONNECT reply.
+constexpr int kReplyBufferSize = 4096;
+
+// Of the soak workload: the share of tunnels held open after the handshake,
+// what each of those sends and how long it is held at most.
+constexpr double kSoakHoldShare = 0.5;
+constexpr int kSoakPayloadBytes = 64 * 1024;
+constexpr base::TimeDelta kSoakMaxHold = base::Seconds(30);
+// For naive to close and free what the workload left before a quiet sample.
+constexpr base::TimeDelta kSoakSettleTime = base::Seconds(5);
+constexpr base::TimeDelta kScrapeTimeout = base::Seconds(5);
+constexpr size_t kMaxScrapeBytes = 16 * 1024 * 1024;
+// Counts may grow by this much over the percentage, e.g. an idle tunnel
+// session more.
+constexpr double kSoakCountSlack = 4;
+
+enum class Protocol {
+  kSocks5,
+  kHttp,
+};
+
+// The stage a connection failed at.
+enum Stage {
+  kConnect,
+  kHandshake,
+  kTimeout,
+  kNumStages,
+};
+
+constexpr const char* kStageNames[kNumStages] = {"connect", "handshake",
+                                                 "timeout"};
+
+struct ProxyTarget {
+  std::string url;
+  Protocol protocol;
+  IPEndPoint endpoint;
+};
+
+bool ParseProxy(std::string_view url, ProxyTarget* proxy) {
+  proxy->url = std::string(url);
+  std::string_view rest = url;
+  if (base::StartsWith(rest, "socks://")) {
+    proxy->protocol = Protocol::kSocks5;
+    rest.remove_prefix(sizeof("socks://") - 1);
+  } else if (base::StartsWith(rest, "http://")) {
+    proxy->protocol = Protocol::kHttp;
+    rest.remove_prefix(sizeof("http://") - 1);
+  } else {
+    return false;
+  }
+  HostPortPair host_port = HostPortPair::FromString(rest);
+  IPAddress address;
+  if (host_port.port() == 0 ||
+      !address.AssignFromIPLiteral(host_port.host())) {
+    return false;
+  }
+  proxy->endpoint = IPEndPoint(address, host_port.port());
+  return true;
+}
+
+// The RSS of process `pid` in bytes, or -1.
+int64_t GetResidentBytes(int pid) {
+#if BUILDFLAG(IS_LINUX)
+  std::string status;
+  if (!base::ReadFileToString(
+          base::FilePath("/proc/" + base::NumberToString(pid) + "/status"),
+          &status)) {
+    return -1;
+  }
+  for (std::string_view line : base::SplitStringPiece(
+           status, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (!base::StartsWith(line, "VmRSS:"))
+      continue;
+    line.remove_prefix(sizeof("VmRSS:") - 1);
+    std::vector<std::string_view> parts = base::SplitStringPiece(
+        line, " \t", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    int64_t kb;
+    if (!parts.empty() && base::StringToInt64(parts[0], &kb))
+      return kb * 1024;
+  }
+#endif
+  return -1;
+}
+
+// Accepts the tunneled connections and holds each until the client closes
+// it.
+class Sink {
+ public:
+  Sink() = default;
+  Sink(const Sink&) = delete;
+  Sink& operator=(const Sink&) = delete;
+
+  int Listen() {
+    listen_socket_ =
+        std::make_unique<TCPServerSocket>(nullptr, NetLogSource());
+    int rv = listen_socket_->ListenWithAddressAndPort("127.0.0.1", 0,
+                                                      /*backlog=*/4096);
+    if (rv != OK)
+      return rv;
+    rv = listen_socket_->GetLocalAddress(&endpoint_);
+    if (rv != OK)
+      return rv;
+    DoAccept();
+    return OK;
+  }
+
+  const IPEndPoint& endpoint() const { return endpoint_; }
+
+ private:
+  void DoAccept() {
+    for (;;) {
+      int rv = listen_socket_->Accept(
+          &accepted_socket_,
+          base::BindOnce(&Sink::OnAcceptComplete, base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv != OK) {
+        RetryAccept();
+        return;
+      }
+      Hold(std::move(accepted_socket_));
+    }
+  }
+
+  void OnAcceptComplete(int result) {
+    if (result != OK) {
+      RetryAccept();
+      return;
+    }
+    Hold(std::move(accepted_socket_));
+    DoAccept();
+  }
+
+  // Out of file descriptors, say, until some connections close.
+  void RetryAccept() {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+        FROM_HERE, base::BindOnce(&Sink::DoAccept, base::Unretained(this)),
+        kTickInterval);
+  }
+
+  void Hold(std::unique_ptr<StreamSocket> socket) {
+    StreamSocket* socket_ptr = socket.get();
+    sockets_.insert(std::move(socket));
+    DoRead(socket_ptr);
+  }
+
+  void DoRead(StreamSocket* socket) {
+    for (;;) {
+      int rv = socket->Read(
+          read_buffer_.get(), read_buffer_->size(),
+          base::BindOnce(&Sink::OnReadComplete, base::Unretained(this),
+                         base::Unretained(socket)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv <= 0) {
+        sockets_.erase(sockets_.find(socket));
+        return;
+      }
+    }
+  }
+
+  void OnReadComplete(StreamSocket* socket, int result) {
+    if (result <= 0) {
+      sockets_.erase(sockets_.find(socket));
+      return;
+    }
+    DoRead(socket);
+  }
+
+  std::unique_ptr<TCPServerSocket> listen_socket_;
+  std::unique_ptr<StreamSocket> accepted_socket_;
+  IPEndPoint endpoint_;
+  std::set<std::unique_ptr<StreamSocket>, base::UniquePtrComparator> sockets_;
+  // Shared, what is read is discarded.
+  scoped_refptr<IOBufferWithSize> read_buffer_ =
+      base::MakeRefCounted<IOBufferWithSize>(4096);
+};
+
+// Opens one tunnel and reports when its handshake is done, then closes it or
+// holds it open until destroyed.
+class ChurnConnection {
+ public:
+  using DoneCallback =
+      base::OnceCallback<void(ChurnConnection*, std::optional<Stage>)>;
+
+  ChurnConnection(const ProxyTarget& proxy,
+                  const HostPortPair& target,
+                  DoneCallback done_callback)
+      : proxy_(&proxy),
+        target_(target),
+        done_callback_(std::move(done_callback)) {}
+  ChurnConnection(const ChurnConnection&) = delete;
+  ChurnConnection& operator=(const ChurnConnection&) = delete;
+
+  void Start(base::TimeDelta timeout) {
+    start_time_ = base::TimeTicks::Now();
+    timeout_timer_.Start(FROM_HERE, timeout,
+                         base::BindOnce(&ChurnConnection::Finish,
+                                        base::Unretained(this), kTimeout));
+    socket_ = std::make_unique<TCPClientSocket>(
+        AddressList(proxy_->endpoint), nullptr, nullptr, nullptr,
+        NetLogSource());
+    int rv = socket_->Connect(base::BindOnce(
+        &ChurnConnection::OnConnectComplete, base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnConnectComplete(rv);
+  }
+
+  base::TimeDelta connect_time() const { return connect_time_; }
+  base::TimeDelta handshake_time() const { return handshake_time_; }
+
+  // After the handshake, writes `size` bytes through the tunnel, then holds
+  // it open until destroyed. Closes it on a write error.
+  void Send(int size) {
+    write_buffer_ = base::MakeRefCounted<DrainableIOBuffer>(
+        base::MakeRefCounted<StringIOBuffer>(std::string(size, '\0')), size);
+    DoSend();
+  }
+
+ private:
+  void DoSend() {
+    while (socket_ && write_buffer_->BytesRemaining() > 0) {
+      int rv = socket_->Write(
+          write_buffer_.get(), write_buffer_->BytesRemaining(),
+          base::BindOnce(&ChurnConnection::OnSendComplete,
+                         base::Unretained(this)),
+          kTrafficAnnotation);
+      if (rv == ERR_IO_PENDING)
+        return;
+      OnSendResult(rv);
+    }
+  }
+
+  void OnSendComplete(int result) {
+    OnSendResult(result);
+    DoSend();
+  }
+
+  void OnSendResult(int result) {
+    if (result <= 0) {
+      socket_.reset();
+      return;
+    }
+    write_buffer_->DidConsume(result);
+  }
+
+  void OnConnectComplete(int result) {
+    if (result != OK) {
+      Finish(kConnect);
+      return;
+    }
+    connect_time_ = base::TimeTicks::Now() - start_time_;
+    std::string request;
+    if (proxy_->protocol == Protocol::kSocks5) {
+      // The greeting and the request are pipelined as naive allows.
+      const std::string& host = target_.host();
+      request = std::string("\x05\x01\x00\x05\x01\x00\x03", 7);
+      request.push_back(static_cast<char>(host.size()));
+      request += host;
+      request.push_back(static_cast<char>(target_.port() >> 8));
+      request.push_back(static_cast<char>(target_.port() & 0xff));
+    } else {
+      request = "CONNECT " + target_.ToString() + " HTTP/1.1\r\nHost: " +
+                target_.ToString() + "\r\n\r\n";
+    }
+    size_t size = request.size();
+    write_buffer_ = base::MakeRefCounted<DrainableIOBuffer>(
+        base::MakeRefCounted<StringIOBuffer>(std::move(request)), size);
+    DoWrite();
+  }
+
+  void DoWrite() {
+    while (write_buffer_->BytesRemaining() > 0) {
+      int rv = socket_->Write(
+          write_buffer_.get(), write_buffer_->BytesRemaining(),
+          base::BindOnce(&ChurnConnection::OnWriteComplete,
+                         base::Unretained(this)),
+          kTrafficAnnotation);
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv <= 0) {
+        Finish(kHandshake);
+        return;
+      }
+      write_buffer_->DidConsume(rv);
+    }
+    read_buffer_ = base::MakeRefCounted<GrowableIOBuffer>();
+    read_buffer_->SetCapacity(kReplyBufferSize);
+    DoRead();
+  }
+
+  void OnWriteComplete(int result) {
+    if (result <= 0) {
+      Finish(kHandshake);
+      return;
+    }
+    write_buffer_->DidConsume(result);
+    DoWrite();
+  }
+
+  void DoRead() {
+    for (;;) {
+      if (read_buffer_->RemainingCapacity() == 0) {
+        Finish(kHandshake);
+        return;
+      }
+      int rv = socket_->Read(read_buffer_.get(),
+                             read_buffer_->RemainingCapacity(),
+                             base::BindOnce(&ChurnConnection::OnReadComplete,
+                                            base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!HandleRead(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int result) {
+    if (HandleRead(result))
+      DoRead();
+  }
+
+  // Returns whether more of the reply is needed.
+  bool HandleRead(int result) {
+    if (result <= 0) {
+      Finish(kHandshake);
+      return false;
+    }
+    read_buffer_->set_offset(read_buffer_->offset() + result);
+    std::string_view reply(read_buffer_->StartOfBuffer(),
+                           read_buffer_->offset());
+    std::optional<bool> ok = proxy_->protocol == Protocol::kSocks5
+                                 ? ParseSocks5Reply(reply)
+                                 : ParseHttpReply(reply);
+    if (!ok)
+      return true;
+    if (!*ok) {
+      Finish(kHandshake);
+      return false;
+    }
+    handshake_time_ = base::TimeTicks::Now() - start_time_;
+    Finish(std::nullopt);
+    return false;
+  }
+
+  // Empty until the whole reply is read.
+  static std::optional<bool> ParseSocks5Reply(std::string_view reply) {
+    // The method selection, then the reply up to its bound address.
+    if (reply.size() < 2 + 5)
+      return std::nullopt;
+    if (reply[0] != 0x05 || reply[1] != 0x00 || reply[2] != 0x05 ||
+        reply[3] != 0x00) {
+      return false;
+    }
+    size_t size = 2 + 4 + 2;
+    switch (reply[5]) {
+      case 0x01:
+        size += 4;
+        break;
+      case 0x03:
+        size += 1 + static_cast<uint8_t>(reply[6]);
+        break;
+      case 0x04:
+        size += 16;
+        break;
+      default:
+        return false;
+    }
+    if (reply.size() < size)
+      return std::nullopt;
+    return true;
+  }
+
+  static std::optional<bool> ParseHttpReply(std::string_view reply) {
+    if (reply.find("\r\n\r\n") == std::string_view::npos)
+      return std::nullopt;
+    return base::StartsWith(reply, "HTTP/1.1 200") ||
+           base::StartsWith(reply, "HTTP/1.0 200");
+  }
+
+  void Finish(std::optional<Stage> failure) {
+    timeout_timer_.Stop();
+    if (failure)
+      socket_.reset();
+    // May destroy this.
+    std::move(done_callback_).Run(this, failure);
+  }
+
+  const ProxyTarget* proxy_;
+  HostPortPair target_;
+  DoneCallback done_callback_;
+  std::unique_ptr<TCPClientSocket> socket_;
+  scoped_refptr<DrainableIOBuffer> write_buffer_;
+  scoped_refptr<GrowableIOBuffer> read_buffer_;
+  base::TimeTicks start_time_;
+  base::TimeDelta connect_time_;
+  base::TimeDelta handshake_time_;
+  base::OneShotTimer timeout_timer_;
+};
+
+struct Options {
+  double rate = 1000;
+  base::TimeDelta duration = base::Seconds(10);
+  base::TimeDelta timeout = base::Seconds(5);
+  int max_inflight = 4096;
+  // Of the memory phase, run if `pid` is set.
+  int idle_connections = 1000;
+  int pid = 0;
+  // Runs the soak instead of the churn and memory phases if positive.
+  base::TimeDelta soak;
+  base::TimeDelta sample_interval = base::Minutes(1);
+  int max_growth_percent = 10;
+  // Of the --metrics listener of naive.
+  std::optional<IPEndPoint> metrics;
+};
+
+// Fetches a path of the --metrics listener of naive with a plain HTTP/1.1
+// GET and returns the body, or nothing on any error or a status but 200.
+class MetricsScraper {
+ public:
+  using DoneCallback = base::OnceCallback<void(std::optional<std::string>)>;
+
+  MetricsScraper(const IPEndPoint& endpoint,
+                 std::string_view path,
+                 DoneCallback done_callback)
+      : endpoint_(endpoint),
+        path_(path),
+        done_callback_(std::move(done_callback)) {}
+  MetricsScraper(const MetricsScraper&) = delete;
+  MetricsScraper& operator=(const MetricsScraper&) = delete;
+
+  void Start() {
+    timeout_timer_.Start(
+        FROM_HERE, kScrapeTimeout,
+        base::BindOnce(&MetricsScraper::Finish, base::Unretained(this),
+                       /*ok=*/false));
+    socket_ = std::make_unique<TCPClientSocket>(
+        AddressList(endpoint_), nullptr, nullptr, nullptr, NetLogSource());
+    int rv = socket_->Connect(base::BindOnce(
+        &MetricsScraper::OnConnectComplete, base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnConnectComplete(rv);
+  }
+
+ private:
+  void OnConnectComplete(int result) {
+    if (result != OK) {
+      Finish(/*ok=*/false);
+      return;
+    }
+    std::string request = "GET " + path_ + " HTTP/1.1\r\nHost: " +
+                          endpoint_.ToString() +
+                          "\r\nConnection: close\r\n\r\n";
+    size_t size = request.size();
+    write_buffer_ = base::MakeRefCounted<DrainableIOBuffer>(
+        base::MakeRefCounted<StringIOBuffer>(std::move(request)), size);
+    DoWrite();
+  }
+
+  void DoWrite() {
+    while (write_buffer_->BytesRemaining() > 0) {
+      int rv = socket_->Write(
+          write_buffer_.get(), write_buffer_->BytesRemaining(),
+          base::BindOnce(&MetricsScraper::OnWriteComplete,
+                         base::Unretained(this)),
+          kTrafficAnnotation);
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv <= 0) {
+        Finish(/*ok=*/false);
+        return;
+      }
+      write_buffer_->DidConsume(rv);
+    }
+    DoRead();
+  }
+
+  void OnWriteComplete(int result) {
+    if (result <= 0) {
+      Finish(/*ok=*/false);
+      return;
+    }
+    write_buffer_->DidConsume(result);
+    DoWrite();
+  }
+
+  void DoRead() {
+    for (;;) {
+      int rv = socket_->Read(read_buffer_.get(), read_buffer_->size(),
+                             base::BindOnce(&MetricsScraper::OnReadComplete,
+                                            base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!HandleRead(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int result) {
+    if (HandleRead(result))
+      DoRead();
+  }
+
+  // Returns whether more of the response is needed. The server closes the
+  // connection after it.
+  bool HandleRead(int result) {
+    if (result < 0 || response_.size() > kMaxScrapeBytes) {
+      Finish(/*ok=*/false);
+      return false;
+    }
+    if (result == 0) {
+      Finish(/*ok=*/true);
+      return false;
+    }
+    response_.append(read_buffer_->data(), result);
+    return true;
+  }
+
+  void Finish(bool ok) {
+    timeout_timer_.Stop();
+    socket_.reset();
+    std::optional<std::string> body;
+    size_t header_end = response_.find("\r\n\r\n");
+    if (ok && header_end != std::string::npos &&
+        (base::StartsWith(response_, "HTTP/1.1 200") ||
+         base::StartsWith(response_, "HTTP/1.0 200"))) {
+      body = response_.substr(header_end + 4);
+    }
+    // May destroy this.
+    std::move(done_callback_).Run(std::move(body));
+  }
+
+  IPEndPoint endpoint_;
+  std::string path_;
+  DoneCallback done_callback_;
+  std::unique_ptr<TCPClientSocket> socket_;
+  scoped_refptr<DrainableIOBuffer> write_buffer_;
+  scoped_refptr<IOBufferWithSize> read_buffer_ =
+      base::MakeRefCounted<IOBufferWithSize>(16 * 1024);
+  std::string response_;
+  base::OneShotTimer timeout_timer_;
+};
+
+// The values of a soak sample by name. Byte sizes end in "_bytes", the
+// others are counts.
+using SoakSample = std::map<std::string, double>;
+
+// The Prometheus samples of naive summed over their labels into the names
+// of a SoakSample.
+void ParsePrometheusSample(std::string_view text, SoakSample* sample) {
+  static constexpr struct {
+    const char* metric;
+    const char* name;
+  } kMetrics[] = {
+      {"naive_malloc_bytes", "malloc_bytes"},
+      {"naive_relay_buffer_bytes", "relay_buffer_bytes"},
+      {"naive_connection_memory_bytes", "connection_memory_bytes"},
+      {"naive_connections_active", "connections"},
+      {"naive_handshakes_pending", "handshakes"},
+      {"naive_resolver_resolutions", "resolver_entries"},
+      {"naive_negative_cache_entries", "negative_cache_entries"},
+  };
+  for (std::string_view line : base::SplitStringPiece(
+           text, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (line.front() == '#')
+      continue;
+    size_t name_end = line.find_first_of("{ ");
+    size_t value_start = line.rfind(' ');
+    if (name_end == std::string_view::npos ||
+        value_start == std::string_view::npos) {
+      continue;
+    }
+    std::string_view metric = line.substr(0, name_end);
+    double value;
+    if (!base::StringToDouble(line.substr(value_start + 1), &value))
+      continue;
+    for (const auto& [known, name] : kMetrics) {
+      if (metric == known) {
+        (*sample)[name] += value;
+      }
+    }
+  }
+}
+
+base::Value::Dict Percentiles(std::vector<base::TimeDelta> samples) {
+  base::Value::Dict dict;
+  if (samples.empty())
+    return dict;
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double q) {
+    size_t i = std::min(samples.size() - 1,
+                        static_cast<size_t>(q * samples.size()));
+    return samples[i].InMillisecondsF();
+  };
+  base::TimeDelta total;
+  for (base::TimeDelta sample : samples)
+    total += sample;
+  dict.Set("mean", (total / samples.size()).InMillisecondsF());
+  dict.Set("p50", at(0.50));
+  dict.Set("p90", at(0.90));
+  dict.Set("p99", at(0.99));
+  dict.Set("p999", at(0.999));
+  dict.Set("max", samples.back().InMillisecondsF());
+  return dict;
+}
+
+// Runs the churn and memory phases against one proxy.
+class ChurnRun {
+ public:
+  ChurnRun(const ProxyTarget& proxy,
+           const HostPortPair& target,
+           const Options& options)
+      : proxy_(&proxy), target_(target), options_(options) {}
+  ChurnRun(const ChurnRun&) = delete;
+  ChurnRun& operator=(const ChurnRun&) = delete;
+
+  base::Value::Dict Run() {
+    base::RunLoop churn_loop;
+    quit_ = churn_loop.QuitClosure();
+    start_time_ = base::TimeTicks::Now();
+    tick_timer_.Start(FROM_HERE, kTickInterval,
+                      base::BindRepeating(&ChurnRun::OnTick,
+                                          base::Unretained(this)));
+    OnTick();
+    churn_loop.Run();
+    base::TimeDelta elapsed = end_time_ - start_time_;
+
+    base::Value::Dict result;
+    result.Set("proxy", proxy_->url);
+    result.Set("protocol",
+               proxy_->protocol == Protocol::kSocks5 ? "socks" : "http");
+    result.Set("target_rate", options_.rate);
+    result.Set("duration_s", elapsed.InSecondsF());
+    result.Set("attempts", attempts_);
+    result.Set("handshakes", static_cast<int>(handshake_times_.size()));
+    result.Set("accept_rate", handshake_times_.size() / elapsed.InSecondsF());
+    result.Set("skipped_at_max_inflight", skipped_);
+    base::Value::Dict failures;
+    int failure_count = 0;
+    for (int stage = 0; stage < kNumStages; ++stage) {
+      failures.Set(kStageNames[stage], failures_[stage]);
+      failure_count += failures_[stage];
+    }
+    result.Set("failures", std::move(failures));
+    result.Set("failure_rate",
+               attempts_ ? static_cast<double>(failure_count) / attempts_ : 0);
+    result.Set("connect_ms", Percentiles(std::move(connect_times_)));
+    result.Set("handshake_ms", Percentiles(std::move(handshake_times_)));
+    if (options_.pid > 0)
+      result.Set("memory", MeasureMemory());
+    return result;
+  }
+
+ private:
+  void OnTick() {
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start_time_;
+    if (elapsed >= options_.duration) {
+      tick_timer_.Stop();
+      stopped_ = true;
+      MaybeQuit();
+      return;
+    }
+    int due = static_cast<int>(elapsed.InSecondsF() * options_.rate) + 1 -
+              attempts_ - skipped_;
+    for (int i = 0; i < due; ++i) {
+      if (inflight_.size() >= static_cast<size_t>(options_.max_inflight)) {
+        // Counted against the rate, so the backlog does not burst later.
+        ++skipped_;
+        continue;
+      }
+      ++attempts_;
+      auto connection = std::make_unique<ChurnConnection>(
+          *proxy_, target_,
+          base::BindOnce(&ChurnRun::OnChurnDone, base::Unretained(this)));
+      ChurnConnection* connection_ptr = connection.get();
+      inflight_.insert(std::move(connection));
+      connection_ptr->Start(options_.timeout);
+    }
+  }
+
+  void OnChurnDone(ChurnConnection* connection, std::optional<Stage> failure) {
+    if (failure) {
+      ++failures_[*failure];
+    } else {
+      connect_times_.push_back(connection->connect_time());
+      handshake_times_.push_back(connection->handshake_time());
+    }
+    // Closes the tunnel right away, not from its call stack.
+    auto it = inflight_.find(connection);
+    base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+        FROM_HERE, std::move(inflight_.extract(it).value()));
+    MaybeQuit();
+  }
+
+  void MaybeQuit() {
+    if (stopped_ && inflight_.empty() && quit_) {
+      end_time_ = base::TimeTicks::Now();
+      std::move(quit_).Run();
+    }
+  }
+
+  // Holds `idle_connections` tunnels open at once to attribute the growth
+  // of the RSS of naive to them.
+  base::Value::Dict MeasureMemory() {
+    base::Value::Dict memory;
+    // Lets naive free what the churn left.
+    base::RunLoop settle_loop;
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+        FROM_HERE, settle_loop.QuitClosure(), base::Seconds(1));
+    settle_loop.Run();
+    int64_t before = GetResidentBytes(options_.pid);
+
+    base::RunLoop open_loop;
+    idle_pending_ = options_.idle_connections;
+    idle_quit_ = open_loop.QuitClosure();
+    for (int i = 0; i < options_.idle_connections; ++i) {
+      auto connection = std::make_unique<ChurnConnection>(
+          *proxy_, target_,
+          base::BindOnce(&ChurnRun::OnIdleDone, base::Unretained(this)));
+      ChurnConnection* connection_ptr = connection.get();
+      idle_.push_back(std::move(connection));
+      connection_ptr->Start(options_.timeout);
+    }
+    if (idle_pending_ > 0)
+      open_loop.Run();
+    int64_t after = GetResidentBytes(options_.pid);
+    idle_.clear();
+
+    memory.Set("connections", idle_opened_);
+    if (before >= 0 && after >= 0) {
+      memory.Set("rss_before_bytes", static_cast<double>(before));
+      memory.Set("rss_after_bytes", static_cast<double>(after));
+      if (idle_opened_ > 0) {
+        memory.Set("bytes_per_connection",
+                   static_cast<double>(after - before) / idle_opened_);
+      }
+    }
+    return memory;
+  }
+
+  void OnIdleDone(ChurnConnection* connection, std::optional<Stage> failure) {
+    if (!failure)
+      ++idle_opened_;
+    if (--idle_pending_ == 0)
+      std::move(idle_quit_).Run();
+  }
+
+  const ProxyTarget* proxy_;
+  HostPortPair target_;
+  Options options_;
+
+  base::TimeTicks start_time_;
+  base::TimeTicks end_time_;
+  base::RepeatingTimer tick_timer_;
+  bool stopped_ = false;
+  base::OnceClosure quit_;
+
+  int attempts_ = 0;
+  int skipped_ = 0;
+  int failures_[kNumStages] = {};
+  std::vector<base::TimeDelta> connect_times_;
+  std::vector<base::TimeDelta> handshake_times_;
+  std::set<std::unique_ptr<ChurnConnection>, base::UniquePtrComparator>
+      inflight_;
+
+  std::vector<std::unique_ptr<ChurnConnection>> idle_;
+  int idle_pending_ = 0;
+  int idle_opened_ = 0;
+  base::OnceClosure idle_quit_;
+};
+
+base::Value::Dict SoakSampleToDict(const SoakSample& sample) {
+  base::Value::Dict dict;
+  for (const auto& [name, value] : sample)
+    dict.Set(name, value);
+  return dict;
+}
+
+// Runs the soak against one proxy: a warm-up of one sample interval, a
+// quiet baseline sample, the soak with a sample each interval, then a quiet
+// final sample compared to the baseline.
+class SoakRun {
+ public:
+  SoakRun(const ProxyTarget& proxy,
+          const HostPortPair& target,
+          const Options& options)
+      : proxy_(&proxy), target_(target), options_(options) {}
+  SoakRun(const SoakRun&) = delete;
+  SoakRun& operator=(const SoakRun&) = delete;
+
+  // The result has "passed" false if a value grew past the bound.
+  base::Value::Dict Run() {
+    RunLoad(options_.sample_interval);
+    SoakSample baseline = TakeQuietSample();
+    PrintSample("baseline", baseline);
+
+    attempts_ = 0;
+    handshakes_ = 0;
+    std::fill(std::begin(failures_), std::end(failures_), 0);
+    soak_start_ = base::TimeTicks::Now();
+    // Unretained is safe because the timer is owned by this.
+    sample_timer_.Start(FROM_HERE, options_.sample_interval,
+                        base::BindRepeating(&SoakRun::OnSampleTick,
+                                            base::Unretained(this)));
+    RunLoad(options_.soak);
+    sample_timer_.Stop();
+    base::TimeDelta elapsed = base::TimeTicks::Now() - soak_start_;
+    SoakSample final_sample = TakeQuietSample();
+    PrintSample("final", final_sample);
+
+    base::Value::List exceeded;
+    double growth = 1 + options_.max_growth_percent / 100.0;
+    for (const auto& [name, before] : baseline) {
+      auto it = final_sample.find(name);
+      if (it == final_sample.end())
+        continue;
+      double bound = before * growth;
+      if (!base::EndsWith(name, "_bytes"))
+        bound += kSoakCountSlack;
+      if (it->second > bound)
+        exceeded.Append(name);
+    }
+
+    base::Value::Dict result;
+    result.Set("proxy", proxy_->url);
+    result.Set("protocol",
+               proxy_->protocol == Protocol::kSocks5 ? "socks" : "http");
+    result.Set("target_rate", options_.rate);
+    result.Set("duration_s", elapsed.InSecondsF());
+    result.Set("attempts", attempts_);
+    result.Set("handshakes", handshakes_);
+    base::Value::Dict failures;
+    for (int stage = 0; stage < kNumStages; ++stage)
+      failures.Set(kStageNames[stage], failures_[stage]);
+    result.Set("failures", std::move(failures));
+    result.Set("samples", samples_);
+    result.Set("baseline", SoakSampleToDict(baseline));
+    result.Set("final", SoakSampleToDict(final_sample));
+    result.Set("peak", SoakSampleToDict(peak_));
+    result.Set("max_growth_percent", options_.max_growth_percent);
+    result.Set("passed", exceeded.empty());
+    result.Set("exceeded", std::move(exceeded));
+    return result;
+  }
+
+ private:
+  // Runs the workload for `duration`, then until its tunnels are closed.
+  void RunLoad(base::TimeDelta duration) {
+    base::RunLoop load_loop;
+    quit_ = load_loop.QuitClosure();
+    stopped_ = false;
+    load_duration_ = duration;
+    load_start_ = base::TimeTicks::Now();
+    due_base_ = 0;
+    tick_timer_.Start(FROM_HERE, kTickInterval,
+                      base::BindRepeating(&SoakRun::OnTick,
+                                          base::Unretained(this)));
+    OnTick();
+    load_loop.Run();
+  }
+
+  void OnTick() {
+    base::TimeDelta elapsed = base::TimeTicks::Now() - load_start_;
+    if (elapsed >= load_duration_) {
+      tick_timer_.Stop();
+      stopped_ = true;
+      MaybeQuit();
+      return;
+    }
+    int due = static_cast<int>(elapsed.InSecondsF() * options_.rate) + 1 -
+              due_base_;
+    for (int i = 0; i < due; ++i) {
+      // Counted against the rate like the churn, skipped or not.
+      ++due_base_;
+      if (inflight_.size() + held_.size() >=
+          static_cast<size_t>(options_.max_inflight)) {
+        continue;
+      }
+      ++attempts_;
+      auto connection = std::make_unique<ChurnConnection>(
+          *proxy_, target_,
+          base::BindOnce(&SoakRun::OnConnectionDone, base::Unretained(this)));
+      ChurnConnection* connection_ptr = connection.get();
+      inflight_.insert(std::move(connection));
+      connection_ptr->Start(options_.timeout);
+    }
+  }
+
+  void OnConnectionDone(ChurnConnection* connection,
+                        std::optional<Stage> failure) {
+    std::unique_ptr<ChurnConnection> owned =
+        std::move(inflight_.extract(inflight_.find(connection)).value());
+    if (failure) {
+      ++failures_[*failure];
+    } else {
+      ++handshakes_;
+    }
+    if (!failure && base::RandDouble() < kSoakHoldShare) {
+      owned->Send(kSoakPayloadBytes);
+      held_.insert(std::move(owned));
+      base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+          FROM_HERE,
+          base::BindOnce(&SoakRun::Release, base::Unretained(this),
+                         base::Unretained(connection)),
+          base::RandDouble() * kSoakMaxHold);
+    } else {
+      // Closes the tunnel right away, not from its call stack.
+      base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+          FROM_HERE, std::move(owned));
+    }
+    MaybeQuit();
+  }
+
+  void Release(ChurnConnection* connection) {
+    held_.erase(held_.find(connection));
+    MaybeQuit();
+  }
+
+  void MaybeQuit() {
+    if (stopped_ && inflight_.empty() && held_.empty() && !sampling_ &&
+        quit_) {
+      std::move(quit_).Run();
+    }
+  }
+
+  void OnSampleTick() {
+    if (sampling_)
+      return;
+    TakeSample(base::BindOnce(&SoakRun::OnLoadSample, base::Unretained(this)));
+  }
+
+  void OnLoadSample(SoakSample sample) {
+    ++samples_;
+    for (const auto& [name, value] : sample) {
+      double& peak = peak_[name];
+      peak = std::max(peak, value);
+    }
+    PrintSample("soak", sample);
+    MaybeQuit();
+  }
+
+  // Once naive had time to close and free what the workload left.
+  SoakSample TakeQuietSample() {
+    base::RunLoop settle_loop;
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+        FROM_HERE, settle_loop.QuitClosure(), kSoakSettleTime);
+    settle_loop.Run();
+
+    SoakSample sample;
+    base::RunLoop sample_loop;
+    TakeSample(base::BindOnce(
+        [](SoakSample* out, base::OnceClosure quit, SoakSample sample) {
+          *out = std::move(sample);
+          std::move(quit).Run();
+        },
+        &sample, sample_loop.QuitClosure()));
+    sample_loop.Run();
+    return sample;
+  }
+
+  void TakeSample(base::OnceCallback<void(SoakSample)> callback) {
+    sampling_ = true;
+    sample_callback_ = std::move(callback);
+    pending_sample_.clear();
+    if (options_.pid > 0) {
+      int64_t rss = GetResidentBytes(options_.pid);
+      if (rss >= 0)
+        pending_sample_["rss_bytes"] = rss;
+    }
+    if (!options_.metrics) {
+      FinishSample();
+      return;
+    }
+    Scrape("/metrics", base::BindOnce(&SoakRun::OnMetricsScraped,
+                                      base::Unretained(this)));
+  }
+
+  void Scrape(std::string_view path, MetricsScraper::DoneCallback callback) {
+    if (scraper_) {
+      // Not from the call stack of the last one.
+      base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+          FROM_HERE, std::move(scraper_));
+    }
+    scraper_ = std::make_unique<MetricsScraper>(*options_.metrics, path,
+                                                std::move(callback));
+    scraper_->Start();
+  }
+
+  void OnMetricsScraped(std::optional<std::string> body) {
+    if (body)
+      ParsePrometheusSample(*body, &pending_sample_);
+    // A line per tunnel session and HTTP/2 and QUIC session, if naive
+    // serves the admin listing.
+    Scrape("/admin/sessions", base::BindOnce(&SoakRun::OnSessionsScraped,
+                                             base::Unretained(this)));
+  }
+
+  void OnSessionsScraped(std::optional<std::string> body) {
+    if (body) {
+      pending_sample_["sessions"] =
+          std::count(body->begin(), body->end(), '\n');
+    }
+    FinishSample();
+  }
+
+  void FinishSample() {
+    sampling_ = false;
+    std::move(sample_callback_).Run(std::move(pending_sample_));
+  }
+
+  void PrintSample(const char* phase, const SoakSample& sample) {
+    base::Value::Dict line;
+    line.Set("proxy", proxy_->url);
+    line.Set("phase", phase);
+    if (!soak_start_.is_null()) {
+      line.Set("elapsed_s",
+               (base::TimeTicks::Now() - soak_start_).InSecondsF());
+    }
+    line.Set("values", SoakSampleToDict(sample));
+    std::string json;
+    base::JSONWriter::Write(line, &json);
+    std::printf("%s\n", json.c_str());
+    std::fflush(stdout);
+  }
+
+  const ProxyTarget* proxy_;
+  HostPortPair target_;
+  Options options_;
+
+  base::TimeTicks soak_start_;
+  base::TimeTicks load_start_;
+  base::TimeDelta load_duration_;
+  base::RepeatingTimer tick_timer_;
+  int due_base_ = 0;
+  bool stopped_ = false;
+  base::OnceClosure quit_;
+
+  int attempts_ = 0;
+  int handshakes_ = 0;
+  int failures_[kNumStages] = {};
+  std::set<std::unique_ptr<ChurnConnection>, base::UniquePtrComparator>
+      inflight_;
+  // Tunnels past their handshake, until their hold ends.
+  std::set<std::unique_ptr<ChurnConnection>, base::UniquePtrComparator>
+      held_;
+
+  base::RepeatingTimer sample_timer_;
+  bool sampling_ = false;
+  base::OnceCallback<void(SoakSample)> sample_callback_;
+  SoakSample pending_sample_;
+  std::unique_ptr<MetricsScraper> scraper_;
+  int samples_ = 0;
+  SoakSample peak_;
+};
+
+bool ParseOptions(const base::CommandLine& command_line, Options* options) {
+  auto get_int = [&command_line](const char* name, int min, int* value) {
+    if (!command_line.HasSwitch(name))
+      return true;
+    if (!base::StringToInt(command_line.GetSwitchValueASCII(name), value) ||
+        *value < min) {
+      std::fprintf(stderr, "Invalid %s\n", name);
+      return false;
+    }
+    return true;
+  };
+  int rate = static_cast<int>(options->rate);
+  int duration = options->duration.InSeconds();
+  int timeout_ms = options->timeout.InMilliseconds();
+  int soak_minutes = 0;
+  int sample_interval = options->sample_interval.InSeconds();
+  if (!get_int("rate", 1, &rate) || !get_int("duration", 1, &duration) ||
+      !get_int("timeout-ms", 1, &timeout_ms) ||
+      !get_int("max-inflight", 1, &options->max_inflight) ||
+      !get_int("idle-connections", 1, &options->idle_connections) ||
+      !get_int("pid", 1, &options->pid) ||
+      !get_int("soak", 1, &soak_minutes) ||
+      !get_int("sample-interval", 1, &sample_interval) ||
+      !get_int("max-growth", 0, &options->max_growth_percent)) {
+    return false;
+  }
+  options->rate = rate;
+  options->duration = base::Seconds(duration);
+  options->timeout = base::Milliseconds(timeout_ms);
+  options->soak = base::Minutes(soak_minutes);
+  options->sample_interval = base::Seconds(sample_interval);
+  if (command_line.HasSwitch("metrics")) {
+    HostPortPair host_port = HostPortPair::FromString(
+        command_line.GetSwitchValueASCII("metrics"));
+    IPAddress address;
+    if (host_port.port() == 0 ||
+        !address.AssignFromIPLiteral(host_port.host())) {
+      std::fprintf(stderr, "Invalid metrics\n");
+      return false;
+    }
+    options->metrics = IPEndPoint(address, host_port.port());
+  }
+  if (options->soak.is_positive() && options->pid == 0 &&
+      !options->metrics) {
+    std::fprintf(stderr, "soak needs pid or metrics\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+  base::SingleThreadTaskExecutor io_task_executor(base::MessagePumpType::IO);
+
+  if (command_line.HasSwitch("h") || command_line.HasSwitch("help") ||
+      !command_line.HasSwitch("proxy")) {
+    std::printf(
+        "Usage: naive_churn --proxy=<proto>://<ip>:<port>,... [OPTIONS]\n"
+        "\n"
+        "proto: socks, http\n"
+        "--rate=<N>              Connections a second, default 1000\n"
+        "--duration=<seconds>    Default 10\n"
+        "--timeout-ms=<N>        Per handshake, default 5000\n"
+        "--max-inflight=<N>      Default 4096\n"
+        "--target=<host>:<port>  Default a sink on 127.0.0.1\n"
+        "--pid=<pid>             Of naive, to measure memory (Linux only)\n"
+        "--idle-connections=<N>  Held open to measure memory, default 1000\n"
+        "--soak=<minutes>        Run a mixed workload and check for growth\n"
+        "--sample-interval=<s>   Of the soak, default 60\n"
+        "--max-growth=<percent>  Over the soak, default 10\n"
+        "--metrics=<ip>:<port>   Of naive, to sample during the soak\n");
+    return command_line.HasSwitch("proxy") ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  net::Options options;
+  if (!net::ParseOptions(command_line, &options))
+    return EXIT_FAILURE;
+
+  std::vector<net::ProxyTarget> proxies;
+  for (std::string_view url : base::SplitStringPiece(
+           command_line.GetSwitchValueASCII("proxy"), ",",
+           base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (!net::ParseProxy(url, &proxies.emplace_back())) {
+      std::fprintf(stderr, "Invalid proxy %s\n", std::string(url).c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  net::Sink sink;
+  net::HostPortPair target;
+  if (command_line.HasSwitch("target")) {
+    target = net::HostPortPair::FromString(
+        command_line.GetSwitchValueASCII("target"));
+    if (target.IsEmpty() || target.port() == 0) {
+      std::fprintf(stderr, "Invalid target\n");
+      return EXIT_FAILURE;
+    }
+  } else {
+    int rv = sink.Listen();
+    if (rv != net::OK) {
+      std::fprintf(stderr, "Failed to listen: %s\n",
+                   net::ErrorToShortString(rv).c_str());
+      return EXIT_FAILURE;
+    }
+    target = net::HostPortPair::FromIPEndPoint(sink.endpoint());
+  }
+
+  bool passed = true;
+  for (const net::ProxyTarget& proxy : proxies) {
+    base::Value::Dict result;
+    if (options.soak.is_positive()) {
+      net::SoakRun run(proxy, target, options);
+      result = run.Run();
+      passed = passed && result.FindBool("passed").value_or(false);
+    } else {
+      net::ChurnRun run(proxy, target, options);
+      result = run.Run();
+    }
+    std::string json;
+    base::JSONWriter::Write(result, &json);
+    std::printf("%s\n", json.c_str());
+    std::fflush(stdout);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,15 +3,75 @@
 // found in the LICENSE file.
 #include "net/tools/naive/naive_config.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <string_view>
 
+#include "base/files/file_util.h"
 #include "base/strings/escape.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
 #include "net/base/url_util.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/crypto_protocol.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_constants.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_buffer_pool.h"
+#include "third_party/abseil-cpp/absl/container/flat_hash_set.h"
 #include "url/gurl.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include <sched.h>
+#endif
+
 namespace net {
 
+namespace {
+// Accepts both JSON numbers and strings from the command line.
+bool ParseInt(const base::Value& v, int* out) {
+  if (std::optional<int> i = v.GetIfInt()) {
+    *out = *i;
+    return true;
+  } else if (const std::string* str = v.GetIfString()) {
+    return base::StringToInt(*str, out);
+  }
+  return false;
+}
+
+// Accepts a comma-separated string or a list of tags of up to four
+// characters, e.g. "B2ON,IW20".
+bool ParseQuicTags(const base::Value& v, quic::QuicTagVector* out) {
+  std::vector<std::string> tags;
+  if (const std::string* str = v.GetIfString()) {
+    tags = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                             base::SPLIT_WANT_NONEMPTY);
+  } else if (const base::Value::List* strs = v.GetIfList()) {
+    for (const auto& str_e : *strs) {
+      const std::string* s = str_e.GetIfString();
+      if (!s || s->empty()) {
+        return false;
+      }
+      tags.push_back(*s);
+    }
+  }
+  if (tags.empty()) {
+    return false;
+  }
+  for (const std::string& tag : tags) {
+    if (tag.size() > 4) {
+      return false;
+    }
+    out->push_back(quic::ParseQuicTag(tag));
+  }
+  return true;
+}
+}  // namespace
+
 NaiveListenConfig::NaiveListenConfig() = default;
 NaiveListenConfig::NaiveListenConfig(const NaiveListenConfig&) = default;
 NaiveListenConfig::~NaiveListenConfig() = default;
@@ -22,12 +82,51 @@ bool NaiveListenConfig::Parse(const std::string& str) {
     protocol = ClientProtocol::kSocks5;
   } else if (url.scheme() == "http") {
     protocol = ClientProtocol::kHttp;
+  } else if (url.scheme() == "https") {
+    protocol = ClientProtocol::kHttps;
+  } else if (url.scheme() == "h2c") {
+    protocol = ClientProtocol::kHttps;
+    h2c = true;
+  } else if (url.scheme() == "socks+unix" || url.scheme() == "http+unix") {
+#if BUILDFLAG(IS_POSIX)
+    protocol = url.scheme() == "socks+unix" ? ClientProtocol::kSocks5
+                                            : ClientProtocol::kHttp;
+    unix_path = base::UnescapeBinaryURLComponent(url.path());
+    if (!url.host().empty() || unix_path.size() < 2 || unix_path[0] != '/') {
+      std::cerr << "Invalid path in " << str << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "Unix protocols only support POSIX." << std::endl;
+    return false;
+#endif
   } else if (url.scheme() == "redir") {
 #if BUILDFLAG(IS_LINUX)
     protocol = ClientProtocol::kRedir;
 #else
     std::cerr << "Redir protocol only supports Linux." << std::endl;
     return false;
+#endif
+  } else if (url.scheme() == "quic") {
+#if BUILDFLAG(IS_LINUX)
+    protocol = ClientProtocol::kQuic;
+#else
+    std::cerr << "Quic protocol only supports Linux." << std::endl;
+    return false;
+#endif
+  } else if (url.scheme() == "embed") {
+#if BUILDFLAG(IS_POSIX)
+    protocol = ClientProtocol::kEmbedded;
+#else
+    std::cerr << "Embed protocol only supports POSIX." << std::endl;
+    return false;
+#endif
+  } else if (url.scheme() == "tun") {
+#if BUILDFLAG(IS_LINUX)
+    protocol = ClientProtocol::kTun;
+#else
+    std::cerr << "Tun protocol only supports Linux." << std::endl;
+    return false;
 #endif
   } else {
     std::cerr << "Invalid scheme in " << str << std::endl;
@@ -41,7 +140,9 @@ bool NaiveListenConfig::Parse(const std::string& str) {
     pass = base::UnescapeBinaryURLComponent(url.password());
   }
 
-  if (!url.host().empty()) {
+  if (protocol == ClientProtocol::kTun) {
+    device = url.host();
+  } else if (!url.host().empty()) {
     addr = url.HostNoBrackets();
   }
 
@@ -52,8 +153,235 @@ bool NaiveListenConfig::Parse(const std::string& str) {
   }
   if (effective_port != url::PORT_UNSPECIFIED) {
     port = effective_port;
+  } else if (protocol == ClientProtocol::kQuic) {
+    // The port of HTTP/3, which quic:// has no default for.
+    port = 443;
+  }
+
+  for (QueryIterator it(url); !it.IsAtEnd(); it.Advance()) {
+    if (it.GetKey() == "cert") {
+      cert = base::FilePath::FromUTF8Unsafe(
+          base::UnescapeBinaryURLComponent(it.GetValue()));
+      continue;
+    } else if (it.GetKey() == "key") {
+      key = base::FilePath::FromUTF8Unsafe(
+          base::UnescapeBinaryURLComponent(it.GetValue()));
+      continue;
+    } else if ((protocol == ClientProtocol::kSocks5 ||
+                protocol == ClientProtocol::kHttp) &&
+               it.GetKey() == "proxy-protocol") {
+      if (!it.GetValue().empty()) {
+        std::cerr << "Invalid proxy-protocol in " << str << std::endl;
+        return false;
+      }
+      proxy_protocol = true;
+      continue;
+    } else if (protocol == ClientProtocol::kTun &&
+               it.GetKey() == "connect-ip") {
+      if (!it.GetValue().empty()) {
+        std::cerr << "Invalid connect-ip in " << str << std::endl;
+        return false;
+      }
+      connect_ip = true;
+      continue;
+    }
+    int* limit;
+    int min_limit = 0;
+    if (it.GetKey() == "max-connections") {
+      limit = &max_connections;
+    } else if (it.GetKey() == "max-handshakes") {
+      limit = &max_handshakes;
+    } else if (it.GetKey() == "max-destination-connections") {
+      limit = &max_destination_connections;
+    } else if (it.GetKey() == "backlog") {
+      limit = &backlog;
+      min_limit = 1;
+    } else if (it.GetKey() == "rate-limit") {
+      limit = &rate_limit;
+    } else if (protocol == ClientProtocol::kTun && it.GetKey() == "fd") {
+      limit = &tun_fd;
+    } else if (protocol == ClientProtocol::kTun && it.GetKey() == "mtu") {
+      limit = &mtu;
+      // The minimum of IPv6.
+      min_limit = 1280;
+    } else {
+      std::cerr << "Invalid option " << it.GetKey() << " in " << str
+                << std::endl;
+      return false;
+    }
+    if (!base::StringToInt(it.GetValue(), limit) || *limit < min_limit) {
+      std::cerr << "Invalid " << it.GetKey() << " in " << str << std::endl;
+      return false;
+    }
+  }
+
+  if (((protocol == ClientProtocol::kHttps && !h2c) ||
+       protocol == ClientProtocol::kQuic) &&
+      (cert.empty() || key.empty())) {
+    std::cerr << "Missing cert or key in " << str << std::endl;
+    return false;
+  }
+  if (protocol == ClientProtocol::kTun && device.empty()) {
+    std::cerr << "Missing device in " << str << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+NaiveProxyServerConfig::NaiveProxyServerConfig() = default;
+NaiveProxyServerConfig::NaiveProxyServerConfig(const NaiveProxyServerConfig&) =
+    default;
+NaiveProxyServerConfig::~NaiveProxyServerConfig() = default;
+
+bool NaiveProxyServerConfig::Parse(const std::string& str) {
+  GURL gurl(str);
+  net::GetIdentityFromURL(gurl, &user, &pass);
+
+  GURL::Replacements remove_auth;
+  remove_auth.ClearUsername();
+  remove_auth.ClearPassword();
+  GURL url_no_auth = gurl.ReplaceComponents(remove_auth);
+  url = url_no_auth.GetWithEmptyPath().spec();
+  if (url.empty()) {
+    std::cerr << "Invalid proxy " << str << std::endl;
+    return false;
+  } else if (url.back() == '/') {
+    url.pop_back();
+  }
+  return true;
+}
+
+bool NaiveRouteRule::Parse(const std::string& str) {
+  // Matchers may be paths containing '=', targets may not.
+  size_t pos = str.find('=');
+  if (pos != std::string::npos) {
+    target = std::string(base::TrimWhitespaceASCII(
+        std::string_view(str).substr(0, pos), base::TRIM_ALL));
+    matcher = std::string(base::TrimWhitespaceASCII(
+        std::string_view(str).substr(pos + 1), base::TRIM_ALL));
+  }
+  if (target.empty() || matcher.empty() || matcher == "@") {
+    std::cerr << "Invalid route " << str << std::endl;
+    return false;
+  }
+  if (target != "direct" && target != "proxy") {
+    NaiveProxyServerConfig proxy;
+    if (!proxy.Parse(target)) {
+      return false;
+    }
+    target = proxy.url;
+  }
+  return true;
+}
+
+NaiveHostPin::NaiveHostPin() = default;
+NaiveHostPin::NaiveHostPin(const NaiveHostPin&) = default;
+NaiveHostPin::~NaiveHostPin() = default;
+
+bool NaiveHostPin::Parse(std::string_view str) {
+  std::vector<std::string_view> parts = base::SplitStringPiece(
+      str, "=", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  bool valid = parts.size() == 2 && !parts[0].empty();
+  if (valid) {
+    host = base::ToLowerASCII(parts[0]);
+    for (std::string_view literal : base::SplitStringPiece(
+             parts[1], "|", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+      IPAddress address;
+      valid = valid && address.AssignFromIPLiteral(literal);
+      addresses.push_back(address);
+    }
+  }
+  if (!valid) {
+    std::cerr << "Invalid proxy-pin " << str << std::endl;
+    return false;
+  }
+  return true;
+}
+
+NaiveSpkiPin::NaiveSpkiPin() = default;
+NaiveSpkiPin::NaiveSpkiPin(const NaiveSpkiPin&) = default;
+NaiveSpkiPin::~NaiveSpkiPin() = default;
+
+bool NaiveSpkiPin::Parse(std::string_view str) {
+  // Base64 ends with '=' padding, so the host is split off the first one.
+  size_t eq = str.find('=');
+  std::string_view host_str = base::TrimWhitespaceASCII(
+      str.substr(0, std::min(eq, str.size())), base::TRIM_ALL);
+  bool valid = eq != std::string_view::npos && !host_str.empty();
+  if (valid) {
+    host = base::ToLowerASCII(host_str);
+    for (std::string_view hash_str :
+         base::SplitStringPiece(str.substr(eq + 1), "|",
+                                base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+      valid = valid && hashes.emplace_back().FromString(hash_str);
+    }
+  }
+  if (!valid) {
+    std::cerr << "Invalid proxy-spki " << str << std::endl;
+    return false;
+  }
+  return true;
+}
+
+NaiveRelayConfig::NaiveRelayConfig() = default;
+NaiveRelayConfig::NaiveRelayConfig(const NaiveRelayConfig&) = default;
+NaiveRelayConfig::~NaiveRelayConfig() = default;
+
+bool NaivePriorityRule::Parse(const std::string& str) {
+  std::string_view rule = str;
+  listen = base::StartsWith(rule, "listen:");
+  if (listen) {
+    rule.remove_prefix(sizeof("listen:") - 1);
+  }
+  std::vector<std::string_view> parts = base::SplitStringPiece(
+      rule, "=", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  bool valid = parts.size() == 2;
+  if (valid) {
+    std::vector<std::string_view> ports = base::SplitStringPiece(
+        parts[0], "-", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+    valid = (ports.size() == 1 || ports.size() == 2) &&
+            base::StringToInt(ports.front(), &port_min) &&
+            base::StringToInt(ports.back(), &port_max) && port_min >= 1 &&
+            port_min <= port_max && port_max <= 65535;
+  }
+  if (valid) {
+    valid = false;
+    for (int i = IDLE; i <= MAXIMUM_PRIORITY; ++i) {
+      auto p = static_cast<RequestPriority>(i);
+      if (base::EqualsCaseInsensitiveASCII(parts[1],
+                                           RequestPriorityToString(p))) {
+        priority = p;
+        valid = true;
+      }
+    }
+  }
+  if (!valid) {
+    std::cerr << "Invalid priority " << str << std::endl;
+    return false;
   }
+  return true;
+}
 
+bool NaiveUserConfig::Parse(std::string_view str) {
+  std::vector<std::string_view> parts = base::SplitStringPiece(
+      str, ":", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  bool valid = parts.size() >= 2 && parts.size() <= 4 && !parts[0].empty();
+  if (valid) {
+    name = std::string(parts[0]);
+    pass = std::string(parts[1]);
+  }
+  if (valid && parts.size() >= 3) {
+    valid = base::StringToUint64(parts[2], &soft_quota);
+  }
+  if (valid && parts.size() == 4) {
+    valid = base::StringToUint64(parts[3], &hard_quota);
+  }
+  // Octets of SOCKS5 username/password authentication.
+  if (!valid || name.size() > 255 || pass.size() > 255) {
+    std::cerr << "Invalid user " << name << std::endl;
+    return false;
+  }
   return true;
 }
 
@@ -62,6 +390,22 @@ NaiveConfig::NaiveConfig(const NaiveConfig&) = default;
 NaiveConfig::~NaiveConfig() = default;
 
 bool NaiveConfig::Parse(const base::Value::Dict& value) {
+  // Before the options it sets defaults for.
+  if (value.contains("low-memory")) {
+    low_memory = true;
+    relay.buffer_min_size = 8 * 1024;
+    relay.buffer_max_size = 32 * 1024;
+    relay.read_if_ready = true;
+    h2_session_window = 2 * 1024 * 1024;
+    h2_stream_window = 512 * 1024;
+    // The initial HPACK table size.
+    h2_header_table_size = 4096;
+  }
+
+  if (value.contains("mobile")) {
+    wakeup_period = base::Minutes(1);
+  }
+
   if (const base::Value* v = value.Find("listen")) {
     listen.clear();
     if (const std::string* str = v->GetIfString()) {
@@ -83,119 +427,1608 @@ bool NaiveConfig::Parse(const base::Value::Dict& value) {
       std::cerr << "Invalid listen" << std::endl;
       return false;
     }
+    // NaiveEmbedding hands its connections to a single listener, and the
+    // main worker owns a single NaiveTunStack.
+    for (ClientProtocol protocol :
+         {ClientProtocol::kEmbedded, ClientProtocol::kTun}) {
+      if (std::count_if(listen.begin(), listen.end(),
+                        [protocol](const NaiveListenConfig& listen_config) {
+                          return listen_config.protocol == protocol;
+                        }) > 1) {
+        std::cerr << "Only one " << ToString(protocol)
+                  << " listener is allowed" << std::endl;
+        return false;
+      }
+    }
   }
 
   if (const base::Value* v = value.Find("insecure-concurrency")) {
-    if (std::optional<int> i = v->GetIfInt()) {
-      insecure_concurrency = *i;
-    } else if (const std::string* str = v->GetIfString()) {
-      if (!base::StringToInt(*str, &insecure_concurrency)) {
-        std::cerr << "Invalid concurrency" << std::endl;
-        return false;
-      }
-    } else {
+    if (!ParseInt(*v, &insecure_concurrency) || insecure_concurrency < 1) {
       std::cerr << "Invalid concurrency" << std::endl;
       return false;
     }
-    if (insecure_concurrency < 1) {
-      std::cerr << "Invalid concurrency" << std::endl;
+  }
+
+  if (const base::Value* v = value.Find("insecure-concurrency-max")) {
+    if (!ParseInt(*v, &relay.max_concurrency) ||
+        relay.max_concurrency < insecure_concurrency) {
+      std::cerr << "Invalid insecure-concurrency-max" << std::endl;
       return false;
     }
   }
 
-  if (const base::Value* v = value.Find("extra-headers")) {
-    if (const std::string* str = v->GetIfString()) {
-      extra_headers.AddHeadersFromString(*str);
-    } else {
-      std::cerr << "Invalid extra-headers" << std::endl;
+  if (const base::Value* v = value.Find("bulk-sessions")) {
+    if (!ParseInt(*v, &bulk_sessions) || bulk_sessions < 0) {
+      std::cerr << "Invalid bulk-sessions" << std::endl;
       return false;
     }
   }
 
-  if (const base::Value* v = value.Find("proxy")) {
-    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
-      GURL url(*str);
-      net::GetIdentityFromURL(url, &proxy_user, &proxy_pass);
+  if (const base::Value* v = value.Find("bulk-bytes")) {
+    if (!ParseInt(*v, &relay.bulk_bytes) || relay.bulk_bytes < 1 ||
+        bulk_sessions == 0) {
+      std::cerr << "Invalid bulk-bytes" << std::endl;
+      return false;
+    }
+  }
 
-      GURL::Replacements remove_auth;
-      remove_auth.ClearUsername();
-      remove_auth.ClearPassword();
-      GURL url_no_auth = url.ReplaceComponents(remove_auth);
-      proxy_url = url_no_auth.GetWithEmptyPath().spec();
-      if (proxy_url.empty()) {
-        std::cerr << "Invalid proxy" << std::endl;
-        return false;
-      } else if (proxy_url.back() == '/') {
-        proxy_url.pop_back();
-      }
-    } else {
-      std::cerr << "Invalid proxy" << std::endl;
+  if (value.contains("separate-tunnel-sessions")) {
+    separate_tunnel_sessions = true;
+  }
+
+  if (value.contains("adapt-network")) {
+    relay.adapt_network = true;
+  }
+
+  if (value.contains("session-affinity")) {
+    relay.session_affinity = true;
+  }
+
+  if (const base::Value* v = value.Find("bond")) {
+    if (!ParseInt(*v, &relay.bond_members) || relay.bond_members < 0 ||
+        relay.bond_members > NaiveBondSocket::kMaxMembers) {
+      std::cerr << "Invalid bond" << std::endl;
       return false;
     }
   }
 
-  if (const base::Value* v = value.Find("host-resolver-rules")) {
+  if (const base::Value* v = value.Find("socket-pool-max")) {
+    if (!ParseInt(*v, &socket_pool_max) || socket_pool_max < 1) {
+      std::cerr << "Invalid socket-pool-max" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("socket-pool-max-per-group")) {
+    if (!ParseInt(*v, &socket_pool_max_per_group) ||
+        socket_pool_max_per_group < 1 ||
+        (socket_pool_max > 0 && socket_pool_max_per_group > socket_pool_max)) {
+      std::cerr << "Invalid socket-pool-max-per-group" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("threads")) {
+    if (!ParseInt(*v, &threads) || threads < 1) {
+      std::cerr << "Invalid threads" << std::endl;
+      return false;
+    }
+#if !BUILDFLAG(IS_LINUX)
+    if (threads > 1) {
+      std::cerr << "threads only supports Linux." << std::endl;
+      return false;
+    }
+#endif
+  }
+
+  if (const base::Value* v = value.Find("upstream-threads")) {
+    if (!ParseInt(*v, &upstream_threads) || upstream_threads < 1 ||
+        upstream_threads > threads) {
+      std::cerr << "Invalid upstream-threads" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("cpu-affinity")) {
+#if BUILDFLAG(IS_LINUX)
+    std::vector<std::string> fields;
     if (const std::string* str = v->GetIfString()) {
-      host_resolver_rules = *str;
-    } else {
-      std::cerr << "Invalid host-resolver-rules" << std::endl;
+      fields = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                                 base::SPLIT_WANT_ALL);
+    } else if (std::optional<int> i = v->GetIfInt()) {
+      fields.push_back(base::NumberToString(*i));
+    }
+    cpu_affinity.clear();
+    bool valid = !fields.empty();
+    for (const std::string& field : fields) {
+      int cpu;
+      valid = valid && base::StringToInt(field, &cpu) && cpu >= 0 &&
+              cpu < CPU_SETSIZE;
+      cpu_affinity.push_back(cpu);
+    }
+    if (!valid) {
+      std::cerr << "Invalid cpu-affinity" << std::endl;
       return false;
     }
+#else
+    std::cerr << "cpu-affinity only supports Linux." << std::endl;
+    return false;
+#endif
   }
 
-  if (const base::Value* v = value.Find("resolver-range")) {
-    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
-      if (!net::ParseCIDRBlock(*str, &resolver_range, &resolver_prefix)) {
-        std::cerr << "Invalid resolver-range" << std::endl;
-        return false;
-      }
-      if (resolver_range.IsIPv6()) {
-        std::cerr << "IPv6 resolver range not supported" << std::endl;
+  if (value.contains("numa")) {
+#if BUILDFLAG(IS_LINUX)
+    numa = true;
+#else
+    std::cerr << "numa only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("rebalance")) {
+#if BUILDFLAG(IS_LINUX)
+    rebalance = true;
+#else
+    std::cerr << "rebalance only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("relay-hugepages")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &relay_hugepages_mb) || relay_hugepages_mb < 2 ||
+        relay_hugepages_mb > 1024 * 1024) {
+      std::cerr << "Invalid relay-hugepages" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "relay-hugepages only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("idle-trim")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid idle-trim" << std::endl;
+      return false;
+    }
+    idle_trim = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("idle-trim-connections")) {
+    if (!ParseInt(*v, &idle_trim_connections) || idle_trim_connections < 0) {
+      std::cerr << "Invalid idle-trim-connections" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("overload-lag")) {
+    int ms;
+    if (!ParseInt(*v, &ms) || ms < 0) {
+      std::cerr << "Invalid overload-lag" << std::endl;
+      return false;
+    }
+    overload_lag = base::Milliseconds(ms);
+  }
+
+  if (const base::Value* v = value.Find("overload-policy")) {
+    const std::string* str = v->GetIfString();
+    if (!str) {
+      std::cerr << "Invalid overload-policy" << std::endl;
+      return false;
+    }
+    overload_policy = {};
+    for (std::string_view action : base::SplitStringPiece(
+             *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+      if (action == "pause-accept") {
+        overload_policy.pause_accept = true;
+      } else if (action == "reject-handshakes") {
+        overload_policy.reject_handshakes = true;
+      } else if (action == "shrink-yield") {
+        overload_policy.shrink_yield = true;
+      } else {
+        std::cerr << "Invalid overload-policy " << action << std::endl;
         return false;
       }
-    } else {
-      std::cerr << "Invalid resolver-range" << std::endl;
+    }
+    // Paused listeners accept no client to reject.
+    if (overload_policy.pause_accept && overload_policy.reject_handshakes) {
+      std::cerr << "overload-policy pause-accept does not combine with "
+                   "reject-handshakes"
+                << std::endl;
       return false;
     }
   }
 
-  if (const base::Value* v = value.Find("log")) {
+  if (const base::Value* v = value.Find("epoll-spin")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &epoll_spin_us) || epoll_spin_us < 1 ||
+        epoll_spin_us > 1000000) {
+      std::cerr << "Invalid epoll-spin" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "epoll-spin only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("extra-headers")) {
     if (const std::string* str = v->GetIfString()) {
-      if (!str->empty()) {
-        log.logging_dest = logging::LOG_TO_FILE;
-        log_file = base::FilePath::FromUTF8Unsafe(*str);
-        log.log_file_path = log_file.value().c_str();
-      } else {
-        log.logging_dest = logging::LOG_TO_STDERR;
-      }
+      extra_headers.AddHeadersFromString(*str);
     } else {
-      std::cerr << "Invalid log" << std::endl;
+      std::cerr << "Invalid extra-headers" << std::endl;
       return false;
     }
   }
 
-  if (const base::Value* v = value.Find("log-net-log")) {
-    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
-      log_net_log = base::FilePath::FromUTF8Unsafe(*str);
-    } else {
-      std::cerr << "Invalid log-net-log" << std::endl;
+  if (const base::Value* v = value.Find("user")) {
+    std::vector<std::string> strs;
+    if (const std::string* str = v->GetIfString()) {
+      strs = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                               base::SPLIT_WANT_NONEMPTY);
+    } else if (const base::Value::List* list = v->GetIfList()) {
+      for (const auto& str_e : *list) {
+        if (const std::string* s = str_e.GetIfString()) {
+          strs.push_back(*s);
+        } else {
+          std::cerr << "Invalid user element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (strs.empty()) {
+      std::cerr << "Invalid user" << std::endl;
       return false;
     }
+    for (const std::string& str : strs) {
+      if (!users.emplace_back().Parse(str)) {
+        return false;
+      }
+    }
   }
 
-  if (const base::Value* v = value.Find("ssl-key-log-file")) {
-    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
-      ssl_key_log_file = base::FilePath::FromUTF8Unsafe(*str);
-    } else {
-      std::cerr << "Invalid ssl-key-log-file" << std::endl;
+  if (const base::Value* v = value.Find("user-file")) {
+    const std::string* str = v->GetIfString();
+    std::string contents;
+    if (!str || str->empty() ||
+        !base::ReadFileToString(base::FilePath::FromUTF8Unsafe(*str),
+                                &contents)) {
+      std::cerr << "Invalid user-file" << std::endl;
+      return false;
+    }
+    // Parsed in place rather than as JSON, which would hold every line as
+    // a base::Value too.
+    for (std::string_view line : base::SplitStringPiece(
+             contents, "\n", base::TRIM_WHITESPACE,
+             base::SPLIT_WANT_NONEMPTY)) {
+      if (line[0] == '#')
+        continue;
+      if (!users.emplace_back().Parse(line)) {
+        return false;
+      }
+    }
+    if (users.empty()) {
+      std::cerr << "Invalid user-file" << std::endl;
       return false;
     }
   }
 
-  if (value.contains("no-post-quantum")) {
+  if (!users.empty()) {
+    // NaiveUserTable looks them up by name.
+    absl::flat_hash_set<std::string_view> names;
+    names.reserve(users.size());
+    for (const NaiveUserConfig& user : users) {
+      if (!names.insert(user.name).second) {
+        std::cerr << "Duplicate user " << user.name << std::endl;
+        return false;
+      }
+    }
+  }
+
+  if (const base::Value* v = value.Find("proxy")) {
+    proxies.clear();
+    if (const std::string* str = v->GetIfString()) {
+      for (const std::string& s : base::SplitString(
+               *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+        if (!proxies.emplace_back().Parse(s)) {
+          return false;
+        }
+      }
+    } else if (const base::Value::List* strs = v->GetIfList()) {
+      for (const auto& str_e : *strs) {
+        if (const std::string* s = str_e.GetIfString(); s && !s->empty()) {
+          if (!proxies.emplace_back().Parse(*s)) {
+            return false;
+          }
+        } else {
+          std::cerr << "Invalid proxy element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (proxies.empty()) {
+      std::cerr << "Invalid proxy" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("route")) {
+    route.clear();
+    if (const std::string* str = v->GetIfString()) {
+      for (const std::string& s : base::SplitString(
+               *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+        if (!route.emplace_back().Parse(s)) {
+          return false;
+        }
+      }
+    } else if (const base::Value::List* strs = v->GetIfList()) {
+      for (const auto& str_e : *strs) {
+        if (const std::string* s = str_e.GetIfString(); s && !s->empty()) {
+          if (!route.emplace_back().Parse(*s)) {
+            return false;
+          }
+        } else {
+          std::cerr << "Invalid route element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (route.empty()) {
+      std::cerr << "Invalid route" << std::endl;
+      return false;
+    }
+    // Other proxies would have neither credentials nor forced QUIC.
+    for (const NaiveRouteRule& rule : route) {
+      if (rule.target == "direct" || rule.target == "proxy")
+        continue;
+      bool found = false;
+      for (const NaiveProxyServerConfig& proxy : proxies) {
+        found = found || proxy.url == rule.target;
+      }
+      if (!found) {
+        std::cerr << "Route to unknown proxy " << rule.target << std::endl;
+        return false;
+      }
+    }
+  }
+
+  if (const base::Value* v = value.Find("proxy-pin")) {
+    proxy_pins.clear();
+    if (const std::string* str = v->GetIfString()) {
+      for (const std::string& s : base::SplitString(
+               *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+        if (!proxy_pins.emplace_back().Parse(s)) {
+          return false;
+        }
+      }
+    } else if (const base::Value::List* strs = v->GetIfList()) {
+      for (const auto& str_e : *strs) {
+        if (const std::string* s = str_e.GetIfString(); s && !s->empty()) {
+          if (!proxy_pins.emplace_back().Parse(*s)) {
+            return false;
+          }
+        } else {
+          std::cerr << "Invalid proxy-pin element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (proxy_pins.empty()) {
+      std::cerr << "Invalid proxy-pin" << std::endl;
+      return false;
+    }
+    // Other names are left to host-resolver-rules.
+    for (const NaiveHostPin& pin : proxy_pins) {
+      bool found = false;
+      for (const NaiveProxyServerConfig& proxy : proxies) {
+        found = found || GURL(proxy.url).HostNoBrackets() == pin.host;
+      }
+      if (!found) {
+        std::cerr << "proxy-pin " << pin.host << " is not a proxy host"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  if (const base::Value* v = value.Find("proxy-spki")) {
+    proxy_spki_pins.clear();
+    if (const std::string* str = v->GetIfString()) {
+      for (const std::string& s : base::SplitString(
+               *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+        if (!proxy_spki_pins.emplace_back().Parse(s)) {
+          return false;
+        }
+      }
+    } else if (const base::Value::List* strs = v->GetIfList()) {
+      for (const auto& str_e : *strs) {
+        if (const std::string* s = str_e.GetIfString(); s && !s->empty()) {
+          if (!proxy_spki_pins.emplace_back().Parse(*s)) {
+            return false;
+          }
+        } else {
+          std::cerr << "Invalid proxy-spki element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (proxy_spki_pins.empty()) {
+      std::cerr << "Invalid proxy-spki" << std::endl;
+      return false;
+    }
+    for (const NaiveSpkiPin& pin : proxy_spki_pins) {
+      bool found = false;
+      for (const NaiveProxyServerConfig& proxy : proxies) {
+        found = found || GURL(proxy.url).HostNoBrackets() == pin.host;
+      }
+      if (!found) {
+        std::cerr << "proxy-spki " << pin.host << " is not a proxy host"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  if (const base::Value* v = value.Find("ruleset")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      ruleset = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid ruleset" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("host-resolver-rules")) {
+    if (const std::string* str = v->GetIfString()) {
+      host_resolver_rules = *str;
+    } else {
+      std::cerr << "Invalid host-resolver-rules" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("host-cache-size")) {
+    if (!ParseInt(*v, &host_cache_size) || host_cache_size < 1) {
+      std::cerr << "Invalid host-cache-size" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("host-cache-min-ttl")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid host-cache-min-ttl" << std::endl;
+      return false;
+    }
+    host_cache_min_ttl = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("host-cache-stale")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid host-cache-stale" << std::endl;
+      return false;
+    }
+    host_cache_max_stale = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("host-cache-prefetch")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid host-cache-prefetch" << std::endl;
+      return false;
+    }
+    host_cache_prefetch = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("async-dns")) {
+    const std::string* str = v->GetIfString();
+    if (!str) {
+      std::cerr << "Invalid async-dns" << std::endl;
+      return false;
+    }
+    for (std::string_view server : base::SplitStringPiece(
+             *str, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+      // 1.1.1.1, 1.1.1.1:53, 2606:4700::1111 or [2606:4700::1111]:53.
+      IPAddress address;
+      uint16_t port = 53;
+      if (!address.AssignFromIPLiteral(server)) {
+        HostPortPair host_port = HostPortPair::FromString(server);
+        if (!address.AssignFromIPLiteral(host_port.host()) ||
+            host_port.port() == 0) {
+          std::cerr << "Invalid async-dns server: " << server << std::endl;
+          return false;
+        }
+        port = host_port.port();
+      }
+      async_dns_servers.emplace_back(address, port);
+    }
+    async_dns = true;
+  }
+
+  if (const base::Value* v = value.Find("async-dns-concurrency")) {
+    if (!ParseInt(*v, &async_dns_concurrency) || async_dns_concurrency < 1) {
+      std::cerr << "Invalid async-dns-concurrency" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("resolver-range")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      if (!net::ParseCIDRBlock(*str, &resolver_range, &resolver_prefix)) {
+        std::cerr << "Invalid resolver-range" << std::endl;
+        return false;
+      }
+      if (resolver_range.IsIPv6()) {
+        std::cerr << "IPv6 resolver range not supported" << std::endl;
+        return false;
+      }
+    } else {
+      std::cerr << "Invalid resolver-range" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("resolver-range6")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      if (!net::ParseCIDRBlock(*str, &resolver_range6, &resolver_prefix6) ||
+          !resolver_range6.IsIPv6()) {
+        std::cerr << "Invalid resolver-range6" << std::endl;
+        return false;
+      }
+      // The last 32 bits carry the address offset in resolver-range.
+      if (resolver_prefix6 > 96) {
+        std::cerr << "resolver-range6 prefix must be at most 96" << std::endl;
+        return false;
+      }
+    } else {
+      std::cerr << "Invalid resolver-range6" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("resolver-cache")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      resolver_cache_file = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid resolver-cache" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("resolver-preconnect")) {
+    resolver_preconnect = true;
+  }
+
+  if (const base::Value* v = value.Find("resolver-doh")) {
+#if BUILDFLAG(IS_LINUX)
+    if (const std::string* str = v->GetIfString()) {
+      resolver_doh_url = GURL(*str);
+    }
+    if (!resolver_doh_url.is_valid() ||
+        !resolver_doh_url.SchemeIs(url::kHttpsScheme)) {
+      std::cerr << "Invalid resolver-doh" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "resolver-doh only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("resolver-thread")) {
+    // The DoH requests go through the session of the main worker.
+    if (resolver_doh_url.is_valid()) {
+      std::cerr << "resolver-thread does not combine with resolver-doh"
+                << std::endl;
+      return false;
+    }
+    resolver_thread = true;
+  }
+
+  if (value.contains("redir-sniff")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.redir_sniff = true;
+#else
+    std::cerr << "redir-sniff only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("tproxy-udp-port")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &tproxy_udp_port) || tproxy_udp_port < 1 ||
+        tproxy_udp_port > 65535) {
+      std::cerr << "Invalid tproxy-udp-port" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "tproxy-udp-port only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("tcp-fastopen")) {
+#if BUILDFLAG(IS_LINUX)
+    tcp_fastopen = true;
+#else
+    std::cerr << "tcp-fastopen only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("no-tcp-nodelay")) {
+    tcp_no_delay = false;
+  }
+
+  if (const base::Value* v = value.Find("tcp-rcvbuf")) {
+    if (!ParseInt(*v, &tcp_receive_buffer) || tcp_receive_buffer < 1) {
+      std::cerr << "Invalid tcp-rcvbuf" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("tcp-sndbuf")) {
+    if (!ParseInt(*v, &tcp_send_buffer) || tcp_send_buffer < 1) {
+      std::cerr << "Invalid tcp-sndbuf" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("tcp-notsent-lowat")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &tcp_notsent_lowat) || tcp_notsent_lowat < 1) {
+      std::cerr << "Invalid tcp-notsent-lowat" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "tcp-notsent-lowat only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  // IDLE[,INTERVAL[,COUNT]] in seconds and probes. An IDLE of 0 disables
+  // keepalives.
+  if (const base::Value* v = value.Find("tcp-keepalive")) {
+    std::vector<std::string> fields;
+    if (const std::string* str = v->GetIfString()) {
+      fields = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                                 base::SPLIT_WANT_ALL);
+    } else if (std::optional<int> i = v->GetIfInt()) {
+      fields.push_back(base::NumberToString(*i));
+    }
+    int* const outs[] = {&tcp_keepalive_idle, &tcp_keepalive_interval,
+                         &tcp_keepalive_count};
+    bool valid = !fields.empty() && fields.size() <= std::size(outs);
+    for (size_t i = 0; valid && i < fields.size(); ++i) {
+      valid = base::StringToInt(fields[i], outs[i]) &&
+              *outs[i] >= (i == 0 ? 0 : 1);
+    }
+    if (!valid) {
+      std::cerr << "Invalid tcp-keepalive" << std::endl;
+      return false;
+    }
+#if !BUILDFLAG(IS_LINUX)
+    if (fields.size() > 1) {
+      std::cerr << "tcp-keepalive interval and count only support Linux."
+                << std::endl;
+      return false;
+    }
+#endif
+  }
+
+  if (const base::Value* v = value.Find("tcp-congestion")) {
+#if BUILDFLAG(IS_LINUX)
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      tcp_congestion_control = *str;
+    } else {
+      std::cerr << "Invalid tcp-congestion" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "tcp-congestion only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("tcp-busy-poll")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &tcp_busy_poll_us) || tcp_busy_poll_us < 1) {
+      std::cerr << "Invalid tcp-busy-poll" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "tcp-busy-poll only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("egress-source")) {
+#if BUILDFLAG(IS_LINUX)
+    std::vector<std::string> strs;
+    if (const std::string* str = v->GetIfString()) {
+      strs = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                               base::SPLIT_WANT_NONEMPTY);
+    } else if (const base::Value::List* list = v->GetIfList()) {
+      for (const auto& str_e : *list) {
+        if (const std::string* s = str_e.GetIfString()) {
+          strs.push_back(*s);
+        } else {
+          std::cerr << "Invalid egress-source element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (strs.empty()) {
+      std::cerr << "Invalid egress-source" << std::endl;
+      return false;
+    }
+    for (const std::string& str : strs) {
+      IPAddress address;
+      if (!address.AssignFromIPLiteral(str) || address.IsZero()) {
+        std::cerr << "Invalid egress-source address: " << str << std::endl;
+        return false;
+      }
+      egress_source_addresses.push_back(address);
+    }
+#else
+    std::cerr << "egress-source only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("connect-family")) {
+    using Family = TransportConnectJob::ConnectPolicy::Family;
+    const std::string* str = v->GetIfString();
+    if (str && *str == "ipv6") {
+      connect_policy.family = Family::kPreferIPv6;
+    } else if (str && *str == "ipv4") {
+      connect_policy.family = Family::kPreferIPv4;
+    } else if (str && *str == "ipv6-only") {
+      connect_policy.family = Family::kIPv6Only;
+    } else if (str && *str == "ipv4-only") {
+      connect_policy.family = Family::kIPv4Only;
+    } else {
+      std::cerr << "Invalid connect-family" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("connect-fallback-delay")) {
+    int milliseconds;
+    if (!ParseInt(*v, &milliseconds) || milliseconds < 0) {
+      std::cerr << "Invalid connect-fallback-delay" << std::endl;
+      return false;
+    }
+    connect_policy.fallback_delay = base::Milliseconds(milliseconds);
+  }
+
+  if (const base::Value* v = value.Find("connect-family-memory")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid connect-family-memory" << std::endl;
+      return false;
+    }
+    connect_policy.family_memory = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("proxy-race")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid proxy-race" << std::endl;
+      return false;
+    }
+    connect_policy.race_memory = base::Seconds(seconds);
+    for (const NaiveProxyServerConfig& proxy : proxies) {
+      std::string host = GURL(proxy.url).HostNoBrackets();
+      if (!host.empty())
+        connect_policy.race_hosts.insert(std::move(host));
+    }
+  }
+
+  if (value.contains("mptcp")) {
+#if BUILDFLAG(IS_LINUX)
+    for (const NaiveProxyServerConfig& proxy : proxies) {
+      std::string host = GURL(proxy.url).HostNoBrackets();
+      if (!host.empty())
+        connect_policy.multipath_hosts.insert(std::move(host));
+    }
+#else
+    std::cerr << "mptcp only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("metrics")) {
+    HostPortPair host_port;
+    if (const std::string* str = v->GetIfString()) {
+      host_port = HostPortPair::FromString(*str);
+    }
+    IPAddress address;
+    if (!address.AssignFromIPLiteral(host_port.host()) ||
+        host_port.port() == 0) {
+      std::cerr << "Invalid metrics" << std::endl;
+      return false;
+    }
+    metrics_addr = host_port.host();
+    metrics_port = host_port.port();
+  }
+
+  if (value.contains("metrics-admin")) {
+    IPAddress address;
+    if (metrics_port == 0 || !address.AssignFromIPLiteral(metrics_addr) ||
+        !address.IsLoopback()) {
+      std::cerr << "metrics-admin needs metrics on a loopback address"
+                << std::endl;
+      return false;
+    }
+    metrics_admin = true;
+  }
+
+  if (const base::Value* v = value.Find("tcp-info-interval")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid tcp-info-interval" << std::endl;
+      return false;
+    }
+    tcp_info_interval = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("handoff")) {
+#if BUILDFLAG(IS_LINUX)
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      handoff_path = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid handoff" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "handoff only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("handoff-drain")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid handoff-drain" << std::endl;
+      return false;
+    }
+    handoff_drain = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("log")) {
+    if (const std::string* str = v->GetIfString()) {
+      if (!str->empty()) {
+        log.logging_dest = logging::LOG_TO_FILE;
+        log_file = base::FilePath::FromUTF8Unsafe(*str);
+        log.log_file_path = log_file.value().c_str();
+      } else {
+        log.logging_dest = logging::LOG_TO_STDERR;
+      }
+    } else {
+      std::cerr << "Invalid log" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("log-async")) {
+    log_async = true;
+  }
+
+  if (const base::Value* v = value.Find("log-rate-limit")) {
+    if (!ParseInt(*v, &log_rate_limit) || log_rate_limit < 0) {
+      std::cerr << "Invalid log-rate-limit" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("log-net-log")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      log_net_log = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid log-net-log" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("log-net-log-ring")) {
+    int megabytes;
+    if (!ParseInt(*v, &megabytes) || megabytes < 1 || megabytes > 1024) {
+      std::cerr << "Invalid log-net-log-ring" << std::endl;
+      return false;
+    }
+    if (log_net_log.empty()) {
+      std::cerr << "log-net-log-ring requires log-net-log" << std::endl;
+      return false;
+    }
+    log_net_log_ring_size = static_cast<size_t>(megabytes) * 1024 * 1024;
+  }
+
+  if (const base::Value* v = value.Find("log-net-log-ring-errors")) {
+    if (!ParseInt(*v, &log_net_log_ring_errors) ||
+        log_net_log_ring_errors < 0) {
+      std::cerr << "Invalid log-net-log-ring-errors" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("trace")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      trace = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid trace" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("access-log")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      access_log = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid access-log" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("access-log-records")) {
+    if (!ParseInt(*v, &access_log_records) || access_log_records < 1) {
+      std::cerr << "Invalid access-log-records" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("ssl-key-log-file")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      ssl_key_log_file = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid ssl-key-log-file" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("no-post-quantum")) {
     no_post_quantum = true;
   }
 
+  if (value.contains("kernel-tls")) {
+#if BUILDFLAG(IS_LINUX)
+    kernel_tls = true;
+#else
+    std::cerr << "kernel-tls only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("tls-offload")) {
+    tls_offload = true;
+  }
+
+  if (value.contains("tls-dynamic-records")) {
+    tls_dynamic_records = true;
+  }
+
+  if (value.contains("no-fastopen")) {
+    fastopen = false;
+  }
+
+  if (const base::Value* v = value.Find("padding-cache")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      padding_cache_file = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid padding-cache" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("session-cache")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      session_cache_file = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid session-cache" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("ticket-keys")) {
+    if (const std::string* str = v->GetIfString(); str && !str->empty()) {
+      ticket_keys_file = base::FilePath::FromUTF8Unsafe(*str);
+    } else {
+      std::cerr << "Invalid ticket-keys" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("padding-cache-ttl")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid padding-cache-ttl" << std::endl;
+      return false;
+    }
+    padding_cache_ttl = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("proxy-warm-pool")) {
+    if (!ParseInt(*v, &proxy_warm_pool) || proxy_warm_pool < 1 ||
+        proxy_warm_pool > 64) {
+      std::cerr << "Invalid proxy-warm-pool" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("socks-pipeline")) {
+    socks_pipeline = true;
+  }
+
+  // The smallest window HTTP/2 allows.
+  constexpr int kMinH2Window = 65535;
+  if (const base::Value* v = value.Find("h2-session-window")) {
+    if (!ParseInt(*v, &h2_session_window) ||
+        h2_session_window < kMinH2Window) {
+      std::cerr << "Invalid h2-session-window" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("h2-stream-window")) {
+    if (!ParseInt(*v, &h2_stream_window) || h2_stream_window < kMinH2Window) {
+      std::cerr << "Invalid h2-stream-window" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("h2-window-max")) {
+    if (!ParseInt(*v, &h2_window_max) || h2_window_max < kMinH2Window) {
+      std::cerr << "Invalid h2-window-max" << std::endl;
+      return false;
+    }
+  }
+
+  // Bounds the read buffer kept by each proxy session.
+  constexpr int kMaxH2ReadSize = 4 * 1024 * 1024;
+  if (const base::Value* v = value.Find("h2-read-size")) {
+    if (!ParseInt(*v, &h2_read_size) || h2_read_size < 0 ||
+        h2_read_size > kMaxH2ReadSize) {
+      std::cerr << "Invalid h2-read-size" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("h2-notsent-lowat")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &h2_notsent_lowat) || h2_notsent_lowat < 1) {
+      std::cerr << "Invalid h2-notsent-lowat" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "h2-notsent-lowat only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("write-quantum")) {
+    if (!ParseInt(*v, &write_quantum) || write_quantum < 0) {
+      std::cerr << "Invalid write-quantum" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("session-probe")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid session-probe" << std::endl;
+      return false;
+    }
+    session_probe_interval = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("session-probe-timeout")) {
+    int milliseconds;
+    if (!ParseInt(*v, &milliseconds) || milliseconds < 1) {
+      std::cerr << "Invalid session-probe-timeout" << std::endl;
+      return false;
+    }
+    session_probe_timeout = base::Milliseconds(milliseconds);
+  }
+
+  if (const base::Value* v = value.Find("wakeup-period")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid wakeup-period" << std::endl;
+      return false;
+    }
+    wakeup_period = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("quic-congestion-control")) {
+    const std::string* str = v->GetIfString();
+    quic::QuicTag tag = 0;
+    if (str && *str == "bbr2") {
+      tag = quic::kB2ON;
+    } else if (str && *str == "bbr") {
+      tag = quic::kTBBR;
+    } else if (str && *str == "cubic") {
+      tag = quic::kQBIC;
+    } else if (str && *str == "reno") {
+      tag = quic::kRENO;
+    } else {
+      std::cerr << "Invalid quic-congestion-control" << std::endl;
+      return false;
+    }
+    quic_connection_options.push_back(tag);
+    quic_client_connection_options.push_back(tag);
+  }
+
+  if (const base::Value* v = value.Find("quic-initial-cwnd")) {
+    int packets;
+    if (!ParseInt(*v, &packets)) {
+      packets = 0;
+    }
+    quic::QuicTag tag = 0;
+    if (packets == 3) {
+      tag = quic::kIW03;
+    } else if (packets == 10) {
+      tag = quic::kIW10;
+    } else if (packets == 20) {
+      tag = quic::kIW20;
+    } else if (packets == 50) {
+      tag = quic::kIW50;
+    } else {
+      std::cerr << "Invalid quic-initial-cwnd" << std::endl;
+      return false;
+    }
+    quic_connection_options.push_back(tag);
+    quic_client_connection_options.push_back(tag);
+  }
+
+  if (const base::Value* v = value.Find("quic-connection-options")) {
+    if (!ParseQuicTags(*v, &quic_connection_options)) {
+      std::cerr << "Invalid quic-connection-options" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("quic-client-connection-options")) {
+    if (!ParseQuicTags(*v, &quic_client_connection_options)) {
+      std::cerr << "Invalid quic-client-connection-options" << std::endl;
+      return false;
+    }
+  }
+
+  // The smallest window QUIC allows and the largest it auto-tunes to.
+  constexpr int kMinQuicWindow =
+      static_cast<int>(quic::kMinimumFlowControlSendWindow);
+  constexpr int kMaxQuicSessionWindow =
+      static_cast<int>(quic::kSessionReceiveWindowLimit);
+  constexpr int kMaxQuicStreamWindow =
+      static_cast<int>(quic::kStreamReceiveWindowLimit);
+  if (const base::Value* v = value.Find("quic-session-window")) {
+    if (!ParseInt(*v, &quic_session_window) ||
+        quic_session_window < kMinQuicWindow ||
+        quic_session_window > kMaxQuicSessionWindow) {
+      std::cerr << "Invalid quic-session-window" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("quic-stream-window")) {
+    if (!ParseInt(*v, &quic_stream_window) ||
+        quic_stream_window < kMinQuicWindow ||
+        quic_stream_window > kMaxQuicStreamWindow) {
+      std::cerr << "Invalid quic-stream-window" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("quic-window-autotune")) {
+    quic_window_autotune = true;
+  }
+
+  if (value.contains("no-quic-migration")) {
+    quic_migration = false;
+  }
+
+  if (const base::Value* v = value.Find("quic-port-hop")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid quic-port-hop" << std::endl;
+      return false;
+    }
+    quic_port_hop_interval = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("quic-hop-ports")) {
+    const std::string* str = v->GetIfString();
+    std::vector<std::string_view> ports;
+    if (str) {
+      ports = base::SplitStringPiece(*str, "-", base::TRIM_WHITESPACE,
+                                     base::SPLIT_WANT_ALL);
+    }
+    if (ports.size() != 2 ||
+        !base::StringToInt(ports[0], &quic_hop_port_min) ||
+        !base::StringToInt(ports[1], &quic_hop_port_max) ||
+        quic_hop_port_min < 1 || quic_hop_port_min > quic_hop_port_max ||
+        quic_hop_port_max > 65535) {
+      std::cerr << "Invalid quic-hop-ports" << std::endl;
+      return false;
+    }
+  }
+
+  if (quic_port_hop_interval.is_positive() && !quic_migration) {
+    std::cerr << "quic-port-hop conflicts with no-quic-migration" << std::endl;
+    return false;
+  }
+
+  // QUIC requires 1200 bytes, the largest is what an IPv6 packet on an
+  // Ethernet link carries.
+  constexpr int kMinQuicPacketLength = 1200;
+  constexpr int kMaxQuicPacketLength =
+      static_cast<int>(quic::kMaxOutgoingPacketSize);
+  if (const base::Value* v = value.Find("quic-max-packet-length")) {
+    if (!ParseInt(*v, &quic_max_packet_length) ||
+        quic_max_packet_length < kMinQuicPacketLength ||
+        quic_max_packet_length > kMaxQuicPacketLength) {
+      std::cerr << "Invalid quic-max-packet-length" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("quic-mtu")) {
+    if (!ParseInt(*v, &quic_mtu) || quic_mtu < kMinQuicPacketLength ||
+        quic_mtu > kMaxQuicPacketLength) {
+      std::cerr << "Invalid quic-mtu" << std::endl;
+      return false;
+    }
+  }
+
+  if (value.contains("quic-ecn")) {
+    quic_ecn = true;
+  }
+
+  if (value.contains("quic-txtime")) {
+    quic_txtime = true;
+  }
+
+  if (value.contains("quic-shared-socket")) {
+    quic_shared_socket = true;
+  }
+
+  if (const base::Value* v = value.Find("bench")) {
+    if (const std::string* str = v->GetIfString()) {
+      bench_url = GURL(*str);
+    }
+    if (!bench_url.is_valid() || !bench_url.SchemeIsHTTPOrHTTPS()) {
+      std::cerr << "Invalid bench" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("bench-sessions")) {
+    constexpr int kMaxBenchSessions = 16;
+    if (!ParseInt(*v, &bench_sessions) || bench_sessions < 1 ||
+        bench_sessions > kMaxBenchSessions) {
+      std::cerr << "Invalid bench-sessions" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-buffer-min")) {
+    if (!ParseInt(*v, &relay.buffer_min_size) ||
+        relay.buffer_min_size < NaiveBufferPool::kMinBufferSize ||
+        relay.buffer_min_size > NaiveBufferPool::kMaxBufferSize) {
+      std::cerr << "Invalid relay-buffer-min" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-buffer-max")) {
+    if (!ParseInt(*v, &relay.buffer_max_size) ||
+        relay.buffer_max_size < NaiveBufferPool::kMinBufferSize ||
+        relay.buffer_max_size > NaiveBufferPool::kMaxBufferSize) {
+      std::cerr << "Invalid relay-buffer-max" << std::endl;
+      return false;
+    }
+  }
+
+  if (relay.buffer_min_size > relay.buffer_max_size) {
+    std::cerr << "relay-buffer-min exceeds relay-buffer-max" << std::endl;
+    return false;
+  }
+
+  if (const base::Value* v = value.Find("relay-buffer-grow-after")) {
+    if (!ParseInt(*v, &relay.buffer_grow_after) ||
+        relay.buffer_grow_after < 1) {
+      std::cerr << "Invalid relay-buffer-grow-after" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-buffer-shrink-idle")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid relay-buffer-shrink-idle" << std::endl;
+      return false;
+    }
+    relay.buffer_shrink_idle = base::Seconds(seconds);
+  }
+
+  if (value.contains("relay-read-if-ready")) {
+    relay.read_if_ready = true;
+  }
+
+  if (value.contains("relay-splice")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.splice = true;
+#else
+    std::cerr << "relay-splice only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("relay-io-uring")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.io_uring = true;
+#else
+    std::cerr << "relay-io-uring only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("relay-sockmap")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.sockmap = true;
+#else
+    std::cerr << "relay-sockmap only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("relay-rio")) {
+#if BUILDFLAG(IS_WIN)
+    relay.rio = true;
+#else
+    std::cerr << "relay-rio only supports Windows." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("relay-notsent-lowat")) {
+#if BUILDFLAG(IS_LINUX)
+    if (!ParseInt(*v, &relay.notsent_lowat) || relay.notsent_lowat < 1) {
+      std::cerr << "Invalid relay-notsent-lowat" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "relay-notsent-lowat only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("relay-zerocopy")) {
+#if BUILDFLAG(IS_LINUX)
+    // Smaller sends cost more in page pinning and completions than the
+    // copy saves.
+    if (!ParseInt(*v, &relay.zerocopy_threshold) ||
+        relay.zerocopy_threshold < 4096) {
+      std::cerr << "Invalid relay-zerocopy" << std::endl;
+      return false;
+    }
+#else
+    std::cerr << "relay-zerocopy only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("reset-on-connect-failure")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.reset_on_connect_failure = true;
+#else
+    std::cerr << "reset-on-connect-failure only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (const base::Value* v = value.Find("negative-cache-ttl")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid negative-cache-ttl" << std::endl;
+      return false;
+    }
+    relay.negative_cache_ttl = base::Seconds(seconds);
+  }
+
+  if (value.contains("reset-on-error")) {
+#if BUILDFLAG(IS_LINUX)
+    relay.reset_on_error = true;
+#else
+    std::cerr << "reset-on-error only supports Linux." << std::endl;
+    return false;
+#endif
+  }
+
+  if (value.contains("no-half-close")) {
+    relay.half_close = false;
+  }
+
+  if (const base::Value* v = value.Find("relay-yield-bytes")) {
+    if (!ParseInt(*v, &relay.yield_bytes) || relay.yield_bytes <= 0) {
+      std::cerr << "Invalid relay-yield-bytes" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-yield-interval")) {
+    int milliseconds;
+    if (!ParseInt(*v, &milliseconds) || milliseconds <= 0) {
+      std::cerr << "Invalid relay-yield-interval" << std::endl;
+      return false;
+    }
+    relay.yield_interval = base::Milliseconds(milliseconds);
+  }
+
+  if (value.contains("relay-yield-adaptive")) {
+    relay.yield_adaptive = true;
+  }
+
+  if (const base::Value* v = value.Find("relay-yield-batch")) {
+    if (!ParseInt(*v, &relay.yield_batch) || relay.yield_batch < 0) {
+      std::cerr << "Invalid relay-yield-batch" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-read-ahead")) {
+    // At least a DATA frame, so the proxy can always send.
+    if (!ParseInt(*v, &relay.read_ahead_limit) ||
+        relay.read_ahead_limit < 16 * 1024) {
+      std::cerr << "Invalid relay-read-ahead" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-pipeline")) {
+    if (!ParseInt(*v, &relay.pipeline_bytes) || relay.pipeline_bytes < 0) {
+      std::cerr << "Invalid relay-pipeline" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-coalesce")) {
+    // Padded writes frame their payload with a 16-bit size.
+    if (!ParseInt(*v, &relay.coalesce_bytes) || relay.coalesce_bytes < 0 ||
+        relay.coalesce_bytes > std::numeric_limits<uint16_t>::max()) {
+      std::cerr << "Invalid relay-coalesce" << std::endl;
+      return false;
+    }
+    if (relay.coalesce_bytes > 0 && relay.pipeline_bytes == 0) {
+      std::cerr << "relay-coalesce requires relay-pipeline" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-padding-batch")) {
+    if (!ParseInt(*v, &relay.padding_batch_bytes) ||
+        relay.padding_batch_bytes < 0 ||
+        relay.padding_batch_bytes > std::numeric_limits<uint16_t>::max()) {
+      std::cerr << "Invalid relay-padding-batch" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("relay-padding-batch-delay")) {
+    int microseconds;
+    if (!ParseInt(*v, &microseconds) || microseconds < 0) {
+      std::cerr << "Invalid relay-padding-batch-delay" << std::endl;
+      return false;
+    }
+    relay.padding_batch_delay = base::Microseconds(microseconds);
+  }
+
+  if (const base::Value* v = value.Find("padding-profile")) {
+    if (const std::string* str = v->GetIfString()) {
+      relay.padding_profile = ParsePaddingProfile(*str);
+    }
+    if (!relay.padding_profile.has_value()) {
+      std::cerr << "Invalid padding-profile" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("udp-idle-timeout")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid udp-idle-timeout" << std::endl;
+      return false;
+    }
+    relay.udp_idle_timeout = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("handshake-timeout")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid handshake-timeout" << std::endl;
+      return false;
+    }
+    relay.handshake_timeout = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("connect-timeout")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid connect-timeout" << std::endl;
+      return false;
+    }
+    relay.connect_timeout = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("idle-timeout")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 0) {
+      std::cerr << "Invalid idle-timeout" << std::endl;
+      return false;
+    }
+    relay.idle_timeout = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("keep-warm")) {
+    int seconds;
+    if (!ParseInt(*v, &seconds) || seconds < 1) {
+      std::cerr << "Invalid keep-warm" << std::endl;
+      return false;
+    }
+    relay.keep_warm_interval = base::Seconds(seconds);
+  }
+
+  if (const base::Value* v = value.Find("egress-preconnect")) {
+    if (!ParseInt(*v, &relay.egress_preconnect) ||
+        relay.egress_preconnect < 1 || relay.egress_preconnect > 16) {
+      std::cerr << "Invalid egress-preconnect" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("rate-limit")) {
+    if (!ParseInt(*v, &relay.rate_limit) || relay.rate_limit < 0) {
+      std::cerr << "Invalid rate-limit" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("user-rate-limit")) {
+    if (!ParseInt(*v, &relay.user_rate_limit) || relay.user_rate_limit < 0) {
+      std::cerr << "Invalid user-rate-limit" << std::endl;
+      return false;
+    }
+  }
+
+  if (const base::Value* v = value.Find("priority")) {
+    std::vector<std::string> rules;
+    if (const std::string* str = v->GetIfString()) {
+      rules = base::SplitString(*str, ",", base::TRIM_WHITESPACE,
+                                base::SPLIT_WANT_NONEMPTY);
+    } else if (const base::Value::List* strs = v->GetIfList()) {
+      for (const auto& str_e : *strs) {
+        if (const std::string* s = str_e.GetIfString()) {
+          rules.push_back(*s);
+        } else {
+          std::cerr << "Invalid priority element" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (rules.empty()) {
+      std::cerr << "Invalid priority" << std::endl;
+      return false;
+    }
+    for (const std::string& rule : rules) {
+      if (!relay.priority_rules.emplace_back().Parse(rule)) {
+        return false;
+      }
+    }
+  }
+
   return true;
 }
 
@@ -4,16 +4,27 @@
 #ifndef NET_TOOLS_NAIVE_NAIVE_CONFIG_H_
 #define NET_TOOLS_NAIVE_NAIVE_CONFIG_H_
 
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/files/file_path.h"
 #include "base/logging.h"
+#include "base/time/time.h"
 #include "base/values.h"
+#include "net/base/hash_value.h"
 #include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/request_priority.h"
 #include "net/http/http_request_headers.h"
+#include "net/socket/transport_connect_job.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_tag.h"
+#include "net/tools/naive/naive_lag_monitor.h"
+#include "net/tools/naive/naive_padding_table.h"
 #include "net/tools/naive/naive_protocol.h"
+#include "url/gurl.h"
 
 namespace net {
 
@@ -23,39 +34,644 @@ struct NaiveListenConfig {
   std::string pass;
   std::string addr = "0.0.0.0";
   int port = 1080;
+  // Per IO thread, unlimited if 0. From the query string, e.g.
+  // "socks://:1080?max-connections=4096&max-handshakes=256".
+  int max_connections = 0;
+  int max_handshakes = 0;
+  // Per IO thread, open connections to one destination host and port,
+  // unlimited if 0, see NaiveRelayConfig::max_destination_connections.
+  int max_destination_connections = 0;
+  // Length of the accept queue, capped by net.core.somaxconn on Linux.
+  int backlog = 512;
+  // Bytes a second of each direction of all connections of the listener,
+  // unlimited if 0, see NaiveRelayConfig::listen_rate_limit.
+  int rate_limit = 0;
+  // PEM certificate chain and private key of https:// listeners, e.g.
+  // "https://:443?cert=/etc/naive/fullchain.pem&key=/etc/naive/key.pem".
+  base::FilePath cert;
+  base::FilePath key;
+  // The device of tun:// listeners, opened by name as in "tun://tun0", or
+  // inherited already open with the name only labeling it, as in
+  // "tun://vpn?fd=3". `mtu` is that of the device, e.g.
+  // "tun://tun0?mtu=9000".
+  std::string device;
+  int tun_fd = -1;
+  int mtu = 1500;
+  // Whether a tun:// listener carries the packets of flows to addresses
+  // other than fake ones in a CONNECT-IP tunnel through its QUIC proxy, as
+  // in "tun://tun0?connect-ip", see NaiveTunStack.
+  bool connect_ip = false;
+  // Whether an https:// listener is instead h2c://, taking cleartext
+  // HTTP/2 with prior knowledge and no cert, for local clients multiplexing
+  // their tunnels over one connection, e.g. "h2c://127.0.0.1:8443".
+  bool h2c = false;
+  // The socket file of socks+unix:// and http+unix:// listeners, which take
+  // kSocks5 and kHttp clients on a Unix domain socket, e.g.
+  // "socks+unix:///run/naive.sock". Empty for those on TCP.
+  std::string unix_path;
+  // Whether socks:// and http:// clients are behind a load balancer sending
+  // the PROXY protocol header, e.g. "socks://:1080?proxy-protocol".
+  bool proxy_protocol = false;
 
   NaiveListenConfig();
   NaiveListenConfig(const NaiveListenConfig&);
   ~NaiveListenConfig();
   bool Parse(const std::string& str);
+
+  friend bool operator==(const NaiveListenConfig&,
+                         const NaiveListenConfig&) = default;
+};
+
+struct NaiveProxyServerConfig {
+  std::string url = "direct://";
+  std::u16string user;
+  std::u16string pass;
+
+  NaiveProxyServerConfig();
+  NaiveProxyServerConfig(const NaiveProxyServerConfig&);
+  ~NaiveProxyServerConfig();
+  bool Parse(const std::string& str);
+};
+
+// Assigns a stream priority to tunnels, parsed from
+// "[listen:]PORT[-PORT]=PRIORITY", where PRIORITY is one of highest, medium,
+// low, lowest and idle. Rules match the destination port, or with "listen:"
+// the port of the listener accepting the connection.
+struct NaivePriorityRule {
+  bool listen = false;
+  int port_min = 0;
+  int port_max = 0;
+  RequestPriority priority = MAXIMUM_PRIORITY;
+
+  bool Parse(const std::string& str);
+  bool Matches(int port) const { return port >= port_min && port <= port_max; }
+};
+
+// Routes tunnels by destination, parsed from "TARGET=MATCHER". TARGET is
+// "direct", "proxy" for the upstreams as without rules, or the URL of one of
+// the proxies. MATCHER is a domain suffix, an IP address or CIDR block, "*"
+// for all others, or "@PATH" of a file with one matcher per line. The most
+// specific match wins, see NaiveRouter.
+struct NaiveRouteRule {
+  std::string target;
+  std::string matcher;
+
+  bool Parse(const std::string& str);
+};
+
+// Addresses of a proxy host connected to without resolving it, parsed from
+// "HOST=IP[|IP...]".
+struct NaiveHostPin {
+  std::string host;
+  std::vector<IPAddress> addresses;
+
+  NaiveHostPin();
+  NaiveHostPin(const NaiveHostPin&);
+  ~NaiveHostPin();
+  bool Parse(std::string_view str);
+};
+
+// Public keys a proxy host is trusted with instead of the trust store,
+// parsed from "HOST=sha256/BASE64[|sha256/BASE64...]", see
+// NaiveCertVerifier.
+struct NaiveSpkiPin {
+  std::string host;
+  HashValueVector hashes;
+
+  NaiveSpkiPin();
+  NaiveSpkiPin(const NaiveSpkiPin&);
+  ~NaiveSpkiPin();
+  bool Parse(std::string_view str);
+};
+
+// A client of the SOCKS5 listeners without credentials of their own, parsed
+// from "NAME:PASS[:SOFT[:HARD]]" with quotas in megabytes relayed either
+// way since startup, unlimited if 0. Over the soft quota the user's new
+// connections are refused, over the hard quota its open ones are closed.
+struct NaiveUserConfig {
+  std::string name;
+  std::string pass;
+  uint64_t soft_quota = 0;
+  uint64_t hard_quota = 0;
+
+  bool Parse(std::string_view str);
+};
+
+// Tuning of the relay loop in NaiveConnection.
+struct NaiveRelayConfig {
+  // Read buffer sizes per direction. Equal sizes disable adaptive sizing.
+  // Otherwise reads start at `buffer_min_size`, double after
+  // `buffer_grow_after` consecutive reads filling the buffer up to
+  // `buffer_max_size`, and fall back to `buffer_min_size` after a read
+  // stays pending for `buffer_shrink_idle`.
+  int buffer_min_size = 64 * 1024;
+  int buffer_max_size = 64 * 1024;
+  int buffer_grow_after = 2;
+  base::TimeDelta buffer_shrink_idle = base::Seconds(5);
+
+  // Waits for readability with ReadIfReady() so idle directions do not hold
+  // a read buffer. Sockets without support fall back to Read().
+  bool read_if_ready = false;
+
+  // A relay direction yields to the other connections of its IO thread after
+  // reading `yield_bytes` or for `yield_interval` without doing so, like
+  // SpdySession. The yielded directions are resumed up to `yield_batch` per
+  // pump iteration, see NaiveRelayScheduler. 0 resumes all queued at once.
+  int yield_bytes = 32 * 1024;
+  base::TimeDelta yield_interval = base::Milliseconds(20);
+  int yield_batch = 0;
+  // Scales the budget with the connections relaying on the thread instead,
+  // see NaiveRelayScheduler::GetAdaptiveYieldBytes(). `yield_bytes` is then
+  // the least and `yield_interval` the most a direction gets.
+  bool yield_adaptive = false;
+
+  // Relays direct:// connections without padding with splice(2). Linux only.
+  bool splice = false;
+
+  // Relays the connections `splice` would with io_uring instead, see
+  // NaiveUringRelay, falling back to `splice` if enabled or the userspace
+  // relay on kernels without it. Linux only.
+  bool io_uring = false;
+
+  // Relays the connections `splice` would in the kernel through a BPF
+  // sockmap instead, see NaiveSockmapRelay, falling back to `io_uring` or
+  // `splice` if enabled or the userspace relay where it is not available.
+  // Linux only.
+  bool sockmap = false;
+
+  // Relays the connections `splice` would with Registered I/O, see
+  // NaiveRioRelay, or the userspace relay where it is not available.
+  // Windows only.
+  bool rio = false;
+
+  // Sets TCP_NOTSENT_LOWAT on the client sockets and direct:// server sockets
+  // and reads the next payload for one only once its unsent bytes fell under
+  // it, see NaiveDrainWatcher. 0 disables it. Linux only.
+  int notsent_lowat = 0;
+
+  // Sends the writes of at least this many bytes to direct:// server
+  // sockets with MSG_ZEROCOPY, see SocketPosix::EnableZeroCopy(). 0
+  // disables it. Linux only.
+  int zerocopy_threshold = 0;
+
+  // Resets client connections if the upstream connection fails, after the
+  // client was already sent a success reply. Linux only.
+  bool reset_on_connect_failure = false;
+
+  // Takes the name a redir client connects to from the server name of its
+  // TLS ClientHello or the Host header of its HTTP request, see
+  // NaiveSniffer, unless its address is one the redirect resolver handed
+  // out for a name. Linux only.
+  bool redir_sniff = false;
+
+  // Fails the connections to a destination at once for this long after an
+  // upstream connect to it failed as unreachable, see NaiveNegativeCache.
+  // Zero disables it.
+  base::TimeDelta negative_cache_ttl;
+
+  // Closes the client and direct:// server sockets of a connection with a
+  // reset when either side fails other than by a clean close, so error
+  // storms do not leave sockets in FIN_WAIT or TIME_WAIT. Linux only.
+  bool reset_on_error = false;
+
+  // Passes on the EOF of one side as a half-close of the other, a FIN or
+  // END_STREAM, and goes on relaying the other way until it ends too, see
+  // StreamSocket::ShutdownWrite(). Sides that cannot half-close are closed.
+  bool half_close = true;
+
+  // While a write to the client is pending, keeps at most this many bytes
+  // of HTTP/2 tunnel data buffered here or in flight from the proxy, by
+  // holding back the stream's window updates until the buffered data has
+  // been relayed, see ProxyClientSocket::SetReadAheadLimit(). Bounds the
+  // memory of slow clients below the stream window. 0 disables it.
+  int read_ahead_limit = 0;
+
+  // Keeps reading from a side while the write of the previous read to the
+  // other side is pending, queueing up to this many bytes behind it, so a
+  // slow write does not hold up reads from a fast side. Bounds the relay
+  // buffers of each direction to the queue plus the write pending. 0
+  // alternates reads and writes.
+  int pipeline_bytes = 0;
+
+  // Merges reads queued by `pipeline_bytes` into the last queued write
+  // while it holds less than this many bytes, so bursts of small reads,
+  // e.g. of interactive clients, take fewer DATA frames and TLS records.
+  // Reads with no write pending go out as they are. 0 disables it.
+  int coalesce_bytes = 0;
+
+  // Lets reads that become ready within `padding_batch_delay` join the
+  // payload of a pending padded write, up to `padding_batch_bytes`, so
+  // bursts of small writes spend fewer of the padded frames. 0 disables it.
+  int padding_batch_bytes = 0;
+  base::TimeDelta padding_batch_delay;
+
+  // Shapes the padding sizes of PaddingType::kVariant2 writes. If set,
+  // kVariant2 is also requested from the proxy. Otherwise only clients
+  // asking for it get kVariant2, shaped uniformly.
+  std::optional<PaddingProfile> padding_profile;
+
+  // Closes the CONNECT-UDP tunnel of a SOCKS5 or TPROXY UDP flow after no
+  // datagram went either way for this long.
+  base::TimeDelta udp_idle_timeout = base::Seconds(60);
+
+  // Closes connections whose client handshake, upstream connect, or relay
+  // made no progress for this long. Zero disables a timeout. The control
+  // connection of a UDP association is left to `udp_idle_timeout`.
+  base::TimeDelta handshake_timeout = base::Seconds(60);
+  base::TimeDelta connect_timeout;
+  base::TimeDelta idle_timeout;
+
+  // Preconnects a tunnel session for each anonymization key this often, at
+  // startup and after network changes, so a client arriving after idle does
+  // not wait for the session handshakes. Zero disables it.
+  base::TimeDelta keep_warm_interval;
+
+  // Keeps this many idle direct:// connections, past those open, to each of
+  // the destinations taking the most connects, so connections to them skip
+  // the DNS lookup and TCP handshake, see NaiveHotDestinations. 0 disables
+  // it.
+  int egress_preconnect = 0;
+
+  // Adds tunnel sessions beyond insecure-concurrency while the existing
+  // ones carry many connections, up to this many in total, and removes them
+  // once the load drops. 0 keeps insecure-concurrency fixed.
+  int max_concurrency = 0;
+
+  // Adapts to the estimates of the upstream network, see
+  // NaiveNetworkAdapter.
+  bool adapt_network = false;
+
+  // Sends the connections to a site, by registrable domain, down the same
+  // tunnel session unless it is loaded, where its HPACK state and
+  // congestion window are warm, instead of spreading them by load. Off by
+  // default, as spreading them hides which connections go together.
+  bool session_affinity = false;
+
+  // Connections to a host one of whose connections received this many
+  // bytes from it in the last minutes count as bulk, see
+  // NaiveConfig::bulk_sessions. 0 classes them by priority only.
+  int bulk_bytes = 0;
+
+  // Stripes each proxied connection over `bond_members` tunnels, each on a
+  // tunnel session of its own, once the proxy replied that it joins bonds,
+  // see NaiveBondSocket. 0 disables it. A server joins the bonds of its
+  // clients with `accept_bonds`, only set with a single upstream thread,
+  // where all the members of a bond arrive.
+  int bond_members = 0;
+  bool accept_bonds = false;
+
+  // Tunnel priorities of the connections of a listener, overridden by the
+  // first destination port rule of `priority_rules` matching. The first
+  // listen port rule matching sets `priority` of each listener.
+  std::vector<NaivePriorityRule> priority_rules;
+  RequestPriority priority = MAXIMUM_PRIORITY;
+
+  // Shapes the relay with NaiveRateLimiter, in bytes a second of each
+  // direction, unlimited if 0: `rate_limit` of all connections,
+  // `user_rate_limit` of those of each listen user across the listeners,
+  // and `listen_rate_limit` of those of a listener, set from
+  // NaiveListenConfig::rate_limit. Each upstream thread gets an equal share.
+  int rate_limit = 0;
+  int user_rate_limit = 0;
+  int listen_rate_limit = 0;
+
+  // Connections of a listener to one destination open at once, unlimited if
+  // 0, set from NaiveListenConfig::max_destination_connections. Those past
+  // it are closed once their destination is known, so one hot destination
+  // cannot take all the connections and sockets of the others.
+  int max_destination_connections = 0;
+
+  // Whether the clients of a listener send the PROXY protocol header of a
+  // load balancer first, set from NaiveListenConfig::proxy_protocol.
+  bool proxy_protocol = false;
+
+  NaiveRelayConfig();
+  NaiveRelayConfig(const NaiveRelayConfig&);
+  ~NaiveRelayConfig();
+
+  bool IsAdaptive() const { return buffer_min_size != buffer_max_size; }
 };
 
 struct NaiveConfig {
+  // Defaults for devices with little RAM, overridden by the options they
+  // are defaults of: smaller relay buffers read only when ready, smaller
+  // HTTP/2 windows and header table, and at startup socket pool limits
+  // scaled to the physical memory, a smaller idle buffer pool and smaller
+  // allocator thread caches.
+  bool low_memory = false;
+
+  // Coalesces the periodic work of all threads to multiples of this, so a
+  // phone's radio wakes once per period instead of once per timer: the
+  // PINGs of `session_probe_interval`, keep-warm, resolver expiry, user
+  // quota flushes and the other housekeeping timers. Tunnel sessions past
+  // the first are closed once no connection was open for a period and
+  // warmed again by the next connection. Set to a minute by `mobile`. Zero
+  // disables it.
+  base::TimeDelta wakeup_period;
+
   std::vector<NaiveListenConfig> listen = {NaiveListenConfig()};
 
   int insecure_concurrency = 1;
+  // Tunnel sessions kept for bulk connections, those at the priority
+  // lowest or idle by NaiveRelayConfig::priority_rules or to a host marked
+  // by NaiveRelayConfig::bulk_bytes, so interactive connections never wait
+  // behind the retransmissions of a bulk one in its TCP connection. 0 puts
+  // all connections on the sessions of `insecure_concurrency`.
+  int bulk_sessions = 0;
+  // Gives each listener its own tunnel sessions instead of sharing those of
+  // its IO thread with the other listeners, so that the connections of
+  // different listeners never go down the same session.
+  bool separate_tunnel_sessions = false;
+
+  // Limits of the normal socket pool of each network session, overall and
+  // per proxy chain, and per group, i.e. per destination and proxy chain.
+  // Tunnels and direct connections of the relay ignore them, other sockets
+  // such as those of certificate fetches and DoH queue at them. 0 keeps
+  // the default of 2048 and 2040, or those of `low_memory`.
+  int socket_pool_max = 0;
+  int socket_pool_max_per_group = 0;
+
+  // Number of IO threads, each running its own listeners and network session.
+  // Connections are distributed by the kernel through SO_REUSEPORT.
+  int threads = 1;
+
+  // Number of the threads owning upstream sessions. The other threads only
+  // accept connections and hand them to these, so upstream connections are
+  // not multiplied by `threads`. 0 means all threads.
+  int upstream_threads = 0;
+
+  // CPUs the IO threads are pinned to, thread i to cpu_affinity[i % size].
+  // Empty leaves them to the scheduler. Linux only.
+  std::vector<int> cpu_affinity;
+
+  // Spreads the IO threads over the NUMA nodes, or places them on the nodes
+  // of their cpu_affinity, preferring node memory for them, and hands each
+  // connection to a thread on the node that received it. Linux only.
+  bool numa = false;
+
+  // Moves busy direct relays from the busiest upstream thread to the
+  // idlest, see NaiveRebalancer. Linux only.
+  bool rebalance = false;
+
+  // Microseconds an idle IO thread polls for events before sleeping, see
+  // MessagePumpEpoll::SetSpinDuration(). Linux only.
+  int epoll_spin_us = 0;
+
+  // Megabytes of relay buffers each IO thread reserves on huge pages, see
+  // NaiveBufferArena. 0 allocates them from the heap. Linux only.
+  int relay_hugepages_mb = 0;
+
+  // Trims the memory of an IO thread once it has had at most
+  // `idle_trim_connections` open for this long, see NaiveIdleTrimmer. Zero
+  // disables it.
+  base::TimeDelta idle_trim;
+  int idle_trim_connections = 0;
+
+  // Sheds load by `overload_policy` while the tasks of an IO thread wait
+  // this long to run, see NaiveLagMonitor. Zero disables it.
+  base::TimeDelta overload_lag;
+  NaiveLagMonitor::Policy overload_policy = {.pause_accept = true,
+                                             .shrink_yield = true};
 
   HttpRequestHeaders extra_headers;
 
-  std::string proxy_url = "direct://";
+  // Accounted separately, see NaiveUserTable. Includes those read from the
+  // "user-file" option, one per line, so large tables stay out of the JSON
+  // config. Names are unique.
+  std::vector<NaiveUserConfig> users;
 
-  std::u16string proxy_user;
-  std::u16string proxy_pass;
+  // Each connection goes to the best healthy one of these upstreams, see
+  // NaiveProxyDelegate::OnResolveProxy().
+  std::vector<NaiveProxyServerConfig> proxies = {NaiveProxyServerConfig()};
+  std::vector<NaiveRouteRule> route;
+  std::vector<NaiveHostPin> proxy_pins;
+  std::vector<NaiveSpkiPin> proxy_spki_pins;
+  // Compiled by naive_rules_compile, with the tags "ruleset:" and "geoip:"
+  // matchers of `route` refer to, see NaiveRuleset.
+  base::FilePath ruleset;
 
   std::string host_resolver_rules;
 
+  // Host cache of each network session. 0 keeps Chromium's 1000 entries.
+  int host_cache_size = 0;
+  // Successful results are cached for at least this long.
+  base::TimeDelta host_cache_min_ttl;
+  // See NaiveHostResolver. Both zero and no `proxy_pins` disables it.
+  base::TimeDelta host_cache_max_stale;
+  base::TimeDelta host_cache_prefetch;
+
+  // Resolves with Chromium's asynchronous DnsClient instead of
+  // getaddrinfo() on ThreadPool workers, querying `async_dns_servers` if
+  // set, otherwise the nameservers of the system config.
+  bool async_dns = false;
+  std::vector<IPEndPoint> async_dns_servers;
+  // Names each network session resolves at once with `async_dns`.
+  int async_dns_concurrency = 1024;
+
   IPAddress resolver_range = {100, 64, 0, 0};
   size_t resolver_prefix = 10;
+  // Answers AAAA queries from this range if set, e.g. a /64. Otherwise
+  // AAAA queries get an empty answer.
+  IPAddress resolver_range6;
+  size_t resolver_prefix6 = 0;
+  // Keeps the resolver mappings across restarts if set.
+  base::FilePath resolver_cache_file;
+  // Opens a tunnel to each new name the resolver maps, before the redirected
+  // connection to it arrives.
+  bool resolver_preconnect = false;
+  // Forwards the queries the range does not answer to this DNS over HTTPS
+  // server through the proxy if set. Linux only.
+  GURL resolver_doh_url;
+  // Serves the resolver on an IO thread of its own instead of the main
+  // worker's, so its replies do not wait for the relays.
+  bool resolver_thread = false;
+
+  // Port on the redir listen address receiving UDP redirected by an iptables
+  // TPROXY rule. 0 disables it. Linux only.
+  int tproxy_udp_port = 0;
+
+  // Options of the listening, accepted and outgoing TCP sockets, see
+  // TCPSocketPosix::TuningOptions. Not applied on Windows.
+  bool tcp_fastopen = false;
+  bool tcp_no_delay = true;
+  int tcp_receive_buffer = 0;
+  int tcp_send_buffer = 0;
+  int tcp_notsent_lowat = 0;
+  int tcp_keepalive_idle = 45;
+  int tcp_keepalive_interval = 0;
+  int tcp_keepalive_count = 0;
+  std::string tcp_congestion_control;
+  int tcp_busy_poll_us = 0;
+  // Local addresses of outgoing TCP sockets. Linux only.
+  std::vector<IPAddress> egress_source_addresses;
+
+  // Address family racing of outgoing TCP connects, to direct destinations
+  // and to proxies.
+  TransportConnectJob::ConnectPolicy connect_policy;
+
+  // Serves Prometheus metrics over HTTP on this address if the port is set.
+  std::string metrics_addr;
+  int metrics_port = 0;
+  // Also serves the admin listing of connections and sessions there, which
+  // closes connections, on a loopback address only.
+  bool metrics_admin = false;
+  // Samples the TCP_INFO of relay and tunnel sockets this often for the
+  // metrics, see NaiveTcpInfoStats. Zero disables it. Linux only.
+  base::TimeDelta tcp_info_interval;
+
+  // Takes over the listening sockets of the naive serving this unix socket
+  // path at startup if any, then serves them at the path to the next one.
+  // Linux only.
+  base::FilePath handoff_path;
+  // Open connections are served this long after a handoff.
+  base::TimeDelta handoff_drain = base::Minutes(10);
 
   logging::LoggingSettings log = {.logging_dest = logging::LOG_NONE};
   base::FilePath log_file;
+  // Writes the log from a thread pool sequence instead of the logging
+  // threads.
+  bool log_async = false;
+  // Messages a second each log call site may write, unlimited if 0.
+  int log_rate_limit = 0;
 
   base::FilePath log_net_log;
+  // Keeps this much of the NetLog in memory if positive, saved next to
+  // `log_net_log` on SIGUSR1 or after `log_net_log_ring_errors` failed
+  // events within a minute, instead of writing all of it there.
+  size_t log_net_log_ring_size = 0;
+  int log_net_log_ring_errors = 0;
+
+  // Records the trace events of the relay pipeline with Perfetto, in
+  // builds with enable_base_tracing=true.
+  base::FilePath trace;
+
+  // Records each closed connection in a ring of this many fixed width
+  // records mapped from the file, see NaiveAccessLog.
+  base::FilePath access_log;
+  int access_log_records = 262144;
 
   base::FilePath ssl_key_log_file;
 
   std::optional<bool> no_post_quantum;
 
+  // Encrypts the records sent to TLS 1.3 proxies in the kernel, see
+  // SSLClientSocket::SetKernelTlsEnabled(). Linux only.
+  bool kernel_tls = false;
+
+  // Encrypts the records sent to TLS 1.3 proxies on the thread pool, see
+  // SSLClientSocket::SetParallelSealingEnabled().
+  bool tls_offload = false;
+
+  // Starts writes after idle with small TLS records, see
+  // SSLClientSocket::SetDynamicRecordSizing().
+  bool tls_dynamic_records = false;
+
+  // Sends early client data right after the tunnel request instead of after
+  // the tunnel response from HTTP/2 and HTTP/3 proxies whose padding support
+  // is known.
+  bool fastopen = true;
+
+  // Persists the padding types negotiated with proxies, so the first
+  // connections after a restart can start relaying early.
+  base::FilePath padding_cache_file;
+  // Negotiated padding types are forgotten after not being confirmed by a
+  // tunnel response for this long.
+  base::TimeDelta padding_cache_ttl = base::Days(1);
+
+  // Keeps TLS sessions, QUIC resumption state and HTTP server properties
+  // across restarts, see NaiveSessionStore.
+  base::FilePath session_cache_file;
+
+  // Session ticket keys of https:// and quic:// listeners shared with other
+  // servers, see NaiveTicketKeys.
+  base::FilePath ticket_keys_file;
+
+  // Idle TCP or TLS connections kept to each HTTP/1.1 proxy, and greeted
+  // ones to each SOCKS5 proxy, for the next tunnels, see HttpProxyWarmPool and
+  // SOCKS5WarmPool. 0 disables it.
+  int proxy_warm_pool = 0;
+
+  // Sends the CONNECT request to socks:// proxies along with the greeting.
+  bool socks_pipeline = false;
+
+  // HTTP/2 receive windows of the proxy sessions and their tunnel streams.
+  // 0 keeps Chromium's 15 MB per session and 6 MB per stream.
+  int h2_session_window = 0;
+  int h2_stream_window = 0;
+  // Grows the receive windows up to this while the proxy is limited by
+  // them, see SpdySession::AutotuneRecvWindowSize(). 0 disables it.
+  int h2_window_max = 0;
+  // Lets the socket reads of HTTP/2 proxy sessions grow from 8 KiB up to
+  // this while the proxy sends faster than they drain, see
+  // SpdySession::EnableAdaptiveReadSize(). 0 keeps them at 8 KiB.
+  int h2_read_size = 0;
+  // Completes a write into an HTTP/2 tunnel only once fewer than this many
+  // of its bytes are unsent in the kernel, see
+  // SpdySession::EnableUploadLowat().
+  int h2_notsent_lowat = 0;
+  // Bytes each tunnel stream of a proxy session sends before the others
+  // get their turn: a deficit round robin over HTTP/2 streams, and the
+  // batch size of QUIC streams. 0 keeps FIFO for HTTP/2 and QUICHE's 16000
+  // for QUIC.
+  int write_quantum = 0;
+  // Pings each HTTP/2 proxy session after this long without reads and
+  // closes it if nothing arrives within the larger of
+  // `session_probe_timeout` and four PING round trips, see
+  // SpdySession::EnablePingProbe(). QUIC sessions ping this often while no
+  // retransmittable packet is in flight instead. Zero disables it.
+  base::TimeDelta session_probe_interval;
+  base::TimeDelta session_probe_timeout = base::Seconds(5);
+  // HPACK table the proxies may use for their headers, 0 keeps Chromium's
+  // 64 KB. Only set by `low_memory`.
+  int h2_header_table_size = 0;
+
+  // QUIC connection options sent to the proxy, which mostly concern how the
+  // proxy sends, and options only applied by this client. The congestion
+  // control and initial window options are added to both.
+  quic::QuicTagVector quic_connection_options;
+  quic::QuicTagVector quic_client_connection_options;
+  // QUIC receive windows of the proxy sessions and their tunnel streams.
+  // 0 keeps Chromium's 15 MB per session and 6 MB per stream.
+  int quic_session_window = 0;
+  int quic_stream_window = 0;
+  // Grows the receive windows while the proxy is limited by them, see
+  // QuicParams::auto_tune_flow_control_windows.
+  bool quic_window_autotune = false;
+  // Keeps QUIC proxy sessions and their tunnels across network changes by
+  // migrating them, to another network where the platform reports them or
+  // to a new port when the path degrades, see QuicSessionPool.
+  bool quic_migration = true;
+  // Moves each QUIC proxy session to a new local port every interval,
+  // unless zero, and to a random server port from quic_hop_port_min to
+  // quic_hop_port_max if set, see QuicSessionPool::HopPorts(). Needs
+  // quic_migration.
+  base::TimeDelta quic_port_hop_interval;
+  int quic_hop_port_min = 0;
+  int quic_hop_port_max = 0;
+  // Length of the packets QUIC proxy sessions start with, 0 keeps
+  // Chromium's 1250, and the target of path MTU discovery probing up from
+  // it after the handshake, 0 disables it.
+  int quic_max_packet_length = 0;
+  int quic_mtu = 0;
+  // Reports the ECN marks of received packets to the proxy, and marks sent
+  // packets where the congestion controller responds to them.
+  bool quic_ecn = false;
+  // Paces QUIC proxy sessions through the kernel, see
+  // QuicParams::use_tx_time.
+  bool quic_txtime = false;
+  // Shares one UDP socket among the QUIC sessions to each proxy address, see
+  // QuicParams::share_sockets.
+  bool quic_shared_socket = false;
+
+  // Measures the proxies with requests to this URL through them instead of
+  // listening, see RunBench(). The URL should serve a large body and accept
+  // large POST bodies.
+  GURL bench_url;
+  // The most sessions the throughput is measured through at once.
+  int bench_sessions = 4;
+
+  NaiveRelayConfig relay;
+
   NaiveConfig();
   NaiveConfig(const NaiveConfig&);
   ~NaiveConfig();
@@ -5,7 +5,9 @@
 
 #include "net/tools/naive/naive_connection.h"
 
+#include <algorithm>
 #include <cstring>
+#include <optional>
 #include <utility>
 
 #include "base/functional/bind.h"
@@ -13,46 +15,127 @@
 #include "base/logging.h"
 #include "base/rand_util.h"
 #include "base/strings/strcat.h"
-#include "base/task/single_thread_task_runner.h"
 #include "base/time/time.h"
+#include "base/trace_event/base_tracing.h"
 #include "build/build_config.h"
 #include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/load_flags.h"
 #include "net/base/net_errors.h"
 #include "net/base/privacy_mode.h"
 #include "net/base/url_util.h"
+#include "net/http/proxy_client_socket.h"
 #include "net/proxy_resolution/proxy_info.h"
 #include "net/socket/client_socket_handle.h"
 #include "net/socket/client_socket_pool_manager.h"
+#include "net/socket/socket_descriptor.h"
 #include "net/socket/stream_socket.h"
-#include "net/spdy/spdy_session.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/spdy/spdy_buffer.h"
 #include "net/tools/naive/http_proxy_server_socket.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_heavy_hitters.h"
+#include "net/tools/naive/naive_https_server_session.h"
+#include "net/tools/naive/naive_lag_monitor.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_negative_cache.h"
+#include "net/tools/naive/naive_network_adapter.h"
 #include "net/tools/naive/naive_padding_socket.h"
+#include "net/tools/naive/naive_relay_scheduler.h"
 #include "net/tools/naive/redirect_resolver.h"
 #include "net/tools/naive/socks5_server_socket.h"
+#include "net/tools/naive/socks5_udp_relay.h"
 #include "url/scheme_host_port.h"
 
 #if BUILDFLAG(IS_LINUX)
 #include <linux/netfilter_ipv4.h>
+#include <linux/sockios.h>
 #include <netinet/in.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "base/posix/eintr_wrapper.h"
 
-#include "net/base/ip_endpoint.h"
 #include "net/base/sockaddr_storage.h"
-#include "net/socket/tcp_client_socket.h"
+#include "net/tools/naive/naive_drain_watcher.h"
+#include "net/tools/naive/naive_quic_server.h"
+#include "net/tools/naive/naive_sniffer.h"
+#include "net/tools/naive/naive_sockmap.h"
+#include "net/tools/naive/naive_sockmap_relay.h"
+#include "net/tools/naive/naive_splice_relay.h"
+#include "net/tools/naive/naive_tcp_info.h"
+#include "net/tools/naive/naive_tun_tcp_flow.h"
+#include "net/tools/naive/naive_uring.h"
+#include "net/tools/naive/naive_uring_relay.h"
+#endif
+
+#if BUILDFLAG(IS_WIN)
+#include "net/tools/naive/naive_rio.h"
+#include "net/tools/naive/naive_rio_relay.h"
 #endif
 
 namespace net {
 
 namespace {
-constexpr int kBufferSize = 64 * 1024;
+// The control connection of a UDP association carries no payload.
+constexpr int kUdpControlBufferSize = 64;
+
+// Of the batch delay with NaiveRelayConfig::adapt_network, a fraction of the
+// tunnel RTT.
+constexpr int kBatchDelayRttFraction = 16;
+constexpr base::TimeDelta kMaxBatchDelay = base::Milliseconds(5);
+
+#if BUILDFLAG(IS_LINUX)
+// Of the tunnel data written at once by TryWritevServerData().
+constexpr int kMaxWritevRegions = 16;
+#endif
+
+// Errors of a tunnel failing with its session, or refused by one going
+// away, which leaves the pool so that a new tunnel gets a new session.
+bool IsDeadSessionError(int error) {
+  return error == ERR_HTTP2_PING_FAILED || error == ERR_QUIC_PROTOCOL_ERROR ||
+         error == ERR_CONNECTION_RESET || error == ERR_CONNECTION_CLOSED ||
+         // Tunnels past the last stream a GOAWAY accepted.
+         error == ERR_HTTP2_SERVER_REFUSED_STREAM ||
+         error == ERR_QUIC_GOAWAY_REQUEST_CAN_BE_RETRIED;
+}
+
+#if BUILDFLAG(IS_LINUX)
+// Returns the bytes queued in the kernel buffers of `transport` both ways.
+size_t GetQueuedBytes(TCPClientSocket* transport) {
+  int fd = transport->SocketDescriptorForTesting();
+  if (fd == kInvalidSocket)
+    return 0;
+  size_t queued = 0;
+  for (unsigned long request : {SIOCINQ, SIOCOUTQ}) {
+    int bytes = 0;
+    if (ioctl(fd, request, &bytes) == 0 && bytes > 0)
+      queued += bytes;
+  }
+  return queued;
+}
+#endif
 }  // namespace
 
+#if BUILDFLAG(IS_LINUX)
+NaiveDetachedRelay::NaiveDetachedRelay() = default;
+
+NaiveDetachedRelay::NaiveDetachedRelay(NaiveDetachedRelay&&) = default;
+
+NaiveDetachedRelay& NaiveDetachedRelay::operator=(NaiveDetachedRelay&&) =
+    default;
+
+NaiveDetachedRelay::~NaiveDetachedRelay() = default;
+#endif
+
 NaiveConnection::NaiveConnection(
     unsigned int id,
     ClientProtocol protocol,
     std::unique_ptr<PaddingDetectorDelegate> padding_detector_delegate,
     const ProxyInfo& proxy_info,
+    const NaiveRelayConfig& relay_config,
     RedirectResolver* resolver,
     HttpNetworkSession* session,
     const NetworkAnonymizationKey& network_anonymization_key,
@@ -62,31 +145,106 @@ NaiveConnection::NaiveConnection(
     : id_(id),
       protocol_(protocol),
       padding_detector_delegate_(std::move(padding_detector_delegate)),
-      proxy_info_(proxy_info),
+      proxy_info_(&proxy_info),
+      relay_config_(relay_config),
       resolver_(resolver),
       session_(session),
-      network_anonymization_key_(network_anonymization_key),
+      network_anonymization_key_(&network_anonymization_key),
       net_log_(net_log),
       next_state_(STATE_NONE),
       client_socket_(std::move(accepted_socket)),
-      server_socket_handle_(std::make_unique<ClientSocketHandle>()),
-      sockets_{nullptr, nullptr},
+      priority_(MAXIMUM_PRIORITY),
+      server_proxy_socket_(nullptr),
+      buffer_pool_(NaiveBufferPool::GetForCurrentThread()),
+      metrics_(NaiveMetrics::GetForCurrentThread()),
+      read_stats_(
+          NaiveShardedStats<NaiveRelayReadStats>::GetForCurrentThread()),
+      read_sizes_{relay_config.buffer_min_size, relay_config.buffer_min_size},
+      full_reads_{0, 0},
       errors_{OK, OK},
       write_pending_{false, false},
+      read_closed_{false, false},
+      batched_bytes_{0, 0},
+      bytes_relayed_{0, 0},
+      batch_read_pending_{false, false},
+      deferred_pull_errors_{OK, OK},
       early_pull_pending_(false),
       can_push_to_server_(false),
       early_pull_result_(ERR_IO_PENDING),
       full_duplex_(false),
+      running_(false),
+      idle_check_bytes_(0),
       time_func_(&base::TimeTicks::Now),
       traffic_annotation_(traffic_annotation) {
   io_callback_ = base::BindRepeating(&NaiveConnection::OnIOComplete,
                                      weak_ptr_factory_.GetWeakPtr());
+  for (Direction from : {kClient, kServer}) {
+    Direction to = from == kClient ? kServer : kClient;
+    auto weak_this = weak_ptr_factory_.GetWeakPtr();
+    RelayCallbacks& callbacks = relay_callbacks_[from];
+    callbacks.pull_complete = base::BindRepeating(
+        &NaiveConnection::OnPullComplete, weak_this, from, to);
+    callbacks.pull_ready = base::BindRepeating(&NaiveConnection::OnPullReady,
+                                               weak_this, from, to);
+    callbacks.push_complete = base::BindRepeating(
+        &NaiveConnection::OnPushComplete, weak_this, from, to);
+    callbacks.batch_read_ready = base::BindRepeating(
+        &NaiveConnection::OnBatchReadReady, weak_this, from, to);
+    callbacks.pull =
+        base::BindRepeating(&NaiveConnection::Pull, weak_this, from, to);
+    callbacks.start_pull =
+        base::BindRepeating(&NaiveConnection::StartPull, weak_this, from, to);
+    callbacks.yield_or_pull = base::BindRepeating(
+        &NaiveConnection::YieldOrPull, weak_this, from, to);
+    // Unretained is safe because the batch timers are owned by this.
+    callbacks.finish_batch = base::BindRepeating(
+        &NaiveConnection::FinishBatch, base::Unretained(this), from, to);
+  }
+  push_spdy_buffer_callback_ =
+      base::BindRepeating(&NaiveConnection::OnPushSpdyBufferComplete,
+                          weak_ptr_factory_.GetWeakPtr());
 }
 
+NaiveConnection::RelayCallbacks::RelayCallbacks() = default;
+
+NaiveConnection::RelayCallbacks::~RelayCallbacks() = default;
+
 NaiveConnection::~NaiveConnection() {
   Disconnect();
 }
 
+const ProxyChain& NaiveConnection::proxy_chain() const {
+  return proxy_info_->proxy_chain();
+}
+
+const char* NaiveConnection::GetPhaseName() const {
+  if (running_) {
+    if (udp_relay_)
+      return "udp";
+#if BUILDFLAG(IS_LINUX)
+    if (sockmap_relay_ || splice_relay_ || uring_relay_)
+      return "spliced";
+#endif
+#if BUILDFLAG(IS_WIN)
+    if (rio_relay_)
+      return "spliced";
+#endif
+    return "relay";
+  }
+  switch (next_state_) {
+    case STATE_CONNECT_CLIENT:
+    case STATE_CONNECT_CLIENT_COMPLETE:
+    case STATE_SNIFF_COMPLETE:
+      return "handshake";
+    case STATE_CONNECT_SERVER:
+    case STATE_CONNECT_SERVER_COMPLETE:
+      return "connect";
+    case STATE_NONE:
+      return "connected";
+  }
+  NOTREACHED();
+}
+
 int NaiveConnection::Connect(CompletionOnceCallback callback) {
   DCHECK(client_socket_);
   DCHECK_EQ(next_state_, STATE_NONE);
@@ -96,6 +254,7 @@ int NaiveConnection::Connect(CompletionOnceCallback callback) {
     return OK;
 
   next_state_ = STATE_CONNECT_CLIENT;
+  connect_start_time_ = time_func_();
 
   int rv = DoLoop(OK);
   if (rv == ERR_IO_PENDING) {
@@ -106,9 +265,39 @@ int NaiveConnection::Connect(CompletionOnceCallback callback) {
 
 void NaiveConnection::Disconnect() {
   full_duplex_ = false;
+  if (relay_counted_) {
+    NaiveRelayScheduler::GetForCurrentThread()->RemoveRelay();
+    relay_counted_ = false;
+  }
+#if BUILDFLAG(IS_LINUX)
+  const bool direct_relay = sockmap_relay_ || splice_relay_ || uring_relay_;
+#elif BUILDFLAG(IS_WIN)
+  const bool direct_relay = rio_relay_ != nullptr;
+#endif
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+  // Stops watching the descriptors before they are closed.
+  if (direct_relay) {
+    for (Direction d : {kClient, kServer}) {
+      int64_t bytes = GetDirectRelayBytes(d);
+      metrics_->bytes_relayed[d] += bytes;
+      if (user_bytes_relayed_)
+        user_bytes_relayed_[d] += bytes;
+    }
+#if BUILDFLAG(IS_LINUX)
+    sockmap_relay_.reset();
+    splice_relay_.reset();
+    uring_relay_.reset();
+#else
+    rio_relay_.reset();
+#endif
+  }
+#endif
+  udp_relay_.reset();
   // Closes server side first because latency is higher.
-  if (server_socket_handle_->socket())
-    server_socket_handle_->socket()->Disconnect();
+  if (bond_socket_)
+    bond_socket_->Disconnect();
+  if (server_socket_handle_.socket())
+    server_socket_handle_.socket()->Disconnect();
   client_socket_->Disconnect();
 
   next_state_ = STATE_NONE;
@@ -147,6 +336,11 @@ int NaiveConnection::DoLoop(int last_io_result) {
       case STATE_CONNECT_CLIENT_COMPLETE:
         rv = DoConnectClientComplete(rv);
         break;
+#if BUILDFLAG(IS_LINUX)
+      case STATE_SNIFF_COMPLETE:
+        rv = DoSniffComplete(rv);
+        break;
+#endif
       case STATE_CONNECT_SERVER:
         DCHECK_EQ(rv, OK);
         rv = DoConnectServer();
@@ -170,21 +364,130 @@ int NaiveConnection::DoConnectClient() {
 }
 
 int NaiveConnection::DoConnectClientComplete(int result) {
-  if (result < 0)
+  if (result < 0) {
+    ++metrics_->connect_errors;
     return result;
+  }
+  connect_client_duration_ = time_func_() - connect_start_time_;
+  metrics_->client_handshake_latency.Add(connect_client_duration_);
+
+  if (protocol_ == ClientProtocol::kSocks5) {
+    user_ = static_cast<const Socks5ServerSocket*>(client_socket_.get())
+                ->authenticated_user();
+    if (user_) {
+      user_bytes_relayed_ =
+          NaiveUserMeter::GetForCurrentThread()->GetCounters(user_.get());
+    }
+  }
+
+  // A UDP association has no upstream connection of its own. Run() relays
+  // its datagrams while the client connection stays open.
+  if (IsUdpAssociate()) {
+    next_state_ = STATE_NONE;
+    return OK;
+  }
+
+  int rv = GetOrigin();
+  if (rv != OK)
+    return rv;
+#if BUILDFLAG(IS_LINUX)
+  if (sniffer_) {
+    next_state_ = STATE_SNIFF_COMPLETE;
+    // Unretained is safe because the sniffer is owned by this.
+    sniffer_->Start(base::BindOnce(&NaiveConnection::OnSniffed,
+                                   base::Unretained(this)));
+    return ERR_IO_PENDING;
+  }
+#endif
+  return PrepareConnectServer();
+}
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveConnection::OnSniffed(std::string host) {
+  sniffed_host_ = std::move(host);
+  OnIOComplete(OK);
+}
+
+int NaiveConnection::DoSniffComplete(int result) {
+  DCHECK_EQ(result, OK);
+  sniffer_.reset();
+  if (!sniffed_host_.empty()) {
+    LOG(INFO) << "Connection " << id_ << " to " << origin_.host()
+              << " sniffed as " << sniffed_host_;
+    origin_.set_host(sniffed_host_);
+  } else if (sniff_required_) {
+    LOG(ERROR) << "Connection " << id_ << " to unresolved name for "
+               << origin_.host();
+    return ERR_ADDRESS_INVALID;
+  }
+  return PrepareConnectServer();
+}
+#endif
+
+int NaiveConnection::PrepareConnectServer() {
+  if (relay_config_.negative_cache_ttl.is_positive()) {
+    int rv = NaiveNegativeCache::GetForCurrentThread()->Lookup(origin_,
+                                                               time_func_());
+    if (rv != OK) {
+      LOG(INFO) << "Connection " << id_ << " to " << origin_.ToString()
+                << " failed from the negative cache: "
+                << ErrorToShortString(rv);
+#if BUILDFLAG(IS_LINUX)
+      if (relay_config_.reset_on_connect_failure)
+        ResetClient();
+#endif
+      return rv;
+    }
+  }
+  if (admit_callback_) {
+    if (!admit_callback_.Run(origin_)) {
+      LOG(INFO) << "Connection " << id_ << " to " << origin_.ToString()
+                << " refused at the destination limit";
+      return ERR_INSUFFICIENT_RESOURCES;
+    }
+    admitted_ = true;
+  }
+  // Before the upstream decides the early pull and splicing below.
+  if (route_callback_) {
+    if (const ProxyInfo* proxy_info = route_callback_.Run(origin_)) {
+      proxy_info_ = proxy_info;
+      padding_detector_delegate_->SetProxyChain(proxy_info->proxy_chain());
+    }
+  }
+  // Ahead of the tunnel session, as bulk priorities get sessions apart.
+  priority_ = relay_config_.priority;
+  for (const NaivePriorityRule& rule : relay_config_.priority_rules) {
+    if (!rule.listen && rule.Matches(origin_.port())) {
+      priority_ = rule.priority;
+      break;
+    }
+  }
+  if (session_callback_ && !proxy_info_->is_direct()) {
+    network_anonymization_key_ = &session_callback_.Run(
+        origin_, priority_, *network_anonymization_key_);
+  }
 
   std::optional<PaddingType> client_padding_type =
       padding_detector_delegate_->GetClientPaddingType();
   CHECK(client_padding_type.has_value());
 
-  sockets_[kClient] = std::make_unique<NaivePaddingSocket>(
-      client_socket_.get(), *client_padding_type, kClient);
+  sockets_[kClient].emplace(
+      client_socket_.get(), *client_padding_type,
+      relay_config_.padding_profile.value_or(PaddingProfile::kUniform),
+      kClient);
+  if (protocol_ == ClientProtocol::kBond)
+    bond_sides_[kClient] = static_cast<NaiveBondSocket*>(client_socket_.get());
+  client_bypass_pending_ = true;
+  BypassClientHandshakeSocket();
 
   // For proxy client sockets, padding support detection is finished after the
   // first server response which means there will be one missed early pull. For
   // proxy server sockets (HttpProxyServerSocket), padding support detection is
   // done during client connect, so there shouldn't be any missed early pull.
-  if (!padding_detector_delegate_->GetServerPaddingType().has_value()) {
+  // The splice relay reads the client socket itself, so there is no early
+  // pull, which would also gain nothing without a tunnel handshake.
+  if (!padding_detector_delegate_->GetServerPaddingType().has_value() ||
+      CanSplice()) {
     early_pull_pending_ = false;
     early_pull_result_ = 0;
     next_state_ = STATE_CONNECT_SERVER;
@@ -204,18 +507,34 @@ int NaiveConnection::DoConnectClientComplete(int result) {
   return OK;
 }
 
-int NaiveConnection::DoConnectServer() {
-  next_state_ = STATE_CONNECT_SERVER_COMPLETE;
-
-  HostPortPair origin;
+int NaiveConnection::GetOrigin() {
+  // ClientProtocol::kEmbedded and kTun keep the origin set by set_origin().
   if (protocol_ == ClientProtocol::kSocks5) {
     const auto* socket =
         static_cast<const Socks5ServerSocket*>(client_socket_.get());
-    origin = socket->request_endpoint();
+    origin_ = socket->request_endpoint();
   } else if (protocol_ == ClientProtocol::kHttp) {
     const auto* socket =
         static_cast<const HttpProxyServerSocket*>(client_socket_.get());
-    origin = socket->request_endpoint();
+    origin_ = socket->request_endpoint();
+  } else if (protocol_ == ClientProtocol::kHttps) {
+    if (client_socket_->GetNegotiatedProtocol() == kProtoHTTP2) {
+      origin_ =
+          static_cast<const NaiveHttp2ServerStream*>(client_socket_.get())
+              ->request_endpoint();
+    } else {
+      origin_ =
+          static_cast<const HttpProxyServerSocket*>(client_socket_.get())
+              ->request_endpoint();
+    }
+  } else if (protocol_ == ClientProtocol::kQuic) {
+#if BUILDFLAG(IS_LINUX)
+    origin_ = static_cast<const NaiveQuicServerStream*>(client_socket_.get())
+                  ->request_endpoint();
+#endif
+  } else if (protocol_ == ClientProtocol::kBond) {
+    origin_ = static_cast<const NaiveBondSocket*>(client_socket_.get())
+                  ->request_endpoint();
   } else if (protocol_ == ClientProtocol::kRedir) {
 #if BUILDFLAG(IS_LINUX)
     const auto* socket =
@@ -242,9 +561,14 @@ int NaiveConnection::DoConnectServer() {
         const auto& addr = ipe.address();
         auto name = resolver_->FindNameByAddress(addr);
         if (!name.empty()) {
-          origin = HostPortPair(name, ipe.port());
+          origin_ = HostPortPair(name, ipe.port());
+        } else if (relay_config_.redir_sniff) {
+          // The address stands in for the name until it is sniffed.
+          origin_ = HostPortPair::FromIPEndPoint(ipe);
+          sniff_required_ = resolver_->IsInResolvedRange(addr);
+          sniffer_ = std::make_unique<NaiveSniffer>(sd);
         } else if (!resolver_->IsInResolvedRange(addr)) {
-          origin = HostPortPair::FromIPEndPoint(ipe);
+          origin_ = HostPortPair::FromIPEndPoint(ipe);
         } else {
           LOG(ERROR) << "Connection " << id_ << " to unresolved name for "
                      << addr.ToString();
@@ -260,37 +584,165 @@ int NaiveConnection::DoConnectServer() {
 #endif
   }
 
+  return OK;
+}
+
+int NaiveConnection::DoConnectServer() {
+  TRACE_EVENT("net", "NaiveConnection::DoConnectServer", "id", id_);
+  next_state_ = STATE_CONNECT_SERVER_COMPLETE;
+  // A retry counts toward the first attempt.
+  if (!connect_retried_)
+    connect_server_start_time_ = time_func_();
+
   url::CanonHostInfo host_info;
   url::SchemeHostPort endpoint(
-      "http", CanonicalizeHost(origin.HostForURL(), &host_info), origin.port(),
-      url::SchemeHostPort::ALREADY_CANONICALIZED);
+      "http", CanonicalizeHost(origin_.HostForURL(), &host_info),
+      origin_.port(), url::SchemeHostPort::ALREADY_CANONICALIZED);
   if (!endpoint.IsValid()) {
     LOG(ERROR) << "Connection " << id_ << " to invalid origin "
-               << origin.ToString();
+               << origin_.ToString();
     return ERR_ADDRESS_INVALID;
   }
 
-  LOG(INFO) << "Connection " << id_ << " to " << origin.ToString();
+  IPEndPoint client_endpoint;
+  if (relay_config_.proxy_protocol &&
+      client_socket_->GetPeerAddress(&client_endpoint) == OK) {
+    // Behind a load balancer, the client is known by its PROXY protocol
+    // header only.
+    LOG(INFO) << "Connection " << id_ << " from "
+              << client_endpoint.ToString() << " to " << origin_.ToString();
+  } else {
+    LOG(INFO) << "Connection " << id_ << " to " << origin_.ToString();
+  }
+  if (!connect_retried_) {
+    NaiveHeavyHitters::GetForCurrentThread()->AddConnect(
+        origin_, connect_server_start_time_);
+  }
+
+  // Members are tunnels of the proxy, which joins them.
+  if (bond_network_anonymization_keys_ && !proxy_info_->is_direct() &&
+      !proxy_info_->proxy_chain().First().is_socks()) {
+    int count = std::min(relay_config_.bond_members,
+                         padding_detector_delegate_->GetServerBondMembers());
+    if (count > 1)
+      return DoConnectBond(count);
+  }
 
   // Ignores socket limit set by socket pool for this type of socket.
   return InitSocketHandleForHttpRequest(
       std::move(endpoint), LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_,
-      proxy_info_, {}, PRIVACY_MODE_DISABLED,
-      network_anonymization_key_, SecureDnsPolicy::kDisable, SocketTag(),
-      net_log_, server_socket_handle_.get(), io_callback_,
+      *proxy_info_, {}, PRIVACY_MODE_DISABLED,
+      *network_anonymization_key_, SecureDnsPolicy::kDisable, SocketTag(),
+      net_log_, &server_socket_handle_, io_callback_,
       ClientSocketPool::ProxyAuthCallback());
 }
 
+int NaiveConnection::DoConnectBond(int count) {
+  DCHECK_LE(static_cast<size_t>(count - 1),
+            bond_network_anonymization_keys_->size());
+  bond_pending_ = count;
+  bond_result_ = OK;
+  for (int i = 0; i < count; ++i) {
+    // Each on its own tunnel session, the first on that of the connection.
+    const NetworkAnonymizationKey& nak =
+        i == 0 ? *network_anonymization_key_
+               : (*bond_network_anonymization_keys_)[i - 1];
+    auto& handle =
+        bond_handles_.emplace_back(std::make_unique<ClientSocketHandle>());
+    int rv = InitSocketHandleForHttpRequest(
+        url::SchemeHostPort("http", kBondHost, kBondPort,
+                            url::SchemeHostPort::ALREADY_CANONICALIZED),
+        LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_, *proxy_info_, {},
+        PRIVACY_MODE_DISABLED, nak, SecureDnsPolicy::kDisable, SocketTag(),
+        net_log_, handle.get(),
+        base::BindOnce(&NaiveConnection::OnBondMemberComplete,
+                       weak_ptr_factory_.GetWeakPtr()),
+        ClientSocketPool::ProxyAuthCallback());
+    if (rv == ERR_IO_PENDING)
+      continue;
+    --bond_pending_;
+    if (rv < 0 && bond_result_ == OK)
+      bond_result_ = rv;
+  }
+  return bond_pending_ > 0 ? ERR_IO_PENDING : bond_result_;
+}
+
+void NaiveConnection::OnBondMemberComplete(int result) {
+  if (result < 0 && bond_result_ == OK)
+    bond_result_ = result;
+  if (--bond_pending_ == 0)
+    OnIOComplete(bond_result_);
+}
+
 int NaiveConnection::DoConnectServerComplete(int result) {
-  if (result < 0)
+  if (result < 0 && !connect_retried_ && IsDeadSessionError(result) &&
+      !proxy_info_->is_direct()) {
+    LOG(INFO) << "Connection " << id_ << " retries its tunnel after "
+              << ErrorToShortString(result);
+    connect_retried_ = true;
+    server_socket_handle_.Reset();
+    bond_handles_.clear();
+    next_state_ = STATE_CONNECT_SERVER;
+    return OK;
+  }
+  connect_server_duration_ = time_func_() - connect_server_start_time_;
+  if (relay_config_.negative_cache_ttl.is_positive()) {
+    NaiveNegativeCache::GetForCurrentThread()->Report(
+        origin_, result, time_func_(), relay_config_.negative_cache_ttl);
+  }
+  if (result < 0) {
+    ++metrics_->connect_errors;
+#if BUILDFLAG(IS_LINUX)
+    if (relay_config_.reset_on_connect_failure)
+      ResetClient();
+#endif
     return result;
+  }
 
   std::optional<PaddingType> server_padding_type =
       padding_detector_delegate_->GetServerPaddingType();
   CHECK(server_padding_type.has_value());
+  metrics_->server_connect_latency.Add(connect_server_duration_);
 
-  sockets_[kServer] = std::make_unique<NaivePaddingSocket>(
-      server_socket_handle_->socket(), *server_padding_type, kServer);
+  if (!bond_handles_.empty()) {
+    for (const auto& handle : bond_handles_) {
+      static_cast<ProxyClientSocket*>(handle->socket())
+          ->SetStreamPriority(priority_);
+    }
+    LOG(INFO) << "Connection " << id_ << " bonded over "
+              << bond_handles_.size() << " tunnels";
+    bond_socket_ = std::make_unique<NaiveBondSocket>(
+        std::move(bond_handles_), origin_,
+        base::RandBytesAsString(NaiveBondSocket::kBondIdSize),
+        traffic_annotation_);
+    bond_handles_.clear();
+    int rv = bond_socket_->Connect(base::DoNothing());
+    if (rv != OK)
+      return rv;
+    bond_sides_[kServer] = bond_socket_.get();
+    sockets_[kServer].emplace(
+        bond_socket_.get(), *server_padding_type,
+        relay_config_.padding_profile.value_or(PaddingProfile::kUniform),
+        kServer);
+    full_duplex_ = true;
+    next_state_ = STATE_NONE;
+    return OK;
+  }
+
+  sockets_[kServer].emplace(
+      server_socket_handle_.socket(), *server_padding_type,
+      relay_config_.padding_profile.value_or(PaddingProfile::kUniform),
+      kServer);
+  // Tunnels through single HTTP(S) and QUIC proxies are proxy client
+  // sockets. Only HTTP/2 ones hand over their buffers.
+  if (!proxy_info_->is_direct() &&
+      !proxy_info_->proxy_chain().First().is_socks()) {
+    server_proxy_socket_ =
+        static_cast<ProxyClientSocket*>(server_socket_handle_.socket());
+    // The socket pool requires MAXIMUM_PRIORITY for requests ignoring its
+    // limits, so the tunnel stream is reprioritized once connected.
+    server_proxy_socket_->SetStreamPriority(priority_);
+  }
 
   full_duplex_ = true;
   next_state_ = STATE_NONE;
@@ -298,13 +750,21 @@ int NaiveConnection::DoConnectServerComplete(int result) {
 }
 
 int NaiveConnection::Run(CompletionOnceCallback callback) {
-  DCHECK(sockets_[kServer]);
   DCHECK_EQ(next_state_, STATE_NONE);
   DCHECK(!connect_callback_);
 
+  running_ = true;
+  if (IsUdpAssociate()) {
+    int rv = RunUdpAssociate();
+    if (rv == ERR_IO_PENDING)
+      run_callback_ = std::move(callback);
+    return rv;
+  }
+  DCHECK(sockets_[kServer]);
+
   // The client-side socket may be closed before the server-side
   // socket is connected.
-  if (errors_[kClient] != OK || sockets_[kClient] == nullptr)
+  if (errors_[kClient] != OK || !sockets_[kClient])
     return errors_[kClient];
   if (errors_[kServer] != OK)
     return errors_[kServer];
@@ -314,10 +774,47 @@ int NaiveConnection::Run(CompletionOnceCallback callback) {
   bytes_passed_without_yielding_[kClient] = 0;
   bytes_passed_without_yielding_[kServer] = 0;
 
-  yield_after_time_[kClient] =
-      time_func_() + base::Milliseconds(kYieldAfterDurationMilliseconds);
+  NaiveRelayScheduler::GetForCurrentThread()->AddRelay();
+  relay_counted_ = true;
+  yield_after_time_[kClient] = time_func_() + GetYieldInterval();
   yield_after_time_[kServer] = yield_after_time_[kClient];
 
+#if BUILDFLAG(IS_LINUX)
+  if (CanSplice()) {
+    int rv = RunSplice();
+    if (rv == ERR_IO_PENDING)
+      return rv;
+    // Falls back to the userspace relay if the pipes cannot be created, or
+    // io_uring or the sockmap is not available.
+  }
+  if (relay_config_.notsent_lowat > 0)
+    WatchDrains();
+  // The relay writes its pooled buffers alone to direct:// server sockets,
+  // which leave the pool only once the kernel is done with them.
+  if (relay_config_.zerocopy_threshold > 0 && proxy_info_->is_direct()) {
+    int rv = static_cast<TCPClientSocket*>(server_socket_handle_.socket())
+                 ->EnableZeroCopy(relay_config_.zerocopy_threshold);
+    if (rv != OK) {
+      VLOG(1) << "Connection " << id_
+              << " cannot send zero-copy: " << ErrorToShortString(rv);
+    }
+  }
+#endif
+#if BUILDFLAG(IS_WIN)
+  if (CanSplice()) {
+    int rv = RunRio();
+    if (rv == ERR_IO_PENDING)
+      return rv;
+    // Falls back to the userspace relay if Registered I/O is not available
+    // for the sockets.
+  }
+#endif
+
+  if (IsRateLimited()) {
+    rate_flows_[kClient].emplace(rate_limits_, kClient);
+    rate_flows_[kServer].emplace(rate_limits_, kServer);
+  }
+
   can_push_to_server_ = true;
   // early_pull_result_ == 0 means the early pull was not started because
   // padding support was not yet known.
@@ -325,25 +822,506 @@ int NaiveConnection::Run(CompletionOnceCallback callback) {
     Pull(kClient, kServer);
   } else if (!early_pull_pending_) {
     DCHECK_GT(early_pull_result_, 0);
-    Push(kClient, kServer, early_pull_result_);
+    if (rate_flows_[kClient])
+      rate_flows_[kClient]->Charge(early_pull_result_);
+    Relay(kClient, kServer, early_pull_result_);
   }
   Pull(kServer, kClient);
 
   return ERR_IO_PENDING;
 }
 
+std::unique_ptr<StreamSocket> NaiveConnection::ReleaseKeptAliveClient(
+    std::optional<IPEndPoint>* proxied_source) {
+  if (protocol_ != ClientProtocol::kHttp &&
+      (protocol_ != ClientProtocol::kHttps ||
+       client_socket_->GetNegotiatedProtocol() == kProtoHTTP2)) {
+    return nullptr;
+  }
+  auto* socket = static_cast<HttpProxyServerSocket*>(client_socket_.get());
+  *proxied_source = socket->proxied_source();
+  return socket->ReleaseKeptAliveTransport();
+}
+
+#if BUILDFLAG(IS_LINUX)
+bool NaiveConnection::CanDetachRelay() const {
+  if (!running_ || udp_relay_ || sockmap_relay_ || splice_relay_ ||
+      uring_relay_ || bond_socket_ || !proxy_info_->is_direct() ||
+      IsRateLimited() || relay_config_.zerocopy_threshold > 0) {
+    return false;
+  }
+  // The client transports of kSocks5 and kHttp are handed to the padding
+  // socket once their handshake socket holds nothing more, see
+  // BypassClientHandshakeSocket().
+  if ((protocol_ != ClientProtocol::kSocks5 &&
+       protocol_ != ClientProtocol::kHttp) ||
+      client_bypass_pending_) {
+    return false;
+  }
+  if (protocol_ == ClientProtocol::kHttp &&
+      static_cast<const HttpProxyServerSocket*>(client_socket_.get())
+          ->is_keep_alive_request()) {
+    return false;
+  }
+  for (Direction side : {kClient, kServer}) {
+    if (!sockets_[side] || sockets_[side]->padding_type() != PaddingType::kNone)
+      return false;
+    if (errors_[side] != OK || read_closed_[side] || write_pending_[side] ||
+        queued_bytes_[side] > 0 || batched_bytes_[side] > 0 ||
+        batch_read_pending_[side] || deferred_pull_errors_[side] != OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<NaiveDetachedRelay> NaiveConnection::DetachRelay() {
+  DCHECK(CanDetachRelay());
+  TCPClientSocket* transports[kNumDirections] = {
+      GetClientTransport(),
+      static_cast<TCPClientSocket*>(server_socket_handle_.socket())};
+  NaiveDetachedRelay relay;
+  for (Direction side : {kClient, kServer}) {
+    // TCPClientSocket cannot release its own descriptor.
+    relay.fds[side].reset(HANDLE_EINTR(
+        dup(transports[side]->SocketDescriptorForTesting())));
+    if (!relay.fds[side].is_valid()) {
+      PLOG(ERROR) << "Connection " << id_ << " cannot duplicate its socket";
+      return std::nullopt;
+    }
+    transports[side]->GetPeerAddress(&relay.peer_addresses[side]);
+    relay.first_byte_time[side] = first_byte_time_[side];
+    relay.bytes_relayed[side] = bytes_relayed_[side];
+  }
+  relay.origin = origin_;
+  relay.user = user_;
+  relay.connect_start_time = connect_start_time_;
+  // Stops watching the sockets before any pending read takes their bytes.
+  Disconnect();
+  return relay;
+}
+
+void NaiveConnection::AttachRelay(std::unique_ptr<StreamSocket> server_socket,
+                                  NaiveDetachedRelay relay) {
+  DCHECK_EQ(next_state_, STATE_NONE);
+  DCHECK(!full_duplex_);
+  origin_ = relay.origin;
+  user_ = std::move(relay.user);
+  if (user_) {
+    user_bytes_relayed_ =
+        NaiveUserMeter::GetForCurrentThread()->GetCounters(user_.get());
+  }
+  connect_start_time_ = relay.connect_start_time;
+  for (Direction side : {kClient, kServer}) {
+    first_byte_time_[side] = relay.first_byte_time[side];
+    bytes_relayed_[side] = relay.bytes_relayed[side];
+  }
+  idle_check_bytes_ = bytes_relayed_[kClient] + bytes_relayed_[kServer];
+
+  server_socket_handle_.SetSocket(std::move(server_socket));
+  PaddingProfile profile =
+      relay_config_.padding_profile.value_or(PaddingProfile::kUniform);
+  sockets_[kClient].emplace(client_socket_.get(), PaddingType::kNone, profile,
+                            kClient);
+  sockets_[kClient]->set_transport_socket(
+      static_cast<TCPClientSocket*>(client_socket_.get()));
+  sockets_[kServer].emplace(server_socket_handle_.socket(), PaddingType::kNone,
+                            profile, kServer);
+  // Nothing was read ahead for the server.
+  early_pull_pending_ = false;
+  early_pull_result_ = 0;
+  full_duplex_ = true;
+}
+#endif
+
+bool NaiveConnection::IsUdpAssociate() const {
+  return protocol_ == ClientProtocol::kSocks5 &&
+         static_cast<const Socks5ServerSocket*>(client_socket_.get())
+             ->is_udp_associate();
+}
+
+int NaiveConnection::RunUdpAssociate() {
+  auto* socket = static_cast<Socks5ServerSocket*>(client_socket_.get());
+  IPEndPoint client_endpoint;
+  int rv = socket->GetPeerAddress(&client_endpoint);
+  if (rv != OK)
+    return rv;
+
+  LOG(INFO) << "Connection " << id_ << " associates UDP for "
+            << client_endpoint.ToString();
+
+  udp_relay_ = std::make_unique<Socks5UdpRelay>(
+      socket->TakeUdpSocket(), client_endpoint.address(),
+      proxy_info_->proxy_chain(), session_, *network_anonymization_key_,
+      relay_config_.udp_idle_timeout, net_log_, traffic_annotation_);
+  udp_relay_->Start(base::BindOnce(&NaiveConnection::OnUdpRelayError,
+                                   weak_ptr_factory_.GetWeakPtr()));
+
+  udp_control_buffer_ =
+      base::MakeRefCounted<IOBufferWithSize>(kUdpControlBufferSize);
+  return ReadUdpControl();
+}
+
+int NaiveConnection::ReadUdpControl() {
+  for (;;) {
+    int rv = client_socket_->Read(
+        udp_control_buffer_.get(), kUdpControlBufferSize,
+        base::BindOnce(&NaiveConnection::OnUdpControlRead,
+                       weak_ptr_factory_.GetWeakPtr()));
+    if (rv == ERR_IO_PENDING)
+      return rv;
+    // The association ends when the client closes the connection.
+    if (rv <= 0)
+      return rv == 0 ? ERR_CONNECTION_CLOSED : rv;
+  }
+}
+
+void NaiveConnection::OnUdpControlRead(int result) {
+  if (result > 0)
+    result = ReadUdpControl();
+  else if (result == 0)
+    result = ERR_CONNECTION_CLOSED;
+  if (result == ERR_IO_PENDING)
+    return;
+  std::move(run_callback_).Run(result);
+}
+
+void NaiveConnection::OnUdpRelayError(int result) {
+  if (run_callback_)
+    std::move(run_callback_).Run(result);
+}
+
+bool NaiveConnection::CanSplice() const {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+  // The client side of https:// is TLS, that of quic:// a QUIC stream, and
+  // that of tun:// a userspace TCP stack.
+  if (!(relay_config_.splice || relay_config_.io_uring ||
+        relay_config_.sockmap || relay_config_.rio) ||
+      !proxy_info_->is_direct() ||
+      protocol_ == ClientProtocol::kHttps ||
+      protocol_ == ClientProtocol::kQuic ||
+      protocol_ == ClientProtocol::kBond ||
+      protocol_ == ClientProtocol::kTun || IsRateLimited()) {
+    return false;
+  }
+  // Spliced bytes are only counted once the relay ends.
+  if (user_ && user_->has_hard_quota()) {
+    return false;
+  }
+  if (padding_detector_delegate_->GetClientPaddingType() !=
+          PaddingType::kNone ||
+      padding_detector_delegate_->GetServerPaddingType() !=
+          PaddingType::kNone) {
+    return false;
+  }
+  // Payload already read past the CONNECT header must go through Push().
+  // Requests kept alive are delimited by reading and writing through it.
+  if (protocol_ == ClientProtocol::kHttp) {
+    const auto* socket =
+        static_cast<const HttpProxyServerSocket*>(client_socket_.get());
+    if (socket->has_buffered_data() || socket->is_keep_alive_request())
+      return false;
+  }
+  // Likewise for payload read along with a pipelined SOCKS5 request.
+  if (protocol_ == ClientProtocol::kSocks5 &&
+      static_cast<const Socks5ServerSocket*>(client_socket_.get())
+          ->has_buffered_data()) {
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+TCPClientSocket* NaiveConnection::GetClientTransport() {
+  StreamSocket* client_transport = client_socket_.get();
+  if (protocol_ == ClientProtocol::kHttps) {
+    // Under TLS, and possibly shared by other HTTP/2 streams.
+    return nullptr;
+  } else if (protocol_ == ClientProtocol::kQuic) {
+    // A UDP socket shared by all QUIC connections.
+    return nullptr;
+  } else if (protocol_ == ClientProtocol::kBond) {
+    // Streams of several sessions.
+    return nullptr;
+  } else if (protocol_ == ClientProtocol::kTun) {
+    // Packets on a TUN device shared by all flows.
+    return nullptr;
+  } else if (protocol_ == ClientProtocol::kSocks5) {
+    client_transport = static_cast<Socks5ServerSocket*>(client_socket_.get())
+                           ->transport_socket();
+  } else if (protocol_ == ClientProtocol::kHttp) {
+    client_transport =
+        static_cast<HttpProxyServerSocket*>(client_socket_.get())
+            ->transport_socket();
+  }
+  return static_cast<TCPClientSocket*>(client_transport);
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveConnection::ResetClient() {
+  // The client has already been told that the connection succeeded, so it
+  // may be mid-handshake. A reset fails it immediately, where a clean close
+  // could look like the destination closing the connection.
+  if (protocol_ == ClientProtocol::kTun) {
+    static_cast<NaiveTunTcpSocket*>(client_socket_.get())
+        ->set_reset_on_disconnect();
+    return;
+  }
+  if (TCPClientSocket* client_transport = GetClientTransport())
+    ResetOnClose(client_transport);
+}
+
+void NaiveConnection::ResetOnClose(TCPClientSocket* transport) {
+  int fd = transport->SocketDescriptorForTesting();
+  if (fd == kInvalidSocket)
+    return;
+  struct linger linger = {.l_onoff = 1, .l_linger = 0};
+  if (setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger)) != 0)
+    PLOG(WARNING) << "Connection " << id_ << " cannot set SO_LINGER";
+}
+
+void NaiveConnection::MaybeResetOnError(int error) {
+  if (!relay_config_.reset_on_error || error == ERR_CONNECTION_CLOSED ||
+      reset_on_error_) {
+    return;
+  }
+  reset_on_error_ = true;
+  ResetClient();
+  // Proxy tunnels share the transport of their session.
+  if (proxy_info_->is_direct() && server_socket_handle_.socket()) {
+    ResetOnClose(
+        static_cast<TCPClientSocket*>(server_socket_handle_.socket()));
+  }
+}
+
+int NaiveConnection::RunSplice() {
+  // Direct connections to http:// endpoints are plain TCP on both sides.
+  int client_fd = GetClientTransport()->SocketDescriptorForTesting();
+  int server_fd = static_cast<TCPClientSocket*>(server_socket_handle_.socket())
+                      ->SocketDescriptorForTesting();
+
+  if (relay_config_.sockmap) {
+    if (NaiveSockmap* sockmap = NaiveSockmap::GetForCurrentThread()) {
+      sockmap_relay_ =
+          std::make_unique<NaiveSockmapRelay>(sockmap, client_fd, server_fd);
+      int rv = sockmap_relay_->Run(base::BindOnce(
+          &NaiveConnection::OnSpliceComplete, weak_ptr_factory_.GetWeakPtr()));
+      if (rv == ERR_IO_PENDING)
+        return rv;
+      VLOG(1) << "Connection " << id_
+              << " cannot relay in the kernel: " << ErrorToShortString(rv);
+      sockmap_relay_.reset();
+    }
+    if (!relay_config_.io_uring && !relay_config_.splice)
+      return ERR_NOT_IMPLEMENTED;
+  }
+
+  if (relay_config_.io_uring) {
+    if (NaiveUring* uring = NaiveUring::GetForCurrentThread()) {
+      uring_relay_ =
+          std::make_unique<NaiveUringRelay>(uring, client_fd, server_fd);
+      return uring_relay_->Run(base::BindOnce(
+          &NaiveConnection::OnSpliceComplete, weak_ptr_factory_.GetWeakPtr()));
+    }
+    if (!relay_config_.splice)
+      return ERR_NOT_IMPLEMENTED;
+  }
+
+  splice_relay_ = std::make_unique<NaiveSpliceRelay>(
+      client_fd, server_fd, relay_config_.yield_bytes,
+      relay_config_.half_close);
+  int rv = splice_relay_->Run(base::BindOnce(
+      &NaiveConnection::OnSpliceComplete, weak_ptr_factory_.GetWeakPtr()));
+  if (rv != ERR_IO_PENDING) {
+    LOG(WARNING) << "Connection " << id_
+                 << " cannot splice: " << ErrorToShortString(rv);
+    splice_relay_.reset();
+  }
+  return rv;
+}
+#endif
+
+#if BUILDFLAG(IS_WIN)
+int NaiveConnection::RunRio() {
+  NaiveRio* rio = NaiveRio::GetForCurrentThread();
+  if (!rio)
+    return ERR_NOT_IMPLEMENTED;
+  // Direct connections to http:// endpoints are plain TCP on both sides.
+  SOCKET client_socket = GetClientTransport()->SocketDescriptorForTesting();
+  SOCKET server_socket =
+      static_cast<TCPClientSocket*>(server_socket_handle_.socket())
+          ->SocketDescriptorForTesting();
+  rio_relay_ = std::make_unique<NaiveRioRelay>(rio, client_socket,
+                                               server_socket);
+  int rv = rio_relay_->Run(base::BindOnce(&NaiveConnection::OnSpliceComplete,
+                                          weak_ptr_factory_.GetWeakPtr()));
+  if (rv != ERR_IO_PENDING) {
+    VLOG(1) << "Connection " << id_
+            << " cannot relay with Registered I/O: " << ErrorToShortString(rv);
+    rio_relay_.reset();
+  }
+  return rv;
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+void NaiveConnection::OnSpliceComplete(int result) {
+  errors_[kClient] = result;
+  Disconnect(kServer);
+  Disconnect(kClient);
+  OnBothDisconnected();
+}
+
+int64_t NaiveConnection::GetDirectRelayBytes(Direction from) const {
+#if BUILDFLAG(IS_LINUX)
+  if (sockmap_relay_)
+    return sockmap_relay_->bytes_relayed(from);
+  if (splice_relay_)
+    return splice_relay_->bytes_relayed(from);
+  if (uring_relay_)
+    return uring_relay_->bytes_relayed(from);
+#else
+  if (rio_relay_)
+    return rio_relay_->bytes_relayed(from);
+#endif
+  return 0;
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveConnection::WatchDrains() {
+  if (TCPClientSocket* client_transport = GetClientTransport()) {
+    drain_watchers_[kClient] = std::make_unique<NaiveDrainWatcher>(
+        client_transport->SocketDescriptorForTesting(),
+        relay_config_.notsent_lowat);
+  }
+  // Proxy tunnels share their transport with other tunnels, which are held
+  // back by HTTP/2 and QUIC flow control instead.
+  if (proxy_info_->is_direct()) {
+    drain_watchers_[kServer] = std::make_unique<NaiveDrainWatcher>(
+        static_cast<TCPClientSocket*>(server_socket_handle_.socket())
+            ->SocketDescriptorForTesting(),
+        relay_config_.notsent_lowat);
+  }
+}
+#endif
+
+void NaiveConnection::BypassClientHandshakeSocket() {
+  StreamSocket* transport = nullptr;
+  if (protocol_ == ClientProtocol::kSocks5) {
+    const auto* socket =
+        static_cast<const Socks5ServerSocket*>(client_socket_.get());
+    if (socket->has_buffered_data())
+      return;
+    transport = socket->transport_socket();
+  } else if (protocol_ == ClientProtocol::kHttp ||
+             (protocol_ == ClientProtocol::kHttps &&
+              client_socket_->GetNegotiatedProtocol() != kProtoHTTP2)) {
+    const auto* socket =
+        static_cast<const HttpProxyServerSocket*>(client_socket_.get());
+    // Requests kept alive are delimited by the socket.
+    if (socket->is_keep_alive_request()) {
+      client_bypass_pending_ = false;
+      return;
+    }
+    if (socket->has_buffered_data())
+      return;
+    transport = socket->transport_socket();
+  }
+  client_bypass_pending_ = false;
+  if (!transport)
+    return;
+  // The SOCKS5 and HTTP listeners accept plain TCP connections, whose
+  // sockets the padding socket then calls without virtual dispatch.
+  if (protocol_ == ClientProtocol::kSocks5 ||
+      protocol_ == ClientProtocol::kHttp) {
+    sockets_[kClient]->set_transport_socket(
+        static_cast<TCPClientSocket*>(transport));
+  } else {
+    sockets_[kClient]->set_transport_socket(transport);
+  }
+}
+
+bool NaiveConnection::IsRateLimited() const {
+  return std::any_of(rate_limits_.begin(), rate_limits_.end(),
+                     [](const auto& limit) { return limit != nullptr; });
+}
+
 void NaiveConnection::Pull(Direction from, Direction to) {
-  if (errors_[kClient] < 0 || errors_[kServer] < 0)
+  if (rate_flows_[from] &&
+      !rate_flows_[from]->WaitForTokens(relay_callbacks_[from].start_pull)) {
+    return;
+  }
+  StartPull(from, to);
+}
+
+void NaiveConnection::StartPull(Direction from, Direction to) {
+  if (relay_config_.IsAdaptive())
+    pull_start_time_[from] = time_func_();
+
+  DoPull(from, to);
+}
+
+void NaiveConnection::DoPull(Direction from, Direction to) {
+  if (errors_[kClient] < 0 || errors_[kServer] < 0 || read_closed_[from])
     return;
+  TRACE_EVENT("net", "NaiveConnection::Pull", "id", id_, "from",
+              static_cast<int>(from));
 
-  int read_size = kBufferSize;
-  read_buffers_[from] = base::MakeRefCounted<IOBufferWithSize>(kBufferSize);
+  if (deferred_pull_errors_[from] != OK) {
+    int error = deferred_pull_errors_[from];
+    deferred_pull_errors_[from] = OK;
+    OnPullComplete(from, to, error);
+    return;
+  }
+
+  // Buffers handed over by the tunnel are written as they are, so not while
+  // pipelined writes to the client are pending.
+  if (from == kServer && !write_pending_[kClient]) {
+#if BUILDFLAG(IS_LINUX)
+    if (TryWritevServerData())
+      return;
+#endif
+    if (TryPullSpdyBuffer())
+      return;
+  }
+
+  read_buffers_[from] = buffer_pool_->Get(read_sizes_[from]);
+  // Leaves room for the receiving side to frame padding around the payload
+  // without copying it. Reads stay within the size asked for, which the
+  // size class of the buffer may exceed.
+  int read_size = read_buffers_[from]->size();
+  int capacity = read_buffers_[from]->capacity();
+  if (sockets_[to] && sockets_[to]->write_headroom() > 0) {
+    int headroom = sockets_[to]->write_headroom();
+    int tailroom = sockets_[to]->write_tailroom();
+    read_buffers_[from]->Reset(
+        headroom, std::min(read_size, capacity - headroom - tailroom));
+  } else if (to == kServer && CanWriteInPlace()) {
+    int headroom = server_proxy_socket_->GetWriteHeadroom();
+    read_buffers_[from]->Reset(headroom,
+                               std::min(read_size, capacity - headroom));
+  }
 
   DCHECK(sockets_[from]);
-  int rv = sockets_[from]->Read(
-      read_buffers_[from].get(), read_size,
-      base::BindRepeating(&NaiveConnection::OnPullComplete,
-                          weak_ptr_factory_.GetWeakPtr(), from, to));
+  int rv = ERR_READ_IF_READY_NOT_IMPLEMENTED;
+  if (relay_config_.read_if_ready) {
+    rv = sockets_[from]->ReadIfReady(read_buffers_[from].get(),
+                                     read_buffers_[from]->size(),
+                                     relay_callbacks_[from].pull_ready);
+    // The socket does not hold on to the buffer while waiting for data.
+    if (rv == ERR_IO_PENDING)
+      buffer_pool_->Release(std::move(read_buffers_[from]));
+  }
+  if (rv == ERR_READ_IF_READY_NOT_IMPLEMENTED) {
+    rv = sockets_[from]->Read(read_buffers_[from].get(),
+                              read_buffers_[from]->size(),
+                              relay_callbacks_[from].pull_complete);
+  }
 
   if (from == kClient && early_pull_pending_)
     early_pull_result_ = rv;
@@ -352,31 +1330,339 @@ void NaiveConnection::Pull(Direction from, Direction to) {
     OnPullComplete(from, to, rv);
 }
 
+void NaiveConnection::OnPullReady(Direction from, Direction to, int result) {
+  if (result < 0) {
+    OnPullComplete(from, to, result);
+    return;
+  }
+  // The data that ended a long wait is read into a buffer of the minimum
+  // size already.
+  if (relay_config_.IsAdaptive())
+    MaybeShrinkReadSize(from);
+  DoPull(from, to);
+}
+
+void NaiveConnection::Relay(Direction from, Direction to, int size) {
+  if (relay_config_.pipeline_bytes == 0) {
+    Push(from, to, size);
+    return;
+  }
+  if (!IsConnected(to)) {
+    buffer_pool_->Release(std::move(read_buffers_[from]));
+    return;
+  }
+  if (write_pending_[to] && Coalesce(from, to, size)) {
+    queued_bytes_[to] += size;
+    buffer_pool_->Release(std::move(read_buffers_[from]));
+  } else if (write_pending_[to]) {
+    scoped_refptr<NaiveRelayBuffer> buffer = std::move(read_buffers_[from]);
+    buffer->Reset(buffer->headroom(), size);
+    queued_bytes_[to] += size;
+    queued_writes_[to].push_back(std::move(buffer));
+  } else {
+    Push(from, to, size);
+  }
+  if (queued_bytes_[to] >= relay_config_.pipeline_bytes) {
+    pull_stalled_[from] = true;
+    return;
+  }
+  ContinuePull(from, to);
+}
+
 void NaiveConnection::Push(Direction from, Direction to, int size) {
-  write_buffers_[to] = base::MakeRefCounted<DrainableIOBuffer>(
-      std::move(read_buffers_[from]), size);
+  TRACE_EVENT("net", "NaiveConnection::Push", "id", id_, "to",
+              static_cast<int>(to), "bytes", size);
+  write_buffers_[to] = std::move(read_buffers_[from]);
+  write_buffers_[to]->Reset(write_buffers_[to]->headroom(), size);
   write_pending_[to] = true;
   DCHECK(sockets_[to]);
-  int rv = sockets_[to]->Write(
-      write_buffers_[to].get(), write_buffers_[to]->BytesRemaining(),
-      base::BindRepeating(&NaiveConnection::OnPushComplete,
-                          weak_ptr_factory_.GetWeakPtr(), from, to),
-      traffic_annotation_);
+  int rv = WriteBuffer(from, to);
 
+  if (rv != ERR_IO_PENDING) {
+    OnPushComplete(from, to, rv);
+  } else if (to == kClient) {
+    LimitReadAhead();
+  }
+}
+
+bool NaiveConnection::Coalesce(Direction from, Direction to, int size) {
+  if (relay_config_.coalesce_bytes == 0 || queued_writes_[to].empty())
+    return false;
+  NaiveRelayBuffer* last = queued_writes_[to].back().get();
+  int queued = last->BytesRemaining();
+  // Keeps the room the padding of `to` frames the payload with.
+  if (queued + size > relay_config_.coalesce_bytes ||
+      last->tailroom() - sockets_[to]->write_tailroom() < size) {
+    return false;
+  }
+  std::memcpy(last->data() + queued, read_buffers_[from]->data(), size);
+  last->Reset(last->headroom(), queued + size);
+  return true;
+}
+
+bool NaiveConnection::CanWriteInPlace() const {
+  return server_proxy_socket_ && sockets_[kServer] &&
+         sockets_[kServer]->write_headroom() == 0 &&
+         server_proxy_socket_->GetWriteHeadroom() > 0;
+}
+
+int NaiveConnection::WriteBuffer(Direction from, Direction to) {
+  NaiveRelayBuffer* buffer = write_buffers_[to].get();
+  // Past the padding the tunnel frames the payload in the headroom DoPull()
+  // left before it.
+  if (to == kServer && CanWriteInPlace() &&
+      buffer->headroom() >= server_proxy_socket_->GetWriteHeadroom()) {
+    return server_proxy_socket_->WriteInPlace(
+        buffer, buffer->BytesRemaining(), relay_callbacks_[from].push_complete,
+        traffic_annotation_);
+  }
+  return sockets_[to]->Write(buffer, buffer->BytesRemaining(),
+                             relay_callbacks_[from].push_complete,
+                             traffic_annotation_);
+}
+
+void NaiveConnection::PushQueued(Direction from, Direction to) {
+  write_buffers_[to] = std::move(queued_writes_[to].front());
+  queued_writes_[to].pop_front();
+  queued_bytes_[to] -= write_buffers_[to]->BytesRemaining();
+  int rv = WriteBuffer(from, to);
   if (rv != ERR_IO_PENDING)
     OnPushComplete(from, to, rv);
 }
 
+void NaiveConnection::ReleaseQueuedWrites(Direction side) {
+  for (scoped_refptr<NaiveRelayBuffer>& buffer : queued_writes_[side]) {
+    buffer_pool_->Release(std::move(buffer));
+  }
+  queued_writes_[side].clear();
+  queued_bytes_[side] = 0;
+}
+
+void NaiveConnection::LimitReadAhead() {
+  if (relay_config_.read_ahead_limit > 0 && server_proxy_socket_)
+    server_proxy_socket_->SetReadAheadLimit(relay_config_.read_ahead_limit);
+}
+
+bool NaiveConnection::MaybeShrinkReadSize(Direction from) {
+  // Reads pending for long belong to interactive or idle traffic.
+  if (time_func_() - pull_start_time_[from] <=
+      relay_config_.buffer_shrink_idle) {
+    return false;
+  }
+  read_sizes_[from] = relay_config_.buffer_min_size;
+  full_reads_[from] = 0;
+  return true;
+}
+
+void NaiveConnection::AdaptReadSize(Direction from, int result) {
+  if (MaybeShrinkReadSize(from))
+    return;
+
+  if (result < read_buffers_[from]->size()) {
+    full_reads_[from] = 0;
+    return;
+  }
+
+  if (++full_reads_[from] >= relay_config_.buffer_grow_after) {
+    read_sizes_[from] =
+        std::min(read_sizes_[from] * 2, relay_config_.buffer_max_size);
+    full_reads_[from] = 0;
+  }
+}
+
+void NaiveConnection::CountRelayed(Direction from, int size) {
+  if (size > 0 && first_byte_time_[from].is_null())
+    first_byte_time_[from] = time_func_();
+  bytes_relayed_[from] += size;
+  metrics_->bytes_relayed[from] += size;
+  if (user_bytes_relayed_)
+    user_bytes_relayed_[from] += size;
+}
+
+std::optional<base::TimeDelta> NaiveConnection::first_byte_delay(
+    Direction from) const {
+  if (first_byte_time_[from].is_null())
+    return std::nullopt;
+  return first_byte_time_[from] - connect_start_time_;
+}
+
+int64_t NaiveConnection::bytes_relayed(Direction from) const {
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+  return bytes_relayed_[from] + GetDirectRelayBytes(from);
+#else
+  return bytes_relayed_[from];
+#endif
+}
+
+NaiveMemoryUsage NaiveConnection::GetMemoryUsage() {
+  NaiveMemoryUsage usage;
+  for (int i = 0; i < kNumDirections; ++i) {
+    if (read_buffers_[i]) {
+      usage.bytes[NaiveMemoryUsage::kRelayBuffers] +=
+          read_buffers_[i]->capacity();
+    }
+    if (write_buffers_[i]) {
+      usage.bytes[NaiveMemoryUsage::kRelayBuffers] +=
+          write_buffers_[i]->capacity();
+    }
+    for (const auto& buffer : queued_writes_[i]) {
+      usage.bytes[NaiveMemoryUsage::kRelayBuffers] += buffer->capacity();
+    }
+    if (sockets_[i]) {
+      usage.bytes[NaiveMemoryUsage::kPaddingBuffers] +=
+          sockets_[i]->GetMemoryUsage();
+    }
+  }
+  if (client_socket_) {
+    if (protocol_ == ClientProtocol::kSocks5) {
+      usage.bytes[NaiveMemoryUsage::kHandshakeBuffers] =
+          static_cast<const Socks5ServerSocket*>(client_socket_.get())
+              ->GetHandshakeMemoryUsage();
+    } else if (protocol_ == ClientProtocol::kHttp ||
+               (protocol_ == ClientProtocol::kHttps &&
+                client_socket_->GetNegotiatedProtocol() != kProtoHTTP2)) {
+      usage.bytes[NaiveMemoryUsage::kHandshakeBuffers] =
+          static_cast<const HttpProxyServerSocket*>(client_socket_.get())
+              ->GetHandshakeMemoryUsage();
+    }
+  }
+  // The DATA frame being relayed without a copy, then those queued behind
+  // it.
+  if (spdy_read_buffer_) {
+    usage.bytes[NaiveMemoryUsage::kTunnelBacklog] +=
+        spdy_read_buffer_->GetRemainingSize();
+  }
+  if (server_proxy_socket_) {
+    usage.bytes[NaiveMemoryUsage::kTunnelBacklog] +=
+        server_proxy_socket_->GetReadBacklogSize();
+  }
+#if BUILDFLAG(IS_LINUX)
+  if (client_socket_) {
+    if (TCPClientSocket* client_transport = GetClientTransport()) {
+      usage.bytes[NaiveMemoryUsage::kSocketBuffers] +=
+          GetQueuedBytes(client_transport);
+    }
+  }
+  // Proxy tunnels share the transport of their session.
+  if (proxy_info_->is_direct() && server_socket_handle_.socket()) {
+    usage.bytes[NaiveMemoryUsage::kSocketBuffers] += GetQueuedBytes(
+        static_cast<TCPClientSocket*>(server_socket_handle_.socket()));
+  }
+#endif
+  return usage;
+}
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveConnection::SampleTcpInfo() {
+  if (TCPClientSocket* client_transport = GetClientTransport()) {
+    AddTcpInfoSample(client_transport->SocketDescriptorForTesting(),
+                     NaiveTcpInfoStats::kClient);
+  }
+  if (proxy_info_->is_direct() && server_socket_handle_.socket()) {
+    AddTcpInfoSample(
+        server_socket_handle_.socket()->GetTransportSocketDescriptor(),
+        NaiveTcpInfoStats::kEgress);
+  }
+}
+#endif
+
+base::TimeTicks NaiveConnection::GetTimeoutDeadline(base::TimeTicks now) {
+  base::TimeTicks deadline = base::TimeTicks::Max();
+  auto limit = [&deadline](base::TimeTicks start, base::TimeDelta timeout) {
+    if (timeout.is_positive())
+      deadline = std::min(deadline, start + timeout);
+  };
+  if (!running_) {
+    // Phases not started yet cannot time out before their timeout from now.
+    if (connect_server_start_time_.is_null()) {
+      limit(connect_start_time_, relay_config_.handshake_timeout);
+      limit(now, relay_config_.connect_timeout);
+    } else {
+      limit(connect_server_start_time_, relay_config_.connect_timeout);
+    }
+    limit(now, relay_config_.idle_timeout);
+    return deadline;
+  }
+  if (IsUdpAssociate())
+    return deadline;
+  int64_t bytes = bytes_relayed(kClient) + bytes_relayed(kServer);
+  if (idle_since_.is_null() || bytes != idle_check_bytes_) {
+    idle_check_bytes_ = bytes;
+    idle_since_ = now;
+  }
+  limit(idle_since_, relay_config_.idle_timeout);
+  return deadline;
+}
+
+int NaiveConnection::GetClientAddress(IPEndPoint* address) const {
+  if (!client_socket_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  return client_socket_->GetPeerAddress(address);
+}
+
+base::TimeDelta NaiveConnection::age() const {
+  return time_func_() - connect_start_time_;
+}
+
+void NaiveConnection::DisconnectAfterFlush(Direction side) {
+  if (bond_sides_[side] && sockets_[side]) {
+    int rv = bond_sides_[side]->Flush(
+        base::BindOnce(&NaiveConnection::OnFlushComplete,
+                       weak_ptr_factory_.GetWeakPtr(), side));
+    if (rv == ERR_IO_PENDING) {
+      write_pending_[side] = true;
+      return;
+    }
+  }
+  Disconnect(side);
+}
+
+void NaiveConnection::OnFlushComplete(Direction side, int result) {
+  // Unless the side was disconnected meanwhile.
+  if (!write_pending_[side])
+    return;
+  write_pending_[side] = false;
+  Disconnect(side);
+  if (!IsConnected(kClient) && !IsConnected(kServer))
+    OnBothDisconnected();
+}
+
+void NaiveConnection::CountPadding(const NaivePaddingSocket& socket) {
+  const NaivePaddingFramer::ByteCounts* counts[NaivePaddingStats::kNumOps] = {
+      &socket.read_bytes(), &socket.written_bytes()};
+  padding_stats_->frames[NaivePaddingStats::kRead] += socket.num_read_frames();
+  padding_stats_->frames[NaivePaddingStats::kWrite] +=
+      socket.num_written_frames();
+  for (int op = 0; op < NaivePaddingStats::kNumOps; ++op) {
+    padding_stats_->payload_bytes[op] += counts[op]->payload;
+    padding_stats_->padding_bytes[op] += counts[op]->padding;
+    padding_stats_->header_bytes[op] += counts[op]->header;
+  }
+  padding_stats_->split_writes += socket.num_split_writes();
+}
+
 void NaiveConnection::Disconnect(Direction side) {
   if (sockets_[side]) {
     sockets_[side]->Disconnect();
-    sockets_[side] = nullptr;
+    if (padding_stats_)
+      CountPadding(*sockets_[side]);
+    sockets_[side].reset();
     write_pending_[side] = false;
   }
+  // Back to the pool now rather than with the connection, which lingers
+  // until the next task. A pending read or write of the side is gone with
+  // its socket.
+  buffer_pool_->Release(std::move(read_buffers_[side]));
+  buffer_pool_->Release(std::move(write_buffers_[side]));
+  ReleaseQueuedWrites(side);
+  rate_flows_[side].reset();
+#if BUILDFLAG(IS_LINUX)
+  drain_watchers_[side].reset();
+#endif
 }
 
 bool NaiveConnection::IsConnected(Direction side) {
-  return sockets_[side] != nullptr;
+  return sockets_[side].has_value();
 }
 
 void NaiveConnection::OnBothDisconnected() {
@@ -393,26 +1679,52 @@ void NaiveConnection::OnBothDisconnected() {
 void NaiveConnection::OnPullError(Direction from, Direction to, int error) {
   DCHECK_LT(error, 0);
 
-  errors_[from] = error;
-  Disconnect(from);
+  buffer_pool_->Release(std::move(read_buffers_[from]));
+  // An EOF while the other way still relays only ends this way.
+  if (error == ERR_CONNECTION_CLOSED && relay_config_.half_close &&
+      IsConnected(to) && !read_closed_[to]) {
+    read_closed_[from] = true;
+    if (!write_pending_[to])
+      HalfClose(from, to);
+  } else {
+    errors_[from] = error;
+#if BUILDFLAG(IS_LINUX)
+    MaybeResetOnError(error);
+#endif
+    Disconnect(from);
 
-  if (!write_pending_[to])
-    Disconnect(to);
+    if (!write_pending_[to])
+      DisconnectAfterFlush(to);
+  }
 
   if (!IsConnected(from) && !IsConnected(to))
     OnBothDisconnected();
 }
 
+void NaiveConnection::HalfClose(Direction from, Direction to) {
+  if (sockets_[to]->ShutdownWrite() == OK)
+    return;
+  // Sides that cannot half-close end the connection as on any EOF.
+  errors_[from] = ERR_CONNECTION_CLOSED;
+  Disconnect(from);
+  DisconnectAfterFlush(to);
+}
+
 void NaiveConnection::OnPushError(Direction from, Direction to, int error) {
   DCHECK_LE(error, 0);
   DCHECK(!write_pending_[to]);
 
   if (error < 0) {
     errors_[to] = error;
+#if BUILDFLAG(IS_LINUX)
+    MaybeResetOnError(error);
+#endif
     Disconnect(kServer);
     Disconnect(kClient);
   } else if (!IsConnected(from)) {
-    Disconnect(to);
+    DisconnectAfterFlush(to);
+  } else if (read_closed_[from]) {
+    HalfClose(from, to);
   }
 
   if (!IsConnected(from) && !IsConnected(to))
@@ -420,6 +1732,8 @@ void NaiveConnection::OnPushError(Direction from, Direction to, int error) {
 }
 
 void NaiveConnection::OnPullComplete(Direction from, Direction to, int result) {
+  TRACE_EVENT("net", "NaiveConnection::OnPullComplete", "id", id_, "from",
+              static_cast<int>(from), "bytes", result);
   if (from == kClient && early_pull_pending_) {
     early_pull_pending_ = false;
     early_pull_result_ = result ? result : ERR_CONNECTION_CLOSED;
@@ -430,45 +1744,339 @@ void NaiveConnection::OnPullComplete(Direction from, Direction to, int result) {
     return;
   }
 
+  read_stats_->read_bytes[from].Add(result);
+  if (relay_config_.IsAdaptive())
+    AdaptReadSize(from, result);
+  if (rate_flows_[from])
+    rate_flows_[from]->Charge(result);
+  if (from == kClient && client_bypass_pending_)
+    BypassClientHandshakeSocket();
+
   if (from == kClient && !can_push_to_server_)
     return;
 
-  Push(from, to, result);
+  if (MaybeStartBatch(from, to, result))
+    return;
+
+  Relay(from, to, result);
+}
+
+bool NaiveConnection::MaybeStartBatch(Direction from,
+                                      Direction to,
+                                      int result) {
+  // Only padded frames are worth saving. Unpadded writes go out as is.
+  if (result >= relay_config_.padding_batch_bytes ||
+      sockets_[to]->write_headroom() == 0) {
+    return false;
+  }
+  ContinueBatch(from, to, result);
+  return true;
+}
+
+void NaiveConnection::ContinueBatch(Direction from, Direction to, int result) {
+  batched_bytes_[from] += result;
+  // Appends further reads after the payload read so far.
+  read_buffers_[from]->DidConsume(result);
+  if (batched_bytes_[from] >= relay_config_.padding_batch_bytes ||
+      read_buffers_[from]->BytesRemaining() == 0) {
+    FinishBatch(from, to);
+    return;
+  }
+
+  if (!batch_timers_[from].IsRunning()) {
+    batch_timers_[from].Start(FROM_HERE, GetBatchDelay(),
+                              relay_callbacks_[from].finish_batch);
+  }
+  DoBatchRead(from, to);
+}
+
+base::TimeDelta NaiveConnection::GetBatchDelay() const {
+  if (!relay_config_.adapt_network)
+    return relay_config_.padding_batch_delay;
+  // A delay small next to the round trip goes unnoticed.
+  std::optional<base::TimeDelta> rtt =
+      NaiveNetworkQuality::GetForCurrentThread()->http_rtt;
+  if (!rtt)
+    return relay_config_.padding_batch_delay;
+  return std::max(relay_config_.padding_batch_delay,
+                  std::min(*rtt / kBatchDelayRttFraction, kMaxBatchDelay));
+}
+
+void NaiveConnection::DoBatchRead(Direction from, Direction to) {
+  int size = std::min(read_buffers_[from]->BytesRemaining(),
+                      relay_config_.padding_batch_bytes - batched_bytes_[from]);
+  // A plain Read() could not be abandoned when the batch window closes.
+  int rv = sockets_[from]->ReadIfReady(read_buffers_[from].get(), size,
+                                       relay_callbacks_[from].batch_read_ready);
+  if (rv == ERR_IO_PENDING) {
+    batch_read_pending_[from] = true;
+    return;
+  }
+  if (rv > 0) {
+    if (rate_flows_[from])
+      rate_flows_[from]->Charge(rv);
+    ContinueBatch(from, to, rv);
+    return;
+  }
+  if (rv != ERR_READ_IF_READY_NOT_IMPLEMENTED)
+    deferred_pull_errors_[from] = rv ? rv : ERR_CONNECTION_CLOSED;
+  FinishBatch(from, to);
+}
+
+void NaiveConnection::OnBatchReadReady(Direction from,
+                                       Direction to,
+                                       int result) {
+  batch_read_pending_[from] = false;
+  if (result < 0) {
+    deferred_pull_errors_[from] = result;
+    FinishBatch(from, to);
+    return;
+  }
+  DoBatchRead(from, to);
+}
+
+void NaiveConnection::FinishBatch(Direction from, Direction to) {
+  batch_timers_[from].Stop();
+  if (batch_read_pending_[from]) {
+    batch_read_pending_[from] = false;
+    if (IsConnected(from))
+      sockets_[from]->CancelReadIfReady();
+  }
+
+  int size = batched_bytes_[from];
+  batched_bytes_[from] = 0;
+  if (!IsConnected(to) || !read_buffers_[from]) {
+    buffer_pool_->Release(std::move(read_buffers_[from]));
+    return;
+  }
+  read_buffers_[from]->Reset(read_buffers_[from]->headroom() - size, size);
+  Relay(from, to, size);
 }
 
 void NaiveConnection::OnPushComplete(Direction from, Direction to, int result) {
+  TRACE_EVENT("net", "NaiveConnection::OnPushComplete", "id", id_, "to",
+              static_cast<int>(to), "bytes", result);
   if (result >= 0 && write_buffers_[to] != nullptr) {
     bytes_passed_without_yielding_[from] += result;
+    CountRelayed(from, result);
     write_buffers_[to]->DidConsume(result);
     int size = write_buffers_[to]->BytesRemaining();
     if (size > 0) {
-      int rv = sockets_[to]->Write(
-          write_buffers_[to].get(), size,
-          base::BindRepeating(&NaiveConnection::OnPushComplete,
-                              weak_ptr_factory_.GetWeakPtr(), from, to),
-          traffic_annotation_);
+      int rv = sockets_[to]->Write(write_buffers_[to].get(), size,
+                                   relay_callbacks_[from].push_complete,
+                                   traffic_annotation_);
       if (rv != ERR_IO_PENDING)
         OnPushComplete(from, to, rv);
       return;
     }
   }
 
+  buffer_pool_->Release(std::move(write_buffers_[to]));
+  // Over the hard quota the open connections of the user close at their
+  // next write.
+  if (result >= 0 && user_ && user_->over_hard_quota())
+    result = ERR_ACCESS_DENIED;
+  // The write stays pending until the queue behind it is written.
+  if (result >= 0 && !queued_writes_[to].empty()) {
+    PushQueued(from, to);
+    MaybeResumePull(from, to);
+    return;
+  }
   write_pending_[to] = false;
+  ReleaseQueuedWrites(to);
   // Checks for termination even if result is OK.
   OnPushError(from, to, result >= 0 ? OK : result);
+  // Pipelined pulls go on from Relay() instead.
+  if (relay_config_.pipeline_bytes > 0) {
+    MaybeResumePull(from, to);
+  } else {
+    ContinuePull(from, to);
+  }
+}
 
-  if (bytes_passed_without_yielding_[from] > kYieldAfterBytesRead ||
+void NaiveConnection::ContinuePull(Direction from, Direction to) {
+#if BUILDFLAG(IS_LINUX)
+  if (drain_watchers_[to] &&
+      !drain_watchers_[to]->WaitForDrain(
+          relay_callbacks_[from].yield_or_pull)) {
+    return;
+  }
+#endif
+  YieldOrPull(from, to);
+}
+
+void NaiveConnection::MaybeResumePull(Direction from, Direction to) {
+  if (!pull_stalled_[from] ||
+      queued_bytes_[to] >= relay_config_.pipeline_bytes) {
+    return;
+  }
+  pull_stalled_[from] = false;
+  ContinuePull(from, to);
+}
+
+int NaiveConnection::GetYieldBytes() const {
+  int yield_bytes =
+      relay_config_.yield_adaptive
+          ? NaiveRelayScheduler::GetForCurrentThread()->GetAdaptiveYieldBytes(
+                relay_config_.yield_bytes)
+          : relay_config_.yield_bytes;
+  // Cut in overload, so the relays take shorter turns.
+  return yield_bytes / NaiveLagMonitor::GetForCurrentThread()->yield_divisor();
+}
+
+base::TimeDelta NaiveConnection::GetYieldInterval() const {
+  base::TimeDelta yield_interval =
+      relay_config_.yield_adaptive
+          ? NaiveRelayScheduler::GetForCurrentThread()
+                ->GetAdaptiveYieldInterval(relay_config_.yield_interval)
+          : relay_config_.yield_interval;
+  return yield_interval /
+         NaiveLagMonitor::GetForCurrentThread()->yield_divisor();
+}
+
+void NaiveConnection::YieldOrPull(Direction from, Direction to) {
+  if (bytes_passed_without_yielding_[from] > GetYieldBytes() ||
       time_func_() > yield_after_time_[from]) {
+    TRACE_EVENT_INSTANT("net", "NaiveConnection::Yield", "id", id_, "from",
+                        static_cast<int>(from), "bytes",
+                        bytes_passed_without_yielding_[from]);
+    ++yield_count_;
     bytes_passed_without_yielding_[from] = 0;
-    yield_after_time_[from] =
-        time_func_() + base::Milliseconds(kYieldAfterDurationMilliseconds);
-    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
-        FROM_HERE,
-        base::BindRepeating(&NaiveConnection::Pull,
-                            weak_ptr_factory_.GetWeakPtr(), from, to));
+    yield_after_time_[from] = time_func_() + GetYieldInterval();
+    NaiveRelayScheduler::GetForCurrentThread()->Schedule(
+        relay_callbacks_[from].pull);
   } else {
     Pull(from, to);
   }
 }
 
+bool NaiveConnection::TryPullSpdyBuffer() {
+  if (!server_proxy_socket_ || spdy_buffers_unsupported_ ||
+      !sockets_[kClient] || !sockets_[kServer]->IsReadPassthrough() ||
+      sockets_[kClient]->write_headroom() > 0) {
+    return false;
+  }
+  int rv = server_proxy_socket_->ReadSpdyBuffer(
+      &spdy_read_buffer_, relay_callbacks_[kServer].pull_ready);
+  if (rv == ERR_NOT_IMPLEMENTED) {
+    spdy_buffers_unsupported_ = true;
+    return false;
+  }
+  if (rv == ERR_IO_PENDING)
+    return true;
+  if (rv <= 0) {
+    OnPullComplete(kServer, kClient, rv);
+    return true;
+  }
+  PushSpdyBuffer();
+  return true;
+}
+
+#if BUILDFLAG(IS_LINUX)
+bool NaiveConnection::TryWritevServerData() {
+  // Like CanSplice(), the client must be a TCP socket taking the data as it
+  // is.
+  if (!server_proxy_socket_ || peek_unsupported_ || !sockets_[kClient] ||
+      !sockets_[kServer]->IsReadPassthrough() ||
+      sockets_[kClient]->write_headroom() > 0 || IsRateLimited() ||
+      padding_detector_delegate_->GetClientPaddingType() !=
+          PaddingType::kNone) {
+    return false;
+  }
+  if (protocol_ == ClientProtocol::kHttp) {
+    if (static_cast<const HttpProxyServerSocket*>(client_socket_.get())
+            ->is_keep_alive_request()) {
+      return false;
+    }
+  } else if (protocol_ != ClientProtocol::kSocks5) {
+    return false;
+  }
+  TCPClientSocket* client_transport = GetClientTransport();
+  int fd = client_transport ? client_transport->SocketDescriptorForTesting()
+                            : kInvalidSocket;
+  if (fd == kInvalidSocket)
+    return false;
+
+  base::span<const char> regions[kMaxWritevRegions];
+  int rv = server_proxy_socket_->PeekReadData(
+      regions, relay_callbacks_[kServer].pull_ready);
+  if (rv == ERR_NOT_IMPLEMENTED) {
+    peek_unsupported_ = true;
+    return false;
+  }
+  if (rv == ERR_IO_PENDING)
+    return true;
+  if (rv <= 0) {
+    OnPullComplete(kServer, kClient, rv);
+    return true;
+  }
+
+  iovec iov[kMaxWritevRegions];
+  for (int i = 0; i < rv; ++i) {
+    iov[i].iov_base = const_cast<char*>(regions[i].data());
+    iov[i].iov_len = regions[i].size();
+  }
+  ssize_t written = HANDLE_EINTR(writev(fd, iov, rv));
+  // A full send buffer or an error is the socket's to wait for or report.
+  if (written <= 0)
+    return false;
+  server_proxy_socket_->ConsumeReadData(written);
+  read_stats_->read_bytes[kServer].Add(written);
+  bytes_passed_without_yielding_[kServer] += written;
+  CountRelayed(kServer, written);
+  // Like OnPushComplete().
+  int result = OK;
+  if (user_ && user_->over_hard_quota())
+    result = ERR_ACCESS_DENIED;
+  OnPushError(kServer, kClient, result);
+  ContinuePull(kServer, kClient);
+  return true;
+}
+#endif
+
+void NaiveConnection::PushSpdyBuffer() {
+  int size = static_cast<int>(spdy_read_buffer_->GetRemainingSize());
+  if (rate_flows_[kServer])
+    rate_flows_[kServer]->Charge(size);
+  spdy_write_buffer_ = base::MakeRefCounted<DrainableIOBuffer>(
+      spdy_read_buffer_->GetIOBufferForRemainingData(), size);
+  write_pending_[kClient] = true;
+  DCHECK(sockets_[kClient]);
+  int rv = sockets_[kClient]->Write(spdy_write_buffer_.get(), size,
+                                    push_spdy_buffer_callback_,
+                                    traffic_annotation_);
+  if (rv != ERR_IO_PENDING) {
+    OnPushSpdyBufferComplete(rv);
+  } else {
+    LimitReadAhead();
+  }
+}
+
+void NaiveConnection::OnPushSpdyBufferComplete(int result) {
+  if (result >= 0 && spdy_write_buffer_ != nullptr) {
+    bytes_passed_without_yielding_[kServer] += result;
+    CountRelayed(kServer, result);
+    spdy_write_buffer_->DidConsume(result);
+    int size = spdy_write_buffer_->BytesRemaining();
+    if (size > 0) {
+      int rv = sockets_[kClient]->Write(spdy_write_buffer_.get(), size,
+                                        push_spdy_buffer_callback_,
+                                        traffic_annotation_);
+      if (rv != ERR_IO_PENDING)
+        OnPushSpdyBufferComplete(rv);
+      return;
+    }
+  }
+
+  spdy_write_buffer_.reset();
+  // Returns the flow control window once the client took the data.
+  spdy_read_buffer_.reset();
+  write_pending_[kClient] = false;
+  // Like OnPushComplete().
+  if (result >= 0 && user_ && user_->over_hard_quota())
+    result = ERR_ACCESS_DENIED;
+  OnPushError(kServer, kClient, result >= 0 ? OK : result);
+  ContinuePull(kServer, kClient);
+}
+
 }  // namespace net
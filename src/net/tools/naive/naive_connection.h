@@ -6,41 +6,106 @@
 #ifndef NET_TOOLS_NAIVE_NAIVE_CONNECTION_H_
 #define NET_TOOLS_NAIVE_NAIVE_CONNECTION_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "base/containers/circular_deque.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/callback.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "build/build_config.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/completion_repeating_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/request_priority.h"
+#include "net/socket/client_socket_handle.h"
+#include "net/tools/naive/naive_buffer_pool.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_metrics.h"
 #include "net/tools/naive/naive_padding_socket.h"
 #include "net/tools/naive/naive_protocol.h"
 #include "net/tools/naive/naive_proxy_delegate.h"
+#include "net/tools/naive/naive_rate_limiter.h"
+#include "net/tools/naive/naive_user_table.h"
 
 namespace net {
 
-class ClientSocketHandle;
-class DrainableIOBuffer;
 class HttpNetworkSession;
-class IOBuffer;
+class IOBufferWithSize;
+class NaiveBondSocket;
+class NaiveDrainWatcher;
+struct NaivePaddingStats;
+class NaiveRioRelay;
+class NaiveSniffer;
+class NaiveSockmapRelay;
+class NaiveSpliceRelay;
+class NaiveUringRelay;
+class DrainableIOBuffer;
 class NetLogWithSource;
+class ProxyClientSocket;
 class ProxyInfo;
+class SpdyBuffer;
 class StreamSocket;
+class TCPClientSocket;
 struct NetworkTrafficAnnotationTag;
 struct SSLConfig;
 class RedirectResolver;
 class NetworkAnonymizationKey;
+class Socks5UdpRelay;
+
+#if BUILDFLAG(IS_LINUX)
+// A relay taken off its thread by NaiveConnection::DetachRelay(), for
+// NaiveConnection::AttachRelay() to go on with on another.
+struct NaiveDetachedRelay {
+  NaiveDetachedRelay();
+  NaiveDetachedRelay(NaiveDetachedRelay&&);
+  NaiveDetachedRelay& operator=(NaiveDetachedRelay&&);
+  ~NaiveDetachedRelay();
+
+  // The plain TCP sockets of the client and the destination.
+  base::ScopedFD fds[kNumDirections];
+  IPEndPoint peer_addresses[kNumDirections];
+  HostPortPair origin;
+  scoped_refptr<NaiveUserTable::User> user;
+  base::TimeTicks connect_start_time;
+  base::TimeTicks first_byte_time[kNumDirections];
+  int64_t bytes_relayed[kNumDirections] = {};
+};
+#endif
 
 class NaiveConnection {
  public:
   using TimeFunc = base::TimeTicks (*)();
+  // Returns the upstream for the destination, or nullptr for the one the
+  // connection was created with.
+  using RouteCallback =
+      base::RepeatingCallback<const ProxyInfo*(const HostPortPair& origin)>;
+  // Returns whether the connection may go on to the destination.
+  using AdmitCallback =
+      base::RepeatingCallback<bool(const HostPortPair& origin)>;
+  // Returns the key of the tunnel session for a connection to `origin` at
+  // `priority` now on the session of `current`, which may be `current`.
+  using SessionCallback =
+      base::RepeatingCallback<const NetworkAnonymizationKey&(
+          const HostPortPair& origin,
+          RequestPriority priority,
+          const NetworkAnonymizationKey& current)>;
 
   NaiveConnection(
       unsigned int id,
       ClientProtocol protocol,
       std::unique_ptr<PaddingDetectorDelegate> padding_detector_delegate,
       const ProxyInfo& proxy_info,
+      const NaiveRelayConfig& relay_config,
       RedirectResolver* resolver,
       HttpNetworkSession* session,
       const NetworkAnonymizationKey& network_anonymization_key,
@@ -52,14 +117,126 @@ class NaiveConnection {
   NaiveConnection& operator=(const NaiveConnection&) = delete;
 
   unsigned int id() const { return id_; }
+  ClientProtocol protocol() const { return protocol_; }
+  // Of the client, from its PROXY protocol header behind a load balancer.
+  int GetClientAddress(IPEndPoint* address) const;
+  // How long the upstream connection took, which the client spent on its
+  // own handshake after the optimistic reply instead of waiting.
+  base::TimeDelta connect_server_duration() const {
+    return connect_server_duration_;
+  }
+  // Of the client handshake, up to the parsed request.
+  base::TimeDelta connect_client_duration() const {
+    return connect_client_duration_;
+  }
+  // Client payload of the early pull, started before the tunnel connected.
+  int early_data_size() const { return std::max(early_pull_result_, 0); }
+  // From the start of Connect() to the first byte read from `from` being
+  // written to the other side, if any was. Unknown for spliced connections.
+  std::optional<base::TimeDelta> first_byte_delay(Direction from) const;
+  // Payload read from `from` and written to the other side.
+  int64_t bytes_relayed(Direction from) const;
+  // Times a relay direction yielded to the other connections of the thread.
+  uint64_t yield_count() const { return yield_count_; }
+  // Since the start of Connect().
+  base::TimeDelta age() const;
+  // Bytes the connection holds now by what holds them, counting payload it
+  // has read but not yet written and the handshake, padding and tunnel
+  // buffers along the way. Relay buffers count in full even if partly
+  // used, since they are held whole.
+  NaiveMemoryUsage GetMemoryUsage();
+#if BUILDFLAG(IS_LINUX)
+  // Samples the TCP_INFO of the client socket and of the socket to a direct
+  // destination, see NaiveTcpInfoStats. Tunnels share the socket of their
+  // session, which is sampled with the session pool.
+  void SampleTcpInfo();
+#endif
+  // Returns when the connection should be closed by the timeouts of
+  // NaiveRelayConfig, or the earliest time the timeout of a phase not yet
+  // reached could end. Relay progress is only seen by calls of this, so the
+  // idle timeout counts from the first call that saw no new bytes.
+  base::TimeTicks GetTimeoutDeadline(base::TimeTicks now);
+  const NetworkAnonymizationKey& network_anonymization_key() const {
+    return *network_anonymization_key_;
+  }
+  const ProxyChain& proxy_chain() const;
+  // Whether Run() was called, after a successful Connect().
+  bool is_running() const { return running_; }
+  // Names what the connection is doing, for the admin listing: "handshake",
+  // "connect", "connected" until Run(), then "relay", "spliced" or "udp".
+  const char* GetPhaseName() const;
+  // The socket framing the padding of `side`, null until the connection
+  // has it.
+  const NaivePaddingSocket* padding_socket(Direction side) const {
+    return sockets_[side] ? &*sockets_[side] : nullptr;
+  }
+  // Shapes the relay under `limits` once running, instead of splicing it.
+  void set_rate_limits(const NaiveRateLimiter::LimitSet& limits) {
+    rate_limits_ = limits;
+  }
+  // The destination of a ClientProtocol::kEmbedded connection, whose host
+  // has no handshake to ask for it.
+  void set_origin(const HostPortPair& origin) { origin_ = origin; }
+  // Adds the padding of the connection to `stats` when its sides close,
+  // e.g. to those of its listener.
+  void set_padding_stats(NaivePaddingStats* stats) { padding_stats_ = stats; }
+  // Picks the upstream once the client asked for its destination.
+  void set_route_callback(const RouteCallback& route_callback) {
+    route_callback_ = route_callback;
+  }
+  // Asked before the upstream once the client asked for its destination.
+  // The connection fails with ERR_INSUFFICIENT_RESOURCES if refused.
+  void set_admit_callback(const AdmitCallback& admit_callback) {
+    admit_callback_ = admit_callback;
+  }
+  // Moves the connection to another tunnel session once the client asked
+  // for its destination, before the upstream connect.
+  void set_session_callback(const SessionCallback& session_callback) {
+    session_callback_ = session_callback;
+  }
+  // Whether the admit callback let the connection go on to origin(), for
+  // its owner to account for once it closes.
+  bool admitted() const { return admitted_; }
+  const HostPortPair& origin() const { return origin_; }
+  // Of the tunnel sessions for members of a bond past the first, which
+  // takes `network_anonymization_key`. Without these the connection is not
+  // bonded.
+  void set_bond_network_anonymization_keys(
+      const std::vector<NetworkAnonymizationKey>* keys) {
+    bond_network_anonymization_keys_ = keys;
+  }
   int Connect(CompletionOnceCallback callback);
   void Disconnect();
   int Run(CompletionOnceCallback callback);
+  // After Run() completed, returns the client transport of a plain HTTP
+  // request kept alive, for the next request to get a tunnel of its own,
+  // and the client address of its PROXY protocol header if any.
+  std::unique_ptr<StreamSocket> ReleaseKeptAliveClient(
+      std::optional<IPEndPoint>* proxied_source);
+#if BUILDFLAG(IS_LINUX)
+  // Whether DetachRelay() can move the connection to another thread: it
+  // runs the userspace relay between the plain TCP sockets of a direct
+  // connection, without padding, rate limits or zero-copy sends, and holds
+  // no payload it has read but not written. Its pending reads have not
+  // taken anything from the sockets yet.
+  bool CanDetachRelay() const;
+  // Returns duplicates of the sockets with what AttachRelay() needs, and
+  // disconnects, so nothing more is read on this thread. Returns nullopt,
+  // leaving the connection as it is, if the sockets cannot be duplicated.
+  std::optional<NaiveDetachedRelay> DetachRelay();
+  // Goes on with `relay` of another thread on this connection, whose
+  // accepted socket is on the client descriptor of `relay` and
+  // `server_socket` on the other. Takes the place of Connect() before
+  // Run().
+  void AttachRelay(std::unique_ptr<StreamSocket> server_socket,
+                   NaiveDetachedRelay relay);
+#endif
 
  private:
   enum State {
     STATE_CONNECT_CLIENT,
     STATE_CONNECT_CLIENT_COMPLETE,
+    STATE_SNIFF_COMPLETE,
     STATE_CONNECT_SERVER,
     STATE_CONNECT_SERVER_COMPLETE,
     STATE_NONE,
@@ -78,49 +255,307 @@ class NaiveConnection {
   int DoLoop(int last_io_result);
   int DoConnectClient();
   int DoConnectClientComplete(int result);
+  // Sets `origin_` to the destination the client asked for. Sets up
+  // `sniffer_` if the name is to be sniffed first.
+  int GetOrigin();
+#if BUILDFLAG(IS_LINUX)
+  void OnSniffed(std::string host);
+  int DoSniffComplete(int result);
+#endif
+  // Checks and routes `origin_`, then starts the early pull.
+  int PrepareConnectServer();
   int DoConnectServer();
+  // Opens `count` member tunnels for a NaiveBondSocket to the origin.
+  int DoConnectBond(int count);
+  void OnBondMemberComplete(int result);
   int DoConnectServerComplete(int result);
+  // Waits for tokens of `rate_flows_[from]` before StartPull().
   void Pull(Direction from, Direction to);
+  void StartPull(Direction from, Direction to);
+  void DoPull(Direction from, Direction to);
+  void OnPullReady(Direction from, Direction to, int result);
+  // Pushes the `size` bytes read from `from`, or with
+  // NaiveRelayConfig::pipeline_bytes queues them behind the pending write
+  // to `to` and pulls on while the queue is below the limit.
+  void Relay(Direction from, Direction to, int size);
   void Push(Direction from, Direction to, int size);
+  // Appends the `size` bytes read from `from` to the last buffer queued to
+  // `to` if both fit in NaiveRelayConfig::coalesce_bytes, returning false
+  // otherwise.
+  bool Coalesce(Direction from, Direction to, int size);
+  // Whether writes to the tunnel can be framed in the relay buffers, see
+  // ProxyClientSocket::WriteInPlace().
+  bool CanWriteInPlace() const;
+  // Writes `write_buffers_[to]`.
+  int WriteBuffer(Direction from, Direction to);
+  // Writes the next buffer of `queued_writes_[to]`.
+  void PushQueued(Direction from, Direction to);
+  void ReleaseQueuedWrites(Direction side);
+  // Bounds the tunnel data read ahead for a client write pending, see
+  // NaiveRelayConfig::read_ahead_limit.
+  void LimitReadAhead();
+  void AdaptReadSize(Direction from, int result);
+  // Returns to NaiveRelayConfig::buffer_min_size if the pull of `from` has
+  // waited longer than NaiveRelayConfig::buffer_shrink_idle.
+  bool MaybeShrinkReadSize(Direction from);
+  // Accounts for `size` bytes from `from` written to the other side.
+  void CountRelayed(Direction from, int size);
   void Disconnect(Direction side);
+  void CountPadding(const NaivePaddingSocket& socket);
+  // Like Disconnect() once the chunks written to a bond side are sent,
+  // counting as a pending write until then.
+  void DisconnectAfterFlush(Direction side);
+  void OnFlushComplete(Direction side, int result);
   bool IsConnected(Direction side);
   void OnBothDisconnected();
   void OnPullError(Direction from, Direction to, int error);
+  // Passes on the EOF read from `from` once it is written to `to`, see
+  // NaiveRelayConfig::half_close.
+  void HalfClose(Direction from, Direction to);
   void OnPushError(Direction from, Direction to, int error);
   void OnPullComplete(Direction from, Direction to, int result);
   void OnPushComplete(Direction from, Direction to, int result);
+  // Pulls again after a completed Push(), once `to` has drained.
+  void ContinuePull(Direction from, Direction to);
+  // Pulls again if Relay() stopped at the pipeline limit and the queue has
+  // drained below it.
+  void MaybeResumePull(Direction from, Direction to);
+  void YieldOrPull(Direction from, Direction to);
+  // The budget between yields, see NaiveRelayConfig::yield_adaptive.
+  int GetYieldBytes() const;
+  base::TimeDelta GetYieldInterval() const;
+
+  // Relays the DATA payloads received by an HTTP/2 tunnel to the client
+  // without copying them into a relay buffer, once neither side has padding
+  // left to frame. Returns false if the tunnel does not support it.
+  bool TryPullSpdyBuffer();
+  void PushSpdyBuffer();
+  void OnPushSpdyBufferComplete(int result);
+#if BUILDFLAG(IS_LINUX)
+  // Writes the data received by the tunnel to the client TCP socket with
+  // writev() straight from where the tunnel holds it, e.g. the QUIC stream
+  // sequencer, and consumes what was written. Returns false to leave the
+  // pull to the copying relay, which includes waiting for the client to
+  // take more.
+  bool TryWritevServerData();
+#endif
+
+  // Keeps reading into read_buffers_[from] for up to
+  // NaiveRelayConfig::padding_batch_delay before a padded Push(), so
+  // payload arriving in a burst shares one padded frame.
+  bool MaybeStartBatch(Direction from, Direction to, int result);
+  void ContinueBatch(Direction from, Direction to, int result);
+  // NaiveRelayConfig::padding_batch_delay, longer on long round trips with
+  // NaiveRelayConfig::adapt_network.
+  base::TimeDelta GetBatchDelay() const;
+  void DoBatchRead(Direction from, Direction to);
+  void OnBatchReadReady(Direction from, Direction to, int result);
+  void FinishBatch(Direction from, Direction to);
+
+  // Whether the client socket is the control connection of a SOCKS5 UDP
+  // association. Its datagrams are relayed by Socks5UdpRelay until the
+  // connection closes.
+  bool IsUdpAssociate() const;
+  int RunUdpAssociate();
+  int ReadUdpControl();
+  void OnUdpControlRead(int result);
+  // Ends the association when its UDP socket fails.
+  void OnUdpRelayError(int result);
+
+  // Whether both sides are plain TCP sockets that can be relayed by
+  // NaiveSockmapRelay, NaiveSpliceRelay or NaiveUringRelay instead of Pull()
+  // and Push().
+  bool CanSplice() const;
+  bool IsRateLimited() const;
+  // Relays the client side on the transport of the SOCKS5 or HTTP/1.1
+  // handshake socket once that only passes data through, so relay I/O
+  // skips its virtual call and callback hop. Retried after each client read
+  // until then, as payload read along with the request has to drain first.
+  void BypassClientHandshakeSocket();
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_WIN)
+  // Returns nullptr if the client has no TCP socket of its own.
+  TCPClientSocket* GetClientTransport();
+  void OnSpliceComplete(int result);
+  int64_t GetDirectRelayBytes(Direction from) const;
+#endif
+#if BUILDFLAG(IS_LINUX)
+  // Makes closing the client socket send a reset.
+  void ResetClient();
+  // Makes closing `transport` send a reset, so it does not linger in
+  // FIN_WAIT or TIME_WAIT.
+  void ResetOnClose(TCPClientSocket* transport);
+  // With NaiveRelayConfig::reset_on_error, resets both sides on errors
+  // other than a clean close.
+  void MaybeResetOnError(int error);
+  // Runs NaiveSockmapRelay, NaiveUringRelay or NaiveSpliceRelay, the first
+  // that is enabled and available.
+  int RunSplice();
+  // Sets up `drain_watchers_` with NaiveRelayConfig::notsent_lowat.
+  void WatchDrains();
+#endif
+#if BUILDFLAG(IS_WIN)
+  // Runs NaiveRioRelay if Registered I/O is available.
+  int RunRio();
+#endif
 
   unsigned int id_;
   ClientProtocol protocol_;
   std::unique_ptr<PaddingDetectorDelegate> padding_detector_delegate_;
-  const ProxyInfo& proxy_info_;
+  const ProxyInfo* proxy_info_;
+  const NaiveRelayConfig& relay_config_;
   RedirectResolver* resolver_;
   HttpNetworkSession* session_;
-  const NetworkAnonymizationKey& network_anonymization_key_;
+  // Of the tunnel session, one owned by the proxy.
+  const NetworkAnonymizationKey* network_anonymization_key_;
   const NetLogWithSource& net_log_;
 
   CompletionRepeatingCallback io_callback_;
+  // The relay callbacks of each side read from, bound once and copied for
+  // each read and write, which takes a reference instead of allocating.
+  struct RelayCallbacks {
+    RelayCallbacks();
+    RelayCallbacks(const RelayCallbacks&) = delete;
+    RelayCallbacks& operator=(const RelayCallbacks&) = delete;
+    ~RelayCallbacks();
+
+    CompletionRepeatingCallback pull_complete;
+    CompletionRepeatingCallback pull_ready;
+    CompletionRepeatingCallback push_complete;
+    CompletionRepeatingCallback batch_read_ready;
+    base::RepeatingClosure pull;
+    base::RepeatingClosure start_pull;
+    base::RepeatingClosure yield_or_pull;
+    base::RepeatingClosure finish_batch;
+  };
+  RelayCallbacks relay_callbacks_[kNumDirections];
+  CompletionRepeatingCallback push_spdy_buffer_callback_;
   CompletionOnceCallback connect_callback_;
   CompletionOnceCallback run_callback_;
 
   State next_state_;
 
   std::unique_ptr<StreamSocket> client_socket_;
-  std::unique_ptr<ClientSocketHandle> server_socket_handle_;
+  // Held by value with the padding sockets below so that one connection
+  // takes fewer separate heap allocations.
+  ClientSocketHandle server_socket_handle_;
+
+  // The member tunnels while connecting, then the bond over them.
+  const std::vector<NetworkAnonymizationKey>* bond_network_anonymization_keys_ =
+      nullptr;
+  std::vector<std::unique_ptr<ClientSocketHandle>> bond_handles_;
+  int bond_pending_ = 0;
+  int bond_result_ = OK;
+  std::unique_ptr<NaiveBondSocket> bond_socket_;
+  // The bond under each side if any, the server side of a bonded connection
+  // or the client side of a joined one.
+  NaiveBondSocket* bond_sides_[kNumDirections] = {};
 
-  std::unique_ptr<NaivePaddingSocket> sockets_[kNumDirections];
-  scoped_refptr<IOBuffer> read_buffers_[kNumDirections];
-  scoped_refptr<DrainableIOBuffer> write_buffers_[kNumDirections];
+  std::optional<NaivePaddingSocket> sockets_[kNumDirections];
+  // Stream priority of the tunnel, see NaiveRelayConfig::priority_rules.
+  RequestPriority priority_;
+  // The tunnel under sockets_[kServer], null if it is not a proxy client
+  // socket.
+  ProxyClientSocket* server_proxy_socket_;
+  // Whether the tunnel does not hand over its buffers, see
+  // TryPullSpdyBuffer(), or its data in place, see TryWritevServerData().
+  bool spdy_buffers_unsupported_ = false;
+  bool peek_unsupported_ = false;
+  std::unique_ptr<SpdyBuffer> spdy_read_buffer_;
+  scoped_refptr<DrainableIOBuffer> spdy_write_buffer_;
+  NaiveBufferPool* buffer_pool_;
+  NaiveMetrics* metrics_;
+  NaiveRelayReadStats* read_stats_;
+  NaivePaddingStats* padding_stats_ = nullptr;
+  scoped_refptr<NaiveRelayBuffer> read_buffers_[kNumDirections];
+  scoped_refptr<NaiveRelayBuffer> write_buffers_[kNumDirections];
+  // Read while the write to the side was pending, see
+  // NaiveRelayConfig::pipeline_bytes, and the payload they hold.
+  base::circular_deque<scoped_refptr<NaiveRelayBuffer>>
+      queued_writes_[kNumDirections];
+  int queued_bytes_[kNumDirections] = {};
+  // Whether the pulls from the side wait for its queue to drain.
+  bool pull_stalled_[kNumDirections] = {};
+  int read_sizes_[kNumDirections];
+  int full_reads_[kNumDirections];
+  base::TimeTicks pull_start_time_[kNumDirections];
   int errors_[kNumDirections];
   bool write_pending_[kNumDirections];
+  // Whether the side sent its EOF, passed on by HalfClose().
+  bool read_closed_[kNumDirections];
   int bytes_passed_without_yielding_[kNumDirections];
   base::TimeTicks yield_after_time_[kNumDirections];
+  uint64_t yield_count_ = 0;
+  // Whether the relay is counted by NaiveRelayScheduler::AddRelay().
+  bool relay_counted_ = false;
+#if BUILDFLAG(IS_LINUX)
+  // Whether MaybeResetOnError() reset the sides.
+  bool reset_on_error_ = false;
+#endif
+
+  base::TimeTicks first_byte_time_[kNumDirections];
+  int64_t bytes_relayed_[kNumDirections];
+
+  // Payload read so far by an ongoing batch.
+  int batched_bytes_[kNumDirections];
+  bool batch_read_pending_[kNumDirections];
+  base::OneShotTimer batch_timers_[kNumDirections];
+  // A read error or EOF seen during a batch, reported once the batched
+  // payload has been pushed.
+  int deferred_pull_errors_[kNumDirections];
+
+  NaiveRateLimiter::LimitSet rate_limits_;
+  RouteCallback route_callback_;
+  AdmitCallback admit_callback_;
+  SessionCallback session_callback_;
+  bool admitted_ = false;
+  HostPortPair origin_;
+  // Charged with the payload read from each side while running.
+  std::optional<NaiveRateLimiter::Flow> rate_flows_[kNumDirections];
+
+  // The user a SOCKS5 client authenticated as, and its counters on this
+  // thread.
+  scoped_refptr<NaiveUserTable::User> user_;
+  uint64_t* user_bytes_relayed_ = nullptr;
+
+  bool client_bypass_pending_ = false;
 
   bool early_pull_pending_;
   bool can_push_to_server_;
   int early_pull_result_;
 
   bool full_duplex_;
+  bool running_;
+
+  base::TimeTicks connect_start_time_;
+  base::TimeDelta connect_client_duration_;
+  base::TimeTicks connect_server_start_time_;
+  // Whether the upstream connect was retried after its session was found
+  // dead, see NaiveConfig::session_probe_interval.
+  bool connect_retried_ = false;
+  base::TimeDelta connect_server_duration_;
+  // Relayed bytes as of the last GetTimeoutDeadline() that saw them change.
+  int64_t idle_check_bytes_;
+  base::TimeTicks idle_since_;
+
+#if BUILDFLAG(IS_LINUX)
+  std::unique_ptr<NaiveSockmapRelay> sockmap_relay_;
+  std::unique_ptr<NaiveSpliceRelay> splice_relay_;
+  std::unique_ptr<NaiveUringRelay> uring_relay_;
+  // Of the plain TCP sides, reset when the side disconnects.
+  std::unique_ptr<NaiveDrainWatcher> drain_watchers_[kNumDirections];
+  // With NaiveRelayConfig::redir_sniff, until the name is found. Without
+  // one, the connection fails if `sniff_required_` and goes to the address
+  // of `origin_` otherwise.
+  std::unique_ptr<NaiveSniffer> sniffer_;
+  std::string sniffed_host_;
+  bool sniff_required_ = false;
+#endif
+#if BUILDFLAG(IS_WIN)
+  std::unique_ptr<NaiveRioRelay> rio_relay_;
+#endif
+
+  std::unique_ptr<Socks5UdpRelay> udp_relay_;
+  scoped_refptr<IOBufferWithSize> udp_control_buffer_;
 
   TimeFunc time_func_;
 
@@ -0,0 +1,106 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures building the URLRequestContext of an IO thread with the services
+// URLRequestContextBuilder sets up by default and with those left by
+// UseTunnelOnlyServices(), both otherwise configured like naive's: no HTTP
+// cache, a fixed proxy resolution service and a NaiveCertVerifier. Prints
+// the build time and the resident set growth per context. The contexts are
+// all kept until the end so the memory of one profile is not reused by the
+// other, and one context of each is built first so one-off initialization
+// is not counted.
+//
+//   naive_context_perftest --contexts=32
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "base/process/process_metrics.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/single_thread_task_executor.h"
+#include "base/task/thread_pool/thread_pool_instance.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/cert/cert_verifier.h"
+#include "net/proxy_resolution/configured_proxy_resolution_service.h"
+#include "net/tools/naive/naive_cert_verifier.h"
+#include "net/tools/naive/naive_tunnel_context.h"
+#include "net/url_request/url_request_context.h"
+#include "net/url_request/url_request_context_builder.h"
+
+namespace net {
+namespace {
+
+using Contexts = std::vector<std::unique_ptr<URLRequestContext>>;
+
+size_t GetResidentSetSize() {
+  return base::ProcessMetrics::CreateCurrentProcessMetrics()
+      ->GetResidentSetSize();
+}
+
+std::unique_ptr<URLRequestContext> BuildContext(bool tunnel_only) {
+  URLRequestContextBuilder builder;
+  builder.DisableHttpCache();
+  if (tunnel_only) {
+    UseTunnelOnlyServices(&builder);
+  }
+  builder.set_proxy_resolution_service(
+      ConfiguredProxyResolutionService::CreateDirect());
+  // Never verifies, so the trust store is not loaded.
+  builder.SetCertVerifier(std::make_unique<NaiveCertVerifier>(
+      base::BindOnce([] { return std::unique_ptr<CertVerifier>(); })));
+  return builder.Build();
+}
+
+void Measure(const char* profile,
+             bool tunnel_only,
+             int count,
+             Contexts& contexts) {
+  contexts.push_back(BuildContext(tunnel_only));
+  size_t rss = GetResidentSetSize();
+  base::ElapsedTimer timer;
+  for (int i = 0; i < count; ++i) {
+    contexts.push_back(BuildContext(tunnel_only));
+  }
+  base::TimeDelta elapsed = timer.Elapsed();
+  size_t bytes = GetResidentSetSize() - rss;
+  std::printf("  %-12s %8.1f us/context %10zu bytes/context\n", profile,
+              elapsed.InMicrosecondsF() / count, bytes / count);
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+  logging::SetMinLogLevel(logging::LOGGING_WARNING);
+  base::SingleThreadTaskExecutor io_task_executor(base::MessagePumpType::IO);
+  base::ThreadPoolInstance::CreateAndStartWithDefaultParams(
+      "naive_context_perftest");
+
+  int contexts = 32;
+  if (command_line.HasSwitch("contexts") &&
+      (!base::StringToInt(command_line.GetSwitchValueASCII("contexts"),
+                          &contexts) ||
+       contexts < 1)) {
+    std::fprintf(stderr, "Invalid contexts\n");
+    return EXIT_FAILURE;
+  }
+
+  std::printf("URLRequestContext, %d contexts\n", contexts);
+  net::Contexts built;
+  net::Measure("default", /*tunnel_only=*/false, contexts, built);
+  net::Measure("tunnel-only", /*tunnel_only=*/true, contexts, built);
+  built.clear();
+  base::ThreadPoolInstance::Get()->Shutdown();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,310 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_doh_client.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/strings/string_util.h"
+#include "net/base/elements_upload_data_stream.h"
+#include "net/base/io_buffer.h"
+#include "net/base/load_flags.h"
+#include "net/base/net_errors.h"
+#include "net/base/upload_bytes_element_reader.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/dns_response.h"
+#include "net/dns/public/dns_protocol.h"
+#include "net/http/http_request_headers.h"
+#include "net/url_request/url_request.h"
+#include "net/url_request/url_request_context.h"
+
+namespace net {
+
+namespace {
+constexpr char kDnsMessageContentType[] = "application/dns-message";
+constexpr int kInitialReadBufferSize = 4096;
+// The largest DNS message.
+constexpr int kMaxReplySize = 65535;
+constexpr size_t kMaxCacheEntries = 1024;
+// For replies without records, e.g. NODATA without an SOA record.
+constexpr uint32_t kNegativeTtl = 60;
+constexpr uint32_t kMaxTtl = 60 * 60 * 24;
+
+uint32_t ReadTtl(const std::string& reply, size_t offset) {
+  return (static_cast<uint8_t>(reply[offset]) << 24) |
+         (static_cast<uint8_t>(reply[offset + 1]) << 16) |
+         (static_cast<uint8_t>(reply[offset + 2]) << 8) |
+         static_cast<uint8_t>(reply[offset + 3]);
+}
+
+void WriteTtl(std::string& reply, size_t offset, uint32_t ttl) {
+  reply[offset] = ttl >> 24;
+  reply[offset + 1] = ttl >> 16;
+  reply[offset + 2] = ttl >> 8;
+  reply[offset + 3] = ttl;
+}
+
+// Gives `reply` the ID and question of a query, whose question only differs
+// in case from the one `reply` answers.
+void SetQuery(std::string& reply, uint16_t id, std::string_view question) {
+  reply[0] = id >> 8;
+  reply[1] = id;
+  std::memcpy(reply.data() + sizeof(dns_protocol::Header), question.data(),
+              question.size());
+}
+
+// Checks that `reply` answers `query`, and finds the TTLs of its records but
+// OPT, whose TTL field holds flags. `min_ttl` is the time it may be cached.
+bool ParseReply(const DnsQuery& query,
+                std::string_view reply,
+                std::vector<size_t>* ttl_offsets,
+                uint32_t* min_ttl) {
+  auto buffer = base::MakeRefCounted<IOBufferWithSize>(reply.size());
+  std::memcpy(buffer->data(), reply.data(), reply.size());
+  DnsResponse response(std::move(buffer), reply.size());
+  if (!response.InitParse(reply.size(), query))
+    return false;
+
+  uint32_t ttl = kMaxTtl;
+  bool has_records = false;
+  DnsRecordParser parser = response.Parser();
+  unsigned count = response.answer_count() + response.authority_count() +
+                   response.additional_answer_count();
+  for (unsigned i = 0; i < count; ++i) {
+    DnsResourceRecord record;
+    if (!parser.ReadRecord(&record))
+      return false;
+    if (record.type == dns_protocol::kTypeOPT)
+      continue;
+    // The TTL and the data length precede the data.
+    ttl_offsets->push_back(parser.GetOffset() - record.rdata.size() - 6);
+    ttl = std::min(ttl, record.ttl);
+    has_records = true;
+  }
+  if (!has_records)
+    ttl = kNegativeTtl;
+  // Failures other than a missing name are not cached.
+  if (response.rcode() != dns_protocol::kRcodeNOERROR &&
+      response.rcode() != dns_protocol::kRcodeNXDOMAIN) {
+    ttl = 0;
+  }
+  *min_ttl = ttl;
+  return true;
+}
+}  // namespace
+
+// One DoH request, and the queries waiting for its reply.
+class NaiveDohClient::Job : public URLRequest::Delegate {
+ public:
+  struct Waiter {
+    uint16_t id;
+    std::string question;
+    ReplyCallback callback;
+  };
+
+  Job(NaiveDohClient* client, std::string key, const DnsQuery& query)
+      : client_(client),
+        key_(std::move(key)),
+        // ID 0 as RFC 8484 recommends for caching, padded as RFC 8467
+        // recommends for encrypted queries.
+        query_(std::make_unique<DnsQuery>(
+            0,
+            query.qname(),
+            query.qtype(),
+            /*opt_rdata=*/nullptr,
+            DnsQuery::PaddingStrategy::BLOCK_LENGTH_128)),
+        buffer_(base::MakeRefCounted<GrowableIOBuffer>()) {}
+  ~Job() override = default;
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+
+  const DnsQuery& query() const { return *query_; }
+
+  void AddWaiter(const DnsQuery& query, ReplyCallback callback) {
+    waiters_.push_back(Waiter{query.id(), std::string(query.question()),
+                              std::move(callback)});
+  }
+
+  std::vector<Waiter> TakeWaiters() { return std::move(waiters_); }
+
+  void Start(URLRequestContext* context,
+             const GURL& url,
+             const NetworkTrafficAnnotationTag& traffic_annotation) {
+    request_ = context->CreateRequest(url, HIGHEST, this, traffic_annotation);
+    request_->set_method("POST");
+    request_->SetIdempotency(IDEMPOTENT);
+    request_->set_upload(ElementsUploadDataStream::CreateWithReader(
+        std::make_unique<UploadBytesElementReader>(
+            query_->io_buffer()->data(), query_->io_buffer()->size()),
+        /*identifier=*/0));
+    HttpRequestHeaders headers;
+    headers.SetHeader(HttpRequestHeaders::kAccept, kDnsMessageContentType);
+    headers.SetHeader(HttpRequestHeaders::kContentType, kDnsMessageContentType);
+    request_->SetExtraRequestHeaders(headers);
+    request_->SetLoadFlags(request_->load_flags() | LOAD_DISABLE_CACHE);
+    request_->set_allow_credentials(false);
+    buffer_->SetCapacity(kInitialReadBufferSize);
+    request_->Start();
+  }
+
+  // URLRequest::Delegate implementation.
+  void OnResponseStarted(URLRequest* request, int net_error) override {
+    if (net_error != OK) {
+      Finish(net_error);
+      return;
+    }
+    if (request->GetResponseCode() != 200) {
+      Finish(ERR_DNS_MALFORMED_RESPONSE);
+      return;
+    }
+    Read();
+  }
+
+  void OnReadCompleted(URLRequest* request, int bytes_read) override {
+    if (HandleRead(bytes_read)) {
+      Read();
+    }
+  }
+
+ private:
+  void Read() {
+    for (;;) {
+      if (buffer_->RemainingCapacity() == 0) {
+        if (buffer_->capacity() >= kMaxReplySize) {
+          Finish(ERR_DNS_MALFORMED_RESPONSE);
+          return;
+        }
+        buffer_->SetCapacity(
+            std::min(buffer_->capacity() * 2, kMaxReplySize));
+      }
+      int rv = request_->Read(buffer_.get(), buffer_->RemainingCapacity());
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!HandleRead(rv))
+        return;
+    }
+  }
+
+  // Returns whether to read more.
+  bool HandleRead(int result) {
+    if (result <= 0) {
+      Finish(result);
+      return false;
+    }
+    buffer_->set_offset(buffer_->offset() + result);
+    return true;
+  }
+
+  void Finish(int result) {
+    // Deletes `this`.
+    client_->OnJobComplete(
+        key_, result,
+        std::string_view(buffer_->StartOfBuffer(), buffer_->offset()));
+  }
+
+  NaiveDohClient* const client_;
+  const std::string key_;
+  std::unique_ptr<DnsQuery> query_;
+  std::vector<Waiter> waiters_;
+  std::unique_ptr<URLRequest> request_;
+  scoped_refptr<GrowableIOBuffer> buffer_;
+};
+
+NaiveDohClient::CacheEntry::CacheEntry() = default;
+
+NaiveDohClient::CacheEntry::CacheEntry(const CacheEntry&) = default;
+
+NaiveDohClient::CacheEntry::~CacheEntry() = default;
+
+NaiveDohClient::NaiveDohClient(
+    URLRequestContext* context,
+    const GURL& url,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : context_(context),
+      url_(url),
+      traffic_annotation_(traffic_annotation),
+      cache_(kMaxCacheEntries) {}
+
+NaiveDohClient::~NaiveDohClient() = default;
+
+int NaiveDohClient::Resolve(const DnsQuery& query,
+                            std::string* reply,
+                            ReplyCallback callback) {
+  // Clients may randomize the case of names, which replies must echo.
+  std::string key = base::ToLowerASCII(query.question());
+  auto now = base::TimeTicks::Now();
+  auto cached = cache_.Get(key);
+  if (cached != cache_.end()) {
+    const CacheEntry& entry = cached->second;
+    if (now < entry.expiration) {
+      *reply = entry.reply;
+      auto age = static_cast<uint32_t>((now - entry.time).InSeconds());
+      for (size_t offset : entry.ttl_offsets) {
+        WriteTtl(*reply, offset,
+                 std::max(ReadTtl(*reply, offset), age) - age);
+      }
+      SetQuery(*reply, query.id(), query.question());
+      return OK;
+    }
+    cache_.Erase(cached);
+  }
+
+  auto it = jobs_.find(key);
+  if (it != jobs_.end()) {
+    it->second->AddWaiter(query, std::move(callback));
+    return ERR_IO_PENDING;
+  }
+  auto job = std::make_unique<Job>(this, key, query);
+  Job* job_ptr = job.get();
+  job->AddWaiter(query, std::move(callback));
+  jobs_.emplace(std::move(key), std::move(job));
+  job_ptr->Start(context_, url_, traffic_annotation_);
+  return ERR_IO_PENDING;
+}
+
+void NaiveDohClient::OnJobComplete(const std::string& key,
+                                   int result,
+                                   std::string_view body) {
+  auto it = jobs_.find(key);
+  DCHECK(it != jobs_.end());
+  std::unique_ptr<Job> job = std::move(it->second);
+  jobs_.erase(it);
+
+  std::string reply;
+  CacheEntry entry;
+  uint32_t ttl = 0;
+  if (result == OK &&
+      ParseReply(job->query(), body, &entry.ttl_offsets, &ttl)) {
+    reply = std::string(body);
+  } else {
+    LOG(INFO) << "DoH query failed: "
+              << ErrorToShortString(result == OK ? ERR_DNS_MALFORMED_RESPONSE
+                                                 : result);
+    std::optional<DnsQuery> query_opt;
+    query_opt.emplace(job->query().id(), job->query().qname(),
+                      job->query().qtype());
+    DnsResponse response(0, /*is_authoritative=*/false, /*answers=*/{},
+                         /*authority_records=*/{}, /*additional_records=*/{},
+                         query_opt, dns_protocol::kRcodeSERVFAIL);
+    reply.assign(response.io_buffer()->data(), response.io_buffer_size());
+  }
+  if (ttl > 0) {
+    entry.reply = reply;
+    entry.time = base::TimeTicks::Now();
+    entry.expiration = entry.time + base::Seconds(ttl);
+    cache_.Put(key, std::move(entry));
+  }
+
+  for (Job::Waiter& waiter : job->TakeWaiters()) {
+    std::string waiter_reply = reply;
+    SetQuery(waiter_reply, waiter.id, waiter.question);
+    std::move(waiter.callback).Run(std::move(waiter_reply));
+  }
+}
+
+}  // namespace net
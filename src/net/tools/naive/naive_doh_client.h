@@ -0,0 +1,76 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_DOH_CLIENT_H_
+#define NET_TOOLS_NAIVE_NAIVE_DOH_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/containers/lru_cache.h"
+#include "base/functional/callback.h"
+#include "base/time/time.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "url/gurl.h"
+
+namespace net {
+
+class DnsQuery;
+class URLRequestContext;
+
+// Forwards DNS queries as DNS over HTTPS (RFC 8484) requests of a
+// URLRequestContext, so they go through the proxy of its network session and
+// share its tunnels instead of leaving on a path of their own. Identical
+// queries in flight share a request. Replies are cached for their smallest
+// TTL, and served from the cache with their TTLs lowered by its age.
+class NaiveDohClient {
+ public:
+  // Gets the reply to the query, with its ID and question.
+  using ReplyCallback = base::OnceCallback<void(std::string reply)>;
+
+  NaiveDohClient(URLRequestContext* context,
+                 const GURL& url,
+                 const NetworkTrafficAnnotationTag& traffic_annotation);
+  ~NaiveDohClient();
+  NaiveDohClient(const NaiveDohClient&) = delete;
+  NaiveDohClient& operator=(const NaiveDohClient&) = delete;
+
+  // Returns OK with the cached reply in `reply`, or ERR_IO_PENDING and runs
+  // `callback` later. Failed queries get a SERVFAIL reply.
+  int Resolve(const DnsQuery& query,
+              std::string* reply,
+              ReplyCallback callback);
+
+ private:
+  class Job;
+
+  struct CacheEntry {
+    CacheEntry();
+    CacheEntry(const CacheEntry&);
+    ~CacheEntry();
+
+    // With ID 0.
+    std::string reply;
+    // Of the TTLs of all records but OPT.
+    std::vector<size_t> ttl_offsets;
+    base::TimeTicks time;
+    base::TimeTicks expiration;
+  };
+
+  void OnJobComplete(const std::string& key, int result, std::string_view body);
+
+  URLRequestContext* const context_;
+  const GURL url_;
+  const NetworkTrafficAnnotationTag traffic_annotation_;
+  // Keyed by the lowercased question.
+  base::LRUCache<std::string, CacheEntry> cache_;
+  std::map<std::string, std::unique_ptr<Job>> jobs_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_DOH_CLIENT_H_
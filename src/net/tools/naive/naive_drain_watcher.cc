@@ -0,0 +1,59 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_drain_watcher.h"
+
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <utility>
+
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/task/current_thread.h"
+
+namespace net {
+
+NaiveDrainWatcher::NaiveDrainWatcher(int fd, int notsent_lowat)
+    : fd_(fd), notsent_lowat_(notsent_lowat), watcher_(FROM_HERE) {
+  if (setsockopt(fd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &notsent_lowat_,
+                 sizeof(notsent_lowat_)) != 0) {
+    PLOG(WARNING) << "Failed to set TCP_NOTSENT_LOWAT on fd: " << fd_;
+  }
+}
+
+NaiveDrainWatcher::~NaiveDrainWatcher() = default;
+
+bool NaiveDrainWatcher::WaitForDrain(base::OnceClosure callback) {
+  DCHECK(!callback_);
+
+  // Relays without backpressure rather than failing if the queue cannot be
+  // inspected or watched.
+  int unsent = 0;
+  if (ioctl(fd_, SIOCOUTQNSD, &unsent) != 0 || unsent < notsent_lowat_)
+    return true;
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          fd_, /*persistent=*/false, base::MessagePumpForIO::WATCH_WRITE,
+          &watcher_, this)) {
+    PLOG(ERROR) << "WatchFileDescriptor failed on write";
+    return true;
+  }
+  callback_ = std::move(callback);
+  return false;
+}
+
+void NaiveDrainWatcher::OnFileCanReadWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+void NaiveDrainWatcher::OnFileCanWriteWithoutBlocking(int fd) {
+  // Errors also make the socket writable, and are reported by the next
+  // write.
+  std::move(callback_).Run();
+}
+
+}  // namespace net
@@ -0,0 +1,42 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_DRAIN_WATCHER_H_
+#define NET_TOOLS_NAIVE_NAIVE_DRAIN_WATCHER_H_
+
+#include "base/functional/callback.h"
+#include "base/message_loop/message_pump_for_io.h"
+
+namespace net {
+
+// Holds back the relay into a TCP socket while it has TCP_NOTSENT_LOWAT or
+// more bytes not yet sent, so the next payload waits in the socket it comes
+// from, slowing its sender with TCP flow control, instead of queueing in a
+// send buffer of megabytes behind the payload of other connections.
+// Linux only.
+class NaiveDrainWatcher : public base::MessagePumpForIO::FdWatcher {
+ public:
+  // Sets TCP_NOTSENT_LOWAT on `fd`. Does not take ownership of it.
+  NaiveDrainWatcher(int fd, int notsent_lowat);
+  ~NaiveDrainWatcher() override;
+  NaiveDrainWatcher(const NaiveDrainWatcher&) = delete;
+  NaiveDrainWatcher& operator=(const NaiveDrainWatcher&) = delete;
+
+  // Returns true if the unsent bytes are under the low-water mark. Otherwise
+  // returns false and runs `callback` once the socket becomes writable, which
+  // the kernel also holds back until they are.
+  bool WaitForDrain(base::OnceClosure callback);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  const int fd_;
+  const int notsent_lowat_;
+  base::MessagePumpForIO::FdWatchController watcher_;
+  base::OnceClosure callback_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_DRAIN_WATCHER_H_
@@ -0,0 +1,52 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_embed.h"
+
+#include <utility>
+
+#include "base/files/scoped_file.h"
+#include "net/base/host_port_pair.h"
+#include "net/tools/naive/naive_embedding.h"
+#include "net/tools/naive/naive_main.h"
+
+struct naive_embed {
+  net::NaiveEmbedding embedding;
+};
+
+naive_embed* naive_embed_create(void) {
+  return new naive_embed;
+}
+
+int naive_embed_run(naive_embed* embed, int argc, char* argv[]) {
+  int result = net::NaiveMain(argc, argv, &embed->embedding);
+  // Also for the early returns of NaiveMain(), so that waiters wake up.
+  embed->embedding.Finish();
+  return result;
+}
+
+int naive_embed_wait(naive_embed* embed) {
+  return embed->embedding.WaitUntilStarted() ? 0 : -1;
+}
+
+int naive_embed_connect(naive_embed* embed,
+                        int fd,
+                        const char* host,
+                        uint16_t port) {
+  base::ScopedFD socket(fd);
+  if (!host || !*host || port == 0) {
+    return -1;
+  }
+  return embed->embedding.Connect(std::move(socket),
+                                  net::HostPortPair(host, port))
+             ? 0
+             : -1;
+}
+
+void naive_embed_stop(naive_embed* embed) {
+  embed->embedding.Stop();
+}
+
+void naive_embed_destroy(naive_embed* embed) {
+  delete embed;
+}
@@ -0,0 +1,59 @@
+/* Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file. */
+#ifndef NET_TOOLS_NAIVE_NAIVE_EMBED_H_
+#define NET_TOOLS_NAIVE_NAIVE_EMBED_H_
+
+/* The C API of libnaive_embed, which runs naive inside a host process. The
+ * host hands it connected sockets with their destinations, which are relayed
+ * without a SOCKS5 or HTTP handshake by the embed:// listener. A host with a
+ * stream other than a socket can pass one end of a socketpair() and pump the
+ * other. POSIX only. */
+
+#include <stdint.h>
+
+#if defined(NAIVE_EMBED_IMPLEMENTATION)
+#define NAIVE_EMBED_EXPORT __attribute__((visibility("default")))
+#else
+#define NAIVE_EMBED_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct naive_embed naive_embed;
+
+NAIVE_EMBED_EXPORT naive_embed* naive_embed_create(void);
+
+/* Runs naive on the calling thread with the command line `argv`, which
+ * includes --listen=embed://, until naive_embed_stop(). Returns its exit
+ * status. Can be called once per process. */
+NAIVE_EMBED_EXPORT int naive_embed_run(naive_embed* embed,
+                                       int argc,
+                                       char* argv[]);
+
+/* Blocks until naive_embed_run() has started or failed. Returns 0 if it is
+ * running, -1 otherwise. Thread-safe. */
+NAIVE_EMBED_EXPORT int naive_embed_wait(naive_embed* embed);
+
+/* Relays the connected socket `fd` to `host`:`port` through the configured
+ * proxies, taking ownership of `fd` even on failure. Returns 0, or -1 if
+ * naive is not running or the destination is invalid. Thread-safe. */
+NAIVE_EMBED_EXPORT int naive_embed_connect(naive_embed* embed,
+                                           int fd,
+                                           const char* host,
+                                           uint16_t port);
+
+/* Makes naive_embed_run() close its connections and return, or
+ * return right away if it has not started yet. Thread-safe. */
+NAIVE_EMBED_EXPORT void naive_embed_stop(naive_embed* embed);
+
+/* After naive_embed_run() has returned, or if it was never called. */
+NAIVE_EMBED_EXPORT void naive_embed_destroy(naive_embed* embed);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NET_TOOLS_NAIVE_NAIVE_EMBED_H_
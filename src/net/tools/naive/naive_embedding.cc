@@ -0,0 +1,90 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_embedding.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "net/base/host_port_pair.h"
+#include "net/tools/naive/naive_proxy.h"
+
+namespace net {
+
+NaiveEmbedding::Target::Target() = default;
+
+NaiveEmbedding::Target::Target(
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    base::WeakPtr<NaiveProxy> proxy)
+    : task_runner(std::move(task_runner)), proxy(std::move(proxy)) {}
+
+NaiveEmbedding::Target::Target(const Target&) = default;
+
+NaiveEmbedding::Target& NaiveEmbedding::Target::operator=(const Target&) =
+    default;
+
+NaiveEmbedding::Target::~Target() = default;
+
+NaiveEmbedding::NaiveEmbedding() : state_changed_(&lock_) {}
+
+NaiveEmbedding::~NaiveEmbedding() = default;
+
+void NaiveEmbedding::Start(std::vector<Target> targets,
+                           base::OnceClosure quit) {
+  base::AutoLock lock(lock_);
+  DCHECK(state_ == State::kStarting);
+  DCHECK(!targets.empty());
+  targets_ = std::move(targets);
+  main_task_runner_ = base::SingleThreadTaskRunner::GetCurrentDefault();
+  if (stop_requested_) {
+    main_task_runner_->PostTask(FROM_HERE, std::move(quit));
+  } else {
+    quit_ = std::move(quit);
+  }
+  state_ = State::kRunning;
+  state_changed_.Broadcast();
+}
+
+void NaiveEmbedding::Finish() {
+  base::AutoLock lock(lock_);
+  if (state_ == State::kFinished)
+    return;
+  state_ = State::kFinished;
+  // The closures posted to the targets hold their own references.
+  targets_.clear();
+  quit_.Reset();
+  main_task_runner_.reset();
+  state_changed_.Broadcast();
+}
+
+bool NaiveEmbedding::WaitUntilStarted() {
+  base::AutoLock lock(lock_);
+  while (state_ == State::kStarting)
+    state_changed_.Wait();
+  return state_ == State::kRunning;
+}
+
+bool NaiveEmbedding::Connect(base::ScopedFD socket,
+                             const HostPortPair& origin) {
+  base::AutoLock lock(lock_);
+  if (state_ != State::kRunning || stop_requested_)
+    return false;
+  const Target& target = targets_[next_target_];
+  next_target_ = (next_target_ + 1) % targets_.size();
+  // The socket is closed along with the task if the target is gone.
+  target.task_runner->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveProxy::AdoptEmbedded, target.proxy,
+                                std::move(socket), origin));
+  return true;
+}
+
+void NaiveEmbedding::Stop() {
+  base::AutoLock lock(lock_);
+  stop_requested_ = true;
+  if (quit_)
+    main_task_runner_->PostTask(FROM_HERE, std::move(quit_));
+}
+
+}  // namespace net
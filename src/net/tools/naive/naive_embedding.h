@@ -0,0 +1,84 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_EMBEDDING_H_
+#define NET_TOOLS_NAIVE_NAIVE_EMBEDDING_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/thread_annotations.h"
+
+namespace net {
+
+class HostPortPair;
+class NaiveProxy;
+
+// Runs naive inside a host process, which hands it connected sockets along
+// with their destinations instead of talking SOCKS5 to a listener. The
+// sockets go round-robin to the embed:// listener of each upstream worker,
+// see ClientProtocol::kEmbedded. Thread-safe, except that Start() and
+// Finish() are called by NaiveMain() on its thread. POSIX only.
+class NaiveEmbedding {
+ public:
+  struct Target {
+    Target();
+    Target(scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+           base::WeakPtr<NaiveProxy> proxy);
+    Target(const Target&);
+    Target& operator=(const Target&);
+    ~Target();
+
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+    // Only dereferenced on `task_runner`.
+    base::WeakPtr<NaiveProxy> proxy;
+  };
+
+  NaiveEmbedding();
+  ~NaiveEmbedding();
+  NaiveEmbedding(const NaiveEmbedding&) = delete;
+  NaiveEmbedding& operator=(const NaiveEmbedding&) = delete;
+
+  // Once the workers serve `targets`. `quit` ends NaiveMain() on the current
+  // thread, right away if Stop() came first.
+  void Start(std::vector<Target> targets, base::OnceClosure quit);
+  // Once NaiveMain() stopped running or failed to start. Does nothing the
+  // second time.
+  void Finish();
+
+  // Blocks until NaiveMain() has started or given up. Returns whether it is
+  // running.
+  bool WaitUntilStarted();
+  // Relays `socket` to `origin` on the next target. Returns false, closing
+  // `socket`, if NaiveMain() is not running.
+  bool Connect(base::ScopedFD socket, const HostPortPair& origin);
+  // Makes NaiveMain() return, or not start.
+  void Stop();
+
+ private:
+  enum class State {
+    kStarting,
+    kRunning,
+    kFinished,
+  };
+
+  base::Lock lock_;
+  base::ConditionVariable state_changed_;
+  State state_ GUARDED_BY(lock_) = State::kStarting;
+  bool stop_requested_ GUARDED_BY(lock_) = false;
+  std::vector<Target> targets_ GUARDED_BY(lock_);
+  size_t next_target_ GUARDED_BY(lock_) = 0;
+  scoped_refptr<base::SingleThreadTaskRunner> main_task_runner_
+      GUARDED_BY(lock_);
+  base::OnceClosure quit_ GUARDED_BY(lock_);
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_EMBEDDING_H_
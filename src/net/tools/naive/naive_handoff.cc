@@ -0,0 +1,285 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_handoff.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/check.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/posix/unix_domain_socket.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/task/current_thread.h"
+#include "base/time/time.h"
+
+namespace net {
+
+namespace {
+// Ends the messages carrying sockets. No key looks like it.
+constexpr char kEndMessage[] = "end";
+constexpr char kConfirmMessage[] = "ok";
+// Keys of up to UnixDomainSocket::kMaxFileDescriptors sockets.
+constexpr size_t kMaxMessageSize = 4096;
+// Covers the startup of the successor, from taking the sockets to
+// confirming.
+constexpr base::TimeDelta kSuccessorTimeout = base::Seconds(60);
+
+bool MakeAddress(const base::FilePath& path, sockaddr_un* address) {
+  *address = {};
+  address->sun_family = AF_UNIX;
+  if (path.value().size() >= sizeof(address->sun_path)) {
+    LOG(ERROR) << "Handoff path too long: " << path;
+    return false;
+  }
+  memcpy(address->sun_path, path.value().c_str(), path.value().size());
+  return true;
+}
+}  // namespace
+
+NaiveHandoff::NaiveHandoff(const base::FilePath& path)
+    : path_(path),
+      listen_watcher_(FROM_HERE),
+      successor_watcher_(FROM_HERE) {}
+
+NaiveHandoff::~NaiveHandoff() = default;
+
+// static
+std::string NaiveHandoff::MakeKey(std::string_view type,
+                                  const std::string& addr,
+                                  int port) {
+  return base::StrCat({type, " ", addr, ":", base::NumberToString(port)});
+}
+
+void NaiveHandoff::ReceiveSockets() {
+  sockaddr_un address;
+  if (!MakeAddress(path_, &address))
+    return;
+  base::ScopedFD fd(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+  if (!fd.is_valid()) {
+    PLOG(ERROR) << "socket failed";
+    return;
+  }
+  // Nothing to take over, or a path left by a process that is gone.
+  if (HANDLE_EINTR(connect(fd.get(), reinterpret_cast<sockaddr*>(&address),
+                           sizeof(address))) != 0) {
+    return;
+  }
+  timeval timeout = {};
+  timeout.tv_sec = kSuccessorTimeout.InSeconds();
+  setsockopt(fd.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::multimap<std::string, base::ScopedFD> sockets;
+  for (;;) {
+    char buffer[kMaxMessageSize];
+    std::vector<base::ScopedFD> fds;
+    ssize_t size = base::UnixDomainSocket::RecvMsg(fd.get(), buffer,
+                                                   sizeof(buffer), &fds);
+    if (size <= 0) {
+      PLOG_IF(ERROR, size < 0) << "Failed to receive sockets from " << path_;
+      LOG_IF(ERROR, size == 0) << "Sockets from " << path_ << " cut short";
+      return;
+    }
+    std::string_view message(buffer, size);
+    if (message == kEndMessage)
+      break;
+    std::vector<std::string_view> keys = base::SplitStringPiece(
+        message, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (keys.size() != fds.size()) {
+      LOG(ERROR) << "Invalid sockets from " << path_;
+      return;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      sockets.emplace(keys[i], std::move(fds[i]));
+    }
+  }
+  LOG(INFO) << "Took over " << sockets.size() << " sockets from " << path_;
+  received_sockets_ = std::move(sockets);
+  predecessor_ = std::move(fd);
+}
+
+base::ScopedFD NaiveHandoff::TakeSocket(const std::string& key) {
+  auto it = received_sockets_.find(key);
+  if (it == received_sockets_.end())
+    return base::ScopedFD();
+  base::ScopedFD fd = std::move(it->second);
+  received_sockets_.erase(it);
+  return fd;
+}
+
+void NaiveHandoff::AddSocket(const std::string& key, int fd) {
+  base::AutoLock lock(offered_lock_);
+  offered_sockets_.emplace_back(key, fd);
+}
+
+void NaiveHandoff::RemoveSocket(int fd) {
+  base::AutoLock lock(offered_lock_);
+  std::erase_if(offered_sockets_,
+                [fd](const auto& socket) { return socket.second == fd; });
+}
+
+void NaiveHandoff::ConfirmReceived() {
+  if (!predecessor_.is_valid())
+    return;
+  // Their pending connections are lost once the old process closes its
+  // duplicates, as with a restart.
+  for (const auto& [key, fd] : received_sockets_) {
+    LOG(WARNING) << "Closing unused socket " << key;
+  }
+  received_sockets_.clear();
+  if (HANDLE_EINTR(send(predecessor_.get(), kConfirmMessage,
+                        sizeof(kConfirmMessage) - 1, MSG_NOSIGNAL)) < 0) {
+    PLOG(ERROR) << "Failed to confirm handoff";
+  }
+  predecessor_.reset();
+}
+
+bool NaiveHandoff::Serve(SendCallback send_callback,
+                         DoneCallback done_callback) {
+  DCHECK(!listen_fd_.is_valid());
+  sockaddr_un address;
+  if (!MakeAddress(path_, &address))
+    return false;
+  listen_fd_.reset(
+      socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (!listen_fd_.is_valid()) {
+    PLOG(ERROR) << "socket failed";
+    return false;
+  }
+  // Replaces the path of the predecessor, or one left stale.
+  if (unlink(path_.value().c_str()) != 0 && errno != ENOENT) {
+    PLOG(ERROR) << "Failed to remove " << path_;
+    return false;
+  }
+  if (bind(listen_fd_.get(), reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd_.get(), 1) != 0) {
+    PLOG(ERROR) << "Failed to listen on " << path_;
+    listen_fd_.reset();
+    return false;
+  }
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          listen_fd_.get(), /*persistent=*/true,
+          base::MessagePumpForIO::WATCH_READ, &listen_watcher_, this)) {
+    PLOG(ERROR) << "WatchFileDescriptor failed on handoff";
+    listen_fd_.reset();
+    return false;
+  }
+  send_callback_ = std::move(send_callback);
+  done_callback_ = std::move(done_callback);
+  return true;
+}
+
+void NaiveHandoff::OnFileCanReadWithoutBlocking(int fd) {
+  if (fd == listen_fd_.get()) {
+    OnSuccessorConnected();
+  } else {
+    DCHECK_EQ(fd, successor_.get());
+    OnSuccessorRead();
+  }
+}
+
+void NaiveHandoff::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+void NaiveHandoff::OnSuccessorConnected() {
+  base::ScopedFD fd(HANDLE_EINTR(
+      accept4(listen_fd_.get(), nullptr, nullptr, SOCK_CLOEXEC)));
+  if (!fd.is_valid()) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      PLOG(ERROR) << "accept failed on handoff";
+    return;
+  }
+  if (successor_.is_valid()) {
+    LOG(WARNING) << "Handoff already in progress";
+    return;
+  }
+  successor_ = std::move(fd);
+  LOG(INFO) << "Handing sockets over to a new process";
+  send_callback_.Run();
+  if (!SendSockets()) {
+    FinishSuccessor(false);
+    return;
+  }
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          successor_.get(), /*persistent=*/true,
+          base::MessagePumpForIO::WATCH_READ, &successor_watcher_, this)) {
+    PLOG(ERROR) << "WatchFileDescriptor failed on handoff";
+    FinishSuccessor(false);
+    return;
+  }
+  successor_timer_.Start(FROM_HERE, kSuccessorTimeout, this,
+                         &NaiveHandoff::OnSuccessorTimeout);
+}
+
+bool NaiveHandoff::SendSockets() {
+  // Held while sending so no socket is closed before it is sent.
+  base::AutoLock lock(offered_lock_);
+  const size_t batch = base::UnixDomainSocket::kMaxFileDescriptors;
+  for (size_t i = 0; i < offered_sockets_.size(); i += batch) {
+    std::string message;
+    std::vector<int> fds;
+    for (size_t j = i; j < std::min(i + batch, offered_sockets_.size());
+         ++j) {
+      message += offered_sockets_[j].first;
+      message += '\n';
+      fds.push_back(offered_sockets_[j].second);
+    }
+    if (!base::UnixDomainSocket::SendMsg(successor_.get(), message.data(),
+                                         message.size(), fds)) {
+      PLOG(ERROR) << "Failed to send sockets";
+      return false;
+    }
+  }
+  if (!base::UnixDomainSocket::SendMsg(successor_.get(), kEndMessage,
+                                       sizeof(kEndMessage) - 1, {})) {
+    PLOG(ERROR) << "Failed to send sockets";
+    return false;
+  }
+  return true;
+}
+
+void NaiveHandoff::OnSuccessorRead() {
+  char buffer[sizeof(kConfirmMessage)];
+  ssize_t size = HANDLE_EINTR(
+      recv(successor_.get(), buffer, sizeof(buffer), MSG_DONTWAIT));
+  if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    return;
+  bool handed_off = std::string_view(buffer, std::max<ssize_t>(size, 0)) ==
+                    kConfirmMessage;
+  LOG_IF(WARNING, !handed_off) << "New process went away before serving";
+  FinishSuccessor(handed_off);
+}
+
+void NaiveHandoff::OnSuccessorTimeout() {
+  LOG(WARNING) << "New process did not confirm in time";
+  FinishSuccessor(false);
+}
+
+void NaiveHandoff::FinishSuccessor(bool handed_off) {
+  successor_timer_.Stop();
+  successor_watcher_.StopWatchingFileDescriptor();
+  successor_.reset();
+  if (handed_off) {
+    // The path now belongs to the successor.
+    listen_watcher_.StopWatchingFileDescriptor();
+    listen_fd_.reset();
+    base::AutoLock lock(offered_lock_);
+    offered_sockets_.clear();
+  }
+  done_callback_.Run(handed_off);
+}
+
+}  // namespace net
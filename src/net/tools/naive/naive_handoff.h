@@ -0,0 +1,102 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_HANDOFF_H_
+#define NET_TOOLS_NAIVE_NAIVE_HANDOFF_H_
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/callback.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+// Hands the listening sockets of a running naive over to a new one started
+// with the same config, so an upgrade refuses no connections. The new
+// process receives them over a unix socket with SCM_RIGHTS instead of
+// listening itself, and confirms once its workers serve them. The old
+// process then stops accepting and drains its connections. Linux only.
+class NaiveHandoff : public base::MessagePumpForIO::FdWatcher {
+ public:
+  // Runs right before the sockets are sent to a successor.
+  using SendCallback = base::RepeatingClosure;
+  // Runs with whether the successor took the sockets over, or went away
+  // without confirming.
+  using DoneCallback = base::RepeatingCallback<void(bool handed_off)>;
+
+  explicit NaiveHandoff(const base::FilePath& path);
+  ~NaiveHandoff() override;
+  NaiveHandoff(const NaiveHandoff&) = delete;
+  NaiveHandoff& operator=(const NaiveHandoff&) = delete;
+
+  // Identifies a socket by what it is bound to, e.g. "tcp 0.0.0.0:1080".
+  static std::string MakeKey(std::string_view type,
+                             const std::string& addr,
+                             int port);
+
+  // Takes the sockets of the process serving the path, if there is one.
+  // Blocks until they are received.
+  void ReceiveSockets();
+
+  // Returns a received socket for `key` not taken yet, or an invalid one.
+  // Called during startup, by one worker at a time like AddSocket().
+  base::ScopedFD TakeSocket(const std::string& key);
+
+  // Offers `fd` under `key` to the next process. `fd` stays owned by the
+  // caller and must stay open while this serves, or until RemoveSocket().
+  // Can be called on any thread.
+  void AddSocket(const std::string& key, int fd);
+  // Stops offering `fd`, before it is closed.
+  void RemoveSocket(int fd);
+
+  // Tells the process the sockets came from that they are served by this
+  // one now, and closes the sockets not taken.
+  void ConfirmReceived();
+
+  // Offers the sockets at the path on the calling IO thread until a
+  // successor takes them over.
+  bool Serve(SendCallback send_callback, DoneCallback done_callback);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  void OnSuccessorConnected();
+  bool SendSockets();
+  void OnSuccessorRead();
+  // Gives up on a successor not confirming in time.
+  void OnSuccessorTimeout();
+  void FinishSuccessor(bool handed_off);
+
+  const base::FilePath path_;
+
+  std::multimap<std::string, base::ScopedFD> received_sockets_;
+  // Open until ConfirmReceived().
+  base::ScopedFD predecessor_;
+
+  // Changed by the workers as their listeners change.
+  base::Lock offered_lock_;
+  std::vector<std::pair<std::string, int>> offered_sockets_
+      GUARDED_BY(offered_lock_);
+  SendCallback send_callback_;
+  DoneCallback done_callback_;
+  base::ScopedFD listen_fd_;
+  base::MessagePumpForIO::FdWatchController listen_watcher_;
+  // One successor at a time.
+  base::ScopedFD successor_;
+  base::MessagePumpForIO::FdWatchController successor_watcher_;
+  base::OneShotTimer successor_timer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_HANDOFF_H_
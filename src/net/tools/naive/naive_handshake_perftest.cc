@@ -0,0 +1,326 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the handshakes of Socks5ServerSocket and HttpProxyServerSocket
+// on a mock transport serving a scripted client synchronously, in one read
+// and byte by byte, for small requests and large ones: SOCKS5 with
+// username/password authentication and a 253 byte domain, HTTP CONNECT with
+// padding and 4 KB of headers. Prints handshakes per second and, in builds
+// with the allocator shim, heap allocations per handshake, the two sockets
+// included.
+//
+//   naive_handshake_perftest --iterations=200000
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/check_op.h"
+#include "base/command_line.h"
+#include "base/functional/callback_helpers.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/stream_socket.h"
+#include "net/ssl/ssl_info.h"
+#include "net/tools/naive/http_proxy_server_socket.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_proxy_delegate.h"
+#include "net/tools/naive/socks5_server_socket.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "partition_alloc/partition_alloc_buildflags.h"
+
+#if PA_BUILDFLAG(USE_ALLOCATOR_SHIM)
+#include "partition_alloc/shim/allocator_shim.h"
+#endif
+
+namespace net {
+namespace {
+
+constexpr NetworkTrafficAnnotationTag kTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_perftest", "");
+
+#if PA_BUILDFLAG(USE_ALLOCATOR_SHIM)
+std::atomic<uint64_t> g_allocations{0};
+
+void* CountAlloc(const allocator_shim::AllocatorDispatch* self,
+                 size_t size,
+                 void* context) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return self->next->alloc_function(self->next, size, context);
+}
+
+void* CountAllocUnchecked(const allocator_shim::AllocatorDispatch* self,
+                          size_t size,
+                          void* context) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return self->next->alloc_unchecked_function(self->next, size, context);
+}
+
+void* CountAllocZeroInitialized(const allocator_shim::AllocatorDispatch* self,
+                                size_t n,
+                                size_t size,
+                                void* context) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return self->next->alloc_zero_initialized_function(self->next, n, size,
+                                                     context);
+}
+
+void* CountAllocAligned(const allocator_shim::AllocatorDispatch* self,
+                        size_t alignment,
+                        size_t size,
+                        void* context) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return self->next->alloc_aligned_function(self->next, alignment, size,
+                                            context);
+}
+
+void* CountRealloc(const allocator_shim::AllocatorDispatch* self,
+                   void* address,
+                   size_t size,
+                   void* context) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return self->next->realloc_function(self->next, address, size, context);
+}
+
+// The functions left null are taken from the next dispatch.
+allocator_shim::AllocatorDispatch g_counting_dispatch = {
+    &CountAlloc,                 // alloc_function
+    &CountAllocUnchecked,        // alloc_unchecked_function
+    &CountAllocZeroInitialized,  // alloc_zero_initialized_function
+    &CountAllocAligned,          // alloc_aligned_function
+    &CountRealloc,               // realloc_function
+    nullptr,                     // free_function
+    nullptr,                     // get_size_estimate_function
+    nullptr,                     // good_size_function
+    nullptr,                     // claimed_address_function
+    nullptr,                     // batch_malloc_function
+    nullptr,                     // batch_free_function
+    nullptr,                     // free_definite_size_function
+    nullptr,                     // try_free_default_function
+    nullptr,                     // aligned_malloc_function
+    nullptr,                     // aligned_realloc_function
+    nullptr,                     // aligned_free_function
+    nullptr,                     // next
+};
+
+bool CountsAllocations() {
+  return true;
+}
+
+uint64_t GetAllocationCount() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+#else
+bool CountsAllocations() {
+  return false;
+}
+
+uint64_t GetAllocationCount() {
+  return 0;
+}
+#endif
+
+// Serves reads synchronously from a client script in reads of at most
+// `segment_size` bytes, all that fits if 0, and discards writes.
+class ScriptedStreamSocket : public StreamSocket {
+ public:
+  ScriptedStreamSocket(std::string_view script, int segment_size)
+      : script_(script), segment_size_(segment_size) {}
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override {
+    int size = std::min<int>(buf_len, script_.size() - offset_);
+    if (segment_size_ > 0) {
+      size = std::min(size, segment_size_);
+    }
+    std::memcpy(buf->data(), script_.data() + offset_, size);
+    offset_ += size;
+    return size;
+  }
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override {
+    return buf_len;
+  }
+  int SetReceiveBufferSize(int32_t size) override { return OK; }
+  int SetSendBufferSize(int32_t size) override { return OK; }
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override { return OK; }
+  void Disconnect() override {}
+  bool IsConnected() const override { return true; }
+  bool IsConnectedAndIdle() const override { return true; }
+  int GetPeerAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int GetLocalAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  const NetLogWithSource& NetLog() const override { return net_log_; }
+  bool WasEverUsed() const override { return true; }
+  NextProto GetNegotiatedProtocol() const override { return kProtoUnknown; }
+  bool GetSSLInfo(SSLInfo* ssl_info) override { return false; }
+  int64_t GetTotalReceivedBytes() const override { return offset_; }
+  void ApplySocketTag(const SocketTag& tag) override {}
+
+ private:
+  const std::string_view script_;
+  const int segment_size_;
+  size_t offset_ = 0;
+  NetLogWithSource net_log_;
+};
+
+class NullPaddingDetectorDelegate : public ClientPaddingDetectorDelegate {
+ public:
+  void SetClientPaddingType(PaddingType padding_type) override {}
+};
+
+// A hostname of `size` bytes in labels of at most 63.
+std::string MakeHostname(size_t size) {
+  std::string host;
+  while (host.size() < size) {
+    if (!host.empty()) {
+      host += '.';
+    }
+    host.append(std::min<size_t>(63, size - host.size()), 'a');
+  }
+  if (host.back() == '.') {
+    host.back() = 'a';
+  }
+  return host;
+}
+
+std::string MakeSocks5Script(bool large) {
+  std::string host = large ? MakeHostname(253) : "www.example.com";
+  std::string script;
+  if (large) {
+    script += {'\x05', '\x01', '\x02'};
+    std::string user(255, 'u');
+    std::string pass(255, 'p');
+    script += {'\x01', static_cast<char>(user.size())};
+    script += user;
+    script += static_cast<char>(pass.size());
+    script += pass;
+  } else {
+    script += {'\x05', '\x01', '\x00'};
+  }
+  script += {'\x05', '\x01', '\x00', '\x03', static_cast<char>(host.size())};
+  script += host;
+  script += {'\x01', '\xbb'};
+  return script;
+}
+
+std::string MakeHttpScript(bool large) {
+  std::string host = large ? MakeHostname(253) : "www.example.com";
+  std::string script = "CONNECT " + host + ":443 HTTP/1.1\r\nHost: " + host +
+                       ":443\r\n";
+  if (large) {
+    script += "Proxy-Authorization: Basic " + std::string(344, 'Q') + "\r\n";
+    script += "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+              "(KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n";
+    for (int i = 0; script.size() < 4096; ++i) {
+      script += "X-Extra-" + base::NumberToString(i) + ": " +
+                std::string(100, 'x') + "\r\n";
+    }
+  }
+  // As NaiveProxyDelegate sends them, with the largest padding.
+  script += std::string(kPaddingHeader) + ": " + std::string(32, '~') +
+            "\r\n" + kPaddingTypeRequestHeader + ": 1, 0\r\n\r\n";
+  return script;
+}
+
+std::unique_ptr<StreamSocket> CreateServerSocket(
+    bool socks5,
+    bool large,
+    std::unique_ptr<StreamSocket> transport,
+    ClientPaddingDetectorDelegate* padding_detector_delegate,
+    const std::vector<PaddingType>& padding_types) {
+  if (socks5) {
+    return std::make_unique<Socks5ServerSocket>(
+        std::move(transport), large ? std::string(255, 'u') : std::string(),
+        large ? std::string(255, 'p') : std::string(),
+        /*user_table=*/nullptr, /*udp_associate_enabled=*/false,
+        kTrafficAnnotation);
+  }
+  return std::make_unique<HttpProxyServerSocket>(
+      std::move(transport), padding_detector_delegate, kTrafficAnnotation,
+      padding_types);
+}
+
+void Benchmark(bool socks5, int iterations) {
+  std::printf("%s (handshakes/s, allocations/handshake)\n",
+              socks5 ? "Socks5ServerSocket" : "HttpProxyServerSocket");
+  NullPaddingDetectorDelegate padding_detector_delegate;
+  const std::vector<PaddingType> padding_types = {PaddingType::kVariant1,
+                                                  PaddingType::kNone};
+  for (bool large : {false, true}) {
+    std::string script =
+        socks5 ? MakeSocks5Script(large) : MakeHttpScript(large);
+    for (int segment_size : {0, 1}) {
+      uint64_t allocations = GetAllocationCount();
+      base::TimeTicks start = base::TimeTicks::Now();
+      for (int i = 0; i < iterations; ++i) {
+        std::unique_ptr<StreamSocket> socket = CreateServerSocket(
+            socks5, large,
+            std::make_unique<ScriptedStreamSocket>(script, segment_size),
+            &padding_detector_delegate, padding_types);
+        int rv = socket->Connect(base::DoNothing());
+        CHECK_EQ(rv, OK);
+      }
+      base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+      double per_handshake =
+          static_cast<double>(GetAllocationCount() - allocations) / iterations;
+      std::printf("  %-5s %5zu bytes %-12s: %10.0f", large ? "large" : "small",
+                  script.size(),
+                  segment_size == 0 ? "one read" : "byte by byte",
+                  iterations / elapsed.InSecondsF());
+      if (CountsAllocations()) {
+        std::printf(" %8.2f", per_handshake);
+      }
+      std::printf("\n");
+    }
+  }
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+
+  int iterations = 200000;
+  if (command_line.HasSwitch("iterations") &&
+      (!base::StringToInt(command_line.GetSwitchValueASCII("iterations"),
+                          &iterations) ||
+       iterations < 1)) {
+    std::fprintf(stderr, "Invalid iterations\n");
+    return EXIT_FAILURE;
+  }
+
+#if PA_BUILDFLAG(USE_ALLOCATOR_SHIM)
+  allocator_shim::InsertAllocatorDispatch(&net::g_counting_dispatch);
+#endif
+  net::Benchmark(/*socks5=*/true, iterations);
+  net::Benchmark(/*socks5=*/false, iterations);
+  return EXIT_SUCCESS;
+}
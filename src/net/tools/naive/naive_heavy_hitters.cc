@@ -0,0 +1,74 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_heavy_hitters.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+NaiveHeavyHitters::NaiveHeavyHitters()
+    : connects_(kCapacity, /*min_count=*/1),
+      kilobytes_(kCapacity, /*min_count=*/1) {}
+
+NaiveHeavyHitters::~NaiveHeavyHitters() = default;
+
+// static
+NaiveHeavyHitters* NaiveHeavyHitters::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveHeavyHitters>();
+}
+
+void NaiveHeavyHitters::AddConnect(const HostPortPair& destination,
+                                   base::TimeTicks now) {
+  MaybeDecay(now);
+  connects_.Add(destination);
+}
+
+void NaiveHeavyHitters::AddBytes(const HostPortPair& destination,
+                                 int64_t bytes,
+                                 base::TimeTicks now) {
+  if (bytes <= 0)
+    return;
+  MaybeDecay(now);
+  kilobytes_.Add(destination, static_cast<uint32_t>(std::min<int64_t>(
+                                  (bytes + 1023) / 1024, UINT32_MAX)));
+}
+
+std::vector<NaiveHeavyHitters::Entry> NaiveHeavyHitters::GetTop() const {
+  std::vector<Entry> top;
+  auto add = [this, &top](const HostPortPair& destination) {
+    if (std::any_of(top.begin(), top.end(), [&](const Entry& entry) {
+          return entry.destination == destination;
+        })) {
+      return;
+    }
+    top.push_back({destination, connects_.Estimate(destination),
+                   uint64_t{kilobytes_.Estimate(destination)} * 1024});
+  };
+  for (const auto& [destination, estimate] : connects_.GetTop()) {
+    add(destination);
+  }
+  for (const auto& [destination, estimate] : kilobytes_.GetTop()) {
+    add(destination);
+  }
+  return top;
+}
+
+void NaiveHeavyHitters::MaybeDecay(base::TimeTicks now) {
+  if (last_decay_.is_null()) {
+    last_decay_ = now;
+    return;
+  }
+  // Once per interval however long nothing was added, so an idle thread
+  // keeps its last estimates until its next connection.
+  if (now - last_decay_ < kDecayInterval)
+    return;
+  connects_.Decay();
+  kilobytes_.Decay();
+  last_decay_ = now;
+}
+
+}  // namespace net
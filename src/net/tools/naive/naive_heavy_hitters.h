@@ -0,0 +1,62 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_HEAVY_HITTERS_H_
+#define NET_TOOLS_NAIVE_NAIVE_HEAVY_HITTERS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+#include "net/tools/naive/naive_hot_destinations.h"
+
+namespace net {
+
+// The destinations of an IO thread taking the most connects and the most
+// relayed bytes, each estimated in constant memory by a
+// NaiveHotDestinations, for the metrics and the admin listing. The
+// estimates are halved every kDecayInterval, so they follow the current
+// load rather than the all-time one.
+class NaiveHeavyHitters {
+ public:
+  // Destinations kept by each estimate.
+  static constexpr size_t kCapacity = 32;
+  static constexpr base::TimeDelta kDecayInterval = base::Minutes(1);
+
+  struct Entry {
+    HostPortPair destination;
+    uint32_t connects;
+    uint64_t bytes;
+  };
+
+  NaiveHeavyHitters();
+  NaiveHeavyHitters(const NaiveHeavyHitters&) = delete;
+  NaiveHeavyHitters& operator=(const NaiveHeavyHitters&) = delete;
+  ~NaiveHeavyHitters();
+
+  // Returns the tracker of the calling thread, creating it on first use.
+  static NaiveHeavyHitters* GetForCurrentThread();
+
+  void AddConnect(const HostPortPair& destination, base::TimeTicks now);
+  // Of a connection once it closed, counted in KiB.
+  void AddBytes(const HostPortPair& destination,
+                int64_t bytes,
+                base::TimeTicks now);
+
+  // The destinations kept by either estimate with both of their estimates,
+  // those with the most connects first, then those with the most bytes.
+  std::vector<Entry> GetTop() const;
+
+ private:
+  void MaybeDecay(base::TimeTicks now);
+
+  NaiveHotDestinations connects_;
+  NaiveHotDestinations kilobytes_;
+  base::TimeTicks last_decay_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_HEAVY_HITTERS_H_
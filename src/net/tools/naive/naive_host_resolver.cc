@@ -0,0 +1,334 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_host_resolver.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/check_op.h"
+#include "base/functional/bind.h"
+#include "base/functional/callback.h"
+#include "base/functional/callback_helpers.h"
+#include "base/values.h"
+#include "net/base/address_list.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/host_cache.h"
+#include "net/dns/public/host_resolver_results.h"
+#include "net/dns/public/host_resolver_source.h"
+#include "net/dns/public/resolve_error_info.h"
+
+namespace net {
+
+// Answers from the host cache if the probe found a usable result there, and
+// otherwise resolves as usual.
+class NaiveHostResolver::RequestImpl : public HostResolver::ResolveHostRequest {
+ public:
+  RequestImpl(std::unique_ptr<ResolveHostRequest> probe,
+              std::unique_ptr<ResolveHostRequest> request,
+              base::TimeDelta max_stale,
+              base::TimeDelta prefetch_before,
+              base::OnceClosure refresh)
+      : probe_(std::move(probe)),
+        request_(std::move(request)),
+        max_stale_(max_stale),
+        prefetch_before_(prefetch_before),
+        refresh_(std::move(refresh)) {}
+  ~RequestImpl() override = default;
+  RequestImpl(const RequestImpl&) = delete;
+  RequestImpl& operator=(const RequestImpl&) = delete;
+
+  int Start(CompletionOnceCallback callback) override {
+    int rv = probe_->Start(base::DoNothing());
+    // Local-only requests complete synchronously.
+    DCHECK_NE(rv, ERR_IO_PENDING);
+    const std::optional<HostCache::EntryStaleness>& stale_info =
+        probe_->GetStaleInfo();
+    if (rv == OK && stale_info &&
+        (!stale_info->is_stale() || (stale_info->network_changes == 0 &&
+                                     stale_info->expired_by < max_stale_))) {
+      if (stale_info->expired_by > -prefetch_before_)
+        std::move(refresh_).Run();
+      request_.reset();
+      return OK;
+    }
+    probe_.reset();
+    return request_->Start(std::move(callback));
+  }
+
+  const AddressList* GetAddressResults() const override {
+    return active()->GetAddressResults();
+  }
+
+  const std::vector<HostResolverEndpointResult>* GetEndpointResults()
+      const override {
+    return active()->GetEndpointResults();
+  }
+
+  const std::vector<std::string>* GetTextResults() const override {
+    return active()->GetTextResults();
+  }
+
+  const std::vector<HostPortPair>* GetHostnameResults() const override {
+    return active()->GetHostnameResults();
+  }
+
+  const std::set<std::string>* GetDnsAliasResults() const override {
+    return active()->GetDnsAliasResults();
+  }
+
+  ResolveErrorInfo GetResolveErrorInfo() const override {
+    return active()->GetResolveErrorInfo();
+  }
+
+  const std::optional<HostCache::EntryStaleness>& GetStaleInfo()
+      const override {
+    return active()->GetStaleInfo();
+  }
+
+  void ChangeRequestPriority(RequestPriority priority) override {
+    if (request_)
+      request_->ChangeRequestPriority(priority);
+  }
+
+ private:
+  ResolveHostRequest* active() const {
+    return probe_ ? probe_.get() : request_.get();
+  }
+
+  // Only one of them is kept once started.
+  std::unique_ptr<ResolveHostRequest> probe_;
+  std::unique_ptr<ResolveHostRequest> request_;
+  const base::TimeDelta max_stale_;
+  const base::TimeDelta prefetch_before_;
+  base::OnceClosure refresh_;
+};
+
+// Answers with the pinned addresses of a name.
+class NaiveHostResolver::PinnedRequest
+    : public HostResolver::ResolveHostRequest {
+ public:
+  explicit PinnedRequest(std::vector<IPEndPoint> endpoints)
+      : addresses_(endpoints) {
+    endpoint_results_.emplace_back().ip_endpoints = std::move(endpoints);
+  }
+  ~PinnedRequest() override = default;
+  PinnedRequest(const PinnedRequest&) = delete;
+  PinnedRequest& operator=(const PinnedRequest&) = delete;
+
+  int Start(CompletionOnceCallback callback) override {
+    return addresses_.empty() ? ERR_NAME_NOT_RESOLVED : OK;
+  }
+
+  const AddressList* GetAddressResults() const override {
+    return &addresses_;
+  }
+
+  const std::vector<HostResolverEndpointResult>* GetEndpointResults()
+      const override {
+    return &endpoint_results_;
+  }
+
+  const std::vector<std::string>* GetTextResults() const override {
+    return nullptr;
+  }
+
+  const std::vector<HostPortPair>* GetHostnameResults() const override {
+    return nullptr;
+  }
+
+  const std::set<std::string>* GetDnsAliasResults() const override {
+    return &dns_aliases_;
+  }
+
+  ResolveErrorInfo GetResolveErrorInfo() const override {
+    return ResolveErrorInfo(addresses_.empty() ? ERR_NAME_NOT_RESOLVED : OK);
+  }
+
+  const std::optional<HostCache::EntryStaleness>& GetStaleInfo()
+      const override {
+    return stale_info_;
+  }
+
+ private:
+  const AddressList addresses_;
+  std::vector<HostResolverEndpointResult> endpoint_results_;
+  const std::set<std::string> dns_aliases_;
+  const std::optional<HostCache::EntryStaleness> stale_info_;
+};
+
+NaiveHostResolver::NaiveHostResolver(std::unique_ptr<HostResolver> impl,
+                                     base::TimeDelta max_stale,
+                                     base::TimeDelta prefetch_before,
+                                     Pins pins)
+    : impl_(std::move(impl)),
+      max_stale_(max_stale),
+      prefetch_before_(prefetch_before),
+      pins_(std::move(pins)) {}
+
+NaiveHostResolver::~NaiveHostResolver() = default;
+
+void NaiveHostResolver::OnShutdown() {
+  refreshes_.clear();
+  impl_->OnShutdown();
+}
+
+std::unique_ptr<HostResolver::ResolveHostRequest>
+NaiveHostResolver::CreateRequest(
+    url::SchemeHostPort host,
+    NetworkAnonymizationKey network_anonymization_key,
+    NetLogWithSource net_log,
+    std::optional<ResolveHostParameters> optional_parameters) {
+  return CreateCachingRequest(std::move(host), network_anonymization_key,
+                              net_log, optional_parameters);
+}
+
+std::unique_ptr<HostResolver::ResolveHostRequest>
+NaiveHostResolver::CreateRequest(
+    const HostPortPair& host,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    const NetLogWithSource& net_log,
+    const std::optional<ResolveHostParameters>& optional_parameters) {
+  return CreateCachingRequest(host, network_anonymization_key, net_log,
+                              optional_parameters);
+}
+
+std::unique_ptr<HostResolver::ServiceEndpointRequest>
+NaiveHostResolver::CreateServiceEndpointRequest(
+    Host host,
+    NetworkAnonymizationKey network_anonymization_key,
+    NetLogWithSource net_log,
+    ResolveHostParameters parameters) {
+  return impl_->CreateServiceEndpointRequest(
+      std::move(host), std::move(network_anonymization_key),
+      std::move(net_log), std::move(parameters));
+}
+
+std::unique_ptr<HostResolver::ProbeRequest>
+NaiveHostResolver::CreateDohProbeRequest() {
+  return impl_->CreateDohProbeRequest();
+}
+
+HostCache* NaiveHostResolver::GetHostCache() {
+  return impl_->GetHostCache();
+}
+
+base::Value::Dict NaiveHostResolver::GetDnsConfigAsValue() const {
+  return impl_->GetDnsConfigAsValue();
+}
+
+void NaiveHostResolver::SetRequestContext(URLRequestContext* request_context) {
+  impl_->SetRequestContext(request_context);
+}
+
+HostResolverManager* NaiveHostResolver::GetManagerForTesting() {
+  return impl_->GetManagerForTesting();
+}
+
+std::unique_ptr<HostResolver::ResolveHostRequest>
+NaiveHostResolver::CreateCachingRequest(
+    RequestHost host,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    const NetLogWithSource& net_log,
+    const std::optional<ResolveHostParameters>& optional_parameters) {
+  ResolveHostParameters parameters =
+      optional_parameters.value_or(ResolveHostParameters());
+  if (auto request = CreatePinnedRequest(host, parameters))
+    return request;
+  // Leaves alone requests that do not use the cache as usual.
+  if ((!max_stale_.is_positive() && !prefetch_before_.is_positive()) ||
+      parameters.cache_usage != ResolveHostParameters::CacheUsage::ALLOWED ||
+      parameters.source == HostResolverSource::LOCAL_ONLY) {
+    return CreateImplRequest(host, network_anonymization_key, net_log,
+                             optional_parameters);
+  }
+
+  ResolveHostParameters probe_parameters = parameters;
+  probe_parameters.source = HostResolverSource::LOCAL_ONLY;
+  probe_parameters.cache_usage =
+      ResolveHostParameters::CacheUsage::STALE_ALLOWED;
+  auto probe = CreateImplRequest(host, network_anonymization_key, net_log,
+                                 probe_parameters);
+  auto request = CreateImplRequest(host, network_anonymization_key, net_log,
+                                   optional_parameters);
+  return std::make_unique<RequestImpl>(
+      std::move(probe), std::move(request), max_stale_, prefetch_before_,
+      base::BindOnce(&NaiveHostResolver::Refresh,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(host),
+                     network_anonymization_key, std::move(parameters)));
+}
+
+std::unique_ptr<HostResolver::ResolveHostRequest>
+NaiveHostResolver::CreatePinnedRequest(
+    const RequestHost& host,
+    const ResolveHostParameters& parameters) {
+  HostPortPair host_port;
+  if (const auto* scheme_host_port = absl::get_if<url::SchemeHostPort>(&host)) {
+    host_port = HostPortPair::FromSchemeHostPort(*scheme_host_port);
+  } else {
+    host_port = absl::get<HostPortPair>(host);
+  }
+  auto it = pins_.find(host_port.host());
+  if (it == pins_.end())
+    return nullptr;
+  // Other types, e.g. HTTPS records, are resolved as usual.
+  DnsQueryType type = parameters.dns_query_type;
+  if (type != DnsQueryType::UNSPECIFIED && type != DnsQueryType::A &&
+      type != DnsQueryType::AAAA) {
+    return nullptr;
+  }
+  std::vector<IPEndPoint> endpoints;
+  for (const IPAddress& address : it->second) {
+    if ((type == DnsQueryType::A && !address.IsIPv4()) ||
+        (type == DnsQueryType::AAAA && !address.IsIPv6())) {
+      continue;
+    }
+    endpoints.emplace_back(address, host_port.port());
+  }
+  return std::make_unique<PinnedRequest>(std::move(endpoints));
+}
+
+std::unique_ptr<HostResolver::ResolveHostRequest>
+NaiveHostResolver::CreateImplRequest(
+    const RequestHost& host,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    const NetLogWithSource& net_log,
+    const std::optional<ResolveHostParameters>& optional_parameters) {
+  if (const auto* scheme_host_port = absl::get_if<url::SchemeHostPort>(&host)) {
+    return impl_->CreateRequest(*scheme_host_port, network_anonymization_key,
+                                net_log, optional_parameters);
+  }
+  return impl_->CreateRequest(absl::get<HostPortPair>(host),
+                              network_anonymization_key, net_log,
+                              optional_parameters);
+}
+
+void NaiveHostResolver::Refresh(
+    const RequestHost& host,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    ResolveHostParameters parameters) {
+  RefreshKey key(host, network_anonymization_key, parameters.dns_query_type);
+  if (refreshes_.contains(key))
+    return;
+
+  // Speculative requests only fill the cache.
+  parameters.cache_usage = ResolveHostParameters::CacheUsage::DISALLOWED;
+  parameters.is_speculative = true;
+  auto request = CreateImplRequest(host, network_anonymization_key,
+                                   NetLogWithSource(), parameters);
+  // Unretained is safe as `this` owns the request.
+  int rv = request->Start(base::BindOnce(&NaiveHostResolver::OnRefreshComplete,
+                                         base::Unretained(this), key));
+  if (rv == ERR_IO_PENDING)
+    refreshes_.emplace(std::move(key), std::move(request));
+}
+
+void NaiveHostResolver::OnRefreshComplete(const RefreshKey& key, int result) {
+  refreshes_.erase(key);
+}
+
+}  // namespace net
@@ -0,0 +1,106 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_HOST_RESOLVER_H_
+#define NET_TOOLS_NAIVE_NAIVE_HOST_RESOLVER_H_
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/dns/host_resolver.h"
+#include "net/dns/public/dns_query_type.h"
+#include "net/log/net_log_with_source.h"
+#include "third_party/abseil-cpp/absl/types/variant.h"
+#include "url/scheme_host_port.h"
+
+namespace net {
+
+// Wraps the HostResolver of a network session so the names its connections
+// use most are answered from the host cache. A result that expired up to
+// `max_stale` ago is still served, while it is resolved again in the
+// background, and a result used within `prefetch_before` of its expiry is
+// resolved again before it expires. Names with pinned addresses, e.g. those
+// of the proxies, are answered with them without resolving.
+class NaiveHostResolver : public HostResolver {
+ public:
+  using Pins = std::map<std::string, std::vector<IPAddress>>;
+
+  NaiveHostResolver(std::unique_ptr<HostResolver> impl,
+                    base::TimeDelta max_stale,
+                    base::TimeDelta prefetch_before,
+                    Pins pins);
+  ~NaiveHostResolver() override;
+  NaiveHostResolver(const NaiveHostResolver&) = delete;
+  NaiveHostResolver& operator=(const NaiveHostResolver&) = delete;
+
+  // HostResolver:
+  void OnShutdown() override;
+  std::unique_ptr<ResolveHostRequest> CreateRequest(
+      url::SchemeHostPort host,
+      NetworkAnonymizationKey network_anonymization_key,
+      NetLogWithSource net_log,
+      std::optional<ResolveHostParameters> optional_parameters) override;
+  std::unique_ptr<ResolveHostRequest> CreateRequest(
+      const HostPortPair& host,
+      const NetworkAnonymizationKey& network_anonymization_key,
+      const NetLogWithSource& net_log,
+      const std::optional<ResolveHostParameters>& optional_parameters) override;
+  std::unique_ptr<ServiceEndpointRequest> CreateServiceEndpointRequest(
+      Host host,
+      NetworkAnonymizationKey network_anonymization_key,
+      NetLogWithSource net_log,
+      ResolveHostParameters parameters) override;
+  std::unique_ptr<ProbeRequest> CreateDohProbeRequest() override;
+  HostCache* GetHostCache() override;
+  base::Value::Dict GetDnsConfigAsValue() const override;
+  void SetRequestContext(URLRequestContext* request_context) override;
+  HostResolverManager* GetManagerForTesting() override;
+
+ private:
+  class RequestImpl;
+  class PinnedRequest;
+
+  using RequestHost = absl::variant<url::SchemeHostPort, HostPortPair>;
+  using RefreshKey =
+      std::tuple<RequestHost, NetworkAnonymizationKey, DnsQueryType>;
+
+  std::unique_ptr<ResolveHostRequest> CreateCachingRequest(
+      RequestHost host,
+      const NetworkAnonymizationKey& network_anonymization_key,
+      const NetLogWithSource& net_log,
+      const std::optional<ResolveHostParameters>& optional_parameters);
+  // Returns null if `host` is not pinned for the query.
+  std::unique_ptr<ResolveHostRequest> CreatePinnedRequest(
+      const RequestHost& host,
+      const ResolveHostParameters& parameters);
+  std::unique_ptr<ResolveHostRequest> CreateImplRequest(
+      const RequestHost& host,
+      const NetworkAnonymizationKey& network_anonymization_key,
+      const NetLogWithSource& net_log,
+      const std::optional<ResolveHostParameters>& optional_parameters);
+  // Resolves `host` again into the host cache, once at a time.
+  void Refresh(const RequestHost& host,
+               const NetworkAnonymizationKey& network_anonymization_key,
+               ResolveHostParameters parameters);
+  void OnRefreshComplete(const RefreshKey& key, int result);
+
+  std::unique_ptr<HostResolver> impl_;
+  const base::TimeDelta max_stale_;
+  const base::TimeDelta prefetch_before_;
+  const Pins pins_;
+  std::map<RefreshKey, std::unique_ptr<ResolveHostRequest>> refreshes_;
+
+  base::WeakPtrFactory<NaiveHostResolver> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_HOST_RESOLVER_H_
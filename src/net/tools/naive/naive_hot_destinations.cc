@@ -0,0 +1,124 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_hot_destinations.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/hash/hash.h"
+
+namespace net {
+
+NaiveHotDestinations::NaiveHotDestinations(size_t capacity,
+                                           uint32_t min_count)
+    : capacity_(capacity), min_count_(min_count) {
+  top_.reserve(capacity_);
+}
+
+NaiveHotDestinations::~NaiveHotDestinations() = default;
+
+std::array<size_t, NaiveHotDestinations::kDepth>
+NaiveHotDestinations::GetColumns(const HostPortPair& destination) const {
+  // The row indexes are derived from two halves of one hash, which is as
+  // good as independent hashes for a count-min sketch.
+  uint64_t hash = base::HashInts64(base::FastHash(destination.host()),
+                                   destination.port());
+  auto h1 = static_cast<uint32_t>(hash);
+  auto h2 = static_cast<uint32_t>(hash >> 32) | 1;
+  std::array<size_t, kDepth> columns;
+  for (size_t i = 0; i < kDepth; ++i) {
+    columns[i] = (h1 + i * h2) % kWidth;
+  }
+  return columns;
+}
+
+uint32_t NaiveHotDestinations::Increment(const HostPortPair& destination,
+                                         uint32_t amount) {
+  std::array<size_t, kDepth> columns = GetColumns(destination);
+  uint32_t estimate = UINT32_MAX;
+  for (size_t i = 0; i < kDepth; ++i) {
+    uint32_t& count = counts_[i][columns[i]];
+    count = amount < UINT32_MAX - count ? count + amount : UINT32_MAX;
+    estimate = std::min(estimate, count);
+  }
+  return estimate;
+}
+
+uint32_t NaiveHotDestinations::Estimate(
+    const HostPortPair& destination) const {
+  std::array<size_t, kDepth> columns = GetColumns(destination);
+  uint32_t estimate = UINT32_MAX;
+  for (size_t i = 0; i < kDepth; ++i) {
+    estimate = std::min(estimate, counts_[i][columns[i]]);
+  }
+  return estimate;
+}
+
+void NaiveHotDestinations::Add(const HostPortPair& destination,
+                               uint32_t amount) {
+  uint32_t estimate = Increment(destination, amount);
+  auto it = std::find_if(top_.begin(), top_.end(), [&](const Entry& entry) {
+    return entry.destination == destination;
+  });
+  if (it != top_.end()) {
+    it->estimate = estimate;
+    return;
+  }
+  if (top_.size() < capacity_) {
+    top_.push_back({destination, estimate});
+    return;
+  }
+  // Replaces the coldest once overtaken.
+  auto coldest = std::min_element(
+      top_.begin(), top_.end(), [](const Entry& a, const Entry& b) {
+        return a.estimate < b.estimate;
+      });
+  if (estimate > coldest->estimate) {
+    *coldest = {destination, estimate};
+  }
+}
+
+void NaiveHotDestinations::Decay() {
+  for (auto& row : counts_) {
+    for (uint32_t& count : row) {
+      count /= 2;
+    }
+  }
+  for (Entry& entry : top_) {
+    entry.estimate /= 2;
+  }
+  std::erase_if(top_, [](const Entry& entry) { return entry.estimate == 0; });
+}
+
+bool NaiveHotDestinations::IsHot(const HostPortPair& destination) const {
+  return std::any_of(top_.begin(), top_.end(), [&](const Entry& entry) {
+    return entry.destination == destination && entry.estimate >= min_count_;
+  });
+}
+
+std::vector<HostPortPair> NaiveHotDestinations::GetHot() const {
+  std::vector<HostPortPair> destinations;
+  for (auto& [destination, estimate] : GetTop()) {
+    if (estimate < min_count_)
+      break;
+    destinations.push_back(std::move(destination));
+  }
+  return destinations;
+}
+
+std::vector<std::pair<HostPortPair, uint32_t>> NaiveHotDestinations::GetTop()
+    const {
+  std::vector<std::pair<HostPortPair, uint32_t>> top;
+  top.reserve(top_.size());
+  for (const Entry& entry : top_) {
+    top.emplace_back(entry.destination, entry.estimate);
+  }
+  std::sort(top.begin(), top.end(), [](const auto& a, const auto& b) {
+    return a.second > b.second;
+  });
+  return top;
+}
+
+}  // namespace net
@@ -0,0 +1,66 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_HOT_DESTINATIONS_H_
+#define NET_TOOLS_NAIVE_NAIVE_HOT_DESTINATIONS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "net/base/host_port_pair.h"
+
+namespace net {
+
+// Finds the destinations taking the most connects in constant memory: a
+// count-min sketch estimates the connects of every destination, and the
+// few with the highest estimates are kept by name. Decay() halves the
+// counts, so the set follows the current load instead of the all-time one.
+class NaiveHotDestinations {
+ public:
+  // Keeps the `capacity` destinations with the highest estimates, and
+  // reports those of them with at least `min_count`.
+  NaiveHotDestinations(size_t capacity, uint32_t min_count);
+  NaiveHotDestinations(const NaiveHotDestinations&) = delete;
+  NaiveHotDestinations& operator=(const NaiveHotDestinations&) = delete;
+  ~NaiveHotDestinations();
+
+  // Counts a connect to `destination`, or `amount` of whatever is counted.
+  void Add(const HostPortPair& destination, uint32_t amount = 1);
+  void Decay();
+
+  bool IsHot(const HostPortPair& destination) const;
+  // Hottest first.
+  std::vector<HostPortPair> GetHot() const;
+  // The destinations kept with their estimates, hottest first, hot or not.
+  std::vector<std::pair<HostPortPair, uint32_t>> GetTop() const;
+  // Of any destination, kept or not, at least its count.
+  uint32_t Estimate(const HostPortPair& destination) const;
+
+ private:
+  struct Entry {
+    HostPortPair destination;
+    // As of its last connect, halved by each Decay() since.
+    uint32_t estimate;
+  };
+
+  static constexpr size_t kDepth = 4;
+  static constexpr size_t kWidth = 1024;
+
+  // Adds `amount` to the counters of `destination` in each row and returns
+  // its new estimate, the smallest of them.
+  uint32_t Increment(const HostPortPair& destination, uint32_t amount);
+  // The counters of `destination`, one in each row.
+  std::array<size_t, kDepth> GetColumns(const HostPortPair& destination) const;
+
+  const size_t capacity_;
+  const uint32_t min_count_;
+  std::array<std::array<uint32_t, kWidth>, kDepth> counts_ = {};
+  // At most `capacity_`, unordered.
+  std::vector<Entry> top_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_HOT_DESTINATIONS_H_
@@ -0,0 +1,821 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_https_server_session.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/net_errors.h"
+#include "net/socket/ssl_server_socket.h"
+#include "net/spdy/spdy_http_utils.h"
+#include "net/third_party/quiche/src/quiche/http2/adapter/data_source.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_proxy_delegate.h"
+
+namespace net {
+
+namespace {
+using http2::adapter::Header;
+using http2::adapter::HeaderRep;
+
+constexpr int kReadBufferSize = 32 * 1024;
+// Frames are serialized into the write buffer until it holds this much,
+// then wait for the pending write.
+constexpr size_t kMaxWriteBufferSize = 64 * 1024;
+// Tunnel payload queued on a stream before its writes wait.
+constexpr size_t kStreamSendBufferSize = 64 * 1024;
+// Clients open another session past it.
+constexpr uint32_t kMaxConcurrentStreams = 256;
+// The receive windows of Chromium's own sessions, so that uploads are not
+// held back by flow control on long paths. Payload is only acknowledged
+// once the tunnel reads it, which bounds what a session buffers.
+constexpr uint32_t kStreamWindowSize = 6 * 1024 * 1024;
+constexpr int kSessionWindowSize = 15 * 1024 * 1024;
+// Like HttpProxyServerSocket.
+constexpr int kMinPaddingSize = 30;
+constexpr int kMaxPaddingSize = kMinPaddingSize + 32;
+
+// Drops the consumed front of `buffer` once all of it is consumed.
+void ConsumeBuffer(std::string* buffer, size_t* offset, size_t size) {
+  *offset += size;
+  if (*offset == buffer->size()) {
+    buffer->clear();
+    *offset = 0;
+  }
+}
+}  // namespace
+
+struct NaiveHttpsServerSession::Stream {
+  // The request, until the tunnel is started.
+  std::string method;
+  std::string authority;
+  bool has_padding = false;
+  std::optional<std::string> padding_type_request;
+  bool bond_request = false;
+  bool request_complete = false;
+
+  // Null before the tunnel is started and once its socket is gone.
+  NaiveHttp2ServerStream* socket = nullptr;
+  // No tunnel reads what arrives on the stream anymore.
+  bool discard = false;
+  bool responded = false;
+  PaddingType padding_type = PaddingType::kNone;
+
+  // DATA received and not read by the tunnel yet.
+  std::string inbound;
+  size_t inbound_offset = 0;
+  bool inbound_fin = false;
+  // Written by the tunnel and not sent yet.
+  std::string outbound;
+  size_t outbound_offset = 0;
+  bool outbound_fin = false;
+};
+
+// Sends the payload written to a tunnel from its Stream.
+class NaiveHttpsServerSession::DataSource
+    : public http2::adapter::DataFrameSource {
+ public:
+  DataSource(NaiveHttpsServerSession* session, StreamId stream_id)
+      : session_(session), stream_id_(stream_id) {}
+  DataSource(const DataSource&) = delete;
+  DataSource& operator=(const DataSource&) = delete;
+
+  std::pair<int64_t, bool> SelectPayloadLength(size_t max_length) override {
+    Stream* stream = session_->FindStream(stream_id_);
+    if (!stream)
+      return {kError, false};
+    size_t available = stream->outbound.size() - stream->outbound_offset;
+    if (available == 0)
+      return {kBlocked, stream->outbound_fin};
+    size_t length = std::min(available, max_length);
+    return {length, stream->outbound_fin && length == available};
+  }
+
+  bool Send(std::string_view frame_header, size_t payload_length) override {
+    return session_->SendDataFrame(stream_id_, frame_header, payload_length);
+  }
+
+  bool send_fin() const override { return true; }
+
+ private:
+  NaiveHttpsServerSession* session_;
+  const StreamId stream_id_;
+};
+
+NaiveHttpsServerSession::NaiveHttpsServerSession(
+    std::unique_ptr<StreamSocket> socket,
+    bool cleartext,
+    base::TimeDelta handshake_timeout,
+    const std::vector<PaddingType>& supported_padding_types,
+    bool accept_bonds,
+    const NetworkTrafficAnnotationTag& traffic_annotation,
+    TunnelCallback tunnel_callback)
+    : socket_(std::move(socket)),
+      cleartext_(cleartext),
+      handshake_timeout_(handshake_timeout),
+      supported_padding_types_(supported_padding_types),
+      accept_bonds_(accept_bonds),
+      traffic_annotation_(traffic_annotation),
+      tunnel_callback_(std::move(tunnel_callback)) {}
+
+NaiveHttpsServerSession::~NaiveHttpsServerSession() = default;
+
+int NaiveHttpsServerSession::Handshake(CompletionOnceCallback callback) {
+  if (cleartext_)
+    return OK;
+  auto* ssl_socket = static_cast<SSLServerSocket*>(socket_.get());
+  // Unretained is safe because the socket is owned by this.
+  int rv = ssl_socket->Handshake(base::BindOnce(
+      &NaiveHttpsServerSession::OnHandshakeComplete, base::Unretained(this)));
+  if (rv != ERR_IO_PENDING)
+    return rv;
+  callback_ = std::move(callback);
+  if (handshake_timeout_.is_positive()) {
+    handshake_timer_.Start(FROM_HERE, handshake_timeout_, this,
+                           &NaiveHttpsServerSession::OnHandshakeTimeout);
+  }
+  return ERR_IO_PENDING;
+}
+
+void NaiveHttpsServerSession::OnHandshakeComplete(int result) {
+  handshake_timer_.Stop();
+  std::move(callback_).Run(result);
+}
+
+void NaiveHttpsServerSession::OnHandshakeTimeout() {
+  // Cancels the handshake.
+  socket_.reset();
+  std::move(callback_).Run(ERR_TIMED_OUT);
+}
+
+int NaiveHttpsServerSession::Run(CompletionOnceCallback callback) {
+  if (!cleartext_ && socket_->GetNegotiatedProtocol() != kProtoHTTP2) {
+    tunnel_callback_.Run(std::move(socket_));
+    return OK;
+  }
+
+  http2::adapter::OgHttp2Adapter::Options options;
+  options.perspective = http2::adapter::Perspective::kServer;
+  options.should_index_header = &ShouldIndexHeader;
+  adapter_ = http2::adapter::OgHttp2Adapter::Create(*this, options);
+  const http2::adapter::Http2Setting settings[] = {
+      {http2::adapter::MAX_CONCURRENT_STREAMS, kMaxConcurrentStreams},
+      {http2::adapter::INITIAL_WINDOW_SIZE, kStreamWindowSize},
+  };
+  adapter_->SubmitSettings(settings);
+  adapter_->SubmitWindowUpdate(
+      http2::adapter::kConnectionStreamId,
+      kSessionWindowSize - http2::adapter::kInitialFlowControlWindowSize);
+  read_buffer_ = base::MakeRefCounted<IOBufferWithSize>(kReadBufferSize);
+
+  callback_ = std::move(callback);
+  // Completes asynchronously even if the connection is already closed.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveHttpsServerSession::Serve,
+                                weak_ptr_factory_.GetWeakPtr()));
+  return ERR_IO_PENDING;
+}
+
+void NaiveHttpsServerSession::Serve() {
+  Send();
+  DoRead();
+}
+
+void NaiveHttpsServerSession::DoRead() {
+  while (!closed_) {
+    // Unretained is safe because the socket is owned by this.
+    int rv = socket_->Read(
+        read_buffer_.get(), read_buffer_->size(),
+        base::BindOnce(&NaiveHttpsServerSession::OnReadComplete,
+                       base::Unretained(this)));
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (!HandleReadResult(rv))
+      return;
+  }
+}
+
+void NaiveHttpsServerSession::OnReadComplete(int result) {
+  if (HandleReadResult(result))
+    DoRead();
+}
+
+bool NaiveHttpsServerSession::HandleReadResult(int result) {
+  if (result <= 0) {
+    Close(result == 0 ? ERR_CONNECTION_CLOSED : result);
+    return false;
+  }
+  int64_t rv =
+      adapter_->ProcessBytes(std::string_view(read_buffer_->data(), result));
+  StartTunnels();
+  // Sends the GOAWAY of a connection error before closing.
+  Send();
+  if (closed_)
+    return false;
+  if (rv < 0) {
+    Close(ERR_HTTP2_PROTOCOL_ERROR);
+    return false;
+  }
+  if (!adapter_->want_read() && !adapter_->want_write()) {
+    Close(OK);
+    return false;
+  }
+  return true;
+}
+
+void NaiveHttpsServerSession::StartTunnels() {
+  std::vector<StreamId> new_tunnels = std::move(new_tunnels_);
+  new_tunnels_.clear();
+  for (StreamId stream_id : new_tunnels) {
+    Stream* stream = FindStream(stream_id);
+    // Reset in the same read.
+    if (!stream)
+      continue;
+    // Not a proxy client.
+    if (stream->method != "CONNECT") {
+      RespondAndClose(stream_id, "405");
+      continue;
+    }
+    HostPortPair request_endpoint = HostPortPair::FromString(stream->authority);
+    if (request_endpoint.IsEmpty()) {
+      RespondAndClose(stream_id, "400");
+      continue;
+    }
+    std::optional<std::string_view> padding_type_request;
+    if (stream->padding_type_request) {
+      padding_type_request = *stream->padding_type_request;
+    }
+    std::optional<PaddingType> padding_type = NegotiatePaddingType(
+        stream->has_padding, padding_type_request, supported_padding_types_);
+    if (!padding_type.has_value()) {
+      RespondAndClose(stream_id, "400");
+      continue;
+    }
+    stream->padding_type = *padding_type;
+    stream->method.clear();
+    stream->authority.clear();
+
+    auto socket = std::make_unique<NaiveHttp2ServerStream>(
+        weak_ptr_factory_.GetWeakPtr(), stream_id, request_endpoint,
+        *padding_type, socket_->NetLog());
+    stream->socket = socket.get();
+    tunnel_callback_.Run(std::move(socket));
+  }
+}
+
+void NaiveHttpsServerSession::RespondAndClose(StreamId stream_id,
+                                              std::string_view status) {
+  Stream* stream = FindStream(stream_id);
+  stream->discard = true;
+  stream->responded = true;
+  const Header headers[] = {
+      {HeaderRep(std::string(":status")), HeaderRep(std::string(status))},
+  };
+  adapter_->SubmitResponse(stream_id, headers, /*data_source=*/nullptr,
+                           /*end_stream=*/true);
+}
+
+void NaiveHttpsServerSession::Send() {
+  if (closed_)
+    return;
+  if (!sending_) {
+    sending_ = true;
+    adapter_->Send();
+    sending_ = false;
+  }
+  if (!pending_write_)
+    DoWrite();
+}
+
+void NaiveHttpsServerSession::DoWrite() {
+  while (!closed_) {
+    if (!pending_write_) {
+      if (write_buffer_.empty())
+        return;
+      size_t size = write_buffer_.size();
+      pending_write_ = base::MakeRefCounted<DrainableIOBuffer>(
+          base::MakeRefCounted<StringIOBuffer>(std::move(write_buffer_)),
+          size);
+      write_buffer_.clear();
+    }
+    // Unretained is safe because the socket is owned by this.
+    int rv = socket_->Write(
+        pending_write_.get(), pending_write_->BytesRemaining(),
+        base::BindOnce(&NaiveHttpsServerSession::OnWriteComplete,
+                       base::Unretained(this)),
+        traffic_annotation_);
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (rv < 0) {
+      Close(rv);
+      return;
+    }
+    pending_write_->DidConsume(rv);
+    if (pending_write_->BytesRemaining() == 0) {
+      pending_write_ = nullptr;
+      // Frames held back by the full buffer.
+      if (!sending_ && adapter_->want_write()) {
+        sending_ = true;
+        adapter_->Send();
+        sending_ = false;
+      }
+    }
+  }
+}
+
+void NaiveHttpsServerSession::OnWriteComplete(int result) {
+  if (result < 0) {
+    Close(result);
+    return;
+  }
+  pending_write_->DidConsume(result);
+  if (pending_write_->BytesRemaining() > 0) {
+    DoWrite();
+    return;
+  }
+  pending_write_ = nullptr;
+  Send();
+}
+
+bool NaiveHttpsServerSession::SendDataFrame(StreamId stream_id,
+                                            std::string_view frame_header,
+                                            size_t payload_length) {
+  if (write_buffer_.size() >= kMaxWriteBufferSize)
+    return false;
+  // Found by DataSource::SelectPayloadLength().
+  Stream* stream = FindStream(stream_id);
+  write_buffer_.append(frame_header);
+  write_buffer_.append(stream->outbound, stream->outbound_offset,
+                       payload_length);
+  ConsumeBuffer(&stream->outbound, &stream->outbound_offset, payload_length);
+  if (stream->outbound.size() - stream->outbound_offset <
+      kStreamSendBufferSize) {
+    NotifyStream(stream);
+  }
+  return true;
+}
+
+void NaiveHttpsServerSession::Close(int error) {
+  if (closed_)
+    return;
+  closed_ = true;
+  // The tunnels fail from then on, and those waiting on the session fail
+  // right away.
+  for (const auto& [stream_id, stream] : streams_) {
+    NotifyStream(stream.get());
+  }
+  weak_ptr_factory_.InvalidateWeakPtrs();
+  socket_->Disconnect();
+  std::move(callback_).Run(error);
+}
+
+NaiveHttpsServerSession::Stream* NaiveHttpsServerSession::FindStream(
+    StreamId stream_id) const {
+  auto it = streams_.find(stream_id);
+  return it == streams_.end() ? nullptr : it->second.get();
+}
+
+void NaiveHttpsServerSession::NotifyStream(Stream* stream) {
+  if (stream->socket)
+    stream->socket->NotifySoon();
+}
+
+int NaiveHttpsServerSession::SubmitTunnelResponse(StreamId stream_id) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream)
+    return ERR_CONNECTION_CLOSED;
+  std::string padding(base::RandInt(kMinPaddingSize, kMaxPaddingSize), '\0');
+  FillNonindexHeaderValue(base::RandUint64(), padding.data(), padding.size());
+  std::vector<Header> headers;
+  headers.emplace_back(HeaderRep(std::string(":status")),
+                       HeaderRep(std::string("200")));
+  headers.emplace_back(HeaderRep(std::string(kPaddingHeader)),
+                       HeaderRep(std::move(padding)));
+  // Clients not asking for a type infer it from the padding header.
+  if (stream->padding_type_request) {
+    headers.emplace_back(
+        HeaderRep(std::string(kPaddingTypeReplyHeader)),
+        HeaderRep(std::string(ToString(stream->padding_type))));
+    stream->padding_type_request.reset();
+  }
+  if (stream->bond_request) {
+    headers.emplace_back(
+        HeaderRep(std::string(kBondReplyHeader)),
+        HeaderRep(base::NumberToString(NaiveBondSocket::kMaxMembers)));
+  }
+  adapter_->SubmitResponse(stream_id, headers,
+                           std::make_unique<DataSource>(this, stream_id),
+                           /*end_stream=*/false);
+  stream->responded = true;
+  Send();
+  return OK;
+}
+
+int NaiveHttpsServerSession::ReadStream(StreamId stream_id,
+                                        IOBuffer* buf,
+                                        int buf_len) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream)
+    return ERR_CONNECTION_CLOSED;
+  size_t available = stream->inbound.size() - stream->inbound_offset;
+  if (available == 0)
+    return stream->inbound_fin ? 0 : ERR_IO_PENDING;
+  size_t size = std::min(available, static_cast<size_t>(buf_len));
+  std::memcpy(buf->data(), stream->inbound.data() + stream->inbound_offset,
+              size);
+  ConsumeBuffer(&stream->inbound, &stream->inbound_offset, size);
+  // Opens the windows once enough is read.
+  adapter_->MarkDataConsumedForStream(stream_id, size);
+  Send();
+  return size;
+}
+
+int NaiveHttpsServerSession::WriteStream(StreamId stream_id,
+                                         IOBuffer* buf,
+                                         int buf_len) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream || stream->outbound_fin)
+    return ERR_CONNECTION_CLOSED;
+  if (stream->outbound.size() - stream->outbound_offset >=
+      kStreamSendBufferSize) {
+    return ERR_IO_PENDING;
+  }
+  stream->outbound.erase(0, stream->outbound_offset);
+  stream->outbound_offset = 0;
+  stream->outbound.append(buf->data(), buf_len);
+  adapter_->ResumeStream(stream_id);
+  Send();
+  return buf_len;
+}
+
+void NaiveHttpsServerSession::CloseStream(StreamId stream_id) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream)
+    return;
+  stream->socket = nullptr;
+  stream->discard = true;
+  adapter_->MarkDataConsumedForStream(
+      stream_id, stream->inbound.size() - stream->inbound_offset);
+  stream->inbound.clear();
+  stream->inbound_offset = 0;
+  if (stream->responded) {
+    stream->outbound_fin = true;
+    adapter_->ResumeStream(stream_id);
+  } else {
+    adapter_->SubmitRst(stream_id,
+                        http2::adapter::Http2ErrorCode::REFUSED_STREAM);
+  }
+  Send();
+}
+
+int NaiveHttpsServerSession::ShutdownStream(StreamId stream_id) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream)
+    return ERR_CONNECTION_CLOSED;
+  if (!stream->outbound_fin) {
+    stream->outbound_fin = true;
+    adapter_->ResumeStream(stream_id);
+    Send();
+  }
+  return OK;
+}
+
+int NaiveHttpsServerSession::GetPeerAddress(IPEndPoint* address) const {
+  return socket_->GetPeerAddress(address);
+}
+
+int NaiveHttpsServerSession::GetLocalAddress(IPEndPoint* address) const {
+  return socket_->GetLocalAddress(address);
+}
+
+int64_t NaiveHttpsServerSession::OnReadyToSend(std::string_view serialized) {
+  if (write_buffer_.size() >= kMaxWriteBufferSize)
+    return kSendBlocked;
+  write_buffer_.append(serialized);
+  return serialized.size();
+}
+
+void NaiveHttpsServerSession::OnConnectionError(ConnectionError error) {
+  // Seen as the failed ProcessBytes().
+}
+
+bool NaiveHttpsServerSession::OnFrameHeader(StreamId stream_id,
+                                            size_t length,
+                                            uint8_t type,
+                                            uint8_t flags) {
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnBeginHeadersForStream(StreamId stream_id) {
+  // Trailers go to the stream of the request.
+  std::unique_ptr<Stream>& stream = streams_[stream_id];
+  if (!stream)
+    stream = std::make_unique<Stream>();
+  return true;
+}
+
+http2::adapter::Http2VisitorInterface::OnHeaderResult
+NaiveHttpsServerSession::OnHeaderForStream(StreamId stream_id,
+                                           std::string_view key,
+                                           std::string_view value) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream || stream->request_complete)
+    return HEADER_OK;
+  if (key == ":method") {
+    stream->method = value;
+  } else if (key == ":authority") {
+    stream->authority = value;
+  } else if (key == kPaddingHeader) {
+    stream->has_padding = true;
+  } else if (key == kPaddingTypeRequestHeader) {
+    stream->padding_type_request = std::string(value);
+  } else if (key == kBondRequestHeader) {
+    stream->bond_request = accept_bonds_;
+  }
+  return HEADER_OK;
+}
+
+bool NaiveHttpsServerSession::OnEndHeadersForStream(StreamId stream_id) {
+  Stream* stream = FindStream(stream_id);
+  if (stream && !stream->request_complete) {
+    stream->request_complete = true;
+    // Started once the read is processed, as the tunnel calls back into the
+    // adapter.
+    new_tunnels_.push_back(stream_id);
+  }
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnBeginDataForStream(StreamId stream_id,
+                                                   size_t payload_length) {
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnDataPaddingLength(StreamId stream_id,
+                                                  size_t padding_length) {
+  adapter_->MarkDataConsumedForStream(stream_id, padding_length);
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnDataForStream(StreamId stream_id,
+                                              std::string_view data) {
+  Stream* stream = FindStream(stream_id);
+  if (!stream || stream->discard) {
+    adapter_->MarkDataConsumedForStream(stream_id, data.size());
+    return true;
+  }
+  stream->inbound.append(data);
+  NotifyStream(stream);
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnEndStream(StreamId stream_id) {
+  Stream* stream = FindStream(stream_id);
+  if (stream) {
+    stream->inbound_fin = true;
+    NotifyStream(stream);
+  }
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnCloseStream(
+    StreamId stream_id,
+    http2::adapter::Http2ErrorCode error_code) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end())
+    return true;
+  // Its tunnel fails from then on.
+  NotifyStream(it->second.get());
+  streams_.erase(it);
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnGoAway(
+    StreamId last_accepted_stream_id,
+    http2::adapter::Http2ErrorCode error_code,
+    std::string_view opaque_data) {
+  return true;
+}
+
+int NaiveHttpsServerSession::OnBeforeFrameSent(uint8_t frame_type,
+                                               StreamId stream_id,
+                                               size_t length,
+                                               uint8_t flags) {
+  return 0;
+}
+
+int NaiveHttpsServerSession::OnFrameSent(uint8_t frame_type,
+                                         StreamId stream_id,
+                                         size_t length,
+                                         uint8_t flags,
+                                         uint32_t error_code) {
+  return 0;
+}
+
+bool NaiveHttpsServerSession::OnInvalidFrame(StreamId stream_id,
+                                             InvalidFrameError error) {
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnMetadataForStream(StreamId stream_id,
+                                                  std::string_view metadata) {
+  return true;
+}
+
+bool NaiveHttpsServerSession::OnMetadataEndForStream(StreamId stream_id) {
+  return true;
+}
+
+NaiveHttp2ServerStream::NaiveHttp2ServerStream(
+    base::WeakPtr<NaiveHttpsServerSession> session,
+    NaiveHttpsServerSession::StreamId stream_id,
+    const HostPortPair& request_endpoint,
+    PaddingType padding_type,
+    const NetLogWithSource& net_log)
+    : session_(std::move(session)),
+      stream_id_(stream_id),
+      request_endpoint_(request_endpoint),
+      padding_type_(padding_type),
+      net_log_(net_log) {}
+
+NaiveHttp2ServerStream::~NaiveHttp2ServerStream() {
+  Disconnect();
+}
+
+int NaiveHttp2ServerStream::Connect(CompletionOnceCallback callback) {
+  if (connected_)
+    return OK;
+  if (!session_)
+    return ERR_CONNECTION_CLOSED;
+  int rv = session_->SubmitTunnelResponse(stream_id_);
+  connected_ = rv == OK;
+  return rv;
+}
+
+void NaiveHttp2ServerStream::Disconnect() {
+  connected_ = false;
+  if (session_) {
+    session_->CloseStream(stream_id_);
+    session_.reset();
+  }
+  read_buf_ = nullptr;
+  read_callback_.Reset();
+  write_buf_ = nullptr;
+  write_callback_.Reset();
+}
+
+bool NaiveHttp2ServerStream::IsConnected() const {
+  return connected_ && session_ && session_->FindStream(stream_id_);
+}
+
+bool NaiveHttp2ServerStream::IsConnectedAndIdle() const {
+  if (!IsConnected())
+    return false;
+  const NaiveHttpsServerSession::Stream* stream =
+      session_->FindStream(stream_id_);
+  return stream->inbound.size() == stream->inbound_offset;
+}
+
+const NetLogWithSource& NaiveHttp2ServerStream::NetLog() const {
+  return net_log_;
+}
+
+bool NaiveHttp2ServerStream::WasEverUsed() const {
+  return was_ever_used_;
+}
+
+NextProto NaiveHttp2ServerStream::GetNegotiatedProtocol() const {
+  return kProtoHTTP2;
+}
+
+bool NaiveHttp2ServerStream::GetSSLInfo(SSLInfo* ssl_info) {
+  return false;
+}
+
+int64_t NaiveHttp2ServerStream::GetTotalReceivedBytes() const {
+  return total_received_bytes_;
+}
+
+void NaiveHttp2ServerStream::ApplySocketTag(const SocketTag& tag) {
+  // Shares the TLS connection with the other streams.
+}
+
+int NaiveHttp2ServerStream::ShutdownWrite() {
+  DCHECK(!write_callback_);
+  if (!IsConnected())
+    return ERR_SOCKET_NOT_CONNECTED;
+  return session_->ShutdownStream(stream_id_);
+}
+
+int NaiveHttp2ServerStream::Read(IOBuffer* buf,
+                                 int buf_len,
+                                 CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  DCHECK(callback);
+  int rv = DoRead(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    read_buf_ = buf;
+    read_buf_len_ = buf_len;
+    read_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveHttp2ServerStream::Write(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  DCHECK(!write_callback_);
+  DCHECK(callback);
+  int rv = DoWrite(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    write_buf_ = buf;
+    write_buf_len_ = buf_len;
+    write_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveHttp2ServerStream::SetReceiveBufferSize(int32_t size) {
+  // Like SpdyProxyClientSocket, as the TLS connection is shared.
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveHttp2ServerStream::SetSendBufferSize(int32_t size) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveHttp2ServerStream::GetPeerAddress(IPEndPoint* address) const {
+  if (!session_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  return session_->GetPeerAddress(address);
+}
+
+int NaiveHttp2ServerStream::GetLocalAddress(IPEndPoint* address) const {
+  if (!session_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  return session_->GetLocalAddress(address);
+}
+
+void NaiveHttp2ServerStream::NotifySoon() {
+  if (notify_pending_ || (!read_callback_ && !write_callback_))
+    return;
+  notify_pending_ = true;
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveHttp2ServerStream::DoPendingIO,
+                                weak_ptr_factory_.GetWeakPtr()));
+}
+
+void NaiveHttp2ServerStream::DoPendingIO() {
+  notify_pending_ = false;
+  // The callbacks may disconnect this.
+  base::WeakPtr<NaiveHttp2ServerStream> self = weak_ptr_factory_.GetWeakPtr();
+  if (write_callback_) {
+    int rv = DoWrite(write_buf_.get(), write_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      write_buf_ = nullptr;
+      std::move(write_callback_).Run(rv);
+      if (!self)
+        return;
+    }
+  }
+  if (read_callback_) {
+    int rv = DoRead(read_buf_.get(), read_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      read_buf_ = nullptr;
+      std::move(read_callback_).Run(rv);
+    }
+  }
+}
+
+int NaiveHttp2ServerStream::DoRead(IOBuffer* buf, int buf_len) {
+  if (!session_)
+    return ERR_CONNECTION_CLOSED;
+  int rv = session_->ReadStream(stream_id_, buf, buf_len);
+  if (rv > 0) {
+    was_ever_used_ = true;
+    total_received_bytes_ += rv;
+  }
+  return rv;
+}
+
+int NaiveHttp2ServerStream::DoWrite(IOBuffer* buf, int buf_len) {
+  if (!session_)
+    return ERR_CONNECTION_CLOSED;
+  int rv = session_->WriteStream(stream_id_, buf, buf_len);
+  if (rv > 0)
+    was_ever_used_ = true;
+  return rv;
+}
+
+}  // namespace net
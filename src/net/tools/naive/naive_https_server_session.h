@@ -0,0 +1,271 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_HTTPS_SERVER_SESSION_H_
+#define NET_TOOLS_NAIVE_NAIVE_HTTPS_SERVER_SESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/io_buffer.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/stream_socket.h"
+#include "net/third_party/quiche/src/quiche/http2/adapter/http2_visitor_interface.h"
+#include "net/third_party/quiche/src/quiche/http2/adapter/oghttp2_adapter.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+class NaiveHttp2ServerStream;
+class SSLServerSocket;
+struct NetworkTrafficAnnotationTag;
+
+// Serves a client connection of an https:// listener in place of a TLS and
+// HTTP/2 terminating frontend. Once the TLS handshake negotiated h2, each
+// CONNECT stream is a tunnel handed over as a NaiveHttp2ServerStream, with
+// padding negotiated like HttpProxyServerSocket does. With http/1.1 the TLS
+// socket itself is handed over for the HTTP/1.1 CONNECT. With `accept_bonds`
+// the h2 tunnel responses tell clients asking that NaiveBondJoiner joins
+// their bonds.
+//
+// A `cleartext` session serves a client connection of an h2c:// listener,
+// which speaks h2 with prior knowledge on the transport itself, so that
+// local clients opening many tunnels share one connection.
+class NaiveHttpsServerSession : public http2::adapter::Http2VisitorInterface {
+ public:
+  using StreamId = http2::adapter::Http2StreamId;
+  using TunnelCallback =
+      base::RepeatingCallback<void(std::unique_ptr<StreamSocket>)>;
+
+  // `socket` is an SSLServerSocket unless `cleartext`.
+  NaiveHttpsServerSession(
+      std::unique_ptr<StreamSocket> socket,
+      bool cleartext,
+      base::TimeDelta handshake_timeout,
+      const std::vector<PaddingType>& supported_padding_types,
+      bool accept_bonds,
+      const NetworkTrafficAnnotationTag& traffic_annotation,
+      TunnelCallback tunnel_callback);
+  ~NaiveHttpsServerSession() override;
+  NaiveHttpsServerSession(const NaiveHttpsServerSession&) = delete;
+  NaiveHttpsServerSession& operator=(const NaiveHttpsServerSession&) = delete;
+
+  // Fails with ERR_TIMED_OUT past `handshake_timeout`. Completes at once
+  // for a cleartext session.
+  int Handshake(CompletionOnceCallback callback);
+  // After a successful Handshake(). Completes once the connection is closed
+  // and the tunnels still open on it have failed.
+  int Run(CompletionOnceCallback callback);
+
+  // http2::adapter::Http2VisitorInterface implementation.
+  int64_t OnReadyToSend(std::string_view serialized) override;
+  void OnConnectionError(ConnectionError error) override;
+  bool OnFrameHeader(StreamId stream_id,
+                     size_t length,
+                     uint8_t type,
+                     uint8_t flags) override;
+  void OnSettingsStart() override {}
+  void OnSetting(http2::adapter::Http2Setting setting) override {}
+  void OnSettingsEnd() override {}
+  void OnSettingsAck() override {}
+  bool OnBeginHeadersForStream(StreamId stream_id) override;
+  OnHeaderResult OnHeaderForStream(StreamId stream_id,
+                                   std::string_view key,
+                                   std::string_view value) override;
+  bool OnEndHeadersForStream(StreamId stream_id) override;
+  bool OnBeginDataForStream(StreamId stream_id, size_t payload_length) override;
+  bool OnDataPaddingLength(StreamId stream_id, size_t padding_length) override;
+  bool OnDataForStream(StreamId stream_id, std::string_view data) override;
+  bool OnEndStream(StreamId stream_id) override;
+  void OnRstStream(StreamId stream_id,
+                   http2::adapter::Http2ErrorCode error_code) override {}
+  bool OnCloseStream(StreamId stream_id,
+                     http2::adapter::Http2ErrorCode error_code) override;
+  void OnPriorityForStream(StreamId stream_id,
+                           StreamId parent_stream_id,
+                           int weight,
+                           bool exclusive) override {}
+  void OnPing(http2::adapter::Http2PingId ping_id, bool is_ack) override {}
+  void OnPushPromiseForStream(StreamId stream_id,
+                              StreamId promised_stream_id) override {}
+  bool OnGoAway(StreamId last_accepted_stream_id,
+                http2::adapter::Http2ErrorCode error_code,
+                std::string_view opaque_data) override;
+  void OnWindowUpdate(StreamId stream_id, int window_increment) override {}
+  int OnBeforeFrameSent(uint8_t frame_type,
+                        StreamId stream_id,
+                        size_t length,
+                        uint8_t flags) override;
+  int OnFrameSent(uint8_t frame_type,
+                  StreamId stream_id,
+                  size_t length,
+                  uint8_t flags,
+                  uint32_t error_code) override;
+  bool OnInvalidFrame(StreamId stream_id, InvalidFrameError error) override;
+  void OnBeginMetadataForStream(StreamId stream_id,
+                                size_t payload_length) override {}
+  bool OnMetadataForStream(StreamId stream_id,
+                           std::string_view metadata) override;
+  bool OnMetadataEndForStream(StreamId stream_id) override;
+  void OnErrorDebug(std::string_view message) override {}
+
+ private:
+  friend class NaiveHttp2ServerStream;
+  struct Stream;
+  class DataSource;
+
+  void OnHandshakeComplete(int result);
+  void OnHandshakeTimeout();
+
+  void Serve();
+  void DoRead();
+  void OnReadComplete(int result);
+  // Returns false once the session is closed.
+  bool HandleReadResult(int result);
+  // Hands over the tunnels whose requests arrived in the last read.
+  void StartTunnels();
+  void RespondAndClose(StreamId stream_id, std::string_view status);
+
+  // Serializes pending frames into `write_buffer_`, unless already doing so.
+  void Send();
+  void DoWrite();
+  void OnWriteComplete(int result);
+  // Called by DataSource. Returns false if the write buffer is full.
+  bool SendDataFrame(StreamId stream_id,
+                     std::string_view frame_header,
+                     size_t payload_length);
+  // Fails the tunnels left and completes Run() with `error`.
+  void Close(int error);
+
+  Stream* FindStream(StreamId stream_id) const;
+  // Wakes the NaiveHttp2ServerStream of `stream` if it waits on it.
+  void NotifyStream(Stream* stream);
+
+  // Called by NaiveHttp2ServerStream.
+  int SubmitTunnelResponse(StreamId stream_id);
+  int ReadStream(StreamId stream_id, IOBuffer* buf, int buf_len);
+  int WriteStream(StreamId stream_id, IOBuffer* buf, int buf_len);
+  // Ends the stream once what was written to it is sent.
+  void CloseStream(StreamId stream_id);
+  // Sends END_STREAM once what was written to it is sent, reads going on.
+  int ShutdownStream(StreamId stream_id);
+  int GetPeerAddress(IPEndPoint* address) const;
+  int GetLocalAddress(IPEndPoint* address) const;
+
+  std::unique_ptr<StreamSocket> socket_;
+  const bool cleartext_;
+  const base::TimeDelta handshake_timeout_;
+  const std::vector<PaddingType> supported_padding_types_;
+  const bool accept_bonds_;
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+  const TunnelCallback tunnel_callback_;
+
+  CompletionOnceCallback callback_;
+  base::OneShotTimer handshake_timer_;
+
+  // Declared before `adapter_`, which owns the DataSources referring to it.
+  std::map<StreamId, std::unique_ptr<Stream>> streams_;
+  std::unique_ptr<http2::adapter::OgHttp2Adapter> adapter_;
+  std::vector<StreamId> new_tunnels_;
+
+  scoped_refptr<IOBufferWithSize> read_buffer_;
+  // Frames serialized while a write is pending, written together next.
+  std::string write_buffer_;
+  scoped_refptr<DrainableIOBuffer> pending_write_;
+  bool sending_ = false;
+  bool closed_ = false;
+
+  base::WeakPtrFactory<NaiveHttpsServerSession> weak_ptr_factory_{this};
+};
+
+// One CONNECT stream of a NaiveHttpsServerSession. Connect() sends the
+// response. Fails with ERR_CONNECTION_CLOSED once the session is gone.
+class NaiveHttp2ServerStream : public StreamSocket {
+ public:
+  NaiveHttp2ServerStream(base::WeakPtr<NaiveHttpsServerSession> session,
+                         NaiveHttpsServerSession::StreamId stream_id,
+                         const HostPortPair& request_endpoint,
+                         PaddingType padding_type,
+                         const NetLogWithSource& net_log);
+  NaiveHttp2ServerStream(const NaiveHttp2ServerStream&) = delete;
+  NaiveHttp2ServerStream& operator=(const NaiveHttp2ServerStream&) = delete;
+
+  // On destruction Disconnect() is called.
+  ~NaiveHttp2ServerStream() override;
+
+  const HostPortPair& request_endpoint() const { return request_endpoint_; }
+  PaddingType padding_type() const { return padding_type_; }
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override;
+  void Disconnect() override;
+  bool IsConnected() const override;
+  bool IsConnectedAndIdle() const override;
+  const NetLogWithSource& NetLog() const override;
+  bool WasEverUsed() const override;
+  NextProto GetNegotiatedProtocol() const override;
+  bool GetSSLInfo(SSLInfo* ssl_info) override;
+  int64_t GetTotalReceivedBytes() const override;
+  void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override;
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override;
+  int SetReceiveBufferSize(int32_t size) override;
+  int SetSendBufferSize(int32_t size) override;
+  int GetPeerAddress(IPEndPoint* address) const override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+
+ private:
+  friend class NaiveHttpsServerSession;
+
+  // Retries the pending read and write in a new task, as the session wakes
+  // the stream from within its HTTP/2 adapter.
+  void NotifySoon();
+  void DoPendingIO();
+
+  int DoRead(IOBuffer* buf, int buf_len);
+  int DoWrite(IOBuffer* buf, int buf_len);
+
+  base::WeakPtr<NaiveHttpsServerSession> session_;
+  const NaiveHttpsServerSession::StreamId stream_id_;
+  const HostPortPair request_endpoint_;
+  const PaddingType padding_type_;
+  NetLogWithSource net_log_;
+
+  bool connected_ = false;
+  bool was_ever_used_ = false;
+  int64_t total_received_bytes_ = 0;
+
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_ = 0;
+  CompletionOnceCallback read_callback_;
+  scoped_refptr<IOBuffer> write_buf_;
+  int write_buf_len_ = 0;
+  CompletionOnceCallback write_callback_;
+  bool notify_pending_ = false;
+
+  base::WeakPtrFactory<NaiveHttp2ServerStream> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_HTTPS_SERVER_SESSION_H_
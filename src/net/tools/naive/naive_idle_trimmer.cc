@@ -0,0 +1,101 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_idle_trimmer.h"
+
+#include <algorithm>
+
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "net/dns/host_cache.h"
+#include "net/ssl/ssl_client_session_cache.h"
+#include "net/tools/naive/naive_buffer_pool.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_wakeup.h"
+#include "partition_alloc/partition_alloc_buildflags.h"
+#include "partition_alloc/partition_alloc_config.h"
+
+#if PA_BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+#include "partition_alloc/memory_reclaimer.h"
+#if PA_CONFIG(THREAD_CACHE_SUPPORTED)
+#include "partition_alloc/thread_cache.h"
+#endif
+#endif
+
+namespace net {
+
+namespace {
+// Kept through a trim, so the first connections after it still find the
+// destinations and proxies they most likely use.
+constexpr size_t kMinFreeBytes = 256 * 1024;
+constexpr size_t kMinHostCacheEntries = 64;
+constexpr size_t kMinSessionCacheEntries = 16;
+
+constexpr base::TimeDelta kMinCheckInterval = base::Seconds(1);
+constexpr base::TimeDelta kMaxCheckInterval = base::Seconds(15);
+}  // namespace
+
+NaiveIdleTrimmer::NaiveIdleTrimmer(
+    base::TimeDelta idle_time,
+    size_t max_connections,
+    base::RepeatingCallback<size_t()> connection_count,
+    HostCache* host_cache,
+    SSLClientSessionCache* session_cache)
+    : idle_time_(idle_time),
+      max_connections_(max_connections),
+      connection_count_(std::move(connection_count)),
+      host_cache_(host_cache),
+      session_cache_(session_cache) {
+  // Unretained is safe because the timer is owned by this.
+  check_timer_.Start(
+      FROM_HERE,
+      AlignToWakeupPeriod(
+          std::clamp(idle_time_ / 4, kMinCheckInterval, kMaxCheckInterval)),
+      base::BindRepeating(&NaiveIdleTrimmer::Check, base::Unretained(this)));
+}
+
+NaiveIdleTrimmer::~NaiveIdleTrimmer() = default;
+
+void NaiveIdleTrimmer::Check() {
+  if (connection_count_.Run() > max_connections_) {
+    idle_since_ = base::TimeTicks();
+    trimmed_ = false;
+    return;
+  }
+  base::TimeTicks now = base::TimeTicks::Now();
+  if (idle_since_.is_null()) {
+    idle_since_ = now;
+  }
+  if (!trimmed_ && now - idle_since_ >= idle_time_) {
+    trimmed_ = true;
+    Trim();
+  }
+}
+
+void NaiveIdleTrimmer::Trim() {
+  NaiveBufferPool* buffer_pool = NaiveBufferPool::GetForCurrentThread();
+  size_t free_bytes = buffer_pool->free_bytes();
+  buffer_pool->Trim(kMinFreeBytes);
+  if (host_cache_) {
+    host_cache_->Shrink(kMinHostCacheEntries);
+  }
+  session_cache_->Shrink(kMinSessionCacheEntries);
+
+#if PA_BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+#if PA_CONFIG(THREAD_CACHE_SUPPORTED)
+  // Purges the cache of this thread now and those of the others at their
+  // next allocation.
+  partition_alloc::ThreadCacheRegistry::Instance().PurgeAll();
+#endif
+  // Process-wide, decommits the empty slot spans of all partitions, so the
+  // trimmers of the other threads mostly find nothing left.
+  partition_alloc::MemoryReclaimer::Instance()->ReclaimAll();
+#endif
+
+  ++NaiveMetrics::GetForCurrentThread()->idle_trims;
+  VLOG(1) << "Trimmed after idle: "
+          << free_bytes - buffer_pool->free_bytes()
+          << " bytes of relay buffers freed";
+}
+
+}  // namespace net
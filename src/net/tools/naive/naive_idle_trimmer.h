@@ -0,0 +1,55 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_IDLE_TRIMMER_H_
+#define NET_TOOLS_NAIVE_NAIVE_IDLE_TRIMMER_H_
+
+#include <cstddef>
+
+#include "base/functional/callback.h"
+#include "base/memory/raw_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+class HostCache;
+class SSLClientSessionCache;
+
+// Gives the memory left behind by a burst of connections back to the system
+// once an IO thread has served at most `max_connections` for `idle_time`:
+// the idle relay buffers of its pool, the host and TLS session caches of its
+// network session down to a floor, its allocator thread cache, and the empty
+// pages of PartitionAlloc. Trims once per idle period, and again only after
+// the connections rose above `max_connections` in between.
+class NaiveIdleTrimmer {
+ public:
+  // `connection_count` returns the open connections of the thread.
+  // `host_cache` may be null.
+  NaiveIdleTrimmer(base::TimeDelta idle_time,
+                   size_t max_connections,
+                   base::RepeatingCallback<size_t()> connection_count,
+                   HostCache* host_cache,
+                   SSLClientSessionCache* session_cache);
+  ~NaiveIdleTrimmer();
+  NaiveIdleTrimmer(const NaiveIdleTrimmer&) = delete;
+  NaiveIdleTrimmer& operator=(const NaiveIdleTrimmer&) = delete;
+
+ private:
+  void Check();
+  void Trim();
+
+  const base::TimeDelta idle_time_;
+  const size_t max_connections_;
+  const base::RepeatingCallback<size_t()> connection_count_;
+  const raw_ptr<HostCache> host_cache_;
+  const raw_ptr<SSLClientSessionCache> session_cache_;
+
+  // Null while over `max_connections_`.
+  base::TimeTicks idle_since_;
+  bool trimmed_ = false;
+  base::MetronomeTimer check_timer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_IDLE_TRIMMER_H_
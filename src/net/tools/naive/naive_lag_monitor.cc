@@ -0,0 +1,71 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_lag_monitor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/tools/naive/naive_thread_local.h"
+#include "net/tools/naive/naive_wakeup.h"
+
+namespace net {
+
+NaiveLagMonitor::NaiveLagMonitor() = default;
+
+NaiveLagMonitor::~NaiveLagMonitor() = default;
+
+// static
+NaiveLagMonitor* NaiveLagMonitor::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveLagMonitor>();
+}
+
+void NaiveLagMonitor::Start(base::TimeDelta threshold, const Policy& policy) {
+  threshold_ = threshold;
+  policy_ = policy;
+  // Unretained is safe because the timer is owned by this.
+  probe_timer_.Start(
+      FROM_HERE, AlignToWakeupPeriod(kProbeInterval),
+      base::BindRepeating(&NaiveLagMonitor::Probe, base::Unretained(this)));
+}
+
+base::CallbackListSubscription NaiveLagMonitor::AddOverloadEndCallback(
+    base::RepeatingClosure callback) {
+  return overload_end_callbacks_.Add(std::move(callback));
+}
+
+base::TimeDelta NaiveLagMonitor::TakePeakLag() {
+  return std::exchange(peak_lag_, lag_);
+}
+
+void NaiveLagMonitor::Probe() {
+  // A probe still queued already says the thread is behind.
+  if (probe_pending_)
+    return;
+  probe_pending_ = true;
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveLagMonitor::OnProbe,
+                                weak_ptr_factory_.GetWeakPtr(),
+                                base::TimeTicks::Now()));
+}
+
+void NaiveLagMonitor::OnProbe(base::TimeTicks posted) {
+  probe_pending_ = false;
+  lag_ = base::TimeTicks::Now() - posted;
+  peak_lag_ = std::max(peak_lag_, lag_);
+  if (!overloaded_ && lag_ >= threshold_) {
+    overloaded_ = true;
+    ++overloads_;
+    LOG(WARNING) << "IO thread overloaded, tasks wait "
+                 << lag_.InMilliseconds() << " ms";
+  } else if (overloaded_ && lag_ < threshold_ / 2) {
+    overloaded_ = false;
+    LOG(INFO) << "IO thread no longer overloaded";
+    overload_end_callbacks_.Notify();
+  }
+}
+
+}  // namespace net
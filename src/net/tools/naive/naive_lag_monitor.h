@@ -0,0 +1,89 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_LAG_MONITOR_H_
+#define NET_TOOLS_NAIVE_NAIVE_LAG_MONITOR_H_
+
+#include <cstdint>
+
+#include "base/callback_list.h"
+#include "base/functional/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+// Measures how long the tasks posted to an IO thread wait before they run,
+// by posting a probe every kProbeInterval, and puts the thread in overload
+// while the lag stays at or above a threshold, until it falls below half
+// of it. Overload sheds new work by the policy set: listeners hold off
+// accepts or close the clients they accept, and relays yield after a
+// fraction of their budget, so the open connections keep their latency.
+class NaiveLagMonitor {
+ public:
+  static constexpr base::TimeDelta kProbeInterval = base::Milliseconds(100);
+  // Of the relay yield budget left while overloaded.
+  static constexpr int kOverloadYieldDivisor = 4;
+
+  struct Policy {
+    bool pause_accept = false;
+    bool reject_handshakes = false;
+    bool shrink_yield = false;
+  };
+
+  NaiveLagMonitor();
+  NaiveLagMonitor(const NaiveLagMonitor&) = delete;
+  NaiveLagMonitor& operator=(const NaiveLagMonitor&) = delete;
+  ~NaiveLagMonitor();
+
+  // Returns the monitor of the calling thread, creating it on first use.
+  // It probes only once started.
+  static NaiveLagMonitor* GetForCurrentThread();
+
+  void Start(base::TimeDelta threshold, const Policy& policy);
+  bool started() const { return probe_timer_.IsRunning(); }
+
+  bool overloaded() const { return overloaded_; }
+  bool ShouldPauseAccept() const {
+    return overloaded_ && policy_.pause_accept;
+  }
+  bool ShouldRejectHandshakes() const {
+    return overloaded_ && policy_.reject_handshakes;
+  }
+  int yield_divisor() const {
+    return overloaded_ && policy_.shrink_yield ? kOverloadYieldDivisor : 1;
+  }
+
+  // Runs `callback` each time the overload ends.
+  base::CallbackListSubscription AddOverloadEndCallback(
+      base::RepeatingClosure callback);
+
+  // Of the last probe.
+  base::TimeDelta lag() const { return lag_; }
+  // The most since the last call.
+  base::TimeDelta TakePeakLag();
+  uint64_t overloads() const { return overloads_; }
+  // Clients closed by the policy, counted by the listeners.
+  void AddReject() { ++rejects_; }
+  uint64_t rejects() const { return rejects_; }
+
+ private:
+  void Probe();
+  void OnProbe(base::TimeTicks posted);
+
+  base::TimeDelta threshold_;
+  Policy policy_;
+  bool overloaded_ = false;
+  bool probe_pending_ = false;
+  base::TimeDelta lag_;
+  base::TimeDelta peak_lag_;
+  uint64_t overloads_ = 0;
+  uint64_t rejects_ = 0;
+  base::RepeatingClosureList overload_end_callbacks_;
+  base::MetronomeTimer probe_timer_;
+  base::WeakPtrFactory<NaiveLagMonitor> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_LAG_MONITOR_H_
@@ -0,0 +1,216 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_log_sink.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+#include "base/check.h"
+#include "base/containers/span.h"
+#include "base/files/file.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/task/thread_pool.h"
+#include "base/thread_annotations.h"
+#include "base/time/time.h"
+#include "third_party/abseil-cpp/absl/base/attributes.h"
+
+namespace net {
+
+namespace {
+// Messages beyond this are dropped until the writer catches up.
+constexpr size_t kMaxQueuedBytes = 1024 * 1024;
+// Call sites sharing a slot share its limit.
+constexpr size_t kNumSites = 256;
+
+// Set while the handler runs, so that logging from the task posting or the
+// writing falls through to the logging library instead of recursing.
+ABSL_CONST_INIT thread_local bool in_handler = false;
+
+class Sink {
+ public:
+  Sink(const base::FilePath& log_file, bool async, int rate_limit)
+      : async_(async), rate_limit_(rate_limit) {
+    if (!log_file.empty()) {
+      file_ = base::File(
+          log_file, base::File::FLAG_OPEN_ALWAYS | base::File::FLAG_APPEND);
+    }
+    if (async_) {
+      task_runner_ = base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::USER_VISIBLE,
+           base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN});
+    }
+  }
+  Sink(const Sink&) = delete;
+  Sink& operator=(const Sink&) = delete;
+
+  // Returns whether the message was taken over.
+  bool OnMessage(int severity,
+                 const char* file,
+                 int line,
+                 const std::string& str) {
+    if (severity >= logging::LOGGING_FATAL) {
+      Flush();
+      return false;
+    }
+
+    std::string note;
+    {
+      base::AutoLock lock(lock_);
+      if (rate_limit_ > 0 && !Admit(file, line, &note))
+        return true;
+      // Errors are written right away, as the process may exit after them.
+      if (async_ && severity < logging::LOGGING_ERROR) {
+        Enqueue(note, str);
+        return true;
+      }
+    }
+    // Keeps the order with the queued messages.
+    Flush();
+    if (!note.empty())
+      Write(note);
+    return false;
+  }
+
+  void Flush() {
+    if (async_)
+      Drain();
+  }
+
+ private:
+  struct Site {
+    const char* file = nullptr;
+    int line = 0;
+    int64_t window = 0;
+    int count = 0;
+    int suppressed = 0;
+  };
+
+  // Returns whether the call site may log now. `note` gets the count of its
+  // messages suppressed before.
+  bool Admit(const char* file, int line, std::string* note)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    size_t index =
+        (std::hash<const char*>()(file) ^ static_cast<size_t>(line)) %
+        kNumSites;
+    Site& site = sites_[index];
+    int64_t window = (base::TimeTicks::Now() - base::TimeTicks()).InSeconds();
+    if (site.file != file || site.line != line) {
+      site = Site{file, line, window, 0, 0};
+    } else if (site.window != window) {
+      if (site.suppressed > 0) {
+        *note = base::StringPrintf("(%d messages from %s:%d suppressed)\n",
+                                   site.suppressed, file, line);
+      }
+      site.window = window;
+      site.count = 0;
+      site.suppressed = 0;
+    }
+    if (site.count >= rate_limit_) {
+      ++site.suppressed;
+      return false;
+    }
+    ++site.count;
+    return true;
+  }
+
+  void Enqueue(const std::string& note, const std::string& str)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    if (pending_.size() + note.size() + str.size() > kMaxQueuedBytes) {
+      ++dropped_;
+      return;
+    }
+    pending_ += note;
+    pending_ += str;
+    if (!drain_posted_) {
+      drain_posted_ = true;
+      // Logging from PostTask() falls through, see `in_handler`.
+      task_runner_->PostTask(
+          FROM_HERE, base::BindOnce(&Sink::Drain, base::Unretained(this)));
+    }
+  }
+
+  void Drain() {
+    std::string text;
+    {
+      base::AutoLock lock(lock_);
+      text.swap(pending_);
+      drain_posted_ = false;
+      if (dropped_ > 0) {
+        text += base::StringPrintf("(%d log messages dropped)\n", dropped_);
+        dropped_ = 0;
+      }
+    }
+    if (!text.empty())
+      Write(text);
+  }
+
+  void Write(const std::string& text) {
+    base::AutoLock lock(write_lock_);
+    if (file_.IsValid()) {
+      file_.WriteAtCurrentPosAndCheck(base::as_byte_span(text));
+    } else {
+      fwrite(text.data(), 1, text.size(), stderr);
+      fflush(stderr);
+    }
+  }
+
+  const bool async_;
+  const int rate_limit_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  base::Lock lock_;
+  std::string pending_ GUARDED_BY(lock_);
+  bool drain_posted_ GUARDED_BY(lock_) = false;
+  int dropped_ GUARDED_BY(lock_) = 0;
+  std::array<Site, kNumSites> sites_ GUARDED_BY(lock_);
+
+  // Serializes the writes of the drain sequence and Flush().
+  base::Lock write_lock_;
+  base::File file_ GUARDED_BY(write_lock_);
+};
+
+Sink* g_sink = nullptr;
+
+bool HandleLogMessage(int severity,
+                      const char* file,
+                      int line,
+                      size_t message_start,
+                      const std::string& str) {
+  if (in_handler)
+    return false;
+  in_handler = true;
+  bool handled = g_sink->OnMessage(severity, file, line, str);
+  in_handler = false;
+  return handled;
+}
+}  // namespace
+
+// static
+void NaiveLogSink::Install(const base::FilePath& log_file,
+                           bool async,
+                           int rate_limit) {
+  DCHECK(!g_sink);
+  if (!async && rate_limit <= 0)
+    return;
+  // Intentionally leaked, as messages may be logged until exit.
+  g_sink = new Sink(log_file, async, rate_limit);
+  logging::SetLogMessageHandler(&HandleLogMessage);
+}
+
+// static
+void NaiveLogSink::Flush() {
+  if (g_sink)
+    g_sink->Flush();
+}
+
+}  // namespace net
@@ -0,0 +1,32 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_LOG_SINK_H_
+#define NET_TOOLS_NAIVE_NAIVE_LOG_SINK_H_
+
+#include "base/files/file_path.h"
+
+namespace net {
+
+// Takes log messages over from the logging library through its message
+// handler, to rate limit them per call site and to write them off the
+// IO threads.
+class NaiveLogSink {
+ public:
+  // Installs the sink once logging::InitLogging() has set up the
+  // destination, `log_file` or stderr if empty. If `async`, messages are
+  // queued and written by a thread pool sequence, dropping them once too
+  // much is queued, while errors are still written right away. Each call
+  // site logs at most `rate_limit` messages a second if positive, with a
+  // count of those suppressed once it may log again. Fatal messages are
+  // neither queued nor limited.
+  static void Install(const base::FilePath& log_file,
+                      bool async,
+                      int rate_limit);
+
+  // Writes out the queued messages on the calling thread, for exit.
+  static void Flush();
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_LOG_SINK_H_
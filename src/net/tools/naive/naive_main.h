@@ -0,0 +1,18 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_MAIN_H_
+#define NET_TOOLS_NAIVE_NAIVE_MAIN_H_
+
+namespace net {
+
+class NaiveEmbedding;
+
+// Runs naive with the command line `argv` on the calling thread, which
+// becomes its main IO thread, and returns the exit status. `embedding` is
+// null for the naive executable, otherwise the host of an embed:// listener
+// that stops it.
+int NaiveMain(int argc, char* argv[], NaiveEmbedding* embedding);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_MAIN_H_
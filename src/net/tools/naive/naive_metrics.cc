@@ -0,0 +1,817 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_metrics.h"
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#include "base/notreached.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "net/tools/naive/naive_thread_local.h"
+#include "net/tools/naive/naive_user_table.h"
+
+namespace net {
+
+namespace {
+std::string EscapeLabelValue(std::string_view value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void AppendHeader(std::string& out,
+                  const char* name,
+                  const char* type,
+                  const char* help) {
+  base::StringAppendF(&out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name,
+                      type);
+}
+
+void AppendSample(std::string& out,
+                  std::string_view name,
+                  std::string_view labels,
+                  std::string_view value) {
+  out += name;
+  if (!labels.empty()) {
+    out += '{';
+    out += labels;
+    out += '}';
+  }
+  out += ' ';
+  out += value;
+  out += '\n';
+}
+
+void AppendSample(std::string& out,
+                  std::string_view name,
+                  std::string_view labels,
+                  uint64_t value) {
+  AppendSample(out, name, labels, base::NumberToString(value));
+}
+
+void AppendHistogram(std::string& out,
+                     std::string_view name,
+                     std::string_view labels,
+                     const NaiveLatencyHistogram& histogram) {
+  std::string prefix = labels.empty() ? "" : std::string(labels) + ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i <= NaiveLatencyHistogram::kBucketBoundsMs.size(); ++i) {
+    cumulative += histogram.bucket_count(i);
+    std::string le =
+        i < NaiveLatencyHistogram::kBucketBoundsMs.size()
+            ? base::NumberToString(
+                  NaiveLatencyHistogram::kBucketBoundsMs[i] / 1000.0)
+            : "+Inf";
+    AppendSample(out, std::string(name) + "_bucket",
+                 prefix + "le=\"" + le + "\"", cumulative);
+  }
+  AppendSample(out, std::string(name) + "_sum", labels,
+               base::NumberToString(histogram.sum().InSecondsF()));
+  AppendSample(out, std::string(name) + "_count", labels, histogram.count());
+}
+
+// The buckets are cumulated up to the highest one holding values, as the
+// rest would repeat the count.
+void AppendSizeHistogram(std::string& out,
+                         std::string_view name,
+                         std::string_view labels,
+                         const NaiveStatsHistogram::Snapshot& histogram) {
+  std::string prefix = std::string(labels) + ",le=\"";
+  size_t last = 0;
+  for (size_t i = 0; i < NaiveStatsHistogram::kNumBuckets - 1; ++i) {
+    if (histogram.counts[i])
+      last = i;
+  }
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i <= last; ++i) {
+    cumulative += histogram.counts[i];
+    // Bucket `i` holds values less than its bound, i.e. at most one less.
+    AppendSample(
+        out, std::string(name) + "_bucket",
+        prefix +
+            base::NumberToString(NaiveStatsHistogram::GetBucketBound(i) - 1) +
+            "\"",
+        cumulative);
+  }
+  AppendSample(out, std::string(name) + "_bucket", prefix + "+Inf\"",
+               histogram.count);
+  AppendSample(out, std::string(name) + "_sum", labels, histogram.sum);
+  AppendSample(out, std::string(name) + "_count", labels, histogram.count);
+}
+
+void AppendPaddingCounter(
+    std::string& out,
+    const char* name,
+    const char* help,
+    uint64_t (NaivePaddingStats::*values)[NaivePaddingStats::kNumOps],
+    const std::vector<std::string>& listener_labels,
+    const std::vector<NaiveMetricsSnapshot::Listener>& listeners) {
+  AppendHeader(out, name, "counter", help);
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (!listeners[i].served)
+      continue;
+    const NaivePaddingStats& padding = listeners[i].padding;
+    AppendSample(out, name, listener_labels[i] + ",op=\"read\"",
+                 (padding.*values)[NaivePaddingStats::kRead]);
+    AppendSample(out, name, listener_labels[i] + ",op=\"write\"",
+                 (padding.*values)[NaivePaddingStats::kWrite]);
+  }
+}
+}  // namespace
+
+void NaiveLatencyHistogram::Add(base::TimeDelta latency) {
+  int64_t ms = latency.InMillisecondsRoundedUp();
+  auto it = std::lower_bound(kBucketBoundsMs.begin(), kBucketBoundsMs.end(),
+                             ms);
+  ++counts_[it - kBucketBoundsMs.begin()];
+  ++count_;
+  sum_ += latency;
+}
+
+void NaiveLatencyHistogram::Merge(const NaiveLatencyHistogram& other) {
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+// static
+NaiveMetrics* NaiveMetrics::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveMetrics>();
+}
+
+void NaiveMetrics::Merge(const NaiveMetrics& other) {
+  client_handshake_latency.Merge(other.client_handshake_latency);
+  server_connect_latency.Merge(other.server_connect_latency);
+  connect_errors += other.connect_errors;
+  for (int i = 0; i < kNumDirections; ++i) {
+    bytes_relayed[i] += other.bytes_relayed[i];
+  }
+  relay_batches += other.relay_batches;
+  relay_full_batches += other.relay_full_batches;
+  relay_resumes += other.relay_resumes;
+  idle_trims += other.idle_trims;
+}
+
+void NaiveRelayReadStats::AddTo(Snapshot* snapshot) const {
+  for (int i = 0; i < kNumDirections; ++i) {
+    read_bytes[i].AddTo(&snapshot->read_bytes[i]);
+  }
+}
+
+// static
+const char* NaiveTcpInfoStats::GetRoleName(Role role) {
+  switch (role) {
+    case kClient:
+      return "client";
+    case kEgress:
+      return "egress";
+    case kTunnel:
+      return "tunnel";
+    case kNumRoles:
+      break;
+  }
+  NOTREACHED();
+}
+
+void NaiveTcpInfoStats::AddTo(Snapshot* snapshot) const {
+  for (int i = 0; i < kNumRoles; ++i) {
+    rtt_us[i].AddTo(&snapshot->rtt_us[i]);
+    retransmit_permille[i].AddTo(&snapshot->retransmit_permille[i]);
+    cwnd_segments[i].AddTo(&snapshot->cwnd_segments[i]);
+    delivery_rate[i].AddTo(&snapshot->delivery_rate[i]);
+  }
+}
+
+void NaivePaddingStats::Merge(const NaivePaddingStats& other) {
+  for (int i = 0; i < kNumOps; ++i) {
+    frames[i] += other.frames[i];
+    payload_bytes[i] += other.payload_bytes[i];
+    padding_bytes[i] += other.padding_bytes[i];
+    header_bytes[i] += other.header_bytes[i];
+  }
+  split_writes += other.split_writes;
+}
+
+NaiveMetricsSnapshot::Listener::Listener() = default;
+
+NaiveMetricsSnapshot::Listener::Listener(const Listener&) = default;
+
+NaiveMetricsSnapshot::Listener::~Listener() = default;
+
+// static
+const char* NaiveMemoryUsage::GetKindName(Kind kind) {
+  switch (kind) {
+    case kRelayBuffers:
+      return "relay";
+    case kPaddingBuffers:
+      return "padding";
+    case kHandshakeBuffers:
+      return "handshake";
+    case kTunnelBacklog:
+      return "tunnel";
+    case kSocketBuffers:
+      return "socket";
+    case kNumKinds:
+      break;
+  }
+  NOTREACHED();
+}
+
+void NaiveMemoryUsage::Add(const NaiveMemoryUsage& other) {
+  for (int i = 0; i < kNumKinds; ++i) {
+    bytes[i] += other.bytes[i];
+  }
+}
+
+size_t NaiveMemoryUsage::total() const {
+  size_t sum = 0;
+  for (size_t kind_bytes : bytes) {
+    sum += kind_bytes;
+  }
+  return sum;
+}
+
+NaiveMetricsSnapshot::NaiveMetricsSnapshot() = default;
+
+NaiveMetricsSnapshot::NaiveMetricsSnapshot(const NaiveMetricsSnapshot&) =
+    default;
+
+NaiveMetricsSnapshot::NaiveMetricsSnapshot(NaiveMetricsSnapshot&&) = default;
+
+NaiveMetricsSnapshot::~NaiveMetricsSnapshot() = default;
+
+std::string FormatPrometheusMetrics(
+    const std::vector<std::string>& listener_names,
+    const NaiveUserTable* user_table,
+    const std::vector<NaiveMetricsSnapshot>& snapshots) {
+  std::vector<std::string> listener_labels;
+  for (const std::string& name : listener_names) {
+    listener_labels.push_back("listener=\"" + EscapeLabelValue(name) + "\"");
+  }
+  std::vector<NaiveMetricsSnapshot::Listener> listeners(listener_names.size());
+  NaiveMetrics metrics;
+  NaiveMetricsSnapshot totals;
+  for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+    for (size_t i = 0;
+         i < listeners.size() && i < snapshot.listeners.size(); ++i) {
+      const NaiveMetricsSnapshot::Listener& listener = snapshot.listeners[i];
+      if (!listener.served)
+        continue;
+      listeners[i].served = true;
+      listeners[i].active_connections += listener.active_connections;
+      listeners[i].accepts += listener.accepts;
+      listeners[i].pending_handshakes += listener.pending_handshakes;
+      listeners[i].rejects += listener.rejects;
+      listeners[i].accept_paused += listener.accept_paused;
+      listeners[i].padding.Merge(listener.padding);
+    }
+    metrics.Merge(snapshot.metrics);
+    totals.buffer_pool_hits += snapshot.buffer_pool_hits;
+    totals.buffer_pool_misses += snapshot.buffer_pool_misses;
+    totals.buffer_pool_free_count += snapshot.buffer_pool_free_count;
+    totals.buffer_pool_free_bytes += snapshot.buffer_pool_free_bytes;
+    totals.relay_queued += snapshot.relay_queued;
+    totals.has_lag = totals.has_lag || snapshot.has_lag;
+    totals.overloads += snapshot.overloads;
+    totals.overload_rejects += snapshot.overload_rejects;
+    totals.negative_cache_entries += snapshot.negative_cache_entries;
+    totals.negative_cache_hits += snapshot.negative_cache_hits;
+    totals.negative_cache_insertions += snapshot.negative_cache_insertions;
+    totals.connection_memory.Add(snapshot.connection_memory);
+    totals.connection_memory_max =
+        std::max(totals.connection_memory_max, snapshot.connection_memory_max);
+    if (snapshot.has_process_memory) {
+      totals.has_process_memory = true;
+      totals.relay_buffer_bytes = snapshot.relay_buffer_bytes;
+      totals.relay_buffer_peak_bytes = snapshot.relay_buffer_peak_bytes;
+      totals.malloc_bytes = snapshot.malloc_bytes;
+      totals.relay_reads = snapshot.relay_reads;
+      totals.tcp_info = snapshot.tcp_info;
+      totals.egress_sources = snapshot.egress_sources;
+      totals.ephemeral_ports = snapshot.ephemeral_ports;
+    }
+    totals.mptcp_connections += snapshot.mptcp_connections;
+    totals.mptcp_fallbacks += snapshot.mptcp_fallbacks;
+    totals.mptcp_subflows += snapshot.mptcp_subflows;
+    totals.h2_header_frames += snapshot.h2_header_frames;
+    totals.h2_header_uncompressed_bytes +=
+        snapshot.h2_header_uncompressed_bytes;
+    totals.h2_header_bytes += snapshot.h2_header_bytes;
+    if (snapshot.has_resolver) {
+      totals.has_resolver = true;
+      totals.resolutions += snapshot.resolutions;
+      totals.resolution_overwrites += snapshot.resolution_overwrites;
+      totals.resolution_drops += snapshot.resolution_drops;
+    }
+  }
+
+  std::string out;
+  AppendHeader(out, "naive_connections_active", "gauge",
+               "Open client connections.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_connections_active", listener_labels[i],
+                   listeners[i].active_connections);
+    }
+  }
+  AppendHeader(out, "naive_accepts_total", "counter",
+               "Accepted client connections.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_accepts_total", listener_labels[i],
+                   listeners[i].accepts);
+    }
+  }
+  AppendHeader(out, "naive_handshakes_pending", "gauge",
+               "Connections in their handshake or upstream connect.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_handshakes_pending", listener_labels[i],
+                   listeners[i].pending_handshakes);
+    }
+  }
+  AppendHeader(out, "naive_connections_rejected_total", "counter",
+               "Client connections dropped at a limit.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_connections_rejected_total", listener_labels[i],
+                   listeners[i].rejects);
+    }
+  }
+  AppendHeader(out, "naive_accept_paused", "gauge",
+               "Workers holding off accepts at a connection limit.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_accept_paused", listener_labels[i],
+                   listeners[i].accept_paused);
+    }
+  }
+  AppendHeader(out, "naive_tunnel_session_connections", "gauge",
+               "Open connections by tunnel session, under each "
+               "listener sharing it.");
+  for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+    for (size_t i = 0;
+         i < listeners.size() && i < snapshot.listeners.size(); ++i) {
+      const std::vector<int>& sessions =
+          snapshot.listeners[i].tunnel_session_connections;
+      for (size_t j = 0; j < sessions.size(); ++j) {
+        AppendSample(out, "naive_tunnel_session_connections",
+                     base::StringPrintf("%s,worker=\"%d\",session=\"%zu\"",
+                                        listener_labels[i].c_str(),
+                                        snapshot.worker, j),
+                     sessions[j]);
+      }
+    }
+  }
+
+  AppendHeader(out, "naive_connect_latency_seconds", "histogram",
+               "Connect latency by phase.");
+  AppendHistogram(out, "naive_connect_latency_seconds", "phase=\"client\"",
+                  metrics.client_handshake_latency);
+  AppendHistogram(out, "naive_connect_latency_seconds", "phase=\"server\"",
+                  metrics.server_connect_latency);
+  AppendHeader(out, "naive_connect_errors_total", "counter",
+               "Failed client handshakes and upstream connects.");
+  AppendSample(out, "naive_connect_errors_total", "", metrics.connect_errors);
+  AppendHeader(out, "naive_negative_cache_entries", "gauge",
+               "Destinations cached as unreachable, expired ones included.");
+  AppendSample(out, "naive_negative_cache_entries", "",
+               totals.negative_cache_entries);
+  AppendHeader(out, "naive_negative_cache_insertions_total", "counter",
+               "Upstream connects failed as unreachable and cached.");
+  AppendSample(out, "naive_negative_cache_insertions_total", "",
+               totals.negative_cache_insertions);
+  AppendHeader(out, "naive_negative_cache_hits_total", "counter",
+               "Connections failed from the negative cache.");
+  AppendSample(out, "naive_negative_cache_hits_total", "",
+               totals.negative_cache_hits);
+
+  // Each worker sees a share of the destinations, summing them is left to
+  // the queries.
+  std::vector<std::vector<std::string>> destination_labels;
+  for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+    std::vector<std::string>& labels = destination_labels.emplace_back();
+    for (const NaiveHeavyHitters::Entry& entry : snapshot.heavy_hitters) {
+      labels.push_back(base::StringPrintf(
+          "worker=\"%d\",destination=\"%s\"", snapshot.worker,
+          EscapeLabelValue(entry.destination.ToString()).c_str()));
+    }
+  }
+  AppendHeader(out, "naive_destination_connects", "gauge",
+               "Estimated connects to the busiest destinations, halved every "
+               "minute.");
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    for (size_t j = 0; j < snapshots[i].heavy_hitters.size(); ++j) {
+      AppendSample(out, "naive_destination_connects", destination_labels[i][j],
+                   uint64_t{snapshots[i].heavy_hitters[j].connects});
+    }
+  }
+  AppendHeader(out, "naive_destination_bytes", "gauge",
+               "Estimated bytes relayed with the busiest destinations by "
+               "closed connections, halved every minute.");
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    for (size_t j = 0; j < snapshots[i].heavy_hitters.size(); ++j) {
+      AppendSample(out, "naive_destination_bytes", destination_labels[i][j],
+                   snapshots[i].heavy_hitters[j].bytes);
+    }
+  }
+
+  AppendHeader(out, "naive_relay_bytes_total", "counter",
+               "Bytes relayed by direction.");
+  AppendSample(out, "naive_relay_bytes_total", "direction=\"upload\"",
+               metrics.bytes_relayed[kClient]);
+  AppendSample(out, "naive_relay_bytes_total", "direction=\"download\"",
+               metrics.bytes_relayed[kServer]);
+  AppendPaddingCounter(out, "naive_padding_frames_total",
+                       "Padded frames of closed connections.",
+                       &NaivePaddingStats::frames, listener_labels, listeners);
+  AppendPaddingCounter(out, "naive_padding_payload_bytes_total",
+                       "Payload in padded frames of closed connections.",
+                       &NaivePaddingStats::payload_bytes, listener_labels,
+                       listeners);
+  AppendPaddingCounter(out, "naive_padding_bytes_total",
+                       "Padding in padded frames of closed connections.",
+                       &NaivePaddingStats::padding_bytes, listener_labels,
+                       listeners);
+  AppendPaddingCounter(out, "naive_padding_header_bytes_total",
+                       "Headers of padded frames of closed connections.",
+                       &NaivePaddingStats::header_bytes, listener_labels,
+                       listeners);
+  AppendHeader(out, "naive_padding_split_writes_total", "counter",
+               "Padded writes split into several transport writes.");
+  for (size_t i = 0; i < listeners.size(); ++i) {
+    if (listeners[i].served) {
+      AppendSample(out, "naive_padding_split_writes_total", listener_labels[i],
+                   listeners[i].padding.split_writes);
+    }
+  }
+  AppendHeader(out, "naive_relay_batches_total", "counter",
+               "Batches of yielded relay directions by whether they resumed "
+               "all queued.");
+  AppendSample(out, "naive_relay_batches_total", "result=\"drained\"",
+               metrics.relay_batches - metrics.relay_full_batches);
+  AppendSample(out, "naive_relay_batches_total", "result=\"full\"",
+               metrics.relay_full_batches);
+  AppendHeader(out, "naive_relay_resumes_total", "counter",
+               "Yielded relay directions resumed.");
+  AppendSample(out, "naive_relay_resumes_total", "", metrics.relay_resumes);
+  AppendHeader(out, "naive_relay_queued", "gauge",
+               "Yielded relay directions waiting for a batch.");
+  AppendSample(out, "naive_relay_queued", "", totals.relay_queued);
+
+  if (totals.has_lag) {
+    AppendHeader(out, "naive_loop_lag_seconds", "gauge",
+                 "Time the last lag probe waited in the IO thread's queue.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_lag) {
+        AppendSample(out, "naive_loop_lag_seconds",
+                     base::StringPrintf("worker=\"%d\"", snapshot.worker),
+                     base::NumberToString(snapshot.loop_lag.InSecondsF()));
+      }
+    }
+    AppendHeader(out, "naive_loop_lag_peak_seconds", "gauge",
+                 "Most time a lag probe waited since the last scrape.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_lag) {
+        AppendSample(
+            out, "naive_loop_lag_peak_seconds",
+            base::StringPrintf("worker=\"%d\"", snapshot.worker),
+            base::NumberToString(snapshot.loop_lag_peak.InSecondsF()));
+      }
+    }
+    AppendHeader(out, "naive_overloaded", "gauge",
+                 "1 while the IO thread sheds load, see --overload-lag.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_lag) {
+        AppendSample(out, "naive_overloaded",
+                     base::StringPrintf("worker=\"%d\"", snapshot.worker),
+                     uint64_t{snapshot.overloaded});
+      }
+    }
+    AppendHeader(out, "naive_overloads_total", "counter",
+                 "Times the IO thread went into overload.");
+    AppendSample(out, "naive_overloads_total", "", totals.overloads);
+    AppendHeader(out, "naive_overload_rejects_total", "counter",
+                 "Clients closed at accept while overloaded.");
+    AppendSample(out, "naive_overload_rejects_total", "",
+                 totals.overload_rejects);
+  }
+
+  AppendHeader(out, "naive_mptcp_connections", "gauge",
+               "Upstream connections opened with MPTCP by whether the peer "
+               "kept it.");
+  AppendSample(out, "naive_mptcp_connections", "mode=\"mptcp\"",
+               static_cast<uint64_t>(totals.mptcp_connections));
+  AppendSample(out, "naive_mptcp_connections", "mode=\"tcp\"",
+               static_cast<uint64_t>(totals.mptcp_fallbacks));
+  AppendHeader(out, "naive_mptcp_subflows", "gauge",
+               "Subflows of the MPTCP upstream connections.");
+  AppendSample(out, "naive_mptcp_subflows", "",
+               static_cast<uint64_t>(totals.mptcp_subflows));
+
+  AppendHeader(out, "naive_h2_header_frames_total", "counter",
+               "HEADERS frames sent on HTTP/2 tunnel sessions.");
+  AppendSample(out, "naive_h2_header_frames_total", "",
+               totals.h2_header_frames);
+  AppendHeader(out, "naive_h2_header_bytes_total", "counter",
+               "Header bytes of the HEADERS frames before and after HPACK.");
+  AppendSample(out, "naive_h2_header_bytes_total", "encoding=\"none\"",
+               totals.h2_header_uncompressed_bytes);
+  AppendSample(out, "naive_h2_header_bytes_total", "encoding=\"hpack\"",
+               totals.h2_header_bytes);
+
+  AppendHeader(out, "naive_buffer_pool_gets_total", "counter",
+               "Relay buffer requests by whether the pool had one.");
+  AppendSample(out, "naive_buffer_pool_gets_total", "result=\"hit\"",
+               totals.buffer_pool_hits);
+  AppendSample(out, "naive_buffer_pool_gets_total", "result=\"miss\"",
+               totals.buffer_pool_misses);
+  AppendHeader(out, "naive_buffer_pool_free_buffers", "gauge",
+               "Idle relay buffers in the pools.");
+  AppendSample(out, "naive_buffer_pool_free_buffers", "",
+               totals.buffer_pool_free_count);
+  AppendHeader(out, "naive_buffer_pool_free_bytes", "gauge",
+               "Idle relay buffer memory in the pools.");
+  AppendSample(out, "naive_buffer_pool_free_bytes", "",
+               totals.buffer_pool_free_bytes);
+  AppendHeader(out, "naive_idle_trims_total", "counter",
+               "Memory trims of IO threads after idling.");
+  AppendSample(out, "naive_idle_trims_total", "", metrics.idle_trims);
+
+  AppendHeader(out, "naive_connection_memory_bytes", "gauge",
+               "Memory held by open connections by kind.");
+  for (int i = 0; i < NaiveMemoryUsage::kNumKinds; ++i) {
+    AppendSample(
+        out, "naive_connection_memory_bytes",
+        base::StringPrintf("kind=\"%s\"",
+                           NaiveMemoryUsage::GetKindName(
+                               static_cast<NaiveMemoryUsage::Kind>(i))),
+        totals.connection_memory.bytes[i]);
+  }
+  AppendHeader(out, "naive_connection_memory_peak_bytes", "gauge",
+               "Most memory held by the open connections of each worker at "
+               "once, as of scrapes and dumps.");
+  for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+    AppendSample(out, "naive_connection_memory_peak_bytes",
+                 base::StringPrintf("worker=\"%d\"", snapshot.worker),
+                 snapshot.connection_memory_peak);
+  }
+  AppendHeader(out, "naive_connection_memory_max_bytes", "gauge",
+               "Memory held by the open connection holding the most.");
+  AppendSample(out, "naive_connection_memory_max_bytes", "",
+               totals.connection_memory_max);
+  if (totals.has_process_memory) {
+    AppendHeader(out, "naive_relay_buffer_bytes", "gauge",
+                 "Relay buffers allocated, idle ones included.");
+    AppendSample(out, "naive_relay_buffer_bytes", "",
+                 totals.relay_buffer_bytes);
+    AppendHeader(out, "naive_relay_buffer_peak_bytes", "gauge",
+                 "Most relay buffers allocated at once.");
+    AppendSample(out, "naive_relay_buffer_peak_bytes", "",
+                 totals.relay_buffer_peak_bytes);
+    AppendHeader(out, "naive_malloc_bytes", "gauge",
+                 "Memory allocated by malloc.");
+    AppendSample(out, "naive_malloc_bytes", "", totals.malloc_bytes);
+    AppendHeader(out, "naive_relay_read_bytes", "histogram",
+                 "Sizes of relay reads by direction.");
+    AppendSizeHistogram(out, "naive_relay_read_bytes", "direction=\"upload\"",
+                        totals.relay_reads.read_bytes[kClient]);
+    AppendSizeHistogram(out, "naive_relay_read_bytes",
+                        "direction=\"download\"",
+                        totals.relay_reads.read_bytes[kServer]);
+
+    // Sampled with --tcp-info-interval only.
+    struct {
+      const char* name;
+      const char* help;
+      NaiveStatsHistogram::Snapshot* histograms;
+    } tcp_info_histograms[] = {
+        {"naive_tcp_rtt_microseconds", "Smoothed RTT of sampled TCP sockets.",
+         totals.tcp_info.rtt_us},
+        {"naive_tcp_retransmit_permille",
+         "Segments retransmitted per thousand sent by sampled TCP sockets.",
+         totals.tcp_info.retransmit_permille},
+        {"naive_tcp_cwnd_segments",
+         "Congestion windows of sampled TCP sockets.",
+         totals.tcp_info.cwnd_segments},
+        {"naive_tcp_delivery_rate_bytes",
+         "Delivery rates of sampled TCP sockets per second.",
+         totals.tcp_info.delivery_rate},
+    };
+    for (const auto& histogram : tcp_info_histograms) {
+      if (histogram.histograms[NaiveTcpInfoStats::kClient].count == 0 &&
+          histogram.histograms[NaiveTcpInfoStats::kEgress].count == 0 &&
+          histogram.histograms[NaiveTcpInfoStats::kTunnel].count == 0) {
+        continue;
+      }
+      AppendHeader(out, histogram.name, "histogram", histogram.help);
+      for (int i = 0; i < NaiveTcpInfoStats::kNumRoles; ++i) {
+        AppendSizeHistogram(
+            out, histogram.name,
+            base::StringPrintf("role=\"%s\"",
+                               NaiveTcpInfoStats::GetRoleName(
+                                   static_cast<NaiveTcpInfoStats::Role>(i))),
+            histogram.histograms[i]);
+      }
+    }
+  }
+
+  if (!totals.egress_sources.empty()) {
+    std::vector<std::string> source_labels;
+    for (const auto& source : totals.egress_sources) {
+      source_labels.push_back("address=\"" + EscapeLabelValue(source.address) +
+                              "\"");
+    }
+    AppendHeader(out, "naive_egress_source_sockets", "gauge",
+                 "Outgoing TCP sockets bound to each egress source address.");
+    for (size_t i = 0; i < source_labels.size(); ++i) {
+      AppendSample(
+          out, "naive_egress_source_sockets", source_labels[i],
+          static_cast<uint64_t>(totals.egress_sources[i].open_sockets));
+    }
+    // Ports are only taken per 4-tuple, so this is the least left to any
+    // one destination.
+    if (totals.ephemeral_ports > 0) {
+      AppendHeader(out, "naive_egress_source_ports_available", "gauge",
+                   "Ephemeral ports of each egress source address not taken "
+                   "by its sockets, at least.");
+      for (size_t i = 0; i < source_labels.size(); ++i) {
+        int available = std::max(
+            0, totals.ephemeral_ports - totals.egress_sources[i].open_sockets);
+        AppendSample(out, "naive_egress_source_ports_available",
+                     source_labels[i], static_cast<uint64_t>(available));
+      }
+    }
+    AppendHeader(out, "naive_egress_source_exhausted_total", "counter",
+                 "Connects failing for lack of a free local port by egress "
+                 "source address.");
+    for (size_t i = 0; i < source_labels.size(); ++i) {
+      AppendSample(out, "naive_egress_source_exhausted_total",
+                   source_labels[i], totals.egress_sources[i].exhausted);
+    }
+  }
+
+  if (user_table) {
+    const auto& users = user_table->users();
+    std::vector<std::string> user_labels;
+    for (const auto& user : users) {
+      user_labels.push_back("user=\"" + EscapeLabelValue(user->name()) + "\"");
+    }
+    AppendHeader(out, "naive_user_bytes_total", "counter",
+                 "Bytes relayed for each user by direction.");
+    for (size_t i = 0; i < users.size(); ++i) {
+      AppendSample(out, "naive_user_bytes_total",
+                   user_labels[i] + ",direction=\"upload\"",
+                   users[i]->bytes_relayed(kClient));
+      AppendSample(out, "naive_user_bytes_total",
+                   user_labels[i] + ",direction=\"download\"",
+                   users[i]->bytes_relayed(kServer));
+    }
+    AppendHeader(out, "naive_user_over_quota", "gauge",
+                 "Users past their soft or hard quota.");
+    for (size_t i = 0; i < users.size(); ++i) {
+      AppendSample(out, "naive_user_over_quota",
+                   user_labels[i] + ",quota=\"soft\"",
+                   uint64_t{users[i]->over_soft_quota()});
+      AppendSample(out, "naive_user_over_quota",
+                   user_labels[i] + ",quota=\"hard\"",
+                   uint64_t{users[i]->over_hard_quota()});
+    }
+  }
+
+  bool has_quic_sessions = std::any_of(
+      snapshots.begin(), snapshots.end(),
+      [](const NaiveMetricsSnapshot& snapshot) {
+        return !snapshot.quic_max_packet_lengths.empty();
+      });
+  if (has_quic_sessions) {
+    AppendHeader(out, "naive_quic_max_packet_length", "gauge",
+                 "Packet length of the QUIC sessions to a proxy in bytes, as "
+                 "raised by path MTU discovery.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      for (const auto& [proxy, length] : snapshot.quic_max_packet_lengths) {
+        AppendSample(out, "naive_quic_max_packet_length",
+                     base::StringPrintf("worker=\"%d\",proxy=\"%s\"",
+                                        snapshot.worker, proxy.c_str()),
+                     uint64_t{length});
+      }
+    }
+  }
+
+  bool has_quic_port_hops = std::any_of(
+      snapshots.begin(), snapshots.end(),
+      [](const NaiveMetricsSnapshot& snapshot) {
+        return snapshot.has_quic_port_hops;
+      });
+  if (has_quic_port_hops) {
+    AppendHeader(out, "naive_quic_port_hops_total", "counter",
+                 "QUIC sessions moved to new ports by outcome.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_quic_port_hops) {
+        AppendSample(out, "naive_quic_port_hops_total",
+                     base::StringPrintf("worker=\"%d\",result=\"ok\"",
+                                        snapshot.worker),
+                     snapshot.quic_port_hops);
+        AppendSample(out, "naive_quic_port_hops_total",
+                     base::StringPrintf("worker=\"%d\",result=\"failed\"",
+                                        snapshot.worker),
+                     snapshot.quic_port_hop_failures);
+      }
+    }
+    AppendHeader(out, "naive_quic_path_bytes_total", "counter",
+                 "Bytes sent and received on the QUIC paths left by hops.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_quic_port_hops) {
+        AppendSample(out, "naive_quic_path_bytes_total",
+                     base::StringPrintf("worker=\"%d\"", snapshot.worker),
+                     snapshot.quic_path_bytes);
+      }
+    }
+    AppendHeader(out, "naive_quic_path_seconds_total", "counter",
+                 "Time spent on the QUIC paths left by hops, the bytes over "
+                 "it being their rate.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_quic_port_hops) {
+        AppendSample(
+            out, "naive_quic_path_seconds_total",
+            base::StringPrintf("worker=\"%d\"", snapshot.worker),
+            base::NumberToString(snapshot.quic_path_time.InSecondsF()));
+      }
+    }
+  }
+
+  bool has_network_quality = std::any_of(
+      snapshots.begin(), snapshots.end(),
+      [](const NaiveMetricsSnapshot& snapshot) {
+        return snapshot.has_network_quality;
+      });
+  if (has_network_quality) {
+    AppendHeader(out, "naive_network_rtt_seconds", "gauge",
+                 "Estimated round trip time to the proxy by kind.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      const std::pair<const char*, const std::optional<base::TimeDelta>&>
+          rtts[] = {{"http", snapshot.http_rtt},
+                    {"transport", snapshot.transport_rtt}};
+      for (const auto& [kind, rtt] : rtts) {
+        if (rtt) {
+          AppendSample(out, "naive_network_rtt_seconds",
+                       base::StringPrintf("worker=\"%d\",kind=\"%s\"",
+                                          snapshot.worker, kind),
+                       base::NumberToString(rtt->InSecondsF()));
+        }
+      }
+    }
+    AppendHeader(out, "naive_network_downstream_kbps", "gauge",
+                 "Estimated download throughput in kilobits a second.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.downstream_kbps) {
+        AppendSample(out, "naive_network_downstream_kbps",
+                     base::StringPrintf("worker=\"%d\"", snapshot.worker),
+                     static_cast<uint64_t>(*snapshot.downstream_kbps));
+      }
+    }
+    AppendHeader(out, "naive_network_effective_connection_type", "gauge",
+                 "Estimated effective connection type, 1 for the current one.");
+    for (const NaiveMetricsSnapshot& snapshot : snapshots) {
+      if (snapshot.has_network_quality) {
+        AppendSample(out, "naive_network_effective_connection_type",
+                     base::StringPrintf("worker=\"%d\",type=\"%s\"",
+                                        snapshot.worker,
+                                        snapshot.effective_connection_type
+                                            .c_str()),
+                     uint64_t{1});
+      }
+    }
+  }
+
+  if (totals.has_resolver) {
+    AppendHeader(out, "naive_resolver_resolutions", "gauge",
+                 "Names holding a fake address.");
+    AppendSample(out, "naive_resolver_resolutions", "", totals.resolutions);
+    AppendHeader(out, "naive_resolver_overwrites_total", "counter",
+                 "Resolutions replaced because the range ran out.");
+    AppendSample(out, "naive_resolver_overwrites_total", "",
+                 totals.resolution_overwrites);
+    AppendHeader(out, "naive_resolver_drops_total", "counter",
+                 "Resolutions dropped after expiring.");
+    AppendSample(out, "naive_resolver_drops_total", "",
+                 totals.resolution_drops);
+  }
+  return out;
+}
+
+}  // namespace net
@@ -0,0 +1,282 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_METRICS_H_
+#define NET_TOOLS_NAIVE_NAIVE_METRICS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base/time/time.h"
+#include "net/tools/naive/naive_heavy_hitters.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_stats.h"
+
+namespace net {
+
+class NaiveUserTable;
+
+// Latency counts in fixed buckets, like a Prometheus histogram.
+class NaiveLatencyHistogram {
+ public:
+  // Upper bounds of the buckets but the last, unbounded one.
+  static constexpr std::array<int, 13> kBucketBoundsMs = {
+      1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+
+  void Add(base::TimeDelta latency);
+  void Merge(const NaiveLatencyHistogram& other);
+
+  // Samples in bucket `i` alone, not cumulative.
+  uint64_t bucket_count(size_t i) const { return counts_[i]; }
+  uint64_t count() const { return count_; }
+  base::TimeDelta sum() const { return sum_; }
+
+ private:
+  std::array<uint64_t, kBucketBoundsMs.size() + 1> counts_ = {};
+  uint64_t count_ = 0;
+  base::TimeDelta sum_;
+};
+
+// What the padding of closed connections cost, by whether the frames were
+// read or written.
+struct NaivePaddingStats {
+  enum Op { kRead, kWrite, kNumOps };
+
+  void Merge(const NaivePaddingStats& other);
+
+  uint64_t frames[kNumOps] = {};
+  uint64_t payload_bytes[kNumOps] = {};
+  uint64_t padding_bytes[kNumOps] = {};
+  uint64_t header_bytes[kNumOps] = {};
+  // Padded writes split into several transport writes.
+  uint64_t split_writes = 0;
+};
+
+// Memory held by connections, by what holds it, see
+// NaiveConnection::GetMemoryUsage().
+struct NaiveMemoryUsage {
+  enum Kind {
+    // Relay buffers being read into or written from.
+    kRelayBuffers,
+    // Copies of padded frames being written.
+    kPaddingBuffers,
+    // Of SOCKS5 and HTTP/1.1 handshakes, and payload read along with them.
+    kHandshakeBuffers,
+    // Tunnel data received but not yet relayed.
+    kTunnelBacklog,
+    // Queued in the kernel buffers of TCP sockets of the connection. Linux
+    // only.
+    kSocketBuffers,
+    kNumKinds,
+  };
+
+  static const char* GetKindName(Kind kind);
+
+  void Add(const NaiveMemoryUsage& other);
+  size_t total() const;
+
+  size_t bytes[kNumKinds] = {};
+};
+
+// Relay counters of one IO thread. Only its thread updates them, so an
+// update is a plain add, and scrapes copy them on that thread.
+struct NaiveMetrics {
+  // Returns the metrics of the calling thread, creating them on first use.
+  // They live as long as the thread.
+  static NaiveMetrics* GetForCurrentThread();
+
+  void Merge(const NaiveMetrics& other);
+
+  // From accepting a client to its parsed request.
+  NaiveLatencyHistogram client_handshake_latency;
+  // Of the upstream connect or tunnel.
+  NaiveLatencyHistogram server_connect_latency;
+  uint64_t connect_errors = 0;
+  // By the side the bytes were read from.
+  uint64_t bytes_relayed[kNumDirections] = {};
+  // Of NaiveRelayScheduler: batches run, those leaving directions queued at
+  // the batch size, and the directions they resumed.
+  uint64_t relay_batches = 0;
+  uint64_t relay_full_batches = 0;
+  uint64_t relay_resumes = 0;
+  // Of NaiveIdleTrimmer.
+  uint64_t idle_trims = 0;
+};
+
+// Sizes of relay reads by the side read from, of the IO thread updating
+// them, see NaiveShardedStats. Unlike NaiveMetrics, scrapes sum them from
+// the thread serving them.
+struct NaiveRelayReadStats {
+  struct Snapshot {
+    NaiveStatsHistogram::Snapshot read_bytes[kNumDirections];
+  };
+
+  void AddTo(Snapshot* snapshot) const;
+
+  NaiveStatsHistogram read_bytes[kNumDirections];
+};
+
+// TCP_INFO of relay sockets sampled every NaiveConfig::tcp_info_interval,
+// of the IO thread sampling them, like NaiveRelayReadStats. Linux only.
+struct NaiveTcpInfoStats {
+  enum Role {
+    // Accepted from clients, if plain TCP.
+    kClient,
+    // Connected directly to destinations.
+    kEgress,
+    // Carrying the HTTP/2 tunnel sessions to proxies.
+    kTunnel,
+    kNumRoles,
+  };
+  static const char* GetRoleName(Role role);
+
+  struct Snapshot {
+    NaiveStatsHistogram::Snapshot rtt_us[kNumRoles];
+    // Segments retransmitted per thousand sent.
+    NaiveStatsHistogram::Snapshot retransmit_permille[kNumRoles];
+    NaiveStatsHistogram::Snapshot cwnd_segments[kNumRoles];
+    // In bytes per second.
+    NaiveStatsHistogram::Snapshot delivery_rate[kNumRoles];
+  };
+
+  void AddTo(Snapshot* snapshot) const;
+
+  NaiveStatsHistogram rtt_us[kNumRoles];
+  NaiveStatsHistogram retransmit_permille[kNumRoles];
+  NaiveStatsHistogram cwnd_segments[kNumRoles];
+  NaiveStatsHistogram delivery_rate[kNumRoles];
+};
+
+// What a scrape collects from one worker on its thread.
+struct NaiveMetricsSnapshot {
+  struct Listener {
+    Listener();
+    Listener(const Listener&);
+    ~Listener();
+
+    bool served = false;
+    size_t active_connections = 0;
+    uint64_t accepts = 0;
+    size_t pending_handshakes = 0;
+    uint64_t rejects = 0;
+    // Workers holding off accepts at a limit, one at most per snapshot.
+    int accept_paused = 0;
+    // Open connections by tunnel session, i.e. by anonymization key, of all
+    // the listeners sharing them.
+    std::vector<int> tunnel_session_connections;
+    NaivePaddingStats padding;
+  };
+
+  NaiveMetricsSnapshot();
+  NaiveMetricsSnapshot(const NaiveMetricsSnapshot&);
+  NaiveMetricsSnapshot(NaiveMetricsSnapshot&&);
+  ~NaiveMetricsSnapshot();
+
+  int worker = 0;
+  NaiveMetrics metrics;
+  // Indexed like NaiveConfig::listen.
+  std::vector<Listener> listeners;
+
+  uint64_t buffer_pool_hits = 0;
+  uint64_t buffer_pool_misses = 0;
+  size_t buffer_pool_free_count = 0;
+  size_t buffer_pool_free_bytes = 0;
+
+  size_t relay_queued = 0;
+
+  // Of NaiveLagMonitor, if started.
+  bool has_lag = false;
+  base::TimeDelta loop_lag;
+  base::TimeDelta loop_lag_peak;
+  bool overloaded = false;
+  uint64_t overloads = 0;
+  uint64_t overload_rejects = 0;
+
+  // Of NaiveNegativeCache.
+  size_t negative_cache_entries = 0;
+  uint64_t negative_cache_hits = 0;
+  uint64_t negative_cache_insertions = 0;
+
+  // Of NaiveHeavyHitters.
+  std::vector<NaiveHeavyHitters::Entry> heavy_hitters;
+
+  // Of the open connections of the worker, see NaiveProxy::GetMemoryUsage().
+  NaiveMemoryUsage connection_memory;
+  // The total most held at once as of the scrapes and dumps so far.
+  size_t connection_memory_peak = 0;
+  // Held by the connection holding the most.
+  size_t connection_memory_max = 0;
+
+  // Process-wide, in the snapshot of the first worker only: relay buffers
+  // allocated now and at most, idle ones in the pools included, and the
+  // memory allocated by malloc, i.e. PartitionAlloc where it is the
+  // allocator.
+  bool has_process_memory = false;
+  size_t relay_buffer_bytes = 0;
+  size_t relay_buffer_peak_bytes = 0;
+  size_t malloc_bytes = 0;
+  NaiveRelayReadStats::Snapshot relay_reads;
+  NaiveTcpInfoStats::Snapshot tcp_info;
+
+  // Process-wide like the above: the egress source addresses, see
+  // TCPSocketPosix::SourceAddressStats, and the size of the ephemeral port
+  // range, 0 if unknown.
+  struct EgressSource {
+    std::string address;
+    int open_sockets = 0;
+    uint64_t exhausted = 0;
+  };
+  std::vector<EgressSource> egress_sources;
+  int ephemeral_ports = 0;
+
+  // Of the sockets of the worker opened with MPTCP, see
+  // TCPSocketPosix::MultipathStats.
+  int mptcp_connections = 0;
+  int mptcp_fallbacks = 0;
+  int mptcp_subflows = 0;
+
+  // Of the HTTP/2 tunnel sessions, see SpdyHeaderEncoderStats.
+  uint64_t h2_header_frames = 0;
+  uint64_t h2_header_uncompressed_bytes = 0;
+  uint64_t h2_header_bytes = 0;
+
+  // By proxy, the max packet length of the QUIC sessions to it, the
+  // smallest if several, see QuicSessionPool::GetMaxPacketLengths().
+  std::map<std::string, size_t> quic_max_packet_lengths;
+
+  // Of the QUIC port hops, if the worker hops, see
+  // QuicSessionPool::PortHopStats.
+  bool has_quic_port_hops = false;
+  uint64_t quic_port_hops = 0;
+  uint64_t quic_port_hop_failures = 0;
+  uint64_t quic_path_bytes = 0;
+  base::TimeDelta quic_path_time;
+
+  // Of NaiveNetworkQuality, if the worker adapts to it.
+  bool has_network_quality = false;
+  std::optional<base::TimeDelta> http_rtt;
+  std::optional<base::TimeDelta> transport_rtt;
+  std::optional<int32_t> downstream_kbps;
+  std::string effective_connection_type;
+
+  bool has_resolver = false;
+  size_t resolutions = 0;
+  uint64_t resolution_overwrites = 0;
+  uint64_t resolution_drops = 0;
+};
+
+// Formats the snapshots of all workers in the Prometheus text exposition
+// format. `listener_names` label the listeners of the snapshots. The
+// counters of `user_table` are added if set, as of their last flush.
+std::string FormatPrometheusMetrics(
+    const std::vector<std::string>& listener_names,
+    const NaiveUserTable* user_table,
+    const std::vector<NaiveMetricsSnapshot>& snapshots);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_METRICS_H_
@@ -0,0 +1,360 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_metrics_server.h"
+
+#include <string_view>
+#include <utility>
+
+#include "base/barrier_callback.h"
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/task/task_runner.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/socket/server_socket.h"
+#include "net/socket/stream_socket.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+
+namespace {
+// Scrapers send short requests, so longer ones are refused.
+constexpr int kMaxRequestSize = 8 * 1024;
+constexpr base::TimeDelta kConnectionTimeout = base::Seconds(10);
+constexpr char kMetricsPath[] = "/metrics";
+constexpr char kAdminConnectionsPath[] = "/admin/connections";
+constexpr char kAdminSessionsPath[] = "/admin/sessions";
+constexpr char kAdminDestinationsPath[] = "/admin/destinations";
+constexpr char kAdminClosePath[] = "/admin/close";
+
+constexpr char kMetricsContentType[] = "text/plain; version=0.0.4";
+constexpr char kAdminContentType[] = "application/x-ndjson";
+
+constexpr NetworkTrafficAnnotationTag kMetricsTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_metrics", "");
+}  // namespace
+
+// Reads one request and writes its response.
+class NaiveMetricsServer::Connection {
+ public:
+  Connection(NaiveMetricsServer* server, std::unique_ptr<StreamSocket> socket)
+      : server_(server),
+        socket_(std::move(socket)),
+        read_buffer_(base::MakeRefCounted<GrowableIOBuffer>()) {
+    read_buffer_->SetCapacity(kMaxRequestSize);
+  }
+  ~Connection() = default;
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  void Start() {
+    // Closes connections sending nothing, or scrapes that never complete.
+    timer_.Start(FROM_HERE, kConnectionTimeout,
+                 base::BindOnce(&Connection::Finish, base::Unretained(this)));
+    Read();
+  }
+
+ private:
+  void Read() {
+    for (;;) {
+      if (read_buffer_->RemainingCapacity() == 0) {
+        SendResponse("431 Request Header Fields Too Large", "", "");
+        return;
+      }
+      int rv = socket_->Read(
+          read_buffer_.get(), read_buffer_->RemainingCapacity(),
+          base::BindOnce(&Connection::OnReadComplete,
+                         weak_ptr_factory_.GetWeakPtr()));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!HandleRead(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int result) {
+    if (HandleRead(result)) {
+      Read();
+    }
+  }
+
+  // Returns whether to read more.
+  bool HandleRead(int result) {
+    if (result <= 0) {
+      Finish();
+      return false;
+    }
+    read_buffer_->set_offset(read_buffer_->offset() + result);
+    std::string_view request(read_buffer_->StartOfBuffer(),
+                             read_buffer_->offset());
+    if (request.find("\r\n\r\n") == std::string_view::npos)
+      return true;
+
+    std::string_view request_line = request.substr(0, request.find("\r\n"));
+    // "GET /metrics HTTP/1.1", allowing a query string. Request bodies are
+    // not read, the admin takes its arguments in the query string.
+    size_t method_end = request_line.find(' ');
+    if (method_end == std::string_view::npos) {
+      SendResponse("400 Bad Request", "", "");
+      return false;
+    }
+    std::string_view method = request_line.substr(0, method_end);
+    std::string_view target = request_line.substr(method_end + 1);
+    target = target.substr(0, target.find(' '));
+    std::string_view query;
+    if (size_t query_start = target.find('?');
+        query_start != std::string_view::npos) {
+      query = target.substr(query_start + 1);
+      target = target.substr(0, query_start);
+    }
+    server_->HandleRequest(method, target, query,
+                           base::BindOnce(&Connection::OnResponse,
+                                          weak_ptr_factory_.GetWeakPtr()));
+    return false;
+  }
+
+  void OnResponse(std::string status,
+                  std::string content_type,
+                  std::string body) {
+    SendResponse(status, content_type, body);
+  }
+
+  void SendResponse(std::string_view status,
+                    std::string_view content_type,
+                    std::string_view body) {
+    std::string response = base::StringPrintf(
+        "HTTP/1.1 %.*s\r\n"
+        "Content-Type: %.*s; charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        static_cast<int>(status.size()), status.data(),
+        static_cast<int>(content_type.size()), content_type.data(),
+        body.size());
+    response += body;
+    auto buffer = base::MakeRefCounted<StringIOBuffer>(std::move(response));
+    int size = buffer->size();
+    write_buffer_ =
+        base::MakeRefCounted<DrainableIOBuffer>(std::move(buffer), size);
+    Write();
+  }
+
+  void Write() {
+    while (write_buffer_->BytesRemaining() > 0) {
+      int rv = socket_->Write(
+          write_buffer_.get(), write_buffer_->BytesRemaining(),
+          base::BindOnce(&Connection::OnWriteComplete,
+                         weak_ptr_factory_.GetWeakPtr()),
+          kMetricsTrafficAnnotation);
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (rv <= 0)
+        break;
+      write_buffer_->DidConsume(rv);
+    }
+    Finish();
+  }
+
+  void OnWriteComplete(int result) {
+    if (result <= 0) {
+      Finish();
+      return;
+    }
+    write_buffer_->DidConsume(result);
+    Write();
+  }
+
+  void Finish() {
+    // Deletes `this`.
+    server_->Close(this);
+  }
+
+  NaiveMetricsServer* const server_;
+  std::unique_ptr<StreamSocket> socket_;
+  scoped_refptr<GrowableIOBuffer> read_buffer_;
+  scoped_refptr<DrainableIOBuffer> write_buffer_;
+  base::OneShotTimer timer_;
+
+  base::WeakPtrFactory<Connection> weak_ptr_factory_{this};
+};
+
+NaiveMetricsServer::Source::Source() = default;
+
+NaiveMetricsServer::Source::Source(
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    CollectCallback collect)
+    : task_runner(std::move(task_runner)), collect(std::move(collect)) {}
+
+NaiveMetricsServer::Source::Source(const Source&) = default;
+
+NaiveMetricsServer::Source& NaiveMetricsServer::Source::operator=(
+    const Source&) = default;
+
+NaiveMetricsServer::Source::~Source() = default;
+
+NaiveMetricsServer::NaiveMetricsServer(
+    std::unique_ptr<ServerSocket> listen_socket,
+    std::vector<std::string> listener_names,
+    std::vector<Source> sources,
+    scoped_refptr<NaiveUserTable> user_table)
+    : listen_socket_(std::move(listen_socket)),
+      listener_names_(std::move(listener_names)),
+      sources_(std::move(sources)),
+      admin_(!sources_.empty() && sources_[0].list_connections),
+      user_table_(std::move(user_table)) {
+  DCHECK(listen_socket_);
+  DCHECK(!sources_.empty());
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveMetricsServer::DoAcceptLoop,
+                                weak_ptr_factory_.GetWeakPtr()));
+}
+
+NaiveMetricsServer::~NaiveMetricsServer() = default;
+
+void NaiveMetricsServer::DoAcceptLoop() {
+  int result;
+  do {
+    result = listen_socket_->Accept(
+        &accepted_socket_,
+        base::BindRepeating(&NaiveMetricsServer::OnAcceptComplete,
+                            weak_ptr_factory_.GetWeakPtr()));
+    if (result == ERR_IO_PENDING)
+      return;
+    HandleAcceptResult(result);
+  } while (result == OK);
+}
+
+void NaiveMetricsServer::OnAcceptComplete(int result) {
+  HandleAcceptResult(result);
+  if (result == OK)
+    DoAcceptLoop();
+}
+
+void NaiveMetricsServer::HandleAcceptResult(int result) {
+  if (result != OK) {
+    LOG(ERROR) << "Metrics accept error: " << ErrorToShortString(result);
+    return;
+  }
+  auto connection =
+      std::make_unique<Connection>(this, std::move(accepted_socket_));
+  Connection* connection_ptr = connection.get();
+  connections_.insert(std::move(connection));
+  connection_ptr->Start();
+}
+
+void NaiveMetricsServer::HandleRequest(std::string_view method,
+                                       std::string_view target,
+                                       std::string_view query,
+                                       ResponseCallback callback) {
+  bool admin_target = admin_ && (target == kAdminConnectionsPath ||
+                                 target == kAdminSessionsPath ||
+                                 target == kAdminDestinationsPath ||
+                                 target == kAdminClosePath);
+  if (target != kMetricsPath && !admin_target) {
+    std::move(callback).Run("404 Not Found", kMetricsContentType, "");
+    return;
+  }
+  // Only closing changes anything, and only it takes a POST.
+  std::string_view allowed = target == kAdminClosePath ? "POST" : "GET";
+  if (method != allowed) {
+    std::move(callback).Run("405 Method Not Allowed", kMetricsContentType, "");
+    return;
+  }
+  if (target == kMetricsPath) {
+    Collect(std::move(callback));
+  } else if (target == kAdminConnectionsPath) {
+    List(&Source::list_connections, std::move(callback));
+  } else if (target == kAdminSessionsPath) {
+    List(&Source::list_sessions, std::move(callback));
+  } else if (target == kAdminDestinationsPath) {
+    List(&Source::list_destinations, std::move(callback));
+  } else {
+    CloseConnection(query, std::move(callback));
+  }
+}
+
+void NaiveMetricsServer::Collect(ResponseCallback callback) {
+  auto barrier = base::BarrierCallback<NaiveMetricsSnapshot>(
+      sources_.size(),
+      base::BindOnce(&NaiveMetricsServer::OnCollected,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+  for (const Source& source : sources_) {
+    source.task_runner->PostTaskAndReplyWithResult(FROM_HERE, source.collect,
+                                                   barrier);
+  }
+}
+
+void NaiveMetricsServer::OnCollected(
+    ResponseCallback callback,
+    std::vector<NaiveMetricsSnapshot> snapshots) {
+  std::move(callback).Run(
+      "200 OK", kMetricsContentType,
+      FormatPrometheusMetrics(listener_names_, user_table_.get(), snapshots));
+}
+
+void NaiveMetricsServer::List(ListCallback Source::*list,
+                              ResponseCallback callback) {
+  auto barrier = base::BarrierCallback<std::string>(
+      sources_.size(),
+      base::BindOnce(
+          [](ResponseCallback callback, std::vector<std::string> listings) {
+            std::move(callback).Run("200 OK", kAdminContentType,
+                                    base::StrCat(listings));
+          },
+          std::move(callback)));
+  for (const Source& source : sources_) {
+    source.task_runner->PostTaskAndReplyWithResult(FROM_HERE, source.*list,
+                                                   barrier);
+  }
+}
+
+void NaiveMetricsServer::CloseConnection(std::string_view query,
+                                         ResponseCallback callback) {
+  base::StringPairs pairs;
+  base::SplitStringIntoKeyValuePairs(query, '=', '&', &pairs);
+  size_t worker = sources_.size();
+  size_t listener = 0;
+  unsigned int id = 0;
+  int found = 0;
+  for (const auto& [key, value] : pairs) {
+    if ((key == "worker" && base::StringToSizeT(value, &worker)) ||
+        (key == "listener" && base::StringToSizeT(value, &listener)) ||
+        (key == "id" && base::StringToUint(value, &id))) {
+      ++found;
+    }
+  }
+  if (found != 3 || worker >= sources_.size()) {
+    std::move(callback).Run("400 Bad Request", kAdminContentType, "");
+    return;
+  }
+  const Source& source = sources_[worker];
+  source.task_runner->PostTaskAndReplyWithResult(
+      FROM_HERE, base::BindOnce(source.close_connection, listener, id),
+      base::BindOnce(
+          [](ResponseCallback callback, bool closed) {
+            if (closed) {
+              std::move(callback).Run("200 OK", kAdminContentType, "");
+            } else {
+              std::move(callback).Run("404 Not Found", kAdminContentType, "");
+            }
+          },
+          std::move(callback)));
+}
+
+void NaiveMetricsServer::Close(Connection* connection) {
+  auto it = connections_.find(connection);
+  DCHECK(it != connections_.end());
+  connections_.erase(it);
+}
+
+}  // namespace net
@@ -0,0 +1,123 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_METRICS_SERVER_H_
+#define NET_TOOLS_NAIVE_NAIVE_METRICS_SERVER_H_
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/containers/unique_ptr_adapters.h"
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_user_table.h"
+
+namespace net {
+
+class ServerSocket;
+class StreamSocket;
+
+// Serves GET /metrics in the Prometheus text format over plain HTTP/1.1,
+// one request per connection. Each scrape collects a snapshot from every
+// worker on its own thread, so the relay counters need no synchronization.
+//
+// With the admin callbacks of the sources set, also serves, likewise
+// gathered on the thread of each worker, a JSON object per line:
+//   GET /admin/connections     the open connections
+//   GET /admin/sessions        the tunnel sessions and HTTP/2 and QUIC
+//                              sessions
+//   GET /admin/destinations    the busiest destinations of each worker
+//   POST /admin/close?worker=<W>&listener=<L>&id=<N>
+//                              closes a connection of the listing
+class NaiveMetricsServer {
+ public:
+  // Run on the thread of a worker to snapshot it.
+  using CollectCallback = base::RepeatingCallback<NaiveMetricsSnapshot()>;
+  // Run on the thread of a worker for the lines of an admin listing.
+  using ListCallback = base::RepeatingCallback<std::string()>;
+  // Run on the thread of a worker to close a connection of its listener
+  // `listener`, returning false if there is none.
+  using CloseCallback =
+      base::RepeatingCallback<bool(size_t listener, unsigned int id)>;
+
+  struct Source {
+    Source();
+    Source(scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+           CollectCallback collect);
+    Source(const Source&);
+    Source& operator=(const Source&);
+    ~Source();
+
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+    CollectCallback collect;
+    // Null without the admin listing.
+    ListCallback list_connections;
+    ListCallback list_sessions;
+    ListCallback list_destinations;
+    CloseCallback close_connection;
+  };
+
+  // `listener_names` label the listeners of the snapshots. The sources must
+  // outlive this object or their task runners must drop the tasks.
+  // `user_table` is read directly, null without users.
+  NaiveMetricsServer(std::unique_ptr<ServerSocket> listen_socket,
+                     std::vector<std::string> listener_names,
+                     std::vector<Source> sources,
+                     scoped_refptr<NaiveUserTable> user_table);
+  ~NaiveMetricsServer();
+  NaiveMetricsServer(const NaiveMetricsServer&) = delete;
+  NaiveMetricsServer& operator=(const NaiveMetricsServer&) = delete;
+
+  // Relabels the listeners after they changed, for the next scrape.
+  void set_listener_names(std::vector<std::string> listener_names) {
+    listener_names_ = std::move(listener_names);
+  }
+
+ private:
+  class Connection;
+
+  void DoAcceptLoop();
+  void OnAcceptComplete(int result);
+  void HandleAcceptResult(int result);
+
+  // Answers a request for `target` without its query string.
+  using ResponseCallback = base::OnceCallback<
+      void(std::string status, std::string content_type, std::string body)>;
+  void HandleRequest(std::string_view method,
+                     std::string_view target,
+                     std::string_view query,
+                     ResponseCallback callback);
+
+  // Gets the scrape body for a connection.
+  void Collect(ResponseCallback callback);
+  void OnCollected(ResponseCallback callback,
+                   std::vector<NaiveMetricsSnapshot> snapshots);
+  // Gets the admin listing of `list` of every source.
+  void List(ListCallback Source::*list, ResponseCallback callback);
+  void CloseConnection(std::string_view query, ResponseCallback callback);
+  // Deletes a connection once it is done.
+  void Close(Connection* connection);
+
+  std::unique_ptr<ServerSocket> listen_socket_;
+  std::vector<std::string> listener_names_;
+  const std::vector<Source> sources_;
+  const bool admin_;
+  const scoped_refptr<NaiveUserTable> user_table_;
+
+  std::unique_ptr<StreamSocket> accepted_socket_;
+  std::set<std::unique_ptr<Connection>, base::UniquePtrComparator>
+      connections_;
+
+  base::WeakPtrFactory<NaiveMetricsServer> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_METRICS_SERVER_H_
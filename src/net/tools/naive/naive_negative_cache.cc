@@ -0,0 +1,75 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_negative_cache.h"
+
+#include "net/base/net_errors.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+NaiveNegativeCache::NaiveNegativeCache() : entries_(kMaxEntries) {}
+
+NaiveNegativeCache::~NaiveNegativeCache() = default;
+
+// static
+NaiveNegativeCache* NaiveNegativeCache::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveNegativeCache>();
+}
+
+// static
+bool NaiveNegativeCache::IsUnreachableError(int error) {
+  switch (error) {
+    case ERR_CONNECTION_REFUSED:
+    case ERR_CONNECTION_TIMED_OUT:
+    case ERR_ADDRESS_UNREACHABLE:
+    case ERR_NAME_NOT_RESOLVED:
+    // The proxy replied to the CONNECT with an error status.
+    case ERR_TUNNEL_CONNECTION_FAILED:
+      return true;
+    default:
+      return false;
+  }
+}
+
+int NaiveNegativeCache::Lookup(const HostPortPair& destination,
+                               base::TimeTicks now) {
+  auto it = entries_.Peek(destination);
+  if (it == entries_.end())
+    return OK;
+  if (it->second.expiration <= now) {
+    entries_.Erase(it);
+    return OK;
+  }
+  ++hits_;
+  return it->second.error;
+}
+
+void NaiveNegativeCache::Report(const HostPortPair& destination,
+                                int result,
+                                base::TimeTicks now,
+                                base::TimeDelta ttl) {
+  if (!IsUnreachableError(result)) {
+    if (result == OK) {
+      auto it = entries_.Peek(destination);
+      if (it != entries_.end())
+        entries_.Erase(it);
+    }
+    return;
+  }
+  // Pushes out the least recently reported entry once full.
+  entries_.Put(destination, Value{result, now + ttl});
+  ++insertions_;
+}
+
+std::vector<NaiveNegativeCache::Entry> NaiveNegativeCache::GetEntries(
+    base::TimeTicks now) const {
+  std::vector<Entry> entries;
+  for (const auto& [destination, value] : entries_) {
+    if (value.expiration > now)
+      entries.push_back({destination, value.error, value.expiration - now});
+  }
+  return entries;
+}
+
+}  // namespace net
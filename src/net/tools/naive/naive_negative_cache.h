@@ -0,0 +1,73 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_NEGATIVE_CACHE_H_
+#define NET_TOOLS_NAIVE_NAIVE_NEGATIVE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/containers/lru_cache.h"
+#include "base/time/time.h"
+#include "net/base/host_port_pair.h"
+
+namespace net {
+
+// Destinations of an IO thread whose upstream connect just failed as
+// unreachable, so the connections retrying them fail at once with the same
+// error instead of each waiting for a tunnel and the connect timeout of the
+// exit. Entries last a TTL and are dropped on a successful connect.
+class NaiveNegativeCache {
+ public:
+  static constexpr size_t kMaxEntries = 1024;
+
+  struct Entry {
+    HostPortPair destination;
+    int error;
+    base::TimeDelta remaining;
+  };
+
+  NaiveNegativeCache();
+  NaiveNegativeCache(const NaiveNegativeCache&) = delete;
+  NaiveNegativeCache& operator=(const NaiveNegativeCache&) = delete;
+  ~NaiveNegativeCache();
+
+  // Returns the cache of the calling thread, creating it on first use.
+  static NaiveNegativeCache* GetForCurrentThread();
+
+  // Whether a failed connect with `error` says the destination is
+  // unreachable rather than the tunnel or the client failed: the connect
+  // errors of a direct:// exit, and a CONNECT refused by the proxy.
+  static bool IsUnreachableError(int error);
+
+  // Returns the error cached for `destination`, or OK if none is.
+  int Lookup(const HostPortPair& destination, base::TimeTicks now);
+  // Caches `result` for `ttl` if it is an unreachable error, or forgets
+  // `destination` once it connected.
+  void Report(const HostPortPair& destination,
+              int result,
+              base::TimeTicks now,
+              base::TimeDelta ttl);
+
+  // Expired entries included until they are looked up or pushed out.
+  size_t size() const { return entries_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t insertions() const { return insertions_; }
+  // The unexpired entries, most recently reported first.
+  std::vector<Entry> GetEntries(base::TimeTicks now) const;
+
+ private:
+  struct Value {
+    int error;
+    base::TimeTicks expiration;
+  };
+
+  base::LRUCache<HostPortPair, Value> entries_;
+  uint64_t hits_ = 0;
+  uint64_t insertions_ = 0;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_NEGATIVE_CACHE_H_
@@ -0,0 +1,435 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_net_log_ring.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "base/check.h"
+#include "base/containers/span.h"
+#include "base/files/file.h"
+#include "base/functional/bind.h"
+#include "base/json/json_writer.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/thread_pool.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_entry.h"
+#include "net/log/net_log_event_type.h"
+#include "net/log/net_log_source.h"
+#include "net/log/net_log_source_type.h"
+
+#if BUILDFLAG(IS_POSIX)
+#include <signal.h>
+
+#include "net/tools/naive/naive_signal_watcher.h"
+#endif
+
+namespace net {
+
+namespace {
+constexpr base::TimeDelta kErrorWindow = base::Minutes(1);
+constexpr base::TimeDelta kAutoDumpInterval = base::Minutes(1);
+// Nested params deeper than this are not expected from NetLog.
+constexpr int kMaxDepth = 64;
+
+struct RecordHeader {
+  int64_t time;
+  int64_t source_start_time;
+  uint32_t source_id;
+  uint16_t type;
+  uint16_t source_type;
+  uint8_t phase;
+};
+
+enum ValueTag : uint8_t {
+  kTagNone,
+  kTagBool,
+  kTagInt,
+  kTagDouble,
+  kTagString,
+  kTagBinary,
+  kTagDict,
+  kTagList,
+};
+
+int64_t ToMicroseconds(base::TimeTicks time) {
+  return (time - base::TimeTicks()).InMicroseconds();
+}
+
+base::TimeTicks FromMicroseconds(int64_t us) {
+  return base::TimeTicks() + base::Microseconds(us);
+}
+
+void AppendVarint(std::string& out, size_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+void AppendBytes(std::string& out, std::string_view bytes) {
+  AppendVarint(out, bytes.size());
+  out += bytes;
+}
+
+void EncodeValue(const base::Value& value, std::string& out);
+
+void EncodeDict(const base::Value::Dict& dict, std::string& out) {
+  AppendVarint(out, dict.size());
+  for (const auto [key, value] : dict) {
+    AppendBytes(out, key);
+    EncodeValue(value, out);
+  }
+}
+
+void EncodeValue(const base::Value& value, std::string& out) {
+  switch (value.type()) {
+    case base::Value::Type::NONE:
+      out += static_cast<char>(kTagNone);
+      break;
+    case base::Value::Type::BOOLEAN:
+      out += static_cast<char>(kTagBool);
+      out += static_cast<char>(value.GetBool());
+      break;
+    case base::Value::Type::INTEGER: {
+      out += static_cast<char>(kTagInt);
+      int i = value.GetInt();
+      out.append(reinterpret_cast<const char*>(&i), sizeof(i));
+      break;
+    }
+    case base::Value::Type::DOUBLE: {
+      out += static_cast<char>(kTagDouble);
+      double d = value.GetDouble();
+      out.append(reinterpret_cast<const char*>(&d), sizeof(d));
+      break;
+    }
+    case base::Value::Type::STRING:
+      out += static_cast<char>(kTagString);
+      AppendBytes(out, value.GetString());
+      break;
+    case base::Value::Type::BINARY: {
+      out += static_cast<char>(kTagBinary);
+      const base::Value::BlobStorage& blob = value.GetBlob();
+      AppendBytes(out, std::string_view(
+                           reinterpret_cast<const char*>(blob.data()),
+                           blob.size()));
+      break;
+    }
+    case base::Value::Type::DICT:
+      out += static_cast<char>(kTagDict);
+      EncodeDict(value.GetDict(), out);
+      break;
+    case base::Value::Type::LIST:
+      out += static_cast<char>(kTagList);
+      AppendVarint(out, value.GetList().size());
+      for (const base::Value& item : value.GetList()) {
+        EncodeValue(item, out);
+      }
+      break;
+  }
+}
+
+bool ReadVarint(std::string_view& in, size_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (in.empty())
+      return false;
+    auto byte = static_cast<uint8_t>(in[0]);
+    in.remove_prefix(1);
+    *value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool ReadBytes(std::string_view& in, std::string_view* bytes) {
+  size_t size;
+  if (!ReadVarint(in, &size) || size > in.size())
+    return false;
+  *bytes = in.substr(0, size);
+  in.remove_prefix(size);
+  return true;
+}
+
+template <typename T>
+bool ReadPod(std::string_view& in, T* value) {
+  if (in.size() < sizeof(T))
+    return false;
+  std::memcpy(value, in.data(), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return true;
+}
+
+std::optional<base::Value> DecodeValue(std::string_view& in, int depth);
+
+std::optional<base::Value::Dict> DecodeDict(std::string_view& in, int depth) {
+  size_t size;
+  if (depth > kMaxDepth || !ReadVarint(in, &size))
+    return std::nullopt;
+  base::Value::Dict dict;
+  for (size_t i = 0; i < size; ++i) {
+    std::string_view key;
+    if (!ReadBytes(in, &key))
+      return std::nullopt;
+    std::optional<base::Value> value = DecodeValue(in, depth + 1);
+    if (!value)
+      return std::nullopt;
+    dict.Set(key, std::move(*value));
+  }
+  return dict;
+}
+
+std::optional<base::Value> DecodeValue(std::string_view& in, int depth) {
+  uint8_t tag;
+  if (depth > kMaxDepth || !ReadPod(in, &tag))
+    return std::nullopt;
+  switch (tag) {
+    case kTagNone:
+      return base::Value();
+    case kTagBool: {
+      uint8_t b;
+      if (!ReadPod(in, &b))
+        return std::nullopt;
+      return base::Value(b != 0);
+    }
+    case kTagInt: {
+      int i;
+      if (!ReadPod(in, &i))
+        return std::nullopt;
+      return base::Value(i);
+    }
+    case kTagDouble: {
+      double d;
+      if (!ReadPod(in, &d))
+        return std::nullopt;
+      return base::Value(d);
+    }
+    case kTagString: {
+      std::string_view s;
+      if (!ReadBytes(in, &s))
+        return std::nullopt;
+      return base::Value(s);
+    }
+    case kTagBinary: {
+      std::string_view s;
+      if (!ReadBytes(in, &s))
+        return std::nullopt;
+      return base::Value(base::as_byte_span(s));
+    }
+    case kTagDict: {
+      std::optional<base::Value::Dict> dict = DecodeDict(in, depth);
+      if (!dict)
+        return std::nullopt;
+      return base::Value(std::move(*dict));
+    }
+    case kTagList: {
+      size_t size;
+      if (!ReadVarint(in, &size))
+        return std::nullopt;
+      base::Value::List list;
+      for (size_t i = 0; i < size; ++i) {
+        std::optional<base::Value> item = DecodeValue(in, depth + 1);
+        if (!item)
+          return std::nullopt;
+        list.Append(std::move(*item));
+      }
+      return base::Value(std::move(list));
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<NetLogEntry> DecodeRecord(std::string_view record) {
+  RecordHeader header;
+  if (!ReadPod(record, &header))
+    return std::nullopt;
+  std::optional<base::Value::Dict> params = DecodeDict(record, 0);
+  if (!params)
+    return std::nullopt;
+  return NetLogEntry(
+      static_cast<NetLogEventType>(header.type),
+      NetLogSource(static_cast<NetLogSourceType>(header.source_type),
+                   header.source_id,
+                   FromMicroseconds(header.source_start_time)),
+      static_cast<NetLogEventPhase>(header.phase),
+      FromMicroseconds(header.time), std::move(*params));
+}
+}  // namespace
+
+NaiveNetLogRing::NaiveNetLogRing(const base::FilePath& path,
+                                 size_t capacity,
+                                 int error_threshold,
+                                 std::unique_ptr<base::Value::Dict> constants)
+    : path_(path),
+      error_threshold_(error_threshold),
+      constants_(std::move(constants)),
+      dump_task_runner_(base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN})),
+      ring_(capacity) {
+  DCHECK_GT(capacity, sizeof(uint32_t));
+}
+
+NaiveNetLogRing::~NaiveNetLogRing() {
+  // Safe as worker threads are stopped first.
+  if (net_log())
+    net_log()->RemoveObserver(this);
+}
+
+void NaiveNetLogRing::StartObserving(NetLog* net_log) {
+  net_log->AddObserver(this, NetLogCaptureMode::kDefault);
+}
+
+#if BUILDFLAG(IS_POSIX)
+bool NaiveNetLogRing::WatchSignal() {
+  // Unretained is safe because the watcher is owned by `this`.
+  auto signal_watcher = std::make_unique<NaiveSignalWatcher>(
+      SIGUSR1,
+      base::BindRepeating(&NaiveNetLogRing::Dump, base::Unretained(this)));
+  if (!signal_watcher->Start())
+    return false;
+  signal_watcher_ = std::move(signal_watcher);
+  return true;
+}
+#endif
+
+void NaiveNetLogRing::Dump() {
+  std::vector<std::string> records;
+  {
+    base::AutoLock lock(lock_);
+    size_t offset = head_;
+    size_t remaining = used_;
+    while (remaining > 0) {
+      uint32_t size;
+      Read(offset, reinterpret_cast<char*>(&size), sizeof(size));
+      offset = (offset + sizeof(size)) % ring_.size();
+      std::string& record = records.emplace_back(size, '\0');
+      Read(offset, record.data(), size);
+      offset = (offset + size) % ring_.size();
+      remaining -= sizeof(size) + size;
+    }
+  }
+  base::FilePath path = path_.InsertBeforeExtensionASCII(
+      "-" + base::NumberToString(
+                base::Time::Now().InMillisecondsSinceUnixEpoch()));
+  dump_task_runner_->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveNetLogRing::WriteDump, std::move(path),
+                                constants_->Clone(), std::move(records)));
+}
+
+void NaiveNetLogRing::OnAddEntry(const NetLogEntry& entry) {
+  RecordHeader header = {};
+  header.time = ToMicroseconds(entry.time);
+  header.source_start_time = ToMicroseconds(entry.source.start_time);
+  header.source_id = entry.source.id;
+  header.type = static_cast<uint16_t>(entry.type);
+  header.source_type = static_cast<uint16_t>(entry.source.type);
+  header.phase = static_cast<uint8_t>(entry.phase);
+  scratch_.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+  EncodeDict(entry.params, scratch_);
+  {
+    base::AutoLock lock(lock_);
+    Append(scratch_);
+  }
+
+  if (error_threshold_ <= 0 ||
+      entry.params.FindInt("net_error").value_or(OK) >= 0) {
+    return;
+  }
+  if (entry.time - error_window_start_ >= kErrorWindow) {
+    error_window_start_ = entry.time;
+    error_count_ = 0;
+  }
+  if (++error_count_ < error_threshold_)
+    return;
+  error_count_ = 0;
+  if (!last_auto_dump_.is_null() &&
+      entry.time - last_auto_dump_ < kAutoDumpInterval) {
+    return;
+  }
+  last_auto_dump_ = entry.time;
+  Dump();
+}
+
+void NaiveNetLogRing::Append(const std::string& record) {
+  uint32_t size = record.size();
+  size_t needed = sizeof(size) + size;
+  if (needed > ring_.size())
+    return;
+  while (ring_.size() - used_ < needed) {
+    uint32_t oldest;
+    Read(head_, reinterpret_cast<char*>(&oldest), sizeof(oldest));
+    head_ = (head_ + sizeof(oldest) + oldest) % ring_.size();
+    used_ -= sizeof(oldest) + oldest;
+  }
+  size_t tail = (head_ + used_) % ring_.size();
+  Copy(tail, reinterpret_cast<const char*>(&size), sizeof(size));
+  Copy((tail + sizeof(size)) % ring_.size(), record.data(), size);
+  used_ += needed;
+}
+
+void NaiveNetLogRing::Copy(size_t offset, const char* data, size_t size) {
+  size_t first = std::min(size, ring_.size() - offset);
+  std::memcpy(ring_.data() + offset, data, first);
+  std::memcpy(ring_.data(), data + first, size - first);
+}
+
+void NaiveNetLogRing::Read(size_t offset, char* data, size_t size) const {
+  size_t first = std::min(size, ring_.size() - offset);
+  std::memcpy(data, ring_.data() + offset, first);
+  std::memcpy(data + first, ring_.data(), size - first);
+}
+
+// static
+void NaiveNetLogRing::WriteDump(base::FilePath path,
+                                base::Value::Dict constants,
+                                std::vector<std::string> records) {
+  base::File file(path, base::File::FLAG_CREATE_ALWAYS |
+                            base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    LOG(ERROR) << "Failed to create " << path << ": "
+               << base::File::ErrorToString(file.error_details());
+    return;
+  }
+
+  // The format of FileNetLogObserver, which the viewer reads.
+  std::string out = "{\"constants\":";
+  std::string json;
+  base::JSONWriter::Write(constants, &json);
+  out += json;
+  out += ",\n\"events\": [\n";
+  size_t events = 0;
+  bool ok = true;
+  for (const std::string& record : records) {
+    std::optional<NetLogEntry> entry = DecodeRecord(record);
+    if (!entry)
+      continue;
+    if (events++ > 0)
+      out += ",\n";
+    base::JSONWriter::Write(entry->ToDict(), &json);
+    out += json;
+    if (out.size() >= 64 * 1024) {
+      ok = ok && file.WriteAtCurrentPosAndCheck(base::as_byte_span(out));
+      out.clear();
+    }
+  }
+  out += "]}\n";
+  ok = ok && file.WriteAtCurrentPosAndCheck(base::as_byte_span(out));
+  if (!ok) {
+    LOG(ERROR) << "Failed to write " << path;
+    return;
+  }
+  LOG(INFO) << "Saved " << events << " NetLog events to " << path;
+}
+
+}  // namespace net
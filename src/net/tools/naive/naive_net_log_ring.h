@@ -0,0 +1,94 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_NET_LOG_RING_H_
+#define NET_TOOLS_NAIVE_NAIVE_NET_LOG_RING_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/synchronization/lock.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/thread_annotations.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "build/build_config.h"
+#include "net/log/net_log.h"
+
+namespace net {
+
+class NaiveSignalWatcher;
+
+// Keeps the latest NetLog events in a fixed size memory ring instead of
+// writing them out, and saves them as a NetLog file on demand: after too
+// many failed events, or on SIGUSR1 if watched. Events are stored in a
+// compact binary form, JSON is only written by dumps, on a thread pool
+// sequence.
+class NaiveNetLogRing : public NetLog::ThreadSafeObserver {
+ public:
+  // Dumps are saved next to `path`, with their time before its extension.
+  // A dump is started once `error_threshold` events with a net error are
+  // seen within a minute if positive, at most once a minute.
+  NaiveNetLogRing(const base::FilePath& path,
+                  size_t capacity,
+                  int error_threshold,
+                  std::unique_ptr<base::Value::Dict> constants);
+  ~NaiveNetLogRing() override;
+  NaiveNetLogRing(const NaiveNetLogRing&) = delete;
+  NaiveNetLogRing& operator=(const NaiveNetLogRing&) = delete;
+
+  void StartObserving(NetLog* net_log);
+
+#if BUILDFLAG(IS_POSIX)
+  // Dumps on each SIGUSR1, watched on the calling IO thread.
+  bool WatchSignal();
+#endif
+
+  // Saves the events kept so far. Can be called on any thread.
+  void Dump();
+
+  // NetLog::ThreadSafeObserver implementation.
+  void OnAddEntry(const NetLogEntry& entry) override;
+
+ private:
+  // Appends a record, evicting the oldest ones to make room.
+  void Append(const std::string& record) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void Copy(size_t offset, const char* data, size_t size)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void Read(size_t offset, char* data, size_t size) const
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Decodes `records` and writes them to a new file.
+  static void WriteDump(base::FilePath path,
+                        base::Value::Dict constants,
+                        std::vector<std::string> records);
+
+  const base::FilePath path_;
+  const int error_threshold_;
+  const std::unique_ptr<base::Value::Dict> constants_;
+  scoped_refptr<base::SequencedTaskRunner> dump_task_runner_;
+
+  // Only used by OnAddEntry(), which NetLog never calls concurrently.
+  std::string scratch_;
+  base::TimeTicks error_window_start_;
+  int error_count_ = 0;
+  base::TimeTicks last_auto_dump_;
+
+  base::Lock lock_;
+  // Length-prefixed records, the oldest at `head_`, `used_` bytes in all,
+  // wrapping around.
+  std::vector<char> ring_ GUARDED_BY(lock_);
+  size_t head_ GUARDED_BY(lock_) = 0;
+  size_t used_ GUARDED_BY(lock_) = 0;
+
+#if BUILDFLAG(IS_POSIX)
+  std::unique_ptr<NaiveSignalWatcher> signal_watcher_;
+#endif
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_NET_LOG_RING_H_
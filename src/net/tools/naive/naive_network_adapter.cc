@@ -0,0 +1,99 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_network_adapter.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "base/functional/bind.h"
+#include "net/nqe/network_quality_estimator.h"
+#include "net/spdy/spdy_session_pool.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_thread_local.h"
+#include "net/tools/naive/naive_wakeup.h"
+
+namespace net {
+
+namespace {
+constexpr base::TimeDelta kUpdateInterval = base::Seconds(5);
+// Keeps a few round trips of data in flight on a slow link.
+constexpr int64_t kWindowRoundTrips = 4;
+constexpr int64_t kMinSessionWindow = 1024 * 1024;
+}  // namespace
+
+// static
+NaiveNetworkQuality* NaiveNetworkQuality::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveNetworkQuality>();
+}
+
+int64_t NaiveNetworkQuality::bandwidth_delay_product() const {
+  // Prefers the RTT of the tunnel sessions, from their PINGs, to that of
+  // their sockets.
+  std::optional<base::TimeDelta> rtt = http_rtt ? http_rtt : transport_rtt;
+  if (!rtt || !downstream_kbps)
+    return 0;
+  return rtt->InMicroseconds() * *downstream_kbps / 8000;
+}
+
+NaiveNetworkAdapter::NaiveNetworkAdapter(
+    NetworkQualityEstimator* network_quality_estimator,
+    SpdySessionPool* spdy_session_pool,
+    size_t session_window)
+    : network_quality_estimator_(network_quality_estimator),
+      spdy_session_pool_(spdy_session_pool),
+      session_window_(session_window),
+      last_bytes_downloaded_(
+          NaiveMetrics::GetForCurrentThread()->bytes_relayed[kServer]),
+      last_update_time_(base::TimeTicks::Now()) {
+  // Unretained is safe because the timer is owned by this.
+  update_timer_.Start(FROM_HERE, AlignToWakeupPeriod(kUpdateInterval),
+                      base::BindRepeating(&NaiveNetworkAdapter::Update,
+                                          base::Unretained(this)));
+}
+
+NaiveNetworkAdapter::~NaiveNetworkAdapter() = default;
+
+void NaiveNetworkAdapter::Update() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  uint64_t bytes_downloaded =
+      NaiveMetrics::GetForCurrentThread()->bytes_relayed[kServer];
+  int64_t elapsed_us = (now - last_update_time_).InMicroseconds();
+  if (elapsed_us > 0) {
+    int64_t kbps = static_cast<int64_t>(bytes_downloaded -
+                                        last_bytes_downloaded_) *
+                   8000 / elapsed_us;
+    peak_download_kbps_ = std::max(kbps, peak_download_kbps_ * 7 / 8);
+  }
+  last_bytes_downloaded_ = bytes_downloaded;
+  last_update_time_ = now;
+
+  NaiveNetworkQuality* quality = NaiveNetworkQuality::GetForCurrentThread();
+  quality->http_rtt = network_quality_estimator_->GetHttpRTT();
+  quality->transport_rtt = network_quality_estimator_->GetTransportRTT();
+  quality->downstream_kbps =
+      network_quality_estimator_->GetDownstreamThroughputKbps();
+  if (!quality->downstream_kbps && peak_download_kbps_ > 0) {
+    quality->downstream_kbps = static_cast<int32_t>(std::min<int64_t>(
+        peak_download_kbps_, std::numeric_limits<int32_t>::max()));
+  }
+  quality->effective_connection_type =
+      network_quality_estimator_->GetEffectiveConnectionType();
+
+  // Windows never grow past the configured one.
+  int64_t max_window = static_cast<int64_t>(session_window_);
+  int64_t min_window = std::min(kMinSessionWindow, max_window);
+  int64_t window = max_window;
+  if (quality->effective_connection_type ==
+          EFFECTIVE_CONNECTION_TYPE_SLOW_2G ||
+      quality->effective_connection_type == EFFECTIVE_CONNECTION_TYPE_2G) {
+    window = min_window;
+  } else if (int64_t bdp = quality->bandwidth_delay_product(); bdp > 0) {
+    window = std::clamp(kWindowRoundTrips * bdp, min_window, max_window);
+  }
+  spdy_session_pool_->set_session_max_recv_window_size(
+      static_cast<size_t>(window));
+}
+
+}  // namespace net
@@ -0,0 +1,72 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_NETWORK_ADAPTER_H_
+#define NET_TOOLS_NAIVE_NAIVE_NETWORK_ADAPTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "base/memory/raw_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/nqe/effective_connection_type.h"
+
+namespace net {
+
+class NetworkQualityEstimator;
+class SpdySessionPool;
+
+// The estimates of the upstream network last taken by the NaiveNetworkAdapter
+// of an IO thread. Only its thread reads and updates them.
+struct NaiveNetworkQuality {
+  // Returns the estimates of the calling thread, creating them on first use.
+  // They live as long as the thread.
+  static NaiveNetworkQuality* GetForCurrentThread();
+
+  // Returns the bytes in flight filling the path, or 0 if unknown.
+  int64_t bandwidth_delay_product() const;
+
+  std::optional<base::TimeDelta> http_rtt;
+  std::optional<base::TimeDelta> transport_rtt;
+  std::optional<int32_t> downstream_kbps;
+  EffectiveConnectionType effective_connection_type =
+      EFFECTIVE_CONNECTION_TYPE_UNKNOWN;
+};
+
+// Takes the estimates of `network_quality_estimator` into the
+// NaiveNetworkQuality of its thread every few seconds, by which NaiveProxy
+// adds tunnel sessions on paths whose bandwidth-delay product exceeds a
+// session window and NaiveConnection batches padded writes longer on long
+// round trips. It also shrinks the receive windows of new HTTP/2 sessions on
+// slow links, down from `session_window`, so the proxy does not queue up
+// seconds of data behind them.
+//
+// The estimator only measures the throughput of URLRequests, so without one
+// it is taken from the peak download rate of the relay on the thread.
+class NaiveNetworkAdapter {
+ public:
+  NaiveNetworkAdapter(NetworkQualityEstimator* network_quality_estimator,
+                      SpdySessionPool* spdy_session_pool,
+                      size_t session_window);
+  ~NaiveNetworkAdapter();
+  NaiveNetworkAdapter(const NaiveNetworkAdapter&) = delete;
+  NaiveNetworkAdapter& operator=(const NaiveNetworkAdapter&) = delete;
+
+ private:
+  void Update();
+
+  const raw_ptr<NetworkQualityEstimator> network_quality_estimator_;
+  const raw_ptr<SpdySessionPool> spdy_session_pool_;
+  const size_t session_window_;
+
+  uint64_t last_bytes_downloaded_ = 0;
+  base::TimeTicks last_update_time_;
+  // Decaying, in kilobits a second.
+  int64_t peak_download_kbps_ = 0;
+  base::MetronomeTimer update_timer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_NETWORK_ADAPTER_H_
@@ -0,0 +1,182 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_numa.h"
+
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "base/containers/contains.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+
+// Older headers lack the Linux 4.5 option.
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace net {
+
+namespace {
+constexpr char kNodePath[] = "/sys/devices/system/node";
+// MPOL_PREFERRED of <linux/mempolicy.h>, which conflicts with <numaif.h>.
+constexpr int kMemoryPolicyPreferred = 1;
+// Above any index of the group, so the kernel falls back to hashing.
+constexpr uint32_t kNoSocket = UINT32_MAX;
+
+bool ReadList(const base::FilePath& path, std::vector<int>* out) {
+  std::string list;
+  return base::ReadFileToString(path, &list) &&
+         NaiveNumaTopology::ParseList(
+             base::TrimWhitespaceASCII(list, base::TRIM_ALL), out);
+}
+}  // namespace
+
+NaiveNumaTopology::Node::Node() = default;
+NaiveNumaTopology::Node::Node(const Node&) = default;
+NaiveNumaTopology::Node& NaiveNumaTopology::Node::operator=(const Node&) =
+    default;
+NaiveNumaTopology::Node::~Node() = default;
+
+NaiveNumaTopology::NaiveNumaTopology() = default;
+NaiveNumaTopology::NaiveNumaTopology(const NaiveNumaTopology&) = default;
+NaiveNumaTopology& NaiveNumaTopology::operator=(const NaiveNumaTopology&) =
+    default;
+NaiveNumaTopology::~NaiveNumaTopology() = default;
+
+// static
+NaiveNumaTopology NaiveNumaTopology::Read() {
+  NaiveNumaTopology topology;
+  const base::FilePath node_path(kNodePath);
+  std::vector<int> ids;
+  if (!ReadList(node_path.Append("online"), &ids)) {
+    return topology;
+  }
+  for (int id : ids) {
+    Node node;
+    node.id = id;
+    // Nodes of memory alone have no CPUs to run workers on.
+    if (!ReadList(node_path.Append("node" + base::NumberToString(id))
+                      .Append("cpulist"),
+                  &node.cpus) ||
+        node.cpus.empty()) {
+      continue;
+    }
+    topology.nodes_.push_back(std::move(node));
+  }
+  return topology;
+}
+
+// static
+bool NaiveNumaTopology::ParseList(std::string_view list,
+                                  std::vector<int>* out) {
+  out->clear();
+  if (list.empty()) {
+    return true;
+  }
+  for (std::string_view range : base::SplitStringPiece(
+           list, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    std::vector<std::string_view> ends = base::SplitStringPiece(
+        range, "-", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    int first;
+    int last;
+    if (ends.size() > 2 || !base::StringToInt(ends.front(), &first) ||
+        !base::StringToInt(ends.back(), &last) || first < 0 || last < first ||
+        last >= CPU_SETSIZE) {
+      return false;
+    }
+    for (int i = first; i <= last; ++i) {
+      out->push_back(i);
+    }
+  }
+  return true;
+}
+
+int NaiveNumaTopology::IndexOfCpu(int cpu) const {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (base::Contains(nodes_[i].cpus, cpu)) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void BindCurrentThreadToNode(const NaiveNumaTopology::Node& node, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (cpu >= 0) {
+    CPU_SET(cpu, &set);
+  } else {
+    for (int node_cpu : node.cpus) {
+      CPU_SET(node_cpu, &set);
+    }
+  }
+  if (sched_setaffinity(0, sizeof(set), &set)) {
+    PLOG(ERROR) << "Failed to bind thread to NUMA node " << node.id;
+  }
+
+  constexpr size_t kBits = sizeof(unsigned long) * CHAR_BIT;
+  std::vector<unsigned long> mask(node.id / kBits + 1);
+  mask[node.id / kBits] |= 1UL << (node.id % kBits);
+  // The kernel reads one bit less than `maxnode`.
+  if (syscall(SYS_set_mempolicy, kMemoryPolicyPreferred, mask.data(),
+              mask.size() * kBits + 1)) {
+    PLOG(ERROR) << "Failed to prefer memory of NUMA node " << node.id;
+  }
+}
+
+NaiveNumaSteering::NaiveNumaSteering(const NaiveNumaTopology& topology,
+                                     const std::vector<int>& worker_nodes) {
+  program_.push_back(
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU));
+  for (size_t i = 0; i < topology.nodes().size(); ++i) {
+    std::vector<uint32_t> workers;
+    for (size_t w = 0; w < worker_nodes.size(); ++w) {
+      if (worker_nodes[w] == static_cast<int>(i)) {
+        workers.push_back(w);
+      }
+    }
+    if (workers.empty()) {
+      continue;
+    }
+    const std::vector<int>& cpus = topology.nodes()[i].cpus;
+    for (size_t j = 0; j < cpus.size(); ++j) {
+      program_.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                  static_cast<uint32_t>(cpus[j]), 0, 1));
+      program_.push_back(
+          BPF_STMT(BPF_RET | BPF_K, workers[j % workers.size()]));
+    }
+  }
+  program_.push_back(BPF_STMT(BPF_RET | BPF_K, kNoSocket));
+}
+
+NaiveNumaSteering::~NaiveNumaSteering() = default;
+
+bool NaiveNumaSteering::Attach(int fd) const {
+  if (program_.size() > BPF_MAXINSNS) {
+    LOG(ERROR) << "Too many CPUs to steer connections to NUMA nodes";
+    return false;
+  }
+  sock_fprog fprog = {};
+  fprog.len = program_.size();
+  fprog.filter = const_cast<sock_filter*>(program_.data());
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog,
+                 sizeof(fprog))) {
+    PLOG(ERROR) << "Failed to steer connections to NUMA nodes";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace net
@@ -0,0 +1,80 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_NUMA_H_
+#define NET_TOOLS_NAIVE_NAIVE_NUMA_H_
+
+#include <linux/filter.h>
+
+#include <string_view>
+#include <vector>
+
+namespace net {
+
+// The NUMA nodes of the machine and their CPUs, as sysfs lists them. Linux
+// only.
+class NaiveNumaTopology {
+ public:
+  struct Node {
+    Node();
+    Node(const Node&);
+    Node& operator=(const Node&);
+    ~Node();
+
+    // As numbered by the kernel, which may skip numbers.
+    int id = 0;
+    std::vector<int> cpus;
+  };
+
+  NaiveNumaTopology();
+  NaiveNumaTopology(const NaiveNumaTopology&);
+  NaiveNumaTopology& operator=(const NaiveNumaTopology&);
+  ~NaiveNumaTopology();
+
+  // Without nodes if sysfs has no NUMA information.
+  static NaiveNumaTopology Read();
+
+  // Parses a sysfs CPU or node list like "0-3,8".
+  static bool ParseList(std::string_view list, std::vector<int>* out);
+
+  const std::vector<Node>& nodes() const { return nodes_; }
+
+  // Index in nodes() of the node of `cpu`, -1 if none has it.
+  int IndexOfCpu(int cpu) const;
+
+ private:
+  std::vector<Node> nodes_;
+};
+
+// Runs the calling thread on `cpu`, or on any CPU of `node` if `cpu` is -1,
+// and makes the kernel prefer `node` for the pages the thread touches first,
+// so the buffers and connections of a worker stay in the memory of its node.
+// Threads it starts later inherit both. Failures are logged and otherwise
+// ignored.
+void BindCurrentThreadToNode(const NaiveNumaTopology::Node& node, int cpu);
+
+// A classic BPF program for SO_ATTACH_REUSEPORT_CBPF handing each connection
+// to the socket of a worker on the node of the CPU that received it, which
+// is the node of the NIC queue of the connection. Workers are sockets of the
+// SO_REUSEPORT group in the order they started listening; CPUs of a node are
+// spread over its workers. Connections on nodes without workers, and those
+// the program has no socket for, are hashed over the group as without it.
+class NaiveNumaSteering {
+ public:
+  // `worker_nodes[i]` is the index in `topology` of the node of worker i.
+  NaiveNumaSteering(const NaiveNumaTopology& topology,
+                    const std::vector<int>& worker_nodes);
+  ~NaiveNumaSteering();
+  NaiveNumaSteering(const NaiveNumaSteering&) = delete;
+  NaiveNumaSteering& operator=(const NaiveNumaSteering&) = delete;
+
+  // Attaches the program to the SO_REUSEPORT group of the listening socket
+  // `fd`, including sockets joining it later. Logs failures.
+  bool Attach(int fd) const;
+
+ private:
+  std::vector<sock_filter> program_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_NUMA_H_
@@ -26,15 +26,40 @@ int NaivePaddingFramer::Read(const char* padded,
                              int payload_buf_capacity) {
   // This check guarantees write_ptr does not overflow.
   CHECK_GE(payload_buf_capacity, padded_len);
+  // write_ptr never passes the read position, so payload can be compacted
+  // in place.
 
   char* write_ptr = payload_buf;
   while (padded_len > 0) {
+    // Fast path: a complete frame at a frame boundary is copied out in one
+    // step. Frames split across reads go through the state machine below.
+    if (state_ == ReadState::kPayloadLength1 &&
+        padded_len >= frame_header_size() &&
+        (!max_read_frames_.has_value() ||
+         num_read_frames_ < *max_read_frames_)) {
+      int payload_length = static_cast<uint8_t>(padded[0]) * 256 +
+                           static_cast<uint8_t>(padded[1]);
+      int padding_length = static_cast<uint8_t>(padded[2]);
+      int frame_size = frame_header_size() + payload_length + padding_length;
+      if (frame_size <= padded_len) {
+        std::memmove(write_ptr, padded + frame_header_size(), payload_length);
+        write_ptr += payload_length;
+        read_bytes_.header += frame_header_size();
+        read_bytes_.payload += payload_length;
+        read_bytes_.padding += padding_length;
+        padded += frame_size;
+        padded_len -= frame_size;
+        CountReadFrame();
+        continue;
+      }
+    }
+
     int copy_size;
     switch (state_) {
       case ReadState::kPayloadLength1:
         if (max_read_frames_.has_value() &&
             num_read_frames_ >= *max_read_frames_) {
-          std::memcpy(write_ptr, padded, padded_len);
+          std::memmove(write_ptr, padded, padded_len);
           padded += padded_len;
           write_ptr += padded_len;
           padded_len = 0;
@@ -43,6 +68,7 @@ int NaivePaddingFramer::Read(const char* padded,
         read_payload_length_ = static_cast<uint8_t>(padded[0]);
         ++padded;
         --padded_len;
+        ++read_bytes_.header;
         state_ = ReadState::kPayloadLength2;
         break;
       case ReadState::kPayloadLength2:
@@ -50,12 +76,14 @@ int NaivePaddingFramer::Read(const char* padded,
             read_payload_length_ * 256 + static_cast<uint8_t>(padded[0]);
         ++padded;
         --padded_len;
+        ++read_bytes_.header;
         state_ = ReadState::kPaddingLength1;
         break;
       case ReadState::kPaddingLength1:
         read_padding_length_ = static_cast<uint8_t>(padded[0]);
         ++padded;
         --padded_len;
+        ++read_bytes_.header;
         state_ = ReadState::kPayload;
         break;
       case ReadState::kPayload:
@@ -65,29 +93,35 @@ int NaivePaddingFramer::Read(const char* padded,
           state_ = ReadState::kPadding;
         }
 
-        std::memcpy(write_ptr, padded, copy_size);
+        std::memmove(write_ptr, padded, copy_size);
         padded += copy_size;
         write_ptr += copy_size;
         padded_len -= copy_size;
+        read_bytes_.payload += copy_size;
         break;
       case ReadState::kPadding:
         copy_size = std::min(read_padding_length_, padded_len);
         read_padding_length_ -= copy_size;
         if (read_padding_length_ == 0) {
-          if (num_read_frames_ < std::numeric_limits<int>::max() - 1) {
-            ++num_read_frames_;
-          }
+          CountReadFrame();
           state_ = ReadState::kPayloadLength1;
         }
 
         padded += copy_size;
         padded_len -= copy_size;
+        read_bytes_.padding += copy_size;
         break;
     }
   }
   return write_ptr - payload_buf;
 }
 
+void NaivePaddingFramer::CountReadFrame() {
+  if (num_read_frames_ < std::numeric_limits<int>::max() - 1) {
+    ++num_read_frames_;
+  }
+}
+
 int NaivePaddingFramer::Write(const char* payload_buf,
                               int payload_buf_len,
                               int padding_size,
@@ -98,21 +132,32 @@ int NaivePaddingFramer::Write(const char* payload_buf,
   CHECK_LE(padding_size, max_padding_size());
   CHECK_GE(padding_size, 0);
 
-  payload_consumed_len = std::min(
-      payload_buf_len, padded_capacity - frame_header_size() - padding_size);
-  int padded_buf_len =
-      frame_header_size() + payload_consumed_len + padding_size;
-
-  padded[0] = payload_consumed_len / 256;
-  padded[1] = payload_consumed_len % 256;
-  padded[2] = padding_size;
+  payload_consumed_len =
+      std::min({payload_buf_len, max_payload_size(),
+                padded_capacity - frame_header_size() - padding_size});
   std::memcpy(padded + frame_header_size(), payload_buf, payload_consumed_len);
-  std::memset(padded + frame_header_size() + payload_consumed_len, '\0',
-              padding_size);
+  return WriteInPlace(padded, payload_consumed_len, padding_size);
+}
+
+int NaivePaddingFramer::WriteInPlace(char* frame,
+                                     int payload_len,
+                                     int padding_size) {
+  CHECK_GE(payload_len, 0);
+  CHECK_LE(payload_len, max_payload_size());
+  CHECK_LE(padding_size, max_padding_size());
+  CHECK_GE(padding_size, 0);
+
+  frame[0] = payload_len / 256;
+  frame[1] = payload_len % 256;
+  frame[2] = padding_size;
+  std::memset(frame + frame_header_size() + payload_len, '\0', padding_size);
 
   if (num_written_frames_ < std::numeric_limits<int>::max() - 1) {
     ++num_written_frames_;
   }
-  return padded_buf_len;
+  written_bytes_.header += frame_header_size();
+  written_bytes_.payload += payload_len;
+  written_bytes_.padding += padding_size;
+  return frame_header_size() + payload_len + padding_size;
 }
 }  // namespace net
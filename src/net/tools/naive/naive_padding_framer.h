@@ -19,6 +19,13 @@ namespace net {
 // };
 class NaivePaddingFramer {
  public:
+  // Of the frames read or written so far.
+  struct ByteCounts {
+    uint64_t payload = 0;
+    uint64_t padding = 0;
+    uint64_t header = 0;
+  };
+
   // `max_read_frames`: Assumes the byte stream stops using the padding
   //   framing after `max_read_frames` frames. If -1, it means
   //   the byte stream always uses the padding framing.
@@ -34,10 +41,15 @@ class NaivePaddingFramer {
 
   int num_written_frames() const { return num_written_frames_; }
 
+  const ByteCounts& read_bytes() const { return read_bytes_; }
+
+  const ByteCounts& written_bytes() const { return written_bytes_; }
+
   // Reads `padded` for `padded_len` bytes and extracts unpadded payload to
   // `payload_buf`.
   // Returns the number of payload bytes extracted.
   // Returning zero indicates a pure padding instead of EOF.
+  // `payload_buf` may be `padded` itself to de-pad in place.
   int Read(const char* padded,
            int padded_len,
            char* payload_buf,
@@ -54,6 +66,11 @@ class NaivePaddingFramer {
             int padded_capacity,
             int& payload_consumed_len);
 
+  // Encodes a frame around `payload_len` payload bytes already placed at
+  // `frame + frame_header_size()`, writing the header before them and
+  // `padding_size` zeros after them. Returns the frame size.
+  int WriteInPlace(char* frame, int payload_len, int padding_size);
+
  private:
   enum class ReadState {
     kPayloadLength1,
@@ -63,14 +80,18 @@ class NaivePaddingFramer {
     kPadding,
   };
 
+  void CountReadFrame();
+
   std::optional<int> max_read_frames_;
 
   ReadState state_ = ReadState::kPayloadLength1;
   int read_payload_length_ = 0;
   int read_padding_length_ = 0;
   int num_read_frames_ = 0;
+  ByteCounts read_bytes_;
 
   int num_written_frames_ = 0;
+  ByteCounts written_bytes_;
 };
 }  // namespace net
 #endif  // NET_TOOLS_NAIVE_NAIVE_PADDING_FRAMER_H_
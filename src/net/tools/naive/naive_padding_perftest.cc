@@ -0,0 +1,226 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures NaivePaddingFramer and NaivePaddingSocket on synthetic streams.
+// Prints ns/byte for each chunk and padding size, and relay buffer
+// allocations per frame for the socket paths.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/check_op.h"
+#include "base/command_line.h"
+#include "base/functional/callback_helpers.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/stream_socket.h"
+#include "net/ssl/ssl_info.h"
+#include "net/tools/naive/naive_buffer_pool.h"
+#include "net/tools/naive/naive_padding_framer.h"
+#include "net/tools/naive/naive_padding_socket.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+namespace {
+
+constexpr int kChunkSizes[] = {1, 64, 1400, 16 * 1024, 64 * 1024};
+constexpr int kPaddingSizes[] = {0, 64, 255};
+constexpr int kFirstPaddings = 8;
+constexpr NetworkTrafficAnnotationTag kTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_perftest", "");
+
+// Serves reads synchronously from a fixed stream and discards writes.
+class MemoryStreamSocket : public StreamSocket {
+ public:
+  explicit MemoryStreamSocket(std::string data) : data_(std::move(data)) {}
+
+  void Rewind() { offset_ = 0; }
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override {
+    int size = std::min<int>(buf_len, data_.size() - offset_);
+    std::memcpy(buf->data(), data_.data() + offset_, size);
+    offset_ += size;
+    return size;
+  }
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override {
+    return buf_len;
+  }
+  int SetReceiveBufferSize(int32_t size) override { return OK; }
+  int SetSendBufferSize(int32_t size) override { return OK; }
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override { return OK; }
+  void Disconnect() override {}
+  bool IsConnected() const override { return true; }
+  bool IsConnectedAndIdle() const override { return true; }
+  int GetPeerAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int GetLocalAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  const NetLogWithSource& NetLog() const override { return net_log_; }
+  bool WasEverUsed() const override { return true; }
+  NextProto GetNegotiatedProtocol() const override { return kProtoUnknown; }
+  bool GetSSLInfo(SSLInfo* ssl_info) override { return false; }
+  int64_t GetTotalReceivedBytes() const override { return offset_; }
+  void ApplySocketTag(const SocketTag& tag) override {}
+
+ private:
+  std::string data_;
+  size_t offset_ = 0;
+  NetLogWithSource net_log_;
+};
+
+// Encodes `total` payload bytes in frames of up to `chunk` bytes.
+std::string EncodeStream(int total, int chunk, int padding) {
+  NaivePaddingFramer framer(std::nullopt);
+  std::string payload(chunk, 'x');
+  std::vector<char> frame(chunk + framer.frame_header_size() + padding);
+  std::string stream;
+  for (int written = 0; written < total;) {
+    int size = std::min(chunk, total - written);
+    int consumed = 0;
+    int frame_size = framer.Write(payload.data(), size, padding, frame.data(),
+                                  frame.size(), consumed);
+    stream.append(frame.data(), frame_size);
+    written += consumed;
+  }
+  return stream;
+}
+
+double NsPerByte(base::TimeDelta elapsed, int64_t bytes) {
+  return static_cast<double>(elapsed.InNanoseconds()) / bytes;
+}
+
+void BenchmarkFramerRead(int total) {
+  std::printf("NaivePaddingFramer::Read (ns/padded byte)\n");
+  for (int padding : kPaddingSizes) {
+    for (int chunk : kChunkSizes) {
+      std::string stream = EncodeStream(total, chunk, padding);
+      NaivePaddingFramer framer(std::nullopt);
+      std::vector<char> payload(chunk);
+      base::TimeTicks start = base::TimeTicks::Now();
+      for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+        int size = std::min<int>(chunk, stream.size() - offset);
+        framer.Read(stream.data() + offset, size, payload.data(),
+                    payload.size());
+      }
+      base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+      std::printf("  chunk %6d padding %3d: %8.3f\n", chunk, padding,
+                  NsPerByte(elapsed, stream.size()));
+    }
+  }
+}
+
+void BenchmarkFramerWrite(int total) {
+  std::printf("NaivePaddingFramer::Write (ns/payload byte)\n");
+  for (int padding : kPaddingSizes) {
+    for (int chunk : kChunkSizes) {
+      NaivePaddingFramer framer(std::nullopt);
+      std::string payload(chunk, 'x');
+      std::vector<char> frame(chunk + framer.frame_header_size() + padding);
+      base::TimeTicks start = base::TimeTicks::Now();
+      for (int written = 0; written < total;) {
+        int consumed = 0;
+        framer.Write(payload.data(), chunk, padding, frame.data(),
+                     frame.size(), consumed);
+        written += consumed;
+      }
+      base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+      std::printf("  chunk %6d padding %3d: %8.3f\n", chunk, padding,
+                  NsPerByte(elapsed, total));
+    }
+  }
+}
+
+// Only the first kFirstPaddings frames of a socket are padded, so each
+// iteration runs a fresh NaivePaddingSocket through its padded phase.
+void BenchmarkSocket(int iterations) {
+  NaivePaddingFramer framer(std::nullopt);
+  NaiveBufferPool* pool = NaiveBufferPool::GetForCurrentThread();
+
+  std::printf(
+      "NaivePaddingSocket padded phase (ns/payload byte, "
+      "buffer allocations/frame)\n");
+  for (int chunk : kChunkSizes) {
+    chunk = std::min(chunk, framer.max_payload_size() -
+                                framer.frame_header_size() -
+                                framer.max_padding_size());
+    MemoryStreamSocket transport(
+        EncodeStream(chunk * kFirstPaddings, chunk, framer.max_padding_size()));
+    auto buf = base::MakeRefCounted<IOBufferWithSize>(chunk);
+    std::memset(buf->data(), 'x', chunk);
+
+    int64_t bytes = 0;
+    uint64_t misses = pool->misses();
+    base::TimeTicks start = base::TimeTicks::Now();
+    for (int i = 0; i < iterations; ++i) {
+      transport.Rewind();
+      NaivePaddingSocket socket(&transport, PaddingType::kVariant1,
+                                PaddingProfile::kUniform, kClient);
+      for (int frame = 0; frame < kFirstPaddings; ++frame) {
+        int rv = socket.Write(buf.get(), chunk, base::DoNothing(),
+                              kTrafficAnnotation);
+        CHECK_EQ(rv, chunk);
+        rv = socket.Read(buf.get(), chunk, base::DoNothing());
+        CHECK_GT(rv, 0);
+        bytes += chunk + rv;
+      }
+    }
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+    double frames = 2.0 * iterations * kFirstPaddings;
+    std::printf("  chunk %6d: %8.3f ns/byte %8.4f allocations/frame\n", chunk,
+                NsPerByte(elapsed, bytes), (pool->misses() - misses) / frames);
+  }
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+
+  int total = 64 * 1024 * 1024;
+  int iterations = 20000;
+  if (command_line.HasSwitch("bytes") &&
+      !base::StringToInt(command_line.GetSwitchValueASCII("bytes"), &total)) {
+    std::fprintf(stderr, "Invalid bytes\n");
+    return EXIT_FAILURE;
+  }
+  if (command_line.HasSwitch("iterations") &&
+      !base::StringToInt(command_line.GetSwitchValueASCII("iterations"),
+                         &iterations)) {
+    std::fprintf(stderr, "Invalid iterations\n");
+    return EXIT_FAILURE;
+  }
+
+  net::BenchmarkFramerRead(total);
+  net::BenchmarkFramerWrite(total);
+  net::BenchmarkSocket(iterations);
+  return EXIT_SUCCESS;
+}
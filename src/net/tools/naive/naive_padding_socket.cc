@@ -9,70 +9,221 @@
 #include <tuple>
 #include <utility>
 
+#include "base/functional/bind.h"
 #include "base/rand_util.h"
 #include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/base_tracing.h"
 #include "net/base/io_buffer.h"
+#include "net/socket/tcp_client_socket.h"
 
 namespace net {
 
 namespace {
 constexpr int kMaxBufferSize = 64 * 1024;
 constexpr int kFirstPaddings = 8;
+
+// Transport calls of the passthrough paths. The overloads of a
+// TCPClientSocket are qualified so they bind statically.
+int TransportRead(StreamSocket* socket,
+                  IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) {
+  return socket->Read(buf, buf_len, std::move(callback));
+}
+
+int TransportRead(TCPClientSocket* socket,
+                  IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) {
+  return socket->TCPClientSocket::Read(buf, buf_len, std::move(callback));
+}
+
+int TransportReadIfReady(StreamSocket* socket,
+                         IOBuffer* buf,
+                         int buf_len,
+                         CompletionOnceCallback callback) {
+  return socket->ReadIfReady(buf, buf_len, std::move(callback));
+}
+
+int TransportReadIfReady(TCPClientSocket* socket,
+                         IOBuffer* buf,
+                         int buf_len,
+                         CompletionOnceCallback callback) {
+  return socket->TCPClientSocket::ReadIfReady(buf, buf_len,
+                                              std::move(callback));
+}
+
+int TransportWrite(StreamSocket* socket,
+                   IOBuffer* buf,
+                   int buf_len,
+                   CompletionOnceCallback callback,
+                   const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return socket->Write(buf, buf_len, std::move(callback), traffic_annotation);
+}
+
+int TransportWrite(TCPClientSocket* socket,
+                   IOBuffer* buf,
+                   int buf_len,
+                   CompletionOnceCallback callback,
+                   const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return socket->TCPClientSocket::Write(buf, buf_len, std::move(callback),
+                                        traffic_annotation);
+}
 }  // namespace
 
 NaivePaddingSocket::NaivePaddingSocket(StreamSocket* transport_socket,
                                        PaddingType padding_type,
+                                       PaddingProfile padding_profile,
                                        Direction direction)
     : transport_socket_(transport_socket),
       padding_type_(padding_type),
       direction_(direction),
-      read_buf_(base::MakeRefCounted<IOBufferWithSize>(kMaxBufferSize)),
-      framer_(kFirstPaddings) {}
+      buffer_pool_(NaiveBufferPool::GetForCurrentThread()),
+      framer_(kFirstPaddings),
+      padding_table_(padding_profile, direction) {
+  // Unretained is safe because the transport is disconnected before this is
+  // destroyed, dropping its callbacks.
+  read_padding_callback_ =
+      base::BindRepeating(&NaivePaddingSocket::OnReadPaddingV1Complete,
+                          base::Unretained(this));
+  write_padding_callback_ =
+      base::BindRepeating(&NaivePaddingSocket::OnWritePaddingV1Complete,
+                          base::Unretained(this));
+  SelectPaths();
+}
 
 NaivePaddingSocket::~NaivePaddingSocket() {
   Disconnect();
+  // A buffer framed in place belongs to the caller.
+  if (write_in_place_headroom_ < 0) {
+    buffer_pool_->Release(std::move(write_buf_));
+  }
 }
 
 void NaivePaddingSocket::Disconnect() {
   transport_socket_->Disconnect();
 }
 
+int NaivePaddingSocket::ShutdownWrite() {
+  return transport_socket_->ShutdownWrite();
+}
+
+void NaivePaddingSocket::set_transport_socket(StreamSocket* transport_socket) {
+  transport_socket_ = transport_socket;
+  tcp_transport_ = false;
+  SelectPaths();
+}
+
+void NaivePaddingSocket::set_transport_socket(
+    TCPClientSocket* transport_socket) {
+  transport_socket_ = transport_socket;
+  tcp_transport_ = true;
+  SelectPaths();
+}
+
+void NaivePaddingSocket::SelectPaths() {
+  bool padded = padding_type_ != PaddingType::kNone;
+  if (padded && framer_.num_read_frames() < kFirstPaddings) {
+    read_path_ = &NaivePaddingSocket::ReadPadded;
+    read_if_ready_path_ = &NaivePaddingSocket::ReadIfReadyPadded;
+  } else if (tcp_transport_) {
+    read_path_ = &NaivePaddingSocket::ReadPassthrough<TCPClientSocket>;
+    read_if_ready_path_ =
+        &NaivePaddingSocket::ReadIfReadyPassthrough<TCPClientSocket>;
+  } else {
+    read_path_ = &NaivePaddingSocket::ReadPassthrough<StreamSocket>;
+    read_if_ready_path_ =
+        &NaivePaddingSocket::ReadIfReadyPassthrough<StreamSocket>;
+  }
+  if (padded && framer_.num_written_frames() < kFirstPaddings) {
+    write_path_ = &NaivePaddingSocket::WritePadded;
+  } else if (tcp_transport_) {
+    write_path_ = &NaivePaddingSocket::WritePassthrough<TCPClientSocket>;
+  } else {
+    write_path_ = &NaivePaddingSocket::WritePassthrough<StreamSocket>;
+  }
+}
+
 int NaivePaddingSocket::Read(IOBuffer* buf,
                              int buf_len,
                              CompletionOnceCallback callback) {
   DCHECK(!callback.is_null());
+  return (this->*read_path_)(buf, buf_len, std::move(callback));
+}
 
-  switch (padding_type_) {
-    case PaddingType::kNone:
-      return ReadNoPadding(buf, buf_len, std::move(callback));
-    case PaddingType::kVariant1:
-      if (framer_.num_read_frames() < kFirstPaddings) {
-        return ReadPaddingV1(buf, buf_len, std::move(callback));
-      } else {
-        return ReadNoPadding(buf, buf_len, std::move(callback));
-      }
-    default:
-      NOTREACHED();
-  }
+int NaivePaddingSocket::ReadIfReady(IOBuffer* buf,
+                                    int buf_len,
+                                    CompletionOnceCallback callback) {
+  DCHECK(!callback.is_null());
+  return (this->*read_if_ready_path_)(buf, buf_len, std::move(callback));
 }
 
-int NaivePaddingSocket::ReadNoPadding(IOBuffer* buf,
-                                      int buf_len,
-                                      CompletionOnceCallback callback) {
-  int rv = transport_socket_->Read(
-      buf, buf_len,
-      base::BindOnce(&NaivePaddingSocket::OnReadNoPaddingComplete,
-                     base::Unretained(this), std::move(callback)));
-  return rv;
+int NaivePaddingSocket::CancelReadIfReady() {
+  return transport_socket_->CancelReadIfReady();
+}
+
+template <typename Transport>
+int NaivePaddingSocket::ReadPassthrough(IOBuffer* buf,
+                                        int buf_len,
+                                        CompletionOnceCallback callback) {
+  // Hands the callback to the transport directly so unpadded reads cost no
+  // extra callback hop or binding allocation.
+  return TransportRead(static_cast<Transport*>(transport_socket_), buf,
+                       buf_len, std::move(callback));
+}
+
+template <typename Transport>
+int NaivePaddingSocket::ReadIfReadyPassthrough(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback) {
+  return TransportReadIfReady(static_cast<Transport*>(transport_socket_), buf,
+                              buf_len, std::move(callback));
 }
 
-void NaivePaddingSocket::OnReadNoPaddingComplete(
+template <typename Transport>
+int NaivePaddingSocket::WritePassthrough(
+    IOBuffer* buf,
+    int buf_len,
     CompletionOnceCallback callback,
-    int rv) {
-  DCHECK_NE(ERR_IO_PENDING, rv);
-  DCHECK(callback);
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  return TransportWrite(static_cast<Transport*>(transport_socket_), buf,
+                        buf_len, std::move(callback), traffic_annotation);
+}
+
+int NaivePaddingSocket::ReadPadded(IOBuffer* buf,
+                                   int buf_len,
+                                   CompletionOnceCallback callback) {
+  if (framer_.num_read_frames() >= kFirstPaddings) {
+    SelectPaths();
+    return (this->*read_path_)(buf, buf_len, std::move(callback));
+  }
+  return ReadPaddingV1(buf, buf_len, std::move(callback));
+}
+
+int NaivePaddingSocket::ReadIfReadyPadded(IOBuffer* buf,
+                                          int buf_len,
+                                          CompletionOnceCallback callback) {
+  if (framer_.num_read_frames() >= kFirstPaddings) {
+    SelectPaths();
+    return (this->*read_if_ready_path_)(buf, buf_len, std::move(callback));
+  }
+  // De-padding may need several transport reads.
+  return ERR_READ_IF_READY_NOT_IMPLEMENTED;
+}
 
-  std::move(callback).Run(rv);
+int NaivePaddingSocket::WritePadded(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  if (framer_.num_written_frames() >= kFirstPaddings) {
+    SelectPaths();
+    return (this->*write_path_)(buf, buf_len, std::move(callback),
+                                traffic_annotation);
+  }
+  return WritePaddingV1(buf, buf_len, std::move(callback),
+                        traffic_annotation);
 }
 
 int NaivePaddingSocket::ReadPaddingV1(IOBuffer* buf,
@@ -81,9 +232,6 @@ int NaivePaddingSocket::ReadPaddingV1(IOBuffer* buf,
   DCHECK(!callback.is_null());
   DCHECK(read_user_buf_ == nullptr);
 
-  // Truncates user requested buf len if it is too large for the padding
-  // buffer.
-  buf_len = std::min(buf_len, kMaxBufferSize);
   read_user_buf_ = buf;
   read_user_buf_len_ = buf_len;
 
@@ -105,7 +253,8 @@ void NaivePaddingSocket::OnReadPaddingV1Complete(int rv) {
   DCHECK(read_user_buf_ != nullptr);
 
   if (rv > 0) {
-    rv = framer_.Read(read_buf_->data(), rv, read_user_buf_->data(),
+    TRACE_EVENT("net", "NaivePaddingSocket::UnframeRead", "bytes", rv);
+    rv = framer_.Read(read_user_buf_->data(), rv, read_user_buf_->data(),
                       read_user_buf_len_);
     if (rv == 0) {
       rv = ReadPaddingV1Payload();
@@ -123,14 +272,13 @@ void NaivePaddingSocket::OnReadPaddingV1Complete(int rv) {
 
 int NaivePaddingSocket::ReadPaddingV1Payload() {
   for (;;) {
-    int rv = transport_socket_->Read(
-        read_buf_.get(), read_user_buf_len_,
-        base::BindOnce(&NaivePaddingSocket::OnReadPaddingV1Complete,
-                       base::Unretained(this)));
+    int rv = transport_socket_->Read(read_user_buf_, read_user_buf_len_,
+                                     read_padding_callback_);
     if (rv <= 0) {
       return rv;
     }
-    rv = framer_.Read(read_buf_->data(), rv, read_user_buf_->data(),
+    TRACE_EVENT("net", "NaivePaddingSocket::UnframeRead", "bytes", rv);
+    rv = framer_.Read(read_user_buf_->data(), rv, read_user_buf_->data(),
                       read_user_buf_len_);
     if (rv > 0) {
       return rv;
@@ -143,44 +291,46 @@ int NaivePaddingSocket::Write(
     int buf_len,
     CompletionOnceCallback callback,
     const NetworkTrafficAnnotationTag& traffic_annotation) {
-  switch (padding_type_) {
-    case PaddingType::kNone:
-      return WriteNoPadding(buf, buf_len, std::move(callback),
-                            traffic_annotation);
-    case PaddingType::kVariant1:
-      if (framer_.num_written_frames() < kFirstPaddings) {
-        return WritePaddingV1(buf, buf_len, std::move(callback),
+  return (this->*write_path_)(buf, buf_len, std::move(callback),
                               traffic_annotation);
-      } else {
-        return WriteNoPadding(buf, buf_len, std::move(callback),
-                              traffic_annotation);
-      }
-    default:
-      NOTREACHED();
-  }
 }
 
-int NaivePaddingSocket::WriteNoPadding(
-    IOBuffer* buf,
+int NaivePaddingSocket::Write(
+    NaiveRelayBuffer* buf,
     int buf_len,
     CompletionOnceCallback callback,
     const NetworkTrafficAnnotationTag& traffic_annotation) {
-  return transport_socket_->Write(
-      buf, buf_len,
-      base::BindOnce(&NaivePaddingSocket::OnWriteNoPaddingComplete,
-                     base::Unretained(this), std::move(callback),
-                     traffic_annotation),
-      traffic_annotation);
+  if (write_headroom() > 0 && buf_len == buf->BytesRemaining() &&
+      buf_len <= framer_.max_payload_size() &&
+      buf->headroom() >= write_headroom() &&
+      buf->tailroom() >= write_tailroom()) {
+    return WritePaddingV1InPlace(buf, std::move(callback), traffic_annotation);
+  }
+  return Write(static_cast<IOBuffer*>(buf), buf_len, std::move(callback),
+               traffic_annotation);
 }
 
-void NaivePaddingSocket::OnWriteNoPaddingComplete(
-    CompletionOnceCallback callback,
-    const NetworkTrafficAnnotationTag& traffic_annotation,
-    int rv) {
-  DCHECK_NE(ERR_IO_PENDING, rv);
-  DCHECK(callback);
+int NaivePaddingSocket::write_headroom() const {
+  if (padding_type_ == PaddingType::kNone ||
+      framer_.num_written_frames() >= kFirstPaddings) {
+    return 0;
+  }
+  return framer_.frame_header_size();
+}
+
+size_t NaivePaddingSocket::GetMemoryUsage() const {
+  if (!write_buf_ || write_in_place_headroom_ >= 0)
+    return 0;
+  return write_buf_->capacity();
+}
 
-  std::move(callback).Run(rv);
+bool NaivePaddingSocket::IsReadPassthrough() const {
+  return padding_type_ == PaddingType::kNone ||
+         framer_.num_read_frames() >= kFirstPaddings;
+}
+
+int NaivePaddingSocket::write_tailroom() const {
+  return write_headroom() > 0 ? framer_.max_padding_size() : 0;
 }
 
 int NaivePaddingSocket::WritePaddingV1(
@@ -189,57 +339,106 @@ int NaivePaddingSocket::WritePaddingV1(
     CompletionOnceCallback callback,
     const NetworkTrafficAnnotationTag& traffic_annotation) {
   DCHECK(write_buf_ == nullptr);
+  TRACE_EVENT("net", "NaivePaddingSocket::FrameWrite", "bytes", buf_len);
 
-  auto padded = base::MakeRefCounted<IOBufferWithSize>(kMaxBufferSize);
-  int padding_size;
-  if (direction_ == kServer) {
-    if (buf_len < 100) {
-      padding_size = base::RandInt(framer_.max_padding_size() - buf_len,
-                                   framer_.max_padding_size());
-    } else {
-      padding_size = base::RandInt(0, framer_.max_padding_size());
-    }
-  } else {
-    padding_size = base::RandInt(0, framer_.max_padding_size());
-  }
+  write_buf_ = buffer_pool_->Get(kMaxBufferSize);
+  int padding_size = ChoosePaddingSize(buf_len);
   int write_buf_len =
-      framer_.Write(buf->data(), buf_len, padding_size, padded->data(),
+      framer_.Write(buf->data(), buf_len, padding_size, write_buf_->data(),
                     kMaxBufferSize, write_user_payload_len_);
-  // Using DrainableIOBuffer here because we do not want to
+  // Drains the encoded frames in place because we do not want to
   // repeatedly encode the padding frames when short writes happen.
-  write_buf_ =
-      base::MakeRefCounted<DrainableIOBuffer>(std::move(padded), write_buf_len);
+  write_buf_->Reset(write_buf_len);
 
   int rv = WritePaddingV1Drain(traffic_annotation);
   if (rv == ERR_IO_PENDING) {
     write_callback_ = std::move(callback);
+    write_traffic_annotation_.emplace(traffic_annotation);
     return rv;
   }
 
-  write_buf_ = nullptr;
-  write_user_payload_len_ = 0;
+  FinishPaddingV1Write();
 
   return rv;
 }
 
-void NaivePaddingSocket::OnWritePaddingV1Complete(
-    const NetworkTrafficAnnotationTag& traffic_annotation,
-    int rv) {
+int NaivePaddingSocket::WritePaddingV1InPlace(
+    NaiveRelayBuffer* buf,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  DCHECK(write_buf_ == nullptr);
+
+  int payload_len = buf->BytesRemaining();
+  TRACE_EVENT("net", "NaivePaddingSocket::FrameWriteInPlace", "bytes",
+              payload_len);
+  int padding_size = ChoosePaddingSize(payload_len);
+  write_in_place_headroom_ = buf->headroom();
+  write_user_payload_len_ = payload_len;
+  // Widens the buffer over the reserved room and encodes the frame around
+  // the payload, so the payload is not copied.
+  buf->Reset(write_in_place_headroom_ - framer_.frame_header_size(),
+             framer_.frame_header_size() + payload_len + padding_size);
+  framer_.WriteInPlace(buf->data(), payload_len, padding_size);
+  write_buf_ = buf;
+
+  int rv = WritePaddingV1Drain(traffic_annotation);
+  if (rv == ERR_IO_PENDING) {
+    write_callback_ = std::move(callback);
+    write_traffic_annotation_.emplace(traffic_annotation);
+    return rv;
+  }
+
+  FinishPaddingV1Write();
+
+  return rv;
+}
+
+int NaivePaddingSocket::ChoosePaddingSize(int payload_len) {
+  if (padding_type_ == PaddingType::kVariant2) {
+    return padding_table_.NextPaddingSize(payload_len,
+                                          framer_.max_padding_size());
+  }
+  if (direction_ == kServer && payload_len < 100) {
+    return base::RandInt(framer_.max_padding_size() - payload_len,
+                         framer_.max_padding_size());
+  }
+  return base::RandInt(0, framer_.max_padding_size());
+}
+
+int NaivePaddingSocket::ChooseSplitSize() {
+  if (padding_type_ == PaddingType::kVariant2) {
+    return padding_table_.NextSplitSize();
+  }
+  return base::RandInt(200, 300);
+}
+
+void NaivePaddingSocket::FinishPaddingV1Write() {
+  if (write_in_place_headroom_ >= 0) {
+    // Hands the caller's buffer back as it was passed in.
+    write_buf_->Reset(write_in_place_headroom_, write_user_payload_len_);
+    write_buf_ = nullptr;
+    write_in_place_headroom_ = -1;
+  } else {
+    buffer_pool_->Release(std::move(write_buf_));
+  }
+  write_user_payload_len_ = 0;
+}
+
+void NaivePaddingSocket::OnWritePaddingV1Complete(int rv) {
   DCHECK_NE(ERR_IO_PENDING, rv);
   DCHECK(write_callback_);
   DCHECK(write_buf_ != nullptr);
 
   if (rv > 0) {
     write_buf_->DidConsume(rv);
-    rv = WritePaddingV1Drain(traffic_annotation);
+    rv = WritePaddingV1Drain(*write_traffic_annotation_);
     if (rv == ERR_IO_PENDING)
       return;
   }
 
   // Must reset these before invoking write_callback_, which may reenter
   // Write().
-  write_buf_ = nullptr;
-  write_user_payload_len_ = 0;
+  FinishPaddingV1Write();
 
   std::move(write_callback_).Run(rv);
 }
@@ -252,13 +451,15 @@ int NaivePaddingSocket::WritePaddingV1Drain(
     int remaining = write_buf_->BytesRemaining();
     if (direction_ == kServer && write_user_payload_len_ > 400 &&
         write_user_payload_len_ < 1024) {
-      remaining = std::min(remaining, base::RandInt(200, 300));
+      int split_size = ChooseSplitSize();
+      if (split_size < remaining) {
+        remaining = split_size;
+        ++num_split_writes_;
+      }
     }
-    int rv = transport_socket_->Write(
-        write_buf_.get(), remaining,
-        base::BindOnce(&NaivePaddingSocket::OnWritePaddingV1Complete,
-                       base::Unretained(this), traffic_annotation),
-        traffic_annotation);
+    int rv = transport_socket_->Write(write_buf_.get(), remaining,
+                                      write_padding_callback_,
+                                      traffic_annotation);
     if (rv <= 0) {
       return rv;
     }
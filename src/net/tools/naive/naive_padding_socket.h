@@ -5,6 +5,7 @@
 #define NET_TOOLS_NAIVE_NAIVE_PADDING_SOCKET_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -18,17 +19,23 @@
 #include "net/base/net_errors.h"
 #include "net/base/net_export.h"
 #include "net/socket/stream_socket.h"
+#include "net/tools/naive/naive_buffer_pool.h"
 #include "net/tools/naive/naive_padding_framer.h"
+#include "net/tools/naive/naive_padding_table.h"
 #include "net/tools/naive/naive_protocol.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
 #include "url/gurl.h"
 
 namespace net {
 
+class TCPClientSocket;
+
 class NaivePaddingSocket {
  public:
+  // `padding_profile` shapes padded writes of PaddingType::kVariant2.
   NaivePaddingSocket(StreamSocket* transport_socket,
                      PaddingType padding_type,
+                     PaddingProfile padding_profile,
                      Direction direction);
 
   NaivePaddingSocket(const NaivePaddingSocket&) = delete;
@@ -38,27 +45,108 @@ class NaivePaddingSocket {
   ~NaivePaddingSocket();
 
   void Disconnect();
+  // Half-closes the transport, see StreamSocket::ShutdownWrite(). Completed
+  // writes end on a frame boundary, so the peer reads EOF between frames.
+  int ShutdownWrite();
+
+  // Reads and writes on `transport_socket` from the next call, e.g. on the
+  // transport of a handshake socket that only passes data through from now
+  // on. The old socket must outlive the pending calls, which complete
+  // through it.
+  void set_transport_socket(StreamSocket* transport_socket);
+  // Same as above for a TCP transport, which unpadded reads and writes then
+  // call without virtual dispatch.
+  void set_transport_socket(TCPClientSocket* transport_socket);
 
   int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
 
+  // Waits for readiness without holding `buf` like StreamSocket::ReadIfReady().
+  // Returns ERR_READ_IF_READY_NOT_IMPLEMENTED while padding frames are still
+  // expected because de-padding may need several transport reads, or if the
+  // transport does not support it. Falls back to Read() in that case.
+  int ReadIfReady(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int CancelReadIfReady();
+
   int Write(IOBuffer* buf,
             int buf_len,
             CompletionOnceCallback callback,
             const NetworkTrafficAnnotationTag& traffic_annotation);
 
+  // Same as above, but encodes padded frames around the payload in place if
+  // `buf` has write_headroom() bytes free before its data and
+  // write_tailroom() bytes after. `buf` is restored before completion.
+  int Write(NaiveRelayBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation);
+
+  // The room the next Write() can use for in-place framing. Zero once writes
+  // are no longer padded.
+  int write_headroom() const;
+  int write_tailroom() const;
+
+  // Bytes of the copied padded frames of a pending write, for memory
+  // accounting. Frames encoded in place are in the caller's buffer.
+  size_t GetMemoryUsage() const;
+
+  // Whether reads return the transport data as is, with no padding frames
+  // left to remove.
+  bool IsReadPassthrough() const;
+
+  PaddingType padding_type() const { return padding_type_; }
+  int num_read_frames() const { return framer_.num_read_frames(); }
+  int num_written_frames() const { return framer_.num_written_frames(); }
+  const NaivePaddingFramer::ByteCounts& read_bytes() const {
+    return framer_.read_bytes();
+  }
+  const NaivePaddingFramer::ByteCounts& written_bytes() const {
+    return framer_.written_bytes();
+  }
+  // Transport writes that WritePaddingV1Drain() cut short of the encoded
+  // frames to split them.
+  uint64_t num_split_writes() const { return num_split_writes_; }
+
  private:
-  int ReadNoPadding(IOBuffer* buf,
-                    int buf_len,
-                    CompletionOnceCallback callback);
-  int WriteNoPadding(IOBuffer* buf,
-                     int buf_len,
-                     CompletionOnceCallback callback,
-                     const NetworkTrafficAnnotationTag& traffic_annotation);
-  void OnReadNoPaddingComplete(CompletionOnceCallback callback, int rv);
-  void OnWriteNoPaddingComplete(
+  using ReadPath = int (NaivePaddingSocket::*)(IOBuffer* buf,
+                                               int buf_len,
+                                               CompletionOnceCallback callback);
+  using WritePath = int (NaivePaddingSocket::*)(
+      IOBuffer* buf,
+      int buf_len,
       CompletionOnceCallback callback,
-      const NetworkTrafficAnnotationTag& traffic_annotation,
-      int rv);
+      const NetworkTrafficAnnotationTag& traffic_annotation);
+
+  // Points the paths of Read(), ReadIfReady() and Write() at the padded
+  // ones while frames are still padded, and at the passthrough ones of the
+  // transport type after, so the relay does not check the padding state or
+  // dispatch on the transport for each call.
+  void SelectPaths();
+
+  // Passthrough paths, `Transport` being the type of `transport_socket_`.
+  template <typename Transport>
+  int ReadPassthrough(IOBuffer* buf,
+                      int buf_len,
+                      CompletionOnceCallback callback);
+  template <typename Transport>
+  int ReadIfReadyPassthrough(IOBuffer* buf,
+                             int buf_len,
+                             CompletionOnceCallback callback);
+  template <typename Transport>
+  int WritePassthrough(IOBuffer* buf,
+                       int buf_len,
+                       CompletionOnceCallback callback,
+                       const NetworkTrafficAnnotationTag& traffic_annotation);
+
+  // Padded paths, which select the passthrough ones once the frames are
+  // done.
+  int ReadPadded(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int ReadIfReadyPadded(IOBuffer* buf,
+                        int buf_len,
+                        CompletionOnceCallback callback);
+  int WritePadded(IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback,
+                  const NetworkTrafficAnnotationTag& traffic_annotation);
 
   int ReadPaddingV1(IOBuffer* buf,
                     int buf_len,
@@ -67,10 +155,16 @@ class NaivePaddingSocket {
                      int buf_len,
                      CompletionOnceCallback callback,
                      const NetworkTrafficAnnotationTag& traffic_annotation);
+  int WritePaddingV1InPlace(
+      NaiveRelayBuffer* buf,
+      CompletionOnceCallback callback,
+      const NetworkTrafficAnnotationTag& traffic_annotation);
+  int ChoosePaddingSize(int payload_len);
+  int ChooseSplitSize();
+  // Releases or restores write_buf_ after a padded write.
+  void FinishPaddingV1Write();
   void OnReadPaddingV1Complete(int rv);
-  void OnWritePaddingV1Complete(
-      const NetworkTrafficAnnotationTag& traffic_annotation,
-      int rv);
+  void OnWritePaddingV1Complete(int rv);
 
   // Exhausts synchronous reads if it is a pure padding
   // so this does not return zero for non-EOF condition.
@@ -84,20 +178,39 @@ class NaivePaddingSocket {
   // handling and making it owning the transport socket may interfere badly
   // with the client socket pool.
   StreamSocket* transport_socket_;
+  // Whether `transport_socket_` is a TCPClientSocket.
+  bool tcp_transport_ = false;
 
   PaddingType padding_type_;
   Direction direction_;
 
+  ReadPath read_path_;
+  ReadPath read_if_ready_path_;
+  WritePath write_path_;
+
+  // Bound once and copied for each transport read and write of padded
+  // frames, which takes a reference instead of allocating.
+  CompletionRepeatingCallback read_padding_callback_;
+  CompletionRepeatingCallback write_padding_callback_;
+
   IOBuffer* read_user_buf_ = nullptr;
   int read_user_buf_len_ = 0;
   CompletionOnceCallback read_callback_;
-  scoped_refptr<IOBuffer> read_buf_;
+  NaiveBufferPool* buffer_pool_;
 
   int write_user_payload_len_ = 0;
   CompletionOnceCallback write_callback_;
-  scoped_refptr<DrainableIOBuffer> write_buf_;
+  // Of the pending padded write.
+  std::optional<NetworkTrafficAnnotationTag> write_traffic_annotation_;
+  scoped_refptr<NaiveRelayBuffer> write_buf_;
+  // Headroom of the caller's buffer if write_buf_ is framed in place,
+  // otherwise -1.
+  int write_in_place_headroom_ = -1;
+
+  uint64_t num_split_writes_ = 0;
 
   NaivePaddingFramer framer_;
+  NaivePaddingTable padding_table_;
 };
 
 }  // namespace net
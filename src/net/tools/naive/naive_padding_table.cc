@@ -0,0 +1,57 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_padding_table.h"
+
+#include "base/notreached.h"
+#include "base/rand_util.h"
+
+namespace net {
+
+std::optional<PaddingProfile> ParsePaddingProfile(std::string_view str) {
+  if (str == "uniform") {
+    return PaddingProfile::kUniform;
+  } else if (str == "light") {
+    return PaddingProfile::kLight;
+  } else if (str == "heavy") {
+    return PaddingProfile::kHeavy;
+  } else {
+    return std::nullopt;
+  }
+}
+
+NaivePaddingTable::NaivePaddingTable(PaddingProfile profile,
+                                     Direction direction)
+    : profile_(profile), direction_(direction) {
+  base::RandBytes(random_);
+}
+
+int NaivePaddingTable::NextPaddingSize(int payload_len,
+                                       int max_padding_size) {
+  // Hides the size of short server replies regardless of the profile.
+  if (direction_ == kServer && payload_len < 100) {
+    return NextInRange(max_padding_size - payload_len, max_padding_size);
+  }
+  switch (profile_) {
+    case PaddingProfile::kUniform:
+      return NextInRange(0, max_padding_size);
+    case PaddingProfile::kLight:
+      return NextInRange(0, max_padding_size / 4);
+    case PaddingProfile::kHeavy:
+      return NextInRange(max_padding_size / 2 + 1, max_padding_size);
+  }
+  NOTREACHED();
+}
+
+int NaivePaddingTable::NextSplitSize() {
+  return NextInRange(200, 300);
+}
+
+int NaivePaddingTable::NextInRange(int min, int max) {
+  // Wraps around instead of failing if more sizes are drawn than expected.
+  int value = random_[next_];
+  next_ = (next_ + 1) % kTableSize;
+  return min + value * (max - min + 1) / 256;
+}
+
+}  // namespace net
@@ -0,0 +1,57 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_PADDING_TABLE_H_
+#define NET_TOOLS_NAIVE_NAIVE_PADDING_TABLE_H_
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+// Shapes the padding sizes of PaddingType::kVariant2 frames. Only affects
+// the sending side, so the peers do not need to agree on it.
+enum class PaddingProfile {
+  // Uniform in [0, 255] like kVariant1.
+  kUniform,
+  // Uniform in [0, 63], for less padding overhead.
+  kLight,
+  // Uniform in [128, 255], for more frame size variation.
+  kHeavy,
+};
+
+// Returns empty if `str` is invalid.
+std::optional<PaddingProfile> ParsePaddingProfile(std::string_view str);
+
+// Random sizes for the padded frames of one connection side. Drawn from the
+// CSPRNG once at construction instead of once or twice per frame.
+class NaivePaddingTable {
+ public:
+  NaivePaddingTable(PaddingProfile profile, Direction direction);
+  NaivePaddingTable(const NaivePaddingTable&) = delete;
+  NaivePaddingTable& operator=(const NaivePaddingTable&) = delete;
+
+  // Returns the padding size of the next frame carrying `payload_len`
+  // bytes, at most `max_padding_size`.
+  int NextPaddingSize(int payload_len, int max_padding_size);
+
+  // Returns a size in [200, 300] to split a transport write at.
+  int NextSplitSize();
+
+ private:
+  // Enough for eight padded frames each split into up to five writes.
+  static constexpr int kTableSize = 64;
+
+  int NextInRange(int min, int max);
+
+  PaddingProfile profile_;
+  Direction direction_;
+  uint8_t random_[kTableSize];
+  int next_ = 0;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_PADDING_TABLE_H_
@@ -3,10 +3,14 @@
 // found in the LICENSE file.
 #include "net/tools/naive/naive_protocol.h"
 
+#include <algorithm>
 #include <optional>
 #include <string>
+#include <vector>
 
+#include "base/logging.h"
 #include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
 
 namespace net {
 const char* ToString(ClientProtocol value) {
@@ -17,6 +21,16 @@ const char* ToString(ClientProtocol value) {
       return "http";
     case ClientProtocol::kRedir:
       return "redir";
+    case ClientProtocol::kHttps:
+      return "https";
+    case ClientProtocol::kQuic:
+      return "quic";
+    case ClientProtocol::kBond:
+      return "bond";
+    case ClientProtocol::kEmbedded:
+      return "embed";
+    case ClientProtocol::kTun:
+      return "tun";
     default:
       return "";
   }
@@ -27,17 +41,55 @@ std::optional<PaddingType> ParsePaddingType(std::string_view str) {
     return PaddingType::kNone;
   } else if (str == "1") {
     return PaddingType::kVariant1;
+  } else if (str == "2") {
+    return PaddingType::kVariant2;
   } else {
     return std::nullopt;
   }
 }
 
+std::optional<PaddingType> NegotiatePaddingType(
+    bool has_padding,
+    std::optional<std::string_view> padding_type_request,
+    const std::vector<PaddingType>& supported_padding_types) {
+  if (!padding_type_request.has_value()) {
+    // Backward compatibility with before kVariant1 when the padding-version
+    // header does not exist.
+    if (has_padding) {
+      return PaddingType::kVariant1;
+    } else {
+      return PaddingType::kNone;
+    }
+  }
+
+  std::vector<std::string_view> padding_type_strs = base::SplitStringPiece(
+      *padding_type_request, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  for (std::string_view padding_type_str : padding_type_strs) {
+    std::optional<PaddingType> padding_type =
+        ParsePaddingType(padding_type_str);
+    // Skips types from newer clients so they can fall back to older ones.
+    if (!padding_type.has_value()) {
+      LOG(WARNING) << "Unknown padding type: " << padding_type_str;
+      continue;
+    }
+    if (std::find(supported_padding_types.begin(),
+                  supported_padding_types.end(),
+                  *padding_type) != supported_padding_types.end()) {
+      return padding_type;
+    }
+  }
+  LOG(ERROR) << "No padding type is supported: " << *padding_type_request;
+  return std::nullopt;
+}
+
 const char* ToString(PaddingType value) {
   switch (value) {
     case PaddingType::kNone:
       return "0";
     case PaddingType::kVariant1:
       return "1";
+    case PaddingType::kVariant2:
+      return "2";
     default:
       return "";
   }
@@ -49,6 +101,8 @@ const char* ToReadableString(PaddingType value) {
       return "None";
     case PaddingType::kVariant1:
       return "Variant1";
+    case PaddingType::kVariant2:
+      return "Variant2";
     default:
       return "";
   }
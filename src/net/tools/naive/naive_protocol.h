@@ -7,12 +7,27 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace net {
 enum class ClientProtocol {
   kSocks5,
   kHttp,
   kRedir,
+  // HTTP CONNECT over TLS, with each HTTP/2 stream a tunnel. Also that of
+  // h2c:// listeners, cleartext HTTP/2 with prior knowledge.
+  kHttps,
+  // HTTP/3 CONNECT over QUIC, with each request stream a tunnel.
+  kQuic,
+  // Tunnels of https:// or quic:// joined by NaiveBondJoiner into one
+  // NaiveBondSocket.
+  kBond,
+  // Connected sockets handed over by a host process through NaiveEmbedding,
+  // with the destination known and no handshake.
+  kEmbedded,
+  // TCP connections from a TUN device, terminated by NaiveTunStack. The
+  // destination is that of the client's packets.
+  kTun,
 };
 
 const char* ToString(ClientProtocol value);
@@ -41,11 +56,24 @@ enum class PaddingType {
   // };
   // Wire format: "1".
   kVariant1 = 1,
+
+  // Same frames as kVariant1, but padding sizes are taken from a table drawn
+  // once per connection and shaped by the sender's PaddingProfile.
+  // Wire format: "2".
+  kVariant2 = 2,
 };
 
 // Returns empty if `str` is invalid.
 std::optional<PaddingType> ParsePaddingType(std::string_view str);
 
+// Picks the padding type of a tunnel request from the value of its
+// kPaddingTypeRequestHeader, if any, and whether it has kPaddingHeader.
+// Returns empty if none of the requested types is supported.
+std::optional<PaddingType> NegotiatePaddingType(
+    bool has_padding,
+    std::optional<std::string_view> padding_type_request,
+    const std::vector<PaddingType>& supported_padding_types);
+
 const char* ToString(PaddingType value);
 
 const char* ToReadableString(PaddingType value);
@@ -60,5 +88,17 @@ constexpr const char* kPaddingTypeRequestHeader = "padding-type-request";
 // Must be one of PaddingType.
 constexpr const char* kPaddingTypeReplyHeader = "padding-type-reply";
 
+// Contains the number of tunnels a client would stripe a connection over.
+constexpr const char* kBondRequestHeader = "bond-request";
+
+// Contains the most members of a bond the server joins, sent in reply to
+// kBondRequestHeader if it joins bonds.
+constexpr const char* kBondReplyHeader = "bond-reply";
+
+// The destination of the member tunnels of a bond, whose hellos name the
+// actual destination. Reserved so that it is never a real host.
+constexpr const char* kBondHost = "bond.naive.invalid";
+constexpr int kBondPort = 443;
+
 }  // namespace net
 #endif  // NET_TOOLS_NAIVE_NAIVE_PROTOCOL_H_
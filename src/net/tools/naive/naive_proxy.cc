@@ -5,142 +5,909 @@
 
 #include "net/tools/naive/naive_proxy.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <optional>
 #include <string>
 #include <utility>
 
 #include "base/functional/bind.h"
+#include "base/functional/callback_helpers.h"
+#include "base/hash/hash.h"
+#include "base/json/string_escape.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/notreached.h"
+#include "base/ranges/algorithm.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
 #include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/base_tracing.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/load_flags.h"
 #include "net/base/net_errors.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "net/base/sockaddr_storage.h"
+#include "net/base/url_util.h"
 #include "net/http/http_network_session.h"
+#include "net/http/proxy_fallback.h"
 #include "net/proxy_resolution/configured_proxy_resolution_service.h"
 #include "net/proxy_resolution/proxy_config.h"
 #include "net/proxy_resolution/proxy_list.h"
+#include "net/quic/quic_session_pool.h"
 #include "net/socket/client_socket_pool_manager.h"
 #include "net/socket/server_socket.h"
+#include "net/socket/ssl_server_socket.h"
 #include "net/socket/stream_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_socket.h"
+#include "net/spdy/spdy_session_pool.h"
 #include "net/tools/naive/http_proxy_server_socket.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_heavy_hitters.h"
+#include "net/tools/naive/naive_hot_destinations.h"
+#include "net/tools/naive/naive_https_server_session.h"
+#include "net/tools/naive/naive_lag_monitor.h"
+#include "net/tools/naive/naive_network_adapter.h"
 #include "net/tools/naive/naive_proxy_delegate.h"
+#include "net/tools/naive/naive_relay_scheduler.h"
+#include "net/tools/naive/naive_wakeup.h"
 #include "net/tools/naive/socks5_server_socket.h"
+#include "url/gurl.h"
+#include "url/scheme_host_port.h"
+
+#if BUILDFLAG(IS_LINUX)
+#include "net/tools/naive/naive_quic_server.h"
+#include "net/tools/naive/naive_tun_tcp_flow.h"
+#endif
+
+#if BUILDFLAG(IS_POSIX)
+#include <sys/socket.h>
+#endif
 
 namespace net {
 
+namespace {
+// Connections on a tunnel session beyond which another session is added,
+// up to NaiveRelayConfig::max_concurrency. Half the common HTTP/2 limit of
+// 100 concurrent streams.
+constexpr int kSessionConnectionsHigh = 50;
+// Lowest threshold of a path whose bandwidth-delay product exceeds the
+// session window many times, where a few bulk transfers fill the window.
+constexpr int kSessionConnectionsMin = 4;
+// How often upstreams race again, which mostly reopens the fallback
+// session once it timed out. Network changes start a race right away.
+constexpr base::TimeDelta kRaceInterval = base::Minutes(10);
+// How long a destination stays bulk after a connection to it relayed
+// NaiveRelayConfig::bulk_bytes.
+constexpr base::TimeDelta kBulkDestinationTtl = base::Minutes(10);
+// Timeouts are checked to the second. Longer ones are checked again each
+// minute or so until due.
+constexpr base::TimeDelta kTimeoutTick = base::Seconds(1);
+constexpr size_t kTimeoutSlots = 64;
+// Sockets accepted per wakeup before their connections are set up. The
+// loop then yields to the open connections and comes back for more.
+constexpr size_t kAcceptBatchSize = 32;
+// Of NaiveRelayConfig::egress_preconnect: the destinations pooled, the
+// connects a destination takes in about one refill interval to be pooled,
+// and how often the pools are topped up, after which the connect counts
+// are halved.
+constexpr size_t kHotDestinations = 16;
+constexpr uint32_t kMinHotConnects = 8;
+constexpr base::TimeDelta kEgressRefillInterval = base::Seconds(10);
+
+std::string FormatDelay(std::optional<base::TimeDelta> delay) {
+  if (!delay)
+    return "-";
+  return base::NumberToString(delay->InMilliseconds()) + " ms";
+}
+
+NaiveAccessLog::Entry MakeAccessLogEntry(const NaiveConnection& connection,
+                                         int reason) {
+  NaiveAccessLog::Entry entry = {};
+  entry.close_time =
+      (base::Time::Now() - base::Time::UnixEpoch()).InMicroseconds();
+  entry.upload_bytes = connection.bytes_relayed(kClient);
+  entry.download_bytes = connection.bytes_relayed(kServer);
+  entry.duration_ms = connection.age().InMilliseconds();
+  entry.result = reason;
+  IPEndPoint client;
+  if (connection.GetClientAddress(&client) == OK) {
+    NaiveAccessLog::SetClient(client, &entry);
+  }
+  NaiveAccessLog::SetDestination(connection.origin(), &entry);
+  entry.protocol = static_cast<uint8_t>(connection.protocol());
+  return entry;
+}
+}  // namespace
+
 NaiveProxy::NaiveProxy(std::unique_ptr<ServerSocket> listen_socket,
+                       std::unique_ptr<SSLServerContext> ssl_server_context,
                        ClientProtocol protocol,
                        const std::string& listen_user,
                        const std::string& listen_pass,
-                       int concurrency,
+                       scoped_refptr<NaiveUserTable> user_table,
+                       scoped_refptr<NaiveRouter> router,
+                       int max_connections,
+                       int max_handshakes,
+                       scoped_refptr<NaiveTunnelSessions> tunnel_sessions,
+                       const NaiveRelayConfig& relay_config,
                        RedirectResolver* resolver,
                        HttpNetworkSession* session,
                        const NetworkTrafficAnnotationTag& traffic_annotation,
                        const std::vector<PaddingType>& supported_padding_types)
     : listen_socket_(std::move(listen_socket)),
+      ssl_server_context_(std::move(ssl_server_context)),
       protocol_(protocol),
       listen_user_(listen_user),
       listen_pass_(listen_pass),
-      concurrency_(concurrency),
+      user_table_(std::move(user_table)),
+      router_(std::move(router)),
+      max_connections_(max_connections),
+      max_handshakes_(max_handshakes),
+      relay_config_(relay_config),
       resolver_(resolver),
       session_(session),
       net_log_(
           NetLogWithSource::Make(session->net_log(), NetLogSourceType::NONE)),
       last_id_(0),
+      accept_count_(0),
+      handshake_count_(0),
+      reject_count_(0),
+      accept_paused_(false),
+      accepting_(true),
+      tunnel_sessions_(std::move(tunnel_sessions)),
+      timeout_wheel_(kTimeoutTick,
+                     kTimeoutSlots,
+                     base::BindRepeating(&NaiveProxy::CheckTimeout,
+                                         base::Unretained(this))),
       traffic_annotation_(traffic_annotation),
       supported_padding_types_(supported_padding_types) {
   const auto& proxy_config = static_cast<ConfiguredProxyResolutionService*>(
                                  session_->proxy_resolution_service())
                                  ->config();
   DCHECK(proxy_config);
-  const ProxyList& proxy_list =
-      proxy_config.value().value().proxy_rules().single_proxies;
-  DCHECK(!proxy_list.IsEmpty());
-  proxy_info_.UseProxyList(proxy_list);
-  proxy_info_.set_traffic_annotation(
-      net::MutableNetworkTrafficAnnotationTag(traffic_annotation_));
+  proxy_list_ = proxy_config.value().value().proxy_rules().single_proxies;
+  DCHECK(!proxy_list_.IsEmpty());
+  for (const ProxyChain& proxy_chain : proxy_list_.AllChains()) {
+    ProxyInfo& proxy_info = proxy_infos_.emplace_back();
+    proxy_info.UseProxyChain(proxy_chain);
+    proxy_info.set_traffic_annotation(
+        net::MutableNetworkTrafficAnnotationTag(traffic_annotation_));
+  }
+  if (router_) {
+    // The config makes sure proxy targets are in the proxy list.
+    for (const ProxyChain& target : router_->targets()) {
+      ProxyInfo& proxy_info = route_infos_.emplace_back();
+      proxy_info.UseProxyChain(target);
+      proxy_info.set_traffic_annotation(
+          net::MutableNetworkTrafficAnnotationTag(traffic_annotation_));
+    }
+    // Unretained is safe because the connections are owned by this.
+    route_callback_ =
+        base::BindRepeating(&NaiveProxy::Route, base::Unretained(this));
+  }
+  // The egress pools are sized by the connections open to each destination.
+  if (relay_config_.max_destination_connections > 0 ||
+      relay_config_.egress_preconnect > 0) {
+    // Likewise.
+    admit_callback_ = base::BindRepeating(&NaiveProxy::AdmitDestination,
+                                          base::Unretained(this));
+  }
+  if (relay_config_.session_affinity || tunnel_sessions_->bulk_sessions > 0) {
+    // Likewise.
+    session_callback_ = base::BindRepeating(
+        &NaiveProxy::PickDestinationSession, base::Unretained(this));
+  }
 
-  for (int i = 0; i < concurrency_; i++) {
-    network_anonymization_keys_.push_back(
+  for (int i = 1; i < relay_config_.bond_members; i++) {
+    bond_network_anonymization_keys_.push_back(
         NetworkAnonymizationKey::CreateTransient());
   }
+  if (relay_config_.accept_bonds) {
+    // Unretained is safe because the joiner is owned by this.
+    bond_joiner_ = std::make_unique<NaiveBondJoiner>(
+        traffic_annotation_, base::BindRepeating(&NaiveProxy::OnBondJoined,
+                                                 base::Unretained(this)));
+  }
+
+  NaiveRelayScheduler::GetForCurrentThread()->set_batch_size(
+      relay_config_.yield_batch);
 
-  DCHECK(listen_socket_);
+  auto* rate_limiter = NaiveRateLimiter::GetForCurrentThread();
+  if (relay_config_.rate_limit > 0) {
+    rate_limits_[0] =
+        rate_limiter->GetSharedLimit(std::string(), relay_config_.rate_limit);
+  }
+  if (relay_config_.listen_rate_limit > 0) {
+    rate_limits_[1] = base::MakeRefCounted<NaiveRateLimiter::Limit>(
+        relay_config_.listen_rate_limit);
+  }
+  if (relay_config_.user_rate_limit > 0 && !listen_user_.empty()) {
+    rate_limits_[2] = rate_limiter->GetSharedLimit(
+        listen_user_, relay_config_.user_rate_limit);
+  }
+
+  // Embedded connections are handed over by AdoptEmbedded() instead, and
+  // those of a TUN device by AdoptTunFlow().
+  DCHECK_EQ(protocol_ == ClientProtocol::kEmbedded ||
+                protocol_ == ClientProtocol::kTun,
+            !listen_socket_);
+  // Unset for the cleartext kHttps of h2c:// listeners.
+  DCHECK(protocol_ == ClientProtocol::kHttps || !ssl_server_context_);
   // Start accepting connections in next run loop in case when delegate is not
   // ready to get callbacks.
   base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
       FROM_HERE, base::BindOnce(&NaiveProxy::DoAcceptLoop,
                                 weak_ptr_factory_.GetWeakPtr()));
+
+  direct_proxy_info_.UseDirect();
+  direct_proxy_info_.set_traffic_annotation(
+      net::MutableNetworkTrafficAnnotationTag(traffic_annotation_));
+
+  observes_network_changes_ = relay_config_.keep_warm_interval.is_positive() ||
+                              proxy_infos_.size() > 1;
+  if (observes_network_changes_) {
+    NetworkChangeNotifier::AddNetworkChangeObserver(this);
+  }
+  if (proxy_infos_.size() > 1) {
+    race_timer_.Start(FROM_HERE, AlignToWakeupPeriod(kRaceInterval),
+                      base::BindRepeating(&NaiveProxy::RaceUpstreams,
+                                          base::Unretained(this)));
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&NaiveProxy::RaceUpstreams,
+                                  weak_ptr_factory_.GetWeakPtr()));
+  }
+  if (relay_config_.keep_warm_interval.is_positive()) {
+    keep_warm_timer_.Start(
+        FROM_HERE, AlignToWakeupPeriod(relay_config_.keep_warm_interval),
+        base::BindRepeating(&NaiveProxy::KeepWarm, base::Unretained(this)));
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&NaiveProxy::KeepWarm, weak_ptr_factory_.GetWeakPtr()));
+  }
+  if (!base::ranges::all_of(proxy_infos_, &ProxyInfo::is_direct)) {
+    // Unretained is safe because the subscriptions are owned by this.
+    auto go_away_callback = base::BindRepeating(
+        &NaiveProxy::OnTunnelSessionGoAway, base::Unretained(this));
+    spdy_go_away_subscription_ =
+        session_->spdy_session_pool()->AddGoAwayCallback(go_away_callback);
+    quic_go_away_subscription_ =
+        session_->quic_session_pool()->AddGoAwayCallback(go_away_callback);
+  }
+  // Unretained is safe because the subscription is owned by this.
+  overload_end_subscription_ =
+      NaiveLagMonitor::GetForCurrentThread()->AddOverloadEndCallback(
+          base::BindRepeating(&NaiveProxy::MaybeResumeAccept,
+                              base::Unretained(this)));
+  if (relay_config_.egress_preconnect > 0) {
+    hot_destinations_ = std::make_unique<NaiveHotDestinations>(
+        kHotDestinations, kMinHotConnects);
+    egress_timer_.Start(FROM_HERE, AlignToWakeupPeriod(kEgressRefillInterval),
+                        base::BindRepeating(&NaiveProxy::RefillEgressPools,
+                                            base::Unretained(this)));
+  }
+  if (GetWakeupPeriod().is_positive() &&
+      tunnel_sessions_->fixed_sessions() > 1) {
+    if (tunnel_sessions_->IsIdle()) {
+      tunnel_sessions_->idle_since = base::TimeTicks::Now();
+    }
+    idle_session_timer_.Start(
+        FROM_HERE, GetWakeupPeriod(),
+        base::BindRepeating(&NaiveProxy::CloseIdleTunnelSessions,
+                            base::Unretained(this)));
+  }
+}
+
+NaiveProxy::~NaiveProxy() {
+  if (observes_network_changes_) {
+    NetworkChangeNotifier::RemoveNetworkChangeObserver(this);
+  }
 }
 
-NaiveProxy::~NaiveProxy() = default;
+void NaiveProxy::StopAccepting() {
+  listen_socket_.reset();
+  accepting_ = false;
+  accept_paused_ = false;
+  // No new connections to warm or rank upstreams for.
+  keep_warm_timer_.Stop();
+  race_timer_.Stop();
+  egress_timer_.Stop();
+  idle_session_timer_.Stop();
+  if (observes_network_changes_) {
+    NetworkChangeNotifier::RemoveNetworkChangeObserver(this);
+    observes_network_changes_ = false;
+  }
+}
 
 void NaiveProxy::DoAcceptLoop() {
-  int result;
-  do {
+  TRACE_EVENT("net", "NaiveProxy::DoAcceptLoop");
+  // The accept queue is drained before any connection of the batch is set
+  // up, so that during a burst of clients it does not overflow while their
+  // handshakes start.
+  int result = OK;
+  while (listen_socket_ && accept_batch_.size() < kAcceptBatchSize) {
+    if (AtConnectionLimit()) {
+      // New clients wait in the listen backlog instead of taking time from
+      // the open connections.
+      accept_paused_ = true;
+      break;
+    }
     result = listen_socket_->Accept(
         &accepted_socket_, base::BindRepeating(&NaiveProxy::OnAcceptComplete,
                                                weak_ptr_factory_.GetWeakPtr()));
-    if (result == ERR_IO_PENDING)
-      return;
-    HandleAcceptResult(result);
-  } while (result == OK);
+    if (result != OK)
+      break;
+    accept_batch_.push_back(std::move(accepted_socket_));
+  }
+  bool batch_full = accept_batch_.size() == kAcceptBatchSize;
+  for (auto& accepted_socket : accept_batch_) {
+    DoConnect(std::move(accepted_socket));
+  }
+  accept_batch_.clear();
+
+  if (result != OK && result != ERR_IO_PENDING) {
+    LOG(ERROR) << "Accept error: " << ErrorToShortString(result);
+  } else if (batch_full) {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&NaiveProxy::DoAcceptLoop,
+                                  weak_ptr_factory_.GetWeakPtr()));
+  }
 }
 
 void NaiveProxy::OnAcceptComplete(int result) {
-  HandleAcceptResult(result);
-  if (result == OK)
-    DoAcceptLoop();
+  if (result != OK) {
+    LOG(ERROR) << "Accept error: " << ErrorToShortString(result);
+    return;
+  }
+  accept_batch_.push_back(std::move(accepted_socket_));
+  DoAcceptLoop();
+}
+
+bool NaiveProxy::AtConnectionLimit() const {
+  if (!accepting_)
+    return false;
+  if (NaiveLagMonitor::GetForCurrentThread()->ShouldPauseAccept())
+    return true;
+  // Counts the sockets accepted in the current batch.
+  if (max_connections_ > 0 &&
+      connections_.size() + accept_batch_.size() >=
+          static_cast<size_t>(max_connections_)) {
+    return true;
+  }
+  return max_handshakes_ > 0 &&
+         handshake_count_ + accept_batch_.size() >=
+             static_cast<size_t>(max_handshakes_);
+}
+
+void NaiveProxy::MaybeResumeAccept() {
+  if (!accept_paused_ || AtConnectionLimit())
+    return;
+  accept_paused_ = false;
+  // Not from the call stack of a connection.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveProxy::DoAcceptLoop,
+                                weak_ptr_factory_.GetWeakPtr()));
 }
 
-void NaiveProxy::HandleAcceptResult(int result) {
+#if BUILDFLAG(IS_LINUX)
+void NaiveProxy::AdoptSocket(base::ScopedFD socket,
+                             const IPEndPoint& peer_address) {
+  // The forwarder cannot leave it in a backlog, so it is closed.
+  if (AtConnectionLimit()) {
+    ++reject_count_;
+    return;
+  }
+  auto tcp_socket = std::make_unique<TCPSocket>(
+      /*socket_performance_watcher=*/nullptr, net_log_.net_log(),
+      NetLogSource());
+  int result = tcp_socket->AdoptConnectedSocket(socket.release(),
+                                                peer_address);
   if (result != OK) {
-    LOG(ERROR) << "Accept error: " << ErrorToShortString(result);
+    LOG(ERROR) << "Failed to adopt socket: " << ErrorToShortString(result);
     return;
   }
-  DoConnect();
+  DoConnect(
+      std::make_unique<TCPClientSocket>(std::move(tcp_socket), peer_address));
+}
+
+std::optional<NaiveDetachedRelay> NaiveProxy::DetachBusiestRelay(
+    base::TimeDelta min_age) {
+  if (protocol_ != ClientProtocol::kSocks5 &&
+      protocol_ != ClientProtocol::kHttp) {
+    return std::nullopt;
+  }
+  NaiveConnection* busiest = nullptr;
+  double busiest_rate = 0;
+  connections_.ForEach([&](NaiveConnection& connection) {
+    base::TimeDelta age = connection.age();
+    if (age < min_age || !connection.CanDetachRelay())
+      return;
+    double rate = (connection.bytes_relayed(kClient) +
+                   connection.bytes_relayed(kServer)) /
+                  age.InSecondsF();
+    if (rate > busiest_rate) {
+      busiest = &connection;
+      busiest_rate = rate;
+    }
+  });
+  if (!busiest)
+    return std::nullopt;
+  std::optional<NaiveDetachedRelay> relay = busiest->DetachRelay();
+  if (!relay)
+    return std::nullopt;
+  unsigned int connection_id = busiest->id();
+  LOG(INFO) << "Connection " << connection_id << " to "
+            << busiest->origin().ToString() << " moves to another thread at "
+            << static_cast<int64_t>(busiest_rate) << " bytes/s";
+  // Not in a callback of the connection, which is disconnected already.
+  RemoveConnection(connection_id);
+  return relay;
 }
 
-void NaiveProxy::DoConnect() {
+void NaiveProxy::AdoptRelay(NaiveDetachedRelay relay) {
+  std::unique_ptr<StreamSocket> sockets[kNumDirections];
+  for (Direction side : {kClient, kServer}) {
+    auto tcp_socket = std::make_unique<TCPSocket>(
+        /*socket_performance_watcher=*/nullptr, net_log_.net_log(),
+        NetLogSource());
+    int result = tcp_socket->AdoptConnectedSocket(
+        relay.fds[side].release(), relay.peer_addresses[side]);
+    if (result != OK) {
+      LOG(ERROR) << "Failed to adopt socket: " << ErrorToShortString(result);
+      return;
+    }
+    sockets[side] = std::make_unique<TCPClientSocket>(
+        std::move(tcp_socket), relay.peer_addresses[side]);
+  }
+  unsigned int connection_id = connections_.Allocate();
+  if (connection_id == ConnectionTable::kInvalidHandle) {
+    LOG(ERROR) << "Too many connections";
+    ++reject_count_;
+    return;
+  }
+
+  int tunnel_session_id = PickTunnelSession();
+  ++tunnel_sessions_->connection_counts[tunnel_session_id];
+  tunnel_sessions_->idle_since = base::TimeTicks();
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  auto connection_ptr = std::make_unique<NaiveConnection>(
+      connection_id, ClientProtocol::kEmbedded,
+      std::make_unique<PaddingDetectorDelegate>(
+          proxy_delegate, direct_proxy_info_.proxy_chain(),
+          ClientProtocol::kEmbedded),
+      direct_proxy_info_, relay_config_, resolver_, session_,
+      tunnel_sessions_->keys[tunnel_session_id], net_log_,
+      std::move(sockets[kClient]), traffic_annotation_);
+  auto* connection = connection_ptr.get();
+  connection->set_padding_stats(&padding_stats_);
+  connection->AttachRelay(std::move(sockets[kServer]), std::move(relay));
+  connections_.Assign(connection_id, std::move(connection_ptr));
+  LOG(INFO) << "Connection " << connection_id << " to "
+            << connection->origin().ToString() << " adopted";
+  ScheduleTimeoutCheck(connection);
+  DoRun(connection);
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveProxy::AdoptTunFlow(std::unique_ptr<NaiveTunTcpSocket> socket,
+                              const HostPortPair& origin) {
+  // The client has been answered already, so it is reset rather than left
+  // to time out.
+  if (!accepting_ || AtConnectionLimit()) {
+    ++reject_count_;
+    socket->set_reset_on_disconnect();
+    return;
+  }
+  ++accept_count_;
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  const ProxyInfo& proxy_info = PickUpstream();
+  auto padding_detector_delegate = std::make_unique<PaddingDetectorDelegate>(
+      proxy_delegate, proxy_info.proxy_chain(), ClientProtocol::kTun);
+  StartConnection(ClientProtocol::kTun, std::move(padding_detector_delegate),
+                  proxy_info, std::move(socket), origin);
+}
+#endif
+
+#if BUILDFLAG(IS_POSIX)
+void NaiveProxy::AdoptEmbedded(base::ScopedFD socket,
+                               const HostPortPair& origin) {
+  // The host is not kept waiting in a backlog either, so it is closed.
+  if (!accepting_ || AtConnectionLimit()) {
+    ++reject_count_;
+    return;
+  }
+  // Unix domain sockets, such as one end of a socketpair() standing in for
+  // a stream of the host, have no peer address.
+  IPEndPoint peer_address;
+  SockaddrStorage peer_storage;
+  if (getpeername(socket.get(), peer_storage.addr, &peer_storage.addr_len) ==
+      0) {
+    peer_address.FromSockAddr(peer_storage.addr, peer_storage.addr_len);
+  }
+  auto tcp_socket = std::make_unique<TCPSocket>(
+      /*socket_performance_watcher=*/nullptr, net_log_.net_log(),
+      NetLogSource());
+  int result = tcp_socket->AdoptConnectedSocket(socket.release(),
+                                                peer_address);
+  if (result != OK) {
+    LOG(ERROR) << "Failed to adopt socket: " << ErrorToShortString(result);
+    return;
+  }
+  ++accept_count_;
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  const ProxyInfo& proxy_info = PickUpstream();
+  auto padding_detector_delegate = std::make_unique<PaddingDetectorDelegate>(
+      proxy_delegate, proxy_info.proxy_chain(), ClientProtocol::kEmbedded);
+  StartConnection(
+      ClientProtocol::kEmbedded, std::move(padding_detector_delegate),
+      proxy_info,
+      std::make_unique<TCPClientSocket>(std::move(tcp_socket), peer_address),
+      origin);
+}
+#endif
+
+void NaiveProxy::DoConnect(std::unique_ptr<StreamSocket> accepted_socket) {
+  ++accept_count_;
+  NaiveLagMonitor* lag_monitor = NaiveLagMonitor::GetForCurrentThread();
+  if (lag_monitor->ShouldRejectHandshakes()) {
+    // Closed at once, so the client tries again elsewhere or later instead
+    // of waiting for a handshake the thread has no time for.
+    ++reject_count_;
+    lag_monitor->AddReject();
+    return;
+  }
+  if (protocol_ == ClientProtocol::kHttps) {
+    DoHttpsHandshake(std::move(accepted_socket));
+    return;
+  }
+  DoConnectTunnel(std::move(accepted_socket));
+}
+
+void NaiveProxy::DoConnectTunnel(std::unique_ptr<StreamSocket> client_socket) {
+  ConnectTunnel(std::move(client_socket), relay_config_.proxy_protocol,
+                std::nullopt);
+}
+
+void NaiveProxy::ConnectTunnel(
+    std::unique_ptr<StreamSocket> client_socket,
+    bool proxy_protocol,
+    const std::optional<IPEndPoint>& proxied_source) {
+  // Tunnels of an https:// session do not pass the accept loop's limits.
+  if (protocol_ == ClientProtocol::kHttps && max_connections_ > 0 &&
+      connections_.size() >= static_cast<size_t>(max_connections_)) {
+    ++reject_count_;
+    return;
+  }
   std::unique_ptr<StreamSocket> socket;
   auto* proxy_delegate =
       static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
   DCHECK(proxy_delegate);
-  DCHECK(!proxy_info_.is_empty());
-  const ProxyChain& proxy_server = proxy_info_.proxy_chain();
+  const ProxyInfo& proxy_info = PickUpstream();
+  const ProxyChain& proxy_server = proxy_info.proxy_chain();
   auto padding_detector_delegate = std::make_unique<PaddingDetectorDelegate>(
       proxy_delegate, proxy_server, protocol_);
 
   if (protocol_ == ClientProtocol::kSocks5) {
-    socket = std::make_unique<Socks5ServerSocket>(std::move(accepted_socket_),
-                                                  listen_user_, listen_pass_,
-                                                  traffic_annotation_);
-  } else if (protocol_ == ClientProtocol::kHttp) {
-    socket = std::make_unique<HttpProxyServerSocket>(
-        std::move(accepted_socket_), padding_detector_delegate.get(),
+    // UDP associations are relayed with CONNECT-UDP, which needs a QUIC
+    // proxy.
+    bool udp_associate_enabled =
+        proxy_server.is_single_proxy() && proxy_server.First().is_quic();
+    auto socks_socket = std::make_unique<Socks5ServerSocket>(
+        std::move(client_socket), listen_user_, listen_pass_,
+        user_table_.get(), udp_associate_enabled, traffic_annotation_);
+    socks_socket->set_proxy_protocol(proxy_protocol);
+    socket = std::move(socks_socket);
+  } else if (protocol_ == ClientProtocol::kHttp ||
+             (protocol_ == ClientProtocol::kHttps &&
+              client_socket->GetNegotiatedProtocol() != kProtoHTTP2)) {
+    auto http_socket = std::make_unique<HttpProxyServerSocket>(
+        std::move(client_socket), padding_detector_delegate.get(),
         traffic_annotation_, supported_padding_types_);
+    http_socket->set_proxy_protocol(proxy_protocol);
+    http_socket->set_proxied_source(proxied_source);
+    socket = std::move(http_socket);
+  } else if (protocol_ == ClientProtocol::kHttps) {
+    // Padding was negotiated with the CONNECT request of the stream.
+    const auto* stream =
+        static_cast<NaiveHttp2ServerStream*>(client_socket.get());
+    if (bond_joiner_ && stream->request_endpoint().host() == kBondHost) {
+      bond_joiner_->AddMember(std::move(client_socket), stream->padding_type());
+      return;
+    }
+    padding_detector_delegate->SetClientPaddingType(stream->padding_type());
+    socket = std::move(client_socket);
+#if BUILDFLAG(IS_LINUX)
+  } else if (protocol_ == ClientProtocol::kQuic) {
+    // Likewise with the CONNECT request of the QUIC stream.
+    const auto* stream =
+        static_cast<NaiveQuicServerStream*>(client_socket.get());
+    if (bond_joiner_ && stream->request_endpoint().host() == kBondHost) {
+      bond_joiner_->AddMember(std::move(client_socket), stream->padding_type());
+      return;
+    }
+    padding_detector_delegate->SetClientPaddingType(stream->padding_type());
+    socket = std::move(client_socket);
+#endif
   } else if (protocol_ == ClientProtocol::kRedir) {
-    socket = std::move(accepted_socket_);
+    socket = std::move(client_socket);
   } else {
     return;
   }
 
+  StartConnection(protocol_, std::move(padding_detector_delegate), proxy_info,
+                  std::move(socket), HostPortPair());
+}
+
+void NaiveProxy::StartConnection(
+    ClientProtocol protocol,
+    std::unique_ptr<PaddingDetectorDelegate> padding_detector_delegate,
+    const ProxyInfo& proxy_info,
+    std::unique_ptr<StreamSocket> socket,
+    const HostPortPair& origin) {
+  unsigned int connection_id = connections_.Allocate();
+  if (connection_id == ConnectionTable::kInvalidHandle) {
+    LOG(ERROR) << "Too many connections";
+    ++reject_count_;
+    return;
+  }
+
+  tunnel_sessions_->idle_since = base::TimeTicks();
+  int tunnel_session_id = PickTunnelSession();
+  if (tunnel_sessions_->closed) {
+    // The first session is the one left open.
+    tunnel_session_id = 0;
+    tunnel_sessions_->closed = false;
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&NaiveProxy::WarmTunnelSessions,
+                                  weak_ptr_factory_.GetWeakPtr(), size_t{1},
+                                  tunnel_sessions_->keys.size()));
+  } else if (tunnel_sessions_->connection_counts[tunnel_session_id] >=
+                 SessionConnectionsHigh() &&
+             tunnel_sessions_->keys.size() - tunnel_sessions_->bulk_sessions <
+                 static_cast<size_t>(relay_config_.max_concurrency)) {
+    tunnel_session_id = AddTunnelSession();
+  }
   last_id_++;
-  int tunnel_session_id = last_id_ % concurrency_;
-  const auto& nak = network_anonymization_keys_[tunnel_session_id];
+  ++tunnel_sessions_->connection_counts[tunnel_session_id];
+  const auto& nak = tunnel_sessions_->keys[tunnel_session_id];
   auto connection_ptr = std::make_unique<NaiveConnection>(
-      last_id_, protocol_, std::move(padding_detector_delegate), proxy_info_,
-      resolver_, session_, nak, net_log_, std::move(socket),
-      traffic_annotation_);
+      connection_id, protocol, std::move(padding_detector_delegate),
+      proxy_info, relay_config_, resolver_, session_, nak, net_log_,
+      std::move(socket), traffic_annotation_);
   auto* connection = connection_ptr.get();
-  connection_by_id_[connection->id()] = std::move(connection_ptr);
+  connection->set_rate_limits(rate_limits_);
+  connection->set_padding_stats(&padding_stats_);
+  if (protocol == ClientProtocol::kEmbedded ||
+      protocol == ClientProtocol::kTun) {
+    connection->set_origin(origin);
+  }
+  if (route_callback_) {
+    connection->set_route_callback(route_callback_);
+  }
+  if (admit_callback_) {
+    connection->set_admit_callback(admit_callback_);
+  }
+  if (session_callback_) {
+    connection->set_session_callback(session_callback_);
+  }
+  if (!bond_network_anonymization_keys_.empty()) {
+    connection->set_bond_network_anonymization_keys(
+        &bond_network_anonymization_keys_);
+  }
+  connections_.Assign(connection_id, std::move(connection_ptr));
+  ++handshake_count_;
   int result = connection->Connect(
       base::BindRepeating(&NaiveProxy::OnConnectComplete,
                           weak_ptr_factory_.GetWeakPtr(), connection->id()));
+  ScheduleTimeoutCheck(connection);
   if (result == ERR_IO_PENDING)
     return;
   HandleConnectResult(connection, result);
 }
 
+void NaiveProxy::OnBondJoined(std::unique_ptr<NaiveBondSocket> socket,
+                              PaddingType padding_type) {
+  // Like the tunnels it was joined from.
+  if (max_connections_ > 0 &&
+      connections_.size() >= static_cast<size_t>(max_connections_)) {
+    ++reject_count_;
+    return;
+  }
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  const ProxyInfo& proxy_info = PickUpstream();
+  auto padding_detector_delegate = std::make_unique<PaddingDetectorDelegate>(
+      proxy_delegate, proxy_info.proxy_chain(), ClientProtocol::kBond);
+  padding_detector_delegate->SetClientPaddingType(padding_type);
+  StartConnection(ClientProtocol::kBond, std::move(padding_detector_delegate),
+                  proxy_info, std::move(socket), HostPortPair());
+}
+
+void NaiveProxy::PreconnectName(const std::string& name) {
+  constexpr uint16_t kPreconnectPort = 443;
+  url::CanonHostInfo host_info;
+  url::SchemeHostPort endpoint("http", CanonicalizeHost(name, &host_info),
+                               kPreconnectPort,
+                               url::SchemeHostPort::ALREADY_CANONICALIZED);
+  if (!endpoint.IsValid())
+    return;
+
+  // Goes into the socket group of the next connection.
+  int tunnel_session_id = PickTunnelSession();
+  const auto& nak = tunnel_sessions_->keys[tunnel_session_id];
+  LOG(INFO) << "Preconnect to " << name << ":" << kPreconnectPort;
+  PreconnectSocketsForHttpRequest(
+      std::move(endpoint), LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_,
+      PickUpstream(), {}, PRIVACY_MODE_DISABLED, nak, SecureDnsPolicy::kDisable,
+      net_log_, /*num_preconnect_streams=*/1, base::DoNothing());
+}
+
+void NaiveProxy::OnNetworkChanged(NetworkChangeNotifier::ConnectionType type) {
+  // Sessions on the old network are gone.
+  if (type == NetworkChangeNotifier::CONNECTION_NONE)
+    return;
+  if (relay_config_.keep_warm_interval.is_positive()) {
+    KeepWarm();
+  }
+  if (proxy_infos_.size() > 1) {
+    // The ranking came from the old network.
+    auto* proxy_delegate =
+        static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+    proxy_delegate->ResetUpstreamStats();
+    race_timer_.Reset();
+    RaceUpstreams();
+  }
+}
+
+void NaiveProxy::KeepWarm() {
+  WarmTunnelSessions(
+      0, tunnel_sessions_->closed ? 1 : tunnel_sessions_->keys.size());
+}
+
+void NaiveProxy::WarmTunnelSessions(size_t begin, size_t end) {
+  // Sessions may have been removed since this was posted.
+  end = std::min(end, tunnel_sessions_->keys.size());
+  for (const ProxyInfo& proxy_info : proxy_infos_) {
+    const ProxyChain& proxy_chain = proxy_info.proxy_chain();
+    if (proxy_chain.is_direct())
+      continue;
+    // A session to the proxy only comes with a tunnel. The tunnel to the
+    // proxy's own origin is left idle in the socket pool, so a new one is
+    // opened once it times out, and the traffic keeps the session from
+    // reaching the proxy's idle timeout.
+    const HostPortPair& proxy = proxy_chain.First().host_port_pair();
+    url::SchemeHostPort endpoint("http", proxy.host(), proxy.port());
+    if (!endpoint.IsValid())
+      continue;
+    for (size_t i = begin; i < end; ++i) {
+      PreconnectSocketsForHttpRequest(
+          endpoint, LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_, proxy_info,
+          {}, PRIVACY_MODE_DISABLED, tunnel_sessions_->keys[i],
+          SecureDnsPolicy::kDisable, net_log_,
+          /*num_preconnect_streams=*/1, base::DoNothing());
+    }
+  }
+}
+
+void NaiveProxy::CloseIdleTunnelSessions() {
+  // The listeners sharing the sessions each run this, the first one past
+  // the period closes them.
+  if (tunnel_sessions_->closed || tunnel_sessions_->idle_since.is_null() ||
+      base::TimeTicks::Now() - tunnel_sessions_->idle_since <
+          GetWakeupPeriod()) {
+    return;
+  }
+  // Their PINGs and keepalives would wake the radio for nothing. Idle
+  // tunnels left in the socket pools go down with them.
+  for (size_t i = 1; i < tunnel_sessions_->keys.size(); ++i) {
+    const auto& nak = tunnel_sessions_->keys[i];
+    session_->spdy_session_pool()->CloseSessionsForNetworkAnonymizationKey(
+        nak, "Idle in mobile mode.");
+    session_->quic_session_pool()->CloseSessionsForNetworkAnonymizationKey(
+        nak, ERR_ABORTED, quic::QUIC_NETWORK_IDLE_TIMEOUT);
+  }
+  tunnel_sessions_->closed = true;
+  LOG(INFO) << "Closed idle tunnel sessions past the first";
+}
+
+void NaiveProxy::OnTunnelSessionGoAway(const NetworkAnonymizationKey& key) {
+  auto it = base::ranges::find(tunnel_sessions_->keys, key);
+  if (it == tunnel_sessions_->keys.end())
+    return;
+  size_t index = it - tunnel_sessions_->keys.begin();
+  // Those closed in mobile mode stay closed.
+  if (tunnel_sessions_->closed && index > 0)
+    return;
+  LOG(INFO) << "Tunnel session " << index
+            << " received GOAWAY, opening its replacement";
+  // Not within the session handling the GOAWAY.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&NaiveProxy::WarmTunnelSessions,
+                     weak_ptr_factory_.GetWeakPtr(), index, index + 1));
+}
+
+void NaiveProxy::RefillEgressPools() {
+  for (const HostPortPair& destination : hot_destinations_->GetHot()) {
+    PreconnectEgress(destination);
+  }
+  hot_destinations_->Decay();
+}
+
+void NaiveProxy::PreconnectEgress(const HostPortPair& destination) {
+  url::CanonHostInfo host_info;
+  url::SchemeHostPort endpoint(
+      "http", CanonicalizeHost(destination.HostForURL(), &host_info),
+      destination.port(), url::SchemeHostPort::ALREADY_CANONICALIZED);
+  if (!endpoint.IsValid())
+    return;
+
+  // The socket pool counts the sockets of the open connections against the
+  // target, which is topped up with idle ones past them. A connection
+  // connecting next takes an idle one instead of resolving and connecting.
+  int open = 0;
+  auto it = destination_connections_.find(destination);
+  if (it != destination_connections_.end()) {
+    open = it->second;
+  }
+  const auto& nak = tunnel_sessions_->keys[PickTunnelSession()];
+  VLOG(1) << "Egress preconnect to " << destination.ToString() << ", "
+          << open << " open";
+  PreconnectSocketsForHttpRequest(
+      std::move(endpoint), LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_,
+      direct_proxy_info_, {}, PRIVACY_MODE_DISABLED, nak,
+      SecureDnsPolicy::kDisable, net_log_,
+      open + relay_config_.egress_preconnect, base::DoNothing());
+}
+
+void NaiveProxy::RaceUpstreams() {
+  // In the session the next connections use, so the loser stays there as a
+  // warm fallback. Upstreams with an idle tunnel already complete
+  // synchronously and are not measured again.
+  const auto& nak = tunnel_sessions_->keys[PickTunnelSession()];
+  for (size_t i = 0; i < proxy_infos_.size(); ++i) {
+    const ProxyChain& proxy_chain = proxy_infos_[i].proxy_chain();
+    if (proxy_chain.is_direct())
+      continue;
+    const HostPortPair& proxy = proxy_chain.First().host_port_pair();
+    url::SchemeHostPort endpoint("http", proxy.host(), proxy.port());
+    if (!endpoint.IsValid())
+      continue;
+    PreconnectSocketsForHttpRequest(
+        std::move(endpoint), LOAD_IGNORE_LIMITS, MAXIMUM_PRIORITY, session_,
+        proxy_infos_[i], {}, PRIVACY_MODE_DISABLED, nak,
+        SecureDnsPolicy::kDisable, net_log_, /*num_preconnect_streams=*/1,
+        base::BindOnce(&NaiveProxy::OnRaceComplete,
+                       weak_ptr_factory_.GetWeakPtr(), i,
+                       base::TimeTicks::Now()));
+  }
+}
+
+void NaiveProxy::OnRaceComplete(size_t upstream,
+                                base::TimeTicks start_time,
+                                int result) {
+  const ProxyChain& proxy_chain = proxy_infos_[upstream].proxy_chain();
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  base::TimeDelta connect_time = base::TimeTicks::Now() - start_time;
+  if (result == OK) {
+    LOG(INFO) << "Upstream " << proxy_chain.ToDebugString()
+              << " connected in " << connect_time.InMilliseconds() << " ms";
+    proxy_delegate->OnUpstreamConnected(proxy_chain, connect_time);
+    return;
+  }
+  int final_error;
+  if (CanFalloverToNextProxy(proxy_chain, result, &final_error,
+                             /*is_for_ip_protection=*/false)) {
+    proxy_delegate->OnFallback(proxy_chain, result);
+  }
+}
+
 void NaiveProxy::OnConnectComplete(unsigned int connection_id, int result) {
   auto* connection = FindConnection(connection_id);
   if (!connection)
@@ -149,10 +916,20 @@ void NaiveProxy::OnConnectComplete(unsigned int connection_id, int result) {
 }
 
 void NaiveProxy::HandleConnectResult(NaiveConnection* connection, int result) {
+  --handshake_count_;
+  MaybeResumeAccept();
+  ReportUpstreamResult(connection, result);
   if (result != OK) {
     Close(connection->id(), result);
     return;
   }
+  if (hot_destinations_ && connection->proxy_chain().is_direct()) {
+    hot_destinations_->Add(connection->origin());
+    // Replaces the pooled connection this one may have taken.
+    if (hot_destinations_->IsHot(connection->origin())) {
+      PreconnectEgress(connection->origin());
+    }
+  }
   DoRun(connection);
 }
 
@@ -173,31 +950,451 @@ void NaiveProxy::OnRunComplete(unsigned int connection_id, int result) {
 }
 
 void NaiveProxy::HandleRunResult(NaiveConnection* connection, int result) {
+  // The next request on a client connection kept alive is a new connection
+  // with a tunnel of its own, in the same session upstream.
+  std::unique_ptr<StreamSocket> client_socket;
+  std::optional<IPEndPoint> proxied_source;
+  if (result == OK)
+    client_socket = connection->ReleaseKeptAliveClient(&proxied_source);
   Close(connection->id(), result);
+  // Its PROXY protocol header came before the first request.
+  if (client_socket)
+    ConnectTunnel(std::move(client_socket), false, proxied_source);
+}
+
+std::unique_ptr<NaiveConnection> NaiveProxy::RemoveConnection(
+    unsigned int connection_id) {
+  std::unique_ptr<NaiveConnection> connection =
+      connections_.Remove(connection_id);
+  if (!connection)
+    return nullptr;
+  --tunnel_sessions_->connection_counts[FindTunnelSession(
+      connection->network_anonymization_key())];
+  if (tunnel_sessions_->bulk_sessions > 0 && relay_config_.bulk_bytes > 0 &&
+      connection->bytes_relayed(kServer) >= relay_config_.bulk_bytes) {
+    tunnel_sessions_->bulk_destinations.Put(connection->origin().host(),
+                                            base::TimeTicks::Now());
+  }
+  if (connection->admitted()) {
+    ReleaseDestination(connection->origin());
+  }
+  RemoveIdleTunnelSessions();
+  MaybeResumeAccept();
+  if (tunnel_sessions_->IsIdle()) {
+    tunnel_sessions_->idle_since = base::TimeTicks::Now();
+  }
+  return connection;
 }
 
 void NaiveProxy::Close(unsigned int connection_id, int reason) {
-  auto it = connection_by_id_.find(connection_id);
-  if (it == connection_by_id_.end())
+  std::unique_ptr<NaiveConnection> connection =
+      RemoveConnection(connection_id);
+  if (!connection)
     return;
 
+  // Attributes latency to the client handshake, the tunnel, or the
+  // destination by its first download byte. The upstream connect time is the
+  // latency the optimistic client reply took off the client's handshake.
   LOG(INFO) << "Connection " << connection_id
-            << " closed: " << ErrorToShortString(reason);
+            << " closed: " << ErrorToShortString(reason) << " (client "
+            << connection->connect_client_duration().InMilliseconds()
+            << " ms, upstream connect "
+            << connection->connect_server_duration().InMilliseconds()
+            << " ms, first upload "
+            << FormatDelay(connection->first_byte_delay(kClient))
+            << ", first download "
+            << FormatDelay(connection->first_byte_delay(kServer))
+            << ", duration " << connection->age().InMilliseconds()
+            << " ms, early data " << connection->early_data_size()
+            << " bytes, upload " << connection->bytes_relayed(kClient)
+            << " bytes, download " << connection->bytes_relayed(kServer)
+            << " bytes, " << connection->yield_count() << " yields)";
+  if (access_log_) {
+    access_log_->Append(MakeAccessLogEntry(*connection, reason));
+  }
+  if (!connection->origin().IsEmpty()) {
+    NaiveHeavyHitters::GetForCurrentThread()->AddBytes(
+        connection->origin(),
+        connection->bytes_relayed(kClient) + connection->bytes_relayed(kServer),
+        base::TimeTicks::Now());
+  }
 
   // The call stack might have callbacks which still have the pointer of
   // connection. Instead of referencing connection with ID all the time,
   // destroys the connection in next run loop to make sure any pending
   // callbacks in the call stack return.
   base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
-      FROM_HERE, std::move(it->second));
-  connection_by_id_.erase(it);
+      FROM_HERE, std::move(connection));
+}
+
+void NaiveProxy::DoHttpsHandshake(
+    std::unique_ptr<StreamSocket> accepted_socket) {
+  unsigned int session_id = https_sessions_.Allocate();
+  if (session_id == HttpsSessionTable::kInvalidHandle) {
+    LOG(ERROR) << "Too many connections";
+    ++reject_count_;
+    return;
+  }
+  std::unique_ptr<StreamSocket> socket = std::move(accepted_socket);
+  if (ssl_server_context_) {
+    socket = ssl_server_context_->CreateSSLServerSocket(std::move(socket));
+  }
+  // Unretained is safe because the sessions are owned by this.
+  auto https_session_ptr = std::make_unique<NaiveHttpsServerSession>(
+      std::move(socket), /*cleartext=*/!ssl_server_context_,
+      relay_config_.handshake_timeout, supported_padding_types_,
+      relay_config_.accept_bonds, traffic_annotation_,
+      base::BindRepeating(&NaiveProxy::DoConnectTunnel,
+                          base::Unretained(this)));
+  auto* https_session = https_session_ptr.get();
+  https_sessions_.Assign(session_id, std::move(https_session_ptr));
+  // Counts against max-handshakes like the handshakes of connections.
+  ++handshake_count_;
+  int result = https_session->Handshake(
+      base::BindOnce(&NaiveProxy::OnHttpsHandshakeComplete,
+                     weak_ptr_factory_.GetWeakPtr(), session_id));
+  if (result == ERR_IO_PENDING)
+    return;
+  OnHttpsHandshakeComplete(session_id, result);
+}
+
+void NaiveProxy::OnHttpsHandshakeComplete(unsigned int session_id,
+                                          int result) {
+  --handshake_count_;
+  MaybeResumeAccept();
+  NaiveHttpsServerSession* https_session = https_sessions_.Find(session_id);
+  DCHECK(https_session);
+  if (result == OK) {
+    result = https_session->Run(
+        base::BindOnce(&NaiveProxy::CloseHttpsSession,
+                       weak_ptr_factory_.GetWeakPtr(), session_id));
+  }
+  if (result == ERR_IO_PENDING)
+    return;
+  CloseHttpsSession(session_id, result);
+}
+
+void NaiveProxy::CloseHttpsSession(unsigned int session_id, int reason) {
+  std::unique_ptr<NaiveHttpsServerSession> https_session =
+      https_sessions_.Remove(session_id);
+  if (!https_session)
+    return;
+  LOG_IF(INFO, reason != OK) << "HTTPS session " << session_id
+                             << " closed: " << ErrorToShortString(reason);
+  // Like connections, destroyed once the call stack returns.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(https_session));
+}
+
+void NaiveProxy::CheckTimeout(unsigned int connection_id) {
+  auto* connection = FindConnection(connection_id);
+  if (!connection)
+    return;
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeTicks deadline = connection->GetTimeoutDeadline(now);
+  if (deadline > now) {
+    if (!deadline.is_max())
+      timeout_wheel_.Schedule(connection_id, deadline - now);
+    return;
+  }
+  // HandleConnectResult() is not reached for a connection closed in its
+  // connect.
+  if (!connection->is_running()) {
+    --handshake_count_;
+  }
+  Close(connection_id, ERR_TIMED_OUT);
+}
+
+void NaiveProxy::ScheduleTimeoutCheck(NaiveConnection* connection) {
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeTicks deadline = connection->GetTimeoutDeadline(now);
+  if (deadline.is_max())
+    return;
+  timeout_wheel_.Schedule(connection->id(), deadline - now);
+}
+
+std::vector<std::pair<unsigned int, NaiveMemoryUsage>>
+NaiveProxy::GetConnectionMemoryUsage() {
+  std::vector<std::pair<unsigned int, NaiveMemoryUsage>> usages;
+  usages.reserve(connections_.size());
+  connections_.ForEach([&usages](NaiveConnection& connection) {
+    usages.emplace_back(connection.id(), connection.GetMemoryUsage());
+  });
+  return usages;
+}
+
+#if BUILDFLAG(IS_LINUX)
+void NaiveProxy::SampleTcpInfo(size_t max_connections) {
+  // Every `stride`th connection, starting further on with each call.
+  size_t stride = std::max<size_t>(
+      (connections_.size() + max_connections - 1) / max_connections, 1);
+  size_t i = tcp_info_sample_phase_++;
+  connections_.ForEach([&](NaiveConnection& connection) {
+    if (i++ % stride == 0 && connection.is_running()) {
+      connection.SampleTcpInfo();
+    }
+  });
+}
+#endif
+
+void NaiveProxy::AppendConnectionListing(std::string_view fields,
+                                         std::string* out) {
+  // Formatted directly, as a JSON value per connection would allocate a
+  // dozen times each.
+  connections_.ForEach([&](NaiveConnection& connection) {
+    base::StringAppendF(
+        out, "{%.*s\"id\":%u,\"phase\":\"%s\",\"age_ms\":%" PRId64
+             ",\"session\":%d,\"upstream\":",
+        static_cast<int>(fields.size()), fields.data(), connection.id(),
+        connection.GetPhaseName(), connection.age().InMilliseconds(),
+        FindTunnelSession(connection.network_anonymization_key()));
+    base::EscapeJSONString(connection.proxy_chain().ToDebugString(),
+                           /*put_in_quotes=*/true, out);
+    out->append(",\"origin\":");
+    base::EscapeJSONString(connection.origin().ToString(),
+                           /*put_in_quotes=*/true, out);
+    base::StringAppendF(out, ",\"upload\":%" PRId64 ",\"download\":%" PRId64,
+                        connection.bytes_relayed(kClient),
+                        connection.bytes_relayed(kServer));
+    // Whether reads of a side still remove padding frames.
+    for (Direction side : {kClient, kServer}) {
+      const char* name = side == kClient ? "client" : "server";
+      if (const NaivePaddingSocket* socket = connection.padding_socket(side)) {
+        base::StringAppendF(out, ",\"%s_padding\":\"%s\",\"%s_padded\":%s",
+                            name, ToReadableString(socket->padding_type()),
+                            name,
+                            socket->IsReadPassthrough() ? "false" : "true");
+      }
+    }
+    out->append("}\n");
+  });
+}
+
+void NaiveProxy::AppendTunnelSessionListing(std::string_view fields,
+                                            std::string* out) const {
+  for (size_t i = 0; i < tunnel_sessions_->keys.size(); ++i) {
+    base::StringAppendF(out, "{%.*s\"session\":%zu,\"connections\":%d,\"key\":",
+                        static_cast<int>(fields.size()), fields.data(), i,
+                        tunnel_sessions_->connection_counts[i]);
+    base::EscapeJSONString(tunnel_sessions_->keys[i].ToDebugString(),
+                           /*put_in_quotes=*/true, out);
+    out->append("}\n");
+  }
+}
+
+bool NaiveProxy::CloseConnection(unsigned int connection_id) {
+  NaiveConnection* connection = FindConnection(connection_id);
+  if (!connection)
+    return false;
+  LOG(INFO) << "Connection " << connection_id << " closed by the admin";
+  // Like CheckTimeout().
+  if (!connection->is_running()) {
+    --handshake_count_;
+  }
+  Close(connection_id, ERR_ABORTED);
+  return true;
 }
 
 NaiveConnection* NaiveProxy::FindConnection(unsigned int connection_id) {
-  auto it = connection_by_id_.find(connection_id);
-  if (it == connection_by_id_.end())
+  return connections_.Find(connection_id);
+}
+
+const ProxyInfo& NaiveProxy::PickUpstream() {
+  if (proxy_infos_.size() == 1)
+    return proxy_infos_[0];
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  ProxyInfo ranked;
+  ranked.UseProxyList(proxy_list_);
+  proxy_delegate->OnResolveProxy(GURL(), NetworkAnonymizationKey(), "CONNECT",
+                                 ProxyRetryInfoMap(), &ranked);
+  for (const ProxyInfo& proxy_info : proxy_infos_) {
+    if (proxy_info.proxy_chain() == ranked.proxy_chain())
+      return proxy_info;
+  }
+  NOTREACHED();
+}
+
+const ProxyInfo* NaiveProxy::Route(const HostPortPair& origin) const {
+  int target = router_->Route(origin.host());
+  if (target == NaiveRouter::kDefaultTarget)
     return nullptr;
-  return it->second.get();
+  return &route_infos_[target];
+}
+
+bool NaiveProxy::AdmitDestination(const HostPortPair& origin) {
+  auto it = destination_connections_.try_emplace(origin, 0).first;
+  if (relay_config_.max_destination_connections > 0 &&
+      it->second >= relay_config_.max_destination_connections) {
+    ++reject_count_;
+    return false;
+  }
+  ++it->second;
+  return true;
+}
+
+void NaiveProxy::ReleaseDestination(const HostPortPair& origin) {
+  auto it = destination_connections_.find(origin);
+  CHECK(it != destination_connections_.end());
+  if (--it->second == 0) {
+    destination_connections_.erase(it);
+  }
+}
+
+void NaiveProxy::ReportUpstreamResult(NaiveConnection* connection,
+                                      int result) {
+  const ProxyChain& proxy_chain = connection->proxy_chain();
+  // Failures before the upstream connect are the client's, and direct
+  // failures are the target's.
+  if (proxy_infos_.size() == 1 || proxy_chain.is_direct() ||
+      connection->connect_server_duration().is_zero()) {
+    return;
+  }
+  auto* proxy_delegate =
+      static_cast<NaiveProxyDelegate*>(session_->context().proxy_delegate);
+  if (result == OK) {
+    proxy_delegate->OnUpstreamConnected(
+        proxy_chain, connection->connect_server_duration());
+    return;
+  }
+  // Tunnel failures are left out, the proxy reports those for the target.
+  int final_error;
+  if (CanFalloverToNextProxy(proxy_chain, result, &final_error,
+                             /*is_for_ip_protection=*/false)) {
+    proxy_delegate->OnFallback(proxy_chain, result);
+  }
+}
+
+int NaiveProxy::SessionConnectionsHigh() const {
+  if (!relay_config_.adapt_network)
+    return kSessionConnectionsHigh;
+  // The connections of a session share its receive window, which caps the
+  // session at a window a round trip.
+  int64_t bdp = NaiveNetworkQuality::GetForCurrentThread()
+                    ->bandwidth_delay_product();
+  int64_t window = session_->params().spdy_session_max_recv_window_size;
+  if (bdp <= window)
+    return kSessionConnectionsHigh;
+  return std::max<int64_t>(kSessionConnectionsHigh * window / bdp,
+                           kSessionConnectionsMin);
+}
+
+int NaiveProxy::PickTunnelSession() const {
+  const int concurrency = tunnel_sessions_->concurrency;
+  const std::vector<int>& counts = tunnel_sessions_->connection_counts;
+  // A session busy with a bulk transfer would block new interactive streams
+  // behind it in its TCP connection.
+  int best = (last_id_ + 1) % concurrency;
+  for (int i = 1; i < concurrency; ++i) {
+    int candidate = (last_id_ + 1 + i) % concurrency;
+    if (counts[candidate] < counts[best]) {
+      best = candidate;
+    }
+  }
+  if (counts[best] < SessionConnectionsHigh())
+    return best;
+
+  // Added sessions only take connections while the others are busy, so they
+  // drain once the load drops.
+  for (size_t i = tunnel_sessions_->fixed_sessions(); i < counts.size(); ++i) {
+    if (counts[i] < counts[best]) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+int NaiveProxy::AddTunnelSession() {
+  tunnel_sessions_->keys.push_back(NetworkAnonymizationKey::CreateTransient());
+  tunnel_sessions_->connection_counts.push_back(0);
+  LOG(INFO) << "Added tunnel session, now " << tunnel_sessions_->keys.size();
+  return tunnel_sessions_->keys.size() - 1;
+}
+
+void NaiveProxy::RemoveIdleTunnelSessions() {
+  const size_t concurrency = tunnel_sessions_->concurrency;
+  std::vector<int>& counts = tunnel_sessions_->connection_counts;
+  int base_min =
+      *std::min_element(counts.begin(), counts.begin() + concurrency);
+  // Waits until the load is well below the threshold, so sessions are not
+  // added and removed over and over around it.
+  if (base_min >= SessionConnectionsHigh() / 2)
+    return;
+  const size_t fixed_sessions = tunnel_sessions_->fixed_sessions();
+  while (counts.size() > fixed_sessions && counts.back() == 0) {
+    tunnel_sessions_->keys.pop_back();
+    counts.pop_back();
+    LOG(INFO) << "Removed tunnel session, now "
+              << tunnel_sessions_->keys.size();
+  }
+}
+
+int NaiveProxy::FindTunnelSession(const NetworkAnonymizationKey& key) const {
+  // Connections refer to the keys in NaiveTunnelSessions::keys.
+  for (size_t i = 0; i < tunnel_sessions_->keys.size(); ++i) {
+    if (&tunnel_sessions_->keys[i] == &key) {
+      return i;
+    }
+  }
+  NOTREACHED();
+}
+
+bool NaiveProxy::IsBulkDestination(const HostPortPair& origin,
+                                   RequestPriority priority) {
+  if (priority <= LOWEST)
+    return true;
+  auto& destinations = tunnel_sessions_->bulk_destinations;
+  auto it = destinations.Peek(origin.host());
+  if (it == destinations.end())
+    return false;
+  if (base::TimeTicks::Now() - it->second < kBulkDestinationTtl)
+    return true;
+  destinations.Erase(it);
+  return false;
+}
+
+const NetworkAnonymizationKey& NaiveProxy::PickDestinationSession(
+    const HostPortPair& origin,
+    RequestPriority priority,
+    const NetworkAnonymizationKey& current) {
+  int current_id = FindTunnelSession(current);
+  std::vector<int>& counts = tunnel_sessions_->connection_counts;
+  int preferred = current_id;
+  if (tunnel_sessions_->bulk_sessions > 0 &&
+      IsBulkDestination(origin, priority)) {
+    // The least loaded bulk session, however loaded, so a bulk transfer
+    // never shares a TCP connection, and its losses, with interactive
+    // ones.
+    preferred = tunnel_sessions_->concurrency;
+    for (int i = preferred + 1; i < tunnel_sessions_->fixed_sessions(); ++i) {
+      if (counts[i] < counts[preferred]) {
+        preferred = i;
+      }
+    }
+  } else if (relay_config_.session_affinity) {
+    // Subdomains of a site share its session, like the connections a
+    // browser coalesces. IP literals have no registrable domain and hash as
+    // is.
+    std::string domain =
+        registry_controlled_domains::GetDomainAndRegistry(
+            origin.host(),
+            registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+    if (domain.empty()) {
+      domain = origin.host();
+    }
+    // Only the fixed sessions, so a site keeps its session as added ones
+    // come and go.
+    preferred = base::FastHash(domain) % tunnel_sessions_->concurrency;
+    // Spills over to the least loaded session picked at the start.
+    if (counts[preferred] >= SessionConnectionsHigh()) {
+      preferred = current_id;
+    }
+  }
+  if (preferred == current_id)
+    return current;
+  --counts[current_id];
+  ++counts[preferred];
+  return tunnel_sessions_->keys[preferred];
 }
 
 }  // namespace net
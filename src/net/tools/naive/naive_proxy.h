@@ -5,51 +5,215 @@
 #ifndef NET_TOOLS_NAIVE_NAIVE_PROXY_H_
 #define NET_TOOLS_NAIVE_NAIVE_PROXY_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "base/callback_list.h"
+#include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
+#include "build/build_config.h"
 #include "net/base/completion_repeating_callback.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/network_change_notifier.h"
 #include "net/base/network_isolation_key.h"
+#include "net/base/request_priority.h"
 #include "net/log/net_log_with_source.h"
 #include "net/proxy_resolution/proxy_info.h"
+#include "net/proxy_resolution/proxy_list.h"
 #include "net/ssl/ssl_config.h"
+#include "net/tools/naive/naive_access_log.h"
+#include "net/tools/naive/naive_bond_joiner.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_metrics.h"
 #include "net/tools/naive/naive_connection.h"
 #include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_rate_limiter.h"
+#include "net/tools/naive/naive_router.h"
+#include "net/tools/naive/naive_slot_table.h"
+#include "net/tools/naive/naive_timer_wheel.h"
+#include "net/tools/naive/naive_tunnel_sessions.h"
+#include "net/tools/naive/naive_user_table.h"
+
+#if BUILDFLAG(IS_POSIX)
+#include "base/files/scoped_file.h"
+#endif
 
 namespace net {
 
 class ClientSocketHandle;
 class HttpNetworkSession;
+class IPEndPoint;
+class NaiveBondSocket;
 class NaiveConnection;
+class NaiveHotDestinations;
+class NaiveHttpsServerSession;
+class NaiveTunTcpSocket;
 class ServerSocket;
+class SSLServerContext;
 class StreamSocket;
 struct NetworkTrafficAnnotationTag;
 class RedirectResolver;
 
-class NaiveProxy {
+class NaiveProxy : public NetworkChangeNotifier::NetworkChangeObserver {
  public:
+  // `ssl_server_context` is only set with ClientProtocol::kHttps, unless it
+  // serves cleartext h2 with prior knowledge for an h2c:// listener, and
+  // `server_socket` with any but ClientProtocol::kEmbedded and kTun.
+  // `user_table` authenticates SOCKS5 clients without `listen_user` and
+  // `listen_pass`, null if no users are configured. `router` is null without
+  // route rules. `tunnel_sessions` may be shared with the other listeners of
+  // the thread.
   NaiveProxy(std::unique_ptr<ServerSocket> server_socket,
+             std::unique_ptr<SSLServerContext> ssl_server_context,
              ClientProtocol protocol,
              const std::string& listen_user,
              const std::string& listen_pass,
-             int concurrency,
+             scoped_refptr<NaiveUserTable> user_table,
+             scoped_refptr<NaiveRouter> router,
+             int max_connections,
+             int max_handshakes,
+             scoped_refptr<NaiveTunnelSessions> tunnel_sessions,
+             const NaiveRelayConfig& relay_config,
              RedirectResolver* resolver,
              HttpNetworkSession* session,
              const NetworkTrafficAnnotationTag& traffic_annotation,
              const std::vector<PaddingType>& supported_padding_types);
-  ~NaiveProxy();
+  ~NaiveProxy() override;
   NaiveProxy(const NaiveProxy&) = delete;
   NaiveProxy& operator=(const NaiveProxy&) = delete;
 
+#if BUILDFLAG(IS_LINUX)
+  // Serves a connected socket accepted on another thread, as if it had been
+  // accepted by this proxy's listener.
+  void AdoptSocket(base::ScopedFD socket, const IPEndPoint& peer_address);
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+  // Detaches the relay with the most throughput over its life that
+  // NaiveConnection::CanDetachRelay() allows and that is at least
+  // `min_age` old, for the proxy of the same listener on another thread to
+  // adopt. Only SOCKS5 and HTTP listeners, which every upstream thread
+  // serves, give up relays. Returns nullopt if none can move.
+  std::optional<NaiveDetachedRelay> DetachBusiestRelay(base::TimeDelta min_age);
+  // Goes on with `relay` detached on another thread. Adopted relays run as
+  // ClientProtocol::kEmbedded connections, without a handshake, and do not
+  // move again. The relay is dropped at the connection limit.
+  void AdoptRelay(NaiveDetachedRelay relay);
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+  // Serves `socket` of a ClientProtocol::kTun proxy, relaying it to `origin`
+  // without a client handshake. The flow is reset if it is rejected.
+  void AdoptTunFlow(std::unique_ptr<NaiveTunTcpSocket> socket,
+                    const HostPortPair& origin);
+#endif
+
+#if BUILDFLAG(IS_POSIX)
+  // Serves `socket` connected by the host of a ClientProtocol::kEmbedded
+  // proxy, relaying it to `origin` without a client handshake.
+  void AdoptEmbedded(base::ScopedFD socket, const HostPortPair& origin);
+#endif
+
+  // Opens a speculative tunnel to `name` like one a redirected connection
+  // would open, for the connection to take over once it arrives. Only the
+  // HTTPS port is warmed since the port is not known yet.
+  void PreconnectName(const std::string& name);
+
+  // Closes the listener, leaving the open connections to finish.
+  void StopAccepting();
+  bool is_accepting() const { return accepting_; }
+
+  // Client connections accepted or adopted so far.
+  uint64_t accept_count() const { return accept_count_; }
+  size_t connection_count() const { return connections_.size(); }
+  // Connections yet to complete their handshake and upstream connect.
+  size_t handshake_count() const { return handshake_count_; }
+  // Adopted connections, https:// tunnels and connections to a destination
+  // dropped at a limit.
+  uint64_t reject_count() const { return reject_count_; }
+  // Whether a limit holds off accepting, leaving clients in the backlog.
+  bool accept_paused() const { return accept_paused_; }
+  // Open connections by tunnel session, of all the listeners sharing them.
+  const std::vector<int>& tunnel_connection_counts() const {
+    return tunnel_sessions_->connection_counts;
+  }
+  // Of the closed sides of the connections so far.
+  const NaivePaddingStats& padding_stats() const { return padding_stats_; }
+  // The memory each open connection holds now by its id, see
+  // NaiveConnection::GetMemoryUsage().
+  std::vector<std::pair<unsigned int, NaiveMemoryUsage>>
+  GetConnectionMemoryUsage();
+#if BUILDFLAG(IS_LINUX)
+  // Samples the TCP_INFO of at most about `max_connections` relaying
+  // connections, see NaiveConnection::SampleTcpInfo(). Successive calls take
+  // different ones while there are more.
+  void SampleTcpInfo(size_t max_connections);
+#endif
+
+  // Appends a line to `out` for each open connection, a JSON object
+  // starting with the members in `fields`, for the admin listing of
+  // NaiveMetricsServer.
+  void AppendConnectionListing(std::string_view fields, std::string* out);
+  // Likewise for each tunnel session, with its open connections.
+  void AppendTunnelSessionListing(std::string_view fields,
+                                  std::string* out) const;
+  // Closes the open connection `connection_id` for the admin, returning
+  // false if there is none.
+  bool CloseConnection(unsigned int connection_id);
+
+  // Records each connection once it closes.
+  void set_access_log(scoped_refptr<NaiveAccessLog> access_log) {
+    access_log_ = std::move(access_log);
+  }
+
+  base::WeakPtr<NaiveProxy> GetWeakPtr() {
+    return weak_ptr_factory_.GetWeakPtr();
+  }
+
+  // NetworkChangeNotifier::NetworkChangeObserver implementation.
+  void OnNetworkChanged(NetworkChangeNotifier::ConnectionType type) override;
+
  private:
+  using ConnectionTable = NaiveSlotTable<NaiveConnection>;
+  using HttpsSessionTable = NaiveSlotTable<NaiveHttpsServerSession>;
+
   void DoAcceptLoop();
   void OnAcceptComplete(int result);
-  void HandleAcceptResult(int result);
 
-  void DoConnect();
+  bool AtConnectionLimit() const;
+  // Restarts the accept loop paused at a limit, or in overload, once below
+  // it.
+  void MaybeResumeAccept();
+
+  void DoConnect(std::unique_ptr<StreamSocket> accepted_socket);
+  // Serves `client_socket`, accepted or a tunnel of an https:// session,
+  // with a new connection.
+  void DoConnectTunnel(std::unique_ptr<StreamSocket> client_socket);
+  // Likewise, expecting a PROXY protocol header first if `proxy_protocol`.
+  // `proxied_source` is the client address of the header read with an
+  // earlier request on a transport kept alive.
+  void ConnectTunnel(std::unique_ptr<StreamSocket> client_socket,
+                     bool proxy_protocol,
+                     const std::optional<IPEndPoint>& proxied_source);
+  // Serves `socket`, the handshake socket over a client of `protocol`, with
+  // a new connection. `origin` is the destination of a
+  // ClientProtocol::kEmbedded or kTun one, empty otherwise.
+  void StartConnection(
+      ClientProtocol protocol,
+      std::unique_ptr<PaddingDetectorDelegate> padding_detector_delegate,
+      const ProxyInfo& proxy_info,
+      std::unique_ptr<StreamSocket> socket,
+      const HostPortPair& origin);
+  void OnBondJoined(std::unique_ptr<NaiveBondSocket> socket,
+                    PaddingType padding_type);
   void OnConnectComplete(unsigned int connection_id, int result);
   void HandleConnectResult(NaiveConnection* connection, int result);
 
@@ -59,25 +223,162 @@ class NaiveProxy {
 
   void Close(unsigned int connection_id, int reason);
 
+  void DoHttpsHandshake(std::unique_ptr<StreamSocket> accepted_socket);
+  void OnHttpsHandshakeComplete(unsigned int session_id, int result);
+  void CloseHttpsSession(unsigned int session_id, int reason);
+
+  // Closes the connection once past its deadline, otherwise checks it again
+  // then.
+  void CheckTimeout(unsigned int connection_id);
+  void ScheduleTimeoutCheck(NaiveConnection* connection);
+
   NaiveConnection* FindConnection(unsigned int connection_id);
+  // Takes the connection out of the table and the accounting of its tunnel
+  // session and destination, for Close() or DetachBusiestRelay().
+  std::unique_ptr<NaiveConnection> RemoveConnection(
+      unsigned int connection_id);
+
+  // Returns the upstream the proxy delegate ranks best for the next
+  // connection.
+  const ProxyInfo& PickUpstream();
+  // Returns the upstream of the rule `origin` matches, or nullptr for
+  // PickUpstream()'s.
+  const ProxyInfo* Route(const HostPortPair& origin) const;
+  // Counts a connection to `origin` unless that reaches
+  // NaiveRelayConfig::max_destination_connections, if set.
+  bool AdmitDestination(const HostPortPair& origin);
+  void ReleaseDestination(const HostPortPair& origin);
+  // Feeds the connect result into the upstream ranking.
+  void ReportUpstreamResult(NaiveConnection* connection, int result);
+
+  // Returns the connections on a tunnel session beyond which another is
+  // added.
+  int SessionConnectionsHigh() const;
+  // Returns the tunnel session with the fewest connections for the next
+  // connection, taking equally loaded ones in round-robin order.
+  int PickTunnelSession() const;
+  // Returns the new session.
+  int AddTunnelSession();
+  // Removes added sessions left without connections once the load drops.
+  void RemoveIdleTunnelSessions();
+  int FindTunnelSession(const NetworkAnonymizationKey& key) const;
+  // Whether a connection to `origin` at `priority` is bulk, by its priority
+  // or an earlier connection to it, see NaiveConfig::bulk_sessions.
+  bool IsBulkDestination(const HostPortPair& origin, RequestPriority priority);
+  // Moves a connection to `origin` from the session of `current` to the
+  // least loaded bulk session if it is bulk, otherwise to the one its
+  // registrable domain hashes to unless that one is loaded, see
+  // NaiveRelayConfig::session_affinity.
+  const NetworkAnonymizationKey& PickDestinationSession(
+      const HostPortPair& origin,
+      RequestPriority priority,
+      const NetworkAnonymizationKey& current);
+
+  // Preconnects a tunnel for each anonymization key unless one is idle,
+  // only for the first while CloseIdleTunnelSessions() has the others
+  // closed.
+  void KeepWarm();
+  // Preconnects a tunnel for the anonymization keys in [begin, end).
+  void WarmTunnelSessions(size_t begin, size_t end);
+  // Closes the tunnel sessions past the first once no connection was open
+  // for a wakeup period, see NaiveConfig::wakeup_period. The next
+  // connection takes the first session and warms the others again.
+  void CloseIdleTunnelSessions();
+  // Opens the replacement of a tunnel session that received a GOAWAY, for
+  // which new connections wait in the session pool instead of failing. The
+  // tunnels on the old session run to completion.
+  void OnTunnelSessionGoAway(const NetworkAnonymizationKey& key);
+
+  // Tops up the idle direct connections to the hot destinations, see
+  // NaiveRelayConfig::egress_preconnect.
+  void RefillEgressPools();
+  void PreconnectEgress(const HostPortPair& destination);
+
+  // Preconnects every upstream and ranks them by how fast they connect.
+  void RaceUpstreams();
+  void OnRaceComplete(size_t upstream, base::TimeTicks start_time, int result);
 
   std::unique_ptr<ServerSocket> listen_socket_;
+  std::unique_ptr<SSLServerContext> ssl_server_context_;
   ClientProtocol protocol_;
   std::string listen_user_;
   std::string listen_pass_;
-  int concurrency_;
-  ProxyInfo proxy_info_;
+  scoped_refptr<NaiveUserTable> user_table_;
+  int max_connections_;
+  int max_handshakes_;
+  ProxyList proxy_list_;
+  // One per chain of `proxy_list_`, in its order. Connections keep
+  // references to these.
+  std::vector<ProxyInfo> proxy_infos_;
+  scoped_refptr<NaiveRouter> router_;
+  // One per target of `router_`, in its order.
+  std::vector<ProxyInfo> route_infos_;
+  NaiveConnection::RouteCallback route_callback_;
+  // Set with NaiveRelayConfig::max_destination_connections or
+  // egress_preconnect.
+  NaiveConnection::AdmitCallback admit_callback_;
+  // Admitted connections open by destination.
+  std::map<HostPortPair, int> destination_connections_;
+  // Set with NaiveRelayConfig::session_affinity or
+  // NaiveConfig::bulk_sessions.
+  NaiveConnection::SessionCallback session_callback_;
+  // Set with NaiveRelayConfig::egress_preconnect, of the connects of
+  // direct:// connections.
+  std::unique_ptr<NaiveHotDestinations> hot_destinations_;
+  // Of the egress preconnects and adopted relays.
+  ProxyInfo direct_proxy_info_;
+  NaiveRelayConfig relay_config_;
+  // Of the connections of this listener, see NaiveRelayConfig::rate_limit.
+  NaiveRateLimiter::LimitSet rate_limits_;
   RedirectResolver* resolver_;
   HttpNetworkSession* session_;
   NetLogWithSource net_log_;
 
   unsigned int last_id_;
+  uint64_t accept_count_;
+  size_t handshake_count_;
+  uint64_t reject_count_;
+  NaivePaddingStats padding_stats_;
+  scoped_refptr<NaiveAccessLog> access_log_;
+#if BUILDFLAG(IS_LINUX)
+  // Where SampleTcpInfo() starts counting connections.
+  size_t tcp_info_sample_phase_ = 0;
+#endif
+  bool accept_paused_;
+  // Until StopAccepting(), with or without `listen_socket_`.
+  bool accepting_;
 
   std::unique_ptr<StreamSocket> accepted_socket_;
+  // Sockets accepted by DoAcceptLoop() whose connections are not set up
+  // yet. Keeps its capacity across batches.
+  std::vector<std::unique_ptr<StreamSocket>> accept_batch_;
+
+  scoped_refptr<NaiveTunnelSessions> tunnel_sessions_;
+  // Of the tunnel sessions of bond members past the first, see
+  // NaiveRelayConfig::bond_members.
+  std::vector<NetworkAnonymizationKey> bond_network_anonymization_keys_;
+  // Set with NaiveRelayConfig::accept_bonds.
+  std::unique_ptr<NaiveBondJoiner> bond_joiner_;
 
-  std::vector<NetworkAnonymizationKey> network_anonymization_keys_;
+  base::MetronomeTimer keep_warm_timer_;
+  base::MetronomeTimer race_timer_;
+  base::MetronomeTimer egress_timer_;
+  // Runs CloseIdleTunnelSessions() in mobile mode.
+  base::MetronomeTimer idle_session_timer_;
+  bool observes_network_changes_;
+  // Of OnTunnelSessionGoAway(), with a proxy to tunnel through.
+  base::CallbackListSubscription spdy_go_away_subscription_;
+  base::CallbackListSubscription quic_go_away_subscription_;
+  // Of MaybeResumeAccept(), when the thread leaves overload, see
+  // NaiveLagMonitor.
+  base::CallbackListSubscription overload_end_subscription_;
 
-  std::map<unsigned int, std::unique_ptr<NaiveConnection>> connection_by_id_;
+  ConnectionTable connections_;
+  // TLS connections of an https:// listener, which hand their tunnels over
+  // to `connections_`.
+  HttpsSessionTable https_sessions_;
+  // Has at most one check scheduled for each connection.
+  NaiveTimerWheel timeout_wheel_;
 
   const NetworkTrafficAnnotationTag& traffic_annotation_;
 
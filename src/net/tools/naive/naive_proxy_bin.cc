@@ -3,48 +3,85 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <cinttypes>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include "base/allocator/allocator_check.h"
 #include "base/allocator/partition_alloc_support.h"
 #include "base/allocator/partition_allocator/src/partition_alloc/shim/allocator_shim.h"
 #include "base/at_exit.h"
+#include "base/barrier_callback.h"
 #include "base/check.h"
 #include "base/command_line.h"
+#include "base/containers/contains.h"
 #include "base/feature_list.h"
 #include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/bind.h"
+#include "base/functional/callback_helpers.h"
 #include "base/json/json_file_value_serializer.h"
+#include "base/json/string_escape.h"
 #include "base/json/json_writer.h"
+#include "base/location.h"
 #include "base/logging.h"
+#include "base/memory/weak_ptr.h"
+#include "base/notreached.h"
 #include "base/process/memory.h"
+#include "base/process/process_metrics.h"
 #include "base/rand_util.h"
+#include "base/ranges/algorithm.h"
 #include "base/run_loop.h"
 #include "base/strings/escape.h"
+#include "base/strings/strcat.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/system/sys_info.h"
+#include "base/task/bind_post_task.h"
 #include "base/task/single_thread_task_executor.h"
+#include "base/task/single_thread_task_runner.h"
 #include "base/task/thread_pool/thread_pool_instance.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/timer/timer.h"
 #include "base/values.h"
 #include "build/build_config.h"
 #include "components/version_info/version_info.h"
 #include "net/base/auth.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/network_change_notifier.h"
 #include "net/base/network_isolation_key.h"
 #include "net/base/url_util.h"
+#include "net/cert/cert_net_fetcher.h"
 #include "net/cert/cert_verifier.h"
-#include "net/cert_net/cert_net_fetcher_url_request.h"
+#include "net/cert/coalescing_cert_verifier.h"
+#include "net/cert/x509_certificate.h"
+#include "net/cert/x509_util.h"
+#include "net/dns/host_cache.h"
+#include "net/dns/public/dns_config_overrides.h"
 #include "net/dns/host_resolver.h"
 #include "net/dns/mapped_host_resolver.h"
 #include "net/http/http_auth.h"
 #include "net/http/http_auth_cache.h"
 #include "net/http/http_network_session.h"
 #include "net/http/http_request_headers.h"
+#include "net/http/http_server_properties.h"
 #include "net/http/http_transaction_factory.h"
 #include "net/log/file_net_log_observer.h"
 #include "net/log/net_log.h"
@@ -53,211 +90,2257 @@
 #include "net/log/net_log_event_type.h"
 #include "net/log/net_log_source.h"
 #include "net/log/net_log_util.h"
+#include "net/nqe/effective_connection_type.h"
+#include "net/nqe/network_quality_estimator.h"
+#include "net/nqe/network_quality_estimator_params.h"
 #include "net/proxy_resolution/configured_proxy_resolution_service.h"
 #include "net/proxy_resolution/proxy_config.h"
 #include "net/proxy_resolution/proxy_config_service_fixed.h"
 #include "net/proxy_resolution/proxy_config_with_annotation.h"
+#include "net/proxy_resolution/proxy_list.h"
+#include "net/quic/quic_context.h"
+#include "net/quic/quic_session_pool.h"
 #include "net/socket/client_socket_pool_manager.h"
+#include "net/socket/socks_connect_job.h"
 #include "net/socket/ssl_client_socket.h"
+#include "net/socket/ssl_server_socket.h"
 #include "net/socket/tcp_server_socket.h"
+#include "net/socket/tcp_socket.h"
+#include "net/socket/transport_connect_job.h"
 #include "net/socket/udp_server_socket.h"
+#include "net/spdy/spdy_http_utils.h"
+#include "net/spdy/spdy_proxy_client_socket.h"
+#include "net/spdy/spdy_session_pool.h"
 #include "net/ssl/ssl_config_service.h"
 #include "net/ssl/ssl_key_logger_impl.h"
+#include "net/ssl/ssl_server_config.h"
 #include "net/third_party/quiche/src/quiche/quic/core/quic_versions.h"
+#include "net/third_party/quiche/src/quiche/spdy/core/spdy_protocol.h"
+#include "net/tools/naive/naive_cert_net_fetcher.h"
+#include "net/tools/naive/naive_cert_verifier.h"
 #include "net/tools/naive/naive_command_line.h"
 #include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_access_log.h"
+#include "net/tools/naive/naive_bench.h"
+#include "net/tools/naive/naive_buffer_pool.h"
+#include "net/tools/naive/naive_heavy_hitters.h"
+#include "net/tools/naive/naive_host_resolver.h"
+#include "net/tools/naive/naive_log_sink.h"
+#include "net/tools/naive/naive_main.h"
+#include "net/tools/naive/naive_idle_trimmer.h"
+#include "net/tools/naive/naive_lag_monitor.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_metrics_server.h"
+#include "net/tools/naive/naive_negative_cache.h"
+#include "net/tools/naive/naive_net_log_ring.h"
+#include "net/tools/naive/naive_network_adapter.h"
 #include "net/tools/naive/naive_protocol.h"
 #include "net/tools/naive/naive_proxy.h"
 #include "net/tools/naive/naive_proxy_delegate.h"
+#include "net/tools/naive/naive_relay_scheduler.h"
+#include "net/tools/naive/naive_router.h"
+#include "net/tools/naive/naive_session_store.h"
+#include "net/tools/naive/naive_stats.h"
+#include "net/tools/naive/naive_trace_recorder.h"
+#include "net/tools/naive/naive_ticket_keys.h"
+#include "net/tools/naive/naive_tunnel_context.h"
+#include "net/tools/naive/naive_tunnel_sessions.h"
+#include "net/tools/naive/naive_user_table.h"
+#include "net/tools/naive/naive_wakeup.h"
 #include "net/tools/naive/redirect_resolver.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
 #include "net/url_request/url_request_context.h"
 #include "net/url_request/url_request_context_builder.h"
+#include "partition_alloc/partition_alloc_buildflags.h"
+#include "partition_alloc/partition_alloc_config.h"
+#include "partition_alloc/thread_cache.h"
+#include "third_party/boringssl/src/include/openssl/bio.h"
+#include "third_party/boringssl/src/include/openssl/evp.h"
+#include "third_party/boringssl/src/include/openssl/pem.h"
 #include "url/gurl.h"
 #include "url/scheme_host_port.h"
 #include "url/url_util.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include <sched.h>
+
+#include "base/message_loop/message_pump_epoll.h"
+#include "net/tools/naive/naive_accept_forwarder.h"
+#include "net/tools/naive/naive_doh_client.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/certificate_view.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/proof_source_x509.h"
+#include "net/tools/naive/naive_handoff.h"
+#include "net/tools/naive/naive_numa.h"
+#include "net/tools/naive/naive_quic_server.h"
+#include "net/tools/naive/naive_rebalancer.h"
+#include "net/tools/naive/naive_tcp_info.h"
+#include "net/tools/naive/naive_tproxy_udp_relay.h"
+#include "net/tools/naive/naive_tun_stack.h"
+#endif
+
+#if BUILDFLAG(IS_POSIX)
+#include <signal.h>
+
+#include "net/tools/naive/naive_embedding.h"
+#include "net/tools/naive/naive_signal_watcher.h"
+#include "net/tools/naive/naive_unix_server_socket.h"
+#endif
+
 #if BUILDFLAG(IS_APPLE)
-#include "base/allocator/early_zone_registration_apple.h"
 #include "base/apple/scoped_nsautorelease_pool.h"
 #endif
 
-namespace {
-
-constexpr int kListenBackLog = 512;
-constexpr int kDefaultMaxSocketsPerPool = 256;
-constexpr int kDefaultMaxSocketsPerGroup = 255;
-constexpr int kExpectedMaxUsers = 8;
-constexpr net::NetworkTrafficAnnotationTag kTrafficAnnotation =
-    net::DefineNetworkTrafficAnnotation("naive", "");
-
-std::unique_ptr<base::Value::Dict> GetConstants() {
-  base::Value::Dict constants_dict = net::GetNetConstants();
-  base::Value::Dict dict;
-  std::string os_type = base::StringPrintf(
-      "%s: %s (%s)", base::SysInfo::OperatingSystemName().c_str(),
-      base::SysInfo::OperatingSystemVersion().c_str(),
-      base::SysInfo::OperatingSystemArchitecture().c_str());
-  dict.Set("os_type", os_type);
-  constants_dict.Set("clientInfo", std::move(dict));
-  return std::make_unique<base::Value::Dict>(std::move(constants_dict));
+#if BUILDFLAG(IS_WIN)
+#include "net/socket/socket_descriptor.h"
+#endif
+
+namespace {
+
+constexpr int kListenBackLog = 512;
+constexpr int kDefaultMaxSocketsPerPool = 256;
+constexpr int kDefaultMaxSocketsPerGroup = 255;
+constexpr int kExpectedMaxUsers = 8;
+// Socket pool limits of low-memory, per MB of physical memory and at least.
+constexpr int kLowMemorySocketsPerMB = 4;
+constexpr int kLowMemoryMinSockets = 64;
+// Idle relay buffers kept per IO thread with low-memory.
+constexpr size_t kLowMemoryMaxFreeBytes = 1024 * 1024;
+// The payload of a full TLS record.
+constexpr size_t kMaxH2CoalescedWriteSize = 16 * 1024;
+// Connections of each listener sampled per --tcp-info-interval.
+constexpr size_t kMaxTcpInfoSamples = 64;
+// How long the HEADERS frames of tunnels opened in a burst, as on a browser
+// session restore, are held to share writes.
+constexpr base::TimeDelta kH2HeadersBatchingWindow = base::Milliseconds(1);
+constexpr net::NetworkTrafficAnnotationTag kTrafficAnnotation =
+    net::DefineNetworkTrafficAnnotation("naive", "");
+
+std::unique_ptr<base::Value::Dict> GetConstants() {
+  base::Value::Dict constants_dict = net::GetNetConstants();
+  base::Value::Dict dict;
+  std::string os_type = base::StringPrintf(
+      "%s: %s (%s)", base::SysInfo::OperatingSystemName().c_str(),
+      base::SysInfo::OperatingSystemVersion().c_str(),
+      base::SysInfo::OperatingSystemArchitecture().c_str());
+  dict.Set("os_type", os_type);
+  constants_dict.Set("clientInfo", std::move(dict));
+  return std::make_unique<base::Value::Dict>(std::move(constants_dict));
+}
+}  // namespace
+
+namespace net {
+namespace {
+// NetLog::ThreadSafeObserver implementation that simply prints stall events
+// to the logs.
+class PrintingLogObserver : public NetLog::ThreadSafeObserver {
+ public:
+  // Only these are dispatched to the observer, so other events do not
+  // materialize their parameters for it.
+  static std::vector<NetLogEventType> GetEventTypes() {
+    return {
+        NetLogEventType::SOCKET_POOL_STALLED_MAX_SOCKETS,
+        NetLogEventType::SOCKET_POOL_STALLED_MAX_SOCKETS_PER_GROUP,
+        NetLogEventType::HTTP2_SESSION_STREAM_STALLED_BY_SESSION_SEND_WINDOW,
+        NetLogEventType::HTTP2_SESSION_STREAM_STALLED_BY_STREAM_SEND_WINDOW,
+        NetLogEventType::HTTP2_SESSION_STALLED_MAX_STREAMS,
+        NetLogEventType::HTTP2_STREAM_FLOW_CONTROL_UNSTALLED,
+    };
+  }
+
+  PrintingLogObserver() = default;
+  PrintingLogObserver(const PrintingLogObserver&) = delete;
+  PrintingLogObserver& operator=(const PrintingLogObserver&) = delete;
+
+  ~PrintingLogObserver() override {
+    // This is guaranteed to be safe as worker threads are stopped first.
+    net_log()->RemoveObserver(this);
+  }
+
+  // NetLog::ThreadSafeObserver implementation:
+  void OnAddEntry(const NetLogEntry& entry) override {
+    const char* source_type = NetLog::SourceTypeToString(entry.source.type);
+    const char* event_type = NetLogEventTypeToString(entry.type);
+    const char* event_phase = NetLog::EventPhaseToString(entry.phase);
+    base::Value params(entry.ToDict());
+    std::string params_str;
+    base::JSONWriter::Write(params, &params_str);
+    params_str.insert(0, ": ");
+
+    VLOG(1) << source_type << "(" << entry.source.id << "): " << event_type
+            << ": " << event_phase << params_str;
+  }
+};
+}  // namespace
+
+class NaiveHandoff;
+class NaiveNumaSteering;
+
+namespace {
+// How often a process draining after a handoff checks its connections.
+constexpr base::TimeDelta kDrainCheckInterval = base::Seconds(1);
+
+std::unique_ptr<URLRequestContext> BuildCertURLRequestContext(NetLog* net_log) {
+  URLRequestContextBuilder builder;
+
+  builder.DisableHttpCache();
+  UseTunnelOnlyServices(&builder);
+  builder.set_net_log(net_log);
+
+  ProxyConfig proxy_config;
+  auto proxy_service =
+      ConfiguredProxyResolutionService::CreateWithoutProxyResolver(
+          std::make_unique<ProxyConfigServiceFixed>(
+              ProxyConfigWithAnnotation(proxy_config, kTrafficAnnotation)),
+          net_log);
+  proxy_service->ForceReloadProxyConfig();
+  builder.set_proxy_resolution_service(std::move(proxy_service));
+
+  return builder.Build();
+}
+
+// CertVerifier::CreateDefault() without its cache, loading the trust store.
+std::unique_ptr<CertVerifier> CreateCertVerifier(
+    scoped_refptr<CertNetFetcher> cert_net_fetcher) {
+  base::ElapsedTimer timer;
+  auto verifier = std::make_unique<CoalescingCertVerifier>(
+      CertVerifier::CreateDefaultWithoutCaching(std::move(cert_net_fetcher)));
+  LOG(INFO) << "Certificate verifier ready in "
+            << timer.Elapsed().InMilliseconds() << " ms";
+  return verifier;
+}
+
+// kVariant2 is only requested if configured because servers before it reject
+// requests listing unknown padding types.
+std::vector<PaddingType> GetRequestedPaddingTypes(
+    const NaiveRelayConfig& relay_config) {
+  if (relay_config.padding_profile.has_value()) {
+    return {PaddingType::kVariant2, PaddingType::kVariant1, PaddingType::kNone};
+  }
+  return {PaddingType::kVariant1, PaddingType::kNone};
+}
+
+// Offered to the clients of every listener, in order of preference.
+std::vector<PaddingType> GetSupportedPaddingTypes() {
+  return {PaddingType::kVariant2, PaddingType::kVariant1, PaddingType::kNone};
+}
+
+// Lets tunnels authenticate to the proxies of `config`, replacing the
+// credentials set before.
+void SetProxyCredentials(const NaiveConfig& config,
+                         HttpNetworkSession* session) {
+  auto* auth_cache = session->http_auth_cache();
+  auth_cache->ClearAllEntries();
+  for (const NaiveProxyServerConfig& proxy : config.proxies) {
+    if (proxy.user.empty() || proxy.pass.empty())
+      continue;
+    // The origin as in the proxy list, see BuildURLRequestContext().
+    std::string proxy_url = proxy.url;
+    if (proxy_url.compare(0, 7, "quic://") == 0 ||
+        proxy_url.compare(0, 7, "auto://") == 0) {
+      proxy_url.replace(0, 4, "https");
+    }
+    url::SchemeHostPort auth_origin{GURL(proxy_url)};
+    AuthCredentials credentials(proxy.user, proxy.pass);
+    auth_cache->Add(auth_origin, HttpAuth::AUTH_PROXY,
+                    /*realm=*/{}, HttpAuth::AUTH_SCHEME_BASIC, {},
+                    /*challenge=*/"Basic", credentials, /*path=*/"/");
+  }
+}
+
+// Builds a URLRequestContext assuming there's only a single loop.
+// `session_store` and `network_quality_estimator` may be null. Sets
+// `host_mapper` to the resolver applying the host resolver rules.
+std::unique_ptr<URLRequestContext> BuildURLRequestContext(
+    const NaiveConfig& config,
+    scoped_refptr<CertNetFetcher> cert_net_fetcher,
+    NetLog* net_log,
+    NaiveSessionStore* session_store,
+    NetworkQualityEstimator* network_quality_estimator,
+    MappedHostResolver** host_mapper) {
+  URLRequestContextBuilder builder;
+
+  builder.DisableHttpCache();
+  UseTunnelOnlyServices(&builder);
+  builder.set_net_log(net_log);
+  builder.set_network_quality_estimator(network_quality_estimator);
+
+  HttpNetworkSessionParams session_params;
+  session_params.http_proxy_warm_sockets = config.proxy_warm_pool;
+  session_params.socks5_warm_sockets = config.proxy_warm_pool;
+  if (config.h2_session_window > 0) {
+    session_params.spdy_session_max_recv_window_size = config.h2_session_window;
+  }
+  if (config.h2_stream_window > 0) {
+    session_params.http2_settings[spdy::SETTINGS_INITIAL_WINDOW_SIZE] =
+        config.h2_stream_window;
+  }
+  if (config.h2_header_table_size > 0) {
+    session_params.http2_settings[spdy::SETTINGS_HEADER_TABLE_SIZE] =
+        config.h2_header_table_size;
+  }
+  builder.set_http_network_session_params(session_params);
+
+  // The QUIC session pool copies its config when the context is built.
+  auto quic_context = std::make_unique<QuicContext>();
+  quic_context->params()->connection_options = config.quic_connection_options;
+  quic_context->params()->client_connection_options =
+      config.quic_client_connection_options;
+  quic_context->params()->session_flow_control_window =
+      config.quic_session_window;
+  quic_context->params()->stream_flow_control_window =
+      config.quic_stream_window;
+  quic_context->params()->auto_tune_flow_control_windows =
+      config.quic_window_autotune;
+  if (config.quic_migration) {
+    // Network change migration needs network handles, which only some
+    // platforms report. Idle sessions migrate too, so the warm ones do not
+    // need a new handshake.
+    QuicParams* params = quic_context->params();
+    params->migrate_sessions_on_network_change_v2 = true;
+    params->migrate_sessions_early_v2 = true;
+    params->retry_on_alternate_network_before_handshake = true;
+    params->allow_port_migration = true;
+    params->migrate_idle_sessions = true;
+  }
+  if (config.quic_max_packet_length > 0) {
+    quic_context->params()->max_packet_length = config.quic_max_packet_length;
+  }
+  quic_context->params()->mtu_discovery_target = config.quic_mtu;
+  quic_context->params()->stream_write_quantum = config.write_quantum;
+  quic_context->params()->report_ecn = config.quic_ecn;
+  quic_context->params()->send_ecn = config.quic_ecn;
+  quic_context->params()->use_tx_time = config.quic_txtime;
+  quic_context->params()->share_sockets = config.quic_shared_socket;
+  // Unacknowledged PINGs then fail the session by its loss detection. Its
+  // alarm follows the last packet, so in mobile mode only the interval is
+  // coalesced.
+  if (config.session_probe_interval.is_positive()) {
+    quic_context->params()->retransmittable_on_wire_timeout =
+        AlignToWakeupPeriod(config.session_probe_interval);
+  }
+  builder.set_quic_context(std::move(quic_context));
+
+  ProxyConfig proxy_config;
+  ProxyList& proxy_list = proxy_config.proxy_rules().single_proxies;
+  proxy_config.proxy_rules().type = ProxyConfig::ProxyRules::Type::PROXY_LIST;
+  // URLs as used for the QUIC origins.
+  std::vector<std::string> proxy_urls;
+  std::vector<bool> force_quic;
+  for (const NaiveProxyServerConfig& proxy : config.proxies) {
+    std::string proxy_url = proxy.url;
+    bool is_quic = proxy_url.compare(0, 7, "quic://") == 0;
+    // Races a QUIC and an HTTP/2 upstream to the same server, see
+    // NaiveProxy::RaceUpstreams(). QUIC goes first to win ties.
+    bool is_auto = proxy_url.compare(0, 7, "auto://") == 0;
+    force_quic.push_back(is_quic || is_auto);
+    if (force_quic.back()) {
+      proxy_url.replace(0, 4, "https");
+    }
+    ProxyList parsed;
+    parsed.Set(proxy_url);
+    if (parsed.size() != 1) {
+      LOG(ERROR) << "Invalid proxy " << proxy.url;
+      return nullptr;
+    }
+    if (force_quic.back()) {
+      proxy_list.AddProxyChain(ProxyChain::ForIpProtection(
+          {ProxyServer(ProxyServer::Scheme::SCHEME_QUIC,
+                       parsed.First().First().host_port_pair())}));
+    }
+    if (!is_quic) {
+      proxy_list.AddProxyChain(parsed.First());
+    }
+    proxy_urls.push_back(std::move(proxy_url));
+  }
+  LOG(INFO) << "Proxying via " << proxy_list.ToDebugString();
+  auto proxy_service =
+      ConfiguredProxyResolutionService::CreateWithoutProxyResolver(
+          std::make_unique<ProxyConfigServiceFixed>(
+              ProxyConfigWithAnnotation(proxy_config, kTrafficAnnotation)),
+          net_log);
+  proxy_service->ForceReloadProxyConfig();
+  builder.set_proxy_resolution_service(std::move(proxy_service));
+
+  HostResolver::ManagerOptions resolver_options;
+  if (config.async_dns) {
+    resolver_options.insecure_dns_client_enabled = true;
+    // Connects only need the addresses, not HTTPS records as well.
+    resolver_options.additional_types_via_insecure_dns_enabled = false;
+    // Each name takes a slot per A and AAAA transaction in flight.
+    resolver_options.max_concurrent_resolves = config.async_dns_concurrency;
+    if (!config.async_dns_servers.empty()) {
+      // Not waiting for the system config, which may never be read without
+      // a NetworkChangeNotifier.
+      resolver_options.dns_config_overrides =
+          DnsConfigOverrides::CreateOverridingEverythingWithDefaults();
+      resolver_options.dns_config_overrides.nameservers =
+          config.async_dns_servers;
+    }
+  }
+  // As the builder would create it, but mapped even without rules so a
+  // reload can set them.
+  auto mapped_host_resolver = std::make_unique<MappedHostResolver>(
+      HostResolver::CreateStandaloneResolver(
+          net_log, resolver_options,
+          /*host_mapping_rules=*/"", /*enable_caching=*/true));
+  mapped_host_resolver->SetRulesFromString(config.host_resolver_rules);
+  *host_mapper = mapped_host_resolver.get();
+  std::unique_ptr<HostResolver> host_resolver =
+      std::move(mapped_host_resolver);
+  if (config.host_cache_max_stale.is_positive() ||
+      config.host_cache_prefetch.is_positive() || !config.proxy_pins.empty()) {
+    NaiveHostResolver::Pins pins;
+    for (const NaiveHostPin& pin : config.proxy_pins) {
+      pins[pin.host] = pin.addresses;
+    }
+    host_resolver = std::make_unique<NaiveHostResolver>(
+        std::move(host_resolver), config.host_cache_max_stale,
+        config.host_cache_prefetch, std::move(pins));
+  }
+  builder.set_host_resolver(std::move(host_resolver));
+
+  // CertVerifier::CreateDefault() with a cache for all threads, created on
+  // the first verification missing it, which pinned proxies never do.
+  NaiveCertVerifier::SpkiPins spki_pins;
+  for (const NaiveSpkiPin& pin : config.proxy_spki_pins) {
+    spki_pins[pin.host] = pin.hashes;
+  }
+  builder.SetCertVerifier(std::make_unique<NaiveCertVerifier>(
+      base::BindOnce(&CreateCertVerifier, std::move(cert_net_fetcher)),
+      std::move(spki_pins)));
+
+  if (session_store) {
+    builder.SetHttpServerProperties(std::make_unique<HttpServerProperties>(
+        session_store->CreatePrefDelegate(), net_log));
+  }
+
+  builder.set_proxy_delegate(std::make_unique<NaiveProxyDelegate>(
+      config.extra_headers,
+      GetRequestedPaddingTypes(config.relay), config.fastopen,
+      config.padding_cache_file, config.padding_cache_ttl,
+      config.relay.bond_members));
+
+  if (config.no_post_quantum == true) {
+    struct NoPostQuantum : public SSLConfigService {
+      SSLContextConfig GetSSLContextConfig() override {
+        SSLContextConfig config;
+        config.post_quantum_override = false;
+        return config;
+      }
+
+      bool CanShareConnectionWithClientCerts(std::string_view) const override {
+        return false;
+      }
+    };
+    builder.set_ssl_config_service(std::make_unique<NoPostQuantum>());
+  }
+
+  auto context = builder.Build();
+
+  if (HostCache* host_cache = context->host_resolver()->GetHostCache()) {
+    if (config.host_cache_size > 0) {
+      host_cache->set_max_entries(config.host_cache_size);
+    }
+    host_cache->set_min_ttl(config.host_cache_min_ttl);
+  }
+
+  auto* session = context->http_transaction_factory()->GetSession();
+  if (session_store) {
+    session->ssl_client_context()->ssl_client_session_cache()->set_persister(
+        session_store);
+    session->quic_session_pool()->set_session_cache_factory(
+        base::BindRepeating(&NaiveSessionStore::CreateQuicSessionCache,
+                            base::Unretained(session_store)));
+  }
+  session->spdy_session_pool()->set_recv_window_autotune_max(
+      config.h2_window_max);
+  session->spdy_session_pool()->set_max_read_size(config.h2_read_size);
+  session->spdy_session_pool()->set_upload_notsent_lowat(
+      config.h2_notsent_lowat);
+  // Many tunnel streams sending small frames at once would otherwise cost
+  // a TLS record and a syscall each.
+  session->spdy_session_pool()->set_write_coalescing_size(
+      kMaxH2CoalescedWriteSize);
+  session->spdy_session_pool()->set_write_quantum(config.write_quantum);
+  session->spdy_session_pool()->set_headers_batching_window(
+      kH2HeadersBatchingWindow);
+  session->spdy_session_pool()->set_ping_probe(
+      AlignToWakeupPeriod(config.session_probe_interval),
+      config.session_probe_timeout,
+      /*aligned=*/GetWakeupPeriod().is_positive());
+  for (size_t i = 0; i < config.proxies.size(); ++i) {
+    const NaiveProxyServerConfig& proxy = config.proxies[i];
+    if (proxy.user.empty() || proxy.pass.empty())
+      continue;
+    if (force_quic[i]) {
+      auto* quic = context->quic_context()->params();
+      quic->supported_versions = {quic::ParsedQuicVersion::RFCv1()};
+      quic->origins_to_force_quic_on.insert(
+          net::HostPortPair::FromURL(GURL(proxy_urls[i])));
+    }
+  }
+  SetProxyCredentials(config, session);
+
+  return context;
+}
+
+// The network stack of one IO thread. Not thread-safe, must be created and
+// destroyed on its thread.
+struct NaiveWorker {
+  ~NaiveWorker() {
+    // Before the context whose verifier fetches with it.
+    if (cert_net_fetcher) {
+      cert_net_fetcher->Shutdown();
+    }
+    // On its own thread, which runs the deletion before it is joined.
+    if (resolver_thread) {
+      resolver_thread->task_runner()->DeleteSoon(FROM_HERE,
+                                                 std::move(resolver));
+      resolver_thread->Stop();
+    }
+  }
+
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+  // Outlives the context using it.
+  std::unique_ptr<NaiveSessionStore> session_store;
+  scoped_refptr<NaiveCertNetFetcher> cert_net_fetcher;
+  // Likewise outlives the context, null without
+  // NaiveRelayConfig::adapt_network.
+  std::unique_ptr<NetworkQualityEstimator> network_quality_estimator;
+  std::unique_ptr<URLRequestContext> context;
+  std::unique_ptr<NaiveNetworkAdapter> network_adapter;
+  // Null without NaiveConfig::idle_trim.
+  std::unique_ptr<NaiveIdleTrimmer> idle_trimmer;
+  // Owned by `context`.
+  MappedHostResolver* host_mapper = nullptr;
+  // On the main worker only, with NaiveConfig::resolver_thread. Runs
+  // `resolver`.
+  std::unique_ptr<base::Thread> resolver_thread;
+  // On the main worker only. Lives on `resolver_thread` if set.
+  std::unique_ptr<RedirectResolver> resolver;
+  // The main worker's, translating the fake addresses of redir listeners on
+  // every worker.
+  RedirectResolver* shared_resolver = nullptr;
+  // Shared by all workers, null without NaiveConfig::users.
+  scoped_refptr<NaiveUserTable> user_table;
+  // Likewise without NaiveConfig::route.
+  scoped_refptr<NaiveRouter> router;
+  // Likewise without NaiveConfig::ticket_keys_file.
+  scoped_refptr<NaiveTicketKeys> ticket_keys;
+  // Likewise without NaiveConfig::access_log.
+  scoped_refptr<NaiveAccessLog> access_log;
+  // Drawn from by all its listeners, created with the first of them. Null
+  // with NaiveConfig::separate_tunnel_sessions.
+  scoped_refptr<NaiveTunnelSessions> tunnel_sessions;
+  // Includes proxies of removed listeners until their connections close.
+  std::vector<std::unique_ptr<NaiveProxy>> naive_proxies;
+  // Indexed like NaiveConfig::listen, null for listeners not served here.
+  std::vector<base::WeakPtr<NaiveProxy>> listen_proxies;
+#if BUILDFLAG(IS_LINUX)
+  // Indexed like NaiveConfig::listen.
+  std::vector<std::unique_ptr<NaiveAcceptForwarder>> forwarders;
+  // Indexed like NaiveConfig::listen, the listening sockets offered to the
+  // handoff, -1 if none.
+  std::vector<int> listen_fds;
+  std::unique_ptr<NaiveTproxyUdpRelay> tproxy_udp_relay;
+  // Of the tun:// listener, on the main worker.
+  std::unique_ptr<NaiveTunStack> tun_stack;
+  // Runs SampleWorkerTcpInfo(), unless NaiveConfig::tcp_info_interval is
+  // zero.
+  base::RepeatingTimer tcp_info_timer;
+#endif
+  // Runs HopWorkerPorts(), unless NaiveConfig::quic_port_hop_interval is
+  // zero.
+  base::RepeatingTimer quic_port_hop_timer;
+  // Of NaiveConfig::numa, attached by the main worker to the listening
+  // sockets it opens. Owned by main(), null without numa. Linux only.
+  const NaiveNumaSteering* numa_steering = nullptr;
+  // The most memory its connections held at once as of the scrapes and
+  // dumps that looked, see GetConnectionMemory().
+  size_t connection_memory_peak = 0;
+};
+
+// Runs `task` on the thread the resolver of the main worker `worker` lives
+// on and waits for it. The resolver thread never waits for another.
+void RunOnResolverThread(NaiveWorker* worker, base::OnceClosure task) {
+  if (!worker->resolver_thread) {
+    std::move(task).Run();
+    return;
+  }
+  base::WaitableEvent done;
+  worker->resolver_thread->task_runner()->PostTask(
+      FROM_HERE, std::move(task).Then(base::BindOnce(
+                     &base::WaitableEvent::Signal, base::Unretained(&done))));
+  done.Wait();
+}
+
+// Takes the socket from `handoff` if it has one for the listener, and
+// offers the listening socket to the next process, setting `offered_fd`.
+std::unique_ptr<TCPServerSocket> Listen(const NaiveListenConfig& listen_config,
+                                        NetLog* net_log,
+                                        bool is_main,
+                                        NaiveHandoff* handoff,
+                                        const NaiveNumaSteering* numa_steering,
+                                        int* offered_fd) {
+  auto tcp_socket = std::make_unique<TCPSocket>(
+      /*socket_performance_watcher=*/nullptr, net_log, NetLogSource());
+  TCPSocket* socket = tcp_socket.get();
+  auto listen_socket = std::make_unique<TCPServerSocket>(std::move(tcp_socket));
+
+  int result;
+#if BUILDFLAG(IS_LINUX)
+  std::string key;
+  base::ScopedFD inherited_socket;
+  if (handoff) {
+    key = NaiveHandoff::MakeKey("tcp", listen_config.addr, listen_config.port);
+    inherited_socket = handoff->TakeSocket(key);
+  }
+  if (inherited_socket.is_valid()) {
+    // Already listening.
+    result = listen_socket->AdoptSocket(inherited_socket.release());
+  } else
+#endif
+  {
+    result = listen_socket->ListenWithAddressAndPort(
+        listen_config.addr, listen_config.port, listen_config.backlog);
+  }
+  if (result != OK) {
+    LOG(ERROR) << "Failed to listen on " << ToString(listen_config.protocol)
+               << "://" << listen_config.addr << " " << listen_config.port
+               << ": " << ErrorToShortString(result);
+    return nullptr;
+  }
+  if (is_main) {
+    LOG(INFO) << "Listening on " << ToString(listen_config.protocol) << "://"
+              << listen_config.addr << ":" << listen_config.port;
+  }
+  *offered_fd = -1;
+#if BUILDFLAG(IS_LINUX)
+  // First in the SO_REUSEPORT group, the other workers join the program.
+  if (is_main && numa_steering) {
+    numa_steering->Attach(socket->SocketDescriptorForTesting());
+  }
+  if (handoff) {
+    *offered_fd = socket->SocketDescriptorForTesting();
+    handoff->AddSocket(key, *offered_fd);
+  }
+#else
+  static_cast<void>(socket);
+  static_cast<void>(numa_steering);
+#endif
+  return listen_socket;
+}
+
+#if BUILDFLAG(IS_POSIX)
+// Binds the socket file of a socks+unix:// or http+unix:// listener. A path
+// can only be bound once, so the main worker alone serves it.
+std::unique_ptr<ServerSocket> ListenUnix(const NaiveListenConfig& listen_config,
+                                         NetLog* net_log) {
+  auto listen_socket = std::make_unique<NaiveUnixServerSocket>(net_log);
+  int result = listen_socket->BindAndListen(listen_config.unix_path,
+                                            listen_config.backlog);
+  if (result != OK) {
+    LOG(ERROR) << "Failed to listen on " << ToString(listen_config.protocol)
+               << "+unix://" << listen_config.unix_path << ": "
+               << ErrorToShortString(result);
+    return nullptr;
+  }
+  LOG(INFO) << "Listening on " << ToString(listen_config.protocol)
+            << "+unix://" << listen_config.unix_path;
+  return listen_socket;
+}
+#endif
+
+// Loads the certificate chain and key of an https:// or quic:// listener.
+// The chain starts with the server certificate, followed by its
+// intermediates.
+bool LoadServerCertificate(const NaiveListenConfig& listen_config,
+                           scoped_refptr<X509Certificate>* cert,
+                           bssl::UniquePtr<EVP_PKEY>* key) {
+  std::string cert_data;
+  if (!base::ReadFileToString(listen_config.cert, &cert_data)) {
+    LOG(ERROR) << "Failed to read certificate " << listen_config.cert;
+    return false;
+  }
+  CertificateList certs = X509Certificate::CreateCertificateListFromBytes(
+      base::as_byte_span(cert_data), X509Certificate::FORMAT_PEM_CERT_SEQUENCE);
+  if (certs.empty()) {
+    LOG(ERROR) << "Invalid certificate " << listen_config.cert;
+    return false;
+  }
+  std::vector<bssl::UniquePtr<CRYPTO_BUFFER>> intermediates;
+  for (size_t i = 1; i < certs.size(); ++i) {
+    intermediates.push_back(bssl::UpRef(certs[i]->cert_buffer()));
+  }
+  *cert = X509Certificate::CreateFromBuffer(
+      bssl::UpRef(certs[0]->cert_buffer()), std::move(intermediates));
+
+  std::string key_data;
+  if (!base::ReadFileToString(listen_config.key, &key_data)) {
+    LOG(ERROR) << "Failed to read key " << listen_config.key;
+    return false;
+  }
+  bssl::UniquePtr<BIO> bio(BIO_new_mem_buf(key_data.data(), key_data.size()));
+  key->reset(PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr));
+  if (!*key) {
+    LOG(ERROR) << "Invalid key " << listen_config.key;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<SSLServerContext> CreateHttpsServerContext(
+    const NaiveListenConfig& listen_config,
+    scoped_refptr<NaiveTicketKeys> ticket_keys) {
+  scoped_refptr<X509Certificate> cert;
+  bssl::UniquePtr<EVP_PKEY> key;
+  if (!LoadServerCertificate(listen_config, &cert, &key)) {
+    return nullptr;
+  }
+  SSLServerConfig ssl_config;
+  ssl_config.alpn_protos = {kProtoHTTP2, kProtoHTTP11};
+  ssl_config.ticket_key_source = std::move(ticket_keys);
+  return CreateSSLServerContext(cert.get(), key.get(), ssl_config);
+}
+
+// The members of a bond only meet when all tunnels are served by one
+// thread, see NaiveBondJoiner.
+bool AcceptsBonds(const NaiveConfig& config) {
+  int upstream_threads =
+      config.upstream_threads > 0 ? config.upstream_threads : config.threads;
+  return upstream_threads == 1;
+}
+
+#if BUILDFLAG(IS_LINUX)
+// Issues the session tickets of quic:// listeners under the keys of
+// NaiveConfig::ticket_keys_file if set, and under keys of BoringSSL's own
+// otherwise.
+class NaiveProofSource : public quic::ProofSourceX509 {
+ public:
+  // Returns nullptr if `key` is not that of `chain`.
+  static std::unique_ptr<NaiveProofSource> Create(
+      quiche::QuicheReferenceCountedPointer<Chain> chain,
+      quic::CertificatePrivateKey key,
+      scoped_refptr<NaiveTicketKeys> ticket_keys) {
+    // The constructor is protected.
+    std::unique_ptr<NaiveProofSource> proof_source(new NaiveProofSource(
+        std::move(chain), std::move(key), std::move(ticket_keys)));
+    if (!proof_source->valid()) {
+      return nullptr;
+    }
+    return proof_source;
+  }
+
+  TicketCrypter* GetTicketCrypter() override { return ticket_keys_.get(); }
+
+ private:
+  NaiveProofSource(quiche::QuicheReferenceCountedPointer<Chain> chain,
+                   quic::CertificatePrivateKey key,
+                   scoped_refptr<NaiveTicketKeys> ticket_keys)
+      : quic::ProofSourceX509(std::move(chain), std::move(key)),
+        ticket_keys_(std::move(ticket_keys)) {}
+
+  const scoped_refptr<NaiveTicketKeys> ticket_keys_;
+};
+
+// Opens a UDP socket of the worker's own for a quic:// listener. Unlike TCP
+// listeners, these are not offered to the handoff, as the QUIC connections
+// cannot be carried over.
+std::unique_ptr<NaiveQuicServer> ListenQuic(
+    const NaiveListenConfig& listen_config,
+    bool accept_bonds,
+    scoped_refptr<NaiveTicketKeys> ticket_keys,
+    NetLog* net_log,
+    bool is_main) {
+  scoped_refptr<X509Certificate> cert;
+  bssl::UniquePtr<EVP_PKEY> key;
+  if (!LoadServerCertificate(listen_config, &cert, &key)) {
+    return nullptr;
+  }
+  std::vector<std::string> chain;
+  chain.emplace_back(x509_util::CryptoBufferAsStringPiece(cert->cert_buffer()));
+  for (const auto& intermediate : cert->intermediate_buffers()) {
+    chain.emplace_back(
+        x509_util::CryptoBufferAsStringPiece(intermediate.get()));
+  }
+  // Fails if the key is not that of the certificate.
+  std::unique_ptr<quic::ProofSource> proof_source = NaiveProofSource::Create(
+      quiche::QuicheReferenceCountedPointer<quic::ProofSource::Chain>(
+          new quic::ProofSource::Chain(chain)),
+      quic::CertificatePrivateKey(std::move(key)), ticket_keys);
+  if (!proof_source) {
+    LOG(ERROR) << "Invalid key " << listen_config.key;
+    return nullptr;
+  }
+
+  auto quic_server = std::make_unique<NaiveQuicServer>(
+      std::move(proof_source), GetSupportedPaddingTypes(), accept_bonds,
+      ticket_keys ? ticket_keys->GetSourceAddressTokenSecret() : std::string(),
+      NetLogWithSource::Make(net_log, NetLogSourceType::NONE));
+  int result = quic_server->ListenWithAddressAndPort(
+      listen_config.addr, listen_config.port, listen_config.backlog);
+  if (result != OK) {
+    LOG(ERROR) << "Failed to listen on " << ToString(listen_config.protocol)
+               << "://" << listen_config.addr << " " << listen_config.port
+               << ": " << ErrorToShortString(result);
+    return nullptr;
+  }
+  if (is_main) {
+    LOG(INFO) << "Listening on " << ToString(listen_config.protocol) << "://"
+              << listen_config.addr << ":" << listen_config.port;
+  }
+  return quic_server;
+}
+#endif
+
+// Serves listener `i` of `config` with a new NaiveProxy on `worker`.
+bool AddNaiveProxy(const NaiveConfig& config,
+                   size_t i,
+                   std::unique_ptr<ServerSocket> listen_socket,
+                   NaiveWorker* worker) {
+  const NaiveListenConfig& listen_config = config.listen[i];
+  std::unique_ptr<SSLServerContext> ssl_server_context;
+  if (listen_config.protocol == ClientProtocol::kHttps && !listen_config.h2c) {
+    ssl_server_context =
+        CreateHttpsServerContext(listen_config, worker->ticket_keys);
+    if (!ssl_server_context) {
+      return false;
+    }
+  }
+  auto* session = worker->context->http_transaction_factory()->GetSession();
+  NaiveRelayConfig relay_config = config.relay;
+  for (const NaivePriorityRule& rule : relay_config.priority_rules) {
+    if (rule.listen && rule.Matches(listen_config.port)) {
+      relay_config.priority = rule.priority;
+      break;
+    }
+  }
+  relay_config.listen_rate_limit = listen_config.rate_limit;
+  relay_config.max_destination_connections =
+      listen_config.max_destination_connections;
+  relay_config.proxy_protocol = listen_config.proxy_protocol;
+  relay_config.accept_bonds = AcceptsBonds(config);
+  int upstream_threads =
+      config.upstream_threads > 0 ? config.upstream_threads : config.threads;
+  for (int* rate : {&relay_config.rate_limit, &relay_config.user_rate_limit,
+                    &relay_config.listen_rate_limit}) {
+    if (*rate > 0)
+      *rate = std::max(*rate / upstream_threads, 1);
+  }
+  scoped_refptr<NaiveTunnelSessions> tunnel_sessions = worker->tunnel_sessions;
+  if (!tunnel_sessions) {
+    tunnel_sessions = base::MakeRefCounted<NaiveTunnelSessions>(
+        config.insecure_concurrency, config.bulk_sessions);
+    if (!config.separate_tunnel_sessions) {
+      worker->tunnel_sessions = tunnel_sessions;
+    }
+  }
+  auto naive_proxy = std::make_unique<NaiveProxy>(
+      std::move(listen_socket), std::move(ssl_server_context),
+      listen_config.protocol, listen_config.user, listen_config.pass,
+      worker->user_table, worker->router, listen_config.max_connections,
+      listen_config.max_handshakes, std::move(tunnel_sessions), relay_config,
+      worker->shared_resolver, session, kTrafficAnnotation,
+      GetSupportedPaddingTypes());
+  // The new names are preconnected on the main worker, posted to it from a
+  // resolver thread.
+  if (config.resolver_preconnect && worker->resolver &&
+      listen_config.protocol == ClientProtocol::kRedir) {
+    RedirectResolver::NewNameCallback callback = base::BindRepeating(
+        &NaiveProxy::PreconnectName, naive_proxy->GetWeakPtr());
+    if (worker->resolver_thread) {
+      callback = base::BindPostTask(worker->task_runner, std::move(callback));
+    }
+    RunOnResolverThread(
+        worker, base::BindOnce(&RedirectResolver::set_new_name_callback,
+                               base::Unretained(worker->resolver.get()),
+                               std::move(callback)));
+  }
+  if (worker->access_log) {
+    naive_proxy->set_access_log(worker->access_log);
+  }
+  worker->listen_proxies[i] = naive_proxy->GetWeakPtr();
+  worker->naive_proxies.push_back(std::move(naive_proxy));
+  return true;
+}
+
+#if BUILDFLAG(IS_LINUX)
+// Forwards the connections of listener `i` on `worker` to the NaiveProxy
+// instances of the upstream workers.
+void AddForwarder(const NaiveConfig& config,
+                  size_t i,
+                  std::unique_ptr<TCPServerSocket> listen_socket,
+                  const std::vector<std::unique_ptr<NaiveWorker>>& workers,
+                  NaiveWorker* worker) {
+  int upstream_threads =
+      config.upstream_threads > 0 ? config.upstream_threads : config.threads;
+  std::vector<NaiveAcceptForwarder::Target> targets;
+  for (int j = 0; j < upstream_threads; ++j) {
+    targets.emplace_back(workers[j]->task_runner,
+                         workers[j]->listen_proxies[i]);
+  }
+  worker->forwarders[i] = std::make_unique<NaiveAcceptForwarder>(
+      std::move(listen_socket), std::move(targets));
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+// Serves tun:// listener `i` on the main worker, whose resolver translates
+// fake addresses back to names.
+bool StartTun(const NaiveConfig& config, size_t i, NaiveWorker* worker) {
+  const NaiveListenConfig& listen_config = config.listen[i];
+  if (!AddNaiveProxy(config, i, nullptr, worker)) {
+    return false;
+  }
+  auto* session = worker->context->http_transaction_factory()->GetSession();
+  const auto& proxy_config = static_cast<ConfiguredProxyResolutionService*>(
+                                 session->proxy_resolution_service())
+                                 ->config();
+  const ProxyChain& proxy_chain =
+      proxy_config.value().value().proxy_rules().single_proxies.First();
+  if (listen_config.connect_ip &&
+      !(proxy_chain.is_single_proxy() && proxy_chain.First().is_quic())) {
+    LOG(ERROR) << "connect-ip needs a quic proxy";
+    return false;
+  }
+  worker->tun_stack = std::make_unique<NaiveTunStack>(
+      listen_config.mtu, worker->resolver.get(), proxy_chain,
+      listen_config.connect_ip, session,
+      config.relay.udp_idle_timeout, kTrafficAnnotation,
+      base::BindRepeating(&NaiveProxy::AdoptTunFlow,
+                          worker->listen_proxies[i]));
+  int result = listen_config.tun_fd >= 0
+                   ? worker->tun_stack->Adopt(base::ScopedFD(
+                         listen_config.tun_fd))
+                   : worker->tun_stack->Open(listen_config.device);
+  if (result != OK) {
+    LOG(ERROR) << "Failed to open tun " << listen_config.device << ": "
+               << ErrorToShortString(result);
+    return false;
+  }
+  return true;
+}
+#endif
+
+// Open connections of `worker`, those of removed listeners included.
+size_t CountWorkerConnections(NaiveWorker* worker) {
+  size_t count = 0;
+  for (const auto& naive_proxy : worker->naive_proxies) {
+    count += naive_proxy->connection_count();
+  }
+  return count;
+}
+
+#if BUILDFLAG(IS_LINUX)
+// Samples the TCP_INFO of some connections of `worker` and of its HTTP/2
+// tunnel sessions, which are few enough to take all of them.
+void SampleWorkerTcpInfo(NaiveWorker* worker) {
+  for (const auto& naive_proxy : worker->naive_proxies) {
+    naive_proxy->SampleTcpInfo(kMaxTcpInfoSamples);
+  }
+  auto* session = worker->context->http_transaction_factory()->GetSession();
+  for (SocketDescriptor fd :
+       session->spdy_session_pool()->GetTransportSocketDescriptors()) {
+    AddTcpInfoSample(fd, NaiveTcpInfoStats::kTunnel);
+  }
+}
+#endif
+
+// Moves the QUIC sessions of `worker` to new ports, see
+// QuicSessionPool::HopPorts().
+void HopWorkerPorts(NaiveWorker* worker,
+                    uint16_t first_port,
+                    uint16_t last_port) {
+  auto* session = worker->context->http_transaction_factory()->GetSession();
+  size_t probing =
+      session->quic_session_pool()->HopPorts(first_port, last_port);
+  VLOG(1) << "Hopping ports of " << probing << " QUIC sessions";
+}
+
+// Opens the resolver of redir listener `listen_config` at `listen_addr` on
+// the calling thread, setting `resolver`, or logs why it failed.
+void OpenResolverOnThread(const NaiveConfig* config,
+                          const NaiveListenConfig* listen_config,
+                          const IPAddress& listen_addr,
+                          NetLog* net_log,
+                          NaiveHandoff* handoff,
+                          std::unique_ptr<RedirectResolver>* resolver) {
+#if BUILDFLAG(IS_LINUX)
+  // Serves bursts of queries in batches.
+  auto new_resolver = std::make_unique<RedirectResolver>(
+      config->resolver_range, config->resolver_prefix,
+      config->resolver_range6, config->resolver_prefix6);
+  if (!config->resolver_cache_file.empty()) {
+    new_resolver->UseCacheFile(config->resolver_cache_file);
+  }
+  std::string key;
+  base::ScopedFD inherited_socket;
+  if (handoff) {
+    key = NaiveHandoff::MakeKey("udp", listen_config->addr,
+                                listen_config->port);
+    inherited_socket = handoff->TakeSocket(key);
+  }
+  int result = inherited_socket.is_valid()
+                   ? new_resolver->Listen(std::move(inherited_socket))
+                   : new_resolver->Listen(
+                         IPEndPoint(listen_addr, listen_config->port));
+  if (result != OK) {
+    LOG(ERROR) << "Failed to open resolver: " << ErrorToShortString(result);
+    return;
+  }
+  if (handoff) {
+    handoff->AddSocket(key, new_resolver->socket_descriptor());
+  }
+#else
+  auto resolver_socket =
+      std::make_unique<UDPServerSocket>(net_log, NetLogSource());
+  resolver_socket->AllowAddressReuse();
+  int result =
+      resolver_socket->Listen(IPEndPoint(listen_addr, listen_config->port));
+  if (result != OK) {
+    LOG(ERROR) << "Failed to open resolver: " << ErrorToShortString(result);
+    return;
+  }
+
+  auto new_resolver = std::make_unique<RedirectResolver>(
+      std::move(resolver_socket), config->resolver_range,
+      config->resolver_prefix, config->resolver_range6,
+      config->resolver_prefix6);
+  if (!config->resolver_cache_file.empty()) {
+    new_resolver->UseCacheFile(config->resolver_cache_file);
+  }
+#endif
+  *resolver = std::move(new_resolver);
+}
+
+// Sets up worker `index` on the current IO thread. Workers below
+// `upstream_threads` own a network session; the rest forward their accepted
+// connections to those in `workers`. Only the main worker serves tun and
+// Unix domain socket listeners and the resolver of redir listeners, which
+// the other workers share and which may run on a thread of its own. Sockets
+// are taken from and offered to `handoff` if set.
+bool StartWorker(const NaiveConfig& config,
+                 NetLog* net_log,
+                 int index,
+                 const std::vector<std::unique_ptr<NaiveWorker>>& workers,
+                 NaiveHandoff* handoff,
+                 NaiveWorker* worker) {
+  worker->task_runner = base::SingleThreadTaskRunner::GetCurrentDefault();
+  bool is_main = index == 0;
+  int upstream_threads =
+      config.upstream_threads > 0 ? config.upstream_threads : config.threads;
+
+#if BUILDFLAG(IS_LINUX)
+  worker->listen_fds.assign(config.listen.size(), -1);
+  worker->forwarders.resize(config.listen.size());
+#endif
+  if (index >= upstream_threads) {
+#if BUILDFLAG(IS_LINUX)
+    for (size_t i = 0; i < config.listen.size(); ++i) {
+      const NaiveListenConfig& listen_config = config.listen[i];
+      // Each upstream worker serves quic:// on a socket of its own,
+      // embed:// and tun:// have no socket, and the main worker serves
+      // Unix domain sockets.
+      if (listen_config.protocol == ClientProtocol::kQuic ||
+          listen_config.protocol == ClientProtocol::kEmbedded ||
+          listen_config.protocol == ClientProtocol::kTun ||
+          !listen_config.unix_path.empty()) {
+        continue;
+      }
+      auto listen_socket = Listen(listen_config, net_log, is_main, handoff,
+                                  worker->numa_steering,
+                                  &worker->listen_fds[i]);
+      if (!listen_socket) {
+        return false;
+      }
+      AddForwarder(config, i, std::move(listen_socket), workers, worker);
+    }
+    return true;
+#else
+    NOTREACHED();
+#endif
+  }
+
+  // The builtin verifier is supported but not enabled by default on Mac,
+  // falling back to CreateSystemVerifyProc() which drops the net fetcher,
+  // causing a DCHECK in ~CertNetFetcherURLRequest().
+  // See CertVerifier::CreateDefaultWithoutCaching() and
+  // CertVerifyProc::CreateSystemVerifyProc() for the build flags.
+#if BUILDFLAG(CHROME_ROOT_STORE_SUPPORTED) || BUILDFLAG(IS_FUCHSIA) || \
+    BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_ANDROID)
+  // Its context is built on the first fetch.
+  worker->cert_net_fetcher = base::MakeRefCounted<NaiveCertNetFetcher>(
+      base::BindOnce(&BuildCertURLRequestContext, net_log));
+#endif
+  if (!config.session_cache_file.empty()) {
+    // Each worker keeps its own sessions, so the others have files of their
+    // own, e.g. cache.1.json.
+    base::FilePath session_cache_file = config.session_cache_file;
+    if (!is_main) {
+      session_cache_file = session_cache_file.InsertBeforeExtensionASCII(
+          base::StringPrintf(".%d", index));
+    }
+    worker->session_store =
+        std::make_unique<NaiveSessionStore>(session_cache_file);
+  }
+  if (config.relay.adapt_network) {
+    worker->network_quality_estimator =
+        std::make_unique<NetworkQualityEstimator>(
+            std::make_unique<NetworkQualityEstimatorParams>(
+                std::map<std::string, std::string>()),
+            net_log);
+  }
+  worker->context = BuildURLRequestContext(
+      config, worker->cert_net_fetcher, net_log, worker->session_store.get(),
+      worker->network_quality_estimator.get(), &worker->host_mapper);
+  if (!worker->context) {
+    return false;
+  }
+  if (worker->network_quality_estimator) {
+    auto* session = worker->context->http_transaction_factory()->GetSession();
+    worker->network_adapter = std::make_unique<NaiveNetworkAdapter>(
+        worker->network_quality_estimator.get(), session->spdy_session_pool(),
+        session->params().spdy_session_max_recv_window_size);
+  }
+  if (config.idle_trim.is_positive()) {
+    auto* session = worker->context->http_transaction_factory()->GetSession();
+    // Unretained is safe because the worker owns the trimmer.
+    worker->idle_trimmer = std::make_unique<NaiveIdleTrimmer>(
+        config.idle_trim, config.idle_trim_connections,
+        base::BindRepeating(&CountWorkerConnections, base::Unretained(worker)),
+        worker->context->host_resolver()->GetHostCache(),
+        session->ssl_client_context()->ssl_client_session_cache());
+  }
+  if (config.overload_lag.is_positive()) {
+    NaiveLagMonitor::GetForCurrentThread()->Start(config.overload_lag,
+                                                  config.overload_policy);
+  }
+  if (config.quic_port_hop_interval.is_positive()) {
+    // Unretained is safe because the worker owns the timer.
+    worker->quic_port_hop_timer.Start(
+        FROM_HERE, AlignToWakeupPeriod(config.quic_port_hop_interval),
+        base::BindRepeating(&HopWorkerPorts, base::Unretained(worker),
+                            static_cast<uint16_t>(config.quic_hop_port_min),
+                            static_cast<uint16_t>(config.quic_hop_port_max)));
+  }
+#if BUILDFLAG(IS_LINUX)
+  if (config.tcp_info_interval.is_positive()) {
+    // Unretained is safe because the worker owns the timer.
+    worker->tcp_info_timer.Start(
+        FROM_HERE, AlignToWakeupPeriod(config.tcp_info_interval),
+        base::BindRepeating(&SampleWorkerTcpInfo, base::Unretained(worker)));
+  }
+#endif
+
+  worker->listen_proxies.resize(config.listen.size());
+  for (size_t i = 0; i < config.listen.size(); ++i) {
+    const NaiveListenConfig& listen_config = config.listen[i];
+#if BUILDFLAG(IS_LINUX)
+    if (listen_config.protocol == ClientProtocol::kQuic) {
+      auto quic_server = ListenQuic(listen_config, AcceptsBonds(config),
+                                    worker->ticket_keys, net_log, is_main);
+      if (!quic_server ||
+          !AddNaiveProxy(config, i, std::move(quic_server), worker)) {
+        return false;
+      }
+      continue;
+    }
+#endif
+    if (listen_config.protocol == ClientProtocol::kEmbedded) {
+      if (!AddNaiveProxy(config, i, nullptr, worker)) {
+        return false;
+      }
+      continue;
+    }
+    // Opened after the resolver of any redir listener, see StartTun().
+    if (listen_config.protocol == ClientProtocol::kTun) {
+      continue;
+    }
+#if BUILDFLAG(IS_POSIX)
+    if (!listen_config.unix_path.empty()) {
+      if (!is_main) {
+        continue;
+      }
+      auto listen_socket = ListenUnix(listen_config, net_log);
+      if (!listen_socket ||
+          !AddNaiveProxy(config, i, std::move(listen_socket), worker)) {
+        return false;
+      }
+      continue;
+    }
+#endif
+
+    int offered_fd;
+    auto listen_socket = Listen(listen_config, net_log, is_main, handoff,
+                                worker->numa_steering, &offered_fd);
+    if (!listen_socket) {
+      return false;
+    }
+#if BUILDFLAG(IS_LINUX)
+    worker->listen_fds[i] = offered_fd;
+#endif
+
+    // Started before the others, see NaiveMain().
+    if (!is_main && listen_config.protocol == ClientProtocol::kRedir &&
+        !worker->shared_resolver) {
+      worker->shared_resolver = workers[0]->shared_resolver;
+      // A resolver thread may replace names already, so the worker is
+      // registered before it can read any.
+      if (workers[0]->resolver_thread) {
+        RunOnResolverThread(
+            workers[0].get(),
+            base::BindOnce(&RedirectResolver::AddReader,
+                           base::Unretained(workers[0]->resolver.get()),
+                           worker->task_runner));
+      }
+    }
+    if (is_main && worker->resolver == nullptr &&
+        listen_config.protocol == ClientProtocol::kRedir) {
+      IPAddress listen_addr;
+      if (!listen_addr.AssignFromIPLiteral(listen_config.addr)) {
+        LOG(ERROR) << "Failed to open resolver: " << listen_config.addr;
+        return false;
+      }
+
+      if (config.resolver_thread) {
+        worker->resolver_thread =
+            std::make_unique<base::Thread>("naive_resolver");
+        if (!worker->resolver_thread->StartWithOptions(
+                base::Thread::Options(base::MessagePumpType::IO, 0))) {
+          LOG(ERROR) << "Failed to start resolver thread";
+          worker->resolver_thread.reset();
+          return false;
+        }
+      }
+      // The resolver and its socket are created on the thread they live on.
+      RunOnResolverThread(
+          worker,
+          base::BindOnce(&OpenResolverOnThread, &config, &listen_config,
+                         listen_addr, net_log, handoff, &worker->resolver));
+      if (!worker->resolver) {
+        return false;
+      }
+#if BUILDFLAG(IS_LINUX)
+      if (config.resolver_doh_url.is_valid()) {
+        worker->resolver->set_doh_client(std::make_unique<NaiveDohClient>(
+            worker->context.get(), config.resolver_doh_url,
+            kTrafficAnnotation));
+      }
+#endif
+      if (worker->resolver_thread) {
+        // Looks names up for the tun and TPROXY UDP relays and the redir
+        // listeners of the main worker.
+        RunOnResolverThread(
+            worker, base::BindOnce(&RedirectResolver::AddReader,
+                                   base::Unretained(worker->resolver.get()),
+                                   worker->task_runner));
+      }
+      worker->shared_resolver = worker->resolver.get();
+
+#if BUILDFLAG(IS_LINUX)
+      if (config.tproxy_udp_port > 0) {
+        auto* session =
+            worker->context->http_transaction_factory()->GetSession();
+        const auto& proxy_config =
+            static_cast<ConfiguredProxyResolutionService*>(
+                session->proxy_resolution_service())
+                ->config();
+        const ProxyChain& proxy_chain =
+            proxy_config.value().value().proxy_rules().single_proxies.First();
+        if (!proxy_chain.is_single_proxy() ||
+            !proxy_chain.First().is_quic()) {
+          LOG(ERROR) << "tproxy-udp-port requires a quic proxy";
+          return false;
+        }
+        worker->tproxy_udp_relay = std::make_unique<NaiveTproxyUdpRelay>(
+            proxy_chain, worker->resolver.get(), session,
+            config.relay.udp_idle_timeout, kTrafficAnnotation);
+        int result = worker->tproxy_udp_relay->Listen(
+            IPEndPoint(listen_addr, config.tproxy_udp_port));
+        if (result != OK) {
+          LOG(ERROR) << "Failed to open TPROXY UDP: "
+                     << ErrorToShortString(result);
+          return false;
+        }
+      }
+#endif
+    }
+
+    if (!AddNaiveProxy(config, i, std::move(listen_socket), worker)) {
+      return false;
+    }
+  }
+
+#if BUILDFLAG(IS_LINUX)
+  for (size_t i = 0; is_main && i < config.listen.size(); ++i) {
+    if (config.listen[i].protocol == ClientProtocol::kTun &&
+        !StartTun(config, i, worker)) {
+      return false;
+    }
+  }
+#endif
+
+  return true;
+}
+
+void StartWorkerOnThread(
+    const NaiveConfig* config,
+    NetLog* net_log,
+    int index,
+    const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+    NaiveHandoff* handoff,
+    NaiveWorker* worker,
+    bool* started,
+    base::WaitableEvent* done) {
+  *started = StartWorker(*config, net_log, index, *workers, handoff, worker);
+  done->Signal();
+}
+
+#if BUILDFLAG(IS_LINUX)
+// Pins the calling thread to `cpu`. Threads it starts later inherit the
+// affinity. Failures are logged and otherwise ignored.
+void PinCurrentThread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set)) {
+    PLOG(ERROR) << "Failed to pin thread to CPU " << cpu;
+  }
+}
+#endif
+
+// Returns the memory of the open connections of `worker` by their ids, and
+// adds it up in `total`. Run on the thread of `worker`.
+std::vector<std::pair<unsigned int, NaiveMemoryUsage>> GetConnectionMemory(
+    NaiveWorker* worker,
+    NaiveMemoryUsage* total) {
+  std::vector<std::pair<unsigned int, NaiveMemoryUsage>> usages;
+  for (const auto& proxy : worker->naive_proxies) {
+    std::vector<std::pair<unsigned int, NaiveMemoryUsage>> proxy_usages =
+        proxy->GetConnectionMemoryUsage();
+    usages.insert(usages.end(), proxy_usages.begin(), proxy_usages.end());
+  }
+  for (const auto& [id, usage] : usages) {
+    total->Add(usage);
+  }
+  worker->connection_memory_peak =
+      std::max(worker->connection_memory_peak, total->total());
+  return usages;
+}
+
+#if BUILDFLAG(IS_POSIX)
+// Logged per worker on SIGUSR2.
+constexpr size_t kTopMemoryConnections = 10;
+constexpr size_t kTopNegativeCacheEntries = 20;
+
+std::string FormatMemoryUsage(const NaiveMemoryUsage& usage) {
+  std::string out = base::NumberToString(usage.total()) + " bytes (";
+  for (int i = 0; i < NaiveMemoryUsage::kNumKinds; ++i) {
+    base::StrAppend(
+        &out, {i > 0 ? ", " : "",
+               NaiveMemoryUsage::GetKindName(
+                   static_cast<NaiveMemoryUsage::Kind>(i)),
+               " ", base::NumberToString(usage.bytes[i])});
+  }
+  out += ")";
+  return out;
+}
+
+// Logs the destinations the negative cache of the calling thread fails
+// connections to, most recently cached first.
+void LogWorkerNegativeCache(int index) {
+  std::vector<NaiveNegativeCache::Entry> entries =
+      NaiveNegativeCache::GetForCurrentThread()->GetEntries(
+          base::TimeTicks::Now());
+  if (entries.empty())
+    return;
+  LOG(INFO) << "Worker " << index << ": " << entries.size()
+            << " destinations in the negative cache";
+  size_t top = std::min(entries.size(), kTopNegativeCacheEntries);
+  for (size_t i = 0; i < top; ++i) {
+    LOG(INFO) << "Worker " << index << " negative cache "
+              << entries[i].destination.ToString() << ": "
+              << ErrorToShortString(entries[i].error) << " for "
+              << entries[i].remaining.InSeconds() << " s";
+  }
+}
+
+// Logs the memory of the connections of `worker` and those of them holding
+// the most, then its negative cache. Run on the thread of `worker`.
+void LogWorkerMemory(int index, NaiveWorker* worker) {
+  NaiveMemoryUsage total;
+  std::vector<std::pair<unsigned int, NaiveMemoryUsage>> usages =
+      GetConnectionMemory(worker, &total);
+  LOG(INFO) << "Worker " << index << ": " << usages.size()
+            << " connections hold " << FormatMemoryUsage(total) << ", peak "
+            << worker->connection_memory_peak << " bytes";
+  size_t top = std::min(usages.size(), kTopMemoryConnections);
+  std::partial_sort(usages.begin(), usages.begin() + top, usages.end(),
+                    [](const auto& a, const auto& b) {
+                      return a.second.total() > b.second.total();
+                    });
+  for (size_t i = 0; i < top; ++i) {
+    LOG(INFO) << "Worker " << index << " connection " << usages[i].first
+              << ": " << FormatMemoryUsage(usages[i].second);
+  }
+  LogWorkerNegativeCache(index);
+}
+
+// Logs the memory of the process, then that of the connections of every
+// worker on its thread. On SIGUSR2.
+void LogMemoryUsage(const std::vector<std::unique_ptr<NaiveWorker>>* workers) {
+  LOG(INFO) << "Relay buffers hold " << NaiveBufferPool::allocated_bytes()
+            << " bytes, peak " << NaiveBufferPool::peak_allocated_bytes()
+            << " bytes, malloc "
+            << base::ProcessMetrics::CreateCurrentProcessMetrics()
+                   ->GetMallocUsage()
+            << " bytes";
+  for (size_t i = 0; i < workers->size(); ++i) {
+    NaiveWorker* worker = (*workers)[i].get();
+    worker->task_runner->PostTask(
+        FROM_HERE, base::BindOnce(&LogWorkerMemory, static_cast<int>(i),
+                                  base::Unretained(worker)));
+  }
+}
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+// Returns the size of the ephemeral port range, or 0 if unknown.
+int GetEphemeralPortCount() {
+  std::string contents;
+  if (!base::ReadFileToString(
+          base::FilePath("/proc/sys/net/ipv4/ip_local_port_range"),
+          &contents)) {
+    return 0;
+  }
+  std::vector<std::string_view> parts = base::SplitStringPiece(
+      contents, " \t\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  int low;
+  int high;
+  if (parts.size() != 2 || !base::StringToInt(parts[0], &low) ||
+      !base::StringToInt(parts[1], &high) || high < low) {
+    return 0;
+  }
+  return high - low + 1;
+}
+#endif  // BUILDFLAG(IS_LINUX)
+
+// Run on the thread of `resolver`.
+void CollectResolverMetrics(const RedirectResolver* resolver,
+                            NaiveMetricsSnapshot* snapshot) {
+  snapshot->resolutions = resolver->resolution_count();
+  snapshot->resolution_overwrites = resolver->overwrite_count();
+  snapshot->resolution_drops = resolver->drop_count();
+}
+
+// Run on the thread of `worker`. Waits for a resolver thread.
+NaiveMetricsSnapshot CollectWorkerMetrics(int index, NaiveWorker* worker) {
+  NaiveMetricsSnapshot snapshot;
+  snapshot.worker = index;
+  snapshot.metrics = *NaiveMetrics::GetForCurrentThread();
+  snapshot.listeners.resize(worker->listen_proxies.size());
+  for (size_t i = 0; i < worker->listen_proxies.size(); ++i) {
+    NaiveProxy* proxy = worker->listen_proxies[i].get();
+    if (!proxy)
+      continue;
+    NaiveMetricsSnapshot::Listener& listener = snapshot.listeners[i];
+    listener.served = true;
+    listener.active_connections = proxy->connection_count();
+    listener.accepts = proxy->accept_count();
+    listener.pending_handshakes = proxy->handshake_count();
+    listener.rejects = proxy->reject_count();
+    listener.accept_paused = proxy->accept_paused();
+    listener.tunnel_session_connections = proxy->tunnel_connection_counts();
+    listener.padding = proxy->padding_stats();
+  }
+
+  NaiveBufferPool* buffer_pool = NaiveBufferPool::GetForCurrentThread();
+  snapshot.buffer_pool_hits = buffer_pool->hits();
+  snapshot.buffer_pool_misses = buffer_pool->misses();
+  snapshot.buffer_pool_free_count = buffer_pool->free_count();
+  snapshot.buffer_pool_free_bytes = buffer_pool->free_bytes();
+  snapshot.relay_queued = NaiveRelayScheduler::GetForCurrentThread()->queued();
+  NaiveLagMonitor* lag_monitor = NaiveLagMonitor::GetForCurrentThread();
+  if (lag_monitor->started()) {
+    snapshot.has_lag = true;
+    snapshot.loop_lag = lag_monitor->lag();
+    snapshot.loop_lag_peak = lag_monitor->TakePeakLag();
+    snapshot.overloaded = lag_monitor->overloaded();
+    snapshot.overloads = lag_monitor->overloads();
+    snapshot.overload_rejects = lag_monitor->rejects();
+  }
+  NaiveNegativeCache* negative_cache = NaiveNegativeCache::GetForCurrentThread();
+  snapshot.negative_cache_entries = negative_cache->size();
+  snapshot.negative_cache_hits = negative_cache->hits();
+  snapshot.negative_cache_insertions = negative_cache->insertions();
+  snapshot.heavy_hitters = NaiveHeavyHitters::GetForCurrentThread()->GetTop();
+
+  for (const auto& [id, usage] :
+       GetConnectionMemory(worker, &snapshot.connection_memory)) {
+    snapshot.connection_memory_max =
+        std::max(snapshot.connection_memory_max, usage.total());
+  }
+  snapshot.connection_memory_peak = worker->connection_memory_peak;
+  if (index == 0) {
+    snapshot.has_process_memory = true;
+    snapshot.relay_buffer_bytes = NaiveBufferPool::allocated_bytes();
+    snapshot.relay_buffer_peak_bytes = NaiveBufferPool::peak_allocated_bytes();
+    snapshot.malloc_bytes =
+        base::ProcessMetrics::CreateCurrentProcessMetrics()->GetMallocUsage();
+    snapshot.relay_reads =
+        NaiveShardedStats<NaiveRelayReadStats>::Aggregate();
+    snapshot.tcp_info = NaiveShardedStats<NaiveTcpInfoStats>::Aggregate();
+#if BUILDFLAG(IS_LINUX)
+    for (const TCPSocket::SourceAddressStats& stats :
+         TCPSocket::GetSourceAddressStats()) {
+      NaiveMetricsSnapshot::EgressSource& source =
+          snapshot.egress_sources.emplace_back();
+      source.address = stats.address.ToString();
+      source.open_sockets = stats.open_sockets;
+      source.exhausted = stats.exhausted;
+    }
+    if (!snapshot.egress_sources.empty()) {
+      snapshot.ephemeral_ports = GetEphemeralPortCount();
+    }
+#endif  // BUILDFLAG(IS_LINUX)
+  }
+
+  if (worker->context) {
+#if BUILDFLAG(IS_LINUX)
+    const TCPSocket::MultipathStats multipath_stats =
+        TCPSocket::GetMultipathStats();
+    snapshot.mptcp_connections = multipath_stats.connections;
+    snapshot.mptcp_fallbacks = multipath_stats.fallbacks;
+    snapshot.mptcp_subflows = multipath_stats.subflows;
+#endif  // BUILDFLAG(IS_LINUX)
+    HttpNetworkSession* session =
+        worker->context->http_transaction_factory()->GetSession();
+    const SpdyHeaderEncoderStats& header_stats =
+        session->spdy_session_pool()->header_encoder_stats();
+    snapshot.h2_header_frames = header_stats.frames;
+    snapshot.h2_header_uncompressed_bytes = header_stats.uncompressed_bytes;
+    snapshot.h2_header_bytes = header_stats.compressed_bytes;
+
+    if (worker->quic_port_hop_timer.IsRunning()) {
+      const QuicSessionPool::PortHopStats& hop_stats =
+          session->quic_session_pool()->port_hop_stats();
+      snapshot.has_quic_port_hops = true;
+      snapshot.quic_port_hops = hop_stats.hops;
+      snapshot.quic_port_hop_failures = hop_stats.failures;
+      snapshot.quic_path_bytes = hop_stats.path_bytes;
+      snapshot.quic_path_time = hop_stats.path_time;
+    }
+
+    // The smallest of the sessions to each proxy.
+    for (const auto& [server, length] :
+         session->quic_session_pool()->GetMaxPacketLengths()) {
+      auto [it, inserted] = snapshot.quic_max_packet_lengths.emplace(
+          server.ToString(), length);
+      if (!inserted) {
+        it->second = std::min<size_t>(it->second, length);
+      }
+    }
+  }
+
+  if (worker->network_adapter) {
+    const NaiveNetworkQuality* quality =
+        NaiveNetworkQuality::GetForCurrentThread();
+    snapshot.has_network_quality = true;
+    snapshot.http_rtt = quality->http_rtt;
+    snapshot.transport_rtt = quality->transport_rtt;
+    snapshot.downstream_kbps = quality->downstream_kbps;
+    snapshot.effective_connection_type =
+        GetNameForEffectiveConnectionType(quality->effective_connection_type);
+  }
+
+  if (worker->resolver) {
+    snapshot.has_resolver = true;
+    RunOnResolverThread(worker,
+                        base::BindOnce(&CollectResolverMetrics,
+                                       base::Unretained(worker->resolver.get()),
+                                       base::Unretained(&snapshot)));
+  }
+  return snapshot;
+}
+
+// The members starting the admin listing lines of listener `listener` of
+// worker `index`, the listener indexing `NaiveWorker::naive_proxies`.
+std::string GetAdminListingFields(int index, size_t listener) {
+  return base::StringPrintf("\"worker\":%d,\"listener\":%zu,", index,
+                            listener);
+}
+
+// Run on the thread of `worker`.
+std::string ListWorkerConnections(int index, NaiveWorker* worker) {
+  std::string out;
+  for (size_t i = 0; i < worker->naive_proxies.size(); ++i) {
+    worker->naive_proxies[i]->AppendConnectionListing(
+        GetAdminListingFields(index, i), &out);
+  }
+  return out;
+}
+
+// Run on the thread of `worker`. The HTTP/2 and QUIC sessions are shared
+// by the listeners of the worker, and name the tunnel session they belong
+// to by its key.
+std::string ListWorkerSessions(int index, NaiveWorker* worker) {
+  std::string out;
+  for (size_t i = 0; i < worker->naive_proxies.size(); ++i) {
+    worker->naive_proxies[i]->AppendTunnelSessionListing(
+        GetAdminListingFields(index, i), &out);
+  }
+  if (!worker->context)
+    return out;
+  HttpNetworkSession* session =
+      worker->context->http_transaction_factory()->GetSession();
+  auto append = [&out, index](const char* type, base::Value& list) {
+    for (base::Value& value : list.GetList()) {
+      base::Value::Dict* dict = value.GetIfDict();
+      if (!dict)
+        continue;
+      dict->Set("worker", index);
+      dict->Set("type", type);
+      base::JSONWriter::Write(*dict, &out);
+      out += '\n';
+    }
+  };
+  append("h2", *session->spdy_session_pool()->SpdySessionPoolInfoToValue());
+  base::Value quic_sessions =
+      session->quic_session_pool()->QuicSessionPoolInfoToValue();
+  append("quic", quic_sessions);
+  return out;
+}
+
+// Run on the thread of worker `index`. The estimates are of the thread, not
+// of a listener.
+std::string ListWorkerDestinations(int index) {
+  std::string out;
+  for (const NaiveHeavyHitters::Entry& entry :
+       NaiveHeavyHitters::GetForCurrentThread()->GetTop()) {
+    base::StringAppendF(&out, "{\"worker\":%d,\"destination\":", index);
+    base::EscapeJSONString(entry.destination.ToString(),
+                           /*put_in_quotes=*/true, &out);
+    base::StringAppendF(&out, ",\"connects\":%u,\"bytes\":%" PRIu64 "}\n",
+                        entry.connects, entry.bytes);
+  }
+  return out;
+}
+
+// Run on the thread of `worker`.
+bool CloseWorkerConnection(NaiveWorker* worker,
+                           size_t listener,
+                           unsigned int id) {
+  if (listener >= worker->naive_proxies.size())
+    return false;
+  return worker->naive_proxies[listener]->CloseConnection(id);
+}
+
+// Labels the listeners in metrics.
+std::vector<std::string> GetListenerNames(const NaiveConfig& config) {
+  std::vector<std::string> listener_names;
+  for (const NaiveListenConfig& listen_config : config.listen) {
+    if (listen_config.protocol == ClientProtocol::kEmbedded) {
+      listener_names.push_back("embed://");
+      continue;
+    }
+    if (listen_config.protocol == ClientProtocol::kTun) {
+      listener_names.push_back("tun://" + listen_config.device);
+      continue;
+    }
+    if (!listen_config.unix_path.empty()) {
+      listener_names.push_back(base::StrCat({ToString(listen_config.protocol),
+                                             "+unix://",
+                                             listen_config.unix_path}));
+      continue;
+    }
+    listener_names.push_back(
+        base::StrCat({ToString(listen_config.protocol), "://",
+                      HostPortPair(listen_config.addr, listen_config.port)
+                          .ToString()}));
+  }
+  return listener_names;
+}
+
+std::unique_ptr<NaiveMetricsServer> StartMetricsServer(
+    const NaiveConfig& config,
+    NetLog* net_log,
+    const std::vector<std::unique_ptr<NaiveWorker>>& workers,
+    scoped_refptr<NaiveUserTable> user_table) {
+  auto listen_socket =
+      std::make_unique<TCPServerSocket>(net_log, NetLogSource());
+  int result = listen_socket->ListenWithAddressAndPort(
+      config.metrics_addr, config.metrics_port, kListenBackLog);
+  if (result != OK) {
+    LOG(ERROR) << "Failed to listen on metrics " << config.metrics_addr << " "
+               << config.metrics_port << ": " << ErrorToShortString(result);
+    return nullptr;
+  }
+  LOG(INFO) << "Serving metrics on http://"
+            << HostPortPair(config.metrics_addr, config.metrics_port).ToString()
+            << "/metrics";
+  if (config.metrics_admin) {
+    LOG(INFO) << "Serving the admin on http://"
+              << HostPortPair(config.metrics_addr, config.metrics_port)
+                     .ToString()
+              << "/admin/";
+  }
+
+  std::vector<NaiveMetricsServer::Source> sources;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    NaiveMetricsServer::Source& source = sources.emplace_back(
+        workers[i]->task_runner,
+        base::BindRepeating(&CollectWorkerMetrics, static_cast<int>(i),
+                            workers[i].get()));
+    if (config.metrics_admin) {
+      source.list_connections = base::BindRepeating(
+          &ListWorkerConnections, static_cast<int>(i), workers[i].get());
+      source.list_sessions = base::BindRepeating(
+          &ListWorkerSessions, static_cast<int>(i), workers[i].get());
+      source.list_destinations =
+          base::BindRepeating(&ListWorkerDestinations, static_cast<int>(i));
+      source.close_connection =
+          base::BindRepeating(&CloseWorkerConnection, workers[i].get());
+    }
+  }
+  return std::make_unique<NaiveMetricsServer>(
+      std::move(listen_socket), GetListenerNames(config), std::move(sources),
+      std::move(user_table));
+}
+
+// Returns the config in `config_file`, or nullopt after printing the error.
+std::optional<base::Value::Dict> ReadConfigFile(
+    const base::FilePath& config_file) {
+  JSONFileValueDeserializer reader(config_file);
+  int error_code;
+  std::string error_message;
+  std::unique_ptr<base::Value> value =
+      reader.Deserialize(&error_code, &error_message);
+  if (value == nullptr) {
+    std::cerr << "Error reading " << config_file << ": (" << error_code << ") "
+              << error_message << std::endl;
+    return std::nullopt;
+  }
+  if (base::Value::Dict* dict = value->GetIfDict()) {
+    return std::move(*dict);
+  }
+  return base::Value::Dict();
+}
+
+#if BUILDFLAG(IS_POSIX)
+// The keys a reload applies, see NaiveConfigReloader.
+constexpr std::string_view kReloadableKeys[] = {
+    "listen", "proxy", "extra-headers", "host-resolver-rules"};
+
+// What a reload changes, see NaiveConfigReloader.
+struct NaiveReload {
+  // The running config with the reloaded settings.
+  NaiveConfig config;
+  // Indexed like `config.listen`, the index of the same listener in the
+  // running config, or -1 for a new one.
+  std::vector<int> old_index;
+  bool host_resolver_rules_changed = false;
+};
+
+// Applies `reload` on the thread of `worker`. New listeners are opened
+// before removed ones stop accepting, so on Linux a changed listener
+// refuses no connections as both share the port through SO_REUSEPORT.
+void ReloadWorker(const NaiveReload* reload,
+                  NetLog* net_log,
+                  int index,
+                  const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                  NaiveHandoff* handoff,
+                  NaiveWorker* worker) {
+  const NaiveConfig& config = reload->config;
+  bool is_main = index == 0;
+  if (worker->context) {
+    // For the tunnels opened from now on. Tunnels already open keep their
+    // headers and credentials, and sessions their resolved addresses.
+    static_cast<NaiveProxyDelegate*>(worker->context->proxy_delegate())
+        ->SetExtraHeaders(config.extra_headers);
+    SetProxyCredentials(
+        config, worker->context->http_transaction_factory()->GetSession());
+    if (reload->host_resolver_rules_changed) {
+      worker->host_mapper->SetRulesFromString(config.host_resolver_rules);
+      if (HostCache* host_cache =
+              worker->context->host_resolver()->GetHostCache()) {
+        host_cache->clear();
+      }
+    }
+  }
+
+  // Proxies stopped by the last reload, whose forwarders are gone by now.
+  std::erase_if(worker->naive_proxies,
+                [](const std::unique_ptr<NaiveProxy>& naive_proxy) {
+                  return !naive_proxy->is_accepting() &&
+                         naive_proxy->connection_count() == 0;
+                });
+
+  std::vector<base::WeakPtr<NaiveProxy>> old_listen_proxies =
+      std::exchange(worker->listen_proxies, {});
+  worker->listen_proxies.resize(config.listen.size());
+#if BUILDFLAG(IS_LINUX)
+  std::vector<std::unique_ptr<NaiveAcceptForwarder>> old_forwarders =
+      std::exchange(worker->forwarders, {});
+  worker->forwarders.resize(config.listen.size());
+  std::vector<int> old_listen_fds = std::exchange(worker->listen_fds, {});
+  worker->listen_fds.assign(config.listen.size(), -1);
+#endif
+  std::vector<bool> kept(old_listen_proxies.size());
+  for (size_t i = 0; i < config.listen.size(); ++i) {
+    int j = reload->old_index[i];
+    if (j >= 0) {
+      kept[j] = true;
+      worker->listen_proxies[i] = old_listen_proxies[j];
+#if BUILDFLAG(IS_LINUX)
+      worker->forwarders[i] = std::move(old_forwarders[j]);
+      worker->listen_fds[i] = old_listen_fds[j];
+#endif
+      continue;
+    }
+    // Redir, embed, tun and Unix domain socket listeners are never added,
+    // see NaiveConfigReloader::Reload().
+    const NaiveListenConfig& listen_config = config.listen[i];
+    DCHECK(listen_config.protocol != ClientProtocol::kRedir);
+    DCHECK(listen_config.protocol != ClientProtocol::kEmbedded);
+    DCHECK(listen_config.protocol != ClientProtocol::kTun);
+    DCHECK(listen_config.unix_path.empty());
+#if BUILDFLAG(IS_LINUX)
+    if (listen_config.protocol == ClientProtocol::kQuic) {
+      if (!worker->context) {
+        continue;
+      }
+      if (auto quic_server =
+              ListenQuic(listen_config, AcceptsBonds(config),
+                         worker->ticket_keys, net_log, is_main)) {
+        AddNaiveProxy(config, i, std::move(quic_server), worker);
+      }
+      continue;
+    }
+#endif
+    int offered_fd;
+    auto listen_socket = Listen(listen_config, net_log, is_main, handoff,
+                                worker->numa_steering, &offered_fd);
+    if (!listen_socket) {
+      continue;
+    }
+#if BUILDFLAG(IS_LINUX)
+    worker->listen_fds[i] = offered_fd;
+    if (!worker->context) {
+      AddForwarder(config, i, std::move(listen_socket), *workers, worker);
+      continue;
+    }
+#endif
+    AddNaiveProxy(config, i, std::move(listen_socket), worker);
+  }
+
+  for (size_t j = 0; j < kept.size(); ++j) {
+    if (kept[j]) {
+      continue;
+    }
+#if BUILDFLAG(IS_LINUX)
+    // Before the socket is closed.
+    if (handoff && old_listen_fds[j] >= 0) {
+      handoff->RemoveSocket(old_listen_fds[j]);
+    }
+    old_forwarders[j].reset();
+#endif
+    if (NaiveProxy* naive_proxy = old_listen_proxies[j].get()) {
+      naive_proxy->StopAccepting();
+    }
+  }
 }
-}  // namespace
 
-namespace net {
-namespace {
-// NetLog::ThreadSafeObserver implementation that simply prints events
-// to the logs.
-class PrintingLogObserver : public NetLog::ThreadSafeObserver {
+// Reloads the config file on SIGHUP. New listeners, proxy credentials,
+// extra headers and host resolver rules apply to new connections, one
+// worker at a time. Open connections are left alone, including those of
+// removed listeners. Other changes need a restart. POSIX only.
+class NaiveConfigReloader {
  public:
-  PrintingLogObserver() = default;
-  PrintingLogObserver(const PrintingLogObserver&) = delete;
-  PrintingLogObserver& operator=(const PrintingLogObserver&) = delete;
+  // `config` and `config_dict` are the running config.
+  NaiveConfigReloader(const base::FilePath& config_file,
+                      base::Value::Dict config_dict,
+                      NaiveConfig* config,
+                      NetLog* net_log,
+                      const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                      NaiveHandoff* handoff,
+                      std::unique_ptr<NaiveMetricsServer>* metrics_server)
+      : config_file_(config_file),
+        config_dict_(std::move(config_dict)),
+        config_(config),
+        net_log_(net_log),
+        workers_(workers),
+        handoff_(handoff),
+        metrics_server_(metrics_server) {}
+  NaiveConfigReloader(const NaiveConfigReloader&) = delete;
+  NaiveConfigReloader& operator=(const NaiveConfigReloader&) = delete;
 
-  ~PrintingLogObserver() override {
-    // This is guaranteed to be safe as this program is single threaded.
-    net_log()->RemoveObserver(this);
+  bool WatchSignal() {
+    // Unretained is safe because the watcher is owned by `this`.
+    signal_watcher_ = std::make_unique<NaiveSignalWatcher>(
+        SIGHUP, base::BindRepeating(&NaiveConfigReloader::Reload,
+                                    base::Unretained(this)));
+    return signal_watcher_->Start();
   }
 
-  // NetLog::ThreadSafeObserver implementation:
-  void OnAddEntry(const NetLogEntry& entry) override {
-    switch (entry.type) {
-      case NetLogEventType::SOCKET_POOL_STALLED_MAX_SOCKETS:
-      case NetLogEventType::SOCKET_POOL_STALLED_MAX_SOCKETS_PER_GROUP:
-      case NetLogEventType::HTTP2_SESSION_STREAM_STALLED_BY_SESSION_SEND_WINDOW:
-      case NetLogEventType::HTTP2_SESSION_STREAM_STALLED_BY_STREAM_SEND_WINDOW:
-      case NetLogEventType::HTTP2_SESSION_STALLED_MAX_STREAMS:
-      case NetLogEventType::HTTP2_STREAM_FLOW_CONTROL_UNSTALLED:
-        break;
-      default:
-        return;
+  // Ignores SIGHUP from now on.
+  void Stop() { signal_watcher_.reset(); }
+
+ private:
+  void Reload() {
+    if (reload_) {
+      LOG(WARNING) << "Ignoring SIGHUP during a reload";
+      return;
+    }
+    LOG(INFO) << "Reloading " << config_file_;
+    std::optional<base::Value::Dict> config_dict =
+        ReadConfigFile(config_file_);
+    NaiveConfig new_config;
+    if (!config_dict || !new_config.Parse(*config_dict)) {
+      LOG(ERROR) << "Failed to reload " << config_file_;
+      return;
     }
-    const char* source_type = NetLog::SourceTypeToString(entry.source.type);
-    const char* event_type = NetLogEventTypeToString(entry.type);
-    const char* event_phase = NetLog::EventPhaseToString(entry.phase);
-    base::Value params(entry.ToDict());
-    std::string params_str;
-    base::JSONWriter::Write(params, &params_str);
-    params_str.insert(0, ": ");
 
-    VLOG(1) << source_type << "(" << entry.source.id << "): " << event_type
-            << ": " << event_phase << params_str;
+    // Sorted for the log.
+    std::set<std::string> ignored;
+    for (auto [key, value] : *config_dict) {
+      const base::Value* old_value = config_dict_.Find(key);
+      if (!base::Contains(kReloadableKeys, key) &&
+          (!old_value || *old_value != value)) {
+        ignored.insert(key);
+      }
+    }
+    for (auto [key, value] : config_dict_) {
+      if (!base::Contains(kReloadableKeys, key) &&
+          !config_dict->contains(key)) {
+        ignored.insert(key);
+      }
+    }
+
+    auto reload = std::make_unique<NaiveReload>();
+    reload->config = *config_;
+    NaiveConfig& config = reload->config;
+    config.extra_headers = new_config.extra_headers;
+    reload->host_resolver_rules_changed =
+        new_config.host_resolver_rules != config.host_resolver_rules;
+    config.host_resolver_rules = new_config.host_resolver_rules;
+    // Only the credentials of the same proxies, see
+    // BuildURLRequestContext().
+    bool same_proxies = new_config.proxies.size() == config.proxies.size();
+    for (size_t i = 0; same_proxies && i < config.proxies.size(); ++i) {
+      same_proxies = new_config.proxies[i].url == config.proxies[i].url;
+    }
+    if (same_proxies) {
+      config.proxies = new_config.proxies;
+    } else {
+      ignored.insert("proxy");
+    }
+    // Redirected connections need the resolver set up at startup,
+    // embedded ones the listener NaiveEmbedding started with, those of a
+    // TUN device its NaiveTunStack, and those of a Unix domain socket the
+    // socket file bound by the main worker at startup.
+    auto is_fixed = [](const NaiveListenConfig& listen_config) {
+      return listen_config.protocol == ClientProtocol::kRedir ||
+             listen_config.protocol == ClientProtocol::kEmbedded ||
+             listen_config.protocol == ClientProtocol::kTun ||
+             !listen_config.unix_path.empty();
+    };
+    std::vector<NaiveListenConfig> old_fixed, new_fixed;
+    base::ranges::copy_if(config.listen, std::back_inserter(old_fixed),
+                          is_fixed);
+    base::ranges::copy_if(new_config.listen, std::back_inserter(new_fixed),
+                          is_fixed);
+    if (old_fixed == new_fixed) {
+      config.listen = new_config.listen;
+    } else {
+      ignored.insert("listen");
+    }
+    std::vector<bool> taken(config_->listen.size());
+    for (const NaiveListenConfig& listen_config : config.listen) {
+      int old_index = -1;
+      for (size_t j = 0; j < config_->listen.size(); ++j) {
+        if (!taken[j] && config_->listen[j] == listen_config) {
+          taken[j] = true;
+          old_index = static_cast<int>(j);
+          break;
+        }
+      }
+      reload->old_index.push_back(old_index);
+    }
+
+    // Compares the next reload with what runs.
+    for (const std::string& key : ignored) {
+      if (const base::Value* old_value = config_dict_.Find(key)) {
+        config_dict->Set(key, old_value->Clone());
+      } else {
+        config_dict->Remove(key);
+      }
+    }
+    config_dict_ = std::move(*config_dict);
+    if (!ignored.empty()) {
+      LOG(WARNING) << "Restart to apply "
+                   << base::JoinString(std::vector<std::string>(
+                                           ignored.begin(), ignored.end()),
+                                       ", ");
+    }
+
+    reload_ = std::move(reload);
+    ReloadNextWorker(0);
   }
-};
-}  // namespace
 
-namespace {
-std::unique_ptr<URLRequestContext> BuildCertURLRequestContext(NetLog* net_log) {
-  URLRequestContextBuilder builder;
+  // Upstream workers go first, so forwarding workers find their new
+  // listeners.
+  void ReloadNextWorker(size_t index) {
+    if (index == workers_->size()) {
+      *config_ = std::move(reload_->config);
+      reload_.reset();
+      if (*metrics_server_) {
+        (*metrics_server_)->set_listener_names(GetListenerNames(*config_));
+      }
+      LOG(INFO) << "Reloaded " << config_file_;
+      return;
+    }
+    NaiveWorker* worker = (*workers_)[index].get();
+    worker->task_runner->PostTaskAndReply(
+        FROM_HERE,
+        base::BindOnce(&ReloadWorker, reload_.get(), net_log_,
+                       static_cast<int>(index), workers_, handoff_, worker),
+        base::BindOnce(&NaiveConfigReloader::ReloadNextWorker,
+                       weak_ptr_factory_.GetWeakPtr(), index + 1));
+  }
 
-  builder.DisableHttpCache();
-  builder.set_net_log(net_log);
+  const base::FilePath config_file_;
+  base::Value::Dict config_dict_;
+  NaiveConfig* const config_;
+  NetLog* const net_log_;
+  const std::vector<std::unique_ptr<NaiveWorker>>* const workers_;
+  NaiveHandoff* const handoff_;
+  std::unique_ptr<NaiveMetricsServer>* const metrics_server_;
 
-  ProxyConfig proxy_config;
-  auto proxy_service =
-      ConfiguredProxyResolutionService::CreateWithoutProxyResolver(
-          std::make_unique<ProxyConfigServiceFixed>(
-              ProxyConfigWithAnnotation(proxy_config, kTrafficAnnotation)),
-          net_log);
-  proxy_service->ForceReloadProxyConfig();
-  builder.set_proxy_resolution_service(std::move(proxy_service));
+  std::unique_ptr<NaiveSignalWatcher> signal_watcher_;
+  // Set while the workers apply it.
+  std::unique_ptr<NaiveReload> reload_;
 
-  return builder.Build();
-}
+  base::WeakPtrFactory<NaiveConfigReloader> weak_ptr_factory_{this};
+};
+#endif
 
-// Builds a URLRequestContext assuming there's only a single loop.
-std::unique_ptr<URLRequestContext> BuildURLRequestContext(
-    const NaiveConfig& config,
-    scoped_refptr<CertNetFetcherURLRequest> cert_net_fetcher,
-    NetLog* net_log) {
-  URLRequestContextBuilder builder;
+#if BUILDFLAG(IS_LINUX)
+// Run on the thread of `worker`.
+void StopWorkerAccepting(NaiveWorker* worker) {
+  for (auto& forwarder : worker->forwarders) {
+    forwarder.reset();
+  }
+  for (const auto& naive_proxy : worker->naive_proxies) {
+    naive_proxy->StopAccepting();
+  }
+}
 
-  builder.DisableHttpCache();
-  builder.set_net_log(net_log);
+// Run on the thread of `worker`.
+size_t CountWorkerConnections(NaiveWorker* worker) {
+  size_t count = 0;
+  for (const auto& naive_proxy : worker->naive_proxies) {
+    count += naive_proxy->connection_count();
+  }
+  return count;
+}
 
-  std::string proxy_url = config.proxy_url;
-  bool force_quic = false;
-  if (proxy_url.compare(0, 7, "quic://") == 0) {
-    proxy_url.replace(0, 4, "https");
-    force_quic = true;
+void OnConnectionsCounted(base::RepeatingClosure quit,
+                          std::vector<size_t> counts) {
+  for (size_t count : counts) {
+    if (count > 0)
+      return;
   }
+  LOG(INFO) << "All connections closed after handoff";
+  quit.Run();
+}
 
-  ProxyConfig proxy_config;
-  proxy_config.proxy_rules().ParseFromString(proxy_url);
-  if (force_quic) {
-    const ProxyServer& proxy_server =
-        proxy_config.proxy_rules().single_proxies.First().First();
-    proxy_config.proxy_rules().single_proxies.SetSingleProxyChain(
-        ProxyChain::ForIpProtection({ProxyServer(
-            ProxyServer::Scheme::SCHEME_QUIC, proxy_server.host_port_pair())}));
-  }
-  LOG(INFO) << "Proxying via "
-            << proxy_config.proxy_rules().single_proxies.ToDebugString();
-  auto proxy_service =
-      ConfiguredProxyResolutionService::CreateWithoutProxyResolver(
-          std::make_unique<ProxyConfigServiceFixed>(
-              ProxyConfigWithAnnotation(proxy_config, kTrafficAnnotation)),
-          net_log);
-  proxy_service->ForceReloadProxyConfig();
-  builder.set_proxy_resolution_service(std::move(proxy_service));
+void CheckDrained(const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                  base::TimeTicks deadline,
+                  base::RepeatingClosure quit) {
+  if (base::TimeTicks::Now() >= deadline) {
+    LOG(INFO) << "Closing the connections left after handoff";
+    quit.Run();
+    return;
+  }
+  auto barrier = base::BarrierCallback<size_t>(
+      workers->size(), base::BindOnce(&OnConnectionsCounted, quit));
+  for (const auto& worker : *workers) {
+    worker->task_runner->PostTaskAndReplyWithResult(
+        FROM_HERE, base::BindOnce(&CountWorkerConnections, worker.get()),
+        barrier);
+  }
+}
 
-  if (!config.host_resolver_rules.empty()) {
-    builder.set_host_mapping_rules(config.host_resolver_rules);
+// Run on the thread of `workers[to]`.
+void AdoptWorkerRelay(const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                      size_t to,
+                      size_t listener,
+                      NaiveDetachedRelay relay) {
+  NaiveWorker* worker = (*workers)[to].get();
+  if (listener < worker->listen_proxies.size()) {
+    if (NaiveProxy* naive_proxy = worker->listen_proxies[listener].get()) {
+      naive_proxy->AdoptRelay(std::move(relay));
+      return;
+    }
   }
+  LOG(WARNING) << "Dropping relay of removed listener " << listener;
+}
 
-  builder.SetCertVerifier(
-      CertVerifier::CreateDefault(std::move(cert_net_fetcher)));
+// Run on the thread of `workers[from]`, for NaiveRebalancer.
+void MoveWorkerRelay(const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                     size_t from,
+                     size_t to) {
+  NaiveWorker* worker = (*workers)[from].get();
+  for (size_t i = 0; i < worker->listen_proxies.size(); ++i) {
+    NaiveProxy* naive_proxy = worker->listen_proxies[i].get();
+    if (!naive_proxy)
+      continue;
+    std::optional<NaiveDetachedRelay> relay =
+        naive_proxy->DetachBusiestRelay(NaiveRebalancer::kMinRelayAge);
+    if (relay) {
+      (*workers)[to]->task_runner->PostTask(
+          FROM_HERE, base::BindOnce(&AdoptWorkerRelay, workers, to, i,
+                                    std::move(*relay)));
+      return;
+    }
+  }
+}
 
-  builder.set_proxy_delegate(std::make_unique<NaiveProxyDelegate>(
-      config.extra_headers,
-      std::vector<PaddingType>{PaddingType::kVariant1, PaddingType::kNone}));
+// Run on the thread of a worker, for NaiveRebalancer.
+uint64_t SumBytesRelayed() {
+  const NaiveMetrics* metrics = NaiveMetrics::GetForCurrentThread();
+  return metrics->bytes_relayed[kClient] + metrics->bytes_relayed[kServer];
+}
 
-  if (config.no_post_quantum == true) {
-    struct NoPostQuantum : public SSLConfigService {
-      SSLContextConfig GetSSLContextConfig() override {
-        SSLContextConfig config;
-        config.post_quantum_override = false;
-        return config;
-      }
+// Saves the cache of the resolver of the main worker `worker` before its
+// socket is sent.
+void PauseResolverForHandoff(NaiveWorker* worker) {
+  RunOnResolverThread(
+      worker, base::BindOnce(&RedirectResolver::PauseForHandoff,
+                             base::Unretained(worker->resolver.get())));
+  // The successor loads the file as soon as it has the socket.
+  base::WaitableEvent saved;
+  worker->resolver->FlushCache(base::BindOnce(&base::WaitableEvent::Signal,
+                                              base::Unretained(&saved)));
+  saved.Wait();
+}
 
-      bool CanShareConnectionWithClientCerts(std::string_view) const override {
-        return false;
-      }
-    };
-    builder.set_ssl_config_service(std::make_unique<NoPostQuantum>());
+// Once the successor serves the sockets, stops accepting on every worker
+// and quits after the open connections close or `drain` passes.
+void OnHandoffDone(const std::vector<std::unique_ptr<NaiveWorker>>* workers,
+                   std::unique_ptr<NaiveMetricsServer>* metrics_server,
+                   NaiveConfigReloader* reloader,
+                   base::RepeatingTimer* drain_timer,
+                   base::TimeDelta drain,
+                   base::RepeatingClosure quit,
+                   bool handed_off) {
+  if (RedirectResolver* resolver = (*workers)[0]->resolver.get()) {
+    RunOnResolverThread(
+        (*workers)[0].get(),
+        base::BindOnce(&RedirectResolver::ResumeAfterHandoff,
+                       base::Unretained(resolver), handed_off));
+  }
+  if (!handed_off)
+    return;
+  LOG(INFO) << "Handed over, draining connections";
+  metrics_server->reset();
+  // The listeners belong to the successor now.
+  if (reloader) {
+    reloader->Stop();
   }
+  for (const auto& worker : *workers) {
+    worker->task_runner->PostTask(
+        FROM_HERE, base::BindOnce(&StopWorkerAccepting, worker.get()));
+  }
+  drain_timer->Start(FROM_HERE, kDrainCheckInterval,
+                     base::BindRepeating(&CheckDrained, workers,
+                                         base::TimeTicks::Now() + drain,
+                                         std::move(quit)));
+}
+#endif
 
-  auto context = builder.Build();
+// Applies the startup part of NaiveConfig::low_memory and logs the memory
+// budget it leaves the relay.
+// Sets the limits of the normal socket pool overall, per proxy chain and per
+// group, in an order ClientSocketPoolManager accepts as the group limit may
+// exceed neither of the others at any time.
+void SetSocketPoolLimits(int max_sockets, int max_sockets_per_group) {
+  constexpr auto kPool = HttpNetworkSession::NORMAL_SOCKET_POOL;
+  ClientSocketPoolManager::set_max_sockets_per_group(
+      kPool, std::min(max_sockets_per_group,
+                      ClientSocketPoolManager::max_sockets_per_group(kPool)));
+  ClientSocketPoolManager::set_max_sockets_per_pool(kPool, max_sockets);
+  ClientSocketPoolManager::set_max_sockets_per_proxy_chain(kPool, max_sockets);
+  ClientSocketPoolManager::set_max_sockets_per_group(kPool,
+                                                     max_sockets_per_group);
+}
 
-  if (!config.proxy_url.empty() && !config.proxy_user.empty() &&
-      !config.proxy_pass.empty()) {
-    auto* session = context->http_transaction_factory()->GetSession();
-    auto* auth_cache = session->http_auth_cache();
-    GURL proxy_gurl(proxy_url);
-    if (force_quic) {
-      auto* quic = context->quic_context()->params();
-      quic->supported_versions = {quic::ParsedQuicVersion::RFCv1()};
-      quic->origins_to_force_quic_on.insert(
-          net::HostPortPair::FromURL(proxy_gurl));
+void ApplyLowMemoryProfile(const NaiveConfig& config) {
+  int memory_mb = base::SysInfo::AmountOfPhysicalMemoryMB();
+  int max_sockets = std::clamp(memory_mb * kLowMemorySocketsPerMB,
+                               kLowMemoryMinSockets,
+                               kDefaultMaxSocketsPerPool * kExpectedMaxUsers);
+  SetSocketPoolLimits(
+      max_sockets,
+      max_sockets * kDefaultMaxSocketsPerGroup / kDefaultMaxSocketsPerPool);
+  NaiveBufferPool::SetMaxFreeBytes(kLowMemoryMaxFreeBytes);
+#if PA_CONFIG(THREAD_CACHE_SUPPORTED) && \
+    PA_BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+  // As Chrome does on low-end Android devices.
+  partition_alloc::ThreadCacheRegistry::Instance().SetThreadCacheMultiplier(
+      partition_alloc::ThreadCache::kDefaultMultiplier / 2);
+#endif
+
+  // Both directions of every pooled socket reading full buffers at once.
+  int64_t relay_budget_mb = int64_t{max_sockets} * 2 *
+                            config.relay.buffer_max_size / (1024 * 1024);
+  LOG(INFO) << "Low-memory profile for " << memory_mb << " MB: "
+            << max_sockets << " sockets, relay buffers "
+            << config.relay.buffer_min_size / 1024 << "-"
+            << config.relay.buffer_max_size / 1024 << " KB per direction, "
+            << relay_budget_mb << " MB at most, "
+            << kLowMemoryMaxFreeBytes / 1024 << " KB kept idle per thread, "
+            << "HTTP/2 windows "
+            << config.h2_session_window / 1024 << " KB per session and "
+            << config.h2_stream_window / 1024 << " KB per tunnel";
+}
+
+// Loads the trust store of the main worker once it listens, ahead of its
+// first verification. The other workers only load theirs on a miss in the
+// shared cache, see NaiveCertVerifier.
+void WarmCertVerifier(NaiveWorker* worker) {
+  static_cast<NaiveCertVerifier*>(worker->context->cert_verifier())->Warm();
+}
+
+// Destroys the workers of `threads` on their own threads, then joins them.
+// `workers[0]` belongs to the main thread and is left alone.
+void StopWorkers(std::vector<std::unique_ptr<NaiveWorker>>& workers,
+                 std::vector<std::unique_ptr<base::Thread>>& threads) {
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (i + 1 < workers.size()) {
+      threads[i]->task_runner()->DeleteSoon(FROM_HERE,
+                                            std::move(workers[i + 1]));
     }
-    url::SchemeHostPort auth_origin(proxy_gurl);
-    AuthCredentials credentials(config.proxy_user, config.proxy_pass);
-    auth_cache->Add(auth_origin, HttpAuth::AUTH_PROXY,
-                    /*realm=*/{}, HttpAuth::AUTH_SCHEME_BASIC, {},
-                    /*challenge=*/"Basic", credentials, /*path=*/"/");
+    threads[i]->Stop();
   }
+  threads.clear();
+}
 
-  return context;
+// For --bench, which needs no session store or estimator.
+std::unique_ptr<URLRequestContext> BuildBenchContext(
+    scoped_refptr<CertNetFetcher> cert_net_fetcher,
+    NetLog* net_log,
+    const NaiveConfig& config) {
+  MappedHostResolver* host_mapper = nullptr;
+  return BuildURLRequestContext(config, std::move(cert_net_fetcher), net_log,
+                                nullptr, nullptr, &host_mapper);
 }
 }  // namespace
 }  // namespace net
 
-int main(int argc, char* argv[]) {
-  // chrome/app/chrome_exe_main_mac.cc: main()
-#if BUILDFLAG(IS_APPLE)
-  partition_alloc::EarlyMallocZoneRegistration();
-#endif
+namespace net {
 
+int NaiveMain(int argc, char* argv[], NaiveEmbedding* embedding) {
   // content/app/content_main.cc: RunContentProcess()
 #if BUILDFLAG(IS_APPLE)
   base::apple::ScopedNSAutoreleasePool pool;
@@ -318,6 +2401,8 @@ int main(int argc, char* argv[]) {
   url::AddStandardScheme("socks",
                          url::SCHEME_WITH_HOST_PORT_AND_USER_INFORMATION);
   url::AddStandardScheme("redir", url::SCHEME_WITH_HOST_AND_PORT);
+  url::AddStandardScheme("embed", url::SCHEME_WITH_HOST_AND_PORT);
+  url::AddStandardScheme("tun", url::SCHEME_WITH_HOST);
   net::ClientSocketPoolManager::set_max_sockets_per_pool(
       net::HttpNetworkSession::NORMAL_SOCKET_POOL,
       kDefaultMaxSocketsPerPool * kExpectedMaxUsers);
@@ -328,31 +2413,27 @@ int main(int argc, char* argv[]) {
       net::HttpNetworkSession::NORMAL_SOCKET_POOL,
       kDefaultMaxSocketsPerGroup * kExpectedMaxUsers);
 
+  // Times the startup phases for the log.
+  base::ElapsedTimer startup_timer;
+
   const auto& proc = *base::CommandLine::ForCurrentProcess();
   const auto& args = proc.GetArgs();
   base::Value::Dict config_dict;
+  // Empty if the config is from the command line.
+  base::FilePath config_file;
   if (args.empty() && proc.argv().size() >= 2) {
     config_dict = GetSwitchesAsValue(proc);
   } else {
-    base::FilePath config_file;
     if (!args.empty()) {
       config_file = base::FilePath(args[0]);
     } else {
       config_file = base::FilePath::FromUTF8Unsafe("config.json");
     }
-    JSONFileValueDeserializer reader(config_file);
-    int error_code;
-    std::string error_message;
-    std::unique_ptr<base::Value> value =
-        reader.Deserialize(&error_code, &error_message);
-    if (value == nullptr) {
-      std::cerr << "Error reading " << config_file << ": (" << error_code
-                << ") " << error_message << std::endl;
+    std::optional<base::Value::Dict> dict = net::ReadConfigFile(config_file);
+    if (!dict) {
       return EXIT_FAILURE;
     }
-    if (const base::Value::Dict* dict = value->GetIfDict()) {
-      config_dict = dict->Clone();
-    }
+    config_dict = std::move(*dict);
   }
 
   if (config_dict.contains("h") || config_dict.contains("help")) {
@@ -362,18 +2443,189 @@ int main(int argc, char* argv[]) {
                  "-h, --help                 Show this message\n"
                  "--version                  Print version\n"
                  "--listen=<proto>://[addr][:port] [--listen=...]\n"
-                 "                           proto: socks, http\n"
-                 "                                  redir (Linux only)\n"
+                 "                           proto: socks, http, https, h2c\n"
+                 "                                  socks+unix, http+unix\n"
+                 "                                  redir, quic, tun (Linux only)\n"
+                 "                           ?max-connections=<N>\n"
+                 "                           &max-handshakes=<N>\n"
+                 "                           &max-destination-connections=<N>\n"
+                 "                           &backlog=<N>\n"
+                 "                           &rate-limit=<N>\n"
+                 "                           socks, http:\n"
+                 "                             &proxy-protocol\n"
+                 "                           https, quic:\n"
+                 "                             &cert=<pem>&key=<pem>\n"
+                 "                           tun://<dev>[?fd=<N>&mtu=<N>]\n"
+                 "                             &connect-ip\n"
+                 "--user=<user>,...          SOCKS5 client accounts\n"
+                 "                           NAME:PASS[:SOFT-MB[:HARD-MB]]\n"
+                 "--user-file=<path>         A line of such per user\n"
                  "--proxy=<proto>://[<user>:<pass>@]<hostname>[:<port>]\n"
-                 "                           proto: https, quic\n"
+                 "                           proto: https, quic, auto\n"
+                 "                           Comma-separated for failover\n"
+                 "--route=<target>=<matcher>,...\n"
+                 "                           Bypass proxies by destination\n"
+                 "--ruleset=<path>           Route tags, naive_rules_compile\n"
                  "--insecure-concurrency=<N> Use N connections, insecure\n"
+                 "--insecure-concurrency-max=<M>\n"
+                 "                           Grow to M connections under load\n"
+                 "--bulk-sessions=<N>        N more for bulk connections\n"
+                 "--bulk-bytes=<N>           Bulk hosts by bytes received\n"
+                 "--separate-tunnel-sessions Keep listeners off each other's\n"
+                 "                           tunnel connections\n"
+                 "--socket-pool-max=<N>      Sockets per network session\n"
+                 "--socket-pool-max-per-group=<N>\n"
+                 "                           Sockets per destination\n"
+                 "--adapt-network            Tune sessions to RTT, bandwidth\n"
+                 "--session-affinity         Keep sites on one tunnel session\n"
+                 "--bond=<N>                 Stripe each connection over N\n"
+                 "                           tunnels on separate sessions\n"
+                 "--threads=<N>              Use N IO threads (Linux)\n"
+                 "--upstream-threads=<M>     Only M threads open tunnels\n"
+                 "--cpu-affinity=<cpu>,...   Pin IO threads to CPUs (Linux)\n"
+                 "--numa                     Threads per NUMA node (Linux)\n"
+                 "--rebalance                Move busy relays between\n"
+                 "                           threads (Linux)\n"
+                 "--epoll-spin=<us>          Poll when idle before sleeping\n"
+                 "--relay-hugepages=<MB>     Relay buffers on huge pages\n"
+                 "--idle-trim=<s>            Return memory after bursts\n"
+                 "--idle-trim-connections=<N>\n"
+                 "                           Connections counted as idle\n"
+                 "--overload-lag=<ms>        Shed load when tasks wait long\n"
+                 "--overload-policy=<action>,...\n"
+                 "                           pause-accept, reject-handshakes,\n"
+                 "                           shrink-yield\n"
                  "--extra-headers=...        Extra headers split by CRLF\n"
                  "--host-resolver-rules=...  Resolver rules\n"
+                 "--host-cache-size=<N>      Host cache entries\n"
+                 "--host-cache-min-ttl=<s>   Cache results at least s\n"
+                 "--host-cache-stale=<s>     Serve expired results, refresh\n"
+                 "--host-cache-prefetch=<s>  Refresh names used near expiry\n"
+                 "--async-dns[=<ip>[:<port>],...]\n"
+                 "                           Resolve without getaddrinfo\n"
+                 "--async-dns-concurrency=<N>\n"
+                 "                           Names resolved at once\n"
                  "--resolver-range=...       Redirect resolver range\n"
+                 "--resolver-range6=...      Redirect resolver IPv6 range\n"
+                 "--resolver-cache=<path>    Keep resolver mappings\n"
+                 "--resolver-preconnect      Open tunnels on DNS queries\n"
+                 "--resolver-doh=<url>       Forward DNS to DoH (Linux)\n"
+                 "--resolver-thread          Resolve on a separate thread\n"
+                 "--redir-sniff              Redir names from SNI, Host\n"
+                 "                           (Linux)\n"
+                 "--tproxy-udp-port=<port>   Redirect UDP by TPROXY (Linux)\n"
+                 "--tcp-fastopen             TCP Fast Open (Linux)\n"
+                 "--no-tcp-nodelay           Allow Nagle's algorithm\n"
+                 "--tcp-rcvbuf=<N>           TCP socket buffer sizes\n"
+                 "--tcp-sndbuf=<N>\n"
+                 "--tcp-notsent-lowat=<N>    Limit unsent data (Linux)\n"
+                 "--tcp-keepalive=<idle>[,<interval>,<count>]\n"
+                 "--tcp-congestion=<cc>      e.g. bbr, cubic (Linux)\n"
+                 "--tcp-busy-poll=<us>       SO_BUSY_POLL (Linux)\n"
+                 "--egress-source=<addr>[,<addr>...]\n"
+                 "                           Local addresses of outgoing TCP\n"
+                 "                           sockets, least used first (Linux)\n"
+                 "--connect-family=<family>  ipv4, ipv6, ipv4-only, ipv6-only\n"
+                 "--connect-fallback-delay=<ms>\n"
+                 "                           Delay of the other family\n"
+                 "--connect-family-memory=<s>\n"
+                 "                           Remember hosts needing IPv4\n"
+                 "--proxy-race=<s>           Race proxy addresses, keep best\n"
+                 "--mptcp                    Multipath TCP to proxies (Linux)\n"
+                 "--proxy-pin=<host>=<ip>[|<ip>...]\n"
+                 "                           Proxy addresses without DNS\n"
+                 "--proxy-spki=<host>=sha256/<base64>[|...]\n"
+                 "                           Trust proxy keys, no root store\n"
+                 "--metrics=<addr>:<port>    Serve Prometheus metrics\n"
+                 "--metrics-admin            Serve /admin/ there too\n"
+                 "--tcp-info-interval=<s>    Sample TCP_INFO for metrics\n"
+                 "--handoff=<path>           Take over sockets on upgrades\n"
+                 "--handoff-drain=<s>        Time to drain the old process\n"
                  "--log[=<path>]             Log to stderr, or file\n"
+                 "--log-async                Write the log off IO threads\n"
+                 "--log-rate-limit=<N>       Messages/s per log call site\n"
                  "--log-net-log=<path>       Save NetLog\n"
+                 "--log-net-log-ring=<MB>    Keep NetLog in memory, dump it\n"
+                 "--log-net-log-ring-errors=<N>\n"
+                 "                           Dump after N errors a minute\n"
+                 "--trace=<path>             Record a Perfetto trace\n"
+                 "--access-log=<path>        Binary record of connections\n"
+                 "--access-log-records=<N>   Records kept in the ring\n"
                  "--ssl-key-log-file=<path>  Save SSL keys for Wireshark\n"
                  "--no-post-quantum          No post-quantum key agreement\n"
+                 "--kernel-tls               Encrypt in the kernel (Linux)\n"
+                 "--tls-offload              Encrypt on the thread pool\n"
+                 "--tls-dynamic-records      Small TLS records after idle\n"
+                 "--no-fastopen              Wait for tunnel responses\n"
+                 "--reset-on-connect-failure Reset clients on failure (Linux)\n"
+                 "--negative-cache-ttl=<s>   Fail unreachable targets at once\n"
+                 "--reset-on-error           Reset sockets on errors (Linux)\n"
+                 "--no-half-close            Close both sides on EOF\n"
+                 "--padding-cache=<path>     Remember proxy padding types\n"
+                 "--session-cache=<path>     Resume sessions after restarts\n"
+                 "--ticket-keys=<path>       Session tickets shared by servers\n"
+                 "--low-memory               Defaults for small devices\n"
+                 "--mobile                   Coalesced wakeups for phones\n"
+                 "--wakeup-period=<s>\n"
+                 "--relay-buffer-min=<N>     Adaptive relay buffer sizing\n"
+                 "--relay-buffer-max=<N>\n"
+                 "--relay-read-if-ready      No buffers for idle reads\n"
+                 "--relay-yield-bytes=<N>    Relay fairness budgets\n"
+                 "--relay-yield-interval=<ms>\n"
+                 "--relay-yield-adaptive     Scale yields with connections\n"
+                 "--relay-yield-batch=<N>\n"
+                 "--relay-splice             Zero-copy direct relay (Linux)\n"
+                 "--relay-io-uring           io_uring direct relay (Linux)\n"
+                 "--relay-sockmap            In-kernel direct relay (Linux)\n"
+                 "--relay-rio                Registered I/O relay (Windows)\n"
+                 "--relay-notsent-lowat=<N>  Relay backpressure (Linux)\n"
+                 "--relay-zerocopy=<N>       Zero-copy sends of N+ bytes\n"
+                 "--relay-read-ahead=<N>     Tunnel bytes held for slow clients\n"
+                 "--relay-pipeline=<N>       Bytes read ahead of pending writes\n"
+                 "--relay-coalesce=<N>       Merge reads queued behind writes\n"
+                 "--relay-padding-batch=<N>  Merge small padded writes\n"
+                 "--relay-padding-batch-delay=<us>\n"
+                 "--padding-profile=...      uniform, light, heavy\n"
+                 "--udp-idle-timeout=<s>     Close idle SOCKS5 UDP flows\n"
+                 "--handshake-timeout=<s>    Close stalled client handshakes\n"
+                 "--connect-timeout=<s>      Close stalled upstream connects\n"
+                 "--idle-timeout=<s>         Close idle connections\n"
+                 "--keep-warm=<s>            Preconnect tunnel sessions\n"
+                 "--egress-preconnect=<N>    Idle direct connections to hot "
+                 "targets\n"
+                 "--proxy-warm-pool=<N>      Idle HTTP/1.1 and SOCKS5 "
+                 "connections\n"
+                 "--socks-pipeline           Send SOCKS5 CONNECT with greeting\n"
+                 "--h2-session-window=<N>    HTTP/2 receive windows\n"
+                 "--h2-stream-window=<N>\n"
+                 "--h2-window-max=<N>        Autotune HTTP/2 windows up to N\n"
+                 "--h2-read-size=<N>         Grow HTTP/2 reads up to N bytes\n"
+                 "--h2-notsent-lowat=<N>     Tunnel upload backpressure\n"
+                 "--write-quantum=<N>        Bytes per tunnel send turn\n"
+                 "--session-probe=<s>        PING idle proxy sessions\n"
+                 "--session-probe-timeout=<ms>\n"
+                 "--priority=<rule>,...      [listen:]PORT[-PORT]=PRIORITY\n"
+                 "--rate-limit=<N>           Bytes/s each way of all clients\n"
+                 "--user-rate-limit=<N>      Bytes/s each way of each user\n"
+                 "--quic-congestion-control=<cc>\n"
+                 "                           cc: bbr2, bbr, cubic, reno\n"
+                 "--quic-initial-cwnd=<N>    N: 3, 10, 20, 50 packets\n"
+                 "--quic-connection-options=<tag>,...\n"
+                 "--quic-client-connection-options=<tag>,...\n"
+                 "--quic-session-window=<N>  QUIC receive windows\n"
+                 "--quic-stream-window=<N>\n"
+                 "--quic-window-autotune     Autotune QUIC windows\n"
+                 "--no-quic-migration        Keep QUIC off new networks\n"
+                 "--quic-port-hop=<s>        Move QUIC to new ports\n"
+                 "--quic-hop-ports=<first>-<last>\n"
+                 "--quic-max-packet-length=<N>\n"
+                 "                           Initial QUIC packet length\n"
+                 "--quic-mtu=<N>             Probe QUIC path MTU up to N\n"
+                 "--quic-ecn                 Use ECN on QUIC sessions\n"
+                 "--quic-txtime              Pace QUIC in the kernel\n"
+                 "--quic-shared-socket       One UDP socket per proxy\n"
+                 "--bench=<url>              Measure the proxies and exit\n"
+                 "--bench-sessions=<N>\n"
               << std::endl;
     exit(EXIT_SUCCESS);
   }
@@ -388,11 +2640,87 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
   CHECK(logging::InitLogging(config.log));
+  if (config.log.logging_dest != logging::LOG_NONE) {
+    net::NaiveLogSink::Install(config.log_file, config.log_async,
+                               config.log_rate_limit);
+  }
+
+  if (config.low_memory) {
+    net::ApplyLowMemoryProfile(config);
+  }
+  // Before the IO threads start their timers.
+  net::SetWakeupPeriod(config.wakeup_period);
+  if (config.socket_pool_max > 0 || config.socket_pool_max_per_group > 0) {
+    constexpr auto kPool = net::HttpNetworkSession::NORMAL_SOCKET_POOL;
+    // An option given alone moves the other only as far as it has to.
+    int max_sockets =
+        config.socket_pool_max > 0
+            ? config.socket_pool_max
+            : std::max(config.socket_pool_max_per_group,
+                       net::ClientSocketPoolManager::max_sockets_per_pool(
+                           kPool));
+    int max_sockets_per_group =
+        config.socket_pool_max_per_group > 0
+            ? config.socket_pool_max_per_group
+            : std::min(max_sockets,
+                       net::ClientSocketPoolManager::max_sockets_per_group(
+                           kPool));
+    net::SetSocketPoolLimits(max_sockets, max_sockets_per_group);
+  }
 
   if (!config.ssl_key_log_file.empty()) {
     net::SSLClientSocket::SetSSLKeyLogger(
         std::make_unique<net::SSLKeyLoggerImpl>(config.ssl_key_log_file));
   }
+  if (config.kernel_tls) {
+    net::SSLClientSocket::SetKernelTlsEnabled(true);
+  }
+  if (config.tls_offload) {
+    net::SSLClientSocket::SetParallelSealingEnabled(true);
+  }
+  if (config.tls_dynamic_records) {
+    net::SSLClientSocket::SetDynamicRecordSizing(true);
+  }
+  if (config.relay.half_close) {
+    net::SpdyProxyClientSocket::SetHalfCloseEnabled(true);
+  }
+
+#if BUILDFLAG(IS_POSIX)
+  // Before any worker opens a socket.
+  net::TCPSocket::TuningOptions tcp_options;
+  tcp_options.fastopen = config.tcp_fastopen;
+  tcp_options.no_delay = config.tcp_no_delay;
+  tcp_options.receive_buffer_size = config.tcp_receive_buffer;
+  tcp_options.send_buffer_size = config.tcp_send_buffer;
+  tcp_options.notsent_lowat = config.tcp_notsent_lowat;
+  tcp_options.keepalive_idle = config.tcp_keepalive_idle;
+  tcp_options.keepalive_interval = config.tcp_keepalive_interval;
+  tcp_options.keepalive_count = config.tcp_keepalive_count;
+  tcp_options.congestion_control = config.tcp_congestion_control;
+  tcp_options.busy_poll_us = config.tcp_busy_poll_us;
+  tcp_options.source_addresses = config.egress_source_addresses;
+  net::TCPSocket::SetTuningOptions(tcp_options);
+#endif
+#if BUILDFLAG(IS_LINUX)
+  if (config.relay_hugepages_mb > 0) {
+    net::NaiveBufferPool::SetArenaBytes(
+        static_cast<size_t>(config.relay_hugepages_mb) * 1024 * 1024);
+  }
+  if (config.epoll_spin_us > 0) {
+    base::MessagePumpEpoll::SetSpinDuration(
+        base::Microseconds(config.epoll_spin_us));
+  }
+#endif
+#if BUILDFLAG(IS_WIN)
+  if (config.relay.rio) {
+    net::SetRegisteredIoSockets(true);
+  }
+#endif
+  net::TransportConnectJob::SetConnectPolicy(config.connect_policy);
+  net::SOCKSConnectJob::SetPipelined(config.socks_pipeline);
+  // Random padding would only evict the other headers from the dynamic
+  // tables of HPACK and QPACK.
+  net::SetUnindexedHeaderNames({net::kPaddingHeader});
 
   // The declaration order for net_log and printing_log_observer is
   // important. The destructor of PrintingLogObserver removes itself
@@ -400,89 +2728,359 @@ int main(int argc, char* argv[]) {
   // printing_log_observer.
   net::NetLog* net_log = net::NetLog::Get();
   std::unique_ptr<net::FileNetLogObserver> observer;
-  if (!config.log_net_log.empty()) {
+  std::unique_ptr<net::NaiveNetLogRing> net_log_ring;
+  if (config.log_net_log_ring_size > 0) {
+    net_log_ring = std::make_unique<net::NaiveNetLogRing>(
+        config.log_net_log, config.log_net_log_ring_size,
+        config.log_net_log_ring_errors, GetConstants());
+    net_log_ring->StartObserving(net_log);
+#if BUILDFLAG(IS_POSIX)
+    net_log_ring->WatchSignal();
+#endif
+  } else if (!config.log_net_log.empty()) {
     observer = net::FileNetLogObserver::CreateUnbounded(
         config.log_net_log, net::NetLogCaptureMode::kDefault, GetConstants());
     observer->StartObserving(net_log);
   }
 
+  std::unique_ptr<net::NaiveTraceRecorder> trace_recorder;
+  if (!config.trace.empty()) {
+    trace_recorder = std::make_unique<net::NaiveTraceRecorder>(config.trace);
+    if (!trace_recorder->Start()) {
+      return EXIT_FAILURE;
+    }
+  }
+
   // Avoids net log overhead if verbose logging is disabled.
   std::unique_ptr<net::PrintingLogObserver> printing_log_observer;
   if (config.log.logging_dest != logging::LOG_NONE && VLOG_IS_ON(1)) {
     printing_log_observer = std::make_unique<net::PrintingLogObserver>();
     net_log->AddObserver(printing_log_observer.get(),
-                         net::NetLogCaptureMode::kDefault);
+                         net::NetLogCaptureMode::kDefault,
+                         net::PrintingLogObserver::GetEventTypes());
   }
 
-  auto cert_context = net::BuildCertURLRequestContext(net_log);
-  scoped_refptr<net::CertNetFetcherURLRequest> cert_net_fetcher;
-  // The builtin verifier is supported but not enabled by default on Mac,
-  // falling back to CreateSystemVerifyProc() which drops the net fetcher,
-  // causing a DCHECK in ~CertNetFetcherURLRequest().
-  // See CertVerifier::CreateDefaultWithoutCaching() and
-  // CertVerifyProc::CreateSystemVerifyProc() for the build flags.
+  if (config.bench_url.is_valid()) {
+    scoped_refptr<net::NaiveCertNetFetcher> cert_net_fetcher;
 #if BUILDFLAG(CHROME_ROOT_STORE_SUPPORTED) || BUILDFLAG(IS_FUCHSIA) || \
     BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS) || BUILDFLAG(IS_ANDROID)
-  cert_net_fetcher = base::MakeRefCounted<net::CertNetFetcherURLRequest>();
-  cert_net_fetcher->SetURLRequestContext(cert_context.get());
+    cert_net_fetcher = base::MakeRefCounted<net::NaiveCertNetFetcher>(
+        base::BindOnce(&net::BuildCertURLRequestContext, net_log));
 #endif
-  auto context =
-      net::BuildURLRequestContext(config, std::move(cert_net_fetcher), net_log);
-  auto* session = context->http_transaction_factory()->GetSession();
+    bool measured = net::RunBench(
+        config,
+        base::BindRepeating(&net::BuildBenchContext, cert_net_fetcher, net_log));
+    if (cert_net_fetcher) {
+      cert_net_fetcher->Shutdown();
+    }
+    return measured ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
-  std::vector<std::unique_ptr<net::NaiveProxy>> naive_proxies;
-  std::unique_ptr<net::RedirectResolver> resolver;
+  // Reports network changes to NaiveProxy::OnNetworkChanged() on every worker.
+  std::unique_ptr<net::NetworkChangeNotifier> network_change_notifier;
+  // QUIC migration follows the default network it reports.
+  bool quic_migration =
+      config.quic_migration &&
+      std::any_of(config.proxies.begin(), config.proxies.end(),
+                  [](const net::NaiveProxyServerConfig& proxy) {
+                    return proxy.url.compare(0, 7, "quic://") == 0 ||
+                           proxy.url.compare(0, 7, "auto://") == 0;
+                  });
+  // The async resolver reads the system DNS config through it.
+  bool system_dns_config =
+      config.async_dns && config.async_dns_servers.empty();
+  if (config.relay.keep_warm_interval.is_positive() ||
+      config.proxies.size() > 1 ||
+      config.proxies[0].url.compare(0, 7, "auto://") == 0 || quic_migration ||
+      system_dns_config) {
+    network_change_notifier = net::NetworkChangeNotifier::CreateIfNeeded();
+  }
 
-  for (const net::NaiveListenConfig& listen_config : config.listen) {
-    auto listen_socket =
-        std::make_unique<net::TCPServerSocket>(net_log, net::NetLogSource());
+  LOG(INFO) << "Initialized in " << startup_timer.Elapsed().InMilliseconds()
+            << " ms";
 
-    int result = listen_socket->ListenWithAddressAndPort(
-        listen_config.addr, listen_config.port, kListenBackLog);
-    if (result != net::OK) {
-      LOG(ERROR) << "Failed to listen on "
-                 << net::ToString(listen_config.protocol) << "://"
-                 << listen_config.addr << " " << listen_config.port << ": "
-                 << net::ErrorToShortString(result);
-      return EXIT_FAILURE;
+  // Takes the listening sockets of the running process before listening.
+  net::NaiveHandoff* handoff = nullptr;
+#if BUILDFLAG(IS_LINUX)
+  std::unique_ptr<net::NaiveHandoff> owned_handoff;
+  if (!config.handoff_path.empty()) {
+    owned_handoff = std::make_unique<net::NaiveHandoff>(config.handoff_path);
+    handoff = owned_handoff.get();
+    handoff->ReceiveSockets();
+  }
+#endif
+
+#if BUILDFLAG(IS_LINUX)
+  // Outlives the workers using it.
+  net::NaiveNumaTopology numa_topology;
+  std::vector<int> worker_nodes;
+  std::unique_ptr<net::NaiveNumaSteering> numa_steering;
+  if (config.numa) {
+    numa_topology = net::NaiveNumaTopology::Read();
+    const int num_nodes = numa_topology.nodes().size();
+    if (num_nodes < 2) {
+      LOG(WARNING) << "Ignoring numa on " << num_nodes << " NUMA nodes";
+    } else {
+      for (int i = 0; i < config.threads; ++i) {
+        int node = -1;
+        if (!config.cpu_affinity.empty()) {
+          node = numa_topology.IndexOfCpu(
+              config.cpu_affinity[i % config.cpu_affinity.size()]);
+        }
+        worker_nodes.push_back(node >= 0 ? node : i % num_nodes);
+      }
+      numa_steering =
+          std::make_unique<net::NaiveNumaSteering>(numa_topology, worker_nodes);
     }
-    LOG(INFO) << "Listening on " << net::ToString(listen_config.protocol)
-              << "://" << listen_config.addr << ":" << listen_config.port;
+  }
+#endif
 
-    if (resolver == nullptr &&
-        listen_config.protocol == net::ClientProtocol::kRedir) {
-      auto resolver_socket =
-          std::make_unique<net::UDPServerSocket>(net_log, net::NetLogSource());
-      resolver_socket->AllowAddressReuse();
-      net::IPAddress listen_addr;
-      if (!listen_addr.AssignFromIPLiteral(listen_config.addr)) {
-        LOG(ERROR) << "Failed to open resolver: " << listen_config.addr;
+  // Worker 0 runs on the main thread. The others get their own IO threads,
+  // sharing the listening ports through SO_REUSEPORT. Workers are started in
+  // order, so forwarding workers find all upstream workers ready.
+  base::ElapsedTimer workers_timer;
+  std::vector<std::unique_ptr<net::NaiveWorker>> workers;
+  std::vector<std::unique_ptr<base::Thread>> worker_threads;
+  scoped_refptr<net::NaiveUserTable> user_table;
+  if (!config.users.empty()) {
+    user_table = base::MakeRefCounted<net::NaiveUserTable>(config.users);
+  }
+  scoped_refptr<net::NaiveRouter> router;
+  if (!config.route.empty()) {
+    scoped_refptr<net::NaiveRuleset> ruleset;
+    if (!config.ruleset.empty()) {
+      ruleset = net::NaiveRuleset::Open(config.ruleset);
+      if (!ruleset) {
         return EXIT_FAILURE;
       }
-
-      result = resolver_socket->Listen(
-          net::IPEndPoint(listen_addr, listen_config.port));
-      if (result != net::OK) {
-        LOG(ERROR) << "Failed to open resolver: "
-                   << net::ErrorToShortString(result);
+    }
+    router = net::NaiveRouter::Create(config.route, std::move(ruleset));
+    if (!router) {
+      return EXIT_FAILURE;
+    }
+  }
+  scoped_refptr<net::NaiveTicketKeys> ticket_keys;
+  if (!config.ticket_keys_file.empty()) {
+    ticket_keys =
+        base::MakeRefCounted<net::NaiveTicketKeys>(config.ticket_keys_file);
+    if (!ticket_keys->Load()) {
+      return EXIT_FAILURE;
+    }
+  }
+  scoped_refptr<net::NaiveAccessLog> access_log;
+  if (!config.access_log.empty()) {
+    access_log = net::NaiveAccessLog::Open(config.access_log,
+                                           config.access_log_records);
+    if (!access_log) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (int i = 0; i < config.threads; ++i) {
+    auto worker = std::make_unique<net::NaiveWorker>();
+    worker->user_table = user_table;
+    worker->router = router;
+    worker->ticket_keys = ticket_keys;
+    worker->access_log = access_log;
+    bool started = false;
+#if BUILDFLAG(IS_LINUX)
+    const int cpu =
+        config.cpu_affinity.empty()
+            ? -1
+            : config.cpu_affinity[i % config.cpu_affinity.size()];
+    base::OnceClosure place_thread;
+    if (numa_steering) {
+      place_thread =
+          base::BindOnce(&net::BindCurrentThreadToNode,
+                         numa_topology.nodes()[worker_nodes[i]], cpu);
+    } else if (cpu >= 0) {
+      place_thread = base::BindOnce(&net::PinCurrentThread, cpu);
+    }
+    worker->numa_steering = numa_steering.get();
+#endif
+    if (i == 0) {
+#if BUILDFLAG(IS_LINUX)
+      if (place_thread) {
+        std::move(place_thread).Run();
+      }
+#endif
+      started = net::StartWorker(config, net_log, i, workers, handoff,
+                                 worker.get());
+    } else {
+      auto thread = std::make_unique<base::Thread>(
+          base::StringPrintf("naive_worker_%d", i));
+      if (!thread->StartWithOptions(
+              base::Thread::Options(base::MessagePumpType::IO, 0))) {
+        LOG(ERROR) << "Failed to start worker thread " << i;
+        net::StopWorkers(workers, worker_threads);
         return EXIT_FAILURE;
       }
+#if BUILDFLAG(IS_LINUX)
+      if (place_thread) {
+        thread->task_runner()->PostTask(FROM_HERE, std::move(place_thread));
+      }
+#endif
+      base::WaitableEvent done;
+      thread->task_runner()->PostTask(
+          FROM_HERE,
+          base::BindOnce(&net::StartWorkerOnThread, &config, net_log, i,
+                         &workers, handoff, worker.get(), &started, &done));
+      done.Wait();
+      worker_threads.push_back(std::move(thread));
+    }
+    workers.push_back(std::move(worker));
+    if (!started) {
+      net::StopWorkers(workers, worker_threads);
+      return EXIT_FAILURE;
+    }
+  }
+  LOG(INFO) << "Started " << workers.size() << " workers in "
+            << workers_timer.Elapsed().InMilliseconds() << " ms, listening "
+            << startup_timer.Elapsed().InMilliseconds() << " ms after start";
+  // No names are replaced before the main thread runs, so the other workers
+  // are registered in time for their first redirected connection. Those of
+  // a resolver thread were registered as they started.
+  for (size_t i = 1; i < workers.size() && !workers[0]->resolver_thread;
+       ++i) {
+    if (workers[i]->shared_resolver) {
+      workers[0]->resolver->AddReader(workers[i]->task_runner);
+    }
+  }
+  // Not before listening, as it loads the trust store. With pinned proxies
+  // it is left to a verification needing it.
+  if (config.proxy_spki_pins.empty()) {
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&net::WarmCertVerifier, workers[0].get()));
+  }
+
+  // Scrapes post tasks to the workers, so it is gone before they are.
+  std::unique_ptr<net::NaiveMetricsServer> metrics_server;
+  if (config.metrics_port > 0) {
+    metrics_server =
+        net::StartMetricsServer(config, net_log, workers, user_table);
+    if (!metrics_server) {
+      net::StopWorkers(workers, worker_threads);
+      return EXIT_FAILURE;
+    }
+  }
+
+#if BUILDFLAG(IS_LINUX)
+  // Likewise posts to the workers.
+  std::unique_ptr<net::NaiveRebalancer> rebalancer;
+  const int upstream_threads =
+      config.upstream_threads > 0 ? config.upstream_threads : config.threads;
+  if (config.rebalance && upstream_threads > 1) {
+    std::vector<scoped_refptr<base::SingleThreadTaskRunner>> task_runners;
+    for (int i = 0; i < upstream_threads; ++i) {
+      task_runners.push_back(workers[i]->task_runner);
+    }
+    rebalancer = std::make_unique<net::NaiveRebalancer>(
+        std::move(task_runners), base::BindRepeating(&net::SumBytesRelayed),
+        base::BindRepeating(&net::MoveWorkerRelay, &workers));
+  }
+#endif
+
+  // Picks up keys rotated into the file, also on the listeners already
+  // open.
+  base::RepeatingTimer ticket_keys_timer;
+  if (ticket_keys) {
+    ticket_keys_timer.Start(
+        FROM_HERE, net::NaiveTicketKeys::kReloadInterval,
+        base::BindRepeating(base::IgnoreResult(&net::NaiveTicketKeys::Load),
+                            ticket_keys));
+  }
+
+#if BUILDFLAG(IS_POSIX)
+  // Reloads work on the running config from here on.
+  std::unique_ptr<net::NaiveConfigReloader> reloader;
+  if (!config_file.empty()) {
+    reloader = std::make_unique<net::NaiveConfigReloader>(
+        config_file, config_dict.Clone(), &config, net_log, &workers, handoff,
+        &metrics_server);
+    if (!reloader->WatchSignal()) {
+      LOG(ERROR) << "Failed to watch SIGHUP, reloading is disabled";
+    }
+  }
+  // Gone before the workers it posts to.
+  auto memory_watcher = std::make_unique<net::NaiveSignalWatcher>(
+      SIGUSR2, base::BindRepeating(&net::LogMemoryUsage, &workers));
+  if (!memory_watcher->Start()) {
+    LOG(ERROR) << "Failed to watch SIGUSR2, memory dumps are disabled";
+    memory_watcher.reset();
+  }
+#endif
 
-      resolver = std::make_unique<net::RedirectResolver>(
-          std::move(resolver_socket), config.resolver_range,
-          config.resolver_prefix);
+  base::RunLoop run_loop;
+  base::RepeatingTimer drain_timer;
+#if BUILDFLAG(IS_LINUX)
+  if (handoff) {
+    handoff->ConfirmReceived();
+    // The resolver of the main worker saves its cache for the successor.
+    net::NaiveHandoff::SendCallback send_callback = base::DoNothing();
+    if (workers[0]->resolver) {
+      send_callback = base::BindRepeating(&net::PauseResolverForHandoff,
+                                          workers[0].get());
     }
+    bool serving = handoff->Serve(
+        std::move(send_callback),
+        base::BindRepeating(&net::OnHandoffDone, &workers, &metrics_server,
+                            reloader.get(), &drain_timer, config.handoff_drain,
+                            run_loop.QuitClosure()));
+    if (!serving) {
+      LOG(ERROR) << "Failed to serve handoff on " << config.handoff_path;
+    }
+  }
+#endif
 
-    auto naive_proxy = std::make_unique<net::NaiveProxy>(
-        std::move(listen_socket), listen_config.protocol, listen_config.user,
-        listen_config.pass, config.insecure_concurrency, resolver.get(),
-        session, kTrafficAnnotation,
-        std::vector<net::PaddingType>{net::PaddingType::kVariant1,
-                                      net::PaddingType::kNone});
-    naive_proxies.push_back(std::move(naive_proxy));
+#if BUILDFLAG(IS_POSIX)
+  if (embedding) {
+    std::vector<net::NaiveEmbedding::Target> targets;
+    auto embed_listener = base::ranges::find(
+        config.listen, net::ClientProtocol::kEmbedded,
+        &net::NaiveListenConfig::protocol);
+    if (embed_listener != config.listen.end()) {
+      size_t i = embed_listener - config.listen.begin();
+      for (const auto& worker : workers) {
+        if (worker->context) {
+          targets.emplace_back(worker->task_runner,
+                               worker->listen_proxies[i]);
+        }
+      }
+    }
+    if (targets.empty()) {
+      LOG(ERROR) << "Embedding needs --listen=embed://";
+#if BUILDFLAG(IS_LINUX)
+      rebalancer.reset();
+#endif
+      metrics_server.reset();
+      net::StopWorkers(workers, worker_threads);
+      return EXIT_FAILURE;
+    }
+    embedding->Start(std::move(targets), run_loop.QuitClosure());
   }
+#endif
+
+  run_loop.Run();
 
-  base::RunLoop().Run();
+#if BUILDFLAG(IS_POSIX)
+  memory_watcher.reset();
+  // No more connections for the workers being stopped.
+  if (embedding) {
+    embedding->Finish();
+  }
+#endif
+#if BUILDFLAG(IS_LINUX)
+  rebalancer.reset();
+#endif
+  metrics_server.reset();
+  net::StopWorkers(workers, worker_threads);
+  if (trace_recorder) {
+    trace_recorder->Stop();
+  }
+  net::NaiveLogSink::Flush();
+  // Runs the cache file writes the workers left behind.
+  base::ThreadPoolInstance::Get()->Shutdown();
 
   return EXIT_SUCCESS;
 }
+
+}  // namespace net
@@ -3,22 +3,85 @@
 // found in the LICENSE file.
 #include "net/tools/naive/naive_proxy_delegate.h"
 
+#include <algorithm>
 #include <optional>
 #include <string>
 #include <string_view>
 
+#include "base/files/file_util.h"
+#include "base/functional/bind.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/json/values_util.h"
 #include "base/logging.h"
+#include "base/no_destructor.h"
 #include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/task/thread_pool.h"
 #include "net/base/proxy_string_util.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
+#include "net/proxy_resolution/proxy_info.h"
+#include "net/proxy_resolution/proxy_list.h"
 #include "net/third_party/quiche/src/quiche/spdy/core/hpack/hpack_constants.h"
 
 namespace net {
 namespace {
 bool g_nonindex_codes_initialized;
 uint8_t g_nonindex_codes[17];
+
+// Backoff of an upstream after consecutive failures.
+constexpr base::TimeDelta kUpstreamRetryDelayMin = base::Seconds(5);
+constexpr base::TimeDelta kUpstreamRetryDelayMax = base::Minutes(5);
+// Weight of a new sample in the smoothed connect time, like TCP's SRTT.
+constexpr int kConnectTimeSmoothing = 8;
+// Of the padding header value.
+constexpr int kMinPaddingSize = 16;
+constexpr int kMaxPaddingSize = 32;
+// Coalesces the saves of proxies negotiating at about the same time.
+constexpr base::TimeDelta kPaddingCacheSaveDelay = base::Seconds(1);
+
+// Shared by the delegates of all workers, so their read-merge-write cycles
+// of the padding cache file take turns.
+scoped_refptr<base::SequencedTaskRunner> GetPaddingCacheTaskRunner() {
+  static base::NoDestructor<scoped_refptr<base::SequencedTaskRunner>>
+      task_runner(base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::BLOCK_SHUTDOWN}));
+  return *task_runner;
+}
+
+// Runs on the padding cache sequence. Adds the entries of `file` that are
+// newer than those of `cache` and have not expired.
+std::optional<std::string> MergePaddingCache(const base::FilePath& file,
+                                             base::TimeDelta ttl,
+                                             base::Value::Dict cache) {
+  std::string contents;
+  std::optional<base::Value::Dict> saved;
+  if (base::ReadFileToString(file, &contents))
+    saved = base::JSONReader::ReadDict(contents);
+  base::Time now = base::Time::Now();
+  for (auto [uri, value] : std::move(saved).value_or(base::Value::Dict())) {
+    const base::Value::Dict* entry = value.GetIfDict();
+    if (!entry)
+      continue;
+    std::optional<base::Time> time = base::ValueToTime(entry->Find("time"));
+    if (!time.has_value() || now - *time > ttl)
+      continue;
+    const base::Value::Dict* own = cache.FindDict(uri);
+    std::optional<base::Time> own_time =
+        own ? base::ValueToTime(own->Find("time")) : std::nullopt;
+    if (own_time.has_value() && *own_time >= *time)
+      continue;
+    cache.Set(uri, std::move(value));
+  }
+  std::string merged;
+  if (!base::JSONWriter::Write(cache, &merged))
+    return std::nullopt;
+  return merged;
+}
 }  // namespace
 
 void InitializeNonindexCodes() {
@@ -50,9 +113,23 @@ void FillNonindexHeaderValue(uint64_t unique_bits, char* buf, int len) {
 
 NaiveProxyDelegate::NaiveProxyDelegate(
     const HttpRequestHeaders& extra_headers,
-    const std::vector<PaddingType>& supported_padding_types)
-    : extra_headers_(extra_headers) {
+    const std::vector<PaddingType>& supported_padding_types,
+    bool fastopen,
+    const base::FilePath& padding_cache_file,
+    base::TimeDelta padding_cache_ttl,
+    int bond_members)
+    : extra_headers_(extra_headers),
+      padding_state_(base::RandUint64()),
+      fastopen_(fastopen),
+      padding_cache_file_(padding_cache_file),
+      padding_cache_ttl_(padding_cache_ttl) {
   InitializeNonindexCodes();
+  LoadPaddingCache();
+  if (!padding_cache_file_.empty()) {
+    padding_cache_writer_ = std::make_unique<base::ImportantFileWriter>(
+        padding_cache_file_, GetPaddingCacheTaskRunner(),
+        kPaddingCacheSaveDelay);
+  }
 
   std::vector<std::string_view> padding_type_strs;
   for (PaddingType padding_type : supported_padding_types) {
@@ -60,9 +137,46 @@ NaiveProxyDelegate::NaiveProxyDelegate(
   }
   extra_headers_.SetHeader(kPaddingTypeRequestHeader,
                            base::JoinString(padding_type_strs, ", "));
+  if (bond_members > 1) {
+    extra_headers_.SetHeader(kBondRequestHeader,
+                             base::NumberToString(bond_members));
+  }
+  UpdateTunnelHeaders();
 }
 
-NaiveProxyDelegate::~NaiveProxyDelegate() = default;
+NaiveProxyDelegate::~NaiveProxyDelegate() {
+  if (padding_cache_writer_ && padding_cache_writer_->HasPendingWrite())
+    padding_cache_writer_->DoScheduledWrite();
+}
+
+void NaiveProxyDelegate::SetExtraHeaders(
+    const HttpRequestHeaders& extra_headers) {
+  std::string padding_type_request;
+  extra_headers_.GetHeader(kPaddingTypeRequestHeader, &padding_type_request);
+  std::string bond_request;
+  bool has_bond_request =
+      extra_headers_.GetHeader(kBondRequestHeader, &bond_request);
+  extra_headers_ = extra_headers;
+  extra_headers_.SetHeader(kPaddingTypeRequestHeader, padding_type_request);
+  if (has_bond_request) {
+    extra_headers_.SetHeader(kBondRequestHeader, bond_request);
+  }
+  UpdateTunnelHeaders();
+}
+
+void NaiveProxyDelegate::UpdateTunnelHeaders() {
+  tunnel_headers_.Clear();
+  tunnel_headers_.SetHeader(kPaddingHeader,
+                            std::string(kMaxPaddingSize, '~'));
+  tunnel_headers_.MergeFrom(extra_headers_);
+}
+
+uint64_t NaiveProxyDelegate::NextPaddingBits() {
+  uint64_t z = (padding_state_ += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
 
 Error NaiveProxyDelegate::OnBeforeTunnelRequest(
     const ProxyChain& proxy_chain,
@@ -76,17 +190,29 @@ Error NaiveProxyDelegate::OnBeforeTunnelRequest(
   if (proxy_chain.GetProxyServer(chain_index).is_socks())
     return OK;
 
-  // Sends client-side padding header regardless of server support
-  std::string padding(base::RandInt(16, 32), '~');
-  FillNonindexHeaderValue(base::RandUint64(), &padding[0], padding.size());
-  extra_headers->SetHeader(kPaddingHeader, padding);
+  // Sends client-side padding header regardless of server support. The
+  // socket passes no headers of its own, so the prebuilt ones are copied
+  // and the padding value, first of them, overwritten in place.
+  if (extra_headers->IsEmpty()) {
+    *extra_headers = tunnel_headers_;
+  } else {
+    extra_headers->MergeFrom(tunnel_headers_);
+  }
+  char padding[kMaxPaddingSize];
+  constexpr int kPaddingSizes = kMaxPaddingSize - kMinPaddingSize + 1;
+  int padding_size =
+      kMinPaddingSize + static_cast<int>(NextPaddingBits() % kPaddingSizes);
+  FillNonindexHeaderValue(NextPaddingBits(), padding, padding_size);
+  extra_headers->SetHeader(kPaddingHeader,
+                           std::string_view(padding, padding_size));
 
   // Enables Fast Open in H2/H3 proxy client socket once the state of server
-  // padding support is known.
-  if (padding_type_by_server_[proxy_chain].has_value()) {
+  // padding support is known. The socket then connects as soon as the
+  // request headers are sent, and NaiveConnection pushes the early pulled
+  // client data without waiting for the tunnel response.
+  if (fastopen_ && GetProxyServerPaddingType(proxy_chain).has_value()) {
     extra_headers->SetHeader("fastopen", "1");
   }
-  extra_headers->MergeFrom(extra_headers_);
 
   return OK;
 }
@@ -133,12 +259,36 @@ Error NaiveProxyDelegate::OnTunnelHeadersReceived(
   if (!new_padding_type.has_value()) {
     return ERR_INVALID_RESPONSE;
   }
-  std::optional<PaddingType>& padding_type =
-      padding_type_by_server_[proxy_chain];
-  if (!padding_type.has_value() || padding_type != new_padding_type) {
+  base::Time now = base::Time::Now();
+  auto it = padding_type_by_server_.find(proxy_chain);
+  if (it == padding_type_by_server_.end() ||
+      it->second.padding_type != *new_padding_type) {
     LOG(INFO) << proxy_chain.ToDebugString() << " negotiated padding type: "
               << ToReadableString(*new_padding_type);
-    padding_type = new_padding_type;
+    it = padding_type_by_server_.insert_or_assign(
+        it, proxy_chain, NegotiatedPaddingType{*new_padding_type});
+  }
+  it->second.confirm_time = now;
+
+  if (extra_headers_.HasHeader(kBondRequestHeader)) {
+    std::string bond_reply;
+    int bond_members = 0;
+    if (response_headers.GetNormalizedHeader(kBondReplyHeader, &bond_reply) &&
+        (!base::StringToInt(bond_reply, &bond_members) || bond_members < 0)) {
+      LOG(ERROR) << "Received invalid bond reply: " << bond_reply;
+      bond_members = 0;
+    }
+    int& known = bond_members_by_server_[proxy_chain];
+    if (known != bond_members) {
+      LOG(INFO) << proxy_chain.ToDebugString() << " joins bonds of up to "
+                << bond_members << " tunnels";
+      known = bond_members;
+    }
+  }
+  // Refreshes the saved entry well before it would expire at the next start.
+  if (!padding_cache_file_.empty() &&
+      now - it->second.save_time > padding_cache_ttl_ / 2) {
+    SavePaddingCache();
   }
   return OK;
 }
@@ -153,7 +303,143 @@ std::optional<PaddingType> NaiveProxyDelegate::GetProxyServerPaddingType(
   if (proxy_chain.GetProxyServer(0).is_socks())
     return PaddingType::kNone;
 
-  return padding_type_by_server_[proxy_chain];
+  auto it = padding_type_by_server_.find(proxy_chain);
+  if (it == padding_type_by_server_.end() ||
+      base::Time::Now() - it->second.confirm_time > padding_cache_ttl_) {
+    return std::nullopt;
+  }
+  return it->second.padding_type;
+}
+
+int NaiveProxyDelegate::GetProxyServerBondMembers(
+    const ProxyChain& proxy_chain) const {
+  auto it = bond_members_by_server_.find(proxy_chain);
+  return it == bond_members_by_server_.end() ? 0 : it->second;
+}
+
+void NaiveProxyDelegate::OnResolveProxy(
+    const GURL& url,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    const std::string& method,
+    const ProxyRetryInfoMap& proxy_retry_info,
+    ProxyInfo* result) {
+  std::vector<ProxyChain> chains = result->proxy_list().AllChains();
+  if (chains.size() < 2)
+    return;
+
+  base::TimeTicks now = base::TimeTicks::Now();
+  auto is_better = [&](const ProxyChain& a, const ProxyChain& b) {
+    const UpstreamStats& stats_a = upstream_stats_[a];
+    const UpstreamStats& stats_b = upstream_stats_[b];
+    bool healthy_a = stats_a.retry_time <= now;
+    bool healthy_b = stats_b.retry_time <= now;
+    if (healthy_a != healthy_b)
+      return healthy_a;
+    if (!healthy_a)
+      return stats_a.retry_time < stats_b.retry_time;
+    return stats_a.smoothed_connect_time < stats_b.smoothed_connect_time;
+  };
+  // Equal upstreams keep the configured order.
+  std::stable_sort(chains.begin(), chains.end(), is_better);
+
+  ProxyList proxy_list;
+  for (const ProxyChain& chain : chains) {
+    proxy_list.AddProxyChain(chain);
+  }
+  result->OverrideProxyList(proxy_list);
+}
+
+void NaiveProxyDelegate::OnFallback(const ProxyChain& bad_proxy,
+                                    int net_error) {
+  UpstreamStats& stats = upstream_stats_[bad_proxy];
+  base::TimeDelta delay = kUpstreamRetryDelayMin;
+  for (int i = 0; i < stats.consecutive_failures; ++i) {
+    delay = std::min(delay * 2, kUpstreamRetryDelayMax);
+    if (delay == kUpstreamRetryDelayMax)
+      break;
+  }
+  ++stats.consecutive_failures;
+  stats.retry_time = base::TimeTicks::Now() + delay;
+  LOG(WARNING) << "Upstream " << bad_proxy.ToDebugString()
+               << " failed: " << ErrorToShortString(net_error)
+               << ", retrying in " << delay;
+}
+
+void NaiveProxyDelegate::OnUpstreamConnected(const ProxyChain& proxy_chain,
+                                             base::TimeDelta connect_time) {
+  UpstreamStats& stats = upstream_stats_[proxy_chain];
+  if (stats.consecutive_failures > 0) {
+    LOG(INFO) << "Upstream " << proxy_chain.ToDebugString() << " recovered";
+  }
+  stats.consecutive_failures = 0;
+  stats.retry_time = base::TimeTicks();
+  if (stats.smoothed_connect_time.is_zero()) {
+    stats.smoothed_connect_time = connect_time;
+  } else {
+    stats.smoothed_connect_time +=
+        (connect_time - stats.smoothed_connect_time) / kConnectTimeSmoothing;
+  }
+}
+
+void NaiveProxyDelegate::ResetUpstreamStats() {
+  upstream_stats_.clear();
+}
+
+void NaiveProxyDelegate::LoadPaddingCache() {
+  if (padding_cache_file_.empty())
+    return;
+  std::string contents;
+  // Does not exist before the first save.
+  if (!base::ReadFileToString(padding_cache_file_, &contents))
+    return;
+  std::optional<base::Value::Dict> cache = base::JSONReader::ReadDict(contents);
+  if (!cache.has_value()) {
+    LOG(WARNING) << "Invalid padding cache: " << padding_cache_file_;
+    return;
+  }
+
+  base::Time now = base::Time::Now();
+  for (const auto [uri, value] : *cache) {
+    const base::Value::Dict* entry = value.GetIfDict();
+    if (!entry)
+      continue;
+    const std::string* padding_type_str = entry->FindString("padding-type");
+    std::optional<base::Time> confirm_time =
+        base::ValueToTime(entry->Find("time"));
+    if (!padding_type_str || !confirm_time.has_value() ||
+        now - *confirm_time > padding_cache_ttl_) {
+      continue;
+    }
+    std::optional<PaddingType> padding_type =
+        ParsePaddingType(*padding_type_str);
+    ProxyChain proxy_chain =
+        ProxyUriToProxyChain(uri, ProxyServer::SCHEME_HTTPS);
+    if (!padding_type.has_value() || !proxy_chain.IsValid())
+      continue;
+    padding_type_by_server_[proxy_chain] = {*padding_type, *confirm_time,
+                                            *confirm_time};
+  }
+}
+
+void NaiveProxyDelegate::SavePaddingCache() {
+  if (!padding_cache_writer_)
+    return;
+  padding_cache_writer_->ScheduleWriteWithBackgroundDataSerializer(this);
+}
+
+base::ImportantFileWriter::BackgroundDataProducerCallback
+NaiveProxyDelegate::GetSerializedDataProducerForBackgroundSequence() {
+  base::Time now = base::Time::Now();
+  base::Value::Dict cache;
+  for (auto& [proxy_chain, entry] : padding_type_by_server_) {
+    cache.Set(ProxyServerToProxyUri(proxy_chain.GetProxyServer(0)),
+              base::Value::Dict()
+                  .Set("padding-type", ToString(entry.padding_type))
+                  .Set("time", base::TimeToValue(entry.confirm_time)));
+    entry.save_time = now;
+  }
+  return base::BindOnce(&MergePaddingCache, padding_cache_file_,
+                        padding_cache_ttl_, std::move(cache));
 }
 
 PaddingDetectorDelegate::PaddingDetectorDelegate(
@@ -161,7 +447,7 @@ PaddingDetectorDelegate::PaddingDetectorDelegate(
     const ProxyChain& proxy_chain,
     ClientProtocol client_protocol)
     : naive_proxy_delegate_(naive_proxy_delegate),
-      proxy_chain_(proxy_chain),
+      proxy_chain_(&proxy_chain),
       client_protocol_(client_protocol) {}
 
 PaddingDetectorDelegate::~PaddingDetectorDelegate() = default;
@@ -170,6 +456,11 @@ void PaddingDetectorDelegate::SetClientPaddingType(PaddingType padding_type) {
   detected_client_padding_type_ = padding_type;
 }
 
+void PaddingDetectorDelegate::SetProxyChain(const ProxyChain& proxy_chain) {
+  proxy_chain_ = &proxy_chain;
+  cached_server_padding_type_.reset();
+}
+
 std::optional<PaddingType> PaddingDetectorDelegate::GetClientPaddingType() {
   // Not possible to negotiate padding capability given the underlying
   // protocols.
@@ -177,16 +468,24 @@ std::optional<PaddingType> PaddingDetectorDelegate::GetClientPaddingType() {
     return PaddingType::kNone;
   } else if (client_protocol_ == ClientProtocol::kRedir) {
     return PaddingType::kNone;
+  } else if (client_protocol_ == ClientProtocol::kEmbedded) {
+    return PaddingType::kNone;
+  } else if (client_protocol_ == ClientProtocol::kTun) {
+    return PaddingType::kNone;
   }
 
   return detected_client_padding_type_;
 }
 
+int PaddingDetectorDelegate::GetServerBondMembers() {
+  return naive_proxy_delegate_->GetProxyServerBondMembers(*proxy_chain_);
+}
+
 std::optional<PaddingType> PaddingDetectorDelegate::GetServerPaddingType() {
   if (cached_server_padding_type_.has_value())
     return cached_server_padding_type_;
   cached_server_padding_type_ =
-      naive_proxy_delegate_->GetProxyServerPaddingType(proxy_chain_);
+      naive_proxy_delegate_->GetProxyServerPaddingType(*proxy_chain_);
   return cached_server_padding_type_;
 }
 
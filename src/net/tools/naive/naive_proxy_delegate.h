@@ -6,11 +6,15 @@
 
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
 #include "base/strings/string_piece.h"
+#include "base/time/time.h"
 #include "net/base/net_errors.h"
 #include "net/base/proxy_chain.h"
 #include "net/base/proxy_delegate.h"
@@ -27,18 +31,36 @@ void FillNonindexHeaderValue(uint64_t unique_bits, char* buf, int len);
 
 class ProxyInfo;
 
-class NaiveProxyDelegate : public ProxyDelegate {
+class NaiveProxyDelegate
+    : public ProxyDelegate,
+      public base::ImportantFileWriter::BackgroundDataSerializer {
  public:
+  // `fastopen` lets tunnel sockets complete before the tunnel response once
+  // the padding type is known. Loads and saves negotiated padding types in
+  // `padding_cache_file` unless it is empty, merged with those the delegates
+  // of other workers saved there. With `bond_members` above 1 asks
+  // the proxies whether they join bonds of that many tunnels.
   NaiveProxyDelegate(const HttpRequestHeaders& extra_headers,
-                     const std::vector<PaddingType>& supported_padding_types);
+                     const std::vector<PaddingType>& supported_padding_types,
+                     bool fastopen,
+                     const base::FilePath& padding_cache_file,
+                     base::TimeDelta padding_cache_ttl,
+                     int bond_members);
   ~NaiveProxyDelegate() override;
 
+  // Replaces the headers added to tunnel requests from now on.
+  void SetExtraHeaders(const HttpRequestHeaders& extra_headers);
+
+  // Orders the upstreams in `result` best first: healthy ones by their
+  // smoothed connect time, then failed ones by when they may be retried.
   void OnResolveProxy(const GURL& url,
                       const NetworkAnonymizationKey& network_anonymization_key,
                       const std::string& method,
                       const ProxyRetryInfoMap& proxy_retry_info,
-                      ProxyInfo* result) override {}
-  void OnFallback(const ProxyChain& bad_proxy, int net_error) override {}
+                      ProxyInfo* result) override;
+  // Takes `bad_proxy` out of rotation, for longer on each consecutive
+  // failure.
+  void OnFallback(const ProxyChain& bad_proxy, int net_error) override;
   void OnSuccessfulRequestAfterFailures(
       const ProxyRetryInfoMap& proxy_retry_info) override {}
 
@@ -55,18 +77,71 @@ class NaiveProxyDelegate : public ProxyDelegate {
   void SetProxyResolutionService(
       ProxyResolutionService* proxy_resolution_service) override {}
 
-  // Returns empty if the padding type has not been negotiated.
+  // Returns empty if the padding type has not been negotiated, or not
+  // confirmed within the padding cache TTL.
   std::optional<PaddingType> GetProxyServerPaddingType(
       const ProxyChain& proxy_chain);
 
+  // Returns the most members of a bond the proxy joins, or 0 if it does not
+  // or has not replied yet.
+  int GetProxyServerBondMembers(const ProxyChain& proxy_chain) const;
+
+  // Records a successful tunnel through `proxy_chain`, which puts it back in
+  // rotation and feeds `connect_time` into its smoothed connect time.
+  void OnUpstreamConnected(const ProxyChain& proxy_chain,
+                           base::TimeDelta connect_time);
+  // Forgets the ranking, e.g. when it was measured on another network.
+  void ResetUpstreamStats();
+
  private:
+  struct UpstreamStats {
+    // Zero until measured, so new upstreams are tried first.
+    base::TimeDelta smoothed_connect_time;
+    int consecutive_failures = 0;
+    base::TimeTicks retry_time;
+  };
+
+  struct NegotiatedPaddingType {
+    PaddingType padding_type;
+    // When a tunnel response last confirmed it.
+    base::Time confirm_time;
+    // When it was last written to the padding cache file.
+    base::Time save_time;
+  };
+
   std::optional<PaddingType> ParsePaddingHeaders(
       const HttpResponseHeaders& headers);
+  // Rebuilds `tunnel_headers_` from `extra_headers_`.
+  void UpdateTunnelHeaders();
+  // Steps a SplitMix64 generator seeded from the CSPRNG once. The padding
+  // header only needs to vary, not to be unpredictable.
+  uint64_t NextPaddingBits();
+  void LoadPaddingCache();
+  void SavePaddingCache();
+
+  // base::ImportantFileWriter::BackgroundDataSerializer:
+  base::ImportantFileWriter::BackgroundDataProducerCallback
+  GetSerializedDataProducerForBackgroundSequence() override;
 
   HttpRequestHeaders extra_headers_;
-
-  // Empty value means padding type has not been negotiated.
-  std::map<ProxyChain, std::optional<PaddingType>> padding_type_by_server_;
+  // The headers of every tunnel request: a padding header of the longest
+  // size, overwritten per request, followed by `extra_headers_`.
+  HttpRequestHeaders tunnel_headers_;
+  uint64_t padding_state_;
+  bool fastopen_;
+
+  base::FilePath padding_cache_file_;
+  base::TimeDelta padding_cache_ttl_;
+  // Null without a padding cache file.
+  std::unique_ptr<base::ImportantFileWriter> padding_cache_writer_;
+
+  // Missing entries mean padding type has not been negotiated.
+  std::map<ProxyChain, NegotiatedPaddingType> padding_type_by_server_;
+  // From the last tunnel response of each proxy. Not saved in the padding
+  // cache, so it is learned again by the first tunnel after a restart.
+  std::map<ProxyChain, int> bond_members_by_server_;
+
+  std::map<ProxyChain, UpstreamStats> upstream_stats_;
 };
 
 class ClientPaddingDetectorDelegate {
@@ -85,11 +160,15 @@ class PaddingDetectorDelegate : public ClientPaddingDetectorDelegate {
 
   std::optional<PaddingType> GetClientPaddingType();
   std::optional<PaddingType> GetServerPaddingType();
+  // See NaiveProxyDelegate::GetProxyServerBondMembers().
+  int GetServerBondMembers();
   void SetClientPaddingType(PaddingType padding_type) override;
+  // For a connection routed to another upstream before connecting it.
+  void SetProxyChain(const ProxyChain& proxy_chain);
 
  private:
   NaiveProxyDelegate* naive_proxy_delegate_;
-  const ProxyChain& proxy_chain_;
+  const ProxyChain* proxy_chain_;
   ClientProtocol client_protocol_;
 
   std::optional<PaddingType> detected_client_padding_type_;
@@ -0,0 +1,19 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "build/build_config.h"
+#include "net/tools/naive/naive_main.h"
+
+#if BUILDFLAG(IS_APPLE)
+#include "base/allocator/early_zone_registration_apple.h"
+#endif
+
+int main(int argc, char* argv[]) {
+  // chrome/app/chrome_exe_main_mac.cc: main()
+#if BUILDFLAG(IS_APPLE)
+  partition_alloc::EarlyMallocZoneRegistration();
+#endif
+
+  return net::NaiveMain(argc, argv, /*embedding=*/nullptr);
+}
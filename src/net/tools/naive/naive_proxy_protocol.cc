@@ -0,0 +1,117 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/naive/naive_proxy_protocol.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "net/base/ip_address.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+namespace {
+constexpr std::string_view kV1Signature = "PROXY ";
+// "PROXY UNKNOWN" with the longest addresses and ports of TCP6, and CRLF.
+constexpr size_t kV1MaxSize = 107;
+constexpr std::string_view kV2Signature(
+    "\x0d\x0a\x0d\x0a\x00\x0d\x0a\x51\x55\x49\x54\x0a", 12);
+constexpr size_t kV2HeaderSize = 16;
+
+enum : uint8_t {
+  kV2CommandLocal = 0x20,
+  kV2CommandProxy = 0x21,
+  kV2TcpOverIPv4 = 0x11,
+  kV2UdpOverIPv4 = 0x12,
+  kV2TcpOverIPv6 = 0x21,
+  kV2UdpOverIPv6 = 0x22,
+};
+
+// Whether `data` is too short to tell it from the start of `signature`.
+bool IsPrefixOf(std::string_view data, std::string_view signature) {
+  return data.size() < signature.size() && base::StartsWith(signature, data);
+}
+
+uint16_t ReadUint16(std::string_view data, size_t offset) {
+  return static_cast<uint16_t>(static_cast<uint8_t>(data[offset]) << 8 |
+                               static_cast<uint8_t>(data[offset + 1]));
+}
+
+int ParseV1(std::string_view data, std::optional<IPEndPoint>* source) {
+  size_t end = data.substr(0, kV1MaxSize).find("\r\n");
+  if (end == std::string_view::npos)
+    return data.size() < kV1MaxSize ? 0 : ERR_INVALID_ARGUMENT;
+
+  std::vector<std::string_view> fields = base::SplitStringPiece(
+      data.substr(0, end), " ", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  // The rest of UNKNOWN is to be ignored.
+  if (fields.size() >= 2 && fields[1] == "UNKNOWN") {
+    *source = std::nullopt;
+    return end + 2;
+  }
+  if (fields.size() != 6 || (fields[1] != "TCP4" && fields[1] != "TCP6"))
+    return ERR_INVALID_ARGUMENT;
+  IPAddress address;
+  unsigned port;
+  if (!address.AssignFromIPLiteral(fields[2]) ||
+      address.IsIPv4() != (fields[1] == "TCP4") ||
+      !base::StringToUint(fields[4], &port) || port > 65535) {
+    return ERR_INVALID_ARGUMENT;
+  }
+  *source = IPEndPoint(address, port);
+  return end + 2;
+}
+
+int ParseV2(std::string_view data, std::optional<IPEndPoint>* source) {
+  if (data.size() < kV2HeaderSize)
+    return 0;
+  uint8_t command = data[12];
+  uint8_t family = data[13];
+  size_t size = kV2HeaderSize + ReadUint16(data, 14);
+  if ((command != kV2CommandLocal && command != kV2CommandProxy) ||
+      size > kMaxProxyProtocolHeaderSize) {
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (data.size() < size)
+    return 0;
+
+  // LOCAL connections are the load balancer's own, and carry no address.
+  *source = std::nullopt;
+  if (command == kV2CommandLocal)
+    return size;
+  auto bytes = base::as_byte_span(data);
+  if (family == kV2TcpOverIPv4 || family == kV2UdpOverIPv4) {
+    // Source and destination addresses, then their ports.
+    if (size < kV2HeaderSize + 12)
+      return ERR_INVALID_ARGUMENT;
+    *source = IPEndPoint(IPAddress(bytes.subspan(kV2HeaderSize, 4u)),
+                         ReadUint16(data, kV2HeaderSize + 8));
+  } else if (family == kV2TcpOverIPv6 || family == kV2UdpOverIPv6) {
+    if (size < kV2HeaderSize + 36)
+      return ERR_INVALID_ARGUMENT;
+    *source = IPEndPoint(IPAddress(bytes.subspan(kV2HeaderSize, 16u)),
+                         ReadUint16(data, kV2HeaderSize + 32));
+  }
+  // Unix sockets and unspecified families keep the load balancer's address.
+  return size;
+}
+}  // namespace
+
+int ParseProxyProtocolHeader(std::string_view data,
+                             std::optional<IPEndPoint>* source) {
+  if (IsPrefixOf(data, kV1Signature) || IsPrefixOf(data, kV2Signature))
+    return 0;
+  if (base::StartsWith(data, kV1Signature))
+    return ParseV1(data, source);
+  if (base::StartsWith(data, kV2Signature))
+    return ParseV2(data, source);
+  return ERR_INVALID_ARGUMENT;
+}
+
+}  // namespace net
@@ -0,0 +1,29 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_NAIVE_NAIVE_PROXY_PROTOCOL_H_
+#define NET_TOOLS_NAIVE_NAIVE_PROXY_PROTOCOL_H_
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "net/base/ip_endpoint.h"
+
+namespace net {
+
+// Largest PROXY protocol header accepted, enough for the TLVs load
+// balancers add to version 2 headers.
+inline constexpr size_t kMaxProxyProtocolHeaderSize = 4096;
+
+// Parses the PROXY protocol header, version 1 or 2, that a load balancer
+// sends ahead of the client's bytes. Returns the size of the header,
+// 0 if `data` is a valid but incomplete start of one, or
+// ERR_INVALID_ARGUMENT. `source` is the client's address, or nullopt for
+// health checks of the load balancer itself and unknown protocols.
+int ParseProxyProtocolHeader(std::string_view data,
+                             std::optional<IPEndPoint>* source);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_PROXY_PROTOCOL_H_
@@ -0,0 +1,844 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_quic_server.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/current_thread.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/net_errors.h"
+#include "net/base/sockaddr_storage.h"
+#include "net/quic/address_utils.h"
+#include "net/quic/platform/impl/quic_chromium_clock.h"
+#include "net/quic/quic_chromium_alarm_factory.h"
+#include "net/quic/quic_chromium_connection_helper.h"
+#include "net/spdy/spdy_http_utils.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/proof_source.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/quic_crypto_server_config.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/quic_random.h"
+#include "net/third_party/quiche/src/quiche/quic/core/deterministic_connection_id_generator.h"
+#include "net/third_party/quiche/src/quiche/quic/core/http/quic_server_session_base.h"
+#include "net/third_party/quiche/src/quiche/quic/core/http/quic_spdy_server_stream_base.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_config.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_connection.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_dispatcher.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_packet_writer.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_packets.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_version_manager.h"
+#include "net/tools/naive/naive_bond_socket.h"
+#include "net/tools/naive/naive_proxy_delegate.h"
+
+namespace net {
+
+namespace {
+// Packets taken per wakeup with one recvmmsg(2).
+constexpr int kBatchSize = 32;
+// Like QuicSimpleServer.
+constexpr size_t kNumSessionsToCreatePerSocketEvent = 16;
+// Holds the bursts arriving between wakeups.
+constexpr int kSocketBufferSize = 4 * 1024 * 1024;
+// Clients open another session past it.
+constexpr uint32_t kMaxConcurrentStreams = 256;
+// The receive windows of the https:// listener.
+constexpr uint64_t kStreamWindowSize = 6 * 1024 * 1024;
+constexpr uint64_t kSessionWindowSize = 15 * 1024 * 1024;
+// Like HttpProxyServerSocket.
+constexpr int kMinPaddingSize = 30;
+constexpr int kMaxPaddingSize = kMinPaddingSize + 32;
+
+// Writes one packet per sendto(2), as the batch and GSO writers of QUICHE
+// are not part of the build. Blocks until the socket is writable again.
+class PacketWriter : public quic::QuicPacketWriter {
+ public:
+  PacketWriter(int fd, base::RepeatingClosure blocked_callback)
+      : fd_(fd), blocked_callback_(std::move(blocked_callback)) {}
+  PacketWriter(const PacketWriter&) = delete;
+  PacketWriter& operator=(const PacketWriter&) = delete;
+
+  // quic::QuicPacketWriter implementation.
+  quic::WriteResult WritePacket(
+      const char* buffer,
+      size_t buf_len,
+      const quic::QuicIpAddress& self_address,
+      const quic::QuicSocketAddress& peer_address,
+      quic::PerPacketOptions* options,
+      const quic::QuicPacketWriterParams& params) override {
+    DCHECK(!write_blocked_);
+    SockaddrStorage storage;
+    if (!ToIPEndPoint(peer_address).ToSockAddr(storage.addr,
+                                                &storage.addr_len)) {
+      return quic::WriteResult(quic::WRITE_STATUS_ERROR, EINVAL);
+    }
+    ssize_t rv = HANDLE_EINTR(sendto(fd_, buffer, buf_len, MSG_DONTWAIT,
+                                     storage.addr, storage.addr_len));
+    if (rv >= 0)
+      return quic::WriteResult(quic::WRITE_STATUS_OK, rv);
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      write_blocked_ = true;
+      blocked_callback_.Run();
+      return quic::WriteResult(quic::WRITE_STATUS_BLOCKED, errno);
+    }
+    return quic::WriteResult(quic::WRITE_STATUS_ERROR, errno);
+  }
+  bool IsWriteBlocked() const override { return write_blocked_; }
+  void SetWritable() override { write_blocked_ = false; }
+  std::optional<int> MessageTooBigErrorCode() const override {
+    return EMSGSIZE;
+  }
+  quic::QuicByteCount GetMaxPacketSize(
+      const quic::QuicSocketAddress& peer_address) const override {
+    return quic::kMaxOutgoingPacketSize;
+  }
+  bool SupportsReleaseTime() const override { return false; }
+  bool IsBatchMode() const override { return false; }
+  bool SupportsEcn() const override { return false; }
+  quic::QuicPacketBuffer GetNextWriteLocation(
+      const quic::QuicIpAddress& self_address,
+      const quic::QuicSocketAddress& peer_address) override {
+    return {nullptr, nullptr};
+  }
+  quic::WriteResult Flush() override {
+    return quic::WriteResult(quic::WRITE_STATUS_OK, 0);
+  }
+
+ private:
+  const int fd_;
+  const base::RepeatingClosure blocked_callback_;
+  bool write_blocked_ = false;
+};
+
+// Accepts every client, as clients are authenticated by the upstream.
+class CryptoStreamHelper : public quic::QuicCryptoServerStreamBase::Helper {
+ public:
+  bool CanAcceptClientHello(const quic::CryptoHandshakeMessage& message,
+                            const quic::QuicSocketAddress& client_address,
+                            const quic::QuicSocketAddress& peer_address,
+                            const quic::QuicSocketAddress& self_address,
+                            std::string* error_details) const override {
+    return true;
+  }
+};
+
+class Session : public quic::QuicServerSessionBase {
+ public:
+  Session(const quic::QuicConfig& config,
+          const quic::ParsedQuicVersionVector& supported_versions,
+          quic::QuicConnection* connection,
+          quic::QuicSession::Visitor* visitor,
+          quic::QuicCryptoServerStreamBase::Helper* helper,
+          const quic::QuicCryptoServerConfig* crypto_config,
+          quic::QuicCompressedCertsCache* compressed_certs_cache,
+          NaiveQuicServer* server)
+      : quic::QuicServerSessionBase(config,
+                                    supported_versions,
+                                    connection,
+                                    visitor,
+                                    helper,
+                                    crypto_config,
+                                    compressed_certs_cache),
+        server_(server) {}
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+  ~Session() override { DeleteConnection(); }
+
+ protected:
+  // quic::QuicServerSessionBase implementation.
+  quic::QuicSpdyStream* CreateIncomingStream(quic::QuicStreamId id) override;
+  quic::QuicSpdyStream* CreateIncomingStream(
+      quic::PendingStream* pending) override;
+  // The server opens no streams of its own.
+  quic::QuicSpdyStream* CreateOutgoingBidirectionalStream() override {
+    return nullptr;
+  }
+  quic::QuicSpdyStream* CreateOutgoingUnidirectionalStream() override {
+    return nullptr;
+  }
+  std::unique_ptr<quic::QuicCryptoServerStreamBase>
+  CreateQuicCryptoServerStream(
+      const quic::QuicCryptoServerConfig* crypto_config,
+      quic::QuicCompressedCertsCache* compressed_certs_cache) override {
+    return quic::CreateCryptoServerStream(crypto_config, compressed_certs_cache,
+                                          this, stream_helper());
+  }
+  quic::QuicStream* ProcessBidirectionalPendingStream(
+      quic::PendingStream* pending) override {
+    return CreateIncomingStream(pending);
+  }
+
+ private:
+  NaiveQuicServer* server_;
+};
+
+class Dispatcher : public quic::QuicDispatcher {
+ public:
+  Dispatcher(const quic::QuicConfig* config,
+             const quic::QuicCryptoServerConfig* crypto_config,
+             quic::QuicVersionManager* version_manager,
+             std::unique_ptr<quic::QuicConnectionHelperInterface> helper,
+             std::unique_ptr<quic::QuicCryptoServerStreamBase::Helper>
+                 session_helper,
+             std::unique_ptr<quic::QuicAlarmFactory> alarm_factory,
+             quic::ConnectionIdGeneratorInterface& connection_id_generator,
+             NaiveQuicServer* server)
+      : quic::QuicDispatcher(config,
+                             crypto_config,
+                             version_manager,
+                             std::move(helper),
+                             std::move(session_helper),
+                             std::move(alarm_factory),
+                             quic::kQuicDefaultConnectionIdLength,
+                             connection_id_generator),
+        server_(server) {}
+  Dispatcher(const Dispatcher&) = delete;
+  Dispatcher& operator=(const Dispatcher&) = delete;
+
+ protected:
+  // quic::QuicDispatcher implementation.
+  std::unique_ptr<quic::QuicSession> CreateQuicSession(
+      quic::QuicConnectionId server_connection_id,
+      const quic::QuicSocketAddress& self_address,
+      const quic::QuicSocketAddress& peer_address,
+      std::string_view alpn,
+      const quic::ParsedQuicVersion& version,
+      const quic::ParsedClientHello& parsed_chlo,
+      quic::ConnectionIdGeneratorInterface& connection_id_generator)
+      override {
+    // Owned by the session.
+    auto* connection = new quic::QuicConnection(
+        server_connection_id, self_address, peer_address, helper(),
+        alarm_factory(), writer(), /*owns_writer=*/false,
+        quic::Perspective::IS_SERVER, quic::ParsedQuicVersionVector{version},
+        connection_id_generator);
+    auto session = std::make_unique<Session>(
+        config(), GetSupportedVersions(), connection, this, session_helper(),
+        crypto_config(), compressed_certs_cache(), server_);
+    session->Initialize();
+    // Keeps the padding of responses out of the dynamic table.
+    session->qpack_encoder()->SetIndexingPolicy(&ShouldIndexHeader);
+    return session;
+  }
+
+ private:
+  NaiveQuicServer* server_;
+};
+}  // namespace
+
+// A request stream of a Session, handed over as a NaiveQuicServerStream
+// once it is a valid CONNECT.
+class NaiveHttp3Stream : public quic::QuicSpdyServerStreamBase {
+ public:
+  NaiveHttp3Stream(quic::QuicStreamId id,
+                   quic::QuicSpdySession* session,
+                   NaiveQuicServer* server)
+      : quic::QuicSpdyServerStreamBase(id, session, quic::BIDIRECTIONAL),
+        server_(server) {}
+  NaiveHttp3Stream(quic::PendingStream* pending,
+                   quic::QuicSpdySession* session,
+                   NaiveQuicServer* server)
+      : quic::QuicSpdyServerStreamBase(pending, session), server_(server) {}
+  NaiveHttp3Stream(const NaiveHttp3Stream&) = delete;
+  NaiveHttp3Stream& operator=(const NaiveHttp3Stream&) = delete;
+  ~NaiveHttp3Stream() override { DetachSocket(); }
+
+  // Called by NaiveQuicServerStream.
+  void SendTunnelResponse(bool has_padding_type_request,
+                          PaddingType padding_type,
+                          bool bond_reply) {
+    std::string padding(base::RandInt(kMinPaddingSize, kMaxPaddingSize), '\0');
+    FillNonindexHeaderValue(base::RandUint64(), padding.data(),
+                            padding.size());
+    spdy::Http2HeaderBlock headers;
+    headers[":status"] = "200";
+    headers[kPaddingHeader] = std::move(padding);
+    // Clients not asking for a type infer it from the padding header.
+    if (has_padding_type_request) {
+      headers[kPaddingTypeReplyHeader] = ToString(padding_type);
+    }
+    if (bond_reply) {
+      headers[kBondReplyHeader] =
+          base::NumberToString(NaiveBondSocket::kMaxMembers);
+    }
+    WriteHeaders(std::move(headers), /*fin=*/false, nullptr);
+    responded_ = true;
+  }
+  int ReadTunnel(IOBuffer* buf, int buf_len) {
+    if (HasBytesToRead()) {
+      struct iovec iov = {buf->data(), static_cast<size_t>(buf_len)};
+      return static_cast<int>(Readv(&iov, 1));
+    }
+    if (sequencer()->IsClosed()) {
+      // All of the body and the FIN are consumed.
+      if (!read_side_closed())
+        OnFinRead();
+      return 0;
+    }
+    // Reset by the client.
+    if (read_side_closed())
+      return ERR_CONNECTION_CLOSED;
+    return ERR_IO_PENDING;
+  }
+  int WriteTunnel(IOBuffer* buf, int buf_len) {
+    if (write_side_closed() || fin_buffered())
+      return ERR_CONNECTION_CLOSED;
+    if (!CanWriteNewData())
+      return ERR_IO_PENDING;
+    WriteOrBufferBody(std::string_view(buf->data(), buf_len), /*fin=*/false);
+    return buf_len;
+  }
+  quic::QuicSocketAddress peer_address() { return session()->peer_address(); }
+  quic::QuicSocketAddress self_address() { return session()->self_address(); }
+  // Sends a FIN once what was written to it is sent, reads going on.
+  void ShutdownTunnel() {
+    if (!write_side_closed() && !fin_buffered())
+      WriteOrBufferBody("", /*fin=*/true);
+  }
+  // Ends the stream once what was written to it is sent.
+  void CloseTunnel() {
+    socket_ = nullptr;
+    if (!responded_) {
+      Reset(quic::QUIC_REFUSED_STREAM);
+      return;
+    }
+    if (!write_side_closed() && !fin_buffered())
+      WriteOrBufferBody("", /*fin=*/true);
+    // Discards what the client still sends.
+    if (!read_side_closed())
+      StopReading();
+  }
+
+  // quic::QuicSpdyStream implementation.
+  void OnInitialHeadersComplete(
+      bool fin,
+      size_t frame_len,
+      const quic::QuicHeaderList& header_list) override;
+  void OnBodyAvailable() override { NotifySocket(); }
+  void OnCanWriteNewData() override { NotifySocket(); }
+  void OnStreamReset(const quic::QuicRstStreamFrame& frame) override {
+    quic::QuicSpdyServerStreamBase::OnStreamReset(frame);
+    NotifySocket();
+  }
+  bool OnStopSending(quic::QuicResetStreamError error) override {
+    bool rv = quic::QuicSpdyServerStreamBase::OnStopSending(error);
+    NotifySocket();
+    return rv;
+  }
+  void OnClose() override {
+    quic::QuicSpdyServerStreamBase::OnClose();
+    DetachSocket();
+  }
+
+ private:
+  void RespondAndClose(std::string_view status) {
+    spdy::Http2HeaderBlock headers;
+    headers[":status"] = status;
+    WriteHeaders(std::move(headers), /*fin=*/true, nullptr);
+    responded_ = true;
+  }
+  void NotifySocket() {
+    if (socket_)
+      socket_->NotifySoon();
+  }
+  void DetachSocket() {
+    if (socket_) {
+      socket_->OnStreamClosed();
+      socket_ = nullptr;
+    }
+  }
+
+  NaiveQuicServer* server_;
+  // Null before the tunnel is started and once its socket is gone.
+  NaiveQuicServerStream* socket_ = nullptr;
+  bool responded_ = false;
+};
+
+void NaiveHttp3Stream::OnInitialHeadersComplete(
+    bool fin,
+    size_t frame_len,
+    const quic::QuicHeaderList& header_list) {
+  quic::QuicSpdyServerStreamBase::OnInitialHeadersComplete(fin, frame_len,
+                                                           header_list);
+  // Invalid headers reset the stream.
+  if (rst_sent() || write_side_closed())
+    return;
+  std::string method;
+  std::string authority;
+  bool has_protocol = false;
+  bool has_padding = false;
+  std::optional<std::string> padding_type_request;
+  bool bond_request = false;
+  for (const auto& [key, value] : this->header_list()) {
+    if (key == ":method") {
+      method = value;
+    } else if (key == ":authority") {
+      authority = value;
+    } else if (key == ":protocol") {
+      has_protocol = true;
+    } else if (key == kPaddingHeader) {
+      has_padding = true;
+    } else if (key == kPaddingTypeRequestHeader) {
+      padding_type_request = value;
+    } else if (key == kBondRequestHeader) {
+      bond_request = true;
+    }
+  }
+  ConsumeHeaderList();
+
+  // Not a proxy client.
+  if (method != "CONNECT") {
+    RespondAndClose("405");
+    return;
+  }
+  // Extended CONNECT, such as CONNECT-UDP, is not served.
+  if (has_protocol) {
+    RespondAndClose("501");
+    return;
+  }
+  HostPortPair request_endpoint = HostPortPair::FromString(authority);
+  if (request_endpoint.IsEmpty()) {
+    RespondAndClose("400");
+    return;
+  }
+  std::optional<std::string_view> padding_type_request_view;
+  if (padding_type_request) {
+    padding_type_request_view = *padding_type_request;
+  }
+  std::optional<PaddingType> padding_type =
+      NegotiatePaddingType(has_padding, padding_type_request_view,
+                           server_->supported_padding_types_);
+  if (!padding_type.has_value()) {
+    RespondAndClose("400");
+    return;
+  }
+
+  auto socket = std::make_unique<NaiveQuicServerStream>(
+      this, request_endpoint, *padding_type, padding_type_request.has_value(),
+      bond_request && server_->accept_bonds_, server_->net_log_);
+  socket_ = socket.get();
+  server_->AddTunnel(std::move(socket));
+}
+
+namespace {
+quic::QuicSpdyStream* Session::CreateIncomingStream(quic::QuicStreamId id) {
+  if (!ShouldCreateIncomingStream(id))
+    return nullptr;
+  auto* stream = new NaiveHttp3Stream(id, this, server_);
+  ActivateStream(base::WrapUnique(stream));
+  return stream;
+}
+
+quic::QuicSpdyStream* Session::CreateIncomingStream(
+    quic::PendingStream* pending) {
+  auto* stream = new NaiveHttp3Stream(pending, this, server_);
+  ActivateStream(base::WrapUnique(stream));
+  return stream;
+}
+}  // namespace
+
+NaiveQuicServer::NaiveQuicServer(
+    std::unique_ptr<quic::ProofSource> proof_source,
+    const std::vector<PaddingType>& supported_padding_types,
+    bool accept_bonds,
+    const std::string& source_address_token_secret,
+    const NetLogWithSource& net_log)
+    : supported_padding_types_(supported_padding_types),
+      accept_bonds_(accept_bonds),
+      net_log_(net_log),
+      task_runner_(base::SingleThreadTaskRunner::GetCurrentDefault()),
+      config_(std::make_unique<quic::QuicConfig>()),
+      crypto_config_(std::make_unique<quic::QuicCryptoServerConfig>(
+          source_address_token_secret.empty()
+              ? base::RandBytesAsString(32)
+              : source_address_token_secret,
+          quic::QuicRandom::GetInstance(),
+          std::move(proof_source),
+          quic::KeyExchangeSource::Default())),
+      version_manager_(std::make_unique<quic::QuicVersionManager>(
+          quic::CurrentSupportedHttp3Versions())),
+      connection_id_generator_(
+          std::make_unique<quic::DeterministicConnectionIdGenerator>(
+              quic::kQuicDefaultConnectionIdLength)),
+      read_buffer_(kBatchSize * quic::kMaxIncomingPacketSize),
+      read_watcher_(FROM_HERE),
+      write_watcher_(FROM_HERE) {
+  config_->SetMaxBidirectionalStreamsToSend(kMaxConcurrentStreams);
+  config_->SetInitialStreamFlowControlWindowToSend(kStreamWindowSize);
+  config_->SetInitialSessionFlowControlWindowToSend(kSessionWindowSize);
+  crypto_config_->AddDefaultConfig(
+      quic::QuicRandom::GetInstance(), quic::QuicChromiumClock::GetInstance(),
+      quic::QuicCryptoServerConfig::ConfigOptions());
+}
+
+NaiveQuicServer::~NaiveQuicServer() {
+  // Closes the connections, failing their tunnels.
+  if (dispatcher_)
+    dispatcher_->Shutdown();
+}
+
+int NaiveQuicServer::Listen(const IPEndPoint& address,
+                            int backlog,
+                            std::optional<bool> ipv6_only) {
+  DCHECK(!socket_.is_valid());
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+  base::ScopedFD fd(socket(storage.addr->sa_family,
+                           SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (!fd.is_valid())
+    return MapSystemError(errno);
+  int on = 1;
+  if (setsockopt(fd.get(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+    return MapSystemError(errno);
+  if (ipv6_only.has_value() && address.GetFamily() == ADDRESS_FAMILY_IPV6) {
+    int v6_only = *ipv6_only;
+    if (setsockopt(fd.get(), IPPROTO_IPV6, IPV6_V6ONLY, &v6_only,
+                   sizeof(v6_only)) != 0) {
+      return MapSystemError(errno);
+    }
+  }
+  // Best effort, capped by net.core.rmem_max and wmem_max.
+  int buffer_size = kSocketBufferSize;
+  setsockopt(fd.get(), SOL_SOCKET, SO_RCVBUF, &buffer_size,
+             sizeof(buffer_size));
+  setsockopt(fd.get(), SOL_SOCKET, SO_SNDBUF, &buffer_size,
+             sizeof(buffer_size));
+  if (bind(fd.get(), storage.addr, storage.addr_len) != 0)
+    return MapSystemError(errno);
+  SockaddrStorage local;
+  if (getsockname(fd.get(), local.addr, &local.addr_len) != 0)
+    return MapSystemError(errno);
+  if (!local_address_.FromSockAddr(local.addr, local.addr_len))
+    return ERR_ADDRESS_INVALID;
+  socket_ = std::move(fd);
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          socket_.get(), /*persistent=*/true,
+          base::MessagePumpForIO::WATCH_READ, &read_watcher_, this)) {
+    socket_.reset();
+    return ERR_UNEXPECTED;
+  }
+
+  const quic::QuicClock* clock = quic::QuicChromiumClock::GetInstance();
+  dispatcher_ = std::make_unique<Dispatcher>(
+      config_.get(), crypto_config_.get(), version_manager_.get(),
+      std::make_unique<QuicChromiumConnectionHelper>(
+          clock, quic::QuicRandom::GetInstance()),
+      std::make_unique<CryptoStreamHelper>(),
+      std::make_unique<QuicChromiumAlarmFactory>(task_runner_.get(), clock),
+      *connection_id_generator_, this);
+  // Unretained is safe because the writer is owned by `dispatcher_`.
+  writer_ = new PacketWriter(
+      socket_.get(), base::BindRepeating(&NaiveQuicServer::OnWriteBlocked,
+                                         base::Unretained(this)));
+  dispatcher_->InitializeWithWriter(writer_);
+  return OK;
+}
+
+int NaiveQuicServer::GetLocalAddress(IPEndPoint* address) const {
+  if (!socket_.is_valid())
+    return ERR_SOCKET_NOT_CONNECTED;
+  *address = local_address_;
+  return OK;
+}
+
+int NaiveQuicServer::Accept(std::unique_ptr<StreamSocket>* socket,
+                            CompletionOnceCallback callback) {
+  DCHECK(!accept_callback_);
+  if (!tunnels_.empty()) {
+    *socket = std::move(tunnels_.front());
+    tunnels_.pop_front();
+    return OK;
+  }
+  accept_socket_ = socket;
+  accept_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+void NaiveQuicServer::OnFileCanReadWithoutBlocking(int fd) {
+  struct sockaddr_storage addresses[kBatchSize];
+  struct iovec iovs[kBatchSize];
+  struct mmsghdr msgs[kBatchSize];
+  for (int i = 0; i < kBatchSize; ++i) {
+    iovs[i] = {.iov_base = read_buffer_.data() +
+                           i * quic::kMaxIncomingPacketSize,
+               .iov_len = quic::kMaxIncomingPacketSize};
+    msgs[i] = {};
+    msgs[i].msg_hdr.msg_name = &addresses[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int count =
+      HANDLE_EINTR(recvmmsg(fd, msgs, kBatchSize, MSG_DONTWAIT, nullptr));
+  if (count < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG(INFO) << "DoRead: ignoring error "
+                << ErrorToShortString(MapSystemError(errno));
+    }
+    return;
+  }
+
+  const quic::QuicSocketAddress self_address =
+      ToQuicSocketAddress(local_address_);
+  const quic::QuicTime now = quic::QuicChromiumClock::GetInstance()->Now();
+  for (int i = 0; i < count; ++i) {
+    const struct msghdr& msg = msgs[i].msg_hdr;
+    IPEndPoint from;
+    if ((msg.msg_flags & MSG_TRUNC) ||
+        !from.FromSockAddr(reinterpret_cast<struct sockaddr*>(msg.msg_name),
+                           msg.msg_namelen)) {
+      continue;
+    }
+    quic::QuicReceivedPacket packet(
+        static_cast<const char*>(iovs[i].iov_base), msgs[i].msg_len, now);
+    dispatcher_->ProcessPacket(self_address, ToQuicSocketAddress(from),
+                               packet);
+  }
+  ProcessBufferedChlos();
+}
+
+void NaiveQuicServer::OnFileCanWriteWithoutBlocking(int fd) {
+  writer_->SetWritable();
+  dispatcher_->OnCanWrite();
+}
+
+void NaiveQuicServer::AddTunnel(std::unique_ptr<NaiveQuicServerStream> socket) {
+  tunnels_.push_back(std::move(socket));
+  if (!accept_callback_)
+    return;
+  task_runner_->PostTask(FROM_HERE,
+                         base::BindOnce(&NaiveQuicServer::CompleteAccept,
+                                        weak_ptr_factory_.GetWeakPtr()));
+}
+
+void NaiveQuicServer::CompleteAccept() {
+  if (!accept_callback_ || tunnels_.empty())
+    return;
+  *accept_socket_ = std::move(tunnels_.front());
+  tunnels_.pop_front();
+  accept_socket_ = nullptr;
+  std::move(accept_callback_).Run(OK);
+}
+
+void NaiveQuicServer::OnWriteBlocked() {
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          socket_.get(), /*persistent=*/false,
+          base::MessagePumpForIO::WATCH_WRITE, &write_watcher_, this)) {
+    LOG(ERROR) << "WatchFileDescriptor failed on QUIC socket";
+  }
+}
+
+void NaiveQuicServer::ProcessBufferedChlos() {
+  dispatcher_->ProcessBufferedChlos(kNumSessionsToCreatePerSocketEvent);
+  if (!dispatcher_->HasChlosBuffered())
+    return;
+  task_runner_->PostTask(FROM_HERE,
+                         base::BindOnce(&NaiveQuicServer::ProcessBufferedChlos,
+                                        weak_ptr_factory_.GetWeakPtr()));
+}
+
+NaiveQuicServerStream::NaiveQuicServerStream(
+    NaiveHttp3Stream* stream,
+    const HostPortPair& request_endpoint,
+    PaddingType padding_type,
+    bool has_padding_type_request,
+    bool bond_reply,
+    const NetLogWithSource& net_log)
+    : stream_(stream),
+      request_endpoint_(request_endpoint),
+      padding_type_(padding_type),
+      has_padding_type_request_(has_padding_type_request),
+      bond_reply_(bond_reply),
+      net_log_(net_log) {}
+
+NaiveQuicServerStream::~NaiveQuicServerStream() {
+  Disconnect();
+}
+
+int NaiveQuicServerStream::Connect(CompletionOnceCallback callback) {
+  if (connected_)
+    return OK;
+  if (!stream_)
+    return ERR_CONNECTION_CLOSED;
+  stream_->SendTunnelResponse(has_padding_type_request_, padding_type_,
+                              bond_reply_);
+  connected_ = true;
+  return OK;
+}
+
+void NaiveQuicServerStream::Disconnect() {
+  connected_ = false;
+  if (stream_) {
+    stream_->CloseTunnel();
+    stream_ = nullptr;
+  }
+  read_buf_ = nullptr;
+  read_callback_.Reset();
+  write_buf_ = nullptr;
+  write_callback_.Reset();
+}
+
+bool NaiveQuicServerStream::IsConnected() const {
+  return connected_ && stream_;
+}
+
+bool NaiveQuicServerStream::IsConnectedAndIdle() const {
+  return IsConnected() && !stream_->HasBytesToRead();
+}
+
+const NetLogWithSource& NaiveQuicServerStream::NetLog() const {
+  return net_log_;
+}
+
+bool NaiveQuicServerStream::WasEverUsed() const {
+  return was_ever_used_;
+}
+
+NextProto NaiveQuicServerStream::GetNegotiatedProtocol() const {
+  return kProtoQUIC;
+}
+
+bool NaiveQuicServerStream::GetSSLInfo(SSLInfo* ssl_info) {
+  return false;
+}
+
+int64_t NaiveQuicServerStream::GetTotalReceivedBytes() const {
+  return total_received_bytes_;
+}
+
+void NaiveQuicServerStream::ApplySocketTag(const SocketTag& tag) {
+  // Shares the UDP socket with the other streams.
+}
+
+int NaiveQuicServerStream::ShutdownWrite() {
+  DCHECK(!write_callback_);
+  if (!IsConnected())
+    return ERR_SOCKET_NOT_CONNECTED;
+  stream_->ShutdownTunnel();
+  return OK;
+}
+
+int NaiveQuicServerStream::Read(IOBuffer* buf,
+                                int buf_len,
+                                CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  DCHECK(callback);
+  int rv = DoRead(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    read_buf_ = buf;
+    read_buf_len_ = buf_len;
+    read_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveQuicServerStream::Write(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  DCHECK(!write_callback_);
+  DCHECK(callback);
+  int rv = DoWrite(buf, buf_len);
+  if (rv == ERR_IO_PENDING) {
+    write_buf_ = buf;
+    write_buf_len_ = buf_len;
+    write_callback_ = std::move(callback);
+  }
+  return rv;
+}
+
+int NaiveQuicServerStream::SetReceiveBufferSize(int32_t size) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveQuicServerStream::SetSendBufferSize(int32_t size) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveQuicServerStream::GetPeerAddress(IPEndPoint* address) const {
+  if (!stream_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  *address = ToIPEndPoint(stream_->peer_address());
+  return OK;
+}
+
+int NaiveQuicServerStream::GetLocalAddress(IPEndPoint* address) const {
+  if (!stream_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  *address = ToIPEndPoint(stream_->self_address());
+  return OK;
+}
+
+void NaiveQuicServerStream::OnStreamClosed() {
+  stream_ = nullptr;
+  NotifySoon();
+}
+
+void NaiveQuicServerStream::NotifySoon() {
+  if (notify_pending_ || (!read_callback_ && !write_callback_))
+    return;
+  notify_pending_ = true;
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveQuicServerStream::DoPendingIO,
+                                weak_ptr_factory_.GetWeakPtr()));
+}
+
+void NaiveQuicServerStream::DoPendingIO() {
+  notify_pending_ = false;
+  // The callbacks may disconnect this.
+  base::WeakPtr<NaiveQuicServerStream> self = weak_ptr_factory_.GetWeakPtr();
+  if (write_callback_) {
+    int rv = DoWrite(write_buf_.get(), write_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      write_buf_ = nullptr;
+      std::move(write_callback_).Run(rv);
+      if (!self)
+        return;
+    }
+  }
+  if (read_callback_) {
+    int rv = DoRead(read_buf_.get(), read_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      read_buf_ = nullptr;
+      std::move(read_callback_).Run(rv);
+    }
+  }
+}
+
+int NaiveQuicServerStream::DoRead(IOBuffer* buf, int buf_len) {
+  if (!stream_)
+    return ERR_CONNECTION_CLOSED;
+  int rv = stream_->ReadTunnel(buf, buf_len);
+  if (rv > 0) {
+    was_ever_used_ = true;
+    total_received_bytes_ += rv;
+  }
+  return rv;
+}
+
+int NaiveQuicServerStream::DoWrite(IOBuffer* buf, int buf_len) {
+  if (!stream_)
+    return ERR_CONNECTION_CLOSED;
+  int rv = stream_->WriteTunnel(buf, buf_len);
+  if (rv > 0)
+    was_ever_used_ = true;
+  return rv;
+}
+
+}  // namespace net
@@ -0,0 +1,202 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_QUIC_SERVER_H_
+#define NET_TOOLS_NAIVE_NAIVE_QUIC_SERVER_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/next_proto.h"
+#include "net/socket/server_socket.h"
+#include "net/socket/stream_socket.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace base {
+class SingleThreadTaskRunner;
+}
+
+namespace quic {
+class DeterministicConnectionIdGenerator;
+class ProofSource;
+class QuicConfig;
+class QuicCryptoServerConfig;
+class QuicDispatcher;
+class QuicPacketWriter;
+class QuicVersionManager;
+}  // namespace quic
+
+namespace net {
+
+class NaiveHttp3Stream;
+class NaiveQuicServerStream;
+
+// Serves a quic:// listener on a UDP socket of its own, in place of an
+// HTTP/3 terminating frontend. Each CONNECT stream is accepted as a
+// NaiveQuicServerStream, with padding negotiated like HttpProxyServerSocket
+// does. The socket is bound with SO_REUSEPORT so each worker serves its
+// own, the kernel keeping the packets of a connection on one of them. With
+// `accept_bonds` tunnel responses tell clients asking that NaiveBondJoiner
+// joins their bonds. Source address tokens are minted with
+// `source_address_token_secret`, or a random secret if empty. Linux only.
+class NaiveQuicServer : public ServerSocket,
+                        public base::MessagePumpForIO::FdWatcher {
+ public:
+  NaiveQuicServer(std::unique_ptr<quic::ProofSource> proof_source,
+                  const std::vector<PaddingType>& supported_padding_types,
+                  bool accept_bonds,
+                  const std::string& source_address_token_secret,
+                  const NetLogWithSource& net_log);
+  ~NaiveQuicServer() override;
+  NaiveQuicServer(const NaiveQuicServer&) = delete;
+  NaiveQuicServer& operator=(const NaiveQuicServer&) = delete;
+
+  // ServerSocket implementation. `backlog` is ignored.
+  int Listen(const IPEndPoint& address,
+             int backlog,
+             std::optional<bool> ipv6_only) override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+  int Accept(std::unique_ptr<StreamSocket>* socket,
+             CompletionOnceCallback callback) override;
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  friend class NaiveHttp3Stream;
+
+  // Called by NaiveHttp3Stream with a new tunnel.
+  void AddTunnel(std::unique_ptr<NaiveQuicServerStream> socket);
+  // Completes the pending Accept() outside of the session adding the tunnel.
+  void CompleteAccept();
+  void OnWriteBlocked();
+  // Creates the sessions of the CHLOs buffered by the dispatcher.
+  void ProcessBufferedChlos();
+
+  const std::vector<PaddingType> supported_padding_types_;
+  const bool accept_bonds_;
+  NetLogWithSource net_log_;
+  const scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+
+  std::unique_ptr<quic::QuicConfig> config_;
+  std::unique_ptr<quic::QuicCryptoServerConfig> crypto_config_;
+  std::unique_ptr<quic::QuicVersionManager> version_manager_;
+  std::unique_ptr<quic::DeterministicConnectionIdGenerator>
+      connection_id_generator_;
+
+  base::ScopedFD socket_;
+  IPEndPoint local_address_;
+  // Holds the packets of a recvmmsg(2) batch.
+  std::vector<char> read_buffer_;
+  base::MessagePumpForIO::FdWatchController read_watcher_;
+  base::MessagePumpForIO::FdWatchController write_watcher_;
+  // Declared after the socket, as its sessions write to it on destruction.
+  std::unique_ptr<quic::QuicDispatcher> dispatcher_;
+  // Owned by `dispatcher_`.
+  quic::QuicPacketWriter* writer_ = nullptr;
+
+  // Tunnels not accepted yet.
+  std::deque<std::unique_ptr<NaiveQuicServerStream>> tunnels_;
+  std::unique_ptr<StreamSocket>* accept_socket_ = nullptr;
+  CompletionOnceCallback accept_callback_;
+
+  base::WeakPtrFactory<NaiveQuicServer> weak_ptr_factory_{this};
+};
+
+// One CONNECT stream of a NaiveQuicServer. Connect() sends the response.
+// Fails with ERR_CONNECTION_CLOSED once the stream is gone.
+class NaiveQuicServerStream : public StreamSocket {
+ public:
+  NaiveQuicServerStream(NaiveHttp3Stream* stream,
+                        const HostPortPair& request_endpoint,
+                        PaddingType padding_type,
+                        bool has_padding_type_request,
+                        bool bond_reply,
+                        const NetLogWithSource& net_log);
+  NaiveQuicServerStream(const NaiveQuicServerStream&) = delete;
+  NaiveQuicServerStream& operator=(const NaiveQuicServerStream&) = delete;
+
+  // On destruction Disconnect() is called.
+  ~NaiveQuicServerStream() override;
+
+  const HostPortPair& request_endpoint() const { return request_endpoint_; }
+  PaddingType padding_type() const { return padding_type_; }
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override;
+  void Disconnect() override;
+  bool IsConnected() const override;
+  bool IsConnectedAndIdle() const override;
+  const NetLogWithSource& NetLog() const override;
+  bool WasEverUsed() const override;
+  NextProto GetNegotiatedProtocol() const override;
+  bool GetSSLInfo(SSLInfo* ssl_info) override;
+  int64_t GetTotalReceivedBytes() const override;
+  void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override;
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override;
+  int SetReceiveBufferSize(int32_t size) override;
+  int SetSendBufferSize(int32_t size) override;
+  int GetPeerAddress(IPEndPoint* address) const override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+
+ private:
+  friend class NaiveHttp3Stream;
+
+  // Called by NaiveHttp3Stream once it is gone.
+  void OnStreamClosed();
+  // Retries the pending read and write in a new task, as the stream wakes
+  // the socket from within its QUIC session.
+  void NotifySoon();
+  void DoPendingIO();
+
+  int DoRead(IOBuffer* buf, int buf_len);
+  int DoWrite(IOBuffer* buf, int buf_len);
+
+  // Null once the stream is gone.
+  NaiveHttp3Stream* stream_;
+  const HostPortPair request_endpoint_;
+  const PaddingType padding_type_;
+  const bool has_padding_type_request_;
+  const bool bond_reply_;
+  NetLogWithSource net_log_;
+
+  bool connected_ = false;
+  bool was_ever_used_ = false;
+  int64_t total_received_bytes_ = 0;
+
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_ = 0;
+  CompletionOnceCallback read_callback_;
+  scoped_refptr<IOBuffer> write_buf_;
+  int write_buf_len_ = 0;
+  CompletionOnceCallback write_callback_;
+  bool notify_pending_ = false;
+
+  base::WeakPtrFactory<NaiveQuicServerStream> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_QUIC_SERVER_H_
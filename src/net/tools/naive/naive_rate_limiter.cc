@@ -0,0 +1,188 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_rate_limiter.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+namespace {
+// Waiting flows with tokens are served at most this often, which lets the
+// flows resumed before read and be charged first.
+constexpr base::TimeDelta kMinServeDelay = base::Milliseconds(1);
+// Holds at least a few reads, so a slow rate still reads in full buffers.
+constexpr double kMinBurst = 4 * NaiveRateLimiter::kQuantum;
+}  // namespace
+
+NaiveRateLimiter::Limit::Limit(int rate) {
+  set_rate(rate);
+  for (int i = 0; i < kNumDirections; ++i) {
+    tokens_[i] = burst_;
+  }
+}
+
+NaiveRateLimiter::Limit::~Limit() = default;
+
+void NaiveRateLimiter::Limit::set_rate(int rate) {
+  DCHECK_GT(rate, 0);
+  rate_ = rate;
+  burst_ = std::max(rate / 10.0, kMinBurst);
+  for (double& tokens : tokens_) {
+    tokens = std::min(tokens, burst_);
+  }
+}
+
+double NaiveRateLimiter::Limit::GetTokens(Direction direction,
+                                          base::TimeTicks now) {
+  if (!refill_time_[direction].is_null()) {
+    double refill = (now - refill_time_[direction]).InSecondsF() * rate_;
+    tokens_[direction] = std::min(tokens_[direction] + refill, burst_);
+  }
+  refill_time_[direction] = now;
+  return tokens_[direction];
+}
+
+base::TimeDelta NaiveRateLimiter::Limit::GetRefillDelay(Direction direction) {
+  if (tokens_[direction] >= 0)
+    return base::TimeDelta();
+  return base::Seconds(-tokens_[direction] / rate_);
+}
+
+NaiveRateLimiter::Flow::Flow(const LimitSet& limits, Direction direction)
+    : limiter_(NaiveRateLimiter::GetForCurrentThread()),
+      limits_(limits),
+      direction_(direction) {}
+
+NaiveRateLimiter::Flow::~Flow() {
+  if (next())
+    RemoveFromList();
+}
+
+bool NaiveRateLimiter::Flow::HasTokens(base::TimeTicks now) {
+  for (const scoped_refptr<Limit>& limit : limits_) {
+    if (limit && limit->GetTokens(direction_, now) < 0)
+      return false;
+  }
+  return true;
+}
+
+bool NaiveRateLimiter::Flow::WaitForTokens(base::OnceClosure callback) {
+  DCHECK(!next());
+  // Flows already waiting get their turn first.
+  if (limiter_->waiting_.empty() && HasTokens(base::TimeTicks::Now())) {
+    // Credit only counts while flows compete.
+    deficit_ = 0;
+    return true;
+  }
+  callback_ = std::move(callback);
+  limiter_->Enqueue(this);
+  return false;
+}
+
+void NaiveRateLimiter::Flow::Charge(int size) {
+  for (const scoped_refptr<Limit>& limit : limits_) {
+    if (limit)
+      limit->tokens_[direction_] -= size;
+  }
+  deficit_ -= size;
+}
+
+NaiveRateLimiter::NaiveRateLimiter() = default;
+
+NaiveRateLimiter::~NaiveRateLimiter() = default;
+
+// static
+NaiveRateLimiter* NaiveRateLimiter::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveRateLimiter>();
+}
+
+scoped_refptr<NaiveRateLimiter::Limit> NaiveRateLimiter::GetSharedLimit(
+    const std::string& key,
+    int rate) {
+  scoped_refptr<Limit>& limit = shared_limits_[key];
+  if (!limit) {
+    limit = base::MakeRefCounted<Limit>(rate);
+  } else if (limit->rate() != rate) {
+    limit->set_rate(rate);
+  }
+  return limit;
+}
+
+void NaiveRateLimiter::Enqueue(Flow* flow) {
+  waiting_.Append(flow);
+  ScheduleServe();
+}
+
+void NaiveRateLimiter::Serve() {
+  base::TimeTicks now = base::TimeTicks::Now();
+
+  // Instead of crediting every flow with tokens one round at a time, credits
+  // them with the rounds the first of them to be resumed needs at once.
+  int64_t rounds = -1;
+  for (base::LinkNode<Flow>* node = waiting_.head(); node != waiting_.end();
+       node = node->next()) {
+    Flow* flow = node->value();
+    if (!flow->HasTokens(now))
+      continue;
+    int64_t needed =
+        flow->deficit_ > 0 ? 0 : -flow->deficit_ / kQuantum + 1;
+    if (rounds < 0 || needed < rounds)
+      rounds = needed;
+  }
+
+  std::vector<base::OnceClosure> callbacks;
+  if (rounds >= 0) {
+    base::LinkNode<Flow>* node = waiting_.head();
+    while (node != waiting_.end()) {
+      Flow* flow = node->value();
+      node = node->next();
+      if (!flow->HasTokens(now))
+        continue;
+      flow->deficit_ += rounds * kQuantum;
+      if (flow->deficit_ > 0) {
+        flow->RemoveFromList();
+        callbacks.push_back(std::move(flow->callback_));
+      }
+    }
+  }
+  if (!waiting_.empty())
+    ScheduleServe();
+
+  // The flows read and wait again from within the callbacks.
+  for (base::OnceClosure& callback : callbacks) {
+    std::move(callback).Run();
+  }
+}
+
+void NaiveRateLimiter::ScheduleServe() {
+  if (serve_timer_.IsRunning())
+    return;
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeDelta delay = base::TimeDelta::Max();
+  for (base::LinkNode<Flow>* node = waiting_.head(); node != waiting_.end();
+       node = node->next()) {
+    Flow* flow = node->value();
+    base::TimeDelta flow_delay;
+    for (const scoped_refptr<Limit>& limit : flow->limits_) {
+      if (!limit)
+        continue;
+      limit->GetTokens(flow->direction_, now);
+      flow_delay =
+          std::max(flow_delay, limit->GetRefillDelay(flow->direction_));
+    }
+    delay = std::min(delay, flow_delay);
+  }
+  // Unretained is safe because the timer is owned by this.
+  serve_timer_.Start(FROM_HERE, std::max(delay, kMinServeDelay),
+                     base::BindOnce(&NaiveRateLimiter::Serve,
+                                    base::Unretained(this)));
+}
+
+}  // namespace net
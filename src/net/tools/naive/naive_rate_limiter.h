@@ -0,0 +1,123 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_RATE_LIMITER_H_
+#define NET_TOOLS_NAIVE_NAIVE_RATE_LIMITER_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "base/containers/linked_list.h"
+#include "base/functional/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+// Shapes the relay of the connections of an IO thread with token buckets of
+// bytes, which the relay directions are charged for after each read. A
+// direction finding one of its buckets empty waits, and the waiting ones are
+// resumed in deficit round-robin order once refilled, so a bulk transfer
+// sharing a bucket cannot hold off the others for long. Buckets are refilled
+// lazily, with one timer for all waiting directions.
+class NaiveRateLimiter {
+ public:
+  // Bytes a waiting direction is credited with in each round.
+  static constexpr int kQuantum = 16 * 1024;
+  // Buckets one direction can be subject to: of the IO thread, the listener
+  // and the user.
+  static constexpr size_t kMaxLimits = 3;
+
+  // A token bucket for each direction, of `rate` bytes a second each and
+  // holding up to a tenth of a second of it.
+  class Limit : public base::RefCounted<Limit> {
+   public:
+    explicit Limit(int rate);
+    Limit(const Limit&) = delete;
+    Limit& operator=(const Limit&) = delete;
+
+    int rate() const { return rate_; }
+    void set_rate(int rate);
+
+   private:
+    friend class base::RefCounted<Limit>;
+    friend class NaiveRateLimiter;
+
+    ~Limit();
+
+    // Returns the tokens of `direction` after refilling them up to `now`,
+    // negative while reads taken beyond them are being paid back.
+    double GetTokens(Direction direction, base::TimeTicks now);
+    // Returns how long until the tokens of `direction` are no longer
+    // negative.
+    base::TimeDelta GetRefillDelay(Direction direction);
+
+    int rate_;
+    double burst_;
+    double tokens_[kNumDirections];
+    base::TimeTicks refill_time_[kNumDirections];
+  };
+
+  // The limits a connection is subject to, unset ones null.
+  using LimitSet = std::array<scoped_refptr<Limit>, kMaxLimits>;
+
+  // One relay direction of a connection.
+  class Flow : public base::LinkNode<Flow> {
+   public:
+    Flow(const LimitSet& limits, Direction direction);
+    ~Flow();
+    Flow(const Flow&) = delete;
+    Flow& operator=(const Flow&) = delete;
+
+    // Returns true if the direction may read now. Otherwise returns false and
+    // runs `callback` once it may.
+    bool WaitForTokens(base::OnceClosure callback);
+    // Charges `size` bytes read to the buckets.
+    void Charge(int size);
+
+   private:
+    friend class NaiveRateLimiter;
+
+    // Whether none of the buckets is negative.
+    bool HasTokens(base::TimeTicks now);
+
+    NaiveRateLimiter* const limiter_;
+    const LimitSet limits_;
+    const Direction direction_;
+    // Bytes the flow may still read in the current round, negative after
+    // reading past it.
+    int64_t deficit_ = 0;
+    base::OnceClosure callback_;
+  };
+
+  NaiveRateLimiter();
+  NaiveRateLimiter(const NaiveRateLimiter&) = delete;
+  NaiveRateLimiter& operator=(const NaiveRateLimiter&) = delete;
+  ~NaiveRateLimiter();
+
+  // Returns the limiter of the calling thread, creating it on first use.
+  static NaiveRateLimiter* GetForCurrentThread();
+
+  // Returns the limit shared by all listeners of the thread with `key`, e.g.
+  // empty for the thread and the name of a user, taking `rate` if it
+  // changed.
+  scoped_refptr<Limit> GetSharedLimit(const std::string& key, int rate);
+
+ private:
+  void Enqueue(Flow* flow);
+  // Resumes the waiting flows that have tokens and credit left.
+  void Serve();
+  void ScheduleServe();
+
+  base::LinkedList<Flow> waiting_;
+  base::OneShotTimer serve_timer_;
+  std::map<std::string, scoped_refptr<Limit>> shared_limits_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_RATE_LIMITER_H_
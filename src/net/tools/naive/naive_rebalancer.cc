@@ -0,0 +1,79 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_rebalancer.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+
+namespace net {
+
+NaiveRebalancer::NaiveRebalancer(
+    std::vector<scoped_refptr<base::SingleThreadTaskRunner>> task_runners,
+    SampleCallback sample_callback,
+    MoveCallback move_callback)
+    : task_runners_(std::move(task_runners)),
+      sample_callback_(std::move(sample_callback)),
+      move_callback_(std::move(move_callback)),
+      bytes_(task_runners_.size()) {
+  DCHECK_GT(task_runners_.size(), 1u);
+  // Unretained is safe because the timer is owned by this.
+  timer_.Start(FROM_HERE, kInterval,
+               base::BindRepeating(&NaiveRebalancer::Sample,
+                                   base::Unretained(this)));
+}
+
+NaiveRebalancer::~NaiveRebalancer() = default;
+
+void NaiveRebalancer::Sample() {
+  // A worker busy enough to miss a whole interval is left to the next one.
+  if (pending_samples_ > 0)
+    return;
+  pending_samples_ = task_runners_.size();
+  for (size_t i = 0; i < task_runners_.size(); ++i) {
+    task_runners_[i]->PostTaskAndReplyWithResult(
+        FROM_HERE, base::BindOnce(sample_callback_),
+        base::BindOnce(&NaiveRebalancer::OnSampled,
+                       weak_ptr_factory_.GetWeakPtr(), i));
+  }
+}
+
+void NaiveRebalancer::OnSampled(size_t worker, uint64_t bytes) {
+  bytes_[worker] = bytes;
+  if (--pending_samples_ == 0)
+    Rebalance();
+}
+
+void NaiveRebalancer::Rebalance() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  if (!last_time_.is_null()) {
+    double seconds = (now - last_time_).InSecondsF();
+    size_t busiest = 0;
+    size_t idlest = 0;
+    std::vector<double> rates(bytes_.size());
+    for (size_t i = 0; i < bytes_.size(); ++i) {
+      rates[i] = (bytes_[i] - last_bytes_[i]) / seconds;
+      if (rates[i] > rates[busiest])
+        busiest = i;
+      if (rates[i] < rates[idlest])
+        idlest = i;
+    }
+    if (rates[busiest] > 2 * rates[idlest] &&
+        rates[busiest] - rates[idlest] >= kMinImbalance) {
+      VLOG(1) << "Rebalancing from worker " << busiest << " at "
+              << static_cast<int64_t>(rates[busiest]) << " bytes/s to worker "
+              << idlest << " at " << static_cast<int64_t>(rates[idlest])
+              << " bytes/s";
+      task_runners_[busiest]->PostTask(
+          FROM_HERE, base::BindOnce(move_callback_, busiest, idlest));
+    }
+  }
+  last_bytes_ = bytes_;
+  last_time_ = now;
+}
+
+}  // namespace net
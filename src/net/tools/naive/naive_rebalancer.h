@@ -0,0 +1,70 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_REBALANCER_H_
+#define NET_TOOLS_NAIVE_NAIVE_REBALANCER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+// Moves busy relays from the upstream worker relaying the most bytes to the
+// one relaying the fewest. SO_REUSEPORT spreads connections by count, not by
+// load, so long bulk transfers stay on whichever thread accepted them. Each
+// kInterval the workers report the bytes relayed so far. If the busiest
+// relayed over twice as fast as the idlest, and kMinImbalance bytes/s
+// faster, it hands its fastest relay that can move to the idlest, see
+// NaiveProxy::DetachBusiestRelay(). One relay moves per interval, so the
+// next pass sees the load the move shifted. Linux only.
+class NaiveRebalancer {
+ public:
+  static constexpr base::TimeDelta kInterval = base::Seconds(2);
+  static constexpr double kMinImbalance = 1024 * 1024;
+  // Relays younger than this are not worth moving yet.
+  static constexpr base::TimeDelta kMinRelayAge = base::Seconds(10);
+
+  // Runs on the thread of a worker, returning the bytes it relayed so far.
+  using SampleCallback = base::RepeatingCallback<uint64_t()>;
+  // Runs on the thread of worker `from`, handing its fastest relay that can
+  // move to worker `to`.
+  using MoveCallback = base::RepeatingCallback<void(size_t from, size_t to)>;
+
+  // Workers are indexed like `task_runners`.
+  NaiveRebalancer(
+      std::vector<scoped_refptr<base::SingleThreadTaskRunner>> task_runners,
+      SampleCallback sample_callback,
+      MoveCallback move_callback);
+  ~NaiveRebalancer();
+  NaiveRebalancer(const NaiveRebalancer&) = delete;
+  NaiveRebalancer& operator=(const NaiveRebalancer&) = delete;
+
+ private:
+  void Sample();
+  void OnSampled(size_t worker, uint64_t bytes);
+  void Rebalance();
+
+  const std::vector<scoped_refptr<base::SingleThreadTaskRunner>>
+      task_runners_;
+  const SampleCallback sample_callback_;
+  const MoveCallback move_callback_;
+  // Of the pass in progress and the last one.
+  std::vector<uint64_t> bytes_;
+  std::vector<uint64_t> last_bytes_;
+  base::TimeTicks last_time_;
+  size_t pending_samples_ = 0;
+  base::RepeatingTimer timer_;
+
+  base::WeakPtrFactory<NaiveRebalancer> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_REBALANCER_H_
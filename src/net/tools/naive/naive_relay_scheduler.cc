@@ -0,0 +1,76 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_relay_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/base_tracing.h"
+#include "net/tools/naive/naive_metrics.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+NaiveRelayScheduler::NaiveRelayScheduler()
+    : metrics_(NaiveMetrics::GetForCurrentThread()) {}
+
+NaiveRelayScheduler::~NaiveRelayScheduler() = default;
+
+// static
+NaiveRelayScheduler* NaiveRelayScheduler::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveRelayScheduler>();
+}
+
+int NaiveRelayScheduler::GetAdaptiveYieldBytes(int min_bytes) const {
+  return std::max(kAdaptiveYieldBytes / std::max(relays_, 1), min_bytes);
+}
+
+base::TimeDelta NaiveRelayScheduler::GetAdaptiveYieldInterval(
+    base::TimeDelta max_interval) const {
+  return std::max(max_interval / std::max(relays_, 1),
+                  kMinAdaptiveYieldInterval);
+}
+
+void NaiveRelayScheduler::Schedule(base::OnceClosure callback) {
+  run_queue_.push_back(std::move(callback));
+  PostBatch();
+}
+
+void NaiveRelayScheduler::PostBatch() {
+  if (batch_pending_)
+    return;
+  batch_pending_ = true;
+  // Unretained is safe because the scheduler lives as long as the thread.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&NaiveRelayScheduler::RunBatch,
+                                base::Unretained(this)));
+}
+
+void NaiveRelayScheduler::RunBatch() {
+  batch_pending_ = false;
+  size_t count = run_queue_.size();
+  if (batch_size_ > 0 && count > static_cast<size_t>(batch_size_)) {
+    count = batch_size_;
+    ++metrics_->relay_full_batches;
+  }
+  TRACE_EVENT("net", "NaiveRelayScheduler::RunBatch", "count", count,
+              "queued", run_queue_.size());
+  ++metrics_->relay_batches;
+  metrics_->relay_resumes += count;
+
+  // The directions may yield again from within the callbacks, queueing
+  // themselves behind the rest.
+  for (size_t i = 0; i < count; ++i) {
+    base::OnceClosure callback = std::move(run_queue_.front());
+    run_queue_.pop_front();
+    std::move(callback).Run();
+  }
+  if (!run_queue_.empty())
+    PostBatch();
+}
+
+}  // namespace net
@@ -0,0 +1,70 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_RELAY_SCHEDULER_H_
+#define NET_TOOLS_NAIVE_NAIVE_RELAY_SCHEDULER_H_
+
+#include <cstddef>
+
+#include "base/containers/circular_deque.h"
+#include "base/functional/callback.h"
+#include "base/time/time.h"
+
+namespace net {
+
+struct NaiveMetrics;
+
+// The run queue of the relay directions of an IO thread that yielded after
+// their budget of NaiveRelayConfig. Instead of posting a task per direction,
+// the queued directions are resumed from one task per pump iteration, up to
+// a batch size in the order they yielded, so the pump polls for I/O between
+// the batches. Directions yielding again within a batch wait for the next.
+class NaiveRelayScheduler {
+ public:
+  static constexpr int kAdaptiveYieldBytes = 1024 * 1024;
+  static constexpr base::TimeDelta kMinAdaptiveYieldInterval =
+      base::Milliseconds(1);
+
+  NaiveRelayScheduler();
+  NaiveRelayScheduler(const NaiveRelayScheduler&) = delete;
+  NaiveRelayScheduler& operator=(const NaiveRelayScheduler&) = delete;
+  ~NaiveRelayScheduler();
+
+  // Returns the scheduler of the calling thread, creating it on first use.
+  static NaiveRelayScheduler* GetForCurrentThread();
+
+  // Directions resumed per batch, 0 for all queued before it.
+  void set_batch_size(int batch_size) { batch_size_ = batch_size; }
+
+  size_t queued() const { return run_queue_.size(); }
+
+  // Counts the connections relaying on the thread, which share the adaptive
+  // budget below.
+  void AddRelay() { ++relays_; }
+  void RemoveRelay() { --relays_; }
+  int relays() const { return relays_; }
+
+  // The budget of a relay direction between yields with
+  // NaiveRelayConfig::yield_adaptive: kAdaptiveYieldBytes split among the
+  // relays, but at least `min_bytes`, and `max_interval` split likewise, but
+  // at least kMinAdaptiveYieldInterval. A single flow then yields rarely,
+  // and many flows take turns quickly.
+  int GetAdaptiveYieldBytes(int min_bytes) const;
+  base::TimeDelta GetAdaptiveYieldInterval(base::TimeDelta max_interval) const;
+
+  // Runs `callback` from a later batch.
+  void Schedule(base::OnceClosure callback);
+
+ private:
+  void PostBatch();
+  void RunBatch();
+
+  NaiveMetrics* const metrics_;
+  int batch_size_ = 0;
+  int relays_ = 0;
+  bool batch_pending_ = false;
+  base::circular_deque<base::OnceClosure> run_queue_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_RELAY_SCHEDULER_H_
@@ -0,0 +1,251 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_rio.h"
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "net/base/net_errors.h"
+#include "net/base/winsock_init.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+namespace {
+// Grown as request queues reserve room for their completions.
+constexpr DWORD kInitialQueueSize = 1024;
+constexpr ULONG kDequeueBatch = 64;
+}  // namespace
+
+NaiveRio::NaiveRio() = default;
+
+NaiveRio::~NaiveRio() {
+  watcher_.StopWatching();
+  if (queue_ != RIO_INVALID_CQ)
+    rio_.RIOCloseCompletionQueue(queue_);
+  for (const Chunk& chunk : chunks_) {
+    rio_.RIODeregisterBuffer(chunk.id);
+  }
+}
+
+// static
+NaiveRio* NaiveRio::GetForCurrentThread() {
+  // Setting up is only tried once per thread.
+  return GetOrCreateForCurrentThread<NaiveRio>(
+      []() -> std::unique_ptr<NaiveRio> {
+        auto rio = base::WrapUnique(new NaiveRio());
+        if (!rio->Init()) {
+          LOG(WARNING) << "Registered I/O is unavailable, relaying with IOCP";
+          return nullptr;
+        }
+        return rio;
+      });
+}
+
+bool NaiveRio::Init() {
+  EnsureWinsockInit();
+  // The function table is only handed out for sockets of Registered I/O.
+  SOCKET socket = ::WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
+                              WSA_FLAG_REGISTERED_IO);
+  if (socket == INVALID_SOCKET) {
+    LOG(WARNING) << "WSASocket failed: " << WSAGetLastError();
+    return false;
+  }
+  GUID guid = WSAID_MULTIPLE_RIO;
+  DWORD bytes = 0;
+  int rv = WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER,
+                    &guid, sizeof(guid), &rio_, sizeof(rio_), &bytes, nullptr,
+                    nullptr);
+  int error = WSAGetLastError();
+  closesocket(socket);
+  if (rv != 0) {
+    LOG(WARNING) << "Registered I/O functions not found: " << error;
+    return false;
+  }
+
+  event_.Set(CreateEvent(nullptr, /*bManualReset=*/FALSE,
+                         /*bInitialState=*/FALSE, nullptr));
+  if (!event_.is_valid()) {
+    PLOG(WARNING) << "CreateEvent failed";
+    return false;
+  }
+  RIO_NOTIFICATION_COMPLETION notification = {};
+  notification.Type = RIO_EVENT_COMPLETION;
+  notification.Event.EventHandle = event_.get();
+  notification.Event.NotifyReset = FALSE;
+  queue_ = rio_.RIOCreateCompletionQueue(kInitialQueueSize, &notification);
+  if (queue_ == RIO_INVALID_CQ) {
+    LOG(WARNING) << "RIOCreateCompletionQueue failed: " << WSAGetLastError();
+    return false;
+  }
+  queue_size_ = kInitialQueueSize;
+  if (!AddChunk())
+    return false;
+  Arm();
+  return true;
+}
+
+bool NaiveRio::AddChunk() {
+  if (static_cast<int>(chunks_.size()) * kChunkBuffers >= kMaxBuffers)
+    return false;
+  Chunk chunk;
+  // Not zeroed, which would touch all of it.
+  chunk.storage.reset(new char[kChunkBuffers * kBufferSize]);
+  chunk.id = rio_.RIORegisterBuffer(chunk.storage.get(),
+                                    kChunkBuffers * kBufferSize);
+  if (chunk.id == RIO_INVALID_BUFFERID) {
+    LOG(WARNING) << "RIORegisterBuffer failed: " << WSAGetLastError();
+    return false;
+  }
+  int first = static_cast<int>(chunks_.size()) * kChunkBuffers;
+  chunks_.push_back(std::move(chunk));
+  // Lower buffers are handed out first.
+  for (int i = first + kChunkBuffers - 1; i >= first; --i) {
+    free_buffers_.push_back(i);
+  }
+  return true;
+}
+
+RIO_RQ NaiveRio::CreateRequestQueue(SOCKET socket) {
+  for (;;) {
+    RIO_RQ queue = rio_.RIOCreateRequestQueue(
+        socket, /*MaxOutstandingReceive=*/1, /*MaxReceiveDataBuffers=*/1,
+        /*MaxOutstandingSend=*/1, /*MaxSendDataBuffers=*/1, queue_, queue_,
+        nullptr);
+    if (queue != RIO_INVALID_RQ)
+      return queue;
+    int error = WSAGetLastError();
+    // The completion queue has no room left for those of another request
+    // queue.
+    if (error != WSAENOBUFS || queue_size_ * 2 > RIO_MAX_CQ_SIZE ||
+        !rio_.RIOResizeCompletionQueue(queue_, queue_size_ * 2)) {
+      VLOG(1) << "RIOCreateRequestQueue failed: " << error;
+      return RIO_INVALID_RQ;
+    }
+    queue_size_ *= 2;
+  }
+}
+
+int NaiveRio::AllocateBuffer() {
+  if (free_buffers_.empty() && !AddChunk())
+    return -1;
+  int buffer_id = free_buffers_.back();
+  free_buffers_.pop_back();
+  return buffer_id;
+}
+
+void NaiveRio::ReleaseBuffer(int buffer_id) {
+  free_buffers_.push_back(buffer_id);
+}
+
+char* NaiveRio::buffer(int buffer_id) {
+  return chunks_[buffer_id / kChunkBuffers].storage.get() +
+         buffer_id % kChunkBuffers * kBufferSize;
+}
+
+RIO_BUF NaiveRio::GetBuf(int buffer_id, int size) const {
+  RIO_BUF buf;
+  buf.BufferId = chunks_[buffer_id / kChunkBuffers].id;
+  buf.Offset = buffer_id % kChunkBuffers * kBufferSize;
+  buf.Length = size;
+  return buf;
+}
+
+uint32_t NaiveRio::TakeSlot(Op* op, int buffer_id) {
+  DCHECK(!op->in_flight());
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = slots_.size();
+    slots_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot].op = op;
+  slots_[slot].buffer_id = buffer_id;
+  op->slot_ = slot + 1;
+  return op->slot_;
+}
+
+void NaiveRio::FreeSlot(uint32_t slot) {
+  slots_[slot - 1] = Slot();
+  free_slots_.push_back(slot - 1);
+}
+
+int NaiveRio::Receive(RIO_RQ queue, int buffer_id, Op* op) {
+  RIO_BUF buf = GetBuf(buffer_id, kBufferSize);
+  uint32_t slot = TakeSlot(op, buffer_id);
+  if (!rio_.RIOReceive(queue, &buf, 1, 0,
+                       reinterpret_cast<void*>(uintptr_t{slot}))) {
+    int error = WSAGetLastError();
+    FreeSlot(slot);
+    op->slot_ = 0;
+    return MapSystemError(error);
+  }
+  return OK;
+}
+
+int NaiveRio::Send(RIO_RQ queue, int buffer_id, int size, Op* op) {
+  DCHECK_LE(size, kBufferSize);
+  RIO_BUF buf = GetBuf(buffer_id, size);
+  uint32_t slot = TakeSlot(op, buffer_id);
+  if (!rio_.RIOSend(queue, &buf, 1, 0,
+                    reinterpret_cast<void*>(uintptr_t{slot}))) {
+    int error = WSAGetLastError();
+    FreeSlot(slot);
+    op->slot_ = 0;
+    return MapSystemError(error);
+  }
+  return OK;
+}
+
+void NaiveRio::Cancel(Op* op) {
+  if (!op->in_flight())
+    return;
+  // The slot stays taken until the request completes.
+  slots_[op->slot_ - 1].op = nullptr;
+  op->slot_ = 0;
+}
+
+void NaiveRio::Arm() {
+  watcher_.StartWatchingOnce(event_.get(), this);
+  // Fails with WSAEALREADY if still armed, which is as good.
+  rio_.RIONotify(queue_);
+}
+
+void NaiveRio::OnObjectSignaled(HANDLE object) {
+  RIORESULT results[kDequeueBatch];
+  for (;;) {
+    ULONG count =
+        rio_.RIODequeueCompletion(queue_, results, std::size(results));
+    CHECK_NE(count, RIO_CORRUPT_CQ);
+    for (ULONG i = 0; i < count; ++i) {
+      Dispatch(results[i]);
+    }
+    if (count < std::size(results))
+      break;
+  }
+  Arm();
+}
+
+void NaiveRio::Dispatch(const RIORESULT& result) {
+  uint32_t slot = static_cast<uint32_t>(result.RequestContext);
+  DCHECK_GT(slot, 0u);
+  Slot taken = slots_[slot - 1];
+  FreeSlot(slot);
+  if (!taken.op) {
+    // Cancelled, so the request was aborted by closing its socket.
+    ReleaseBuffer(taken.buffer_id);
+    return;
+  }
+  taken.op->slot_ = 0;
+  taken.op->OnComplete(result.Status, result.BytesTransferred);
+}
+
+}  // namespace net
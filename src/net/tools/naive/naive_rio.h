@@ -0,0 +1,122 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_RIO_H_
+#define NET_TOOLS_NAIVE_NAIVE_RIO_H_
+
+#include <winsock2.h>
+
+#include <mswsock.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/win/object_watcher.h"
+#include "base/win/scoped_handle.h"
+
+namespace net {
+
+// A Registered I/O completion queue of an IO thread, with the relay buffers
+// registered with it once in chunks, so receives and sends neither lock nor
+// map pages per operation like overlapped I/O does. Completions are
+// signalled by an event watched through the message pump and dequeued in
+// batches. Only sockets created with WSA_FLAG_REGISTERED_IO, see
+// SetRegisteredIoSockets(), can take requests. Windows only.
+class NaiveRio : public base::win::ObjectWatcher::Delegate {
+ public:
+  static constexpr int kBufferSize = 16 * 1024;
+  // Registered as needed in chunks of 1 MB.
+  static constexpr int kChunkBuffers = 64;
+  static constexpr int kMaxBuffers = 4096;
+
+  // A request of the queue.
+  class Op {
+   public:
+    bool in_flight() const { return slot_ != 0; }
+
+    // `status` is a Winsock error code, 0 on success. A receive of 0 bytes
+    // is EOF.
+    virtual void OnComplete(int status, int bytes) = 0;
+
+   protected:
+    ~Op() = default;
+
+   private:
+    friend class NaiveRio;
+
+    // The slot of the request in flight plus one, which is its request
+    // context, or 0.
+    uint32_t slot_ = 0;
+  };
+
+  NaiveRio(const NaiveRio&) = delete;
+  NaiveRio& operator=(const NaiveRio&) = delete;
+  ~NaiveRio() override;
+
+  // Returns the queue of the calling thread, setting it up on first use, or
+  // nullptr if Registered I/O is not available, i.e. before Windows 8.
+  static NaiveRio* GetForCurrentThread();
+
+  // Returns the request queue of `socket` for one receive and one send at a
+  // time, or RIO_INVALID_RQ, e.g. if the socket was created without
+  // WSA_FLAG_REGISTERED_IO. The queue is freed with the socket.
+  RIO_RQ CreateRequestQueue(SOCKET socket);
+
+  // Returns -1 if all kMaxBuffers are taken.
+  int AllocateBuffer();
+  void ReleaseBuffer(int buffer_id);
+  char* buffer(int buffer_id);
+
+  // Receives into the whole buffer. Each op may have one request at a time.
+  // Returns a net error if the request cannot be queued.
+  int Receive(RIO_RQ queue, int buffer_id, Op* op);
+  // Sends `size` bytes from the start of the buffer. Registered I/O sends
+  // all of them or fails.
+  int Send(RIO_RQ queue, int buffer_id, int size, Op* op);
+  // `op` is not called any more. Registered I/O cannot cancel requests, so
+  // they complete once the socket is closed, and the buffer of the request
+  // is released then.
+  void Cancel(Op* op);
+
+  // base::win::ObjectWatcher::Delegate implementation.
+  void OnObjectSignaled(HANDLE object) override;
+
+ private:
+  // A request in flight.
+  struct Slot {
+    // Null once cancelled.
+    Op* op = nullptr;
+    int buffer_id = -1;
+  };
+
+  NaiveRio();
+
+  bool Init();
+  bool AddChunk();
+  RIO_BUF GetBuf(int buffer_id, int size) const;
+  // Returns the request context for `op`.
+  uint32_t TakeSlot(Op* op, int buffer_id);
+  void FreeSlot(uint32_t slot);
+  void Arm();
+  void Dispatch(const RIORESULT& result);
+
+  RIO_EXTENSION_FUNCTION_TABLE rio_ = {};
+  base::win::ScopedHandle event_;
+  base::win::ObjectWatcher watcher_;
+  RIO_CQ queue_ = RIO_INVALID_CQ;
+  DWORD queue_size_ = 0;
+
+  struct Chunk {
+    std::unique_ptr<char[]> storage;
+    RIO_BUFFERID id = RIO_INVALID_BUFFERID;
+  };
+  std::vector<Chunk> chunks_;
+  std::vector<int> free_buffers_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_RIO_H_
@@ -0,0 +1,118 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_rio_relay.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/notreached.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+namespace {
+Direction Other(Direction d) {
+  return d == kClient ? kServer : kClient;
+}
+}  // namespace
+
+NaiveRioRelay::Pump::Pump(NaiveRioRelay* relay, Direction from)
+    : relay(relay), from(from) {}
+
+NaiveRioRelay::Pump::~Pump() = default;
+
+void NaiveRioRelay::Pump::OnComplete(int status, int bytes) {
+  relay->OnComplete(*this, status, bytes);
+}
+
+NaiveRioRelay::NaiveRioRelay(NaiveRio* rio,
+                             SOCKET client_socket,
+                             SOCKET server_socket)
+    : rio_(rio),
+      sockets_{client_socket, server_socket},
+      pumps_{Pump(this, kClient), Pump(this, kServer)} {}
+
+NaiveRioRelay::~NaiveRioRelay() {
+  Stop();
+}
+
+int NaiveRioRelay::Run(CompletionOnceCallback callback) {
+  DCHECK(!callback_);
+  for (Direction d : {kClient, kServer}) {
+    queues_[d] = rio_->CreateRequestQueue(sockets_[d]);
+    if (queues_[d] == RIO_INVALID_RQ)
+      return ERR_NOT_IMPLEMENTED;
+  }
+  for (Pump& pump : pumps_) {
+    pump.buffer_id = rio_->AllocateBuffer();
+    if (pump.buffer_id < 0) {
+      Stop();
+      return ERR_INSUFFICIENT_RESOURCES;
+    }
+  }
+  for (Pump& pump : pumps_) {
+    int rv = Receive(pump);
+    if (rv != OK) {
+      Stop();
+      return rv;
+    }
+  }
+  callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int NaiveRioRelay::Receive(Pump& pump) {
+  pump.state = Pump::kReceive;
+  return rio_->Receive(queues_[pump.from], pump.buffer_id, &pump);
+}
+
+int NaiveRioRelay::Send(Pump& pump, int size) {
+  pump.state = Pump::kSend;
+  return rio_->Send(queues_[Other(pump.from)], pump.buffer_id, size, &pump);
+}
+
+void NaiveRioRelay::OnComplete(Pump& pump, int status, int bytes) {
+  if (status != 0) {
+    Finish(MapSystemError(status));
+    return;
+  }
+  int rv;
+  switch (pump.state) {
+    case Pump::kReceive:
+      if (bytes == 0) {
+        Finish(ERR_CONNECTION_CLOSED);
+        return;
+      }
+      rv = Send(pump, bytes);
+      break;
+    case Pump::kSend:
+      bytes_relayed_[pump.from] += bytes;
+      rv = Receive(pump);
+      break;
+    case Pump::kIdle:
+      NOTREACHED();
+  }
+  if (rv != OK)
+    Finish(rv);
+}
+
+void NaiveRioRelay::Stop() {
+  for (Pump& pump : pumps_) {
+    if (pump.in_flight()) {
+      // Released by the queue once the request is aborted.
+      rio_->Cancel(&pump);
+    } else if (pump.buffer_id >= 0) {
+      rio_->ReleaseBuffer(pump.buffer_id);
+    }
+    pump.buffer_id = -1;
+    pump.state = Pump::kIdle;
+  }
+}
+
+void NaiveRioRelay::Finish(int result) {
+  Stop();
+  std::move(callback_).Run(result);
+}
+
+}  // namespace net
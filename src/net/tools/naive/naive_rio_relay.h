@@ -0,0 +1,75 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_RIO_RELAY_H_
+#define NET_TOOLS_NAIVE_NAIVE_RIO_RELAY_H_
+
+#include <cstdint>
+
+#include "net/base/completion_once_callback.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_rio.h"
+
+namespace net {
+
+// Relays between two connected TCP sockets like NaiveUringRelay, but with
+// receives and sends through the NaiveRio of the thread, into buffers
+// registered once instead of locked per operation. Each direction holds a
+// buffer for as long as the relay runs. Windows only.
+class NaiveRioRelay {
+ public:
+  // Does not take ownership of the sockets, which must stay open until the
+  // relay is destroyed.
+  NaiveRioRelay(NaiveRio* rio, SOCKET client_socket, SOCKET server_socket);
+  ~NaiveRioRelay();
+  NaiveRioRelay(const NaiveRioRelay&) = delete;
+  NaiveRioRelay& operator=(const NaiveRioRelay&) = delete;
+
+  // Returns ERR_IO_PENDING and runs `callback` when either direction reaches
+  // EOF (ERR_CONNECTION_CLOSED) or fails. Returns another error if the
+  // sockets cannot take Registered I/O or no buffers are left, in which case
+  // they can still be relayed otherwise.
+  int Run(CompletionOnceCallback callback);
+
+  int64_t bytes_relayed(Direction from) const { return bytes_relayed_[from]; }
+
+ private:
+  // One direction, receiving from its side and sending to the other.
+  class Pump : public NaiveRio::Op {
+   public:
+    enum State {
+      kIdle,
+      kReceive,
+      kSend,
+    };
+
+    Pump(NaiveRioRelay* relay, Direction from);
+    ~Pump();
+
+    // NaiveRio::Op implementation.
+    void OnComplete(int status, int bytes) override;
+
+    NaiveRioRelay* const relay;
+    const Direction from;
+    State state = kIdle;
+    int buffer_id = -1;
+  };
+
+  int Receive(Pump& pump);
+  int Send(Pump& pump, int size);
+  void OnComplete(Pump& pump, int status, int bytes);
+  // Cancels the requests of the pumps, releasing their buffers.
+  void Stop();
+  void Finish(int result);
+
+  NaiveRio* const rio_;
+  SOCKET sockets_[kNumDirections];
+  RIO_RQ queues_[kNumDirections] = {RIO_INVALID_RQ, RIO_INVALID_RQ};
+  Pump pumps_[kNumDirections];
+  int64_t bytes_relayed_[kNumDirections] = {0, 0};
+
+  CompletionOnceCallback callback_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_RIO_RELAY_H_
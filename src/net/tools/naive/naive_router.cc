@@ -0,0 +1,179 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_router.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "net/base/ip_address.h"
+#include "net/base/proxy_server.h"
+#include "net/proxy_resolution/proxy_list.h"
+
+namespace net {
+
+NaiveRouter::NaiveRouter() = default;
+
+NaiveRouter::~NaiveRouter() = default;
+
+// static
+scoped_refptr<NaiveRouter> NaiveRouter::Create(
+    const std::vector<NaiveRouteRule>& rules,
+    scoped_refptr<NaiveRuleset> ruleset) {
+  auto router = base::WrapRefCounted(new NaiveRouter());
+  if (ruleset) {
+    router->tag_targets_.assign(ruleset->tag_count(), kNoMatch);
+    router->ruleset_ = std::move(ruleset);
+  }
+  for (const NaiveRouteRule& rule : rules) {
+    int target = router->GetTarget(rule.target);
+    if (rule.matcher.front() != '@') {
+      if (!router->AddMatcher(rule.matcher, target))
+        return nullptr;
+      continue;
+    }
+    std::string path = rule.matcher.substr(1);
+    std::string contents;
+    if (!base::ReadFileToString(base::FilePath::FromUTF8Unsafe(path),
+                                &contents)) {
+      LOG(ERROR) << "Failed to read route file " << path;
+      return nullptr;
+    }
+    for (std::string_view line : base::SplitStringPiece(
+             contents, "\n", base::TRIM_WHITESPACE,
+             base::SPLIT_WANT_NONEMPTY)) {
+      if (line.front() == '#')
+        continue;
+      if (!router->AddMatcher(line, target))
+        return nullptr;
+    }
+  }
+  router->ranges_ = FlattenIPBlocks(std::move(router->blocks_), kNoMatch);
+  router->blocks_.clear();
+  LOG(INFO) << "Routing " << router->domains_.size() << " domains and "
+            << router->ranges_.size() << " IP ranges";
+  return router;
+}
+
+int NaiveRouter::Route(std::string_view host) const {
+  IPAddress address;
+  if (address.AssignFromIPLiteral(host)) {
+    absl::uint128 value = IPAddressToUint128(address);
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), value,
+                               [](absl::uint128 v, const NaiveIPRange& range) {
+                                 return v < range.start;
+                               });
+    // The first range starts at 0.
+    int target = std::prev(it)->value;
+    int prefix_length = std::prev(it)->prefix_length;
+    if (ruleset_) {
+      // Inline matchers win over tags of equal blocks.
+      int tag_prefix_length;
+      uint32_t tag = ruleset_->LookupAddress(value, &tag_prefix_length);
+      if (tag != NaiveRuleset::kNoTag && tag_targets_[tag] != kNoMatch &&
+          (target == kNoMatch || tag_prefix_length > prefix_length)) {
+        target = tag_targets_[tag];
+      }
+    }
+    if (target != kNoMatch)
+      return target;
+  } else if (!domains_.empty() || ruleset_) {
+    if (!host.empty() && host.back() == '.') {
+      host.remove_suffix(1);
+    }
+    std::string name = base::ToLowerASCII(host);
+    std::string_view suffix = name;
+    while (true) {
+      auto it = domains_.find(suffix);
+      if (it != domains_.end())
+        return it->second;
+      if (ruleset_) {
+        uint32_t tag = ruleset_->LookupDomain(suffix);
+        if (tag != NaiveRuleset::kNoTag && tag_targets_[tag] != kNoMatch)
+          return tag_targets_[tag];
+      }
+      size_t dot = suffix.find('.');
+      if (dot == std::string_view::npos)
+        break;
+      suffix.remove_prefix(dot + 1);
+    }
+  }
+  return wildcard_target_ != kNoMatch ? wildcard_target_ : kDefaultTarget;
+}
+
+int NaiveRouter::GetTarget(const std::string& target) {
+  if (target == "proxy")
+    return kDefaultTarget;
+  auto it = std::find(target_names_.begin(), target_names_.end(), target);
+  if (it != target_names_.end())
+    return static_cast<int>(it - target_names_.begin());
+
+  target_names_.push_back(target);
+  if (target == "direct") {
+    targets_.push_back(ProxyChain::Direct());
+  } else if (target.compare(0, 7, "quic://") == 0 ||
+             target.compare(0, 7, "auto://") == 0) {
+    // See BuildURLRequestContext().
+    ProxyList parsed;
+    parsed.Set("https" + target.substr(4));
+    targets_.push_back(ProxyChain::ForIpProtection(
+        {ProxyServer(ProxyServer::Scheme::SCHEME_QUIC,
+                     parsed.First().First().host_port_pair())}));
+  } else {
+    ProxyList parsed;
+    parsed.Set(target);
+    targets_.push_back(parsed.First());
+  }
+  return static_cast<int>(targets_.size()) - 1;
+}
+
+bool NaiveRouter::AddMatcher(std::string_view matcher, int target) {
+  // Earlier rules win over equal matchers.
+  if (matcher == "*") {
+    if (wildcard_target_ == kNoMatch) {
+      wildcard_target_ = target;
+    }
+    return true;
+  }
+
+  if (base::StartsWith(matcher, "ruleset:"))
+    return AddTag(matcher.substr(8), target);
+  if (base::StartsWith(matcher, "geoip:"))
+    return AddTag(base::ToLowerASCII(matcher), target);
+
+  std::string domain;
+  NaiveIPBlock block;
+  if (!ParseRouteMatcher(matcher, &domain, &block))
+    return false;
+  if (!domain.empty()) {
+    domains_.try_emplace(std::move(domain), target);
+    return true;
+  }
+  block.value = target;
+  blocks_.push_back(block);
+  return true;
+}
+
+bool NaiveRouter::AddTag(std::string_view tag, int target) {
+  if (!ruleset_) {
+    LOG(ERROR) << "Route tag " << tag << " without --ruleset";
+    return false;
+  }
+  uint32_t index = ruleset_->FindTag(tag);
+  if (index == NaiveRuleset::kNoTag) {
+    LOG(ERROR) << "Route tag " << tag << " not in the ruleset";
+    return false;
+  }
+  if (tag_targets_[index] == kNoMatch) {
+    tag_targets_[index] = target;
+  }
+  return true;
+}
+
+}  // namespace net
@@ -0,0 +1,81 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_ROUTER_H_
+#define NET_TOOLS_NAIVE_NAIVE_ROUTER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "net/base/proxy_chain.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_ruleset.h"
+#include "third_party/abseil-cpp/absl/container/flat_hash_map.h"
+
+namespace net {
+
+// The rules of NaiveConfig::route compiled once for all IO threads, so
+// classifying a tunnel costs a few hash lookups or one binary search
+// however many rules there are. Domain suffixes are looked up in a hash
+// table per label of the host, longest first. CIDR blocks are flattened
+// into sorted disjoint ranges of the most specific block, with IPv4 blocks
+// mapped into IPv6. Tags of a NaiveRuleset are looked up in its mapped
+// tables alongside.
+class NaiveRouter : public base::RefCountedThreadSafe<NaiveRouter> {
+ public:
+  // The upstreams as without rules.
+  static constexpr int kDefaultTarget = -1;
+
+  // Returns nullptr after logging the error if a rule file cannot be read
+  // or a matcher is invalid. `ruleset` may be null without "ruleset:" and
+  // "geoip:" matchers.
+  static scoped_refptr<NaiveRouter> Create(
+      const std::vector<NaiveRouteRule>& rules,
+      scoped_refptr<NaiveRuleset> ruleset);
+
+  NaiveRouter(const NaiveRouter&) = delete;
+  NaiveRouter& operator=(const NaiveRouter&) = delete;
+
+  // Direct or single proxy chains. The chain of a QUIC or auto:// proxy is
+  // its QUIC one, as in the proxy list.
+  const std::vector<ProxyChain>& targets() const { return targets_; }
+
+  // Returns the index into targets() for the host or IP literal `host`, or
+  // kDefaultTarget.
+  int Route(std::string_view host) const;
+
+ private:
+  friend class base::RefCountedThreadSafe<NaiveRouter>;
+
+  // Of IP ranges and the wildcard without a rule.
+  static constexpr int kNoMatch = -2;
+
+  NaiveRouter();
+  ~NaiveRouter();
+
+  int GetTarget(const std::string& target);
+  bool AddMatcher(std::string_view matcher, int target);
+  bool AddTag(std::string_view tag, int target);
+
+  std::vector<std::string> target_names_;
+  std::vector<ProxyChain> targets_;
+
+  // Keyed by the lowercase suffix without leading or trailing dots.
+  absl::flat_hash_map<std::string, int> domains_;
+  int wildcard_target_ = kNoMatch;
+
+  // Only while compiling, in the order of the rules.
+  std::vector<NaiveIPBlock> blocks_;
+  // Sorted, the first starting at 0.
+  std::vector<NaiveIPRange> ranges_;
+
+  scoped_refptr<NaiveRuleset> ruleset_;
+  // By tag of `ruleset_`, kNoMatch for tags without a rule.
+  std::vector<int> tag_targets_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_ROUTER_H_
@@ -0,0 +1,246 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compiles lists of route matchers and a GeoIP CSV into the memory-mapped
+// NaiveRuleset format:
+//
+//   naive_rules_compile --out=rules.bin [--geoip=countries.csv] \
+//       TAG=PATH...
+//
+// Each PATH has one domain, IP address or CIDR block per line and # comments,
+// as @PATH files of --route. The GeoIP CSV has "CIDR,COUNTRY" lines, and
+// each country becomes the tag "geoip:<country>" in lowercase. A domain or
+// block in several tags belongs to the first.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/bits.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "net/tools/naive/naive_ruleset.h"
+#include "third_party/abseil-cpp/absl/container/flat_hash_map.h"
+
+namespace net {
+namespace {
+
+class RulesetWriter {
+ public:
+  // Returns the index of the tag, adding it if new.
+  uint32_t GetTag(const std::string& name) {
+    auto [it, inserted] = tag_indices_.try_emplace(
+        name, static_cast<uint32_t>(tag_names_.size()));
+    if (inserted) {
+      tag_names_.push_back(name);
+    }
+    return it->second;
+  }
+
+  bool AddMatcher(std::string_view matcher, uint32_t tag) {
+    std::string domain;
+    NaiveIPBlock block;
+    if (!ParseRouteMatcher(matcher, &domain, &block))
+      return false;
+    if (!domain.empty()) {
+      if (domain_indices_.try_emplace(domain, domains_.size()).second) {
+        domains_.emplace_back(std::move(domain), tag);
+      }
+      return true;
+    }
+    block.value = static_cast<int>(tag);
+    blocks_.push_back(block);
+    return true;
+  }
+
+  std::string Serialize() {
+    std::vector<NaiveIPRange> ranges =
+        FlattenIPBlocks(std::move(blocks_), kNoTagValue);
+
+    std::string strings;
+    auto add_string = [&strings](std::string_view s) {
+      NaiveRuleset::StringRef ref = {static_cast<uint32_t>(strings.size()),
+                                     static_cast<uint32_t>(s.size())};
+      strings.append(s);
+      return ref;
+    };
+    std::vector<NaiveRuleset::StringRef> tags;
+    for (const std::string& name : tag_names_) {
+      tags.push_back(add_string(name));
+    }
+
+    // At most half full, so misses end within a few probes.
+    size_t slot_count =
+        domains_.empty()
+            ? 0
+            : size_t{1} << base::bits::Log2Ceiling(
+                  static_cast<uint32_t>(domains_.size() * 2));
+    std::vector<NaiveRuleset::DomainSlot> slots(
+        slot_count, {0, NaiveRuleset::kNoTag, {0, 0}});
+    for (const auto& [domain, tag] : domains_) {
+      uint32_t hash = NaiveRuleset::Hash(domain);
+      size_t index = hash & (slot_count - 1);
+      while (slots[index].tag != NaiveRuleset::kNoTag) {
+        index = (index + 1) & (slot_count - 1);
+      }
+      slots[index] = {hash, tag, add_string(domain)};
+    }
+
+    std::vector<NaiveRuleset::IPRange> ip_ranges;
+    for (const NaiveIPRange& range : ranges) {
+      ip_ranges.push_back({absl::Uint128High64(range.start),
+                           absl::Uint128Low64(range.start),
+                           range.value == kNoTagValue
+                               ? NaiveRuleset::kNoTag
+                               : static_cast<uint32_t>(range.value),
+                           static_cast<uint32_t>(range.prefix_length)});
+    }
+
+    NaiveRuleset::Header header = {};
+    std::memcpy(header.magic, NaiveRuleset::kMagic, sizeof(header.magic));
+    header.version = NaiveRuleset::kVersion;
+    header.tag_count = static_cast<uint32_t>(tags.size());
+    header.slot_count = static_cast<uint32_t>(slots.size());
+    header.range_count = static_cast<uint32_t>(ip_ranges.size());
+
+    std::string out(sizeof(header), '\0');
+    auto append = [&out](const void* data, size_t size) {
+      out.resize(base::bits::AlignUp(out.size(), size_t{8}), '\0');
+      uint64_t offset = out.size();
+      out.append(static_cast<const char*>(data), size);
+      return offset;
+    };
+    header.tags_offset =
+        append(tags.data(), tags.size() * sizeof(NaiveRuleset::StringRef));
+    header.slots_offset = append(
+        slots.data(), slots.size() * sizeof(NaiveRuleset::DomainSlot));
+    header.ranges_offset = append(
+        ip_ranges.data(), ip_ranges.size() * sizeof(NaiveRuleset::IPRange));
+    header.strings_offset = append(strings.data(), strings.size());
+    header.strings_size = strings.size();
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::fprintf(stderr, "%zu tags, %zu domains, %zu IP ranges\n",
+                 tags.size(), domains_.size(), ip_ranges.size());
+    return out;
+  }
+
+ private:
+  static constexpr int kNoTagValue = -1;
+
+  std::vector<std::string> tag_names_;
+  absl::flat_hash_map<std::string, uint32_t> tag_indices_;
+  // In the order added, so the file is the same for the same input.
+  std::vector<std::pair<std::string, uint32_t>> domains_;
+  absl::flat_hash_map<std::string, size_t> domain_indices_;
+  std::vector<NaiveIPBlock> blocks_;
+};
+
+bool ReadLines(const base::FilePath& path, std::string* contents,
+               std::vector<std::string_view>* lines) {
+  if (!base::ReadFileToString(path, contents)) {
+    std::fprintf(stderr, "Failed to read %s\n", path.AsUTF8Unsafe().c_str());
+    return false;
+  }
+  for (std::string_view line : base::SplitStringPiece(
+           *contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (line.front() != '#') {
+      lines->push_back(line);
+    }
+  }
+  return true;
+}
+
+bool AddList(RulesetWriter& writer, std::string_view arg) {
+  size_t pos = arg.find('=');
+  if (pos == 0 || pos == std::string_view::npos || pos + 1 == arg.size()) {
+    std::fprintf(stderr, "Invalid list %s, expected TAG=PATH\n",
+                 std::string(arg).c_str());
+    return false;
+  }
+  std::string name(arg.substr(0, pos));
+  if (base::StartsWith(name, "geoip:")) {
+    std::fprintf(stderr, "The geoip: tags are from --geoip\n");
+    return false;
+  }
+  std::string contents;
+  std::vector<std::string_view> lines;
+  if (!ReadLines(base::FilePath::FromUTF8Unsafe(arg.substr(pos + 1)),
+                 &contents, &lines))
+    return false;
+  uint32_t tag = writer.GetTag(name);
+  for (std::string_view line : lines) {
+    if (!writer.AddMatcher(line, tag))
+      return false;
+  }
+  return true;
+}
+
+bool AddGeoIP(RulesetWriter& writer, const base::FilePath& path) {
+  std::string contents;
+  std::vector<std::string_view> lines;
+  if (!ReadLines(path, &contents, &lines))
+    return false;
+  for (std::string_view line : lines) {
+    std::vector<std::string_view> fields = base::SplitStringPiece(
+        line, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+    if (fields.size() != 2 || fields[0].empty() || fields[1].empty() ||
+        fields[0].find('/') == std::string_view::npos) {
+      std::fprintf(stderr, "Invalid GeoIP line %s\n",
+                   std::string(line).c_str());
+      return false;
+    }
+    uint32_t tag =
+        writer.GetTag("geoip:" + base::ToLowerASCII(fields[1]));
+    if (!writer.AddMatcher(fields[0], tag))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+
+  base::FilePath out = command_line.GetSwitchValuePath("out");
+  if (out.empty()) {
+    std::fprintf(stderr,
+                 "Usage: naive_rules_compile --out=<path> [--geoip=<csv>] "
+                 "<tag>=<path>...\n");
+    return EXIT_FAILURE;
+  }
+
+  net::RulesetWriter writer;
+  for (const auto& arg : command_line.GetArgs()) {
+    if (!net::AddList(writer, base::FilePath(arg).AsUTF8Unsafe()))
+      return EXIT_FAILURE;
+  }
+  if (command_line.HasSwitch("geoip") &&
+      !net::AddGeoIP(writer, command_line.GetSwitchValuePath("geoip"))) {
+    return EXIT_FAILURE;
+  }
+
+  // Replaced by a rename, so processes mapping the old file keep reading
+  // it unchanged.
+  if (!base::ImportantFileWriter::WriteFileAtomically(out,
+                                                      writer.Serialize())) {
+    std::fprintf(stderr, "Failed to write %s\n", out.AsUTF8Unsafe().c_str());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_ruleset.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/bits.h"
+#include "base/logging.h"
+#include "base/strings/string_util.h"
+
+namespace net {
+
+absl::uint128 IPAddressToUint128(const IPAddress& address) {
+  IPAddress ipv6 = address.IsIPv4() ? ConvertIPv4ToIPv4MappedIPv6(address)
+                                    : address;
+  absl::uint128 value = 0;
+  for (uint8_t byte : ipv6.bytes()) {
+    value = (value << 8) | byte;
+  }
+  return value;
+}
+
+std::string NormalizeRouteDomain(std::string_view domain) {
+  if (base::StartsWith(domain, "*.")) {
+    domain.remove_prefix(2);
+  }
+  while (!domain.empty() && domain.front() == '.') {
+    domain.remove_prefix(1);
+  }
+  if (!domain.empty() && domain.back() == '.') {
+    domain.remove_suffix(1);
+  }
+  return base::ToLowerASCII(domain);
+}
+
+std::vector<NaiveIPRange> FlattenIPBlocks(std::vector<NaiveIPBlock> blocks,
+                                          int no_match) {
+  // Blocks either nest or are disjoint, so sorted by start and then size
+  // each block is within the ones on the stack.
+  std::stable_sort(blocks.begin(), blocks.end(),
+                   [](const NaiveIPBlock& a, const NaiveIPBlock& b) {
+                     if (a.first != b.first)
+                       return a.first < b.first;
+                     return a.prefix_length < b.prefix_length;
+                   });
+  std::vector<NaiveIPRange> ranges;
+  auto emit = [&ranges](absl::uint128 start, int prefix_length, int value) {
+    if (!ranges.empty() && ranges.back().start == start) {
+      ranges.pop_back();
+    }
+    if (!ranges.empty() && ranges.back().value == value &&
+        ranges.back().prefix_length == prefix_length)
+      return;
+    ranges.push_back({start, prefix_length, value});
+  };
+  std::vector<NaiveIPBlock> stack;
+  // Resumes the enclosing block after the innermost one ends.
+  auto pop = [&]() {
+    absl::uint128 last = stack.back().last;
+    stack.pop_back();
+    if (last == absl::Uint128Max())
+      return;
+    if (stack.empty()) {
+      emit(last + 1, 0, no_match);
+    } else {
+      emit(last + 1, stack.back().prefix_length, stack.back().value);
+    }
+  };
+  emit(0, 0, no_match);
+  for (const NaiveIPBlock& block : blocks) {
+    while (!stack.empty() && stack.back().last < block.first) {
+      pop();
+    }
+    if (!stack.empty() && stack.back().first == block.first &&
+        stack.back().last == block.last) {
+      continue;
+    }
+    emit(block.first, block.prefix_length, block.value);
+    stack.push_back(block);
+  }
+  while (!stack.empty()) {
+    pop();
+  }
+  ranges.shrink_to_fit();
+  return ranges;
+}
+
+bool ParseRouteMatcher(std::string_view matcher,
+                       std::string* domain,
+                       NaiveIPBlock* block) {
+  IPAddress address;
+  size_t prefix_length;
+  if (address.AssignFromIPLiteral(matcher)) {
+    prefix_length = address.size() * 8;
+  } else if (matcher.find('/') != std::string_view::npos) {
+    if (!ParseCIDRBlock(matcher, &address, &prefix_length)) {
+      LOG(ERROR) << "Invalid route CIDR block " << matcher;
+      return false;
+    }
+  } else {
+    *domain = NormalizeRouteDomain(matcher);
+    if (domain->empty()) {
+      LOG(ERROR) << "Invalid route domain " << matcher;
+      return false;
+    }
+    return true;
+  }
+
+  domain->clear();
+  if (address.IsIPv4()) {
+    prefix_length += 96;
+  }
+  absl::uint128 host_mask =
+      prefix_length == 0 ? absl::Uint128Max()
+                         : (absl::uint128(1) << (128 - prefix_length)) - 1;
+  absl::uint128 first = IPAddressToUint128(address) & ~host_mask;
+  *block = {first, first | host_mask, static_cast<int>(prefix_length), 0};
+  return true;
+}
+
+NaiveRuleset::NaiveRuleset() = default;
+
+NaiveRuleset::~NaiveRuleset() = default;
+
+// static
+uint32_t NaiveRuleset::Hash(std::string_view domain) {
+  uint32_t hash = 2166136261u;
+  for (char c : domain) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// static
+scoped_refptr<NaiveRuleset> NaiveRuleset::Open(const base::FilePath& path) {
+  auto ruleset = base::WrapRefCounted(new NaiveRuleset());
+  if (!ruleset->Init(path))
+    return nullptr;
+  LOG(INFO) << "Mapped ruleset " << path << " with " << ruleset->tags_.size()
+            << " tags and " << ruleset->ranges_.size() << " IP ranges";
+  return ruleset;
+}
+
+bool NaiveRuleset::Init(const base::FilePath& path) {
+  if (!file_.Initialize(path)) {
+    LOG(ERROR) << "Failed to map ruleset " << path;
+    return false;
+  }
+  const uint8_t* data = file_.data();
+  uint64_t length = file_.length();
+  Header header;
+  if (length < sizeof(header)) {
+    LOG(ERROR) << "Invalid ruleset " << path;
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    LOG(ERROR) << "Invalid ruleset " << path;
+    return false;
+  }
+  if (header.version != kVersion) {
+    LOG(ERROR) << "Ruleset " << path << " has version " << header.version
+               << ", expected " << kVersion << "; compile it again";
+    return false;
+  }
+
+  // Only the bounds are checked here, so mapping does not touch the pages
+  // of the tables. Lookups check what they read.
+  auto in_bounds = [length](uint64_t offset, uint64_t size) {
+    return offset % 8 == 0 && offset <= length && size <= length - offset;
+  };
+  if (!in_bounds(header.tags_offset,
+                 uint64_t{header.tag_count} * sizeof(StringRef)) ||
+      !in_bounds(header.slots_offset,
+                 uint64_t{header.slot_count} * sizeof(DomainSlot)) ||
+      !in_bounds(header.ranges_offset,
+                 uint64_t{header.range_count} * sizeof(IPRange)) ||
+      !in_bounds(header.strings_offset, header.strings_size) ||
+      (header.slot_count != 0 &&
+       !base::bits::IsPowerOfTwo(header.slot_count))) {
+    LOG(ERROR) << "Invalid ruleset " << path;
+    return false;
+  }
+  tags_ = base::span(
+      reinterpret_cast<const StringRef*>(data + header.tags_offset),
+      header.tag_count);
+  slots_ = base::span(
+      reinterpret_cast<const DomainSlot*>(data + header.slots_offset),
+      header.slot_count);
+  ranges_ = base::span(
+      reinterpret_cast<const IPRange*>(data + header.ranges_offset),
+      header.range_count);
+  strings_ = std::string_view(
+      reinterpret_cast<const char*>(data + header.strings_offset),
+      header.strings_size);
+  return true;
+}
+
+std::string_view NaiveRuleset::GetString(const StringRef& ref) const {
+  if (ref.offset > strings_.size() ||
+      ref.length > strings_.size() - ref.offset)
+    return {};
+  return strings_.substr(ref.offset, ref.length);
+}
+
+uint32_t NaiveRuleset::FindTag(std::string_view name) const {
+  for (size_t i = 0; i < tags_.size(); ++i) {
+    if (GetString(tags_[i]) == name)
+      return static_cast<uint32_t>(i);
+  }
+  return kNoTag;
+}
+
+uint32_t NaiveRuleset::LookupDomain(std::string_view domain) const {
+  if (slots_.empty())
+    return kNoTag;
+  uint32_t hash = Hash(domain);
+  size_t mask = slots_.size() - 1;
+  // Bounded in case a corrupt table has no empty slot.
+  for (size_t i = 0, index = hash & mask; i < slots_.size();
+       ++i, index = (index + 1) & mask) {
+    const DomainSlot& slot = slots_[index];
+    if (slot.tag == kNoTag)
+      return kNoTag;
+    if (slot.hash == hash && GetString(slot.domain) == domain)
+      return slot.tag < tags_.size() ? slot.tag : kNoTag;
+  }
+  return kNoTag;
+}
+
+uint32_t NaiveRuleset::LookupAddress(absl::uint128 address,
+                                     int* prefix_length) const {
+  uint64_t high = absl::Uint128High64(address);
+  uint64_t low = absl::Uint128Low64(address);
+  auto it = std::upper_bound(
+      ranges_.begin(), ranges_.end(), std::pair(high, low),
+      [](const std::pair<uint64_t, uint64_t>& v, const IPRange& range) {
+        return v < std::pair(range.start_high, range.start_low);
+      });
+  if (it == ranges_.begin())
+    return kNoTag;
+  --it;
+  if (it->tag >= tags_.size())
+    return kNoTag;
+  *prefix_length = static_cast<int>(it->prefix_length);
+  return it->tag;
+}
+
+}  // namespace net
@@ -0,0 +1,151 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_RULESET_H_
+#define NET_TOOLS_NAIVE_NAIVE_RULESET_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "net/base/ip_address.h"
+#include "third_party/abseil-cpp/absl/numeric/int128.h"
+
+namespace net {
+
+// IPv4 addresses as their IPv4-mapped IPv6 addresses.
+absl::uint128 IPAddressToUint128(const IPAddress& address);
+
+// Lowercases and strips the leading "*." or dots and the trailing dot of a
+// domain matcher.
+std::string NormalizeRouteDomain(std::string_view domain);
+
+// A CIDR block of route matchers, from `first` to `last` inclusive.
+struct NaiveIPBlock {
+  absl::uint128 first;
+  absl::uint128 last;
+  int prefix_length;
+  int value;
+};
+
+// An IP range from `start` up to the start of the next one, of the most
+// specific block containing it.
+struct NaiveIPRange {
+  absl::uint128 start;
+  int prefix_length;
+  int value;
+};
+
+// Returns sorted disjoint ranges of `blocks`, the first starting at 0 and
+// addresses in no block `no_match` with prefix length 0. Blocks either nest
+// or are disjoint; of equal blocks the first wins.
+std::vector<NaiveIPRange> FlattenIPBlocks(std::vector<NaiveIPBlock> blocks,
+                                          int no_match);
+
+// Parses a matcher of a route rule or ruleset source: a domain into
+// `domain`, or an IP address or CIDR block into `block` with `block.value`
+// left 0. Returns false after logging the error if it is invalid.
+bool ParseRouteMatcher(std::string_view matcher,
+                       std::string* domain,
+                       NaiveIPBlock* block);
+
+// A ruleset compiled by naive_rules_compile, mapped read-only so the pages
+// are shared by all threads and processes using the file and lookups need
+// no parsing at startup. The file has named tags of domains and IP ranges,
+// such as lists of sites or GeoIP countries, referenced by NaiveRouter
+// rules. A domain or address belongs to at most one tag.
+//
+// Layout, little-endian and each section 8-byte aligned:
+//   Header
+//   StringRef[tag_count] of the tag names
+//   DomainSlot[slot_count], an open addressing table with linear probing
+//     of FNV-1a hashes of the suffixes, slot_count a power of two
+//   IPRange[range_count], sorted, the first starting at 0, with IPv4
+//     addresses mapped into IPv6
+//   strings of tag names and domains, not NUL-terminated
+class NaiveRuleset : public base::RefCountedThreadSafe<NaiveRuleset> {
+ public:
+  static constexpr char kMagic[8] = {'N', 'A', 'I', 'V', 'E', 'R', 'S', '\0'};
+  // Bumped on any change of the layout.
+  static constexpr uint32_t kVersion = 1;
+  // Of empty domain slots and ranges without a tag.
+  static constexpr uint32_t kNoTag = 0xffffffff;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t tag_count;
+    uint32_t slot_count;
+    uint32_t range_count;
+    uint64_t tags_offset;
+    uint64_t slots_offset;
+    uint64_t ranges_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+  };
+  struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+  };
+  struct DomainSlot {
+    uint32_t hash;
+    uint32_t tag;
+    StringRef domain;
+  };
+  struct IPRange {
+    uint64_t start_high;
+    uint64_t start_low;
+    uint32_t tag;
+    uint32_t prefix_length;
+  };
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(DomainSlot) == 16);
+  static_assert(sizeof(IPRange) == 24);
+
+  // The hash of domain slots, stable across builds unlike absl::Hash.
+  static uint32_t Hash(std::string_view domain);
+
+  // Returns nullptr after logging the error if `path` cannot be mapped or
+  // is not a ruleset of kVersion.
+  static scoped_refptr<NaiveRuleset> Open(const base::FilePath& path);
+
+  NaiveRuleset(const NaiveRuleset&) = delete;
+  NaiveRuleset& operator=(const NaiveRuleset&) = delete;
+
+  size_t tag_count() const { return tags_.size(); }
+
+  // Returns the index of the tag named `name`, or kNoTag.
+  uint32_t FindTag(std::string_view name) const;
+
+  // Returns the tag of exactly the lowercase suffix `domain`, or kNoTag.
+  uint32_t LookupDomain(std::string_view domain) const;
+
+  // Returns the tag of `address` as from IPAddressToUint128(), or kNoTag,
+  // and sets `prefix_length` to that of its most specific block.
+  uint32_t LookupAddress(absl::uint128 address, int* prefix_length) const;
+
+ private:
+  friend class base::RefCountedThreadSafe<NaiveRuleset>;
+
+  NaiveRuleset();
+  ~NaiveRuleset();
+
+  bool Init(const base::FilePath& path);
+  // Empty if `ref` is out of the strings.
+  std::string_view GetString(const StringRef& ref) const;
+
+  base::MemoryMappedFile file_;
+  base::span<const StringRef> tags_;
+  base::span<const DomainSlot> slots_;
+  base::span<const IPRange> ranges_;
+  std::string_view strings_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_RULESET_H_
@@ -0,0 +1,377 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_session_store.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/base64.h"
+#include "base/files/file_util.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/json/values_util.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/raw_ptr.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/task/thread_pool.h"
+#include "base/time/time.h"
+#include "net/cert/x509_util.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/quic_client_session_cache.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/transport_parameters.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_versions.h"
+#include "third_party/boringssl/src/include/openssl/ssl.h"
+
+namespace net {
+
+namespace {
+// Coalesces the tickets a new connection usually receives.
+constexpr base::TimeDelta kSaveDelay = base::Seconds(1);
+
+std::string EncodeSession(SSL_SESSION* session) {
+  uint8_t* data;
+  size_t len;
+  if (!SSL_SESSION_to_bytes(session, &data, &len))
+    return std::string();
+  bssl::UniquePtr<uint8_t> free_data(data);
+  return base::Base64Encode(base::span<const uint8_t>(data, len));
+}
+
+bssl::UniquePtr<SSL_SESSION> DecodeSession(const base::Value::Dict& entry,
+                                           const SSL_CTX* ctx) {
+  const std::string* str = entry.FindString("session");
+  if (!str)
+    return nullptr;
+  std::optional<std::vector<uint8_t>> data = base::Base64Decode(*str);
+  if (!data.has_value())
+    return nullptr;
+  return bssl::UniquePtr<SSL_SESSION>(
+      SSL_SESSION_from_bytes(data->data(), data->size(), ctx));
+}
+
+base::Time GetExpirationTime(SSL_SESSION* session) {
+  return base::Time::FromTimeT(SSL_SESSION_get_time(session) +
+                               SSL_SESSION_get_timeout(session));
+}
+
+// Sessions of other network partitions or privacy modes are not saved.
+std::optional<std::string> GetKeyString(
+    const SSLClientSessionCache::Key& cache_key) {
+  if (cache_key.dest_ip_addr.has_value() ||
+      !cache_key.network_anonymization_key.IsEmpty() ||
+      cache_key.privacy_mode != PRIVACY_MODE_DISABLED) {
+    return std::nullopt;
+  }
+  return cache_key.server.ToString();
+}
+
+std::optional<std::string> GetKeyString(const quic::QuicServerId& server_id) {
+  if (server_id.privacy_mode_enabled())
+    return std::nullopt;
+  return server_id.ToHostPortString();
+}
+}  // namespace
+
+class NaiveSessionStore::PrefDelegate
+    : public HttpServerProperties::PrefDelegate {
+ public:
+  explicit PrefDelegate(NaiveSessionStore* store) : store_(store) {}
+
+  const base::Value::Dict& GetServerProperties() const override {
+    return store_->server_properties_;
+  }
+
+  void SetServerProperties(base::Value::Dict dict,
+                           base::OnceClosure callback) override {
+    store_->server_properties_ = std::move(dict);
+    if (callback) {
+      store_->Save();
+      base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+          FROM_HERE, std::move(callback));
+    } else {
+      store_->ScheduleSave();
+    }
+  }
+
+  void WaitForPrefLoad(base::OnceClosure pref_loaded_callback) override {
+    // The store loads the file when it is created.
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, std::move(pref_loaded_callback));
+  }
+
+ private:
+  raw_ptr<NaiveSessionStore> store_;
+};
+
+// Takes the saved session of a server when the in-memory cache has none.
+class NaiveSessionStore::QuicSessionCache : public quic::SessionCache {
+ public:
+  explicit QuicSessionCache(NaiveSessionStore* store) : store_(store) {}
+
+  void Insert(const quic::QuicServerId& server_id,
+              bssl::UniquePtr<SSL_SESSION> session,
+              const quic::TransportParameters& params,
+              const quic::ApplicationState* application_state) override {
+    store_->SaveQuicSession(server_id, session.get(), params,
+                            application_state);
+    cache_.Insert(server_id, std::move(session), params, application_state);
+  }
+
+  std::unique_ptr<quic::QuicResumptionState> Lookup(
+      const quic::QuicServerId& server_id,
+      quic::QuicWallTime now,
+      const SSL_CTX* ctx) override {
+    std::unique_ptr<quic::QuicResumptionState> state =
+        cache_.Lookup(server_id, now, ctx);
+    if (!state)
+      state = store_->LoadQuicSession(server_id, ctx);
+    return state;
+  }
+
+  void ClearEarlyData(const quic::QuicServerId& server_id) override {
+    cache_.ClearEarlyData(server_id);
+  }
+
+  void OnNewTokenReceived(const quic::QuicServerId& server_id,
+                          absl::string_view token) override {
+    store_->SaveQuicToken(server_id, token);
+    cache_.OnNewTokenReceived(server_id, token);
+  }
+
+  void RemoveExpiredEntries(quic::QuicWallTime now) override {
+    cache_.RemoveExpiredEntries(now);
+  }
+
+  void Clear() override {
+    store_->ForgetQuicSessions();
+    cache_.Clear();
+  }
+
+ private:
+  raw_ptr<NaiveSessionStore> store_;
+  quic::QuicClientSessionCache cache_;
+};
+
+NaiveSessionStore::NaiveSessionStore(const base::FilePath& file)
+    : file_(file),
+      ssl_ctx_(SSL_CTX_new(TLS_with_buffers_method())),
+      writer_(file,
+              base::ThreadPool::CreateSequencedTaskRunner(
+                  {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+                   base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+              kSaveDelay) {
+  SSL_CTX_set0_buffer_pool(ssl_ctx_.get(), x509_util::GetBufferPool());
+  Load();
+}
+
+NaiveSessionStore::~NaiveSessionStore() {
+  if (writer_.HasPendingWrite())
+    writer_.DoScheduledWrite();
+}
+
+std::unique_ptr<HttpServerProperties::PrefDelegate>
+NaiveSessionStore::CreatePrefDelegate() {
+  return std::make_unique<PrefDelegate>(this);
+}
+
+std::unique_ptr<quic::SessionCache>
+NaiveSessionStore::CreateQuicSessionCache() {
+  return std::make_unique<QuicSessionCache>(this);
+}
+
+void NaiveSessionStore::SaveSession(
+    const SSLClientSessionCache::Key& cache_key,
+    SSL_SESSION* session) {
+  std::optional<std::string> key = GetKeyString(cache_key);
+  if (!key.has_value() || !SSL_SESSION_is_resumable(session))
+    return;
+  std::string encoded = EncodeSession(session);
+  if (encoded.empty())
+    return;
+  tls_sessions_.Set(
+      *key, base::Value::Dict()
+                .Set("session", std::move(encoded))
+                .Set("expires", base::TimeToValue(GetExpirationTime(session))));
+  ScheduleSave();
+}
+
+bssl::UniquePtr<SSL_SESSION> NaiveSessionStore::LoadSession(
+    const SSLClientSessionCache::Key& cache_key) {
+  std::optional<std::string> key = GetKeyString(cache_key);
+  if (!key.has_value())
+    return nullptr;
+  std::optional<base::Value> entry = tls_sessions_.Extract(*key);
+  if (!entry.has_value() || !entry->is_dict())
+    return nullptr;
+  ScheduleSave();
+  return DecodeSession(entry->GetDict(), ssl_ctx_.get());
+}
+
+void NaiveSessionStore::ForgetSessions(
+    const base::flat_set<HostPortPair>* servers) {
+  if (!servers) {
+    tls_sessions_.clear();
+  } else {
+    for (const HostPortPair& server : *servers) {
+      tls_sessions_.Remove(server.ToString());
+    }
+  }
+  ScheduleSave();
+}
+
+void NaiveSessionStore::SaveQuicSession(
+    const quic::QuicServerId& server_id,
+    SSL_SESSION* session,
+    const quic::TransportParameters& params,
+    const quic::ApplicationState* application_state) {
+  std::optional<std::string> key = GetKeyString(server_id);
+  if (!key.has_value() || !SSL_SESSION_is_resumable(session))
+    return;
+  std::string encoded = EncodeSession(session);
+  std::vector<uint8_t> params_data;
+  if (encoded.empty() ||
+      !quic::SerializeTransportParameters(params, &params_data)) {
+    return;
+  }
+  base::Value::Dict entry;
+  entry.Set("session", std::move(encoded));
+  entry.Set("params", base::Base64Encode(params_data));
+  if (application_state) {
+    entry.Set("application-state", base::Base64Encode(*application_state));
+  }
+  entry.Set("expires", base::TimeToValue(GetExpirationTime(session)));
+  // The token of the server stays valid across its new sessions.
+  if (const base::Value::Dict* old_entry = quic_sessions_.FindDict(*key)) {
+    if (const std::string* token = old_entry->FindString("token")) {
+      entry.Set("token", *token);
+    }
+  }
+  quic_sessions_.Set(*key, std::move(entry));
+  ScheduleSave();
+}
+
+std::unique_ptr<quic::QuicResumptionState> NaiveSessionStore::LoadQuicSession(
+    const quic::QuicServerId& server_id,
+    const SSL_CTX* ctx) {
+  std::optional<std::string> key = GetKeyString(server_id);
+  if (!key.has_value())
+    return nullptr;
+  std::optional<base::Value> value = quic_sessions_.Extract(*key);
+  if (!value.has_value() || !value->is_dict())
+    return nullptr;
+  ScheduleSave();
+  const base::Value::Dict& entry = value->GetDict();
+
+  auto state = std::make_unique<quic::QuicResumptionState>();
+  state->tls_session = DecodeSession(entry, ctx);
+  if (!state->tls_session ||
+      base::Time::Now() >= GetExpirationTime(state->tls_session.get())) {
+    return nullptr;
+  }
+  const std::string* params_str = entry.FindString("params");
+  std::optional<std::vector<uint8_t>> params_data;
+  if (params_str)
+    params_data = base::Base64Decode(*params_str);
+  if (!params_data.has_value())
+    return nullptr;
+  state->transport_params = std::make_unique<quic::TransportParameters>();
+  std::string error_details;
+  // The versions of the tunnels are limited to RFCv1.
+  if (!quic::ParseTransportParameters(
+          quic::ParsedQuicVersion::RFCv1(), quic::Perspective::IS_SERVER,
+          params_data->data(), params_data->size(),
+          state->transport_params.get(), &error_details)) {
+    return nullptr;
+  }
+  if (const std::string* str = entry.FindString("application-state")) {
+    std::optional<std::vector<uint8_t>> data = base::Base64Decode(*str);
+    if (!data.has_value())
+      return nullptr;
+    state->application_state =
+        std::make_unique<quic::ApplicationState>(std::move(*data));
+  }
+  if (const std::string* str = entry.FindString("token")) {
+    std::optional<std::vector<uint8_t>> data = base::Base64Decode(*str);
+    if (data.has_value())
+      state->token.assign(data->begin(), data->end());
+  }
+  return state;
+}
+
+void NaiveSessionStore::SaveQuicToken(const quic::QuicServerId& server_id,
+                                      std::string_view token) {
+  std::optional<std::string> key = GetKeyString(server_id);
+  if (!key.has_value())
+    return;
+  if (base::Value::Dict* entry = quic_sessions_.FindDict(*key)) {
+    entry->Set("token", base::Base64Encode(token));
+    ScheduleSave();
+  }
+}
+
+void NaiveSessionStore::ForgetQuicSessions() {
+  quic_sessions_.clear();
+  ScheduleSave();
+}
+
+void NaiveSessionStore::Load() {
+  std::string contents;
+  // Does not exist before the first save.
+  if (!base::ReadFileToString(file_, &contents))
+    return;
+  std::optional<base::Value::Dict> store = base::JSONReader::ReadDict(contents);
+  if (!store.has_value()) {
+    LOG(WARNING) << "Invalid session cache: " << file_;
+    return;
+  }
+
+  base::Time now = base::Time::Now();
+  auto load_sessions = [&](std::string_view name, base::Value::Dict* out) {
+    base::Value::Dict* sessions = store->FindDict(name);
+    if (!sessions)
+      return;
+    for (auto [key, value] : *sessions) {
+      const base::Value::Dict* entry = value.GetIfDict();
+      if (!entry)
+        continue;
+      std::optional<base::Time> expires =
+          base::ValueToTime(entry->Find("expires"));
+      if (!expires.has_value() || now >= *expires)
+        continue;
+      out->Set(key, std::move(value));
+    }
+  };
+  load_sessions("tls", &tls_sessions_);
+  load_sessions("quic", &quic_sessions_);
+  if (base::Value::Dict* server_properties =
+          store->FindDict("server-properties")) {
+    server_properties_ = std::move(*server_properties);
+  }
+}
+
+void NaiveSessionStore::ScheduleSave() {
+  writer_.ScheduleWrite(this);
+}
+
+void NaiveSessionStore::Save() {
+  std::optional<std::string> contents = SerializeData();
+  if (contents.has_value())
+    writer_.WriteNow(std::move(*contents));
+}
+
+std::optional<std::string> NaiveSessionStore::SerializeData() {
+  base::Value::Dict store;
+  store.Set("tls", tls_sessions_.Clone());
+  store.Set("quic", quic_sessions_.Clone());
+  store.Set("server-properties", server_properties_.Clone());
+
+  std::string contents;
+  if (!base::JSONWriter::Write(store, &contents))
+    return std::nullopt;
+  return contents;
+}
+
+}  // namespace net
@@ -0,0 +1,83 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SESSION_STORE_H_
+#define NET_TOOLS_NAIVE_NAIVE_SESSION_STORE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/values.h"
+#include "net/http/http_server_properties.h"
+#include "net/ssl/ssl_client_session_cache.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/quic_crypto_client_config.h"
+#include "third_party/boringssl/src/include/openssl/base.h"
+
+namespace net {
+
+// Keeps the TLS sessions, QUIC resumption state and HTTP server properties
+// of a network session in a file, so the first tunnels after a restart
+// resume their TLS sessions, and QUIC tunnels can send 0-RTT. Like the
+// single-use sessions of the in-memory caches, a saved session is forgotten
+// once loaded. The file is written on a background sequence. Must outlive
+// the URLRequestContext using it.
+class NaiveSessionStore : public SSLClientSessionCache::Persister,
+                          public base::ImportantFileWriter::DataSerializer {
+ public:
+  explicit NaiveSessionStore(const base::FilePath& file);
+  ~NaiveSessionStore() override;
+  NaiveSessionStore(const NaiveSessionStore&) = delete;
+  NaiveSessionStore& operator=(const NaiveSessionStore&) = delete;
+
+  // For the HttpServerProperties of the network session.
+  std::unique_ptr<HttpServerProperties::PrefDelegate> CreatePrefDelegate();
+  // For QuicSessionPool::set_session_cache_factory().
+  std::unique_ptr<quic::SessionCache> CreateQuicSessionCache();
+
+  // SSLClientSessionCache::Persister:
+  void SaveSession(const SSLClientSessionCache::Key& cache_key,
+                   SSL_SESSION* session) override;
+  bssl::UniquePtr<SSL_SESSION> LoadSession(
+      const SSLClientSessionCache::Key& cache_key) override;
+  void ForgetSessions(const base::flat_set<HostPortPair>* servers) override;
+
+  // base::ImportantFileWriter::DataSerializer:
+  std::optional<std::string> SerializeData() override;
+
+ private:
+  class PrefDelegate;
+  class QuicSessionCache;
+
+  void SaveQuicSession(const quic::QuicServerId& server_id,
+                       SSL_SESSION* session,
+                       const quic::TransportParameters& params,
+                       const quic::ApplicationState* application_state);
+  std::unique_ptr<quic::QuicResumptionState> LoadQuicSession(
+      const quic::QuicServerId& server_id,
+      const SSL_CTX* ctx);
+  void SaveQuicToken(const quic::QuicServerId& server_id,
+                     std::string_view token);
+  void ForgetQuicSessions();
+
+  void Load();
+  // Saves the file after changes have settled for a moment.
+  void ScheduleSave();
+  // Saves the file without waiting.
+  void Save();
+
+  const base::FilePath file_;
+  // Sections of the file. The sessions are keyed by server.
+  base::Value::Dict tls_sessions_;
+  base::Value::Dict quic_sessions_;
+  base::Value::Dict server_properties_;
+  // Parses the TLS sessions like the SSL_CTX of SSLClientSocketImpl.
+  bssl::UniquePtr<SSL_CTX> ssl_ctx_;
+  base::ImportantFileWriter writer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SESSION_STORE_H_
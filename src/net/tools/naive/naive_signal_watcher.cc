@@ -0,0 +1,95 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_signal_watcher.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/files/file_util.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+
+namespace net {
+
+namespace {
+// The write ends of the pipes of the watchers, by signal. 0 if not watched,
+// which a write end never is as the read end takes the lower descriptor.
+int g_signal_write_fds[NSIG];
+
+void OnSignal(int signal) {
+  int saved_errno = errno;
+  char c = 0;
+  // Nothing to do if the pipe is full, as the callback is pending already.
+  [[maybe_unused]] ssize_t rv = write(g_signal_write_fds[signal], &c, 1);
+  errno = saved_errno;
+}
+}  // namespace
+
+NaiveSignalWatcher::NaiveSignalWatcher(int signal,
+                                       base::RepeatingClosure callback)
+    : signal_(signal), callback_(std::move(callback)), watcher_(FROM_HERE) {
+  DCHECK_GT(signal_, 0);
+  DCHECK_LT(signal_, NSIG);
+}
+
+NaiveSignalWatcher::~NaiveSignalWatcher() {
+  if (!write_fd_.is_valid() || g_signal_write_fds[signal_] != write_fd_.get())
+    return;
+  signal(signal_, SIG_IGN);
+  g_signal_write_fds[signal_] = 0;
+}
+
+bool NaiveSignalWatcher::Start() {
+  DCHECK_EQ(g_signal_write_fds[signal_], 0);
+  int fds[2];
+  if (pipe(fds) != 0) {
+    PLOG(ERROR) << "pipe failed";
+    return false;
+  }
+  read_fd_.reset(fds[0]);
+  write_fd_.reset(fds[1]);
+  if (!base::SetNonBlocking(fds[0]) || !base::SetNonBlocking(fds[1])) {
+    PLOG(ERROR) << "Failed to set pipe non-blocking";
+    return false;
+  }
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          read_fd_.get(), /*persistent=*/true,
+          base::MessagePumpForIO::WATCH_READ, &watcher_, this)) {
+    PLOG(ERROR) << "WatchFileDescriptor failed on read";
+    return false;
+  }
+  g_signal_write_fds[signal_] = write_fd_.get();
+
+  struct sigaction action = {};
+  action.sa_handler = &OnSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(signal_, &action, nullptr) != 0) {
+    PLOG(ERROR) << "sigaction failed";
+    g_signal_write_fds[signal_] = 0;
+    return false;
+  }
+  return true;
+}
+
+void NaiveSignalWatcher::OnFileCanReadWithoutBlocking(int fd) {
+  char buffer[16];
+  while (HANDLE_EINTR(read(fd, buffer, sizeof(buffer))) > 0) {
+  }
+  callback_.Run();
+}
+
+void NaiveSignalWatcher::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+}  // namespace net
@@ -0,0 +1,40 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SIGNAL_WATCHER_H_
+#define NET_TOOLS_NAIVE_NAIVE_SIGNAL_WATCHER_H_
+
+#include "base/files/scoped_file.h"
+#include "base/functional/callback.h"
+#include "base/message_loop/message_pump_for_io.h"
+
+namespace net {
+
+// Runs a callback on the calling IO thread after a signal is delivered,
+// through a pipe written by the signal handler, as a handler can do nothing
+// else safely. Signals arriving before the callback ran are coalesced. At
+// most one watcher per signal. POSIX only.
+class NaiveSignalWatcher : public base::MessagePumpForIO::FdWatcher {
+ public:
+  NaiveSignalWatcher(int signal, base::RepeatingClosure callback);
+  // Ignores the signal from then on.
+  ~NaiveSignalWatcher() override;
+  NaiveSignalWatcher(const NaiveSignalWatcher&) = delete;
+  NaiveSignalWatcher& operator=(const NaiveSignalWatcher&) = delete;
+
+  bool Start();
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  const int signal_;
+  const base::RepeatingClosure callback_;
+  base::ScopedFD read_fd_;
+  base::ScopedFD write_fd_;
+  base::MessagePumpForIO::FdWatchController watcher_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SIGNAL_WATCHER_H_
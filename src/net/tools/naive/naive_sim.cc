@@ -0,0 +1,747 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs NaiveConnections to direct destinations in process on virtual time,
+// over modelled links with bandwidth, round trip time and loss, to compare
+// relay options reproducibly in seconds instead of with live tests. Each
+// connection relays between a client and a destination simulated on the
+// far ends of socket pairs: the client uploads --upload bytes, and the
+// destination answers with --download bytes one round trip after naive
+// connects to it. Both close once the other has all their bytes.
+//
+// Time is mocked for the whole process, so the relay, its yields and
+// timers, and the time function of NaiveConnection all run on it, and a
+// run with the same options and --seed gives the same result. Relay options
+// of naive, such as --relay-buffer-max or --relay-yield-bytes, are taken
+// as naive takes them. The sockets are AF_UNIX pairs, so kernel relays such
+// as --relay-splice are left off, and connects complete at once. Prints the
+// flow completion times, the goodput and its fairness across connections,
+// and the yields of the relay as one JSON object.
+//
+//   naive_sim --connections=1000 --download=1048576 --client-rtt=50
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/files/file_descriptor_watcher_posix.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/bind.h"
+#include "base/json/json_writer.h"
+#include "base/logging.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/process_metrics.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/test/task_environment.h"
+#include "base/time/time.h"
+#include "base/time/time_override.h"
+#include "base/values.h"
+#include "net/base/address_list.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/http/http_network_session.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_transaction_factory.h"
+#include "net/log/net_log_source.h"
+#include "net/log/net_log_with_source.h"
+#include "net/proxy_resolution/configured_proxy_resolution_service.h"
+#include "net/proxy_resolution/proxy_config.h"
+#include "net/proxy_resolution/proxy_config_service_fixed.h"
+#include "net/proxy_resolution/proxy_config_with_annotation.h"
+#include "net/proxy_resolution/proxy_info.h"
+#include "net/socket/client_socket_factory.h"
+#include "net/socket/client_socket_pool_manager.h"
+#include "net/socket/datagram_client_socket.h"
+#include "net/socket/ssl_client_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_socket.h"
+#include "net/tools/naive/naive_command_line.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_connection.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_proxy_delegate.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "net/url_request/url_request_context.h"
+#include "net/url_request/url_request_context_builder.h"
+
+namespace net {
+namespace {
+
+constexpr NetworkTrafficAnnotationTag kTrafficAnnotation =
+    DefineNetworkTrafficAnnotation("naive_sim", "");
+// Of the modelled links, as TCP segments a stream on Ethernet.
+constexpr size_t kPacketSize = 1448;
+constexpr size_t kIoSize = 64 * 1024;
+// Destinations are numbered by their address in 10.0.0.0/8.
+constexpr int kMaxConnections = 1 << 24;
+constexpr uint16_t kOriginPort = 80;
+
+// The payload is not looked at, so reads share one buffer and writes send
+// zeros.
+char g_read_buffer[kIoSize];
+const char g_zeros[kIoSize] = {};
+
+// SplitMix64, seeded by --seed.
+uint64_t NextRandom(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+// In [0, 1).
+double NextRandomUnit(uint64_t* state) {
+  return (NextRandom(state) >> 11) * 0x1.0p-53;
+}
+
+struct LinkParams {
+  base::TimeDelta GetTransmitTime(size_t bytes) const {
+    return base::Seconds(bytes * 8.0 / bits_per_second);
+  }
+  // Twice the bandwidth-delay product unless set, as TCP autotunes it.
+  size_t GetWindow() const {
+    if (window > 0)
+      return window;
+    double bdp = bits_per_second / 8.0 * rtt.InSecondsF();
+    return std::max<size_t>(2 * bdp, kIoSize);
+  }
+
+  int64_t bits_per_second = 100'000'000;
+  base::TimeDelta rtt = base::Milliseconds(20);
+  // Of each packet.
+  double loss = 0;
+  // The bytes in flight on the link at most, those sent and not yet taken
+  // by the receiving end.
+  size_t window = 0;
+};
+
+struct Options {
+  int connections = 100;
+  // Between the starts of the connections.
+  base::TimeDelta arrival = base::Milliseconds(10);
+  int64_t upload = 16 * 1024;
+  int64_t download = 1024 * 1024;
+  // Between the client and naive, and naive and the destination.
+  LinkParams client_link;
+  LinkParams server_link;
+  // Of every socket end.
+  int socket_buffer = 128 * 1024;
+  uint64_t seed = 1;
+  // Of virtual time, after which the connections not done are reported.
+  base::TimeDelta time_limit = base::Hours(1);
+};
+
+// Carries one direction of a connection over a modelled link, from a
+// socket end or a generator of `generate` bytes, to a socket end or a
+// counter. Bytes are taken into the link while less than its window is in
+// flight, serialized at its bandwidth in packets, and delivered half a
+// round trip later in order. A lost packet arrives a round trip later than
+// it would have, holding up the bytes behind it as TCP does.
+class SimStream {
+ public:
+  SimStream(const LinkParams& link,
+            uint64_t* random_state,
+            base::ScopedFD read_fd,
+            base::ScopedFD write_fd,
+            int64_t generate,
+            base::RepeatingClosure progress_callback)
+      : link_(link),
+        window_(link.GetWindow()),
+        random_state_(random_state),
+        read_fd_(std::move(read_fd)),
+        write_fd_(std::move(write_fd)),
+        generate_left_(generate),
+        progress_callback_(std::move(progress_callback)) {}
+  SimStream(const SimStream&) = delete;
+  SimStream& operator=(const SimStream&) = delete;
+
+  void Start() { Pump(); }
+  // Lets a generator send its FIN after its bytes.
+  void Close() {
+    close_ = true;
+    Pump();
+  }
+  // Bytes written to the socket end or counted.
+  int64_t received() const { return received_; }
+  bool finished() const { return fin_delivered_; }
+  base::WeakPtr<SimStream> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
+ private:
+  void Pump() {
+    while (!fin_sent_ && in_flight_ < window_) {
+      size_t room = std::min(window_ - in_flight_, kIoSize);
+      if (!read_fd_.is_valid()) {
+        size_t size = std::min<int64_t>(room, generate_left_);
+        if (size > 0) {
+          generate_left_ -= size;
+          Send(size, /*fin=*/false);
+          continue;
+        }
+        if (close_)
+          Send(0, /*fin=*/true);
+        return;
+      }
+      ssize_t rv = HANDLE_EINTR(read(read_fd_.get(), g_read_buffer, room));
+      if (rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Unretained is safe because the watcher is owned by this.
+        if (!read_watcher_) {
+          read_watcher_ = base::FileDescriptorWatcher::WatchReadable(
+              read_fd_.get(),
+              base::BindRepeating(&SimStream::Pump, base::Unretained(this)));
+        }
+        return;
+      }
+      if (rv > 0) {
+        Send(rv, /*fin=*/false);
+        continue;
+      }
+      // Naive closed its end, a reset counting as a FIN.
+      read_watcher_.reset();
+      read_fd_.reset();
+      Send(0, /*fin=*/true);
+      return;
+    }
+    // Reads again once the window opens.
+    read_watcher_.reset();
+  }
+
+  void Send(size_t size, bool fin) {
+    const base::TimeTicks now = base::TimeTicks::Now();
+    in_flight_ += size;
+    fin_sent_ = fin;
+    do {
+      size_t packet = std::min(size, kPacketSize);
+      size -= packet;
+      link_free_time_ = std::max(link_free_time_, now) +
+                        link_.GetTransmitTime(packet);
+      base::TimeTicks arrival = link_free_time_ + link_.rtt / 2;
+      while (link_.loss > 0 && NextRandomUnit(random_state_) < link_.loss) {
+        arrival += link_.rtt;
+      }
+      arrival = std::max(arrival, last_arrival_time_);
+      last_arrival_time_ = arrival;
+      base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+          FROM_HERE,
+          base::BindOnce(&SimStream::Deliver, weak_factory_.GetWeakPtr(),
+                         packet, fin && size == 0),
+          arrival - now);
+    } while (size > 0);
+  }
+
+  void Deliver(size_t size, bool fin) {
+    if (!write_fd_.is_valid()) {
+      received_ += size;
+      fin_delivered_ = fin_delivered_ || fin;
+      Consume(size);
+      return;
+    }
+    write_pending_ += size;
+    fin_pending_ = fin_pending_ || fin;
+    Flush();
+  }
+
+  void Flush() {
+    size_t written = 0;
+    while (write_pending_ > 0) {
+      ssize_t rv = HANDLE_EINTR(send(write_fd_.get(), g_zeros,
+                                     std::min(write_pending_, kIoSize),
+                                     MSG_NOSIGNAL));
+      if (rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Unretained is safe because the watcher is owned by this.
+        if (!write_watcher_) {
+          write_watcher_ = base::FileDescriptorWatcher::WatchWritable(
+              write_fd_.get(),
+              base::BindRepeating(&SimStream::Flush, base::Unretained(this)));
+        }
+        break;
+      }
+      // Bytes for an end naive closed are dropped.
+      size_t size = rv < 0 ? write_pending_ : static_cast<size_t>(rv);
+      write_pending_ -= size;
+      written += size;
+    }
+    if (write_pending_ == 0) {
+      write_watcher_.reset();
+      if (fin_pending_) {
+        shutdown(write_fd_.get(), SHUT_WR);
+        write_fd_.reset();
+        fin_delivered_ = true;
+      }
+    }
+    received_ += written;
+    Consume(written);
+  }
+
+  // Opens the window by bytes the receiving end took.
+  void Consume(size_t size) {
+    in_flight_ -= size;
+    progress_callback_.Run();
+    Pump();
+  }
+
+  const LinkParams link_;
+  const size_t window_;
+  const raw_ptr<uint64_t> random_state_;
+
+  base::ScopedFD read_fd_;
+  base::ScopedFD write_fd_;
+  int64_t generate_left_;
+  bool close_ = false;
+  base::RepeatingClosure progress_callback_;
+  std::unique_ptr<base::FileDescriptorWatcher::Controller> read_watcher_;
+  std::unique_ptr<base::FileDescriptorWatcher::Controller> write_watcher_;
+
+  size_t in_flight_ = 0;
+  bool fin_sent_ = false;
+  // When the link is done serializing the packets sent so far.
+  base::TimeTicks link_free_time_;
+  base::TimeTicks last_arrival_time_;
+
+  size_t write_pending_ = 0;
+  bool fin_pending_ = false;
+  int64_t received_ = 0;
+  bool fin_delivered_ = false;
+
+  base::WeakPtrFactory<SimStream> weak_factory_{this};
+};
+
+class Simulation : public ClientSocketFactory {
+ public:
+  Simulation(const Options& options, const NaiveRelayConfig& relay_config)
+      : options_(options),
+        relay_config_(relay_config),
+        random_state_(options.seed),
+        connections_(options.connections) {
+    direct_proxy_info_.UseDirect();
+    // Kernel relays need TCP sockets.
+    relay_config_.splice = false;
+    relay_config_.io_uring = false;
+    relay_config_.sockmap = false;
+    relay_config_.rio = false;
+    relay_config_.notsent_lowat = 0;
+    relay_config_.zerocopy_threshold = 0;
+  }
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+  ~Simulation() override = default;
+
+  base::Value::Dict Run() {
+    const base::TimeTicks wall_start =
+        base::subtle::TimeTicksNowIgnoringOverride();
+    context_ = BuildContext();
+    start_time_ = base::TimeTicks::Now();
+    auto* task_runner = base::SingleThreadTaskRunner::GetCurrentDefault().get();
+    for (int i = 0; i < options_.connections; ++i) {
+      task_runner->PostDelayedTask(
+          FROM_HERE,
+          base::BindOnce(&Simulation::StartConnection, base::Unretained(this),
+                         i),
+          options_.arrival * i);
+    }
+    base::RunLoop run_loop;
+    quit_closure_ = run_loop.QuitClosure();
+    task_runner->PostDelayedTask(FROM_HERE, quit_closure_,
+                                 options_.time_limit);
+    run_loop.Run();
+    base::Value::Dict result = Summarize();
+    result.Set("wall_seconds",
+               (base::subtle::TimeTicksNowIgnoringOverride() - wall_start)
+                   .InSecondsF());
+    return result;
+  }
+
+  // ClientSocketFactory implementation.
+  std::unique_ptr<DatagramClientSocket> CreateDatagramClientSocket(
+      DatagramSocket::BindType bind_type,
+      NetLog* net_log,
+      const NetLogSource& source) override {
+    NOTREACHED();
+  }
+  std::unique_ptr<TransportClientSocket> CreateTransportClientSocket(
+      const AddressList& addresses,
+      std::unique_ptr<SocketPerformanceWatcher> socket_performance_watcher,
+      NetworkQualityEstimator* network_quality_estimator,
+      NetLog* net_log,
+      const NetLogSource& source) override {
+    const IPEndPoint& endpoint = addresses.front();
+    const IPAddressBytes& bytes = endpoint.address().bytes();
+    int index = (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    CHECK_LT(index, options_.connections);
+    SimConnection& sim = connections_[index];
+    base::ScopedFD fds[2];
+    CreateSocketPair(fds);
+    auto progress =
+        base::BindRepeating(&Simulation::OnProgress, base::Unretained(this),
+                            index);
+    sim.streams[kServerUp] = std::make_unique<SimStream>(
+        options_.server_link, &random_state_, DupFD(fds[1]), base::ScopedFD(),
+        0, progress);
+    sim.streams[kServerDown] = std::make_unique<SimStream>(
+        options_.server_link, &random_state_, base::ScopedFD(),
+        std::move(fds[1]), options_.download, progress);
+    sim.streams[kServerUp]->Start();
+    // The answer leaves the destination once the request reached it.
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostDelayedTask(
+        FROM_HERE,
+        base::BindOnce(&SimStream::Start,
+                       sim.streams[kServerDown]->GetWeakPtr()),
+        options_.server_link.rtt);
+    return AdoptSocket(std::move(fds[0]), endpoint, net_log);
+  }
+  std::unique_ptr<SSLClientSocket> CreateSSLClientSocket(
+      SSLClientContext* context,
+      std::unique_ptr<StreamSocket> stream_socket,
+      const HostPortPair& host_and_port,
+      const SSLConfig& ssl_config) override {
+    NOTREACHED();
+  }
+
+ private:
+  enum StreamIndex {
+    // Client to naive, and naive to the destination.
+    kClientUp,
+    kServerUp,
+    // Destination to naive, and naive to the client.
+    kServerDown,
+    kClientDown,
+    kNumStreams,
+  };
+
+  struct SimConnection {
+    base::TimeTicks start_time;
+    // When the client had the download and the destination the upload.
+    base::TimeTicks complete_time;
+    std::unique_ptr<NaiveConnection> connection;
+    std::unique_ptr<SimStream> streams[kNumStreams];
+    int result = ERR_IO_PENDING;
+    uint64_t yields = 0;
+  };
+
+  std::unique_ptr<URLRequestContext> BuildContext() {
+    URLRequestContextBuilder builder;
+    builder.DisableHttpCache();
+    auto proxy_service =
+        ConfiguredProxyResolutionService::CreateWithoutProxyResolver(
+            std::make_unique<ProxyConfigServiceFixed>(
+                ProxyConfigWithAnnotation(ProxyConfig(), kTrafficAnnotation)),
+            /*net_log=*/nullptr);
+    proxy_service->ForceReloadProxyConfig();
+    builder.set_proxy_resolution_service(std::move(proxy_service));
+    auto proxy_delegate = std::make_unique<NaiveProxyDelegate>(
+        HttpRequestHeaders(), std::vector<PaddingType>{PaddingType::kNone},
+        /*fastopen=*/false, base::FilePath(), base::TimeDelta(),
+        /*bond_members=*/0);
+    proxy_delegate_ = proxy_delegate.get();
+    builder.set_proxy_delegate(std::move(proxy_delegate));
+    builder.set_client_socket_factory_for_testing(this);
+    return builder.Build();
+  }
+
+  void CreateSocketPair(base::ScopedFD fds[2]) {
+    int pair[2];
+    PCHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                      pair) == 0);
+    for (int i = 0; i < 2; ++i) {
+      fds[i].reset(pair[i]);
+      for (int option : {SO_SNDBUF, SO_RCVBUF}) {
+        setsockopt(pair[i], SOL_SOCKET, option, &options_.socket_buffer,
+                   sizeof(options_.socket_buffer));
+      }
+    }
+  }
+
+  static base::ScopedFD DupFD(const base::ScopedFD& fd) {
+    base::ScopedFD dup_fd(HANDLE_EINTR(dup(fd.get())));
+    PCHECK(dup_fd.is_valid());
+    return dup_fd;
+  }
+
+  static std::unique_ptr<TCPClientSocket> AdoptSocket(
+      base::ScopedFD fd,
+      const IPEndPoint& peer_address,
+      NetLog* net_log) {
+    auto tcp_socket = std::make_unique<TCPSocket>(
+        /*socket_performance_watcher=*/nullptr, net_log, NetLogSource());
+    CHECK_EQ(tcp_socket->AdoptConnectedSocket(fd.release(), peer_address),
+             OK);
+    return std::make_unique<TCPClientSocket>(std::move(tcp_socket),
+                                             peer_address);
+  }
+
+  void StartConnection(int index) {
+    SimConnection& sim = connections_[index];
+    sim.start_time = base::TimeTicks::Now();
+    base::ScopedFD fds[2];
+    CreateSocketPair(fds);
+    auto progress =
+        base::BindRepeating(&Simulation::OnProgress, base::Unretained(this),
+                            index);
+    sim.streams[kClientUp] = std::make_unique<SimStream>(
+        options_.client_link, &random_state_, base::ScopedFD(), DupFD(fds[1]),
+        options_.upload, progress);
+    sim.streams[kClientDown] = std::make_unique<SimStream>(
+        options_.client_link, &random_state_, std::move(fds[1]),
+        base::ScopedFD(), 0, progress);
+
+    HttpNetworkSession* session =
+        context_->http_transaction_factory()->GetSession();
+    sim.connection = std::make_unique<NaiveConnection>(
+        index, ClientProtocol::kEmbedded,
+        std::make_unique<PaddingDetectorDelegate>(
+            proxy_delegate_, direct_proxy_info_.proxy_chain(),
+            ClientProtocol::kEmbedded),
+        direct_proxy_info_, relay_config_, /*resolver=*/nullptr, session,
+        network_anonymization_key_, NetLogWithSource(),
+        AdoptSocket(std::move(fds[0]), IPEndPoint(), /*net_log=*/nullptr),
+        kTrafficAnnotation);
+    IPAddress origin(10, (index >> 16) & 0xff, (index >> 8) & 0xff,
+                     index & 0xff);
+    sim.connection->set_origin(
+        HostPortPair::FromIPEndPoint(IPEndPoint(origin, kOriginPort)));
+    sim.streams[kClientUp]->Start();
+    sim.streams[kClientDown]->Start();
+
+    // Unretained is safe because this outlives the run loop.
+    int rv = sim.connection->Connect(base::BindOnce(
+        &Simulation::OnConnectComplete, base::Unretained(this), index));
+    if (rv != ERR_IO_PENDING)
+      OnConnectComplete(index, rv);
+  }
+
+  void OnConnectComplete(int index, int result) {
+    SimConnection& sim = connections_[index];
+    if (result == OK) {
+      result = sim.connection->Run(base::BindOnce(
+          &Simulation::OnRunComplete, base::Unretained(this), index));
+      if (result == ERR_IO_PENDING)
+        return;
+    }
+    OnRunComplete(index, result);
+  }
+
+  void OnRunComplete(int index, int result) {
+    SimConnection& sim = connections_[index];
+    sim.result = result;
+    sim.yields = sim.connection->yield_count();
+    // Not in its own callback.
+    base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+        FROM_HERE, std::move(sim.connection));
+    // The streams go on to see the ends naive closed.
+    if (++closed_connections_ == options_.connections)
+      quit_closure_.Run();
+  }
+
+  void OnProgress(int index) {
+    SimConnection& sim = connections_[index];
+    if (!sim.complete_time.is_null() || !sim.streams[kServerUp] ||
+        sim.streams[kClientDown]->received() < options_.download ||
+        sim.streams[kServerUp]->received() < options_.upload) {
+      return;
+    }
+    sim.complete_time = base::TimeTicks::Now();
+    sim.streams[kClientUp]->Close();
+    sim.streams[kServerDown]->Close();
+  }
+
+  base::Value::Dict Summarize() const {
+    std::vector<base::TimeDelta> completion_times;
+    std::vector<double> goodputs;
+    int errors = 0;
+    uint64_t yields = 0;
+    base::TimeTicks last_complete_time = start_time_;
+    for (const SimConnection& sim : connections_) {
+      if (sim.result != OK && sim.result != ERR_IO_PENDING)
+        ++errors;
+      yields += sim.yields;
+      if (sim.complete_time.is_null())
+        continue;
+      base::TimeDelta completion_time = sim.complete_time - sim.start_time;
+      completion_times.push_back(completion_time);
+      goodputs.push_back((options_.upload + options_.download) * 8.0 /
+                         completion_time.InSecondsF());
+      last_complete_time = std::max(last_complete_time, sim.complete_time);
+    }
+    std::sort(completion_times.begin(), completion_times.end());
+
+    base::Value::Dict result;
+    result.Set("connections", options_.connections);
+    result.Set("completed", static_cast<int>(completion_times.size()));
+    result.Set("errors", errors);
+    if (!completion_times.empty()) {
+      base::Value::Dict fct;
+      for (auto [name, percentile] :
+           {std::pair("p50", 50), std::pair("p90", 90), std::pair("p99", 99),
+            std::pair("max", 100)}) {
+        size_t rank = (completion_times.size() - 1) * percentile / 100;
+        fct.Set(name, completion_times[rank].InMillisecondsF());
+      }
+      result.Set("fct_ms", std::move(fct));
+      // Jain's index: 1 when all connections got the same goodput.
+      double sum = 0;
+      double sum_squares = 0;
+      for (double goodput : goodputs) {
+        sum += goodput;
+        sum_squares += goodput * goodput;
+      }
+      result.Set("fairness", sum * sum / (goodputs.size() * sum_squares));
+      result.Set("goodput_mbps",
+                 completion_times.size() *
+                     (options_.upload + options_.download) * 8.0 /
+                     (last_complete_time - start_time_).InSecondsF() / 1e6);
+    }
+    result.Set("yields", static_cast<double>(yields));
+    result.Set("virtual_seconds",
+               (base::TimeTicks::Now() - start_time_).InSecondsF());
+    return result;
+  }
+
+  const Options options_;
+  NaiveRelayConfig relay_config_;
+  uint64_t random_state_;
+  ProxyInfo direct_proxy_info_;
+  const NetworkAnonymizationKey network_anonymization_key_;
+  std::unique_ptr<URLRequestContext> context_;
+  // Owned by `context_`.
+  raw_ptr<NaiveProxyDelegate> proxy_delegate_ = nullptr;
+  std::vector<SimConnection> connections_;
+  int closed_connections_ = 0;
+  base::TimeTicks start_time_;
+  base::RepeatingClosure quit_closure_;
+};
+
+bool ParseOptions(const base::CommandLine& command_line, Options* options) {
+  auto get_int = [&command_line](const char* name, int64_t min, int64_t max,
+                                 int64_t* value) {
+    if (!command_line.HasSwitch(name))
+      return true;
+    if (!base::StringToInt64(command_line.GetSwitchValueASCII(name), value) ||
+        *value < min || *value > max) {
+      std::fprintf(stderr, "Invalid %s\n", name);
+      return false;
+    }
+    return true;
+  };
+  int64_t connections = options->connections;
+  int64_t arrival_us = options->arrival.InMicroseconds();
+  int64_t socket_buffer = options->socket_buffer;
+  int64_t seed = options->seed;
+  int64_t time_limit = options->time_limit.InSeconds();
+  if (!get_int("connections", 1, kMaxConnections, &connections) ||
+      !get_int("arrival-us", 0, INT32_MAX, &arrival_us) ||
+      !get_int("upload", 0, INT64_MAX, &options->upload) ||
+      !get_int("download", 0, INT64_MAX, &options->download) ||
+      !get_int("socket-buffer", 4096, INT32_MAX, &socket_buffer) ||
+      !get_int("seed", 0, INT64_MAX, &seed) ||
+      !get_int("time-limit", 1, INT32_MAX, &time_limit)) {
+    return false;
+  }
+  options->connections = connections;
+  options->arrival = base::Microseconds(arrival_us);
+  options->socket_buffer = socket_buffer;
+  options->seed = seed;
+  options->time_limit = base::Seconds(time_limit);
+
+  for (auto [prefix, link] : {std::pair("client-", &options->client_link),
+                              std::pair("server-", &options->server_link)}) {
+    std::string name = prefix;
+    int64_t mbps = link->bits_per_second / 1'000'000;
+    int64_t rtt_ms = link->rtt.InMilliseconds();
+    // In hundredths of a percent.
+    int64_t loss = 0;
+    int64_t window = 0;
+    if (!get_int((name + "mbps").c_str(), 1, 1'000'000, &mbps) ||
+        !get_int((name + "rtt").c_str(), 0, 60'000, &rtt_ms) ||
+        !get_int((name + "loss").c_str(), 0, 5000, &loss) ||
+        !get_int((name + "window").c_str(), 0, INT32_MAX, &window)) {
+      return false;
+    }
+    link->bits_per_second = mbps * 1'000'000;
+    link->rtt = base::Milliseconds(rtt_ms);
+    link->loss = loss / 10000.0;
+    link->window = window;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  DuplicateSwitchCollector::InitInstance();
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+
+  if (command_line.HasSwitch("h") || command_line.HasSwitch("help")) {
+    std::printf(
+        "Usage: naive_sim [OPTIONS] [naive relay options]\n"
+        "\n"
+        "--connections=<N>       Default 100\n"
+        "--arrival-us=<N>        Between connection starts, default 10000\n"
+        "--upload=<bytes>        Per connection, default 16384\n"
+        "--download=<bytes>      Per connection, default 1048576\n"
+        "--client-mbps=<N>       Client to naive, default 100\n"
+        "--client-rtt=<ms>       Default 20\n"
+        "--client-loss=<N>       Per packet, in 0.01%%, default 0\n"
+        "--client-window=<bytes> In flight, default 2 BDP\n"
+        "--server-mbps=<N>       Naive to destination, likewise\n"
+        "--server-rtt=<ms>\n"
+        "--server-loss=<N>\n"
+        "--server-window=<bytes>\n"
+        "--socket-buffer=<bytes> Default 131072\n"
+        "--seed=<N>              Of the losses, default 1\n"
+        "--time-limit=<s>        Of virtual time, default 3600\n"
+        "--log                   Log the connections\n");
+    return EXIT_SUCCESS;
+  }
+
+  net::Options options;
+  if (!net::ParseOptions(command_line, &options))
+    return EXIT_FAILURE;
+  // The relay options as naive parses them, ignoring those of the
+  // simulation.
+  net::NaiveConfig config;
+  if (!config.Parse(GetSwitchesAsValue(command_line)))
+    return EXIT_FAILURE;
+  if (!command_line.HasSwitch("log"))
+    logging::SetMinLogLevel(logging::LOGGING_WARNING);
+  // Each connection goes to its own destination, all at once at worst.
+  constexpr auto kPool = net::HttpNetworkSession::NORMAL_SOCKET_POOL;
+  int max_sockets = std::max(
+      options.connections,
+      net::ClientSocketPoolManager::max_sockets_per_pool(kPool));
+  net::ClientSocketPoolManager::set_max_sockets_per_pool(kPool, max_sockets);
+  net::ClientSocketPoolManager::set_max_sockets_per_proxy_chain(kPool,
+                                                                max_sockets);
+  // Each connection holds six descriptors here and two in naive.
+  base::IncreaseFdLimitTo(std::min(options.connections, 100000) * 8 + 64);
+
+  base::test::TaskEnvironment task_environment(
+      base::test::TaskEnvironment::MainThreadType::IO,
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME);
+  net::Simulation simulation(options, config.relay);
+  base::Value::Dict result = simulation.Run();
+  std::string json;
+  base::JSONWriter::Write(result, &json);
+  std::printf("%s\n", json.c_str());
+  return EXIT_SUCCESS;
+}
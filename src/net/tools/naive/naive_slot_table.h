@@ -0,0 +1,133 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SLOT_TABLE_H_
+#define NET_TOOLS_NAIVE_NAIVE_SLOT_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/check.h"
+
+namespace net {
+
+// Owns objects addressed by handles that pack a slot index with the slot's
+// generation. Lookup, insertion and removal are O(1), and freed slots are
+// reused without allocating. Removing an object bumps its slot's generation,
+// so stale handles stop matching until the generation wraps around.
+template <typename T>
+class NaiveSlotTable {
+ public:
+  using Handle = unsigned int;
+
+  static constexpr Handle kInvalidHandle = 0;
+  static constexpr int kIndexBits = 20;
+  static constexpr size_t kMaxSlots = size_t{1} << kIndexBits;
+
+  NaiveSlotTable() = default;
+  NaiveSlotTable(const NaiveSlotTable&) = delete;
+  NaiveSlotTable& operator=(const NaiveSlotTable&) = delete;
+  ~NaiveSlotTable() = default;
+
+  // Reserves an empty slot and returns its handle, or kInvalidHandle if all
+  // kMaxSlots slots are in use. The object is added with Assign().
+  Handle Allocate() {
+    uint32_t index;
+    if (!free_indices_.empty()) {
+      index = free_indices_.back();
+      free_indices_.pop_back();
+    } else if (slots_.size() < kMaxSlots) {
+      index = static_cast<uint32_t>(slots_.size());
+      slots_.emplace_back();
+    } else {
+      return kInvalidHandle;
+    }
+    Slot& slot = slots_[index];
+    DCHECK(!slot.in_use);
+    slot.in_use = true;
+    ++size_;
+    return MakeHandle(index, slot.generation);
+  }
+
+  void Assign(Handle handle, std::unique_ptr<T> value) {
+    Slot* slot = GetSlot(handle);
+    CHECK(slot);
+    slot->value = std::move(value);
+  }
+
+  // Returns nullptr for stale or invalid handles.
+  T* Find(Handle handle) const {
+    const Slot* slot = GetSlot(handle);
+    return slot ? slot->value.get() : nullptr;
+  }
+
+  // Releases the slot of `handle` and returns its object, or nullptr if the
+  // handle is stale or invalid.
+  std::unique_ptr<T> Remove(Handle handle) {
+    Slot* slot = GetSlot(handle);
+    if (!slot)
+      return nullptr;
+    std::unique_ptr<T> value = std::move(slot->value);
+    slot->in_use = false;
+    slot->generation = NextGeneration(slot->generation);
+    free_indices_.push_back(IndexOf(handle));
+    --size_;
+    return value;
+  }
+
+  size_t size() const { return size_; }
+
+  // Calls `f` with each object in slot order. `f` must not add or remove
+  // objects.
+  template <typename F>
+  void ForEach(F f) {
+    for (Slot& slot : slots_) {
+      if (slot.value)
+        f(*slot.value);
+    }
+  }
+
+ private:
+  static constexpr uint32_t kIndexMask = (uint32_t{1} << kIndexBits) - 1;
+  static constexpr uint32_t kMaxGeneration =
+      (uint32_t{1} << (32 - kIndexBits)) - 1;
+
+  // Generations start at 1 so that no handle equals kInvalidHandle.
+  struct Slot {
+    std::unique_ptr<T> value;
+    uint32_t generation = 1;
+    bool in_use = false;
+  };
+
+  static Handle MakeHandle(uint32_t index, uint32_t generation) {
+    return (generation << kIndexBits) | index;
+  }
+  static uint32_t IndexOf(Handle handle) { return handle & kIndexMask; }
+  static uint32_t GenerationOf(Handle handle) { return handle >> kIndexBits; }
+  static uint32_t NextGeneration(uint32_t generation) {
+    return generation == kMaxGeneration ? 1 : generation + 1;
+  }
+
+  Slot* GetSlot(Handle handle) {
+    return const_cast<Slot*>(std::as_const(*this).GetSlot(handle));
+  }
+  const Slot* GetSlot(Handle handle) const {
+    uint32_t index = IndexOf(handle);
+    if (index >= slots_.size())
+      return nullptr;
+    const Slot& slot = slots_[index];
+    if (!slot.in_use || slot.generation != GenerationOf(handle))
+      return nullptr;
+    return &slot;
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_indices_;
+  size_t size_ = 0;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SLOT_TABLE_H_
@@ -0,0 +1,234 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_sniffer.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/notreached.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/task/current_thread.h"
+#include "net/base/url_util.h"
+
+namespace net {
+
+namespace {
+constexpr size_t kTlsRecordHeaderSize = 5;
+constexpr uint8_t kTlsHandshakeRecord = 0x16;
+constexpr uint8_t kTlsClientHello = 0x01;
+constexpr uint16_t kTlsServerNameExtension = 0x0000;
+constexpr uint8_t kTlsHostName = 0x00;
+// Longest method token looked for before the space after it.
+constexpr size_t kMaxHttpMethodSize = 8;
+// Until the rest of a first segment split in two arrives, the socket stays
+// readable with its first part, so it is peeked again after a while.
+constexpr base::TimeDelta kRetryInterval = base::Milliseconds(5);
+
+uint16_t ReadUint16(std::string_view data, size_t offset) {
+  return static_cast<uint16_t>(static_cast<uint8_t>(data[offset]) << 8 |
+                               static_cast<uint8_t>(data[offset + 1]));
+}
+
+bool SetHost(std::string_view name, std::string* host) {
+  std::string lower = base::ToLowerASCII(name);
+  if (lower.empty() || !IsCanonicalizedHostCompliant(lower))
+    return false;
+  *host = std::move(lower);
+  return true;
+}
+
+NaiveSniffer::Result ParseClientHello(std::string_view data,
+                                      std::string* host) {
+  using Result = NaiveSniffer::Result;
+  if (data.size() < kTlsRecordHeaderSize)
+    return Result::kNeedMore;
+  size_t record_size = ReadUint16(data, 3);
+  // The ClientHello is looked for in the first record only, which holds it
+  // whole with any client seen.
+  std::string_view record = data.substr(kTlsRecordHeaderSize);
+  const Result truncated =
+      record.size() >= record_size ? Result::kNone : Result::kNeedMore;
+  record = record.substr(0, record_size);
+  size_t offset = 0;
+  auto has = [&](size_t size) { return offset + size <= record.size(); };
+
+  // The handshake header, the legacy version and the random.
+  if (!has(1))
+    return truncated;
+  if (static_cast<uint8_t>(record[0]) != kTlsClientHello)
+    return Result::kNone;
+  offset = 4 + 2 + 32;
+  // The session ID, the cipher suites and the compression methods.
+  if (!has(1))
+    return truncated;
+  offset += 1 + static_cast<uint8_t>(record[offset]);
+  if (!has(2))
+    return truncated;
+  offset += 2 + ReadUint16(record, offset);
+  if (!has(1))
+    return truncated;
+  offset += 1 + static_cast<uint8_t>(record[offset]);
+  if (!has(2))
+    return truncated;
+  size_t extensions_end = offset + 2 + ReadUint16(record, offset);
+  offset += 2;
+  while (offset < extensions_end) {
+    if (!has(4))
+      return truncated;
+    uint16_t type = ReadUint16(record, offset);
+    size_t size = ReadUint16(record, offset + 2);
+    offset += 4;
+    if (type != kTlsServerNameExtension) {
+      offset += size;
+      continue;
+    }
+    // The size of the list, then the type and size of its first name.
+    if (!has(5))
+      return truncated;
+    if (static_cast<uint8_t>(record[offset + 2]) != kTlsHostName)
+      return Result::kNone;
+    size_t name_size = ReadUint16(record, offset + 3);
+    offset += 5;
+    if (!has(name_size))
+      return truncated;
+    return SetHost(record.substr(offset, name_size), host) ? Result::kFound
+                                                           : Result::kNone;
+  }
+  return Result::kNone;
+}
+
+NaiveSniffer::Result ParseHttpRequest(std::string_view data,
+                                      std::string* host) {
+  using Result = NaiveSniffer::Result;
+  size_t method_end = 0;
+  while (method_end < data.size() && method_end < kMaxHttpMethodSize &&
+         base::IsAsciiUpper(data[method_end])) {
+    ++method_end;
+  }
+  if (method_end == data.size())
+    return Result::kNeedMore;
+  if (method_end == 0 || data[method_end] != ' ')
+    return Result::kNone;
+  size_t headers_end = data.find("\r\n\r\n");
+  if (headers_end == std::string_view::npos)
+    return Result::kNeedMore;
+  std::vector<std::string_view> lines =
+      base::SplitStringPieceUsingSubstr(data.substr(0, headers_end), "\r\n",
+                                        base::KEEP_WHITESPACE,
+                                        base::SPLIT_WANT_ALL);
+  // Past the request line.
+  for (size_t i = 1; i < lines.size(); ++i) {
+    size_t colon = lines[i].find(':');
+    if (colon == std::string_view::npos ||
+        !base::EqualsCaseInsensitiveASCII(
+            base::TrimWhitespaceASCII(lines[i].substr(0, colon),
+                                      base::TRIM_ALL),
+            "host")) {
+      continue;
+    }
+    std::string name;
+    int port;
+    if (!ParseHostAndPort(base::TrimWhitespaceASCII(
+                              lines[i].substr(colon + 1), base::TRIM_ALL),
+                          &name, &port)) {
+      return Result::kNone;
+    }
+    return SetHost(name, host) ? Result::kFound : Result::kNone;
+  }
+  return Result::kNone;
+}
+}  // namespace
+
+// static
+NaiveSniffer::Result NaiveSniffer::Parse(std::string_view data,
+                                         std::string* host) {
+  if (data.empty())
+    return Result::kNeedMore;
+  if (static_cast<uint8_t>(data[0]) == kTlsHandshakeRecord)
+    return ParseClientHello(data, host);
+  return ParseHttpRequest(data, host);
+}
+
+NaiveSniffer::NaiveSniffer(int fd) : fd_(fd), watcher_(FROM_HERE) {}
+
+NaiveSniffer::~NaiveSniffer() = default;
+
+void NaiveSniffer::Start(base::OnceCallback<void(std::string)> callback) {
+  DCHECK(!callback_);
+  callback_ = std::move(callback);
+  // Unretained is safe because the timers are owned by this.
+  timeout_timer_.Start(FROM_HERE, kTimeout,
+                       base::BindOnce(&NaiveSniffer::Finish,
+                                      base::Unretained(this), std::string()));
+  WatchReadable();
+}
+
+void NaiveSniffer::WatchReadable() {
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          fd_, /*persistent=*/false, base::MessagePumpForIO::WATCH_READ,
+          &watcher_, this)) {
+    // Gives up at the timeout.
+    PLOG(ERROR) << "WatchFileDescriptor failed on read";
+  }
+}
+
+void NaiveSniffer::OnFileCanReadWithoutBlocking(int fd) {
+  Peek();
+}
+
+void NaiveSniffer::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+void NaiveSniffer::Peek() {
+  char buffer[kMaxBytes];
+  ssize_t rv =
+      HANDLE_EINTR(recv(fd_, buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT));
+  if (rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    WatchReadable();
+    return;
+  }
+  // The relay reports the error or the close.
+  if (rv <= 0) {
+    Finish(std::string());
+    return;
+  }
+  std::string host;
+  switch (Parse(std::string_view(buffer, rv), &host)) {
+    case Result::kFound:
+      Finish(std::move(host));
+      return;
+    case Result::kNone:
+      Finish(std::string());
+      return;
+    case Result::kNeedMore:
+      if (static_cast<size_t>(rv) == sizeof(buffer)) {
+        Finish(std::string());
+        return;
+      }
+      retry_timer_.Start(
+          FROM_HERE, kRetryInterval,
+          base::BindOnce(&NaiveSniffer::Peek, base::Unretained(this)));
+      return;
+  }
+}
+
+void NaiveSniffer::Finish(std::string host) {
+  timeout_timer_.Stop();
+  retry_timer_.Stop();
+  watcher_.StopWatchingFileDescriptor();
+  // May destroy this.
+  std::move(callback_).Run(std::move(host));
+}
+
+}  // namespace net
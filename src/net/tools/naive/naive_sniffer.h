@@ -0,0 +1,68 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SNIFFER_H_
+#define NET_TOOLS_NAIVE_NAIVE_SNIFFER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "base/functional/callback.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+// Finds the name a redirected client connects to in its first bytes, the
+// server name of a TLS ClientHello or the Host header of an HTTP request,
+// so the tunnel can ask for the name and let the exit resolve it. Peeks
+// with MSG_PEEK, leaving the bytes in the socket for the relay to read as
+// usual. Linux only.
+class NaiveSniffer : public base::MessagePumpForIO::FdWatcher {
+ public:
+  // Waited at most for the first bytes, which clients of protocols where
+  // the server speaks first never send.
+  static constexpr base::TimeDelta kTimeout = base::Milliseconds(300);
+  // Peeked at most, enough for ClientHellos with post-quantum key shares.
+  static constexpr size_t kMaxBytes = 4096;
+
+  enum class Result {
+    kFound,
+    kNeedMore,
+    kNone,
+  };
+
+  // Parses the start of a client stream. Sets `host` if kFound.
+  static Result Parse(std::string_view data, std::string* host);
+
+  // Does not take ownership of `fd`.
+  explicit NaiveSniffer(int fd);
+  ~NaiveSniffer() override;
+  NaiveSniffer(const NaiveSniffer&) = delete;
+  NaiveSniffer& operator=(const NaiveSniffer&) = delete;
+
+  // Runs `callback` with the name found, or an empty one if there is none
+  // within kTimeout, the client sent something else or closed. Never runs
+  // it synchronously.
+  void Start(base::OnceCallback<void(std::string)> callback);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  void WatchReadable();
+  void Peek();
+  void Finish(std::string host);
+
+  const int fd_;
+  base::MessagePumpForIO::FdWatchController watcher_;
+  base::OneShotTimer timeout_timer_;
+  base::OneShotTimer retry_timer_;
+  base::OnceCallback<void(std::string)> callback_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SNIFFER_H_
@@ -0,0 +1,265 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_sockmap.h"
+
+#include <linux/bpf.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+#include "base/check_op.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "net/base/net_errors.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+#ifndef SO_COOKIE
+#define SO_COOKIE 57
+#endif
+
+namespace net {
+
+namespace {
+int Bpf(int cmd, union bpf_attr* attr) {
+  return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+uint64_t ToU64(const void* ptr) {
+  return reinterpret_cast<uintptr_t>(ptr);
+}
+
+bpf_insn Insn(uint8_t code,
+              uint8_t dst,
+              uint8_t src,
+              int16_t off,
+              int32_t imm) {
+  bpf_insn insn = {};
+  insn.code = code;
+  insn.dst_reg = dst;
+  insn.src_reg = src;
+  insn.off = off;
+  insn.imm = imm;
+  return insn;
+}
+
+bpf_insn MovReg(uint8_t dst, uint8_t src) {
+  return Insn(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0);
+}
+
+bpf_insn MovImm(uint8_t dst, int32_t imm) {
+  return Insn(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm);
+}
+
+bpf_insn Call(int32_t func) {
+  return Insn(BPF_JMP | BPF_CALL, 0, 0, 0, func);
+}
+
+bpf_insn Exit() {
+  return Insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+}
+
+// Loads a map descriptor, taking two instructions.
+void LoadMap(uint8_t dst, int map_fd, bpf_insn* insns) {
+  insns[0] =
+      Insn(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, map_fd);
+  insns[1] = Insn(0, 0, 0, 0, 0);
+}
+
+base::ScopedFD CreateMap(bpf_map_type type,
+                         uint32_t key_size,
+                         uint32_t value_size,
+                         uint32_t max_entries) {
+  union bpf_attr attr = {};
+  attr.map_type = type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  return base::ScopedFD(Bpf(BPF_MAP_CREATE, &attr));
+}
+
+base::ScopedFD LoadProgram(const bpf_insn* insns, size_t count) {
+  static const char kLicense[] = "Dual BSD/GPL";
+  union bpf_attr attr = {};
+  attr.prog_type = BPF_PROG_TYPE_SK_SKB;
+  attr.insns = ToU64(insns);
+  attr.insn_cnt = count;
+  attr.license = ToU64(kLicense);
+  return base::ScopedFD(Bpf(BPF_PROG_LOAD, &attr));
+}
+
+bool Attach(int map_fd, int prog_fd, bpf_attach_type type) {
+  union bpf_attr attr = {};
+  attr.target_fd = map_fd;
+  attr.attach_bpf_fd = prog_fd;
+  attr.attach_type = type;
+  return Bpf(BPF_PROG_ATTACH, &attr) == 0;
+}
+
+int UpdateElem(int map_fd, const void* key, const void* value) {
+  union bpf_attr attr = {};
+  attr.map_fd = map_fd;
+  attr.key = ToU64(key);
+  attr.value = ToU64(value);
+  attr.flags = BPF_ANY;
+  return Bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+void DeleteElem(int map_fd, const void* key) {
+  union bpf_attr attr = {};
+  attr.map_fd = map_fd;
+  attr.key = ToU64(key);
+  // Fails with ENOENT for the sockets the kernel removed on close.
+  Bpf(BPF_MAP_DELETE_ELEM, &attr);
+}
+
+bool GetCookie(int fd, uint64_t* cookie) {
+  socklen_t len = sizeof(*cookie);
+  return getsockopt(fd, SOL_SOCKET, SO_COOKIE, cookie, &len) == 0;
+}
+}  // namespace
+
+NaiveSockmap::NaiveSockmap() = default;
+
+NaiveSockmap::~NaiveSockmap() = default;
+
+// static
+NaiveSockmap* NaiveSockmap::GetForCurrentThread() {
+  // Setting up is only tried once per thread.
+  return GetOrCreateForCurrentThread<NaiveSockmap>(
+      []() -> std::unique_ptr<NaiveSockmap> {
+        auto sockmap = base::WrapUnique(new NaiveSockmap());
+        if (!sockmap->Init()) {
+          LOG(WARNING) << "BPF sockmap is unavailable, relaying as usual";
+          return nullptr;
+        }
+        return sockmap;
+      });
+}
+
+bool NaiveSockmap::Init() {
+  sockmap_fd_ = CreateMap(BPF_MAP_TYPE_SOCKMAP, sizeof(uint32_t),
+                          sizeof(uint32_t), 2 * kMaxPairs);
+  if (!sockmap_fd_.is_valid()) {
+    PLOG(WARNING) << "Cannot create sockmap";
+    return false;
+  }
+  peers_fd_ = CreateMap(BPF_MAP_TYPE_HASH, sizeof(uint64_t), sizeof(uint32_t),
+                        2 * kMaxPairs);
+  if (!peers_fd_.is_valid()) {
+    PLOG(WARNING) << "Cannot create peer map";
+    return false;
+  }
+
+  // Passes each skb whole instead of framing messages. Kernels from 5.10
+  // do without, older ones need one for the verdict to run.
+  const bpf_insn parser[] = {
+      Insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_0, BPF_REG_1,
+           offsetof(struct __sk_buff, len), 0),
+      Exit(),
+  };
+  parser_fd_ = LoadProgram(parser, std::size(parser));
+  if (!parser_fd_.is_valid()) {
+    PLOG(WARNING) << "Cannot load sk_skb parser";
+    return false;
+  }
+
+  // key = peers[bpf_get_socket_cookie(skb)];
+  // return key ? bpf_sk_redirect_map(skb, sockmap, *key, 0) : SK_PASS;
+  bpf_insn verdict[18];
+  verdict[0] = MovReg(BPF_REG_6, BPF_REG_1);
+  verdict[1] = Call(BPF_FUNC_get_socket_cookie);
+  verdict[2] =
+      Insn(BPF_STX | BPF_MEM | BPF_DW, BPF_REG_10, BPF_REG_0, -8, 0);
+  verdict[3] = MovReg(BPF_REG_2, BPF_REG_10);
+  verdict[4] = Insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -8);
+  LoadMap(BPF_REG_1, peers_fd_.get(), &verdict[5]);
+  verdict[7] = Call(BPF_FUNC_map_lookup_elem);
+  // To the SK_PASS at 16.
+  verdict[8] = Insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 7, 0);
+  verdict[9] = Insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_0, 0, 0);
+  verdict[10] = MovReg(BPF_REG_1, BPF_REG_6);
+  LoadMap(BPF_REG_2, sockmap_fd_.get(), &verdict[11]);
+  verdict[13] = MovImm(BPF_REG_4, 0);
+  verdict[14] = Call(BPF_FUNC_sk_redirect_map);
+  verdict[15] = Exit();
+  verdict[16] = MovImm(BPF_REG_0, SK_PASS);
+  verdict[17] = Exit();
+  verdict_fd_ = LoadProgram(verdict, std::size(verdict));
+  if (!verdict_fd_.is_valid()) {
+    PLOG(WARNING) << "Cannot load sk_skb verdict";
+    return false;
+  }
+
+  if (!Attach(sockmap_fd_.get(), parser_fd_.get(),
+              BPF_SK_SKB_STREAM_PARSER) ||
+      !Attach(sockmap_fd_.get(), verdict_fd_.get(),
+              BPF_SK_SKB_STREAM_VERDICT)) {
+    PLOG(WARNING) << "Cannot attach sk_skb programs";
+    return false;
+  }
+
+  pairs_.resize(kMaxPairs);
+  // Lower pairs are handed out first.
+  for (int i = kMaxPairs - 1; i >= 0; --i) {
+    free_pairs_.push_back(i);
+  }
+  return true;
+}
+
+int NaiveSockmap::AddPair(int fd_a, int fd_b) {
+  if (free_pairs_.empty())
+    return ERR_INSUFFICIENT_RESOURCES;
+  Pair pair;
+  if (!GetCookie(fd_a, &pair.cookies[0]) ||
+      !GetCookie(fd_b, &pair.cookies[1])) {
+    return MapSystemError(errno);
+  }
+  int index = free_pairs_.back();
+  const int fds[2] = {fd_a, fd_b};
+  // The peers go in first, so no skb of an inserted socket misses them.
+  for (int i = 0; i < 2; ++i) {
+    uint32_t peer_key = index * 2 + (1 - i);
+    if (UpdateElem(peers_fd_.get(), &pair.cookies[i], &peer_key) != 0) {
+      int error = errno;
+      for (int j = 0; j < i; ++j) {
+        DeleteElem(peers_fd_.get(), &pair.cookies[j]);
+      }
+      return MapSystemError(error);
+    }
+  }
+  for (int i = 0; i < 2; ++i) {
+    uint32_t key = index * 2 + i;
+    uint32_t fd = fds[i];
+    if (UpdateElem(sockmap_fd_.get(), &key, &fd) != 0) {
+      int error = errno;
+      PLOG(WARNING) << "Cannot insert socket into sockmap";
+      pairs_[index] = pair;
+      free_pairs_.pop_back();
+      RemovePair(index);
+      return MapSystemError(error);
+    }
+  }
+  pairs_[index] = pair;
+  free_pairs_.pop_back();
+  return index;
+}
+
+void NaiveSockmap::RemovePair(int pair) {
+  DCHECK_GE(pair, 0);
+  DCHECK_LT(pair, kMaxPairs);
+  for (int i = 0; i < 2; ++i) {
+    uint32_t key = pair * 2 + i;
+    DeleteElem(sockmap_fd_.get(), &key);
+    DeleteElem(peers_fd_.get(), &pairs_[pair].cookies[i]);
+  }
+  pairs_[pair] = Pair();
+  free_pairs_.push_back(pair);
+}
+
+}  // namespace net
@@ -0,0 +1,60 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SOCKMAP_H_
+#define NET_TOOLS_NAIVE_NAIVE_SOCKMAP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+
+namespace net {
+
+// A BPF sockmap of an IO thread whose sk_skb stream verdict program
+// redirects everything received on a socket to the send queue of its peer,
+// so the kernel relays pairs of TCP sockets by itself. The program and maps
+// are set up with raw bpf(2) syscalls. The peer of a socket is looked up by
+// its socket cookie in a hash map next to the sockmap. Linux only.
+class NaiveSockmap {
+ public:
+  // Pairs relayed per thread at once.
+  static constexpr int kMaxPairs = 4096;
+
+  NaiveSockmap(const NaiveSockmap&) = delete;
+  NaiveSockmap& operator=(const NaiveSockmap&) = delete;
+  ~NaiveSockmap();
+
+  // Returns the sockmap of the calling thread, setting it up on first use,
+  // or nullptr if it is not available, e.g. without CAP_BPF or
+  // CAP_NET_ADMIN, or on kernels whose sk_skb programs cannot get socket
+  // cookies.
+  static NaiveSockmap* GetForCurrentThread();
+
+  // Starts relaying between two connected TCP sockets, returning the pair
+  // to remove, or a net error if the map is full or a socket cannot be
+  // inserted.
+  int AddPair(int fd_a, int fd_b);
+  // Stops relaying a pair, which is done anyway once its sockets close.
+  void RemovePair(int pair);
+
+ private:
+  struct Pair {
+    uint64_t cookies[2] = {0, 0};
+  };
+
+  NaiveSockmap();
+  bool Init();
+
+  base::ScopedFD sockmap_fd_;
+  // Socket cookie to the sockmap key of the peer.
+  base::ScopedFD peers_fd_;
+  base::ScopedFD parser_fd_;
+  base::ScopedFD verdict_fd_;
+
+  std::vector<Pair> pairs_;
+  std::vector<int> free_pairs_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SOCKMAP_H_
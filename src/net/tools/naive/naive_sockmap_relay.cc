@@ -0,0 +1,203 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_sockmap_relay.h"
+
+// Not <netinet/tcp.h>, whose tcp_info lacks the byte counters.
+#include <linux/sockios.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "net/base/net_errors.h"
+#include "net/tools/naive/naive_sockmap.h"
+
+namespace net {
+
+namespace {
+constexpr int kDrainSize = 16 * 1024;
+// For the kernel to write what it has redirected, checked every
+// kForwardPollInterval.
+constexpr base::TimeDelta kForwardTimeout = base::Seconds(2);
+constexpr base::TimeDelta kForwardPollInterval = base::Milliseconds(5);
+
+Direction Other(Direction d) {
+  return d == kClient ? kServer : kClient;
+}
+
+bool GetTcpInfo(int fd, struct tcp_info* info) {
+  socklen_t len = sizeof(*info);
+  *info = {};
+  return getsockopt(fd, IPPROTO_TCP, TCP_INFO, info, &len) == 0;
+}
+
+// Bytes received, including those not read yet.
+uint64_t GetBytesReceived(int fd) {
+  struct tcp_info info;
+  if (!GetTcpInfo(fd, &info))
+    return 0;
+  return info.tcpi_bytes_received;
+}
+
+// Bytes written, including those not acknowledged or sent yet.
+uint64_t GetBytesWritten(int fd) {
+  struct tcp_info info;
+  int outq = 0;
+  if (!GetTcpInfo(fd, &info) || ioctl(fd, SIOCOUTQ, &outq) != 0)
+    return 0;
+  return info.tcpi_bytes_acked + outq;
+}
+
+int GetBytesUnread(int fd) {
+  int inq = 0;
+  if (ioctl(fd, SIOCINQ, &inq) != 0)
+    return 0;
+  return inq;
+}
+}  // namespace
+
+NaiveSockmapRelay::NaiveSockmapRelay(NaiveSockmap* sockmap,
+                                     int client_fd,
+                                     int server_fd)
+    : sockmap_(sockmap),
+      fds_{client_fd, server_fd},
+      read_watchers_{base::MessagePumpForIO::FdWatchController(FROM_HERE),
+                     base::MessagePumpForIO::FdWatchController(FROM_HERE)},
+      write_watchers_{base::MessagePumpForIO::FdWatchController(FROM_HERE),
+                      base::MessagePumpForIO::FdWatchController(FROM_HERE)} {}
+
+NaiveSockmapRelay::~NaiveSockmapRelay() {
+  // Before the sockets are closed, so their keys are free for reuse.
+  if (pair_ >= 0)
+    sockmap_->RemovePair(pair_);
+}
+
+int NaiveSockmapRelay::Run(CompletionOnceCallback callback) {
+  DCHECK(!callback_);
+
+  for (Direction d : {kClient, kServer}) {
+    bytes_received_before_[d] =
+        GetBytesReceived(fds_[d]) - GetBytesUnread(fds_[d]);
+    bytes_written_before_[d] = GetBytesWritten(fds_[d]);
+  }
+  int rv = sockmap_->AddPair(fds_[kClient], fds_[kServer]);
+  if (rv < 0)
+    return rv;
+  pair_ = rv;
+
+  callback_ = std::move(callback);
+  Drain(kClient);
+  // The client direction may have finished the relay synchronously.
+  if (callback_)
+    Drain(kServer);
+  return ERR_IO_PENDING;
+}
+
+int64_t NaiveSockmapRelay::bytes_relayed(Direction from) const {
+  if (pair_ < 0)
+    return 0;
+  return GetBytesReceived(fds_[from]) - bytes_received_before_[from];
+}
+
+void NaiveSockmapRelay::OnFileCanReadWithoutBlocking(int fd) {
+  Drain(fd == fds_[kClient] ? kClient : kServer);
+}
+
+void NaiveSockmapRelay::OnFileCanWriteWithoutBlocking(int fd) {
+  // The writable side is the destination of the other direction.
+  Drain(fd == fds_[kClient] ? kServer : kClient);
+}
+
+void NaiveSockmapRelay::Drain(Direction from) {
+  if (!callback_ || forward_timer_.IsRunning())
+    return;
+  int rv = DoDrain(from);
+  if (rv == ERR_CONNECTION_CLOSED) {
+    eof_time_ = base::TimeTicks::Now();
+    WaitForwarded(from);
+  } else if (rv != ERR_IO_PENDING) {
+    Finish(rv);
+  }
+}
+
+int NaiveSockmapRelay::DoDrain(Direction from) {
+  int src = fds_[from];
+  int dst = fds_[Other(from)];
+
+  // Only the payload queued before the insertion and the EOF are read here,
+  // the program redirects the rest.
+  for (;;) {
+    if (!pending_[from].empty()) {
+      ssize_t rv =
+          HANDLE_EINTR(send(dst, pending_[from].data(), pending_[from].size(),
+                            MSG_DONTWAIT | MSG_NOSIGNAL));
+      if (rv < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          return MapSystemError(errno);
+        if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+                dst, /*persistent=*/false, base::MessagePumpForIO::WATCH_WRITE,
+                &write_watchers_[from], this)) {
+          return ERR_UNEXPECTED;
+        }
+        return ERR_IO_PENDING;
+      }
+      pending_[from].erase(0, rv);
+      continue;
+    }
+
+    char buffer[kDrainSize];
+    ssize_t rv = HANDLE_EINTR(recv(src, buffer, sizeof(buffer), MSG_DONTWAIT));
+    if (rv < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return MapSystemError(errno);
+      if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+              src, /*persistent=*/false, base::MessagePumpForIO::WATCH_READ,
+              &read_watchers_[from], this)) {
+        return ERR_UNEXPECTED;
+      }
+      return ERR_IO_PENDING;
+    }
+    if (rv == 0)
+      return ERR_CONNECTION_CLOSED;
+    pending_[from].assign(buffer, rv);
+  }
+}
+
+bool NaiveSockmapRelay::IsForwarded(Direction from) const {
+  Direction to = Other(from);
+  return GetBytesWritten(fds_[to]) - bytes_written_before_[to] >=
+         GetBytesReceived(fds_[from]) - bytes_received_before_[from];
+}
+
+void NaiveSockmapRelay::WaitForwarded(Direction from) {
+  // Closing the sockets would drop what the kernel has yet to write.
+  if (!IsForwarded(from) &&
+      base::TimeTicks::Now() - eof_time_ < kForwardTimeout) {
+    forward_timer_.Start(
+        FROM_HERE, kForwardPollInterval,
+        base::BindOnce(&NaiveSockmapRelay::WaitForwarded,
+                       base::Unretained(this), from));
+    return;
+  }
+  Finish(ERR_CONNECTION_CLOSED);
+}
+
+void NaiveSockmapRelay::Finish(int result) {
+  for (Direction d : {kClient, kServer}) {
+    read_watchers_[d].StopWatchingFileDescriptor();
+    write_watchers_[d].StopWatchingFileDescriptor();
+  }
+  forward_timer_.Stop();
+  std::move(callback_).Run(result);
+}
+
+}  // namespace net
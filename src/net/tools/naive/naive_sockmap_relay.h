@@ -0,0 +1,75 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SOCKMAP_RELAY_H_
+#define NET_TOOLS_NAIVE_NAIVE_SOCKMAP_RELAY_H_
+
+#include <cstdint>
+#include <string>
+
+#include "base/memory/raw_ptr.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/completion_once_callback.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+class NaiveSockmap;
+
+// Relays between two connected TCP sockets in the kernel by inserting them
+// into the NaiveSockmap of the thread, so payload never wakes up userspace.
+// The sockets are still watched for EOF and errors, and the payload that
+// was queued before the insertion is relayed with send(2). EOF is only
+// reported once the kernel has written all payload, as told by TCP_INFO.
+// Only usable when neither side needs padding, TLS or HTTP/2 framing. Linux
+// only.
+class NaiveSockmapRelay : public base::MessagePumpForIO::FdWatcher {
+ public:
+  // Does not take ownership of the socket descriptors.
+  NaiveSockmapRelay(NaiveSockmap* sockmap, int client_fd, int server_fd);
+  ~NaiveSockmapRelay() override;
+  NaiveSockmapRelay(const NaiveSockmapRelay&) = delete;
+  NaiveSockmapRelay& operator=(const NaiveSockmapRelay&) = delete;
+
+  // Returns ERR_IO_PENDING and runs `callback` when either direction reaches
+  // EOF (ERR_CONNECTION_CLOSED) or fails. Returns an error synchronously if
+  // the sockets cannot be inserted.
+  int Run(CompletionOnceCallback callback);
+
+  // Read from TCP_INFO, as the kernel relays the bytes by itself.
+  int64_t bytes_relayed(Direction from) const;
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  void Drain(Direction from);
+  int DoDrain(Direction from);
+  // Whether the kernel has written all that was received from `from`.
+  bool IsForwarded(Direction from) const;
+  void WaitForwarded(Direction from);
+  void Finish(int result);
+
+  const raw_ptr<NaiveSockmap> sockmap_;
+  int fds_[kNumDirections];
+  // Of the sockmap, or -1 before Run().
+  int pair_ = -1;
+  // Counters of TCP_INFO as of Run(), less the unread and unsent bytes.
+  uint64_t bytes_received_before_[kNumDirections] = {0, 0};
+  uint64_t bytes_written_before_[kNumDirections] = {0, 0};
+  // Read from a direction, not yet sent.
+  std::string pending_[kNumDirections];
+
+  base::MessagePumpForIO::FdWatchController read_watchers_[kNumDirections];
+  base::MessagePumpForIO::FdWatchController write_watchers_[kNumDirections];
+  base::OneShotTimer forward_timer_;
+  base::TimeTicks eof_time_;
+
+  CompletionOnceCallback callback_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SOCKMAP_RELAY_H_
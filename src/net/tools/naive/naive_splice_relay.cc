@@ -0,0 +1,167 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_splice_relay.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "net/base/net_errors.h"
+#include "net/tools/naive/naive_relay_scheduler.h"
+
+namespace net {
+
+namespace {
+constexpr int kSpliceSize = 64 * 1024;
+
+Direction Other(Direction d) {
+  return d == kClient ? kServer : kClient;
+}
+}  // namespace
+
+NaiveSpliceRelay::NaiveSpliceRelay(int client_fd,
+                                   int server_fd,
+                                   int yield_bytes,
+                                   bool half_close)
+    : fds_{client_fd, server_fd},
+      yield_bytes_(yield_bytes),
+      half_close_(half_close),
+      read_watchers_{base::MessagePumpForIO::FdWatchController(FROM_HERE),
+                     base::MessagePumpForIO::FdWatchController(FROM_HERE)},
+      write_watchers_{base::MessagePumpForIO::FdWatchController(FROM_HERE),
+                      base::MessagePumpForIO::FdWatchController(FROM_HERE)} {}
+
+NaiveSpliceRelay::~NaiveSpliceRelay() = default;
+
+int NaiveSpliceRelay::Run(CompletionOnceCallback callback) {
+  DCHECK(!callback_);
+
+  for (Direction d : {kClient, kServer}) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+      PLOG(ERROR) << "pipe2 failed";
+      return MapSystemError(errno);
+    }
+    pipe_read_ends_[d].reset(pipe_fds[0]);
+    pipe_write_ends_[d].reset(pipe_fds[1]);
+  }
+
+  callback_ = std::move(callback);
+  Pump(kClient);
+  // The client direction may have finished the relay synchronously.
+  if (callback_)
+    Pump(kServer);
+  return ERR_IO_PENDING;
+}
+
+void NaiveSpliceRelay::OnFileCanReadWithoutBlocking(int fd) {
+  Pump(fd == fds_[kClient] ? kClient : kServer);
+}
+
+void NaiveSpliceRelay::OnFileCanWriteWithoutBlocking(int fd) {
+  // The writable side is the destination of the other direction.
+  Pump(fd == fds_[kClient] ? kServer : kClient);
+}
+
+void NaiveSpliceRelay::Pump(Direction from) {
+  if (!callback_ || done_[from])
+    return;
+  int rv = DoPump(from);
+  if (rv == ERR_IO_PENDING)
+    return;
+  if (rv != ERR_CONNECTION_CLOSED) {
+    Finish(rv);
+    return;
+  }
+
+  // Everything read from `from` has been written.
+  done_[from] = true;
+  Direction to = Other(from);
+  if (done_[to]) {
+    Finish(ERR_CONNECTION_CLOSED);
+    return;
+  }
+  if (half_close_ && shutdown(fds_[to], SHUT_WR) == 0)
+    return;
+  // Still writes out what was spliced into the pipe of the other direction.
+  read_closed_[to] = true;
+  Pump(to);
+}
+
+int NaiveSpliceRelay::DoPump(Direction from) {
+  int src = fds_[from];
+  int dst = fds_[Other(from)];
+  int bytes_passed_without_yielding = 0;
+
+  for (;;) {
+    // Drains the pipe before reading more so EOF is only reported after all
+    // payload has been written.
+    if (pipe_bytes_[from] > 0) {
+      ssize_t rv = HANDLE_EINTR(
+          splice(pipe_read_ends_[from].get(), nullptr, dst, nullptr,
+                 pipe_bytes_[from], SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+      if (rv < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          return MapSystemError(errno);
+        if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+                dst, /*persistent=*/false, base::MessagePumpForIO::WATCH_WRITE,
+                &write_watchers_[from], this)) {
+          return ERR_UNEXPECTED;
+        }
+        return ERR_IO_PENDING;
+      }
+      pipe_bytes_[from] -= rv;
+      bytes_relayed_[from] += rv;
+      continue;
+    }
+
+    if (read_closed_[from])
+      return ERR_CONNECTION_CLOSED;
+
+    if (bytes_passed_without_yielding > yield_bytes_) {
+      NaiveRelayScheduler::GetForCurrentThread()->Schedule(base::BindOnce(
+          &NaiveSpliceRelay::Pump, weak_ptr_factory_.GetWeakPtr(), from));
+      return ERR_IO_PENDING;
+    }
+
+    ssize_t rv = HANDLE_EINTR(
+        splice(src, nullptr, pipe_write_ends_[from].get(), nullptr,
+               kSpliceSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+    if (rv < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return MapSystemError(errno);
+      if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+              src, /*persistent=*/false, base::MessagePumpForIO::WATCH_READ,
+              &read_watchers_[from], this)) {
+        return ERR_UNEXPECTED;
+      }
+      return ERR_IO_PENDING;
+    }
+    if (rv == 0) {
+      read_closed_[from] = true;
+      return ERR_CONNECTION_CLOSED;
+    }
+    pipe_bytes_[from] += rv;
+    bytes_passed_without_yielding += rv;
+  }
+}
+
+void NaiveSpliceRelay::Finish(int result) {
+  for (Direction d : {kClient, kServer}) {
+    read_watchers_[d].StopWatchingFileDescriptor();
+    write_watchers_[d].StopWatchingFileDescriptor();
+  }
+  weak_ptr_factory_.InvalidateWeakPtrs();
+  std::move(callback_).Run(result);
+}
+
+}  // namespace net
@@ -0,0 +1,73 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_SPLICE_RELAY_H_
+#define NET_TOOLS_NAIVE_NAIVE_SPLICE_RELAY_H_
+
+#include <cstdint>
+
+#include "base/files/scoped_file.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "net/base/completion_once_callback.h"
+#include "net/tools/naive/naive_protocol.h"
+
+namespace net {
+
+// Relays between two connected TCP sockets with splice(2) through a pipe per
+// direction, so payload never gets copied to userspace. Only usable when
+// neither side needs padding, TLS or HTTP/2 framing. Linux only.
+class NaiveSpliceRelay : public base::MessagePumpForIO::FdWatcher {
+ public:
+  // Does not take ownership of the socket descriptors. A direction yields
+  // after splicing `yield_bytes`. With `half_close`, an EOF is passed on by
+  // shutting down the writing side of the other socket, like
+  // NaiveRelayConfig::half_close, and the other direction keeps relaying.
+  NaiveSpliceRelay(int client_fd,
+                   int server_fd,
+                   int yield_bytes,
+                   bool half_close);
+  ~NaiveSpliceRelay() override;
+  NaiveSpliceRelay(const NaiveSpliceRelay&) = delete;
+  NaiveSpliceRelay& operator=(const NaiveSpliceRelay&) = delete;
+
+  // Returns ERR_IO_PENDING and runs `callback` when either direction fails,
+  // or with ERR_CONNECTION_CLOSED once both directions have written out all
+  // they read. Without half-closing, the first EOF stops the other direction
+  // from reading more, but not from writing what its pipe holds. Returns an
+  // error synchronously if the pipes cannot be created.
+  int Run(CompletionOnceCallback callback);
+
+  int64_t bytes_relayed(Direction from) const { return bytes_relayed_[from]; }
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+ private:
+  void Pump(Direction from);
+  int DoPump(Direction from);
+  void Finish(int result);
+
+  int fds_[kNumDirections];
+  const int yield_bytes_;
+  const bool half_close_;
+  base::ScopedFD pipe_read_ends_[kNumDirections];
+  base::ScopedFD pipe_write_ends_[kNumDirections];
+  int pipe_bytes_[kNumDirections] = {0, 0};
+  int64_t bytes_relayed_[kNumDirections] = {0, 0};
+  // Whether a direction reads no more, after its EOF or the other's.
+  bool read_closed_[kNumDirections] = {false, false};
+  // Whether a direction has also written out its pipe since.
+  bool done_[kNumDirections] = {false, false};
+
+  base::MessagePumpForIO::FdWatchController read_watchers_[kNumDirections];
+  base::MessagePumpForIO::FdWatchController write_watchers_[kNumDirections];
+
+  CompletionOnceCallback callback_;
+
+  base::WeakPtrFactory<NaiveSpliceRelay> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_SPLICE_RELAY_H_
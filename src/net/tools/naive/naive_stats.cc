@@ -0,0 +1,41 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_stats.h"
+
+#include <cmath>
+
+namespace net {
+
+void NaiveStatsHistogram::Snapshot::Merge(const Snapshot& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    counts[i] += other.counts[i];
+  }
+  count += other.count;
+  sum += other.sum;
+}
+
+uint64_t NaiveStatsHistogram::Snapshot::GetQuantile(double fraction) const {
+  if (count == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * count));
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    cumulative += counts[i];
+    if (cumulative >= rank && counts[i] > 0) {
+      return i < kNumBuckets - 1 ? GetBucketBound(i) - 1 : UINT64_MAX;
+    }
+  }
+  return UINT64_MAX;
+}
+
+void NaiveStatsHistogram::AddTo(Snapshot* snapshot) const {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    uint64_t n = buckets_[i].value();
+    snapshot->counts[i] += n;
+    snapshot->count += n;
+  }
+  snapshot->sum += sum_.value();
+}
+
+}  // namespace net
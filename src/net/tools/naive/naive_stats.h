@@ -0,0 +1,121 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_STATS_H_
+#define NET_TOOLS_NAIVE_NAIVE_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/no_destructor.h"
+#include "base/synchronization/lock.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+// A counter written by one thread alone and read by any. An update is a
+// relaxed load and store, not a read-modify-write, so it costs about as
+// much as a plain add.
+class NaiveStatsCounter {
+ public:
+  void Add(uint64_t n) {
+    value_.store(value_.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Counts of values in log-scale buckets: bucket 0 holds 0 and bucket `i`
+// holds values in [2^(i-1), 2^i). Written by one thread alone like
+// NaiveStatsCounter.
+class NaiveStatsHistogram {
+ public:
+  static constexpr size_t kNumBuckets = 65;
+
+  // A copy of the counts, which can be merged with those of other threads.
+  struct Snapshot {
+    void Merge(const Snapshot& other);
+    // Returns the largest value of the bucket holding the `fraction`
+    // quantile, or 0 if there are no values.
+    uint64_t GetQuantile(double fraction) const;
+
+    std::array<uint64_t, kNumBuckets> counts = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+  };
+
+  // Returns the bound the values of bucket `i` are less than, or 0 for the
+  // last, unbounded one.
+  static uint64_t GetBucketBound(size_t i) {
+    return i < kNumBuckets - 1 ? uint64_t{1} << i : 0;
+  }
+
+  void Add(uint64_t value) {
+    buckets_[std::bit_width(value)].Add(1);
+    sum_.Add(value);
+  }
+
+  // The count and sum may be off from the buckets by updates made while
+  // copying.
+  void AddTo(Snapshot* snapshot) const;
+
+ private:
+  std::array<NaiveStatsCounter, kNumBuckets> buckets_;
+  NaiveStatsCounter sum_;
+};
+
+// Per thread instances of `T`, a struct of the counters and histograms
+// above which provides
+//   struct Snapshot;
+//   void AddTo(Snapshot* snapshot) const;
+// Each thread updates its own instance without synchronizing, and
+// Aggregate() sums all of them from any thread without posting to them.
+// The instances are created on first use and outlive the threads updating
+// them, see GetOrCreateForCurrentThread().
+template <typename T>
+class NaiveShardedStats {
+ public:
+  using Snapshot = typename T::Snapshot;
+
+  static T* GetForCurrentThread() {
+    return GetOrCreateForCurrentThread<T>([] {
+      auto shard = std::make_unique<T>();
+      Shards& shards = GetShards();
+      base::AutoLock lock(shards.lock);
+      shards.list.push_back(shard.get());
+      return shard;
+    });
+  }
+
+  static Snapshot Aggregate() {
+    Snapshot snapshot;
+    Shards& shards = GetShards();
+    base::AutoLock lock(shards.lock);
+    for (const T* shard : shards.list) {
+      shard->AddTo(&snapshot);
+    }
+    return snapshot;
+  }
+
+ private:
+  struct Shards {
+    base::Lock lock;
+    std::vector<T*> list;
+  };
+
+  static Shards& GetShards() {
+    static base::NoDestructor<Shards> shards;
+    return *shards;
+  }
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_STATS_H_
@@ -0,0 +1,50 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_tcp_info.h"
+
+// Not <netinet/tcp.h>, whose tcp_info lacks the segment counters and the
+// delivery rate.
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "net/tools/naive/naive_stats.h"
+
+namespace net {
+
+bool AddTcpInfoSample(int fd, NaiveTcpInfoStats::Role role) {
+  if (fd < 0)
+    return false;
+  struct tcp_info info = {};
+  socklen_t len = sizeof(info);
+  if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+    return false;
+  // Nothing measured yet, e.g. before the handshake completes.
+  if (info.tcpi_rtt == 0)
+    return false;
+
+  NaiveTcpInfoStats* stats =
+      NaiveShardedStats<NaiveTcpInfoStats>::GetForCurrentThread();
+  stats->rtt_us[role].Add(info.tcpi_rtt);
+  stats->cwnd_segments[role].Add(info.tcpi_snd_cwnd);
+  // Older kernels fill fewer fields. The ratio is over the life of the
+  // connection so far.
+  if (len >= offsetof(struct tcp_info, tcpi_segs_out) +
+                 sizeof(info.tcpi_segs_out) &&
+      info.tcpi_segs_out > 0) {
+    stats->retransmit_permille[role].Add(uint64_t{info.tcpi_total_retrans} *
+                                         1000 / info.tcpi_segs_out);
+  }
+  if (len >= offsetof(struct tcp_info, tcpi_delivery_rate) +
+                 sizeof(info.tcpi_delivery_rate) &&
+      info.tcpi_delivery_rate > 0) {
+    stats->delivery_rate[role].Add(info.tcpi_delivery_rate);
+  }
+  return true;
+}
+
+}  // namespace net
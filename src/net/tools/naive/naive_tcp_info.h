@@ -0,0 +1,17 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TCP_INFO_H_
+#define NET_TOOLS_NAIVE_NAIVE_TCP_INFO_H_
+
+#include "net/tools/naive/naive_metrics.h"
+
+namespace net {
+
+// Reads the TCP_INFO of the TCP socket `fd` into the NaiveTcpInfoStats of
+// the calling thread under `role`. Returns false if it cannot be read, e.g.
+// for sockets other than TCP. Linux only.
+bool AddTcpInfoSample(int fd, NaiveTcpInfoStats::Role role);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TCP_INFO_H_
@@ -0,0 +1,39 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_THREAD_LOCAL_H_
+#define NET_TOOLS_NAIVE_NAIVE_THREAD_LOCAL_H_
+
+#include <memory>
+
+#include "base/functional/function_ref.h"
+
+namespace net {
+
+// Returns the instance of `T` of the calling thread, made by `create` on the
+// first call there. If `create` returns null, so does every later call on
+// the thread, without trying again.
+//
+// The instances are leaked. The IO threads live until the process exits,
+// and their connections and timers hold raw pointers to these instances
+// until then, so no order of destruction at thread exit would be safe.
+template <typename T>
+T* GetOrCreateForCurrentThread(
+    base::FunctionRef<std::unique_ptr<T>()> create) {
+  thread_local T* current = nullptr;
+  thread_local bool created = false;
+  if (!created) [[unlikely]] {
+    created = true;
+    current = create().release();
+  }
+  return current;
+}
+
+// Same as above for a `T` constructed without arguments.
+template <typename T>
+T* GetOrCreateForCurrentThread() {
+  return GetOrCreateForCurrentThread<T>([] { return std::make_unique<T>(); });
+}
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_THREAD_LOCAL_H_
@@ -0,0 +1,203 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/naive/naive_ticket_keys.h"
+
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "base/base64.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/strings/string_split.h"
+#include "crypto/hkdf.h"
+#include "third_party/boringssl/src/include/openssl/aead.h"
+#include "third_party/boringssl/src/include/openssl/cipher.h"
+#include "third_party/boringssl/src/include/openssl/digest.h"
+#include "third_party/boringssl/src/include/openssl/hmac.h"
+#include "third_party/boringssl/src/include/openssl/rand.h"
+
+namespace net {
+
+namespace {
+// The key name, the HMAC-SHA256 key and the AES-128-CBC key of TLS tickets,
+// as in SSL_CTX_set_tlsext_ticket_keys().
+constexpr size_t kNameSize = 16;
+constexpr size_t kKeySize = 48;
+constexpr size_t kHmacKeyOffset = 16;
+constexpr size_t kAesKeyOffset = 32;
+constexpr size_t kAesKeySize = 16;
+static_assert(kAesKeyOffset + kAesKeySize == kKeySize);
+// QUIC tickets are sealed with AES-256-GCM under a key derived from the
+// same bytes, after the key name and a random nonce.
+constexpr size_t kNonceSize = 12;
+constexpr size_t kTagSize = 16;
+constexpr size_t kSealedOffset = kNameSize + kNonceSize;
+constexpr std::string_view kQuicTicketInfo = "naive quic ticket";
+constexpr std::string_view kQuicTokenInfo = "naive quic token";
+constexpr size_t kQuicTokenSecretSize = 32;
+}  // namespace
+
+struct NaiveTicketKeys::Key {
+  uint8_t bytes[kKeySize];
+  bssl::ScopedEVP_AEAD_CTX quic_aead;
+};
+
+NaiveTicketKeys::NaiveTicketKeys(const base::FilePath& path) : path_(path) {}
+
+NaiveTicketKeys::~NaiveTicketKeys() = default;
+
+bool NaiveTicketKeys::Load() {
+  base::File::Info info;
+  if (!base::GetFileInfo(path_, &info)) {
+    LOG(ERROR) << "Failed to read ticket keys " << path_;
+    return false;
+  }
+  if (info.last_modified == last_modified_) {
+    return true;
+  }
+  std::string data;
+  if (!base::ReadFileToString(path_, &data)) {
+    LOG(ERROR) << "Failed to read ticket keys " << path_;
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Key>> keys;
+  for (std::string_view line : base::SplitStringPiece(
+           data, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::optional<std::vector<uint8_t>> bytes = base::Base64Decode(line);
+    if (!bytes || bytes->size() != kKeySize) {
+      LOG(ERROR) << "Invalid ticket key in " << path_;
+      return false;
+    }
+    auto key = std::make_unique<Key>();
+    std::memcpy(key->bytes, bytes->data(), kKeySize);
+    std::vector<uint8_t> quic_key = crypto::HkdfSha256(
+        *bytes, {}, base::as_byte_span(kQuicTicketInfo),
+        EVP_AEAD_key_length(EVP_aead_aes_256_gcm()));
+    if (!EVP_AEAD_CTX_init(key->quic_aead.get(), EVP_aead_aes_256_gcm(),
+                           quic_key.data(), quic_key.size(), kTagSize,
+                           nullptr)) {
+      return false;
+    }
+    keys.push_back(std::move(key));
+  }
+  if (keys.empty()) {
+    LOG(ERROR) << "No ticket keys in " << path_;
+    return false;
+  }
+
+  bool reloaded = !last_modified_.is_null();
+  last_modified_ = info.last_modified;
+  size_t count = keys.size();
+  {
+    base::AutoLock lock(lock_);
+    keys_ = std::move(keys);
+  }
+  if (reloaded) {
+    LOG(INFO) << "Loaded " << count << " ticket keys from " << path_;
+  }
+  return true;
+}
+
+std::string NaiveTicketKeys::GetSourceAddressTokenSecret() const {
+  base::AutoLock lock(lock_);
+  DCHECK(!keys_.empty());
+  return crypto::HkdfSha256(
+      std::string_view(reinterpret_cast<const char*>(keys_.front()->bytes),
+                       kKeySize),
+      {}, kQuicTokenInfo, kQuicTokenSecretSize);
+}
+
+const NaiveTicketKeys::Key* NaiveTicketKeys::FindKey(
+    const uint8_t* name) const {
+  for (const auto& key : keys_) {
+    if (std::memcmp(key->bytes, name, kNameSize) == 0) {
+      return key.get();
+    }
+  }
+  return nullptr;
+}
+
+int NaiveTicketKeys::HandleTicketKey(uint8_t* key_name,
+                                     uint8_t* iv,
+                                     EVP_CIPHER_CTX* cipher_ctx,
+                                     HMAC_CTX* hmac_ctx,
+                                     bool encrypt) {
+  base::AutoLock lock(lock_);
+  const Key* key;
+  if (encrypt) {
+    key = keys_.front().get();
+    std::memcpy(key_name, key->bytes, kNameSize);
+    RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc()));
+  } else {
+    key = FindKey(key_name);
+    // A full handshake issues a ticket under the first key.
+    if (!key) {
+      return 0;
+    }
+  }
+  if (!HMAC_Init_ex(hmac_ctx, key->bytes + kHmacKeyOffset,
+                    kAesKeyOffset - kHmacKeyOffset, EVP_sha256(), nullptr) ||
+      !EVP_CipherInit_ex(cipher_ctx, EVP_aes_128_cbc(), nullptr,
+                         key->bytes + kAesKeyOffset, iv, encrypt)) {
+    return -1;
+  }
+  // Tickets of a key past the first are renewed under the first.
+  return encrypt || key == keys_.front().get() ? 1 : 2;
+}
+
+size_t NaiveTicketKeys::MaxOverhead() {
+  return kSealedOffset + kTagSize;
+}
+
+std::vector<uint8_t> NaiveTicketKeys::Encrypt(
+    absl::string_view in,
+    absl::string_view encryption_key) {
+  // Set by no caller in Chromium.
+  DCHECK(encryption_key.empty());
+  base::AutoLock lock(lock_);
+  const Key* key = keys_.front().get();
+  std::vector<uint8_t> out(in.size() + MaxOverhead());
+  std::memcpy(out.data(), key->bytes, kNameSize);
+  RAND_bytes(out.data() + kNameSize, kNonceSize);
+  size_t out_len;
+  if (!EVP_AEAD_CTX_seal(key->quic_aead.get(), out.data() + kSealedOffset,
+                         &out_len, out.size() - kSealedOffset,
+                         out.data() + kNameSize, kNonceSize,
+                         reinterpret_cast<const uint8_t*>(in.data()),
+                         in.size(), nullptr, 0)) {
+    return std::vector<uint8_t>();
+  }
+  out.resize(kSealedOffset + out_len);
+  return out;
+}
+
+void NaiveTicketKeys::Decrypt(
+    absl::string_view in,
+    std::shared_ptr<quic::ProofSource::DecryptCallback> callback) {
+  std::vector<uint8_t> out;
+  if (in.size() >= kSealedOffset + kTagSize) {
+    const auto* input = reinterpret_cast<const uint8_t*>(in.data());
+    base::AutoLock lock(lock_);
+    if (const Key* key = FindKey(input)) {
+      out.resize(in.size() - kSealedOffset);
+      size_t out_len;
+      if (EVP_AEAD_CTX_open(key->quic_aead.get(), out.data(), &out_len,
+                            out.size(), input + kNameSize, kNonceSize,
+                            input + kSealedOffset, in.size() - kSealedOffset,
+                            nullptr, 0)) {
+        out.resize(out_len);
+      } else {
+        out.clear();
+      }
+    }
+  }
+  // Outside the lock, as the handshake goes on in the callback.
+  callback->Run(std::move(out));
+}
+
+}  // namespace net
@@ -0,0 +1,78 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_NAIVE_NAIVE_TICKET_KEYS_H_
+#define NET_TOOLS_NAIVE_NAIVE_TICKET_KEYS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/time/time.h"
+#include "net/ssl/ssl_server_config.h"
+#include "net/third_party/quiche/src/quiche/quic/core/crypto/proof_source.h"
+#include "third_party/abseil-cpp/absl/strings/string_view.h"
+
+namespace net {
+
+// Session ticket keys shared by servers behind DNS or anycast, so that a
+// client moved to another server resumes its TLS or QUIC session there.
+// Every server reads the same file, with a key a line, each 48 random bytes
+// in base64. The first key encrypts new tickets and all of them decrypt
+// tickets. Shared by the https:// and quic:// listeners of all threads.
+class NaiveTicketKeys : public SSLServerConfig::TicketKeySource,
+                        public quic::ProofSource::TicketCrypter {
+ public:
+  // How often the file is checked for rotated keys.
+  static constexpr base::TimeDelta kReloadInterval = base::Minutes(1);
+
+  explicit NaiveTicketKeys(const base::FilePath& path);
+  NaiveTicketKeys(const NaiveTicketKeys&) = delete;
+  NaiveTicketKeys& operator=(const NaiveTicketKeys&) = delete;
+
+  // Reads the file if it changed since the last load. The keys read before
+  // are kept if it is invalid.
+  bool Load();
+
+  // The secret of QUIC source address tokens, derived from the first key,
+  // so that the tokens of one server validate the client on all of them.
+  std::string GetSourceAddressTokenSecret() const;
+
+  // SSLServerConfig::TicketKeySource implementation.
+  int HandleTicketKey(uint8_t* key_name,
+                      uint8_t* iv,
+                      EVP_CIPHER_CTX* cipher_ctx,
+                      HMAC_CTX* hmac_ctx,
+                      bool encrypt) override;
+
+  // quic::ProofSource::TicketCrypter implementation.
+  size_t MaxOverhead() override;
+  std::vector<uint8_t> Encrypt(absl::string_view in,
+                               absl::string_view encryption_key) override;
+  void Decrypt(
+      absl::string_view in,
+      std::shared_ptr<quic::ProofSource::DecryptCallback> callback) override;
+
+ private:
+  struct Key;
+
+  ~NaiveTicketKeys() override;
+
+  const Key* FindKey(const uint8_t* name) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const base::FilePath path_;
+  base::Time last_modified_;
+
+  mutable base::Lock lock_;
+  std::vector<std::unique_ptr<Key>> keys_ GUARDED_BY(lock_);
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TICKET_KEYS_H_
@@ -0,0 +1,59 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_timer_wheel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+
+namespace net {
+
+NaiveTimerWheel::NaiveTimerWheel(base::TimeDelta tick,
+                                 size_t num_slots,
+                                 ExpireCallback expire_callback)
+    : tick_(tick),
+      expire_callback_(std::move(expire_callback)),
+      slots_(num_slots) {
+  DCHECK(tick_.is_positive());
+  DCHECK_GE(num_slots, 2u);
+}
+
+NaiveTimerWheel::~NaiveTimerWheel() = default;
+
+void NaiveTimerWheel::Schedule(unsigned int id, base::TimeDelta delay) {
+  // The slot being expired is never scheduled into, so an ID expires no
+  // sooner than the next tick.
+  double ticks = std::ceil(delay / tick_);
+  size_t offset = ticks < slots_.size()
+                      ? std::max(static_cast<size_t>(ticks), size_t{1})
+                      : slots_.size() - 1;
+  slots_[(current_slot_ + offset) % slots_.size()].push_back(id);
+  ++size_;
+  if (!timer_.IsRunning()) {
+    // Unretained is safe because the timer is owned by `this`.
+    timer_.Start(FROM_HERE, tick_,
+                 base::BindRepeating(&NaiveTimerWheel::OnTick,
+                                     base::Unretained(this)));
+  }
+}
+
+void NaiveTimerWheel::OnTick() {
+  current_slot_ = (current_slot_ + 1) % slots_.size();
+  expired_.swap(slots_[current_slot_]);
+  size_ -= expired_.size();
+  // The callback may schedule IDs again, into other slots.
+  for (unsigned int id : expired_) {
+    expire_callback_.Run(id);
+  }
+  expired_.clear();
+  if (size_ == 0) {
+    timer_.Stop();
+  }
+}
+
+}  // namespace net
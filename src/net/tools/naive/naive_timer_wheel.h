@@ -0,0 +1,55 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TIMER_WHEEL_H_
+#define NET_TOOLS_NAIVE_NAIVE_TIMER_WHEEL_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace net {
+
+// Coarse timeouts for many objects from one timer: a hashed wheel of slots
+// one tick apart, each holding the IDs expiring at it. Scheduling is an
+// append and expiry takes a slot at a time, so the cost does not grow with
+// the number of IDs. There is no cancellation. The callback is expected to
+// look the ID up and check whether it is still due, scheduling it again
+// otherwise, so IDs scheduled beyond span() simply expire early. The timer
+// only runs while IDs are scheduled.
+class NaiveTimerWheel {
+ public:
+  using ExpireCallback = base::RepeatingCallback<void(unsigned int id)>;
+
+  NaiveTimerWheel(base::TimeDelta tick,
+                  size_t num_slots,
+                  ExpireCallback expire_callback);
+  ~NaiveTimerWheel();
+  NaiveTimerWheel(const NaiveTimerWheel&) = delete;
+  NaiveTimerWheel& operator=(const NaiveTimerWheel&) = delete;
+
+  // Expires `id` after `delay`, rounded up to the next tick and cut to
+  // span(), give or take a tick.
+  void Schedule(unsigned int id, base::TimeDelta delay);
+
+  base::TimeDelta span() const { return tick_ * (slots_.size() - 1); }
+  size_t size() const { return size_; }
+
+ private:
+  void OnTick();
+
+  const base::TimeDelta tick_;
+  const ExpireCallback expire_callback_;
+  std::vector<std::vector<unsigned int>> slots_;
+  size_t current_slot_ = 0;
+  size_t size_ = 0;
+  // Keeps its capacity across ticks.
+  std::vector<unsigned int> expired_;
+  base::RepeatingTimer timer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TIMER_WHEEL_H_
@@ -0,0 +1,263 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_tproxy_udp_relay.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/net_errors.h"
+#include "net/base/sockaddr_storage.h"
+#include "net/http/http_network_session.h"
+#include "net/log/net_log_source_type.h"
+#include "net/tools/naive/naive_udp_flow.h"
+#include "net/tools/naive/redirect_resolver.h"
+
+namespace net {
+
+namespace {
+// Datagrams taken by one recvmmsg(2) call.
+constexpr int kRecvBatchSize = 16;
+// Batches read before yielding to other sockets.
+constexpr int kMaxRecvBatches = 4;
+// Larger than a datagram from an Ethernet client, and than any datagram a
+// CONNECT-UDP tunnel can carry.
+constexpr int kMaxDatagramSize = 2048;
+constexpr size_t kControlSize = CMSG_SPACE(sizeof(struct sockaddr_in6));
+// Bounds the tunnels open at a time.
+constexpr size_t kMaxFlows = 1024;
+
+IPEndPoint Unmapped(const IPEndPoint& endpoint) {
+  if (!endpoint.address().IsIPv4MappedIPv6())
+    return endpoint;
+  return IPEndPoint(ConvertIPv4MappedIPv6ToIPv4(endpoint.address()),
+                    endpoint.port());
+}
+
+int SetOption(int fd, int level, int name) {
+  int on = 1;
+  if (setsockopt(fd, level, name, &on, sizeof(on)) != 0)
+    return MapSystemError(errno);
+  return OK;
+}
+
+// Opens a UDP socket allowed to bind to foreign addresses.
+int OpenTransparentSocket(const IPEndPoint& address, base::ScopedFD* result) {
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+  base::ScopedFD fd(socket(storage.addr->sa_family,
+                           SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (!fd.is_valid())
+    return MapSystemError(errno);
+  int rv = SetOption(fd.get(), SOL_SOCKET, SO_REUSEADDR);
+  if (rv == OK)
+    rv = SetOption(fd.get(), SOL_IP, IP_TRANSPARENT);
+  if (rv == OK && address.GetFamily() == ADDRESS_FAMILY_IPV6)
+    rv = SetOption(fd.get(), SOL_IPV6, IPV6_TRANSPARENT);
+  if (rv != OK)
+    return rv;
+  if (bind(fd.get(), storage.addr, storage.addr_len) != 0)
+    return MapSystemError(errno);
+  *result = std::move(fd);
+  return OK;
+}
+
+bool GetOriginalDestination(const struct msghdr& msg, IPEndPoint* endpoint) {
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+    if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_ORIGDSTADDR) ||
+        (cmsg->cmsg_level == SOL_IPV6 &&
+         cmsg->cmsg_type == IPV6_ORIGDSTADDR)) {
+      return endpoint->FromSockAddr(
+          reinterpret_cast<const struct sockaddr*>(CMSG_DATA(cmsg)),
+          cmsg->cmsg_len - CMSG_LEN(0));
+    }
+  }
+  return false;
+}
+}  // namespace
+
+NaiveTproxyUdpRelay::Flow::Flow() = default;
+
+NaiveTproxyUdpRelay::Flow::~Flow() = default;
+
+NaiveTproxyUdpRelay::NaiveTproxyUdpRelay(
+    const ProxyChain& proxy_chain,
+    RedirectResolver* resolver,
+    HttpNetworkSession* session,
+    base::TimeDelta idle_timeout,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : proxy_chain_(proxy_chain),
+      resolver_(resolver),
+      session_(session),
+      network_anonymization_key_(NetworkAnonymizationKey::CreateTransient()),
+      idle_timeout_(idle_timeout),
+      net_log_(
+          NetLogWithSource::Make(session->net_log(), NetLogSourceType::NONE)),
+      read_watcher_(FROM_HERE),
+      traffic_annotation_(traffic_annotation) {}
+
+NaiveTproxyUdpRelay::~NaiveTproxyUdpRelay() = default;
+
+int NaiveTproxyUdpRelay::Listen(const IPEndPoint& address) {
+  base::ScopedFD fd;
+  int rv = OpenTransparentSocket(address, &fd);
+  if (rv != OK)
+    return rv;
+  rv = SetOption(fd.get(), SOL_IP, IP_RECVORIGDSTADDR);
+  if (rv == OK && address.GetFamily() == ADDRESS_FAMILY_IPV6)
+    rv = SetOption(fd.get(), SOL_IPV6, IPV6_RECVORIGDSTADDR);
+  if (rv != OK)
+    return rv;
+
+  socket_ = std::move(fd);
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          socket_.get(), /*persistent=*/true,
+          base::MessagePumpForIO::WATCH_READ, &read_watcher_, this)) {
+    socket_.reset();
+    return ERR_UNEXPECTED;
+  }
+  return OK;
+}
+
+void NaiveTproxyUdpRelay::OnFileCanReadWithoutBlocking(int fd) {
+  char buffers[kRecvBatchSize][kMaxDatagramSize];
+  alignas(struct cmsghdr) char controls[kRecvBatchSize][kControlSize];
+  struct sockaddr_storage addresses[kRecvBatchSize];
+  struct iovec iovs[kRecvBatchSize];
+  struct mmsghdr msgs[kRecvBatchSize];
+
+  for (int batch = 0; batch < kMaxRecvBatches; ++batch) {
+    for (int i = 0; i < kRecvBatchSize; ++i) {
+      iovs[i] = {.iov_base = buffers[i], .iov_len = kMaxDatagramSize};
+      msgs[i] = {};
+      msgs[i].msg_hdr.msg_name = &addresses[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_control = controls[i];
+      msgs[i].msg_hdr.msg_controllen = kControlSize;
+    }
+    int count = HANDLE_EINTR(
+        recvmmsg(fd, msgs, kRecvBatchSize, MSG_DONTWAIT, nullptr));
+    if (count < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        PLOG(WARNING) << "recvmmsg failed";
+      return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      const struct msghdr& msg = msgs[i].msg_hdr;
+      // Truncated datagrams could not be carried by the tunnel anyway.
+      if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+        continue;
+      IPEndPoint client;
+      IPEndPoint destination;
+      if (!client.FromSockAddr(reinterpret_cast<struct sockaddr*>(
+                                   msg.msg_name),
+                               msg.msg_namelen) ||
+          !GetOriginalDestination(msg, &destination)) {
+        continue;
+      }
+      HandleDatagram(Unmapped(client), Unmapped(destination),
+                     std::string_view(buffers[i], msgs[i].msg_len));
+    }
+    if (count < kRecvBatchSize)
+      return;
+  }
+}
+
+void NaiveTproxyUdpRelay::HandleDatagram(const IPEndPoint& client,
+                                         const IPEndPoint& destination,
+                                         std::string_view datagram) {
+  FlowKey key(client, destination);
+  auto it = flows_.find(key);
+  if (it != flows_.end()) {
+    it->second->udp_flow->Send(datagram);
+    return;
+  }
+  if (flows_.size() >= kMaxFlows) {
+    LOG(WARNING) << "Too many UDP flows, dropping datagram to "
+                 << destination.ToString();
+    return;
+  }
+
+  HostPortPair target;
+  const IPAddress& address = destination.address();
+  std::string name = resolver_->FindNameByAddress(address);
+  if (!name.empty()) {
+    target = HostPortPair(name, destination.port());
+  } else if (!resolver_->IsInResolvedRange(address)) {
+    target = HostPortPair::FromIPEndPoint(destination);
+  } else {
+    LOG(ERROR) << "UDP flow to unresolved name for " << address.ToString();
+    return;
+  }
+
+  auto flow = std::make_unique<Flow>();
+  int rv = OpenTransparentSocket(destination, &flow->reply_socket);
+  if (rv != OK) {
+    LOG(WARNING) << "Cannot reply from " << destination.ToString() << ": "
+                 << ErrorToShortString(rv);
+    return;
+  }
+  LOG(INFO) << "UDP flow from " << client.ToString() << " to "
+            << target.ToString();
+
+  flow->udp_flow = std::make_unique<NaiveUdpFlow>(
+      target, proxy_chain_, session_, network_anonymization_key_,
+      idle_timeout_, net_log_, traffic_annotation_);
+  NaiveUdpFlow* udp_flow = flow->udp_flow.get();
+  flows_.emplace(key, std::move(flow));
+  // Queued until the tunnel is established. Start() may close the flow
+  // synchronously, so it comes last.
+  udp_flow->Send(datagram);
+  udp_flow->Start(
+      base::BindRepeating(&NaiveTproxyUdpRelay::OnFlowDatagram,
+                          weak_ptr_factory_.GetWeakPtr(), key),
+      base::BindOnce(&NaiveTproxyUdpRelay::OnFlowClosed,
+                     weak_ptr_factory_.GetWeakPtr(), key));
+}
+
+void NaiveTproxyUdpRelay::OnFlowDatagram(const FlowKey& key,
+                                         std::string_view datagram) {
+  auto it = flows_.find(key);
+  if (it == flows_.end())
+    return;
+  SockaddrStorage client;
+  if (!key.first.ToSockAddr(client.addr, &client.addr_len))
+    return;
+  // Like a congested UDP path, drops datagrams the socket cannot take.
+  ssize_t rv = HANDLE_EINTR(sendto(it->second->reply_socket.get(),
+                                   datagram.data(), datagram.size(),
+                                   MSG_DONTWAIT, client.addr,
+                                   client.addr_len));
+  if (rv < 0)
+    DVPLOG(1) << "sendto failed";
+}
+
+void NaiveTproxyUdpRelay::OnFlowClosed(const FlowKey& key, int result) {
+  auto it = flows_.find(key);
+  if (it == flows_.end())
+    return;
+  std::unique_ptr<Flow> flow = std::move(it->second);
+  flows_.erase(it);
+  // The flow is still on the call stack.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(flow));
+}
+
+}  // namespace net
@@ -0,0 +1,91 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TPROXY_UDP_RELAY_H_
+#define NET_TOOLS_NAIVE_NAIVE_TPROXY_UDP_RELAY_H_
+
+#include <map>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "base/files/scoped_file.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/time/time.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/base/proxy_chain.h"
+#include "net/log/net_log_with_source.h"
+
+namespace net {
+
+class HttpNetworkSession;
+class NaiveUdpFlow;
+class RedirectResolver;
+struct NetworkTrafficAnnotationTag;
+
+// Relays UDP redirected by an iptables TPROXY rule, recovering the original
+// destination of each datagram with IP_RECVORIGDSTADDR, and carries each
+// flow of client and destination in its own NaiveUdpFlow. Replies are sent
+// from the original destination with a transparent socket per flow.
+// Destinations in the range of `resolver` are translated back to names like
+// redirected TCP connections. Linux only.
+class NaiveTproxyUdpRelay : public base::MessagePumpForIO::FdWatcher {
+ public:
+  NaiveTproxyUdpRelay(const ProxyChain& proxy_chain,
+                      RedirectResolver* resolver,
+                      HttpNetworkSession* session,
+                      base::TimeDelta idle_timeout,
+                      const NetworkTrafficAnnotationTag& traffic_annotation);
+  ~NaiveTproxyUdpRelay() override;
+  NaiveTproxyUdpRelay(const NaiveTproxyUdpRelay&) = delete;
+  NaiveTproxyUdpRelay& operator=(const NaiveTproxyUdpRelay&) = delete;
+
+  // Opens the transparent socket receiving redirected datagrams at
+  // `address`.
+  int Listen(const IPEndPoint& address);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override {}
+
+ private:
+  // Client and original destination.
+  using FlowKey = std::pair<IPEndPoint, IPEndPoint>;
+
+  struct Flow {
+    Flow();
+    ~Flow();
+
+    std::unique_ptr<NaiveUdpFlow> udp_flow;
+    // Bound to the original destination to send replies from it.
+    base::ScopedFD reply_socket;
+  };
+
+  void HandleDatagram(const IPEndPoint& client,
+                      const IPEndPoint& destination,
+                      std::string_view datagram);
+  void OnFlowDatagram(const FlowKey& key, std::string_view datagram);
+  void OnFlowClosed(const FlowKey& key, int result);
+
+  ProxyChain proxy_chain_;
+  RedirectResolver* resolver_;
+  HttpNetworkSession* session_;
+  NetworkAnonymizationKey network_anonymization_key_;
+  base::TimeDelta idle_timeout_;
+  NetLogWithSource net_log_;
+
+  base::ScopedFD socket_;
+  base::MessagePumpForIO::FdWatchController read_watcher_;
+
+  std::map<FlowKey, std::unique_ptr<Flow>> flows_;
+
+  // Traffic annotation for socket control.
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+
+  base::WeakPtrFactory<NaiveTproxyUdpRelay> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TPROXY_UDP_RELAY_H_
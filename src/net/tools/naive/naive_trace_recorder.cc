@@ -0,0 +1,81 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_trace_recorder.h"
+
+#include <cstdint>
+
+#include "base/logging.h"
+
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+#include "base/trace_event/base_tracing.h"
+#include "third_party/perfetto/include/perfetto/tracing/tracing.h"  // nogncheck
+#include "third_party/perfetto/protos/perfetto/config/track_event/track_event_config.gen.h"  // nogncheck
+#endif
+
+namespace net {
+
+namespace {
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+// Kept in memory until Stop(), about a minute of a busy relay.
+constexpr uint32_t kBufferSizeKb = 64 * 1024;
+#endif
+}  // namespace
+
+NaiveTraceRecorder::NaiveTraceRecorder(const base::FilePath& path)
+    : path_(path) {}
+
+NaiveTraceRecorder::~NaiveTraceRecorder() {
+  Stop();
+}
+
+bool NaiveTraceRecorder::Start() {
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+  file_.Initialize(path_, base::File::FLAG_CREATE_ALWAYS |
+                              base::File::FLAG_WRITE);
+  if (!file_.IsValid()) {
+    LOG(ERROR) << "Failed to open " << path_ << ": "
+               << base::File::ErrorToString(file_.error_details());
+    return false;
+  }
+
+  if (!perfetto::Tracing::IsInitialized()) {
+    perfetto::TracingInitArgs init_args;
+    init_args.backends = perfetto::BackendType::kInProcessBackend;
+    init_args.shmem_size_hint_kb = 4 * 1024;
+    perfetto::Tracing::Initialize(init_args);
+    base::TrackEvent::Register();
+  }
+
+  perfetto::protos::gen::TrackEventConfig track_event_config;
+  track_event_config.add_enabled_categories("net");
+  perfetto::TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(kBufferSizeKb);
+  auto* data_source = trace_config.add_data_sources()->mutable_config();
+  data_source->set_name("track_event");
+  data_source->set_track_event_config_raw(
+      track_event_config.SerializeAsString());
+
+  session_ = perfetto::Tracing::NewTrace(perfetto::BackendType::kInProcessBackend);
+  session_->Setup(trace_config, file_.GetPlatformFile());
+  session_->StartBlocking();
+  return true;
+#else
+  LOG(ERROR) << "Recording " << path_
+             << " requires a build with enable_base_tracing=true";
+  return false;
+#endif
+}
+
+void NaiveTraceRecorder::Stop() {
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+  if (!session_)
+    return;
+  base::TrackEvent::Flush();
+  session_->StopBlocking();
+  session_.reset();
+#endif
+  file_.Close();
+}
+
+}  // namespace net
@@ -0,0 +1,47 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TRACE_RECORDER_H_
+#define NET_TOOLS_NAIVE_NAIVE_TRACE_RECORDER_H_
+
+#include <memory>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/tracing_buildflags.h"
+
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+namespace perfetto {
+class TracingSession;
+}  // namespace perfetto
+#endif
+
+namespace net {
+
+// Records the trace events of the process, those of the "net" category
+// that mark the relay pipeline among them, with the in-process Perfetto
+// backend into a file that ui.perfetto.dev opens. Needs a build with
+// enable_base_tracing=true, Start() fails otherwise.
+class NaiveTraceRecorder {
+ public:
+  explicit NaiveTraceRecorder(const base::FilePath& path);
+  // Stops recording if not done yet.
+  ~NaiveTraceRecorder();
+  NaiveTraceRecorder(const NaiveTraceRecorder&) = delete;
+  NaiveTraceRecorder& operator=(const NaiveTraceRecorder&) = delete;
+
+  // Returns false with the reason logged if recording cannot start.
+  bool Start();
+  // Writes out what is buffered and closes the file.
+  void Stop();
+
+ private:
+  base::FilePath path_;
+  base::File file_;
+#if BUILDFLAG(ENABLE_BASE_TRACING)
+  std::unique_ptr<perfetto::TracingSession> session_;
+#endif
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TRACE_RECORDER_H_
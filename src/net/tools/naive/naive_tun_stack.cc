@@ -0,0 +1,675 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_tun_stack.h"
+
+#include <fcntl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "base/containers/contains.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_network_session.h"
+#include "net/log/net_log_source_type.h"
+#include "net/tools/naive/naive_udp_flow.h"
+#include "net/tools/naive/redirect_resolver.h"
+
+namespace net {
+
+namespace {
+// Packets read before yielding to other sockets. Pending ACKs are sent once
+// per batch, acknowledging the segments of a burst together.
+constexpr int kMaxReadsPerWakeup = 64;
+// Bounds the flows open at a time. Past it, new TCP connections are reset
+// and new UDP flows dropped.
+constexpr size_t kMaxTcpFlows = 4096;
+constexpr size_t kMaxUdpFlows = 1024;
+
+constexpr uint8_t kProtocolTcp = 6;
+constexpr uint8_t kProtocolUdp = 17;
+constexpr uint8_t kProtocolIcmpv6 = 58;
+constexpr size_t kIPv4HeaderSize = 20;
+constexpr size_t kIPv6HeaderSize = 40;
+constexpr size_t kTcpHeaderSize = 20;
+constexpr size_t kUdpHeaderSize = 8;
+// MSS and window scale, each padded to 4 bytes.
+constexpr size_t kSynOptionsSize = 8;
+
+uint16_t ReadUint16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+uint32_t ReadUint32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+         static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+void WriteUint16(uint8_t* p, uint16_t value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+
+void WriteUint32(uint8_t* p, uint32_t value) {
+  WriteUint16(p, value >> 16);
+  WriteUint16(p + 2, value & 0xffff);
+}
+
+// The one's complement sum of RFC 1071, unfolded.
+uint32_t AddChecksum(uint32_t sum, base::span<const uint8_t> data) {
+  size_t i = 0;
+  for (; i + 1 < data.size(); i += 2)
+    sum += ReadUint16(&data[i]);
+  if (i < data.size())
+    sum += static_cast<uint32_t>(data[i]) << 8;
+  return sum;
+}
+
+uint16_t FoldChecksum(uint32_t sum) {
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return static_cast<uint16_t>(~sum);
+}
+
+// Returns `checksum` over data where `from` was replaced by `to`, as in
+// RFC 1624.
+uint16_t UpdateChecksum(uint16_t checksum,
+                        base::span<const uint8_t> from,
+                        base::span<const uint8_t> to) {
+  uint32_t sum = static_cast<uint16_t>(~checksum);
+  for (size_t i = 0; i + 1 < from.size(); i += 2) {
+    sum += static_cast<uint16_t>(~ReadUint16(&from[i]));
+    sum += ReadUint16(&to[i]);
+  }
+  return FoldChecksum(sum);
+}
+
+// Replaces the source, or else the destination, of the IP `packet` by
+// `address` of the same family, updating the checksums covering it. Those
+// of fragments past the first and behind IPv6 extension headers are left,
+// like the stack drops such packets.
+void RewriteAddress(base::span<uint8_t> packet,
+                    bool source,
+                    const IPAddress& address) {
+  const bool is_ipv4 = address.IsIPv4();
+  const size_t offset = is_ipv4 ? (source ? 12 : 16) : (source ? 8 : 24);
+  const size_t header_size =
+      is_ipv4 ? (packet[0] & 0x0f) * 4 : kIPv6HeaderSize;
+  const uint8_t protocol = is_ipv4 ? packet[9] : packet[6];
+  base::span<uint8_t> field = packet.subspan(offset, address.size());
+  base::span<const uint8_t> to(address.bytes().data(), address.size());
+
+  size_t checksum_offset = 0;
+  if (protocol == kProtocolTcp) {
+    checksum_offset = 16;
+  } else if (protocol == kProtocolUdp) {
+    checksum_offset = 6;
+  } else if (protocol == kProtocolIcmpv6 && !is_ipv4) {
+    checksum_offset = 2;
+  }
+  if (is_ipv4 && (ReadUint16(&packet[6]) & 0x1fff)) {
+    checksum_offset = 0;
+  }
+  if (checksum_offset > 0 &&
+      header_size + checksum_offset + 2 <= packet.size()) {
+    uint8_t* checksum = &packet[header_size + checksum_offset];
+    // Zero is no checksum to UDP over IPv4.
+    if (protocol != kProtocolUdp || !is_ipv4 || ReadUint16(checksum) != 0) {
+      uint16_t updated = UpdateChecksum(ReadUint16(checksum), field, to);
+      if (updated == 0 && protocol == kProtocolUdp)
+        updated = 0xffff;
+      WriteUint16(checksum, updated);
+    }
+  }
+  if (is_ipv4) {
+    WriteUint16(&packet[10],
+                UpdateChecksum(ReadUint16(&packet[10]), field, to));
+  }
+  std::copy(to.begin(), to.end(), field.begin());
+}
+
+// Parses the SYN options MSS and window scale.
+void ParseTcpOptions(base::span<const uint8_t> options,
+                     NaiveTunTcpFlow::Segment* segment) {
+  size_t i = 0;
+  while (i < options.size()) {
+    uint8_t kind = options[i];
+    if (kind == 0)
+      break;
+    if (kind == 1) {
+      ++i;
+      continue;
+    }
+    if (i + 1 >= options.size())
+      break;
+    uint8_t length = options[i + 1];
+    if (length < 2 || i + length > options.size())
+      break;
+    if (kind == 2 && length == 4) {
+      segment->mss = ReadUint16(&options[i + 2]);
+    } else if (kind == 3 && length == 3) {
+      segment->window_scale = options[i + 2];
+    }
+    i += length;
+  }
+}
+}  // namespace
+
+NaiveTunStack::NaiveTunStack(
+    int mtu,
+    RedirectResolver* resolver,
+    const ProxyChain& proxy_chain,
+    bool connect_ip,
+    HttpNetworkSession* session,
+    base::TimeDelta udp_idle_timeout,
+    const NetworkTrafficAnnotationTag& traffic_annotation,
+    FlowCallback flow_callback)
+    : mtu_(mtu),
+      resolver_(resolver),
+      proxy_chain_(proxy_chain),
+      // UDP is relayed with CONNECT-UDP, which needs a QUIC proxy.
+      udp_enabled_(proxy_chain.is_single_proxy() &&
+                   proxy_chain.First().is_quic()),
+      session_(session),
+      network_anonymization_key_(NetworkAnonymizationKey::CreateTransient()),
+      udp_idle_timeout_(udp_idle_timeout),
+      net_log_(
+          NetLogWithSource::Make(session->net_log(), NetLogSourceType::NONE)),
+      flow_callback_(std::move(flow_callback)),
+      read_watcher_(FROM_HERE),
+      read_buffer_(mtu),
+      write_buffer_(mtu),
+      connect_ip_(connect_ip && udp_enabled_),
+      traffic_annotation_(traffic_annotation) {}
+
+NaiveTunStack::~NaiveTunStack() = default;
+
+int NaiveTunStack::Open(const std::string& name) {
+  base::ScopedFD fd(HANDLE_EINTR(open("/dev/net/tun", O_RDWR | O_CLOEXEC)));
+  if (!fd.is_valid())
+    return MapSystemError(errno);
+  struct ifreq ifr = {};
+  ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+  if (name.size() >= sizeof(ifr.ifr_name))
+    return ERR_INVALID_ARGUMENT;
+  memcpy(ifr.ifr_name, name.data(), name.size());
+  if (ioctl(fd.get(), TUNSETIFF, &ifr) != 0)
+    return MapSystemError(errno);
+  return Adopt(std::move(fd));
+}
+
+int NaiveTunStack::Adopt(base::ScopedFD fd) {
+  int flags = fcntl(fd.get(), F_GETFL);
+  if (flags < 0 || fcntl(fd.get(), F_SETFL, flags | O_NONBLOCK) != 0)
+    return MapSystemError(errno);
+  fd_ = std::move(fd);
+  return Watch();
+}
+
+int NaiveTunStack::Watch() {
+  if (!base::CurrentIOThread::Get()->WatchFileDescriptor(
+          fd_.get(), /*persistent=*/true, base::MessagePumpForIO::WATCH_READ,
+          &read_watcher_, this)) {
+    fd_.reset();
+    return ERR_UNEXPECTED;
+  }
+  return OK;
+}
+
+void NaiveTunStack::OnFileCanReadWithoutBlocking(int fd) {
+  reading_ = true;
+  for (int i = 0; i < kMaxReadsPerWakeup; ++i) {
+    ssize_t rv =
+        HANDLE_EINTR(read(fd, read_buffer_.data(), read_buffer_.size()));
+    if (rv < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        PLOG(WARNING) << "read failed";
+      break;
+    }
+    HandlePacket(base::span(read_buffer_).first(static_cast<size_t>(rv)));
+  }
+  reading_ = false;
+
+  std::vector<base::WeakPtr<NaiveTunTcpFlow>> pending_acks;
+  pending_acks.swap(pending_acks_);
+  for (const auto& flow : pending_acks) {
+    if (flow)
+      flow->FlushAck();
+  }
+}
+
+void NaiveTunStack::HandlePacket(base::span<const uint8_t> packet) {
+  if (packet.empty())
+    return;
+  IPAddress source;
+  IPAddress destination;
+  uint8_t protocol;
+  base::span<const uint8_t> payload;
+  uint8_t version = packet[0] >> 4;
+  if (version == 4) {
+    if (packet.size() < kIPv4HeaderSize)
+      return;
+    size_t header_size = (packet[0] & 0x0f) * 4;
+    size_t total_size = ReadUint16(&packet[2]);
+    if (header_size < kIPv4HeaderSize || total_size < header_size ||
+        total_size > packet.size()) {
+      return;
+    }
+    // More fragments, or a fragment offset.
+    if (ReadUint16(&packet[6]) & 0x3fff)
+      return;
+    protocol = packet[9];
+    source = IPAddress(packet.subspan(12, 4));
+    destination = IPAddress(packet.subspan(16, 4));
+    payload = packet.subspan(header_size, total_size - header_size);
+  } else if (version == 6) {
+    if (packet.size() < kIPv6HeaderSize)
+      return;
+    size_t payload_size = ReadUint16(&packet[4]);
+    if (kIPv6HeaderSize + payload_size > packet.size())
+      return;
+    protocol = packet[6];
+    source = IPAddress(packet.subspan(8, 16));
+    destination = IPAddress(packet.subspan(24, 16));
+    payload = packet.subspan(kIPv6HeaderSize, payload_size);
+  } else {
+    return;
+  }
+
+  if (connect_ip_ && !IsResolvedAddress(destination)) {
+    size_t packet_size = version == 4 ? ReadUint16(&packet[2])
+                                      : kIPv6HeaderSize + payload.size();
+    SendToIpTunnel(packet.first(packet_size), source);
+    return;
+  }
+
+  if (protocol == kProtocolTcp) {
+    if (payload.size() < kTcpHeaderSize)
+      return;
+    HandleTcp(IPEndPoint(source, ReadUint16(&payload[0])),
+              IPEndPoint(destination, ReadUint16(&payload[2])), payload);
+  } else if (protocol == kProtocolUdp) {
+    if (payload.size() < kUdpHeaderSize)
+      return;
+    size_t udp_size = ReadUint16(&payload[4]);
+    if (udp_size < kUdpHeaderSize || udp_size > payload.size())
+      return;
+    HandleUdp(IPEndPoint(source, ReadUint16(&payload[0])),
+              IPEndPoint(destination, ReadUint16(&payload[2])),
+              payload.subspan(kUdpHeaderSize, udp_size - kUdpHeaderSize));
+  }
+}
+
+void NaiveTunStack::HandleTcp(const IPEndPoint& client,
+                              const IPEndPoint& destination,
+                              base::span<const uint8_t> packet) {
+  size_t header_size = (packet[12] >> 4) * 4;
+  if (header_size < kTcpHeaderSize || header_size > packet.size())
+    return;
+  NaiveTunTcpFlow::Segment segment;
+  segment.seq = ReadUint32(&packet[4]);
+  segment.ack = ReadUint32(&packet[8]);
+  segment.flags = packet[13] & 0x1f;
+  segment.window = ReadUint16(&packet[14]);
+  segment.payload = packet.subspan(header_size);
+
+  FlowKey key(client, destination);
+  auto it = tcp_flows_.find(key);
+  if (it != tcp_flows_.end()) {
+    it->second->HandleSegment(segment);
+    return;
+  }
+  if (segment.flags & NaiveTunTcpFlow::kRst)
+    return;
+
+  // Anything but a new connection is refused, like by a closed port.
+  NaiveTunTcpFlow::Segment reset;
+  reset.flags = NaiveTunTcpFlow::kRst;
+  if (segment.flags & NaiveTunTcpFlow::kAck) {
+    reset.seq = segment.ack;
+  } else {
+    reset.flags |= NaiveTunTcpFlow::kAck;
+    reset.ack = segment.seq + segment.payload.size() +
+                (segment.flags & NaiveTunTcpFlow::kSyn ? 1 : 0);
+  }
+  if (!(segment.flags & NaiveTunTcpFlow::kSyn) ||
+      (segment.flags & NaiveTunTcpFlow::kAck)) {
+    WriteSegment(destination, client, reset);
+    return;
+  }
+  HostPortPair origin;
+  if (tcp_flows_.size() >= kMaxTcpFlows) {
+    LOG(WARNING) << "Too many TCP flows, resetting connection to "
+                 << destination.ToString();
+    WriteSegment(destination, client, reset);
+    return;
+  }
+  if (!GetOrigin(destination, &origin)) {
+    LOG(ERROR) << "TCP flow to unresolved name for "
+               << destination.address().ToString();
+    WriteSegment(destination, client, reset);
+    return;
+  }
+
+  ParseTcpOptions(packet.subspan(kTcpHeaderSize, header_size - kTcpHeaderSize),
+                  &segment);
+  size_t ip_header_size = destination.GetFamily() == ADDRESS_FAMILY_IPV4
+                              ? kIPv4HeaderSize
+                              : kIPv6HeaderSize;
+  auto flow = std::make_unique<NaiveTunTcpFlow>(
+      this, client, destination,
+      static_cast<int>(mtu_ - ip_header_size - kTcpHeaderSize));
+  NaiveTunTcpFlow* flow_ptr = flow.get();
+  tcp_flows_.emplace(key, std::move(flow));
+  flow_ptr->Accept(segment);
+}
+
+void NaiveTunStack::HandleUdp(const IPEndPoint& client,
+                              const IPEndPoint& destination,
+                              base::span<const uint8_t> datagram) {
+  std::string_view data(reinterpret_cast<const char*>(datagram.data()),
+                        datagram.size());
+  FlowKey key(client, destination);
+  auto it = udp_flows_.find(key);
+  if (it != udp_flows_.end()) {
+    it->second->Send(data);
+    return;
+  }
+  if (!udp_enabled_) {
+    DVLOG(1) << "UDP to " << destination.ToString()
+             << " dropped without a quic proxy";
+    return;
+  }
+  if (udp_flows_.size() >= kMaxUdpFlows) {
+    LOG(WARNING) << "Too many UDP flows, dropping datagram to "
+                 << destination.ToString();
+    return;
+  }
+  HostPortPair target;
+  if (!GetOrigin(destination, &target)) {
+    LOG(ERROR) << "UDP flow to unresolved name for "
+               << destination.address().ToString();
+    return;
+  }
+  LOG(INFO) << "UDP flow from " << client.ToString() << " to "
+            << target.ToString();
+
+  auto udp_flow = std::make_unique<NaiveUdpFlow>(
+      target, proxy_chain_, session_, network_anonymization_key_,
+      udp_idle_timeout_, net_log_, traffic_annotation_);
+  NaiveUdpFlow* udp_flow_ptr = udp_flow.get();
+  udp_flows_.emplace(key, std::move(udp_flow));
+  // Queued until the tunnel is established. Start() may close the flow
+  // synchronously, so it comes last.
+  udp_flow_ptr->Send(data);
+  udp_flow_ptr->Start(
+      base::BindRepeating(&NaiveTunStack::OnUdpFlowDatagram,
+                          weak_ptr_factory_.GetWeakPtr(), key),
+      base::BindOnce(&NaiveTunStack::OnUdpFlowClosed,
+                     weak_ptr_factory_.GetWeakPtr(), key));
+}
+
+bool NaiveTunStack::GetOrigin(const IPEndPoint& destination,
+                              HostPortPair* origin) const {
+  const IPAddress& address = destination.address();
+  if (resolver_) {
+    std::string name = resolver_->FindNameByAddress(address);
+    if (!name.empty()) {
+      *origin = HostPortPair(name, destination.port());
+      return true;
+    }
+    if (resolver_->IsInResolvedRange(address))
+      return false;
+  }
+  *origin = HostPortPair::FromIPEndPoint(destination);
+  return true;
+}
+
+void NaiveTunStack::OnUdpFlowDatagram(const FlowKey& key,
+                                      std::string_view datagram) {
+  if (udp_flows_.find(key) == udp_flows_.end())
+    return;
+  const auto& [client, destination] = key;
+  size_t ip_header_size = destination.GetFamily() == ADDRESS_FAMILY_IPV4
+                              ? kIPv4HeaderSize
+                              : kIPv6HeaderSize;
+  if (ip_header_size + kUdpHeaderSize + datagram.size() >
+      static_cast<size_t>(mtu_)) {
+    DVLOG(1) << "UDP datagram larger than the device MTU dropped";
+    return;
+  }
+  uint8_t header[kUdpHeaderSize] = {};
+  WriteUint16(&header[0], destination.port());
+  WriteUint16(&header[2], client.port());
+  WriteUint16(&header[4], kUdpHeaderSize + datagram.size());
+  WritePacket(destination, client, kProtocolUdp, header, /*checksum_offset=*/6,
+              base::as_bytes(base::span(datagram)));
+}
+
+void NaiveTunStack::OnUdpFlowClosed(const FlowKey& key, int result) {
+  auto it = udp_flows_.find(key);
+  if (it == udp_flows_.end())
+    return;
+  std::unique_ptr<NaiveUdpFlow> flow = std::move(it->second);
+  udp_flows_.erase(it);
+  // The flow is still on the call stack.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(flow));
+}
+
+bool NaiveTunStack::IsResolvedAddress(const IPAddress& destination) const {
+  return resolver_ && resolver_->IsInResolvedRange(destination);
+}
+
+void NaiveTunStack::SendToIpTunnel(base::span<const uint8_t> packet,
+                                   const IPAddress& source) {
+  if (!ip_tunnel_) {
+    LOG(INFO) << "Opening CONNECT-IP tunnel";
+    ip_tunnel_ = std::make_unique<NaiveUdpFlow>(
+        HostPortPair("*", 0), proxy_chain_, session_,
+        network_anonymization_key_, udp_idle_timeout_, net_log_,
+        traffic_annotation_);
+    ip_tunnel_->set_connect_ip();
+    // Start() may close the tunnel synchronously, so the packet waits for
+    // the next one.
+    ip_tunnel_->Start(base::BindRepeating(&NaiveTunStack::OnIpTunnelPacket,
+                                          weak_ptr_factory_.GetWeakPtr()),
+                      base::BindOnce(&NaiveTunStack::OnIpTunnelClosed,
+                                     weak_ptr_factory_.GetWeakPtr()));
+    if (!ip_tunnel_)
+      return;
+  }
+
+  std::string data(reinterpret_cast<const char*>(packet.data()),
+                   packet.size());
+  for (const IPAddress& assigned : ip_tunnel_->GetAssignedAddresses()) {
+    if (assigned.size() != source.size() || assigned == source)
+      continue;
+    device_addresses_[source.IsIPv4() ? 0 : 1] = source;
+    RewriteAddress(base::as_writable_bytes(base::span(data)),
+                   /*source=*/true, assigned);
+    break;
+  }
+  ip_tunnel_->Send(data);
+}
+
+void NaiveTunStack::OnIpTunnelPacket(std::string_view packet) {
+  if (packet.empty() || packet.size() > static_cast<size_t>(mtu_)) {
+    DVLOG(1) << "CONNECT-IP packet larger than the device MTU dropped";
+    return;
+  }
+  uint8_t version = static_cast<uint8_t>(packet[0]) >> 4;
+  size_t header_size = version == 4 ? kIPv4HeaderSize : kIPv6HeaderSize;
+  if ((version != 4 && version != 6) || packet.size() < header_size)
+    return;
+  memcpy(write_buffer_.data(), packet.data(), packet.size());
+  base::span<uint8_t> buffer =
+      base::span(write_buffer_).first(packet.size());
+  const IPAddress& device_address = device_addresses_[version == 4 ? 0 : 1];
+  if (device_address.IsValid()) {
+    IPAddress destination = version == 4 ? IPAddress(buffer.subspan(16, 4))
+                                         : IPAddress(buffer.subspan(24, 16));
+    if (base::Contains(ip_tunnel_->GetAssignedAddresses(), destination)) {
+      RewriteAddress(buffer, /*source=*/false, device_address);
+    }
+  }
+  ssize_t rv = HANDLE_EINTR(write(fd_.get(), buffer.data(), buffer.size()));
+  if (rv < 0)
+    DVPLOG(1) << "write failed";
+}
+
+void NaiveTunStack::OnIpTunnelClosed(int result) {
+  LOG(INFO) << "CONNECT-IP tunnel closed: " << ErrorToShortString(result);
+  // The tunnel is still on the call stack. The next packet opens another.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(ip_tunnel_));
+}
+
+void NaiveTunStack::SendSegment(const NaiveTunTcpFlow& flow,
+                                const NaiveTunTcpFlow::Segment& segment) {
+  WriteSegment(flow.destination(), flow.client(), segment);
+}
+
+void NaiveTunStack::ScheduleAck(NaiveTunTcpFlow* flow) {
+  if (!reading_) {
+    flow->FlushAck();
+    return;
+  }
+  pending_acks_.push_back(flow->GetWeakPtr());
+}
+
+void NaiveTunStack::OnFlowEstablished(NaiveTunTcpFlow* flow) {
+  HostPortPair origin;
+  if (!GetOrigin(flow->destination(), &origin)) {
+    // The name expired since the SYN.
+    flow->Close(/*reset=*/true);
+    return;
+  }
+  flow_callback_.Run(
+      std::make_unique<NaiveTunTcpSocket>(flow->GetWeakPtr(), net_log_),
+      origin);
+}
+
+void NaiveTunStack::OnFlowClosed(NaiveTunTcpFlow* flow) {
+  auto it = tcp_flows_.find(FlowKey(flow->client(), flow->destination()));
+  if (it == tcp_flows_.end())
+    return;
+  std::unique_ptr<NaiveTunTcpFlow> owned_flow = std::move(it->second);
+  tcp_flows_.erase(it);
+  // The flow is still on the call stack.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(owned_flow));
+}
+
+void NaiveTunStack::WritePacket(const IPEndPoint& source,
+                                const IPEndPoint& target,
+                                uint8_t protocol,
+                                base::span<uint8_t> header,
+                                size_t checksum_offset,
+                                base::span<const uint8_t> payload) {
+  bool is_ipv4 = source.GetFamily() == ADDRESS_FAMILY_IPV4;
+  size_t ip_header_size = is_ipv4 ? kIPv4HeaderSize : kIPv6HeaderSize;
+  size_t transport_size = header.size() + payload.size();
+  size_t packet_size = ip_header_size + transport_size;
+  DCHECK_LE(packet_size, write_buffer_.size());
+  uint8_t* packet = write_buffer_.data();
+  const IPAddressBytes& source_bytes = source.address().bytes();
+  const IPAddressBytes& target_bytes = target.address().bytes();
+
+  if (is_ipv4) {
+    packet[0] = 0x45;
+    packet[1] = 0;
+    WriteUint16(&packet[2], packet_size);
+    // Identification, then don't fragment.
+    WriteUint16(&packet[4], 0);
+    WriteUint16(&packet[6], 0x4000);
+    packet[8] = 64;
+    packet[9] = protocol;
+    WriteUint16(&packet[10], 0);
+    memcpy(&packet[12], source_bytes.data(), 4);
+    memcpy(&packet[16], target_bytes.data(), 4);
+    WriteUint16(&packet[10], FoldChecksum(AddChecksum(
+                                 0, base::span(packet, kIPv4HeaderSize))));
+  } else {
+    WriteUint32(&packet[0], 0x60000000);
+    WriteUint16(&packet[4], transport_size);
+    packet[6] = protocol;
+    packet[7] = 64;
+    memcpy(&packet[8], source_bytes.data(), 16);
+    memcpy(&packet[24], target_bytes.data(), 16);
+  }
+
+  // The pseudo-header of RFC 793 and RFC 8200.
+  uint32_t sum =
+      AddChecksum(0, base::span(source_bytes.data(), source_bytes.size()));
+  sum = AddChecksum(sum, base::span(target_bytes.data(), target_bytes.size()));
+  sum += protocol;
+  sum += static_cast<uint32_t>(transport_size);
+  WriteUint16(&header[checksum_offset], 0);
+  sum = AddChecksum(sum, header);
+  // The header is of even size, so the payload sums on from it.
+  sum = AddChecksum(sum, payload);
+  uint16_t checksum = FoldChecksum(sum);
+  // Zero is no checksum to UDP.
+  if (checksum == 0 && protocol == kProtocolUdp)
+    checksum = 0xffff;
+  WriteUint16(&header[checksum_offset], checksum);
+
+  memcpy(packet + ip_header_size, header.data(), header.size());
+  if (!payload.empty()) {
+    memcpy(packet + ip_header_size + header.size(), payload.data(),
+           payload.size());
+  }
+  ssize_t rv = HANDLE_EINTR(write(fd_.get(), packet, packet_size));
+  if (rv < 0)
+    DVPLOG(1) << "write failed";
+}
+
+void NaiveTunStack::WriteSegment(const IPEndPoint& source,
+                                 const IPEndPoint& target,
+                                 const NaiveTunTcpFlow::Segment& segment) {
+  uint8_t header[kTcpHeaderSize + kSynOptionsSize] = {};
+  size_t header_size = kTcpHeaderSize;
+  if (segment.flags & NaiveTunTcpFlow::kSyn) {
+    uint8_t* options = &header[kTcpHeaderSize];
+    options[0] = 2;
+    options[1] = 4;
+    WriteUint16(&options[2], segment.mss);
+    if (segment.window_scale >= 0) {
+      options[4] = 1;
+      options[5] = 3;
+      options[6] = 3;
+      options[7] = segment.window_scale;
+      header_size += 8;
+    } else {
+      header_size += 4;
+    }
+  }
+  WriteUint16(&header[0], source.port());
+  WriteUint16(&header[2], target.port());
+  WriteUint32(&header[4], segment.seq);
+  WriteUint32(&header[8], segment.ack);
+  header[12] = (header_size / 4) << 4;
+  header[13] = segment.flags;
+  WriteUint16(&header[14], segment.window);
+  WritePacket(source, target, kProtocolTcp,
+              base::span(header).first(header_size), /*checksum_offset=*/16,
+              segment.payload);
+}
+
+}  // namespace net
@@ -0,0 +1,160 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TUN_STACK_H_
+#define NET_TOOLS_NAIVE_NAIVE_TUN_STACK_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/files/scoped_file.h"
+#include "base/functional/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/time/time.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/base/proxy_chain.h"
+#include "net/log/net_log_with_source.h"
+#include "net/tools/naive/naive_tun_tcp_flow.h"
+
+namespace net {
+
+class HostPortPair;
+class HttpNetworkSession;
+class NaiveUdpFlow;
+class RedirectResolver;
+struct NetworkTrafficAnnotationTag;
+
+// Terminates the TCP connections and UDP flows of IP packets read from a TUN
+// device, so that a device routed to it needs no iptables rules. Each TCP
+// connection is handed to `flow_callback` once established, as a
+// NaiveTunTcpSocket to the destination of its packets. UDP flows are carried
+// by NaiveUdpFlow, which needs `proxy_chain` to be a single QUIC proxy, and
+// are dropped otherwise. Destinations in the range of `resolver` are
+// translated back to names like redirected connections. Fragments and IPv6
+// extension headers are dropped.
+//
+// With `connect_ip`, the packets to other destinations are instead carried
+// as they are in a single CONNECT-IP tunnel through the QUIC proxy, with no
+// tunnel request per flow, and those of the proxy written back to the
+// device. Their source is translated to the address the proxy assigned, if
+// any, and back. Linux only.
+class NaiveTunStack : public base::MessagePumpForIO::FdWatcher,
+                      public NaiveTunTcpFlow::Delegate {
+ public:
+  using FlowCallback =
+      base::RepeatingCallback<void(std::unique_ptr<NaiveTunTcpSocket>,
+                                   const HostPortPair&)>;
+
+  // `resolver` may be null.
+  NaiveTunStack(int mtu,
+                RedirectResolver* resolver,
+                const ProxyChain& proxy_chain,
+                bool connect_ip,
+                HttpNetworkSession* session,
+                base::TimeDelta udp_idle_timeout,
+                const NetworkTrafficAnnotationTag& traffic_annotation,
+                FlowCallback flow_callback);
+  ~NaiveTunStack() override;
+  NaiveTunStack(const NaiveTunStack&) = delete;
+  NaiveTunStack& operator=(const NaiveTunStack&) = delete;
+
+  // Opens the TUN device `name`, or takes `fd` already open on one.
+  int Open(const std::string& name);
+  int Adopt(base::ScopedFD fd);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override {}
+
+  // NaiveTunTcpFlow::Delegate implementation.
+  void SendSegment(const NaiveTunTcpFlow& flow,
+                   const NaiveTunTcpFlow::Segment& segment) override;
+  void ScheduleAck(NaiveTunTcpFlow* flow) override;
+  void OnFlowEstablished(NaiveTunTcpFlow* flow) override;
+  void OnFlowClosed(NaiveTunTcpFlow* flow) override;
+
+ private:
+  // Client and destination.
+  using FlowKey = std::pair<IPEndPoint, IPEndPoint>;
+
+  int Watch();
+  void HandlePacket(base::span<const uint8_t> packet);
+  void HandleTcp(const IPEndPoint& client,
+                 const IPEndPoint& destination,
+                 base::span<const uint8_t> packet);
+  void HandleUdp(const IPEndPoint& client,
+                 const IPEndPoint& destination,
+                 base::span<const uint8_t> datagram);
+  // Returns false if `destination` is a fake address of an unknown name.
+  bool GetOrigin(const IPEndPoint& destination, HostPortPair* origin) const;
+
+  void OnUdpFlowDatagram(const FlowKey& key, std::string_view datagram);
+  void OnUdpFlowClosed(const FlowKey& key, int result);
+
+  // Whether `destination` bypasses the CONNECT-IP tunnel, being a fake
+  // address of a name the proxy has to resolve.
+  bool IsResolvedAddress(const IPAddress& destination) const;
+  // Sends `packet` from `source` into the CONNECT-IP tunnel, opening it if
+  // needed.
+  void SendToIpTunnel(base::span<const uint8_t> packet,
+                      const IPAddress& source);
+  void OnIpTunnelPacket(std::string_view packet);
+  void OnIpTunnelClosed(int result);
+  // Writes a packet from `source` to `target` carrying `payload` after a
+  // transport `header` of `protocol`, whose checksum is at
+  // `checksum_offset`. Drops the packet if the device cannot take it, like
+  // a congested link.
+  void WritePacket(const IPEndPoint& source,
+                   const IPEndPoint& target,
+                   uint8_t protocol,
+                   base::span<uint8_t> header,
+                   size_t checksum_offset,
+                   base::span<const uint8_t> payload);
+  void WriteSegment(const IPEndPoint& source,
+                    const IPEndPoint& target,
+                    const NaiveTunTcpFlow::Segment& segment);
+
+  int mtu_;
+  RedirectResolver* resolver_;
+  ProxyChain proxy_chain_;
+  bool udp_enabled_;
+  HttpNetworkSession* session_;
+  NetworkAnonymizationKey network_anonymization_key_;
+  base::TimeDelta udp_idle_timeout_;
+  NetLogWithSource net_log_;
+  FlowCallback flow_callback_;
+
+  base::ScopedFD fd_;
+  base::MessagePumpForIO::FdWatchController read_watcher_;
+  // Reused for every packet read and written.
+  std::vector<uint8_t> read_buffer_;
+  std::vector<uint8_t> write_buffer_;
+
+  std::map<FlowKey, std::unique_ptr<NaiveTunTcpFlow>> tcp_flows_;
+  std::map<FlowKey, std::unique_ptr<NaiveUdpFlow>> udp_flows_;
+  const bool connect_ip_;
+  std::unique_ptr<NaiveUdpFlow> ip_tunnel_;
+  // The addresses of this host on the device, IPv4 then IPv6, of the
+  // packets translated to the assigned addresses of the tunnel.
+  IPAddress device_addresses_[2];
+  // Flows owing an ACK for the packets read so far, while reading.
+  bool reading_ = false;
+  std::vector<base::WeakPtr<NaiveTunTcpFlow>> pending_acks_;
+
+  // Traffic annotation for socket control.
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+
+  base::WeakPtrFactory<NaiveTunStack> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TUN_STACK_H_
@@ -0,0 +1,632 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_tun_tcp_flow.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/rand_util.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+namespace {
+// Per direction, the most payload a flow holds for the slower side.
+constexpr size_t kReceiveBufferSize = 512 * 1024;
+constexpr size_t kSendBufferSize = 512 * 1024;
+// Fits kReceiveBufferSize in the 16-bit window field.
+constexpr int kWindowScale = 4;
+constexpr int kMaxWindowScale = 14;
+// The default MSS of IPv4 when the SYN has none.
+constexpr int kDefaultMss = 536;
+constexpr base::TimeDelta kInitialRto = base::Milliseconds(250);
+constexpr base::TimeDelta kMaxRto = base::Seconds(30);
+constexpr int kMaxRetransmits = 10;
+constexpr base::TimeDelta kCloseTimeout = base::Seconds(60);
+
+// Sequence number comparisons, modulo 2^32.
+bool SeqLt(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+bool SeqLe(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) <= 0;
+}
+}  // namespace
+
+NaiveTunTcpFlow::NaiveTunTcpFlow(Delegate* delegate,
+                                 const IPEndPoint& client,
+                                 const IPEndPoint& destination,
+                                 int mss)
+    : delegate_(delegate),
+      client_(client),
+      destination_(destination),
+      mss_(mss),
+      rto_(kInitialRto) {}
+
+NaiveTunTcpFlow::~NaiveTunTcpFlow() = default;
+
+void NaiveTunTcpFlow::Accept(const Segment& syn) {
+  DCHECK(syn.flags & kSyn);
+  iss_ = base::RandUint64();
+  snd_una_ = iss_;
+  snd_nxt_ = iss_ + 1;
+  snd_max_ = snd_nxt_;
+  rcv_nxt_ = syn.seq + 1;
+  mss_ = std::min(mss_, syn.mss > 0 ? syn.mss : kDefaultMss);
+  // Either both sides scale their windows or neither does.
+  if (syn.window_scale >= 0) {
+    snd_wscale_ = std::min(syn.window_scale, kMaxWindowScale);
+    rcv_wscale_ = kWindowScale;
+  }
+  snd_wnd_ = syn.window;
+  SendSynAck();
+  StartRetransmitTimer();
+}
+
+void NaiveTunTcpFlow::HandleSegment(const Segment& segment) {
+  if (state_ == STATE_CLOSED)
+    return;
+  if (segment.flags & kRst) {
+    // Only within the window, so that a stray reset cannot close the flow.
+    if (SeqLe(rcv_nxt_, segment.seq) &&
+        SeqLt(segment.seq, rcv_nxt_ + kReceiveBufferSize)) {
+      Abort(ERR_CONNECTION_RESET);
+    }
+    return;
+  }
+  if (segment.flags & kSyn) {
+    // The SYN-ACK was lost.
+    if (state_ == STATE_SYN_RECEIVED && segment.seq + 1 == rcv_nxt_) {
+      SendSynAck();
+    } else {
+      ack_pending_ = true;
+      delegate_->ScheduleAck(this);
+    }
+    return;
+  }
+  if (!(segment.flags & kAck))
+    return;
+
+  bool established = false;
+  if (state_ == STATE_SYN_RECEIVED) {
+    if (segment.ack != iss_ + 1) {
+      return;
+    }
+    established = true;
+    state_ = STATE_ESTABLISHED;
+    snd_una_ = segment.ack;
+    retransmits_ = 0;
+    rto_ = kInitialRto;
+    retransmit_timer_.Stop();
+  }
+  ProcessAck(segment);
+  if (state_ == STATE_CLOSED)
+    return;
+  ProcessPayload(segment);
+  if (state_ == STATE_CLOSED)
+    return;
+  TrySend();
+  MaybeFinish();
+  // Last, so that the socket finds the payload that came with the ACK.
+  if (established && state_ != STATE_CLOSED)
+    delegate_->OnFlowEstablished(this);
+}
+
+void NaiveTunTcpFlow::FlushAck() {
+  if (ack_pending_ && state_ != STATE_CLOSED)
+    SendAck();
+}
+
+int NaiveTunTcpFlow::Read(IOBuffer* buf,
+                          int buf_len,
+                          CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  int rv = ReadAvailable(buf, buf_len);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+  read_buf_ = buf;
+  read_buf_len_ = buf_len;
+  read_if_ready_ = false;
+  read_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int NaiveTunTcpFlow::ReadIfReady(IOBuffer* buf,
+                                 int buf_len,
+                                 CompletionOnceCallback callback) {
+  DCHECK(!read_callback_);
+  int rv = ReadAvailable(buf, buf_len);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+  read_if_ready_ = true;
+  read_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int NaiveTunTcpFlow::CancelReadIfReady() {
+  if (read_if_ready_)
+    read_callback_.Reset();
+  return OK;
+}
+
+int NaiveTunTcpFlow::Write(IOBuffer* buf,
+                           int buf_len,
+                           CompletionOnceCallback callback) {
+  DCHECK(!write_callback_);
+  DCHECK_GT(buf_len, 0);
+  if (error_ != OK)
+    return error_;
+  if (closing_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  size_t room = kSendBufferSize - std::min(send_buffer_size(), kSendBufferSize);
+  if (room == 0) {
+    write_buf_ = buf;
+    write_buf_len_ = buf_len;
+    write_callback_ = std::move(callback);
+    return ERR_IO_PENDING;
+  }
+  size_t size = std::min(room, static_cast<size_t>(buf_len));
+  send_buffer_.append(buf->data(), size);
+  TrySend();
+  return static_cast<int>(size);
+}
+
+void NaiveTunTcpFlow::Close(bool reset) {
+  if (closing_)
+    return;
+  closing_ = true;
+  read_callback_.Reset();
+  read_buf_ = nullptr;
+  write_callback_.Reset();
+  write_buf_ = nullptr;
+  if (state_ == STATE_CLOSED) {
+    Finish();
+    return;
+  }
+  if (reset || unread_size() > 0) {
+    SendReset();
+    Finish();
+    return;
+  }
+  // What the client sends from now on is acknowledged and dropped.
+  receive_buffer_.clear();
+  read_offset_ = 0;
+  close_timer_.Start(FROM_HERE, kCloseTimeout,
+                     base::BindOnce(
+                         [](NaiveTunTcpFlow* flow) {
+                           flow->SendReset();
+                           flow->Finish();
+                         },
+                         base::Unretained(this)));
+  TrySend();
+  MaybeFinish();
+}
+
+bool NaiveTunTcpFlow::IsConnected() const {
+  return state_ != STATE_CLOSED && !closing_ && error_ == OK;
+}
+
+bool NaiveTunTcpFlow::IsIdle() const {
+  return unread_size() == 0;
+}
+
+uint16_t NaiveTunTcpFlow::GetWindowField() const {
+  size_t window = closing_ ? kReceiveBufferSize
+                           : kReceiveBufferSize -
+                                 std::min(unread_size(), kReceiveBufferSize);
+  return static_cast<uint16_t>(
+      std::min<size_t>(window >> rcv_wscale_, 0xffff));
+}
+
+size_t NaiveTunTcpFlow::bytes_in_flight() const {
+  // The FIN takes a sequence number of its own.
+  return snd_nxt_ - snd_una_ - (fin_sent_ ? 1 : 0);
+}
+
+void NaiveTunTcpFlow::SendSynAck() {
+  Segment segment;
+  segment.seq = iss_;
+  segment.ack = rcv_nxt_;
+  segment.flags = kSyn | kAck;
+  segment.window = GetWindowField();
+  segment.mss = mss_;
+  segment.window_scale = snd_wscale_ > 0 || rcv_wscale_ > 0 ? rcv_wscale_ : -1;
+  advertised_window_ = segment.window;
+  delegate_->SendSegment(*this, segment);
+}
+
+void NaiveTunTcpFlow::SendAck() {
+  Segment segment;
+  segment.seq = snd_nxt_;
+  segment.ack = rcv_nxt_;
+  segment.flags = kAck;
+  segment.window = GetWindowField();
+  advertised_window_ = segment.window;
+  ack_pending_ = false;
+  delegate_->SendSegment(*this, segment);
+}
+
+void NaiveTunTcpFlow::SendReset() {
+  Segment segment;
+  segment.seq = snd_nxt_;
+  segment.ack = rcv_nxt_;
+  segment.flags = kRst | kAck;
+  delegate_->SendSegment(*this, segment);
+}
+
+void NaiveTunTcpFlow::ProcessAck(const Segment& segment) {
+  snd_wnd_ = static_cast<uint32_t>(segment.window) << snd_wscale_;
+  if (!SeqLt(snd_una_, segment.ack) || SeqLt(snd_max_, segment.ack))
+    return;
+
+  size_t acked = segment.ack - snd_una_;
+  size_t data_acked = std::min(acked, send_buffer_size());
+  if (fin_sent_ && acked > data_acked)
+    fin_acked_ = true;
+  send_offset_ += data_acked;
+  if (send_offset_ == send_buffer_.size()) {
+    send_buffer_.clear();
+    send_offset_ = 0;
+  } else if (send_offset_ >= send_buffer_.size() / 2) {
+    send_buffer_.erase(0, send_offset_);
+    send_offset_ = 0;
+  }
+  snd_una_ = segment.ack;
+  // After going back to resend, the client may acknowledge beyond.
+  if (SeqLt(snd_nxt_, snd_una_))
+    snd_nxt_ = snd_una_;
+  retransmits_ = 0;
+  rto_ = kInitialRto;
+  retransmit_timer_.Stop();
+  if (snd_una_ != snd_max_)
+    StartRetransmitTimer();
+  CompleteWrite();
+}
+
+void NaiveTunTcpFlow::ProcessPayload(const Segment& segment) {
+  base::span<const uint8_t> payload = segment.payload;
+  bool fin = segment.flags & kFin;
+  if (payload.empty() && !fin)
+    return;
+  // Retransmitted data the flow already has.
+  uint32_t seq = segment.seq;
+  if (SeqLt(seq, rcv_nxt_)) {
+    size_t duplicate = rcv_nxt_ - seq;
+    if (duplicate > payload.size() || (duplicate == payload.size() && !fin)) {
+      ack_pending_ = true;
+      delegate_->ScheduleAck(this);
+      return;
+    }
+    payload = payload.subspan(duplicate);
+    seq = rcv_nxt_;
+  }
+  // Out of order, for the client to resend. The duplicate ACK tells it so.
+  if (seq != rcv_nxt_ || client_fin_) {
+    ack_pending_ = true;
+    delegate_->ScheduleAck(this);
+    return;
+  }
+
+  size_t room = closing_ ? payload.size()
+                         : kReceiveBufferSize -
+                               std::min(unread_size(), kReceiveBufferSize);
+  size_t size = std::min(room, payload.size());
+  if (!closing_) {
+    if (read_offset_ > 0 && read_offset_ == receive_buffer_.size()) {
+      receive_buffer_.clear();
+      read_offset_ = 0;
+    }
+    receive_buffer_.append(reinterpret_cast<const char*>(payload.data()),
+                           size);
+    bytes_received_ += size;
+  }
+  rcv_nxt_ += size;
+  if (fin && size == payload.size()) {
+    client_fin_ = true;
+    ++rcv_nxt_;
+  }
+  ack_pending_ = true;
+  delegate_->ScheduleAck(this);
+  if (size > 0 || client_fin_)
+    CompleteRead();
+}
+
+void NaiveTunTcpFlow::TrySend() {
+  if (state_ != STATE_ESTABLISHED)
+    return;
+  for (;;) {
+    size_t in_flight = bytes_in_flight();
+    size_t unsent = send_buffer_size() - in_flight;
+    size_t window = snd_wnd_ > in_flight ? snd_wnd_ - in_flight : 0;
+    size_t size = std::min({unsent, window, static_cast<size_t>(mss_)});
+    if (size == 0) {
+      if (unsent == 0 && closing_ && !fin_sent_) {
+        Segment segment;
+        segment.seq = snd_nxt_;
+        segment.ack = rcv_nxt_;
+        segment.flags = kFin | kAck;
+        segment.window = GetWindowField();
+        fin_sent_ = true;
+        ++snd_nxt_;
+        if (SeqLt(snd_max_, snd_nxt_))
+          snd_max_ = snd_nxt_;
+        ack_pending_ = false;
+        delegate_->SendSegment(*this, segment);
+        StartRetransmitTimer();
+      } else if (unsent > 0) {
+        // Probes the closed window on the timer.
+        StartRetransmitTimer();
+      }
+      return;
+    }
+    Segment segment;
+    segment.seq = snd_nxt_;
+    segment.ack = rcv_nxt_;
+    segment.flags = kAck | (size == unsent ? kPsh : 0);
+    segment.window = GetWindowField();
+    segment.payload = base::as_bytes(base::make_span(
+        send_buffer_.data() + send_offset_ + in_flight, size));
+    snd_nxt_ += size;
+    if (SeqLt(snd_max_, snd_nxt_))
+      snd_max_ = snd_nxt_;
+    advertised_window_ = segment.window;
+    ack_pending_ = false;
+    delegate_->SendSegment(*this, segment);
+    StartRetransmitTimer();
+  }
+}
+
+void NaiveTunTcpFlow::StartRetransmitTimer() {
+  if (retransmit_timer_.IsRunning())
+    return;
+  // Unretained is safe because the timer is owned by this.
+  retransmit_timer_.Start(FROM_HERE, rto_,
+                          base::BindOnce(&NaiveTunTcpFlow::OnRetransmitTimer,
+                                         base::Unretained(this)));
+}
+
+void NaiveTunTcpFlow::OnRetransmitTimer() {
+  if (++retransmits_ > kMaxRetransmits) {
+    SendReset();
+    Abort(ERR_TIMED_OUT);
+    return;
+  }
+  rto_ = std::min(rto_ * 2, kMaxRto);
+  if (state_ == STATE_SYN_RECEIVED) {
+    SendSynAck();
+    StartRetransmitTimer();
+    return;
+  }
+  size_t in_flight = bytes_in_flight();
+  if (in_flight == 0 && !fin_sent_ && snd_wnd_ == 0 &&
+      send_buffer_size() > 0) {
+    // A window probe of one byte, which the window would not take.
+    Segment segment;
+    segment.seq = snd_nxt_;
+    segment.ack = rcv_nxt_;
+    segment.flags = kAck;
+    segment.window = GetWindowField();
+    segment.payload = base::as_bytes(
+        base::make_span(send_buffer_.data() + send_offset_, 1u));
+    ++snd_nxt_;
+    if (SeqLt(snd_max_, snd_nxt_))
+      snd_max_ = snd_nxt_;
+    delegate_->SendSegment(*this, segment);
+    StartRetransmitTimer();
+    return;
+  }
+  // Go back to resend everything not acknowledged.
+  snd_nxt_ = snd_una_;
+  if (fin_sent_ && !fin_acked_)
+    fin_sent_ = false;
+  // The window may have closed since, leaving the first segment to go.
+  uint32_t window = snd_wnd_;
+  if (snd_wnd_ < static_cast<uint32_t>(mss_))
+    snd_wnd_ = mss_;
+  TrySend();
+  snd_wnd_ = window;
+}
+
+int NaiveTunTcpFlow::ReadAvailable(IOBuffer* buf, int buf_len) {
+  if (size_t available = unread_size()) {
+    size_t size = std::min(available, static_cast<size_t>(buf_len));
+    memcpy(buf->data(), receive_buffer_.data() + read_offset_, size);
+    read_offset_ += size;
+    if (read_offset_ == receive_buffer_.size()) {
+      receive_buffer_.clear();
+      read_offset_ = 0;
+    } else if (read_offset_ >= receive_buffer_.size() / 2) {
+      receive_buffer_.erase(0, read_offset_);
+      read_offset_ = 0;
+    }
+    // Tells the client once the read has opened a window it had filled.
+    uint32_t window = GetWindowField();
+    if (state_ != STATE_CLOSED &&
+        static_cast<size_t>(advertised_window_) << rcv_wscale_ <
+            static_cast<size_t>(mss_) &&
+        (static_cast<size_t>(window) << rcv_wscale_) >=
+            kReceiveBufferSize / 4) {
+      SendAck();
+    }
+    return static_cast<int>(size);
+  }
+  if (error_ != OK)
+    return error_;
+  if (client_fin_)
+    return 0;
+  return ERR_IO_PENDING;
+}
+
+void NaiveTunTcpFlow::CompleteRead() {
+  if (!read_callback_)
+    return;
+  int rv;
+  if (read_if_ready_) {
+    rv = error_ != OK ? error_ : OK;
+  } else {
+    rv = ReadAvailable(read_buf_.get(), read_buf_len_);
+    if (rv == ERR_IO_PENDING)
+      return;
+    read_buf_ = nullptr;
+  }
+  std::move(read_callback_).Run(rv);
+}
+
+void NaiveTunTcpFlow::CompleteWrite() {
+  if (!write_callback_)
+    return;
+  size_t room = kSendBufferSize - std::min(send_buffer_size(), kSendBufferSize);
+  if (room == 0)
+    return;
+  size_t size = std::min(room, static_cast<size_t>(write_buf_len_));
+  send_buffer_.append(write_buf_->data(), size);
+  write_buf_ = nullptr;
+  TrySend();
+  std::move(write_callback_).Run(static_cast<int>(size));
+}
+
+void NaiveTunTcpFlow::Abort(int error) {
+  // No socket was made for the flow yet to close it.
+  bool unused = state_ == STATE_SYN_RECEIVED;
+  error_ = error;
+  state_ = STATE_CLOSED;
+  retransmit_timer_.Stop();
+  close_timer_.Stop();
+  // Either callback may close the flow.
+  base::WeakPtr<NaiveTunTcpFlow> self = GetWeakPtr();
+  if (read_callback_) {
+    read_buf_ = nullptr;
+    std::move(read_callback_).Run(error);
+  }
+  if (self && write_callback_) {
+    write_buf_ = nullptr;
+    std::move(write_callback_).Run(error);
+  }
+  if (self && (closing_ || unused))
+    Finish();
+}
+
+void NaiveTunTcpFlow::MaybeFinish() {
+  if (closing_ && fin_acked_ && client_fin_)
+    Finish();
+}
+
+void NaiveTunTcpFlow::Finish() {
+  if (!delegate_)
+    return;
+  state_ = STATE_CLOSED;
+  retransmit_timer_.Stop();
+  close_timer_.Stop();
+  Delegate* delegate = delegate_;
+  delegate_ = nullptr;
+  delegate->OnFlowClosed(this);
+}
+
+NaiveTunTcpSocket::NaiveTunTcpSocket(base::WeakPtr<NaiveTunTcpFlow> flow,
+                                     const NetLogWithSource& net_log)
+    : flow_(std::move(flow)),
+      client_(flow_->client()),
+      destination_(flow_->destination()),
+      net_log_(net_log) {}
+
+NaiveTunTcpSocket::~NaiveTunTcpSocket() {
+  Disconnect();
+}
+
+int NaiveTunTcpSocket::Connect(CompletionOnceCallback callback) {
+  // The flow is connected by the time the socket is made.
+  return flow_ ? OK : ERR_CONNECTION_RESET;
+}
+
+void NaiveTunTcpSocket::Disconnect() {
+  if (NaiveTunTcpFlow* flow = flow_.get())
+    flow->Close(reset_on_disconnect_);
+  flow_.reset();
+}
+
+bool NaiveTunTcpSocket::IsConnected() const {
+  return flow_ && flow_->IsConnected();
+}
+
+bool NaiveTunTcpSocket::IsConnectedAndIdle() const {
+  return IsConnected() && flow_->IsIdle();
+}
+
+const NetLogWithSource& NaiveTunTcpSocket::NetLog() const {
+  return net_log_;
+}
+
+bool NaiveTunTcpSocket::WasEverUsed() const {
+  return true;
+}
+
+NextProto NaiveTunTcpSocket::GetNegotiatedProtocol() const {
+  return kProtoUnknown;
+}
+
+bool NaiveTunTcpSocket::GetSSLInfo(SSLInfo* ssl_info) {
+  return false;
+}
+
+int64_t NaiveTunTcpSocket::GetTotalReceivedBytes() const {
+  return flow_ ? flow_->bytes_received() : 0;
+}
+
+void NaiveTunTcpSocket::ApplySocketTag(const SocketTag& tag) {}
+
+int NaiveTunTcpSocket::Read(IOBuffer* buf,
+                            int buf_len,
+                            CompletionOnceCallback callback) {
+  if (!flow_)
+    return ERR_CONNECTION_RESET;
+  return flow_->Read(buf, buf_len, std::move(callback));
+}
+
+int NaiveTunTcpSocket::ReadIfReady(IOBuffer* buf,
+                                   int buf_len,
+                                   CompletionOnceCallback callback) {
+  if (!flow_)
+    return ERR_CONNECTION_RESET;
+  return flow_->ReadIfReady(buf, buf_len, std::move(callback));
+}
+
+int NaiveTunTcpSocket::CancelReadIfReady() {
+  return flow_ ? flow_->CancelReadIfReady() : OK;
+}
+
+int NaiveTunTcpSocket::Write(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback,
+    const NetworkTrafficAnnotationTag& traffic_annotation) {
+  if (!flow_)
+    return ERR_CONNECTION_RESET;
+  return flow_->Write(buf, buf_len, std::move(callback));
+}
+
+int NaiveTunTcpSocket::SetReceiveBufferSize(int32_t size) {
+  return OK;
+}
+
+int NaiveTunTcpSocket::SetSendBufferSize(int32_t size) {
+  return OK;
+}
+
+int NaiveTunTcpSocket::GetPeerAddress(IPEndPoint* address) const {
+  *address = client_;
+  return OK;
+}
+
+int NaiveTunTcpSocket::GetLocalAddress(IPEndPoint* address) const {
+  *address = destination_;
+  return OK;
+}
+
+}  // namespace net
@@ -0,0 +1,249 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TUN_TCP_FLOW_H_
+#define NET_TOOLS_NAIVE_NAIVE_TUN_TCP_FLOW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "base/containers/span.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/ip_endpoint.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/stream_socket.h"
+
+namespace net {
+
+class IOBuffer;
+
+// The server end of one TCP connection from a TUN device, terminated by
+// NaiveTunStack. Only what a local link needs is implemented: segments out
+// of order are dropped for the client to resend, lost segments are resent
+// go-back-N on a doubling timeout, and there is no congestion control. The
+// stack owns the flow until both sides have closed, which outlasts the
+// NaiveTunTcpSocket reading and writing it. Linux only.
+class NaiveTunTcpFlow {
+ public:
+  enum Flags : uint8_t {
+    kFin = 0x01,
+    kSyn = 0x02,
+    kRst = 0x04,
+    kPsh = 0x08,
+    kAck = 0x10,
+  };
+
+  struct Segment {
+    uint32_t seq = 0;
+    uint32_t ack = 0;
+    uint8_t flags = 0;
+    // As in the header, before window scaling.
+    uint16_t window = 0;
+    // Options of a SYN, 0 and -1 if absent.
+    int mss = 0;
+    int window_scale = -1;
+    base::span<const uint8_t> payload;
+  };
+
+  class Delegate {
+   public:
+    // Sends `segment` from the destination to the client of `flow`.
+    virtual void SendSegment(const NaiveTunTcpFlow& flow,
+                             const Segment& segment) = 0;
+    // Asks for FlushAck() once the packets read with the current one are
+    // handled.
+    virtual void ScheduleAck(NaiveTunTcpFlow* flow) = 0;
+    // The client has completed the handshake.
+    virtual void OnFlowEstablished(NaiveTunTcpFlow* flow) = 0;
+    // The flow is done and can be destroyed, not from its call stack.
+    virtual void OnFlowClosed(NaiveTunTcpFlow* flow) = 0;
+
+   protected:
+    virtual ~Delegate() = default;
+  };
+
+  // `mss` is the largest payload the device MTU fits.
+  NaiveTunTcpFlow(Delegate* delegate,
+                  const IPEndPoint& client,
+                  const IPEndPoint& destination,
+                  int mss);
+  ~NaiveTunTcpFlow();
+  NaiveTunTcpFlow(const NaiveTunTcpFlow&) = delete;
+  NaiveTunTcpFlow& operator=(const NaiveTunTcpFlow&) = delete;
+
+  const IPEndPoint& client() const { return client_; }
+  const IPEndPoint& destination() const { return destination_; }
+  int64_t bytes_received() const { return bytes_received_; }
+
+  // Answers the SYN opening the flow.
+  void Accept(const Segment& syn);
+  void HandleSegment(const Segment& segment);
+  // Sends the ACK owed for the segments handled since, if not sent along
+  // with data.
+  void FlushAck();
+
+  // For NaiveTunTcpSocket.
+  int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int ReadIfReady(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int CancelReadIfReady();
+  int Write(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  // Sends a FIN after the data written so far, or a reset if `reset` or
+  // data the client sent is left unread. Nothing is read or written after.
+  void Close(bool reset);
+  bool IsConnected() const;
+  bool IsIdle() const;
+
+  base::WeakPtr<NaiveTunTcpFlow> GetWeakPtr() {
+    return weak_ptr_factory_.GetWeakPtr();
+  }
+
+ private:
+  enum State {
+    STATE_SYN_RECEIVED,
+    STATE_ESTABLISHED,
+    STATE_CLOSED,
+  };
+
+  uint16_t GetWindowField() const;
+  size_t unread_size() const { return receive_buffer_.size() - read_offset_; }
+  size_t send_buffer_size() const {
+    return send_buffer_.size() - send_offset_;
+  }
+  // Payload sent and not acknowledged.
+  size_t bytes_in_flight() const;
+
+  void SendSynAck();
+  void SendAck();
+  void SendReset();
+  void ProcessAck(const Segment& segment);
+  void ProcessPayload(const Segment& segment);
+  // Sends what the client's window takes of the unsent data, then a FIN
+  // once Close() left nothing unsent.
+  void TrySend();
+  void StartRetransmitTimer();
+  void OnRetransmitTimer();
+
+  // Returns ERR_IO_PENDING if there is nothing to read yet.
+  int ReadAvailable(IOBuffer* buf, int buf_len);
+  void CompleteRead();
+  void CompleteWrite();
+  // Closes with `error` for the pending and later reads and writes.
+  void Abort(int error);
+  // Closes once both sides are done after Close().
+  void MaybeFinish();
+  void Finish();
+
+  Delegate* delegate_;
+  IPEndPoint client_;
+  IPEndPoint destination_;
+  int mss_;
+
+  State state_ = STATE_SYN_RECEIVED;
+  int error_ = 0;
+
+  // Send sequence space. `snd_max_` is the highest sent so far, as
+  // `snd_nxt_` goes back to `snd_una_` to resend.
+  uint32_t iss_ = 0;
+  uint32_t snd_una_ = 0;
+  uint32_t snd_nxt_ = 0;
+  uint32_t snd_max_ = 0;
+  uint32_t snd_wnd_ = 0;
+  int snd_wscale_ = 0;
+  // Holds the payload from `snd_una_` on; the first `send_offset_` bytes
+  // are acknowledged and erased in bulk.
+  std::string send_buffer_;
+  size_t send_offset_ = 0;
+
+  uint32_t rcv_nxt_ = 0;
+  int rcv_wscale_ = 0;
+  // Payload received and not read yet, from `read_offset_` on.
+  std::string receive_buffer_;
+  size_t read_offset_ = 0;
+  // Of the last segment sent, to send a window update when reads open it.
+  uint32_t advertised_window_ = 0;
+  bool ack_pending_ = false;
+
+  // Set by Close().
+  bool closing_ = false;
+  bool fin_sent_ = false;
+  bool fin_acked_ = false;
+  bool client_fin_ = false;
+
+  base::TimeDelta rto_;
+  int retransmits_ = 0;
+  base::OneShotTimer retransmit_timer_;
+  // Bounds how long a closed flow waits for the client.
+  base::OneShotTimer close_timer_;
+
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_ = 0;
+  CompletionOnceCallback read_callback_;
+  // Whether `read_callback_` is of ReadIfReady().
+  bool read_if_ready_ = false;
+  scoped_refptr<IOBuffer> write_buf_;
+  int write_buf_len_ = 0;
+  CompletionOnceCallback write_callback_;
+
+  int64_t bytes_received_ = 0;
+
+  base::WeakPtrFactory<NaiveTunTcpFlow> weak_ptr_factory_{this};
+};
+
+// The client socket of a NaiveConnection over a NaiveTunTcpFlow. Read and
+// write fail with ERR_CONNECTION_RESET once the flow is gone.
+class NaiveTunTcpSocket : public StreamSocket {
+ public:
+  NaiveTunTcpSocket(base::WeakPtr<NaiveTunTcpFlow> flow,
+                    const NetLogWithSource& net_log);
+  // On destruction Disconnect() is called.
+  ~NaiveTunTcpSocket() override;
+  NaiveTunTcpSocket(const NaiveTunTcpSocket&) = delete;
+  NaiveTunTcpSocket& operator=(const NaiveTunTcpSocket&) = delete;
+
+  // Makes Disconnect() reset the flow instead of closing it.
+  void set_reset_on_disconnect() { reset_on_disconnect_ = true; }
+
+  // StreamSocket implementation.
+  int Connect(CompletionOnceCallback callback) override;
+  void Disconnect() override;
+  bool IsConnected() const override;
+  bool IsConnectedAndIdle() const override;
+  const NetLogWithSource& NetLog() const override;
+  bool WasEverUsed() const override;
+  NextProto GetNegotiatedProtocol() const override;
+  bool GetSSLInfo(SSLInfo* ssl_info) override;
+  int64_t GetTotalReceivedBytes() const override;
+  void ApplySocketTag(const SocketTag& tag) override;
+
+  // Socket implementation.
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override;
+  int ReadIfReady(IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) override;
+  int CancelReadIfReady() override;
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override;
+  int SetReceiveBufferSize(int32_t size) override;
+  int SetSendBufferSize(int32_t size) override;
+  int GetPeerAddress(IPEndPoint* address) const override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+
+ private:
+  base::WeakPtr<NaiveTunTcpFlow> flow_;
+  IPEndPoint client_;
+  IPEndPoint destination_;
+  bool reset_on_disconnect_ = false;
+  NetLogWithSource net_log_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TUN_TCP_FLOW_H_
@@ -0,0 +1,29 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_tunnel_context.h"
+
+#include <memory>
+#include <utility>
+
+#include "net/cookies/cookie_store.h"
+#include "net/http/http_auth_handler_basic.h"
+#include "net/http/http_auth_handler_factory.h"
+#include "net/http/http_auth_scheme.h"
+#include "net/url_request/url_request_context_builder.h"
+
+namespace net {
+
+void UseTunnelOnlyServices(URLRequestContextBuilder* builder) {
+  // A null store disables cookies.
+  builder->SetCookieStore(nullptr);
+
+  auto auth_handler_factory =
+      std::make_unique<HttpAuthHandlerRegistryFactory>(
+          /*http_auth_preferences=*/nullptr);
+  auth_handler_factory->RegisterSchemeFactory(
+      kBasicAuthScheme, std::make_unique<HttpAuthHandlerBasic::Factory>());
+  builder->SetHttpAuthHandlerFactory(std::move(auth_handler_factory));
+}
+
+}  // namespace net
@@ -0,0 +1,22 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_TUNNEL_CONTEXT_H_
+#define NET_TOOLS_NAIVE_NAIVE_TUNNEL_CONTEXT_H_
+
+namespace net {
+
+class URLRequestContextBuilder;
+
+// Leaves out of the context built by `builder` what a browser needs and
+// tunnels do not: the cookie store, and the HTTP auth schemes but Basic,
+// whose credentials naive adds to the auth cache of its proxies ahead of
+// time, so Digest, NTLM and Negotiate with their GSSAPI and SSPI libraries
+// are never set up. Reporting and Network Error Logging stay off as long as
+// the builder is not given a policy for them. The transport security state
+// cannot be left out, as TLS sockets consult it, but it is empty without a
+// persister. The caller still sets a fixed proxy resolution service.
+void UseTunnelOnlyServices(URLRequestContextBuilder* builder);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TUNNEL_CONTEXT_H_
@@ -0,0 +1,32 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/naive/naive_tunnel_sessions.h"
+
+#include <algorithm>
+
+namespace net {
+
+namespace {
+constexpr size_t kMaxBulkDestinations = 1024;
+}  // namespace
+
+NaiveTunnelSessions::NaiveTunnelSessions(int concurrency, int bulk_sessions)
+    : concurrency(concurrency),
+      bulk_sessions(bulk_sessions),
+      connection_counts(concurrency + bulk_sessions),
+      bulk_destinations(kMaxBulkDestinations) {
+  for (int i = 0; i < fixed_sessions(); i++) {
+    keys.push_back(NetworkAnonymizationKey::CreateTransient());
+  }
+}
+
+NaiveTunnelSessions::~NaiveTunnelSessions() = default;
+
+bool NaiveTunnelSessions::IsIdle() const {
+  return std::all_of(connection_counts.begin(), connection_counts.end(),
+                     [](int count) { return count == 0; });
+}
+
+}  // namespace net
@@ -0,0 +1,64 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_NAIVE_NAIVE_TUNNEL_SESSIONS_H_
+#define NET_TOOLS_NAIVE_NAIVE_TUNNEL_SESSIONS_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/containers/lru_cache.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
+#include "net/base/network_anonymization_key.h"
+
+namespace net {
+
+// The tunnel sessions of an IO thread, by the transient network
+// anonymization keys that keep them apart in its session pools. Shared by
+// the listeners of the thread, so their connections warm the same
+// sessions, unless NaiveConfig::separate_tunnel_sessions gives each its
+// own. Not thread-safe.
+struct NaiveTunnelSessions : public base::RefCounted<NaiveTunnelSessions> {
+  // Starts with `concurrency` fixed sessions, followed by `bulk_sessions`
+  // more for bulk connections, see NaiveConfig::bulk_sessions.
+  NaiveTunnelSessions(int concurrency, int bulk_sessions);
+  NaiveTunnelSessions(const NaiveTunnelSessions&) = delete;
+  NaiveTunnelSessions& operator=(const NaiveTunnelSessions&) = delete;
+
+  // Whether no connection is open on any session.
+  bool IsIdle() const;
+  // Those added under load start here.
+  int fixed_sessions() const { return concurrency + bulk_sessions; }
+  bool IsBulkSession(int index) const {
+    return index >= concurrency && index < fixed_sessions();
+  }
+
+  // The fixed sessions come first, the bulk ones among them last, followed
+  // by those added under load, which like the first take interactive
+  // connections.
+  const int concurrency;
+  const int bulk_sessions;
+  // A deque so connections keep their references while sessions are added
+  // and removed.
+  std::deque<NetworkAnonymizationKey> keys;
+  // Open connections by tunnel session, indexed like `keys`.
+  std::vector<int> connection_counts;
+  // Since the last connection closed, null while connections are open.
+  base::TimeTicks idle_since;
+  // Whether those past the first were closed while idle in mobile mode.
+  bool closed = false;
+  // Hosts to which a connection relayed NaiveRelayConfig::bulk_bytes, by
+  // when that was, whose next connections are bulk too.
+  base::LRUCache<std::string, base::TimeTicks> bulk_destinations;
+
+ private:
+  friend class base::RefCounted<NaiveTunnelSessions>;
+
+  ~NaiveTunnelSessions();
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_TUNNEL_SESSIONS_H_
@@ -0,0 +1,408 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_udp_flow.h"
+
+#include <cstring>
+#include <utility>
+
+#include "base/base64.h"
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "base/no_destructor.h"
+#include "base/strings/escape.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "net/base/http_user_agent_settings.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/network_anonymization_key.h"
+#include "net/base/privacy_mode.h"
+#include "net/base/proxy_delegate.h"
+#include "net/base/proxy_server.h"
+#include "net/base/request_priority.h"
+#include "net/base/session_usage.h"
+#include "net/dns/public/secure_dns_policy.h"
+#include "net/http/http_auth.h"
+#include "net/http/http_auth_cache.h"
+#include "net/http/http_network_session.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_response_headers.h"
+#include "net/quic/quic_context.h"
+#include "net/quic/quic_proxy_datagram_client_socket.h"
+#include "net/quic/quic_session_pool.h"
+#include "net/socket/socket_tag.h"
+#include "url/gurl.h"
+#include "url/scheme_host_port.h"
+#include "url/url_constants.h"
+
+namespace net {
+
+namespace {
+// Larger than the payload of any QUIC datagram frame.
+constexpr int kMaxDatagramSize = 4096;
+
+// The tunnel request takes a round trip, after the QUIC handshake for the
+// first flow, so the first few datagrams have to wait for it.
+constexpr size_t kMaxPendingDatagrams =
+    QuicProxyDatagramClientSocket::kMaxDatagramQueueSize;
+
+// Forwards the tunnel callbacks to the naive proxy delegate and adds the
+// proxy credentials, which QuicProxyDatagramClientSocket does not look up
+// in the auth cache itself.
+class AuthProxyDelegate : public ProxyDelegate {
+ public:
+  AuthProxyDelegate(ProxyDelegate* delegate, std::string authorization)
+      : delegate_(delegate), authorization_(std::move(authorization)) {}
+
+  void OnResolveProxy(const GURL& url,
+                      const NetworkAnonymizationKey& network_anonymization_key,
+                      const std::string& method,
+                      const ProxyRetryInfoMap& proxy_retry_info,
+                      ProxyInfo* result) override {}
+  void OnFallback(const ProxyChain& bad_proxy, int net_error) override {}
+  void OnSuccessfulRequestAfterFailures(
+      const ProxyRetryInfoMap& proxy_retry_info) override {}
+
+  Error OnBeforeTunnelRequest(const ProxyChain& proxy_chain,
+                              size_t chain_index,
+                              HttpRequestHeaders* extra_headers) override {
+    Error rv = OK;
+    if (delegate_) {
+      rv = delegate_->OnBeforeTunnelRequest(proxy_chain, chain_index,
+                                            extra_headers);
+    }
+    if (rv == OK && !authorization_.empty()) {
+      extra_headers->SetHeader(HttpRequestHeaders::kProxyAuthorization,
+                               authorization_);
+    }
+    return rv;
+  }
+
+  Error OnTunnelHeadersReceived(
+      const ProxyChain& proxy_chain,
+      size_t chain_index,
+      const HttpResponseHeaders& response_headers) override {
+    // A refusal fails the flow here, before the naive delegate takes its
+    // headers for a padding negotiation.
+    int response_code = response_headers.response_code();
+    if (response_code != 200) {
+      if (response_code == 407) {
+        LOG(WARNING) << "UDP tunnel: " << proxy_chain.ToDebugString()
+                     << (authorization_.empty()
+                             ? " requires credentials"
+                             : " rejected the credentials");
+      }
+      return ERR_TUNNEL_CONNECTION_FAILED;
+    }
+    if (!delegate_)
+      return OK;
+    return delegate_->OnTunnelHeadersReceived(proxy_chain, chain_index,
+                                              response_headers);
+  }
+
+  void SetProxyResolutionService(
+      ProxyResolutionService* proxy_resolution_service) override {}
+
+ private:
+  ProxyDelegate* delegate_;
+  std::string authorization_;
+};
+
+std::string GetBasicAuthorization(HttpNetworkSession* session,
+                                  const url::SchemeHostPort& proxy_origin) {
+  HttpAuthCache::Entry* entry = session->http_auth_cache()->Lookup(
+      proxy_origin, HttpAuth::AUTH_PROXY, /*realm=*/{},
+      HttpAuth::AUTH_SCHEME_BASIC, NetworkAnonymizationKey());
+  if (!entry)
+    return {};
+  const AuthCredentials& credentials = entry->credentials();
+  return "Basic " + base::Base64Encode(base::UTF16ToUTF8(
+                        credentials.username() + u":" +
+                        credentials.password()));
+}
+}  // namespace
+
+NaiveUdpFlow::NaiveUdpFlow(
+    const HostPortPair& target,
+    const ProxyChain& proxy_chain,
+    HttpNetworkSession* session,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    base::TimeDelta idle_timeout,
+    const NetLogWithSource& net_log,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : target_(target),
+      proxy_chain_(proxy_chain),
+      session_(session),
+      network_anonymization_key_(network_anonymization_key),
+      idle_timeout_(idle_timeout),
+      net_log_(net_log),
+      next_state_(STATE_NONE),
+      connected_(false),
+      closed_(false),
+      traffic_annotation_(traffic_annotation) {
+  DCHECK(proxy_chain_.is_single_proxy());
+  DCHECK(proxy_chain_.First().is_quic());
+  io_callback_ = base::BindRepeating(&NaiveUdpFlow::OnIOComplete,
+                                     weak_ptr_factory_.GetWeakPtr());
+}
+
+NaiveUdpFlow::~NaiveUdpFlow() = default;
+
+const std::vector<IPAddress>& NaiveUdpFlow::GetAssignedAddresses() const {
+  static const base::NoDestructor<std::vector<IPAddress>> kNone;
+  return socket_ ? socket_->assigned_addresses() : *kNone;
+}
+
+void NaiveUdpFlow::Start(DatagramCallback datagram_callback,
+                         CompletionOnceCallback close_callback) {
+  DCHECK_EQ(next_state_, STATE_NONE);
+  DCHECK(!close_callback_);
+
+  datagram_callback_ = std::move(datagram_callback);
+  close_callback_ = std::move(close_callback);
+
+  last_active_time_ = base::TimeTicks::Now();
+  idle_timer_.Start(FROM_HERE, idle_timeout_,
+                    base::BindOnce(&NaiveUdpFlow::OnIdleTimer,
+                                   weak_ptr_factory_.GetWeakPtr()));
+
+  next_state_ = STATE_REQUEST_SESSION;
+  int rv = DoLoop(OK);
+  if (rv != ERR_IO_PENDING)
+    HandleConnectResult(rv);
+}
+
+void NaiveUdpFlow::OnIOComplete(int result) {
+  DCHECK_NE(next_state_, STATE_NONE);
+  int rv = DoLoop(result);
+  if (rv != ERR_IO_PENDING)
+    HandleConnectResult(rv);
+}
+
+int NaiveUdpFlow::DoLoop(int last_io_result) {
+  DCHECK(next_state_ != STATE_NONE);
+  int rv = last_io_result;
+  do {
+    State state = next_state_;
+    next_state_ = STATE_NONE;
+    switch (state) {
+      case STATE_REQUEST_SESSION:
+        DCHECK_EQ(OK, rv);
+        rv = DoRequestSession();
+        break;
+      case STATE_REQUEST_SESSION_COMPLETE:
+        rv = DoRequestSessionComplete(rv);
+        break;
+      case STATE_REQUEST_STREAM:
+        DCHECK_EQ(OK, rv);
+        rv = DoRequestStream();
+        break;
+      case STATE_REQUEST_STREAM_COMPLETE:
+        rv = DoRequestStreamComplete(rv);
+        break;
+      case STATE_CONNECT_TUNNEL_COMPLETE:
+        rv = DoConnectTunnelComplete(rv);
+        break;
+      default:
+        NOTREACHED() << "bad state";
+        rv = ERR_UNEXPECTED;
+        break;
+    }
+  } while (rv != ERR_IO_PENDING && next_state_ != STATE_NONE);
+  return rv;
+}
+
+int NaiveUdpFlow::DoRequestSession() {
+  next_state_ = STATE_REQUEST_SESSION_COMPLETE;
+
+  const HostPortPair& proxy = proxy_chain_.First().host_port_pair();
+  url::SchemeHostPort destination(url::kHttpsScheme, proxy.host(),
+                                  proxy.port());
+  session_request_ =
+      std::make_unique<QuicSessionRequest>(session_->quic_session_pool());
+  return session_request_->Request(
+      destination, SupportedQuicVersionForProxying(), ProxyChain::Direct(),
+      traffic_annotation_, session_->context().http_user_agent_settings,
+      SessionUsage::kProxy, PRIVACY_MODE_DISABLED, MAXIMUM_PRIORITY,
+      SocketTag(), network_anonymization_key_, SecureDnsPolicy::kDisable,
+      /*require_dns_https_alpn=*/false, /*cert_verify_flags=*/0,
+      GURL("https://" + proxy.ToString()), net_log_, &net_error_details_,
+      /*failed_on_default_network_callback=*/CompletionOnceCallback(),
+      io_callback_);
+}
+
+int NaiveUdpFlow::DoRequestSessionComplete(int result) {
+  if (result < 0) {
+    session_request_.reset();
+    return result;
+  }
+  session_handle_ = session_request_->ReleaseSessionHandle();
+  session_request_.reset();
+
+  next_state_ = STATE_REQUEST_STREAM;
+  return OK;
+}
+
+int NaiveUdpFlow::DoRequestStream() {
+  next_state_ = STATE_REQUEST_STREAM_COMPLETE;
+
+  return session_handle_->RequestStream(/*requires_confirmation=*/false,
+                                        io_callback_, traffic_annotation_);
+}
+
+int NaiveUdpFlow::DoRequestStreamComplete(int result) {
+  if (result < 0)
+    return result;
+
+  std::unique_ptr<QuicChromiumClientStream::Handle> stream =
+      session_handle_->ReleaseStream();
+  DCHECK(stream);
+  if (!stream->IsOpen())
+    return ERR_CONNECTION_CLOSED;
+
+  IPEndPoint local_address;
+  int rv = session_handle_->GetSelfAddress(&local_address);
+  if (rv != OK)
+    return rv;
+  IPEndPoint proxy_peer_address;
+  rv = session_handle_->GetPeerAddress(&proxy_peer_address);
+  if (rv != OK)
+    return rv;
+
+  // The default URI templates of RFC 9298 and RFC 9484, the latter for any
+  // target and protocol.
+  const HostPortPair& proxy = proxy_chain_.First().host_port_pair();
+  GURL url;
+  if (connect_ip_) {
+    url = GURL(base::StringPrintf("https://%s/.well-known/masque/ip/*/*/",
+                                  proxy.ToString().c_str()));
+  } else {
+    url = GURL(base::StringPrintf(
+        "https://%s/.well-known/masque/udp/%s/%d/", proxy.ToString().c_str(),
+        base::EscapeQueryParamValue(target_.host(), /*use_plus=*/false)
+            .c_str(),
+        target_.port()));
+  }
+
+  std::string user_agent;
+  if (session_->context().http_user_agent_settings)
+    user_agent = session_->context().http_user_agent_settings->GetUserAgent();
+  proxy_delegate_ = std::make_unique<AuthProxyDelegate>(
+      session_->context().proxy_delegate,
+      GetBasicAuthorization(session_, url::SchemeHostPort(url)));
+  socket_ = std::make_unique<QuicProxyDatagramClientSocket>(
+      url, proxy_chain_, user_agent, net_log_, proxy_delegate_.get());
+  if (connect_ip_)
+    socket_->UseConnectIp();
+
+  next_state_ = STATE_CONNECT_TUNNEL_COMPLETE;
+  return socket_->ConnectViaStream(local_address, proxy_peer_address,
+                                   std::move(stream), io_callback_);
+}
+
+int NaiveUdpFlow::DoConnectTunnelComplete(int result) {
+  if (result < 0)
+    return result;
+
+  next_state_ = STATE_NONE;
+  return OK;
+}
+
+void NaiveUdpFlow::HandleConnectResult(int result) {
+  // The idle timer may have closed the flow while connecting.
+  if (closed_)
+    return;
+  if (result < 0) {
+    LOG(INFO) << "UDP flow to " << target_.ToString()
+              << " failed: " << ErrorToShortString(result);
+    Close(result);
+    return;
+  }
+
+  connected_ = true;
+  while (!pending_datagrams_.empty()) {
+    Write(pending_datagrams_.front());
+    pending_datagrams_.pop();
+  }
+  read_buffer_ = base::MakeRefCounted<IOBufferWithSize>(kMaxDatagramSize);
+  DoRead();
+}
+
+void NaiveUdpFlow::Send(std::string_view datagram) {
+  if (closed_)
+    return;
+  last_active_time_ = base::TimeTicks::Now();
+  if (!connected_) {
+    if (pending_datagrams_.size() < kMaxPendingDatagrams)
+      pending_datagrams_.emplace(datagram);
+    return;
+  }
+  Write(datagram);
+}
+
+void NaiveUdpFlow::Write(std::string_view datagram) {
+  auto buffer = base::MakeRefCounted<IOBufferWithSize>(datagram.size());
+  std::memcpy(buffer->data(), datagram.data(), datagram.size());
+  // Datagrams are written synchronously. Like UDP sends, failed writes are
+  // dropped, and a closed stream is noticed by the read.
+  int rv = socket_->Write(buffer.get(), buffer->size(),
+                          CompletionOnceCallback(), traffic_annotation_);
+  if (rv < 0) {
+    DVLOG(1) << "UDP flow to " << target_.ToString()
+             << " dropped datagram: " << ErrorToShortString(rv);
+  }
+}
+
+void NaiveUdpFlow::DoRead() {
+  for (;;) {
+    int rv = socket_->Read(read_buffer_.get(), kMaxDatagramSize,
+                           base::BindOnce(&NaiveUdpFlow::OnReadComplete,
+                                          weak_ptr_factory_.GetWeakPtr()));
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (!HandleReadResult(rv))
+      return;
+  }
+}
+
+void NaiveUdpFlow::OnReadComplete(int result) {
+  if (HandleReadResult(result))
+    DoRead();
+}
+
+bool NaiveUdpFlow::HandleReadResult(int result) {
+  // Oversized datagrams are dropped without closing the flow.
+  if (result == ERR_MSG_TOO_BIG)
+    return true;
+  if (result <= 0) {
+    Close(result == 0 ? ERR_CONNECTION_CLOSED : result);
+    return false;
+  }
+  last_active_time_ = base::TimeTicks::Now();
+  datagram_callback_.Run(std::string_view(read_buffer_->data(), result));
+  return true;
+}
+
+void NaiveUdpFlow::OnIdleTimer() {
+  base::TimeDelta idle = base::TimeTicks::Now() - last_active_time_;
+  if (idle >= idle_timeout_) {
+    Close(ERR_TIMED_OUT);
+    return;
+  }
+  idle_timer_.Start(FROM_HERE, idle_timeout_ - idle,
+                    base::BindOnce(&NaiveUdpFlow::OnIdleTimer,
+                                   weak_ptr_factory_.GetWeakPtr()));
+}
+
+void NaiveUdpFlow::Close(int result) {
+  if (closed_)
+    return;
+  closed_ = true;
+  idle_timer_.Stop();
+  std::queue<std::string>().swap(pending_datagrams_);
+  std::move(close_callback_).Run(result);
+}
+
+}  // namespace net
@@ -0,0 +1,143 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_UDP_FLOW_H_
+#define NET_TOOLS_NAIVE_NAIVE_UDP_FLOW_H_
+
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/completion_repeating_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/net_error_details.h"
+#include "net/base/proxy_chain.h"
+#include "net/log/net_log_with_source.h"
+#include "net/quic/quic_chromium_client_session.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+
+namespace net {
+
+class HttpNetworkSession;
+class IOBufferWithSize;
+class NetworkAnonymizationKey;
+class ProxyDelegate;
+class QuicProxyDatagramClientSocket;
+class QuicSessionRequest;
+
+// Carries the datagrams of one UDP flow to `target` in a CONNECT-UDP
+// (RFC 9298) tunnel through the QUIC proxy of `proxy_chain`, or with
+// set_connect_ip() the IP packets of any flows in a CONNECT-IP (RFC 9484)
+// tunnel. Datagrams sent before the tunnel is established are queued, up to
+// a small limit.
+class NaiveUdpFlow {
+ public:
+  using DatagramCallback = base::RepeatingCallback<void(std::string_view)>;
+
+  NaiveUdpFlow(const HostPortPair& target,
+               const ProxyChain& proxy_chain,
+               HttpNetworkSession* session,
+               const NetworkAnonymizationKey& network_anonymization_key,
+               base::TimeDelta idle_timeout,
+               const NetLogWithSource& net_log,
+               const NetworkTrafficAnnotationTag& traffic_annotation);
+  ~NaiveUdpFlow();
+  NaiveUdpFlow(const NaiveUdpFlow&) = delete;
+  NaiveUdpFlow& operator=(const NaiveUdpFlow&) = delete;
+
+  // Opens a CONNECT-IP tunnel to any destination and protocol instead, whose
+  // datagrams are whole IP packets, with `target` only labeling it in the
+  // log. Must be called before Start().
+  void set_connect_ip() { connect_ip_ = true; }
+  // The addresses the proxy assigned to this end of a CONNECT-IP tunnel,
+  // which the packets sent have to come from. Empty until it did.
+  const std::vector<IPAddress>& GetAssignedAddresses() const;
+
+  // Starts connecting the tunnel. Runs `datagram_callback` for each datagram
+  // from the target, and `close_callback` once when the tunnel fails or no
+  // datagram went either way for the idle timeout. Neither callback may
+  // destroy the flow synchronously.
+  void Start(DatagramCallback datagram_callback,
+             CompletionOnceCallback close_callback);
+
+  // Sends `datagram` to the target. Datagrams are dropped if the tunnel is
+  // not established and the queue is full, or after the flow is closed.
+  void Send(std::string_view datagram);
+
+  const HostPortPair& target() const { return target_; }
+
+ private:
+  enum State {
+    STATE_REQUEST_SESSION,
+    STATE_REQUEST_SESSION_COMPLETE,
+    STATE_REQUEST_STREAM,
+    STATE_REQUEST_STREAM_COMPLETE,
+    STATE_CONNECT_TUNNEL_COMPLETE,
+    STATE_NONE,
+  };
+
+  void OnIOComplete(int result);
+  int DoLoop(int last_io_result);
+  int DoRequestSession();
+  int DoRequestSessionComplete(int result);
+  int DoRequestStream();
+  int DoRequestStreamComplete(int result);
+  int DoConnectTunnelComplete(int result);
+  void HandleConnectResult(int result);
+
+  void Write(std::string_view datagram);
+  void DoRead();
+  void OnReadComplete(int result);
+  bool HandleReadResult(int result);
+
+  void OnIdleTimer();
+  void Close(int result);
+
+  HostPortPair target_;
+  const ProxyChain& proxy_chain_;
+  HttpNetworkSession* session_;
+  const NetworkAnonymizationKey& network_anonymization_key_;
+  base::TimeDelta idle_timeout_;
+  const NetLogWithSource& net_log_;
+
+  CompletionRepeatingCallback io_callback_;
+  DatagramCallback datagram_callback_;
+  CompletionOnceCallback close_callback_;
+
+  bool connect_ip_ = false;
+  State next_state_;
+  bool connected_;
+  bool closed_;
+
+  std::unique_ptr<QuicSessionRequest> session_request_;
+  std::unique_ptr<QuicChromiumClientSession::Handle> session_handle_;
+  NetErrorDetails net_error_details_;
+  // Adds the proxy credentials to the tunnel request.
+  std::unique_ptr<ProxyDelegate> proxy_delegate_;
+  std::unique_ptr<QuicProxyDatagramClientSocket> socket_;
+
+  std::queue<std::string> pending_datagrams_;
+  scoped_refptr<IOBufferWithSize> read_buffer_;
+
+  // Checked when `idle_timer_` fires instead of restarting the timer for
+  // every datagram.
+  base::TimeTicks last_active_time_;
+  base::OneShotTimer idle_timer_;
+
+  // Traffic annotation for socket control.
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+
+  base::WeakPtrFactory<NaiveUdpFlow> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_UDP_FLOW_H_
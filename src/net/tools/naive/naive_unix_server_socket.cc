@@ -0,0 +1,102 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_unix_server_socket.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/log/net_log_source.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_socket.h"
+
+namespace net {
+
+namespace {
+// Access is left to the permissions of the socket file.
+bool AllowAnyPeer(const UnixDomainServerSocket::Credentials&) {
+  return true;
+}
+}  // namespace
+
+NaiveUnixServerSocket::NaiveUnixServerSocket(NetLog* net_log)
+    : net_log_(net_log),
+      listen_socket_(base::BindRepeating(&AllowAnyPeer),
+                     /*use_abstract_namespace=*/false) {}
+
+NaiveUnixServerSocket::~NaiveUnixServerSocket() {
+  if (accepted_fd_ != kInvalidSocket) {
+    IGNORE_EINTR(close(accepted_fd_));
+  }
+}
+
+int NaiveUnixServerSocket::BindAndListen(const std::string& path,
+                                         int backlog) {
+  // Only a socket is removed, a mistyped path to a regular file fails.
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) &&
+      unlink(path.c_str()) != 0) {
+    PLOG(ERROR) << "Failed to remove " << path;
+    return ERR_ADDRESS_IN_USE;
+  }
+  return listen_socket_.BindAndListen(path, backlog);
+}
+
+int NaiveUnixServerSocket::Listen(const IPEndPoint& address,
+                                  int backlog,
+                                  std::optional<bool> ipv6_only) {
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int NaiveUnixServerSocket::GetLocalAddress(IPEndPoint* address) const {
+  return listen_socket_.GetLocalAddress(address);
+}
+
+int NaiveUnixServerSocket::Accept(std::unique_ptr<StreamSocket>* socket,
+                                  CompletionOnceCallback callback) {
+  DCHECK(!accept_out_);
+  // Unretained is safe because the listening socket is owned by this.
+  int result = listen_socket_.AcceptSocketDescriptor(
+      &accepted_fd_,
+      base::BindOnce(&NaiveUnixServerSocket::OnAcceptComplete,
+                     base::Unretained(this), std::move(callback)));
+  if (result == ERR_IO_PENDING) {
+    accept_out_ = socket;
+    return result;
+  }
+  if (result != OK)
+    return result;
+  return WrapAccepted(socket);
+}
+
+void NaiveUnixServerSocket::OnAcceptComplete(CompletionOnceCallback callback,
+                                             int result) {
+  std::unique_ptr<StreamSocket>* socket = accept_out_;
+  accept_out_ = nullptr;
+  if (result == OK) {
+    result = WrapAccepted(socket);
+  }
+  std::move(callback).Run(result);
+}
+
+int NaiveUnixServerSocket::WrapAccepted(std::unique_ptr<StreamSocket>* socket) {
+  SocketDescriptor fd = std::exchange(accepted_fd_, kInvalidSocket);
+  auto tcp_socket = std::make_unique<TCPSocket>(
+      /*socket_performance_watcher=*/nullptr, net_log_, NetLogSource());
+  // Closes the descriptor if it fails.
+  int result = tcp_socket->AdoptConnectedSocket(fd, IPEndPoint());
+  if (result != OK)
+    return result;
+  *socket =
+      std::make_unique<TCPClientSocket>(std::move(tcp_socket), IPEndPoint());
+  return OK;
+}
+
+}  // namespace net
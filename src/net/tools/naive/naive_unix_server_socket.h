@@ -0,0 +1,59 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_UNIX_SERVER_SOCKET_H_
+#define NET_TOOLS_NAIVE_NAIVE_UNIX_SERVER_SOCKET_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "base/memory/raw_ptr.h"
+#include "net/base/completion_once_callback.h"
+#include "net/log/net_log.h"
+#include "net/socket/server_socket.h"
+#include "net/socket/socket_descriptor.h"
+#include "net/socket/unix_domain_server_socket_posix.h"
+
+namespace net {
+
+class IPEndPoint;
+class StreamSocket;
+
+// Listens on a Unix domain socket for local clients of socks+unix:// and
+// http+unix:// listeners, skipping the TCP stack of loopback. Accepted
+// connections are handed out as TCPClientSocket adopting the descriptor
+// with an empty peer address, as the relays take the client transport of
+// socks:// and http:// connections for one and work on any stream
+// socket descriptor. A socket file left at the path by an earlier run is
+// replaced. POSIX only.
+class NaiveUnixServerSocket : public ServerSocket {
+ public:
+  explicit NaiveUnixServerSocket(NetLog* net_log);
+  NaiveUnixServerSocket(const NaiveUnixServerSocket&) = delete;
+  NaiveUnixServerSocket& operator=(const NaiveUnixServerSocket&) = delete;
+  ~NaiveUnixServerSocket() override;
+
+  int BindAndListen(const std::string& path, int backlog);
+
+  // ServerSocket implementation.
+  int Listen(const IPEndPoint& address,
+             int backlog,
+             std::optional<bool> ipv6_only) override;
+  int GetLocalAddress(IPEndPoint* address) const override;
+  int Accept(std::unique_ptr<StreamSocket>* socket,
+             CompletionOnceCallback callback) override;
+
+ private:
+  void OnAcceptComplete(CompletionOnceCallback callback, int result);
+  int WrapAccepted(std::unique_ptr<StreamSocket>* socket);
+
+  const raw_ptr<NetLog> net_log_;
+  UnixDomainServerSocket listen_socket_;
+  SocketDescriptor accepted_fd_ = kInvalidSocket;
+  raw_ptr<std::unique_ptr<StreamSocket>> accept_out_ = nullptr;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_UNIX_SERVER_SOCKET_H_
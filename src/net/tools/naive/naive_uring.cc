@@ -0,0 +1,328 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_uring.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "base/check.h"
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/tools/naive/naive_thread_local.h"
+
+namespace net {
+
+namespace {
+// Small enough for the RLIMIT_MEMLOCK of 64 KB that kernels before 5.12
+// charge the rings to.
+constexpr unsigned kEntries = 256;
+constexpr uint16_t kBufferGroup = 0;
+// Of requests without an op, i.e. buffer provisions and cancellations.
+constexpr uint64_t kNoOp = 0;
+
+void* MapRing(int fd, size_t size, off_t offset) {
+  void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+}  // namespace
+
+NaiveUring::NaiveUring() : watcher_(FROM_HERE) {}
+
+NaiveUring::~NaiveUring() {
+  watcher_.StopWatchingFileDescriptor();
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_)
+    munmap(sq_ring_, sq_ring_size_);
+}
+
+// static
+NaiveUring* NaiveUring::GetForCurrentThread() {
+  // Setting up is only tried once per thread.
+  return GetOrCreateForCurrentThread<NaiveUring>(
+      []() -> std::unique_ptr<NaiveUring> {
+        auto uring = base::WrapUnique(new NaiveUring());
+        if (!uring->Init()) {
+          LOG(WARNING) << "io_uring is unavailable, relaying with epoll";
+          return nullptr;
+        }
+        return uring;
+      });
+}
+
+bool NaiveUring::Init() {
+  io_uring_params params = {};
+  int fd = syscall(__NR_io_uring_setup, kEntries, &params);
+  if (fd < 0) {
+    PLOG(WARNING) << "io_uring_setup failed";
+    return false;
+  }
+  ring_fd_.reset(fd);
+  // Sockets are polled in the kernel instead of by worker threads since
+  // Linux 5.7, which also added provided buffers.
+  if (!(params.features & IORING_FEAT_FAST_POLL)) {
+    LOG(WARNING) << "io_uring lacks IORING_FEAT_FAST_POLL";
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+  sq_ring_ = MapRing(fd, sq_ring_size_, IORING_OFF_SQ_RING);
+  if (!sq_ring_) {
+    PLOG(WARNING) << "io_uring mmap failed";
+    return false;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = MapRing(fd, cq_ring_size_, IORING_OFF_CQ_RING);
+    if (!cq_ring_) {
+      PLOG(WARNING) << "io_uring mmap failed";
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(MapRing(fd, sqes_size_, IORING_OFF_SQES));
+  if (!sqes_) {
+    PLOG(WARNING) << "io_uring mmap failed";
+    return false;
+  }
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_flags_ = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  // Entries are used in ring order.
+  for (unsigned i = 0; i < sq_entries_; ++i) {
+    sq_array_[i] = i;
+  }
+  sq_local_tail_ = *sq_tail_;
+
+  // Not zeroed, which would touch all of it.
+  buffers_.reset(new char[kBufferCount * kBufferSize]);
+  ProvideBuffers(0, kBufferCount);
+  if (Enter(1, IORING_ENTER_GETEVENTS) < 0)
+    return false;
+  unsigned head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+    return false;
+  int result = cqes_[head & cq_mask_].res;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  if (result < 0) {
+    LOG(WARNING) << "io_uring cannot provide buffers: " << strerror(-result);
+    return false;
+  }
+
+  watching_ = base::CurrentIOThread::Get()->WatchFileDescriptor(
+      fd, /*persistent=*/true, base::MessagePumpForIO::WATCH_READ, &watcher_,
+      this);
+  return watching_;
+}
+
+io_uring_sqe* NaiveUring::GetSqe() {
+  if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >=
+      sq_entries_) {
+    Enter(0, 0);
+  }
+  // The kernel copies entries out when submitting, so the queue only stays
+  // full if it could not submit at all.
+  CHECK_LT(sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE),
+           sq_entries_);
+  io_uring_sqe* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+  ++sq_local_tail_;
+  memset(sqe, 0, sizeof(*sqe));
+  ScheduleSubmit();
+  return sqe;
+}
+
+io_uring_sqe* NaiveUring::GetSqeForOp(Op* op, int buffer_id) {
+  DCHECK(!op->in_flight());
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = slots_.size();
+    slots_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot].op = op;
+  slots_[slot].buffer_id = buffer_id;
+  op->slot_ = slot + 1;
+
+  io_uring_sqe* sqe = GetSqe();
+  sqe->user_data = op->slot_;
+  return sqe;
+}
+
+void NaiveUring::Recv(int fd, Op* op) {
+  io_uring_sqe* sqe = GetSqeForOp(op, -1);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->len = kBufferSize;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+}
+
+void NaiveUring::Poll(int fd, short events, Op* op) {
+  io_uring_sqe* sqe = GetSqeForOp(op, -1);
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll_events = events;
+}
+
+void NaiveUring::Send(int fd, int buffer_id, int offset, int size, Op* op) {
+  DCHECK_LE(offset + size, kBufferSize);
+  io_uring_sqe* sqe = GetSqeForOp(op, buffer_id);
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer(buffer_id) + offset);
+  sqe->len = size;
+  sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+void NaiveUring::Cancel(Op* op) {
+  if (!op->in_flight()) {
+    auto it = std::find(buffer_waiters_.begin(), buffer_waiters_.end(), op);
+    if (it != buffer_waiters_.end())
+      buffer_waiters_.erase(it);
+    return;
+  }
+  // The slot stays taken until the request completes.
+  slots_[op->slot_ - 1].op = nullptr;
+  io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = op->slot_;
+  sqe->user_data = kNoOp;
+  op->slot_ = 0;
+}
+
+void NaiveUring::WaitForBuffer(Op* op) {
+  DCHECK(!op->in_flight());
+  buffer_waiters_.push_back(op);
+}
+
+void NaiveUring::ReleaseBuffer(int buffer_id) {
+  ProvideBuffers(buffer_id, 1);
+  if (!buffer_waiters_.empty()) {
+    Op* op = buffer_waiters_.front();
+    buffer_waiters_.pop_front();
+    op->OnBufferAvailable();
+  }
+}
+
+void NaiveUring::ProvideBuffers(int buffer_id, int count) {
+  io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = count;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer(buffer_id));
+  sqe->len = kBufferSize;
+  sqe->off = buffer_id;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = kNoOp;
+}
+
+void NaiveUring::ScheduleSubmit() {
+  if (submit_pending_ || !watching_)
+    return;
+  submit_pending_ = true;
+  // Unretained is safe because the ring lives as long as the thread.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&NaiveUring::Submit, base::Unretained(this)));
+}
+
+void NaiveUring::Submit() {
+  submit_pending_ = false;
+  Enter(0, 0);
+}
+
+int NaiveUring::Enter(unsigned min_complete, unsigned flags) {
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+  unsigned to_submit =
+      sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (to_submit == 0 && flags == 0)
+    return 0;
+  int rv = HANDLE_EINTR(syscall(__NR_io_uring_enter, ring_fd_.get(),
+                                to_submit, min_complete, flags, nullptr, 0));
+  if (rv < 0)
+    PLOG(ERROR) << "io_uring_enter failed";
+  return rv;
+}
+
+void NaiveUring::OnFileCanReadWithoutBlocking(int fd) {
+  Reap();
+}
+
+void NaiveUring::Reap() {
+  for (;;) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      // Completions beyond the queue are held by the kernel until an enter
+      // asks for them.
+      if (!(__atomic_load_n(sq_flags_, __ATOMIC_ACQUIRE) &
+            IORING_SQ_CQ_OVERFLOW) ||
+          Enter(0, IORING_ENTER_GETEVENTS) < 0) {
+        return;
+      }
+      continue;
+    }
+    io_uring_cqe cqe = cqes_[head & cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    Dispatch(cqe);
+  }
+}
+
+void NaiveUring::Dispatch(const io_uring_cqe& cqe) {
+  if (cqe.user_data == kNoOp) {
+    if (cqe.res < 0 && cqe.res != -ENOENT && cqe.res != -EALREADY)
+      LOG(ERROR) << "io_uring request failed: " << strerror(-cqe.res);
+    return;
+  }
+  uint32_t slot = cqe.user_data - 1;
+  Op* op = slots_[slot].op;
+  int send_buffer_id = slots_[slot].buffer_id;
+  slots_[slot] = Slot();
+  free_slots_.push_back(slot);
+
+  int buffer_id = -1;
+  if (cqe.flags & IORING_CQE_F_BUFFER)
+    buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  if (!op) {
+    if (buffer_id >= 0)
+      ReleaseBuffer(buffer_id);
+    if (send_buffer_id >= 0)
+      ReleaseBuffer(send_buffer_id);
+    return;
+  }
+  op->slot_ = 0;
+  op->OnComplete(cqe.res, buffer_id);
+}
+
+}  // namespace net
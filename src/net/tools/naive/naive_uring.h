@@ -0,0 +1,144 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_URING_H_
+#define NET_TOOLS_NAIVE_NAIVE_URING_H_
+
+#include <linux/io_uring.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/containers/circular_deque.h"
+#include "base/files/scoped_file.h"
+#include "base/message_loop/message_pump_for_io.h"
+
+namespace net {
+
+// An io_uring instance of an IO thread, set up with raw syscalls. Requests
+// are queued and submitted with one io_uring_enter(2) per event loop
+// iteration, and completions are reaped when the ring descriptor polls
+// readable through the message pump, so the rest of the thread keeps using
+// epoll. Receives take a buffer from a group provided to the ring only once
+// data arrives, so idle connections hold no buffer. Linux only.
+class NaiveUring : public base::MessagePumpForIO::FdWatcher {
+ public:
+  static constexpr int kBufferSize = 16 * 1024;
+  static constexpr int kBufferCount = 256;
+
+  // A request of the ring.
+  class Op {
+   public:
+    bool in_flight() const { return slot_ != 0; }
+
+    // `result` is that of the syscall, a negative errno on failure.
+    // `buffer_id` is the buffer a receive got, or -1.
+    virtual void OnComplete(int result, int buffer_id) = 0;
+    // The receive failed with -ENOBUFS and may be retried.
+    virtual void OnBufferAvailable() = 0;
+
+   protected:
+    ~Op() = default;
+
+   private:
+    friend class NaiveUring;
+
+    // The slot of the request in flight plus one, which is its user data,
+    // or 0.
+    uint32_t slot_ = 0;
+  };
+
+  NaiveUring(const NaiveUring&) = delete;
+  NaiveUring& operator=(const NaiveUring&) = delete;
+  ~NaiveUring() override;
+
+  // Returns the ring of the calling thread, setting it up on first use, or
+  // nullptr if io_uring with provided buffers is not available, e.g. before
+  // Linux 5.7 or when blocked by seccomp.
+  static NaiveUring* GetForCurrentThread();
+
+  // Receives from `fd` into a buffer from the group, which must be released
+  // after use. Each op may have one request at a time.
+  void Recv(int fd, Op* op);
+  // Waits for `events` on `fd`, for sockets the kernel returns -EAGAIN for
+  // instead of polling them itself.
+  void Poll(int fd, short events, Op* op);
+  // Sends `size` bytes of the buffer from `offset`.
+  void Send(int fd, int buffer_id, int offset, int size, Op* op);
+  // Cancels the request of `op`, which is not called any more. The buffer
+  // of a send is released once the kernel is done with it.
+  void Cancel(Op* op);
+  // Calls OnBufferAvailable() of `op` when a buffer was released.
+  void WaitForBuffer(Op* op);
+
+  char* buffer(int buffer_id) {
+    return buffers_.get() + buffer_id * kBufferSize;
+  }
+  // Provides the buffer to the ring again.
+  void ReleaseBuffer(int buffer_id);
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override {}
+
+ private:
+  // A request in flight.
+  struct Slot {
+    // Null once cancelled.
+    Op* op = nullptr;
+    // The buffer to release if the request was cancelled.
+    int buffer_id = -1;
+  };
+
+  NaiveUring();
+
+  bool Init();
+  // Returns a cleared submission queue entry, submitting the queue if full.
+  io_uring_sqe* GetSqe();
+  // Also takes a slot for `op`.
+  io_uring_sqe* GetSqeForOp(Op* op, int buffer_id);
+  void ProvideBuffers(int buffer_id, int count);
+  void ScheduleSubmit();
+  void Submit();
+  // Submits the queued entries, waiting for `min_complete` completions.
+  int Enter(unsigned min_complete, unsigned flags);
+  void Reap();
+  void Dispatch(const io_uring_cqe& cqe);
+
+  base::ScopedFD ring_fd_;
+  base::MessagePumpForIO::FdWatchController watcher_;
+  // Until then Init() submits itself.
+  bool watching_ = false;
+
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* sq_flags_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  // Of the entries queued, published on submit.
+  unsigned sq_local_tail_ = 0;
+  bool submit_pending_ = false;
+
+  std::unique_ptr<char[]> buffers_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  // Of ops whose receive found no buffer.
+  base::circular_deque<Op*> buffer_waiters_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_URING_H_
@@ -0,0 +1,154 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_uring_relay.h"
+
+#include <poll.h>
+
+#include <cerrno>
+#include <utility>
+
+#include "base/check.h"
+#include "base/notreached.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+namespace {
+Direction Other(Direction d) {
+  return d == kClient ? kServer : kClient;
+}
+}  // namespace
+
+NaiveUringRelay::Pump::Pump(NaiveUringRelay* relay, Direction from)
+    : relay(relay), from(from) {}
+
+NaiveUringRelay::Pump::~Pump() = default;
+
+void NaiveUringRelay::Pump::OnComplete(int result, int buffer_id) {
+  relay->OnComplete(*this, result, buffer_id);
+}
+
+void NaiveUringRelay::Pump::OnBufferAvailable() {
+  relay->Recv(*this);
+}
+
+NaiveUringRelay::NaiveUringRelay(NaiveUring* uring,
+                                 int client_fd,
+                                 int server_fd)
+    : uring_(uring),
+      fds_{client_fd, server_fd},
+      pumps_{Pump(this, kClient), Pump(this, kServer)} {}
+
+NaiveUringRelay::~NaiveUringRelay() {
+  if (callback_)
+    Stop();
+}
+
+int NaiveUringRelay::Run(CompletionOnceCallback callback) {
+  DCHECK(!callback_);
+  callback_ = std::move(callback);
+  Recv(pumps_[kClient]);
+  Recv(pumps_[kServer]);
+  return ERR_IO_PENDING;
+}
+
+void NaiveUringRelay::Recv(Pump& pump) {
+  pump.state = Pump::kRecv;
+  uring_->Recv(fds_[pump.from], &pump);
+}
+
+void NaiveUringRelay::Send(Pump& pump) {
+  pump.state = Pump::kSend;
+  uring_->Send(fds_[Other(pump.from)], pump.buffer_id, pump.offset,
+               pump.size - pump.offset, &pump);
+}
+
+void NaiveUringRelay::OnComplete(Pump& pump, int result, int buffer_id) {
+  switch (pump.state) {
+    case Pump::kRecv:
+      if (result == -ENOBUFS) {
+        // All buffers of the thread are in flight.
+        pump.state = Pump::kIdle;
+        uring_->WaitForBuffer(&pump);
+        return;
+      }
+      if (result == -EAGAIN) {
+        pump.state = Pump::kPollRecv;
+        uring_->Poll(fds_[pump.from], POLLIN, &pump);
+        return;
+      }
+      if (result == 0) {
+        Finish(ERR_CONNECTION_CLOSED);
+        return;
+      }
+      if (result < 0) {
+        Finish(MapSystemError(-result));
+        return;
+      }
+      DCHECK_GE(buffer_id, 0);
+      pump.buffer_id = buffer_id;
+      pump.offset = 0;
+      pump.size = result;
+      Send(pump);
+      return;
+    case Pump::kSend:
+      if (result == -EAGAIN) {
+        pump.state = Pump::kPollSend;
+        uring_->Poll(fds_[Other(pump.from)], POLLOUT, &pump);
+        return;
+      }
+      if (result < 0) {
+        Finish(MapSystemError(-result));
+        return;
+      }
+      bytes_relayed_[pump.from] += result;
+      pump.offset += result;
+      if (pump.offset < pump.size) {
+        Send(pump);
+        return;
+      }
+      uring_->ReleaseBuffer(pump.buffer_id);
+      pump.buffer_id = -1;
+      Recv(pump);
+      return;
+    case Pump::kPollRecv:
+    case Pump::kPollSend:
+      // Errors and hangups are reported by retrying.
+      if (result < 0) {
+        Finish(MapSystemError(-result));
+      } else if (pump.state == Pump::kPollRecv) {
+        Recv(pump);
+      } else {
+        Send(pump);
+      }
+      return;
+    case Pump::kIdle:
+      NOTREACHED();
+  }
+}
+
+void NaiveUringRelay::Stop() {
+  int buffer_ids[kNumDirections];
+  for (Pump& pump : pumps_) {
+    // The ring releases the buffer of a cancelled send once the kernel is
+    // done with it.
+    bool sending = pump.in_flight() && pump.state == Pump::kSend;
+    buffer_ids[pump.from] = sending ? -1 : pump.buffer_id;
+    uring_->Cancel(&pump);
+    pump.buffer_id = -1;
+    pump.state = Pump::kIdle;
+  }
+  // Only after cancelling both, as a released buffer resumes waiting pumps.
+  for (int buffer_id : buffer_ids) {
+    if (buffer_id >= 0)
+      uring_->ReleaseBuffer(buffer_id);
+  }
+}
+
+void NaiveUringRelay::Finish(int result) {
+  Stop();
+  std::move(callback_).Run(result);
+}
+
+}  // namespace net
@@ -0,0 +1,78 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_URING_RELAY_H_
+#define NET_TOOLS_NAIVE_NAIVE_URING_RELAY_H_
+
+#include <cstdint>
+
+#include "net/base/completion_once_callback.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "net/tools/naive/naive_uring.h"
+
+namespace net {
+
+// Relays between two connected TCP sockets like NaiveSpliceRelay, but with
+// receives and sends through the NaiveUring of the thread. The sends of all
+// connections ready in one event loop iteration go to the kernel in one
+// syscall, and a direction only holds a buffer while it has data in flight.
+// Linux only.
+class NaiveUringRelay {
+ public:
+  // Does not take ownership of the socket descriptors.
+  NaiveUringRelay(NaiveUring* uring, int client_fd, int server_fd);
+  ~NaiveUringRelay();
+  NaiveUringRelay(const NaiveUringRelay&) = delete;
+  NaiveUringRelay& operator=(const NaiveUringRelay&) = delete;
+
+  // Returns ERR_IO_PENDING and runs `callback` when either direction reaches
+  // EOF (ERR_CONNECTION_CLOSED) or fails.
+  int Run(CompletionOnceCallback callback);
+
+  int64_t bytes_relayed(Direction from) const { return bytes_relayed_[from]; }
+
+ private:
+  // One direction, receiving from its side and sending to the other.
+  class Pump : public NaiveUring::Op {
+   public:
+    enum State {
+      kIdle,
+      kRecv,
+      kPollRecv,
+      kSend,
+      kPollSend,
+    };
+
+    Pump(NaiveUringRelay* relay, Direction from);
+    ~Pump();
+
+    // NaiveUring::Op implementation.
+    void OnComplete(int result, int buffer_id) override;
+    void OnBufferAvailable() override;
+
+    NaiveUringRelay* const relay;
+    const Direction from;
+    State state = kIdle;
+    // Of the data received and not yet sent.
+    int buffer_id = -1;
+    int offset = 0;
+    int size = 0;
+  };
+
+  void Recv(Pump& pump);
+  void Send(Pump& pump);
+  void OnComplete(Pump& pump, int result, int buffer_id);
+  // Cancels the requests of the pumps.
+  void Stop();
+  void Finish(int result);
+
+  NaiveUring* const uring_;
+  int fds_[kNumDirections];
+  Pump pumps_[kNumDirections];
+  int64_t bytes_relayed_[kNumDirections] = {0, 0};
+
+  CompletionOnceCallback callback_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_URING_RELAY_H_
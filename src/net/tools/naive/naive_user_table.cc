@@ -0,0 +1,107 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_user_table.h"
+
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "net/tools/naive/naive_thread_local.h"
+#include "net/tools/naive/naive_wakeup.h"
+
+namespace net {
+
+namespace {
+constexpr uint64_t kBytesPerMegabyte = 1024 * 1024;
+
+std::vector<scoped_refptr<NaiveUserTable::User>> CreateUsers(
+    const std::vector<NaiveUserConfig>& configs) {
+  std::vector<scoped_refptr<NaiveUserTable::User>> users;
+  for (const NaiveUserConfig& config : configs) {
+    users.push_back(base::MakeRefCounted<NaiveUserTable::User>(config));
+  }
+  return users;
+}
+}  // namespace
+
+NaiveUserTable::User::User(const NaiveUserConfig& config) : config_(config) {}
+
+NaiveUserTable::User::~User() = default;
+
+void NaiveUserTable::User::AddBytesRelayed(const uint64_t* bytes) {
+  uint64_t total = 0;
+  for (int i = 0; i < kNumDirections; ++i) {
+    total += bytes_relayed_[i].fetch_add(bytes[i], std::memory_order_relaxed) +
+             bytes[i];
+  }
+  // Racing flushes of other threads may see a slightly smaller total, which
+  // only delays the quota to their next flush.
+  if (config_.soft_quota > 0 &&
+      total >= config_.soft_quota * kBytesPerMegabyte &&
+      !over_soft_quota_.exchange(true, std::memory_order_relaxed)) {
+    LOG(WARNING) << "User " << config_.name << " is over the soft quota";
+  }
+  if (config_.hard_quota > 0 &&
+      total >= config_.hard_quota * kBytesPerMegabyte &&
+      !over_hard_quota_.exchange(true, std::memory_order_relaxed)) {
+    LOG(WARNING) << "User " << config_.name << " is over the hard quota";
+  }
+}
+
+NaiveUserTable::NaiveUserTable(const std::vector<NaiveUserConfig>& users)
+    : users_(CreateUsers(users)) {
+  users_by_name_.reserve(users_.size());
+  for (const scoped_refptr<User>& user : users_) {
+    users_by_name_.emplace(user->name(), user.get());
+  }
+}
+
+NaiveUserTable::~NaiveUserTable() = default;
+
+NaiveUserTable::User* NaiveUserTable::Authenticate(
+    std::string_view name,
+    std::string_view pass) const {
+  auto it = users_by_name_.find(name);
+  if (it == users_by_name_.end() || it->second->config_.pass != pass)
+    return nullptr;
+  return it->second;
+}
+
+NaiveUserMeter::Counters::Counters() = default;
+
+NaiveUserMeter::Counters::~Counters() = default;
+
+NaiveUserMeter::NaiveUserMeter() = default;
+
+NaiveUserMeter::~NaiveUserMeter() = default;
+
+// static
+NaiveUserMeter* NaiveUserMeter::GetForCurrentThread() {
+  return GetOrCreateForCurrentThread<NaiveUserMeter>();
+}
+
+uint64_t* NaiveUserMeter::GetCounters(NaiveUserTable::User* user) {
+  auto [it, inserted] = counters_.try_emplace(user);
+  if (inserted) {
+    it->second.user = user;
+  }
+  if (!flush_timer_.IsRunning()) {
+    // Unretained is safe because the timer is owned by this.
+    flush_timer_.Start(
+        FROM_HERE, AlignToWakeupPeriod(kFlushInterval),
+        base::BindRepeating(&NaiveUserMeter::Flush, base::Unretained(this)));
+  }
+  return it->second.bytes_relayed;
+}
+
+void NaiveUserMeter::Flush() {
+  for (auto& [user, counters] : counters_) {
+    if (!counters.bytes_relayed[kClient] && !counters.bytes_relayed[kServer])
+      continue;
+    counters.user->AddBytesRelayed(counters.bytes_relayed);
+    for (uint64_t& bytes : counters.bytes_relayed) {
+      bytes = 0;
+    }
+  }
+}
+
+}  // namespace net
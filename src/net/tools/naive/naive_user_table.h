@@ -0,0 +1,122 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_USER_TABLE_H_
+#define NET_TOOLS_NAIVE_NAIVE_USER_TABLE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/timer/timer.h"
+#include "net/tools/naive/naive_config.h"
+#include "net/tools/naive/naive_protocol.h"
+#include "third_party/abseil-cpp/absl/container/flat_hash_map.h"
+
+namespace net {
+
+// The users of NaiveConfig::users, shared by all IO threads. Their byte
+// counters are atomics the IO threads add to through NaiveUserMeter, and
+// the metrics server reads without a lock.
+class NaiveUserTable : public base::RefCountedThreadSafe<NaiveUserTable> {
+ public:
+  class User : public base::RefCountedThreadSafe<User> {
+   public:
+    explicit User(const NaiveUserConfig& config);
+    User(const User&) = delete;
+    User& operator=(const User&) = delete;
+
+    const std::string& name() const { return config_.name; }
+    bool has_hard_quota() const { return config_.hard_quota > 0; }
+    uint64_t bytes_relayed(Direction from) const {
+      return bytes_relayed_[from].load(std::memory_order_relaxed);
+    }
+    // Set once the flushed bytes reach the quota.
+    bool over_soft_quota() const {
+      return over_soft_quota_.load(std::memory_order_relaxed);
+    }
+    bool over_hard_quota() const {
+      return over_hard_quota_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    friend class base::RefCountedThreadSafe<User>;
+    friend class NaiveUserTable;
+    friend class NaiveUserMeter;
+
+    ~User();
+
+    void AddBytesRelayed(const uint64_t* bytes);
+
+    const NaiveUserConfig config_;
+    std::atomic<uint64_t> bytes_relayed_[kNumDirections] = {};
+    std::atomic<bool> over_soft_quota_ = false;
+    std::atomic<bool> over_hard_quota_ = false;
+  };
+
+  explicit NaiveUserTable(const std::vector<NaiveUserConfig>& users);
+  NaiveUserTable(const NaiveUserTable&) = delete;
+  NaiveUserTable& operator=(const NaiveUserTable&) = delete;
+
+  // Returns nullptr if no user has these credentials.
+  User* Authenticate(std::string_view name, std::string_view pass) const;
+
+  // In the order of NaiveConfig::users.
+  const std::vector<scoped_refptr<User>>& users() const { return users_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<NaiveUserTable>;
+
+  ~NaiveUserTable();
+
+  const std::vector<scoped_refptr<User>> users_;
+  // Keyed by the names the users own.
+  absl::flat_hash_map<std::string_view, User*> users_by_name_;
+};
+
+// Counts the bytes relayed for the users on one IO thread with plain adds,
+// and flushes them to the shared counters of the users every
+// kFlushInterval, so the relay does not touch shared cache lines for each
+// write. A user's quota is thus enforced up to one interval late, which is
+// the wakeup period in mobile mode, see AlignToWakeupPeriod().
+class NaiveUserMeter {
+ public:
+  static constexpr base::TimeDelta kFlushInterval = base::Seconds(1);
+
+  NaiveUserMeter();
+  NaiveUserMeter(const NaiveUserMeter&) = delete;
+  NaiveUserMeter& operator=(const NaiveUserMeter&) = delete;
+  ~NaiveUserMeter();
+
+  // Returns the meter of the calling thread, creating it on first use.
+  static NaiveUserMeter* GetForCurrentThread();
+
+  // Returns the counters of `user` on this thread, indexed by the side the
+  // bytes were read from. They stay valid as long as the thread.
+  uint64_t* GetCounters(NaiveUserTable::User* user);
+
+ private:
+  struct Counters {
+    Counters();
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+    ~Counters();
+
+    scoped_refptr<NaiveUserTable::User> user;
+    uint64_t bytes_relayed[kNumDirections] = {};
+  };
+
+  void Flush();
+
+  // Keyed by the user, whose nodes keep the counters in place.
+  std::map<const NaiveUserTable::User*, Counters> counters_;
+  base::MetronomeTimer flush_timer_;
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_USER_TABLE_H_
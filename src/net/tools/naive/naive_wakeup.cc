@@ -0,0 +1,28 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/naive_wakeup.h"
+
+namespace net {
+namespace {
+
+// Written once before the IO threads start, which only read it.
+base::TimeDelta g_wakeup_period;
+
+}  // namespace
+
+void SetWakeupPeriod(base::TimeDelta period) {
+  g_wakeup_period = period;
+}
+
+base::TimeDelta GetWakeupPeriod() {
+  return g_wakeup_period;
+}
+
+base::TimeDelta AlignToWakeupPeriod(base::TimeDelta interval) {
+  if (!g_wakeup_period.is_positive())
+    return interval;
+  return interval.CeilToMultiple(g_wakeup_period);
+}
+
+}  // namespace net
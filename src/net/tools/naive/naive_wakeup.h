@@ -0,0 +1,23 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_NAIVE_WAKEUP_H_
+#define NET_TOOLS_NAIVE_NAIVE_WAKEUP_H_
+
+#include "base/time/time.h"
+
+namespace net {
+
+// Sets the period the periodic work of all threads is coalesced to, see
+// NaiveConfig::wakeup_period. Called before the IO threads start. Zero, the
+// default, leaves every interval as is.
+void SetWakeupPeriod(base::TimeDelta period);
+base::TimeDelta GetWakeupPeriod();
+
+// Returns `interval` rounded up to a multiple of the wakeup period. A
+// base::MetronomeTimer ticks on multiples of its interval since the
+// TimeTicks origin, so the timers started with these wake together.
+base::TimeDelta AlignToWakeupPeriod(base::TimeDelta interval);
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_NAIVE_WAKEUP_H_
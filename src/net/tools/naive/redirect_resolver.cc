@@ -4,12 +4,25 @@
 
 #include "net/tools/naive/redirect_resolver.h"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
-#include <iterator>
+#include <functional>
+#include <optional>
 #include <utility>
 
+#include "base/barrier_closure.h"
+#include "base/files/file_util.h"
+#include "base/functional/bind.h"
+#include "base/functional/callback_helpers.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/location.h"
 #include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/task/single_thread_task_runner.h"
+#include "base/task/thread_pool.h"
+#include "base/values.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/url_util.h"
@@ -18,15 +31,45 @@
 #include "net/dns/dns_response.h"
 #include "net/dns/dns_util.h"
 #include "net/socket/datagram_server_socket.h"
+#include "net/tools/naive/naive_wakeup.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include <sys/socket.h>
+
+#include <cerrno>
+
+#include "base/files/scoped_file.h"
+#include "base/message_loop/message_pump_for_io.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task/current_thread.h"
+#include "net/base/sockaddr_storage.h"
+#include "net/tools/naive/naive_doh_client.h"
+#endif
+
 namespace {
 constexpr int kUdpReadBufferSize = 1024;
+// Queries taken per wakeup in batched mode.
+constexpr int kBatchSize = 32;
 constexpr int kResolutionTtl = 60;
 constexpr int kResolutionRecycleTime = 60 * 5;
-
-std::string PackedIPv4ToString(uint32_t addr) {
-  return net::IPAddress(addr >> 24, addr >> 16, addr >> 8, addr).ToString();
+// Marks an empty name table slot and the ends of the LRU list.
+constexpr uint32_t kNoResolution = ~0U;
+// Marks a name table slot whose resolution was dropped.
+constexpr uint32_t kTombstone = ~0U - 1;
+constexpr size_t kInitialNameTableSize = 64;
+// Not in dns_protocol.h yet.
+constexpr uint16_t kTypeSvcb = 64;
+// Expired resolutions are collected by a sweep this often, dropping at most
+// kMaxDropsPerSweep at a time so DNS queries are not held up behind it.
+constexpr base::TimeDelta kSweepInterval = base::Seconds(10);
+constexpr int kMaxDropsPerSweep = 256;
+// Published names per chunk, see RedirectResolver::PublishedChunk.
+constexpr size_t kPublishedChunkSize = 4096;
+
+uint32_t ToPackedIPv4(const net::IPAddress& address) {
+  return (address.bytes()[0] << 24) | (address.bytes()[1] << 16) |
+         (address.bytes()[2] << 8) | address.bytes()[3];
 }
 }  // namespace
 
@@ -36,14 +79,131 @@ Resolution::Resolution() = default;
 
 Resolution::~Resolution() = default;
 
+struct RedirectResolver::PublishedChunk {
+  std::atomic<const std::string*> names[kPublishedChunkSize] = {};
+};
+
+#if BUILDFLAG(IS_LINUX)
+// Serves the queries on a nonblocking UDP socket. Each wakeup takes up to
+// kBatchSize queries with one recvmmsg(2) into a ring of buffers, and the
+// replies written over them go out with one sendmmsg(2). Queries left in the
+// socket wake it up again.
+class RedirectResolver::BatchReader
+    : public base::MessagePumpForIO::FdWatcher {
+ public:
+  BatchReader(RedirectResolver* resolver, base::ScopedFD socket)
+      : resolver_(resolver), socket_(std::move(socket)), watcher_(FROM_HERE) {
+    for (auto& buffer : buffers_) {
+      buffer = base::MakeRefCounted<IOBufferWithSize>(kUdpReadBufferSize);
+    }
+  }
+  ~BatchReader() override = default;
+  BatchReader(const BatchReader&) = delete;
+  BatchReader& operator=(const BatchReader&) = delete;
+
+  bool Watch() {
+    return base::CurrentIOThread::Get()->WatchFileDescriptor(
+        socket_.get(), /*persistent=*/true, base::MessagePumpForIO::WATCH_READ,
+        &watcher_, this);
+  }
+
+  void StopWatching() { watcher_.StopWatchingFileDescriptor(); }
+
+  int socket_descriptor() const { return socket_.get(); }
+
+  // base::MessagePumpForIO::FdWatcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override {
+    struct sockaddr_storage addresses[kBatchSize];
+    struct iovec iovs[kBatchSize];
+    struct mmsghdr recv_msgs[kBatchSize];
+    struct mmsghdr send_msgs[kBatchSize];
+    for (int i = 0; i < kBatchSize; ++i) {
+      iovs[i] = {.iov_base = buffers_[i]->data(),
+                 .iov_len = kUdpReadBufferSize};
+      recv_msgs[i] = {};
+      recv_msgs[i].msg_hdr.msg_name = &addresses[i];
+      recv_msgs[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+      recv_msgs[i].msg_hdr.msg_iov = &iovs[i];
+      recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int count = HANDLE_EINTR(
+        recvmmsg(fd, recv_msgs, kBatchSize, MSG_DONTWAIT, nullptr));
+    if (count < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG(INFO) << "DoRead: ignoring error "
+                  << ErrorToShortString(MapSystemError(errno));
+      }
+      return;
+    }
+
+    int replies = 0;
+    for (int i = 0; i < count; ++i) {
+      const struct msghdr& msg = recv_msgs[i].msg_hdr;
+      IPEndPoint from;
+      if ((msg.msg_flags & MSG_TRUNC) ||
+          !from.FromSockAddr(reinterpret_cast<struct sockaddr*>(msg.msg_name),
+                             msg.msg_namelen)) {
+        continue;
+      }
+      int size =
+          resolver_->HandleQuery(buffers_[i].get(), recv_msgs[i].msg_len, from);
+      if (size == ERR_IO_PENDING)
+        continue;
+      if (size < 0) {
+        LOG(INFO) << "DoRead: ignoring error " << ErrorToShortString(size);
+        continue;
+      }
+      iovs[i].iov_len = size;
+      send_msgs[replies] = {};
+      send_msgs[replies].msg_hdr.msg_name = msg.msg_name;
+      send_msgs[replies].msg_hdr.msg_namelen = msg.msg_namelen;
+      send_msgs[replies].msg_hdr.msg_iov = &iovs[i];
+      send_msgs[replies].msg_hdr.msg_iovlen = 1;
+      ++replies;
+    }
+
+    for (int sent = 0; sent < replies;) {
+      int rv = HANDLE_EINTR(
+          sendmmsg(fd, send_msgs + sent, replies - sent, MSG_DONTWAIT));
+      if (rv < 0) {
+        // Like UDP loss, the client retries the rest.
+        LOG(INFO) << "OnSend: ignoring error "
+                  << ErrorToShortString(MapSystemError(errno));
+        break;
+      }
+      sent += rv;
+    }
+  }
+  void OnFileCanWriteWithoutBlocking(int fd) override {}
+
+  // Sends a reply outside of a batch.
+  void SendTo(std::string_view reply, const IPEndPoint& to) {
+    SockaddrStorage storage;
+    if (!to.ToSockAddr(storage.addr, &storage.addr_len))
+      return;
+    if (HANDLE_EINTR(sendto(socket_.get(), reply.data(), reply.size(),
+                            MSG_DONTWAIT, storage.addr, storage.addr_len)) <
+        0) {
+      LOG(INFO) << "OnSend: ignoring error "
+                << ErrorToShortString(MapSystemError(errno));
+    }
+  }
+
+ private:
+  RedirectResolver* resolver_;
+  base::ScopedFD socket_;
+  base::MessagePumpForIO::FdWatchController watcher_;
+  scoped_refptr<IOBufferWithSize> buffers_[kBatchSize];
+};
+#endif  // BUILDFLAG(IS_LINUX)
+
 RedirectResolver::RedirectResolver(std::unique_ptr<DatagramServerSocket> socket,
                                    const IPAddress& range,
-                                   size_t prefix)
-    : socket_(std::move(socket)),
-      range_(range),
-      prefix_(prefix),
-      offset_(0),
-      buffer_(base::MakeRefCounted<IOBufferWithSize>(kUdpReadBufferSize)) {
+                                   size_t prefix,
+                                   const IPAddress& range6,
+                                   size_t prefix6)
+    : RedirectResolver(range, prefix, range6, prefix6) {
+  socket_ = std::move(socket);
   DCHECK(socket_);
   // Start accepting connections in next run loop in case when delegate is not
   // ready to get callbacks.
@@ -52,7 +212,146 @@ RedirectResolver::RedirectResolver(std::unique_ptr<DatagramServerSocket> socket,
                                 weak_ptr_factory_.GetWeakPtr()));
 }
 
-RedirectResolver::~RedirectResolver() = default;
+RedirectResolver::RedirectResolver(const IPAddress& range,
+                                   size_t prefix,
+                                   const IPAddress& range6,
+                                   size_t prefix6)
+    : range_(range),
+      prefix_(prefix),
+      prefix6_(prefix6),
+      offset_(0),
+      buffer_(base::MakeRefCounted<IOBufferWithSize>(kUdpReadBufferSize)),
+      name_table_(kInitialNameTableSize, kNoResolution),
+      name_count_(0),
+      name_tombstones_(0),
+      lru_oldest_(kNoResolution),
+      lru_newest_(kNoResolution),
+      published_chunk_count_(
+          ((uint64_t{1} << (32 - prefix)) + kPublishedChunkSize - 1) /
+          kPublishedChunkSize),
+      in_grace_period_(false),
+      overwrite_count_(0),
+      drop_count_(0),
+      cache_dirty_(false) {
+  published_chunks_ =
+      std::make_unique<std::atomic<PublishedChunk*>[]>(published_chunk_count_);
+  if (range6.IsIPv6()) {
+    DCHECK_LE(prefix6_, 96u);
+    // Clears the host bits, which carry the offset of the resolution.
+    std::array<uint8_t, IPAddress::kIPv6AddressSize> bytes;
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      size_t bits =
+          i * 8 < prefix6_ ? std::min<size_t>(prefix6_ - i * 8, 8) : 0;
+      bytes[i] = range6.bytes()[i] & static_cast<uint8_t>(0xff00 >> bits);
+    }
+    range6_ = IPAddress(bytes);
+  }
+  sweep_timer_.Start(
+      FROM_HERE, AlignToWakeupPeriod(kSweepInterval),
+      base::BindRepeating(&RedirectResolver::OnSweepTimer,
+                          base::Unretained(this)));
+}
+
+RedirectResolver::~RedirectResolver() {
+  if (cache_dirty_) {
+    SaveCache();
+  }
+  // The readers are gone by now.
+  for (size_t i = 0; i < published_chunk_count_; ++i) {
+    std::unique_ptr<PublishedChunk> chunk(
+        published_chunks_[i].load(std::memory_order_relaxed));
+    if (!chunk)
+      continue;
+    for (const auto& name : chunk->names) {
+      delete name.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void RedirectResolver::AddReader(
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner) {
+  readers_.push_back(std::move(task_runner));
+}
+
+void RedirectResolver::UseCacheFile(const base::FilePath& cache_file) {
+  DCHECK_EQ(name_count_, 0u);
+  cache_file_ = cache_file;
+  cache_task_runner_ = base::ThreadPool::CreateSequencedTaskRunner(
+      {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+       base::TaskShutdownBehavior::BLOCK_SHUTDOWN});
+  cache_writer_ = std::make_unique<base::ImportantFileWriter>(
+      cache_file_, cache_task_runner_);
+  LoadCache();
+  cache_dirty_ = false;
+}
+
+void RedirectResolver::FlushCache(base::OnceClosure callback) {
+  if (!cache_task_runner_) {
+    std::move(callback).Run();
+    return;
+  }
+  cache_task_runner_->PostTask(FROM_HERE, std::move(callback));
+}
+
+#if BUILDFLAG(IS_LINUX)
+int RedirectResolver::Listen(const IPEndPoint& address) {
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+  base::ScopedFD fd(socket(storage.addr->sa_family,
+                           SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (!fd.is_valid())
+    return MapSystemError(errno);
+  int on = 1;
+  if (setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0)
+    return MapSystemError(errno);
+  if (bind(fd.get(), storage.addr, storage.addr_len) != 0)
+    return MapSystemError(errno);
+  return Listen(std::move(fd));
+}
+
+int RedirectResolver::Listen(base::ScopedFD socket) {
+  DCHECK(!batch_reader_);
+  batch_reader_ = std::make_unique<BatchReader>(this, std::move(socket));
+  if (!batch_reader_->Watch()) {
+    batch_reader_.reset();
+    return ERR_UNEXPECTED;
+  }
+  return OK;
+}
+
+int RedirectResolver::socket_descriptor() const {
+  return batch_reader_ ? batch_reader_->socket_descriptor() : -1;
+}
+
+void RedirectResolver::PauseForHandoff() {
+  if (batch_reader_)
+    batch_reader_->StopWatching();
+  if (cache_dirty_) {
+    SaveCache();
+  }
+}
+
+void RedirectResolver::ResumeAfterHandoff(bool handed_off) {
+  if (handed_off) {
+    cache_file_.clear();
+    return;
+  }
+  if (batch_reader_ && !batch_reader_->Watch()) {
+    LOG(ERROR) << "Failed to resume resolver";
+  }
+}
+
+void RedirectResolver::set_doh_client(
+    std::unique_ptr<NaiveDohClient> doh_client) {
+  doh_client_ = std::move(doh_client);
+}
+
+void RedirectResolver::OnDohReply(const IPEndPoint& to, std::string reply) {
+  DCHECK(batch_reader_);
+  batch_reader_->SendTo(reply, to);
+}
+#endif
 
 void RedirectResolver::DoRead() {
   for (;;) {
@@ -94,9 +393,21 @@ int RedirectResolver::HandleReadResult(int result) {
   if (result < 0)
     return result;
 
-  DnsQuery query(buffer_.get());
-  if (!query.Parse(result)) {
-    LOG(INFO) << "Malformed DNS query from " << recv_address_.ToString();
+  int size = HandleQuery(buffer_.get(), result, recv_address_);
+  if (size < 0)
+    return size;
+
+  return socket_->SendTo(
+      buffer_.get(), size, recv_address_,
+      base::BindOnce(&RedirectResolver::OnSend, base::Unretained(this)));
+}
+
+int RedirectResolver::HandleQuery(IOBufferWithSize* buffer,
+                                  int size,
+                                  const IPEndPoint& from) {
+  DnsQuery query(buffer);
+  if (!query.Parse(size)) {
+    LOG(INFO) << "Malformed DNS query from " << from.ToString();
     return ERR_INVALID_ARGUMENT;
   }
 
@@ -109,135 +420,401 @@ int RedirectResolver::HandleReadResult(int result) {
         DnsResponse(query.id(), /*is_authoritative=*/false, /*answers=*/{},
                     /*authority_records=*/{}, /*additional_records=*/{},
                     query_opt, dns_protocol::kRcodeFORMERR);
-  } else if (query.qtype() != dns_protocol::kTypeA) {
-    response =
-        DnsResponse(query.id(), /*is_authoritative=*/false, /*answers=*/{},
-                    /*authority_records=*/{}, /*additional_records=*/{},
-                    query_opt, dns_protocol::kRcodeNOTIMP);
-  } else {
-    Resolution res;
-
+  } else if (query.qtype() == dns_protocol::kTypeA ||
+             (query.qtype() == dns_protocol::kTypeAAAA && range6_.IsValid())) {
     const auto& name = name_or.value();
-
-    auto by_name_lookup = resolution_by_name_.emplace(name, resolutions_.end());
-    auto by_name = by_name_lookup.first;
-    bool has_name = !by_name_lookup.second;
-    if (has_name) {
-      auto res_it = by_name->second;
-      auto by_addr = res_it->by_addr;
-      uint32_t addr = res_it->addr;
-
-      resolutions_.erase(res_it);
-      resolutions_.emplace_back();
-      res_it = std::prev(resolutions_.end());
-
-      by_name->second = res_it;
-      by_addr->second = res_it;
-      res_it->addr = addr;
-      res_it->name = name;
-      res_it->time = base::TimeTicks::Now();
-      res_it->by_name = by_name;
-      res_it->by_addr = by_addr;
-    } else {
-      uint32_t addr = (range_.bytes()[0] << 24) | (range_.bytes()[1] << 16) |
-                      (range_.bytes()[2] << 8) | range_.bytes()[3];
-      uint32_t subnet = ~0U >> prefix_;
-      addr &= ~subnet;
-      addr += offset_;
-      offset_ = (offset_ + 1) & subnet;
-
-      auto by_addr_lookup =
-          resolution_by_addr_.emplace(addr, resolutions_.end());
-      auto by_addr = by_addr_lookup.first;
-      bool has_addr = !by_addr_lookup.second;
-      if (has_addr) {
-        // Too few available addresses. Overwrites old one.
-        auto res_it = by_addr->second;
-
-        LOG(INFO) << "Overwrite " << res_it->name << " "
-                  << PackedIPv4ToString(res_it->addr) << " with " << name << " "
-                  << PackedIPv4ToString(addr);
-        resolution_by_name_.erase(res_it->by_name);
-        resolutions_.erase(res_it);
-        resolutions_.emplace_back();
-        res_it = std::prev(resolutions_.end());
-
-        by_name->second = res_it;
-        by_addr->second = res_it;
-        res_it->addr = addr;
-        res_it->name = name;
-        res_it->time = base::TimeTicks::Now();
-        res_it->by_name = by_name;
-        res_it->by_addr = by_addr;
-      } else {
-        LOG(INFO) << "Add " << name << " " << PackedIPv4ToString(addr);
-        resolutions_.emplace_back();
-        auto res_it = std::prev(resolutions_.end());
-
-        by_name->second = res_it;
-        by_addr->second = res_it;
-        res_it->addr = addr;
-        res_it->name = name;
-        res_it->time = base::TimeTicks::Now();
-        res_it->by_name = by_name;
-        res_it->by_addr = by_addr;
-
-        // Collects garbage.
-        auto now = base::TimeTicks::Now();
-        for (auto it = resolutions_.begin();
-             it != resolutions_.end() &&
-             (now - it->time).InSeconds() > kResolutionRecycleTime;) {
-          auto next = std::next(it);
-          LOG(INFO) << "Drop " << it->name << " "
-                    << PackedIPv4ToString(it->addr);
-          resolution_by_name_.erase(it->by_name);
-          resolution_by_addr_.erase(it->by_addr);
-          resolutions_.erase(it);
-          it = next;
-        }
-      }
-    }
+    uint32_t index = Resolve(name);
 
     DnsResourceRecord record;
     record.name = name;
-    record.type = dns_protocol::kTypeA;
+    record.type = query.qtype();
     record.klass = dns_protocol::kClassIN;
     record.ttl = kResolutionTtl;
-    uint32_t addr = by_name->second->addr;
     record.SetOwnedRdata(IPAddressToPackedString(
-        IPAddress(addr >> 24, addr >> 16, addr >> 8, addr)));
+        query.qtype() == dns_protocol::kTypeA ? GetIPv4Address(index)
+                                              : GetIPv6Address(index)));
     response = DnsResponse(query.id(), /*is_authoritative=*/false,
                            /*answers=*/{std::move(record)},
                            /*authority_records=*/{}, /*additional_records=*/{},
                            query_opt);
+  } else if (query.qtype() == dns_protocol::kTypeAAAA ||
+             query.qtype() == dns_protocol::kTypeHttps ||
+             query.qtype() == kTypeSvcb) {
+    // No data, so clients go on with the A answer without waiting.
+    response =
+        DnsResponse(query.id(), /*is_authoritative=*/false, /*answers=*/{},
+                    /*authority_records=*/{}, /*additional_records=*/{},
+                    query_opt);
+#if BUILDFLAG(IS_LINUX)
+  } else if (doh_client_) {
+    std::string reply;
+    int rv = doh_client_->Resolve(
+        query, &reply,
+        base::BindOnce(&RedirectResolver::OnDohReply,
+                       weak_ptr_factory_.GetWeakPtr(), from));
+    if (rv == ERR_IO_PENDING)
+      return rv;
+    if (reply.size() > static_cast<size_t>(buffer->size())) {
+      OnDohReply(from, std::move(reply));
+      return ERR_IO_PENDING;
+    }
+    std::memcpy(buffer->data(), reply.data(), reply.size());
+    return reply.size();
+#endif
+  } else {
+    response =
+        DnsResponse(query.id(), /*is_authoritative=*/false, /*answers=*/{},
+                    /*authority_records=*/{}, /*additional_records=*/{},
+                    query_opt, dns_protocol::kRcodeNOTIMP);
   }
-  int size = response.io_buffer_size();
-  if (size > buffer_->size() || !response.io_buffer()) {
+  int response_size = response.io_buffer_size();
+  if (response_size > buffer->size() || !response.io_buffer()) {
     return ERR_NO_BUFFER_SPACE;
   }
-  std::memcpy(buffer_->data(), response.io_buffer()->data(), size);
+  std::memcpy(buffer->data(), response.io_buffer()->data(), response_size);
+  return response_size;
+}
 
-  return socket_->SendTo(
-      buffer_.get(), size, recv_address_,
-      base::BindOnce(&RedirectResolver::OnSend, base::Unretained(this)));
+uint32_t RedirectResolver::Resolve(const std::string& name) {
+  size_t hash = std::hash<std::string_view>()(name);
+  uint32_t index = FindName(name, hash);
+  auto now = base::TimeTicks::Now();
+  if (index != kNoResolution) {
+    Unlink(index);
+    LinkNewest(index);
+    resolutions_[index].time = now;
+    return index;
+  }
+
+  index = offset_;
+  offset_ = (offset_ + 1) & (~0U >> prefix_);
+  if (index >= resolutions_.size()) {
+    resolutions_.resize(index + 1);
+  }
+
+  if (resolutions_[index].in_use) {
+    // Too few available addresses. Overwrites old one.
+    LOG(INFO) << "Overwrite " << resolutions_[index].name << " "
+              << GetIPv4Address(index).ToString() << " with " << name;
+    Drop(index);
+    ++overwrite_count_;
+  } else {
+    LOG(INFO) << "Add " << name << " " << GetIPv4Address(index).ToString();
+  }
+  Resolution& res = resolutions_[index];
+  res.in_use = true;
+  res.name = name;
+  res.hash = hash;
+  res.time = now;
+  InsertName(index);
+  LinkNewest(index);
+  Publish(index, std::make_unique<std::string>(name));
+  cache_dirty_ = true;
+  if (new_name_callback_) {
+    new_name_callback_.Run(name);
+  }
+  return index;
+}
+
+IPAddress RedirectResolver::GetIPv4Address(uint32_t index) const {
+  uint32_t addr = (ToPackedIPv4(range_) & ~(~0U >> prefix_)) + index;
+  return IPAddress(addr >> 24, addr >> 16, addr >> 8, addr);
+}
+
+IPAddress RedirectResolver::GetIPv6Address(uint32_t index) const {
+  std::array<uint8_t, IPAddress::kIPv6AddressSize> bytes;
+  std::copy(range6_.bytes().begin(), range6_.bytes().end(), bytes.begin());
+  bytes[12] = index >> 24;
+  bytes[13] = index >> 16;
+  bytes[14] = index >> 8;
+  bytes[15] = index;
+  return IPAddress(bytes);
 }
 
 bool RedirectResolver::IsInResolvedRange(const IPAddress& address) const {
-  if (!address.IsIPv4())
-    return false;
-  return IPAddressMatchesPrefix(address, range_, prefix_);
+  if (address.IsIPv4())
+    return IPAddressMatchesPrefix(address, range_, prefix_);
+  if (address.IsIPv6() && range6_.IsValid())
+    return IPAddressMatchesPrefix(address, range6_, prefix6_);
+  return false;
 }
 
 std::string RedirectResolver::FindNameByAddress(
     const IPAddress& address) const {
-  if (!address.IsIPv4())
+  if (!IsInResolvedRange(address))
     return {};
-  uint32_t addr = (address.bytes()[0] << 24) | (address.bytes()[1] << 16) |
-                  (address.bytes()[2] << 8) | address.bytes()[3];
-  auto by_addr = resolution_by_addr_.find(addr);
-  if (by_addr == resolution_by_addr_.end())
+  const auto bytes = address.bytes();
+  uint32_t index = (bytes[bytes.size() - 4] << 24) |
+                   (bytes[bytes.size() - 3] << 16) |
+                   (bytes[bytes.size() - 2] << 8) | bytes[bytes.size() - 1];
+  if (address.IsIPv4())
+    index &= ~0U >> prefix_;
+  if (index > (~0U >> prefix_))
     return {};
-  return by_addr->second->name;
+  if (address.IsIPv6() && address != GetIPv6Address(index))
+    return {};
+  // Pairs with the release stores of Publish().
+  const PublishedChunk* chunk = published_chunks_[index / kPublishedChunkSize]
+                                    .load(std::memory_order_acquire);
+  if (!chunk)
+    return {};
+  const std::string* name =
+      chunk->names[index % kPublishedChunkSize].load(std::memory_order_acquire);
+  // Not freed before this task ends, see StartGracePeriod().
+  return name ? *name : std::string();
+}
+
+void RedirectResolver::OnSweepTimer() {
+  if (cache_dirty_) {
+    SaveCache();
+  }
+  Sweep();
+  StartGracePeriod();
+}
+
+void RedirectResolver::Sweep() {
+  auto now = base::TimeTicks::Now();
+  for (int i = 0; i < kMaxDropsPerSweep; ++i) {
+    if (lru_oldest_ == kNoResolution ||
+        (now - resolutions_[lru_oldest_].time).InSeconds() <=
+            kResolutionRecycleTime) {
+      return;
+    }
+    LOG(INFO) << "Drop " << resolutions_[lru_oldest_].name << " "
+              << GetIPv4Address(lru_oldest_).ToString();
+    Drop(lru_oldest_);
+    ++drop_count_;
+  }
+  // More may have expired. Continues after pending queries are served.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&RedirectResolver::Sweep, weak_ptr_factory_.GetWeakPtr()));
+}
+
+uint32_t RedirectResolver::FindName(std::string_view name, size_t hash) const {
+  size_t mask = name_table_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    uint32_t index = name_table_[i];
+    if (index == kNoResolution)
+      return kNoResolution;
+    if (index != kTombstone && resolutions_[index].hash == hash &&
+        resolutions_[index].name == name) {
+      return index;
+    }
+  }
+}
+
+void RedirectResolver::InsertName(uint32_t index) {
+  // Keeps at least a quarter of the slots empty so probes terminate.
+  if ((name_count_ + name_tombstones_ + 1) * 4 > name_table_.size() * 3) {
+    size_t size = name_table_.size();
+    while ((name_count_ + 1) * 2 > size)
+      size *= 2;
+    ResizeNameTable(size);
+  }
+  size_t mask = name_table_.size() - 1;
+  size_t i = resolutions_[index].hash & mask;
+  while (name_table_[i] != kNoResolution && name_table_[i] != kTombstone)
+    i = (i + 1) & mask;
+  if (name_table_[i] == kTombstone)
+    --name_tombstones_;
+  name_table_[i] = index;
+  ++name_count_;
+}
+
+void RedirectResolver::EraseName(uint32_t index) {
+  size_t mask = name_table_.size() - 1;
+  size_t i = resolutions_[index].hash & mask;
+  while (name_table_[i] != index) {
+    DCHECK_NE(name_table_[i], kNoResolution);
+    i = (i + 1) & mask;
+  }
+  name_table_[i] = kTombstone;
+  --name_count_;
+  ++name_tombstones_;
+}
+
+void RedirectResolver::ResizeNameTable(size_t size) {
+  std::vector<uint32_t> old_table = std::move(name_table_);
+  name_table_.assign(size, kNoResolution);
+  name_tombstones_ = 0;
+  size_t mask = size - 1;
+  for (uint32_t index : old_table) {
+    if (index == kNoResolution || index == kTombstone)
+      continue;
+    size_t i = resolutions_[index].hash & mask;
+    while (name_table_[i] != kNoResolution)
+      i = (i + 1) & mask;
+    name_table_[i] = index;
+  }
+}
+
+void RedirectResolver::LinkNewest(uint32_t index) {
+  Resolution& res = resolutions_[index];
+  res.lru_prev = lru_newest_;
+  res.lru_next = kNoResolution;
+  if (lru_newest_ != kNoResolution) {
+    resolutions_[lru_newest_].lru_next = index;
+  } else {
+    lru_oldest_ = index;
+  }
+  lru_newest_ = index;
+}
+
+void RedirectResolver::Unlink(uint32_t index) {
+  Resolution& res = resolutions_[index];
+  if (res.lru_prev != kNoResolution) {
+    resolutions_[res.lru_prev].lru_next = res.lru_next;
+  } else {
+    lru_oldest_ = res.lru_next;
+  }
+  if (res.lru_next != kNoResolution) {
+    resolutions_[res.lru_next].lru_prev = res.lru_prev;
+  } else {
+    lru_newest_ = res.lru_prev;
+  }
+}
+
+void RedirectResolver::Drop(uint32_t index) {
+  EraseName(index);
+  Unlink(index);
+  Resolution& res = resolutions_[index];
+  res.in_use = false;
+  // Keeps the capacity for the next name at this address.
+  res.name.clear();
+  Publish(index, nullptr);
+  cache_dirty_ = true;
+}
+
+void RedirectResolver::Publish(uint32_t index,
+                               std::unique_ptr<const std::string> name) {
+  // This is the only thread storing, so the loads need no ordering.
+  std::atomic<PublishedChunk*>& chunk_slot =
+      published_chunks_[index / kPublishedChunkSize];
+  PublishedChunk* chunk = chunk_slot.load(std::memory_order_relaxed);
+  if (!chunk) {
+    if (!name)
+      return;
+    chunk = new PublishedChunk();
+    chunk_slot.store(chunk, std::memory_order_release);
+  }
+  std::atomic<const std::string*>& name_slot =
+      chunk->names[index % kPublishedChunkSize];
+  const std::string* old_name = name_slot.load(std::memory_order_relaxed);
+  name_slot.store(name.release(), std::memory_order_release);
+  if (old_name) {
+    retired_names_.emplace_back(old_name);
+  }
+}
+
+void RedirectResolver::StartGracePeriod() {
+  if (in_grace_period_ || retired_names_.empty())
+    return;
+  // Readers on this thread are done with the names between tasks.
+  auto done = base::BindOnce(&RedirectResolver::OnGracePeriodDone,
+                             weak_ptr_factory_.GetWeakPtr(),
+                             std::exchange(retired_names_, {}));
+  if (readers_.empty()) {
+    std::move(done).Run();
+    return;
+  }
+  in_grace_period_ = true;
+  base::RepeatingClosure barrier =
+      base::BarrierClosure(readers_.size(), std::move(done));
+  for (const auto& reader : readers_) {
+    reader->PostTaskAndReply(FROM_HERE, base::DoNothing(), barrier);
+  }
+}
+
+void RedirectResolver::OnGracePeriodDone(
+    std::vector<std::unique_ptr<const std::string>> names) {
+  in_grace_period_ = false;
+  // `names` are freed on return.
+}
+
+void RedirectResolver::LoadCache() {
+  std::string contents;
+  // Does not exist before the first save.
+  if (!base::ReadFileToString(cache_file_, &contents))
+    return;
+  std::optional<base::Value::Dict> cache = base::JSONReader::ReadDict(contents);
+  if (!cache.has_value()) {
+    LOG(WARNING) << "Invalid resolver cache: " << cache_file_;
+    return;
+  }
+  // Offsets are only meaningful in the range they were handed out from.
+  const std::string* range = cache->FindString("range");
+  std::optional<int> offset = cache->FindInt("offset");
+  const base::Value::List* resolutions = cache->FindList("resolutions");
+  if (!range || *range != GetRangeString() || !offset.has_value() ||
+      !resolutions) {
+    LOG(WARNING) << "Ignoring resolver cache: " << cache_file_;
+    return;
+  }
+
+  uint32_t subnet = ~0U >> prefix_;
+  auto now = base::TimeTicks::Now();
+  // From least to most recently used.
+  for (const base::Value& value : *resolutions) {
+    const base::Value::List* entry = value.GetIfList();
+    if (!entry || entry->size() != 2 || !(*entry)[0].is_int() ||
+        !(*entry)[1].is_string()) {
+      continue;
+    }
+    int index = (*entry)[0].GetInt();
+    const std::string& name = (*entry)[1].GetString();
+    if (index < 0 || static_cast<uint32_t>(index) > subnet ||
+        !IsCanonicalizedHostCompliant(name)) {
+      continue;
+    }
+    size_t hash = std::hash<std::string_view>()(name);
+    if (static_cast<size_t>(index) >= resolutions_.size()) {
+      resolutions_.resize(index + 1);
+    }
+    if (resolutions_[index].in_use || FindName(name, hash) != kNoResolution)
+      continue;
+    Resolution& res = resolutions_[index];
+    res.in_use = true;
+    res.name = name;
+    res.hash = hash;
+    res.time = now;
+    InsertName(index);
+    LinkNewest(index);
+    Publish(index, std::make_unique<std::string>(name));
+  }
+  offset_ = static_cast<uint32_t>(*offset) & subnet;
+  LOG(INFO) << "Loaded " << name_count_ << " resolutions from " << cache_file_;
+}
+
+void RedirectResolver::SaveCache() {
+  if (cache_file_.empty())
+    return;
+
+  base::Value::List resolutions;
+  for (uint32_t index = lru_oldest_; index != kNoResolution;
+       index = resolutions_[index].lru_next) {
+    resolutions.Append(base::Value::List()
+                           .Append(static_cast<int>(index))
+                           .Append(resolutions_[index].name));
+  }
+  base::Value::Dict cache;
+  cache.Set("range", GetRangeString());
+  cache.Set("offset", static_cast<int>(offset_));
+  cache.Set("resolutions", std::move(resolutions));
+
+  cache_dirty_ = false;
+  std::string contents;
+  if (!base::JSONWriter::Write(cache, &contents))
+    return;
+  size_t hash = std::hash<std::string>()(contents);
+  if (hash == saved_hash_)
+    return;
+  saved_hash_ = hash;
+  cache_writer_->WriteNow(std::move(contents));
+}
+
+std::string RedirectResolver::GetRangeString() const {
+  return GetIPv4Address(0).ToString() + "/" + base::NumberToString(prefix_);
 }
 
 }  // namespace net
@@ -5,62 +5,231 @@
 #ifndef NET_TOOLS_NAIVE_REDIRECT_RESOLVER_H_
 #define NET_TOOLS_NAIVE_REDIRECT_RESOLVER_H_
 
+#include <atomic>
 #include <cstdint>
-#include <list>
-#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/functional/callback.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/task/single_thread_task_runner.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "build/build_config.h"
 #include "net/base/ip_address.h"
 #include "net/base/ip_endpoint.h"
 
+#if BUILDFLAG(IS_LINUX)
+#include "base/files/scoped_file.h"
+#endif
+
 namespace net {
 
 class DatagramServerSocket;
 class IOBufferWithSize;
+#if BUILDFLAG(IS_LINUX)
+class NaiveDohClient;
+#endif
 
+// A fake address handed out for a name. Stored at the offset of its address
+// in the resolver range, and linked from least to most recently used.
 struct Resolution {
   Resolution();
   ~Resolution();
 
-  uint32_t addr;
+  bool in_use = false;
   std::string name;
+  size_t hash = 0;
   base::TimeTicks time;
-  std::map<std::string, std::list<Resolution>::iterator>::iterator by_name;
-  std::map<uint32_t, std::list<Resolution>::iterator>::iterator by_addr;
+  uint32_t lru_prev;
+  uint32_t lru_next;
 };
 
 class RedirectResolver {
  public:
+  using NewNameCallback = base::RepeatingCallback<void(const std::string&)>;
+
+  // Names get an address in `range`, and in `range6` for AAAA queries if it
+  // is valid. The offset of a name in `range` goes in the last 32 bits of its
+  // address in `range6`, so `prefix6` is at most 96.
   RedirectResolver(std::unique_ptr<DatagramServerSocket> socket,
                    const IPAddress& range,
-                   size_t prefix);
+                   size_t prefix,
+                   const IPAddress& range6,
+                   size_t prefix6);
+  // Serves queries once Listen() succeeds, which is Linux only.
+  RedirectResolver(const IPAddress& range,
+                   size_t prefix,
+                   const IPAddress& range6,
+                   size_t prefix6);
   ~RedirectResolver();
   RedirectResolver(const RedirectResolver&) = delete;
   RedirectResolver& operator=(const RedirectResolver&) = delete;
 
+  // These two may be called on any thread added with AddReader(), without
+  // locking. The other methods are for the thread the resolver lives on.
   bool IsInResolvedRange(const IPAddress& address) const;
   std::string FindNameByAddress(const IPAddress& address) const;
 
+  // Lets the thread of `task_runner` call FindNameByAddress(). Names it may
+  // still be reading are freed only once it runs a task posted after they
+  // were replaced, as a reader holds no name past the task it is running.
+  void AddReader(scoped_refptr<base::SingleThreadTaskRunner> task_runner);
+
+#if BUILDFLAG(IS_LINUX)
+  // Opens a UDP socket at `address`, taking the queries that arrive together
+  // with one recvmmsg(2) and sending their replies with one sendmmsg(2).
+  int Listen(const IPEndPoint& address);
+  // Serves queries on a bound UDP socket, e.g. one handed over by
+  // NaiveHandoff.
+  int Listen(base::ScopedFD socket);
+  // The socket opened by Listen(), or -1.
+  int socket_descriptor() const;
+
+  // Stops reading queries and saves the cache, for another process to take
+  // the socket over with the names mapped so far once FlushCache() is done.
+  void PauseForHandoff();
+  // Reads queries again if the other process did not take over. Otherwise
+  // stops saving the cache, which is the other process's now, while still
+  // translating the addresses mapped before.
+  void ResumeAfterHandoff(bool handed_off);
+
+  // Forwards the queries the range does not answer to `doh_client`, instead
+  // of refusing them. AAAA, HTTPS and SVCB queries still get no data, so
+  // clients connect to the fake addresses.
+  void set_doh_client(std::unique_ptr<NaiveDohClient> doh_client);
+#endif
+
+  // Loads the resolutions saved in `cache_file`, and saves changes to it
+  // with each sweep and on destruction, so clients holding fake addresses from
+  // before a restart still reach their names. Must be called before any
+  // query is served. The file is written on a background sequence.
+  void UseCacheFile(const base::FilePath& cache_file);
+  // Runs `callback` on the background sequence once the saves started so
+  // far are written, or right away without a cache file. May be called on
+  // any thread.
+  void FlushCache(base::OnceClosure callback);
+
+  // Runs `callback` for each name queried without an address yet, before
+  // its reply is sent.
+  void set_new_name_callback(NewNameCallback callback) {
+    new_name_callback_ = std::move(callback);
+  }
+
+  // Names currently holding an address.
+  size_t resolution_count() const { return name_count_; }
+  // Resolutions replaced because the range ran out of addresses.
+  uint64_t overwrite_count() const { return overwrite_count_; }
+  // Resolutions dropped after expiring.
+  uint64_t drop_count() const { return drop_count_; }
+
  private:
+#if BUILDFLAG(IS_LINUX)
+  class BatchReader;
+#endif
+
   void DoRead();
   void OnRecv(int result);
   void OnSend(int result);
   int HandleReadResult(int result);
+  // Parses the query of `size` bytes in `buffer` and writes the reply over
+  // it. Returns the size of the reply or an error.
+  // Returns ERR_IO_PENDING if the reply is sent later.
+  int HandleQuery(IOBufferWithSize* buffer, int size, const IPEndPoint& from);
+#if BUILDFLAG(IS_LINUX)
+  void OnDohReply(const IPEndPoint& to, std::string reply);
+#endif
+
+  // Returns the offset of the resolution of `name`, adding it if needed.
+  uint32_t Resolve(const std::string& name);
+  IPAddress GetIPv4Address(uint32_t index) const;
+  IPAddress GetIPv6Address(uint32_t index) const;
+
+  // Returns the offset of the resolution of `name`, or kNoResolution.
+  uint32_t FindName(std::string_view name, size_t hash) const;
+  void InsertName(uint32_t index);
+  void EraseName(uint32_t index);
+  void ResizeNameTable(size_t size);
+
+  void LinkNewest(uint32_t index);
+  void Unlink(uint32_t index);
+  // Removes the resolution at `index` from both indexes.
+  void Drop(uint32_t index);
+  // Saves the cache if needed and sweeps.
+  void OnSweepTimer();
+  // Drops a bounded number of expired resolutions.
+  void Sweep();
+
+  void LoadCache();
+  void SaveCache();
+  std::string GetRangeString() const;
+
+  // Makes `name` the one FindNameByAddress() sees at `index`, or none if
+  // null, retiring the name seen there before.
+  void Publish(uint32_t index, std::unique_ptr<const std::string> name);
+  // Frees the names retired so far once every reader has moved past them.
+  void StartGracePeriod();
+  void OnGracePeriodDone(std::vector<std::unique_ptr<const std::string>> names);
 
   std::unique_ptr<DatagramServerSocket> socket_;
   IPAddress range_;
   size_t prefix_;
+  IPAddress range6_;
+  size_t prefix6_;
   uint32_t offset_;
   scoped_refptr<IOBufferWithSize> buffer_;
   IPEndPoint recv_address_;
+#if BUILDFLAG(IS_LINUX)
+  std::unique_ptr<BatchReader> batch_reader_;
+  std::unique_ptr<NaiveDohClient> doh_client_;
+#endif
+
+  // Indexed by the offset of the address in the range. Grows as addresses
+  // are handed out, up to the size of the range.
+  std::vector<Resolution> resolutions_;
+  // Open addressing with linear probing, holding offsets into
+  // `resolutions_`. The size is a power of two.
+  std::vector<uint32_t> name_table_;
+  size_t name_count_;
+  size_t name_tombstones_;
+  // Least and most recently used resolutions.
+  uint32_t lru_oldest_;
+  uint32_t lru_newest_;
+
+  // The names of `resolutions_` as seen by FindNameByAddress(), indexed the
+  // same way. Chunks are added as the range fills up and kept until
+  // destruction, so a reader never sees one freed.
+  struct PublishedChunk;
+  std::unique_ptr<std::atomic<PublishedChunk*>[]> published_chunks_;
+  size_t published_chunk_count_;
+  // Published names replaced since the last grace period started.
+  std::vector<std::unique_ptr<const std::string>> retired_names_;
+  bool in_grace_period_;
+  std::vector<scoped_refptr<base::SingleThreadTaskRunner>> readers_;
+
+  uint64_t overwrite_count_;
+  uint64_t drop_count_;
+  base::MetronomeTimer sweep_timer_;
+
+  NewNameCallback new_name_callback_;
 
-  std::map<std::string, std::list<Resolution>::iterator> resolution_by_name_;
-  std::map<uint32_t, std::list<Resolution>::iterator> resolution_by_addr_;
-  std::list<Resolution> resolutions_;
+  // Empty if resolutions are not saved.
+  base::FilePath cache_file_;
+  // Whether resolutions were added or dropped since the last save.
+  bool cache_dirty_;
+  // Set with `cache_file_`, and never reset.
+  scoped_refptr<base::SequencedTaskRunner> cache_task_runner_;
+  std::unique_ptr<base::ImportantFileWriter> cache_writer_;
+  // Of the contents last saved, so a save that would not change the file,
+  // e.g. after a name is dropped and mapped again, is skipped.
+  size_t saved_hash_ = 0;
 
   base::WeakPtrFactory<RedirectResolver> weak_ptr_factory_{this};
 };
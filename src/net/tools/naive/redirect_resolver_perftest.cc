@@ -0,0 +1,276 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures RedirectResolver on synthetic A query streams served by a mock
+// socket through RecvFrom(), HandleReadResult() and SendTo(). Fills the
+// whole range with unique names, printing QPS and p99 latency as the table
+// doubles, then repeats names of the full table and adds new ones
+// overwriting the oldest. QPS counts the time of the resolver only, not of
+// generating the queries. Memory is the resident set growth of the fill.
+//
+//   redirect_resolver_perftest --prefix=10 --queries=1048576
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/check.h"
+#include "base/command_line.h"
+#include "base/functional/bind.h"
+#include "base/logging.h"
+#include "base/process/process_metrics.h"
+#include "base/rand_util.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/single_thread_task_executor.h"
+#include "base/time/time.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_names_util.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/public/dns_protocol.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/datagram_server_socket.h"
+#include "net/tools/naive/redirect_resolver.h"
+
+namespace net {
+namespace {
+
+// Names of the hot set of the repeated stream.
+constexpr uint32_t kHotNames = 1024;
+// The first row of the fill.
+constexpr uint32_t kMinFillRow = 1024;
+
+std::string GetName(uint64_t i) {
+  return "n" + base::NumberToString(i) + ".bench.test";
+}
+
+// Query `i` of a stream of new names, the first being name `begin`.
+std::string GetNewName(uint32_t begin, uint32_t i) {
+  return GetName(begin + i);
+}
+
+// Query `i` of a stream of names drawn from `size` names from `begin`.
+std::string GetRandomName(uint32_t begin, uint32_t size, uint32_t i) {
+  return GetName(begin + base::RandGenerator(size));
+}
+
+// Serves A queries for the names of a generator synchronously and times
+// each from its RecvFrom() to the SendTo() of its reply. Pends once a
+// stream is done, until the next Serve().
+class QueryStreamSocket : public DatagramServerSocket {
+ public:
+  using NameGenerator = base::RepeatingCallback<std::string(uint32_t)>;
+
+  explicit QueryStreamSocket(size_t max_latencies) {
+    latencies_ns_.reserve(max_latencies);
+  }
+
+  // Serves `count` queries for the names `generator` returns for 0 to
+  // `count` - 1, then returns once the resolver waits for more.
+  void Serve(uint32_t count, NameGenerator generator) {
+    CHECK(pending_callback_);
+    served_ = 0;
+    count_ = count;
+    generator_ = std::move(generator);
+    latencies_ns_.clear();
+    int size = FillQuery(pending_buf_.get(), pending_buf_len_);
+    pending_buf_ = nullptr;
+    std::move(pending_callback_).Run(size);
+  }
+
+  // Of the queries of the last Serve().
+  std::vector<uint32_t>& latencies_ns() { return latencies_ns_; }
+
+  // DatagramServerSocket implementation.
+  int Listen(const IPEndPoint& address) override { return OK; }
+  int RecvFrom(IOBuffer* buf,
+               int buf_len,
+               IPEndPoint* address,
+               CompletionOnceCallback callback) override {
+    *address = from_;
+    if (served_ == count_) {
+      pending_buf_ = buf;
+      pending_buf_len_ = buf_len;
+      pending_callback_ = std::move(callback);
+      return ERR_IO_PENDING;
+    }
+    return FillQuery(buf, buf_len);
+  }
+  int SendTo(IOBuffer* buf,
+             int buf_len,
+             const IPEndPoint& address,
+             CompletionOnceCallback callback) override {
+    latencies_ns_.push_back(static_cast<uint32_t>(
+        (base::TimeTicks::Now() - recv_time_).InNanoseconds()));
+    return buf_len;
+  }
+  int SetReceiveBufferSize(int32_t size) override { return OK; }
+  int SetSendBufferSize(int32_t size) override { return OK; }
+  void AllowAddressReuse() override {}
+  void AllowBroadcast() override {}
+  void AllowAddressSharingForMulticast() override {}
+  int JoinGroup(const IPAddress& group_address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int LeaveGroup(const IPAddress& group_address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int SetMulticastInterface(uint32_t interface_index) override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int SetMulticastTimeToLive(int time_to_live) override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int SetMulticastLoopbackMode(bool loopback) override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int SetDiffServCodePoint(DiffServCodePoint dscp) override { return OK; }
+  void DetachFromThread() override {}
+
+  // DatagramSocket implementation.
+  void Close() override {}
+  int GetPeerAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  int GetLocalAddress(IPEndPoint* address) const override {
+    return ERR_NOT_IMPLEMENTED;
+  }
+  void UseNonBlockingIO() override {}
+  int SetDoNotFragment() override { return OK; }
+  int SetRecvTos() override { return OK; }
+  int SetTos(DiffServCodePoint dscp, EcnCodePoint ecn) override { return OK; }
+  void SetMsgConfirm(bool confirm) override {}
+  const NetLogWithSource& NetLog() const override { return net_log_; }
+  DscpAndEcn GetLastTos() const override { return {}; }
+
+ private:
+  int FillQuery(IOBuffer* buf, int buf_len) {
+    std::optional<std::vector<uint8_t>> qname =
+        dns_names_util::DottedNameToNetwork(generator_.Run(served_));
+    CHECK(qname);
+    DnsQuery query(static_cast<uint16_t>(served_), *qname,
+                   dns_protocol::kTypeA);
+    int size = query.io_buffer()->size();
+    CHECK_LE(size, buf_len);
+    std::memcpy(buf->data(), query.io_buffer()->data(), size);
+    ++served_;
+    recv_time_ = base::TimeTicks::Now();
+    return size;
+  }
+
+  const IPEndPoint from_{IPAddress::IPv4Localhost(), 53000};
+  uint32_t served_ = 0;
+  uint32_t count_ = 0;
+  NameGenerator generator_;
+  base::TimeTicks recv_time_;
+  std::vector<uint32_t> latencies_ns_;
+
+  scoped_refptr<IOBuffer> pending_buf_;
+  int pending_buf_len_ = 0;
+  CompletionOnceCallback pending_callback_;
+  NetLogWithSource net_log_;
+};
+
+size_t GetResidentSetSize() {
+  return base::ProcessMetrics::CreateCurrentProcessMetrics()
+      ->GetResidentSetSize();
+}
+
+void PrintRow(const char* stream,
+              uint32_t table_size,
+              std::vector<uint32_t>& latencies_ns) {
+  uint64_t total_ns = 0;
+  for (uint32_t ns : latencies_ns) {
+    total_ns += ns;
+  }
+  auto p99 = latencies_ns.begin() + latencies_ns.size() * 99 / 100;
+  std::nth_element(latencies_ns.begin(), p99, latencies_ns.end());
+  std::printf("  %-9s table %8u: %10.0f QPS p99 %8u ns\n", stream, table_size,
+              latencies_ns.size() * 1e9 / std::max<uint64_t>(total_ns, 1),
+              *p99);
+}
+
+void Benchmark(size_t prefix, uint32_t queries) {
+  const uint32_t range_size = 1u << (32 - prefix);
+  auto owned_socket = std::make_unique<QueryStreamSocket>(
+      std::max(range_size / 2, queries));
+  QueryStreamSocket* socket = owned_socket.get();
+  RedirectResolver resolver(std::move(owned_socket), IPAddress(100, 64, 0, 0),
+                            prefix, IPAddress(), 0);
+  // Until the first RecvFrom() pends.
+  base::RunLoop().RunUntilIdle();
+
+  std::printf("RedirectResolver /%zu, %u addresses\n", prefix, range_size);
+  size_t rss = GetResidentSetSize();
+  // Names below `next_name` were queried, the last `range_size` of them
+  // hold an address.
+  uint32_t next_name = 0;
+  for (uint32_t end = kMinFillRow; end <= range_size; end *= 2) {
+    uint32_t begin = next_name;
+    socket->Serve(end - begin, base::BindRepeating(&GetNewName, begin));
+    next_name = end;
+    PrintRow("unique", end, socket->latencies_ns());
+  }
+  size_t fill_bytes = GetResidentSetSize() - rss;
+  std::printf("  memory: %zu bytes, %.1f bytes/name\n", fill_bytes,
+              static_cast<double>(fill_bytes) / resolver.resolution_count());
+
+  uint32_t oldest = next_name - range_size;
+  socket->Serve(queries,
+                base::BindRepeating(&GetRandomName, oldest, kHotNames));
+  PrintRow("hot", range_size, socket->latencies_ns());
+
+  socket->Serve(queries,
+                base::BindRepeating(&GetRandomName, oldest, range_size));
+  PrintRow("repeated", range_size, socket->latencies_ns());
+
+  socket->Serve(queries, base::BindRepeating(&GetNewName, next_name));
+  PrintRow("overwrite", range_size, socket->latencies_ns());
+  std::printf("  overwrites: %llu, memory: %zu bytes\n",
+              static_cast<unsigned long long>(resolver.overwrite_count()),
+              GetResidentSetSize() - rss);
+}
+
+}  // namespace
+}  // namespace net
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager exit_manager;
+  base::CommandLine::Init(argc, argv);
+  const auto& command_line = *base::CommandLine::ForCurrentProcess();
+  // The resolver logs every name it adds.
+  logging::SetMinLogLevel(logging::LOGGING_WARNING);
+  base::SingleThreadTaskExecutor executor;
+
+  int prefix = 10;
+  int queries = 1 << 20;
+  if (command_line.HasSwitch("prefix") &&
+      (!base::StringToInt(command_line.GetSwitchValueASCII("prefix"),
+                          &prefix) ||
+       prefix < 10 || prefix > 22)) {
+    std::fprintf(stderr, "Invalid prefix\n");
+    return EXIT_FAILURE;
+  }
+  if (command_line.HasSwitch("queries") &&
+      (!base::StringToInt(command_line.GetSwitchValueASCII("queries"),
+                          &queries) ||
+       queries < 100)) {
+    std::fprintf(stderr, "Invalid queries\n");
+    return EXIT_FAILURE;
+  }
+
+  net::Benchmark(prefix, queries);
+  return EXIT_SUCCESS;
+}
@@ -5,18 +5,23 @@
 
 #include "net/tools/naive/socks5_server_socket.h"
 
+#include <algorithm>
 #include <cstring>
+#include <string_view>
 #include <utility>
 
 #include "base/functional/bind.h"
 #include "base/functional/callback_helpers.h"
 #include "base/logging.h"
 #include "base/sys_byteorder.h"
+#include "base/trace_event/base_tracing.h"
 #include "net/base/ip_address.h"
 #include "net/base/net_errors.h"
 #include "net/base/sys_addrinfo.h"
 #include "net/log/net_log.h"
 #include "net/log/net_log_event_type.h"
+#include "net/socket/udp_server_socket.h"
+#include "net/tools/naive/naive_proxy_protocol.h"
 
 namespace net {
 
@@ -29,6 +34,8 @@ enum SocksCommandType {
 static constexpr unsigned int kGreetReadHeaderSize = 2;
 static constexpr unsigned int kAuthReadHeaderSize = 2;
 static constexpr unsigned int kReadHeaderSize = 5;
+// Large enough for a pipelined greeting, request and the start of payload.
+static constexpr int kHandshakeReadSize = 1024;
 static constexpr char kSOCKS5Version = '\x05';
 static constexpr char kSOCKS5Reserved = '\x00';
 static constexpr char kAuthMethodNone = '\x00';
@@ -38,6 +45,7 @@ static constexpr char kSubnegotiationVersion = '\x01';
 static constexpr char kAuthStatusSuccess = '\x00';
 static constexpr char kAuthStatusFailure = '\xff';
 static constexpr char kReplySuccess = '\x00';
+static constexpr char kReplyGeneralFailure = '\x01';
 static constexpr char kReplyCommandNotSupported = '\x07';
 
 static_assert(sizeof(struct in_addr) == 4, "incorrect system size of IPv4");
@@ -47,6 +55,8 @@ Socks5ServerSocket::Socks5ServerSocket(
     std::unique_ptr<StreamSocket> transport_socket,
     const std::string& user,
     const std::string& pass,
+    const NaiveUserTable* user_table,
+    bool udp_associate_enabled,
     const NetworkTrafficAnnotationTag& traffic_annotation)
     : io_callback_(base::BindRepeating(&Socks5ServerSocket::OnIOComplete,
                                        base::Unretained(this))),
@@ -54,9 +64,14 @@ Socks5ServerSocket::Socks5ServerSocket(
       next_state_(STATE_NONE),
       completed_handshake_(false),
       bytes_sent_(0),
+      handshake_read_size_(0),
+      send_greet_reply_with_handshake_(false),
       was_ever_used_(false),
       user_(user),
       pass_(pass),
+      user_table_(user_table),
+      udp_associate_enabled_(udp_associate_enabled),
+      is_udp_associate_(false),
       net_log_(transport_->NetLog()),
       traffic_annotation_(traffic_annotation) {}
 
@@ -68,6 +83,15 @@ const HostPortPair& Socks5ServerSocket::request_endpoint() const {
   return request_endpoint_;
 }
 
+size_t Socks5ServerSocket::GetHandshakeMemoryUsage() const {
+  return (handshake_buf_ ? handshake_buf_->size() : 0) + buffer_.capacity() +
+         pending_.capacity();
+}
+
+std::unique_ptr<DatagramServerSocket> Socks5ServerSocket::TakeUdpSocket() {
+  return std::move(udp_socket_);
+}
+
 int Socks5ServerSocket::Connect(CompletionOnceCallback callback) {
   DCHECK(transport_);
   DCHECK_EQ(STATE_NONE, next_state_);
@@ -79,8 +103,12 @@ int Socks5ServerSocket::Connect(CompletionOnceCallback callback) {
 
   net_log_.BeginEvent(NetLogEventType::SOCKS5_CONNECT);
 
-  next_state_ = STATE_GREET_READ;
+  next_state_ = proxy_protocol_ ? STATE_PROXY_HEADER_READ : STATE_GREET_READ;
   buffer_.clear();
+  pending_.clear();
+  send_greet_reply_with_handshake_ = false;
+  is_udp_associate_ = false;
+  udp_socket_.reset();
 
   int rv = DoLoop(OK);
   if (rv == ERR_IO_PENDING) {
@@ -141,6 +169,12 @@ void Socks5ServerSocket::ApplySocketTag(const SocketTag& tag) {
   return transport_->ApplySocketTag(tag);
 }
 
+int Socks5ServerSocket::ShutdownWrite() {
+  if (!completed_handshake_)
+    return ERR_SOCKET_NOT_CONNECTED;
+  return transport_->ShutdownWrite();
+}
+
 // Read is called by the transport layer above to read. This can only be done
 // if the SOCKS handshake is complete.
 int Socks5ServerSocket::Read(IOBuffer* buf,
@@ -151,6 +185,9 @@ int Socks5ServerSocket::Read(IOBuffer* buf,
   DCHECK(!user_callback_);
   DCHECK(callback);
 
+  if (!pending_.empty())
+    return ReadBufferedData(buf, buf_len);
+
   int rv = transport_->Read(
       buf, buf_len,
       base::BindOnce(&Socks5ServerSocket::OnReadWriteComplete,
@@ -160,6 +197,38 @@ int Socks5ServerSocket::Read(IOBuffer* buf,
   return rv;
 }
 
+int Socks5ServerSocket::ReadIfReady(IOBuffer* buf,
+                                    int buf_len,
+                                    CompletionOnceCallback callback) {
+  DCHECK(completed_handshake_);
+  DCHECK_EQ(STATE_NONE, next_state_);
+  DCHECK(!user_callback_);
+  DCHECK(callback);
+
+  if (!pending_.empty())
+    return ReadBufferedData(buf, buf_len);
+
+  int rv = transport_->ReadIfReady(
+      buf, buf_len,
+      base::BindOnce(&Socks5ServerSocket::OnReadWriteComplete,
+                     base::Unretained(this), std::move(callback)));
+  if (rv > 0)
+    was_ever_used_ = true;
+  return rv;
+}
+
+int Socks5ServerSocket::CancelReadIfReady() {
+  return transport_->CancelReadIfReady();
+}
+
+int Socks5ServerSocket::ReadBufferedData(IOBuffer* buf, int buf_len) {
+  was_ever_used_ = true;
+  int size = std::min<int>(buf_len, pending_.size());
+  std::memcpy(buf->data(), pending_.data(), size);
+  pending_.erase(0, size);
+  return size;
+}
+
 // Write is called by the transport layer. This can only be done if the
 // SOCKS handshake is complete.
 int Socks5ServerSocket::Write(
@@ -224,7 +293,16 @@ int Socks5ServerSocket::DoLoop(int last_io_result) {
   do {
     State state = next_state_;
     next_state_ = STATE_NONE;
+    TRACE_EVENT("net", "Socks5ServerSocket::DoLoop", "state",
+                static_cast<int>(state), "rv", rv);
     switch (state) {
+      case STATE_PROXY_HEADER_READ:
+        DCHECK_EQ(OK, rv);
+        rv = DoProxyHeaderRead();
+        break;
+      case STATE_PROXY_HEADER_READ_COMPLETE:
+        rv = DoProxyHeaderReadComplete(rv);
+        break;
       case STATE_GREET_READ:
         DCHECK_EQ(OK, rv);
         net_log_.BeginEvent(NetLogEventType::SOCKS5_GREET_READ);
@@ -288,6 +366,43 @@ int Socks5ServerSocket::DoLoop(int last_io_result) {
   return rv;
 }
 
+int Socks5ServerSocket::DoProxyHeaderRead() {
+  next_state_ = STATE_PROXY_HEADER_READ_COMPLETE;
+
+  // Reads past the header, so the greeting and the request usually arrive
+  // with it in one read.
+  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(kHandshakeReadSize);
+  return transport_->Read(handshake_buf_.get(), kHandshakeReadSize,
+                          io_callback_);
+}
+
+int Socks5ServerSocket::DoProxyHeaderReadComplete(int result) {
+  if (result < 0)
+    return result;
+
+  if (result == 0) {
+    net_log_.AddEvent(
+        NetLogEventType::SOCKS_UNEXPECTEDLY_CLOSED_DURING_GREETING);
+    return ERR_SOCKS_CONNECTION_FAILED;
+  }
+
+  buffer_.append(handshake_buf_->data(), result);
+  int header_size = ParseProxyProtocolHeader(buffer_, &proxied_source_);
+  if (header_size < 0) {
+    LOG(WARNING) << "Invalid PROXY protocol header";
+    return ERR_SOCKS_CONNECTION_FAILED;
+  }
+  if (header_size == 0) {
+    next_state_ = STATE_PROXY_HEADER_READ;
+    return OK;
+  }
+
+  pending_ = buffer_.substr(header_size);
+  buffer_.clear();
+  next_state_ = STATE_GREET_READ;
+  return OK;
+}
+
 int Socks5ServerSocket::DoGreetRead() {
   next_state_ = STATE_GREET_READ_COMPLETE;
 
@@ -295,11 +410,7 @@ int Socks5ServerSocket::DoGreetRead() {
     read_header_size_ = kGreetReadHeaderSize;
   }
 
-  int handshake_buf_len = read_header_size_ - buffer_.size();
-  DCHECK_LT(0, handshake_buf_len);
-  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(handshake_buf_len);
-  return transport_->Read(handshake_buf_.get(), handshake_buf_len,
-                          io_callback_);
+  return ReadHandshake(read_header_size_ - buffer_.size());
 }
 
 int Socks5ServerSocket::DoGreetReadComplete(int result) {
@@ -312,6 +423,7 @@ int Socks5ServerSocket::DoGreetReadComplete(int result) {
     return ERR_SOCKS_CONNECTION_FAILED;
   }
 
+  result = TakeHandshakeRead(result);
   buffer_.append(handshake_buf_->data(), result);
 
   // When the first few bytes are read, check how many more are required
@@ -336,7 +448,7 @@ int Socks5ServerSocket::DoGreetReadComplete(int result) {
   if (buffer_.size() == read_header_size_) {
     int nmethods = buffer_[1];
     char expected_method = kAuthMethodNone;
-    if (!user_.empty() || !pass_.empty()) {
+    if (!user_.empty() || !pass_.empty() || user_table_) {
       expected_method = kAuthMethodUserPass;
     }
     void* match =
@@ -347,6 +459,13 @@ int Socks5ServerSocket::DoGreetReadComplete(int result) {
       auth_method_ = kAuthMethodNoAcceptable;
     }
     buffer_.clear();
+    // A client that sent its request without waiting for the method reply
+    // gets both replies in one write.
+    if (auth_method_ == kAuthMethodNone && !pending_.empty()) {
+      send_greet_reply_with_handshake_ = true;
+      next_state_ = STATE_HANDSHAKE_READ;
+      return OK;
+    }
     next_state_ = STATE_GREET_WRITE;
     return OK;
   }
@@ -355,6 +474,33 @@ int Socks5ServerSocket::DoGreetReadComplete(int result) {
   return OK;
 }
 
+int Socks5ServerSocket::ReadHandshake(int size) {
+  DCHECK_LT(0, size);
+  handshake_read_size_ = size;
+  // Serves bytes read along with an earlier message first.
+  if (!pending_.empty()) {
+    int pending_size = std::min<int>(size, pending_.size());
+    handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(pending_size);
+    std::memcpy(handshake_buf_->data(), pending_.data(), pending_size);
+    pending_.erase(0, pending_size);
+    return pending_size;
+  }
+  // Reads more than needed so pipelined messages take one read.
+  int handshake_buf_len = std::max(size, kHandshakeReadSize);
+  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(handshake_buf_len);
+  return transport_->Read(handshake_buf_.get(), handshake_buf_len,
+                          io_callback_);
+}
+
+int Socks5ServerSocket::TakeHandshakeRead(int result) {
+  if (result > handshake_read_size_) {
+    pending_.append(handshake_buf_->data() + handshake_read_size_,
+                    result - handshake_read_size_);
+    result = handshake_read_size_;
+  }
+  return result;
+}
+
 int Socks5ServerSocket::DoGreetWrite() {
   if (buffer_.empty()) {
     const char write_data[] = {kSOCKS5Version, auth_method_};
@@ -400,11 +546,7 @@ int Socks5ServerSocket::DoAuthRead() {
     read_header_size_ = kAuthReadHeaderSize;
   }
 
-  int handshake_buf_len = read_header_size_ - buffer_.size();
-  DCHECK_LT(0, handshake_buf_len);
-  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(handshake_buf_len);
-  return transport_->Read(handshake_buf_.get(), handshake_buf_len,
-                          io_callback_);
+  return ReadHandshake(read_header_size_ - buffer_.size());
 }
 
 int Socks5ServerSocket::DoAuthReadComplete(int result) {
@@ -415,6 +557,7 @@ int Socks5ServerSocket::DoAuthReadComplete(int result) {
     return ERR_SOCKS_CONNECTION_FAILED;
   }
 
+  result = TakeHandshakeRead(result);
   buffer_.append(handshake_buf_->data(), result);
 
   // When the first few bytes are read, check how many more are required
@@ -441,8 +584,19 @@ int Socks5ServerSocket::DoAuthReadComplete(int result) {
       return OK;
     }
 
-    if (buffer_.compare(kAuthReadHeaderSize, username_len, user_) == 0 &&
-        buffer_.compare(password_offset, password_len, pass_) == 0) {
+    if (user_table_ && user_.empty() && pass_.empty()) {
+      authenticated_user_ = user_table_->Authenticate(
+          std::string_view(buffer_).substr(kAuthReadHeaderSize, username_len),
+          std::string_view(buffer_).substr(password_offset, password_len));
+      if (authenticated_user_ && authenticated_user_->over_soft_quota()) {
+        LOG(INFO) << "Refused user " << authenticated_user_->name()
+                  << " over its quota";
+        authenticated_user_ = nullptr;
+      }
+      auth_status_ =
+          authenticated_user_ ? kAuthStatusSuccess : kAuthStatusFailure;
+    } else if (buffer_.compare(kAuthReadHeaderSize, username_len, user_) == 0 &&
+               buffer_.compare(password_offset, password_len, pass_) == 0) {
       auth_status_ = kAuthStatusSuccess;
     } else {
       auth_status_ = kAuthStatusFailure;
@@ -498,11 +652,7 @@ int Socks5ServerSocket::DoHandshakeRead() {
     read_header_size_ = kReadHeaderSize;
   }
 
-  int handshake_buf_len = read_header_size_ - buffer_.size();
-  DCHECK_LT(0, handshake_buf_len);
-  handshake_buf_ = base::MakeRefCounted<IOBufferWithSize>(handshake_buf_len);
-  return transport_->Read(handshake_buf_.get(), handshake_buf_len,
-                          io_callback_);
+  return ReadHandshake(read_header_size_ - buffer_.size());
 }
 
 int Socks5ServerSocket::DoHandshakeReadComplete(int result) {
@@ -516,6 +666,7 @@ int Socks5ServerSocket::DoHandshakeReadComplete(int result) {
     return ERR_SOCKS_CONNECTION_FAILED;
   }
 
+  result = TakeHandshakeRead(result);
   buffer_.append(handshake_buf_->data(), result);
 
   // When the first few bytes are read, check how many more are required
@@ -531,6 +682,9 @@ int Socks5ServerSocket::DoHandshakeReadComplete(int result) {
       // The proxy replies with success immediately without first connecting
       // to the requested endpoint.
       reply_ = kReplySuccess;
+    } else if (command == kCommandUDPAssociate && udp_associate_enabled_) {
+      reply_ = kReplySuccess;
+      is_udp_associate_ = true;
     } else if (command == kCommandBind || command == kCommandUDPAssociate) {
       reply_ = kReplyCommandNotSupported;
     } else {
@@ -588,6 +742,17 @@ int Socks5ServerSocket::DoHandshakeReadComplete(int result) {
       IPEndPoint endpoint(ip_addr, port_host);
       request_endpoint_ = HostPortPair::FromIPEndPoint(endpoint);
     }
+    // For UDP associations the request endpoint is where the client will
+    // send datagrams from, if it knows. Datagrams are accepted from any port
+    // of the client host instead.
+    if (is_udp_associate_) {
+      int rv = ListenUdp();
+      if (rv != OK) {
+        LOG(WARNING) << "Cannot listen for UDP association: "
+                     << ErrorToShortString(rv);
+        reply_ = kReplyGeneralFailure;
+      }
+    }
     buffer_.clear();
     next_state_ = STATE_HANDSHAKE_WRITE;
     return OK;
@@ -597,6 +762,30 @@ int Socks5ServerSocket::DoHandshakeReadComplete(int result) {
   return OK;
 }
 
+int Socks5ServerSocket::ListenUdp() {
+  IPEndPoint local_endpoint;
+  int rv = transport_->GetLocalAddress(&local_endpoint);
+  if (rv != OK)
+    return rv;
+
+  // Listens on the address the client reached the proxy at.
+  auto socket = std::make_unique<UDPServerSocket>(net_log_.net_log(),
+                                                  net_log_.source());
+  rv = socket->Listen(IPEndPoint(local_endpoint.address(), 0));
+  if (rv != OK)
+    return rv;
+  rv = socket->GetLocalAddress(&udp_endpoint_);
+  if (rv != OK)
+    return rv;
+  if (udp_endpoint_.address().IsIPv4MappedIPv6()) {
+    udp_endpoint_ = IPEndPoint(
+        ConvertIPv4MappedIPv6ToIPv4(udp_endpoint_.address()),
+        udp_endpoint_.port());
+  }
+  udp_socket_ = std::move(socket);
+  return OK;
+}
+
 // Writes the SOCKS handshake data to the underlying socket connection.
 int Socks5ServerSocket::DoHandshakeWrite() {
   next_state_ = STATE_HANDSHAKE_WRITE_COMPLETE;
@@ -612,7 +801,27 @@ int Socks5ServerSocket::DoHandshakeWrite() {
         0x00, 0x00,  // BND.PORT
         // clang-format on
     };
-    buffer_ = std::string(write_data, std::size(write_data));
+    buffer_.clear();
+    if (send_greet_reply_with_handshake_) {
+      buffer_.push_back(kSOCKS5Version);
+      buffer_.push_back(auth_method_);
+    }
+    if (udp_socket_) {
+      // The client sends its datagrams to BND.ADDR and BND.PORT.
+      const IPAddress& address = udp_endpoint_.address();
+      buffer_.push_back(kSOCKS5Version);
+      buffer_.push_back(reply_);
+      buffer_.push_back(kSOCKS5Reserved);
+      buffer_.push_back(address.IsIPv4() ? kEndPointResolvedIPv4
+                                         : kEndPointResolvedIPv6);
+      buffer_.append(reinterpret_cast<const char*>(address.bytes().data()),
+                     address.size());
+      uint16_t port_net = base::HostToNet16(udp_endpoint_.port());
+      buffer_.append(reinterpret_cast<const char*>(&port_net),
+                     sizeof(port_net));
+    } else {
+      buffer_.append(write_data, std::size(write_data));
+    }
     bytes_sent_ = 0;
   }
 
@@ -650,6 +859,10 @@ int Socks5ServerSocket::DoHandshakeWriteComplete(int result) {
 }
 
 int Socks5ServerSocket::GetPeerAddress(IPEndPoint* address) const {
+  if (proxied_source_) {
+    *address = *proxied_source_;
+    return OK;
+  }
   return transport_->GetPeerAddress(address);
 }
 
@@ -9,6 +9,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "base/memory/scoped_refptr.h"
@@ -18,10 +19,12 @@
 #include "net/base/io_buffer.h"
 #include "net/base/ip_endpoint.h"
 #include "net/log/net_log_with_source.h"
+#include "net/socket/datagram_server_socket.h"
 #include "net/socket/connection_attempts.h"
 #include "net/socket/next_proto.h"
 #include "net/socket/stream_socket.h"
 #include "net/ssl/ssl_info.h"
+#include "net/tools/naive/naive_user_table.h"
 
 namespace net {
 struct NetworkTrafficAnnotationTag;
@@ -30,9 +33,14 @@ struct NetworkTrafficAnnotationTag;
 // Currently no SOCKSv5 authentication is supported.
 class Socks5ServerSocket : public StreamSocket {
  public:
+  // UDP ASSOCIATE requests are refused unless `udp_associate_enabled`.
+  // Without `user` and `pass`, clients authenticate as a user of
+  // `user_table` if set, and are refused once it is over its soft quota.
   Socks5ServerSocket(std::unique_ptr<StreamSocket> transport_socket,
                      const std::string& user,
                      const std::string& pass,
+                     const NaiveUserTable* user_table,
+                     bool udp_associate_enabled,
                      const NetworkTrafficAnnotationTag& traffic_annotation);
 
   // On destruction Disconnect() is called.
@@ -42,6 +50,30 @@ class Socks5ServerSocket : public StreamSocket {
   Socks5ServerSocket& operator=(const Socks5ServerSocket&) = delete;
 
   const HostPortPair& request_endpoint() const;
+  // The user of `user_table` the client authenticated as, if any.
+  NaiveUserTable::User* authenticated_user() const {
+    return authenticated_user_.get();
+  }
+
+  // Whether the handshake has set up a UDP association. The connection then
+  // carries no payload, and the association ends when it closes.
+  bool is_udp_associate() const { return is_udp_associate_; }
+  // The socket receiving the datagrams of the association.
+  std::unique_ptr<DatagramServerSocket> TakeUdpSocket();
+
+  // Expects a PROXY protocol header ahead of the greeting, from a load
+  // balancer. The client address in it is then the peer address.
+  void set_proxy_protocol(bool proxy_protocol) {
+    proxy_protocol_ = proxy_protocol;
+  }
+
+  StreamSocket* transport_socket() const { return transport_.get(); }
+
+  // Whether payload received along with the request is yet unread.
+  bool has_buffered_data() const { return !pending_.empty(); }
+
+  // Bytes held by the handshake buffers, for memory accounting.
+  size_t GetHandshakeMemoryUsage() const;
 
   // StreamSocket implementation.
 
@@ -56,11 +88,16 @@ class Socks5ServerSocket : public StreamSocket {
   bool GetSSLInfo(SSLInfo* ssl_info) override;
   int64_t GetTotalReceivedBytes() const override;
   void ApplySocketTag(const SocketTag& tag) override;
+  int ShutdownWrite() override;
 
   // Socket implementation.
   int Read(IOBuffer* buf,
            int buf_len,
            CompletionOnceCallback callback) override;
+  int ReadIfReady(IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) override;
+  int CancelReadIfReady() override;
   int Write(IOBuffer* buf,
             int buf_len,
             CompletionOnceCallback callback,
@@ -74,6 +111,8 @@ class Socks5ServerSocket : public StreamSocket {
 
  private:
   enum State {
+    STATE_PROXY_HEADER_READ,
+    STATE_PROXY_HEADER_READ_COMPLETE,
     STATE_GREET_READ,
     STATE_GREET_READ_COMPLETE,
     STATE_GREET_WRITE,
@@ -100,7 +139,22 @@ class Socks5ServerSocket : public StreamSocket {
   void OnIOComplete(int result);
   void OnReadWriteComplete(CompletionOnceCallback callback, int result);
 
+  // Returns payload read past the request along with it.
+  int ReadBufferedData(IOBuffer* buf, int buf_len);
+
+  // Reads `size` bytes of the current message into handshake_buf_, using
+  // pending_ before the transport.
+  int ReadHandshake(int size);
+  // Moves bytes of a read past the current message into pending_. Returns
+  // the bytes left for the current message.
+  int TakeHandshakeRead(int result);
+
+  // Opens udp_socket_ for a UDP association.
+  int ListenUdp();
+
   int DoLoop(int last_io_result);
+  int DoProxyHeaderRead();
+  int DoProxyHeaderReadComplete(int result);
   int DoGreetRead();
   int DoGreetReadComplete(int result);
   int DoGreetWrite();
@@ -141,6 +195,15 @@ class Socks5ServerSocket : public StreamSocket {
   size_t bytes_sent_;
 
   size_t read_header_size_;
+  int handshake_read_size_;
+
+  // Bytes read past the message being parsed: the following messages of a
+  // pipelined handshake, then payload once the handshake has completed.
+  std::string pending_;
+
+  // Whether the method selection reply is deferred to go out with the
+  // request reply.
+  bool send_greet_reply_with_handshake_;
 
   bool was_ever_used_;
 
@@ -149,12 +212,24 @@ class Socks5ServerSocket : public StreamSocket {
 
   std::string user_;
   std::string pass_;
+  const NaiveUserTable* user_table_;
+  scoped_refptr<NaiveUserTable::User> authenticated_user_;
   char auth_method_;
   char auth_status_;
   char reply_;
 
   HostPortPair request_endpoint_;
 
+  bool proxy_protocol_ = false;
+  // The client address of the PROXY protocol header, unless the load
+  // balancer left it out.
+  std::optional<IPEndPoint> proxied_source_;
+
+  bool udp_associate_enabled_;
+  bool is_udp_associate_;
+  std::unique_ptr<DatagramServerSocket> udp_socket_;
+  IPEndPoint udp_endpoint_;
+
   NetLogWithSource net_log_;
 
   // Traffic annotation for socket control.
@@ -0,0 +1,253 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "net/tools/naive/socks5_udp_relay.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/sys_byteorder.h"
+#include "base/task/single_thread_task_runner.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/socket/datagram_server_socket.h"
+#include "net/tools/naive/naive_udp_flow.h"
+
+namespace net {
+
+namespace {
+// The largest UDP payload.
+constexpr int kUdpRecvBufferSize = 65535;
+// Bounds the tunnels one association may open at a time.
+constexpr size_t kMaxFlows = 256;
+// Datagrams read in a row before yielding to other connections, so a client
+// flooding the association cannot starve them.
+constexpr int kMaxRecvsPerTask = 32;
+
+constexpr char kReserved[] = {0x00, 0x00};
+constexpr char kFragmentNone = 0x00;
+constexpr char kAddressTypeIPv4 = 0x01;
+constexpr char kAddressTypeDomain = 0x03;
+constexpr char kAddressTypeIPv6 = 0x04;
+
+IPAddress Unmapped(const IPAddress& address) {
+  if (address.IsIPv4MappedIPv6())
+    return ConvertIPv4MappedIPv6ToIPv4(address);
+  return address;
+}
+
+// Parses the header of a client datagram. Returns the size of the header,
+// or 0 if it is malformed or fragmented.
+size_t ParseHeader(std::string_view datagram, HostPortPair* target) {
+  // RSV, FRAG, ATYP and at least one byte of DST.ADDR.
+  if (datagram.size() < 5 || datagram[2] != kFragmentNone)
+    return 0;
+  size_t offset = 4;
+  char address_type = datagram[3];
+  std::string host;
+  if (address_type == kAddressTypeIPv4 || address_type == kAddressTypeIPv6) {
+    size_t address_size = address_type == kAddressTypeIPv4
+                              ? IPAddress::kIPv4AddressSize
+                              : IPAddress::kIPv6AddressSize;
+    if (datagram.size() < offset + address_size + sizeof(uint16_t))
+      return 0;
+    IPAddress address(base::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(datagram.data() + offset),
+        address_size));
+    host = address.ToString();
+    offset += address_size;
+  } else if (address_type == kAddressTypeDomain) {
+    size_t domain_size = static_cast<uint8_t>(datagram[offset]);
+    ++offset;
+    if (domain_size == 0 ||
+        datagram.size() < offset + domain_size + sizeof(uint16_t)) {
+      return 0;
+    }
+    host = std::string(datagram.substr(offset, domain_size));
+    offset += domain_size;
+  } else {
+    return 0;
+  }
+  uint16_t port_net;
+  std::memcpy(&port_net, datagram.data() + offset, sizeof(port_net));
+  offset += sizeof(port_net);
+  *target = HostPortPair(host, base::NetToHost16(port_net));
+  return offset;
+}
+
+// Receive errors a UDP socket reports for a single datagram, e.g. an ICMP
+// error for an earlier send or a truncated datagram, after which it still
+// works.
+bool IsTransientRecvError(int error) {
+  return error == ERR_MSG_TOO_BIG || error == ERR_CONNECTION_REFUSED ||
+         error == ERR_CONNECTION_RESET || error == ERR_ADDRESS_UNREACHABLE;
+}
+
+void AppendHeader(const HostPortPair& target, std::string* header) {
+  header->append(kReserved, std::size(kReserved));
+  header->push_back(kFragmentNone);
+  IPAddress address;
+  if (address.AssignFromIPLiteral(target.host())) {
+    header->push_back(address.IsIPv4() ? kAddressTypeIPv4 : kAddressTypeIPv6);
+    header->append(reinterpret_cast<const char*>(address.bytes().data()),
+                   address.size());
+  } else {
+    header->push_back(kAddressTypeDomain);
+    header->push_back(static_cast<char>(target.host().size()));
+    header->append(target.host());
+  }
+  uint16_t port_net = base::HostToNet16(target.port());
+  header->append(reinterpret_cast<const char*>(&port_net), sizeof(port_net));
+}
+}  // namespace
+
+Socks5UdpRelay::Socks5UdpRelay(
+    std::unique_ptr<DatagramServerSocket> socket,
+    const IPAddress& client_address,
+    const ProxyChain& proxy_chain,
+    HttpNetworkSession* session,
+    const NetworkAnonymizationKey& network_anonymization_key,
+    base::TimeDelta idle_timeout,
+    const NetLogWithSource& net_log,
+    const NetworkTrafficAnnotationTag& traffic_annotation)
+    : socket_(std::move(socket)),
+      client_address_(Unmapped(client_address)),
+      proxy_chain_(proxy_chain),
+      session_(session),
+      network_anonymization_key_(network_anonymization_key),
+      idle_timeout_(idle_timeout),
+      net_log_(net_log),
+      recv_buffer_(base::MakeRefCounted<IOBufferWithSize>(kUdpRecvBufferSize)),
+      send_pending_(false),
+      traffic_annotation_(traffic_annotation) {
+  DCHECK(socket_);
+}
+
+Socks5UdpRelay::~Socks5UdpRelay() = default;
+
+void Socks5UdpRelay::Start(CompletionOnceCallback error_callback) {
+  error_callback_ = std::move(error_callback);
+  DoRecv();
+}
+
+void Socks5UdpRelay::DoRecv() {
+  for (int i = 0; i < kMaxRecvsPerTask; ++i) {
+    int rv = socket_->RecvFrom(recv_buffer_.get(), kUdpRecvBufferSize,
+                               &recv_address_,
+                               base::BindOnce(&Socks5UdpRelay::OnRecv,
+                                              weak_ptr_factory_.GetWeakPtr()));
+    if (rv == ERR_IO_PENDING)
+      return;
+    if (!HandleRecvResult(rv))
+      return;
+  }
+  base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(&Socks5UdpRelay::DoRecv,
+                                weak_ptr_factory_.GetWeakPtr()));
+}
+
+void Socks5UdpRelay::OnRecv(int result) {
+  if (HandleRecvResult(result))
+    DoRecv();
+}
+
+bool Socks5UdpRelay::HandleRecvResult(int result) {
+  if (result < 0) {
+    if (IsTransientRecvError(result)) {
+      LOG(INFO) << "UDP association: ignoring error "
+                << ErrorToShortString(result);
+      return true;
+    }
+    LOG(INFO) << "UDP association failed: " << ErrorToShortString(result);
+    // The owner destroys the relay, which is still on the call stack.
+    base::SingleThreadTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(std::move(error_callback_), result));
+    return false;
+  }
+  // Datagrams from other hosts than the client are dropped.
+  if (Unmapped(recv_address_.address()) != client_address_)
+    return true;
+
+  std::string_view datagram(recv_buffer_->data(), result);
+  HostPortPair target;
+  size_t header_size = ParseHeader(datagram, &target);
+  if (header_size == 0)
+    return true;
+  client_endpoint_ = recv_address_;
+
+  std::string_view payload = datagram.substr(header_size);
+  auto it = flows_.find(target);
+  if (it != flows_.end()) {
+    it->second->Send(payload);
+    return true;
+  }
+  if (flows_.size() >= kMaxFlows) {
+    LOG(WARNING) << "UDP association: too many flows, dropping datagram to "
+                 << target.ToString();
+    return true;
+  }
+  auto flow = std::make_unique<NaiveUdpFlow>(
+      target, proxy_chain_, session_, network_anonymization_key_,
+      idle_timeout_, net_log_, traffic_annotation_);
+  NaiveUdpFlow* flow_ptr = flow.get();
+  flows_.emplace(target, std::move(flow));
+  // Queued until the tunnel is established. Start() may close the flow
+  // synchronously, so it comes last.
+  flow_ptr->Send(payload);
+  flow_ptr->Start(
+      base::BindRepeating(&Socks5UdpRelay::OnFlowDatagram,
+                          weak_ptr_factory_.GetWeakPtr(), target),
+      base::BindOnce(&Socks5UdpRelay::OnFlowClosed,
+                     weak_ptr_factory_.GetWeakPtr(), target));
+  return true;
+}
+
+void Socks5UdpRelay::OnFlowDatagram(const HostPortPair& target,
+                                    std::string_view datagram) {
+  // Like a congested UDP path, drops datagrams while a send is pending.
+  if (send_pending_)
+    return;
+
+  std::string packet;
+  AppendHeader(target, &packet);
+  packet.append(datagram);
+  send_buffer_ = base::MakeRefCounted<IOBufferWithSize>(packet.size());
+  std::memcpy(send_buffer_->data(), packet.data(), packet.size());
+  int rv = socket_->SendTo(send_buffer_.get(), send_buffer_->size(),
+                           client_endpoint_,
+                           base::BindOnce(&Socks5UdpRelay::OnSend,
+                                          weak_ptr_factory_.GetWeakPtr()));
+  if (rv == ERR_IO_PENDING) {
+    send_pending_ = true;
+    return;
+  }
+  OnSend(rv);
+}
+
+void Socks5UdpRelay::OnSend(int result) {
+  send_pending_ = false;
+  send_buffer_.reset();
+  if (result < 0) {
+    LOG(INFO) << "UDP association: ignoring send error "
+              << ErrorToShortString(result);
+  }
+}
+
+void Socks5UdpRelay::OnFlowClosed(const HostPortPair& target, int result) {
+  auto it = flows_.find(target);
+  if (it == flows_.end())
+    return;
+  std::unique_ptr<NaiveUdpFlow> flow = std::move(it->second);
+  flows_.erase(it);
+  // The flow is still on the call stack.
+  base::SingleThreadTaskRunner::GetCurrentDefault()->DeleteSoon(
+      FROM_HERE, std::move(flow));
+}
+
+}  // namespace net
@@ -0,0 +1,89 @@
+// Copyright 2026 klzgrad <kizdiv@gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef NET_TOOLS_NAIVE_SOCKS5_UDP_RELAY_H_
+#define NET_TOOLS_NAIVE_SOCKS5_UDP_RELAY_H_
+
+#include <map>
+#include <memory>
+#include <string_view>
+
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "net/base/completion_once_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+
+namespace net {
+
+class DatagramServerSocket;
+class HttpNetworkSession;
+class IOBufferWithSize;
+class NaiveUdpFlow;
+class NetLogWithSource;
+class NetworkAnonymizationKey;
+class ProxyChain;
+struct NetworkTrafficAnnotationTag;
+
+// Relays the datagrams of a SOCKS5 UDP association (RFC 1928, section 7)
+// between the client and one NaiveUdpFlow per destination. The association
+// lasts as long as the relay, which its TCP control connection owns.
+class Socks5UdpRelay {
+ public:
+  // Only accepts datagrams from `client_address`, the address of the
+  // control connection.
+  Socks5UdpRelay(std::unique_ptr<DatagramServerSocket> socket,
+                 const IPAddress& client_address,
+                 const ProxyChain& proxy_chain,
+                 HttpNetworkSession* session,
+                 const NetworkAnonymizationKey& network_anonymization_key,
+                 base::TimeDelta idle_timeout,
+                 const NetLogWithSource& net_log,
+                 const NetworkTrafficAnnotationTag& traffic_annotation);
+  ~Socks5UdpRelay();
+  Socks5UdpRelay(const Socks5UdpRelay&) = delete;
+  Socks5UdpRelay& operator=(const Socks5UdpRelay&) = delete;
+
+  // Runs `error_callback` with the error that failed the client socket,
+  // after which the relay is to be destroyed.
+  void Start(CompletionOnceCallback error_callback);
+
+ private:
+  void DoRecv();
+  void OnRecv(int result);
+  // Returns false if the socket failed.
+  bool HandleRecvResult(int result);
+  void OnSend(int result);
+
+  void OnFlowDatagram(const HostPortPair& target, std::string_view datagram);
+  void OnFlowClosed(const HostPortPair& target, int result);
+
+  std::unique_ptr<DatagramServerSocket> socket_;
+  IPAddress client_address_;
+  // Where replies go, learned from the latest client datagram.
+  IPEndPoint client_endpoint_;
+  const ProxyChain& proxy_chain_;
+  HttpNetworkSession* session_;
+  const NetworkAnonymizationKey& network_anonymization_key_;
+  base::TimeDelta idle_timeout_;
+  const NetLogWithSource& net_log_;
+
+  CompletionOnceCallback error_callback_;
+
+  scoped_refptr<IOBufferWithSize> recv_buffer_;
+  IPEndPoint recv_address_;
+  scoped_refptr<IOBufferWithSize> send_buffer_;
+  bool send_pending_;
+
+  std::map<HostPortPair, std::unique_ptr<NaiveUdpFlow>> flows_;
+
+  // Traffic annotation for socket control.
+  const NetworkTrafficAnnotationTag& traffic_annotation_;
+
+  base::WeakPtrFactory<Socks5UdpRelay> weak_ptr_factory_{this};
+};
+
+}  // namespace net
+#endif  // NET_TOOLS_NAIVE_SOCKS5_UDP_RELAY_H_
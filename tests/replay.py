@@ -0,0 +1,336 @@
+#!/usr/bin/env python3
+"""Replays recorded streams through a naive client and server pair.
+
+Each trace is the output of tools/parse-pcap-stream.py for one TLS stream:
+lines of "<time> <size> <records>", time in half round trips of the capture
+as seen between the endpoints, size negative for the download direction.
+All traces given are replayed at once like the streams of one page load,
+through a naive client and a naive server on loopback, and the completion
+time and wire overhead are reported for each hop protocol.
+
+A send waits for the bytes of the other direction recorded before it,
+then for the think time the capture shows after them, so the replay keeps
+the request and response structure of the capture at any emulated RTT.
+--rtt-ms and --loss shape the hop between the two naive processes with
+tc netem on lo, which needs root.
+
+Wire overhead is the payload the naive client and server exchanged over
+the payload replayed, without TCP and IP headers:
+
+  tools/parse-pcap-stream.py capture.pcap 0 > stream0.txt
+  tests/replay.py --naive=out/Release/naive --rtt-ms=50 stream*.txt
+"""
+import argparse
+import socket
+import statistics
+import struct
+import subprocess
+import threading
+import time
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--naive', required=True)
+parser.add_argument('--rtt-ms', type=float, default=0,
+                    help='emulated round trip between client and server')
+parser.add_argument('--loss', type=float, default=0,
+                    help='emulated packet loss in percent, each way')
+parser.add_argument('--unit-ms', type=float, default=None,
+                    help='time of a trace unit, default half of --rtt-ms')
+parser.add_argument('--runs', type=int, default=5)
+parser.add_argument('traces', nargs='+')
+argv = parser.parse_args()
+
+UNIT = (argv.unit_ms if argv.unit_ms is not None else argv.rtt_ms / 2) / 1000
+SOURCE_HOST = '127.0.0.1'
+
+
+def load_trace(path):
+    entries = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 2 or fields[0].startswith('#'):
+                continue
+            size = int(fields[1])
+            if size:
+                entries.append((float(fields[0]), size))
+    return entries
+
+
+TRACES = [load_trace(path) for path in argv.traces]
+
+
+class Receiver:
+    """Counts the bytes read from a socket, noting when each total came."""
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.received = 0
+        self.arrivals = []
+        self.done = threading.Condition()
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def run(self):
+        while True:
+            try:
+                data = self.sock.recv(1 << 20)
+            except OSError:
+                data = b''
+            with self.done:
+                if data:
+                    self.received += len(data)
+                    self.arrivals.append((self.received, time.monotonic()))
+                else:
+                    self.received = -1
+                self.done.notify_all()
+            if not data:
+                return
+
+    def wait_for(self, size):
+        # Returns when `size` bytes had arrived, or None on EOF before.
+        with self.done:
+            while 0 <= self.received < size:
+                self.done.wait()
+            for total, arrival in self.arrivals:
+                if total >= size:
+                    return arrival
+            return None
+
+
+def play(sock, trace, upload):
+    # Sends the entries of one direction and returns the receiver of the
+    # other once all of it has arrived.
+    receiver = Receiver(sock)
+    expected = sum(abs(size) for _, size in trace if (size > 0) != upload)
+    received_before = 0
+    last_other_time = None
+    last_send = time.monotonic()
+    last_time = trace[0][0] if trace else 0
+    for t, size in trace:
+        if (size > 0) != upload:
+            received_before += abs(size)
+            last_other_time = t
+            continue
+        ready = last_send + max(0, t - last_time) * UNIT
+        if received_before:
+            arrival = receiver.wait_for(received_before)
+            if arrival is None:
+                raise ConnectionError('unexpected EOF')
+            # A unit each way between the capture point and the endpoint.
+            ready = max(ready, arrival + max(0, t - last_other_time - 1) * UNIT)
+        delay = ready - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        last_send = time.monotonic()
+        last_time = t
+        sock.sendall(b'\0' * size)
+    if expected and receiver.wait_for(expected) is None:
+        raise ConnectionError('unexpected EOF')
+    return receiver
+
+
+def serve_source(listener):
+    # Each connection names its trace with a 4-byte index, then the download
+    # direction of the trace is played against the upload.
+    def handle(conn):
+        with conn:
+            try:
+                header = b''
+                while len(header) < 4:
+                    data = conn.recv(4 - len(header))
+                    if not data:
+                        return
+                    header += data
+                trace = TRACES[struct.unpack('!I', header)[0]]
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                receiver = play(conn, trace, upload=False)
+                conn.shutdown(socket.SHUT_WR)
+                receiver.wait_for(1 << 62)
+            except OSError:
+                pass
+
+    while True:
+        conn, _ = listener.accept()
+        threading.Thread(target=handle, args=(conn,), daemon=True).start()
+
+
+def listen():
+    sock = socket.socket()
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('127.0.0.1', 0))
+    sock.listen(1024)
+    return sock, sock.getsockname()[1]
+
+
+source, SOURCE_PORT = listen()
+threading.Thread(target=serve_source, args=(source,), daemon=True).start()
+
+
+class WireCounter:
+    """Forwards the hop between the naive client and server, counting it."""
+
+    def __init__(self, target_port):
+        self.target_port = target_port
+        self.bytes = [0, 0]
+        self.lock = threading.Lock()
+        self.listener, self.port = listen()
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def run(self):
+        while True:
+            conn, _ = self.listener.accept()
+            upstream = socket.create_connection(('127.0.0.1', self.target_port))
+            for sock in (conn, upstream):
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            threading.Thread(target=self.pump, args=(conn, upstream, 0),
+                             daemon=True).start()
+            threading.Thread(target=self.pump, args=(upstream, conn, 1),
+                             daemon=True).start()
+
+    def pump(self, source, target, direction):
+        try:
+            while True:
+                data = source.recv(1 << 20)
+                if not data:
+                    break
+                with self.lock:
+                    self.bytes[direction] += len(data)
+                target.sendall(data)
+            target.shutdown(socket.SHUT_WR)
+        except OSError:
+            pass
+
+    def take(self):
+        with self.lock:
+            result, self.bytes = self.bytes, [0, 0]
+        return result
+
+
+def shape_port(port):
+    # Sends the packets to and from `port` on lo through netem, leaving the
+    # rest of loopback alone.
+    def tc(*args):
+        subprocess.run(['tc'] + list(args), check=True)
+    tc('qdisc', 'add', 'dev', 'lo', 'root', 'handle', '1:', 'prio', 'bands',
+       '4', 'priomap', *(['1'] * 16))
+    netem = ['delay', f'{argv.rtt_ms / 2}ms']
+    if argv.loss:
+        netem += ['loss', f'{argv.loss}%']
+    tc('qdisc', 'add', 'dev', 'lo', 'parent', '1:4', 'handle', '40:', 'netem',
+       *netem)
+    for field in ('sport', 'dport'):
+        tc('filter', 'add', 'dev', 'lo', 'parent', '1:', 'protocol', 'ip',
+           'u32', 'match', 'ip', field, str(port), '0xffff', 'flowid', '1:4')
+
+
+def unshape():
+    subprocess.run(['tc', 'qdisc', 'del', 'dev', 'lo', 'root'],
+                   stderr=subprocess.DEVNULL)
+
+
+port = 20000
+
+
+def allocate_port_number():
+    global port
+    port += 1
+    return port
+
+
+def start_naive(naive_args):
+    cmdline = [argv.naive, '--log'] + naive_args
+    proc = subprocess.Popen(cmdline, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE, text=True, encoding='utf-8')
+    while True:
+        line = proc.stderr.readline()
+        if not line or proc.poll() is not None:
+            raise RuntimeError('failed to start: ' + ' '.join(cmdline))
+        if 'Listening on ' in line:
+            break
+    # Keeps draining the log so naive never blocks on a full pipe.
+    threading.Thread(target=lambda: proc.stderr.read(), daemon=True).start()
+    return proc
+
+
+def recv_exactly(sock, size):
+    data = b''
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError('unexpected EOF')
+        data += chunk
+    return data
+
+
+def replay_stream(index, client_port, errors):
+    try:
+        sock = socket.create_connection(('127.0.0.1', client_port))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.sendall(b'\x05\x01\x00')
+        recv_exactly(sock, 2)
+        sock.sendall(b'\x05\x01\x00\x01' + socket.inet_aton(SOURCE_HOST) +
+                     struct.pack('!H', SOURCE_PORT))
+        recv_exactly(sock, 10)
+        sock.sendall(struct.pack('!I', index))
+        play(sock, TRACES[index], upload=True)
+        sock.close()
+    except OSError as e:
+        errors.append(e)
+
+
+def measure(protocol):
+    server_port = allocate_port_number()
+    client_port = allocate_port_number()
+    procs = []
+    try:
+        procs.append(start_naive(
+            [f'--listen={protocol}://127.0.0.1:{server_port}']))
+        counter = WireCounter(server_port)
+        if argv.rtt_ms or argv.loss:
+            shape_port(counter.port)
+        procs.append(start_naive(
+            [f'--listen=socks://127.0.0.1:{client_port}',
+             f'--proxy={protocol}://127.0.0.1:{counter.port}']))
+
+        payload = [sum(size for trace in TRACES for _, size in trace
+                       if size > 0),
+                   sum(-size for trace in TRACES for _, size in trace
+                       if size < 0)]
+        times = []
+        overheads = []
+        for _ in range(argv.runs):
+            counter.take()
+            errors = []
+            start = time.monotonic()
+            threads = [threading.Thread(target=replay_stream,
+                                        args=(i, client_port, errors))
+                       for i in range(len(TRACES))]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+            times.append((time.monotonic() - start) * 1000)
+            if errors:
+                raise errors[0]
+            # Lets the closing frames reach the counter.
+            time.sleep(0.2)
+            wire = counter.take()
+            overheads.append([wire[i] / max(1, payload[i]) - 1
+                              for i in range(2)])
+
+        up = statistics.mean(o[0] for o in overheads) * 100
+        down = statistics.mean(o[1] for o in overheads) * 100
+        print(f'{protocol + " hop":12} completion p50 '
+              f'{statistics.median(times):8.1f} ms max {max(times):8.1f} ms  '
+              f'overhead up {up:6.1f}% down {down:6.1f}%')
+    finally:
+        unshape()
+        for proc in procs:
+            proc.terminate()
+            proc.wait()
+
+
+# The HTTP hop negotiates padding between the two naive instances, the SOCKS
+# hop carries no padding and shows the cost of the relay alone.
+for protocol in ['http', 'socks']:
+    measure(protocol)